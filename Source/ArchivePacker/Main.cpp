@@ -0,0 +1,139 @@
+#include "Precompiled.hpp"
+#include "Common/Archive.hpp"
+#include "Graphics/TextureAtlas.hpp"
+#include "Graphics/CompressedTexture.hpp"
+#include "Graphics/MeshProcessor.hpp"
+#include "System/DataTable.hpp"
+
+int main(int argc, char* argv[])
+{
+    Build::Initialize();
+    Debug::Initialize();
+    Logger::Initialize();
+
+    // Check command line arguments.
+    if(argc < 3)
+    {
+        std::cout << "Usage: ArchivePacker <archive> [--store] <file>...\n";
+        std::cout << "       ArchivePacker --atlas <image> <index> <file>...\n";
+        std::cout << "       ArchivePacker --compress <bc1|bc3> <texture> <image>\n";
+        std::cout << "       ArchivePacker --mesh <mesh> <obj>\n";
+        std::cout << "       ArchivePacker --table <table> <csv>\n";
+        return -1;
+    }
+
+    // Compile a CSV file into a data table.
+    if(std::string(argv[1]) == "--table")
+    {
+        if(argc != 4)
+        {
+            std::cout << "Usage: ArchivePacker --table <table> <csv>\n";
+            return -1;
+        }
+
+        if(!System::DataTable::Compile(argv[3], argv[2]))
+            return -1;
+
+        Log() << "Compiled \"" << argv[3] << "\" into \"" << argv[2] << "\".";
+
+        return 0;
+    }
+
+    // Process a source mesh into a mesh file.
+    if(std::string(argv[1]) == "--mesh")
+    {
+        if(argc != 4)
+        {
+            std::cout << "Usage: ArchivePacker --mesh <mesh> <obj>\n";
+            return -1;
+        }
+
+        if(!Graphics::MeshProcessor::Convert(argv[3], argv[2]))
+            return -1;
+
+        Log() << "Processed \"" << argv[3] << "\" into \"" << argv[2] << "\".";
+
+        return 0;
+    }
+
+    // Compress an image into a texture with all mipmap levels.
+    if(std::string(argv[1]) == "--compress")
+    {
+        std::string format = argc == 5 ? argv[2] : "";
+
+        if(format != "bc1" && format != "bc3")
+        {
+            std::cout << "Usage: ArchivePacker --compress <bc1|bc3> <texture> <image>\n";
+            return -1;
+        }
+
+        Graphics::BlockFormats::Type blockFormat = format == "bc1" ? Graphics::BlockFormats::BC1 : Graphics::BlockFormats::BC3;
+
+        if(!Graphics::CompressedTexture::Convert(argv[4], argv[3], blockFormat))
+            return -1;
+
+        Log() << "Compressed \"" << argv[4] << "\" into \"" << argv[3] << "\" as " << format << ".";
+
+        return 0;
+    }
+
+    // Bake images into a texture atlas instead of an archive.
+    if(std::string(argv[1]) == "--atlas")
+    {
+        if(argc < 5)
+        {
+            std::cout << "Usage: ArchivePacker --atlas <image> <index> <file>...\n";
+            return -1;
+        }
+
+        Graphics::TextureAtlas atlas;
+
+        for(int i = 4; i < argc; ++i)
+        {
+            std::string filename = argv[i];
+            std::replace(filename.begin(), filename.end(), '\\', '/');
+
+            if(!atlas.AddFile(filename))
+                return -1;
+        }
+
+        if(!atlas.Pack())
+            return -1;
+
+        if(!atlas.Save(argv[2], argv[3]))
+            return -1;
+
+        Log() << "Baked " << atlas.GetRegionCount() << " images into a " << atlas.GetWidth() << "x" << atlas.GetHeight() << " atlas in \"" << argv[2] << "\".";
+
+        return 0;
+    }
+
+    // Add files as entries named after their paths.
+    // Files following the store option are added without compression.
+    ArchiveWriter writer;
+    bool compress = true;
+
+    for(int i = 2; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+
+        if(argument == "--store")
+        {
+            compress = false;
+            continue;
+        }
+
+        std::string name = argument;
+        std::replace(name.begin(), name.end(), '\\', '/');
+
+        if(!writer.AddFile(name, argument, compress))
+            return -1;
+    }
+
+    if(!writer.Write(argv[1]))
+        return -1;
+
+    Log() << "Packed " << writer.GetEntryCount() << " files into \"" << argv[1] << "\".";
+
+    return 0;
+}
@@ -0,0 +1,1079 @@
+#include "Precompiled.hpp"
+#include "AudioMixer.hpp"
+#include "Game/Transform.hpp"
+using namespace Audio;
+
+// Select the widest available instruction set for kernels.
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define AUDIO_MIXER_AVX
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define AUDIO_MIXER_SSE
+#endif
+
+#if defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+#if defined(WIN32) && !defined(WAVE_FORMAT_IEEE_FLOAT)
+    #define WAVE_FORMAT_IEEE_FLOAT 0x0003
+#endif
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize the audio mixer! "
+    #define LogCreateSoundError() "Failed to create a sound! "
+
+    // Constant variables.
+    const int ChannelCount = 2;
+    const float QuarterPi = 0.78539816f;
+
+    // Lanes of the selected instruction set.
+    // Kernels are written once against these and step through blocks by the lane width.
+#if defined(AUDIO_MIXER_AVX)
+    typedef __m256 Lanes;
+    const int LaneWidth = 8;
+
+    inline Lanes LoadLanes(const float* data) { return _mm256_loadu_ps(data); }
+    inline void StoreLanes(float* data, Lanes value) { _mm256_storeu_ps(data, value); }
+    inline Lanes SetLanes(float value) { return _mm256_set1_ps(value); }
+    inline Lanes OffsetLanes() { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+    inline Lanes AddLanes(Lanes first, Lanes second) { return _mm256_add_ps(first, second); }
+    inline Lanes SubtractLanes(Lanes first, Lanes second) { return _mm256_sub_ps(first, second); }
+    inline Lanes MultiplyLanes(Lanes first, Lanes second) { return _mm256_mul_ps(first, second); }
+    inline Lanes ClampLanes(Lanes value, Lanes minimum, Lanes maximum) { return _mm256_min_ps(_mm256_max_ps(value, minimum), maximum); }
+
+    inline void StoreInterleavedLanes(float* data, Lanes first, Lanes second)
+    {
+        // Unpacking works within halves, which are put back in order afterwards.
+        __m256 low = _mm256_unpacklo_ps(first, second);
+        __m256 high = _mm256_unpackhi_ps(first, second);
+
+        _mm256_storeu_ps(data, _mm256_permute2f128_ps(low, high, 0x20));
+        _mm256_storeu_ps(data + 8, _mm256_permute2f128_ps(low, high, 0x31));
+    }
+#elif defined(AUDIO_MIXER_SSE)
+    typedef __m128 Lanes;
+    const int LaneWidth = 4;
+
+    inline Lanes LoadLanes(const float* data) { return _mm_loadu_ps(data); }
+    inline void StoreLanes(float* data, Lanes value) { _mm_storeu_ps(data, value); }
+    inline Lanes SetLanes(float value) { return _mm_set1_ps(value); }
+    inline Lanes OffsetLanes() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+    inline Lanes AddLanes(Lanes first, Lanes second) { return _mm_add_ps(first, second); }
+    inline Lanes SubtractLanes(Lanes first, Lanes second) { return _mm_sub_ps(first, second); }
+    inline Lanes MultiplyLanes(Lanes first, Lanes second) { return _mm_mul_ps(first, second); }
+    inline Lanes ClampLanes(Lanes value, Lanes minimum, Lanes maximum) { return _mm_min_ps(_mm_max_ps(value, minimum), maximum); }
+
+    inline void StoreInterleavedLanes(float* data, Lanes first, Lanes second)
+    {
+        _mm_storeu_ps(data, _mm_unpacklo_ps(first, second));
+        _mm_storeu_ps(data + 4, _mm_unpackhi_ps(first, second));
+    }
+#else
+    typedef float Lanes;
+    const int LaneWidth = 1;
+
+    inline Lanes LoadLanes(const float* data) { return *data; }
+    inline void StoreLanes(float* data, Lanes value) { *data = value; }
+    inline Lanes SetLanes(float value) { return value; }
+    inline Lanes OffsetLanes() { return 0.0f; }
+    inline Lanes AddLanes(Lanes first, Lanes second) { return first + second; }
+    inline Lanes SubtractLanes(Lanes first, Lanes second) { return first - second; }
+    inline Lanes MultiplyLanes(Lanes first, Lanes second) { return first * second; }
+    inline Lanes ClampLanes(Lanes value, Lanes minimum, Lanes maximum) { return std::min(std::max(value, minimum), maximum); }
+
+    inline void StoreInterleavedLanes(float* data, Lanes first, Lanes second)
+    {
+        data[0] = first;
+        data[1] = second;
+    }
+#endif
+
+    // Interpolates between pairs of samples by fractions.
+    // Results are written over the first samples.
+    void InterpolateSamples(float* first, const float* second, const float* fractions, int count)
+    {
+        for(int i = 0; i < count; i += LaneWidth)
+        {
+            Lanes a = LoadLanes(first + i);
+            Lanes b = LoadLanes(second + i);
+
+            StoreLanes(first + i, AddLanes(a, MultiplyLanes(SubtractLanes(b, a), LoadLanes(fractions + i))));
+        }
+    }
+
+    // Accumulates mono samples into both channels with gains ramped linearly over the count.
+    void MixPanned(const float* source, float* left, float* right, float leftStart, float leftEnd, float rightStart, float rightEnd, int count)
+    {
+        float leftStep = (leftEnd - leftStart) / (float)count;
+        float rightStep = (rightEnd - rightStart) / (float)count;
+
+        Lanes offsets = OffsetLanes();
+        Lanes leftSteps = SetLanes(leftStep);
+        Lanes rightSteps = SetLanes(rightStep);
+
+        for(int i = 0; i < count; i += LaneWidth)
+        {
+            Lanes indices = AddLanes(SetLanes((float)i), offsets);
+            Lanes leftGains = AddLanes(SetLanes(leftStart), MultiplyLanes(indices, leftSteps));
+            Lanes rightGains = AddLanes(SetLanes(rightStart), MultiplyLanes(indices, rightSteps));
+
+            Lanes samples = LoadLanes(source + i);
+
+            StoreLanes(left + i, AddLanes(LoadLanes(left + i), MultiplyLanes(samples, leftGains)));
+            StoreLanes(right + i, AddLanes(LoadLanes(right + i), MultiplyLanes(samples, rightGains)));
+        }
+    }
+
+    // Clamps both channels to the output range and interleaves them.
+    void InterleaveChannels(const float* left, const float* right, float* output, int count)
+    {
+        Lanes minimum = SetLanes(-1.0f);
+        Lanes maximum = SetLanes(1.0f);
+
+        for(int i = 0; i < count; i += LaneWidth)
+        {
+            Lanes first = ClampLanes(LoadLanes(left + i), minimum, maximum);
+            Lanes second = ClampLanes(LoadLanes(right + i), minimum, maximum);
+
+            StoreInterleavedLanes(output + i * ChannelCount, first, second);
+        }
+    }
+
+    // Rounds up to the next power of two.
+    std::size_t RoundUpToPowerOfTwo(std::size_t value)
+    {
+        std::size_t result = 1;
+
+        while(result < value)
+        {
+            result <<= 1;
+        }
+
+        return result;
+    }
+}
+
+const int AudioMixer::InvalidSound;
+
+VoiceInfo::VoiceInfo() :
+    gain(1.0f),
+    pitch(1.0f),
+    pan(0.0f),
+    position(0.0f, 0.0f, 0.0f),
+    loop(false),
+    spatial(false)
+{
+}
+
+AudioMixerStatistics::AudioMixerStatistics() :
+    blockCount(0),
+    underrunCount(0),
+    playingVoices(0),
+    mixedVoices(0),
+    pendingCommands(0)
+{
+}
+
+AudioMixerInfo::AudioMixerInfo() :
+    entitySystem(nullptr),
+    componentSystem(nullptr),
+    sampleRate(48000),
+    blockSize(256),
+    blockCount(3),
+    voiceCapacity(256),
+    voiceBudget(32),
+    soundCapacity(256),
+    commandCapacity(1024),
+    referenceDistance(64.0f),
+    maximumDistance(2048.0f),
+    nullDevice(false)
+{
+}
+
+void AudioMixer::Voices::Resize(int capacity)
+{
+    sounds.assign(capacity, InvalidSound);
+    cursors.assign(capacity, 0.0);
+    infos.assign(capacity, VoiceInfo());
+    audibilities.assign(capacity, 0.0f);
+    leftTargets.assign(capacity, 0.0f);
+    rightTargets.assign(capacity, 0.0f);
+    leftGains.assign(capacity, 0.0f);
+    rightGains.assign(capacity, 0.0f);
+    mixed.assign(capacity, false);
+
+    playing.clear();
+    playing.reserve(capacity);
+}
+
+AudioMixer::AudioMixer() :
+    m_entitySystem(nullptr),
+    m_componentSystem(nullptr),
+    m_soundCount(0),
+    m_listener(0.0f, 0.0f, 0.0f),
+    m_deviceBlock(0),
+#if defined(WIN32)
+    m_device(nullptr),
+    m_deviceEvent(nullptr),
+#endif
+    m_stop(false),
+    m_blockCount(0),
+    m_underrunCount(0),
+    m_playingVoices(0),
+    m_mixedVoices(0),
+    m_initialized(false)
+{
+}
+
+AudioMixer::~AudioMixer()
+{
+    this->Cleanup();
+}
+
+void AudioMixer::Cleanup()
+{
+    // Stop the mixer thread before anything it uses.
+    if(m_thread.joinable())
+    {
+        m_stop.store(true, std::memory_order_release);
+        m_thread.join();
+    }
+
+    m_stop.store(false, std::memory_order_relaxed);
+
+    this->CloseDevice();
+
+    // Unsubscribe from the component system.
+    m_emitterDestroy.Cleanup();
+    m_entitySystem = nullptr;
+    m_componentSystem = nullptr;
+
+    m_info = AudioMixerInfo();
+
+    // Release sounds and voices.
+    m_sounds.reset();
+    m_soundCount.store(0, std::memory_order_relaxed);
+
+    m_commands.Cleanup();
+    m_finished.Cleanup();
+    Utility::ClearContainer(m_pending);
+
+    Utility::ClearContainer(m_generations);
+    Utility::ClearContainer(m_active);
+    Utility::ClearContainer(m_freeVoices);
+    Utility::ClearContainer(m_sentPositions);
+
+    m_voices = Voices();
+
+    Utility::ClearContainer(m_resampled);
+    Utility::ClearContainer(m_left);
+    Utility::ClearContainer(m_right);
+    Utility::ClearContainer(m_order);
+
+    m_listener = glm::vec3(0.0f, 0.0f, 0.0f);
+
+    // Reset statistics.
+    m_blockCount.store(0, std::memory_order_relaxed);
+    m_underrunCount.store(0, std::memory_order_relaxed);
+    m_playingVoices.store(0, std::memory_order_relaxed);
+    m_mixedVoices.store(0, std::memory_order_relaxed);
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool AudioMixer::Initialize(const AudioMixerInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    bool initialized = false;
+
+    SCOPE_GUARD
+    (
+        if(!initialized)
+        {
+            this->Cleanup();
+        }
+    );
+
+    // Validate arguments.
+    if((info.entitySystem == nullptr) != (info.componentSystem == nullptr))
+    {
+        LogError() << LogInitializeError() << "Entity and component systems must be set together.";
+        return false;
+    }
+
+    if(info.sampleRate <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid sample rate.";
+        return false;
+    }
+
+    if(info.blockSize <= 0 || info.blockSize % 8 != 0)
+    {
+        LogError() << LogInitializeError() << "Block size must be a positive multiple of eight.";
+        return false;
+    }
+
+    if(info.blockCount < 2)
+    {
+        LogError() << LogInitializeError() << "At least two blocks are needed.";
+        return false;
+    }
+
+    if(info.voiceCapacity <= 0 || info.voiceBudget <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid voice capacity or budget.";
+        return false;
+    }
+
+    if(info.soundCapacity <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid sound capacity.";
+        return false;
+    }
+
+    if(info.referenceDistance <= 0.0f || info.maximumDistance <= info.referenceDistance)
+    {
+        LogError() << LogInitializeError() << "Maximum distance must be greater than a positive reference distance.";
+        return false;
+    }
+
+    m_info = info;
+
+    // Allocate sounds and voices up front, so the mixer thread never allocates.
+    m_sounds.reset(new Sound[info.soundCapacity]);
+
+    if(!m_commands.Initialize((std::size_t)info.commandCapacity))
+    {
+        LogError() << LogInitializeError() << "Could not create the command queue.";
+        return false;
+    }
+
+    // Each voice is finished once before its slot is reused, so this queue can never fill up.
+    if(!m_finished.Initialize(RoundUpToPowerOfTwo((std::size_t)info.voiceCapacity)))
+    {
+        LogError() << LogInitializeError() << "Could not create the finished voice queue.";
+        return false;
+    }
+
+    m_generations.assign(info.voiceCapacity, 0);
+    m_active.assign(info.voiceCapacity, false);
+    m_sentPositions.assign(info.voiceCapacity, glm::vec3(0.0f, 0.0f, 0.0f));
+
+    m_freeVoices.reserve(info.voiceCapacity);
+
+    for(int i = info.voiceCapacity - 1; i >= 0; --i)
+    {
+        m_freeVoices.push_back(i);
+    }
+
+    m_voices.Resize(info.voiceCapacity);
+    m_order.reserve(info.voiceCapacity);
+
+    // Scratch buffers hold first and second samples and fractions of a resampled block.
+    m_resampled.resize(info.blockSize * 3);
+    m_left.resize(info.blockSize);
+    m_right.resize(info.blockSize);
+
+    // Stop voices of destroyed emitters.
+    if(info.componentSystem != nullptr)
+    {
+        m_entitySystem = info.entitySystem;
+        m_componentSystem = info.componentSystem;
+
+        m_emitterDestroy.Bind<AudioMixer, &AudioMixer::OnEmitterDestroy>(this);
+        m_emitterDestroy.Subscribe(m_componentSystem->GetDestroyEvent(Game::ComponentTypes::GetSignature<SoundEmitter>()));
+    }
+
+    // Open the output device.
+    if(!this->OpenDevice())
+        return false;
+
+    // Start the mixer thread.
+    m_thread = std::thread(&AudioMixer::MixerMain, this);
+
+    // Success!
+    return m_initialized = initialized = true;
+}
+
+int AudioMixer::CreateSound(const float* samples, int count, int sampleRate)
+{
+    if(!m_initialized)
+        return InvalidSound;
+
+    if(samples == nullptr || count <= 0 || sampleRate <= 0)
+    {
+        LogError() << LogCreateSoundError() << "Invalid samples.";
+        return InvalidSound;
+    }
+
+    int sound = m_soundCount.load(std::memory_order_relaxed);
+
+    if(sound >= m_info.soundCapacity)
+    {
+        LogError() << LogCreateSoundError() << "Reached the sound capacity.";
+        return InvalidSound;
+    }
+
+    m_sounds[sound].samples.assign(samples, samples + count);
+    m_sounds[sound].sampleRate = sampleRate;
+
+    // Publish the sound to the mixer thread.
+    m_soundCount.store(sound + 1, std::memory_order_release);
+
+    return sound;
+}
+
+VoiceHandle AudioMixer::Play(int sound, const VoiceInfo& info)
+{
+    if(!m_initialized)
+        return VoiceHandle();
+
+    Assert(sound >= 0 && sound < m_soundCount.load(std::memory_order_relaxed), "Invalid sound!");
+
+    if(m_freeVoices.empty())
+        return VoiceHandle();
+
+    // Take a free voice slot.
+    int index = m_freeVoices.back();
+    m_freeVoices.pop_back();
+
+    m_active[index] = true;
+    m_sentPositions[index] = info.position;
+
+    Command command;
+    command.type = CommandTypes::Play;
+    command.voice = index;
+    command.sound = sound;
+    command.info = info;
+
+    this->Submit(command);
+
+    VoiceHandle handle;
+    handle.index = index;
+    handle.generation = m_generations[index];
+
+    return handle;
+}
+
+void AudioMixer::Stop(const VoiceHandle& voice)
+{
+    if(!this->IsVoiceValid(voice))
+        return;
+
+    // The slot is reclaimed once the mixer thread hands it back.
+    Command command;
+    command.type = CommandTypes::Stop;
+    command.voice = voice.index;
+    command.sound = InvalidSound;
+
+    this->Submit(command);
+}
+
+void AudioMixer::SetGain(const VoiceHandle& voice, float gain)
+{
+    if(!this->IsVoiceValid(voice))
+        return;
+
+    Command command;
+    command.type = CommandTypes::SetGain;
+    command.voice = voice.index;
+    command.sound = InvalidSound;
+    command.info.gain = gain;
+
+    this->Submit(command);
+}
+
+void AudioMixer::SetPitch(const VoiceHandle& voice, float pitch)
+{
+    if(!this->IsVoiceValid(voice))
+        return;
+
+    Command command;
+    command.type = CommandTypes::SetPitch;
+    command.voice = voice.index;
+    command.sound = InvalidSound;
+    command.info.pitch = pitch;
+
+    this->Submit(command);
+}
+
+void AudioMixer::SetPan(const VoiceHandle& voice, float pan)
+{
+    if(!this->IsVoiceValid(voice))
+        return;
+
+    Command command;
+    command.type = CommandTypes::SetPan;
+    command.voice = voice.index;
+    command.sound = InvalidSound;
+    command.info.pan = pan;
+
+    this->Submit(command);
+}
+
+void AudioMixer::SetPosition(const VoiceHandle& voice, const glm::vec3& position)
+{
+    if(!this->IsVoiceValid(voice))
+        return;
+
+    m_sentPositions[voice.index] = position;
+
+    Command command;
+    command.type = CommandTypes::SetPosition;
+    command.voice = voice.index;
+    command.sound = InvalidSound;
+    command.info.position = position;
+
+    this->Submit(command);
+}
+
+void AudioMixer::SetListener(const glm::vec3& position)
+{
+    if(!m_initialized)
+        return;
+
+    Command command;
+    command.type = CommandTypes::SetListener;
+    command.voice = -1;
+    command.sound = InvalidSound;
+    command.info.position = position;
+
+    this->Submit(command);
+}
+
+void AudioMixer::Update()
+{
+    if(!m_initialized)
+        return;
+
+    // Reclaim slots of voices finished by the mixer thread.
+    int index = 0;
+
+    while(m_finished.TryPop(index))
+    {
+        m_active[index] = false;
+        m_generations[index] += 1;
+        m_freeVoices.push_back(index);
+    }
+
+    // Send positions of emitters that moved since they were last sent.
+    if(m_componentSystem != nullptr)
+    {
+        m_componentSystem->ForEachChunk<Game::Transform, SoundEmitter>([&](int count, const Game::EntityHandle* entities, Game::Transform* transforms, SoundEmitter* emitters)
+        {
+            for(int i = 0; i < count; ++i)
+            {
+                const VoiceHandle& voice = emitters[i].voice;
+
+                if(this->IsVoiceValid(voice) && m_sentPositions[voice.index] != transforms[i].position)
+                {
+                    this->SetPosition(voice, transforms[i].position);
+                }
+            }
+        });
+    }
+
+    // Submit commands that waited for room in the queue, in order.
+    std::size_t submitted = 0;
+
+    while(submitted < m_pending.size() && m_commands.TryPush(m_pending[submitted]))
+    {
+        ++submitted;
+    }
+
+    m_pending.erase(m_pending.begin(), m_pending.begin() + submitted);
+}
+
+bool AudioMixer::IsPlaying(const VoiceHandle& voice) const
+{
+    return this->IsVoiceValid(voice);
+}
+
+AudioMixerStatistics AudioMixer::GetStatistics() const
+{
+    AudioMixerStatistics statistics;
+    statistics.blockCount = m_blockCount.load(std::memory_order_relaxed);
+    statistics.underrunCount = m_underrunCount.load(std::memory_order_relaxed);
+    statistics.playingVoices = m_playingVoices.load(std::memory_order_relaxed);
+    statistics.mixedVoices = m_mixedVoices.load(std::memory_order_relaxed);
+    statistics.pendingCommands = (int)m_pending.size();
+
+    return statistics;
+}
+
+bool AudioMixer::IsInitialized() const
+{
+    return m_initialized;
+}
+
+void AudioMixer::Submit(const Command& command)
+{
+    // Keep commands behind those that are already waiting.
+    if(!m_pending.empty() || !m_commands.TryPush(command))
+    {
+        m_pending.push_back(command);
+    }
+}
+
+bool AudioMixer::IsVoiceValid(const VoiceHandle& voice) const
+{
+    if(!m_initialized)
+        return false;
+
+    if(voice.index < 0 || voice.index >= (int)m_active.size())
+        return false;
+
+    return m_active[voice.index] && m_generations[voice.index] == voice.generation;
+}
+
+void AudioMixer::MixerMain()
+{
+    // Blocks must be ready before the device runs out of them.
+#if defined(WIN32)
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+#elif defined(__linux__)
+    // Real time scheduling needs privileges and the thread keeps its priority without them.
+    sched_param parameters;
+    parameters.sched_priority = sched_get_priority_min(SCHED_FIFO);
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameters);
+#endif
+
+    m_deadline = std::chrono::steady_clock::now();
+
+    while(!m_stop.load(std::memory_order_acquire))
+    {
+        float* output = this->AcquireDeviceBlock();
+
+        if(output == nullptr)
+            continue;
+
+        this->ProcessCommands();
+        this->MixBlock(output);
+        this->SubmitDeviceBlock();
+
+        m_blockCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void AudioMixer::ProcessCommands()
+{
+    Command command;
+
+    while(m_commands.TryPop(command))
+    {
+        if(command.type == CommandTypes::SetListener)
+        {
+            m_listener = command.info.position;
+            continue;
+        }
+
+        int voice = command.voice;
+
+        if(command.type == CommandTypes::Play)
+        {
+            m_voices.sounds[voice] = command.sound;
+            m_voices.cursors[voice] = 0.0;
+            m_voices.infos[voice] = command.info;
+            m_voices.leftGains[voice] = 0.0f;
+            m_voices.rightGains[voice] = 0.0f;
+            m_voices.mixed[voice] = false;
+            m_voices.playing.push_back(voice);
+            continue;
+        }
+
+        // Voices may finish here before the game thread sees it.
+        if(m_voices.sounds[voice] == InvalidSound)
+            continue;
+
+        VoiceInfo& info = m_voices.infos[voice];
+
+        switch(command.type)
+        {
+        case CommandTypes::Stop:
+            this->FinishVoice(voice);
+            break;
+
+        case CommandTypes::SetGain:
+            info.gain = command.info.gain;
+            break;
+
+        case CommandTypes::SetPitch:
+            info.pitch = command.info.pitch;
+            break;
+
+        case CommandTypes::SetPan:
+            info.pan = command.info.pan;
+            break;
+
+        case CommandTypes::SetPosition:
+            info.position = command.info.position;
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+void AudioMixer::MixBlock(float* output)
+{
+    const int frameCount = m_info.blockSize;
+    std::vector<int>& playing = m_voices.playing;
+
+    // Remove voices stopped by commands.
+    playing.erase(std::remove_if(playing.begin(), playing.end(), [&](int voice)
+    {
+        return m_voices.sounds[voice] == InvalidSound;
+    }), playing.end());
+
+    std::fill(m_left.begin(), m_left.end(), 0.0f);
+    std::fill(m_right.begin(), m_right.end(), 0.0f);
+
+    // Find the most audible voices within the budget.
+    m_order.assign(playing.begin(), playing.end());
+
+    for(int voice : m_order)
+    {
+        this->UpdateVoiceGains(voice);
+    }
+
+    int mixedCount = std::min((int)m_order.size(), m_info.voiceBudget);
+
+    if(mixedCount < (int)m_order.size())
+    {
+        std::nth_element(m_order.begin(), m_order.begin() + mixedCount, m_order.end(), [&](int first, int second)
+        {
+            return m_voices.audibilities[first] > m_voices.audibilities[second];
+        });
+    }
+
+    // Mix audible voices and advance the others silently.
+    int mixedVoices = 0;
+
+    for(int i = 0; i < (int)m_order.size(); ++i)
+    {
+        int voice = m_order[i];
+        bool audible = i < mixedCount && m_voices.audibilities[voice] > 0.0f;
+
+        bool active = this->AdvanceVoice(voice, audible ? m_resampled.data() : nullptr);
+
+        if(audible)
+        {
+            // Voices that were culled fade in from silence.
+            float leftStart = m_voices.mixed[voice] ? m_voices.leftGains[voice] : 0.0f;
+            float rightStart = m_voices.mixed[voice] ? m_voices.rightGains[voice] : 0.0f;
+
+            MixPanned(m_resampled.data(), m_left.data(), m_right.data(),
+                leftStart, m_voices.leftTargets[voice], rightStart, m_voices.rightTargets[voice], frameCount);
+
+            m_voices.leftGains[voice] = m_voices.leftTargets[voice];
+            m_voices.rightGains[voice] = m_voices.rightTargets[voice];
+
+            mixedVoices += 1;
+        }
+
+        m_voices.mixed[voice] = audible;
+
+        if(!active)
+        {
+            this->FinishVoice(voice);
+        }
+    }
+
+    // Remove voices that reached their end.
+    playing.erase(std::remove_if(playing.begin(), playing.end(), [&](int voice)
+    {
+        return m_voices.sounds[voice] == InvalidSound;
+    }), playing.end());
+
+    InterleaveChannels(m_left.data(), m_right.data(), output, frameCount);
+
+    m_playingVoices.store((int)playing.size(), std::memory_order_relaxed);
+    m_mixedVoices.store(mixedVoices, std::memory_order_relaxed);
+}
+
+void AudioMixer::UpdateVoiceGains(int voice)
+{
+    const VoiceInfo& info = m_voices.infos[voice];
+
+    float gain = std::max(info.gain, 0.0f);
+    float pan = info.pan;
+
+    if(info.spatial)
+    {
+        glm::vec3 offset = info.position - m_listener;
+        float distance = glm::length(offset);
+
+        // Attenuate by inverse distance past the reference distance and fade out towards the maximum.
+        if(distance >= m_info.maximumDistance)
+        {
+            gain = 0.0f;
+        }
+        else
+        {
+            float inverse = m_info.referenceDistance / std::max(distance, m_info.referenceDistance);
+            float fade = 1.0f - distance / m_info.maximumDistance;
+
+            gain *= inverse * fade;
+        }
+
+        pan = offset.x / std::max(distance, m_info.referenceDistance);
+    }
+
+    // Keep the total power constant across the stereo field.
+    float angle = (glm::clamp(pan, -1.0f, 1.0f) + 1.0f) * QuarterPi;
+
+    m_voices.leftTargets[voice] = gain * std::cos(angle);
+    m_voices.rightTargets[voice] = gain * std::sin(angle);
+    m_voices.audibilities[voice] = gain;
+}
+
+bool AudioMixer::AdvanceVoice(int voice, float* resampled)
+{
+    const Sound& sound = m_sounds[m_voices.sounds[voice]];
+    const VoiceInfo& info = m_voices.infos[voice];
+
+    const int frameCount = m_info.blockSize;
+    const int length = (int)sound.samples.size();
+    const double step = (double)std::max(info.pitch, 0.0f) * sound.sampleRate / m_info.sampleRate;
+
+    double cursor = m_voices.cursors[voice];
+
+    if(resampled != nullptr)
+    {
+        float* first = resampled;
+        float* second = resampled + frameCount;
+        float* fractions = resampled + frameCount * 2;
+
+        const float* samples = sound.samples.data();
+        double position = cursor;
+
+        // Gather pairs of neighboring samples, which are then interpolated together.
+        for(int i = 0; i < frameCount; ++i)
+        {
+            if(position >= length)
+            {
+                if(info.loop)
+                {
+                    position = std::fmod(position, (double)length);
+                }
+                else
+                {
+                    first[i] = 0.0f;
+                    second[i] = 0.0f;
+                    fractions[i] = 0.0f;
+                    continue;
+                }
+            }
+
+            int index = (int)position;
+            int next = index + 1;
+
+            first[i] = samples[index];
+            second[i] = next < length ? samples[next] : (info.loop ? samples[0] : 0.0f);
+            fractions[i] = (float)(position - index);
+
+            position += step;
+        }
+
+        InterpolateSamples(first, second, fractions, frameCount);
+    }
+
+    // Advance the cursor by the whole block.
+    cursor += step * frameCount;
+
+    if(info.loop)
+    {
+        m_voices.cursors[voice] = std::fmod(cursor, (double)length);
+        return true;
+    }
+
+    m_voices.cursors[voice] = cursor;
+    return cursor < length;
+}
+
+void AudioMixer::FinishVoice(int voice)
+{
+    m_voices.sounds[voice] = InvalidSound;
+
+    bool returned = m_finished.TryPush(voice);
+    Assert(returned, "Finished voice queue is full!");
+    (void)returned;
+}
+
+bool AudioMixer::OpenDevice()
+{
+    m_deviceBlocks.assign((std::size_t)m_info.blockSize * ChannelCount * m_info.blockCount, 0.0f);
+    m_deviceBlock = 0;
+
+#if defined(WIN32)
+    if(!m_info.nullDevice)
+    {
+        // Mix in floating point, so the device converts samples instead of the mixer thread.
+        WAVEFORMATEX format;
+        std::memset(&format, 0, sizeof(format));
+        format.wFormatTag = WAVE_FORMAT_IEEE_FLOAT;
+        format.nChannels = ChannelCount;
+        format.nSamplesPerSec = m_info.sampleRate;
+        format.wBitsPerSample = sizeof(float) * 8;
+        format.nBlockAlign = ChannelCount * sizeof(float);
+        format.nAvgBytesPerSec = format.nSamplesPerSec * format.nBlockAlign;
+
+        m_deviceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+        if(m_deviceEvent == nullptr)
+        {
+            LogError() << LogInitializeError() << "Could not create a device event.";
+            return false;
+        }
+
+        MMRESULT result = waveOutOpen(&m_device, WAVE_MAPPER, &format, (DWORD_PTR)m_deviceEvent, 0, CALLBACK_EVENT);
+
+        if(result != MMSYSERR_NOERROR)
+        {
+            // Keep running without sound on machines without an audio device.
+            LogWarning() << "Could not open an audio device (error " << result << "). Falling back to a null device.";
+
+            m_device = nullptr;
+            CloseHandle(m_deviceEvent);
+            m_deviceEvent = nullptr;
+
+            return true;
+        }
+
+        // Prepare headers of blocks, which start out as done so they can be mixed right away.
+        m_deviceHeaders.resize(m_info.blockCount);
+
+        for(int i = 0; i < m_info.blockCount; ++i)
+        {
+            WAVEHDR& header = m_deviceHeaders[i];
+            std::memset(&header, 0, sizeof(header));
+            header.lpData = reinterpret_cast<LPSTR>(&m_deviceBlocks[(std::size_t)i * m_info.blockSize * ChannelCount]);
+            header.dwBufferLength = m_info.blockSize * ChannelCount * sizeof(float);
+
+            waveOutPrepareHeader(m_device, &header, sizeof(header));
+            header.dwFlags |= WHDR_DONE;
+        }
+    }
+#endif
+
+    return true;
+}
+
+void AudioMixer::CloseDevice()
+{
+#if defined(WIN32)
+    if(m_device != nullptr)
+    {
+        // Return queued blocks before releasing them.
+        waveOutReset(m_device);
+
+        for(WAVEHDR& header : m_deviceHeaders)
+        {
+            waveOutUnprepareHeader(m_device, &header, sizeof(header));
+        }
+
+        waveOutClose(m_device);
+        m_device = nullptr;
+    }
+
+    if(m_deviceEvent != nullptr)
+    {
+        CloseHandle(m_deviceEvent);
+        m_deviceEvent = nullptr;
+    }
+
+    Utility::ClearContainer(m_deviceHeaders);
+#endif
+
+    Utility::ClearContainer(m_deviceBlocks);
+    m_deviceBlock = 0;
+}
+
+float* AudioMixer::AcquireDeviceBlock()
+{
+    float* block = &m_deviceBlocks[(std::size_t)m_deviceBlock * m_info.blockSize * ChannelCount];
+
+#if defined(WIN32)
+    if(m_device != nullptr)
+    {
+        // The device ran dry if it returned every block before we got to them.
+        bool starved = m_blockCount.load(std::memory_order_relaxed) >= (std::uint64_t)m_info.blockCount;
+
+        for(const WAVEHDR& header : m_deviceHeaders)
+        {
+            starved = starved && (header.dwFlags & WHDR_DONE) != 0;
+        }
+
+        if(starved)
+        {
+            m_underrunCount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Wait for the device to return the next block, checking for a stop request in between.
+        while((m_deviceHeaders[m_deviceBlock].dwFlags & WHDR_DONE) == 0)
+        {
+            WaitForSingleObject(m_deviceEvent, 100);
+
+            if(m_stop.load(std::memory_order_acquire))
+                return nullptr;
+        }
+
+        return block;
+    }
+#endif
+
+    // The null device takes a block every block duration, with the first ones queued right away.
+    std::chrono::steady_clock::duration blockDuration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>((double)m_info.blockSize / m_info.sampleRate));
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    if(m_blockCount.load(std::memory_order_relaxed) >= (std::uint64_t)m_info.blockCount)
+    {
+        if(now > m_deadline + blockDuration * m_info.blockCount)
+        {
+            // Start over instead of rushing through missed blocks.
+            m_underrunCount.fetch_add(1, std::memory_order_relaxed);
+            m_deadline = now;
+        }
+
+        std::this_thread::sleep_until(m_deadline);
+    }
+
+    m_deadline += blockDuration;
+
+    return block;
+}
+
+void AudioMixer::SubmitDeviceBlock()
+{
+#if defined(WIN32)
+    if(m_device != nullptr)
+    {
+        WAVEHDR& header = m_deviceHeaders[m_deviceBlock];
+        header.dwFlags &= ~WHDR_DONE;
+
+        waveOutWrite(m_device, &header, sizeof(header));
+    }
+#endif
+
+    m_deviceBlock = (m_deviceBlock + 1) % m_info.blockCount;
+}
+
+void AudioMixer::OnEmitterDestroy(Game::EntitySystem::Events::Destroy event)
+{
+    if(const SoundEmitter* emitter = m_componentSystem->GetComponent<SoundEmitter>(event.handle))
+    {
+        this->Stop(emitter->voice);
+    }
+}
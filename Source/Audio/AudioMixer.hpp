@@ -0,0 +1,398 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/SpscQueue.hpp"
+#include "Game/EntitySystem.hpp"
+#include "Game/ComponentSystem.hpp"
+
+#if defined(WIN32)
+    #include <mmsystem.h>
+#endif
+
+//
+// Audio Mixer
+//
+//  Mixes playing voices on a dedicated thread, so audio never waits for a
+//  frame and frames never wait for audio. The mixer thread raises its own
+//  priority and does not lock, allocate or free memory while mixing. All
+//  voice state lives on the mixer thread and the game thread only talks to
+//  it through a lock-free single producer queue of commands, while finished
+//  voices are handed back through a second queue. Commands that do not fit
+//  the queue wait on the game thread and are submitted again on the next
+//  update, in their original order.
+//
+//  Each block resamples voices with linear interpolation to the output rate,
+//  then applies gain and constant power panning and accumulates them into
+//  the output with SSE or AVX kernels, with a scalar fallback when neither
+//  is available. Gains are ramped over a block to avoid clicks on changes.
+//
+//  Voices with a spatial flag are placed in the world. Updating the mixer
+//  reads positions of entities with Transform and SoundEmitter components
+//  from component storage and sends those that moved to the mixer thread,
+//  which attenuates and pans voices relative to the listener. When more
+//  voices play than the budget allows, only the most audible ones are mixed
+//  and the rest keep advancing silently, so they resume in place once they
+//  become audible again.
+//
+//  Output goes to the default device through the Windows multimedia API.
+//  Other platforms, and machines without an audio device, use a null device
+//  that paces blocks with the clock and discards them.
+//
+//  Example usage:
+//      Audio::AudioMixerInfo info;
+//      info.entitySystem = &entitySystem;
+//      info.componentSystem = &componentSystem;
+//      info.voiceBudget = 32;
+//
+//      Audio::AudioMixer audioMixer;
+//      audioMixer.Initialize(info);
+//
+//      int sound = audioMixer.CreateSound(samples.data(), (int)samples.size(), 22050);
+//
+//      Audio::VoiceInfo voiceInfo;
+//      voiceInfo.loop = true;
+//      voiceInfo.spatial = true;
+//
+//      Audio::SoundEmitter emitter;
+//      emitter.voice = audioMixer.Play(sound, voiceInfo);
+//      componentSystem.AddComponent(entity, emitter);
+//
+//      while(window.IsOpen())
+//      {
+//          audioMixer.SetListener(cameraPosition);
+//          audioMixer.Update();
+//      }
+//
+
+namespace Audio
+{
+    // Handle of a voice.
+    // Generations tell voices apart after their slots are reused.
+    struct VoiceHandle
+    {
+        VoiceHandle() :
+            index(-1),
+            generation(0)
+        {
+        }
+
+        bool operator==(const VoiceHandle& other) const
+        {
+            return index == other.index && generation == other.generation;
+        }
+
+        bool operator!=(const VoiceHandle& other) const
+        {
+            return !(*this == other);
+        }
+
+        int index;
+        int generation;
+    };
+
+    // Component that moves a spatial voice along with its entity.
+    // The voice is stopped when the entity is destroyed.
+    struct SoundEmitter
+    {
+        VoiceHandle voice;
+    };
+
+    // Voice initialization struct.
+    struct VoiceInfo
+    {
+        VoiceInfo();
+
+        // Volume scale.
+        float gain;
+
+        // Playback speed, which also shifts the pitch.
+        float pitch;
+
+        // Stereo position from left (-1.0f) to right (1.0f) of voices that are not spatial.
+        float pan;
+
+        // World position of spatial voices.
+        glm::vec3 position;
+
+        // Restarts the sound after its end.
+        bool loop;
+
+        // Attenuates and pans by the position relative to the listener.
+        bool spatial;
+    };
+
+    // Audio mixer statistics.
+    struct AudioMixerStatistics
+    {
+        AudioMixerStatistics();
+
+        // Number of mixed blocks.
+        std::uint64_t blockCount;
+
+        // Number of blocks the device ran out of before they were mixed.
+        std::uint64_t underrunCount;
+
+        // Number of playing and mixed voices in the last block.
+        int playingVoices;
+        int mixedVoices;
+
+        // Number of commands waiting on the game thread for room in the queue.
+        int pendingCommands;
+    };
+
+    // Audio mixer initialization struct.
+    struct AudioMixerInfo
+    {
+        AudioMixerInfo();
+
+        // Systems that store entities with sound emitters.
+        // Optional, emitters are not tracked without them.
+        Game::EntitySystem* entitySystem;
+        Game::ComponentSystem* componentSystem;
+
+        // Output sample rate in hertz.
+        int sampleRate;
+
+        // Number of frames mixed at once.
+        int blockSize;
+
+        // Number of blocks queued on the device.
+        // More blocks survive longer stalls at the cost of latency.
+        int blockCount;
+
+        // Maximum number of playing voices, including culled ones.
+        int voiceCapacity;
+
+        // Maximum number of mixed voices, with quieter ones culled.
+        int voiceBudget;
+
+        // Maximum number of sounds.
+        int soundCapacity;
+
+        // Number of commands the queue holds, which must be a power of two.
+        int commandCapacity;
+
+        // Distance up to which spatial voices play at full gain,
+        // and past which they can no longer be heard.
+        float referenceDistance;
+        float maximumDistance;
+
+        // Discards output instead of opening a device.
+        bool nullDevice;
+    };
+
+    // Audio mixer class.
+    class AudioMixer : private NonCopyable
+    {
+    public:
+        // Constant variables.
+        static const int InvalidSound = -1;
+
+    public:
+        AudioMixer();
+        ~AudioMixer();
+
+        // Restores instance to its original state.
+        // Stops the mixer thread and closes the device.
+        void Cleanup();
+
+        // Initializes the mixer and starts its thread.
+        bool Initialize(const AudioMixerInfo& info);
+
+        // Creates a sound from mono samples in the range from -1.0f to 1.0f.
+        // Sounds live until the mixer is cleaned up.
+        int CreateSound(const float* samples, int count, int sampleRate);
+
+        // Starts playing a sound.
+        // Returns an invalid handle if all voices are taken.
+        VoiceHandle Play(int sound, const VoiceInfo& info = VoiceInfo());
+
+        // Stops a voice.
+        void Stop(const VoiceHandle& voice);
+
+        // Changes parameters of a playing voice.
+        void SetGain(const VoiceHandle& voice, float gain);
+        void SetPitch(const VoiceHandle& voice, float pitch);
+        void SetPan(const VoiceHandle& voice, float pan);
+        void SetPosition(const VoiceHandle& voice, const glm::vec3& position);
+
+        // Sets the world position that spatial voices are heard from.
+        void SetListener(const glm::vec3& position);
+
+        // Reclaims finished voices, sends positions of sound emitters
+        // and submits commands that are waiting for room in the queue.
+        void Update();
+
+        // Checks if a voice is still playing.
+        // Voices finish on the mixer thread and are seen here after an update.
+        bool IsPlaying(const VoiceHandle& voice) const;
+
+        // Gets the mixer statistics.
+        AudioMixerStatistics GetStatistics() const;
+
+        // Checks if the instance is initialized.
+        bool IsInitialized() const;
+
+    private:
+        // Command types.
+        struct CommandTypes
+        {
+            enum Type
+            {
+                Play,
+                Stop,
+                SetGain,
+                SetPitch,
+                SetPan,
+                SetPosition,
+                SetListener,
+            };
+        };
+
+        // Command sent from the game thread to the mixer thread.
+        struct Command
+        {
+            CommandTypes::Type type;
+            int voice;
+            int sound;
+            VoiceInfo info;
+        };
+
+        // Immutable samples of a sound.
+        struct Sound
+        {
+            std::vector<float> samples;
+            int sampleRate;
+        };
+
+        // Voice state of the mixer thread.
+        // Stored as arrays indexed by voice, so culling only touches what it needs.
+        struct Voices
+        {
+            void Resize(int capacity);
+
+            std::vector<int> sounds;
+            std::vector<double> cursors;
+            std::vector<VoiceInfo> infos;
+            std::vector<float> audibilities;
+
+            // Channel gains that the current block ramps to.
+            std::vector<float> leftTargets;
+            std::vector<float> rightTargets;
+
+            // Channel gains reached at the end of the last mixed block.
+            std::vector<float> leftGains;
+            std::vector<float> rightGains;
+            std::vector<bool> mixed;
+
+            // Indices of playing voices.
+            std::vector<int> playing;
+        };
+
+    private:
+        // Queues a command, keeping it on the game thread while the queue is full.
+        void Submit(const Command& command);
+
+        // Checks if a handle refers to a voice of the game thread.
+        bool IsVoiceValid(const VoiceHandle& voice) const;
+
+        // Main function of the mixer thread.
+        void MixerMain();
+
+        // Applies commands of the game thread.
+        void ProcessCommands();
+
+        // Mixes a block of frames into the interleaved output.
+        void MixBlock(float* output);
+
+        // Computes channel gains and audibility of a voice.
+        void UpdateVoiceGains(int voice);
+
+        // Advances a voice over a block, optionally resampling it into the scratch buffer.
+        // Returns false once a voice that does not loop reaches its end.
+        bool AdvanceVoice(int voice, float* resampled);
+
+        // Hands a voice back to the game thread.
+        void FinishVoice(int voice);
+
+        // Opens the output device.
+        bool OpenDevice();
+
+        // Closes the output device.
+        void CloseDevice();
+
+        // Waits for the device to take another block and returns its buffer.
+        float* AcquireDeviceBlock();
+
+        // Queues the last acquired block on the device.
+        void SubmitDeviceBlock();
+
+        // Called when an entity with a sound emitter is destroyed.
+        void OnEmitterDestroy(Game::EntitySystem::Events::Destroy event);
+
+    private:
+        // Systems that store entities with sound emitters.
+        Game::EntitySystem* m_entitySystem;
+        Game::ComponentSystem* m_componentSystem;
+
+        // Mixer settings.
+        AudioMixerInfo m_info;
+
+        // Sounds, published to the mixer thread through their count.
+        std::unique_ptr<Sound[]> m_sounds;
+        std::atomic<int> m_soundCount;
+
+        // Commands from the game thread and voices finished by the mixer thread.
+        SpscQueue<Command> m_commands;
+        SpscQueue<int> m_finished;
+
+        // Commands that did not fit the queue.
+        std::vector<Command> m_pending;
+
+        // Voice slots of the game thread.
+        std::vector<int> m_generations;
+        std::vector<bool> m_active;
+        std::vector<int> m_freeVoices;
+
+        // Last positions sent for voices of sound emitters.
+        std::vector<glm::vec3> m_sentPositions;
+
+        // Voice state of the mixer thread.
+        Voices m_voices;
+
+        // Scratch buffers of the mixer thread.
+        std::vector<float> m_resampled;
+        std::vector<float> m_left;
+        std::vector<float> m_right;
+        std::vector<int> m_order;
+
+        // Listener position of the mixer thread.
+        glm::vec3 m_listener;
+
+        // Output device.
+        std::vector<float> m_deviceBlocks;
+        int m_deviceBlock;
+        std::chrono::steady_clock::time_point m_deadline;
+
+#if defined(WIN32)
+        HWAVEOUT m_device;
+        HANDLE m_deviceEvent;
+        std::vector<WAVEHDR> m_deviceHeaders;
+#endif
+
+        // Mixer thread and its statistics.
+        std::thread m_thread;
+        std::atomic<bool> m_stop;
+
+        std::atomic<std::uint64_t> m_blockCount;
+        std::atomic<std::uint64_t> m_underrunCount;
+        std::atomic<int> m_playingVoices;
+        std::atomic<int> m_mixedVoices;
+
+        // Sound emitter destroy event receiver.
+        Receiver<void(Game::EntitySystem::Events::Destroy)> m_emitterDestroy;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
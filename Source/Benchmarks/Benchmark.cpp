@@ -0,0 +1,165 @@
+#include "Precompiled.hpp"
+#include "Benchmark.hpp"
+#include "BenchmarkResults.hpp"
+#include "System/Clock.hpp"
+using namespace Benchmarks;
+
+namespace
+{
+    // Number of memory allocations.
+    std::atomic<std::size_t> allocationCount(0);
+
+    // Hardware counters of the benchmark thread.
+    System::HardwareCounters hardwareCounters;
+
+    // Stream of results that writes to the original buffer of the standard output,
+    // so benchmarks can redirect the standard output while measuring.
+    std::ostream results(std::cout.rdbuf());
+
+    // Whether result tables are printed.
+    bool quiet = false;
+}
+
+// Replaced global allocation operators.
+void* operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+    void* memory = std::malloc(size == 0 ? 1 : size);
+
+    if(memory == nullptr)
+        throw std::bad_alloc();
+
+    return memory;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+
+std::size_t Benchmarks::GetAllocationCount()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+bool Benchmarks::EnableHardwareCounters()
+{
+    return hardwareCounters.Initialize();
+}
+
+void Benchmarks::SetQuiet(bool value)
+{
+    quiet = value;
+}
+
+void Benchmarks::PrintHeader(const char* suite)
+{
+    if(quiet)
+        return;
+
+    results << std::endl << suite << std::endl;
+    results << std::left << std::setw(48) << "Benchmark";
+    results << std::right << std::setw(12) << "Operations";
+    results << std::right << std::setw(12) << "ns/op";
+    results << std::right << std::setw(14) << "Allocations";
+
+    if(hardwareCounters.IsInitialized())
+    {
+        for(int type = 0; type < System::HardwareCounterTypes::Count; ++type)
+        {
+            std::string name = System::HardwareCounters::GetTypeName((System::HardwareCounterTypes::Type)type);
+            results << std::right << std::setw(16) << name + "/op";
+        }
+    }
+
+    results << std::endl;
+}
+
+void Benchmarks::PrintLatency(const std::string& name, std::vector<std::uint64_t> latencies)
+{
+    if(latencies.empty())
+        return;
+
+    const struct { const char* suffix; double fraction; } Percentiles[] =
+    {
+        { " p50", 0.50 },
+        { " p99", 0.99 },
+    };
+
+    for(const auto& percentile : Percentiles)
+    {
+        // Select the sample at the rank of the percentile.
+        std::size_t rank = std::min((std::size_t)(percentile.fraction * latencies.size()), latencies.size() - 1);
+        std::nth_element(latencies.begin(), latencies.begin() + rank, latencies.end());
+
+        double nanoseconds = (double)System::Clock::TicksToNanoseconds(latencies[rank]);
+
+        GetResults().AddSample(name + percentile.suffix, nanoseconds);
+
+        if(quiet)
+            continue;
+
+        results << std::left << std::setw(48) << name + percentile.suffix;
+        results << std::right << std::setw(12) << latencies.size();
+        results << std::right << std::setw(12) << std::fixed << std::setprecision(2) << nanoseconds;
+        results << std::right << std::setw(14) << "-" << std::endl;
+    }
+}
+
+Measurement::Measurement(std::string name, std::size_t operations) :
+    m_name(name),
+    m_operations(operations),
+    m_startAllocations(GetAllocationCount())
+{
+    // Start the timer last to not measure the setup.
+    hardwareCounters.Read(m_startCounters);
+    m_startTime = Clock::now();
+}
+
+Measurement::~Measurement()
+{
+    // Stop the timer first to not measure the report.
+    Clock::time_point endTime = Clock::now();
+
+    System::HardwareCounters::Values endCounters;
+    bool counted = hardwareCounters.Read(endCounters);
+
+    std::size_t allocations = GetAllocationCount() - m_startAllocations;
+
+    // Calculate the time per operation.
+    double nanoseconds = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - m_startTime).count();
+    double nanosecondsPerOperation = nanoseconds / (double)std::max<std::size_t>(m_operations, 1);
+
+    GetResults().AddSample(m_name, nanosecondsPerOperation);
+
+    if(quiet)
+        return;
+
+    // Print the result.
+    results << std::left << std::setw(48) << m_name;
+    results << std::right << std::setw(12) << m_operations;
+    results << std::right << std::setw(12) << std::fixed << std::setprecision(2) << nanosecondsPerOperation;
+    results << std::right << std::setw(14) << allocations;
+
+    if(counted)
+    {
+        for(int type = 0; type < System::HardwareCounterTypes::Count; ++type)
+        {
+            double countPerOperation = (double)(endCounters[type] - m_startCounters[type]) / (double)std::max<std::size_t>(m_operations, 1);
+            results << std::right << std::setw(16) << countPerOperation;
+        }
+    }
+
+    results << std::endl;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "System/HardwareCounters.hpp"
+
+//
+// Benchmark
+//
+//  Measures the time and the number of memory allocations of a code
+//  section and reports them per operation when it goes out of scope.
+//  Allocations are counted by global new and delete operators that
+//  are replaced in the benchmark executable.
+//
+//  Latencies of single operations can be printed as percentiles, which
+//  show occasional stalls that the time per operation averages out.
+//
+//  Every measurement is also added as a sample to benchmark results, which
+//  can be saved and compared with a baseline. Printing can be disabled for
+//  repeated runs that only collect samples.
+//
+//  Hardware counters of the benchmark thread can be enabled to also report
+//  retired instructions, cycles, cache misses and branch misses per
+//  operation, which show the effect of data layout changes directly.
+//
+//  Example usage:
+//      {
+//          Benchmarks::Measurement measurement("CreateEntity", count);
+//
+//          for(int i = 0; i < count; ++i)
+//          {
+//              entitySystem.CreateEntity();
+//          }
+//      }
+//
+
+namespace Benchmarks
+{
+    // Gets the number of memory allocations made so far.
+    std::size_t GetAllocationCount();
+
+    // Enables hardware counters for measurements on the calling thread.
+    bool EnableHardwareCounters();
+
+    // Disables or enables printing of result tables.
+    void SetQuiet(bool quiet);
+
+    // Prints a header of the result table.
+    void PrintHeader(const char* suite);
+
+    // Prints the median and the 99th percentile of latencies in clock ticks.
+    void PrintLatency(const std::string& name, std::vector<std::uint64_t> latencies);
+
+    // Measurement class.
+    class Measurement : private NonCopyable
+    {
+    public:
+        Measurement(std::string name, std::size_t operations);
+        ~Measurement();
+
+    private:
+        // Type declarations.
+        typedef std::chrono::high_resolution_clock Clock;
+
+    private:
+        // Name of the measured section.
+        std::string m_name;
+
+        // Number of operations performed.
+        std::size_t m_operations;
+
+        // State at the beginning of the measurement.
+        Clock::time_point m_startTime;
+        std::size_t m_startAllocations;
+        System::HardwareCounters::Values m_startCounters;
+    };
+
+    // Prevents the compiler from optimizing away a computed value.
+    template<typename Type>
+    void KeepValue(const Type& value)
+    {
+        static volatile Type sink;
+        sink = value;
+    }
+
+    // Prevents the compiler from seeing what a pointer points to,
+    // so calls through it are not inlined or devirtualized.
+    template<typename Type>
+    Type* HidePointer(Type* pointer)
+    {
+        static Type* volatile hidden;
+        hidden = pointer;
+        return hidden;
+    }
+}
@@ -0,0 +1,378 @@
+#include "Precompiled.hpp"
+#include "BenchmarkResults.hpp"
+using namespace Benchmarks;
+
+namespace
+{
+    // Log message strings.
+    #define LogLoadError(filename) "Failed to load benchmark results from \"" << filename << "\" file! "
+    #define LogSaveError(filename) "Failed to save benchmark results to \"" << filename << "\" file! "
+
+    // Normal quantile of a two sided 95% confidence interval.
+    const double NormalQuantile = 1.959964;
+
+    // Summary of samples.
+    struct Summary
+    {
+        std::size_t count;
+        double mean;
+        double variance;
+    };
+
+    // Computes the mean and the unbiased variance of samples.
+    Summary Summarize(const std::vector<double>& samples)
+    {
+        Summary summary;
+        summary.count = samples.size();
+        summary.mean = 0.0;
+        summary.variance = 0.0;
+
+        if(samples.empty())
+            return summary;
+
+        for(double sample : samples)
+        {
+            summary.mean += sample;
+        }
+
+        summary.mean /= (double)samples.size();
+
+        if(samples.size() < 2)
+            return summary;
+
+        for(double sample : samples)
+        {
+            summary.variance += (sample - summary.mean) * (sample - summary.mean);
+        }
+
+        summary.variance /= (double)(samples.size() - 1);
+
+        return summary;
+    }
+
+    // Approximates the Student's t quantile of a 95% interval with the
+    // Cornish-Fisher expansion, which is within 1% for two or more degrees of freedom.
+    double GetStudentQuantile(double degrees)
+    {
+        const double z = NormalQuantile;
+        const double z3 = z * z * z;
+        const double z5 = z3 * z * z;
+
+        return z + (z3 + z) / (4.0 * degrees) + (5.0 * z5 + 16.0 * z3 + 3.0 * z) / (96.0 * degrees * degrees);
+    }
+
+    // Writes a string with escaped quotes and backslashes.
+    void WriteString(std::ostream& output, const std::string& text)
+    {
+        output << '"';
+
+        for(char character : text)
+        {
+            if(character == '"' || character == '\\')
+            {
+                output << '\\';
+            }
+
+            output << character;
+        }
+
+        output << '"';
+    }
+
+    // Reads a string with escaped characters starting at an opening quote.
+    bool ReadString(const std::string& text, std::size_t& position, std::string& result)
+    {
+        if(position >= text.size() || text[position] != '"')
+            return false;
+
+        result.clear();
+
+        for(position += 1; position < text.size(); ++position)
+        {
+            char character = text[position];
+
+            if(character == '"')
+            {
+                position += 1;
+                return true;
+            }
+
+            if(character == '\\' && position + 1 < text.size())
+            {
+                character = text[++position];
+            }
+
+            result.push_back(character);
+        }
+
+        return false;
+    }
+
+    // Moves past whitespace and a separator.
+    bool SkipSeparator(const std::string& text, std::size_t& position, char separator)
+    {
+        position = text.find_first_not_of(" \t\r\n", position);
+
+        if(position == std::string::npos || text[position] != separator)
+            return false;
+
+        position = text.find_first_not_of(" \t\r\n", position + 1);
+        return position != std::string::npos;
+    }
+}
+
+void BenchmarkResults::AddSample(const std::string& name, double nanoseconds)
+{
+    auto result = m_indices.emplace(name, m_entries.size());
+
+    if(result.second)
+    {
+        Entry entry;
+        entry.name = name;
+        m_entries.push_back(entry);
+    }
+
+    m_entries[result.first->second].samples.push_back(nanoseconds);
+}
+
+bool BenchmarkResults::Save(const std::string& filename) const
+{
+    std::ofstream file(filename, std::ios::trunc);
+
+    if(!file.is_open())
+    {
+        LogError() << LogSaveError(filename) << "Couldn't open the file.";
+        return false;
+    }
+
+    file << std::setprecision(9);
+    file << "{\n";
+    file << "  \"unit\": \"ns/op\",\n";
+    file << "  \"benchmarks\": [\n";
+
+    for(std::size_t i = 0; i < m_entries.size(); ++i)
+    {
+        const Entry& entry = m_entries[i];
+
+        file << "    { \"name\": ";
+        WriteString(file, entry.name);
+        file << ", \"samples\": [";
+
+        for(std::size_t s = 0; s < entry.samples.size(); ++s)
+        {
+            file << (s == 0 ? "" : ", ") << entry.samples[s];
+        }
+
+        file << "] }" << (i + 1 < m_entries.size() ? ",\n" : "\n");
+    }
+
+    file << "  ]\n";
+    file << "}\n";
+
+    if(!file.good())
+    {
+        LogError() << LogSaveError(filename) << "Couldn't write to the file.";
+        return false;
+    }
+
+    return true;
+}
+
+bool BenchmarkResults::Load(const std::string& filename)
+{
+    m_entries.clear();
+    m_indices.clear();
+
+    std::ifstream file(filename);
+
+    if(!file.is_open())
+    {
+        LogError() << LogLoadError(filename) << "Couldn't open the file.";
+        return false;
+    }
+
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // Read name and samples of every benchmark object.
+    const std::string NameKey = "\"name\"";
+    const std::string SamplesKey = "\"samples\"";
+
+    std::size_t position = 0;
+
+    while((position = text.find(NameKey, position)) != std::string::npos)
+    {
+        std::string name;
+        position += NameKey.size();
+
+        if(!SkipSeparator(text, position, ':') || !ReadString(text, position, name))
+        {
+            LogError() << LogLoadError(filename) << "Invalid benchmark name.";
+            return false;
+        }
+
+        position = text.find(SamplesKey, position);
+
+        if(position == std::string::npos)
+        {
+            LogError() << LogLoadError(filename) << "Missing samples of \"" << name << "\" benchmark.";
+            return false;
+        }
+
+        position += SamplesKey.size();
+
+        if(!SkipSeparator(text, position, ':') || !SkipSeparator(text, position, '['))
+        {
+            LogError() << LogLoadError(filename) << "Invalid samples of \"" << name << "\" benchmark.";
+            return false;
+        }
+
+        while(text[position] != ']')
+        {
+            char* end = nullptr;
+            double sample = std::strtod(text.c_str() + position, &end);
+
+            if(end == text.c_str() + position)
+            {
+                LogError() << LogLoadError(filename) << "Invalid samples of \"" << name << "\" benchmark.";
+                return false;
+            }
+
+            this->AddSample(name, sample);
+
+            position = end - text.c_str();
+            position = text.find_first_not_of(" \t\r\n", position);
+
+            if(position == std::string::npos)
+            {
+                LogError() << LogLoadError(filename) << "Unexpected end of the file.";
+                return false;
+            }
+
+            if(text[position] == ',')
+            {
+                SkipSeparator(text, position, ',');
+            }
+        }
+    }
+
+    return true;
+}
+
+const BenchmarkResults::EntryList& BenchmarkResults::GetEntries() const
+{
+    return m_entries;
+}
+
+const BenchmarkResults::Entry* BenchmarkResults::FindEntry(const std::string& name) const
+{
+    auto it = m_indices.find(name);
+
+    if(it == m_indices.end())
+        return nullptr;
+
+    return &m_entries[it->second];
+}
+
+int BenchmarkResults::Compare(const BenchmarkResults& baseline, const BenchmarkResults& current, double threshold, std::ostream& report)
+{
+    int regressionCount = 0;
+    int improvementCount = 0;
+    int missingCount = 0;
+
+    report << std::endl << "Comparison with baseline (95% confidence, " << threshold * 100.0 << "% threshold)" << std::endl;
+    report << std::left << std::setw(48) << "Benchmark";
+    report << std::right << std::setw(12) << "Baseline";
+    report << std::right << std::setw(12) << "Current";
+    report << std::right << std::setw(10) << "Change";
+    report << std::right << std::setw(20) << "Interval";
+    report << "  " << "Result" << std::endl;
+
+    for(const Entry& entry : current.GetEntries())
+    {
+        const Entry* baselineEntry = baseline.FindEntry(entry.name);
+
+        if(baselineEntry == nullptr || baselineEntry->samples.empty())
+        {
+            missingCount += 1;
+            continue;
+        }
+
+        Summary before = Summarize(baselineEntry->samples);
+        Summary after = Summarize(entry.samples);
+
+        if(before.mean <= 0.0)
+            continue;
+
+        double change = (after.mean - before.mean) / before.mean;
+
+        report << std::left << std::setw(48) << entry.name;
+        report << std::right << std::fixed << std::setprecision(2);
+        report << std::setw(12) << before.mean;
+        report << std::setw(12) << after.mean;
+        report << std::setw(9) << std::showpos << change * 100.0 << "%" << std::noshowpos;
+
+        // Intervals need a variance estimate from both runs.
+        if(before.count < 2 || after.count < 2)
+        {
+            report << std::setw(20) << "-" << "  " << "not tested" << std::endl;
+            continue;
+        }
+
+        // Compute the interval of the difference with Welch's t-test.
+        double beforeError = before.variance / (double)before.count;
+        double afterError = after.variance / (double)after.count;
+        double standardError = std::sqrt(beforeError + afterError);
+
+        double degrees = (double)std::max(std::min(before.count, after.count) - 1, (std::size_t)1);
+
+        if(beforeError + afterError > 0.0)
+        {
+            double numerator = (beforeError + afterError) * (beforeError + afterError);
+            double denominator = beforeError * beforeError / (double)(before.count - 1) + afterError * afterError / (double)(after.count - 1);
+            degrees = std::max(numerator / denominator, 1.0);
+        }
+
+        double margin = GetStudentQuantile(degrees) * standardError;
+        double lower = (after.mean - before.mean - margin) / before.mean;
+        double upper = (after.mean - before.mean + margin) / before.mean;
+
+        std::ostringstream interval;
+        interval << std::fixed << std::setprecision(1) << std::showpos << lower * 100.0 << ".." << upper * 100.0 << "%";
+
+        report << std::setw(20) << interval.str() << "  ";
+
+        if(lower > 0.0 && change > threshold)
+        {
+            report << "REGRESSION";
+            regressionCount += 1;
+        }
+        else if(upper < 0.0 && change < -threshold)
+        {
+            report << "improvement";
+            improvementCount += 1;
+        }
+        else
+        {
+            report << "unchanged";
+        }
+
+        report << std::endl;
+    }
+
+    report << std::endl << regressionCount << " regressions, " << improvementCount << " improvements";
+
+    if(missingCount != 0)
+    {
+        report << ", " << missingCount << " benchmarks missing from the baseline";
+    }
+
+    report << "." << std::endl;
+
+    return regressionCount;
+}
+
+BenchmarkResults& Benchmarks::GetResults()
+{
+    static BenchmarkResults results;
+    return results;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Benchmark Results
+//
+//  Collects time per operation of every benchmark over repeated runs, so
+//  results can be saved as a baseline and compared with later runs. Results
+//  are stored as JSON with a list of samples for each benchmark name, in the
+//  order benchmarks were first run.
+//
+//  Comparing computes a 95% confidence interval of the difference between
+//  mean times with Welch's t-test, which does not assume that both runs have
+//  the same variance. A benchmark is reported as a regression only if the
+//  whole interval is slower than the baseline and the mean change is larger
+//  than the threshold, so noise of a single run is not flagged. Benchmarks
+//  with fewer than two samples on either side can't be tested and are only
+//  listed with their change.
+//
+//  Example usage:
+//      Benchmarks::BenchmarkResults baseline;
+//      baseline.Load("Baseline.json");
+//
+//      int regressions = Benchmarks::BenchmarkResults::Compare(baseline, Benchmarks::GetResults(), 0.05, std::cout);
+//
+
+namespace Benchmarks
+{
+    // Benchmark results class.
+    class BenchmarkResults
+    {
+    public:
+        // Samples of a single benchmark.
+        struct Entry
+        {
+            std::string name;
+            std::vector<double> samples;
+        };
+
+        // Type declarations.
+        typedef std::vector<Entry> EntryList;
+
+    public:
+        // Adds a sample of nanoseconds per operation.
+        void AddSample(const std::string& name, double nanoseconds);
+
+        // Saves results to a JSON file.
+        bool Save(const std::string& filename) const;
+
+        // Loads results from a JSON file saved before.
+        bool Load(const std::string& filename);
+
+        // Gets the samples of every benchmark.
+        const EntryList& GetEntries() const;
+
+        // Compares results with a baseline and writes a report.
+        // Returns the number of significant regressions.
+        static int Compare(const BenchmarkResults& baseline, const BenchmarkResults& current, double threshold, std::ostream& report);
+
+    private:
+        // Finds the entry of a benchmark or returns nullptr.
+        const Entry* FindEntry(const std::string& name) const;
+
+    private:
+        // Samples in the order benchmarks were first run.
+        EntryList m_entries;
+
+        // Indices of entries by their names.
+        std::map<std::string, std::size_t> m_indices;
+    };
+
+    // Gets results of benchmarks run by this process.
+    BenchmarkResults& GetResults();
+}
@@ -0,0 +1,397 @@
+#include "Precompiled.hpp"
+#include "DispatcherBenchmarks.hpp"
+#include "Benchmark.hpp"
+using namespace Benchmarks;
+
+namespace
+{
+    // Number of invocations measured by each benchmark.
+    const int InvocationCount = 10000000;
+
+    // Builds a benchmark name with a receiver count.
+    std::string FormatName(const char* name, int count)
+    {
+        std::ostringstream stream;
+        stream << name << " (" << count << ")";
+        return stream.str();
+    }
+
+    // Sum written by the bound function.
+    int functionSum = 0;
+
+    // Function bound to delegates.
+    int AddToFunctionSum(int value)
+    {
+        functionSum += value;
+        return functionSum;
+    }
+
+    // Object bound to delegates as a functor and through a method.
+    struct Accumulator
+    {
+        Accumulator() :
+            sum(0),
+            stop(-1)
+        {
+        }
+
+        int operator()(int value)
+        {
+            sum += value;
+            return sum;
+        }
+
+        int Add(int value)
+        {
+            sum += value;
+            return sum;
+        }
+
+        void Receive(int value)
+        {
+            sum += value;
+        }
+
+        bool Continue(int value)
+        {
+            sum += value;
+            return sum != stop;
+        }
+
+        int sum;
+        int stop;
+    };
+
+    // Interface invoked through virtual calls.
+    class Callable
+    {
+    public:
+        virtual ~Callable()
+        {
+        }
+
+        virtual int Call(int value) = 0;
+    };
+
+    class AccumulatorCallable : public Callable
+    {
+    public:
+        AccumulatorCallable() :
+            m_sum(0)
+        {
+        }
+
+        int Call(int value)
+        {
+            m_sum += value;
+            return m_sum;
+        }
+
+    private:
+        int m_sum;
+    };
+
+    // Measures invoking a single bound function in different ways.
+    void BenchmarkInvocations()
+    {
+        Accumulator accumulator;
+
+        // Delegates.
+        {
+            Delegate<int(int)> delegate;
+            delegate.Bind<&AddToFunctionSum>();
+
+            Delegate<int(int)>* invoked = HidePointer(&delegate);
+            Measurement measurement("Delegate::Invoke (function)", InvocationCount);
+
+            for(int i = 0; i < InvocationCount; ++i)
+            {
+                invoked->Invoke(i);
+            }
+
+            KeepValue(functionSum);
+        }
+
+        {
+            Delegate<int(int)> delegate;
+            delegate.Bind(&accumulator);
+
+            Delegate<int(int)>* invoked = HidePointer(&delegate);
+            Measurement measurement("Delegate::Invoke (functor)", InvocationCount);
+
+            for(int i = 0; i < InvocationCount; ++i)
+            {
+                invoked->Invoke(i);
+            }
+
+            KeepValue(accumulator.sum);
+        }
+
+        {
+            Delegate<int(int)> delegate;
+            delegate.Bind<Accumulator, &Accumulator::Add>(&accumulator);
+
+            Delegate<int(int)>* invoked = HidePointer(&delegate);
+            Measurement measurement("Delegate::Invoke (method)", InvocationCount);
+
+            for(int i = 0; i < InvocationCount; ++i)
+            {
+                invoked->Invoke(i);
+            }
+
+            KeepValue(accumulator.sum);
+        }
+
+        // Baselines.
+        {
+            std::function<int(int)> function = [&accumulator](int value)
+            {
+                return accumulator.Add(value);
+            };
+
+            std::function<int(int)>* invoked = HidePointer(&function);
+            Measurement measurement("std::function (lambda)", InvocationCount);
+
+            for(int i = 0; i < InvocationCount; ++i)
+            {
+                (*invoked)(i);
+            }
+
+            KeepValue(accumulator.sum);
+        }
+
+        {
+            AccumulatorCallable callable;
+
+            Callable* invoked = HidePointer<Callable>(&callable);
+            Measurement measurement("Virtual call", InvocationCount);
+
+            for(int i = 0; i < InvocationCount; ++i)
+            {
+                invoked->Call(i);
+            }
+
+            KeepValue(invoked->Call(0));
+        }
+    }
+
+    // Measures dispatches to a number of receivers.
+    template<ReceiverStorage::Type Storage>
+    void BenchmarkDispatch(const char* name, int count)
+    {
+        const int DispatchCount = std::max(InvocationCount / count, 1);
+
+        std::vector<Accumulator> accumulators(count);
+        std::unique_ptr<Receiver<void(int)>[]> receivers(new Receiver<void(int)>[count]);
+
+        Dispatcher<void(int), CollectDefault<void>, Storage> dispatcher;
+
+        for(int i = 0; i < count; ++i)
+        {
+            receivers[i].template Bind<Accumulator, &Accumulator::Receive>(&accumulators[i]);
+            receivers[i].Subscribe(dispatcher);
+        }
+
+        {
+            Measurement measurement(FormatName(name, count), (std::size_t)DispatchCount * count);
+
+            for(int i = 0; i < DispatchCount; ++i)
+            {
+                dispatcher.Dispatch(i);
+            }
+        }
+
+        KeepValue(accumulators[count - 1].sum);
+    }
+
+    // Measures calls to a number of standard functions and virtual objects.
+    void BenchmarkDispatchBaselines(int count)
+    {
+        const int DispatchCount = std::max(InvocationCount / count, 1);
+
+        std::vector<Accumulator> accumulators(count);
+
+        // Standard functions.
+        {
+            std::vector<std::function<void(int)>> functions;
+
+            for(int i = 0; i < count; ++i)
+            {
+                Accumulator* accumulator = &accumulators[i];
+
+                functions.push_back([accumulator](int value)
+                {
+                    accumulator->Receive(value);
+                });
+            }
+
+            Measurement measurement(FormatName("std::function list", count), (std::size_t)DispatchCount * count);
+
+            for(int i = 0; i < DispatchCount; ++i)
+            {
+                for(const std::function<void(int)>& function : functions)
+                {
+                    function(i);
+                }
+            }
+        }
+
+        KeepValue(accumulators[count - 1].sum);
+
+        // Virtual calls.
+        {
+            std::vector<std::unique_ptr<Callable>> objects;
+
+            for(int i = 0; i < count; ++i)
+            {
+                objects.emplace_back(HidePointer<Callable>(new AccumulatorCallable()));
+            }
+
+            Measurement measurement(FormatName("Virtual call list", count), (std::size_t)DispatchCount * count);
+
+            for(int i = 0; i < DispatchCount; ++i)
+            {
+                for(const std::unique_ptr<Callable>& object : objects)
+                {
+                    object->Call(i);
+                }
+            }
+        }
+    }
+
+    // Measures dispatches that a collector stops after a few receivers.
+    void BenchmarkEarlyExit(int count, int stopIndex)
+    {
+        const int DispatchCount = std::max(InvocationCount / count, 1);
+
+        std::vector<Accumulator> accumulators(count);
+        std::unique_ptr<Receiver<bool(int)>[]> receivers(new Receiver<bool(int)>[count]);
+
+        Dispatcher<bool(int), CollectWhileTrue<bool>> dispatcher;
+
+        // Receivers return false once their sum reaches their stop value,
+        // which only the stopping receiver does on the first dispatch.
+        for(int i = 0; i < count; ++i)
+        {
+            if(i == stopIndex)
+            {
+                accumulators[i].stop = 1;
+            }
+
+            receivers[i].Bind<Accumulator, &Accumulator::Continue>(&accumulators[i]);
+            receivers[i].Subscribe(dispatcher);
+        }
+
+        {
+            std::ostringstream name;
+            name << "CollectWhileTrue stop at " << stopIndex;
+
+            Measurement measurement(FormatName(name.str().c_str(), count), DispatchCount);
+
+            // Keep the sum of the stopping receiver at its stop value.
+            for(int i = 0; i < DispatchCount; ++i)
+            {
+                dispatcher.Dispatch(i == 0 ? 1 : 0);
+            }
+        }
+
+        KeepValue(accumulators[stopIndex].sum);
+    }
+
+    // Measures receivers that unsubscribe and subscribe again.
+    template<ReceiverStorage::Type Storage>
+    void BenchmarkChurn(const char* name, int count)
+    {
+        const int ChurnCount = 1000000;
+
+        Accumulator accumulator;
+        std::unique_ptr<Receiver<void(int)>[]> receivers(new Receiver<void(int)>[count]);
+
+        Dispatcher<void(int), CollectDefault<void>, Storage> dispatcher;
+
+        for(int i = 0; i < count; ++i)
+        {
+            receivers[i].template Bind<Accumulator, &Accumulator::Receive>(&accumulator);
+            receivers[i].Subscribe(dispatcher, i % 4);
+        }
+
+        // Use a fixed seed to make runs comparable.
+        std::mt19937 random(1234);
+        std::uniform_int_distribution<int> distribution(0, count - 1);
+
+        {
+            Measurement measurement(FormatName(name, count), ChurnCount);
+
+            for(int i = 0; i < ChurnCount; ++i)
+            {
+                int index = distribution(random);
+                receivers[index].Unsubscribe();
+                receivers[index].Subscribe(dispatcher, index % 4);
+            }
+        }
+
+        dispatcher.Dispatch(1);
+        KeepValue(accumulator.sum);
+    }
+
+    // Measures compact receivers that unsubscribe and subscribe again.
+    void BenchmarkCompactChurn(int count)
+    {
+        const int ChurnCount = 1000000;
+
+        Accumulator accumulator;
+        std::unique_ptr<CompactReceiver<void(int)>[]> receivers(new CompactReceiver<void(int)>[count]);
+
+        Dispatcher<void(int), CollectDefault<void>, ReceiverStorage::PackedArray> dispatcher;
+
+        for(int i = 0; i < count; ++i)
+        {
+            receivers[i].Subscribe<Accumulator, &Accumulator::Receive>(dispatcher, &accumulator, i % 4);
+        }
+
+        // Use a fixed seed to make runs comparable.
+        std::mt19937 random(1234);
+        std::uniform_int_distribution<int> distribution(0, count - 1);
+
+        {
+            Measurement measurement(FormatName("Subscribe churn compact", count), ChurnCount);
+
+            for(int i = 0; i < ChurnCount; ++i)
+            {
+                int index = distribution(random);
+                receivers[index].Unsubscribe();
+                receivers[index].Subscribe<Accumulator, &Accumulator::Receive>(dispatcher, &accumulator, index % 4);
+            }
+        }
+
+        dispatcher.Dispatch(1);
+        KeepValue(accumulator.sum);
+    }
+}
+
+void Benchmarks::RunDispatcherBenchmarks()
+{
+    const int ReceiverCounts[] = { 1, 10, 100, 1000 };
+
+    PrintHeader("Dispatcher");
+
+    BenchmarkInvocations();
+
+    for(int count : ReceiverCounts)
+    {
+        BenchmarkDispatch<ReceiverStorage::LinkedList>("Dispatch linked", count);
+        BenchmarkDispatch<ReceiverStorage::PackedArray>("Dispatch packed", count);
+        BenchmarkDispatchBaselines(count);
+    }
+
+    BenchmarkEarlyExit(1000, 0);
+    BenchmarkEarlyExit(1000, 10);
+    BenchmarkEarlyExit(1000, 999);
+
+    for(int count : { 10, 1000 })
+    {
+        BenchmarkChurn<ReceiverStorage::LinkedList>("Subscribe churn linked", count);
+        BenchmarkChurn<ReceiverStorage::PackedArray>("Subscribe churn packed", count);
+        BenchmarkCompactChurn(count);
+    }
+}
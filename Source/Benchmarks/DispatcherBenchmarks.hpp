@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Dispatcher Benchmarks
+//
+//  Measures invocations of delegates bound to functions, functors and
+//  methods, dispatches to different numbers of receivers stored in linked
+//  lists and packed arrays, early exits of collectors, and subscription
+//  churn. Standard functions and virtual calls are measured alongside as
+//  a baseline. Dispatch results are reported per invoked receiver.
+//
+
+namespace Benchmarks
+{
+    // Runs dispatcher and delegate benchmarks.
+    void RunDispatcherBenchmarks();
+}
@@ -0,0 +1,177 @@
+#include "Precompiled.hpp"
+#include "EntitySystemBenchmarks.hpp"
+#include "Benchmark.hpp"
+#include "Game/EntitySystem.hpp"
+using namespace Benchmarks;
+
+namespace
+{
+    // Builds a benchmark name with an entity count.
+    std::string FormatName(const char* name, int count)
+    {
+        std::ostringstream stream;
+        stream << name << " (" << count << ")";
+        return stream.str();
+    }
+
+    // Measures basic operations on a number of entities.
+    void BenchmarkOperations(int count)
+    {
+        Game::EntitySystem entitySystem;
+        entitySystem.Initialize();
+
+        std::vector<Game::EntityHandle> entities(count);
+
+        // Create entities.
+        {
+            Measurement measurement(FormatName("CreateEntity", count), count);
+
+            for(int i = 0; i < count; ++i)
+            {
+                entities[i] = entitySystem.CreateEntity();
+            }
+        }
+
+        {
+            Measurement measurement(FormatName("ProcessCommands (create)", count), count);
+            entitySystem.ProcessCommands();
+        }
+
+        // Validate handles.
+        {
+            Measurement measurement(FormatName("IsHandleValid", count), count);
+
+            int validCount = 0;
+
+            for(int i = 0; i < count; ++i)
+            {
+                validCount += entitySystem.IsHandleValid(entities[i]) ? 1 : 0;
+            }
+
+            KeepValue(validCount);
+        }
+
+        {
+            Measurement measurement(FormatName("AreHandlesValid", count), count);
+            KeepValue(entitySystem.AreHandlesValid(entities.data(), count) ? 1 : 0);
+        }
+
+        // Destroy entities.
+        {
+            Measurement measurement(FormatName("DestroyEntity", count), count);
+
+            for(int i = 0; i < count; ++i)
+            {
+                entitySystem.DestroyEntity(entities[i]);
+            }
+        }
+
+        {
+            Measurement measurement(FormatName("ProcessCommands (destroy)", count), count);
+            entitySystem.ProcessCommands();
+        }
+
+        // Destroy all entities at once.
+        for(int i = 0; i < count; ++i)
+        {
+            entities[i] = entitySystem.CreateEntity();
+        }
+
+        entitySystem.ProcessCommands();
+
+        {
+            Measurement measurement(FormatName("DestroyAllEntities", count), count);
+            entitySystem.DestroyAllEntities();
+        }
+    }
+
+    // Measures bursts of entities that are spawned and destroyed shortly after.
+    void BenchmarkSpawnBursts(int count)
+    {
+        const int FrameCount = 100;
+        const int BurstSize = std::max(count / 10, 1);
+
+        Game::EntitySystem entitySystem;
+        entitySystem.Initialize();
+
+        std::vector<Game::EntityHandle> entities(BurstSize);
+
+        // Warm up handle storage before measuring.
+        entitySystem.CreateEntities(BurstSize, entities.data());
+        entitySystem.DestroyEntities(entities.data(), BurstSize);
+        entitySystem.ProcessCommands();
+
+        {
+            Measurement measurement(FormatName("Spawn-die bursts", count), (std::size_t)FrameCount * BurstSize);
+
+            for(int frame = 0; frame < FrameCount; ++frame)
+            {
+                for(int i = 0; i < BurstSize; ++i)
+                {
+                    entities[i] = entitySystem.CreateEntity();
+                }
+
+                entitySystem.ProcessCommands();
+
+                for(int i = 0; i < BurstSize; ++i)
+                {
+                    entitySystem.DestroyEntity(entities[i]);
+                }
+
+                entitySystem.ProcessCommands();
+            }
+        }
+
+        entitySystem.DestroyAllEntities();
+    }
+
+    // Measures a steady number of entities with a small fraction replaced every frame.
+    void BenchmarkSteadyState(int count)
+    {
+        const int FrameCount = 100;
+        const int ReplacedCount = std::max(count / 100, 1);
+
+        Game::EntitySystem entitySystem;
+        entitySystem.Initialize();
+
+        std::vector<Game::EntityHandle> entities(count);
+        entitySystem.CreateEntities(count, entities.data());
+        entitySystem.ProcessCommands();
+
+        // Use a fixed seed to make runs comparable.
+        std::mt19937 random(1234);
+        std::uniform_int_distribution<int> distribution(0, count - 1);
+
+        {
+            Measurement measurement(FormatName("Steady state", count), (std::size_t)FrameCount * ReplacedCount);
+
+            for(int frame = 0; frame < FrameCount; ++frame)
+            {
+                for(int i = 0; i < ReplacedCount; ++i)
+                {
+                    int index = distribution(random);
+                    entitySystem.DestroyEntity(entities[index]);
+                    entities[index] = entitySystem.CreateEntity();
+                }
+
+                entitySystem.ProcessCommands();
+            }
+        }
+
+        entitySystem.DestroyAllEntities();
+    }
+}
+
+void Benchmarks::RunEntitySystemBenchmarks()
+{
+    const int EntityCounts[] = { 1000, 100000, 1000000 };
+
+    PrintHeader("Entity System");
+
+    for(int count : EntityCounts)
+    {
+        BenchmarkOperations(count);
+        BenchmarkSpawnBursts(count);
+        BenchmarkSteadyState(count);
+    }
+}
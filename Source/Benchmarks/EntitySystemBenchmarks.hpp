@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Entity System Benchmarks
+//
+//  Measures entity creation, destruction, command processing and handle
+//  validation for different numbers of entities and churn patterns.
+//
+
+namespace Benchmarks
+{
+    // Runs entity system benchmarks.
+    void RunEntitySystemBenchmarks();
+}
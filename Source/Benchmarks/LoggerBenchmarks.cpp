@@ -0,0 +1,242 @@
+#include "Precompiled.hpp"
+#include "LoggerBenchmarks.hpp"
+#include "Benchmark.hpp"
+#include "System/Clock.hpp"
+#include "Logger/Sink.hpp"
+#include "Logger/AsyncSink.hpp"
+#include "Logger/Outputs/FileOutput.hpp"
+#include "Logger/Outputs/ConsoleOutput.hpp"
+#include "Logger/Outputs/DebuggerOutput.hpp"
+using namespace Benchmarks;
+
+namespace
+{
+    // Number of messages written by each benchmark.
+    const int MessageCount = 200000;
+
+    // Number of threads writing messages at the same time.
+    const int ThreadCount = 4;
+
+    // Name of the file written by file outputs.
+    const char* FileName = "LoggerBenchmark.txt";
+
+    // Benchmarked output types.
+    struct OutputTypes
+    {
+        enum Type
+        {
+            File,
+            Console,
+            Debugger,
+
+            Count,
+        };
+    };
+
+    const char* OutputNames[OutputTypes::Count] =
+    {
+        "file",
+        "console",
+        "debugger",
+    };
+
+    // Stream buffer that discards written characters.
+    class NullBuffer : public std::streambuf
+    {
+    protected:
+        int overflow(int character)
+        {
+            return traits_type::not_eof(character);
+        }
+
+        std::streamsize xsputn(const char* data, std::streamsize size)
+        {
+            return size;
+        }
+    };
+
+    // Output of a type, prepared for measuring.
+    class OutputFixture : private NonCopyable
+    {
+    public:
+        explicit OutputFixture(OutputTypes::Type type) :
+            m_type(type),
+            m_consoleBuffer(nullptr)
+        {
+            if(m_type == OutputTypes::File)
+            {
+                // Write a single file without rotating it.
+                Logger::FileOutputInfo info;
+                info.filename = FileName;
+                info.rotateSize = 0;
+
+                m_file.Initialize(info);
+            }
+            else if(m_type == OutputTypes::Console)
+            {
+                m_consoleBuffer = std::cout.rdbuf(&m_nullBuffer);
+            }
+        }
+
+        ~OutputFixture()
+        {
+            if(m_type == OutputTypes::File)
+            {
+                m_file.Cleanup();
+                std::remove(FileName);
+            }
+            else if(m_type == OutputTypes::Console)
+            {
+                std::cout.rdbuf(m_consoleBuffer);
+            }
+        }
+
+        Logger::Output* GetOutput()
+        {
+            switch(m_type)
+            {
+            case OutputTypes::File:
+                return &m_file;
+
+            case OutputTypes::Console:
+                return &m_console;
+
+            default:
+                return &m_debugger;
+            }
+        }
+
+    private:
+        OutputTypes::Type m_type;
+
+        Logger::FileOutput m_file;
+        Logger::ConsoleOutput m_console;
+        Logger::DebuggerOutput m_debugger;
+
+        NullBuffer m_nullBuffer;
+        std::streambuf* m_consoleBuffer;
+    };
+
+    // Builds a benchmark name with a sink and an output name.
+    std::string FormatName(const char* name, const char* sink, OutputTypes::Type output)
+    {
+        std::ostringstream stream;
+        stream << name << " (" << sink << ", " << OutputNames[output] << ")";
+        return stream.str();
+    }
+
+    // Writes a message the way the log macros do.
+    void WriteMessage(Logger::Sink& sink, int index)
+    {
+        if(sink.IsEnabled(Logger::Severity::Info))
+        {
+            Logger::ScopedMessage(&sink).SetSeverity(Logger::Severity::Info) << "Benchmark message " << index << " with a value of " << index * 0.5 << ".";
+        }
+    }
+
+    // Writes messages and records the latency of each call.
+    void WriteMessages(Logger::Sink& sink, int begin, int end, std::uint64_t* latencies)
+    {
+        for(int i = begin; i < end; ++i)
+        {
+            std::uint64_t start = System::Clock::ReadTicks();
+            WriteMessage(sink, i);
+            latencies[i] = System::Clock::ReadTicks() - start;
+        }
+    }
+
+    // Measures a sink with an output written from a number of threads.
+    void BenchmarkSink(Logger::Sink& sink, const char* sinkName, OutputTypes::Type output, int threadCount)
+    {
+        std::vector<std::uint64_t> latencies(MessageCount);
+
+        const char* name = threadCount == 1 ? "Messages" : "Messages threaded";
+
+        {
+            Measurement measurement(FormatName(name, sinkName, output), MessageCount);
+
+            if(threadCount == 1)
+            {
+                WriteMessages(sink, 0, MessageCount, latencies.data());
+            }
+            else
+            {
+                std::vector<std::thread> threads;
+
+                for(int thread = 0; thread < threadCount; ++thread)
+                {
+                    int begin = MessageCount * thread / threadCount;
+                    int end = MessageCount * (thread + 1) / threadCount;
+
+                    threads.emplace_back(&WriteMessages, std::ref(sink), begin, end, latencies.data());
+                }
+
+                for(std::thread& thread : threads)
+                {
+                    thread.join();
+                }
+            }
+
+            sink.Flush();
+        }
+
+        PrintLatency(FormatName(threadCount == 1 ? "Latency" : "Latency threaded", sinkName, output), latencies);
+    }
+
+    // Measures messages written to a synchronous sink.
+    void BenchmarkSynchronous(OutputTypes::Type output)
+    {
+        OutputFixture fixture(output);
+
+        Logger::Sink sink;
+        sink.AddOutput(fixture.GetOutput());
+
+        // Outputs are not thread safe without a writer thread.
+        BenchmarkSink(sink, "sync", output, 1);
+    }
+
+    // Measures messages queued for an asynchronous sink.
+    void BenchmarkAsynchronous(OutputTypes::Type output)
+    {
+        OutputFixture fixture(output);
+
+        Logger::AsyncSink sink;
+        sink.AddOutput(fixture.GetOutput());
+        sink.Initialize();
+
+        BenchmarkSink(sink, "async", output, 1);
+        BenchmarkSink(sink, "async", output, ThreadCount);
+
+        sink.Cleanup();
+    }
+
+    // Measures messages below the minimum severity of outputs.
+    void BenchmarkDisabled()
+    {
+        OutputFixture fixture(OutputTypes::Debugger);
+
+        Logger::Sink sink;
+        sink.AddOutput(fixture.GetOutput());
+        sink.SetSeverity(fixture.GetOutput(), Logger::Severity::Error);
+
+        Measurement measurement("Messages (disabled)", MessageCount);
+
+        for(int i = 0; i < MessageCount; ++i)
+        {
+            WriteMessage(sink, i);
+        }
+    }
+}
+
+void Benchmarks::RunLoggerBenchmarks()
+{
+    PrintHeader("Logger");
+
+    for(int output = 0; output < OutputTypes::Count; ++output)
+    {
+        BenchmarkSynchronous((OutputTypes::Type)output);
+        BenchmarkAsynchronous((OutputTypes::Type)output);
+    }
+
+    BenchmarkDisabled();
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Logger Benchmarks
+//
+//  Measures the latency of writing a message at the call site and the
+//  throughput of messages through synchronous and asynchronous sinks with
+//  file, console and debugger outputs, from one and from multiple threads.
+//  Throughput includes flushing the sink, so queued messages are counted
+//  only once they reach the output. Latency is reported as the median and
+//  the 99th percentile, which shows stalls of a full queue that the mean
+//  hides.
+//
+//  Console output is redirected to a discarding buffer while measured, so
+//  results do not depend on the terminal and the result table stays
+//  readable. Debugger output only checks for an attached debugger outside
+//  of Windows.
+//
+
+namespace Benchmarks
+{
+    // Runs logger benchmarks.
+    void RunLoggerBenchmarks();
+}
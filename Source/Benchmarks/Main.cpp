@@ -0,0 +1,81 @@
+#include "Precompiled.hpp"
+#include "EntitySystemBenchmarks.hpp"
+#include "DispatcherBenchmarks.hpp"
+#include "LoggerBenchmarks.hpp"
+#include "BenchmarkResults.hpp"
+#include "Benchmark.hpp"
+
+int main(int argc, char* argv[])
+{
+    Build::Initialize();
+    Debug::Initialize();
+    Logger::Initialize();
+
+    // Parse command line arguments.
+    std::string outputFilename;
+    std::string baselineFilename;
+    double threshold = 0.05;
+    int repeatCount = 1;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+
+        if(std::strcmp(argv[i], "--counters") == 0)
+        {
+            Benchmarks::EnableHardwareCounters();
+        }
+        else if(std::strcmp(argv[i], "--repeat") == 0 && hasValue)
+        {
+            repeatCount = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if(std::strcmp(argv[i], "--output") == 0 && hasValue)
+        {
+            outputFilename = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--compare") == 0 && hasValue)
+        {
+            baselineFilename = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--threshold") == 0 && hasValue)
+        {
+            threshold = std::atof(argv[++i]) / 100.0;
+        }
+        else
+        {
+            std::cout << "Usage: Benchmarks [--counters] [--repeat <count>] [--output <results>] [--compare <baseline>] [--threshold <percent>]\n";
+            return -1;
+        }
+    }
+
+    // Load the baseline before running, so a missing file fails early.
+    Benchmarks::BenchmarkResults baseline;
+
+    if(!baselineFilename.empty() && !baseline.Load(baselineFilename))
+        return -1;
+
+    // Run benchmark suites, printing only the first run.
+    for(int run = 0; run < repeatCount; ++run)
+    {
+        Benchmarks::SetQuiet(run != 0);
+
+        Benchmarks::RunEntitySystemBenchmarks();
+        Benchmarks::RunDispatcherBenchmarks();
+        Benchmarks::RunLoggerBenchmarks();
+    }
+
+    // Save samples of every run.
+    if(!outputFilename.empty() && !Benchmarks::GetResults().Save(outputFilename))
+        return -1;
+
+    // Report regressions against the baseline.
+    if(!baselineFilename.empty())
+    {
+        int regressionCount = Benchmarks::BenchmarkResults::Compare(baseline, Benchmarks::GetResults(), threshold, std::cout);
+
+        if(regressionCount != 0)
+            return 1;
+    }
+
+    return 0;
+}
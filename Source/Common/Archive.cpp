@@ -0,0 +1,435 @@
+#include "Precompiled.hpp"
+#include "Archive.hpp"
+#include "Compression.hpp"
+
+namespace
+{
+    // Log message strings.
+    #define LogOpenError(filename) "Failed to open an archive \"" << filename << "\"! "
+    #define LogReadError(name) "Failed to read an archive entry \"" << name << "\"! "
+    #define LogAddError(name) "Failed to add an archive entry \"" << name << "\"! "
+    #define LogWriteError(filename) "Failed to write an archive \"" << filename << "\"! "
+
+    // File format.
+    const std::uint32_t FileMagic   = 0x4B434150; // "PACK"
+    const std::uint32_t FileVersion = 1;
+
+    // Archive header.
+    struct Header
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint32_t entryCount;
+        std::uint32_t namesSize;
+        std::uint64_t indexOffset;
+        std::uint64_t reserved;
+    };
+
+    // Entry flags.
+    const std::uint32_t EntryCompressed = 1 << 0;
+
+    // Rounds an offset up to an alignment.
+    std::uint64_t AlignOffset(std::uint64_t offset, std::uint64_t alignment)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    // Writes zeros up to an offset.
+    void WritePadding(std::ofstream& file, std::uint64_t& offset, std::uint64_t target)
+    {
+        static const char Zeros[Archive::EntryAlignment] = { 0 };
+
+        while(offset < target)
+        {
+            std::size_t size = (std::size_t)std::min<std::uint64_t>(target - offset, sizeof(Zeros));
+            file.write(Zeros, size);
+            offset += size;
+        }
+    }
+
+    // Orders entries by their name hashes.
+    bool CompareEntryHash(const ArchiveEntry& entry, std::uint64_t hash)
+    {
+        return entry.hash < hash;
+    }
+}
+
+bool ArchiveEntry::IsCompressed() const
+{
+    return (flags & EntryCompressed) != 0;
+}
+
+Archive::Archive() :
+    m_entries(nullptr),
+    m_entryCount(0),
+    m_names(nullptr),
+    m_namesSize(0),
+    m_initialized(false)
+{
+}
+
+Archive::~Archive()
+{
+    this->Cleanup();
+}
+
+void Archive::Cleanup()
+{
+    m_entries = nullptr;
+    m_entryCount = 0;
+    m_names = nullptr;
+    m_namesSize = 0;
+
+    m_file.Cleanup();
+    m_filename.clear();
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool Archive::Open(std::string filename)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            this->Cleanup();
+        }
+    );
+
+    // Map the archive.
+    if(!m_file.Open(filename))
+    {
+        LogError() << LogOpenError(filename) << "Couldn't map the file.";
+        return false;
+    }
+
+    const std::uint8_t* data = reinterpret_cast<const std::uint8_t*>(m_file.GetData());
+    std::size_t size = m_file.GetSize();
+
+    // Validate the header.
+    if(size < sizeof(Header))
+    {
+        LogError() << LogOpenError(filename) << "File is too small.";
+        return false;
+    }
+
+    const Header* header = reinterpret_cast<const Header*>(data);
+
+    if(header->magic != FileMagic || header->version != FileVersion)
+    {
+        LogError() << LogOpenError(filename) << "Unsupported file format.";
+        return false;
+    }
+
+    // Validate the index.
+    std::uint64_t indexSize = (std::uint64_t)header->entryCount * sizeof(ArchiveEntry);
+
+    if(header->indexOffset % alignof(ArchiveEntry) != 0 || header->indexOffset > size ||
+        indexSize + header->namesSize > size - header->indexOffset)
+    {
+        LogError() << LogOpenError(filename) << "Invalid index.";
+        return false;
+    }
+
+    m_entries = reinterpret_cast<const ArchiveEntry*>(data + header->indexOffset);
+    m_entryCount = header->entryCount;
+    m_names = reinterpret_cast<const char*>(data + header->indexOffset + indexSize);
+    m_namesSize = header->namesSize;
+
+    // Validate entries once, so they can be accessed without checks.
+    for(std::size_t i = 0; i < m_entryCount; ++i)
+    {
+        const ArchiveEntry& entry = m_entries[i];
+
+        bool valid = entry.offset <= size && entry.storedSize <= size - entry.offset;
+        valid = valid && (std::uint64_t)entry.nameOffset + entry.nameLength <= m_namesSize;
+        valid = valid && (entry.IsCompressed() || entry.storedSize == entry.size);
+        valid = valid && (i == 0 || m_entries[i - 1].hash <= entry.hash);
+
+        if(!valid)
+        {
+            LogError() << LogOpenError(filename) << "Invalid entry.";
+            return false;
+        }
+    }
+
+    m_filename = filename;
+
+    // Success!
+    return m_initialized = true;
+}
+
+const ArchiveEntry* Archive::Find(const std::string& name) const
+{
+    if(!m_initialized)
+        return nullptr;
+
+    // Binary search the hash and compare names of colliding entries.
+    std::uint64_t hash = HashName(name);
+
+    const ArchiveEntry* end = m_entries + m_entryCount;
+    const ArchiveEntry* entry = std::lower_bound(m_entries, end, hash, &CompareEntryHash);
+
+    for(; entry != end && entry->hash == hash; ++entry)
+    {
+        if(entry->nameLength == name.size() && std::memcmp(m_names + entry->nameOffset, name.data(), name.size()) == 0)
+            return entry;
+    }
+
+    return nullptr;
+}
+
+const void* Archive::GetData(const ArchiveEntry& entry) const
+{
+    Assert(m_initialized, "Archive is not open!");
+
+    return reinterpret_cast<const std::uint8_t*>(m_file.GetData()) + entry.offset;
+}
+
+std::string Archive::GetName(const ArchiveEntry& entry) const
+{
+    Assert(m_initialized, "Archive is not open!");
+
+    return std::string(m_names + entry.nameOffset, entry.nameLength);
+}
+
+bool Archive::Read(const ArchiveEntry& entry, std::vector<std::uint8_t>& content) const
+{
+    Assert(m_initialized, "Archive is not open!");
+
+    const std::uint8_t* data = reinterpret_cast<const std::uint8_t*>(this->GetData(entry));
+
+    if(!entry.IsCompressed())
+    {
+        content.assign(data, data + entry.size);
+        return true;
+    }
+
+    content.resize((std::size_t)entry.size);
+
+    if(!Compression::Decompress(data, (std::size_t)entry.storedSize, content.data(), content.size()))
+    {
+        LogError() << LogReadError(this->GetName(entry)) << "Couldn't decompress the data.";
+        content.clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool Archive::Read(const std::string& name, std::vector<std::uint8_t>& content) const
+{
+    const ArchiveEntry* entry = this->Find(name);
+
+    if(entry == nullptr)
+    {
+        LogError() << LogReadError(name) << "Entry does not exist in \"" << m_filename << "\".";
+        return false;
+    }
+
+    return this->Read(*entry, content);
+}
+
+const ArchiveEntry* Archive::GetEntries() const
+{
+    return m_entries;
+}
+
+std::size_t Archive::GetEntryCount() const
+{
+    return m_entryCount;
+}
+
+bool Archive::IsOpen() const
+{
+    return m_initialized;
+}
+
+std::uint64_t Archive::HashName(const std::string& name)
+{
+    // Hash with the 64bit FNV-1a function.
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for(char character : name)
+    {
+        hash ^= (std::uint8_t)character;
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+ArchiveWriter::ArchiveWriter()
+{
+}
+
+ArchiveWriter::~ArchiveWriter()
+{
+    this->Cleanup();
+}
+
+void ArchiveWriter::Cleanup()
+{
+    Utility::ClearContainer(m_entries);
+}
+
+bool ArchiveWriter::AddEntry(const std::string& name, const void* data, std::size_t size, bool compress)
+{
+    // Validate arguments.
+    if(name.empty())
+    {
+        LogError() << LogAddError(name) << "Invalid name.";
+        return false;
+    }
+
+    if(data == nullptr && size != 0)
+    {
+        LogError() << LogAddError(name) << "Invalid data.";
+        return false;
+    }
+
+    std::uint64_t hash = Archive::HashName(name);
+
+    for(const Entry& other : m_entries)
+    {
+        if(other.hash == hash && other.name == name)
+        {
+            LogError() << LogAddError(name) << "Entry already exists.";
+            return false;
+        }
+    }
+
+    // Keep compressed data only if it is smaller.
+    Entry entry;
+    entry.name = name;
+    entry.hash = hash;
+    entry.size = size;
+    entry.compressed = false;
+
+    if(compress && size != 0)
+    {
+        entry.data.resize(Compression::GetCompressBound(size));
+        std::size_t compressedSize = Compression::Compress(data, size, entry.data.data(), entry.data.size());
+
+        if(compressedSize != 0 && compressedSize < size)
+        {
+            entry.data.resize(compressedSize);
+            entry.data.shrink_to_fit();
+            entry.compressed = true;
+        }
+    }
+
+    if(!entry.compressed)
+    {
+        const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(data);
+        entry.data.assign(bytes, bytes + size);
+    }
+
+    m_entries.push_back(std::move(entry));
+
+    return true;
+}
+
+bool ArchiveWriter::AddFile(const std::string& name, const std::string& filename, bool compress)
+{
+    MappedFile file;
+
+    if(!file.Open(filename))
+    {
+        LogError() << LogAddError(name) << "Couldn't read the \"" << filename << "\" file.";
+        return false;
+    }
+
+    return this->AddEntry(name, file.GetData(), file.GetSize(), compress);
+}
+
+bool ArchiveWriter::Write(const std::string& filename) const
+{
+    // Sort entries by hashes for binary searches.
+    std::vector<const Entry*> entries;
+    entries.reserve(m_entries.size());
+
+    for(const Entry& entry : m_entries)
+    {
+        entries.push_back(&entry);
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry* a, const Entry* b)
+    {
+        return a->hash < b->hash;
+    });
+
+    // Open the file.
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+
+    if(!file)
+    {
+        LogError() << LogWriteError(filename) << "Couldn't open the file.";
+        return false;
+    }
+
+    // Write entry data at aligned offsets and build the index.
+    std::vector<ArchiveEntry> index;
+    index.reserve(entries.size());
+
+    std::string names;
+
+    Header header = {};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::uint64_t offset = sizeof(header);
+
+    for(const Entry* entry : entries)
+    {
+        WritePadding(file, offset, AlignOffset(offset, Archive::EntryAlignment));
+
+        ArchiveEntry indexEntry = {};
+        indexEntry.hash = entry->hash;
+        indexEntry.offset = offset;
+        indexEntry.storedSize = entry->data.size();
+        indexEntry.size = entry->size;
+        indexEntry.nameOffset = (std::uint32_t)names.size();
+        indexEntry.nameLength = (std::uint32_t)entry->name.size();
+        indexEntry.flags = entry->compressed ? EntryCompressed : 0;
+        index.push_back(indexEntry);
+
+        names += entry->name;
+
+        file.write(reinterpret_cast<const char*>(entry->data.data()), entry->data.size());
+        offset += entry->data.size();
+    }
+
+    // Write the index and names after entry data.
+    WritePadding(file, offset, AlignOffset(offset, alignof(ArchiveEntry)));
+
+    header.magic = FileMagic;
+    header.version = FileVersion;
+    header.entryCount = (std::uint32_t)index.size();
+    header.namesSize = (std::uint32_t)names.size();
+    header.indexOffset = offset;
+
+    file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(ArchiveEntry));
+    file.write(names.data(), names.size());
+
+    // Write the header last, so a partially written archive fails to open.
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    if(!file)
+    {
+        LogError() << LogWriteError(filename) << "Couldn't write to the file.";
+        return false;
+    }
+
+    return true;
+}
+
+std::size_t ArchiveWriter::GetEntryCount() const
+{
+    return m_entries.size();
+}
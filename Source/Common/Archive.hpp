@@ -0,0 +1,158 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "MappedFile.hpp"
+
+//
+// Archive
+//
+//  Packs many small files into a single file, so they can be loaded with
+//  a single open and map instead of opening each file on its own. Entries
+//  are found through an index of name hashes sorted for a binary search,
+//  with names kept to tell apart colliding hashes.
+//
+//  Each entry is stored either as is or compressed in the LZ4 block format,
+//  whichever is smaller. Entries start at offsets aligned to pages, so they
+//  can be mapped or read with direct IO on their own. Stored entries can be
+//  accessed in place in the mapped archive, while compressed entries have
+//  to be read into a buffer.
+//
+//  Archives are written by the ArchivePacker tool as a build step, or by the
+//  archive writer at runtime.
+//
+//  Example usage:
+//      ArchiveWriter writer;
+//      writer.AddFile("Data/Player.tga", "../Data/Player.tga", true);
+//      writer.Write("Data.pack");
+//
+//      Archive archive;
+//      archive.Open("Data.pack");
+//
+//      std::vector<std::uint8_t> content;
+//      archive.Read("Data/Player.tga", content);
+//
+
+// Archive entry.
+struct ArchiveEntry
+{
+    // Hash of the entry name.
+    std::uint64_t hash;
+
+    // Location of the entry data in the archive.
+    std::uint64_t offset;
+    std::uint64_t storedSize;
+
+    // Size of the entry data after decompression.
+    std::uint64_t size;
+
+    // Location of the entry name in the name block.
+    std::uint32_t nameOffset;
+    std::uint32_t nameLength;
+
+    // Entry flags.
+    std::uint32_t flags;
+    std::uint32_t padding;
+
+    // Checks if the entry data is compressed.
+    bool IsCompressed() const;
+};
+
+// Archive class.
+class Archive : private NonCopyable
+{
+public:
+    // Alignment of entry data within the archive.
+    static const std::size_t EntryAlignment = 4096;
+
+public:
+    Archive();
+    ~Archive();
+
+    // Restores instance to its original state.
+    void Cleanup();
+
+    // Opens and maps an archive.
+    bool Open(std::string filename);
+
+    // Finds an entry by its name.
+    // Returns nullptr if there is no such entry.
+    const ArchiveEntry* Find(const std::string& name) const;
+
+    // Gets the stored data of an entry in place.
+    // Data of compressed entries has to be decompressed before use.
+    const void* GetData(const ArchiveEntry& entry) const;
+
+    // Gets the name of an entry.
+    std::string GetName(const ArchiveEntry& entry) const;
+
+    // Reads the content of an entry, decompressing it if needed.
+    bool Read(const ArchiveEntry& entry, std::vector<std::uint8_t>& content) const;
+    bool Read(const std::string& name, std::vector<std::uint8_t>& content) const;
+
+    // Gets all entries sorted by their name hashes.
+    const ArchiveEntry* GetEntries() const;
+
+    // Gets the number of entries.
+    std::size_t GetEntryCount() const;
+
+    // Checks if an archive is open.
+    bool IsOpen() const;
+
+    // Hashes an entry name.
+    static std::uint64_t HashName(const std::string& name);
+
+private:
+    // Mapped archive file.
+    MappedFile m_file;
+    std::string m_filename;
+
+    // Index of entries and their names.
+    const ArchiveEntry* m_entries;
+    std::size_t m_entryCount;
+    const char* m_names;
+    std::size_t m_namesSize;
+
+    // Initialization state.
+    bool m_initialized;
+};
+
+// Archive writer class.
+class ArchiveWriter : private NonCopyable
+{
+public:
+    ArchiveWriter();
+    ~ArchiveWriter();
+
+    // Restores instance to its original state.
+    void Cleanup();
+
+    // Adds an entry from memory.
+    bool AddEntry(const std::string& name, const void* data, std::size_t size, bool compress);
+
+    // Adds an entry from the content of a file.
+    bool AddFile(const std::string& name, const std::string& filename, bool compress);
+
+    // Writes added entries to an archive file.
+    bool Write(const std::string& filename) const;
+
+    // Gets the number of added entries.
+    std::size_t GetEntryCount() const;
+
+private:
+    // Added entry.
+    struct Entry
+    {
+        std::string name;
+        std::uint64_t hash;
+        std::uint64_t size;
+        bool compressed;
+        std::vector<std::uint8_t> data;
+    };
+
+    // Type declarations.
+    typedef std::vector<Entry> EntryList;
+
+private:
+    // Added entries.
+    EntryList m_entries;
+};
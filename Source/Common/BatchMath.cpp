@@ -0,0 +1,250 @@
+#include "Precompiled.hpp"
+#include "BatchMath.hpp"
+using namespace BatchMath;
+
+// Select the widest available instruction set for kernels.
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define BATCH_MATH_AVX
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define BATCH_MATH_SSE
+#endif
+
+namespace
+{
+    // Lanes of the selected instruction set.
+    // Kernels are written once against these and step through blocks by the lane width.
+#if defined(BATCH_MATH_AVX)
+    typedef __m256 Lanes;
+    const int LaneWidth = 8;
+
+    inline Lanes LoadLanes(const float* data) { return _mm256_loadu_ps(data); }
+    inline void StoreLanes(float* data, Lanes value) { _mm256_storeu_ps(data, value); }
+    inline Lanes SetLanes(float value) { return _mm256_set1_ps(value); }
+    inline Lanes AddLanes(Lanes first, Lanes second) { return _mm256_add_ps(first, second); }
+    inline Lanes MultiplyLanes(Lanes first, Lanes second) { return _mm256_mul_ps(first, second); }
+#elif defined(BATCH_MATH_SSE)
+    typedef __m128 Lanes;
+    const int LaneWidth = 4;
+
+    inline Lanes LoadLanes(const float* data) { return _mm_loadu_ps(data); }
+    inline void StoreLanes(float* data, Lanes value) { _mm_storeu_ps(data, value); }
+    inline Lanes SetLanes(float value) { return _mm_set1_ps(value); }
+    inline Lanes AddLanes(Lanes first, Lanes second) { return _mm_add_ps(first, second); }
+    inline Lanes MultiplyLanes(Lanes first, Lanes second) { return _mm_mul_ps(first, second); }
+#else
+    typedef float Lanes;
+    const int LaneWidth = 1;
+
+    inline Lanes LoadLanes(const float* data) { return *data; }
+    inline void StoreLanes(float* data, Lanes value) { *data = value; }
+    inline Lanes SetLanes(float value) { return value; }
+    inline Lanes AddLanes(Lanes first, Lanes second) { return first + second; }
+    inline Lanes MultiplyLanes(Lanes first, Lanes second) { return first * second; }
+#endif
+
+    static_assert(Vec3x8::Width % LaneWidth == 0, "Block width must be a multiple of the lane width!");
+
+    // Gets the number of vectors in a block starting at an index.
+    int GetBlockCount(std::size_t first, std::size_t count)
+    {
+        std::size_t remaining = count - first;
+        return remaining < (std::size_t)Vec3x8::Width ? (int)remaining : (int)Vec3x8::Width;
+    }
+}
+
+void Vec3x8::Load(Stream<const glm::vec3> stream, std::size_t first, int count)
+{
+    Assert(count >= 0 && count <= Width, "Invalid number of vectors!");
+
+    for(int i = 0; i < count; ++i)
+    {
+        const glm::vec3& vector = stream[first + i];
+
+        x[i] = vector.x;
+        y[i] = vector.y;
+        z[i] = vector.z;
+    }
+
+    for(int i = count; i < Width; ++i)
+    {
+        x[i] = 0.0f;
+        y[i] = 0.0f;
+        z[i] = 0.0f;
+    }
+}
+
+void Vec3x8::Store(Stream<glm::vec3> stream, std::size_t first, int count) const
+{
+    Assert(count >= 0 && count <= Width, "Invalid number of vectors!");
+
+    for(int i = 0; i < count; ++i)
+    {
+        stream[first + i] = glm::vec3(x[i], y[i], z[i]);
+    }
+}
+
+void BatchMath::TransformPoints(const glm::mat4& matrix, Vec3x8& points)
+{
+    // Columns of the matrix broadcast to all lanes.
+    Lanes m00 = SetLanes(matrix[0][0]), m01 = SetLanes(matrix[0][1]), m02 = SetLanes(matrix[0][2]);
+    Lanes m10 = SetLanes(matrix[1][0]), m11 = SetLanes(matrix[1][1]), m12 = SetLanes(matrix[1][2]);
+    Lanes m20 = SetLanes(matrix[2][0]), m21 = SetLanes(matrix[2][1]), m22 = SetLanes(matrix[2][2]);
+    Lanes m30 = SetLanes(matrix[3][0]), m31 = SetLanes(matrix[3][1]), m32 = SetLanes(matrix[3][2]);
+
+    for(int i = 0; i < Vec3x8::Width; i += LaneWidth)
+    {
+        Lanes x = LoadLanes(points.x + i);
+        Lanes y = LoadLanes(points.y + i);
+        Lanes z = LoadLanes(points.z + i);
+
+        StoreLanes(points.x + i, AddLanes(AddLanes(MultiplyLanes(m00, x), MultiplyLanes(m10, y)), AddLanes(MultiplyLanes(m20, z), m30)));
+        StoreLanes(points.y + i, AddLanes(AddLanes(MultiplyLanes(m01, x), MultiplyLanes(m11, y)), AddLanes(MultiplyLanes(m21, z), m31)));
+        StoreLanes(points.z + i, AddLanes(AddLanes(MultiplyLanes(m02, x), MultiplyLanes(m12, y)), AddLanes(MultiplyLanes(m22, z), m32)));
+    }
+}
+
+void BatchMath::IntegrateVelocities(Vec3x8& positions, const Vec3x8& velocities, float timeDelta)
+{
+    Lanes time = SetLanes(timeDelta);
+
+    for(int i = 0; i < Vec3x8::Width; i += LaneWidth)
+    {
+        StoreLanes(positions.x + i, AddLanes(LoadLanes(positions.x + i), MultiplyLanes(LoadLanes(velocities.x + i), time)));
+        StoreLanes(positions.y + i, AddLanes(LoadLanes(positions.y + i), MultiplyLanes(LoadLanes(velocities.y + i), time)));
+        StoreLanes(positions.z + i, AddLanes(LoadLanes(positions.z + i), MultiplyLanes(LoadLanes(velocities.z + i), time)));
+    }
+}
+
+void BatchMath::AddScalar(float* values, float value, std::size_t count)
+{
+    Lanes lanes = SetLanes(value);
+    std::size_t i = 0;
+
+    for(; i + LaneWidth <= count; i += LaneWidth)
+    {
+        StoreLanes(values + i, AddLanes(LoadLanes(values + i), lanes));
+    }
+
+    for(; i < count; ++i)
+    {
+        values[i] += value;
+    }
+}
+
+void BatchMath::MultiplyAdd(float* values, const float* deltas, float scale, std::size_t count)
+{
+    Lanes lanes = SetLanes(scale);
+    std::size_t i = 0;
+
+    for(; i + LaneWidth <= count; i += LaneWidth)
+    {
+        StoreLanes(values + i, AddLanes(LoadLanes(values + i), MultiplyLanes(LoadLanes(deltas + i), lanes)));
+    }
+
+    for(; i < count; ++i)
+    {
+        values[i] += deltas[i] * scale;
+    }
+}
+
+void BatchMath::Multiply(const float* first, const float* second, float* results, std::size_t count)
+{
+    std::size_t i = 0;
+
+    for(; i + LaneWidth <= count; i += LaneWidth)
+    {
+        StoreLanes(results + i, MultiplyLanes(LoadLanes(first + i), LoadLanes(second + i)));
+    }
+
+    for(; i < count; ++i)
+    {
+        results[i] = first[i] * second[i];
+    }
+}
+
+void BatchMath::TransformPoints(const glm::mat4& matrix, Stream<const glm::vec3> input, Stream<glm::vec3> output, std::size_t count)
+{
+    Vec3x8 points;
+
+    for(std::size_t first = 0; first < count; first += Vec3x8::Width)
+    {
+        int blockCount = GetBlockCount(first, count);
+
+        points.Load(input, first, blockCount);
+        TransformPoints(matrix, points);
+        points.Store(output, first, blockCount);
+    }
+}
+
+void BatchMath::IntegrateVelocities(Stream<glm::vec3> positions, Stream<const glm::vec3> velocities, float timeDelta, std::size_t count)
+{
+    Vec3x8 positionBlock;
+    Vec3x8 velocityBlock;
+
+    for(std::size_t first = 0; first < count; first += Vec3x8::Width)
+    {
+        int blockCount = GetBlockCount(first, count);
+
+        positionBlock.Load(positions, first, blockCount);
+        velocityBlock.Load(velocities, first, blockCount);
+        IntegrateVelocities(positionBlock, velocityBlock, timeDelta);
+        positionBlock.Store(positions, first, blockCount);
+    }
+}
+
+void BatchMath::ComposeMatrices(Stream<const glm::vec3> positions, Stream<const float> rotations,
+    Stream<const glm::vec2> scales, glm::mat4* results, std::size_t count)
+{
+    Assert(results != nullptr || count == 0, "Invalid result array!");
+
+    // Sines and cosines stay scalar, while their products with scales are batched.
+    float sines[Vec3x8::Width];
+    float cosines[Vec3x8::Width];
+    float scalesX[Vec3x8::Width];
+    float scalesY[Vec3x8::Width];
+    float axes[4][Vec3x8::Width];
+
+    for(std::size_t first = 0; first < count; first += Vec3x8::Width)
+    {
+        int blockCount = GetBlockCount(first, count);
+
+        for(int i = 0; i < Vec3x8::Width; ++i)
+        {
+            float rotation = i < blockCount ? rotations[first + i] : 0.0f;
+            const glm::vec2 scale = i < blockCount ? scales[first + i] : glm::vec2(0.0f, 0.0f);
+
+            sines[i] = std::sin(rotation);
+            cosines[i] = std::cos(rotation);
+            scalesX[i] = scale.x;
+            scalesY[i] = scale.y;
+        }
+
+        // Calculate rotated and scaled axes.
+        for(int i = 0; i < Vec3x8::Width; i += LaneWidth)
+        {
+            Lanes sine = LoadLanes(sines + i);
+            Lanes cosine = LoadLanes(cosines + i);
+            Lanes scaleX = LoadLanes(scalesX + i);
+            Lanes scaleY = LoadLanes(scalesY + i);
+
+            StoreLanes(axes[0] + i, MultiplyLanes(cosine, scaleX));
+            StoreLanes(axes[1] + i, MultiplyLanes(sine, scaleX));
+            StoreLanes(axes[2] + i, MultiplyLanes(sine, scaleY));
+            StoreLanes(axes[3] + i, MultiplyLanes(cosine, scaleY));
+        }
+
+        // Write matrices.
+        for(int i = 0; i < blockCount; ++i)
+        {
+            const glm::vec3& position = positions[first + i];
+            glm::mat4& result = results[first + i];
+
+            result[0] = glm::vec4(axes[0][i], axes[1][i], 0.0f, 0.0f);
+            result[1] = glm::vec4(-axes[2][i], axes[3][i], 0.0f, 0.0f);
+            result[2] = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+            result[3] = glm::vec4(position, 1.0f);
+        }
+    }
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Batch Math
+//
+//  Math kernels that process many vectors at once with SIMD instructions,
+//  where GLM works on a single vector or matrix at a time. Kernels work on
+//  blocks of eight vectors stored as separate arrays of components, which
+//  map to a single AVX register or a pair of SSE registers per component,
+//  with a scalar fallback when neither is available.
+//
+//  Streams describe values spread through an array with a stride, such as
+//  a member of components in a dense array of a component pool. Stream
+//  functions gather blocks from them, run a kernel and scatter results
+//  back, so they can be used on component arrays directly. Data that is
+//  already stored in blocks can be passed to block kernels without any
+//  conversion, which avoids the gather and scatter overhead. Array kernels
+//  go further and work on arrays of a single component of any length, such
+//  as particles stored as a structure of arrays.
+//
+//  Kernels only use separate multiplies and adds, so results are identical
+//  to the scalar fallback and do not break determinism.
+//
+//  Example usage:
+//      Transform* transforms = pool.GetComponents();
+//      const Velocity* velocities = velocityPool.GetComponents();
+//
+//      BatchMath::IntegrateVelocities(
+//          BatchMath::MakeStream(transforms, &Transform::position),
+//          BatchMath::MakeStream(velocities, &Velocity::direction),
+//          timeDelta, pool.GetSize());
+//
+//      BatchMath::ComposeMatrices(
+//          BatchMath::MakeStream(transforms, &Transform::position),
+//          BatchMath::MakeStream(transforms, &Transform::rotation),
+//          BatchMath::MakeStream(transforms, &Transform::scale),
+//          matrices.data(), pool.GetSize());
+//
+
+namespace BatchMath
+{
+    // Strided view of values.
+    template<typename Type>
+    struct Stream
+    {
+        Stream(Type* data, std::size_t stride = sizeof(Type)) :
+            data(data),
+            stride(stride)
+        {
+        }
+
+        // Converts a stream of mutable values to a stream of constant values.
+        template<typename Other>
+        Stream(const Stream<Other>& other) :
+            data(other.data),
+            stride(other.stride)
+        {
+        }
+
+        // Gets a value at an index.
+        Type& operator[](std::size_t index) const
+        {
+            typedef typename std::conditional<std::is_const<Type>::value, const std::uint8_t, std::uint8_t>::type Byte;
+
+            return *reinterpret_cast<Type*>(reinterpret_cast<Byte*>(data) + index * stride);
+        }
+
+        // First value and distance between values in bytes.
+        Type* data;
+        std::size_t stride;
+    };
+
+    // Makes a stream of a member of objects in an array.
+    template<typename Class, typename Type>
+    Stream<Type> MakeStream(Class* objects, Type Class::* member)
+    {
+        return Stream<Type>(&(objects->*member), sizeof(Class));
+    }
+
+    template<typename Class, typename Type>
+    Stream<const Type> MakeStream(const Class* objects, Type Class::* member)
+    {
+        return Stream<const Type>(&(objects->*member), sizeof(Class));
+    }
+
+    // Block of vectors with components stored in separate arrays.
+    struct Vec3x8
+    {
+        // Number of vectors in a block.
+        static const int Width = 8;
+
+        // Gathers vectors from a stream.
+        // Lanes past the count are set to zero.
+        void Load(Stream<const glm::vec3> stream, std::size_t first, int count);
+
+        // Scatters a number of vectors to a stream.
+        void Store(Stream<glm::vec3> stream, std::size_t first, int count) const;
+
+        float x[Width];
+        float y[Width];
+        float z[Width];
+    };
+
+    // Block kernels.
+    // Transforms points by an affine matrix, ignoring its projective row.
+    void TransformPoints(const glm::mat4& matrix, Vec3x8& points);
+
+    // Moves positions along velocities over a time.
+    void IntegrateVelocities(Vec3x8& positions, const Vec3x8& velocities, float timeDelta);
+
+    // Array kernels.
+    // Work on plain arrays of components, such as those of structures of arrays.
+    // Adds a value to a number of values.
+    void AddScalar(float* values, float value, std::size_t count);
+
+    // Adds deltas scaled by a factor to a number of values.
+    // Moves positions along velocities when scaled by a time.
+    void MultiplyAdd(float* values, const float* deltas, float scale, std::size_t count);
+
+    // Multiplies a number of pairs of values.
+    void Multiply(const float* first, const float* second, float* results, std::size_t count);
+
+    // Stream functions.
+    // Transforms a number of points by an affine matrix.
+    // Input and output streams can be the same.
+    void TransformPoints(const glm::mat4& matrix, Stream<const glm::vec3> input, Stream<glm::vec3> output, std::size_t count);
+
+    // Moves a number of positions along their velocities over a time.
+    void IntegrateVelocities(Stream<glm::vec3> positions, Stream<const glm::vec3> velocities, float timeDelta, std::size_t count);
+
+    // Calculates world matrices from positions, rotations in radians around
+    // the z axis and scales along local x and y axes, the same as translating,
+    // rotating and scaling a matrix with GLM in this order.
+    void ComposeMatrices(Stream<const glm::vec3> positions, Stream<const float> rotations,
+        Stream<const glm::vec2> scales, glm::mat4* results, std::size_t count);
+}
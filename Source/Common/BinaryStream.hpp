@@ -0,0 +1,210 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Binary Stream
+//
+//  Writes and reads trivially copyable values to and from a flat block of
+//  memory. Arrays are aligned relative to the beginning of the block, so a
+//  reader can return pointers straight into a memory mapped file without
+//  copying or parsing individual elements.
+//
+//  Example usage:
+//      std::vector<std::uint8_t> buffer;
+//      BinaryWriter writer(buffer);
+//      writer.Write(count);
+//      writer.WriteArray(values.data(), values.size());
+//
+//      BinaryReader reader(buffer.data(), buffer.size());
+//      reader.Read(count);
+//
+//      std::size_t size = 0;
+//      const int* values = reader.ReadArray<int>(size);
+//
+//      if(!reader.IsValid())
+//      {
+//          /* Data was truncated! */
+//      }
+//
+
+// Binary writer class.
+class BinaryWriter : private NonCopyable
+{
+public:
+    // Alignment of arrays within the block.
+    static const std::size_t Alignment = 8;
+
+public:
+    BinaryWriter(std::vector<std::uint8_t>& buffer) :
+        m_buffer(&buffer)
+    {
+    }
+
+    // Writes a single value.
+    template<typename Type>
+    void Write(const Type& value)
+    {
+        static_assert(std::is_trivially_copyable<Type>::value, "Written type must be trivially copyable!");
+
+        this->WriteBytes(&value, sizeof(Type));
+    }
+
+    // Writes the number of elements followed by an aligned array of elements.
+    template<typename Type>
+    void WriteArray(const Type* elements, std::size_t count)
+    {
+        static_assert(std::is_trivially_copyable<Type>::value, "Written type must be trivially copyable!");
+        static_assert(alignof(Type) <= Alignment, "Written type has an unsupported alignment!");
+
+        this->Write<std::uint64_t>(count);
+        this->Align();
+        this->WriteBytes(elements, sizeof(Type) * count);
+    }
+
+    // Writes raw bytes.
+    void WriteBytes(const void* data, std::size_t size)
+    {
+        if(size == 0)
+            return;
+
+        std::size_t offset = m_buffer->size();
+        m_buffer->resize(offset + size);
+        std::memcpy(m_buffer->data() + offset, data, size);
+    }
+
+    // Pads the block to the array alignment.
+    void Align()
+    {
+        std::size_t size = (m_buffer->size() + Alignment - 1) / Alignment * Alignment;
+        m_buffer->resize(size, 0);
+    }
+
+private:
+    // Written block of memory.
+    std::vector<std::uint8_t>* m_buffer;
+};
+
+// Binary reader class.
+class BinaryReader : private NonCopyable
+{
+public:
+    // Alignment of arrays within the block.
+    static const std::size_t Alignment = BinaryWriter::Alignment;
+
+public:
+    BinaryReader(const void* data, std::size_t size) :
+        m_data(reinterpret_cast<const std::uint8_t*>(data)),
+        m_size(size),
+        m_offset(0),
+        m_valid(data != nullptr || size == 0)
+    {
+    }
+
+    // Reads a single value.
+    // Value is left unchanged if there is not enough data.
+    template<typename Type>
+    bool Read(Type& value)
+    {
+        static_assert(std::is_trivially_copyable<Type>::value, "Read type must be trivially copyable!");
+
+        const void* bytes = this->ReadBytes(sizeof(Type));
+
+        if(bytes == nullptr)
+            return false;
+
+        std::memcpy(&value, bytes, sizeof(Type));
+        return true;
+    }
+
+    // Reads an array of elements in place.
+    // Returns nullptr if there is not enough data.
+    template<typename Type>
+    const Type* ReadArray(std::size_t& count)
+    {
+        static_assert(std::is_trivially_copyable<Type>::value, "Read type must be trivially copyable!");
+        static_assert(alignof(Type) <= Alignment, "Read type has an unsupported alignment!");
+
+        count = 0;
+
+        std::uint64_t elements = 0;
+
+        if(!this->Read(elements))
+            return nullptr;
+
+        this->Align();
+
+        if(!m_valid || elements > (m_size - m_offset) / sizeof(Type))
+        {
+            m_valid = false;
+            return nullptr;
+        }
+
+        const std::uint8_t* bytes = m_data + m_offset;
+        Assert(reinterpret_cast<std::uintptr_t>(bytes) % alignof(Type) == 0, "Read array is not aligned!");
+
+        m_offset += (std::size_t)elements * sizeof(Type);
+        count = (std::size_t)elements;
+
+        return reinterpret_cast<const Type*>(bytes);
+    }
+
+    // Reads raw bytes in place.
+    // Returns nullptr if there is not enough data.
+    const void* ReadBytes(std::size_t size)
+    {
+        if(!m_valid || size > m_size - m_offset)
+        {
+            m_valid = false;
+            return nullptr;
+        }
+
+        const std::uint8_t* bytes = m_data + m_offset;
+        m_offset += size;
+
+        return bytes;
+    }
+
+    // Skips padding up to the array alignment.
+    void Align()
+    {
+        std::size_t offset = (m_offset + Alignment - 1) / Alignment * Alignment;
+
+        if(offset > m_size)
+        {
+            m_valid = false;
+            return;
+        }
+
+        m_offset = offset;
+    }
+
+    // Gets the current read position.
+    std::size_t GetOffset() const
+    {
+        return m_offset;
+    }
+
+    // Checks if all reads so far had enough data.
+    bool IsValid() const
+    {
+        return m_valid;
+    }
+
+    // Checks if all data has been read.
+    bool IsEnd() const
+    {
+        return m_offset == m_size;
+    }
+
+private:
+    // Read block of memory.
+    const std::uint8_t* m_data;
+    std::size_t m_size;
+
+    // Current read position.
+    std::size_t m_offset;
+
+    // Read state.
+    bool m_valid;
+};
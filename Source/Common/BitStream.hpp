@@ -0,0 +1,214 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Bit Stream
+//
+//  Writes and reads values packed with an arbitrary number of bits, for
+//  compact network packets. Bits are appended to a byte buffer starting
+//  from the lowest bit of each byte. Integers that are usually small can be
+//  written with a variable length, and floats can be quantized to a fixed
+//  number of bits within a known range.
+//
+//  Example usage:
+//      std::vector<std::uint8_t> buffer;
+//      BitWriter writer(buffer);
+//      writer.WriteBits(state, 3);
+//      writer.WriteVarint(count);
+//      writer.WriteQuantized(position.x, -1024.0f, 1024.0f, 20);
+//
+//      BitReader reader(buffer.data(), buffer.size());
+//      std::uint64_t state = reader.ReadBits(3);
+//
+//      if(!reader.IsValid())
+//      {
+//          /* Data was truncated! */
+//      }
+//
+
+// Bit writer class.
+class BitWriter : private NonCopyable
+{
+public:
+    // Starts writing at the end of a buffer.
+    BitWriter(std::vector<std::uint8_t>& buffer) :
+        m_buffer(&buffer),
+        m_bitCount(0)
+    {
+    }
+
+    // Writes the lowest bits of a value.
+    void WriteBits(std::uint64_t value, int count)
+    {
+        Assert(count >= 0 && count <= 64, "Invalid number of bits!");
+
+        while(count > 0)
+        {
+            int offset = (int)(m_bitCount % 8);
+
+            if(offset == 0)
+            {
+                m_buffer->push_back(0);
+            }
+
+            int taken = std::min(8 - offset, count);
+            std::uint64_t mask = ((std::uint64_t)1 << taken) - 1;
+
+            m_buffer->back() |= (std::uint8_t)((value & mask) << offset);
+
+            value >>= taken;
+            count -= taken;
+            m_bitCount += taken;
+        }
+    }
+
+    // Writes a single bit.
+    void WriteBool(bool value)
+    {
+        this->WriteBits(value ? 1 : 0, 1);
+    }
+
+    // Writes an integer in groups of seven bits followed by a continuation bit.
+    void WriteVarint(std::uint64_t value)
+    {
+        while(value >= 0x80)
+        {
+            this->WriteBits((value & 0x7f) | 0x80, 8);
+            value >>= 7;
+        }
+
+        this->WriteBits(value, 8);
+    }
+
+    // Writes a float quantized to a number of bits within a range.
+    // Values outside of the range are clamped.
+    void WriteQuantized(float value, float minimum, float maximum, int bits)
+    {
+        Assert(maximum > minimum, "Invalid quantization range!");
+        Assert(bits > 0 && bits <= 32, "Invalid number of quantization bits!");
+
+        double steps = (double)(((std::uint64_t)1 << bits) - 1);
+        double normalized = ((double)value - minimum) / ((double)maximum - minimum);
+        normalized = std::min(std::max(normalized, 0.0), 1.0);
+
+        this->WriteBits((std::uint64_t)std::floor(normalized * steps + 0.5), bits);
+    }
+
+    // Gets the number of written bits.
+    std::size_t GetBitCount() const
+    {
+        return m_bitCount;
+    }
+
+private:
+    // Buffer that bits are appended to.
+    std::vector<std::uint8_t>* m_buffer;
+
+    // Number of written bits.
+    std::size_t m_bitCount;
+};
+
+// Bit reader class.
+class BitReader : private NonCopyable
+{
+public:
+    BitReader(const void* data, std::size_t size) :
+        m_data(static_cast<const std::uint8_t*>(data)),
+        m_size(size),
+        m_bitOffset(0),
+        m_valid(true)
+    {
+    }
+
+    // Reads a value of a number of bits.
+    // Returns zero once the data has been exhausted.
+    std::uint64_t ReadBits(int count)
+    {
+        Assert(count >= 0 && count <= 64, "Invalid number of bits!");
+
+        if(!m_valid || (std::size_t)count > m_size * 8 - m_bitOffset)
+        {
+            m_valid = false;
+            return 0;
+        }
+
+        std::uint64_t value = 0;
+        int shift = 0;
+
+        while(count > 0)
+        {
+            int offset = (int)(m_bitOffset % 8);
+            int taken = std::min(8 - offset, count);
+            std::uint64_t mask = ((std::uint64_t)1 << taken) - 1;
+
+            value |= ((std::uint64_t)(m_data[m_bitOffset / 8] >> offset) & mask) << shift;
+
+            shift += taken;
+            count -= taken;
+            m_bitOffset += taken;
+        }
+
+        return value;
+    }
+
+    // Reads a single bit.
+    bool ReadBool()
+    {
+        return this->ReadBits(1) != 0;
+    }
+
+    // Reads an integer written in groups of seven bits.
+    std::uint64_t ReadVarint()
+    {
+        std::uint64_t value = 0;
+
+        for(int shift = 0; shift < 64; shift += 7)
+        {
+            std::uint64_t group = this->ReadBits(8);
+            value |= (group & 0x7f) << shift;
+
+            if(!(group & 0x80))
+                return value;
+        }
+
+        // Too many groups for a 64bit value.
+        m_valid = false;
+        return 0;
+    }
+
+    // Reads a float quantized to a number of bits within a range.
+    float ReadQuantized(float minimum, float maximum, int bits)
+    {
+        Assert(maximum > minimum, "Invalid quantization range!");
+        Assert(bits > 0 && bits <= 32, "Invalid number of quantization bits!");
+
+        double steps = (double)(((std::uint64_t)1 << bits) - 1);
+        double normalized = (double)this->ReadBits(bits) / steps;
+
+        return (float)(minimum + normalized * ((double)maximum - minimum));
+    }
+
+    // Checks if all reads have been within the data.
+    bool IsValid() const
+    {
+        return m_valid;
+    }
+
+    // Checks if all bits of whole bytes have been read.
+    bool IsAtEnd() const
+    {
+        return (m_bitOffset + 7) / 8 == m_size;
+    }
+
+private:
+    // Read data.
+    const std::uint8_t* m_data;
+    std::size_t m_size;
+
+    // Position of the next bit.
+    std::size_t m_bitOffset;
+
+    // Validity of reads.
+    bool m_valid;
+};
@@ -5,20 +5,53 @@ namespace
 {
     std::string workingDir;
     std::string sourceDir;
+    std::string sourceDirKey = "SOURCE/";
+
+    // Trims trailing whitespace, unifies separators and ends the path with a separator.
+    std::string NormalizeDir(std::string path)
+    {
+        while(!path.empty() && std::isspace((unsigned char)path.back()))
+        {
+            path.pop_back();
+        }
+
+        std::replace(path.begin(), path.end(), '\\', '/');
+
+        if(!path.empty() && path.back() != '/')
+        {
+            path.push_back('/');
+        }
+
+        return path;
+    }
 }
 
 void Build::Initialize()
 {
-    workingDir = Utility::GetTextFileContent("WorkingDir.txt");
-    sourceDir = Utility::GetTextFileContent("SourceDir.txt");
+    // Resolve paths once, so users don't have to normalize them on every use.
+    workingDir = NormalizeDir(Utility::GetTextFileContent("WorkingDir.txt"));
+    sourceDir = NormalizeDir(Utility::GetTextFileContent("SourceDir.txt"));
+
+    // Fall back to the name of the source directory if the build system did not specify it.
+    sourceDirKey = sourceDir.empty() ? "SOURCE/" : sourceDir;
+
+    for(char& character : sourceDirKey)
+    {
+        character = (char)std::toupper((unsigned char)character);
+    }
 }
 
-std::string Build::GetWorkingDir()
+const std::string& Build::GetWorkingDir()
 {
     return workingDir;
 }
 
-std::string Build::GetSourceDir()
+const std::string& Build::GetSourceDir()
 {
     return sourceDir;
 }
+
+const std::string& Build::GetSourceDirKey()
+{
+    return sourceDirKey;
+}
@@ -12,8 +12,13 @@ namespace Build
     void Initialize();
 
     // Gets the working directory specified by the build system.
-    std::string GetWorkingDir();
+    const std::string& GetWorkingDir();
 
     // Gets the source directory specified by the build system.
-    std::string GetSourceDir();
+    // Paths are resolved once with forward slashes and a trailing separator.
+    const std::string& GetSourceDir();
+
+    // Gets the source directory in upper case for matching paths
+    // regardless of character case, such as those from __FILE__ macro.
+    const std::string& GetSourceDirKey();
 }
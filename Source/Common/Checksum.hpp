@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Checksum
+//
+//  Computes a 64bit checksum of data fed to it in pieces, for detecting
+//  when simulations that should be identical diverge. Comparing checksums
+//  of state every tick finds the first tick where runs differ, without
+//  storing or diffing the whole state. Not suited for hash tables or for
+//  anything security related.
+//
+//  Data is consumed in 8 byte words with a multiply and a rotation each,
+//  and the value is only mixed fully when it is read. Same bytes fed in
+//  the same order always give the same value, regardless of how they are
+//  split between updates of whole words. Padding bytes of structs are fed
+//  as they are, so hashed structs should not have any.
+//
+//  Example usage:
+//      Checksum checksum;
+//      checksum.Update(tickIndex);
+//      checksum.Update(positions.data(), positions.size() * sizeof(glm::vec3));
+//
+//      std::uint64_t value = checksum.GetValue();
+//
+
+// Checksum class.
+class Checksum
+{
+public:
+    Checksum() :
+        m_state(Seed),
+        m_size(0)
+    {
+    }
+
+    // Adds bytes to the checksum.
+    void Update(const void* data, std::size_t size)
+    {
+        const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+        const std::uint8_t* end = bytes + size;
+
+        // Process whole words.
+        while(end - bytes >= 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, bytes, 8);
+
+            this->AddWord(word);
+            bytes += 8;
+        }
+
+        // Process remaining bytes as a partial word.
+        if(bytes != end)
+        {
+            std::uint64_t word = 0;
+            std::memcpy(&word, bytes, end - bytes);
+
+            this->AddWord(word);
+        }
+
+        m_size += size;
+    }
+
+    // Adds a value to the checksum.
+    template<typename Type>
+    void Update(const Type& value)
+    {
+        static_assert(std::is_trivially_copyable<Type>::value, "Checksummed values must be trivially copyable!");
+
+        this->Update(&value, sizeof(Type));
+    }
+
+    // Gets the checksum of all added bytes.
+    std::uint64_t GetValue() const
+    {
+        return Utility::HashMix(m_state ^ m_size);
+    }
+
+private:
+    // Initial state.
+    static const std::uint64_t Seed = 0x9e3779b97f4a7c15ULL;
+
+    // Adds a single word.
+    void AddWord(std::uint64_t word)
+    {
+        m_state = (m_state ^ word) * 0x87c37b91114253d5ULL;
+        m_state = (m_state << 31) | (m_state >> 33);
+    }
+
+private:
+    // Mixed state of added words.
+    std::uint64_t m_state;
+
+    // Number of added bytes.
+    std::uint64_t m_size;
+};
@@ -8,6 +8,17 @@
 //  Collects return types of multiple invocations.
 //  Returns boolean on call that indicates if collection should continue.
 //
+//  Reducing collectors keep a single running result, so queries that ask
+//  every receiver, such as the largest speed modifier or whether any
+//  system vetoes an action, need no temporary containers.
+//
+//  Example usage:
+//      Dispatcher<float(EntityHandle), CollectMax<float>> speedModifier;
+//      Dispatcher<bool(const SpawnRequest&), CollectAny<bool>> vetoSpawn;
+//
+//      float modifier = speedModifier.Dispatch(entity);
+//      bool vetoed = vetoSpawn.Dispatch(request);
+//
 
 // Default collector.
 template<typename ReturnType>
@@ -106,3 +117,292 @@ public:
 private:
     ReturnType m_result;
 };
+
+// Collector that returns the sum of all receiver invocation results.
+template<typename ReturnType>
+class CollectSum
+{
+public:
+    CollectSum() :
+        m_result()
+    {
+    }
+
+    bool operator()(ReturnType result)
+    {
+        m_result += result;
+        return true;
+    }
+
+    ReturnType GetResult() const
+    {
+        return m_result;
+    }
+
+private:
+    ReturnType m_result;
+};
+
+// Collector that returns the smallest receiver invocation result.
+// Returns a value initialized result if no receiver has been invoked.
+template<typename ReturnType>
+class CollectMin
+{
+public:
+    CollectMin() :
+        m_result(),
+        m_collected(false)
+    {
+    }
+
+    bool operator()(ReturnType result)
+    {
+        if(!m_collected || result < m_result)
+        {
+            m_result = result;
+            m_collected = true;
+        }
+
+        return true;
+    }
+
+    ReturnType GetResult() const
+    {
+        return m_result;
+    }
+
+private:
+    ReturnType m_result;
+    bool m_collected;
+};
+
+// Collector that returns the largest receiver invocation result.
+// Returns a value initialized result if no receiver has been invoked.
+template<typename ReturnType>
+class CollectMax
+{
+public:
+    CollectMax() :
+        m_result(),
+        m_collected(false)
+    {
+    }
+
+    bool operator()(ReturnType result)
+    {
+        if(!m_collected || m_result < result)
+        {
+            m_result = result;
+            m_collected = true;
+        }
+
+        return true;
+    }
+
+    ReturnType GetResult() const
+    {
+        return m_result;
+    }
+
+private:
+    ReturnType m_result;
+    bool m_collected;
+};
+
+// Collector that returns true if any receiver invocation returned true.
+// Propagation stops at the first true result, as it decides the outcome.
+// Returns false if no receiver has been invoked.
+template<typename ReturnType = bool>
+class CollectAny
+{
+public:
+    CollectAny() :
+        m_result(false)
+    {
+    }
+
+    bool operator()(ReturnType result)
+    {
+        m_result = result ? true : false;
+        return !m_result;
+    }
+
+    bool GetResult() const
+    {
+        return m_result;
+    }
+
+private:
+    bool m_result;
+};
+
+// Collector that returns true if all receiver invocations returned true.
+// Propagation stops at the first false result, as it decides the outcome.
+// Returns true if no receiver has been invoked.
+template<typename ReturnType = bool>
+class CollectAll
+{
+public:
+    CollectAll() :
+        m_result(true)
+    {
+    }
+
+    bool operator()(ReturnType result)
+    {
+        m_result = result ? true : false;
+        return m_result;
+    }
+
+    bool GetResult() const
+    {
+        return m_result;
+    }
+
+private:
+    bool m_result;
+};
+
+// Span of per element results of a batch, packed into bits of 64 bit words.
+// Receivers of batch events clear bits of elements in bulk and return the span.
+struct BatchMask
+{
+    typedef std::uint64_t WordType;
+
+    static const int WordBits = 64;
+
+    WordType* words;
+    int count;
+
+    // Gets the number of words needed for a number of elements.
+    static int CalculateWordCount(int count)
+    {
+        return (count + WordBits - 1) / WordBits;
+    }
+
+    // Sets results of all elements to true, leaving bits past the count cleared.
+    void SetAll()
+    {
+        int wordCount = CalculateWordCount(count);
+
+        for(int i = 0; i < wordCount; ++i)
+        {
+            words[i] = ~WordType(0);
+        }
+
+        if(count % WordBits != 0)
+        {
+            words[wordCount - 1] = (WordType(1) << (count % WordBits)) - 1;
+        }
+    }
+
+    // Sets the result of an element.
+    void Set(int index, bool value)
+    {
+        Assert(index >= 0 && index < count, "Invalid batch mask index!");
+
+        WordType bit = WordType(1) << (index % WordBits);
+
+        if(value)
+        {
+            words[index / WordBits] |= bit;
+        }
+        else
+        {
+            words[index / WordBits] &= ~bit;
+        }
+    }
+
+    // Gets the result of an element.
+    bool Test(int index) const
+    {
+        Assert(index >= 0 && index < count, "Invalid batch mask index!");
+
+        return (words[index / WordBits] >> (index % WordBits) & 1) != 0;
+    }
+
+    // Checks if any element result is true.
+    bool Any() const
+    {
+        WordType result = 0;
+
+        for(int i = 0; i < CalculateWordCount(count); ++i)
+        {
+            result |= words[i];
+        }
+
+        return result != 0;
+    }
+
+    // Checks if all element results are true.
+    bool All() const
+    {
+        int wordCount = CalculateWordCount(count);
+
+        for(int i = 0; i < count / WordBits; ++i)
+        {
+            if(words[i] != ~WordType(0))
+                return false;
+        }
+
+        if(count % WordBits != 0)
+        {
+            WordType tail = (WordType(1) << (count % WordBits)) - 1;
+
+            if((words[wordCount - 1] & tail) != tail)
+                return false;
+        }
+
+        return true;
+    }
+};
+
+// Collector that continues dispatcher propagation while any element result of a batch is true.
+// Propagation stops once every element has been rejected by receivers.
+class CollectBatchWhileTrue
+{
+public:
+    CollectBatchWhileTrue() :
+        m_result()
+    {
+    }
+
+    bool operator()(BatchMask result)
+    {
+        m_result = result;
+        return result.Any();
+    }
+
+    BatchMask GetResult() const
+    {
+        return m_result;
+    }
+
+private:
+    BatchMask m_result;
+};
+
+// Collector that continues dispatcher propagation while any element result of a batch is false.
+// Propagation stops once every element has been accepted by receivers.
+class CollectBatchWhileFalse
+{
+public:
+    CollectBatchWhileFalse() :
+        m_result()
+    {
+    }
+
+    bool operator()(BatchMask result)
+    {
+        m_result = result;
+        return !result.All();
+    }
+
+    BatchMask GetResult() const
+    {
+        return m_result;
+    }
+
+private:
+    BatchMask m_result;
+};
@@ -0,0 +1,288 @@
+#include "Precompiled.hpp"
+#include "Compression.hpp"
+
+namespace
+{
+    // Format constants.
+    const std::size_t MinimumMatch = 4;
+    const std::size_t MaximumOffset = 65535;
+
+    // Last bytes of a block are always literals.
+    const std::size_t LastLiterals = 5;
+
+    // Last match has to start this many bytes before the end of a block.
+    const std::size_t MatchLimit = 12;
+
+    // Size of the table of recent positions.
+    const int HashBits = 12;
+    const std::size_t HashSize = 1 << HashBits;
+
+    // Reads four bytes without alignment requirements.
+    std::uint32_t ReadSequence(const std::uint8_t* data)
+    {
+        std::uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    // Hashes four bytes into a table index.
+    std::size_t HashSequence(std::uint32_t sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - HashBits);
+    }
+
+    // Writes compressed output and tracks the remaining capacity.
+    class BlockWriter
+    {
+    public:
+        BlockWriter(std::uint8_t* data, std::size_t capacity) :
+            m_data(data),
+            m_capacity(capacity),
+            m_size(0),
+            m_valid(true)
+        {
+        }
+
+        // Writes a byte.
+        void WriteByte(std::uint8_t value)
+        {
+            if(!this->Reserve(1))
+                return;
+
+            m_data[m_size++] = value;
+        }
+
+        // Writes the part of a length that does not fit into a token.
+        void WriteLength(std::size_t length)
+        {
+            while(length >= 255)
+            {
+                this->WriteByte(255);
+                length -= 255;
+            }
+
+            this->WriteByte((std::uint8_t)length);
+        }
+
+        // Writes raw bytes.
+        void WriteBytes(const std::uint8_t* bytes, std::size_t size)
+        {
+            if(size == 0 || !this->Reserve(size))
+                return;
+
+            std::memcpy(m_data + m_size, bytes, size);
+            m_size += size;
+        }
+
+        // Writes a sequence of literals followed by a match.
+        // Matches with zero length end the block.
+        void WriteSequence(const std::uint8_t* literals, std::size_t literalLength, std::size_t offset, std::size_t matchLength)
+        {
+            std::size_t matchCode = matchLength != 0 ? matchLength - MinimumMatch : 0;
+
+            std::uint8_t token = (std::uint8_t)(std::min<std::size_t>(literalLength, 15) << 4);
+            token |= (std::uint8_t)std::min<std::size_t>(matchCode, 15);
+            this->WriteByte(token);
+
+            if(literalLength >= 15)
+            {
+                this->WriteLength(literalLength - 15);
+            }
+
+            this->WriteBytes(literals, literalLength);
+
+            if(matchLength == 0)
+                return;
+
+            this->WriteByte((std::uint8_t)(offset & 0xFF));
+            this->WriteByte((std::uint8_t)(offset >> 8));
+
+            if(matchCode >= 15)
+            {
+                this->WriteLength(matchCode - 15);
+            }
+        }
+
+        // Gets the written size, or zero if the output did not fit.
+        std::size_t GetSize() const
+        {
+            return m_valid ? m_size : 0;
+        }
+
+    private:
+        // Checks if there is space for more bytes.
+        bool Reserve(std::size_t size)
+        {
+            if(!m_valid || size > m_capacity - m_size)
+            {
+                m_valid = false;
+                return false;
+            }
+
+            return true;
+        }
+
+    private:
+        std::uint8_t* m_data;
+        std::size_t m_capacity;
+        std::size_t m_size;
+        bool m_valid;
+    };
+
+    // Reads the part of a length that does not fit into a token.
+    bool ReadLength(const std::uint8_t* data, std::size_t size, std::size_t& offset, std::size_t& length)
+    {
+        std::uint8_t value = 0;
+
+        do
+        {
+            if(offset >= size)
+                return false;
+
+            value = data[offset++];
+            length += value;
+        }
+        while(value == 255);
+
+        return true;
+    }
+}
+
+std::size_t Compression::GetCompressBound(std::size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+std::size_t Compression::Compress(const void* source, std::size_t sourceSize, void* destination, std::size_t destinationCapacity)
+{
+    const std::uint8_t* input = reinterpret_cast<const std::uint8_t*>(source);
+    BlockWriter writer(reinterpret_cast<std::uint8_t*>(destination), destinationCapacity);
+
+    std::size_t anchor = 0;
+
+    // Blocks too small to hold a match are stored as literals.
+    if(sourceSize > MatchLimit)
+    {
+        // Positions are stored incremented by one, so zero marks empty slots.
+        std::vector<std::uint32_t> table(HashSize, 0);
+
+        std::size_t searchLimit = sourceSize - MatchLimit;
+        std::size_t matchEndLimit = sourceSize - LastLiterals;
+
+        for(std::size_t position = 0; position <= searchLimit; )
+        {
+            std::uint32_t sequence = ReadSequence(input + position);
+            std::size_t hash = HashSequence(sequence);
+
+            std::size_t candidate = table[hash];
+            table[hash] = (std::uint32_t)(position + 1);
+
+            if(candidate == 0 || position - (candidate - 1) > MaximumOffset || ReadSequence(input + candidate - 1) != sequence)
+            {
+                ++position;
+                continue;
+            }
+
+            std::size_t match = candidate - 1;
+
+            // Extend the match backwards over pending literals.
+            while(position > anchor && match > 0 && input[position - 1] == input[match - 1])
+            {
+                --position;
+                --match;
+            }
+
+            // Extend the match forwards.
+            std::size_t length = MinimumMatch;
+
+            while(position + length < matchEndLimit && input[position + length] == input[match + length])
+            {
+                ++length;
+            }
+
+            writer.WriteSequence(input + anchor, position - anchor, position - match, length);
+
+            position += length;
+            anchor = position;
+        }
+    }
+
+    // Write remaining literals.
+    writer.WriteSequence(input + anchor, sourceSize - anchor, 0, 0);
+
+    return writer.GetSize();
+}
+
+bool Compression::Decompress(const void* source, std::size_t sourceSize, void* destination, std::size_t destinationSize)
+{
+    const std::uint8_t* input = reinterpret_cast<const std::uint8_t*>(source);
+    std::uint8_t* output = reinterpret_cast<std::uint8_t*>(destination);
+
+    std::size_t inputOffset = 0;
+    std::size_t outputOffset = 0;
+
+    while(inputOffset < sourceSize)
+    {
+        std::uint8_t token = input[inputOffset++];
+
+        // Copy literals.
+        std::size_t literalLength = token >> 4;
+
+        if(literalLength == 15 && !ReadLength(input, sourceSize, inputOffset, literalLength))
+            return false;
+
+        if(literalLength > sourceSize - inputOffset || literalLength > destinationSize - outputOffset)
+            return false;
+
+        if(literalLength != 0)
+        {
+            std::memcpy(output + outputOffset, input + inputOffset, literalLength);
+        }
+
+        inputOffset += literalLength;
+        outputOffset += literalLength;
+
+        // Last sequence has no match.
+        if(inputOffset == sourceSize)
+            return outputOffset == destinationSize;
+
+        // Copy the match, which can overlap its own output.
+        if(sourceSize - inputOffset < 2)
+            return false;
+
+        std::size_t offset = input[inputOffset] | (input[inputOffset + 1] << 8);
+        inputOffset += 2;
+
+        if(offset == 0 || offset > outputOffset)
+            return false;
+
+        std::size_t matchLength = token & 15;
+
+        if(matchLength == 15 && !ReadLength(input, sourceSize, inputOffset, matchLength))
+            return false;
+
+        matchLength += MinimumMatch;
+
+        if(matchLength > destinationSize - outputOffset)
+            return false;
+
+        const std::uint8_t* match = output + outputOffset - offset;
+
+        if(offset >= matchLength)
+        {
+            std::memcpy(output + outputOffset, match, matchLength);
+        }
+        else
+        {
+            for(std::size_t i = 0; i < matchLength; ++i)
+            {
+                output[outputOffset + i] = match[i];
+            }
+        }
+
+        outputOffset += matchLength;
+    }
+
+    // Empty blocks still hold a single token.
+    return false;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Compression
+//
+//  Compresses blocks of memory in the LZ4 block format. Compression finds
+//  matches greedily through a small hash table of recent positions, which
+//  trades ratio for speed. Decompression validates every sequence against
+//  both buffers, so corrupted input fails instead of reading or writing out
+//  of bounds. The original size is not stored in a block and has to be kept
+//  by the caller.
+//
+//  Example usage:
+//      std::vector<std::uint8_t> block(Compression::GetCompressBound(size));
+//      block.resize(Compression::Compress(data, size, block.data(), block.size()));
+//
+//      std::vector<std::uint8_t> content(size);
+//      Compression::Decompress(block.data(), block.size(), content.data(), content.size());
+//
+
+namespace Compression
+{
+    // Gets the maximum size of a compressed block.
+    std::size_t GetCompressBound(std::size_t size);
+
+    // Compresses a block of memory.
+    // Returns the compressed size, or zero if it did not fit into the destination.
+    std::size_t Compress(const void* source, std::size_t sourceSize, void* destination, std::size_t destinationCapacity);
+
+    // Decompresses a block of memory of a known original size.
+    // Returns false if the block is invalid or does not decompress to exactly that size.
+    bool Decompress(const void* source, std::size_t sourceSize, void* destination, std::size_t destinationSize);
+}
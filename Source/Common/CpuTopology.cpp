@@ -0,0 +1,262 @@
+#include "Precompiled.hpp"
+#include "CpuTopology.hpp"
+
+#if defined(__linux__)
+    #include <sched.h>
+#endif
+
+namespace
+{
+#if defined(__linux__)
+    // Reads an integer from a sysfs file.
+    // Returns -1 if the file can't be read.
+    int ReadSysfsInteger(const std::string& path)
+    {
+        std::ifstream file(path);
+
+        int value = -1;
+
+        if(!(file >> value))
+            return -1;
+
+        return value;
+    }
+
+    // Parses a sysfs list of processor ranges, such as "0-7,16-23".
+    std::vector<int> ParseSysfsList(const std::string& text)
+    {
+        std::vector<int> indices;
+        std::istringstream stream(text);
+        std::string range;
+
+        while(std::getline(stream, range, ','))
+        {
+            int first = 0;
+            int last = 0;
+
+            int fields = std::sscanf(range.c_str(), "%d-%d", &first, &last);
+
+            if(fields == 1)
+            {
+                last = first;
+            }
+            else if(fields != 2)
+            {
+                continue;
+            }
+
+            for(int index = first; index <= last; ++index)
+            {
+                indices.push_back(index);
+            }
+        }
+
+        return indices;
+    }
+#endif
+}
+
+CpuTopology::CpuTopology() :
+    m_coreCount(0),
+    m_nodeCount(0)
+{
+}
+
+void CpuTopology::Detect()
+{
+    m_processors.clear();
+
+    if(!this->DetectPlatform() || m_processors.empty())
+    {
+        this->DetectFallback();
+    }
+
+    // Renumber platform identifiers of cores and nodes from zero.
+    std::map<int, int> coreIndices;
+    std::map<int, int> nodeIndices;
+
+    for(Processor& processor : m_processors)
+    {
+        processor.core = coreIndices.emplace(processor.core, (int)coreIndices.size()).first->second;
+        processor.node = nodeIndices.emplace(processor.node, (int)nodeIndices.size()).first->second;
+    }
+
+    m_coreCount = (int)coreIndices.size();
+    m_nodeCount = (int)nodeIndices.size();
+}
+
+bool CpuTopology::DetectPlatform()
+{
+#if defined(WIN32)
+    // Query cores and nodes of the first processor group.
+    DWORD length = 0;
+    GetLogicalProcessorInformation(nullptr, &length);
+
+    std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> entries(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+
+    if(entries.empty() || !GetLogicalProcessorInformation(entries.data(), &length))
+        return false;
+
+    const int MaskBits = (int)sizeof(ULONG_PTR) * 8;
+
+    std::vector<int> cores(MaskBits, -1);
+    std::vector<int> nodes(MaskBits, 0);
+    int coreCount = 0;
+
+    for(const SYSTEM_LOGICAL_PROCESSOR_INFORMATION& entry : entries)
+    {
+        for(int bit = 0; bit < MaskBits; ++bit)
+        {
+            if((entry.ProcessorMask & ((ULONG_PTR)1 << bit)) == 0)
+                continue;
+
+            if(entry.Relationship == RelationProcessorCore)
+            {
+                cores[bit] = coreCount;
+            }
+            else if(entry.Relationship == RelationNumaNode)
+            {
+                nodes[bit] = (int)entry.NumaNode.NodeNumber;
+            }
+        }
+
+        if(entry.Relationship == RelationProcessorCore)
+        {
+            coreCount += 1;
+        }
+    }
+
+    // Keep processors that the process is allowed to run on.
+    DWORD_PTR processMask = 0;
+    DWORD_PTR systemMask = 0;
+
+    if(!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+        return false;
+
+    for(int bit = 0; bit < MaskBits; ++bit)
+    {
+        if((processMask & ((DWORD_PTR)1 << bit)) == 0 || cores[bit] < 0)
+            continue;
+
+        Processor processor;
+        processor.index = bit;
+        processor.core = cores[bit];
+        processor.node = nodes[bit];
+        m_processors.push_back(processor);
+    }
+
+    return true;
+#elif defined(__linux__)
+    // Map processors to the nodes that list them.
+    // Machines without NUMA support have no node directories.
+    const int MaximumNodes = 256;
+
+    std::map<int, int> processorNodes;
+
+    for(int node = 0; node < MaximumNodes; ++node)
+    {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+
+        if(!file)
+            continue;
+
+        std::string text;
+        std::getline(file, text);
+
+        for(int index : ParseSysfsList(text))
+        {
+            processorNodes[index] = node;
+        }
+    }
+
+    // Keep processors that the process is allowed to run on.
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+
+    if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return false;
+
+    for(int index = 0; index < CPU_SETSIZE; ++index)
+    {
+        if(!CPU_ISSET(index, &allowed))
+            continue;
+
+        // Core identifiers are only unique within a package.
+        std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(index) + "/topology/";
+        int package = ReadSysfsInteger(path + "physical_package_id");
+        int core = ReadSysfsInteger(path + "core_id");
+
+        if(package < 0 || core < 0)
+            return false;
+
+        auto node = processorNodes.find(index);
+
+        Processor processor;
+        processor.index = index;
+        processor.core = (package << 16) | (core & 0xffff);
+        processor.node = node != processorNodes.end() ? node->second : 0;
+        m_processors.push_back(processor);
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+void CpuTopology::DetectFallback()
+{
+    m_processors.clear();
+
+    int count = std::max((int)std::thread::hardware_concurrency(), 1);
+
+    for(int index = 0; index < count; ++index)
+    {
+        Processor processor;
+        processor.index = index;
+        processor.core = index;
+        processor.node = 0;
+        m_processors.push_back(processor);
+    }
+}
+
+CpuTopology::IndexList CpuTopology::CalculatePlacement() const
+{
+    // Rank processors by their hardware thread within the core.
+    IndexList threadRanks(m_processors.size());
+    IndexList coreThreads(m_coreCount, 0);
+
+    for(std::size_t i = 0; i < m_processors.size(); ++i)
+    {
+        threadRanks[i] = coreThreads[m_processors[i].core]++;
+    }
+
+    // Take every core once before second threads, filling one node after another.
+    IndexList placement(m_processors.size());
+    std::iota(placement.begin(), placement.end(), 0);
+
+    std::stable_sort(placement.begin(), placement.end(), [&](int first, int second)
+    {
+        if(threadRanks[first] != threadRanks[second])
+            return threadRanks[first] < threadRanks[second];
+
+        return m_processors[first].node < m_processors[second].node;
+    });
+
+    return placement;
+}
+
+const CpuTopology::ProcessorList& CpuTopology::GetProcessors() const
+{
+    return m_processors;
+}
+
+int CpuTopology::GetCoreCount() const
+{
+    return m_coreCount;
+}
+
+int CpuTopology::GetNodeCount() const
+{
+    return m_nodeCount;
+}
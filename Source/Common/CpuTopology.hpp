@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// CPU Topology
+//
+//  Describes logical processors that the process can run on, along with
+//  the physical core and the NUMA node each of them belongs to. Logical
+//  processors of the same core share its execution units and caches, while
+//  processors of different nodes reach each other's memory only through
+//  the interconnect between sockets.
+//
+//  Placement orders processors for pinning threads. It takes one processor
+//  of every physical core before any second hardware thread of a core, and
+//  fills nodes one after another, so threads of a small pool stay on a
+//  single socket and share its last level cache.
+//
+//  Topology is read from sysfs on Linux and from logical processor
+//  information on Windows, where only the first processor group is used.
+//  Other platforms report every hardware thread as a separate core of a
+//  single node.
+//
+//  Example usage:
+//      CpuTopology topology;
+//      topology.Detect();
+//
+//      for(int processor : topology.CalculatePlacement())
+//      {
+//          /* ... */
+//      }
+//
+
+// CPU topology class.
+class CpuTopology
+{
+public:
+    // Logical processor.
+    struct Processor
+    {
+        // Index used by the operating system for thread affinity.
+        int index;
+
+        // Physical core and NUMA node indices, counted from zero.
+        int core;
+        int node;
+    };
+
+    // Type declarations.
+    typedef std::vector<Processor> ProcessorList;
+    typedef std::vector<int> IndexList;
+
+public:
+    CpuTopology();
+
+    // Detects logical processors of the machine.
+    // Falls back to a single node of separate cores if detection fails.
+    void Detect();
+
+    // Orders indices of processors in the list for placing threads.
+    IndexList CalculatePlacement() const;
+
+    // Gets the list of logical processors.
+    const ProcessorList& GetProcessors() const;
+
+    // Gets the number of physical cores.
+    int GetCoreCount() const;
+
+    // Gets the number of NUMA nodes.
+    int GetNodeCount() const;
+
+private:
+    // Detects processors with platform specific functions.
+    bool DetectPlatform();
+
+    // Fills the list with separate cores of a single node.
+    void DetectFallback();
+
+private:
+    // List of logical processors ordered by their indices.
+    ProcessorList m_processors;
+
+    // Number of physical cores and nodes.
+    int m_coreCount;
+    int m_nodeCount;
+};
@@ -0,0 +1,22 @@
+#include "Precompiled.hpp"
+#include "Common/Debug.hpp"
+
+void Debug::ReportFailure(const char* expression, const char* message, const char* file, int line)
+{
+    Logger::Source source(file);
+
+    // Write the message at the end of the scope.
+    {
+        Logger::ScopedMessage scopedMessage(Logger::GetGlobal());
+        scopedMessage.SetSource(source.GetPath()).SetLine(line).SetSeverity(Logger::Severity::Error);
+        scopedMessage << "Assertion failed: \"" << expression << "\"";
+
+        if(message != nullptr)
+        {
+            scopedMessage << " - " << message;
+        }
+    }
+
+    // Make sure the message is written before breaking.
+    Logger::GetGlobal()->Flush();
+}
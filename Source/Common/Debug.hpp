@@ -18,6 +18,35 @@
     */
 #endif
 
+//
+// Compiler Hints
+//
+
+// Keeps a function out of line and away from hot code.
+#if defined(_MSC_VER)
+    #define DEBUG_COLD __declspec(noinline)
+#elif defined(__GNUC__)
+    #define DEBUG_COLD __attribute__((noinline, cold))
+#else
+    #define DEBUG_COLD
+#endif
+
+// Tells the compiler that a condition is unlikely to be true.
+#if defined(__GNUC__)
+    #define DEBUG_UNLIKELY(condition) __builtin_expect(!!(condition), 0)
+#else
+    #define DEBUG_UNLIKELY(condition) (condition)
+#endif
+
+// Triggers a breakpoint, which terminates the application without a debugger.
+#if defined(_MSC_VER)
+    #define DEBUG_BREAK() __debugbreak()
+#elif defined(__GNUC__)
+    #define DEBUG_BREAK() __builtin_trap()
+#else
+    #define DEBUG_BREAK() std::abort()
+#endif
+
 //
 // Debug
 //
@@ -37,6 +66,10 @@ namespace Debug
             _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
         #endif
     }
+
+    // Writes a failed assertion to the log and flushes it.
+    // Kept out of line, so checks only cost a compare and a branch.
+    DEBUG_COLD void ReportFailure(const char* expression, const char* message, const char* file, int line);
 }
 
 //
@@ -45,13 +78,16 @@ namespace Debug
 
 #define DEBUG_EXPAND_MACRO(x) x
 
-#define DEBUG_PRINT_ASSERT_SIMPLE(expression) \
-    Logger::ScopedMessage(Logger::GetGlobal()).SetSource(__FILE__).SetLine(__LINE__) \
-        << "Assertion failed: \"" << expression << "\"";
-
-#define DBEUG_PRINT_ASSERT_MESSAGE(expression, message) \
-    Logger::ScopedMessage(Logger::GetGlobal()).SetSource(__FILE__).SetLine(__LINE__) \
-        << "Assertion failed: \"" << expression << "\" - " << message;
+#define DEBUG_CHECK(expression, message)                                    \
+    do                                                                      \
+    {                                                                       \
+        if(DEBUG_UNLIKELY(!(expression)))                                   \
+        {                                                                   \
+            Debug::ReportFailure(#expression, message, __FILE__, __LINE__); \
+            DEBUG_BREAK();                                                  \
+        }                                                                   \
+    }                                                                       \
+    while(false)
 
 //
 // Assert Macro
@@ -68,19 +104,8 @@ namespace Debug
 //
 
 #ifndef NDEBUG
-    #define ASSERT_SIMPLE(expression)                         \
-        if(!(expression))                                     \
-        {                                                     \
-            DEBUG_PRINT_ASSERT_SIMPLE(#expression);           \
-            __debugbreak();                                   \
-        }
-
-    #define ASSERT_MESSAGE(expression, message)               \
-        if(!(expression))                                     \
-        {                                                     \
-            DBEUG_PRINT_ASSERT_MESSAGE(#expression, message); \
-            __debugbreak();                                   \
-        }
+    #define ASSERT_SIMPLE(expression) DEBUG_CHECK(expression, nullptr)
+    #define ASSERT_MESSAGE(expression, message) DEBUG_CHECK(expression, message)
 #else
     #define ASSERT_SIMPLE(expression) ((void)0)
     #define ASSERT_MESSAGE(expression, message) ((void)0) 
@@ -106,37 +131,54 @@ namespace Debug
 //      Verify(instance != nullptr, "Invalid instance.");
 //
 
-#ifndef NDEBUG
-    #define VERIFY_SIMPLE(expression)                         \
-        if(!(expression))                                     \
-        {                                                     \
-            DEBUG_PRINT_ASSERT_SIMPLE(#expression);           \
-            __debugbreak();                                   \
-        }
-
-    #define VERIFY_MESSAGE(expression, message)               \
-        if(!(expression))                                     \
-        {                                                     \
-            DBEUG_PRINT_ASSERT_MESSAGE(#expression, message); \
-            __debugbreak();                                   \
-        }
-#else
-    #define VERIFY_SIMPLE(expression)                         \
-        if(!(expression))                                     \
-        {                                                     \
-            DEBUG_PRINT_ASSERT_SIMPLE(#expression);           \
-            __debugbreak();                                   \
-        }
-
-    #define VERIFY_MESSAGE(expression, message)               \
-        if(!(expression))                                     \
-        {                                                     \
-            DBEUG_PRINT_ASSERT_MESSAGE(#expression, message); \
-            __debugbreak();                                   \
-        }
-#endif
+#define VERIFY_SIMPLE(expression) DEBUG_CHECK(expression, nullptr)
+#define VERIFY_MESSAGE(expression, message) DEBUG_CHECK(expression, message)
 
 #define VERIFY_DEDUCE(arg1, arg2, arg3, ...) arg3
 #define VERIFY_CHOOSER(...) DEBUG_EXPAND_MACRO(VERIFY_DEDUCE(__VA_ARGS__, VERIFY_MESSAGE, VERIFY_SIMPLE))
 
 #define Verify(...) DEBUG_EXPAND_MACRO(VERIFY_CHOOSER(__VA_ARGS__)(__VA_ARGS__))
+
+//
+// Profile Macros
+//  Measures CPU time of scopes on the global frame profiler.
+//  Used to find where frame time goes, with the trace written at exit.
+//  Call sites have to include the frame profiler header.
+//
+//  Behaviour in different build types:
+//  - PROFILING defined: Records into the global profiler, if one is set
+//  - Otherwise: Stripped
+//
+//  Usage:
+//      PROFILE_THREAD("Worker");
+//      PROFILE_SCOPE("Update");
+//      PROFILE_FUNCTION();
+//      PROFILE_FRAME();
+//
+
+#define PROFILE_NAME(line) PROFILE_STRING(line)
+#define PROFILE_STRING(line) profileScopeLine ## line
+
+#if defined(PROFILING)
+    #define PROFILE_SCOPE(name) \
+        Graphics::FrameProfiler::CpuScope PROFILE_NAME(__LINE__)(Graphics::FrameProfiler::GetGlobal(), name)
+
+    #define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+
+    #define PROFILE_THREAD(name)                                                    \
+        if(Graphics::FrameProfiler* profiler = Graphics::FrameProfiler::GetGlobal()) \
+        {                                                                           \
+            profiler->NameThread(name);                                             \
+        }
+
+    #define PROFILE_FRAME()                                                         \
+        if(Graphics::FrameProfiler* profiler = Graphics::FrameProfiler::GetGlobal()) \
+        {                                                                           \
+            profiler->MarkFrame();                                                  \
+        }
+#else
+    #define PROFILE_SCOPE(name) ((void)0)
+    #define PROFILE_FUNCTION() ((void)0)
+    #define PROFILE_THREAD(name) ((void)0)
+    #define PROFILE_FRAME() ((void)0)
+#endif
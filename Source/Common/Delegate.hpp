@@ -31,12 +31,24 @@
 //  Implementation based on: http://molecularmusings.wordpress.com/2011/09/19/generic-type-safe-delegates-and-events-in-c/
 //
 
+// Forward declarations.
+template<typename Type>
+class DispatcherBase;
+
+template<typename Type>
+class CompactReceiver;
+
 template<typename Type>
 class Delegate;
 
 template<typename ReturnType, typename... Arguments>
 class Delegate<ReturnType(Arguments...)>
 {
+public:
+    // Friend declarations.
+    friend DispatcherBase<ReturnType(Arguments...)>;
+    friend CompactReceiver<ReturnType(Arguments...)>;
+
 private:
     // Type declarations.
     typedef void* InstancePtr;
@@ -0,0 +1,107 @@
+#include "Precompiled.hpp"
+#include "DispatchProfile.hpp"
+
+DispatchProfile::Sample::Sample(DispatchProfile* profile, const void* function) :
+    m_profile(profile),
+    m_function(function)
+{
+    if(m_profile != nullptr)
+    {
+        m_start = Clock::now();
+    }
+}
+
+DispatchProfile::Sample::~Sample()
+{
+    if(m_profile != nullptr)
+    {
+        std::chrono::duration<double> duration = Clock::now() - m_start;
+        m_profile->Record(m_function, duration.count());
+    }
+}
+
+DispatchProfile::DispatchProfile(std::string name) :
+    m_name(name),
+    m_lastReceiver(0)
+{
+}
+
+DispatchProfile::~DispatchProfile()
+{
+}
+
+void DispatchProfile::Reset()
+{
+    m_receivers.clear();
+    m_lastReceiver = 0;
+}
+
+void DispatchProfile::Record(const void* function, double seconds)
+{
+    // Receivers are usually invoked in the same order,
+    // so start looking after the last recorded one.
+    std::size_t index = m_lastReceiver + 1;
+
+    for(std::size_t i = 0; i < m_receivers.size(); ++i, ++index)
+    {
+        if(index >= m_receivers.size())
+        {
+            index = 0;
+        }
+
+        if(m_receivers[index].function == function)
+            break;
+    }
+
+    // Add statistics of a receiver that has not been recorded yet.
+    if(index >= m_receivers.size() || m_receivers[index].function != function)
+    {
+        ReceiverStats stats;
+        stats.function = function;
+        stats.invocations = 0;
+        stats.seconds = 0.0;
+
+        index = m_receivers.size();
+        m_receivers.push_back(stats);
+    }
+
+    // Accumulate statistics.
+    m_receivers[index].invocations += 1;
+    m_receivers[index].seconds += seconds;
+
+    m_lastReceiver = index;
+}
+
+const std::string& DispatchProfile::GetName() const
+{
+    return m_name;
+}
+
+const DispatchProfile::ReceiverList& DispatchProfile::GetReceivers() const
+{
+    return m_receivers;
+}
+
+std::uint64_t DispatchProfile::GetTotalInvocations() const
+{
+    std::uint64_t invocations = 0;
+
+    for(const ReceiverStats& stats : m_receivers)
+    {
+        invocations += stats.invocations;
+    }
+
+    return invocations;
+}
+
+double DispatchProfile::GetTotalSeconds() const
+{
+    double seconds = 0.0;
+
+    for(const ReceiverStats& stats : m_receivers)
+    {
+        seconds += stats.seconds;
+    }
+
+    return seconds;
+}
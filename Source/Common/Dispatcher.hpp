@@ -2,12 +2,20 @@
 
 #include "Precompiled.hpp"
 #include "Collector.hpp"
+#include "DispatchProfile.hpp"
 #include "Receiver.hpp"
+#include "ThreadOwner.hpp"
 
 // Forward declarations.
 template<typename Type>
 class Receiver;
 
+template<typename Type>
+class ReceiverLink;
+
+template<typename Type>
+class CompactReceiver;
+
 //
 // Dispatcher
 //
@@ -36,6 +44,58 @@ class Receiver;
 //      receiverB.Subscribe(dispatcher);
 //      dispatcher.Dispatch(EventData(/* ... */));
 //
+//  Receivers are kept in an intrusive linked list by default, which makes
+//  subscribing free of allocations, but dispatching has to follow pointers
+//  into every receiver. Dispatchers with many receivers can keep a packed
+//  array of bound functions instead, which is walked linearly. Unsubscribed
+//  entries are left as holes and compacted later, so the order of receivers
+//  is preserved.
+//
+//  Example usage:
+//      Dispatcher<void(const EventData&), CollectDefault<void>, ReceiverStorage::PackedArray> dispatcher;
+//
+//  Packed dispatchers also accept compact receivers, which keep only a link
+//  to their entry and are meant to be embedded in large numbers of objects.
+//  Check CompactReceiver class for details.
+//
+//  Receivers with a higher priority are invoked first, while receivers of
+//  the same priority are invoked in subscription order. A dispatcher can also
+//  have a key function that maps an event to an integer key. Receivers with
+//  a key set only receive events with a matching key and are skipped without
+//  invoking them otherwise, which is cheaper than filtering inside receivers.
+//
+//  Receivers can subscribe, unsubscribe and be destroyed while an event is
+//  being dispatched, including the receiver that is being invoked and other
+//  receivers of the same dispatcher. Unsubscribed receivers are not invoked
+//  afterwards. Receivers subscribed while dispatching are invoked for the
+//  ongoing event if they end up after the invoked receiver. Linked dispatches
+//  track the next receiver of each ongoing dispatch, which is advanced when
+//  that receiver unsubscribes, so no list has to be copied.
+//
+//  Example usage:
+//      int GetEventKey(const EventData& event) { return event.key; }
+//      dispatcher.SetKeyFunction(&GetEventKey);
+//
+//      receiverA.SetKey(42);
+//      receiverA.Subscribe(dispatcher, 10);
+//
+//  Invocations of receivers can be counted and timed by setting a profile.
+//  Check DispatchProfile class for details.
+//
+//  Dispatchers are not thread safe. Builds with thread checks assert when a
+//  thread dispatches, subscribes or unsubscribes while another thread is in
+//  the middle of doing so. Check ThreadOwner class for details.
+//
+
+// Receiver storage types.
+struct ReceiverStorage
+{
+    enum Type
+    {
+        LinkedList,
+        PackedArray,
+    };
+};
 
 // Dispatcher base class.
 template<typename Type>
@@ -45,7 +105,7 @@ template<typename ReturnType, typename... Arguments>
 class DispatcherBase<ReturnType(Arguments...)>
 {
 protected:
-    DispatcherBase();
+    DispatcherBase(ReceiverStorage::Type storage = ReceiverStorage::LinkedList);
     virtual ~DispatcherBase();
 
     // Restores instance to it's original state.
@@ -56,33 +116,111 @@ protected:
     ReturnType Dispatch(Arguments... arguments);
 
 public:
+    // Type declarations.
+    typedef int (*KeyFunction)(Arguments...);
+
+    // Sets a function that maps events to keys of receivers.
+    // Receivers without a key receive all events.
+    void SetKeyFunction(KeyFunction function);
+
+    // Sets a profile that records invocations of receivers.
+    // Profiling is disabled when the profile is nullptr.
+    void SetProfile(DispatchProfile* profile);
+
     // Checks if has any subscribers.
     bool HasSubscribers() const;
 
 private:
-    // Friend declaration.
+    // Friend declarations.
     friend Receiver<ReturnType(Arguments...)>;
+    friend CompactReceiver<ReturnType(Arguments...)>;
+
+    // Type declarations.
+    typedef ReturnType (*FunctionPtr)(void*, Arguments...);
 
-    // Subscribes a receiver.
+    // Subscribes a receiver after receivers of the same or higher priority.
     void Subscribe(Receiver<ReturnType(Arguments...)>& receiver);
 
     // Unsubscribes a receiver.
     void Unsubscribe(Receiver<ReturnType(Arguments...)>& receiver);
 
+    // Updates the packed entry after a subscribed receiver has been bound again or has changed its key.
+    void Rebind(Receiver<ReturnType(Arguments...)>& receiver);
+
+    // Adds a packed entry of a linked receiver after entries of the same or higher priority.
+    void SubscribeEntry(ReceiverLink<ReturnType(Arguments...)>& link, void* instance, FunctionPtr function, int key, int priority);
+
+    // Removes a packed entry of a linked receiver.
+    void UnsubscribeEntry(ReceiverLink<ReturnType(Arguments...)>& link);
+
+    // Changes the key of a packed entry of a linked receiver.
+    void SetEntryKey(ReceiverLink<ReturnType(Arguments...)>& link, int key);
+
+    // Removes holes from packed entries and restores their priority order.
+    void CompactEntries();
+
+private:
+    // Packed receiver entry.
+    struct ReceiverEntry
+    {
+        void* instance;
+        FunctionPtr function;
+        int key;
+        int priority;
+        ReceiverLink<ReturnType(Arguments...)>* receiver;
+    };
+
+    typedef std::vector<ReceiverEntry> EntryList;
+
+    // Position of an ongoing linked dispatch.
+    // Cursors of nested dispatches are chained on the stack.
+    struct DispatchCursor
+    {
+        Receiver<ReturnType(Arguments...)>* next;
+        DispatchCursor* previous;
+    };
+
 private:
+    // Receiver storage type.
+    ReceiverStorage::Type m_storage;
+
+    // Function that maps events to receiver keys.
+    KeyFunction m_keyFunction;
+
+    // Profile of receiver invocations.
+    DispatchProfile* m_profile;
+
     // Double linked list of receivers.
     Receiver<ReturnType(Arguments...)>* m_begin;
     Receiver<ReturnType(Arguments...)>* m_end;
+
+    // Innermost ongoing linked dispatch.
+    DispatchCursor* m_cursors;
+
+    // Packed array of receivers with holes left by unsubscribed ones.
+    EntryList m_entries;
+    int m_entryHoles;
+    bool m_entriesUnsorted;
+
+    // Depth of nested dispatches.
+    int m_dispatchDepth;
+
+#if defined(THREAD_OWNER_CHECKS)
+    // Thread that is dispatching or changing receivers.
+    ThreadOwner m_threadOwner;
+#endif
 };
 
 // Dispatcher class.
-template<typename Type, class Collector = CollectDefault<typename std::function<Type>::result_type>>
+template<typename Type, class Collector = CollectDefault<typename std::function<Type>::result_type>, ReceiverStorage::Type Storage = ReceiverStorage::LinkedList>
 class Dispatcher;
 
-template<typename Collector, typename ReturnType, typename... Arguments>
-class Dispatcher<ReturnType(Arguments...), Collector> : public DispatcherBase<ReturnType(Arguments...)>
+template<typename Collector, ReceiverStorage::Type Storage, typename ReturnType, typename... Arguments>
+class Dispatcher<ReturnType(Arguments...), Collector, Storage> : public DispatcherBase<ReturnType(Arguments...)>
 {
 public:
+    Dispatcher();
+
     // Restores instance to it's original state.
     void Cleanup();
 
@@ -106,6 +244,12 @@ protected:
         Assert(receiver != nullptr, "Receiver is nullptr!");
         return receiver->Receive(std::forward<Arguments>(arguments)...);
     }
+
+    ReturnType Dispatch(ReturnType (*function)(void*, Arguments...), void* instance, Arguments... arguments)
+    {
+        Assert(function != nullptr, "Function is nullptr!");
+        return function(instance, std::forward<Arguments>(arguments)...);
+    }
 };
 
 // Collector invocation for non void return types.
@@ -121,6 +265,11 @@ public:
         Assert(receiver != nullptr, "Receiver is nullptr!");
         return collector(this->Dispatch(receiver, std::forward<Arguments>(arguments)...));
     }
+
+    bool operator()(Collector& collector, ReturnType (*function)(void*, Arguments...), void* instance, Arguments... arguments)
+    {
+        return collector(this->Dispatch(function, instance, std::forward<Arguments>(arguments)...));
+    }
 };
 
 // Collector invocation for void return types.
@@ -134,13 +283,26 @@ public:
         this->Dispatch(receiver, std::forward<Arguments>(arguments)...);
         return collector();
     }
+
+    bool operator()(Collector& collector, void (*function)(void*, Arguments...), void* instance, Arguments... arguments)
+    {
+        this->Dispatch(function, instance, std::forward<Arguments>(arguments)...);
+        return collector();
+    }
 };
 
 // Template definitions.
 template<typename ReturnType, typename... Arguments>
-DispatcherBase<ReturnType(Arguments...)>::DispatcherBase() :
+DispatcherBase<ReturnType(Arguments...)>::DispatcherBase(ReceiverStorage::Type storage) :
+    m_storage(storage),
+    m_keyFunction(nullptr),
+    m_profile(nullptr),
     m_begin(nullptr),
-    m_end(nullptr)
+    m_end(nullptr),
+    m_cursors(nullptr),
+    m_entryHoles(0),
+    m_entriesUnsorted(false),
+    m_dispatchDepth(0)
 {
 }
 
@@ -153,7 +315,23 @@ DispatcherBase<ReturnType(Arguments...)>::~DispatcherBase()
 template<typename ReturnType, typename... Arguments>
 void DispatcherBase<ReturnType(Arguments...)>::Cleanup()
 {
-    // Unsubscribe all receivers.
+    // Unsubscribe all packed receivers.
+    for(ReceiverEntry& entry : m_entries)
+    {
+        if(entry.receiver == nullptr)
+            continue;
+
+        Assert(entry.receiver->m_dispatcher == this, "Receiver's dispatcher is not this dispatcher!");
+
+        entry.receiver->m_dispatcher = nullptr;
+        entry.receiver->m_index = -1;
+    }
+
+    Utility::ClearContainer(m_entries);
+    m_entryHoles = 0;
+    m_entriesUnsorted = false;
+
+    // Unsubscribe all linked receivers.
     Receiver<ReturnType(Arguments...)>* iterator = m_begin;
     
     while(iterator != nullptr)
@@ -173,30 +351,73 @@ void DispatcherBase<ReturnType(Arguments...)>::Cleanup()
     
     m_begin = nullptr;
     m_end = nullptr;
+
+    // Stop ongoing dispatches.
+    for(DispatchCursor* cursor = m_cursors; cursor != nullptr; cursor = cursor->previous)
+    {
+        cursor->next = nullptr;
+    }
 }
 
 template<typename ReturnType, typename... Arguments>
 void DispatcherBase<ReturnType(Arguments...)>::Subscribe(Receiver<ReturnType(Arguments...)>& receiver)
 {
+    THREAD_OWNER_SCOPE(m_threadOwner, "Dispatcher used from multiple threads at the same time!");
+
     Assert(receiver.m_dispatcher == nullptr, "Receiver is already subscribed to another dispatcher!");
     Assert(receiver.m_previous == nullptr, "Receiver's previous list element is not nullptr!");
     Assert(receiver.m_next == nullptr, "Receiver's next list element is not nullptr!");
+    Assert(receiver.m_index == -1, "Receiver's entry index is not invalid!");
+
+    // Add receiver to the packed array.
+    if(m_storage == ReceiverStorage::PackedArray)
+    {
+        this->SubscribeEntry(receiver, receiver.m_instance, receiver.m_function, receiver.m_key, receiver.m_priority);
+        return;
+    }
+
+    // Find the last receiver of the same or higher priority.
+    Receiver<ReturnType(Arguments...)>* previous = m_end;
+
+    while(previous != nullptr && previous->m_priority < receiver.m_priority)
+    {
+        previous = previous->m_previous;
+    }
 
     // Add receiver to the linked list.
-    if(m_begin == nullptr)
+    if(previous == nullptr)
     {
-        Assert(m_end == nullptr, "Linked list's beginning is nullptr but its end is not!");
+        // Adding at the beginning of the list.
+        receiver.m_next = m_begin;
+
+        if(m_begin != nullptr)
+        {
+            m_begin->m_previous = &receiver;
+        }
+        else
+        {
+            Assert(m_end == nullptr, "Linked list's beginning is nullptr but its end is not!");
+            m_end = &receiver;
+        }
 
         m_begin = &receiver;
-        m_end = &receiver;
     }
     else
     {
-        Assert(m_end != nullptr, "Linked list's end is nullptr but its beginning is not!");
+        // Adding after the found receiver.
+        receiver.m_previous = previous;
+        receiver.m_next = previous->m_next;
+
+        if(previous->m_next != nullptr)
+        {
+            previous->m_next->m_previous = &receiver;
+        }
+        else
+        {
+            m_end = &receiver;
+        }
 
-        m_end->m_next = &receiver;
-        receiver.m_previous = m_end;
-        m_end = &receiver;
+        previous->m_next = &receiver;
     }
 
     // Set receiver's members.
@@ -206,7 +427,25 @@ void DispatcherBase<ReturnType(Arguments...)>::Subscribe(Receiver<ReturnType(Arg
 template<typename ReturnType, typename... Arguments>
 void DispatcherBase<ReturnType(Arguments...)>::Unsubscribe(Receiver<ReturnType(Arguments...)>& receiver)
 {
-    Assert(receiver.m_dispatcher != this, "Receiver is not subscribed to this dispatcher!");
+    THREAD_OWNER_SCOPE(m_threadOwner, "Dispatcher used from multiple threads at the same time!");
+
+    Assert(receiver.m_dispatcher == this, "Receiver is not subscribed to this dispatcher!");
+
+    // Remove receiver from the packed array.
+    if(m_storage == ReceiverStorage::PackedArray)
+    {
+        this->UnsubscribeEntry(receiver);
+        return;
+    }
+
+    // Advance ongoing dispatches past the receiver.
+    for(DispatchCursor* cursor = m_cursors; cursor != nullptr; cursor = cursor->previous)
+    {
+        if(cursor->next == &receiver)
+        {
+            cursor->next = receiver.m_next;
+        }
+    }
 
     // Remove receiver from the linked list.
     if(m_begin == &receiver)
@@ -254,51 +493,277 @@ void DispatcherBase<ReturnType(Arguments...)>::Unsubscribe(Receiver<ReturnType(A
     receiver.m_next = nullptr;
 }
 
+template<typename ReturnType, typename... Arguments>
+void DispatcherBase<ReturnType(Arguments...)>::SubscribeEntry(ReceiverLink<ReturnType(Arguments...)>& link, void* instance, FunctionPtr function, int key, int priority)
+{
+    THREAD_OWNER_SCOPE(m_threadOwner, "Dispatcher used from multiple threads at the same time!");
+
+    Assert(m_storage == ReceiverStorage::PackedArray, "Subscribing an entry to a linked dispatcher!");
+    Assert(link.m_dispatcher == nullptr, "Receiver is already subscribed to another dispatcher!");
+    Assert(link.m_index == -1, "Receiver's entry index is not invalid!");
+
+    ReceiverEntry entry;
+    entry.instance = instance;
+    entry.function = function;
+    entry.key = key;
+    entry.priority = priority;
+    entry.receiver = &link;
+
+    link.m_dispatcher = this;
+
+    // Find the position after entries of the same or higher priority.
+    std::size_t index = m_entries.size();
+
+    while(index > 0 && m_entries[index - 1].priority < entry.priority)
+    {
+        --index;
+    }
+
+    if(index == m_entries.size() || m_dispatchDepth != 0)
+    {
+        // Append the entry, as shifting would confuse an ongoing dispatch.
+        // Order is restored once the dispatch finishes.
+        m_entriesUnsorted = m_entriesUnsorted || index != m_entries.size();
+
+        link.m_index = (int)m_entries.size();
+        m_entries.push_back(entry);
+    }
+    else
+    {
+        // Insert the entry and shift indices of the following entries.
+        m_entries.insert(m_entries.begin() + index, entry);
+
+        for(std::size_t i = index; i < m_entries.size(); ++i)
+        {
+            if(m_entries[i].receiver != nullptr)
+            {
+                m_entries[i].receiver->m_index = (int)i;
+            }
+        }
+    }
+}
+
+template<typename ReturnType, typename... Arguments>
+void DispatcherBase<ReturnType(Arguments...)>::UnsubscribeEntry(ReceiverLink<ReturnType(Arguments...)>& link)
+{
+    THREAD_OWNER_SCOPE(m_threadOwner, "Dispatcher used from multiple threads at the same time!");
+
+    Assert(link.m_dispatcher == this, "Receiver is not subscribed to this dispatcher!");
+    Assert(link.m_index >= 0 && link.m_index < (int)m_entries.size(), "Receiver's entry index is out of range!");
+    Assert(m_entries[link.m_index].receiver == &link, "Receiver's entry belongs to another receiver!");
+
+    // Leave a hole that is skipped while dispatching.
+    // Its priority is kept, so entries stay ordered.
+    ReceiverEntry& entry = m_entries[link.m_index];
+    entry.instance = nullptr;
+    entry.function = nullptr;
+    entry.receiver = nullptr;
+
+    ++m_entryHoles;
+
+    link.m_dispatcher = nullptr;
+    link.m_index = -1;
+
+    // Compact entries when holes take up half of the array.
+    if(m_dispatchDepth == 0 && m_entryHoles * 2 >= (int)m_entries.size())
+    {
+        this->CompactEntries();
+    }
+}
+
+template<typename ReturnType, typename... Arguments>
+void DispatcherBase<ReturnType(Arguments...)>::SetEntryKey(ReceiverLink<ReturnType(Arguments...)>& link, int key)
+{
+    Assert(link.m_dispatcher == this, "Receiver is not subscribed to this dispatcher!");
+
+    m_entries[link.m_index].key = key;
+}
+
 template<typename ReturnType, typename... Arguments>
 template<typename Collector>
 ReturnType DispatcherBase<ReturnType(Arguments...)>::Dispatch(Arguments... arguments)
 {
+    THREAD_OWNER_SCOPE(m_threadOwner, "Dispatcher used from multiple threads at the same time!");
+
     // Create a result collector.
     Collector collector;
 
-    // Send an event to all receivers.
-    Receiver<ReturnType(Arguments...)>* receiver = m_begin;
+    // Map the event to a key.
+    const int AnyKey = Receiver<ReturnType(Arguments...)>::AnyKey;
+    int key = m_keyFunction != nullptr ? m_keyFunction(arguments...) : AnyKey;
 
-    while(receiver != nullptr)
+    // Send an event to all packed receivers.
+    if(m_storage == ReceiverStorage::PackedArray)
     {
+        ++m_dispatchDepth;
+
+        // Receivers subscribed while dispatching can reallocate entries.
+        for(std::size_t i = 0; i < m_entries.size(); ++i)
+        {
+            FunctionPtr function = m_entries[i].function;
+            void* instance = m_entries[i].instance;
+            int entryKey = m_entries[i].key;
+
+            if(function == nullptr)
+                continue;
+
+            if(entryKey != AnyKey && entryKey != key)
+                continue;
+
+            // Send an event to a receiver and collect the result.
+            DispatchProfile::Sample sample(m_profile, reinterpret_cast<const void*>(function));
+
+            CollectorInvocation<Collector, ReturnType(Arguments...)> invocation;
+            if(!invocation(collector, function, instance, std::forward<Arguments>(arguments)...))
+                break;
+        }
+
+        --m_dispatchDepth;
+
+        // Compact holes left by receivers unsubscribed while dispatching
+        // and sort receivers subscribed while dispatching.
+        if(m_dispatchDepth == 0)
+        {
+            if(m_entriesUnsorted || (m_entryHoles != 0 && m_entryHoles * 2 >= (int)m_entries.size()))
+            {
+                this->CompactEntries();
+            }
+        }
+
+        return collector.GetResult();
+    }
+
+    // Register the position of this dispatch.
+    DispatchCursor cursor;
+    cursor.next = m_begin;
+    cursor.previous = m_cursors;
+
+    m_cursors = &cursor;
+    ++m_dispatchDepth;
+
+    // Send an event to all linked receivers.
+    while(cursor.next != nullptr)
+    {
+        // Advance before invoking, as the receiver may unsubscribe.
+        Receiver<ReturnType(Arguments...)>* receiver = cursor.next;
+        cursor.next = receiver->m_next;
+
+        // Skip receivers with a different key.
+        if(receiver->m_key != AnyKey && receiver->m_key != key)
+            continue;
+
         // Send an event to a receiver and collect the result.
+        DispatchProfile::Sample sample(m_profile, reinterpret_cast<const void*>(receiver->m_function));
+
         CollectorInvocation<Collector, ReturnType(Arguments...)> invocation;
         if(!invocation(collector, receiver, std::forward<Arguments>(arguments)...))
             break;
-
-        // Advance to the next receiver.
-        receiver = receiver->m_next;
     }
 
+    // Unregister the position of this dispatch.
+    Assert(m_cursors == &cursor, "Dispatches have finished in a wrong order!");
+
+    m_cursors = cursor.previous;
+    --m_dispatchDepth;
+
     // Return collected result.
     return collector.GetResult();
 }
 
+template<typename ReturnType, typename... Arguments>
+void DispatcherBase<ReturnType(Arguments...)>::Rebind(Receiver<ReturnType(Arguments...)>& receiver)
+{
+    Assert(receiver.m_dispatcher == this, "Receiver is not subscribed to this dispatcher!");
+
+    // Copy the new binding into the packed entry.
+    if(m_storage == ReceiverStorage::PackedArray)
+    {
+        ReceiverEntry& entry = m_entries[receiver.m_index];
+        entry.instance = receiver.m_instance;
+        entry.function = receiver.m_function;
+        entry.key = receiver.m_key;
+    }
+}
+
+template<typename ReturnType, typename... Arguments>
+void DispatcherBase<ReturnType(Arguments...)>::CompactEntries()
+{
+    Assert(m_dispatchDepth == 0, "Compacting entries while dispatching!");
+
+    // Move remaining entries over holes while keeping their order.
+    std::size_t count = 0;
+
+    for(std::size_t i = 0; i < m_entries.size(); ++i)
+    {
+        if(m_entries[i].receiver == nullptr)
+            continue;
+
+        m_entries[count] = m_entries[i];
+        m_entries[count].receiver->m_index = (int)count;
+        ++count;
+    }
+
+    m_entries.resize(count);
+    m_entryHoles = 0;
+
+    // Sort entries appended while dispatching.
+    if(m_entriesUnsorted)
+    {
+        std::stable_sort(m_entries.begin(), m_entries.end(), [](const ReceiverEntry& a, const ReceiverEntry& b)
+        {
+            return a.priority > b.priority;
+        });
+
+        for(std::size_t i = 0; i < m_entries.size(); ++i)
+        {
+            m_entries[i].receiver->m_index = (int)i;
+        }
+
+        m_entriesUnsorted = false;
+    }
+}
+
+template<typename ReturnType, typename... Arguments>
+void DispatcherBase<ReturnType(Arguments...)>::SetKeyFunction(KeyFunction function)
+{
+    m_keyFunction = function;
+}
+
+template<typename ReturnType, typename... Arguments>
+void DispatcherBase<ReturnType(Arguments...)>::SetProfile(DispatchProfile* profile)
+{
+    m_profile = profile;
+}
+
 template<typename ReturnType, typename... Arguments>
 bool DispatcherBase<ReturnType(Arguments...)>::HasSubscribers() const
 {
+    if(m_storage == ReceiverStorage::PackedArray)
+        return m_entries.size() != (std::size_t)m_entryHoles;
+
     return m_begin != nullptr;
 }
 
-template<typename Collector, typename ReturnType, typename... Arguments>
-void Dispatcher<ReturnType(Arguments...), Collector>::Cleanup()
+template<typename Collector, ReceiverStorage::Type Storage, typename ReturnType, typename... Arguments>
+Dispatcher<ReturnType(Arguments...), Collector, Storage>::Dispatcher() :
+    DispatcherBase<ReturnType(Arguments...)>(Storage)
+{
+}
+
+template<typename Collector, ReceiverStorage::Type Storage, typename ReturnType, typename... Arguments>
+void Dispatcher<ReturnType(Arguments...), Collector, Storage>::Cleanup()
 {
     DispatcherBase<ReturnType(Arguments...)>::Cleanup();
 }
 
-template<typename Collector, typename ReturnType, typename... Arguments>
-ReturnType Dispatcher<ReturnType(Arguments...), Collector>::Dispatch(Arguments... arguments)
+template<typename Collector, ReceiverStorage::Type Storage, typename ReturnType, typename... Arguments>
+ReturnType Dispatcher<ReturnType(Arguments...), Collector, Storage>::Dispatch(Arguments... arguments)
 {
     return DispatcherBase<ReturnType(Arguments...)>::Dispatch<Collector>(std::forward<Arguments>(arguments)...);
 }
 
-template<typename Collector, typename ReturnType, typename... Arguments>
-ReturnType Dispatcher<ReturnType(Arguments...), Collector>::operator()(Arguments... arguments)
+template<typename Collector, ReceiverStorage::Type Storage, typename ReturnType, typename... Arguments>
+ReturnType Dispatcher<ReturnType(Arguments...), Collector, Storage>::operator()(Arguments... arguments)
 {
     return DispatcherBase<ReturnType(Arguments...)>::Dispatch<Collector>(std::forward<Arguments>(arguments)...);
 }
@@ -0,0 +1,55 @@
+#include "Precompiled.hpp"
+#include "EventBus.hpp"
+
+namespace
+{
+    // Number of registered event types.
+    std::atomic<int> registeredCount(0);
+}
+
+int EventTypes::Register()
+{
+    int identifier = registeredCount.fetch_add(1);
+
+    // Check if we reached the limit.
+    Verify(identifier < MaximumCount, "Reached the maximum number of event types!");
+
+    return identifier;
+}
+
+int EventTypes::GetCount()
+{
+    return registeredCount.load();
+}
+
+EventBus::EventBus()
+{
+    for(DispatcherSlot& slot : m_dispatchers)
+    {
+        slot.dispatcher = nullptr;
+        slot.destroy = nullptr;
+    }
+}
+
+EventBus::~EventBus()
+{
+    this->Cleanup();
+}
+
+void EventBus::Cleanup()
+{
+    // Stop forwarding events of other dispatchers.
+    Utility::ClearContainer(m_forwarders);
+
+    // Destroy dispatchers, which unsubscribes their receivers.
+    for(DispatcherSlot& slot : m_dispatchers)
+    {
+        if(slot.dispatcher != nullptr)
+        {
+            slot.destroy(slot.dispatcher);
+        }
+
+        slot.dispatcher = nullptr;
+        slot.destroy = nullptr;
+    }
+}
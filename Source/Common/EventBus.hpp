@@ -0,0 +1,200 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Dispatcher.hpp"
+#include "Receiver.hpp"
+
+//
+// Event Bus
+//
+//  Holds a dispatcher for every event type, so modules can publish and
+//  receive events without knowing which object owns them. Event types are
+//  assigned small identifiers once on their first use, like component
+//  types, which index a flat array of dispatchers. Publishing and
+//  subscribing are a single array access, without hashing or searching.
+//
+//  Dispatchers are created when the first receiver subscribes to their
+//  type, so publishing events that nobody receives only checks for a null
+//  pointer. Events of existing dispatchers, such as those owned by the
+//  window or the entity system, can be forwarded to the bus. Like a single
+//  dispatcher, the bus has to be used from a single thread.
+//
+//  Example usage:
+//      struct EventData { /* ... */ };
+//
+//      EventBus eventBus;
+//
+//      Receiver<void(const EventData&)> receiver;
+//      receiver.Bind<Class, &Class::Function>(&instance);
+//      eventBus.Subscribe(receiver);
+//
+//      eventBus.Publish(EventData(/* ... */));
+//
+//  Forwarding events of an owned dispatcher:
+//      eventBus.Forward(window.events.keyboardKey);
+//
+
+// Event type registry.
+class EventTypes
+{
+public:
+    // Maximum number of registered event types.
+    static const int MaximumCount = 256;
+
+    // Gets the identifier of an event type.
+    template<typename Type>
+    static int GetIdentifier();
+
+    // Gets the number of registered event types.
+    static int GetCount();
+
+private:
+    // Registers a new event type.
+    static int Register();
+};
+
+// Event bus class.
+class EventBus : private NonCopyable
+{
+public:
+    EventBus();
+    ~EventBus();
+
+    // Restores instance to it's original state.
+    // Unsubscribes all receivers and stops forwarding events.
+    void Cleanup();
+
+    // Subscribes a receiver to events of its type.
+    // Receivers with a higher priority are invoked first.
+    template<typename Event>
+    void Subscribe(Receiver<void(const Event&)>& receiver, int priority = 0);
+
+    // Invokes receivers of an event type.
+    template<typename Event>
+    void Publish(const Event& event);
+
+    // Publishes events of a dispatcher owned by another object.
+    // The dispatcher has to outlive the bus or its cleanup.
+    template<typename Argument>
+    void Forward(DispatcherBase<void(Argument)>& source);
+
+    // Gets the dispatcher of an event type, creating it if needed.
+    template<typename Event>
+    Dispatcher<void(const Event&)>& GetDispatcher();
+
+    // Checks if an event type has any subscribers.
+    template<typename Event>
+    bool HasSubscribers() const;
+
+private:
+    // Type declarations.
+    typedef void (*DestroyFunction)(void*);
+
+    // Dispatcher of an event type with its destructor.
+    struct DispatcherSlot
+    {
+        void* dispatcher;
+        DestroyFunction destroy;
+    };
+
+    // Receiver that forwards events of another dispatcher.
+    struct ForwarderBase
+    {
+        virtual ~ForwarderBase()
+        {
+        }
+    };
+
+    template<typename Argument>
+    struct Forwarder : public ForwarderBase
+    {
+        Receiver<void(Argument)> receiver;
+    };
+
+    // Publishes a forwarded event.
+    template<typename Argument>
+    void ForwardEvent(Argument event);
+
+    // Destroys a dispatcher of an event type.
+    template<typename Event>
+    static void DestroyDispatcher(void* dispatcher);
+
+private:
+    // Dispatchers indexed by event type identifiers.
+    DispatcherSlot m_dispatchers[EventTypes::MaximumCount];
+
+    // Receivers of forwarded dispatchers.
+    std::vector<std::unique_ptr<ForwarderBase>> m_forwarders;
+};
+
+// Template implementations.
+template<typename Type>
+int EventTypes::GetIdentifier()
+{
+    static_assert(std::is_same<Type, typename std::decay<Type>::type>::value, "Event types can't be references or qualified!");
+
+    // Register the type once on the first use.
+    static const int identifier = Register();
+    return identifier;
+}
+
+template<typename Event>
+void EventBus::Subscribe(Receiver<void(const Event&)>& receiver, int priority)
+{
+    receiver.Subscribe(this->GetDispatcher<Event>(), priority);
+}
+
+template<typename Event>
+void EventBus::Publish(const Event& event)
+{
+    // Skip events of types that were never subscribed to.
+    void* dispatcher = m_dispatchers[EventTypes::GetIdentifier<Event>()].dispatcher;
+
+    if(dispatcher == nullptr)
+        return;
+
+    static_cast<Dispatcher<void(const Event&)>*>(dispatcher)->Dispatch(event);
+}
+
+template<typename Argument>
+void EventBus::Forward(DispatcherBase<void(Argument)>& source)
+{
+    std::unique_ptr<Forwarder<Argument>> forwarder(new Forwarder<Argument>());
+    forwarder->receiver.template Bind<EventBus, &EventBus::ForwardEvent<Argument>>(this);
+    forwarder->receiver.Subscribe(source);
+
+    m_forwarders.push_back(std::move(forwarder));
+}
+
+template<typename Event>
+Dispatcher<void(const Event&)>& EventBus::GetDispatcher()
+{
+    DispatcherSlot& slot = m_dispatchers[EventTypes::GetIdentifier<Event>()];
+
+    if(slot.dispatcher == nullptr)
+    {
+        slot.dispatcher = new Dispatcher<void(const Event&)>();
+        slot.destroy = &EventBus::DestroyDispatcher<Event>;
+    }
+
+    return *static_cast<Dispatcher<void(const Event&)>*>(slot.dispatcher);
+}
+
+template<typename Event>
+bool EventBus::HasSubscribers() const
+{
+    void* dispatcher = m_dispatchers[EventTypes::GetIdentifier<Event>()].dispatcher;
+    return dispatcher != nullptr && static_cast<Dispatcher<void(const Event&)>*>(dispatcher)->HasSubscribers();
+}
+
+template<typename Argument>
+void EventBus::ForwardEvent(Argument event)
+{
+    this->Publish<typename std::decay<Argument>::type>(event);
+}
+
+template<typename Event>
+void EventBus::DestroyDispatcher(void* dispatcher)
+{
+    delete static_cast<Dispatcher<void(const Event&)>*>(dispatcher);
+}
@@ -0,0 +1,425 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Dispatcher.hpp"
+#include "Receiver.hpp"
+
+//
+// Event Channel
+//
+//  Carries events from any number of threads to a single consumer thread.
+//  Producers push events without locks into a fixed ring of slots, each of
+//  which has a sequence number that tells whether it is free or published.
+//  When the ring is full, events are pushed onto an overflow list instead
+//  and producers keep using it until the consumer drains it. Producers never
+//  wait for the consumer, which flushes published events to receivers of the
+//  channel.
+//
+//  Events pushed by the same thread keep their order. Overflow events are
+//  stamped with the ring position that was next to be claimed when they were
+//  pushed, and are only dispatched once every ring slot before that position
+//  has been. A slot that is claimed but not yet published holds back later
+//  slots and overflow events until a following flush.
+//
+//  Only pushing is thread safe. Flushing, subscribing receivers to the
+//  channel's dispatcher and cleaning up must happen on the consumer thread.
+//
+//  Example usage:
+//      struct EventData { /* ... */ };
+//
+//      EventChannel<void(const EventData&)> channel;
+//      channel.Initialize(1024);
+//
+//      Receiver<void(const EventData&)> receiver;
+//      receiver.Bind<Class, &Class::Function>(&instance);
+//      receiver.Subscribe(channel.GetDispatcher());
+//
+//      jobSystem.ParallelFor(count, 256, [&](int begin, int end)
+//      {
+//          channel.Push(EventData(/* ... */));
+//      });
+//
+//      channel.Flush();
+//
+
+template<typename Type>
+class EventChannel;
+
+template<typename EventArgument>
+class EventChannel<void(EventArgument)> : private NonCopyable
+{
+public:
+    // Type declarations.
+    typedef typename std::decay<EventArgument>::type EventType;
+    typedef Dispatcher<void(EventArgument)> DispatcherType;
+
+public:
+    EventChannel();
+    ~EventChannel();
+
+    // Restores instance to it's original state.
+    // Queued events are dropped without being dispatched.
+    void Cleanup();
+
+    // Allocates the ring of slots.
+    // Capacity must be a power of two.
+    bool Initialize(std::size_t capacity);
+
+    // Queues an event from any thread.
+    void Push(EventArgument event);
+
+    // Dispatches published events in the order their producers pushed them.
+    // Events behind a slot that has not been published wait for a later flush.
+    // Returns the number of dispatched events.
+    std::size_t Flush();
+
+    // Gets the dispatcher that flushed events are sent to.
+    DispatcherType& GetDispatcher();
+
+    // Gets the number of slots in the ring.
+    std::size_t GetCapacity() const;
+
+    // Gets the number of events that didn't fit into the ring.
+    std::size_t GetOverflowCount() const;
+
+private:
+    // Ring slot.
+    struct Slot
+    {
+        std::atomic<std::size_t> sequence;
+        typename std::aligned_storage<sizeof(EventType), alignof(EventType)>::type storage;
+    };
+
+    // Overflow list node.
+    struct Node
+    {
+        Node* next;
+        std::size_t position;
+        EventType event;
+    };
+
+private:
+    // Pushes an event onto the overflow list.
+    void PushOverflow(EventArgument event);
+
+    // Dispatches published ring slots before a position.
+    // Returns false if a slot that has not been published stops it.
+    bool DispatchRing(std::size_t end, std::size_t& count);
+
+    // Drops all events queued in the ring and the overflow list.
+    void DropEvents();
+
+private:
+    // Ring of slots.
+    std::unique_ptr<Slot[]> m_slots;
+    std::size_t m_capacity;
+
+    // Positions of the next slot to be claimed and consumed.
+    std::atomic<std::size_t> m_enqueue;
+    std::size_t m_dequeue;
+
+    // Events that didn't fit into the ring, pushed in reverse order.
+    std::atomic<Node*> m_overflow;
+    std::atomic<std::size_t> m_overflowCount;
+
+    // Overflow events taken by the consumer, sorted by their positions.
+    std::vector<Node*> m_overflowNodes;
+
+    // Dispatcher of flushed events.
+    DispatcherType m_dispatcher;
+};
+
+// Template implementations.
+template<typename EventArgument>
+EventChannel<void(EventArgument)>::EventChannel() :
+    m_capacity(0),
+    m_enqueue(0),
+    m_dequeue(0),
+    m_overflow(nullptr),
+    m_overflowCount(0)
+{
+}
+
+template<typename EventArgument>
+EventChannel<void(EventArgument)>::~EventChannel()
+{
+    this->Cleanup();
+}
+
+template<typename EventArgument>
+void EventChannel<void(EventArgument)>::Cleanup()
+{
+    // Drop queued events.
+    this->DropEvents();
+
+    // Free the ring.
+    m_slots.reset();
+    m_capacity = 0;
+
+    m_enqueue.store(0, std::memory_order_relaxed);
+    m_dequeue = 0;
+    m_overflowCount.store(0, std::memory_order_relaxed);
+    Utility::ClearContainer(m_overflowNodes);
+
+    // Unsubscribe receivers.
+    m_dispatcher.Cleanup();
+}
+
+template<typename EventArgument>
+bool EventChannel<void(EventArgument)>::Initialize(std::size_t capacity)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(capacity == 0 || (capacity & (capacity - 1)) != 0)
+    {
+        LogError() << "Failed to initialize an event channel! Capacity must be a power of two.";
+        return false;
+    }
+
+    // Allocate the ring with every slot free for its first lap.
+    m_slots.reset(new Slot[capacity]);
+    m_capacity = capacity;
+
+    for(std::size_t i = 0; i < capacity; ++i)
+    {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    // Success!
+    return true;
+}
+
+template<typename EventArgument>
+void EventChannel<void(EventArgument)>::Push(EventArgument event)
+{
+    // Keep using the overflow list until it has been drained.
+    if(m_capacity == 0 || m_overflow.load(std::memory_order_acquire) != nullptr)
+    {
+        this->PushOverflow(event);
+        return;
+    }
+
+    // Claim a free slot.
+    std::size_t position = m_enqueue.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+
+    while(true)
+    {
+        slot = &m_slots[position & (m_capacity - 1)];
+        std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        std::intptr_t difference = (std::intptr_t)sequence - (std::intptr_t)position;
+
+        if(difference == 0)
+        {
+            // Slot is free for this lap.
+            if(m_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if(difference < 0)
+        {
+            // Slot still holds an event from the previous lap.
+            this->PushOverflow(event);
+            return;
+        }
+        else
+        {
+            // Slot has been claimed by another producer.
+            position = m_enqueue.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Publish the event.
+    new (&slot->storage) EventType(event);
+    slot->sequence.store(position + 1, std::memory_order_release);
+}
+
+template<typename EventArgument>
+std::size_t EventChannel<void(EventArgument)>::Flush()
+{
+    std::size_t count = 0;
+
+    // Take the overflow list before the ring, so events that its producers
+    // push to the ring afterwards are claimed past positions of taken nodes.
+    Node* node = m_overflow.exchange(nullptr, std::memory_order_acquire);
+
+    while(node != nullptr)
+    {
+        m_overflowNodes.push_back(node);
+        node = node->next;
+    }
+
+    // Order nodes by their positions, keeping the order they were pushed in.
+    std::reverse(m_overflowNodes.begin(), m_overflowNodes.end());
+    std::stable_sort(m_overflowNodes.begin(), m_overflowNodes.end(), [](const Node* first, const Node* second)
+    {
+        return first->position < second->position;
+    });
+
+    // Dispatch each node after ring slots claimed before it was pushed.
+    std::size_t dispatched = 0;
+    bool stalled = false;
+
+    for(Node* taken : m_overflowNodes)
+    {
+        if(!this->DispatchRing(taken->position, count))
+        {
+            stalled = true;
+            break;
+        }
+
+        m_dispatcher.Dispatch(taken->event);
+        delete taken;
+
+        ++dispatched;
+        ++count;
+    }
+
+    if(stalled)
+    {
+        // Put nodes that are held back at the tail of the list, behind nodes pushed since.
+        Node* first = nullptr;
+        Node* last = nullptr;
+
+        for(std::size_t i = m_overflowNodes.size(); i-- > dispatched;)
+        {
+            Node* held = m_overflowNodes[i];
+            held->next = nullptr;
+
+            if(last != nullptr)
+            {
+                last->next = held;
+            }
+            else
+            {
+                first = held;
+            }
+
+            last = held;
+        }
+
+        Node* head = m_overflow.load(std::memory_order_acquire);
+
+        while(true)
+        {
+            if(head == nullptr)
+            {
+                if(m_overflow.compare_exchange_weak(head, first, std::memory_order_release, std::memory_order_acquire))
+                    break;
+            }
+            else
+            {
+                // Producers only push at the head, so the tail can be appended to.
+                Node* tail = head;
+
+                while(tail->next != nullptr)
+                {
+                    tail = tail->next;
+                }
+
+                tail->next = first;
+                break;
+            }
+        }
+
+        m_overflowNodes.clear();
+        return count;
+    }
+
+    m_overflowNodes.clear();
+
+    // Consume published slots up to the position at this point of the flush.
+    this->DispatchRing(m_enqueue.load(std::memory_order_acquire), count);
+
+    return count;
+}
+
+template<typename EventArgument>
+bool EventChannel<void(EventArgument)>::DispatchRing(std::size_t end, std::size_t& count)
+{
+    while(m_dequeue < end)
+    {
+        Slot* slot = &m_slots[m_dequeue & (m_capacity - 1)];
+
+        if(slot->sequence.load(std::memory_order_acquire) != m_dequeue + 1)
+            return false;
+
+        EventType* event = reinterpret_cast<EventType*>(&slot->storage);
+        m_dispatcher.Dispatch(*event);
+        event->~EventType();
+
+        // Free the slot for the next lap.
+        slot->sequence.store(m_dequeue + m_capacity, std::memory_order_release);
+        ++m_dequeue;
+        ++count;
+    }
+
+    return true;
+}
+
+template<typename EventArgument>
+typename EventChannel<void(EventArgument)>::DispatcherType& EventChannel<void(EventArgument)>::GetDispatcher()
+{
+    return m_dispatcher;
+}
+
+template<typename EventArgument>
+std::size_t EventChannel<void(EventArgument)>::GetCapacity() const
+{
+    return m_capacity;
+}
+
+template<typename EventArgument>
+std::size_t EventChannel<void(EventArgument)>::GetOverflowCount() const
+{
+    return m_overflowCount.load(std::memory_order_relaxed);
+}
+
+template<typename EventArgument>
+void EventChannel<void(EventArgument)>::PushOverflow(EventArgument event)
+{
+    // Stamp the node with the next ring position, which is past every slot
+    // claimed earlier by this thread and not past any slot it claims later.
+    Node* node = new Node{ nullptr, m_enqueue.load(std::memory_order_relaxed), event };
+    m_overflowCount.fetch_add(1, std::memory_order_relaxed);
+
+    // Push the node at the head of the list.
+    Node* head = m_overflow.load(std::memory_order_relaxed);
+
+    do
+    {
+        node->next = head;
+    }
+    while(!m_overflow.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+}
+
+template<typename EventArgument>
+void EventChannel<void(EventArgument)>::DropEvents()
+{
+    // Destroy events left in the ring.
+    if(m_capacity != 0)
+    {
+        std::size_t end = m_enqueue.load(std::memory_order_acquire);
+
+        while(m_dequeue != end)
+        {
+            Slot* slot = &m_slots[m_dequeue & (m_capacity - 1)];
+            Assert(slot->sequence.load(std::memory_order_acquire) == m_dequeue + 1, "Event channel slot has not been published!");
+
+            reinterpret_cast<EventType*>(&slot->storage)->~EventType();
+            slot->sequence.store(m_dequeue + m_capacity, std::memory_order_relaxed);
+            ++m_dequeue;
+        }
+    }
+
+    // Free the overflow list.
+    Node* node = m_overflow.exchange(nullptr, std::memory_order_acquire);
+
+    while(node != nullptr)
+    {
+        Node* next = node->next;
+        delete node;
+        node = next;
+    }
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Dispatcher.hpp"
+#include "Receiver.hpp"
+
+//
+// Event Queue
+//
+//  Defers events until they are flushed at a chosen point of a frame.
+//  Events are copied into a buffer that keeps its memory between frames and
+//  are dispatched to receivers of the queue all at once, instead of being
+//  handled inline by the code that raised them. The queue can subscribe to
+//  another dispatcher to queue its events. Events pushed while flushing are
+//  kept for the next flush.
+//
+//  Example usage:
+//      EventQueue<void(const Window::Events::KeyboardKey&)> queue;
+//      queue.Subscribe(window.events.keyboardKey);
+//
+//      Receiver<void(const Window::Events::KeyboardKey&)> receiver;
+//      receiver.Bind<Class, &Class::OnKeyboardKey>(&instance);
+//      receiver.Subscribe(queue.GetDispatcher());
+//
+//      window.ProcessEvents();
+//      queue.Flush();
+//
+
+template<typename Type>
+class EventQueue;
+
+template<typename EventArgument>
+class EventQueue<void(EventArgument)> : private NonCopyable
+{
+public:
+    // Type declarations.
+    typedef typename std::decay<EventArgument>::type EventType;
+    typedef Dispatcher<void(EventArgument)> DispatcherType;
+
+public:
+    EventQueue() :
+        m_flushing(false)
+    {
+        m_receiver.template Bind<EventQueue, &EventQueue::Push>(this);
+    }
+
+    // Restores instance to it's original state and frees its memory.
+    void Cleanup()
+    {
+        Assert(!m_flushing, "Cleaning up an event queue while flushing!");
+
+        m_receiver.Unsubscribe();
+        m_dispatcher.Cleanup();
+
+        Utility::ClearContainer(m_events);
+        Utility::ClearContainer(m_flushEvents);
+    }
+
+    // Queues events dispatched by another dispatcher.
+    void Subscribe(DispatcherBase<void(EventArgument)>& dispatcher)
+    {
+        m_receiver.Subscribe(dispatcher);
+    }
+
+    // Stops queuing events of the subscribed dispatcher.
+    void Unsubscribe()
+    {
+        m_receiver.Unsubscribe();
+    }
+
+    // Queues an event.
+    void Push(EventArgument event)
+    {
+        m_events.push_back(event);
+    }
+
+    // Dispatches all queued events in the order they were pushed.
+    void Flush()
+    {
+        Assert(!m_flushing, "Flushing an event queue recursively!");
+
+        // Swap buffers, so events pushed while flushing are queued.
+        m_flushEvents.swap(m_events);
+        m_flushing = true;
+
+        for(const EventType& event : m_flushEvents)
+        {
+            m_dispatcher.Dispatch(event);
+        }
+
+        m_flushing = false;
+        m_flushEvents.clear();
+    }
+
+    // Removes all queued events without dispatching them.
+    void Clear()
+    {
+        m_events.clear();
+    }
+
+    // Gets the dispatcher that flushed events are sent to.
+    DispatcherType& GetDispatcher()
+    {
+        return m_dispatcher;
+    }
+
+    // Gets the number of queued events.
+    std::size_t GetSize() const
+    {
+        return m_events.size();
+    }
+
+    // Checks if there are no queued events.
+    bool IsEmpty() const
+    {
+        return m_events.empty();
+    }
+
+private:
+    // Type declarations.
+    typedef std::vector<EventType> EventList;
+
+private:
+    // Receiver of the subscribed dispatcher.
+    Receiver<void(EventArgument)> m_receiver;
+
+    // Dispatcher of flushed events.
+    DispatcherType m_dispatcher;
+
+    // Queued events and events being flushed.
+    EventList m_events;
+    EventList m_flushEvents;
+    bool m_flushing;
+};
@@ -0,0 +1,165 @@
+#include "Precompiled.hpp"
+#include "Fiber.hpp"
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize a fiber! "
+}
+
+Fiber::Fiber() :
+    m_function(nullptr),
+    m_parameter(nullptr),
+#ifdef WIN32
+    m_fiber(nullptr),
+#endif
+    m_thread(false),
+    m_initialized(false)
+{
+}
+
+Fiber::~Fiber()
+{
+    this->Cleanup();
+}
+
+void Fiber::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Release the platform context.
+#ifdef WIN32
+    if(m_thread)
+    {
+        ConvertFiberToThread();
+    }
+    else
+    {
+        DeleteFiber(m_fiber);
+    }
+
+    m_fiber = nullptr;
+#else
+    m_stack.reset();
+#endif
+
+    m_function = nullptr;
+    m_parameter = nullptr;
+    m_thread = false;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool Fiber::Initialize(EntryFunction function, void* parameter, std::size_t stackSize)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(function == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid entry function.";
+        return false;
+    }
+
+    if(stackSize == 0)
+    {
+        LogError() << LogInitializeError() << "Invalid stack size.";
+        return false;
+    }
+
+    m_function = function;
+    m_parameter = parameter;
+
+    // Create the platform context.
+#ifdef WIN32
+    m_fiber = CreateFiber(stackSize, &Fiber::Start, this);
+
+    if(m_fiber == nullptr)
+    {
+        LogError() << LogInitializeError() << "Couldn't create a fiber.";
+        return false;
+    }
+#else
+    if(getcontext(&m_context) != 0)
+    {
+        LogError() << LogInitializeError() << "Couldn't get the context.";
+        return false;
+    }
+
+    m_stack.reset(new char[stackSize]);
+
+    m_context.uc_stack.ss_sp = m_stack.get();
+    m_context.uc_stack.ss_size = stackSize;
+    m_context.uc_link = nullptr;
+
+    // Pass the pointer as two integers, which is what makecontext() supports.
+    std::uintptr_t address = (std::uintptr_t)this;
+    makecontext(&m_context, (void(*)())&Fiber::Start, 2, (unsigned int)((std::uint64_t)address >> 32), (unsigned int)address);
+#endif
+
+    // Success!
+    return m_initialized = true;
+}
+
+bool Fiber::InitializeFromThread()
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Wrap the calling thread.
+    // Its context is captured on the first switch.
+#ifdef WIN32
+    m_fiber = ConvertThreadToFiber(nullptr);
+
+    if(m_fiber == nullptr)
+    {
+        LogError() << LogInitializeError() << "Couldn't convert the thread to a fiber.";
+        return false;
+    }
+#endif
+
+    m_thread = true;
+
+    // Success!
+    return m_initialized = true;
+}
+
+void Fiber::SwitchTo(Fiber& target)
+{
+    Assert(m_initialized && target.m_initialized, "Switching between fibers that are not initialized!");
+    Assert(&target != this, "Switching to the same fiber!");
+
+#ifdef WIN32
+    SwitchToFiber(target.m_fiber);
+#else
+    swapcontext(&m_context, &target.m_context);
+#endif
+}
+
+bool Fiber::IsValid() const
+{
+    return m_initialized;
+}
+
+#ifdef WIN32
+void WINAPI Fiber::Start(void* parameter)
+{
+    Fiber* fiber = (Fiber*)parameter;
+    fiber->m_function(fiber->m_parameter);
+
+    // Returning would end the thread.
+    Verify(false, "Fiber entry function has returned!");
+}
+#else
+void Fiber::Start(unsigned int high, unsigned int low)
+{
+    Fiber* fiber = (Fiber*)(std::uintptr_t)(((std::uint64_t)high << 32) | low);
+    fiber->m_function(fiber->m_parameter);
+
+    // Returning would end the thread, since there is no linked context.
+    Verify(false, "Fiber entry function has returned!");
+}
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+#ifndef WIN32
+    #include <ucontext.h>
+#endif
+
+//
+// Fiber
+//
+//  User mode execution context with its own stack, switched cooperatively.
+//  A thread has to be wrapped in a fiber before it can switch to others.
+//  Fibers can be resumed on any thread, but only one thread may run a fiber
+//  at a time. The entry function must never return, so a fiber ends by
+//  switching to another fiber for the last time.
+//
+//  Example usage:
+//      Fiber thread;
+//      thread.InitializeFromThread();
+//
+//      Fiber fiber;
+//      fiber.Initialize(&Function, &thread, 64 * 1024);
+//
+//      thread.SwitchTo(fiber);
+//
+
+// Fiber class.
+class Fiber : private NonCopyable
+{
+public:
+    // Type declarations.
+    typedef void (*EntryFunction)(void* parameter);
+
+public:
+    Fiber();
+    ~Fiber();
+
+    // Restores instance to its original state.
+    void Cleanup();
+
+    // Creates a fiber that starts at the entry function.
+    bool Initialize(EntryFunction function, void* parameter, std::size_t stackSize);
+
+    // Wraps the calling thread, so it can switch to other fibers.
+    bool InitializeFromThread();
+
+    // Saves the current context into this fiber and switches to another.
+    // Must be called from the thread that is running this fiber.
+    void SwitchTo(Fiber& target);
+
+    // Checks if the fiber has been initialized.
+    bool IsValid() const;
+
+private:
+    // Entry point of created fibers.
+#ifdef WIN32
+    static void WINAPI Start(void* parameter);
+#else
+    static void Start(unsigned int high, unsigned int low);
+#endif
+
+private:
+    // Entry function and its parameter.
+    EntryFunction m_function;
+    void* m_parameter;
+
+    // Platform context.
+#ifdef WIN32
+    void* m_fiber;
+#else
+    ucontext_t m_context;
+    std::unique_ptr<char[]> m_stack;
+#endif
+
+    // Thread wrapping state.
+    bool m_thread;
+
+    // Initialization state.
+    bool m_initialized;
+};
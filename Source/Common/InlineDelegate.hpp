@@ -0,0 +1,194 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Inline Delegate
+//
+//  Owning variant of a delegate that stores a bound functor inside itself.
+//  Functors such as lambdas with captures are moved into an inline buffer of
+//  a fixed capacity, so binding them does not allocate and the delegate can
+//  not outlive them. Functors that do not fit are rejected at compile time.
+//  Moving and destroying the stored functor is type erased behind a single
+//  function pointer. Instances can be moved, but not copied.
+//
+//  Binding and invoking a lambda with captures:
+//      int counter = 0;
+//      InlineDelegate<bool(const char*, int)> delegate;
+//      delegate.Bind([&counter](const char* c, int i) { /*...*/ });
+//      delegate.Invoke("hello", 5);
+//
+//  Binding a static function or an instance method works the same as with
+//  a regular delegate and does not store anything in the buffer.
+//
+
+template<typename Type, std::size_t Capacity = 32>
+class InlineDelegate;
+
+template<typename ReturnType, typename... Arguments, std::size_t Capacity>
+class InlineDelegate<ReturnType(Arguments...), Capacity>
+{
+private:
+    // Type declarations.
+    typedef typename std::aligned_storage<Capacity, alignof(std::max_align_t)>::type StorageType;
+
+    typedef ReturnType (*FunctionPtr)(void*, Arguments...);
+    typedef void (*ManagerPtr)(void*, void*);
+
+    // Compile time invocation stubs.
+    template<ReturnType (*Function)(Arguments...)>
+    static ReturnType FunctionStub(void* storage, Arguments... arguments)
+    {
+        return (Function)(std::forward<Arguments>(arguments)...);
+    }
+
+    template<class FunctorType>
+    static ReturnType FunctorStub(void* storage, Arguments... arguments)
+    {
+        return (*static_cast<FunctorType*>(storage))(std::forward<Arguments>(arguments)...);
+    }
+
+    template<class InstanceType, ReturnType (InstanceType::*Function)(Arguments...)>
+    static ReturnType MethodStub(void* storage, Arguments... arguments)
+    {
+        InstanceType* instance = *static_cast<InstanceType**>(storage);
+        return (instance->*Function)(std::forward<Arguments>(arguments)...);
+    }
+
+    // Moves a stored functor into another storage if a destination is given,
+    // then destroys it in the source storage.
+    template<class FunctorType>
+    static void FunctorManager(void* source, void* destination)
+    {
+        FunctorType* functor = static_cast<FunctorType*>(source);
+
+        if(destination != nullptr)
+        {
+            new (destination) FunctorType(std::move(*functor));
+        }
+
+        functor->~FunctorType();
+    }
+
+public:
+    InlineDelegate() :
+        m_function(nullptr),
+        m_manager(nullptr)
+    {
+    }
+
+    ~InlineDelegate()
+    {
+        this->Cleanup();
+    }
+
+    InlineDelegate(InlineDelegate&& other) :
+        InlineDelegate()
+    {
+        *this = std::move(other);
+    }
+
+    InlineDelegate& operator=(InlineDelegate&& other)
+    {
+        if(this == &other)
+            return *this;
+
+        this->Cleanup();
+
+        if(other.m_manager != nullptr)
+        {
+            other.m_manager(&other.m_storage, &m_storage);
+        }
+        else
+        {
+            m_storage = other.m_storage;
+        }
+
+        m_function = other.m_function;
+        m_manager = other.m_manager;
+
+        other.m_function = nullptr;
+        other.m_manager = nullptr;
+
+        return *this;
+    }
+
+    InlineDelegate(const InlineDelegate&) = delete;
+    InlineDelegate& operator=(const InlineDelegate&) = delete;
+
+    // Destroys the stored functor and unbinds the delegate.
+    void Cleanup()
+    {
+        if(m_manager != nullptr)
+        {
+            m_manager(&m_storage, nullptr);
+        }
+
+        m_function = nullptr;
+        m_manager = nullptr;
+    }
+
+    // Binds a static function.
+    template<ReturnType (*Function)(Arguments...)>
+    void Bind()
+    {
+        this->Cleanup();
+
+        m_function = &FunctionStub<Function>;
+    }
+
+    // Binds a functor object by moving or copying it into the delegate.
+    template<class Functor>
+    void Bind(Functor&& functor)
+    {
+        typedef typename std::decay<Functor>::type FunctorType;
+
+        static_assert(sizeof(FunctorType) <= Capacity, "Functor does not fit in the inline delegate storage!");
+        static_assert(alignof(FunctorType) <= alignof(StorageType), "Functor alignment exceeds the inline delegate storage!");
+        static_assert(!std::is_same<FunctorType, InlineDelegate>::value, "Binding an inline delegate to itself!");
+
+        this->Cleanup();
+
+        new (&m_storage) FunctorType(std::forward<Functor>(functor));
+
+        m_function = &FunctorStub<FunctorType>;
+        m_manager = &FunctorManager<FunctorType>;
+    }
+
+    // Binds an instance method.
+    template<class InstanceType, ReturnType (InstanceType::*Function)(Arguments...)>
+    void Bind(InstanceType* instance)
+    {
+        Assert(instance != nullptr, "Method instance is nullptr!");
+
+        this->Cleanup();
+
+        *reinterpret_cast<InstanceType**>(&m_storage) = instance;
+        m_function = &MethodStub<InstanceType, Function>;
+    }
+
+    // Invokes the delegate.
+    ReturnType Invoke(Arguments... arguments)
+    {
+        Assert(m_function != nullptr, "Attempting to invoke a delegate without a bound function!");
+
+        if(m_function == nullptr)
+            return ReturnType();
+
+        return m_function(&m_storage, std::forward<Arguments>(arguments)...);
+    }
+
+    // Checks if the delegate has a bound function.
+    bool IsBound() const
+    {
+        return m_function != nullptr;
+    }
+
+private:
+    // Inline functor storage.
+    StorageType m_storage;
+
+    // Function pointers.
+    FunctionPtr m_function;
+    ManagerPtr m_manager;
+};
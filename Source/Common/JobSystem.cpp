@@ -0,0 +1,960 @@
+#include "Precompiled.hpp"
+#include "JobSystem.hpp"
+#include "CpuTopology.hpp"
+#include "System/Clock.hpp"
+
+#if defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize the job system! "
+
+    // Job system and participant index of the current thread.
+    thread_local const JobSystem* currentJobSystem = nullptr;
+    thread_local int currentParticipant = -1;
+
+    // Fiber actions finished after switching away from a fiber.
+    struct FiberAction
+    {
+        enum Type
+        {
+            None,
+            Wait,
+            Release,
+        };
+    };
+
+    // Fiber switch state of the current thread.
+    struct FiberSwitch
+    {
+        int action;
+        Fiber* fiber;
+        JobCounter* counter;
+    };
+
+    thread_local Fiber* currentFiber = nullptr;
+    thread_local Fiber* currentThreadFiber = nullptr;
+    thread_local FiberSwitch currentSwitch = { FiberAction::None, nullptr, nullptr };
+
+    // Mask of indices in job pools and deques.
+    const unsigned int JobMask = JobSystem::MaximumJobs - 1;
+
+    static_assert((JobSystem::MaximumJobs & JobMask) == 0, "Maximum number of jobs must be a power of two!");
+}
+
+JobSystemInfo::JobSystemInfo() :
+    workerCount(-1),
+    pinThreads(false),
+    arenaSize(0),
+    fiberCount(0),
+    fiberStackSize(256 * 1024)
+{
+}
+
+JobCounter::JobCounter() :
+    m_value(0)
+{
+}
+
+JobCounter::~JobCounter()
+{
+    Assert(m_value.load() == 0, "Destroying a job counter with unfinished jobs!");
+}
+
+bool JobCounter::IsDone() const
+{
+    return m_value.load(std::memory_order_acquire) == 0;
+}
+
+int JobCounter::GetValue() const
+{
+    return m_value.load(std::memory_order_acquire);
+}
+
+JobSystem::JobDeque::JobDeque() :
+    m_top(0),
+    m_bottom(0),
+    m_jobs(new std::atomic<Job*>[MaximumJobs])
+{
+    for(int i = 0; i < MaximumJobs; ++i)
+    {
+        m_jobs[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+void JobSystem::JobDeque::Push(Job* job)
+{
+    // Deque can't overflow, because every job in it occupies a slot of the owner's pool.
+    std::int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+
+    m_jobs[bottom & JobMask].store(job, std::memory_order_relaxed);
+
+    // Publish the job before making it visible to thieves.
+    m_bottom.store(bottom + 1, std::memory_order_release);
+}
+
+JobSystem::Job* JobSystem::JobDeque::Pop()
+{
+    // Reserve the bottom element before checking the top.
+    std::int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    std::int64_t top = m_top.load(std::memory_order_relaxed);
+
+    if(top > bottom)
+    {
+        // Deque is empty.
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = m_jobs[bottom & JobMask].load(std::memory_order_relaxed);
+
+    if(top == bottom)
+    {
+        // Race with thieves for the last element.
+        if(!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            job = nullptr;
+        }
+
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+JobSystem::Job* JobSystem::JobDeque::Steal()
+{
+    std::int64_t top = m_top.load(std::memory_order_acquire);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    std::int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+    if(top >= bottom)
+        return nullptr;
+
+    // Claim the top element unless another thread has taken it.
+    Job* job = m_jobs[top & JobMask].load(std::memory_order_relaxed);
+
+    if(!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+
+    return job;
+}
+
+JobSystem::Job::Job() :
+    counter(nullptr),
+    used(false),
+    allocated(false)
+{
+}
+
+JobSystem::JobSystem() :
+    m_participantCount(0),
+    m_pendingJobs(0),
+    m_fiberCount(0),
+    m_waitingFiberCount(0),
+    m_arenaSize(0),
+    m_startedWorkers(0),
+    m_sleepingWorkers(0),
+    m_exit(false),
+    m_initialized(false)
+{
+}
+
+JobSystem::~JobSystem()
+{
+    this->Cleanup();
+}
+
+void JobSystem::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Run remaining jobs and let workers resume waiting fibers.
+    int participant = this->GetParticipantIndex();
+
+    while(m_pendingJobs.load() > 0 || m_waitingFiberCount.load() > 0)
+    {
+        Job* job = this->RetrieveJob(participant);
+
+        if(job != nullptr)
+        {
+            this->ExecuteJob(job);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    // Wake up and join worker threads.
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_exit = true;
+    }
+
+    m_sleepCondition.notify_all();
+
+    for(std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+
+    Utility::ClearContainer(m_workers);
+
+    // Release participant states.
+    m_participants.reset();
+    m_participantCount = 0;
+
+    // Release fibers.
+    Utility::ClearContainer(m_freeFibers);
+    Utility::ClearContainer(m_waitingFibers);
+    m_fibers.reset();
+    m_fiberCount = 0;
+    m_waitingFiberCount = 0;
+
+    Utility::ClearContainer(m_sharedJobs);
+
+    m_pendingJobs = 0;
+    m_arenaSize = 0;
+    m_startedWorkers = 0;
+    m_sleepingWorkers = 0;
+    m_exit = false;
+
+    // Stop treating the calling thread as a participant.
+    if(currentJobSystem == this)
+    {
+        currentJobSystem = nullptr;
+        currentParticipant = -1;
+    }
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool JobSystem::Initialize(const JobSystemInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            m_initialized = true;
+            this->Cleanup();
+        }
+    );
+
+    // Determine the number of worker threads.
+    int workerCount = info.workerCount;
+
+    if(workerCount < 0)
+    {
+        workerCount = std::max((int)std::thread::hardware_concurrency() - 1, 0);
+    }
+
+    workerCount = std::min(workerCount, MaximumParticipants - 1);
+
+    // Validate the number of fibers.
+    // Every worker needs a fiber to run on and another one to switch to.
+    if(info.fiberCount < 0 || (info.fiberCount > 0 && info.fiberCount <= workerCount))
+    {
+        LogError() << LogInitializeError() << "Invalid number of fibers.";
+        return false;
+    }
+
+    // Create the pool of fibers.
+    // Fibers are only used when there are worker threads.
+    if(info.fiberCount > 0 && workerCount > 0)
+    {
+        m_fiberCount = info.fiberCount;
+        m_fibers.reset(new Fiber[m_fiberCount]);
+
+        for(int i = 0; i < m_fiberCount; ++i)
+        {
+            if(!m_fibers[i].Initialize(&JobSystem::FiberMain, this, info.fiberStackSize))
+            {
+                LogError() << LogInitializeError() << "Couldn't create a fiber.";
+                return false;
+            }
+
+            m_freeFibers.push_back(&m_fibers[i]);
+        }
+    }
+
+    // Create states of every thread including the calling one.
+    // Their memory is allocated later by the thread of each participant.
+    m_participantCount = workerCount + 1;
+    m_participants.reset(new Participant[m_participantCount]);
+    m_arenaSize = info.arenaSize;
+
+    // Place participants on processors of the detected topology.
+    CpuTopology topology;
+
+    if(info.pinThreads)
+    {
+        topology.Detect();
+    }
+
+    const CpuTopology::ProcessorList& processors = topology.GetProcessors();
+    CpuTopology::IndexList placement = topology.CalculatePlacement();
+
+    for(int i = 0; i < m_participantCount; ++i)
+    {
+        Participant& participant = m_participants[i];
+        participant.jobCursor = 0;
+        participant.stealSeed = 2654435761u * (i + 1);
+        participant.processor = -1;
+        participant.node = 0;
+        participant.idleTicks.store(0, std::memory_order_relaxed);
+        participant.sleepTicks.store(0, std::memory_order_relaxed);
+
+        if(!placement.empty())
+        {
+            const CpuTopology::Processor& processor = processors[placement[i % placement.size()]];
+            participant.processor = processor.index;
+            participant.node = processor.node;
+        }
+    }
+
+    // Order other participants by preference, with those on the same node first.
+    // Each list starts after the participant, so neighbors are tried in turn.
+    for(int i = 0; i < m_participantCount; ++i)
+    {
+        Participant& participant = m_participants[i];
+
+        for(int sameNode = 1; sameNode >= 0; --sameNode)
+        {
+            for(int j = 1; j < m_participantCount; ++j)
+            {
+                int other = (i + j) % m_participantCount;
+
+                if((m_participants[other].node == participant.node) == (sameNode != 0))
+                {
+                    participant.victims.push_back(other);
+                }
+            }
+
+            if(sameNode != 0)
+            {
+                participant.nodeVictimCount = (int)participant.victims.size();
+            }
+        }
+    }
+
+    // Make the calling thread the first participant.
+    currentJobSystem = this;
+    currentParticipant = 0;
+
+    if(m_participants[0].processor >= 0)
+    {
+        PinThread(m_participants[0].processor);
+    }
+
+    this->InitializeParticipant(0);
+
+    // Start worker threads and wait until they have allocated their states.
+    for(int i = 0; i < workerCount; ++i)
+    {
+        m_workers.emplace_back(&JobSystem::WorkerMain, this, i + 1);
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_startMutex);
+        m_startCondition.wait(lock, [&]() { return m_startedWorkers == workerCount; });
+    }
+
+    // Success!
+    return m_initialized = true;
+}
+
+void JobSystem::Schedule(JobFunction function, JobCounter* counter)
+{
+    Assert(function != nullptr, "Scheduling a job without a function!");
+
+    // Run the job right away if there are no workers.
+    if(!m_initialized)
+    {
+        function();
+        return;
+    }
+
+    int participant = this->GetParticipantIndex();
+
+    if(participant != -1)
+    {
+        // Take the next job from the pool of the participant.
+        Participant& state = m_participants[participant];
+        Job* job = &state.jobs[state.jobCursor & JobMask];
+
+        if(job->used.load(std::memory_order_acquire))
+        {
+            // Run the job right away if the pool is full.
+            function();
+            return;
+        }
+
+        state.jobCursor += 1;
+
+        if(counter != nullptr)
+        {
+            counter->m_value.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        job->function = std::move(function);
+        job->counter = counter;
+        job->used.store(true, std::memory_order_relaxed);
+
+        // Push the job to the deque of the participant.
+        state.deque->Push(job);
+    }
+    else
+    {
+        // Allocate the job and add it to the shared queue.
+        Job* job = new Job;
+        job->function = std::move(function);
+        job->counter = counter;
+        job->used.store(true, std::memory_order_relaxed);
+        job->allocated = true;
+
+        if(counter != nullptr)
+        {
+            counter->m_value.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::lock_guard<std::mutex> lock(m_sharedMutex);
+        m_sharedJobs.push_back(job);
+    }
+
+    // Wake up a worker for the job.
+    m_pendingJobs.fetch_add(1);
+    this->NotifyWorker();
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+    // Park the fiber of the calling job and continue on a free one.
+    // Resumes here, possibly on another thread, once the counter reaches zero.
+    if(currentFiber != nullptr && currentJobSystem == this && !counter.IsDone())
+    {
+        Fiber* fiber = this->AcquireFiber();
+
+        if(fiber != nullptr)
+        {
+            m_waitingFiberCount.fetch_add(1);
+            this->SwitchFiber(fiber, FiberAction::Wait, &counter);
+
+            Assert(counter.IsDone(), "Fiber resumed before its counter has reached zero!");
+            return;
+        }
+    }
+
+    int participant = this->GetParticipantIndex();
+
+    // Run other jobs until the counter reaches zero.
+    while(!counter.IsDone())
+    {
+        Job* job = m_initialized ? this->RetrieveJob(participant) : nullptr;
+
+        if(job != nullptr)
+        {
+            this->ExecuteJob(job);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::ParallelFor(int count, int grainSize, const RangeFunction& function)
+{
+    Assert(grainSize > 0, "Grain size must be positive!");
+
+    if(count <= 0)
+        return;
+
+    // Run on the calling thread if there is nothing to share.
+    if(!m_initialized || m_workers.empty() || count <= grainSize)
+    {
+        function(0, count);
+        return;
+    }
+
+    // Split chunks into contiguous partitions.
+    // Task lives on the stack of the caller until all of its helpers have finished,
+    // so concurrent calls never share cursors.
+    int chunkCount = (count + grainSize - 1) / grainSize;
+
+    Task task;
+    task.function = &function;
+    task.count = count;
+    task.grainSize = grainSize;
+    task.partitionCount = m_participantCount;
+
+    for(int i = 0; i < task.partitionCount; ++i)
+    {
+        Partition& partition = task.partitions[i];
+        partition.cursor.store((int)((long long)chunkCount * i / task.partitionCount), std::memory_order_relaxed);
+        partition.end = (int)((long long)chunkCount * (i + 1) / task.partitionCount);
+    }
+
+    // Schedule jobs that help with the range.
+    // Each one starts with the partition of the thread that runs it.
+    JobCounter counter;
+    int helperCount = std::min(m_participantCount, chunkCount) - 1;
+
+    for(int i = 0; i < helperCount; ++i)
+    {
+        this->Schedule([this, &task]()
+        {
+            this->ExecuteTask(task, std::max(this->GetParticipantIndex(), 0));
+        }, &counter);
+    }
+
+    // Take part in the work and wait for helpers.
+    this->ExecuteTask(task, std::max(this->GetParticipantIndex(), 0));
+    this->Wait(counter);
+}
+
+int JobSystem::GetWorkerCount() const
+{
+    return (int)m_workers.size();
+}
+
+int JobSystem::GetParticipantIndex() const
+{
+    return currentJobSystem == this ? currentParticipant : -1;
+}
+
+int JobSystem::GetParticipantNode(int participant) const
+{
+    Assert(participant >= 0 && participant < m_participantCount, "Invalid participant index!");
+
+    return m_participants[participant].node;
+}
+
+std::uint64_t JobSystem::GetIdleTicks(int participant) const
+{
+    Assert(participant >= 0 && participant < m_participantCount, "Invalid participant index!");
+
+    const Participant& state = m_participants[participant];
+    std::uint64_t idleTicks = state.idleTicks.load(std::memory_order_relaxed);
+    std::uint64_t sleepTicks = state.sleepTicks.load(std::memory_order_relaxed);
+
+    // Count the current sleep, which is only added once the participant wakes up.
+    if(sleepTicks != 0)
+    {
+        std::uint64_t ticks = System::Clock::ReadTicks();
+        idleTicks += ticks > sleepTicks ? ticks - sleepTicks : 0;
+    }
+
+    return idleTicks;
+}
+
+LinearArena* JobSystem::GetArena()
+{
+    int participant = this->GetParticipantIndex();
+
+    if(participant == -1 || m_arenaSize == 0)
+        return nullptr;
+
+    return &m_participants[participant].arena;
+}
+
+void JobSystem::ResetArenas()
+{
+    if(m_arenaSize == 0)
+        return;
+
+    for(int i = 0; i < m_participantCount; ++i)
+    {
+        m_participants[i].arena.Reset();
+    }
+}
+
+void JobSystem::WorkerMain(int participant)
+{
+    currentJobSystem = this;
+    currentParticipant = participant;
+
+    if(m_participants[participant].processor >= 0)
+    {
+        PinThread(m_participants[participant].processor);
+    }
+
+    // Allocate the state after pinning, so its memory is placed on the node of the thread.
+    this->InitializeParticipant(participant);
+
+    // Wait until every worker has allocated its state before touching states of others.
+    {
+        std::unique_lock<std::mutex> lock(m_startMutex);
+        m_startedWorkers += 1;
+        m_startCondition.notify_all();
+        m_startCondition.wait(lock, [this]() { return m_startedWorkers == m_participantCount - 1; });
+    }
+
+    if(m_fibers == nullptr)
+    {
+        this->RunWorkerLoop();
+        return;
+    }
+
+    // Run the worker loop on a fiber.
+    // The last fiber to exit on this thread switches back to it.
+    Fiber threadFiber;
+    Verify(threadFiber.InitializeFromThread(), "Couldn't convert a worker thread to a fiber!");
+
+    Fiber* fiber = this->AcquireFiber();
+    Verify(fiber != nullptr, "Ran out of fibers for worker threads!");
+
+    currentFiber = &threadFiber;
+    currentThreadFiber = &threadFiber;
+
+    this->SwitchFiber(fiber, FiberAction::None, nullptr);
+
+    currentFiber = nullptr;
+    currentThreadFiber = nullptr;
+}
+
+void JobSystem::InitializeParticipant(int participant)
+{
+    Participant& state = m_participants[participant];
+    state.deque.reset(new JobDeque);
+    state.jobs.reset(new Job[MaximumJobs]);
+
+    if(m_arenaSize > 0)
+    {
+        LinearArenaInfo arenaInfo;
+        arenaInfo.blockSize = m_arenaSize;
+
+        Verify(state.arena.Initialize(arenaInfo), "Couldn't initialize an arena of a participant!");
+    }
+}
+
+void JobSystem::RunWorkerLoop()
+{
+    while(true)
+    {
+        // Resume a waiting fiber whose jobs have finished.
+        // The current fiber returns to the pool and continues this loop when reused.
+        if(currentFiber != nullptr)
+        {
+            Fiber* fiber = this->TakeReadyFiber();
+
+            if(fiber != nullptr)
+            {
+                this->SwitchFiber(fiber, FiberAction::Release, nullptr);
+                continue;
+            }
+        }
+
+        // Run available jobs.
+        // The participant index is read on every iteration, since fibers can move between threads.
+        Job* job = this->RetrieveJob(this->GetParticipantIndex());
+
+        if(job != nullptr)
+        {
+            this->ExecuteJob(job);
+            continue;
+        }
+
+        // Sleep until a job is scheduled or a waiting fiber can be resumed.
+        // Sleeping workers are counted before checking for work, so work
+        // that appears in the meantime always wakes up a worker.
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+
+        // Time spent sleeping is accounted as idle for utilization.
+        Participant& state = m_participants[this->GetParticipantIndex()];
+        state.sleepTicks.store(System::Clock::ReadTicks(), std::memory_order_relaxed);
+
+        m_sleepingWorkers.fetch_add(1);
+        m_sleepCondition.wait(lock, [this]() { return m_exit || m_pendingJobs.load() > 0 || this->HasReadyFiber(); });
+        m_sleepingWorkers.fetch_sub(1);
+
+        std::uint64_t sleepTicks = state.sleepTicks.exchange(0, std::memory_order_relaxed);
+        state.idleTicks.fetch_add(System::Clock::ReadTicks() - sleepTicks, std::memory_order_relaxed);
+
+        // Exit once no fiber is left waiting.
+        if(m_exit && m_waitingFiberCount.load() == 0)
+            return;
+    }
+}
+
+void JobSystem::SwitchFiber(Fiber* target, int action, JobCounter* counter)
+{
+    Fiber* previous = currentFiber;
+
+    // Let the next fiber finish the action once the previous one
+    // is no longer running, so no other thread can resume it early.
+    currentSwitch.action = action;
+    currentSwitch.fiber = previous;
+    currentSwitch.counter = counter;
+    currentFiber = target;
+
+    previous->SwitchTo(*target);
+
+    // Resumed, possibly on another thread.
+    this->FinishFiberSwitch();
+}
+
+void JobSystem::FinishFiberSwitch()
+{
+    FiberSwitch finished = currentSwitch;
+    currentSwitch.action = FiberAction::None;
+    currentSwitch.fiber = nullptr;
+    currentSwitch.counter = nullptr;
+
+    switch(finished.action)
+    {
+    case FiberAction::Wait:
+        {
+            std::lock_guard<std::mutex> lock(m_fiberMutex);
+            m_waitingFibers.push_back({ finished.fiber, finished.counter });
+        }
+        break;
+
+    case FiberAction::Release:
+        {
+            std::lock_guard<std::mutex> lock(m_fiberMutex);
+            m_freeFibers.push_back(finished.fiber);
+        }
+        break;
+    }
+}
+
+Fiber* JobSystem::AcquireFiber()
+{
+    std::lock_guard<std::mutex> lock(m_fiberMutex);
+
+    if(m_freeFibers.empty())
+        return nullptr;
+
+    Fiber* fiber = m_freeFibers.back();
+    m_freeFibers.pop_back();
+
+    return fiber;
+}
+
+Fiber* JobSystem::TakeReadyFiber()
+{
+    if(m_waitingFiberCount.load() == 0)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(m_fiberMutex);
+
+    for(std::size_t i = 0; i < m_waitingFibers.size(); ++i)
+    {
+        if(m_waitingFibers[i].counter->IsDone())
+        {
+            Fiber* fiber = m_waitingFibers[i].fiber;
+
+            m_waitingFibers[i] = m_waitingFibers.back();
+            m_waitingFibers.pop_back();
+            m_waitingFiberCount.fetch_sub(1);
+
+            return fiber;
+        }
+    }
+
+    return nullptr;
+}
+
+bool JobSystem::HasReadyFiber()
+{
+    if(m_waitingFiberCount.load() == 0)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_fiberMutex);
+
+    for(const WaitingFiber& waiting : m_waitingFibers)
+    {
+        if(waiting.counter->IsDone())
+            return true;
+    }
+
+    return false;
+}
+
+void JobSystem::FiberMain(void* parameter)
+{
+    JobSystem* jobSystem = (JobSystem*)parameter;
+
+    // Finish the switch that started this fiber.
+    jobSystem->FinishFiberSwitch();
+
+    // Run jobs until the job system exits.
+    jobSystem->RunWorkerLoop();
+
+    // Return to the thread that is running this fiber for the last time.
+    // The fiber is not released, because jobs still running on other
+    // workers could otherwise resume it past the end of its loop.
+    jobSystem->SwitchFiber(currentThreadFiber, FiberAction::None, nullptr);
+}
+
+JobSystem::Job* JobSystem::RetrieveJob(int participant)
+{
+    if(m_pendingJobs.load(std::memory_order_relaxed) <= 0)
+        return nullptr;
+
+    Job* job = nullptr;
+
+    // Pop the most recent job of the participant.
+    if(participant != -1)
+    {
+        job = m_participants[participant].deque->Pop();
+    }
+
+    // Steal the oldest job of another participant, starting at a random one.
+    // Participants steal from others on their own node before crossing over to other nodes.
+    if(job == nullptr)
+    {
+        if(participant != -1)
+        {
+            Participant& state = m_participants[participant];
+
+            unsigned int& seed = state.stealSeed;
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+
+            int groupEnds[2] = { state.nodeVictimCount, (int)state.victims.size() };
+            int groupBegin = 0;
+
+            for(int groupEnd : groupEnds)
+            {
+                int groupSize = groupEnd - groupBegin;
+
+                for(int i = 0; i < groupSize && job == nullptr; ++i)
+                {
+                    int victim = state.victims[groupBegin + (int)((seed + (unsigned int)i) % (unsigned int)groupSize)];
+                    job = m_participants[victim].deque->Steal();
+                }
+
+                groupBegin = groupEnd;
+            }
+        }
+        else
+        {
+            for(int victim = 0; victim < m_participantCount && job == nullptr; ++victim)
+            {
+                job = m_participants[victim].deque->Steal();
+            }
+        }
+    }
+
+    // Take a job scheduled by a thread that doesn't participate.
+    if(job == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(m_sharedMutex);
+
+        if(!m_sharedJobs.empty())
+        {
+            job = m_sharedJobs.front();
+            m_sharedJobs.pop_front();
+        }
+    }
+
+    if(job != nullptr)
+    {
+        m_pendingJobs.fetch_sub(1);
+    }
+
+    return job;
+}
+
+void JobSystem::ExecuteJob(Job* job)
+{
+    Assert(job->used.load(std::memory_order_relaxed), "Executing a job that is not in use!");
+
+    job->function();
+
+    // Release the job before its counter, so the waiting
+    // thread can't destroy the counter while it's being used.
+    JobCounter* counter = job->counter;
+    job->function = nullptr;
+
+    if(job->allocated)
+    {
+        delete job;
+    }
+    else
+    {
+        job->used.store(false, std::memory_order_release);
+    }
+
+    if(counter != nullptr)
+    {
+        // Wake up a worker that can resume a fiber waiting for the counter.
+        if(counter->m_value.fetch_sub(1, std::memory_order_acq_rel) == 1 && m_waitingFiberCount.load() > 0)
+        {
+            this->NotifyWorker();
+        }
+    }
+}
+
+void JobSystem::ExecuteTask(Task& task, int participant)
+{
+    // Start with the own partition and help with others afterwards,
+    // with partitions of participants on the same node first.
+    const Participant& state = m_participants[participant];
+
+    for(int i = 0; i < task.partitionCount; ++i)
+    {
+        Partition& partition = task.partitions[i == 0 ? participant : state.victims[i - 1]];
+
+        while(true)
+        {
+            int chunk = partition.cursor.fetch_add(1, std::memory_order_relaxed);
+
+            if(chunk >= partition.end)
+                break;
+
+            int begin = chunk * task.grainSize;
+            int end = std::min(begin + task.grainSize, task.count);
+
+            (*task.function)(begin, end);
+        }
+    }
+}
+
+void JobSystem::NotifyWorker()
+{
+    // Lock the mutex so the notification can't be lost
+    // between a worker checking for jobs and going to sleep.
+    if(m_sleepingWorkers.load() > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+        }
+
+        m_sleepCondition.notify_one();
+    }
+}
+
+void JobSystem::PinThread(int processor)
+{
+#if defined(WIN32)
+    SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << (processor % (sizeof(DWORD_PTR) * 8)));
+#elif defined(__linux__)
+    cpu_set_t processorSet;
+    CPU_ZERO(&processorSet);
+    CPU_SET(processor, &processorSet);
+    pthread_setaffinity_np(pthread_self(), sizeof(processorSet), &processorSet);
+#else
+    // Thread affinity is not supported on this platform.
+    (void)processor;
+#endif
+}
@@ -0,0 +1,355 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Fiber.hpp"
+#include "Memory.hpp"
+
+//
+// Job System
+//
+//  Runs jobs on a fixed pool of worker threads with work stealing.
+//  Every participating thread, which includes worker threads and the thread
+//  that initialized the job system, owns a deque of jobs. Jobs scheduled by
+//  a participant are pushed to the bottom of its own deque and popped from
+//  there in last in first out order, while idle participants steal from the
+//  top of other deques. Jobs are kept in a fixed pool per participant, so
+//  scheduling does not allocate. Threads that don't participate schedule
+//  jobs into a shared locked queue instead.
+//
+//  Completion is tracked with job counters, which are incremented for every
+//  scheduled job and decremented once it finishes. Waiting on a counter runs
+//  other jobs in the meantime, so jobs can wait for jobs they have scheduled.
+//
+//  Data parallel ranges are split into chunks of a given grain size. Every
+//  participant starts with its own contiguous partition of chunks, so the same
+//  thread tends to touch the same memory between calls over ranges of the
+//  same size, and helps with partitions of others once its own is done.
+//
+//  Example usage:
+//      JobSystemInfo info;
+//      info.workerCount = 4;
+//
+//      JobSystem jobSystem;
+//      jobSystem.Initialize(info);
+//
+//      jobSystem.ParallelFor(count, 256, [&](int begin, int end)
+//      {
+//          for(int i = begin; i < end; ++i) { /* ... */ }
+//      });
+//
+//  Jobs can optionally run on fibers, which are user mode contexts with their
+//  own stacks. A job that waits on an unfinished counter from a worker thread
+//  then parks its fiber and the worker continues running other jobs on a
+//  fresh fiber from the pool. Parked fibers are resumed by any worker once
+//  their counters reach zero. Without fibers, or when the pool runs out, the
+//  wait runs other jobs on top of the waiting one, which keeps the worker busy
+//  but can't resume the waiting job until the nested jobs return. Jobs that
+//  run on fibers are limited to the fiber stack size and must not keep
+//  pointers to thread local variables across waits. Thread local variables
+//  must not be cached across function calls, which needs fiber safe
+//  optimizations to be enabled with some compilers.
+//
+//  Pinned threads are placed on physical cores of the detected topology,
+//  filling one NUMA node before the next, and only share cores once every
+//  core has a thread. Idle participants steal from participants on their
+//  own node first and help with their partitions of parallel ranges before
+//  crossing over to other nodes, which keeps jobs and the memory they touch
+//  on one socket where possible. Every participant allocates its job pool
+//  and its arena on its own thread after it has been pinned, so memory is
+//  first touched and therefore placed on its node.
+//
+//  Scheduling jobs and waiting for them:
+//      JobCounter counter;
+//      jobSystem.Schedule([]() { /* ... */ }, &counter);
+//      jobSystem.Schedule([]() { /* ... */ }, &counter);
+//      jobSystem.Wait(counter);
+//
+
+// Job system initialization struct.
+struct JobSystemInfo
+{
+    // Number of worker threads.
+    // Negative value uses one less than the number of hardware threads.
+    int workerCount;
+
+    // Pins the initializing thread and worker threads to separate cores.
+    bool pinThreads;
+
+    // Size of the initial block of the arena of each participant.
+    // Zero disables arenas.
+    std::size_t arenaSize;
+
+    // Number of fibers that jobs of worker threads run on.
+    // Zero disables fibers, otherwise there must be more fibers than workers.
+    int fiberCount;
+
+    // Size of the stack of each fiber in bytes.
+    std::size_t fiberStackSize;
+
+    JobSystemInfo();
+};
+
+// Job counter class.
+class JobCounter : private NonCopyable
+{
+public:
+    // Friend declarations.
+    friend class JobSystem;
+
+public:
+    JobCounter();
+    ~JobCounter();
+
+    // Checks if all jobs of the counter have finished.
+    bool IsDone() const;
+
+    // Gets the number of unfinished jobs.
+    int GetValue() const;
+
+private:
+    // Number of unfinished jobs.
+    std::atomic<int> m_value;
+};
+
+// Job system class.
+class JobSystem : private NonCopyable
+{
+public:
+    // Type declarations.
+    typedef std::function<void()> JobFunction;
+    typedef std::function<void(int begin, int end)> RangeFunction;
+
+    // Maximum number of threads taking part in the work.
+    static const int MaximumParticipants = 64;
+
+    // Maximum number of unfinished jobs scheduled by a single participant.
+    static const int MaximumJobs = 4096;
+
+public:
+    JobSystem();
+    ~JobSystem();
+
+    // Restores instance to its original state.
+    void Cleanup();
+
+    // Initializes the job system.
+    // The calling thread becomes a participant along with worker threads.
+    bool Initialize(const JobSystemInfo& info = JobSystemInfo());
+
+    // Schedules a job and increments the counter until it finishes.
+    // Runs the job right away if the job system is not initialized or the job pool is full.
+    void Schedule(JobFunction function, JobCounter* counter = nullptr);
+
+    // Waits until all jobs of the counter have finished.
+    // Parks the calling job when running on a fiber, otherwise runs other jobs while waiting.
+    void Wait(JobCounter& counter);
+
+    // Calls a function for chunks of a range in parallel and waits for completion.
+    // Runs on the calling thread if the job system is not initialized.
+    // Can be called from multiple threads at the same time, including from jobs,
+    // as every call splits its own range and waits only for its own helpers.
+    void ParallelFor(int count, int grainSize, const RangeFunction& function);
+
+    // Gets the number of worker threads.
+    int GetWorkerCount() const;
+
+    // Gets the participant index of the calling thread, or -1 for other threads.
+    int GetParticipantIndex() const;
+
+    // Gets the NUMA node of a participant.
+    // Nodes are only known when threads are pinned, otherwise all participants are on node zero.
+    int GetParticipantNode(int participant) const;
+
+    // Gets clock ticks a participant has spent sleeping without work, including a current sleep.
+    // Only workers sleep, so the initializing thread always reports zero.
+    // Utilization over an interval is one minus the idle share of its ticks.
+    std::uint64_t GetIdleTicks(int participant) const;
+
+    // Gets the arena of the calling participant, allocated from memory of its node.
+    // Returns nullptr for threads that don't participate or if arenas are disabled.
+    LinearArena* GetArena();
+
+    // Frees allocations of arenas of all participants.
+    // Must not be called while jobs are running.
+    void ResetArenas();
+
+private:
+    // Scheduled job.
+    struct Job
+    {
+        JobFunction function;
+        JobCounter* counter;
+
+        // Set while the job is unfinished.
+        std::atomic<bool> used;
+
+        // Set for jobs allocated outside of pools.
+        bool allocated;
+
+        Job();
+    };
+
+    // Work stealing deque of jobs.
+    // Bottom is only changed by the owner, while top is advanced by any thread.
+    class JobDeque
+    {
+    public:
+        JobDeque();
+
+        // Pushes a job at the bottom.
+        // Called only from the owning thread.
+        void Push(Job* job);
+
+        // Pops a job from the bottom.
+        // Called only from the owning thread.
+        Job* Pop();
+
+        // Steals a job from the top.
+        // Called from any thread.
+        Job* Steal();
+
+    private:
+        std::atomic<std::int64_t> m_top;
+        std::atomic<std::int64_t> m_bottom;
+        std::unique_ptr<std::atomic<Job*>[]> m_jobs;
+    };
+
+    // Participant state.
+    // Deque, job pool and arena are allocated by the thread of the participant.
+    struct Participant
+    {
+        std::unique_ptr<JobDeque> deque;
+        std::unique_ptr<Job[]> jobs;
+        LinearArena arena;
+        unsigned int jobCursor;
+        unsigned int stealSeed;
+
+        // Processor the thread is pinned to or -1, and its node.
+        int processor;
+        int node;
+
+        // Other participants in the order of preference for stealing and helping.
+        // Participants on the same node come first.
+        std::vector<int> victims;
+        int nodeVictimCount;
+
+        // Clock ticks spent sleeping without work, and the
+        // tick the participant went to sleep at or zero while awake.
+        std::atomic<std::uint64_t> idleTicks;
+        std::atomic<std::uint64_t> sleepTicks;
+    };
+
+    // Parallel range split into partitions.
+    struct Partition
+    {
+        std::atomic<int> cursor;
+        int end;
+    };
+
+    struct Task
+    {
+        const RangeFunction* function;
+        int count;
+        int grainSize;
+        Partition partitions[MaximumParticipants];
+        int partitionCount;
+    };
+
+    // Fiber waiting for a counter.
+    struct WaitingFiber
+    {
+        Fiber* fiber;
+        JobCounter* counter;
+    };
+
+    typedef std::vector<std::thread> ThreadList;
+    typedef std::deque<Job*> JobQueue;
+    typedef std::vector<Fiber*> FiberList;
+    typedef std::vector<WaitingFiber> WaitingFiberList;
+
+private:
+    // Main function of worker threads.
+    void WorkerMain(int participant);
+
+    // Allocates the state of the calling participant.
+    void InitializeParticipant(int participant);
+
+    // Runs jobs and resumes ready fibers until the job system exits.
+    void RunWorkerLoop();
+
+    // Switches the calling thread to another fiber.
+    // Finishes the action on the previous fiber after it has been switched away from.
+    void SwitchFiber(Fiber* target, int action, JobCounter* counter);
+
+    // Finishes the action of the last fiber switch on the calling thread.
+    void FinishFiberSwitch();
+
+    // Takes a free fiber or returns nullptr if there are none left.
+    Fiber* AcquireFiber();
+
+    // Takes a waiting fiber whose counter has reached zero.
+    Fiber* TakeReadyFiber();
+
+    // Checks if any waiting fiber can be resumed.
+    bool HasReadyFiber();
+
+    // Entry function of fibers.
+    static void FiberMain(void* parameter);
+
+    // Retrieves a job from own deque, other deques or the shared queue.
+    Job* RetrieveJob(int participant);
+
+    // Runs a job and finishes it.
+    void ExecuteJob(Job* job);
+
+    // Processes chunks of a task starting with the partition of a participant.
+    void ExecuteTask(Task& task, int participant);
+
+    // Wakes up a sleeping worker after a job has been scheduled.
+    void NotifyWorker();
+
+    // Pins the calling thread to a logical processor.
+    static void PinThread(int processor);
+
+private:
+    // Worker threads.
+    ThreadList m_workers;
+
+    // Participant states, with the initializing thread as the first.
+    std::unique_ptr<Participant[]> m_participants;
+    int m_participantCount;
+
+    // Jobs scheduled from threads that don't participate.
+    JobQueue m_sharedJobs;
+    std::mutex m_sharedMutex;
+
+    // Number of scheduled jobs that have not been retrieved yet.
+    std::atomic<int> m_pendingJobs;
+
+    // Pool of fibers that run jobs of worker threads.
+    std::unique_ptr<Fiber[]> m_fibers;
+    int m_fiberCount;
+
+    // Free fibers and fibers waiting for counters.
+    FiberList m_freeFibers;
+    WaitingFiberList m_waitingFibers;
+    std::atomic<int> m_waitingFiberCount;
+    std::mutex m_fiberMutex;
+
+    // Size of the initial block of participant arenas.
+    std::size_t m_arenaSize;
+
+    // Worker startup state.
+    int m_startedWorkers;
+    std::mutex m_startMutex;
+    std::condition_variable m_startCondition;
+
+    // Worker sleeping state.
+    std::atomic<int> m_sleepingWorkers;
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCondition;
+    bool m_exit;
+
+    // Initialization state.
+    bool m_initialized;
+};
@@ -0,0 +1,281 @@
+#include "Precompiled.hpp"
+#include "MappedFile.hpp"
+
+#ifndef WIN32
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+    // Log message strings.
+    #define LogOpenError(filename) "Failed to map a file \"" << filename << "\"! "
+    #define LogCreateError(filename) "Failed to create a mapped file \"" << filename << "\"! "
+}
+
+MappedFile::MappedFile() :
+    m_data(nullptr),
+    m_size(0),
+    m_writable(false),
+#ifdef WIN32
+    m_file(INVALID_HANDLE_VALUE),
+    m_mapping(nullptr),
+#else
+    m_file(-1),
+#endif
+    m_initialized(false)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    this->Cleanup();
+}
+
+void MappedFile::Cleanup()
+{
+    // Unmap the memory and close platform handles.
+    // Also called on a partially opened file when opening fails.
+#ifdef WIN32
+    if(m_data != nullptr)
+    {
+        UnmapViewOfFile(m_data);
+    }
+
+    if(m_mapping != nullptr)
+    {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+
+    if(m_file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_file);
+        m_file = INVALID_HANDLE_VALUE;
+    }
+#else
+    if(m_data != nullptr)
+    {
+        munmap(const_cast<void*>(m_data), m_size);
+    }
+
+    if(m_file != -1)
+    {
+        close(m_file);
+        m_file = -1;
+    }
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+    m_writable = false;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool MappedFile::Open(std::string filename)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            this->Cleanup();
+        }
+    );
+
+#ifdef WIN32
+    // Open the file.
+    m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if(m_file == INVALID_HANDLE_VALUE)
+    {
+        LogError() << LogOpenError(filename) << "Couldn't open the file.";
+        return false;
+    }
+
+    // Get the file size.
+    LARGE_INTEGER fileSize;
+
+    if(!GetFileSizeEx(m_file, &fileSize))
+    {
+        LogError() << LogOpenError(filename) << "Couldn't get the file size.";
+        return false;
+    }
+
+    m_size = (std::size_t)fileSize.QuadPart;
+
+    // Map the file into memory.
+    // Empty files can't be mapped, but are still valid.
+    if(m_size != 0)
+    {
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+        if(m_mapping == nullptr)
+        {
+            LogError() << LogOpenError(filename) << "Couldn't create a file mapping.";
+            return false;
+        }
+
+        m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+
+        if(m_data == nullptr)
+        {
+            LogError() << LogOpenError(filename) << "Couldn't map a view of the file.";
+            return false;
+        }
+    }
+#else
+    // Open the file.
+    m_file = open(filename.c_str(), O_RDONLY);
+
+    if(m_file == -1)
+    {
+        LogError() << LogOpenError(filename) << "Couldn't open the file.";
+        return false;
+    }
+
+    // Get the file size.
+    struct stat fileStatus;
+
+    if(fstat(m_file, &fileStatus) != 0)
+    {
+        LogError() << LogOpenError(filename) << "Couldn't get the file size.";
+        return false;
+    }
+
+    m_size = (std::size_t)fileStatus.st_size;
+
+    // Map the file into memory.
+    // Empty files can't be mapped, but are still valid.
+    if(m_size != 0)
+    {
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+
+        if(data == MAP_FAILED)
+        {
+            LogError() << LogOpenError(filename) << "Couldn't map the file.";
+            return false;
+        }
+
+        m_data = data;
+    }
+#endif
+
+    // Success!
+    return m_initialized = true;
+}
+
+bool MappedFile::Create(std::string filename, std::size_t size)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            this->Cleanup();
+        }
+    );
+
+    // Validate arguments.
+    // Empty files can't be mapped for writing.
+    if(size == 0)
+    {
+        LogError() << LogCreateError(filename) << "Invalid size.";
+        return false;
+    }
+
+#ifdef WIN32
+    // Create the file.
+    m_file = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if(m_file == INVALID_HANDLE_VALUE)
+    {
+        LogError() << LogCreateError(filename) << "Couldn't create the file.";
+        return false;
+    }
+
+    // Map the file into memory, which also extends it to the size.
+    std::uint64_t mappingSize = size;
+
+    m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READWRITE, (DWORD)(mappingSize >> 32), (DWORD)(mappingSize & 0xFFFFFFFF), nullptr);
+
+    if(m_mapping == nullptr)
+    {
+        LogError() << LogCreateError(filename) << "Couldn't create a file mapping.";
+        return false;
+    }
+
+    m_data = MapViewOfFile(m_mapping, FILE_MAP_WRITE, 0, 0, size);
+
+    if(m_data == nullptr)
+    {
+        LogError() << LogCreateError(filename) << "Couldn't map a view of the file.";
+        return false;
+    }
+#else
+    // Create the file.
+    m_file = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if(m_file == -1)
+    {
+        LogError() << LogCreateError(filename) << "Couldn't create the file.";
+        return false;
+    }
+
+    // Extend the file to the size.
+    if(ftruncate(m_file, (off_t)size) != 0)
+    {
+        LogError() << LogCreateError(filename) << "Couldn't set the file size.";
+        return false;
+    }
+
+    // Map the file into shared memory.
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+
+    if(data == MAP_FAILED)
+    {
+        LogError() << LogCreateError(filename) << "Couldn't map the file.";
+        return false;
+    }
+
+    m_data = data;
+#endif
+
+    m_size = size;
+    m_writable = true;
+
+    // Success!
+    return m_initialized = true;
+}
+
+const void* MappedFile::GetData() const
+{
+    return m_data;
+}
+
+void* MappedFile::GetWritableData() const
+{
+    Assert(m_writable, "Mapped file is not writable!");
+
+    return const_cast<void*>(m_data);
+}
+
+std::size_t MappedFile::GetSize() const
+{
+    return m_size;
+}
+
+bool MappedFile::IsOpen() const
+{
+    return m_initialized;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Mapped File
+//
+//  Maps the content of a file into read only memory, letting the operating
+//  system page it in on demand instead of reading it up front. The mapping
+//  starts at a page boundary, so data written with aligned offsets can be
+//  accessed in place.
+//
+//  Files can also be created with a fixed size and mapped for writing.
+//  Written memory is shared with the file and reaches it even if the
+//  process crashes, as the operating system writes dirty pages back.
+//
+//  Example usage:
+//      MappedFile file;
+//      file.Open("World.snapshot");
+//
+//      BinaryReader reader(file.GetData(), file.GetSize());
+//
+//      MappedFile ring;
+//      ring.Create("Log.ring", 1024 * 1024);
+//
+//      std::memcpy(ring.GetWritableData(), text, length);
+//
+
+// Mapped file class.
+class MappedFile : private NonCopyable
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // Restores instance to its original state.
+    void Cleanup();
+
+    // Opens and maps a file.
+    bool Open(std::string filename);
+
+    // Creates or truncates a file of a size and maps it for writing.
+    bool Create(std::string filename, std::size_t size);
+
+    // Gets the mapped content of the file.
+    const void* GetData() const;
+
+    // Gets the mapped content of a file mapped for writing.
+    void* GetWritableData() const;
+
+    // Gets the size of the file in bytes.
+    std::size_t GetSize() const;
+
+    // Checks if a file is mapped.
+    bool IsOpen() const;
+
+private:
+    // Mapped memory.
+    const void* m_data;
+    std::size_t m_size;
+    bool m_writable;
+
+    // Platform handles.
+#ifdef WIN32
+    HANDLE m_file;
+    HANDLE m_mapping;
+#else
+    int m_file;
+#endif
+
+    // Initialization state.
+    bool m_initialized;
+};
@@ -0,0 +1,686 @@
+#include "Precompiled.hpp"
+#include "Memory.hpp"
+
+#ifndef WIN32
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+    // Log message strings.
+    #define LogReserveError() "Failed to reserve virtual memory! "
+    #define LogCommitError() "Failed to commit virtual memory! "
+    #define LogInitializeError() "Failed to initialize a linear arena! "
+    #define LogPoolInitializeError() "Failed to initialize a block pool! "
+
+    // Slots of thread caches used by existing pools.
+    std::mutex PoolSlotMutex;
+    std::bitset<BlockPool::MaximumPools> PoolSlots;
+
+    // Generations tell apart pools that reuse a slot.
+    // Zero marks thread caches that have never been used.
+    std::atomic<std::uint64_t> PoolGeneration(0);
+}
+
+VirtualMemoryInfo::VirtualMemoryInfo() :
+    reserveSize(0),
+    hugePages(false)
+{
+}
+
+VirtualMemory::VirtualMemory() :
+    m_data(nullptr),
+    m_reservedSize(0),
+    m_committedSize(0),
+    m_pageSize(0),
+    m_hugePages(false),
+    m_initialized(false)
+{
+}
+
+VirtualMemory::~VirtualMemory()
+{
+    this->Cleanup();
+}
+
+void VirtualMemory::Cleanup()
+{
+    // Release the whole reservation.
+    if(m_data != nullptr)
+    {
+#ifdef WIN32
+        VirtualFree(m_data, 0, MEM_RELEASE);
+#else
+        munmap(m_data, m_reservedSize);
+#endif
+    }
+
+    m_data = nullptr;
+    m_reservedSize = 0;
+    m_committedSize = 0;
+
+    m_pageSize = 0;
+    m_hugePages = false;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool VirtualMemory::Initialize(const VirtualMemoryInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.reserveSize == 0)
+    {
+        LogError() << LogReserveError() << "Invalid reserve size.";
+        return false;
+    }
+
+#ifdef WIN32
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+
+    m_pageSize = systemInfo.dwPageSize;
+
+    // Large pages can't be committed gradually, so the whole reservation is committed at once.
+    if(info.hugePages && GetLargePageMinimum() != 0)
+    {
+        std::size_t pageSize = std::max<std::size_t>(GetLargePageMinimum(), HugePageSize);
+        std::size_t size = (info.reserveSize + pageSize - 1) / pageSize * pageSize;
+
+        m_data = static_cast<std::uint8_t*>(VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE));
+
+        if(m_data != nullptr)
+        {
+            m_reservedSize = size;
+            m_committedSize = size;
+            m_pageSize = pageSize;
+            m_hugePages = true;
+        }
+        else
+        {
+            LogWarning() << "Could not allocate large pages, falling back to regular pages.";
+        }
+    }
+
+    if(m_data == nullptr)
+    {
+        m_reservedSize = (info.reserveSize + m_pageSize - 1) / m_pageSize * m_pageSize;
+        m_data = static_cast<std::uint8_t*>(VirtualAlloc(nullptr, m_reservedSize, MEM_RESERVE, PAGE_NOACCESS));
+
+        if(m_data == nullptr)
+        {
+            LogError() << LogReserveError() << "Could not reserve address space.";
+            return false;
+        }
+    }
+#else
+    // Commit huge pages at a time, so they can be backed by whole huge pages.
+    m_pageSize = info.hugePages ? HugePageSize : (std::size_t)sysconf(_SC_PAGESIZE);
+    m_reservedSize = (info.reserveSize + m_pageSize - 1) / m_pageSize * m_pageSize;
+
+    // Reserve extra space to align the beginning to a huge page.
+    std::size_t mappedSize = m_reservedSize + (info.hugePages ? HugePageSize : 0);
+    void* mapping = mmap(nullptr, mappedSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    if(mapping == MAP_FAILED)
+    {
+        LogError() << LogReserveError() << "Could not reserve address space.";
+        m_reservedSize = 0;
+        return false;
+    }
+
+    std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(mapping);
+    std::uintptr_t aligned = (begin + m_pageSize - 1) & ~(std::uintptr_t)(m_pageSize - 1);
+
+    // Unmap unaligned space around the reservation.
+    if(aligned != begin)
+    {
+        munmap(mapping, aligned - begin);
+    }
+
+    if(begin + mappedSize != aligned + m_reservedSize)
+    {
+        munmap(reinterpret_cast<void*>(aligned + m_reservedSize), begin + mappedSize - aligned - m_reservedSize);
+    }
+
+    m_data = reinterpret_cast<std::uint8_t*>(aligned);
+
+    #ifdef MADV_HUGEPAGE
+        // Transparent huge pages fall back to regular pages if they are not available.
+        if(info.hugePages)
+        {
+            m_hugePages = madvise(m_data, m_reservedSize, MADV_HUGEPAGE) == 0;
+        }
+    #endif
+#endif
+
+    // Success!
+    return m_initialized = true;
+}
+
+bool VirtualMemory::Commit(std::size_t size)
+{
+    Assert(m_initialized, "Virtual memory is not initialized!");
+
+    if(size <= m_committedSize)
+        return true;
+
+    if(size > m_reservedSize)
+        return false;
+
+    // Commit whole pages following the committed range.
+    std::size_t committedSize = std::min((size + m_pageSize - 1) / m_pageSize * m_pageSize, m_reservedSize);
+
+#ifdef WIN32
+    if(VirtualAlloc(m_data + m_committedSize, committedSize - m_committedSize, MEM_COMMIT, PAGE_READWRITE) == nullptr)
+#else
+    if(mprotect(m_data + m_committedSize, committedSize - m_committedSize, PROT_READ | PROT_WRITE) != 0)
+#endif
+    {
+        LogError() << LogCommitError() << "Could not commit " << committedSize - m_committedSize << " bytes.";
+        return false;
+    }
+
+    m_committedSize = committedSize;
+
+    return true;
+}
+
+std::uint8_t* VirtualMemory::GetData() const
+{
+    return m_data;
+}
+
+std::size_t VirtualMemory::GetCommittedSize() const
+{
+    return m_committedSize;
+}
+
+std::size_t VirtualMemory::GetReservedSize() const
+{
+    return m_reservedSize;
+}
+
+bool VirtualMemory::HasHugePages() const
+{
+    return m_hugePages;
+}
+
+bool VirtualMemory::IsInitialized() const
+{
+    return m_initialized;
+}
+
+LinearArenaInfo::LinearArenaInfo() :
+    blockSize(1024 * 1024),
+    reserveSize(0),
+    hugePages(false)
+{
+}
+
+LinearArena::LinearArena() :
+    m_current(nullptr),
+    m_end(nullptr),
+    m_blockSize(0),
+    m_usedSize(0),
+    m_peakSize(0),
+    m_initialized(false)
+{
+}
+
+LinearArena::~LinearArena()
+{
+    this->Cleanup();
+}
+
+void LinearArena::Cleanup()
+{
+    Utility::ClearContainer(m_blocks);
+    m_region.Cleanup();
+
+    m_current = nullptr;
+    m_end = nullptr;
+    m_blockSize = 0;
+
+    m_usedSize = 0;
+    m_peakSize = 0;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool LinearArena::Initialize(const LinearArenaInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.blockSize == 0)
+    {
+        LogError() << LogInitializeError() << "Invalid block size.";
+        return false;
+    }
+
+    m_blockSize = info.blockSize;
+
+    // Allocate the initial block or commit it from a reservation.
+    if(info.reserveSize != 0)
+    {
+        VirtualMemoryInfo regionInfo;
+        regionInfo.reserveSize = info.reserveSize;
+        regionInfo.hugePages = info.hugePages;
+
+        if(!m_region.Initialize(regionInfo))
+        {
+            LogError() << LogInitializeError() << "Could not reserve memory.";
+            return false;
+        }
+
+        m_current = m_region.GetData();
+        m_end = m_region.GetData();
+
+        this->CommitRegion(reinterpret_cast<std::uintptr_t>(m_current) + std::min(m_blockSize, m_region.GetReservedSize()));
+    }
+    else
+    {
+        this->AddBlock(m_blockSize);
+    }
+
+    // Success!
+    return m_initialized = true;
+}
+
+void* LinearArena::Allocate(std::size_t size, std::size_t alignment)
+{
+    Assert(m_initialized, "Linear arena is not initialized!");
+    Assert(alignment != 0 && (alignment & (alignment - 1)) == 0, "Alignment is not a power of two!");
+
+    // Align the current position.
+    std::uintptr_t current = reinterpret_cast<std::uintptr_t>(m_current);
+    std::uintptr_t aligned = (current + alignment - 1) & ~(std::uintptr_t)(alignment - 1);
+    std::size_t padding = (std::size_t)(aligned - current);
+
+    // Grow reserved memory in place or chain a new block if the allocation does not fit.
+    if(padding > (std::size_t)(m_end - m_current) || size > (std::size_t)(m_end - m_current) - padding)
+    {
+        if(!this->CommitRegion(aligned + size))
+        {
+            this->AddBlock(std::max(m_blockSize, size + alignment));
+        }
+
+        current = reinterpret_cast<std::uintptr_t>(m_current);
+        aligned = (current + alignment - 1) & ~(std::uintptr_t)(alignment - 1);
+        padding = (std::size_t)(aligned - current);
+    }
+
+    m_current += padding + size;
+
+    m_usedSize += padding + size;
+    m_peakSize = std::max(m_peakSize, m_usedSize);
+
+    return reinterpret_cast<void*>(aligned);
+}
+
+void LinearArena::Reset()
+{
+    if(!m_initialized)
+        return;
+
+    // Rewind to the beginning of reserved memory, which stays committed.
+    // Blocks chained after running out of reservation are freed.
+    if(m_region.IsInitialized())
+    {
+        Utility::ClearContainer(m_blocks);
+
+        m_current = m_region.GetData();
+        m_end = m_region.GetData() + m_region.GetCommittedSize();
+        m_usedSize = 0;
+
+        return;
+    }
+
+    // Merge blocks, so the next frame fits into a single one.
+    if(m_blocks.size() > 1)
+    {
+        std::size_t capacity = this->GetCapacity();
+
+        Utility::ClearContainer(m_blocks);
+        this->AddBlock(capacity);
+    }
+
+    // Rewind to the beginning of the block.
+    Block& block = m_blocks.back();
+    m_current = block.memory.get();
+    m_end = block.memory.get() + block.size;
+
+    m_usedSize = 0;
+}
+
+std::size_t LinearArena::GetUsedSize() const
+{
+    return m_usedSize;
+}
+
+std::size_t LinearArena::GetPeakSize() const
+{
+    return m_peakSize;
+}
+
+std::size_t LinearArena::GetCapacity() const
+{
+    std::size_t capacity = m_region.GetCommittedSize();
+
+    for(const Block& block : m_blocks)
+    {
+        capacity += block.size;
+    }
+
+    return capacity;
+}
+
+void LinearArena::AddBlock(std::size_t size)
+{
+    Block block;
+    block.memory.reset(new std::uint8_t[size]);
+    block.size = size;
+
+    m_current = block.memory.get();
+    m_end = block.memory.get() + size;
+
+    m_blocks.push_back(std::move(block));
+}
+
+bool LinearArena::CommitRegion(std::uintptr_t end)
+{
+    if(!m_region.IsInitialized() || !m_blocks.empty())
+        return false;
+
+    std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(m_region.GetData());
+
+    if(end < begin || (end - begin) > m_region.GetReservedSize())
+        return false;
+
+    if(!m_region.Commit((std::size_t)(end - begin)))
+        return false;
+
+    m_end = m_region.GetData() + m_region.GetCommittedSize();
+
+    return true;
+}
+
+BlockPoolInfo::BlockPoolInfo() :
+    blockSize(64),
+    chunkBlockCount(1024),
+    threadCacheSize(64),
+    reserveSize(0),
+    hugePages(false)
+{
+}
+
+BlockPool::BlockPool() :
+    m_blockSize(0),
+    m_chunkBlockCount(0),
+    m_threadCacheSize(0),
+    m_slot(-1),
+    m_generation(0),
+    m_freeList(nullptr),
+    m_regionUsed(0),
+    m_initialized(false)
+{
+}
+
+BlockPool::~BlockPool()
+{
+    this->Cleanup();
+}
+
+void BlockPool::Cleanup()
+{
+    // Release the slot of thread caches.
+    // Caches still holding blocks are discarded by their generation.
+    if(m_slot != -1)
+    {
+        std::lock_guard<std::mutex> lock(PoolSlotMutex);
+        PoolSlots.reset(m_slot);
+    }
+
+    m_slot = -1;
+    m_generation = 0;
+
+    // Free all chunks.
+    m_freeList = nullptr;
+    Utility::ClearContainer(m_chunks);
+
+    m_region.Cleanup();
+    m_regionUsed = 0;
+
+    m_blockSize = 0;
+    m_chunkBlockCount = 0;
+    m_threadCacheSize = 0;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool BlockPool::Initialize(const BlockPoolInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            this->Cleanup();
+        }
+    );
+
+    // Validate arguments.
+    if(info.blockSize == 0)
+    {
+        LogError() << LogPoolInitializeError() << "Invalid block size.";
+        return false;
+    }
+
+    if(info.chunkBlockCount == 0)
+    {
+        LogError() << LogPoolInitializeError() << "Invalid chunk block count.";
+        return false;
+    }
+
+    if(info.threadCacheSize == 0)
+    {
+        LogError() << LogPoolInitializeError() << "Invalid thread cache size.";
+        return false;
+    }
+
+    // Blocks have to hold a free list link and keep their alignment.
+    m_blockSize = std::max(info.blockSize, sizeof(FreeBlock));
+    m_blockSize = (m_blockSize + BlockAlignment - 1) / BlockAlignment * BlockAlignment;
+
+    m_chunkBlockCount = info.chunkBlockCount;
+    m_threadCacheSize = info.threadCacheSize;
+
+    // Reserve memory that chunks are carved from.
+    if(info.reserveSize != 0)
+    {
+        VirtualMemoryInfo regionInfo;
+        regionInfo.reserveSize = info.reserveSize;
+        regionInfo.hugePages = info.hugePages;
+
+        if(!m_region.Initialize(regionInfo))
+        {
+            LogError() << LogPoolInitializeError() << "Could not reserve memory.";
+            return false;
+        }
+    }
+
+    // Take a slot of thread caches.
+    {
+        std::lock_guard<std::mutex> lock(PoolSlotMutex);
+
+        for(int i = 0; i < MaximumPools; ++i)
+        {
+            if(!PoolSlots.test(i))
+            {
+                PoolSlots.set(i);
+                m_slot = i;
+                break;
+            }
+        }
+    }
+
+    if(m_slot == -1)
+    {
+        LogError() << LogPoolInitializeError() << "Too many pools exist at once.";
+        return false;
+    }
+
+    m_generation = ++PoolGeneration;
+
+    // Success!
+    return m_initialized = true;
+}
+
+void* BlockPool::Allocate()
+{
+    Assert(m_initialized, "Block pool is not initialized!");
+
+    ThreadCache& cache = this->GetThreadCache();
+
+    if(cache.head == nullptr)
+    {
+        this->Refill(cache);
+    }
+
+    FreeBlock* block = cache.head;
+    cache.head = block->next;
+    cache.count -= 1;
+
+    return block;
+}
+
+void BlockPool::Free(void* block)
+{
+    Assert(m_initialized, "Block pool is not initialized!");
+
+    if(block == nullptr)
+        return;
+
+    ThreadCache& cache = this->GetThreadCache();
+
+    FreeBlock* freeBlock = static_cast<FreeBlock*>(block);
+    freeBlock->next = cache.head;
+    cache.head = freeBlock;
+    cache.count += 1;
+
+    if(cache.count > m_threadCacheSize)
+    {
+        this->Drain(cache);
+    }
+}
+
+std::size_t BlockPool::GetBlockSize() const
+{
+    return m_blockSize;
+}
+
+std::size_t BlockPool::GetChunkCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_chunks.size() + m_regionUsed / (m_blockSize * m_chunkBlockCount);
+}
+
+bool BlockPool::IsInitialized() const
+{
+    return m_initialized;
+}
+
+BlockPool::ThreadCache& BlockPool::GetThreadCache()
+{
+    static thread_local ThreadCache caches[MaximumPools] = {};
+
+    // Discard caches left by a previous pool in the same slot.
+    ThreadCache& cache = caches[m_slot];
+
+    if(cache.generation != m_generation)
+    {
+        cache.generation = m_generation;
+        cache.head = nullptr;
+        cache.count = 0;
+    }
+
+    return cache;
+}
+
+void BlockPool::Refill(ThreadCache& cache)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Carve a new chunk into blocks if the shared list is empty.
+    // Chunks are taken from reserved memory first, which grows in place.
+    if(m_freeList == nullptr)
+    {
+        std::size_t chunkSize = m_blockSize * m_chunkBlockCount;
+        std::uint8_t* chunk = nullptr;
+
+        if(m_region.IsInitialized() && m_region.Commit(m_regionUsed + chunkSize))
+        {
+            chunk = m_region.GetData() + m_regionUsed;
+            m_regionUsed += chunkSize;
+        }
+        else
+        {
+            m_chunks.emplace_back(new std::uint8_t[chunkSize]);
+            chunk = m_chunks.back().get();
+        }
+
+        for(std::size_t i = m_chunkBlockCount; i-- > 0; )
+        {
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + i * m_blockSize);
+            block->next = m_freeList;
+            m_freeList = block;
+        }
+    }
+
+    // Take half of the cache size in a batch.
+    std::size_t count = std::max<std::size_t>(m_threadCacheSize / 2, 1);
+
+    while(count-- > 0 && m_freeList != nullptr)
+    {
+        FreeBlock* block = m_freeList;
+        m_freeList = block->next;
+
+        block->next = cache.head;
+        cache.head = block;
+        cache.count += 1;
+    }
+}
+
+void BlockPool::Drain(ThreadCache& cache)
+{
+    // Detach half of the cached blocks before locking.
+    std::size_t count = cache.count / 2;
+
+    FreeBlock* first = cache.head;
+    FreeBlock* last = first;
+
+    for(std::size_t i = 1; i < count; ++i)
+    {
+        last = last->next;
+    }
+
+    cache.head = last->next;
+    cache.count -= count;
+
+    // Return them to the shared list.
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    last->next = m_freeList;
+    m_freeList = first;
+}
@@ -0,0 +1,516 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Memory
+//
+//  Linear arena that hands out memory by bumping a pointer, for transient
+//  data that lives until the arena is reset, such as data built during a
+//  frame. Individual allocations are never freed and destructors of created
+//  objects are not called, which makes allocating a few instructions and
+//  freeing everything at once free.
+//
+//  Memory is taken from blocks that are kept between resets. When a block
+//  runs out, another one is chained after it. Resetting after a frame that
+//  needed more than one block merges them into a single block of the total
+//  size, so following frames fit into one block again.
+//
+//  Arenas are not thread safe and should be owned by a single thread.
+//
+//  Block pool hands out blocks of a single size, for objects that are
+//  created and destroyed one by one, such as components, event payloads and
+//  render commands. Blocks are carved from chunks that are kept until the
+//  pool is cleaned up. Each thread caches free blocks of a pool, so
+//  allocating and freeing does not lock until the cache has to be refilled
+//  from or returned to the shared list in a batch. Blocks can be freed on a
+//  thread other than the one that allocated them.
+//
+//  Blocks cached by a thread that exits are reused only when the pool is
+//  cleaned up. All blocks have to be freed or abandoned before cleanup.
+//
+//  Virtual memory reserves a range of address space up front and commits
+//  it in place as it grows, so memory carved from it never moves. Ranges
+//  can be backed by 2 MB huge pages, which cover large arrays with far
+//  fewer TLB entries. On Linux, transparent huge pages are requested with
+//  madvise(), which falls back to regular pages silently. On Windows, large
+//  pages need the "Lock pages in memory" privilege and are committed all at
+//  once, falling back to regular pages if they can't be allocated. Arenas
+//  and pools can take their memory from a reservation when one is given.
+//
+//  Example usage:
+//      LinearArena arena;
+//      arena.Initialize(LinearArenaInfo());
+//
+//      while(running)
+//      {
+//          arena.Reset();
+//
+//          ArenaVector<int> visible(ArenaAllocator<int>(&arena));
+//          visible.push_back(42);
+//      }
+//
+//      BlockPoolInfo info;
+//      info.blockSize = sizeof(Event);
+//
+//      BlockPool pool;
+//      pool.Initialize(info);
+//
+//      Event* event = pool.Create<Event>();
+//      pool.Destroy(event);
+//
+//  Reserving address space backed by huge pages:
+//      LinearArenaInfo info;
+//      info.reserveSize = 1024 * 1024 * 1024;
+//      info.hugePages = true;
+//
+//      LinearArena arena;
+//      arena.Initialize(info);
+//
+
+// Virtual memory initialization struct.
+struct VirtualMemoryInfo
+{
+    // Size of reserved address space.
+    std::size_t reserveSize;
+
+    // Backs memory with huge pages where possible.
+    bool hugePages;
+
+    VirtualMemoryInfo();
+};
+
+// Virtual memory class.
+class VirtualMemory : private NonCopyable
+{
+public:
+    // Size of huge pages that reservations are aligned to.
+    static const std::size_t HugePageSize = 2 * 1024 * 1024;
+
+public:
+    VirtualMemory();
+    ~VirtualMemory();
+
+    // Restores instance to its original state.
+    // Releases the whole reservation.
+    void Cleanup();
+
+    // Reserves address space without committing any memory.
+    bool Initialize(const VirtualMemoryInfo& info);
+
+    // Commits memory from the beginning of the reservation up to a size.
+    // Returns false if the size does not fit into the reservation.
+    bool Commit(std::size_t size);
+
+    // Gets the beginning of the reservation.
+    std::uint8_t* GetData() const;
+
+    // Gets the number of committed bytes.
+    std::size_t GetCommittedSize() const;
+
+    // Gets the number of reserved bytes.
+    std::size_t GetReservedSize() const;
+
+    // Checks if memory is backed by huge pages.
+    bool HasHugePages() const;
+
+    // Checks if address space is reserved.
+    bool IsInitialized() const;
+
+private:
+    // Reserved address space.
+    std::uint8_t* m_data;
+    std::size_t m_reservedSize;
+    std::size_t m_committedSize;
+
+    // Granularity of commits.
+    std::size_t m_pageSize;
+    bool m_hugePages;
+
+    // Initialization state.
+    bool m_initialized;
+};
+
+// Linear arena initialization struct.
+struct LinearArenaInfo
+{
+    // Size of the initial block.
+    std::size_t blockSize;
+
+    // Optional size of reserved address space, which the arena grows
+    // into in place before chaining blocks from the heap.
+    std::size_t reserveSize;
+
+    // Backs reserved memory with huge pages.
+    bool hugePages;
+
+    LinearArenaInfo();
+};
+
+// Linear arena class.
+class LinearArena : private NonCopyable
+{
+public:
+    LinearArena();
+    ~LinearArena();
+
+    // Restores instance to its original state.
+    void Cleanup();
+
+    // Initializes the arena and allocates its initial block.
+    bool Initialize(const LinearArenaInfo& info);
+
+    // Allocates memory that stays valid until the arena is reset.
+    // Alignment has to be a power of two.
+    void* Allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+
+    // Creates an object in the arena.
+    // Its destructor is never called.
+    template<typename Type, typename... Arguments>
+    Type* Create(Arguments&&... arguments)
+    {
+        void* memory = this->Allocate(sizeof(Type), alignof(Type));
+        return new (memory) Type(std::forward<Arguments>(arguments)...);
+    }
+
+    // Frees all allocations at once.
+    void Reset();
+
+    // Gets the number of bytes allocated since the last reset.
+    std::size_t GetUsedSize() const;
+
+    // Gets the largest number of bytes allocated between resets.
+    std::size_t GetPeakSize() const;
+
+    // Gets the number of bytes held in blocks.
+    std::size_t GetCapacity() const;
+
+private:
+    // Block of memory.
+    struct Block
+    {
+        std::unique_ptr<std::uint8_t[]> memory;
+        std::size_t size;
+    };
+
+    // Type declarations.
+    typedef std::vector<Block> BlockList;
+
+private:
+    // Adds a block that fits an allocation.
+    void AddBlock(std::size_t size);
+
+    // Commits reserved memory up to an address.
+    // Returns false if the arena has moved on to heap blocks or ran out of reservation.
+    bool CommitRegion(std::uintptr_t end);
+
+private:
+    // Reserved memory that is allocated from first.
+    VirtualMemory m_region;
+
+    // Blocks of memory, with the last one being allocated from.
+    BlockList m_blocks;
+
+    // Position in the current block.
+    std::uint8_t* m_current;
+    std::uint8_t* m_end;
+
+    // Size of blocks added when the arena runs out.
+    std::size_t m_blockSize;
+
+    // Allocation statistics.
+    std::size_t m_usedSize;
+    std::size_t m_peakSize;
+
+    // Initialization state.
+    bool m_initialized;
+};
+
+// Allocator adapter for standard containers.
+// Deallocation does nothing, as memory is freed when the arena is reset.
+// Allocators without an arena use the heap, so containers can be given
+// an arena only when one is available. Allocators propagate with their
+// containers, so an assigned container takes over the arena of the source.
+template<typename Type>
+class ArenaAllocator
+{
+public:
+    // Friend declarations.
+    template<typename Other>
+    friend class ArenaAllocator;
+
+    // Type declarations.
+    typedef Type value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+public:
+    ArenaAllocator(LinearArena* arena = nullptr) :
+        m_arena(arena)
+    {
+    }
+
+    template<typename Other>
+    ArenaAllocator(const ArenaAllocator<Other>& other) :
+        m_arena(other.m_arena)
+    {
+    }
+
+    // Allocates memory for elements.
+    Type* allocate(std::size_t count)
+    {
+        if(m_arena == nullptr)
+            return static_cast<Type*>(::operator new(count * sizeof(Type)));
+
+        return static_cast<Type*>(m_arena->Allocate(count * sizeof(Type), alignof(Type)));
+    }
+
+    // Frees heap memory and does nothing for arena memory, which is freed with the arena.
+    void deallocate(Type* memory, std::size_t)
+    {
+        if(m_arena == nullptr)
+        {
+            ::operator delete(memory);
+        }
+    }
+
+    // Gets the arena that memory is taken from or nullptr for the heap.
+    LinearArena* GetArena() const
+    {
+        return m_arena;
+    }
+
+    // Comparison operators.
+    template<typename Other>
+    bool operator==(const ArenaAllocator<Other>& other) const
+    {
+        return m_arena == other.m_arena;
+    }
+
+    template<typename Other>
+    bool operator!=(const ArenaAllocator<Other>& other) const
+    {
+        return m_arena != other.m_arena;
+    }
+
+private:
+    // Arena that memory is taken from.
+    LinearArena* m_arena;
+};
+
+// Standard containers allocating from an arena.
+template<typename Type>
+using ArenaVector = std::vector<Type, ArenaAllocator<Type>>;
+
+template<typename Type>
+using ArenaDeque = std::deque<Type, ArenaAllocator<Type>>;
+
+template<typename Key, typename Type, typename Compare = std::less<Key>>
+using ArenaMap = std::map<Key, Type, Compare, ArenaAllocator<std::pair<const Key, Type>>>;
+
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>> ArenaString;
+
+// Block pool initialization struct.
+struct BlockPoolInfo
+{
+    // Size of blocks, rounded up to the block alignment.
+    std::size_t blockSize;
+
+    // Number of blocks in each allocated chunk.
+    std::size_t chunkBlockCount;
+
+    // Maximum number of free blocks cached by each thread.
+    std::size_t threadCacheSize;
+
+    // Optional size of reserved address space, which chunks are carved from
+    // before they are allocated from the heap.
+    std::size_t reserveSize;
+
+    // Backs reserved memory with huge pages.
+    bool hugePages;
+
+    BlockPoolInfo();
+};
+
+// Block pool class.
+class BlockPool : private NonCopyable
+{
+public:
+    // Alignment of blocks.
+    static const std::size_t BlockAlignment = alignof(std::max_align_t);
+
+    // Maximum number of pools that can exist at once.
+    static const int MaximumPools = 64;
+
+public:
+    BlockPool();
+    ~BlockPool();
+
+    // Restores instance to its original state.
+    void Cleanup();
+
+    // Initializes the pool.
+    bool Initialize(const BlockPoolInfo& info);
+
+    // Allocates a block.
+    void* Allocate();
+
+    // Frees a block allocated from this pool.
+    void Free(void* block);
+
+    // Creates an object in a block.
+    template<typename Type, typename... Arguments>
+    Type* Create(Arguments&&... arguments)
+    {
+        static_assert(alignof(Type) <= BlockAlignment, "Created type has an unsupported alignment!");
+        Assert(sizeof(Type) <= m_blockSize, "Created type does not fit into a block!");
+
+        void* memory = this->Allocate();
+        return new (memory) Type(std::forward<Arguments>(arguments)...);
+    }
+
+    // Destroys an object and frees its block.
+    template<typename Type>
+    void Destroy(Type* object)
+    {
+        if(object == nullptr)
+            return;
+
+        object->~Type();
+        this->Free(object);
+    }
+
+    // Gets the size of blocks.
+    std::size_t GetBlockSize() const;
+
+    // Gets the number of allocated chunks.
+    std::size_t GetChunkCount() const;
+
+    // Checks if the pool is initialized.
+    bool IsInitialized() const;
+
+private:
+    // Free block linked into a list.
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    // Free blocks cached by a thread.
+    struct ThreadCache
+    {
+        std::uint64_t generation;
+        FreeBlock* head;
+        std::size_t count;
+    };
+
+    // Type declarations.
+    typedef std::vector<std::unique_ptr<std::uint8_t[]>> ChunkList;
+
+private:
+    // Gets the cache of the calling thread.
+    ThreadCache& GetThreadCache();
+
+    // Moves blocks from the shared list into a cache.
+    void Refill(ThreadCache& cache);
+
+    // Moves half of the blocks from a cache into the shared list.
+    void Drain(ThreadCache& cache);
+
+private:
+    // Size of blocks and chunks.
+    std::size_t m_blockSize;
+    std::size_t m_chunkBlockCount;
+    std::size_t m_threadCacheSize;
+
+    // Slot of thread caches and their generation.
+    int m_slot;
+    std::uint64_t m_generation;
+
+    // Shared list of free blocks and allocated chunks.
+    mutable std::mutex m_mutex;
+    FreeBlock* m_freeList;
+    ChunkList m_chunks;
+
+    // Reserved memory and the number of bytes carved into chunks.
+    VirtualMemory m_region;
+    std::size_t m_regionUsed;
+
+    // Initialization state.
+    bool m_initialized;
+};
+
+// Allocator adapter for standard containers.
+// Single elements that fit into a block are taken from the pool, which
+// suits node based containers. Arrays are allocated from the heap.
+template<typename Type>
+class PoolAllocator
+{
+public:
+    // Friend declarations.
+    template<typename Other>
+    friend class PoolAllocator;
+
+    // Type declarations.
+    typedef Type value_type;
+
+public:
+    PoolAllocator(BlockPool* pool) :
+        m_pool(pool)
+    {
+        Assert(pool != nullptr, "Invalid pool!");
+    }
+
+    template<typename Other>
+    PoolAllocator(const PoolAllocator<Other>& other) :
+        m_pool(other.m_pool)
+    {
+    }
+
+    // Allocates memory for elements.
+    Type* allocate(std::size_t count)
+    {
+        if(this->IsPooled(count))
+            return static_cast<Type*>(m_pool->Allocate());
+
+        return static_cast<Type*>(::operator new(count * sizeof(Type)));
+    }
+
+    // Frees memory of elements.
+    void deallocate(Type* elements, std::size_t count)
+    {
+        if(this->IsPooled(count))
+        {
+            m_pool->Free(elements);
+        }
+        else
+        {
+            ::operator delete(elements);
+        }
+    }
+
+    // Comparison operators.
+    template<typename Other>
+    bool operator==(const PoolAllocator<Other>& other) const
+    {
+        return m_pool == other.m_pool;
+    }
+
+    template<typename Other>
+    bool operator!=(const PoolAllocator<Other>& other) const
+    {
+        return m_pool != other.m_pool;
+    }
+
+private:
+    // Checks if an allocation is taken from the pool.
+    bool IsPooled(std::size_t count) const
+    {
+        return count == 1 && sizeof(Type) <= m_pool->GetBlockSize() && alignof(Type) <= BlockPool::BlockAlignment;
+    }
+
+private:
+    // Pool that blocks are taken from.
+    BlockPool* m_pool;
+};
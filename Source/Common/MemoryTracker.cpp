@@ -0,0 +1,281 @@
+#include "Precompiled.hpp"
+#include "MemoryTracker.hpp"
+
+namespace
+{
+    // Names of tags.
+    const char* TagNames[MemoryTags::Count] =
+    {
+        "Untagged",
+        "Entity",
+        "Logger",
+        "Render",
+        "Config",
+    };
+
+    // Counters of a tag.
+    // Atomics are zero initialized before any allocation happens.
+    struct TagCounters
+    {
+        std::atomic<std::int64_t> liveBytes;
+        std::atomic<std::int64_t> peakBytes;
+        std::atomic<std::uint64_t> totalAllocations;
+
+        std::atomic<std::uint64_t> frameAllocations;
+        std::atomic<std::uint64_t> frameBytes;
+
+        std::atomic<std::uint64_t> lastFrameAllocations;
+        std::atomic<std::uint64_t> lastFrameBytes;
+
+        std::atomic<std::int64_t> liveBudget;
+        std::atomic<std::uint64_t> frameBudget;
+
+        // Only accessed when ending frames.
+        bool liveExceeded;
+        bool frameExceeded;
+    };
+
+    TagCounters Counters[MemoryTags::Count];
+
+    // Tag of allocations on each thread.
+    thread_local MemoryTags::Type ThreadTag = MemoryTags::Untagged;
+
+    // Checks if a tag is valid.
+    bool IsValidTag(int tag)
+    {
+        return tag >= 0 && tag < MemoryTags::Count;
+    }
+}
+
+#if defined(MEMORY_TRACKING)
+
+namespace
+{
+    // Header placed before every allocation.
+    // Keeps allocations aligned the same as the heap does.
+    struct AllocationHeader
+    {
+        std::size_t size;
+        std::uint32_t tag;
+    };
+
+    const std::size_t HeaderSize = 16;
+
+    static_assert(sizeof(AllocationHeader) <= HeaderSize, "Allocation header does not fit!");
+    static_assert(alignof(std::max_align_t) <= HeaderSize, "Allocation header breaks alignment!");
+
+    // Counts an allocation.
+    void AddAllocation(MemoryTags::Type tag, std::size_t size)
+    {
+        TagCounters& counters = Counters[tag];
+
+        std::int64_t live = counters.liveBytes.fetch_add((std::int64_t)size, std::memory_order_relaxed) + (std::int64_t)size;
+        std::int64_t peak = counters.peakBytes.load(std::memory_order_relaxed);
+
+        while(live > peak && !counters.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        {
+        }
+
+        counters.totalAllocations.fetch_add(1, std::memory_order_relaxed);
+        counters.frameAllocations.fetch_add(1, std::memory_order_relaxed);
+        counters.frameBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    // Allocates a block with a header.
+    void* Allocate(std::size_t size)
+    {
+        MemoryTags::Type tag = ThreadTag;
+
+        while(true)
+        {
+            void* memory = std::malloc(size + HeaderSize);
+
+            if(memory != nullptr)
+            {
+                AllocationHeader* header = static_cast<AllocationHeader*>(memory);
+                header->size = size;
+                header->tag = (std::uint32_t)tag;
+
+                AddAllocation(tag, size);
+
+                return static_cast<std::uint8_t*>(memory) + HeaderSize;
+            }
+
+            // Let the new handler free memory, as operator new has to.
+            std::new_handler handler = std::get_new_handler();
+
+            if(handler == nullptr)
+                return nullptr;
+
+            handler();
+        }
+    }
+
+    // Frees a block with a header.
+    void Free(void* pointer)
+    {
+        if(pointer == nullptr)
+            return;
+
+        void* memory = static_cast<std::uint8_t*>(pointer) - HeaderSize;
+        AllocationHeader* header = static_cast<AllocationHeader*>(memory);
+
+        Counters[header->tag].liveBytes.fetch_sub((std::int64_t)header->size, std::memory_order_relaxed);
+
+        std::free(memory);
+    }
+}
+
+// Replaced global allocation functions.
+void* operator new(std::size_t size)
+{
+    void* memory = Allocate(size);
+
+    if(memory == nullptr)
+        throw std::bad_alloc();
+
+    return memory;
+}
+
+void* operator new[](std::size_t size)
+{
+    void* memory = Allocate(size);
+
+    if(memory == nullptr)
+        throw std::bad_alloc();
+
+    return memory;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return Allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return Allocate(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    Free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    Free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+    Free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+    Free(pointer);
+}
+
+#endif
+
+MemoryTracker::Statistics::Statistics() :
+    liveBytes(0),
+    peakBytes(0),
+    totalAllocations(0),
+    frameAllocations(0),
+    frameBytes(0),
+    liveBudget(0),
+    frameBudget(0)
+{
+}
+
+void MemoryTracker::SetBudget(MemoryTags::Type tag, std::int64_t liveBytes, std::uint64_t frameAllocations)
+{
+    Assert(IsValidTag(tag), "Invalid memory tag!");
+
+    Counters[tag].liveBudget.store(liveBytes, std::memory_order_relaxed);
+    Counters[tag].frameBudget.store(frameAllocations, std::memory_order_relaxed);
+}
+
+MemoryTracker::Statistics MemoryTracker::GetStatistics(MemoryTags::Type tag)
+{
+    Assert(IsValidTag(tag), "Invalid memory tag!");
+
+    const TagCounters& counters = Counters[tag];
+
+    Statistics statistics;
+    statistics.liveBytes = counters.liveBytes.load(std::memory_order_relaxed);
+    statistics.peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+    statistics.totalAllocations = counters.totalAllocations.load(std::memory_order_relaxed);
+    statistics.frameAllocations = counters.lastFrameAllocations.load(std::memory_order_relaxed);
+    statistics.frameBytes = counters.lastFrameBytes.load(std::memory_order_relaxed);
+    statistics.liveBudget = counters.liveBudget.load(std::memory_order_relaxed);
+    statistics.frameBudget = counters.frameBudget.load(std::memory_order_relaxed);
+
+    return statistics;
+}
+
+void MemoryTracker::EndFrame()
+{
+    for(int i = 0; i < MemoryTags::Count; ++i)
+    {
+        TagCounters& counters = Counters[i];
+
+        // Latch counters of the ended frame.
+        std::uint64_t frameAllocations = counters.frameAllocations.exchange(0, std::memory_order_relaxed);
+        std::uint64_t frameBytes = counters.frameBytes.exchange(0, std::memory_order_relaxed);
+
+        counters.lastFrameAllocations.store(frameAllocations, std::memory_order_relaxed);
+        counters.lastFrameBytes.store(frameBytes, std::memory_order_relaxed);
+
+        // Warn once when a budget is exceeded.
+        std::int64_t liveBytes = counters.liveBytes.load(std::memory_order_relaxed);
+        std::int64_t liveBudget = counters.liveBudget.load(std::memory_order_relaxed);
+        std::uint64_t frameBudget = counters.frameBudget.load(std::memory_order_relaxed);
+
+        bool liveExceeded = liveBudget != 0 && liveBytes > liveBudget;
+        bool frameExceeded = frameBudget != 0 && frameAllocations > frameBudget;
+
+        if(liveExceeded && !counters.liveExceeded)
+        {
+            LogWarning() << "Memory tag \"" << TagNames[i] << "\" exceeded its budget with " << liveBytes << " of " << liveBudget << " live bytes.";
+        }
+
+        if(frameExceeded && !counters.frameExceeded)
+        {
+            LogWarning() << "Memory tag \"" << TagNames[i] << "\" exceeded its budget with " << frameAllocations << " of " << frameBudget << " allocations in a frame (" << frameBytes << " bytes).";
+        }
+
+        counters.liveExceeded = liveExceeded;
+        counters.frameExceeded = frameExceeded;
+    }
+}
+
+void MemoryTracker::SetThreadTag(MemoryTags::Type tag)
+{
+    Assert(IsValidTag(tag), "Invalid memory tag!");
+
+    ThreadTag = tag;
+}
+
+MemoryTags::Type MemoryTracker::GetThreadTag()
+{
+    return ThreadTag;
+}
+
+const char* MemoryTracker::GetTagName(MemoryTags::Type tag)
+{
+    Assert(IsValidTag(tag), "Invalid memory tag!");
+
+    return TagNames[tag];
+}
+
+bool MemoryTracker::IsEnabled()
+{
+#if defined(MEMORY_TRACKING)
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Memory Tracker
+//
+//  Counts heap allocations of subsystems, to find code that allocates every
+//  frame and subsystems that grow past their budgets. Each thread has a
+//  current memory tag that allocations are counted under, which is set with
+//  scoped tags around subsystem code. Blocks remember their tag, so freeing
+//  them subtracts from the right tag on any thread.
+//
+//  Global operator new and delete are replaced when MEMORY_TRACKING is
+//  defined, which adds a small header to every allocation. Statistics can
+//  be queried at runtime from any thread, but stay empty when tracking is
+//  not compiled in.
+//
+//  Each tag can have a budget of live bytes and of allocations per frame.
+//  Ending a frame latches per frame counters and logs a warning when a tag
+//  goes over one of its budgets, once until it falls back under it.
+//
+//  Example usage:
+//      MemoryTracker::SetBudget(MemoryTags::Entity, 64 * 1024 * 1024, 100);
+//
+//      while(running)
+//      {
+//          {
+//              MemoryTracker::ScopedTag tag(MemoryTags::Entity);
+//              entitySystem.ProcessCommands();
+//          }
+//
+//          MemoryTracker::EndFrame();
+//      }
+//
+//      MemoryTracker::Statistics statistics = MemoryTracker::GetStatistics(MemoryTags::Entity);
+//
+
+// Memory tags.
+struct MemoryTags
+{
+    enum Type
+    {
+        Untagged,
+        Entity,
+        Logger,
+        Render,
+        Config,
+
+        Count,
+    };
+};
+
+namespace MemoryTracker
+{
+    // Allocation statistics of a tag.
+    struct Statistics
+    {
+        Statistics();
+
+        // Bytes currently allocated.
+        std::int64_t liveBytes;
+
+        // Largest number of bytes allocated at once.
+        std::int64_t peakBytes;
+
+        // Number of allocations since the start.
+        std::uint64_t totalAllocations;
+
+        // Allocations and allocated bytes of the last ended frame.
+        std::uint64_t frameAllocations;
+        std::uint64_t frameBytes;
+
+        // Budgets, with zero meaning no budget.
+        std::int64_t liveBudget;
+        std::uint64_t frameBudget;
+    };
+
+    // Sets budgets of live bytes and allocations per frame of a tag.
+    // Zero disables a budget.
+    void SetBudget(MemoryTags::Type tag, std::int64_t liveBytes, std::uint64_t frameAllocations);
+
+    // Gets allocation statistics of a tag.
+    Statistics GetStatistics(MemoryTags::Type tag);
+
+    // Latches per frame counters and checks budgets.
+    // Has to be called once per frame from a single thread.
+    void EndFrame();
+
+    // Sets the tag of allocations on the calling thread.
+    void SetThreadTag(MemoryTags::Type tag);
+
+    // Gets the tag of allocations on the calling thread.
+    MemoryTags::Type GetThreadTag();
+
+    // Gets the name of a tag.
+    const char* GetTagName(MemoryTags::Type tag);
+
+    // Checks if tracking is compiled in.
+    bool IsEnabled();
+
+    // Sets the tag of the calling thread for a scope.
+    class ScopedTag : private NonCopyable
+    {
+    public:
+        ScopedTag(MemoryTags::Type tag) :
+            m_previous(GetThreadTag())
+        {
+            SetThreadTag(tag);
+        }
+
+        ~ScopedTag()
+        {
+            SetThreadTag(m_previous);
+        }
+
+    private:
+        // Tag restored at the end of the scope.
+        MemoryTags::Type m_previous;
+    };
+}
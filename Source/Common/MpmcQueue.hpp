@@ -0,0 +1,257 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// MPMC Queue
+//
+//  Bounded first in, first out queue that any number of threads can push to
+//  and pop from at the same time without locks. Elements are stored in a
+//  fixed ring of slots, each of which has a sequence number that tells
+//  producers whether the slot is free for their lap and consumers whether
+//  it has been published. Threads claim positions with a single compare
+//  and swap and then only touch their own slot, so producers and consumers
+//  do not contend with each other unless the queue is empty or full.
+//
+//  Pushing to a full queue and popping from an empty one fail right away
+//  instead of waiting. Positions of producers and consumers are kept on
+//  separate cache lines. Initializing and cleaning up are not thread safe.
+//
+//  Example usage:
+//      MpmcQueue<Request> queue;
+//      queue.Initialize(1024);
+//
+//      jobSystem.ParallelFor(count, 64, [&](int begin, int end)
+//      {
+//          for(int i = begin; i < end; ++i)
+//          {
+//              while(!queue.TryPush(requests[i])) { /* ... */ }
+//          }
+//      });
+//
+//      Request request;
+//
+//      while(queue.TryPop(request))
+//      {
+//          /* ... */
+//      }
+//
+
+template<typename Type>
+class MpmcQueue : private NonCopyable
+{
+public:
+    MpmcQueue();
+    ~MpmcQueue();
+
+    // Restores instance to it's original state.
+    // Queued elements are destroyed.
+    void Cleanup();
+
+    // Allocates the ring of slots.
+    // Capacity must be a power of two.
+    bool Initialize(std::size_t capacity);
+
+    // Pushes an element from any thread.
+    // Returns false if the queue is full.
+    bool TryPush(Type element);
+
+    // Pops an element from any thread.
+    // Returns false if the queue is empty.
+    bool TryPop(Type& element);
+
+    // Gets an approximate number of queued elements.
+    std::size_t GetSize() const;
+
+    // Gets the number of slots in the ring.
+    std::size_t GetCapacity() const;
+
+private:
+    // Size of a cache line that positions are kept apart by.
+    static const std::size_t CacheLineSize = 64;
+
+    // Ring slot.
+    struct Slot
+    {
+        std::atomic<std::size_t> sequence;
+        typename std::aligned_storage<sizeof(Type), alignof(Type)>::type storage;
+    };
+
+private:
+    // Ring of slots.
+    std::unique_ptr<Slot[]> m_slots;
+    std::size_t m_capacity;
+
+    // Positions of the next slot to be claimed by producers and consumers.
+    char m_enqueuePadding[CacheLineSize];
+    std::atomic<std::size_t> m_enqueue;
+    char m_dequeuePadding[CacheLineSize];
+    std::atomic<std::size_t> m_dequeue;
+    char m_endPadding[CacheLineSize];
+};
+
+// Template implementations.
+template<typename Type>
+MpmcQueue<Type>::MpmcQueue() :
+    m_capacity(0),
+    m_enqueue(0),
+    m_dequeue(0)
+{
+}
+
+template<typename Type>
+MpmcQueue<Type>::~MpmcQueue()
+{
+    this->Cleanup();
+}
+
+template<typename Type>
+void MpmcQueue<Type>::Cleanup()
+{
+    // Destroy published elements.
+    std::size_t end = m_enqueue.load(std::memory_order_acquire);
+
+    for(std::size_t position = m_dequeue.load(std::memory_order_relaxed); position != end; ++position)
+    {
+        Slot& slot = m_slots[position & (m_capacity - 1)];
+
+        if(slot.sequence.load(std::memory_order_acquire) == position + 1)
+        {
+            reinterpret_cast<Type*>(&slot.storage)->~Type();
+        }
+    }
+
+    // Free the ring.
+    m_slots.reset();
+    m_capacity = 0;
+
+    m_enqueue.store(0, std::memory_order_relaxed);
+    m_dequeue.store(0, std::memory_order_relaxed);
+}
+
+template<typename Type>
+bool MpmcQueue<Type>::Initialize(std::size_t capacity)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(capacity < 2 || (capacity & (capacity - 1)) != 0)
+    {
+        LogError() << "Failed to initialize a queue! Capacity must be a power of two.";
+        return false;
+    }
+
+    // Allocate the ring with every slot free for its first lap.
+    m_slots.reset(new Slot[capacity]);
+    m_capacity = capacity;
+
+    for(std::size_t i = 0; i < capacity; ++i)
+    {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    // Success!
+    return true;
+}
+
+template<typename Type>
+bool MpmcQueue<Type>::TryPush(Type element)
+{
+    if(m_capacity == 0)
+        return false;
+
+    // Claim a free slot.
+    std::size_t position = m_enqueue.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+
+    while(true)
+    {
+        slot = &m_slots[position & (m_capacity - 1)];
+        std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        std::intptr_t difference = (std::intptr_t)sequence - (std::intptr_t)position;
+
+        if(difference == 0)
+        {
+            // Slot is free for this lap.
+            if(m_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if(difference < 0)
+        {
+            // Slot still holds an element from the previous lap.
+            return false;
+        }
+        else
+        {
+            // Slot has been claimed by another producer.
+            position = m_enqueue.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Publish the element.
+    new (&slot->storage) Type(std::move(element));
+    slot->sequence.store(position + 1, std::memory_order_release);
+
+    return true;
+}
+
+template<typename Type>
+bool MpmcQueue<Type>::TryPop(Type& element)
+{
+    if(m_capacity == 0)
+        return false;
+
+    // Claim a published slot.
+    std::size_t position = m_dequeue.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+
+    while(true)
+    {
+        slot = &m_slots[position & (m_capacity - 1)];
+        std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        std::intptr_t difference = (std::intptr_t)sequence - (std::intptr_t)(position + 1);
+
+        if(difference == 0)
+        {
+            // Slot has been published for this lap.
+            if(m_dequeue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if(difference < 0)
+        {
+            // Slot has not been published yet.
+            return false;
+        }
+        else
+        {
+            // Slot has been claimed by another consumer.
+            position = m_dequeue.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Take the element.
+    Type* stored = reinterpret_cast<Type*>(&slot->storage);
+    element = std::move(*stored);
+    stored->~Type();
+
+    // Free the slot for the next lap.
+    slot->sequence.store(position + m_capacity, std::memory_order_release);
+
+    return true;
+}
+
+template<typename Type>
+std::size_t MpmcQueue<Type>::GetSize() const
+{
+    std::size_t enqueue = m_enqueue.load(std::memory_order_relaxed);
+    std::size_t dequeue = m_dequeue.load(std::memory_order_relaxed);
+
+    return enqueue > dequeue ? enqueue - dequeue : 0;
+}
+
+template<typename Type>
+std::size_t MpmcQueue<Type>::GetCapacity() const
+{
+    return m_capacity;
+}
@@ -0,0 +1,342 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "JobSystem.hpp"
+
+//
+// Parallel
+//
+//  Data parallel algorithms on top of the job system, shared by systems that
+//  would otherwise each write their own, such as compacting entities, writing
+//  culling output or sorting broadphase and render keys. Ranges are split into
+//  chunks of a grain size, which are processed with work stealing like any
+//  other parallel range of the job system. Every algorithm runs on the calling
+//  thread if no job system is given.
+//
+//  Results never depend on the number of threads or on which thread processed
+//  which chunk. Reductions combine partial results of chunks in their order
+//  and sorting is stable, so simulation code can use them without breaking
+//  determinism, as long as the grain size stays the same.
+//
+//  Sorting is a least significant digit radix sort of unsigned integer keys,
+//  with optional values moved along with them. Every pass builds histograms
+//  of chunks in parallel and scatters keys to offsets computed from them.
+//  Passes over digits that are the same for all keys are skipped, so keys
+//  that only use their lower bits, like Morton codes of a small world, take
+//  fewer passes.
+//
+//  Example usage:
+//      Parallel::For(&jobSystem, count, 256, [&](int begin, int end)
+//      {
+//          for(int i = begin; i < end; ++i) { /* ... */ }
+//      });
+//
+//      float total = Parallel::Reduce(&jobSystem, count, 1024, 0.0f,
+//          [&](int begin, int end)
+//          {
+//              float sum = 0.0f;
+//              for(int i = begin; i < end; ++i) sum += masses[i];
+//              return sum;
+//          },
+//          [](float first, float second) { return first + second; });
+//
+//  Compacting visible entities:
+//      int visibleCount = Parallel::PrefixSum(&jobSystem, visible.data(), offsets.data(), count, 1024);
+//
+//      Parallel::For(&jobSystem, count, 1024, [&](int begin, int end)
+//      {
+//          for(int i = begin; i < end; ++i) if(visible[i]) output[offsets[i]] = entities[i];
+//      });
+//
+//  Sorting draw calls by render keys:
+//      Parallel::Sort(&jobSystem, sortKeys.data(), drawIndices.data(), count);
+//
+
+namespace Parallel
+{
+    // Default number of elements per chunk of sorting.
+    const int SortGrainSize = 16384;
+
+    // Calls a function for chunks of a range.
+    // Runs on the calling thread if no job system is given.
+    template<typename Function>
+    void For(JobSystem* jobSystem, int count, int grainSize, Function function);
+
+    // Reduces a range by combining results of chunks in order.
+    // Range function returns the result of a chunk.
+    template<typename Type, typename RangeFunction, typename CombineFunction>
+    Type Reduce(JobSystem* jobSystem, int count, int grainSize, const Type& identity,
+        RangeFunction range, CombineFunction combine);
+
+    // Writes the exclusive prefix sum of values to an output array.
+    // Output can be the same array as the input. Returns the total sum.
+    template<typename Type>
+    Type PrefixSum(JobSystem* jobSystem, const Type* input, Type* output, int count, int grainSize);
+
+    // Sorts unsigned integer keys along with their values.
+    // Sorting is stable, so values with equal keys keep their order.
+    template<typename Key, typename Value>
+    void Sort(JobSystem* jobSystem, Key* keys, Value* values, int count, int grainSize = SortGrainSize);
+
+    // Sorts unsigned integer keys.
+    template<typename Key>
+    void Sort(JobSystem* jobSystem, Key* keys, int count, int grainSize = SortGrainSize);
+}
+
+//
+// Template implementations.
+//
+
+namespace Parallel
+{
+    namespace Detail
+    {
+        // Number of bits and buckets of a radix sort digit.
+        const int DigitBits = 8;
+        const int DigitCount = 1 << DigitBits;
+
+        // Placeholder for sorting keys without values.
+        struct NoValue
+        {
+        };
+
+        // Calls a function for each chunk index of a range.
+        template<typename Function>
+        void ForEachChunk(JobSystem* jobSystem, int chunkCount, Function function)
+        {
+            For(jobSystem, chunkCount, 1, [&](int begin, int end)
+            {
+                for(int chunk = begin; chunk < end; ++chunk)
+                {
+                    function(chunk);
+                }
+            });
+        }
+
+        // Moves a value of a radix sort pass.
+        template<typename Value>
+        inline void MoveValue(Value* source, Value* destination, int from, int to)
+        {
+            destination[to] = std::move(source[from]);
+        }
+
+        inline void MoveValue(NoValue* source, NoValue* destination, int from, int to)
+        {
+        }
+
+        // Sorts keys and values with a least significant digit radix sort.
+        template<typename Key, typename Value>
+        void RadixSort(JobSystem* jobSystem, Key* keys, Value* values, int count, int grainSize)
+        {
+            static_assert(std::is_integral<Key>::value && std::is_unsigned<Key>::value, "Keys must be unsigned integers!");
+
+            Assert(grainSize > 0, "Grain size must be positive!");
+
+            if(count <= 1)
+                return;
+
+            const int PassCount = (int)sizeof(Key) * 8 / DigitBits;
+            int chunkCount = (count + grainSize - 1) / grainSize;
+
+            // Scratch arrays that passes scatter into, swapped with the input after each pass.
+            std::vector<Key> keyScratch(count);
+            std::vector<Value> valueScratch(values == nullptr ? 0 : count);
+            std::vector<int> histograms((std::size_t)chunkCount * DigitCount);
+
+            Key* sourceKeys = keys;
+            Key* targetKeys = keyScratch.data();
+            Value* sourceValues = values;
+            Value* targetValues = valueScratch.empty() ? values : valueScratch.data();
+
+            for(int pass = 0; pass < PassCount; ++pass)
+            {
+                int shift = pass * DigitBits;
+
+                // Count digits of each chunk.
+                ForEachChunk(jobSystem, chunkCount, [&](int chunk)
+                {
+                    int* histogram = &histograms[(std::size_t)chunk * DigitCount];
+                    std::fill(histogram, histogram + DigitCount, 0);
+
+                    int end = std::min(count, (chunk + 1) * grainSize);
+
+                    for(int i = chunk * grainSize; i < end; ++i)
+                    {
+                        histogram[(sourceKeys[i] >> shift) & (DigitCount - 1)] += 1;
+                    }
+                });
+
+                // Turn counts into offsets, ordered by digit first and chunk second.
+                // Skip the pass if all keys have the same digit.
+                int offset = 0;
+                bool skipPass = false;
+
+                for(int digit = 0; digit < DigitCount && !skipPass; ++digit)
+                {
+                    int digitStart = offset;
+
+                    for(int chunk = 0; chunk < chunkCount; ++chunk)
+                    {
+                        int& entry = histograms[(std::size_t)chunk * DigitCount + digit];
+                        int digitCount = entry;
+                        entry = offset;
+                        offset += digitCount;
+                    }
+
+                    skipPass = offset - digitStart == count;
+                }
+
+                if(skipPass)
+                    continue;
+
+                // Scatter keys and values to their offsets.
+                ForEachChunk(jobSystem, chunkCount, [&](int chunk)
+                {
+                    int* offsets = &histograms[(std::size_t)chunk * DigitCount];
+                    int end = std::min(count, (chunk + 1) * grainSize);
+
+                    for(int i = chunk * grainSize; i < end; ++i)
+                    {
+                        int target = offsets[(sourceKeys[i] >> shift) & (DigitCount - 1)]++;
+                        targetKeys[target] = sourceKeys[i];
+
+                        if(values != nullptr)
+                        {
+                            MoveValue(sourceValues, targetValues, i, target);
+                        }
+                    }
+                });
+
+                std::swap(sourceKeys, targetKeys);
+                std::swap(sourceValues, targetValues);
+            }
+
+            // Copy results back if the last pass ended in scratch arrays.
+            if(sourceKeys != keys)
+            {
+                For(jobSystem, count, grainSize, [&](int begin, int end)
+                {
+                    std::copy(sourceKeys + begin, sourceKeys + end, keys + begin);
+
+                    if(values != nullptr)
+                    {
+                        for(int i = begin; i < end; ++i)
+                        {
+                            MoveValue(sourceValues, values, i, i);
+                        }
+                    }
+                });
+            }
+        }
+    }
+
+    template<typename Function>
+    void For(JobSystem* jobSystem, int count, int grainSize, Function function)
+    {
+        if(count <= 0)
+            return;
+
+        if(jobSystem != nullptr)
+        {
+            jobSystem->ParallelFor(count, grainSize, function);
+        }
+        else
+        {
+            function(0, count);
+        }
+    }
+
+    template<typename Type, typename RangeFunction, typename CombineFunction>
+    Type Reduce(JobSystem* jobSystem, int count, int grainSize, const Type& identity,
+        RangeFunction range, CombineFunction combine)
+    {
+        Assert(grainSize > 0, "Grain size must be positive!");
+
+        if(count <= 0)
+            return identity;
+
+        // Compute results of chunks in parallel.
+        int chunkCount = (count + grainSize - 1) / grainSize;
+        std::vector<Type> results(chunkCount, identity);
+
+        Detail::ForEachChunk(jobSystem, chunkCount, [&](int chunk)
+        {
+            results[chunk] = range(chunk * grainSize, std::min(count, (chunk + 1) * grainSize));
+        });
+
+        // Combine results in order, independent of which thread computed them.
+        Type result = identity;
+
+        for(const Type& chunkResult : results)
+        {
+            result = combine(result, chunkResult);
+        }
+
+        return result;
+    }
+
+    template<typename Type>
+    Type PrefixSum(JobSystem* jobSystem, const Type* input, Type* output, int count, int grainSize)
+    {
+        Assert(grainSize > 0, "Grain size must be positive!");
+
+        if(count <= 0)
+            return Type();
+
+        // Sum chunks in parallel.
+        int chunkCount = (count + grainSize - 1) / grainSize;
+        std::vector<Type> chunkSums(chunkCount, Type());
+
+        Detail::ForEachChunk(jobSystem, chunkCount, [&](int chunk)
+        {
+            Type sum = Type();
+            int end = std::min(count, (chunk + 1) * grainSize);
+
+            for(int i = chunk * grainSize; i < end; ++i)
+            {
+                sum += input[i];
+            }
+
+            chunkSums[chunk] = sum;
+        });
+
+        // Scan sums of chunks into their starting offsets.
+        Type total = Type();
+
+        for(Type& sum : chunkSums)
+        {
+            Type chunkSum = sum;
+            sum = total;
+            total += chunkSum;
+        }
+
+        // Scan chunks in parallel starting from their offsets.
+        // Each input is read before its output is written, which allows scanning in place.
+        Detail::ForEachChunk(jobSystem, chunkCount, [&](int chunk)
+        {
+            Type sum = chunkSums[chunk];
+            int end = std::min(count, (chunk + 1) * grainSize);
+
+            for(int i = chunk * grainSize; i < end; ++i)
+            {
+                Type value = input[i];
+                output[i] = sum;
+                sum += value;
+            }
+        });
+
+        return total;
+    }
+
+    template<typename Key, typename Value>
+    void Sort(JobSystem* jobSystem, Key* keys, Value* values, int count, int grainSize)
+    {
+        Detail::RadixSort(jobSystem, keys, values, count, grainSize);
+    }
+
+    template<typename Key>
+    void Sort(JobSystem* jobSystem, Key* keys, int count, int grainSize)
+    {
+        Detail::RadixSort(jobSystem, keys, (Detail::NoValue*)nullptr, count, grainSize);
+    }
+}
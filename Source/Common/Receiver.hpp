@@ -23,19 +23,57 @@ class ReceiverInvoker;
 template<typename Type>
 class Receiver;
 
+// Link between a receiver and the dispatcher it is subscribed to.
+template<typename Type>
+class ReceiverLink;
+
+template<typename ReturnType, typename... Arguments>
+class ReceiverLink<ReturnType(Arguments...)>
+{
+public:
+    // Friend declarations.
+    friend DispatcherBase<ReturnType(Arguments...)>;
+
+public:
+    // Checks if subscribed to a dispatcher.
+    bool IsSubscribed() const
+    {
+        return m_dispatcher != nullptr;
+    }
+
+protected:
+    ReceiverLink() :
+        m_dispatcher(nullptr),
+        m_index(-1)
+    {
+    }
+
+protected:
+    // Subscribed dispatcher.
+    DispatcherBase<ReturnType(Arguments...)>* m_dispatcher;
+
+    // Index of the entry in a packed dispatcher.
+    int m_index;
+};
+
 template<typename ReturnType, typename... Arguments>
-class Receiver<ReturnType(Arguments...)> : private Delegate<ReturnType(Arguments...)>
+class Receiver<ReturnType(Arguments...)> : public ReceiverLink<ReturnType(Arguments...)>, private Delegate<ReturnType(Arguments...)>
 {
 public:
     // Friend declarations.
     friend DispatcherBase<ReturnType(Arguments...)>;
     friend ReceiverInvoker<ReturnType(Arguments...)>;
 
+public:
+    // Key of receivers that receive all events.
+    static const int AnyKey = std::numeric_limits<int>::min();
+
 public:
     Receiver() :
-        m_dispatcher(nullptr),
         m_previous(nullptr),
-        m_next(nullptr)
+        m_next(nullptr),
+        m_key(AnyKey),
+        m_priority(0)
     {
     }
 
@@ -50,17 +88,23 @@ public:
         // Unsubscribe from the dispatcher.
         this->Unsubscribe();
 
+        // Reset the event key and priority.
+        m_key = AnyKey;
+        m_priority = 0;
+
         // Cleanup base class.
         Delegate<ReturnType(Arguments...)>::Cleanup();
     }
 
     // Subcribes to a dispatcher.
-    void Subscribe(DispatcherBase<ReturnType(Arguments...)>& dispatcher)
+    // Receivers with a higher priority are invoked first.
+    void Subscribe(DispatcherBase<ReturnType(Arguments...)>& dispatcher, int priority = 0)
     {
         // Unsubscribe from the current dispatcher.
         this->Unsubscribe();
 
         // Subscribe to the new dispatcher.
+        m_priority = priority;
         dispatcher.Subscribe(*this);
 
         Assert(m_dispatcher == &dispatcher, "Receiver subscribed to a wrong dispatcher!");
@@ -77,14 +121,30 @@ public:
             Assert(m_dispatcher == nullptr, "Dispatcher didn't clear this receiver properly!");
             Assert(m_previous == nullptr, "Dispatcher didn't clear this receiver properly!");
             Assert(m_next == nullptr, "Dispatcher didn't clear this receiver properly!");
+            Assert(m_index == -1, "Dispatcher didn't clear this receiver properly!");
         }
     }
 
+    // Sets the key of events to receive.
+    // Events are matched using the key function of the dispatcher.
+    void SetKey(int key)
+    {
+        m_key = key;
+        this->Rebind();
+    }
+
+    // Gets the key of events to receive.
+    int GetKey() const
+    {
+        return m_key;
+    }
+
     // Binds a static function.
     template<ReturnType(*Function)(Arguments...)>
     void Bind()
     {
         Delegate<ReturnType(Arguments...)>::Bind<Function>();
+        this->Rebind();
     }
 
     // Binds a functor object.
@@ -92,6 +152,7 @@ public:
     void Bind(InstanceType* instance)
     {
         Delegate<ReturnType(Arguments...)>::Bind(instance);
+        this->Rebind();
     }
 
     // Binds an instance method.
@@ -99,9 +160,19 @@ public:
     void Bind(InstanceType* instance)
     {
         Delegate<ReturnType(Arguments...)>::Bind<InstanceType, Function>(instance);
+        this->Rebind();
     }
 
 private:
+    // Updates the dispatcher after binding or changing the key while subscribed.
+    void Rebind()
+    {
+        if(m_dispatcher != nullptr)
+        {
+            m_dispatcher->Rebind(*this);
+        }
+    }
+
     // Receives an event and invokes a bound function.
     ReturnType Receive(Arguments... arguments)
     {
@@ -110,8 +181,123 @@ private:
     }
 
 private:
-    // Intrusive singly linked list.
-    DispatcherBase<ReturnType(Arguments...)>* m_dispatcher;
-    Receiver<ReturnType(Arguments...)>*       m_previous;
-    Receiver<ReturnType(Arguments...)>*       m_next;
+    // Using declarations.
+    using ReceiverLink<ReturnType(Arguments...)>::m_dispatcher;
+    using ReceiverLink<ReturnType(Arguments...)>::m_index;
+
+private:
+    // Intrusive doubly linked list.
+    Receiver<ReturnType(Arguments...)>* m_previous;
+    Receiver<ReturnType(Arguments...)>* m_next;
+
+    // Event key and invocation priority.
+    int m_key;
+    int m_priority;
+};
+
+//
+// Compact Receiver
+//
+//  Receiver of packed array dispatchers with the smallest footprint, meant
+//  to be embedded in large numbers of objects. The bound function, key and
+//  priority are only stored in the entry of the dispatcher, so the receiver
+//  itself holds just the dispatcher and a 32 bit index of its entry. It has
+//  no virtual methods, so it carries no virtual table pointer and is
+//  destroyed without a virtual call.
+//
+//  A function is bound while subscribing. Receivers can't be copied or
+//  moved, as dispatchers keep pointers to them.
+//
+//  Example usage:
+//      Dispatcher<void(const EventData&), CollectDefault<void>, ReceiverStorage::PackedArray> dispatcher;
+//
+//      CompactReceiver<void(const EventData&)> receiver;
+//      receiver.Subscribe<Class, &Class::Function>(dispatcher, &instance);
+//      receiver.SetKey(42);
+//
+
+template<typename Type>
+class CompactReceiver;
+
+template<typename ReturnType, typename... Arguments>
+class CompactReceiver<ReturnType(Arguments...)> final : public ReceiverLink<ReturnType(Arguments...)>, private NonCopyable
+{
+public:
+    // Key of receivers that receive all events.
+    static const int AnyKey = Receiver<ReturnType(Arguments...)>::AnyKey;
+
+public:
+    CompactReceiver()
+    {
+    }
+
+    ~CompactReceiver()
+    {
+        this->Unsubscribe();
+    }
+
+    // Restores instance to it's original state.
+    void Cleanup()
+    {
+        this->Unsubscribe();
+    }
+
+    // Subscribes a static function to a packed dispatcher.
+    // Receivers with a higher priority are invoked first.
+    template<ReturnType (*Function)(Arguments...)>
+    void Subscribe(DispatcherBase<ReturnType(Arguments...)>& dispatcher, int priority = 0)
+    {
+        this->Subscribe(dispatcher, nullptr, &Delegate<ReturnType(Arguments...)>::template FunctionStub<Function>, priority);
+    }
+
+    // Subscribes an instance method to a packed dispatcher.
+    // Receivers with a higher priority are invoked first.
+    template<class InstanceType, ReturnType (InstanceType::*Function)(Arguments...)>
+    void Subscribe(DispatcherBase<ReturnType(Arguments...)>& dispatcher, InstanceType* instance, int priority = 0)
+    {
+        Assert(instance != nullptr, "Method instance is nullptr!");
+        this->Subscribe(dispatcher, instance, &Delegate<ReturnType(Arguments...)>::template MethodStub<InstanceType, Function>, priority);
+    }
+
+    // Unsubscribes from the current dispatcher.
+    void Unsubscribe()
+    {
+        if(m_dispatcher != nullptr)
+        {
+            m_dispatcher->UnsubscribeEntry(*this);
+
+            Assert(m_dispatcher == nullptr, "Dispatcher didn't clear this receiver properly!");
+            Assert(m_index == -1, "Dispatcher didn't clear this receiver properly!");
+        }
+    }
+
+    // Sets the key of events to receive while subscribed.
+    // Events are matched using the key function of the dispatcher.
+    void SetKey(int key)
+    {
+        Assert(m_dispatcher != nullptr, "Setting a key of a receiver that is not subscribed!");
+
+        if(m_dispatcher != nullptr)
+        {
+            m_dispatcher->SetEntryKey(*this, key);
+        }
+    }
+
+private:
+    // Type declarations.
+    typedef ReturnType (*FunctionPtr)(void*, Arguments...);
+
+    // Using declarations.
+    using ReceiverLink<ReturnType(Arguments...)>::m_dispatcher;
+    using ReceiverLink<ReturnType(Arguments...)>::m_index;
+
+    // Subscribes a bound function to a packed dispatcher.
+    void Subscribe(DispatcherBase<ReturnType(Arguments...)>& dispatcher, void* instance, FunctionPtr function, int priority)
+    {
+        this->Unsubscribe();
+
+        dispatcher.SubscribeEntry(*this, instance, function, AnyKey, priority);
+
+        Assert(m_dispatcher == &dispatcher, "Receiver subscribed to a wrong dispatcher!");
+    }
 };
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Ring Buffer
+//
+//  First in, first out queue of elements stored in a single contiguous array.
+//  Memory is kept between uses and only grows when the buffer runs out of space.
+//  Growing or pushing elements invalidates references to existing elements.
+//
+//  Example usage:
+//      RingBuffer<int> buffer;
+//      buffer.Reserve(64);
+//      buffer.Push(1);
+//      buffer.Push(2);
+//
+//      while(!buffer.IsEmpty())
+//      {
+//          int value = buffer.Front();
+//          buffer.Pop();
+//      }
+//
+
+template<typename Type>
+class RingBuffer
+{
+public:
+    RingBuffer() :
+        m_head(0),
+        m_size(0)
+    {
+    }
+
+    // Restores instance to it's original state and frees its memory.
+    void Cleanup()
+    {
+        Utility::ClearContainer(m_elements);
+
+        m_head = 0;
+        m_size = 0;
+    }
+
+    // Removes all elements while keeping the memory.
+    void Clear()
+    {
+        m_head = 0;
+        m_size = 0;
+    }
+
+    // Makes sure that the buffer can hold a number of elements without growing.
+    void Reserve(std::size_t capacity)
+    {
+        if(capacity > m_elements.size())
+        {
+            this->Grow(capacity);
+        }
+    }
+
+    // Adds an element at the end of the buffer.
+    void Push(const Type& element)
+    {
+        if(m_size == m_elements.size())
+        {
+            this->Grow(m_size + 1);
+        }
+
+        m_elements[(m_head + m_size) & (m_elements.size() - 1)] = element;
+        m_size += 1;
+    }
+
+    // Removes an element from the beginning of the buffer.
+    void Pop()
+    {
+        Assert(m_size != 0, "Attempting to pop an element from an empty ring buffer!");
+
+        m_head = (m_head + 1) & (m_elements.size() - 1);
+        m_size -= 1;
+    }
+
+    // Gets the first element.
+    Type& Front()
+    {
+        Assert(m_size != 0, "Attempting to access an element of an empty ring buffer!");
+        return m_elements[m_head];
+    }
+
+    // Gets the last element.
+    Type& Back()
+    {
+        Assert(m_size != 0, "Attempting to access an element of an empty ring buffer!");
+        return m_elements[(m_head + m_size - 1) & (m_elements.size() - 1)];
+    }
+
+    // Gets an element counting from the beginning of the buffer.
+    Type& operator[](std::size_t index)
+    {
+        Assert(index < m_size, "Ring buffer element index out of range!");
+        return m_elements[(m_head + index) & (m_elements.size() - 1)];
+    }
+
+    const Type& operator[](std::size_t index) const
+    {
+        Assert(index < m_size, "Ring buffer element index out of range!");
+        return m_elements[(m_head + index) & (m_elements.size() - 1)];
+    }
+
+    // Checks if the buffer is empty.
+    bool IsEmpty() const
+    {
+        return m_size == 0;
+    }
+
+    // Gets the number of elements.
+    std::size_t GetSize() const
+    {
+        return m_size;
+    }
+
+    // Gets the number of elements that fit without growing.
+    std::size_t GetCapacity() const
+    {
+        return m_elements.size();
+    }
+
+private:
+    // Grows the buffer to a power of two capacity.
+    void Grow(std::size_t required)
+    {
+        std::size_t capacity = std::max<std::size_t>(m_elements.size() * 2, 16);
+
+        while(capacity < required)
+        {
+            capacity *= 2;
+        }
+
+        // Move elements into a new array in a linear order.
+        std::vector<Type> elements(capacity);
+
+        for(std::size_t i = 0; i < m_size; ++i)
+        {
+            elements[i] = m_elements[(m_head + i) & (m_elements.size() - 1)];
+        }
+
+        m_elements.swap(elements);
+        m_head = 0;
+    }
+
+private:
+    // Array of elements with a power of two size.
+    std::vector<Type> m_elements;
+
+    // Index of the first element.
+    std::size_t m_head;
+
+    // Number of stored elements.
+    std::size_t m_size;
+};
@@ -0,0 +1,218 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// SPSC Queue
+//
+//  Bounded first in, first out queue between a single producer thread and a
+//  single consumer thread. Elements are stored in a fixed ring and each side
+//  only writes its own position, so pushing and popping need no atomic read
+//  modify write operations at all. Each side also keeps a cached copy of the
+//  position of the other side and only reloads it when the ring looks full
+//  or empty, which keeps the shared cache lines from bouncing between cores
+//  on every element.
+//
+//  Pushing to a full queue and popping from an empty one fail right away
+//  instead of waiting. Initializing and cleaning up are not thread safe.
+//
+//  Example usage:
+//      SpscQueue<Message> queue;
+//      queue.Initialize(256);
+//
+//      // Producer thread.
+//      queue.TryPush(message);
+//
+//      // Consumer thread.
+//      Message message;
+//
+//      while(queue.TryPop(message))
+//      {
+//          /* ... */
+//      }
+//
+
+template<typename Type>
+class SpscQueue : private NonCopyable
+{
+public:
+    SpscQueue();
+    ~SpscQueue();
+
+    // Restores instance to it's original state.
+    // Queued elements are destroyed.
+    void Cleanup();
+
+    // Allocates the ring of elements.
+    // Capacity must be a power of two.
+    bool Initialize(std::size_t capacity);
+
+    // Pushes an element from the producer thread.
+    // Returns false if the queue is full.
+    bool TryPush(Type element);
+
+    // Pops an element from the consumer thread.
+    // Returns false if the queue is empty.
+    bool TryPop(Type& element);
+
+    // Gets the oldest element from the consumer thread without popping it.
+    // Returns nullptr if the queue is empty.
+    Type* Peek();
+
+    // Gets an approximate number of queued elements.
+    std::size_t GetSize() const;
+
+    // Gets the number of elements the ring can hold.
+    std::size_t GetCapacity() const;
+
+private:
+    // Size of a cache line that positions are kept apart by.
+    static const std::size_t CacheLineSize = 64;
+
+    // Type declarations.
+    typedef typename std::aligned_storage<sizeof(Type), alignof(Type)>::type Storage;
+
+private:
+    // Ring of elements.
+    std::unique_ptr<Storage[]> m_elements;
+    std::size_t m_capacity;
+
+    // Position written by the producer and its cached position of the consumer.
+    char m_producerPadding[CacheLineSize];
+    std::atomic<std::size_t> m_tail;
+    std::size_t m_cachedHead;
+
+    // Position written by the consumer and its cached position of the producer.
+    char m_consumerPadding[CacheLineSize];
+    std::atomic<std::size_t> m_head;
+    std::size_t m_cachedTail;
+    char m_endPadding[CacheLineSize];
+};
+
+// Template implementations.
+template<typename Type>
+SpscQueue<Type>::SpscQueue() :
+    m_capacity(0),
+    m_tail(0),
+    m_cachedHead(0),
+    m_head(0),
+    m_cachedTail(0)
+{
+}
+
+template<typename Type>
+SpscQueue<Type>::~SpscQueue()
+{
+    this->Cleanup();
+}
+
+template<typename Type>
+void SpscQueue<Type>::Cleanup()
+{
+    // Destroy queued elements.
+    while(Type* element = this->Peek())
+    {
+        element->~Type();
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // Free the ring.
+    m_elements.reset();
+    m_capacity = 0;
+
+    m_tail.store(0, std::memory_order_relaxed);
+    m_head.store(0, std::memory_order_relaxed);
+    m_cachedHead = 0;
+    m_cachedTail = 0;
+}
+
+template<typename Type>
+bool SpscQueue<Type>::Initialize(std::size_t capacity)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(capacity == 0 || (capacity & (capacity - 1)) != 0)
+    {
+        LogError() << "Failed to initialize a queue! Capacity must be a power of two.";
+        return false;
+    }
+
+    // Allocate the ring.
+    m_elements.reset(new Storage[capacity]);
+    m_capacity = capacity;
+
+    // Success!
+    return true;
+}
+
+template<typename Type>
+bool SpscQueue<Type>::TryPush(Type element)
+{
+    std::size_t tail = m_tail.load(std::memory_order_relaxed);
+
+    // Reload the consumer position only when the ring looks full.
+    if(tail - m_cachedHead == m_capacity)
+    {
+        m_cachedHead = m_head.load(std::memory_order_acquire);
+
+        if(tail - m_cachedHead == m_capacity)
+            return false;
+    }
+
+    // Publish the element.
+    new (&m_elements[tail & (m_capacity - 1)]) Type(std::move(element));
+    m_tail.store(tail + 1, std::memory_order_release);
+
+    return true;
+}
+
+template<typename Type>
+bool SpscQueue<Type>::TryPop(Type& element)
+{
+    Type* stored = this->Peek();
+
+    if(stored == nullptr)
+        return false;
+
+    // Take the element and free its place for the producer.
+    element = std::move(*stored);
+    stored->~Type();
+
+    m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+    return true;
+}
+
+template<typename Type>
+Type* SpscQueue<Type>::Peek()
+{
+    std::size_t head = m_head.load(std::memory_order_relaxed);
+
+    // Reload the producer position only when the ring looks empty.
+    if(head == m_cachedTail)
+    {
+        m_cachedTail = m_tail.load(std::memory_order_acquire);
+
+        if(head == m_cachedTail)
+            return nullptr;
+    }
+
+    return reinterpret_cast<Type*>(&m_elements[head & (m_capacity - 1)]);
+}
+
+template<typename Type>
+std::size_t SpscQueue<Type>::GetSize() const
+{
+    std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    std::size_t head = m_head.load(std::memory_order_relaxed);
+
+    return tail > head ? tail - head : 0;
+}
+
+template<typename Type>
+std::size_t SpscQueue<Type>::GetCapacity() const
+{
+    return m_capacity;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Collector.hpp"
+
+//
+// Static Dispatcher
+//
+//  Invokes a list of receivers that is known at compile time. Functions and
+//  methods are template arguments, so every call is direct and can be fully
+//  inlined, without a function pointer per receiver like in Dispatcher.
+//  Meant for hot events that always go to the same set of receivers, such as
+//  per frame update hooks. Receivers can not be subscribed or unsubscribed.
+//  Results are handled by the same collectors as in Dispatcher.
+//
+//  Instance methods need an instance that is passed to the constructor in
+//  the order of receivers. Static function receivers take an empty argument.
+//
+//  Example usage:
+//      bool Function(float timeDelta) { /*...*/ }
+//      bool Class::Method(float timeDelta) { /*...*/ }
+//      Class instance;
+//
+//      StaticDispatcher<bool(float), CollectWhileTrue<bool>,
+//          STATIC_RECEIVER(&Class::Method),
+//          STATIC_RECEIVER(&Function)
+//      > dispatcher(&instance, {});
+//
+//      dispatcher.Dispatch(0.016f);
+//
+
+// Static receiver of a function or a method.
+template<typename Type, Type Function>
+class StaticReceiver;
+
+template<typename ReturnType, typename... Arguments, ReturnType (*Function)(Arguments...)>
+class StaticReceiver<ReturnType (*)(Arguments...), Function>
+{
+public:
+    StaticReceiver()
+    {
+    }
+
+    template<typename... Parameters>
+    ReturnType operator()(Parameters&&... parameters) const
+    {
+        return (Function)(std::forward<Parameters>(parameters)...);
+    }
+};
+
+template<class InstanceType, typename ReturnType, typename... Arguments, ReturnType (InstanceType::*Function)(Arguments...)>
+class StaticReceiver<ReturnType (InstanceType::*)(Arguments...), Function>
+{
+public:
+    StaticReceiver(InstanceType* instance = nullptr) :
+        m_instance(instance)
+    {
+    }
+
+    template<typename... Parameters>
+    ReturnType operator()(Parameters&&... parameters) const
+    {
+        Assert(m_instance != nullptr, "Invoking a static receiver without an instance!");
+
+        return (m_instance->*Function)(std::forward<Parameters>(parameters)...);
+    }
+
+private:
+    InstanceType* m_instance;
+};
+
+// Declares a static receiver type of a function or a method.
+#define STATIC_RECEIVER(function) StaticReceiver<decltype(function), function>
+
+// Static dispatcher class.
+template<typename Type, class Collector, class... Receivers>
+class StaticDispatcher;
+
+template<typename ReturnType, typename... Arguments, class Collector, class... Receivers>
+class StaticDispatcher<ReturnType(Arguments...), Collector, Receivers...>
+{
+public:
+    StaticDispatcher(Receivers... receivers) :
+        m_receivers(receivers...)
+    {
+    }
+
+    // Invokes receivers with following arguments.
+    ReturnType Dispatch(Arguments... arguments)
+    {
+        Collector collector;
+        this->Invoke<0>(collector, std::integral_constant<bool, 0 < sizeof...(Receivers)>(), arguments...);
+        return collector.GetResult();
+    }
+
+    ReturnType operator()(Arguments... arguments)
+    {
+        return this->Dispatch(std::forward<Arguments>(arguments)...);
+    }
+
+private:
+    // Collector invocation for non void return types.
+    template<typename Receiver, typename Result>
+    struct Invocation
+    {
+        static bool Call(Collector& collector, Receiver& receiver, Arguments&... arguments)
+        {
+            return collector(receiver(arguments...));
+        }
+    };
+
+    // Collector invocation for void return types.
+    template<typename Receiver>
+    struct Invocation<Receiver, void>
+    {
+        static bool Call(Collector& collector, Receiver& receiver, Arguments&... arguments)
+        {
+            receiver(arguments...);
+            return collector();
+        }
+    };
+
+    // Invokes receivers starting at an index until a collector stops propagation.
+    template<std::size_t Index>
+    void Invoke(Collector& collector, std::true_type, Arguments&... arguments)
+    {
+        typedef typename std::tuple_element<Index, std::tuple<Receivers...>>::type ReceiverType;
+
+        if(!Invocation<ReceiverType, ReturnType>::Call(collector, std::get<Index>(m_receivers), arguments...))
+            return;
+
+        this->Invoke<Index + 1>(collector, std::integral_constant<bool, Index + 1 < sizeof...(Receivers)>(), arguments...);
+    }
+
+    template<std::size_t Index>
+    void Invoke(Collector& collector, std::false_type, Arguments&... arguments)
+    {
+    }
+
+private:
+    // List of receivers.
+    std::tuple<Receivers...> m_receivers;
+};
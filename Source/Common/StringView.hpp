@@ -0,0 +1,136 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// String View
+//
+//  References a range of characters owned by another string, without
+//  copying them. Views are cheap to pass by value and slicing them never
+//  allocates. A view is only valid as long as the string it refers to is
+//  not modified or destroyed, and it is not necessarily null terminated.
+//
+//  Example usage:
+//      std::string filename = "Data/Textures/Player.tga";
+//
+//      StringView extension = Utility::GetFileExtensionView(filename);
+//      if(extension == "tga") { /* ... */ }
+//
+
+// String view class.
+class StringView
+{
+public:
+    // Position returned when characters are not found.
+    static const std::size_t NotFound = (std::size_t)-1;
+
+public:
+    StringView() :
+        m_data(""),
+        m_size(0)
+    {
+    }
+
+    StringView(const char* string) :
+        m_data(string),
+        m_size(std::strlen(string))
+    {
+    }
+
+    StringView(const char* data, std::size_t size) :
+        m_data(data),
+        m_size(size)
+    {
+    }
+
+    StringView(const std::string& string) :
+        m_data(string.data()),
+        m_size(string.size())
+    {
+    }
+
+    // Gets a character.
+    char operator[](std::size_t index) const
+    {
+        Assert(index < m_size, "Index out of range!");
+        return m_data[index];
+    }
+
+    // Comparison operators.
+    bool operator==(const StringView& other) const
+    {
+        return m_size == other.m_size && std::memcmp(m_data, other.m_data, m_size) == 0;
+    }
+
+    bool operator!=(const StringView& other) const
+    {
+        return !(*this == other);
+    }
+
+    // Gets a view of a part of the string.
+    // Offsets and counts past the end are clamped.
+    StringView Substring(std::size_t offset, std::size_t count = NotFound) const
+    {
+        offset = std::min(offset, m_size);
+        count = std::min(count, m_size - offset);
+        return StringView(m_data + offset, count);
+    }
+
+    // Finds the last occurrence of any of the given characters.
+    std::size_t FindLastOf(const char* characters) const
+    {
+        for(std::size_t i = m_size; i-- > 0; )
+        {
+            if(std::strchr(characters, m_data[i]) != nullptr && m_data[i] != '\0')
+                return i;
+        }
+
+        return NotFound;
+    }
+
+    // Copies the viewed characters into a string.
+    std::string ToString() const
+    {
+        return std::string(m_data, m_size);
+    }
+
+    // Gets the viewed characters.
+    const char* GetData() const
+    {
+        return m_data;
+    }
+
+    // Gets the number of viewed characters.
+    std::size_t GetSize() const
+    {
+        return m_size;
+    }
+
+    // Checks if the view is empty.
+    bool IsEmpty() const
+    {
+        return m_size == 0;
+    }
+
+    // Iterators.
+    const char* begin() const
+    {
+        return m_data;
+    }
+
+    const char* end() const
+    {
+        return m_data + m_size;
+    }
+
+private:
+    // Viewed characters.
+    const char* m_data;
+    std::size_t m_size;
+};
+
+// Writes a view to a stream.
+inline std::ostream& operator<<(std::ostream& stream, const StringView& view)
+{
+    return stream.write(view.GetData(), view.GetSize());
+}
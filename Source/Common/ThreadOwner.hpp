@@ -0,0 +1,174 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Thread Owner
+//
+//  Tracks the thread that owns an instance, so calls that mutate it from
+//  another thread are caught by asserts as soon as they happen, instead of
+//  corrupting state that fails much later.
+//
+//  An owner is either claimed, which keeps it until it is released, or taken
+//  by a scope for its duration and given up when the outermost scope of the
+//  owning thread ends. Scopes on other threads fail while it is owned.
+//  Claimed owners suit instances that have a home thread, while scopes suit
+//  instances that are handed between threads, where only overlapping use is
+//  a race.
+//
+//  Checks are compiled only when THREAD_CHECKS is defined in builds with
+//  asserts, otherwise the macros and the members they check are stripped,
+//  so release builds do not pay for them.
+//
+//  Example usage:
+//  #if defined(THREAD_OWNER_CHECKS)
+//      ThreadOwner m_threadOwner;
+//  #endif
+//
+//      THREAD_OWNER_CLAIM(m_threadOwner);
+//      THREAD_OWNER_CHECK(m_threadOwner, "Entity created from a thread that does not own the entity system!");
+//
+//  Checking overlapping use:
+//      THREAD_OWNER_SCOPE(m_threadOwner, "Dispatcher used from multiple threads at the same time!");
+//
+
+// Thread checks are only compiled into builds with asserts.
+#if defined(THREAD_CHECKS) && !defined(NDEBUG)
+    #define THREAD_OWNER_CHECKS
+#endif
+
+// Thread owner class.
+class ThreadOwner
+{
+public:
+    // Scope of use by the calling thread.
+    class Scope : private NonCopyable
+    {
+    public:
+        Scope(ThreadOwner& owner) :
+            m_owner(owner),
+            m_entered(owner.Enter())
+        {
+        }
+
+        ~Scope()
+        {
+            if(m_entered)
+            {
+                m_owner.Leave();
+            }
+        }
+
+        // Checks if the calling thread entered the scope as the owner.
+        bool IsEntered() const
+        {
+            return m_entered;
+        }
+
+    private:
+        ThreadOwner& m_owner;
+        bool m_entered;
+    };
+
+public:
+    ThreadOwner() :
+        m_owner(std::thread::id()),
+        m_depth(0),
+        m_claimed(false)
+    {
+    }
+
+    // Copies start without an owner, as they are new instances.
+    ThreadOwner(const ThreadOwner&) :
+        ThreadOwner()
+    {
+    }
+
+    ThreadOwner& operator=(const ThreadOwner&)
+    {
+        return *this;
+    }
+
+    // Makes the calling thread the owner until it is released.
+    void Claim()
+    {
+        m_owner = std::this_thread::get_id();
+        m_claimed = true;
+    }
+
+    // Releases a claimed owner, so any thread can claim it or enter a scope.
+    void Release()
+    {
+        m_claimed = false;
+
+        if(m_depth == 0)
+        {
+            m_owner = std::thread::id();
+        }
+    }
+
+    // Checks if the calling thread owns the instance or it has no owner.
+    bool IsOwner() const
+    {
+        std::thread::id owner = m_owner;
+        return owner == std::thread::id() || owner == std::this_thread::get_id();
+    }
+
+private:
+    // Takes the owner for a scope, unless another thread owns it.
+    bool Enter()
+    {
+        std::thread::id current = std::this_thread::get_id();
+        std::thread::id expected;
+
+        if(!m_owner.compare_exchange_strong(expected, current) && expected != current)
+            return false;
+
+        // Only the owning thread counts its nested scopes.
+        ++m_depth;
+        return true;
+    }
+
+    // Gives up the owner taken by the outermost scope.
+    void Leave()
+    {
+        if(--m_depth == 0 && !m_claimed)
+        {
+            m_owner = std::thread::id();
+        }
+    }
+
+private:
+    // Owning thread or a default identifier if there is none.
+    std::atomic<std::thread::id> m_owner;
+
+    // Number of nested scopes of the owning thread.
+    int m_depth;
+
+    // Whether the owner was claimed and outlives scopes.
+    std::atomic<bool> m_claimed;
+};
+
+//
+// Thread Owner Macros
+//  Claim, release and check owners declared under THREAD_OWNER_CHECKS.
+//
+//  Behaviour in different build types:
+//  - THREAD_OWNER_CHECKS defined: Asserts when a thread does not own an instance
+//  - Otherwise: Stripped
+//
+
+#if defined(THREAD_OWNER_CHECKS)
+    #define THREAD_OWNER_CLAIM(owner) (owner).Claim()
+    #define THREAD_OWNER_RELEASE(owner) (owner).Release()
+    #define THREAD_OWNER_CHECK(owner, message) Assert((owner).IsOwner(), message)
+
+    #define THREAD_OWNER_SCOPE(owner, message)                  \
+        ThreadOwner::Scope threadOwnerScope(owner);             \
+        Assert(threadOwnerScope.IsEntered(), message)
+#else
+    #define THREAD_OWNER_CLAIM(owner) ((void)0)
+    #define THREAD_OWNER_RELEASE(owner) ((void)0)
+    #define THREAD_OWNER_CHECK(owner, message) ((void)0)
+    #define THREAD_OWNER_SCOPE(owner, message) ((void)0)
+#endif
@@ -1,30 +1,156 @@
 #include "Precompiled.hpp"
 #include "Utility.hpp"
 
-std::string Utility::GetFilePath(std::string filename)
+namespace
 {
-    std::string path;
-
-    std::size_t it = filename.find_last_of("/\\");
-    if(it != std::string::npos)
+    // Checks if a character separates path segments.
+    bool IsSeparator(char character)
     {
-        path = filename.substr(0, it + 1);
+        return character == '/' || character == '\\';
     }
+}
 
-    return path;
+std::string Utility::GetFilePath(const std::string& filename)
+{
+    return GetFilePathView(filename).ToString();
 }
 
-std::string Utility::GetFileExtension(std::string filename)
+std::string Utility::GetFileExtension(const std::string& filename)
 {
-    std::string extension;
+    return GetFileExtensionView(filename).ToString();
+}
+
+StringView Utility::GetFilePathView(StringView filename)
+{
+    std::size_t separator = filename.FindLastOf("/\\");
+
+    if(separator == StringView::NotFound)
+        return StringView();
+
+    return filename.Substring(0, separator + 1);
+}
+
+StringView Utility::GetFileNameView(StringView filename)
+{
+    std::size_t separator = filename.FindLastOf("/\\");
+
+    if(separator == StringView::NotFound)
+        return filename;
+
+    return filename.Substring(separator + 1);
+}
+
+StringView Utility::GetFileExtensionView(StringView filename)
+{
+    // Only look for a dot in the name, so dots in directories are skipped.
+    StringView name = GetFileNameView(filename);
+    std::size_t dot = name.FindLastOf(".");
+
+    if(dot == StringView::NotFound)
+        return StringView();
+
+    return name.Substring(dot + 1);
+}
+
+void Utility::NormalizePath(std::string& path)
+{
+    // Rewrite segments in place, as the result is never longer than the path.
+    // Each kept segment is followed by a separator if the path had one there.
+    std::size_t size = path.size();
+
+    if(size == 0)
+        return;
+
+    char* data = &path[0];
+
+    std::size_t read = 0;
+    std::size_t write = 0;
+
+    bool absolute = IsSeparator(data[0]);
 
-    std::size_t it = filename.find_last_of(".");
-    if(it != std::string::npos)
+    if(absolute)
     {
-        extension = filename.substr(it + 1);
+        data[write++] = '/';
     }
 
-    return extension;
+    std::size_t root = write;
+
+    while(read < size)
+    {
+        // Find the next segment.
+        while(read < size && IsSeparator(data[read]))
+        {
+            ++read;
+        }
+
+        if(read == size)
+            break;
+
+        std::size_t start = read;
+
+        while(read < size && !IsSeparator(data[read]))
+        {
+            ++read;
+        }
+
+        std::size_t length = read - start;
+
+        // Skip current directory segments.
+        if(length == 1 && data[start] == '.')
+            continue;
+
+        // Remove the preceding segment for parent directory segments.
+        // Relative paths keep leading parent segments that can't be resolved.
+        if(length == 2 && data[start] == '.' && data[start + 1] == '.')
+        {
+            if(write > root)
+            {
+                std::size_t previous = write - 1;
+
+                while(previous > root && data[previous - 1] != '/')
+                {
+                    --previous;
+                }
+
+                bool parent = write - previous == 3 && data[previous] == '.' && data[previous + 1] == '.';
+
+                if(!parent)
+                {
+                    write = previous;
+                    continue;
+                }
+            }
+            else if(absolute)
+            {
+                continue;
+            }
+        }
+
+        // Move the segment and its separator.
+        std::memmove(data + write, data + start, length);
+        write += length;
+
+        if(read < size)
+        {
+            data[write++] = '/';
+        }
+    }
+
+    // Keep a trailing separator only if the path ended with one.
+    if(write > root && data[write - 1] == '/' && !IsSeparator(data[size - 1]))
+    {
+        --write;
+    }
+
+    path.resize(write);
+}
+
+void Utility::NormalizePaths(std::vector<std::string>& paths)
+{
+    for(std::string& path : paths)
+    {
+        NormalizePath(path);
+    }
 }
 
 std::string Utility::GetTextFileContent(std::string filename)
@@ -35,10 +161,17 @@ std::string Utility::GetTextFileContent(std::string filename)
     if(file)
     {
         file.seekg(0, std::ios::end);
-        content.resize((unsigned int)file.tellg());
+        std::streamoff size = file.tellg();
         file.seekg(0, std::ios::beg);
 
-        file.read(&content[0], content.size());
+        if(size > 0)
+        {
+            content.resize((std::size_t)size);
+            file.read(&content[0], size);
+
+            // Text mode translation can read fewer characters than the file size.
+            content.resize((std::size_t)file.gcount());
+        }
     }
 
     return content;
@@ -52,10 +185,17 @@ std::vector<char> Utility::GetBinaryFileContent(std::string filename)
     if(file)
     {
         file.seekg(0, std::ios::end);
-        content.resize((unsigned int)file.tellg());
+        std::streamoff size = file.tellg();
         file.seekg(0, std::ios::beg);
 
-        file.read(&content[0], content.size());
+        if(size > 0)
+        {
+            content.resize((std::size_t)size);
+            file.read(&content[0], size);
+
+            // File can shrink after its size has been measured.
+            content.resize((std::size_t)file.gcount());
+        }
     }
 
     return content;
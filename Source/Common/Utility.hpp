@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Precompiled.hpp"
+#include "StringView.hpp"
 
 //
 // Utility
@@ -22,11 +23,50 @@ namespace Utility
         container.swap(Type());
     }
 
-    // Gets the path of a file.
-    std::string GetFilePath(std::string filename);
+    // Mixes bits of a 64bit integer using the MurmurHash3 finalizer.
+    // Turns sequential values into evenly distributed hashes.
+    inline std::uint64_t HashMix(std::uint64_t value)
+    {
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdULL;
+        value ^= value >> 33;
+        value *= 0xc4ceb9fe1a85ec53ULL;
+        value ^= value >> 33;
+        return value;
+    }
+
+    // Counts trailing zero bits of a non zero 64bit integer.
+    inline int CountTrailingZeros(std::uint64_t value)
+    {
+        Assert(value != 0, "Counting trailing zeros of a zero value!");
+
+    #ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return (int)index;
+    #else
+        return __builtin_ctzll(value);
+    #endif
+    }
+
+    // Gets the path of a file, including its trailing separator.
+    std::string GetFilePath(const std::string& filename);
+
+    // Gets the extension of a file, without its dot.
+    std::string GetFileExtension(const std::string& filename);
+
+    // Gets parts of a file name as views into it, without allocating.
+    StringView GetFilePathView(StringView filename);
+    StringView GetFileNameView(StringView filename);
+    StringView GetFileExtensionView(StringView filename);
+
+    // Normalizes a path in place, without allocating.
+    // Separators become forward slashes, repeated separators and "." segments
+    // are removed and ".." segments are resolved against preceding segments.
+    void NormalizePath(std::string& path);
 
-    // Gets the extension of a file.
-    std::string GetFileExtension(std::string filename);
+    // Normalizes many paths in place.
+    void NormalizePaths(std::vector<std::string>& paths);
 
     // Gets the content of a text file.
     std::string GetTextFileContent(std::string filename);
@@ -0,0 +1,695 @@
+#include "Precompiled.hpp"
+#include "BoundingVolumeTree.hpp"
+using namespace Game;
+
+// Select the instruction set for tracing ray packets.
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define BOUNDING_VOLUME_TREE_SSE
+#endif
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize the bounding volume tree! "
+
+    // Constant variables.
+    const int InvalidProxy = -1;
+
+    // Number of rays traced together.
+    const int PacketSize = 4;
+
+    // Number of packets traced by a single job.
+    const int PacketGrainSize = 8;
+
+    // Maximum depth of pending nodes during traversal.
+    // Trees are balanced, so this holds any number of entities.
+    const int TraversalStackSize = 64;
+
+    // Growth of surface area of a subtree that triggers its rebuild.
+    const float RebuildAreaRatio = 1.5f;
+
+    // Bounds of removed proxies that never overlap.
+    const float Infinity = std::numeric_limits<float>::infinity();
+
+    // Calculates the surface area of bounds.
+    float CalculateSurfaceArea(const glm::vec3& minimum, const glm::vec3& maximum)
+    {
+        glm::vec3 size = glm::max(maximum - minimum, glm::vec3(0.0f));
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    // Calculates inverse ray directions.
+    // Parallel axes get huge finite values, which keeps slab tests free of NaNs.
+    glm::vec3 CalculateInverseDirection(const glm::vec3& direction)
+    {
+        glm::vec3 inverse;
+
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            float component = direction[axis];
+
+            if(std::abs(component) < 1e-20f)
+            {
+                component = component < 0.0f ? -1e-20f : 1e-20f;
+            }
+
+            inverse[axis] = 1.0f / component;
+        }
+
+        return inverse;
+    }
+
+    // Intersects a ray with bounds between zero and a maximum distance.
+    bool IntersectBounds(const glm::vec3& origin, const glm::vec3& inverseDirection, float maximumDistance,
+        const glm::vec3& minimum, const glm::vec3& maximum, float& distance)
+    {
+        glm::vec3 first = (minimum - origin) * inverseDirection;
+        glm::vec3 second = (maximum - origin) * inverseDirection;
+
+        glm::vec3 entries = glm::min(first, second);
+        glm::vec3 exits = glm::max(first, second);
+
+        float entry = std::max(std::max(entries.x, entries.y), std::max(entries.z, 0.0f));
+        float exit = std::min(std::min(exits.x, exits.y), std::min(exits.z, maximumDistance));
+
+        distance = entry;
+        return entry <= exit;
+    }
+}
+
+BoundingVolumeTree::Ray::Ray() :
+    origin(0.0f, 0.0f, 0.0f),
+    direction(0.0f, 0.0f, 1.0f),
+    length(std::numeric_limits<float>::max())
+{
+}
+
+BoundingVolumeTree::RaycastHit::RaycastHit() :
+    distance(0.0f)
+{
+}
+
+BoundingVolumeTree::BoundingVolumeTree() :
+    m_entitySystem(nullptr),
+    m_structureChanged(false),
+    m_entityCount(0),
+    m_rebuildCount(0),
+    m_initialized(false)
+{
+}
+
+BoundingVolumeTree::~BoundingVolumeTree()
+{
+    this->Cleanup();
+}
+
+void BoundingVolumeTree::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Unsubscribe from the entity system.
+    m_entityDestroy.Cleanup();
+    m_entitySystem = nullptr;
+
+    // Clear proxy arrays.
+    Utility::ClearContainer(m_proxyIndices);
+    Utility::ClearContainer(m_proxyEntities);
+    Utility::ClearContainer(m_proxyMinimums);
+    Utility::ClearContainer(m_proxyMaximums);
+    Utility::ClearContainer(m_freeProxies);
+    Utility::ClearContainer(m_removedProxies);
+
+    // Clear the tree.
+    Utility::ClearContainer(m_leaves);
+    Utility::ClearContainer(m_nodes);
+
+    m_structureChanged = false;
+    m_entityCount = 0;
+    m_rebuildCount = 0;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool BoundingVolumeTree::Initialize(EntitySystem* entitySystem)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(entitySystem == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid entity system.";
+        return false;
+    }
+
+    m_entitySystem = entitySystem;
+
+    // Remove destroyed entities.
+    m_entityDestroy.Bind<BoundingVolumeTree, &BoundingVolumeTree::OnEntityDestroy>(this);
+    m_entityDestroy.Subscribe(entitySystem->events.destroy);
+
+    // Success!
+    return m_initialized = true;
+}
+
+bool BoundingVolumeTree::Insert(const EntityHandle& entity, const glm::vec3& minimum, const glm::vec3& maximum)
+{
+    if(!m_initialized)
+        return false;
+
+    // Check arguments.
+    if(!m_entitySystem->IsHandleValid(entity) || this->Contains(entity))
+        return false;
+
+    // Make sure the index array can hold the entity.
+    int index = entity.GetIdentifier() - 1;
+
+    if(index >= (int)m_proxyIndices.size())
+    {
+        m_proxyIndices.resize(index + 1, InvalidProxy);
+    }
+
+    // Reuse a proxy removed before the last update or add a new one.
+    // Proxies removed since then may still be referenced by leaves.
+    int proxy = InvalidProxy;
+
+    if(!m_freeProxies.empty())
+    {
+        proxy = m_freeProxies.back();
+        m_freeProxies.pop_back();
+    }
+    else
+    {
+        proxy = (int)m_proxyEntities.size();
+
+        m_proxyEntities.emplace_back();
+        m_proxyMinimums.emplace_back();
+        m_proxyMaximums.emplace_back();
+    }
+
+    m_proxyEntities[proxy] = entity;
+    m_proxyMinimums[proxy] = minimum;
+    m_proxyMaximums[proxy] = maximum;
+    m_proxyIndices[index] = proxy;
+
+    m_entityCount += 1;
+    m_structureChanged = true;
+
+    return true;
+}
+
+bool BoundingVolumeTree::SetBounds(const EntityHandle& entity, const glm::vec3& minimum, const glm::vec3& maximum)
+{
+    int proxy = this->FindProxy(entity);
+
+    if(proxy == InvalidProxy)
+        return false;
+
+    m_proxyMinimums[proxy] = minimum;
+    m_proxyMaximums[proxy] = maximum;
+
+    return true;
+}
+
+bool BoundingVolumeTree::Remove(const EntityHandle& entity)
+{
+    int proxy = this->FindProxy(entity);
+
+    if(proxy == InvalidProxy)
+        return false;
+
+    // Turn the proxy into an empty box that queries skip.
+    m_proxyEntities[proxy] = EntityHandle();
+    m_proxyMinimums[proxy] = glm::vec3(Infinity);
+    m_proxyMaximums[proxy] = glm::vec3(-Infinity);
+    m_removedProxies.push_back(proxy);
+
+    m_proxyIndices[entity.GetIdentifier() - 1] = InvalidProxy;
+
+    m_entityCount -= 1;
+    m_structureChanged = true;
+
+    return true;
+}
+
+bool BoundingVolumeTree::Contains(const EntityHandle& entity) const
+{
+    return this->FindProxy(entity) != InvalidProxy;
+}
+
+void BoundingVolumeTree::Update()
+{
+    if(!m_initialized)
+        return;
+
+    m_rebuildCount = 0;
+
+    if(m_structureChanged)
+    {
+        // Removed proxies are no longer referenced after the rebuild.
+        m_freeProxies.insert(m_freeProxies.end(), m_removedProxies.begin(), m_removedProxies.end());
+        m_removedProxies.clear();
+
+        // Rebuild the whole tree over inserted proxies.
+        m_leaves.clear();
+
+        for(int proxy = 0; proxy < (int)m_proxyEntities.size(); ++proxy)
+        {
+            if(m_proxyEntities[proxy] != EntityHandle())
+            {
+                m_leaves.push_back(proxy);
+            }
+        }
+
+        int leafCount = (int)m_leaves.size();
+        m_nodes.resize(leafCount > 0 ? 2 * leafCount - 1 : 0);
+
+        if(leafCount > 0)
+        {
+            this->BuildSubtree(0, 0, leafCount);
+            m_rebuildCount = 1;
+        }
+
+        m_structureChanged = false;
+    }
+    else
+    {
+        // Refit moved bounds and rebuild where that made the tree too loose.
+        this->RefitNodes();
+        this->RebuildDegradedNodes();
+    }
+}
+
+bool BoundingVolumeTree::Raycast(const Ray& ray, RaycastHit& hit) const
+{
+    hit = RaycastHit();
+
+    if(m_nodes.empty())
+        return false;
+
+    glm::vec3 inverseDirection = CalculateInverseDirection(ray.direction);
+    float closest = ray.length;
+
+    // Traverse nodes with a stack, visiting nearer children first.
+    int stack[TraversalStackSize];
+    int stackSize = 0;
+
+    stack[stackSize++] = 0;
+
+    while(stackSize > 0)
+    {
+        int nodeIndex = stack[--stackSize];
+        const Node& node = m_nodes[nodeIndex];
+
+        float distance = 0.0f;
+
+        if(!IntersectBounds(ray.origin, inverseDirection, closest, node.minimum, node.maximum, distance))
+            continue;
+
+        if(node.leafCount == 1)
+        {
+            const EntityHandle& entity = m_proxyEntities[m_leaves[node.firstLeaf]];
+
+            if(entity == EntityHandle() || entity == ray.ignore)
+                continue;
+
+            closest = distance;
+
+            hit.entity = entity;
+            hit.distance = distance;
+            continue;
+        }
+
+        int left = nodeIndex + 1;
+        int right = nodeIndex + 2 * m_nodes[left].leafCount;
+
+        float leftDistance = glm::dot(m_nodes[left].minimum + m_nodes[left].maximum - 2.0f * ray.origin, ray.direction);
+        float rightDistance = glm::dot(m_nodes[right].minimum + m_nodes[right].maximum - 2.0f * ray.origin, ray.direction);
+
+        Assert(stackSize + 2 <= TraversalStackSize, "Traversal stack overflow!");
+
+        if(leftDistance <= rightDistance)
+        {
+            stack[stackSize++] = right;
+            stack[stackSize++] = left;
+        }
+        else
+        {
+            stack[stackSize++] = left;
+            stack[stackSize++] = right;
+        }
+    }
+
+    return hit.entity != EntityHandle();
+}
+
+void BoundingVolumeTree::RaycastBatch(const Ray* rays, RaycastHit* hits, int count, JobSystem* jobSystem) const
+{
+    Assert(count == 0 || (rays != nullptr && hits != nullptr), "Invalid ray or hit array!");
+
+    int packetCount = (count + PacketSize - 1) / PacketSize;
+
+    // Trace packets independently.
+    auto trace = [this, rays, hits, count](int begin, int end)
+    {
+        for(int packet = begin; packet < end; ++packet)
+        {
+            int first = packet * PacketSize;
+            int size = std::min(count - first, PacketSize);
+
+            this->RaycastPacket(rays + first, hits + first, size);
+        }
+    };
+
+    if(jobSystem != nullptr)
+    {
+        jobSystem->ParallelFor(packetCount, PacketGrainSize, trace);
+    }
+    else
+    {
+        trace(0, packetCount);
+    }
+}
+
+int BoundingVolumeTree::QueryBox(const glm::vec3& minimum, const glm::vec3& maximum, EntityList& results) const
+{
+    if(m_nodes.empty())
+        return 0;
+
+    int resultCount = 0;
+
+    int stack[TraversalStackSize];
+    int stackSize = 0;
+
+    stack[stackSize++] = 0;
+
+    while(stackSize > 0)
+    {
+        int nodeIndex = stack[--stackSize];
+        const Node& node = m_nodes[nodeIndex];
+
+        if(glm::any(glm::greaterThan(node.minimum, maximum)) || glm::any(glm::lessThan(node.maximum, minimum)))
+            continue;
+
+        if(node.leafCount == 1)
+        {
+            const EntityHandle& entity = m_proxyEntities[m_leaves[node.firstLeaf]];
+
+            if(entity != EntityHandle())
+            {
+                results.push_back(entity);
+                resultCount += 1;
+            }
+
+            continue;
+        }
+
+        Assert(stackSize + 2 <= TraversalStackSize, "Traversal stack overflow!");
+
+        stack[stackSize++] = nodeIndex + 2 * m_nodes[nodeIndex + 1].leafCount;
+        stack[stackSize++] = nodeIndex + 1;
+    }
+
+    return resultCount;
+}
+
+int BoundingVolumeTree::GetSize() const
+{
+    return m_entityCount;
+}
+
+int BoundingVolumeTree::GetNodeCount() const
+{
+    return (int)m_nodes.size();
+}
+
+int BoundingVolumeTree::GetRebuildCount() const
+{
+    return m_rebuildCount;
+}
+
+int BoundingVolumeTree::FindProxy(const EntityHandle& entity) const
+{
+    int index = entity.GetIdentifier() - 1;
+
+    if(index < 0 || index >= (int)m_proxyIndices.size())
+        return InvalidProxy;
+
+    int proxy = m_proxyIndices[index];
+
+    if(proxy == InvalidProxy || m_proxyEntities[proxy] != entity)
+        return InvalidProxy;
+
+    return proxy;
+}
+
+void BoundingVolumeTree::BuildSubtree(int nodeIndex, int firstLeaf, int leafCount)
+{
+    // Calculate bounds of proxies and of their centers.
+    glm::vec3 minimum(Infinity);
+    glm::vec3 maximum(-Infinity);
+    glm::vec3 centerMinimum(Infinity);
+    glm::vec3 centerMaximum(-Infinity);
+
+    for(int i = firstLeaf; i < firstLeaf + leafCount; ++i)
+    {
+        int proxy = m_leaves[i];
+        glm::vec3 center = m_proxyMinimums[proxy] + m_proxyMaximums[proxy];
+
+        minimum = glm::min(minimum, m_proxyMinimums[proxy]);
+        maximum = glm::max(maximum, m_proxyMaximums[proxy]);
+        centerMinimum = glm::min(centerMinimum, center);
+        centerMaximum = glm::max(centerMaximum, center);
+    }
+
+    Node& node = m_nodes[nodeIndex];
+    node.minimum = minimum;
+    node.maximum = maximum;
+    node.firstLeaf = firstLeaf;
+    node.leafCount = leafCount;
+    node.builtArea = CalculateSurfaceArea(minimum, maximum);
+
+    if(leafCount == 1)
+        return;
+
+    // Split proxies in halves along the longest axis of their centers.
+    glm::vec3 extent = centerMaximum - centerMinimum;
+    int axis = extent.x >= extent.y ? (extent.x >= extent.z ? 0 : 2) : (extent.y >= extent.z ? 1 : 2);
+
+    int leftCount = leafCount / 2;
+
+    auto begin = m_leaves.begin() + firstLeaf;
+
+    std::nth_element(begin, begin + leftCount, begin + leafCount, [this, axis](int first, int second)
+    {
+        float firstCenter = m_proxyMinimums[first][axis] + m_proxyMaximums[first][axis];
+        float secondCenter = m_proxyMinimums[second][axis] + m_proxyMaximums[second][axis];
+
+        return firstCenter < secondCenter || (firstCenter == secondCenter && first < second);
+    });
+
+    // Place the left subtree right after the node and the right one after it.
+    this->BuildSubtree(nodeIndex + 1, firstLeaf, leftCount);
+    this->BuildSubtree(nodeIndex + 2 * leftCount, firstLeaf + leftCount, leafCount - leftCount);
+}
+
+void BoundingVolumeTree::RefitNodes()
+{
+    // Children follow their parents, so a reverse pass visits them first.
+    for(int nodeIndex = (int)m_nodes.size() - 1; nodeIndex >= 0; --nodeIndex)
+    {
+        Node& node = m_nodes[nodeIndex];
+
+        if(node.leafCount == 1)
+        {
+            int proxy = m_leaves[node.firstLeaf];
+
+            node.minimum = m_proxyMinimums[proxy];
+            node.maximum = m_proxyMaximums[proxy];
+        }
+        else
+        {
+            const Node& left = m_nodes[nodeIndex + 1];
+            const Node& right = m_nodes[nodeIndex + 2 * left.leafCount];
+
+            node.minimum = glm::min(left.minimum, right.minimum);
+            node.maximum = glm::max(left.maximum, right.maximum);
+        }
+    }
+}
+
+void BoundingVolumeTree::RebuildDegradedNodes()
+{
+    // Walk nodes in depth first order and skip over rebuilt subtrees.
+    int nodeIndex = 0;
+
+    while(nodeIndex < (int)m_nodes.size())
+    {
+        const Node& node = m_nodes[nodeIndex];
+
+        float area = CalculateSurfaceArea(node.minimum, node.maximum);
+
+        if(node.leafCount > 1 && area > node.builtArea * RebuildAreaRatio)
+        {
+            int leafCount = node.leafCount;
+
+            this->BuildSubtree(nodeIndex, node.firstLeaf, leafCount);
+            m_rebuildCount += 1;
+
+            nodeIndex += 2 * leafCount - 1;
+        }
+        else
+        {
+            nodeIndex += 1;
+        }
+    }
+}
+
+void BoundingVolumeTree::RaycastPacket(const Ray* rays, RaycastHit* hits, int count) const
+{
+    Assert(count > 0 && count <= PacketSize, "Invalid packet size!");
+
+    // Prepare rays in separate arrays of components.
+    // Unused lanes have a negative length, so they never hit anything.
+    float originX[PacketSize], originY[PacketSize], originZ[PacketSize];
+    float inverseX[PacketSize], inverseY[PacketSize], inverseZ[PacketSize];
+    float closest[PacketSize];
+
+    for(int lane = 0; lane < PacketSize; ++lane)
+    {
+        const Ray& ray = rays[std::min(lane, count - 1)];
+        glm::vec3 inverseDirection = CalculateInverseDirection(ray.direction);
+
+        originX[lane] = ray.origin.x;
+        originY[lane] = ray.origin.y;
+        originZ[lane] = ray.origin.z;
+        inverseX[lane] = inverseDirection.x;
+        inverseY[lane] = inverseDirection.y;
+        inverseZ[lane] = inverseDirection.z;
+        closest[lane] = lane < count ? ray.length : -1.0f;
+    }
+
+    for(int lane = 0; lane < count; ++lane)
+    {
+        hits[lane] = RaycastHit();
+    }
+
+    if(m_nodes.empty())
+        return;
+
+#if defined(BOUNDING_VOLUME_TREE_SSE)
+    __m128 packetOriginX = _mm_loadu_ps(originX);
+    __m128 packetOriginY = _mm_loadu_ps(originY);
+    __m128 packetOriginZ = _mm_loadu_ps(originZ);
+    __m128 packetInverseX = _mm_loadu_ps(inverseX);
+    __m128 packetInverseY = _mm_loadu_ps(inverseY);
+    __m128 packetInverseZ = _mm_loadu_ps(inverseZ);
+#endif
+
+    // Traverse nodes hit by any ray of the packet.
+    int stack[TraversalStackSize];
+    int stackSize = 0;
+
+    stack[stackSize++] = 0;
+
+    while(stackSize > 0)
+    {
+        int nodeIndex = stack[--stackSize];
+        const Node& node = m_nodes[nodeIndex];
+
+        // Test the node against all rays at once.
+        int mask = 0;
+
+    #if defined(BOUNDING_VOLUME_TREE_SSE)
+        __m128 firstX = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.minimum.x), packetOriginX), packetInverseX);
+        __m128 firstY = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.minimum.y), packetOriginY), packetInverseY);
+        __m128 firstZ = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.minimum.z), packetOriginZ), packetInverseZ);
+        __m128 secondX = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.maximum.x), packetOriginX), packetInverseX);
+        __m128 secondY = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.maximum.y), packetOriginY), packetInverseY);
+        __m128 secondZ = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.maximum.z), packetOriginZ), packetInverseZ);
+
+        __m128 entry = _mm_max_ps(_mm_max_ps(_mm_min_ps(firstX, secondX), _mm_min_ps(firstY, secondY)),
+            _mm_max_ps(_mm_min_ps(firstZ, secondZ), _mm_setzero_ps()));
+        __m128 exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(firstX, secondX), _mm_max_ps(firstY, secondY)),
+            _mm_min_ps(_mm_max_ps(firstZ, secondZ), _mm_loadu_ps(closest)));
+
+        mask = _mm_movemask_ps(_mm_cmple_ps(entry, exit));
+    #else
+        for(int lane = 0; lane < PacketSize; ++lane)
+        {
+            float distance = 0.0f;
+
+            glm::vec3 origin(originX[lane], originY[lane], originZ[lane]);
+            glm::vec3 inverseDirection(inverseX[lane], inverseY[lane], inverseZ[lane]);
+
+            if(IntersectBounds(origin, inverseDirection, closest[lane], node.minimum, node.maximum, distance))
+            {
+                mask |= 1 << lane;
+            }
+        }
+    #endif
+
+        if(mask == 0)
+            continue;
+
+        if(node.leafCount == 1)
+        {
+            const EntityHandle& entity = m_proxyEntities[m_leaves[node.firstLeaf]];
+
+            if(entity == EntityHandle())
+                continue;
+
+            // Find exact distances for rays that hit the leaf.
+            for(; mask != 0; mask &= mask - 1)
+            {
+                int lane = (int)Utility::CountTrailingZeros((std::uint64_t)mask);
+
+                if(entity == rays[lane].ignore)
+                    continue;
+
+                float distance = 0.0f;
+
+                glm::vec3 origin(originX[lane], originY[lane], originZ[lane]);
+                glm::vec3 inverseDirection(inverseX[lane], inverseY[lane], inverseZ[lane]);
+
+                if(IntersectBounds(origin, inverseDirection, closest[lane], node.minimum, node.maximum, distance))
+                {
+                    closest[lane] = distance;
+
+                    hits[lane].entity = entity;
+                    hits[lane].distance = distance;
+                }
+            }
+
+            continue;
+        }
+
+        // Visit the child nearer along the first ray first.
+        int left = nodeIndex + 1;
+        int right = nodeIndex + 2 * m_nodes[left].leafCount;
+
+        float leftDistance = glm::dot(m_nodes[left].minimum + m_nodes[left].maximum - 2.0f * rays[0].origin, rays[0].direction);
+        float rightDistance = glm::dot(m_nodes[right].minimum + m_nodes[right].maximum - 2.0f * rays[0].origin, rays[0].direction);
+
+        Assert(stackSize + 2 <= TraversalStackSize, "Traversal stack overflow!");
+
+        if(leftDistance <= rightDistance)
+        {
+            stack[stackSize++] = right;
+            stack[stackSize++] = left;
+        }
+        else
+        {
+            stack[stackSize++] = left;
+            stack[stackSize++] = right;
+        }
+    }
+}
+
+void BoundingVolumeTree::OnEntityDestroy(EntitySystem::Events::Destroy event)
+{
+    this->Remove(event.handle);
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/JobSystem.hpp"
+#include "EntityHandle.hpp"
+#include "EntitySystem.hpp"
+
+//
+// Bounding Volume Tree
+//
+//  Binary tree of axis aligned bounding boxes of entities, for raycasts and
+//  region queries that only visit boxes along the way instead of scanning
+//  all entities. Nodes are stored in a flat array in depth first order,
+//  where the left child follows its parent and the right child follows the
+//  whole left subtree, so every subtree is a contiguous range of nodes.
+//
+//  Moving entities only refits bounds of nodes bottom up in a linear pass.
+//  Refitted subtrees whose surface area has grown too much compared to when
+//  they were built are rebuilt in place, which keeps the tree tight without
+//  rebuilding parts that are still fine. Inserting and removing entities
+//  rebuilds the whole tree at the next update, until which queries do not
+//  report inserted entities.
+//
+//  Raycasts can be batched and are then traced in packets of four rays,
+//  which test each node against all rays of a packet at once with SIMD
+//  instructions. Packets are traced in parallel on a job system. Queries
+//  only read the tree and can be run from multiple threads between updates.
+//
+//  Example usage:
+//      Game::BoundingVolumeTree tree;
+//      tree.Initialize(&entitySystem);
+//
+//      tree.Insert(entity, glm::vec3(-1.0f), glm::vec3(1.0f));
+//      tree.Update();
+//
+//      Game::BoundingVolumeTree::Ray ray;
+//      ray.origin = eyePosition;
+//      ray.direction = glm::normalize(targetPosition - eyePosition);
+//      ray.length = glm::distance(targetPosition, eyePosition);
+//      ray.ignore = agent;
+//
+//      Game::BoundingVolumeTree::RaycastHit hit;
+//      bool occluded = tree.Raycast(ray, hit);
+//
+//  Tracing line of sight checks of many agents at once:
+//      tree.RaycastBatch(rays.data(), hits.data(), (int)rays.size(), &jobSystem);
+//
+
+namespace Game
+{
+    // Bounding volume tree class.
+    class BoundingVolumeTree : private NonCopyable
+    {
+    public:
+        // Type declarations.
+        typedef std::vector<EntityHandle> EntityList;
+
+        // Ray segment starting at an origin.
+        struct Ray
+        {
+            Ray();
+
+            // Start and normalized direction.
+            glm::vec3 origin;
+            glm::vec3 direction;
+
+            // Distance along the direction where the ray ends.
+            float length;
+
+            // Entity whose bounds the ray passes through, such as the one casting it.
+            EntityHandle ignore;
+        };
+
+        // Closest box hit by a ray.
+        // Entity is invalid if nothing was hit.
+        struct RaycastHit
+        {
+            RaycastHit();
+
+            EntityHandle entity;
+            float distance;
+        };
+
+    public:
+        BoundingVolumeTree();
+        ~BoundingVolumeTree();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the bounding volume tree.
+        bool Initialize(EntitySystem* entitySystem);
+
+        // Inserts a bounding box of an entity.
+        // Returns false if the entity is not valid or has already been inserted.
+        bool Insert(const EntityHandle& entity, const glm::vec3& minimum, const glm::vec3& maximum);
+
+        // Changes the bounding box of an entity.
+        bool SetBounds(const EntityHandle& entity, const glm::vec3& minimum, const glm::vec3& maximum);
+
+        // Removes an entity.
+        bool Remove(const EntityHandle& entity);
+
+        // Checks if an entity has been inserted.
+        bool Contains(const EntityHandle& entity) const;
+
+        // Refits the tree to changed bounds and rebuilds degraded parts.
+        void Update();
+
+        // Finds the closest box hit by a ray.
+        bool Raycast(const Ray& ray, RaycastHit& hit) const;
+
+        // Finds the closest boxes hit by a number of rays.
+        // Traces on the calling thread if no job system is given.
+        void RaycastBatch(const Ray* rays, RaycastHit* hits, int count, JobSystem* jobSystem = nullptr) const;
+
+        // Finds entities with boxes overlapping a region.
+        // Appends entities to a list and returns their number.
+        int QueryBox(const glm::vec3& minimum, const glm::vec3& maximum, EntityList& results) const;
+
+        // Gets the number of inserted entities.
+        int GetSize() const;
+
+        // Gets the number of nodes and subtrees rebuilt at the last update.
+        int GetNodeCount() const;
+        int GetRebuildCount() const;
+
+    private:
+        // Tree node.
+        // Leaf nodes reference a single proxy.
+        struct Node
+        {
+            glm::vec3 minimum;
+            glm::vec3 maximum;
+
+            // Range of ordered proxies within the subtree.
+            int firstLeaf;
+            int leafCount;
+
+            // Surface area of bounds when the subtree was built.
+            float builtArea;
+        };
+
+        // Type declarations.
+        typedef std::vector<glm::vec3> BoundsList;
+        typedef std::vector<int> IndexList;
+        typedef std::vector<Node> NodeList;
+
+    private:
+        // Finds the proxy index of an entity or returns -1.
+        int FindProxy(const EntityHandle& entity) const;
+
+        // Builds a subtree of a range of ordered proxies at a node.
+        void BuildSubtree(int nodeIndex, int firstLeaf, int leafCount);
+
+        // Updates bounds of all nodes from bounds of proxies.
+        void RefitNodes();
+
+        // Rebuilds subtrees that have grown too much since they were built.
+        void RebuildDegradedNodes();
+
+        // Traces a packet of up to four rays.
+        void RaycastPacket(const Ray* rays, RaycastHit* hits, int count) const;
+
+        // Called when an entity is destroyed.
+        void OnEntityDestroy(EntitySystem::Events::Destroy event);
+
+    private:
+        // Entity system that owns the entities.
+        EntitySystem* m_entitySystem;
+
+        // Proxy indices indexed by entity handle identifiers.
+        IndexList m_proxyIndices;
+
+        // Proxies with their bounding boxes.
+        // Removed proxies are left as empty boxes and reused.
+        EntityList m_proxyEntities;
+        BoundsList m_proxyMinimums;
+        BoundsList m_proxyMaximums;
+        IndexList  m_freeProxies;
+
+        // Proxies removed since the last update, which leaves may still reference.
+        IndexList m_removedProxies;
+
+        // Proxies ordered by leaves of the tree.
+        IndexList m_leaves;
+
+        // Nodes in depth first order.
+        NodeList m_nodes;
+
+        // Whether proxies have been inserted or removed since the last update.
+        bool m_structureChanged;
+
+        // Number of inserted entities.
+        int m_entityCount;
+
+        // Number of subtrees rebuilt at the last update.
+        int m_rebuildCount;
+
+        // Entity system event receiver.
+        Receiver<void(EntitySystem::Events::Destroy)> m_entityDestroy;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
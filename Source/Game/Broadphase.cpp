@@ -0,0 +1,433 @@
+#include "Precompiled.hpp"
+#include "Broadphase.hpp"
+using namespace Game;
+
+// Select the widest available instruction set for sweeping.
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define BROADPHASE_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define BROADPHASE_SSE2
+#endif
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize the broadphase! "
+
+    // Constant variables.
+    const int InvalidProxy = -1;
+
+    // Number of sentinel elements after sorted bounds.
+    const int SweepPadding = 8;
+
+    // Average number of element shifts per proxy before insertion sort gives up.
+    const int MaximumAverageShifts = 8;
+
+    // Bounds of removed proxies and sentinels that never overlap.
+    const float Infinity = std::numeric_limits<float>::infinity();
+}
+
+Broadphase::Broadphase() :
+    m_entitySystem(nullptr),
+    m_entityCount(0),
+    m_initialized(false)
+{
+}
+
+Broadphase::~Broadphase()
+{
+    this->Cleanup();
+}
+
+void Broadphase::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Unsubscribe from the entity system.
+    m_entityDestroy.Cleanup();
+    m_entitySystem = nullptr;
+
+    // Cleanup event dispatchers.
+    this->events.enter.Cleanup();
+    this->events.exit.Cleanup();
+
+    // Clear proxy arrays.
+    Utility::ClearContainer(m_proxyIndices);
+    Utility::ClearContainer(m_proxyEntities);
+    Utility::ClearContainer(m_proxyMinimums);
+    Utility::ClearContainer(m_proxyMaximums);
+    Utility::ClearContainer(m_freeProxies);
+    Utility::ClearContainer(m_order);
+
+    Utility::ClearContainer(m_sortedEntities);
+
+    for(int axis = 0; axis < 3; ++axis)
+    {
+        Utility::ClearContainer(m_sortedMinimums[axis]);
+        Utility::ClearContainer(m_sortedMaximums[axis]);
+    }
+
+    // Clear pair lists.
+    Utility::ClearContainer(m_pairs);
+    Utility::ClearContainer(m_previousPairs);
+    Utility::ClearContainer(m_enteredPairs);
+    Utility::ClearContainer(m_exitedPairs);
+
+    m_entityCount = 0;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool Broadphase::Initialize(EntitySystem* entitySystem)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(entitySystem == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid entity system.";
+        return false;
+    }
+
+    m_entitySystem = entitySystem;
+
+    // Remove destroyed entities.
+    m_entityDestroy.Bind<Broadphase, &Broadphase::OnEntityDestroy>(this);
+    m_entityDestroy.Subscribe(entitySystem->events.destroy);
+
+    // Success!
+    return m_initialized = true;
+}
+
+bool Broadphase::Insert(const EntityHandle& entity, const glm::vec3& minimum, const glm::vec3& maximum)
+{
+    if(!m_initialized)
+        return false;
+
+    // Check arguments.
+    if(!m_entitySystem->IsHandleValid(entity) || this->Contains(entity))
+        return false;
+
+    // Make sure the index array can hold the entity.
+    int index = entity.GetIdentifier() - 1;
+
+    if(index >= (int)m_proxyIndices.size())
+    {
+        m_proxyIndices.resize(index + 1, InvalidProxy);
+    }
+
+    // Reuse a removed proxy or add a new one.
+    // New proxies are added to the sorted order at the next update.
+    int proxy = InvalidProxy;
+
+    if(!m_freeProxies.empty())
+    {
+        proxy = m_freeProxies.back();
+        m_freeProxies.pop_back();
+    }
+    else
+    {
+        proxy = (int)m_proxyEntities.size();
+
+        m_proxyEntities.emplace_back();
+        m_proxyMinimums.emplace_back();
+        m_proxyMaximums.emplace_back();
+    }
+
+    m_proxyEntities[proxy] = entity;
+    m_proxyMinimums[proxy] = minimum;
+    m_proxyMaximums[proxy] = maximum;
+    m_proxyIndices[index] = proxy;
+
+    m_entityCount += 1;
+
+    return true;
+}
+
+bool Broadphase::SetBounds(const EntityHandle& entity, const glm::vec3& minimum, const glm::vec3& maximum)
+{
+    int proxy = this->FindProxy(entity);
+
+    if(proxy == InvalidProxy)
+        return false;
+
+    m_proxyMinimums[proxy] = minimum;
+    m_proxyMaximums[proxy] = maximum;
+
+    return true;
+}
+
+bool Broadphase::Remove(const EntityHandle& entity)
+{
+    int proxy = this->FindProxy(entity);
+
+    if(proxy == InvalidProxy)
+        return false;
+
+    // Turn the proxy into an empty box that sorts after all others.
+    m_proxyEntities[proxy] = EntityHandle();
+    m_proxyMinimums[proxy] = glm::vec3(Infinity);
+    m_proxyMaximums[proxy] = glm::vec3(-Infinity);
+    m_freeProxies.push_back(proxy);
+
+    m_proxyIndices[entity.GetIdentifier() - 1] = InvalidProxy;
+
+    m_entityCount -= 1;
+
+    return true;
+}
+
+bool Broadphase::Contains(const EntityHandle& entity) const
+{
+    return this->FindProxy(entity) != InvalidProxy;
+}
+
+void Broadphase::Update()
+{
+    if(!m_initialized)
+        return;
+
+    // Find pairs overlapping in this update.
+    m_previousPairs.swap(m_pairs);
+    m_pairs.clear();
+
+    this->SortProxies();
+    this->SweepProxies();
+
+    std::sort(m_pairs.begin(), m_pairs.end());
+
+    // Compare sorted pairs with the previous update.
+    m_enteredPairs.clear();
+    m_exitedPairs.clear();
+
+    std::set_difference(m_pairs.begin(), m_pairs.end(), m_previousPairs.begin(), m_previousPairs.end(), std::back_inserter(m_enteredPairs));
+    std::set_difference(m_previousPairs.begin(), m_previousPairs.end(), m_pairs.begin(), m_pairs.end(), std::back_inserter(m_exitedPairs));
+
+    // Inform about pairs that stopped and started overlapping.
+    if(!m_exitedPairs.empty())
+    {
+        this->events.exit({ m_exitedPairs.data(), (int)m_exitedPairs.size() });
+    }
+
+    if(!m_enteredPairs.empty())
+    {
+        this->events.enter({ m_enteredPairs.data(), (int)m_enteredPairs.size() });
+    }
+}
+
+const Broadphase::Pair* Broadphase::GetPairs() const
+{
+    return m_pairs.data();
+}
+
+int Broadphase::GetPairCount() const
+{
+    return (int)m_pairs.size();
+}
+
+int Broadphase::GetSize() const
+{
+    return m_entityCount;
+}
+
+int Broadphase::FindProxy(const EntityHandle& entity) const
+{
+    int index = entity.GetIdentifier() - 1;
+
+    if(index < 0 || index >= (int)m_proxyIndices.size())
+        return InvalidProxy;
+
+    int proxy = m_proxyIndices[index];
+
+    if(proxy == InvalidProxy || m_proxyEntities[proxy] != entity)
+        return InvalidProxy;
+
+    return proxy;
+}
+
+void Broadphase::SortProxies()
+{
+    // Add proxies created since the last update.
+    for(int proxy = (int)m_order.size(); proxy < (int)m_proxyEntities.size(); ++proxy)
+    {
+        m_order.push_back(proxy);
+    }
+
+    // Resort the previous order with an insertion sort.
+    // Give up and sort from scratch if boxes have moved too much.
+    std::size_t shiftLimit = m_order.size() * MaximumAverageShifts;
+    std::size_t shiftCount = 0;
+
+    for(std::size_t i = 1; i < m_order.size(); ++i)
+    {
+        int proxy = m_order[i];
+        float key = m_proxyMinimums[proxy].x;
+
+        std::size_t j = i;
+
+        for(; j > 0 && m_proxyMinimums[m_order[j - 1]].x > key; --j)
+        {
+            m_order[j] = m_order[j - 1];
+        }
+
+        m_order[j] = proxy;
+        shiftCount += i - j;
+
+        if(shiftCount > shiftLimit)
+        {
+            std::sort(m_order.begin(), m_order.end(), [this](int first, int second)
+            {
+                return m_proxyMinimums[first].x < m_proxyMinimums[second].x;
+            });
+
+            break;
+        }
+    }
+}
+
+void Broadphase::SweepProxies()
+{
+    // Removed proxies have been sorted after all inserted ones.
+    int count = m_entityCount;
+
+    // Copy sorted bounds into separate arrays, followed by sentinels.
+    m_sortedEntities.resize(count);
+
+    for(int axis = 0; axis < 3; ++axis)
+    {
+        m_sortedMinimums[axis].resize(count + SweepPadding);
+        m_sortedMaximums[axis].resize(count + SweepPadding);
+    }
+
+    for(int i = 0; i < count; ++i)
+    {
+        int proxy = m_order[i];
+
+        Assert(m_proxyEntities[proxy] != EntityHandle(), "Removed proxy sorted before an inserted one!");
+
+        m_sortedEntities[i] = m_proxyEntities[proxy];
+
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            m_sortedMinimums[axis][i] = m_proxyMinimums[proxy][axis];
+            m_sortedMaximums[axis][i] = m_proxyMaximums[proxy][axis];
+        }
+    }
+
+    for(int i = count; i < count + SweepPadding; ++i)
+    {
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            m_sortedMinimums[axis][i] = Infinity;
+            m_sortedMaximums[axis][i] = -Infinity;
+        }
+    }
+
+    const float* minimumX = m_sortedMinimums[0].data();
+    const float* minimumY = m_sortedMinimums[1].data();
+    const float* minimumZ = m_sortedMinimums[2].data();
+    const float* maximumX = m_sortedMaximums[0].data();
+    const float* maximumY = m_sortedMaximums[1].data();
+    const float* maximumZ = m_sortedMaximums[2].data();
+
+    // Sweep along the X axis.
+    // Candidates start before the box ends on the sweep axis and the
+    // remaining axes are tested for several candidates at once.
+    for(int i = 0; i < count; ++i)
+    {
+    #if defined(BROADPHASE_AVX)
+        __m256 boxMaximumX = _mm256_set1_ps(maximumX[i]);
+        __m256 boxMinimumY = _mm256_set1_ps(minimumY[i]);
+        __m256 boxMaximumY = _mm256_set1_ps(maximumY[i]);
+        __m256 boxMinimumZ = _mm256_set1_ps(minimumZ[i]);
+        __m256 boxMaximumZ = _mm256_set1_ps(maximumZ[i]);
+
+        for(int j = i + 1; j < count; j += 8)
+        {
+            __m256 candidates = _mm256_cmp_ps(_mm256_loadu_ps(minimumX + j), boxMaximumX, _CMP_LE_OQ);
+            int candidateMask = _mm256_movemask_ps(candidates);
+
+            if(candidateMask == 0)
+                break;
+
+            __m256 overlap = candidates;
+            overlap = _mm256_and_ps(overlap, _mm256_cmp_ps(_mm256_loadu_ps(minimumY + j), boxMaximumY, _CMP_LE_OQ));
+            overlap = _mm256_and_ps(overlap, _mm256_cmp_ps(_mm256_loadu_ps(maximumY + j), boxMinimumY, _CMP_GE_OQ));
+            overlap = _mm256_and_ps(overlap, _mm256_cmp_ps(_mm256_loadu_ps(minimumZ + j), boxMaximumZ, _CMP_LE_OQ));
+            overlap = _mm256_and_ps(overlap, _mm256_cmp_ps(_mm256_loadu_ps(maximumZ + j), boxMinimumZ, _CMP_GE_OQ));
+
+            for(int mask = _mm256_movemask_ps(overlap); mask != 0; mask &= mask - 1)
+            {
+                this->AddPair(i, j + Utility::CountTrailingZeros((std::uint64_t)mask));
+            }
+
+            if(candidateMask != 0xFF)
+                break;
+        }
+    #elif defined(BROADPHASE_SSE2)
+        __m128 boxMaximumX = _mm_set1_ps(maximumX[i]);
+        __m128 boxMinimumY = _mm_set1_ps(minimumY[i]);
+        __m128 boxMaximumY = _mm_set1_ps(maximumY[i]);
+        __m128 boxMinimumZ = _mm_set1_ps(minimumZ[i]);
+        __m128 boxMaximumZ = _mm_set1_ps(maximumZ[i]);
+
+        for(int j = i + 1; j < count; j += 4)
+        {
+            __m128 candidates = _mm_cmple_ps(_mm_loadu_ps(minimumX + j), boxMaximumX);
+            int candidateMask = _mm_movemask_ps(candidates);
+
+            if(candidateMask == 0)
+                break;
+
+            __m128 overlap = candidates;
+            overlap = _mm_and_ps(overlap, _mm_cmple_ps(_mm_loadu_ps(minimumY + j), boxMaximumY));
+            overlap = _mm_and_ps(overlap, _mm_cmpge_ps(_mm_loadu_ps(maximumY + j), boxMinimumY));
+            overlap = _mm_and_ps(overlap, _mm_cmple_ps(_mm_loadu_ps(minimumZ + j), boxMaximumZ));
+            overlap = _mm_and_ps(overlap, _mm_cmpge_ps(_mm_loadu_ps(maximumZ + j), boxMinimumZ));
+
+            for(int mask = _mm_movemask_ps(overlap); mask != 0; mask &= mask - 1)
+            {
+                this->AddPair(i, j + Utility::CountTrailingZeros((std::uint64_t)mask));
+            }
+
+            if(candidateMask != 0xF)
+                break;
+        }
+    #else
+        for(int j = i + 1; j < count && minimumX[j] <= maximumX[i]; ++j)
+        {
+            if(minimumY[j] <= maximumY[i] && maximumY[j] >= minimumY[i] &&
+                minimumZ[j] <= maximumZ[i] && maximumZ[j] >= minimumZ[i])
+            {
+                this->AddPair(i, j);
+            }
+        }
+    #endif
+    }
+}
+
+void Broadphase::AddPair(int first, int second)
+{
+    // Sentinel lanes never overlap, so both indices are valid.
+    const EntityHandle& firstEntity = m_sortedEntities[first];
+    const EntityHandle& secondEntity = m_sortedEntities[second];
+
+    if(secondEntity < firstEntity)
+    {
+        m_pairs.emplace_back(secondEntity, firstEntity);
+    }
+    else
+    {
+        m_pairs.emplace_back(firstEntity, secondEntity);
+    }
+}
+
+void Broadphase::OnEntityDestroy(EntitySystem::Events::Destroy event)
+{
+    this->Remove(event.handle);
+}
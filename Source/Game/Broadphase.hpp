@@ -0,0 +1,165 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "EntityHandle.hpp"
+#include "EntitySystem.hpp"
+
+//
+// Broadphase
+//
+//  Finds pairs of entities with overlapping axis aligned bounding boxes using
+//  sort and sweep. Boxes are kept sorted by their minimum along the X axis and
+//  the order from the previous update is resorted with an insertion sort, which
+//  takes linear time when boxes move little between updates. The sweep copies
+//  sorted bounds into separate arrays and tests several candidates at once with
+//  wide compare instructions. Overlapping pairs are written into a flat list
+//  sorted by handles and compared with the pairs of the previous update, which
+//  produces events about pairs that started and stopped overlapping. Pairs are
+//  ordered, with the lower handle as the first element. Removed and destroyed
+//  entities stop overlapping at the next update.
+//
+//  Example usage:
+//      Game::Broadphase broadphase;
+//      broadphase.Initialize(&entitySystem);
+//
+//      broadphase.Insert(entity, glm::vec3(-1.0f), glm::vec3(1.0f));
+//      broadphase.Update();
+//
+//      for(int i = 0; i < broadphase.GetPairCount(); ++i)
+//      {
+//          const Game::Broadphase::Pair& pair = broadphase.GetPairs()[i];
+//      }
+//
+
+namespace Game
+{
+    // Broadphase class.
+    class Broadphase : private NonCopyable
+    {
+    public:
+        // Type declarations.
+        typedef std::pair<EntityHandle, EntityHandle> Pair;
+
+    public:
+        Broadphase();
+        ~Broadphase();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the broadphase.
+        bool Initialize(EntitySystem* entitySystem);
+
+        // Inserts a bounding box of an entity.
+        // Returns false if the entity is not valid or has already been inserted.
+        bool Insert(const EntityHandle& entity, const glm::vec3& minimum, const glm::vec3& maximum);
+
+        // Changes the bounding box of an entity.
+        bool SetBounds(const EntityHandle& entity, const glm::vec3& minimum, const glm::vec3& maximum);
+
+        // Removes an entity.
+        bool Remove(const EntityHandle& entity);
+
+        // Checks if an entity has been inserted.
+        bool Contains(const EntityHandle& entity) const;
+
+        // Finds overlapping pairs and dispatches enter and exit events.
+        void Update();
+
+        // Gets the sorted list of pairs overlapping at the last update.
+        const Pair* GetPairs() const;
+        int GetPairCount() const;
+
+        // Gets the number of inserted entities.
+        int GetSize() const;
+
+    public:
+        // Broadphase events.
+        // Spans are only valid for the duration of the dispatch.
+        struct Events
+        {
+            // Enter event.
+            // Pairs that started overlapping.
+            struct Enter
+            {
+                const Pair* pairs;
+                int count;
+            };
+
+            Dispatcher<void(Enter)> enter;
+
+            // Exit event.
+            // Pairs that stopped overlapping.
+            struct Exit
+            {
+                const Pair* pairs;
+                int count;
+            };
+
+            Dispatcher<void(Exit)> exit;
+        } events;
+
+    private:
+        // Type declarations.
+        typedef std::vector<EntityHandle> EntityList;
+        typedef std::vector<glm::vec3> BoundsList;
+        typedef std::vector<float> AxisList;
+        typedef std::vector<int> IndexList;
+        typedef std::vector<Pair> PairList;
+
+    private:
+        // Finds the proxy index of an entity or returns -1.
+        int FindProxy(const EntityHandle& entity) const;
+
+        // Sorts proxies by their minimums along the sweep axis.
+        void SortProxies();
+
+        // Collects overlapping pairs of sorted proxies.
+        void SweepProxies();
+
+        // Adds a pair of sorted proxies.
+        void AddPair(int first, int second);
+
+        // Called when an entity is destroyed.
+        void OnEntityDestroy(EntitySystem::Events::Destroy event);
+
+    private:
+        // Entity system that owns the entities.
+        EntitySystem* m_entitySystem;
+
+        // Proxy indices indexed by entity handle identifiers.
+        IndexList m_proxyIndices;
+
+        // Proxies with their bounding boxes.
+        // Removed proxies are left as empty boxes and reused.
+        EntityList m_proxyEntities;
+        BoundsList m_proxyMinimums;
+        BoundsList m_proxyMaximums;
+        IndexList  m_freeProxies;
+
+        // Proxy indices sorted along the sweep axis.
+        IndexList m_order;
+
+        // Sorted bounds split by axes, padded for wide loads.
+        EntityList m_sortedEntities;
+        AxisList   m_sortedMinimums[3];
+        AxisList   m_sortedMaximums[3];
+
+        // Overlapping pairs of the current and previous update.
+        PairList m_pairs;
+        PairList m_previousPairs;
+
+        // Pairs that started and stopped overlapping.
+        PairList m_enteredPairs;
+        PairList m_exitedPairs;
+
+        // Number of inserted entities.
+        int m_entityCount;
+
+        // Entity system event receiver.
+        Receiver<void(EntitySystem::Events::Destroy)> m_entityDestroy;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,1022 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/JobSystem.hpp"
+#include "EntityHandle.hpp"
+#include "EntitySystem.hpp"
+
+//
+// Component Pool
+//
+//  Stores components of a single type in a densely packed array.
+//  A sparse array indexed by entity handle identifiers points into the
+//  dense array, which gives constant time access without any hashing.
+//  Removing a component moves the last one in its place, so the order
+//  of components is not preserved. Components of destroyed entities
+//  are removed automatically.
+//
+//  Example usage:
+//      Game::ComponentPool<Transform> transforms;
+//      transforms.Initialize(&entitySystem);
+//
+//      transforms.Add(entity, Transform());
+//
+//      if(Transform* transform = transforms.Get(entity))
+//      {
+//          transform->position.x += 1.0f;
+//      }
+//
+//      transforms.Remove(entity);
+//
+//  Tracking changed components:
+//      transforms.Modify(entity)->position.x += 1.0f;
+//
+//      transforms.ForEachChanged(lastTick, [](const EntityHandle& entity, Transform& transform)
+//      {
+//          /* Only components changed after the last tick. */
+//      });
+//
+//      lastTick = transforms.AdvanceTick();
+//
+//  Iterating over components from multiple threads:
+//      transforms.ParallelForEach(jobSystem, 1024, [](const EntityHandle& entity, Transform& transform)
+//      {
+//          transform.position.x += 1.0f;
+//      });
+//
+//  Double buffering components for systems running in parallel:
+//      velocities.Initialize(&entitySystem, Game::ComponentStorage::DoubleBuffered);
+//
+//      velocities.ForEachBuffered([](const EntityHandle& entity, const Velocity& current, Velocity& next)
+//      {
+//          /* Read the state of the last tick and write the next one. */
+//      });
+//
+//      /*
+//          Written state becomes current at the next ProcessCommands() call.
+//      */
+//
+//  Reordering components for locality:
+//      transforms.SortByKey([](const EntityHandle& entity, const Transform& transform)
+//      {
+//          return (std::uint64_t)entity.GetIdentifier();
+//      });
+//
+//  Accessing components of a query validated once:
+//      transforms.FindDenseIndices(entities, count, denseIndices);
+//
+//      for(int i = 0; i < count; ++i)
+//      {
+//          if(denseIndices[i] >= 0)
+//          {
+//              components[denseIndices[i]].position.x += 1.0f;
+//          }
+//      }
+//
+//  Creating storage on demand for rarely used components:
+//      markers.Initialize(&entitySystem, Game::ComponentStorage::Single, 600);
+//
+//      /*
+//          Pool allocates nothing and receives no entity events until its
+//          first component is added. After it has been empty for 600 ticks,
+//          its arrays are released again.
+//      */
+//
+//  Iterating over the dense array:
+//      Transform* components = transforms.GetComponents();
+//
+//      for(int i = 0; i < transforms.GetSize(); ++i)
+//      {
+//          components[i].position.x += 1.0f;
+//      }
+//
+
+namespace Game
+{
+    // Storage modes of component pools.
+    struct ComponentStorage
+    {
+        enum Type
+        {
+            // Components are read and written in place.
+            Single,
+
+            // Systems read the current state of components from the last tick
+            // and write their next state into a second array. Arrays are swapped
+            // at the end of every ProcessCommands() call and the next state is
+            // then seeded from the current one, so unwritten components keep
+            // their values. Readers and writers of such components do not
+            // conflict and can run in parallel.
+            DoubleBuffered,
+        };
+    };
+
+    // Component pool class.
+    template<typename Type>
+    class ComponentPool : private NonCopyable
+    {
+    public:
+        // Type declarations.
+        typedef std::uint64_t Tick;
+        typedef std::uint64_t Epoch;
+
+        // Release delay of pools that keep their storage and subscriptions.
+        static const int NeverRelease = -1;
+
+    public:
+        ComponentPool();
+        ~ComponentPool();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the component pool.
+        // Pools with a release delay are created on demand. They subscribe to entity
+        // events only while they hold components, so they are invoked after receivers
+        // of the same priority that subscribed earlier, and release their arrays
+        // once they have been empty for a number of ProcessCommands() calls.
+        bool Initialize(EntitySystem* entitySystem, ComponentStorage::Type storage = ComponentStorage::Single, int releaseDelay = NeverRelease);
+
+        // Adds or replaces a component of an entity.
+        // Double buffered components get both their current and next state set.
+        // Returns nullptr if the entity handle is not valid.
+        Type* Add(const EntityHandle& entity, const Type& component = Type());
+
+        // Removes a component of an entity.
+        bool Remove(const EntityHandle& entity);
+
+        // Gets a component of an entity.
+        // Returns nullptr if the entity has no component in this pool.
+        Type* Get(const EntityHandle& entity);
+        const Type* Get(const EntityHandle& entity) const;
+
+        // Gets a component of an entity and marks it as changed.
+        // Returns nullptr if the entity has no component in this pool.
+        Type* Modify(const EntityHandle& entity);
+
+        // Marks a component of an entity as changed.
+        void MarkChanged(const EntityHandle& entity);
+
+        // Checks if an entity has a component in this pool.
+        bool Has(const EntityHandle& entity) const;
+
+        // Gets a component of an entity without checking its handle.
+        // Entity must have a component in this pool, which is only asserted in debug builds.
+        Type* GetUnchecked(const EntityHandle& entity);
+        const Type* GetUnchecked(const EntityHandle& entity) const;
+
+        // Finds dense indices of components of entities, with -1 for entities without one.
+        // Validates handles of a query once, so components are then accessed by index.
+        // Returns the number of entities that have a component.
+        int FindDenseIndices(const EntityHandle* entities, int count, int* denseIndices) const;
+
+        // Calls a function for each component.
+        template<typename Function>
+        void ForEach(Function function);
+
+        // Calls a function for each component changed after a tick.
+        template<typename Function>
+        void ForEachChanged(Tick sinceTick, Function function);
+
+        // Gets the current tick and starts a new one.
+        // Changes made afterwards are stamped with a greater tick.
+        Tick AdvanceTick();
+
+        // Gets the current tick that stamps changed components.
+        Tick GetTick() const;
+
+        // Calls a function for each component from multiple threads.
+        // Function must be safe to call for different components at the same time.
+        template<typename Function>
+        void ParallelForEach(JobSystem& jobSystem, int grainSize, Function function);
+
+        // Reorders the dense arrays by 64bit keys computed for each component,
+        // keeping the current order of components with equal keys. Handles keep
+        // finding their components, but the storage epoch changes if any
+        // component moves. Must not be called while iterating over the pool.
+        template<typename KeyFunction>
+        void SortByKey(KeyFunction function);
+
+        // Gets the number of components.
+        int GetSize() const;
+
+        // Gets the number of components that fit in dense arrays before they grow.
+        int GetCapacity() const;
+
+        // Gets the number of entries of the sparse array,
+        // including ones of entities without a component.
+        int GetSparseSize() const;
+
+        // Gets the dense array of components.
+        Type* GetComponents();
+        const Type* GetComponents() const;
+
+        // Gets the dense array of entities, parallel to components.
+        const EntityHandle* GetEntities() const;
+
+        // Gets the dense array of change ticks, parallel to components.
+        const Tick* GetChangeTicks() const;
+
+        // Gets the next state of a double buffered component of an entity.
+        // Changes of the next state are not tracked by change ticks.
+        // Returns nullptr if the entity has no component in this pool.
+        Type* GetNext(const EntityHandle& entity);
+
+        // Gets the dense array of next states of double buffered components.
+        Type* GetNextComponents();
+
+        // Calls a function with the current and next state of each double buffered component.
+        template<typename Function>
+        void ForEachBuffered(Function function);
+
+        // Calls a function with the current and next state of each double buffered
+        // component from multiple threads.
+        template<typename Function>
+        void ParallelForEachBuffered(JobSystem& jobSystem, int grainSize, Function function);
+
+        // Makes the next state of double buffered components current.
+        // Called automatically at the end of every ProcessCommands() call.
+        void SwapBuffers();
+
+        // Checks if components are double buffered.
+        bool IsDoubleBuffered() const;
+
+        // Checks if storage is created on demand and released when unused.
+        bool IsOnDemand() const;
+
+        // Checks if the pool holds allocated arrays or entity event subscriptions.
+        bool IsResident() const;
+
+        // Checks if the instance is initialized.
+        bool IsInitialized() const;
+
+        // Gets the storage epoch, which changes whenever components are added,
+        // removed, reordered or swapped. Component pointers remain valid for
+        // as long as the epoch stays the same.
+        Epoch GetEpoch() const;
+
+    public:
+        // Component events.
+        // Listeners must not modify the pool that dispatched an event.
+        struct Events
+        {
+            // Add event.
+            // Dispatched after a component has been added.
+            struct Add
+            {
+                const EntityHandle handle;
+            };
+
+            Dispatcher<void(Add)> add;
+
+            // Remove event.
+            // Dispatched before a component is removed.
+            struct Remove
+            {
+                const EntityHandle handle;
+            };
+
+            Dispatcher<void(Remove)> remove;
+
+            // Cleanup event.
+            // Dispatched before the pool is cleaned up or destroyed.
+            struct Cleanup
+            {
+            };
+
+            Dispatcher<void(Cleanup)> cleanup;
+        } events;
+
+    private:
+        // Type declarations.
+        typedef std::vector<int> SparseList;
+        typedef std::vector<EntityHandle> EntityList;
+        typedef std::vector<Type> ComponentList;
+        typedef std::vector<Tick> TickList;
+        typedef std::vector<std::pair<std::uint64_t, int>> SortList;
+
+    private:
+        // Finds the dense index of an entity or returns -1.
+        int FindDenseIndex(const EntityHandle& entity) const;
+
+        // Subscribes an on demand pool to entity events when it receives its first component.
+        void AcquireStorage();
+
+        // Starts counting down the release of an on demand pool that became empty.
+        void ScheduleRelease();
+
+        // Releases arrays and subscriptions of an empty on demand pool.
+        void ReleaseStorage();
+
+        // Called when an entity is destroyed.
+        void OnEntityDestroy(EntitySystem::Events::Destroy event);
+
+        // Called at the end of every tick.
+        void OnCommandsProcessed(EntitySystem::Events::CommandsProcessed event);
+
+    private:
+        // Entity system instance.
+        EntitySystem* m_entitySystem;
+
+        // Dense indices indexed by entity handle identifiers.
+        SparseList m_sparse;
+
+        // Densely packed entities and their components.
+        EntityList m_entities;
+        ComponentList m_components;
+
+        // Next states of double buffered components, parallel to components.
+        ComponentList m_nextComponents;
+        ComponentStorage::Type m_storage;
+
+        // Ticks of the last change of each component.
+        TickList m_changeTicks;
+
+        // Current tick.
+        Tick m_tick;
+
+        // Storage epoch.
+        Epoch m_epoch;
+
+        // Number of ticks that an empty on demand pool waits before it is released,
+        // and the number of ticks it has been empty for.
+        int m_releaseDelay;
+        int m_emptyTicks;
+
+        // Keys and previous dense indices used when sorting.
+        SortList m_sortKeys;
+
+        // Entity system event receivers.
+        Receiver<void(EntitySystem::Events::Destroy)> m_entityDestroy;
+        Receiver<void(EntitySystem::Events::CommandsProcessed)> m_commandsProcessed;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
+
+// Template implementations.
+namespace Game
+{
+    template<typename Type>
+    ComponentPool<Type>::ComponentPool() :
+        m_entitySystem(nullptr),
+        m_storage(ComponentStorage::Single),
+        m_tick(1),
+        m_epoch(1),
+        m_releaseDelay(NeverRelease),
+        m_emptyTicks(0),
+        m_initialized(false)
+    {
+    }
+
+    template<typename Type>
+    ComponentPool<Type>::~ComponentPool()
+    {
+        this->Cleanup();
+    }
+
+    template<typename Type>
+    void ComponentPool<Type>::Cleanup()
+    {
+        if(!m_initialized)
+            return;
+
+        // Notify listeners that keep a pointer to this pool.
+        this->events.cleanup({});
+
+        // Unsubscribe from the entity system.
+        m_entityDestroy.Cleanup();
+        m_commandsProcessed.Cleanup();
+
+        // Cleanup event dispatchers.
+        this->events.add.Cleanup();
+        this->events.remove.Cleanup();
+        this->events.cleanup.Cleanup();
+
+        // Clear component arrays.
+        Utility::ClearContainer(m_sparse);
+        Utility::ClearContainer(m_entities);
+        Utility::ClearContainer(m_components);
+        Utility::ClearContainer(m_nextComponents);
+        Utility::ClearContainer(m_changeTicks);
+        Utility::ClearContainer(m_sortKeys);
+
+        // Reset the change tick.
+        m_tick = 1;
+
+        // Invalidate cached component pointers.
+        // Epoch is never reset, so it cannot match an earlier one.
+        m_epoch += 1;
+
+        // Reset the entity system.
+        m_entitySystem = nullptr;
+        m_storage = ComponentStorage::Single;
+        m_releaseDelay = NeverRelease;
+        m_emptyTicks = 0;
+
+        // Reset the initialization state.
+        m_initialized = false;
+    }
+
+    template<typename Type>
+    bool ComponentPool<Type>::Initialize(EntitySystem* entitySystem, ComponentStorage::Type storage, int releaseDelay)
+    {
+        // Cleanup this instance.
+        this->Cleanup();
+
+        // Setup a cleanup guard.
+        SCOPE_GUARD
+        (
+            if(!m_initialized)
+            {
+                m_initialized = true;
+                this->Cleanup();
+            }
+        );
+
+        // Validate arguments.
+        if(entitySystem == nullptr)
+        {
+            LogError() << "Failed to initialize a component pool! Invalid entity system.";
+            return false;
+        }
+
+        m_entitySystem = entitySystem;
+        m_storage = storage;
+        m_releaseDelay = std::max(releaseDelay, NeverRelease);
+
+        // Remove components of destroyed entities and swap double buffered components
+        // at tick boundaries. Pools created on demand subscribe with their first component.
+        m_entityDestroy.template Bind<ComponentPool<Type>, &ComponentPool<Type>::OnEntityDestroy>(this);
+        m_commandsProcessed.template Bind<ComponentPool<Type>, &ComponentPool<Type>::OnCommandsProcessed>(this);
+
+        if(m_releaseDelay == NeverRelease)
+        {
+            m_entityDestroy.Subscribe(m_entitySystem->events.destroy);
+
+            if(m_storage == ComponentStorage::DoubleBuffered)
+            {
+                m_commandsProcessed.Subscribe(m_entitySystem->events.commandsProcessed);
+            }
+        }
+
+        // Success!
+        return m_initialized = true;
+    }
+
+    template<typename Type>
+    Type* ComponentPool<Type>::Add(const EntityHandle& entity, const Type& component)
+    {
+        if(!m_initialized)
+            return nullptr;
+
+        // Check if the entity handle is valid.
+        if(!m_entitySystem->IsHandleValid(entity))
+            return nullptr;
+
+        // Replace an existing component.
+        int denseIndex = this->FindDenseIndex(entity);
+
+        if(denseIndex >= 0)
+        {
+            if(m_storage == ComponentStorage::DoubleBuffered)
+            {
+                m_nextComponents[denseIndex] = component;
+            }
+
+            m_components[denseIndex] = component;
+            m_changeTicks[denseIndex] = m_tick;
+            return &m_components[denseIndex];
+        }
+
+        // Make sure the sparse array can hold the entity.
+        int entityIndex = entity.GetIdentifier() - 1;
+
+        if(entityIndex >= (int)m_sparse.size())
+        {
+            m_sparse.resize(entityIndex + 1, -1);
+        }
+
+        // Receive entity events again once an on demand pool holds a component.
+        if(m_components.empty())
+        {
+            this->AcquireStorage();
+        }
+
+        // Add a component at the end of the dense array.
+        denseIndex = (int)m_components.size();
+
+        m_sparse[entityIndex] = denseIndex;
+        m_epoch += 1;
+
+        m_entities.push_back(entity);
+        m_components.push_back(component);
+        m_changeTicks.push_back(m_tick);
+
+        if(m_storage == ComponentStorage::DoubleBuffered)
+        {
+            m_nextComponents.push_back(component);
+        }
+
+        // Inform about an added component.
+        this->events.add({ entity });
+
+        Assert(this->FindDenseIndex(entity) == denseIndex, "Component pool has been modified while adding a component!");
+
+        return &m_components[denseIndex];
+    }
+
+    template<typename Type>
+    bool ComponentPool<Type>::Remove(const EntityHandle& entity)
+    {
+        if(!m_initialized)
+            return false;
+
+        int denseIndex = this->FindDenseIndex(entity);
+
+        if(denseIndex < 0)
+            return false;
+
+        // Inform about a component that is going to be removed.
+        this->events.remove({ entity });
+
+        Assert(this->FindDenseIndex(entity) == denseIndex, "Component pool has been modified while removing a component!");
+
+        // Move the last component in place of the removed one.
+        int lastIndex = (int)m_components.size() - 1;
+
+        if(denseIndex != lastIndex)
+        {
+            m_components[denseIndex] = std::move(m_components[lastIndex]);
+
+            if(m_storage == ComponentStorage::DoubleBuffered)
+            {
+                m_nextComponents[denseIndex] = std::move(m_nextComponents[lastIndex]);
+            }
+
+            m_entities[denseIndex] = m_entities[lastIndex];
+            m_changeTicks[denseIndex] = m_changeTicks[lastIndex];
+            m_sparse[m_entities[denseIndex].GetIdentifier() - 1] = denseIndex;
+        }
+
+        m_components.pop_back();
+
+        if(m_storage == ComponentStorage::DoubleBuffered)
+        {
+            m_nextComponents.pop_back();
+        }
+
+        m_entities.pop_back();
+        m_changeTicks.pop_back();
+        m_sparse[entity.GetIdentifier() - 1] = -1;
+        m_epoch += 1;
+
+        // Count down the release of an on demand pool that became empty.
+        if(m_components.empty())
+        {
+            this->ScheduleRelease();
+        }
+
+        return true;
+    }
+
+    template<typename Type>
+    Type* ComponentPool<Type>::Get(const EntityHandle& entity)
+    {
+        int denseIndex = this->FindDenseIndex(entity);
+
+        if(denseIndex < 0)
+            return nullptr;
+
+        return &m_components[denseIndex];
+    }
+
+    template<typename Type>
+    const Type* ComponentPool<Type>::Get(const EntityHandle& entity) const
+    {
+        int denseIndex = this->FindDenseIndex(entity);
+
+        if(denseIndex < 0)
+            return nullptr;
+
+        return &m_components[denseIndex];
+    }
+
+    template<typename Type>
+    Type* ComponentPool<Type>::Modify(const EntityHandle& entity)
+    {
+        int denseIndex = this->FindDenseIndex(entity);
+
+        if(denseIndex < 0)
+            return nullptr;
+
+        m_changeTicks[denseIndex] = m_tick;
+        return &m_components[denseIndex];
+    }
+
+    template<typename Type>
+    void ComponentPool<Type>::MarkChanged(const EntityHandle& entity)
+    {
+        int denseIndex = this->FindDenseIndex(entity);
+
+        if(denseIndex < 0)
+            return;
+
+        m_changeTicks[denseIndex] = m_tick;
+    }
+
+    template<typename Type>
+    bool ComponentPool<Type>::Has(const EntityHandle& entity) const
+    {
+        return this->FindDenseIndex(entity) >= 0;
+    }
+
+    template<typename Type>
+    Type* ComponentPool<Type>::GetUnchecked(const EntityHandle& entity)
+    {
+        Assert(this->FindDenseIndex(entity) >= 0, "Entity has no component in this pool!");
+        return &m_components[m_sparse[entity.GetIdentifier() - 1]];
+    }
+
+    template<typename Type>
+    const Type* ComponentPool<Type>::GetUnchecked(const EntityHandle& entity) const
+    {
+        Assert(this->FindDenseIndex(entity) >= 0, "Entity has no component in this pool!");
+        return &m_components[m_sparse[entity.GetIdentifier() - 1]];
+    }
+
+    template<typename Type>
+    int ComponentPool<Type>::FindDenseIndices(const EntityHandle* entities, int count, int* denseIndices) const
+    {
+        Assert(entities != nullptr || count == 0, "Input array of entity handles is nullptr!");
+        Assert(denseIndices != nullptr || count == 0, "Output array of dense indices is nullptr!");
+
+        int foundCount = 0;
+
+        for(int i = 0; i < count; ++i)
+        {
+            denseIndices[i] = this->FindDenseIndex(entities[i]);
+            foundCount += denseIndices[i] >= 0 ? 1 : 0;
+        }
+
+        return foundCount;
+    }
+
+    template<typename Type>
+    template<typename Function>
+    void ComponentPool<Type>::ForEach(Function function)
+    {
+        for(std::size_t i = 0; i < m_components.size(); ++i)
+        {
+            function(m_entities[i], m_components[i]);
+        }
+    }
+
+    template<typename Type>
+    template<typename Function>
+    void ComponentPool<Type>::ForEachChanged(Tick sinceTick, Function function)
+    {
+        // Scan the packed array of ticks to skip unchanged data.
+        for(std::size_t i = 0; i < m_changeTicks.size(); ++i)
+        {
+            if(m_changeTicks[i] > sinceTick)
+            {
+                function(m_entities[i], m_components[i]);
+            }
+        }
+    }
+
+    template<typename Type>
+    typename ComponentPool<Type>::Tick ComponentPool<Type>::AdvanceTick()
+    {
+        return m_tick++;
+    }
+
+    template<typename Type>
+    typename ComponentPool<Type>::Tick ComponentPool<Type>::GetTick() const
+    {
+        return m_tick;
+    }
+
+    template<typename Type>
+    template<typename Function>
+    void ComponentPool<Type>::ParallelForEach(JobSystem& jobSystem, int grainSize, Function function)
+    {
+        const EntityHandle* entities = m_entities.data();
+        Type* components = m_components.data();
+
+        jobSystem.ParallelFor((int)m_components.size(), grainSize, [&](int begin, int end)
+        {
+            for(int i = begin; i < end; ++i)
+            {
+                function(entities[i], components[i]);
+            }
+        });
+    }
+
+    template<typename Type>
+    template<typename KeyFunction>
+    void ComponentPool<Type>::SortByKey(KeyFunction function)
+    {
+        if(!m_initialized)
+            return;
+
+        // Compute keys paired with current dense indices.
+        // Indices break ties, which keeps the sort stable.
+        m_sortKeys.resize(m_components.size());
+
+        bool sorted = true;
+
+        for(std::size_t i = 0; i < m_components.size(); ++i)
+        {
+            m_sortKeys[i] = std::make_pair((std::uint64_t)function(m_entities[i], m_components[i]), (int)i);
+
+            if(i != 0 && m_sortKeys[i].first < m_sortKeys[i - 1].first)
+            {
+                sorted = false;
+            }
+        }
+
+        // Skip reordering if components are already in order.
+        if(sorted)
+            return;
+
+        std::sort(m_sortKeys.begin(), m_sortKeys.end());
+
+        // Move components into their new order.
+        EntityList entities;
+        ComponentList components;
+        ComponentList nextComponents;
+        TickList changeTicks;
+
+        entities.reserve(m_entities.size());
+        components.reserve(m_components.size());
+        nextComponents.reserve(m_nextComponents.size());
+        changeTicks.reserve(m_changeTicks.size());
+
+        for(const auto& key : m_sortKeys)
+        {
+            entities.push_back(m_entities[key.second]);
+            components.push_back(std::move(m_components[key.second]));
+            changeTicks.push_back(m_changeTicks[key.second]);
+
+            if(m_storage == ComponentStorage::DoubleBuffered)
+            {
+                nextComponents.push_back(std::move(m_nextComponents[key.second]));
+            }
+        }
+
+        m_entities.swap(entities);
+        m_components.swap(components);
+        m_nextComponents.swap(nextComponents);
+        m_changeTicks.swap(changeTicks);
+
+        // Remap sparse indices to new dense indices.
+        for(std::size_t i = 0; i < m_entities.size(); ++i)
+        {
+            m_sparse[m_entities[i].GetIdentifier() - 1] = (int)i;
+        }
+
+        // Invalidate cached component pointers.
+        m_epoch += 1;
+    }
+
+    template<typename Type>
+    int ComponentPool<Type>::GetSize() const
+    {
+        return (int)m_components.size();
+    }
+
+    template<typename Type>
+    int ComponentPool<Type>::GetCapacity() const
+    {
+        return (int)m_components.capacity();
+    }
+
+    template<typename Type>
+    int ComponentPool<Type>::GetSparseSize() const
+    {
+        return (int)m_sparse.size();
+    }
+
+    template<typename Type>
+    Type* ComponentPool<Type>::GetComponents()
+    {
+        return m_components.data();
+    }
+
+    template<typename Type>
+    const Type* ComponentPool<Type>::GetComponents() const
+    {
+        return m_components.data();
+    }
+
+    template<typename Type>
+    const EntityHandle* ComponentPool<Type>::GetEntities() const
+    {
+        return m_entities.data();
+    }
+
+    template<typename Type>
+    const typename ComponentPool<Type>::Tick* ComponentPool<Type>::GetChangeTicks() const
+    {
+        return m_changeTicks.data();
+    }
+
+    template<typename Type>
+    Type* ComponentPool<Type>::GetNext(const EntityHandle& entity)
+    {
+        Assert(m_storage == ComponentStorage::DoubleBuffered, "Component pool is not double buffered!");
+
+        int denseIndex = this->FindDenseIndex(entity);
+
+        if(denseIndex < 0)
+            return nullptr;
+
+        return &m_nextComponents[denseIndex];
+    }
+
+    template<typename Type>
+    Type* ComponentPool<Type>::GetNextComponents()
+    {
+        Assert(m_storage == ComponentStorage::DoubleBuffered, "Component pool is not double buffered!");
+
+        return m_nextComponents.data();
+    }
+
+    template<typename Type>
+    template<typename Function>
+    void ComponentPool<Type>::ForEachBuffered(Function function)
+    {
+        Assert(m_storage == ComponentStorage::DoubleBuffered, "Component pool is not double buffered!");
+
+        for(std::size_t i = 0; i < m_nextComponents.size(); ++i)
+        {
+            function(m_entities[i], static_cast<const Type&>(m_components[i]), m_nextComponents[i]);
+        }
+    }
+
+    template<typename Type>
+    template<typename Function>
+    void ComponentPool<Type>::ParallelForEachBuffered(JobSystem& jobSystem, int grainSize, Function function)
+    {
+        Assert(m_storage == ComponentStorage::DoubleBuffered, "Component pool is not double buffered!");
+
+        const EntityHandle* entities = m_entities.data();
+        const Type* components = m_components.data();
+        Type* nextComponents = m_nextComponents.data();
+
+        jobSystem.ParallelFor((int)m_nextComponents.size(), grainSize, [&](int begin, int end)
+        {
+            for(int i = begin; i < end; ++i)
+            {
+                function(entities[i], components[i], nextComponents[i]);
+            }
+        });
+    }
+
+    template<typename Type>
+    void ComponentPool<Type>::SwapBuffers()
+    {
+        if(m_storage != ComponentStorage::DoubleBuffered)
+            return;
+
+        // Swap arrays in constant time and seed the next state.
+        m_components.swap(m_nextComponents);
+        std::copy(m_components.begin(), m_components.end(), m_nextComponents.begin());
+
+        // Invalidate cached component pointers.
+        m_epoch += 1;
+    }
+
+    template<typename Type>
+    bool ComponentPool<Type>::IsDoubleBuffered() const
+    {
+        return m_storage == ComponentStorage::DoubleBuffered;
+    }
+
+    template<typename Type>
+    bool ComponentPool<Type>::IsOnDemand() const
+    {
+        return m_releaseDelay != NeverRelease;
+    }
+
+    template<typename Type>
+    bool ComponentPool<Type>::IsResident() const
+    {
+        return m_sparse.capacity() != 0 || m_components.capacity() != 0 || m_entityDestroy.IsSubscribed() || m_commandsProcessed.IsSubscribed();
+    }
+
+    template<typename Type>
+    bool ComponentPool<Type>::IsInitialized() const
+    {
+        return m_initialized;
+    }
+
+    template<typename Type>
+    typename ComponentPool<Type>::Epoch ComponentPool<Type>::GetEpoch() const
+    {
+        return m_epoch;
+    }
+
+    template<typename Type>
+    int ComponentPool<Type>::FindDenseIndex(const EntityHandle& entity) const
+    {
+        int entityIndex = entity.GetIdentifier() - 1;
+
+        if(entityIndex < 0 || entityIndex >= (int)m_sparse.size())
+            return -1;
+
+        int denseIndex = m_sparse[entityIndex];
+
+        // Check if the component belongs to the same version of the entity.
+        if(denseIndex < 0 || m_entities[denseIndex] != entity)
+            return -1;
+
+        return denseIndex;
+    }
+
+    template<typename Type>
+    void ComponentPool<Type>::AcquireStorage()
+    {
+        if(m_releaseDelay == NeverRelease)
+            return;
+
+        if(!m_entityDestroy.IsSubscribed())
+        {
+            m_entityDestroy.Subscribe(m_entitySystem->events.destroy);
+        }
+
+        // Empty pools that were counting down stay subscribed for swapping buffers.
+        if(m_storage == ComponentStorage::DoubleBuffered)
+        {
+            if(!m_commandsProcessed.IsSubscribed())
+            {
+                m_commandsProcessed.Subscribe(m_entitySystem->events.commandsProcessed);
+            }
+        }
+        else
+        {
+            m_commandsProcessed.Unsubscribe();
+        }
+
+        m_emptyTicks = 0;
+    }
+
+    template<typename Type>
+    void ComponentPool<Type>::ScheduleRelease()
+    {
+        if(m_releaseDelay == NeverRelease)
+            return;
+
+        // Empty pools have no components to remove when entities are destroyed.
+        m_entityDestroy.Unsubscribe();
+
+        if(!m_commandsProcessed.IsSubscribed())
+        {
+            m_commandsProcessed.Subscribe(m_entitySystem->events.commandsProcessed);
+        }
+
+        m_emptyTicks = 0;
+    }
+
+    template<typename Type>
+    void ComponentPool<Type>::ReleaseStorage()
+    {
+        Assert(m_components.empty(), "Releasing storage of a component pool that is not empty!");
+
+        m_commandsProcessed.Unsubscribe();
+
+        Utility::ClearContainer(m_sparse);
+        Utility::ClearContainer(m_entities);
+        Utility::ClearContainer(m_components);
+        Utility::ClearContainer(m_nextComponents);
+        Utility::ClearContainer(m_changeTicks);
+        Utility::ClearContainer(m_sortKeys);
+
+        // Invalidate cached component pointers.
+        m_epoch += 1;
+    }
+
+    template<typename Type>
+    void ComponentPool<Type>::OnEntityDestroy(EntitySystem::Events::Destroy event)
+    {
+        this->Remove(event.handle);
+    }
+
+    template<typename Type>
+    void ComponentPool<Type>::OnCommandsProcessed(EntitySystem::Events::CommandsProcessed event)
+    {
+        this->SwapBuffers();
+
+        // Release an on demand pool that stayed empty for long enough.
+        if(m_releaseDelay != NeverRelease && m_components.empty())
+        {
+            if(++m_emptyTicks >= m_releaseDelay)
+            {
+                this->ReleaseStorage();
+            }
+        }
+    }
+}
@@ -0,0 +1,1197 @@
+#include "Precompiled.hpp"
+#include "ComponentSystem.hpp"
+#include "Common/Checksum.hpp"
+using namespace Game;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize the component system! "
+    #define LogSaveSnapshotError() "Failed to save a component system snapshot! "
+    #define LogLoadSnapshotError() "Failed to load a component system snapshot! "
+
+    // Constant variables.
+    const int InvalidArchetype  = -1;
+    const int InvalidColumn     = -1;
+    const int InvalidTransition = -1;
+
+    // Snapshot format identification.
+    const std::uint32_t SnapshotMagic   = 0x53504D43; // "CMPS"
+    const std::uint32_t SnapshotVersion = 1;
+
+    // Snapshot header.
+    struct SnapshotHeader
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::int32_t archetypeCount;
+        std::int32_t reserved;
+    };
+
+    // Snapshot archetype header.
+    struct SnapshotArchetype
+    {
+        std::uint64_t signature;
+        std::int32_t chunkCapacity;
+        std::int32_t chunkCount;
+    };
+
+    // Snapshot component type description.
+    struct SnapshotComponent
+    {
+        std::uint32_t size;
+        std::uint32_t alignment;
+    };
+}
+
+ComponentSystemInfo::ComponentSystemInfo() :
+    entitySystem(nullptr),
+    chunkSize(16 * 1024),
+    reserveSize(0),
+    hugePages(false)
+{
+}
+
+ComponentSystem::ComponentSystem() :
+    m_tick(1),
+    m_initialized(false)
+{
+}
+
+ComponentSystem::~ComponentSystem()
+{
+    this->Cleanup();
+}
+
+void ComponentSystem::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Unsubscribe from the entity system.
+    m_entityFinalize.Cleanup();
+    m_entityDestroy.Cleanup();
+
+    // Clear events of signatures.
+    Utility::ClearContainer(m_signatureEvents);
+
+    // Clear the command list.
+    Utility::ClearContainer(m_commands);
+    Utility::ClearContainer(m_commandData);
+
+    // Clear archetypes.
+    Utility::ClearContainer(m_archetypes);
+    m_archetypeMap.clear();
+
+    // Release reserved chunks after archetypes returned them.
+    m_chunkPool.Cleanup();
+
+    // Clear entity locations.
+    Utility::ClearContainer(m_locations);
+
+    m_tick = 1;
+
+    // Reset initialization parameters.
+    m_info = ComponentSystemInfo();
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool ComponentSystem::Initialize(const ComponentSystemInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            m_initialized = true;
+            this->Cleanup();
+        }
+    );
+
+    // Validate initialization parameters.
+    if(info.entitySystem == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid entity system.";
+        return false;
+    }
+
+    if(info.chunkSize <= 0)
+    {
+        LogError() << LogInitializeError() << "Chunk size must be positive.";
+        return false;
+    }
+
+    m_info = info;
+
+    // Reserve address space for chunks.
+    if(m_info.reserveSize != 0)
+    {
+        BlockPoolInfo chunkPoolInfo;
+        chunkPoolInfo.blockSize = (std::size_t)m_info.chunkSize;
+        chunkPoolInfo.chunkBlockCount = std::max<std::size_t>(VirtualMemory::HugePageSize / m_info.chunkSize, 1);
+        chunkPoolInfo.reserveSize = m_info.reserveSize;
+        chunkPoolInfo.hugePages = m_info.hugePages;
+
+        if(!m_chunkPool.Initialize(chunkPoolInfo))
+        {
+            LogError() << LogInitializeError() << "Could not reserve memory for chunks.";
+            return false;
+        }
+    }
+
+    // Remove components of destroyed entities.
+    m_entityDestroy.Bind<ComponentSystem, &ComponentSystem::OnEntityDestroy>(this);
+    m_entityDestroy.Subscribe(m_info.entitySystem->events.destroy);
+
+    // Success!
+    return m_initialized = true;
+}
+
+void ComponentSystem::QueueCommand(ComponentCommands::Type type, const EntityHandle& entity, int component, const void* data, std::size_t size)
+{
+    Assert(m_initialized, "Component system is not initialized!");
+
+    // Copy component data.
+    std::size_t dataOffset = m_commandData.size();
+
+    if(size != 0)
+    {
+        m_commandData.resize(dataOffset + size);
+        std::memcpy(&m_commandData[dataOffset], data, size);
+    }
+
+    // Add a command to the queue.
+    ComponentCommand command;
+    command.type = type;
+    command.entity = entity;
+    command.component = component;
+    command.dataOffset = dataOffset;
+
+    m_commands.push_back(command);
+}
+
+void ComponentSystem::ProcessCommands()
+{
+    if(!m_initialized)
+        return;
+
+    for(const ComponentCommand& command : m_commands)
+    {
+        // Skip entities that have been destroyed.
+        if(!m_info.entitySystem->IsHandleValid(command.entity))
+            continue;
+
+        // Make sure there is a location entry for the entity.
+        this->ReserveLocations(command.entity.GetIdentifier());
+
+        const EntityLocation* location = this->FindLocation(command.entity);
+        int archetype = location != nullptr ? location->archetype : InvalidArchetype;
+        bool hasComponent = archetype != InvalidArchetype && m_archetypes[archetype]->columnIndices[command.component] != InvalidColumn;
+
+        switch(command.type)
+        {
+        case ComponentCommands::Add:
+            {
+                // Move the entity to an archetype with the added component.
+                EntityLocation target = hasComponent ? *location : this->MoveEntity(command.entity, this->FindAddTransition(archetype, command.component));
+
+                // Copy component data.
+                const ComponentTypeInfo& info = ComponentTypes::GetInfo(command.component);
+                std::memcpy(this->GetComponentData(target, command.component), &m_commandData[command.dataOffset], info.size);
+            }
+            break;
+
+        case ComponentCommands::Remove:
+            {
+                // Move the entity to an archetype without the removed component.
+                if(hasComponent)
+                {
+                    this->MoveEntity(command.entity, this->FindRemoveTransition(archetype, command.component));
+                }
+            }
+            break;
+        }
+    }
+
+    // Clear processed commands.
+    m_commands.clear();
+    m_commandData.clear();
+}
+
+void ComponentSystem::Instantiate(const Prefab& prefab, int count, EntityHandle* handles)
+{
+    Assert(count >= 0, "Attempting to instantiate a negative number of entities!");
+    Assert(handles != nullptr || count == 0, "Attempting to instantiate entities without an output array!");
+
+    if(!m_initialized || count == 0)
+        return;
+
+    // Create entities in a single batch.
+    m_info.entitySystem->CreateEntities(count, handles);
+
+    int archetypeIndex = this->AcquireArchetype(prefab.GetSignature());
+
+    if(archetypeIndex == InvalidArchetype)
+        return;
+
+    Archetype& archetype = *m_archetypes[archetypeIndex];
+
+    // Make sure there are location entries for all created entities.
+    int maximumIdentifier = 0;
+
+    for(int i = 0; i < count; ++i)
+    {
+        maximumIdentifier = std::max(maximumIdentifier, handles[i].GetIdentifier());
+    }
+
+    this->ReserveLocations(maximumIdentifier);
+
+    // Fill chunks with rows of entities.
+    int instantiated = 0;
+
+    while(instantiated < count)
+    {
+        Chunk& chunk = this->AcquireChunk(archetype);
+
+        int chunkIndex = (int)archetype.chunks.size() - 1;
+        int firstRow = chunk.count;
+        int rowCount = std::min(archetype.chunkCapacity - firstRow, count - instantiated);
+
+        // Write entity handles and their locations.
+        EntityHandle* entities = GetEntityColumn(chunk);
+
+        for(int i = 0; i < rowCount; ++i)
+        {
+            const EntityHandle& entity = handles[instantiated + i];
+            entities[firstRow + i] = entity;
+
+            EntityLocation& location = m_locations[entity.GetIdentifier() - 1];
+            location.archetype = archetypeIndex;
+            location.chunk = chunkIndex;
+            location.row = firstRow + i;
+        }
+
+        // Copy prefab values into each component column.
+        for(std::size_t column = 0; column < archetype.components.size(); ++column)
+        {
+            int component = archetype.components[column];
+            std::size_t size = ComponentTypes::GetInfo(component).size;
+
+            std::uint8_t* destination = chunk.memory.get() + archetype.columnOffsets[column] + size * firstRow;
+            std::memcpy(destination, prefab.GetComponentData(component), size);
+
+            // Double the number of copied values with each memory copy.
+            int copied = 1;
+
+            while(copied < rowCount)
+            {
+                int batch = std::min(copied, rowCount - copied);
+                std::memcpy(destination + size * copied, destination, size * batch);
+                copied += batch;
+            }
+        }
+
+        chunk.count += rowCount;
+        chunk.changeTick = m_tick;
+        archetype.entityCount += rowCount;
+        instantiated += rowCount;
+    }
+}
+
+void ComponentSystem::InstantiateColumns(ComponentSignature signature, int count, const std::uint8_t* const* columns, EntityHandle* handles)
+{
+    Assert(count >= 0, "Attempting to instantiate a negative number of entities!");
+    Assert(handles != nullptr || count == 0, "Attempting to instantiate entities without an output array!");
+
+    if(!m_initialized || count == 0)
+        return;
+
+    // Create entities in a single batch.
+    m_info.entitySystem->CreateEntities(count, handles);
+
+    this->InsertColumns(signature, count, columns, handles);
+}
+
+void ComponentSystem::InsertColumns(ComponentSignature signature, int count, const std::uint8_t* const* columns, const EntityHandle* handles)
+{
+    Assert(count >= 0, "Attempting to insert components of a negative number of entities!");
+    Assert(handles != nullptr || count == 0, "Attempting to insert components without entity handles!");
+
+    if(!m_initialized || count == 0)
+        return;
+
+    int archetypeIndex = this->AcquireArchetype(signature);
+
+    if(archetypeIndex == InvalidArchetype)
+        return;
+
+    Archetype& archetype = *m_archetypes[archetypeIndex];
+
+    // Make sure there are location entries for all created entities.
+    int maximumIdentifier = 0;
+
+    for(int i = 0; i < count; ++i)
+    {
+        maximumIdentifier = std::max(maximumIdentifier, handles[i].GetIdentifier());
+    }
+
+    this->ReserveLocations(maximumIdentifier);
+
+    // Fill chunks with rows of entities.
+    int instantiated = 0;
+
+    while(instantiated < count)
+    {
+        Chunk& chunk = this->AcquireChunk(archetype);
+
+        int chunkIndex = (int)archetype.chunks.size() - 1;
+        int firstRow = chunk.count;
+        int rowCount = std::min(archetype.chunkCapacity - firstRow, count - instantiated);
+
+        // Write entity handles and their locations.
+        EntityHandle* entities = GetEntityColumn(chunk);
+
+        for(int i = 0; i < rowCount; ++i)
+        {
+            const EntityHandle& entity = handles[instantiated + i];
+            entities[firstRow + i] = entity;
+
+            EntityLocation& location = m_locations[entity.GetIdentifier() - 1];
+            location.archetype = archetypeIndex;
+            location.chunk = chunkIndex;
+            location.row = firstRow + i;
+        }
+
+        // Copy a range of values into each component column.
+        for(std::size_t column = 0; column < archetype.components.size(); ++column)
+        {
+            std::size_t size = ComponentTypes::GetInfo(archetype.components[column]).size;
+
+            std::uint8_t* destination = chunk.memory.get() + archetype.columnOffsets[column] + size * firstRow;
+            std::memcpy(destination, columns[column] + size * instantiated, size * rowCount);
+        }
+
+        chunk.count += rowCount;
+        chunk.changeTick = m_tick;
+        archetype.entityCount += rowCount;
+        instantiated += rowCount;
+    }
+}
+
+void ComponentSystem::MigrateEntities(ComponentSystem& target, const EntityHandle* handles, int count, EntityMap<EntityHandle>& remap)
+{
+    Assert(count >= 0, "Attempting to migrate a negative number of entities!");
+    Assert(handles != nullptr || count == 0, "Input array of entity handles is nullptr!");
+    Assert(&target != this, "Attempting to migrate entities to the same component system!");
+
+    if(!m_initialized || !target.m_initialized || count <= 0 || handles == nullptr)
+        return;
+
+    Assert(m_commands.empty() && target.m_commands.empty(), "Migrating entities while there are unprocessed component commands left!");
+
+    remap.Reserve(remap.GetSize() + count);
+
+    for(int i = 0; i < count; ++i)
+    {
+        const EntityHandle& entity = handles[i];
+
+        // Detach components before the source handle gets released, so the destroy
+        // event dispatched by migration leaves the row to be moved below.
+        const EntityLocation* location = this->FindLocation(entity);
+        EntityLocation source = location != nullptr ? *location : EntityLocation();
+        int sourceArchetype = location != nullptr ? location->archetype : InvalidArchetype;
+
+        if(sourceArchetype != InvalidArchetype)
+        {
+            m_locations[entity.GetIdentifier() - 1].archetype = InvalidArchetype;
+        }
+
+        // Move the handle slot between entity systems.
+        EntityHandle migrated = m_info.entitySystem->MigrateEntity(*target.m_info.entitySystem, entity);
+
+        if(migrated == EntityHandle())
+        {
+            if(sourceArchetype != InvalidArchetype)
+            {
+                m_locations[entity.GetIdentifier() - 1] = source;
+            }
+
+            continue;
+        }
+
+        remap.Insert(entity, migrated);
+
+        if(sourceArchetype == InvalidArchetype)
+            continue;
+
+        // Append a row to the matching archetype of the target.
+        int targetArchetype = target.AcquireArchetype(m_archetypes[sourceArchetype]->signature);
+
+        target.ReserveLocations(migrated.GetIdentifier());
+        EntityLocation destination = target.AppendRow(targetArchetype, migrated);
+        target.m_locations[migrated.GetIdentifier() - 1] = destination;
+
+        // Copy component values and remove the source row.
+        for(int component : m_archetypes[sourceArchetype]->components)
+        {
+            std::size_t size = ComponentTypes::GetInfo(component).size;
+            std::memcpy(target.GetComponentData(destination, component), this->GetComponentData(source, component), size);
+        }
+
+        this->RemoveRow(source);
+    }
+}
+
+int ComponentSystem::AcquireArchetype(ComponentSignature signature)
+{
+    // Entities without components do not belong to any archetype.
+    if(signature == 0)
+        return InvalidArchetype;
+
+    // Find an existing archetype.
+    auto it = m_archetypeMap.find(signature);
+
+    if(it != m_archetypeMap.end())
+        return it->second;
+
+    // Create a new archetype.
+    std::unique_ptr<Archetype> archetype(new Archetype);
+    archetype->signature = signature;
+    archetype->chunkCapacity = 0;
+    archetype->entityCount = 0;
+    archetype->checkedEvents = 0;
+
+    std::fill(std::begin(archetype->columnIndices), std::end(archetype->columnIndices), InvalidColumn);
+    std::fill(std::begin(archetype->addTransitions), std::end(archetype->addTransitions), InvalidTransition);
+    std::fill(std::begin(archetype->removeTransitions), std::end(archetype->removeTransitions), InvalidTransition);
+
+    std::size_t rowSize = sizeof(EntityHandle);
+
+    for(int component = 0; component < ComponentTypes::MaximumCount; ++component)
+    {
+        if(signature & ComponentTypes::GetSignatureBit(component))
+        {
+            archetype->columnIndices[component] = (int)archetype->components.size();
+            archetype->components.push_back(component);
+
+            rowSize += ComponentTypes::GetInfo(component).size;
+        }
+    }
+
+    // Calculate how many entities fit in a chunk including column alignment.
+    int chunkCapacity = std::max((int)(m_info.chunkSize / rowSize), 1);
+
+    while(true)
+    {
+        std::size_t offset = sizeof(EntityHandle) * chunkCapacity;
+        archetype->columnOffsets.clear();
+
+        for(int component : archetype->components)
+        {
+            const ComponentTypeInfo& info = ComponentTypes::GetInfo(component);
+
+            offset = (offset + info.alignment - 1) / info.alignment * info.alignment;
+            archetype->columnOffsets.push_back(offset);
+            offset += info.size * chunkCapacity;
+        }
+
+        if(offset <= (std::size_t)m_info.chunkSize || chunkCapacity == 1)
+            break;
+
+        chunkCapacity -= 1;
+    }
+
+    archetype->chunkCapacity = chunkCapacity;
+
+    // Add the archetype to the list.
+    int archetypeIndex = (int)m_archetypes.size();
+    m_archetypes.push_back(std::move(archetype));
+    m_archetypeMap.emplace(signature, archetypeIndex);
+
+    return archetypeIndex;
+}
+
+int ComponentSystem::FindAddTransition(int archetype, int component)
+{
+    if(archetype == InvalidArchetype)
+        return this->AcquireArchetype(ComponentTypes::GetSignatureBit(component));
+
+    // Cache the transition between archetypes.
+    int transition = m_archetypes[archetype]->addTransitions[component];
+
+    if(transition == InvalidTransition)
+    {
+        ComponentSignature signature = m_archetypes[archetype]->signature | ComponentTypes::GetSignatureBit(component);
+
+        transition = this->AcquireArchetype(signature);
+        m_archetypes[archetype]->addTransitions[component] = transition;
+    }
+
+    return transition;
+}
+
+int ComponentSystem::FindRemoveTransition(int archetype, int component)
+{
+    Assert(archetype != InvalidArchetype, "Attempting to remove a component from an entity without any!");
+
+    // Cache the transition between archetypes.
+    int transition = m_archetypes[archetype]->removeTransitions[component];
+
+    if(transition == InvalidTransition)
+    {
+        ComponentSignature signature = m_archetypes[archetype]->signature & ~ComponentTypes::GetSignatureBit(component);
+
+        transition = this->AcquireArchetype(signature);
+        m_archetypes[archetype]->removeTransitions[component] = transition;
+    }
+
+    return transition;
+}
+
+const ComponentSystem::EntityLocation* ComponentSystem::FindLocation(const EntityHandle& entity) const
+{
+    int entityIndex = entity.GetIdentifier() - 1;
+
+    if(entityIndex < 0 || entityIndex >= (int)m_locations.size())
+        return nullptr;
+
+    const EntityLocation& location = m_locations[entityIndex];
+
+    if(location.archetype == InvalidArchetype)
+        return nullptr;
+
+    // Check if the location belongs to the same version of the entity.
+    Chunk& chunk = m_archetypes[location.archetype]->chunks[location.chunk];
+
+    if(GetEntityColumn(chunk)[location.row] != entity)
+        return nullptr;
+
+    return &location;
+}
+
+ComponentSystem::Chunk& ComponentSystem::AcquireChunk(Archetype& archetype)
+{
+    // Add a new chunk if the last one is full.
+    if(archetype.chunks.empty() || archetype.chunks.back().count == archetype.chunkCapacity)
+    {
+        Chunk chunk;
+        chunk.memory = this->AllocateChunk(GetChunkSize(archetype));
+        chunk.count = 0;
+        chunk.changeTick = m_tick;
+
+        archetype.chunks.push_back(std::move(chunk));
+    }
+
+    return archetype.chunks.back();
+}
+
+std::unique_ptr<std::uint8_t[], ComponentSystem::ChunkDeleter> ComponentSystem::AllocateChunk(std::size_t size)
+{
+    ChunkDeleter deleter;
+
+    // Chunks of archetypes with rows larger than the chunk size come from the heap.
+    if(m_chunkPool.IsInitialized() && size <= m_chunkPool.GetBlockSize())
+    {
+        deleter.pool = &m_chunkPool;
+        return std::unique_ptr<std::uint8_t[], ChunkDeleter>(static_cast<std::uint8_t*>(m_chunkPool.Allocate()), deleter);
+    }
+
+    return std::unique_ptr<std::uint8_t[], ChunkDeleter>(new std::uint8_t[size], deleter);
+}
+
+void ComponentSystem::ReserveLocations(int identifier)
+{
+    if(identifier > (int)m_locations.size())
+    {
+        EntityLocation location;
+        location.archetype = InvalidArchetype;
+        location.chunk = 0;
+        location.row = 0;
+
+        m_locations.resize(identifier, location);
+    }
+}
+
+void ComponentSystem::RebuildLocations()
+{
+    for(EntityLocation& location : m_locations)
+    {
+        location.archetype = InvalidArchetype;
+    }
+
+    for(std::size_t archetypeIndex = 0; archetypeIndex < m_archetypes.size(); ++archetypeIndex)
+    {
+        Archetype& archetype = *m_archetypes[archetypeIndex];
+
+        for(std::size_t chunkIndex = 0; chunkIndex < archetype.chunks.size(); ++chunkIndex)
+        {
+            Chunk& chunk = archetype.chunks[chunkIndex];
+            const EntityHandle* entities = GetEntityColumn(chunk);
+
+            for(int row = 0; row < chunk.count; ++row)
+            {
+                int identifier = entities[row].GetIdentifier();
+                this->ReserveLocations(identifier);
+
+                EntityLocation& location = m_locations[identifier - 1];
+                location.archetype = (int)archetypeIndex;
+                location.chunk = (int)chunkIndex;
+                location.row = row;
+            }
+        }
+    }
+}
+
+ComponentSystem::EntityLocation ComponentSystem::AppendRow(int archetypeIndex, const EntityHandle& entity)
+{
+    Archetype& archetype = *m_archetypes[archetypeIndex];
+
+    // Add a row at the end of the last chunk.
+    Chunk& chunk = this->AcquireChunk(archetype);
+
+    EntityLocation location;
+    location.archetype = archetypeIndex;
+    location.chunk = (int)archetype.chunks.size() - 1;
+    location.row = chunk.count;
+
+    GetEntityColumn(chunk)[location.row] = entity;
+
+    chunk.count += 1;
+    chunk.changeTick = m_tick;
+    archetype.entityCount += 1;
+
+    return location;
+}
+
+void ComponentSystem::RemoveRow(const EntityLocation& location)
+{
+    Archetype& archetype = *m_archetypes[location.archetype];
+    Chunk& chunk = archetype.chunks[location.chunk];
+    Chunk& lastChunk = archetype.chunks.back();
+
+    int lastRow = lastChunk.count - 1;
+
+    // Move the last row in place of the removed one to keep chunks packed.
+    if(&chunk != &lastChunk || location.row != lastRow)
+    {
+        for(std::size_t column = 0; column < archetype.components.size(); ++column)
+        {
+            std::size_t size = ComponentTypes::GetInfo(archetype.components[column]).size;
+            std::size_t offset = archetype.columnOffsets[column];
+
+            std::memcpy(chunk.memory.get() + offset + size * location.row, lastChunk.memory.get() + offset + size * lastRow, size);
+        }
+
+        EntityHandle movedEntity = GetEntityColumn(lastChunk)[lastRow];
+        GetEntityColumn(chunk)[location.row] = movedEntity;
+
+        m_locations[movedEntity.GetIdentifier() - 1] = location;
+    }
+
+    lastChunk.count -= 1;
+    archetype.entityCount -= 1;
+
+    chunk.changeTick = m_tick;
+    lastChunk.changeTick = m_tick;
+
+    // Free the last chunk once it becomes empty.
+    if(lastChunk.count == 0)
+    {
+        archetype.chunks.pop_back();
+    }
+}
+
+ComponentSystem::EntityLocation ComponentSystem::MoveEntity(const EntityHandle& entity, int archetype)
+{
+    int entityIndex = entity.GetIdentifier() - 1;
+    Assert(entityIndex >= 0 && entityIndex < (int)m_locations.size(), "Invalid entity location index!");
+
+    EntityLocation source = m_locations[entityIndex];
+    EntityLocation target = source;
+    target.archetype = InvalidArchetype;
+
+    // Append the entity to the target archetype.
+    if(archetype != InvalidArchetype)
+    {
+        target = this->AppendRow(archetype, entity);
+
+        // Copy components that both archetypes share.
+        if(source.archetype != InvalidArchetype)
+        {
+            for(int component : m_archetypes[archetype]->components)
+            {
+                if(m_archetypes[source.archetype]->columnIndices[component] == InvalidColumn)
+                    continue;
+
+                std::size_t size = ComponentTypes::GetInfo(component).size;
+                std::memcpy(this->GetComponentData(target, component), this->GetComponentData(source, component), size);
+            }
+        }
+    }
+
+    // Remove the entity from the source archetype.
+    if(source.archetype != InvalidArchetype)
+    {
+        this->RemoveRow(source);
+    }
+
+    m_locations[entityIndex] = target;
+
+    return target;
+}
+
+std::size_t ComponentSystem::GetChunkSize(const Archetype& archetype)
+{
+    // Last column reaches the end of a chunk.
+    return archetype.columnOffsets.back() + ComponentTypes::GetInfo(archetype.components.back()).size * archetype.chunkCapacity;
+}
+
+std::uint8_t* ComponentSystem::GetComponentData(const EntityLocation& location, int component)
+{
+    Archetype& archetype = *m_archetypes[location.archetype];
+
+    int column = archetype.columnIndices[component];
+
+    if(column == InvalidColumn)
+        return nullptr;
+
+    // Component data is handed out for writing.
+    Chunk& chunk = archetype.chunks[location.chunk];
+    chunk.changeTick = m_tick;
+
+    std::size_t size = ComponentTypes::GetInfo(component).size;
+    return chunk.memory.get() + archetype.columnOffsets[column] + size * location.row;
+}
+
+EntityHandle* ComponentSystem::GetEntityColumn(Chunk& chunk)
+{
+    // Entity column is always placed at the beginning of a chunk.
+    return reinterpret_cast<EntityHandle*>(chunk.memory.get());
+}
+
+ComponentSystem::FinalizeDispatcher& ComponentSystem::GetFinalizeEvent(ComponentSignature signature)
+{
+    Assert(m_initialized, "Component system is not initialized!");
+
+    // Start receiving finalize events once there is a receiver for them.
+    if(!m_entityFinalize.IsSubscribed())
+    {
+        m_entityFinalize.Bind<ComponentSystem, &ComponentSystem::OnEntityFinalize>(this);
+        m_entityFinalize.Subscribe(m_info.entitySystem->events.finalize);
+    }
+
+    return this->AcquireSignatureEvents(signature).finalize;
+}
+
+ComponentSystem::DestroyDispatcher& ComponentSystem::GetDestroyEvent(ComponentSignature signature)
+{
+    Assert(m_initialized, "Component system is not initialized!");
+
+    return this->AcquireSignatureEvents(signature).destroy;
+}
+
+ComponentSystem::SignatureEvents& ComponentSystem::AcquireSignatureEvents(ComponentSignature signature)
+{
+    Assert(signature != 0, "Signature events require at least one component!");
+
+    for(std::unique_ptr<SignatureEvents>& events : m_signatureEvents)
+    {
+        if(events->signature == signature)
+            return *events;
+    }
+
+    // Archetypes check new events the next time they are matched.
+    std::unique_ptr<SignatureEvents> events(new SignatureEvents);
+    events->signature = signature;
+
+    m_signatureEvents.push_back(std::move(events));
+
+    return *m_signatureEvents.back();
+}
+
+const std::vector<int>& ComponentSystem::MatchSignatureEvents(Archetype& archetype)
+{
+    // Events are only ever added, so only the ones added since the last call are checked.
+    while(archetype.checkedEvents < (int)m_signatureEvents.size())
+    {
+        ComponentSignature signature = m_signatureEvents[archetype.checkedEvents]->signature;
+
+        if((archetype.signature & signature) == signature)
+        {
+            archetype.events.push_back(archetype.checkedEvents);
+        }
+
+        archetype.checkedEvents += 1;
+    }
+
+    return archetype.events;
+}
+
+bool ComponentSystem::OnEntityFinalize(EntitySystem::Events::Finalize event)
+{
+    // Place components added before entities were created, so they are matched by them.
+    if(!m_commands.empty())
+    {
+        this->ProcessCommands();
+    }
+
+    const EntityLocation* location = this->FindLocation(event.handle);
+
+    if(location == nullptr)
+        return true;
+
+    // Invoke receivers of matching signatures only.
+    // Indices are used, as receivers can add events while being invoked.
+    Archetype& archetype = *m_archetypes[location->archetype];
+    this->MatchSignatureEvents(archetype);
+
+    for(std::size_t i = 0; i < archetype.events.size(); ++i)
+    {
+        FinalizeDispatcher& dispatcher = m_signatureEvents[archetype.events[i]]->finalize;
+
+        if(dispatcher.HasSubscribers() && !dispatcher(event))
+            return false;
+    }
+
+    return true;
+}
+
+void ComponentSystem::OnEntityDestroy(EntitySystem::Events::Destroy event)
+{
+    const EntityLocation* location = this->FindLocation(event.handle);
+
+    if(location == nullptr)
+        return;
+
+    // Inform receivers of matching signatures while components are still present.
+    if(!m_signatureEvents.empty())
+    {
+        Archetype& archetype = *m_archetypes[location->archetype];
+        this->MatchSignatureEvents(archetype);
+
+        for(std::size_t i = 0; i < archetype.events.size(); ++i)
+        {
+            DestroyDispatcher& dispatcher = m_signatureEvents[archetype.events[i]]->destroy;
+
+            if(dispatcher.HasSubscribers())
+            {
+                dispatcher(event);
+            }
+        }
+
+        location = this->FindLocation(event.handle);
+
+        if(location == nullptr)
+            return;
+    }
+
+    // Remove components of the destroyed entity.
+    EntityLocation source = *location;
+    this->RemoveRow(source);
+
+    m_locations[event.handle.GetIdentifier() - 1].archetype = InvalidArchetype;
+}
+
+int ComponentSystem::GetArchetypeCount() const
+{
+    return (int)m_archetypes.size();
+}
+
+ComponentSystem::Tick ComponentSystem::AdvanceTick()
+{
+    return m_tick++;
+}
+
+ComponentSystem::Tick ComponentSystem::GetTick() const
+{
+    return m_tick;
+}
+
+void ComponentSystem::UpdateChecksum(Checksum& checksum) const
+{
+    for(const std::unique_ptr<Archetype>& archetype : m_archetypes)
+    {
+        checksum.Update(archetype->signature);
+        checksum.Update<std::int32_t>(archetype->entityCount);
+
+        // Add used rows of columns, skipping unused memory of chunks.
+        for(const Chunk& chunk : archetype->chunks)
+        {
+            const std::uint8_t* memory = chunk.memory.get();
+
+            checksum.Update(memory, sizeof(EntityHandle) * chunk.count);
+
+            for(std::size_t column = 0; column < archetype->components.size(); ++column)
+            {
+                std::size_t size = ComponentTypes::GetInfo(archetype->components[column]).size;
+                checksum.Update(memory + archetype->columnOffsets[column], size * chunk.count);
+            }
+        }
+    }
+}
+
+bool ComponentSystem::SaveSnapshot(BinaryWriter& writer) const
+{
+    if(!m_initialized)
+    {
+        LogError() << LogSaveSnapshotError() << "Component system is not initialized.";
+        return false;
+    }
+
+    if(!m_commands.empty())
+    {
+        LogError() << LogSaveSnapshotError() << "There are unprocessed commands left.";
+        return false;
+    }
+
+    // Write the header.
+    SnapshotHeader header;
+    header.magic = SnapshotMagic;
+    header.version = SnapshotVersion;
+    header.archetypeCount = (std::int32_t)m_archetypes.size();
+    header.reserved = 0;
+
+    writer.Write(header);
+
+    // Write archetypes with raw chunk memory.
+    for(const std::unique_ptr<Archetype>& archetype : m_archetypes)
+    {
+        SnapshotArchetype archetypeHeader;
+        archetypeHeader.signature = archetype->signature;
+        archetypeHeader.chunkCapacity = archetype->chunkCapacity;
+        archetypeHeader.chunkCount = (std::int32_t)archetype->chunks.size();
+
+        writer.Write(archetypeHeader);
+
+        // Describe component types, so a different type registration can be detected.
+        std::vector<SnapshotComponent> components;
+
+        for(int component : archetype->components)
+        {
+            const ComponentTypeInfo& info = ComponentTypes::GetInfo(component);
+
+            SnapshotComponent description;
+            description.size = (std::uint32_t)info.size;
+            description.alignment = (std::uint32_t)info.alignment;
+
+            components.push_back(description);
+        }
+
+        writer.WriteArray(components.data(), components.size());
+
+        // Write whole chunks to keep their column layout.
+        std::size_t chunkSize = GetChunkSize(*archetype);
+
+        for(const Chunk& chunk : archetype->chunks)
+        {
+            writer.Write<std::int32_t>(chunk.count);
+            writer.WriteArray(chunk.memory.get(), chunkSize);
+        }
+    }
+
+    // Write entity locations.
+    writer.WriteArray(m_locations.data(), m_locations.size());
+
+    return true;
+}
+
+bool ComponentSystem::LoadSnapshot(BinaryReader& reader)
+{
+    if(!m_initialized)
+    {
+        LogError() << LogLoadSnapshotError() << "Component system is not initialized.";
+        return false;
+    }
+
+    // Make sure no existing component is going to be overwritten.
+    bool isEmpty = m_commands.empty();
+
+    for(const std::unique_ptr<Archetype>& archetype : m_archetypes)
+    {
+        isEmpty = isEmpty && archetype->entityCount == 0;
+    }
+
+    if(!isEmpty)
+    {
+        LogError() << LogLoadSnapshotError() << "Component system is not empty.";
+        return false;
+    }
+
+    // Read the header.
+    SnapshotHeader header;
+
+    if(!reader.Read(header) || header.magic != SnapshotMagic || header.archetypeCount < 0)
+    {
+        LogError() << LogLoadSnapshotError() << "Invalid snapshot data.";
+        return false;
+    }
+
+    if(header.version != SnapshotVersion)
+    {
+        LogError() << LogLoadSnapshotError() << "Unsupported snapshot version " << header.version << ".";
+        return false;
+    }
+
+    // Remove chunks copied so far if loading fails.
+    bool loaded = false;
+
+    SCOPE_GUARD_IF(!loaded,
+        for(std::unique_ptr<Archetype>& archetype : m_archetypes)
+        {
+            archetype->chunks.clear();
+            archetype->entityCount = 0;
+        }
+    );
+
+    // Read archetypes and copy their chunks.
+    std::vector<int> archetypeIndices;
+    bool remapped = false;
+
+    for(int i = 0; i < header.archetypeCount; ++i)
+    {
+        SnapshotArchetype archetypeHeader;
+        reader.Read(archetypeHeader);
+
+        std::size_t componentCount = 0;
+        const SnapshotComponent* components = reader.ReadArray<SnapshotComponent>(componentCount);
+
+        if(!reader.IsValid())
+        {
+            LogError() << LogLoadSnapshotError() << "Snapshot data is truncated.";
+            return false;
+        }
+
+        // Check that component types match the registered ones.
+        std::size_t componentIndex = 0;
+
+        for(int component = 0; component < ComponentTypes::MaximumCount; ++component)
+        {
+            if(!(archetypeHeader.signature & ComponentTypes::GetSignatureBit(component)))
+                continue;
+
+            if(component >= ComponentTypes::GetCount() || componentIndex >= componentCount)
+            {
+                LogError() << LogLoadSnapshotError() << "Snapshot contains an unregistered component type.";
+                return false;
+            }
+
+            const ComponentTypeInfo& info = ComponentTypes::GetInfo(component);
+            const SnapshotComponent& description = components[componentIndex++];
+
+            if(info.size != description.size || info.alignment != description.alignment)
+            {
+                LogError() << LogLoadSnapshotError() << "Snapshot component type does not match the registered one.";
+                return false;
+            }
+        }
+
+        if(componentIndex != componentCount || componentCount == 0)
+        {
+            LogError() << LogLoadSnapshotError() << "Snapshot data is inconsistent.";
+            return false;
+        }
+
+        // Create or reuse an archetype with the same layout.
+        int archetypeIndex = this->AcquireArchetype(archetypeHeader.signature);
+        Archetype& archetype = *m_archetypes[archetypeIndex];
+
+        if(archetype.chunkCapacity != archetypeHeader.chunkCapacity || archetypeHeader.chunkCount < 0)
+        {
+            LogError() << LogLoadSnapshotError() << "Snapshot was saved with a different chunk size.";
+            return false;
+        }
+
+        archetypeIndices.push_back(archetypeIndex);
+        remapped = remapped || archetypeIndex != i;
+
+        // Copy chunk memory as a whole.
+        std::size_t chunkSize = GetChunkSize(archetype);
+
+        for(int chunkIndex = 0; chunkIndex < archetypeHeader.chunkCount; ++chunkIndex)
+        {
+            std::int32_t count = 0;
+            reader.Read(count);
+
+            std::size_t size = 0;
+            const std::uint8_t* memory = reader.ReadArray<std::uint8_t>(size);
+
+            if(!reader.IsValid() || size != chunkSize || count <= 0 || count > archetype.chunkCapacity)
+            {
+                LogError() << LogLoadSnapshotError() << "Snapshot chunk data is invalid.";
+                return false;
+            }
+
+            Chunk chunk;
+            chunk.memory = this->AllocateChunk(chunkSize);
+            chunk.count = count;
+            chunk.changeTick = m_tick;
+
+            std::memcpy(chunk.memory.get(), memory, chunkSize);
+
+            archetype.chunks.push_back(std::move(chunk));
+            archetype.entityCount += count;
+        }
+    }
+
+    // Read entity locations.
+    std::size_t locationCount = 0;
+    const EntityLocation* locations = reader.ReadArray<EntityLocation>(locationCount);
+
+    if(!reader.IsValid())
+    {
+        LogError() << LogLoadSnapshotError() << "Snapshot data is truncated.";
+        return false;
+    }
+
+    if(locationCount > (std::size_t)m_info.entitySystem->GetStatistics().handleTableSize)
+    {
+        LogError() << LogLoadSnapshotError() << "Snapshot locations do not match the entity handle table.";
+        return false;
+    }
+
+    // Check that locations point at loaded rows.
+    for(std::size_t i = 0; i < locationCount; ++i)
+    {
+        const EntityLocation& location = locations[i];
+
+        if(location.archetype == InvalidArchetype)
+            continue;
+
+        if(location.archetype < 0 || location.archetype >= header.archetypeCount)
+        {
+            LogError() << LogLoadSnapshotError() << "Snapshot location has an invalid archetype.";
+            return false;
+        }
+
+        const Archetype& archetype = *m_archetypes[archetypeIndices[location.archetype]];
+
+        if(location.chunk < 0 || location.chunk >= (int)archetype.chunks.size() ||
+            location.row < 0 || location.row >= archetype.chunks[location.chunk].count)
+        {
+            LogError() << LogLoadSnapshotError() << "Snapshot location points outside of loaded chunks.";
+            return false;
+        }
+    }
+
+    m_locations.assign(locations, locations + locationCount);
+
+    // Fix up archetype indices only if they were assigned differently.
+    if(remapped)
+    {
+        for(EntityLocation& location : m_locations)
+        {
+            if(location.archetype != InvalidArchetype)
+            {
+                location.archetype = archetypeIndices[location.archetype];
+            }
+        }
+    }
+
+    // Success!
+    return loaded = true;
+}
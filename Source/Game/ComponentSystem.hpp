@@ -0,0 +1,520 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/BinaryStream.hpp"
+#include "Common/Memory.hpp"
+#include "EntityHandle.hpp"
+#include "ComponentType.hpp"
+#include "Prefab.hpp"
+#include "EntitySystem.hpp"
+#include "SystemScheduler.hpp"
+
+// Forward declarations.
+class Checksum;
+
+namespace Game
+{
+    class RollbackBuffer;
+    class WorldPersistence;
+    class WorldPartition;
+    class EntityHandoff;
+}
+
+//
+// Component System
+//
+//  Stores components of entities grouped by their component signatures.
+//  Entities with the same set of components belong to the same archetype,
+//  which keeps its components in fixed size chunks with one contiguous
+//  column per component type. Adding or removing components moves entities
+//  between archetypes, which is deferred until ProcessCommands() is called.
+//  Components of destroyed entities are removed automatically.
+//
+//  Chunks are stamped with the tick of their last change whenever rows are
+//  added, removed or handed out for writing, so snapshots of recent ticks
+//  only have to copy chunks that changed since they were last taken.
+//
+//  Chunks are allocated from the heap, or from reserved address space that
+//  grows in place and can be backed by huge pages, which keeps chunks of
+//  millions of entities close together and reduces TLB misses.
+//
+//  Example usage:
+//      Game::ComponentSystemInfo info;
+//      info.entitySystem = &entitySystem;
+//
+//      Game::ComponentSystem componentSystem;
+//      componentSystem.Initialize(info);
+//
+//      componentSystem.AddComponent(entity, Transform());
+//      componentSystem.AddComponent(entity, Velocity());
+//      componentSystem.ProcessCommands();
+//
+//      componentSystem.ForEach<Transform, Velocity>([](const EntityHandle& entity, Transform& transform, Velocity& velocity)
+//      {
+//          transform.position += velocity.direction;
+//      });
+//
+//  Spawning many entities with the same components:
+//      See Prefab class.
+//
+//  Moving entities with their components to another world:
+//      Game::EntityMap<EntityHandle> remap;
+//      componentSystem.MigrateEntities(otherComponentSystem, &entities[0], 128, remap);
+//
+//  Receiving events of entities with specific components:
+//      // Only entities that have all components of the signature invoke the
+//      // receiver, which is looked up once per archetype instead of filtering
+//      // every entity inside every receiver.
+//      finalizeReceiver.Subscribe(componentSystem.GetFinalizeEvent(
+//          Game::ComponentTypes::GetSignature<Transform, Sprite>()));
+//
+//  Checking access of scheduled systems:
+//      // Builds with thread checks assert when a system run by a scheduler
+//      // accesses component types it did not declare, and when it adds or
+//      // removes component types it did not declare writing.
+//
+//  Iterating over contiguous chunks:
+//      componentSystem.ForEachChunk<Transform>([](int count, const EntityHandle* entities, Transform* transforms)
+//      {
+//          for(int i = 0; i < count; ++i) { /* ... */ }
+//      });
+//
+
+namespace Game
+{
+    // Component system initialization struct.
+    struct ComponentSystemInfo
+    {
+        // Entity system whose entities own the components.
+        EntitySystem* entitySystem;
+
+        // Size of a single chunk of components in bytes.
+        int chunkSize;
+
+        // Optional size of address space reserved for chunks.
+        std::size_t reserveSize;
+
+        // Backs reserved chunks with huge pages.
+        bool hugePages;
+
+        ComponentSystemInfo();
+    };
+
+    // Component system class.
+    class ComponentSystem : private NonCopyable
+    {
+    public:
+        // Friend declarations.
+        friend class RollbackBuffer;
+        friend class WorldPersistence;
+        friend class WorldPartition;
+        friend class EntityHandoff;
+        friend class MemoryLayoutInspector;
+
+        // Type declarations.
+        typedef std::uint64_t Tick;
+        typedef Dispatcher<bool(EntitySystem::Events::Finalize), CollectWhileTrue<bool>> FinalizeDispatcher;
+        typedef Dispatcher<void(EntitySystem::Events::Destroy)> DestroyDispatcher;
+
+    public:
+        ComponentSystem();
+        ~ComponentSystem();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the component system.
+        bool Initialize(const ComponentSystemInfo& info);
+
+        // Adds or replaces a component of an entity.
+        // Component becomes visible at the next ProcessCommands() call.
+        template<typename Type>
+        void AddComponent(const EntityHandle& entity, const Type& component);
+
+        // Removes a component of an entity.
+        // Component remains visible until the next ProcessCommands() call.
+        template<typename Type>
+        void RemoveComponent(const EntityHandle& entity);
+
+        // Moves entities between archetypes.
+        void ProcessCommands();
+
+        // Creates entities with components copied from a prefab.
+        // Components are visible immediately, while entities become active
+        // at the next EntitySystem::ProcessCommands() call.
+        void Instantiate(const Prefab& prefab, int count, EntityHandle* handles);
+
+        // Creates entities with components copied from packed arrays, one array of
+        // values per component of the signature in ascending order of identifiers.
+        // Components are visible immediately, while entities become active
+        // at the next EntitySystem::ProcessCommands() call.
+        void InstantiateColumns(ComponentSignature signature, int count, const std::uint8_t* const* columns, EntityHandle* handles);
+
+        // Inserts components of valid entities without any components from packed
+        // arrays, laid out the same way as for InstantiateColumns().
+        void InsertColumns(ComponentSignature signature, int count, const std::uint8_t* const* columns, const EntityHandle* handles);
+
+        // Moves active entities with their components to another component system
+        // and its entity system. Component rows are copied into chunks of the target
+        // and new handles of migrated entities are inserted into the remap table.
+        // Other storage of the source world drops migrated entities on destroy events,
+        // which are dispatched after their rows have been detached.
+        // Commands of both systems must be processed before migrating.
+        void MigrateEntities(ComponentSystem& target, const EntityHandle* handles, int count, EntityMap<EntityHandle>& remap);
+
+        // Gets a component of an entity.
+        // Returns nullptr if the entity has no such component.
+        template<typename Type>
+        Type* GetComponent(const EntityHandle& entity);
+
+        // Checks if an entity has a component.
+        template<typename Type>
+        bool HasComponent(const EntityHandle& entity) const;
+
+        // Calls a function for each chunk of entities that have all listed components.
+        template<typename... Types, typename Function>
+        void ForEachChunk(Function function);
+
+        // Calls a function for each chunk of entities that have all listed components and none of the excluded ones.
+        template<typename... Types, typename Function>
+        void ForEachChunkExcluding(ComponentSignature excluded, Function function);
+
+        // Calls a function for each entity that has all listed components.
+        template<typename... Types, typename Function>
+        void ForEach(Function function);
+
+        // Gets the number of archetypes.
+        int GetArchetypeCount() const;
+
+        // Gets a dispatcher of finalize events of entities that have all components of a signature.
+        // Pending commands are processed before the first finalize event is matched.
+        FinalizeDispatcher& GetFinalizeEvent(ComponentSignature signature);
+
+        // Gets a dispatcher of destroy events of entities that have all components of a signature.
+        // Dispatched while components of the destroyed entity are still present.
+        DestroyDispatcher& GetDestroyEvent(ComponentSignature signature);
+
+        // Gets the current tick and starts a new one.
+        // Chunks changed afterwards are stamped with a greater tick.
+        Tick AdvanceTick();
+
+        // Gets the current tick that stamps changed chunks.
+        Tick GetTick() const;
+
+        // Adds archetypes with their entities and component columns to a checksum.
+        // Components should not have padding bytes, as they would be included.
+        // Commands should be processed before, as pending changes are not included.
+        void UpdateChecksum(Checksum& checksum) const;
+
+        // Writes archetypes with their chunks of components and entity locations.
+        // Commands must be processed before saving.
+        bool SaveSnapshot(BinaryWriter& writer) const;
+
+        // Restores archetypes, chunks and entity locations.
+        // Must be loaded after the entity system and into a component system without
+        // any components. Component types must be registered in the same order as
+        // when the snapshot was saved.
+        bool LoadSnapshot(BinaryReader& reader);
+
+    private:
+        // Type declarations.
+        struct ComponentCommands
+        {
+            enum Type
+            {
+                Invalid,
+                Add,
+                Remove,
+            };
+        };
+
+        struct ComponentCommand
+        {
+            ComponentCommands::Type type;
+            EntityHandle entity;
+            int component;
+            std::size_t dataOffset;
+        };
+
+        struct ChunkDeleter
+        {
+            ChunkDeleter() :
+                pool(nullptr)
+            {
+            }
+
+            // Pool that the chunk was taken from, or nullptr for heap chunks.
+            BlockPool* pool;
+
+            void operator()(std::uint8_t* memory) const
+            {
+                if(pool != nullptr)
+                {
+                    pool->Free(memory);
+                }
+                else
+                {
+                    delete[] memory;
+                }
+            }
+        };
+
+        struct Chunk
+        {
+            std::unique_ptr<std::uint8_t[], ChunkDeleter> memory;
+            int count;
+
+            // Tick of the last change of any row.
+            Tick changeTick;
+        };
+
+        struct Archetype
+        {
+            // Set of component types.
+            ComponentSignature signature;
+
+            // Component type identifiers sorted in ascending order.
+            std::vector<int> components;
+
+            // Offsets of component columns within a chunk.
+            std::vector<std::size_t> columnOffsets;
+
+            // Column index for each component type or -1 if absent.
+            int columnIndices[ComponentTypes::MaximumCount];
+
+            // Cached archetypes reached by adding or removing a component type.
+            int addTransitions[ComponentTypes::MaximumCount];
+            int removeTransitions[ComponentTypes::MaximumCount];
+
+            // Number of entities that fit in a chunk.
+            int chunkCapacity;
+
+            // List of chunks where all but the last one are full.
+            std::vector<Chunk> chunks;
+
+            // Number of entities.
+            int entityCount;
+
+            // Indices of matching signature events, out of the number of checked ones.
+            std::vector<int> events;
+            int checkedEvents;
+        };
+
+        struct SignatureEvents
+        {
+            ComponentSignature signature;
+            FinalizeDispatcher finalize;
+            DestroyDispatcher destroy;
+        };
+
+        struct EntityLocation
+        {
+            int archetype;
+            int chunk;
+            int row;
+        };
+
+        typedef std::vector<ComponentCommand> CommandList;
+        typedef std::vector<std::uint8_t> CommandData;
+        typedef std::vector<std::unique_ptr<Archetype>> ArchetypeList;
+        typedef std::map<ComponentSignature, int> ArchetypeMap;
+        typedef std::vector<EntityLocation> LocationList;
+        typedef std::vector<std::unique_ptr<SignatureEvents>> SignatureEventList;
+
+    private:
+        // Queues a component command.
+        void QueueCommand(ComponentCommands::Type type, const EntityHandle& entity, int component, const void* data, std::size_t size);
+
+        // Finds or creates an archetype with a signature.
+        int AcquireArchetype(ComponentSignature signature);
+
+        // Finds an archetype with an added or removed component type.
+        int FindAddTransition(int archetype, int component);
+        int FindRemoveTransition(int archetype, int component);
+
+        // Gets the location of an entity or nullptr if it has no components.
+        const EntityLocation* FindLocation(const EntityHandle& entity) const;
+
+        // Makes sure the last chunk of an archetype has space for at least one row.
+        Chunk& AcquireChunk(Archetype& archetype);
+
+        // Allocates memory of a chunk from reserved memory or the heap.
+        std::unique_ptr<std::uint8_t[], ChunkDeleter> AllocateChunk(std::size_t size);
+
+        // Makes sure there are location entries for an entity identifier.
+        void ReserveLocations(int identifier);
+
+        // Rebuilds locations of all entities from entity columns of chunks.
+        void RebuildLocations();
+
+        // Appends an entity row to an archetype.
+        EntityLocation AppendRow(int archetype, const EntityHandle& entity);
+
+        // Removes an entity row from an archetype by moving the last row in its place.
+        void RemoveRow(const EntityLocation& location);
+
+        // Moves an entity to another archetype and copies shared components.
+        EntityLocation MoveEntity(const EntityHandle& entity, int archetype);
+
+        // Gets the size of a chunk in bytes.
+        static std::size_t GetChunkSize(const Archetype& archetype);
+
+        // Gets the memory of a component in a chunk.
+        std::uint8_t* GetComponentData(const EntityLocation& location, int component);
+
+        // Gets the array of entities in a chunk.
+        static EntityHandle* GetEntityColumn(Chunk& chunk);
+
+        // Gets a component column of a chunk.
+        template<typename Type>
+        static Type* GetColumn(const Archetype& archetype, Chunk& chunk);
+
+        // Finds or creates events of a signature.
+        SignatureEvents& AcquireSignatureEvents(ComponentSignature signature);
+
+        // Gets indices of signature events that match an archetype.
+        const std::vector<int>& MatchSignatureEvents(Archetype& archetype);
+
+        // Called when an entity is finalized.
+        bool OnEntityFinalize(EntitySystem::Events::Finalize event);
+
+        // Called when an entity is destroyed.
+        void OnEntityDestroy(EntitySystem::Events::Destroy event);
+
+    private:
+        // Initialization parameters.
+        ComponentSystemInfo m_info;
+
+        // List of queued commands and their component data.
+        CommandList m_commands;
+        CommandData m_commandData;
+
+        // Pool of chunks carved from reserved memory.
+        BlockPool m_chunkPool;
+
+        // List of archetypes and their lookup by signature.
+        ArchetypeList m_archetypes;
+        ArchetypeMap m_archetypeMap;
+
+        // Locations of entities indexed by their handle identifiers.
+        LocationList m_locations;
+
+        // Current tick that stamps changed chunks.
+        Tick m_tick;
+
+        // Events of entities with component signatures.
+        SignatureEventList m_signatureEvents;
+
+        // Entity system event receivers.
+        // Finalize receiver is subscribed along with the first signature event.
+        Receiver<bool(EntitySystem::Events::Finalize)> m_entityFinalize;
+        Receiver<void(EntitySystem::Events::Destroy)> m_entityDestroy;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
+
+// Template implementations.
+namespace Game
+{
+    template<typename Type>
+    void ComponentSystem::AddComponent(const EntityHandle& entity, const Type& component)
+    {
+        if(!m_initialized)
+            return;
+
+        Assert(SystemScheduler::IsWriteDeclared(ComponentTypes::GetSignature<Type>()), "System changes a component type it did not declare writing!");
+
+        this->QueueCommand(ComponentCommands::Add, entity, ComponentTypes::GetIdentifier<Type>(), &component, sizeof(Type));
+    }
+
+    template<typename Type>
+    void ComponentSystem::RemoveComponent(const EntityHandle& entity)
+    {
+        if(!m_initialized)
+            return;
+
+        Assert(SystemScheduler::IsWriteDeclared(ComponentTypes::GetSignature<Type>()), "System changes a component type it did not declare writing!");
+
+        this->QueueCommand(ComponentCommands::Remove, entity, ComponentTypes::GetIdentifier<Type>(), nullptr, 0);
+    }
+
+    template<typename Type>
+    Type* ComponentSystem::GetComponent(const EntityHandle& entity)
+    {
+        Assert(SystemScheduler::IsReadDeclared(ComponentTypes::GetSignature<Type>()), "System accesses a component type it did not declare!");
+
+        const EntityLocation* location = this->FindLocation(entity);
+
+        if(location == nullptr)
+            return nullptr;
+
+        return reinterpret_cast<Type*>(this->GetComponentData(*location, ComponentTypes::GetIdentifier<Type>()));
+    }
+
+    template<typename Type>
+    bool ComponentSystem::HasComponent(const EntityHandle& entity) const
+    {
+        Assert(SystemScheduler::IsReadDeclared(ComponentTypes::GetSignature<Type>()), "System accesses a component type it did not declare!");
+
+        const EntityLocation* location = this->FindLocation(entity);
+
+        if(location == nullptr)
+            return false;
+
+        return m_archetypes[location->archetype]->columnIndices[ComponentTypes::GetIdentifier<Type>()] >= 0;
+    }
+
+    template<typename... Types, typename Function>
+    void ComponentSystem::ForEachChunk(Function function)
+    {
+        this->ForEachChunkExcluding<Types...>(0, function);
+    }
+
+    template<typename... Types, typename Function>
+    void ComponentSystem::ForEachChunkExcluding(ComponentSignature excluded, Function function)
+    {
+        ComponentSignature signature = ComponentTypes::GetSignature<Types...>();
+        Assert(SystemScheduler::IsReadDeclared(signature), "System accesses a component type it did not declare!");
+
+        // Iterate over chunks of matching archetypes.
+        for(const std::unique_ptr<Archetype>& archetype : m_archetypes)
+        {
+            if((archetype->signature & signature) != signature || (archetype->signature & excluded) != 0)
+                continue;
+
+            for(Chunk& chunk : archetype->chunks)
+            {
+                if(chunk.count == 0)
+                    continue;
+
+                // Components are handed out for writing.
+                chunk.changeTick = m_tick;
+
+                function(chunk.count, (const EntityHandle*)GetEntityColumn(chunk), GetColumn<Types>(*archetype, chunk)...);
+            }
+        }
+    }
+
+    template<typename... Types, typename Function>
+    void ComponentSystem::ForEach(Function function)
+    {
+        this->ForEachChunk<Types...>([&function](int count, const EntityHandle* entities, Types*... columns)
+        {
+            for(int i = 0; i < count; ++i)
+            {
+                function(entities[i], columns[i]...);
+            }
+        });
+    }
+
+    template<typename Type>
+    Type* ComponentSystem::GetColumn(const Archetype& archetype, Chunk& chunk)
+    {
+        int column = archetype.columnIndices[ComponentTypes::GetIdentifier<Type>()];
+        Assert(column >= 0, "Archetype does not have a requested component column!");
+
+        return reinterpret_cast<Type*>(chunk.memory.get() + archetype.columnOffsets[column]);
+    }
+}
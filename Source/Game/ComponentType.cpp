@@ -0,0 +1,40 @@
+#include "Precompiled.hpp"
+#include "ComponentType.hpp"
+using namespace Game;
+
+namespace
+{
+    // Registered component types.
+    ComponentTypeInfo registeredTypes[ComponentTypes::MaximumCount];
+    int registeredCount = 0;
+
+    // Guards the registration of types from multiple threads.
+    std::mutex registrationMutex;
+}
+
+int ComponentTypes::Register(std::size_t size, std::size_t alignment)
+{
+    std::lock_guard<std::mutex> lock(registrationMutex);
+
+    // Check if we reached the limit.
+    Verify(registeredCount < MaximumCount, "Reached the maximum number of component types!");
+
+    // Add the type information.
+    ComponentTypeInfo& info = registeredTypes[registeredCount];
+    info.identifier = registeredCount;
+    info.size = size;
+    info.alignment = alignment;
+
+    return registeredCount++;
+}
+
+const ComponentTypeInfo& ComponentTypes::GetInfo(int identifier)
+{
+    Assert(identifier >= 0 && identifier < registeredCount, "Invalid component type identifier!");
+    return registeredTypes[identifier];
+}
+
+int ComponentTypes::GetCount()
+{
+    return registeredCount;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Component Type
+//
+//  Assigns a small runtime identifier to each component type without RTTI.
+//  Identifiers are handed out in the order types are first used and are
+//  stable for the lifetime of the process. Components are stored as plain
+//  data that can be relocated with a memory copy.
+//
+//  Identifiers are dense, so they index arrays of columns and transitions
+//  directly, and each sets a single bit of a signature, so archetypes are
+//  matched with a bitwise and. Signatures of type lists are combined once
+//  and cached, so queries don't touch the registry again.
+//
+//  Example usage:
+//      struct Transform { glm::vec3 position; };
+//
+//      int identifier = Game::ComponentTypes::GetIdentifier<Transform>();
+//      Game::ComponentSignature signature = Game::ComponentTypes::GetSignature<Transform>();
+//
+
+namespace Game
+{
+    // Bit mask of component types.
+    typedef std::uint64_t ComponentSignature;
+
+    // Component type information.
+    struct ComponentTypeInfo
+    {
+        // Identifier of the type.
+        int identifier;
+
+        // Size of the type in bytes.
+        std::size_t size;
+
+        // Alignment of the type in bytes.
+        std::size_t alignment;
+    };
+
+    // Component type registry.
+    class ComponentTypes
+    {
+    public:
+        // Maximum number of registered component types.
+        // Each type needs a bit of a signature.
+        static const int MaximumCount = 64;
+
+        static_assert(MaximumCount <= std::numeric_limits<ComponentSignature>::digits, "Component signatures are too narrow!");
+
+        // Gets the identifier of a component type.
+        template<typename Type>
+        static int GetIdentifier();
+
+        // Gets the signature of one or more component types.
+        template<typename... Types>
+        static ComponentSignature GetSignature();
+
+        // Gets the information about a registered component type.
+        static const ComponentTypeInfo& GetInfo(int identifier);
+
+        // Gets the signature bit of a component type identifier.
+        static ComponentSignature GetSignatureBit(int identifier);
+
+        // Gets the number of registered component types.
+        static int GetCount();
+
+    private:
+        // Registers a new component type.
+        static int Register(std::size_t size, std::size_t alignment);
+
+        // Combines signatures of component types.
+        static ComponentSignature CombineSignatures();
+
+        template<typename Type, typename... Types>
+        static ComponentSignature CombineSignatures(Type*, Types*... types);
+    };
+}
+
+// Template implementations.
+namespace Game
+{
+    template<typename Type>
+    int ComponentTypes::GetIdentifier()
+    {
+        static_assert(std::is_trivially_copyable<Type>::value, "Component types must be trivially copyable!");
+        static_assert(alignof(Type) <= alignof(std::max_align_t), "Component types can't be over aligned!");
+
+        // Register the type once on the first use.
+        static const int identifier = Register(sizeof(Type), alignof(Type));
+        return identifier;
+    }
+
+    template<typename... Types>
+    ComponentSignature ComponentTypes::GetSignature()
+    {
+        // Combine bits once on the first use.
+        static const ComponentSignature signature = CombineSignatures((Types*)nullptr...);
+        return signature;
+    }
+
+    inline ComponentSignature ComponentTypes::GetSignatureBit(int identifier)
+    {
+        Assert(identifier >= 0 && identifier < MaximumCount, "Invalid component type identifier!");
+        return (ComponentSignature)1 << identifier;
+    }
+
+    inline ComponentSignature ComponentTypes::CombineSignatures()
+    {
+        return 0;
+    }
+
+    template<typename Type, typename... Types>
+    ComponentSignature ComponentTypes::CombineSignatures(Type*, Types*... types)
+    {
+        return GetSignatureBit(GetIdentifier<Type>()) | CombineSignatures(types...);
+    }
+}
@@ -0,0 +1,308 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "EntityHandle.hpp"
+
+//
+// Concurrent Entity Map
+//
+//  Hash map keyed by entity handles that any number of threads can insert
+//  into, look up and remove from at the same time without locks. Slots are
+//  stored in a fixed array with a power of two size and collisions are
+//  resolved with linear probing, like in the entity map. Threads claim an
+//  empty slot for a key with a single compare and swap of the packed handle
+//  value, after which the key stays in that slot.
+//
+//  Values must be trivially copyable and small enough to be stored in a
+//  lock free atomic, such as indices, pointers or packed handles. Removing
+//  an element only marks its slot as vacant, so the key keeps its slot and
+//  can be inserted again without probing. Slots of removed keys are only
+//  reclaimed by clearing the map, which must not run at the same time as
+//  other operations. Inserting fails once every slot has been claimed, so
+//  the capacity should leave room for keys that are removed between clears.
+//
+//  Example usage:
+//      Game::ConcurrentEntityMap<int> map;
+//      map.Initialize(4096);
+//
+//      jobSystem.ParallelFor(count, 256, [&](int begin, int end)
+//      {
+//          for(int i = begin; i < end; ++i)
+//          {
+//              map.Insert(entities[i], i);
+//          }
+//      });
+//
+//      int index;
+//
+//      if(map.Find(entity, index))
+//      {
+//          /* ... */
+//      }
+//
+
+namespace Game
+{
+    // Concurrent entity map class.
+    template<typename Value>
+    class ConcurrentEntityMap : private NonCopyable
+    {
+    public:
+        static_assert(std::is_trivially_copyable<Value>::value, "Values must be trivially copyable!");
+
+    public:
+        ConcurrentEntityMap();
+        ~ConcurrentEntityMap();
+
+        // Restores instance to it's original state.
+        void Cleanup();
+
+        // Allocates the array of slots.
+        // Capacity must be a power of two.
+        bool Initialize(std::size_t capacity);
+
+        // Removes all elements and reclaims slots.
+        // Must not be called at the same time as other operations.
+        void Clear();
+
+        // Inserts or replaces an element.
+        // Returns false if the key is invalid or there are no slots left.
+        bool Insert(const EntityHandle& key, const Value& value);
+
+        // Finds an element and copies its value.
+        bool Find(const EntityHandle& key, Value& value) const;
+
+        // Removes an element.
+        bool Remove(const EntityHandle& key);
+
+        // Checks if the map contains an element.
+        bool Contains(const EntityHandle& key) const;
+
+        // Calls a function for each element in an unspecified order.
+        // Elements changed at the same time may or may not be visited.
+        template<typename Function>
+        void ForEach(Function function) const;
+
+        // Gets an approximate number of elements.
+        std::size_t GetSize() const;
+
+        // Gets the number of slots.
+        std::size_t GetCapacity() const;
+
+    private:
+        // Map slot.
+        // Key is the packed value of an entity handle, or zero for an empty slot.
+        struct Slot
+        {
+            std::atomic<EntityHandle::ValueType> key;
+            std::atomic<Value> value;
+            std::atomic<bool> present;
+        };
+
+    private:
+        // Finds the slot of a key or returns nullptr.
+        Slot* FindSlot(const EntityHandle& key) const;
+
+    private:
+        // Array of slots with a power of two size.
+        std::unique_ptr<Slot[]> m_slots;
+        std::size_t m_capacity;
+
+        // Number of present elements.
+        std::atomic<std::size_t> m_size;
+    };
+}
+
+// Template implementations.
+namespace Game
+{
+    template<typename Value>
+    ConcurrentEntityMap<Value>::ConcurrentEntityMap() :
+        m_capacity(0),
+        m_size(0)
+    {
+    }
+
+    template<typename Value>
+    ConcurrentEntityMap<Value>::~ConcurrentEntityMap()
+    {
+        this->Cleanup();
+    }
+
+    template<typename Value>
+    void ConcurrentEntityMap<Value>::Cleanup()
+    {
+        m_slots.reset();
+        m_capacity = 0;
+        m_size.store(0, std::memory_order_relaxed);
+    }
+
+    template<typename Value>
+    bool ConcurrentEntityMap<Value>::Initialize(std::size_t capacity)
+    {
+        // Cleanup this instance.
+        this->Cleanup();
+
+        // Validate arguments.
+        if(capacity == 0 || (capacity & (capacity - 1)) != 0)
+        {
+            LogError() << "Failed to initialize a concurrent entity map! Capacity must be a power of two.";
+            return false;
+        }
+
+        // Allocate empty slots.
+        m_slots.reset(new Slot[capacity]);
+        m_capacity = capacity;
+
+        this->Clear();
+
+        // Success!
+        return true;
+    }
+
+    template<typename Value>
+    void ConcurrentEntityMap<Value>::Clear()
+    {
+        for(std::size_t i = 0; i < m_capacity; ++i)
+        {
+            m_slots[i].key.store(0, std::memory_order_relaxed);
+            m_slots[i].value.store(Value(), std::memory_order_relaxed);
+            m_slots[i].present.store(false, std::memory_order_relaxed);
+        }
+
+        m_size.store(0, std::memory_order_relaxed);
+    }
+
+    template<typename Value>
+    bool ConcurrentEntityMap<Value>::Insert(const EntityHandle& key, const Value& value)
+    {
+        Assert(key.GetValue() != 0, "Attempting to insert an invalid key!");
+
+        if(key.GetValue() == 0 || m_capacity == 0)
+            return false;
+
+        // Probe for the slot of the key or an empty slot to claim.
+        std::size_t index = std::hash<EntityHandle>()(key) & (m_capacity - 1);
+
+        for(std::size_t probe = 0; probe < m_capacity; ++probe)
+        {
+            Slot& slot = m_slots[index];
+            EntityHandle::ValueType slotKey = slot.key.load(std::memory_order_acquire);
+
+            if(slotKey == 0)
+            {
+                // Claim the empty slot, unless another thread claimed it first.
+                if(slot.key.compare_exchange_strong(slotKey, key.GetValue(), std::memory_order_acq_rel))
+                {
+                    slotKey = key.GetValue();
+                }
+            }
+
+            if(slotKey == key.GetValue())
+            {
+                // Publish the value before marking the element as present.
+                slot.value.store(value, std::memory_order_release);
+
+                if(!slot.present.exchange(true, std::memory_order_acq_rel))
+                {
+                    m_size.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                return true;
+            }
+
+            index = (index + 1) & (m_capacity - 1);
+        }
+
+        return false;
+    }
+
+    template<typename Value>
+    bool ConcurrentEntityMap<Value>::Find(const EntityHandle& key, Value& value) const
+    {
+        Slot* slot = this->FindSlot(key);
+
+        if(slot == nullptr || !slot->present.load(std::memory_order_acquire))
+            return false;
+
+        value = slot->value.load(std::memory_order_acquire);
+        return true;
+    }
+
+    template<typename Value>
+    bool ConcurrentEntityMap<Value>::Remove(const EntityHandle& key)
+    {
+        Slot* slot = this->FindSlot(key);
+
+        if(slot == nullptr || !slot->present.exchange(false, std::memory_order_acq_rel))
+            return false;
+
+        m_size.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    template<typename Value>
+    bool ConcurrentEntityMap<Value>::Contains(const EntityHandle& key) const
+    {
+        Slot* slot = this->FindSlot(key);
+
+        return slot != nullptr && slot->present.load(std::memory_order_acquire);
+    }
+
+    template<typename Value>
+    template<typename Function>
+    void ConcurrentEntityMap<Value>::ForEach(Function function) const
+    {
+        for(std::size_t i = 0; i < m_capacity; ++i)
+        {
+            const Slot& slot = m_slots[i];
+
+            if(!slot.present.load(std::memory_order_acquire))
+                continue;
+
+            EntityHandle key;
+            EntityHandle::ValueType packed = slot.key.load(std::memory_order_relaxed);
+            std::memcpy(&key, &packed, sizeof(key));
+
+            function(key, slot.value.load(std::memory_order_acquire));
+        }
+    }
+
+    template<typename Value>
+    typename ConcurrentEntityMap<Value>::Slot* ConcurrentEntityMap<Value>::FindSlot(const EntityHandle& key) const
+    {
+        if(key.GetValue() == 0 || m_capacity == 0)
+            return nullptr;
+
+        // Keys never leave their slots, so probing stops at the first empty slot.
+        std::size_t index = std::hash<EntityHandle>()(key) & (m_capacity - 1);
+
+        for(std::size_t probe = 0; probe < m_capacity; ++probe)
+        {
+            Slot& slot = m_slots[index];
+            EntityHandle::ValueType slotKey = slot.key.load(std::memory_order_acquire);
+
+            if(slotKey == key.GetValue())
+                return &slot;
+
+            if(slotKey == 0)
+                return nullptr;
+
+            index = (index + 1) & (m_capacity - 1);
+        }
+
+        return nullptr;
+    }
+
+    template<typename Value>
+    std::size_t ConcurrentEntityMap<Value>::GetSize() const
+    {
+        return m_size.load(std::memory_order_relaxed);
+    }
+
+    template<typename Value>
+    std::size_t ConcurrentEntityMap<Value>::GetCapacity() const
+    {
+        return m_capacity;
+    }
+}
@@ -0,0 +1,165 @@
+#include "Precompiled.hpp"
+#include "EntityCommandBuffer.hpp"
+#include "EntitySystem.hpp"
+using namespace Game;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize an entity command buffer! "
+}
+
+EntityCommandBuffer::EntityCommandBuffer() :
+    m_entitySystem(nullptr),
+    m_shard(-1),
+    m_next(nullptr),
+    m_submitted(false),
+    m_initialized(false)
+{
+}
+
+EntityCommandBuffer::~EntityCommandBuffer()
+{
+    this->Cleanup();
+}
+
+void EntityCommandBuffer::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Check the state before cleaning up.
+    Assert(!m_submitted, "Cleaning up an entity command buffer with commands that were never played back!");
+
+    // Return handles reserved for entities that will never be created.
+    if(!m_commands.empty())
+    {
+        m_entitySystem->DiscardCommands(*this);
+    }
+
+    // Clear the command list.
+    Utility::ClearContainer(m_commands);
+
+    // Reset the entity system.
+    m_entitySystem = nullptr;
+    m_shard = -1;
+    m_next = nullptr;
+    m_submitted = false;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool EntityCommandBuffer::Initialize(EntitySystem* entitySystem, int shard, LinearArena* arena)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            m_initialized = true;
+            this->Cleanup();
+        }
+    );
+
+    // Validate arguments.
+    if(entitySystem == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid entity system.";
+        return false;
+    }
+
+    if(shard < -1 || shard >= entitySystem->GetShardCount())
+    {
+        LogError() << LogInitializeError() << "Invalid handle shard index.";
+        return false;
+    }
+
+    m_entitySystem = entitySystem;
+    m_shard = shard;
+
+    // Record commands into the arena if there is one.
+    m_commands = CommandList(ArenaAllocator<EntityCommand>(arena));
+
+    // Success!
+    return m_initialized = true;
+}
+
+EntityHandle EntityCommandBuffer::CreateEntity()
+{
+    if(!m_initialized)
+        return EntityHandle();
+
+    // Reserve a handle that will be created when the buffer is played back.
+    EntityHandle handle = m_shard >= 0 ? m_entitySystem->ReserveHandleShard(m_shard, true) : m_entitySystem->ReserveHandleConcurrent(true);
+
+    if(handle.GetIdentifier() == 0)
+        return EntityHandle();
+
+    // Record the command.
+    EntityCommand command;
+    command.type = EntityCommands::Create;
+    command.handle = handle;
+    command.count = 1;
+
+    m_commands.push_back(command);
+
+    return handle;
+}
+
+void EntityCommandBuffer::DestroyEntity(const EntityHandle& handle)
+{
+    if(!m_initialized)
+        return;
+
+    // Record the command.
+    EntityCommand command;
+    command.type = EntityCommands::Destroy;
+    command.handle = handle;
+    command.count = 1;
+
+    m_commands.push_back(command);
+}
+
+void EntityCommandBuffer::Submit()
+{
+    if(!m_initialized)
+        return;
+
+    // Submitting an empty buffer does nothing.
+    if(m_commands.empty())
+        return;
+
+    m_submitted = true;
+    m_entitySystem->SubmitCommands(*this);
+}
+
+int EntityCommandBuffer::GetCommandCount() const
+{
+    return (int)m_commands.size();
+}
+
+bool EntityCommandBuffer::IsEmpty() const
+{
+    return m_commands.empty();
+}
+
+void EntityCommandBuffer::ClearPlayedBack()
+{
+    // Arena memory would not survive the reset of the arena,
+    // so it is dropped along with the commands.
+    if(m_commands.get_allocator().GetArena() != nullptr)
+    {
+        m_commands = CommandList(m_commands.get_allocator());
+    }
+    else
+    {
+        m_commands.clear();
+    }
+
+    // Buffer can be modified again.
+    m_submitted = false;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/Memory.hpp"
+#include "EntityHandle.hpp"
+
+//
+// Entity Command Buffer
+//
+//  Records structural changes to entities that are played back later.
+//  Each job can fill its own buffer independently without any locking.
+//  Submitted buffers are played back in submission order during the
+//  next EntitySystem::ProcessCommands() call. Buffers cleaned up without
+//  being submitted return handles reserved for their created entities,
+//  which are freed during the next ProcessCommands() call.
+//
+//  Example usage:
+//      Game::EntityCommandBuffer commands;
+//      commands.Initialize(&entitySystem);
+//
+//      // Inside a job running on a worker thread.
+//      EntityHandle entity = commands.CreateEntity();
+//      commands.DestroyEntity(otherEntity);
+//      commands.Submit();
+//
+//      // Buffers of threads that own handle shards reserve handles from them.
+//      commands.Initialize(&entitySystem, jobSystem.GetParticipantIndex());
+//
+//      // Commands can be recorded into an arena instead of the heap. The arena
+//      // must not be reset before the buffer is played back, which holds for
+//      // job arenas when buffers are played back in the same frame.
+//      commands.Initialize(&entitySystem, -1, jobSystem.GetArena());
+//
+//      // On the main thread after all jobs have finished.
+//      entitySystem.ProcessCommands();
+//
+
+namespace Game
+{
+    // Forward declarations.
+    class EntitySystem;
+
+    // Entity command types.
+    struct EntityCommands
+    {
+        enum Type
+        {
+            Invalid,
+            Create,
+            Destroy,
+        };
+    };
+
+    // Entity command structure.
+    // Refers to a range of consecutive handle entries starting at the handle.
+    struct EntityCommand
+    {
+        EntityCommands::Type type;
+        EntityHandle handle;
+        int count;
+    };
+
+    // Entity command buffer class.
+    class EntityCommandBuffer : private NonCopyable
+    {
+    public:
+        // Friend declarations.
+        friend class EntitySystem;
+
+    public:
+        EntityCommandBuffer();
+        ~EntityCommandBuffer();
+
+        // Restores instance to its original state.
+        // Recorded commands that have not been submitted are dropped.
+        void Cleanup();
+
+        // Initializes the command buffer.
+        // Handles of created entities are reserved from a shard if one is given.
+        // Commands are recorded into an arena if one is given, which drops them
+        // after every play back instead of keeping their memory.
+        bool Initialize(EntitySystem* entitySystem, int shard = -1, LinearArena* arena = nullptr);
+
+        // Records an entity creation.
+        // Returns an invalid handle if reserved handles have run out.
+        EntityHandle CreateEntity();
+
+        // Records an entity destruction.
+        void DestroyEntity(const EntityHandle& handle);
+
+        // Submits recorded commands to the entity system.
+        // Buffer must not be modified until it has been played back.
+        void Submit();
+
+        // Gets the number of recorded commands.
+        int GetCommandCount() const;
+
+        // Checks if the buffer has no recorded commands.
+        bool IsEmpty() const;
+
+    private:
+        // Type declarations.
+        typedef ArenaVector<EntityCommand> CommandList;
+
+    private:
+        // Clears commands that have been played back.
+        void ClearPlayedBack();
+
+    private:
+        // Entity system instance.
+        EntitySystem* m_entitySystem;
+
+        // Handle shard of the entity system or -1.
+        int m_shard;
+
+        // List of recorded commands.
+        CommandList m_commands;
+
+        // Next buffer in the list of submitted buffers.
+        EntityCommandBuffer* m_next;
+
+        // Set while submitted commands wait to be played back.
+        bool m_submitted;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -6,9 +6,16 @@
 // Entity Handle
 //
 //  References an unique entity in the world. Consists of two integers -
-//  an identifier and a version. The version counter is increased everytime
-//  an unique identifier is reused.
+//  an identifier and a version, packed together into a single 64bit value.
+//  The version counter is increased everytime an unique identifier is reused.
 //
+//  Number of bits used by the identifier can be changed at compile time by
+//  defining ENTITY_HANDLE_IDENTIFIER_BITS. Remaining bits store the version.
+//
+
+#ifndef ENTITY_HANDLE_IDENTIFIER_BITS
+    #define ENTITY_HANDLE_IDENTIFIER_BITS 40
+#endif
 
 namespace Game
 {
@@ -19,55 +26,78 @@ namespace Game
         // Friend declarations.
         friend class EntitySystem;
 
+        // Type declarations.
+        typedef std::uint64_t ValueType;
+
+        // Bit layout of the packed value.
+        static const int IdentifierBits = ENTITY_HANDLE_IDENTIFIER_BITS;
+        static const int VersionBits = 64 - IdentifierBits;
+
+        static_assert(IdentifierBits >= 16 && IdentifierBits <= 48, "Invalid number of entity handle identifier bits!");
+
+        static const ValueType IdentifierMask = ((ValueType)1 << IdentifierBits) - 1;
+        static const ValueType VersionMask = ((ValueType)1 << VersionBits) - 1;
+
+        // Largest values that can be stored in a handle.
+        static const int MaximumIdentifier = IdentifierBits >= 31 ? std::numeric_limits<int>::max() : (int)IdentifierMask;
+        static const int MaximumVersion = VersionBits >= 31 ? std::numeric_limits<int>::max() : (int)VersionMask;
+
     public:
         // Constructor.
         EntityHandle() :
-            m_identifier(0),
-            m_version(0)
-        {
-        }
-
-        // Copy constructor.
-        EntityHandle(const EntityHandle& other) :
-            m_identifier(other.m_identifier),
-            m_version(other.m_version)
+            m_value(0)
         {
         }
 
         // Comparison operators.
         bool operator==(const EntityHandle& other) const
         {
-            return m_identifier == other.m_identifier && m_version == other.m_version;
+            return m_value == other.m_value;
         }
 
         bool operator!=(const EntityHandle& other) const
         {
-            return m_identifier != other.m_identifier || m_version != other.m_version;
+            return m_value != other.m_value;
         }
 
         // Sorting operator.
         bool operator<(const EntityHandle& other) const
         {
-            return m_identifier < other.m_identifier;
+            return (m_value & IdentifierMask) < (other.m_value & IdentifierMask);
         }
 
         // Gets the identifier.
         int GetIdentifier() const
         {
-            return m_identifier;
+            return (int)(m_value & IdentifierMask);
         }
 
         // Gets the version.
         int GetVersion() const
         {
-            return m_version;
+            return (int)(m_value >> IdentifierBits);
+        }
+
+        // Gets the packed value.
+        ValueType GetValue() const
+        {
+            return m_value;
         }
 
     private:
-        // Handle data.
-        int m_identifier;
-        int m_version;
+        // Creates a handle from its parts.
+        EntityHandle(int identifier, int version) :
+            m_value(((ValueType)version << IdentifierBits) | ((ValueType)identifier & IdentifierMask))
+        {
+        }
+
+    private:
+        // Packed handle data.
+        ValueType m_value;
     };
+
+    // Handles are copied as raw memory by component storage and snapshots.
+    static_assert(std::is_trivially_copyable<EntityHandle>::value, "Entity handle must be trivially copyable!");
 }
 
 // Hashing functors.
@@ -79,8 +109,9 @@ namespace std
     {
         std::size_t operator()(const Game::EntityHandle& handle) const
         {
-            // Use the identifier as a hash.
-            return handle.GetIdentifier();
+            // Mix bits of the packed value, so sequential
+            // identifiers spread across all buckets.
+            return (std::size_t)Utility::HashMix(handle.GetValue());
         }
     };
 
@@ -90,10 +121,9 @@ namespace std
     {
         std::size_t operator()(const std::pair<Game::EntityHandle, Game::EntityHandle>& pair) const
         {
-            // Use combined identifiers as a hash.
-            // This turns two 32bit integers into 64bit one.
-            // We assume std::size_t is 64bit, but it's fine if it's not.
-            return (std::size_t)pair.first.GetIdentifier() * std::numeric_limits<int>::max() + pair.second.GetIdentifier();
+            // Mix both packed values, including their versions.
+            // Second value is mixed separately to keep the order of handles significant.
+            return (std::size_t)Utility::HashMix(pair.first.GetValue() ^ Utility::HashMix(pair.second.GetValue()));
         }
     };
 }
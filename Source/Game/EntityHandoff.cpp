@@ -0,0 +1,386 @@
+#include "Precompiled.hpp"
+#include "EntityHandoff.hpp"
+#include "Common/BinaryStream.hpp"
+#include "Common/Compression.hpp"
+using namespace Game;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize an entity handoff! "
+    #define LogWriteError() "Failed to write an entity handoff packet! "
+    #define LogReadError() "Failed to read an entity handoff packet! "
+
+    // Packet format identification.
+    const std::uint32_t PacketMagic   = 0x464F4845; // "EHOF"
+    const std::uint32_t PacketVersion = 1;
+
+    // Packet header.
+    struct PacketHeader
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::int32_t entityCount;
+        std::int32_t groupCount;
+        std::uint64_t bodySize;
+    };
+
+    // Header of a group of entities with the same components.
+    struct PacketGroup
+    {
+        std::uint64_t signature;
+        std::int32_t entityCount;
+        std::int32_t reserved;
+    };
+
+    // Counts component types in a signature.
+    int CountComponents(ComponentSignature signature)
+    {
+        int count = 0;
+
+        for(; signature != 0; signature &= signature - 1)
+        {
+            ++count;
+        }
+
+        return count;
+    }
+}
+
+HandoffEntity::HandoffEntity() :
+    globalId(0),
+    metadata(nullptr),
+    metadataSize(0)
+{
+}
+
+EntityHandoffInfo::EntityHandoffInfo() :
+    entitySystem(nullptr),
+    componentSystem(nullptr)
+{
+}
+
+EntityHandoff::EntityHandoff() :
+    m_initialized(false)
+{
+}
+
+EntityHandoff::~EntityHandoff()
+{
+    this->Cleanup();
+}
+
+void EntityHandoff::Cleanup()
+{
+    Utility::ClearContainer(m_body);
+    Utility::ClearContainer(m_column);
+    Utility::ClearContainer(m_offsets);
+    Utility::ClearContainer(m_globalIds);
+    Utility::ClearContainer(m_metadata);
+    Utility::ClearContainer(m_handles);
+    Utility::ClearContainer(m_received);
+    Utility::ClearContainer(m_groups);
+
+    // Reset initialization parameters.
+    m_info = EntityHandoffInfo();
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool EntityHandoff::Initialize(const EntityHandoffInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.entitySystem == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid entity system.";
+        return false;
+    }
+
+    if(info.componentSystem == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid component system.";
+        return false;
+    }
+
+    m_info = info;
+
+    // Success!
+    return m_initialized = true;
+}
+
+bool EntityHandoff::Write(const HandoffEntity* entities, int count, std::vector<std::uint8_t>& packet)
+{
+    Assert(m_initialized, "Entity handoff is not initialized!");
+    Assert(count >= 0, "Attempting to write a negative number of entities!");
+    Assert(entities != nullptr || count == 0, "Input array of entities is nullptr!");
+
+    const ComponentSystem& componentSystem = *m_info.componentSystem;
+
+    if(!componentSystem.m_commands.empty())
+    {
+        LogError() << LogWriteError() << "There are unprocessed component commands left.";
+        return false;
+    }
+
+    // Group entities by their archetypes, keeping their order.
+    // Entities without components are grouped under an empty signature.
+    std::map<ComponentSignature, std::vector<int>> groups;
+
+    for(int i = 0; i < count; ++i)
+    {
+        if(!m_info.entitySystem->IsHandleValid(entities[i].handle))
+        {
+            LogError() << LogWriteError() << "Invalid entity handle.";
+            return false;
+        }
+
+        const ComponentSystem::EntityLocation* location = componentSystem.FindLocation(entities[i].handle);
+        ComponentSignature signature = location != nullptr ? componentSystem.m_archetypes[location->archetype]->signature : 0;
+
+        groups[signature].push_back(i);
+    }
+
+    // Write groups with identifiers, metadata and a packed column per component.
+    m_body.clear();
+    BinaryWriter writer(m_body);
+
+    std::vector<std::uint32_t> componentSizes;
+
+    for(const auto& pair : groups)
+    {
+        const std::vector<int>& indices = pair.second;
+
+        PacketGroup group;
+        group.signature = pair.first;
+        group.entityCount = (std::int32_t)indices.size();
+        group.reserved = 0;
+
+        writer.Write(group);
+
+        m_globalIds.clear();
+        m_offsets.assign(1, 0);
+        m_metadata.clear();
+
+        for(int index : indices)
+        {
+            const HandoffEntity& entity = entities[index];
+            const std::uint8_t* metadata = reinterpret_cast<const std::uint8_t*>(entity.metadata);
+
+            m_globalIds.push_back(entity.globalId);
+            m_metadata.insert(m_metadata.end(), metadata, metadata + entity.metadataSize);
+            m_offsets.push_back((std::uint32_t)m_metadata.size());
+        }
+
+        writer.WriteArray(m_globalIds.data(), m_globalIds.size());
+        writer.WriteArray(m_offsets.data(), m_offsets.size());
+        writer.WriteArray(m_metadata.data(), m_metadata.size());
+
+        componentSizes.clear();
+
+        if(pair.first == 0)
+        {
+            writer.WriteArray(componentSizes.data(), 0);
+            continue;
+        }
+
+        const ComponentSystem::EntityLocation* first = componentSystem.FindLocation(entities[indices.front()].handle);
+        const ComponentSystem::Archetype& archetype = *componentSystem.m_archetypes[first->archetype];
+
+        for(int component : archetype.components)
+        {
+            componentSizes.push_back((std::uint32_t)ComponentTypes::GetInfo(component).size);
+        }
+
+        writer.WriteArray(componentSizes.data(), componentSizes.size());
+
+        for(std::size_t column = 0; column < archetype.components.size(); ++column)
+        {
+            std::size_t size = componentSizes[column];
+            m_column.resize(size * indices.size());
+
+            for(std::size_t i = 0; i < indices.size(); ++i)
+            {
+                const ComponentSystem::EntityLocation* location = componentSystem.FindLocation(entities[indices[i]].handle);
+                const ComponentSystem::Chunk& chunk = archetype.chunks[location->chunk];
+
+                std::memcpy(m_column.data() + size * i, chunk.memory.get() + archetype.columnOffsets[column] + size * location->row, size);
+            }
+
+            writer.WriteArray(m_column.data(), m_column.size());
+        }
+    }
+
+    // Compress the body behind the header.
+    PacketHeader header;
+    header.magic = PacketMagic;
+    header.version = PacketVersion;
+    header.entityCount = count;
+    header.groupCount = (std::int32_t)groups.size();
+    header.bodySize = m_body.size();
+
+    packet.resize(sizeof(PacketHeader) + Compression::GetCompressBound(m_body.size()));
+    std::memcpy(packet.data(), &header, sizeof(PacketHeader));
+
+    std::size_t compressedSize = Compression::Compress(m_body.data(), m_body.size(), packet.data() + sizeof(PacketHeader), packet.size() - sizeof(PacketHeader));
+    packet.resize(sizeof(PacketHeader) + compressedSize);
+
+    return true;
+}
+
+bool EntityHandoff::Read(const void* data, std::size_t size, std::vector<HandoffEntity>& entities)
+{
+    Assert(m_initialized, "Entity handoff is not initialized!");
+
+    // Read the header.
+    PacketHeader header;
+
+    if(data == nullptr || size < sizeof(PacketHeader))
+    {
+        LogError() << LogReadError() << "Packet is too short.";
+        return false;
+    }
+
+    std::memcpy(&header, data, sizeof(PacketHeader));
+
+    // Blocks in the LZ4 format expand at most 255 times when decompressed.
+    std::size_t compressedSize = size - sizeof(PacketHeader);
+
+    if(header.magic != PacketMagic || header.version != PacketVersion || header.entityCount < 0 || header.groupCount < 0 || header.bodySize > (std::uint64_t)compressedSize * 255 || header.bodySize < (std::uint64_t)header.groupCount * sizeof(PacketGroup))
+    {
+        LogError() << LogReadError() << "Invalid packet header.";
+        return false;
+    }
+
+    // Decompress the body, which read metadata points into.
+    m_received.resize((std::size_t)header.bodySize);
+
+    const std::uint8_t* compressed = reinterpret_cast<const std::uint8_t*>(data) + sizeof(PacketHeader);
+
+    if(!Compression::Decompress(compressed, compressedSize, m_received.data(), m_received.size()))
+    {
+        LogError() << LogReadError() << "Couldn't decompress the body.";
+        return false;
+    }
+
+    // Validate the whole packet before creating any entity.
+    m_groups.resize(header.groupCount);
+
+    if(!this->ParseBody((std::size_t)header.entityCount))
+        return false;
+
+    // Recreate entities as active right away and copy their components.
+    for(const ReceivedGroup& group : m_groups)
+    {
+        m_handles.resize(group.count);
+        m_info.entitySystem->CreateActiveEntities(group.count, m_handles.data());
+        m_info.componentSystem->InsertColumns(group.signature, group.count, group.columns.data(), m_handles.data());
+
+        for(int i = 0; i < group.count; ++i)
+        {
+            HandoffEntity entity;
+            entity.handle = m_handles[i];
+            entity.globalId = group.globalIds[i];
+            entity.metadata = group.metadata + group.metadataOffsets[i];
+            entity.metadataSize = group.metadataOffsets[i + 1] - group.metadataOffsets[i];
+
+            entities.push_back(entity);
+        }
+    }
+
+    return true;
+}
+
+bool EntityHandoff::ParseBody(std::size_t entityCount)
+{
+    BinaryReader reader(m_received.data(), m_received.size());
+
+    std::size_t parsedCount = 0;
+
+    for(ReceivedGroup& group : m_groups)
+    {
+        PacketGroup groupHeader;
+
+        if(!reader.Read(groupHeader) || groupHeader.entityCount < 0)
+        {
+            LogError() << LogReadError() << "Invalid group header.";
+            return false;
+        }
+
+        group.signature = groupHeader.signature;
+        group.count = groupHeader.entityCount;
+        parsedCount += group.count;
+
+        // Read identifiers and metadata of entities.
+        std::size_t globalIdCount = 0;
+        std::size_t offsetCount = 0;
+        std::size_t metadataSize = 0;
+
+        group.globalIds = reader.ReadArray<std::uint64_t>(globalIdCount);
+        group.metadataOffsets = reader.ReadArray<std::uint32_t>(offsetCount);
+        group.metadata = reader.ReadArray<std::uint8_t>(metadataSize);
+
+        if(!reader.IsValid() || globalIdCount != (std::size_t)group.count || offsetCount != (std::size_t)group.count + 1)
+        {
+            LogError() << LogReadError() << "Invalid entity identifiers.";
+            return false;
+        }
+
+        for(std::size_t i = 0; i < (std::size_t)group.count; ++i)
+        {
+            if(group.metadataOffsets[i] > group.metadataOffsets[i + 1] || group.metadataOffsets[i + 1] > metadataSize)
+            {
+                LogError() << LogReadError() << "Invalid entity metadata.";
+                return false;
+            }
+        }
+
+        // Read component columns and check that their types match this build.
+        std::size_t componentCount = 0;
+        const std::uint32_t* componentSizes = reader.ReadArray<std::uint32_t>(componentCount);
+
+        if(!reader.IsValid() || (int)componentCount != CountComponents(group.signature))
+        {
+            LogError() << LogReadError() << "Component count does not match the signature.";
+            return false;
+        }
+
+        group.columns.clear();
+
+        for(int component = 0; component < ComponentTypes::MaximumCount; ++component)
+        {
+            if(!(group.signature & ComponentTypes::GetSignatureBit(component)))
+                continue;
+
+            std::size_t index = group.columns.size();
+
+            if(component >= ComponentTypes::GetCount() || ComponentTypes::GetInfo(component).size != componentSizes[index])
+            {
+                LogError() << LogReadError() << "Component types do not match.";
+                return false;
+            }
+
+            std::size_t columnSize = 0;
+            const std::uint8_t* column = reader.ReadArray<std::uint8_t>(columnSize);
+
+            if(!reader.IsValid() || columnSize != (std::size_t)componentSizes[index] * group.count)
+            {
+                LogError() << LogReadError() << "Invalid component column.";
+                return false;
+            }
+
+            group.columns.push_back(column);
+        }
+    }
+
+    if(parsedCount != entityCount)
+    {
+        LogError() << LogReadError() << "Entity count does not match the header.";
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "EntityHandle.hpp"
+#include "EntitySystem.hpp"
+#include "ComponentSystem.hpp"
+
+//
+// Entity Handoff
+//
+//  Serializes entities with their components into compact packets, so they
+//  can be handed off to another node of a shard running in a different
+//  process. Each entity carries its global identifier, see EntityIdPool,
+//  and optional metadata such as clients subscribed to it. Components are
+//  written as packed columns grouped by signature and the whole packet is
+//  compressed, so a transport can send it as is.
+//
+//  Reading a packet recreates entities under new local handles, which are
+//  active right away without a finalize round trip, with their components
+//  copied straight into archetype chunks. The source node destroys handed
+//  off entities after writing them.
+//
+//  Packets are meant to be read by nodes running the same build, as
+//  component types are identified by their registration order.
+//
+//  Example usage:
+//      Game::EntityHandoffInfo info;
+//      info.entitySystem = &entitySystem;
+//      info.componentSystem = &componentSystem;
+//
+//      Game::EntityHandoff handoff;
+//      handoff.Initialize(info);
+//
+//      // On the source node.
+//      Game::HandoffEntity entity;
+//      entity.handle = handle;
+//      entity.globalId = globalId;
+//      entity.metadata = subscribers.data();
+//      entity.metadataSize = subscribers.size() * sizeof(int);
+//
+//      std::vector<std::uint8_t> packet;
+//      handoff.Write(&entity, 1, packet);
+//      entitySystem.DestroyEntity(handle);
+//      socket.Send(packet.data(), packet.size());
+//
+//      // On the target node.
+//      std::vector<Game::HandoffEntity> received;
+//      handoff.Read(packet.data(), packet.size(), received);
+//
+
+namespace Game
+{
+    // Entity handed off between nodes.
+    struct HandoffEntity
+    {
+        HandoffEntity();
+
+        // Handle of the entity in the local entity system.
+        EntityHandle handle;
+
+        // Identifier that is unique across all nodes.
+        std::uint64_t globalId;
+
+        // Optional metadata carried with the entity.
+        // Read metadata points into the handoff and is valid until the next read.
+        const void* metadata;
+        std::size_t metadataSize;
+    };
+
+    // Entity handoff initialization struct.
+    struct EntityHandoffInfo
+    {
+        // Systems that entities are written from and read into.
+        EntitySystem* entitySystem;
+        ComponentSystem* componentSystem;
+
+        EntityHandoffInfo();
+    };
+
+    // Entity handoff class.
+    class EntityHandoff : private NonCopyable
+    {
+    public:
+        EntityHandoff();
+        ~EntityHandoff();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the handoff.
+        bool Initialize(const EntityHandoffInfo& info);
+
+        // Writes entities with their components into a packet.
+        // Commands of the component system must be processed before writing.
+        bool Write(const HandoffEntity* entities, int count, std::vector<std::uint8_t>& packet);
+
+        // Recreates entities of a packet as active entities.
+        // Received entities are appended with their new local handles.
+        bool Read(const void* data, std::size_t size, std::vector<HandoffEntity>& entities);
+
+    private:
+        // Group of entities with the same components in a received packet.
+        struct ReceivedGroup
+        {
+            ComponentSignature signature;
+            int count;
+
+            const std::uint64_t* globalIds;
+            const std::uint32_t* metadataOffsets;
+            const std::uint8_t* metadata;
+
+            // Component columns within the received body.
+            std::vector<const std::uint8_t*> columns;
+        };
+
+        // Type declarations.
+        typedef std::vector<ReceivedGroup> GroupList;
+
+    private:
+        // Parses received groups and checks their component types.
+        bool ParseBody(std::size_t entityCount);
+
+    private:
+        // Initialization parameters.
+        EntityHandoffInfo m_info;
+
+        // Buffers reused between packets.
+        std::vector<std::uint8_t> m_body;
+        std::vector<std::uint8_t> m_column;
+        std::vector<std::uint32_t> m_offsets;
+        std::vector<std::uint64_t> m_globalIds;
+        std::vector<std::uint8_t> m_metadata;
+        std::vector<EntityHandle> m_handles;
+
+        // Body of the last received packet that read metadata points into.
+        std::vector<std::uint8_t> m_received;
+        GroupList m_groups;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,359 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "EntityHandle.hpp"
+
+//
+// Entity Map
+//
+//  Flat hash map tuned for entity handle keys. Elements are stored in a single
+//  array with a power of two size and collisions are resolved with linear
+//  probing, which keeps lookups within a few neighbouring cache lines.
+//  A default constructed key marks an empty slot, so it cannot be inserted.
+//  Pairs of handles can be used as keys as well, e.g. for collision pairs.
+//  Inserting or removing elements invalidates pointers to existing values.
+//
+//  Example usage:
+//      Game::EntityMap<int> map;
+//      map.Insert(entity, 42);
+//
+//      if(int* value = map.Find(entity))
+//      {
+//          *value += 1;
+//      }
+//
+//      map.Remove(entity);
+//
+//      Game::EntityMap<float, std::pair<EntityHandle, EntityHandle>> pairs;
+//      pairs[std::make_pair(first, second)] = 1.0f;
+//
+
+namespace Game
+{
+    // Entity map class.
+    template<typename Value, typename Key = EntityHandle, typename Hash = std::hash<Key>>
+    class EntityMap
+    {
+    public:
+        EntityMap();
+
+        // Restores instance to it's original state and frees its memory.
+        void Cleanup();
+
+        // Removes all elements while keeping the memory.
+        void Clear();
+
+        // Makes sure that the map can hold a number of elements without growing.
+        void Reserve(std::size_t count);
+
+        // Inserts or replaces an element.
+        Value* Insert(const Key& key, const Value& value);
+
+        // Gets an element, inserting a default one if it does not exist.
+        Value& operator[](const Key& key);
+
+        // Finds an element.
+        Value* Find(const Key& key);
+        const Value* Find(const Key& key) const;
+
+        // Removes an element.
+        bool Remove(const Key& key);
+
+        // Checks if the map contains an element.
+        bool Contains(const Key& key) const;
+
+        // Calls a function for each element in an unspecified order.
+        template<typename Function>
+        void ForEach(Function function) const;
+
+        // Checks if the map is empty.
+        bool IsEmpty() const;
+
+        // Gets the number of elements.
+        std::size_t GetSize() const;
+
+        // Gets the number of slots.
+        std::size_t GetCapacity() const;
+
+    private:
+        // Type declarations.
+        struct Slot
+        {
+            Key key;
+            Value value;
+        };
+
+        typedef std::vector<Slot> SlotList;
+
+    private:
+        // Checks if a slot is empty.
+        static bool IsSlotEmpty(const Slot& slot);
+
+        // Calculates the preferred slot index of a key.
+        std::size_t CalculateSlotIndex(const Key& key) const;
+
+        // Finds the slot index of a key or returns the number of slots.
+        std::size_t FindSlot(const Key& key) const;
+
+        // Inserts an element without checking the capacity.
+        Value* InsertSlot(const Key& key, const Value& value);
+
+        // Rebuilds the slot array with a new power of two size.
+        void Rehash(std::size_t capacity);
+
+    private:
+        // Array of slots with a power of two size.
+        SlotList m_slots;
+
+        // Number of stored elements.
+        std::size_t m_size;
+    };
+}
+
+// Template implementations.
+namespace Game
+{
+    template<typename Value, typename Key, typename Hash>
+    EntityMap<Value, Key, Hash>::EntityMap() :
+        m_size(0)
+    {
+    }
+
+    template<typename Value, typename Key, typename Hash>
+    void EntityMap<Value, Key, Hash>::Cleanup()
+    {
+        Utility::ClearContainer(m_slots);
+        m_size = 0;
+    }
+
+    template<typename Value, typename Key, typename Hash>
+    void EntityMap<Value, Key, Hash>::Clear()
+    {
+        for(Slot& slot : m_slots)
+        {
+            slot = Slot();
+        }
+
+        m_size = 0;
+    }
+
+    template<typename Value, typename Key, typename Hash>
+    void EntityMap<Value, Key, Hash>::Reserve(std::size_t count)
+    {
+        // Keep the load factor below three quarters.
+        std::size_t required = count + count / 3 + 1;
+
+        if(required > m_slots.size())
+        {
+            std::size_t capacity = 16;
+
+            while(capacity < required)
+            {
+                capacity *= 2;
+            }
+
+            this->Rehash(capacity);
+        }
+    }
+
+    template<typename Value, typename Key, typename Hash>
+    Value* EntityMap<Value, Key, Hash>::Insert(const Key& key, const Value& value)
+    {
+        Assert(!(key == Key()), "Attempting to insert an invalid key!");
+
+        // Replace an existing element.
+        std::size_t index = this->FindSlot(key);
+
+        if(index != m_slots.size())
+        {
+            m_slots[index].value = value;
+            return &m_slots[index].value;
+        }
+
+        // Insert a new element.
+        this->Reserve(m_size + 1);
+
+        return this->InsertSlot(key, value);
+    }
+
+    template<typename Value, typename Key, typename Hash>
+    Value& EntityMap<Value, Key, Hash>::operator[](const Key& key)
+    {
+        Value* value = this->Find(key);
+
+        if(value == nullptr)
+        {
+            value = this->Insert(key, Value());
+        }
+
+        return *value;
+    }
+
+    template<typename Value, typename Key, typename Hash>
+    Value* EntityMap<Value, Key, Hash>::Find(const Key& key)
+    {
+        std::size_t index = this->FindSlot(key);
+
+        if(index == m_slots.size())
+            return nullptr;
+
+        return &m_slots[index].value;
+    }
+
+    template<typename Value, typename Key, typename Hash>
+    const Value* EntityMap<Value, Key, Hash>::Find(const Key& key) const
+    {
+        std::size_t index = this->FindSlot(key);
+
+        if(index == m_slots.size())
+            return nullptr;
+
+        return &m_slots[index].value;
+    }
+
+    template<typename Value, typename Key, typename Hash>
+    bool EntityMap<Value, Key, Hash>::Remove(const Key& key)
+    {
+        std::size_t index = this->FindSlot(key);
+
+        if(index == m_slots.size())
+            return false;
+
+        // Shift following elements back to close the gap,
+        // so probing sequences do not need any tombstones.
+        std::size_t mask = m_slots.size() - 1;
+        std::size_t next = index;
+
+        while(true)
+        {
+            next = (next + 1) & mask;
+
+            if(IsSlotEmpty(m_slots[next]))
+                break;
+
+            // Move the element if the gap lies between its preferred slot and its current slot.
+            std::size_t preferred = this->CalculateSlotIndex(m_slots[next].key);
+
+            if(((next - preferred) & mask) >= ((next - index) & mask))
+            {
+                m_slots[index] = std::move(m_slots[next]);
+                index = next;
+            }
+        }
+
+        m_slots[index] = Slot();
+        m_size -= 1;
+
+        return true;
+    }
+
+    template<typename Value, typename Key, typename Hash>
+    bool EntityMap<Value, Key, Hash>::Contains(const Key& key) const
+    {
+        return this->FindSlot(key) != m_slots.size();
+    }
+
+    template<typename Value, typename Key, typename Hash>
+    template<typename Function>
+    void EntityMap<Value, Key, Hash>::ForEach(Function function) const
+    {
+        for(const Slot& slot : m_slots)
+        {
+            if(!IsSlotEmpty(slot))
+            {
+                function(slot.key, slot.value);
+            }
+        }
+    }
+
+    template<typename Value, typename Key, typename Hash>
+    bool EntityMap<Value, Key, Hash>::IsEmpty() const
+    {
+        return m_size == 0;
+    }
+
+    template<typename Value, typename Key, typename Hash>
+    std::size_t EntityMap<Value, Key, Hash>::GetSize() const
+    {
+        return m_size;
+    }
+
+    template<typename Value, typename Key, typename Hash>
+    std::size_t EntityMap<Value, Key, Hash>::GetCapacity() const
+    {
+        return m_slots.size();
+    }
+
+    template<typename Value, typename Key, typename Hash>
+    bool EntityMap<Value, Key, Hash>::IsSlotEmpty(const Slot& slot)
+    {
+        return slot.key == Key();
+    }
+
+    template<typename Value, typename Key, typename Hash>
+    std::size_t EntityMap<Value, Key, Hash>::CalculateSlotIndex(const Key& key) const
+    {
+        return Hash()(key) & (m_slots.size() - 1);
+    }
+
+    template<typename Value, typename Key, typename Hash>
+    std::size_t EntityMap<Value, Key, Hash>::FindSlot(const Key& key) const
+    {
+        if(m_size == 0 || key == Key())
+            return m_slots.size();
+
+        // Probe slots until the key or an empty slot is found.
+        std::size_t mask = m_slots.size() - 1;
+        std::size_t index = this->CalculateSlotIndex(key);
+
+        while(!IsSlotEmpty(m_slots[index]))
+        {
+            if(m_slots[index].key == key)
+                return index;
+
+            index = (index + 1) & mask;
+        }
+
+        return m_slots.size();
+    }
+
+    template<typename Value, typename Key, typename Hash>
+    Value* EntityMap<Value, Key, Hash>::InsertSlot(const Key& key, const Value& value)
+    {
+        Assert(m_size < m_slots.size(), "Entity map has no free slots!");
+
+        // Probe slots until an empty one is found.
+        std::size_t mask = m_slots.size() - 1;
+        std::size_t index = this->CalculateSlotIndex(key);
+
+        while(!IsSlotEmpty(m_slots[index]))
+        {
+            index = (index + 1) & mask;
+        }
+
+        m_slots[index].key = key;
+        m_slots[index].value = value;
+        m_size += 1;
+
+        return &m_slots[index].value;
+    }
+
+    template<typename Value, typename Key, typename Hash>
+    void EntityMap<Value, Key, Hash>::Rehash(std::size_t capacity)
+    {
+        Assert((capacity & (capacity - 1)) == 0, "Entity map capacity must be a power of two!");
+
+        // Move elements into a new array.
+        SlotList slots(capacity);
+        m_slots.swap(slots);
+        m_size = 0;
+
+        for(Slot& slot : slots)
+        {
+            if(!IsSlotEmpty(slot))
+            {
+                this->InsertSlot(slot.key, slot.value);
+            }
+        }
+    }
+}
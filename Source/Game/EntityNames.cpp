@@ -0,0 +1,462 @@
+#include "Precompiled.hpp"
+#include "EntityNames.hpp"
+using namespace Game;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize entity names! "
+    #define LogInternError(text) "Failed to intern \"" << text << "\" string! "
+}
+
+EntityNames::Entry::Entry() :
+    name(InvalidString),
+    active(false)
+{
+}
+
+EntityNames::EntityNames() :
+    m_entitySystem(nullptr),
+    m_initialized(false)
+{
+}
+
+EntityNames::~EntityNames()
+{
+    this->Cleanup();
+}
+
+void EntityNames::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Unsubscribe from the entity system.
+    m_entityCreate.Cleanup();
+    m_entityDestroy.Cleanup();
+    m_entitySystem = nullptr;
+
+    // Clear strings and lookups.
+    Utility::ClearContainer(m_strings);
+    m_stringIds.Cleanup();
+    Utility::ClearContainer(m_nameOwners);
+    Utility::ClearContainer(m_tagMembers);
+    Utility::ClearContainer(m_entries);
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool EntityNames::Initialize(EntitySystem* entitySystem)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(entitySystem == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid entity system.";
+        return false;
+    }
+
+    m_entitySystem = entitySystem;
+
+    // Publish names and tags of created entities and remove those of destroyed ones.
+    m_entityCreate.Bind<EntityNames, &EntityNames::OnEntityCreate>(this);
+    m_entityCreate.Subscribe(entitySystem->events.create);
+
+    m_entityDestroy.Bind<EntityNames, &EntityNames::OnEntityDestroy>(this);
+    m_entityDestroy.Subscribe(entitySystem->events.destroy);
+
+    // Success!
+    return m_initialized = true;
+}
+
+int EntityNames::Intern(const System::ConfigName& text)
+{
+    if(!m_initialized)
+        return InvalidString;
+
+    // A zero key marks empty slots of the map.
+    if(text.GetHash() == 0)
+    {
+        LogError() << LogInternError(text.GetString()) << "Reserved hash.";
+        return InvalidString;
+    }
+
+    if(const int* identifier = m_stringIds.Find(text.GetHash()))
+    {
+        const std::string& interned = m_strings[*identifier];
+
+        // Make sure that the hash does not belong to a different string.
+        if(interned.size() != text.GetLength() || std::memcmp(interned.data(), text.GetText(), text.GetLength()) != 0)
+        {
+            LogError() << LogInternError(text.GetString()) << "Hash collides with \"" << interned << "\" string.";
+            return InvalidString;
+        }
+
+        return *identifier;
+    }
+
+    // Add the string along with its name owner and tag list.
+    int identifier = (int)m_strings.size();
+
+    m_strings.emplace_back(text.GetText(), text.GetLength());
+    m_nameOwners.emplace_back();
+    m_tagMembers.emplace_back();
+
+    m_stringIds.Insert(text.GetHash(), identifier);
+
+    return identifier;
+}
+
+int EntityNames::FindString(const System::ConfigName& text) const
+{
+    if(!m_initialized)
+        return InvalidString;
+
+    const int* identifier = m_stringIds.Find(text.GetHash());
+
+    if(identifier == nullptr)
+        return InvalidString;
+
+    return *identifier;
+}
+
+const std::string& EntityNames::GetString(int identifier) const
+{
+    Assert(identifier >= 0 && identifier < (int)m_strings.size(), "Invalid string identifier!");
+
+    return m_strings[identifier];
+}
+
+bool EntityNames::SetName(const EntityHandle& entity, const System::ConfigName& name)
+{
+    if(!m_initialized)
+        return false;
+
+    if(!m_entitySystem->IsHandleValid(entity))
+        return false;
+
+    int identifier = this->Intern(name);
+
+    if(identifier == InvalidString)
+        return false;
+
+    // Names are unique among active entities.
+    const EntityHandle& owner = m_nameOwners[identifier];
+
+    if(owner != EntityHandle() && owner != entity)
+        return false;
+
+    Entry& entry = this->AcquireEntry(entity);
+
+    if(entry.active)
+    {
+        if(entry.name != InvalidString)
+        {
+            m_nameOwners[entry.name] = EntityHandle();
+        }
+
+        m_nameOwners[identifier] = entity;
+    }
+
+    entry.name = identifier;
+
+    return true;
+}
+
+void EntityNames::ClearName(const EntityHandle& entity)
+{
+    if(!m_initialized)
+        return;
+
+    const Entry* found = this->FindEntry(entity);
+
+    if(found == nullptr || found->name == InvalidString)
+        return;
+
+    Entry& entry = m_entries[entity.GetIdentifier() - 1];
+
+    if(entry.active)
+    {
+        m_nameOwners[entry.name] = EntityHandle();
+    }
+
+    entry.name = InvalidString;
+}
+
+int EntityNames::GetName(const EntityHandle& entity) const
+{
+    const Entry* entry = this->FindEntry(entity);
+
+    if(entry == nullptr)
+        return InvalidString;
+
+    return entry->name;
+}
+
+EntityHandle EntityNames::FindEntity(const System::ConfigName& name) const
+{
+    int identifier = this->FindString(name);
+
+    if(identifier == InvalidString)
+        return EntityHandle();
+
+    return m_nameOwners[identifier];
+}
+
+bool EntityNames::AddTag(const EntityHandle& entity, const System::ConfigName& tag)
+{
+    if(!m_initialized)
+        return false;
+
+    if(!m_entitySystem->IsHandleValid(entity))
+        return false;
+
+    int identifier = this->Intern(tag);
+
+    if(identifier == InvalidString)
+        return false;
+
+    Entry& entry = this->AcquireEntry(entity);
+
+    for(const Membership& membership : entry.tags)
+    {
+        if(membership.tag == identifier)
+            return true;
+    }
+
+    Membership membership;
+    membership.tag = identifier;
+    membership.index = -1;
+
+    if(entry.active)
+    {
+        this->InsertMember(entity, membership);
+    }
+
+    entry.tags.push_back(membership);
+
+    return true;
+}
+
+bool EntityNames::RemoveTag(const EntityHandle& entity, const System::ConfigName& tag)
+{
+    if(!m_initialized)
+        return false;
+
+    int identifier = this->FindString(tag);
+
+    if(identifier == InvalidString || this->FindEntry(entity) == nullptr)
+        return false;
+
+    Entry& entry = m_entries[entity.GetIdentifier() - 1];
+
+    for(std::size_t i = 0; i < entry.tags.size(); ++i)
+    {
+        if(entry.tags[i].tag != identifier)
+            continue;
+
+        if(entry.active)
+        {
+            this->EraseMember(entry.tags[i]);
+        }
+
+        entry.tags[i] = entry.tags.back();
+        entry.tags.pop_back();
+
+        return true;
+    }
+
+    return false;
+}
+
+bool EntityNames::HasTag(const EntityHandle& entity, const System::ConfigName& tag) const
+{
+    int identifier = this->FindString(tag);
+    const Entry* entry = this->FindEntry(entity);
+
+    if(identifier == InvalidString || entry == nullptr)
+        return false;
+
+    for(const Membership& membership : entry->tags)
+    {
+        if(membership.tag == identifier)
+            return true;
+    }
+
+    return false;
+}
+
+const EntityNames::EntityList& EntityNames::GetTagged(const System::ConfigName& tag) const
+{
+    int identifier = this->FindString(tag);
+
+    if(identifier == InvalidString)
+        return m_emptyList;
+
+    return m_tagMembers[identifier];
+}
+
+EntityNames::Entry& EntityNames::AcquireEntry(const EntityHandle& entity)
+{
+    int index = entity.GetIdentifier() - 1;
+
+    if(index >= (int)m_entries.size())
+    {
+        m_entries.resize(index + 1);
+    }
+
+    Entry& entry = m_entries[index];
+
+    if(entry.handle != entity)
+    {
+        // Entities that left without a destroy event, such as migrated ones, are still published.
+        if(entry.active)
+        {
+            this->Unpublish(entry);
+        }
+
+        entry = Entry();
+        entry.handle = entity;
+
+        // Entities created without create events, such as loaded ones, are published right away.
+        if(m_entitySystem->IsEntityActive(entity))
+        {
+            this->Publish(entry);
+        }
+    }
+
+    return entry;
+}
+
+const EntityNames::Entry* EntityNames::FindEntry(const EntityHandle& entity) const
+{
+    int index = entity.GetIdentifier() - 1;
+
+    if(index < 0 || index >= (int)m_entries.size())
+        return nullptr;
+
+    if(m_entries[index].handle != entity)
+        return nullptr;
+
+    return &m_entries[index];
+}
+
+void EntityNames::Publish(Entry& entry)
+{
+    Assert(!entry.active, "Entry is already published!");
+
+    entry.active = true;
+
+    // Drop a name that another entity took while this one was being created.
+    if(entry.name != InvalidString)
+    {
+        EntityHandle& owner = m_nameOwners[entry.name];
+
+        if(owner != EntityHandle() && owner != entry.handle)
+        {
+            LogWarning() << "Entity name \"" << m_strings[entry.name] << "\" is already taken!";
+            entry.name = InvalidString;
+        }
+        else
+        {
+            owner = entry.handle;
+        }
+    }
+
+    for(Membership& membership : entry.tags)
+    {
+        this->InsertMember(entry.handle, membership);
+    }
+}
+
+void EntityNames::Unpublish(Entry& entry)
+{
+    Assert(entry.active, "Entry is not published!");
+
+    if(entry.name != InvalidString && m_nameOwners[entry.name] == entry.handle)
+    {
+        m_nameOwners[entry.name] = EntityHandle();
+    }
+
+    for(Membership& membership : entry.tags)
+    {
+        this->EraseMember(membership);
+        membership.index = -1;
+    }
+
+    entry.active = false;
+}
+
+void EntityNames::InsertMember(const EntityHandle& entity, Membership& membership)
+{
+    EntityList& members = m_tagMembers[membership.tag];
+
+    membership.index = (int)members.size();
+    members.push_back(entity);
+}
+
+void EntityNames::EraseMember(const Membership& membership)
+{
+    EntityList& members = m_tagMembers[membership.tag];
+
+    Assert(membership.index >= 0 && membership.index < (int)members.size(), "Invalid tag membership!");
+
+    // Move the last member into the removed one and update its index.
+    const EntityHandle& last = members.back();
+
+    if(membership.index != (int)members.size() - 1)
+    {
+        Entry& moved = m_entries[last.GetIdentifier() - 1];
+
+        for(Membership& other : moved.tags)
+        {
+            if(other.tag == membership.tag)
+            {
+                other.index = membership.index;
+                break;
+            }
+        }
+
+        members[membership.index] = last;
+    }
+
+    members.pop_back();
+}
+
+void EntityNames::OnEntityCreate(EntitySystem::Events::Create event)
+{
+    int index = event.handle.GetIdentifier() - 1;
+
+    if(index >= (int)m_entries.size())
+        return;
+
+    Entry& entry = m_entries[index];
+
+    if(entry.handle == event.handle && !entry.active)
+    {
+        this->Publish(entry);
+    }
+}
+
+void EntityNames::OnEntityDestroy(EntitySystem::Events::Destroy event)
+{
+    int index = event.handle.GetIdentifier() - 1;
+
+    if(index >= (int)m_entries.size())
+        return;
+
+    Entry& entry = m_entries[index];
+
+    if(entry.handle != event.handle)
+        return;
+
+    if(entry.active)
+    {
+        this->Unpublish(entry);
+    }
+
+    entry = Entry();
+}
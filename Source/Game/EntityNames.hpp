@@ -0,0 +1,180 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "System/Config.hpp"
+#include "EntityHandle.hpp"
+#include "EntityMap.hpp"
+#include "EntitySystem.hpp"
+
+//
+// Entity Names
+//
+//  Finds entities by unique names and by tags given as strings, for
+//  scripts and tools that refer to entities by text. Names and tags are
+//  interned into string identifiers once, in a flat hash map keyed by
+//  FNV-1a hashes of their texts. They are passed as ConfigName, which
+//  hashes string literals at compile time, so lookups do not compare or
+//  copy strings. Interning fails if two texts share a hash.
+//
+//  Each name is owned by a single entity, found with a single lookup, and
+//  each tag keeps a list of its entities, which are removed from it in
+//  constant time. Names and tags can be assigned to entities that have not
+//  been created yet, and are published to lookups on the create event.
+//  Entities are removed from lookups on the destroy event, so handles that
+//  are returned are always of active entities.
+//
+//  Tags that are known at compile time and queried every frame should be
+//  marker components of EntityTags instead, which filters them with bits.
+//
+//  Example usage:
+//      Game::EntityNames names;
+//      names.Initialize(&entitySystem);
+//
+//      names.SetName(entity, "Player");
+//      names.AddTag(entity, "Team.Blue");
+//      entitySystem.ProcessCommands();
+//
+//      EntityHandle player = names.FindEntity("Player");
+//
+//      for(const EntityHandle& member : names.GetTagged("Team.Blue"))
+//      {
+//          /* ... */
+//      }
+//
+
+namespace Game
+{
+    // Entity names class.
+    class EntityNames : private NonCopyable
+    {
+    public:
+        // Type declarations.
+        typedef std::vector<EntityHandle> EntityList;
+
+        // Identifier returned for strings that are not interned.
+        static const int InvalidString = -1;
+
+    public:
+        EntityNames();
+        ~EntityNames();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the name index.
+        bool Initialize(EntitySystem* entitySystem);
+
+        // Interns a string and returns its identifier.
+        // Returns an invalid identifier if it collides with another string.
+        int Intern(const System::ConfigName& text);
+
+        // Finds the identifier of an interned string.
+        int FindString(const System::ConfigName& text) const;
+
+        // Gets the text of an interned string.
+        const std::string& GetString(int identifier) const;
+
+        // Sets a unique name of an entity, replacing its previous name.
+        // Returns false if the handle is not valid or another entity has the name.
+        bool SetName(const EntityHandle& entity, const System::ConfigName& name);
+
+        // Removes the name of an entity.
+        void ClearName(const EntityHandle& entity);
+
+        // Gets the string identifier of the name of an entity.
+        int GetName(const EntityHandle& entity) const;
+
+        // Finds an active entity by its name.
+        // Returns an invalid handle if no active entity has the name.
+        EntityHandle FindEntity(const System::ConfigName& name) const;
+
+        // Adds a tag to an entity.
+        // Returns false if the handle is not valid.
+        bool AddTag(const EntityHandle& entity, const System::ConfigName& tag);
+
+        // Removes a tag from an entity.
+        bool RemoveTag(const EntityHandle& entity, const System::ConfigName& tag);
+
+        // Checks if an entity has a tag.
+        bool HasTag(const EntityHandle& entity, const System::ConfigName& tag) const;
+
+        // Gets active entities with a tag in an unspecified order.
+        // List is only valid until tags or entities change.
+        const EntityList& GetTagged(const System::ConfigName& tag) const;
+
+    private:
+        // Membership of an entity in a list of tagged entities.
+        struct Membership
+        {
+            int tag;
+            int index;
+        };
+
+        // Names and tags of an entity, indexed by handle identifiers.
+        // Only entries of active entities are published to lookups.
+        struct Entry
+        {
+            Entry();
+
+            EntityHandle handle;
+            int name;
+            bool active;
+            std::vector<Membership> tags;
+        };
+
+        // Type declarations.
+        typedef std::vector<Entry> EntryList;
+        typedef std::vector<std::string> StringList;
+        typedef std::vector<EntityList> TagList;
+
+    private:
+        // Gets the entry of an entity, resetting an entry left by a previous handle.
+        Entry& AcquireEntry(const EntityHandle& entity);
+
+        // Finds the entry of an entity or returns nullptr.
+        const Entry* FindEntry(const EntityHandle& entity) const;
+
+        // Publishes names and tags of an entry to lookups.
+        void Publish(Entry& entry);
+
+        // Removes names and tags of an entry from lookups.
+        void Unpublish(Entry& entry);
+
+        // Adds an entity to a list of tagged entities.
+        void InsertMember(const EntityHandle& entity, Membership& membership);
+
+        // Removes an entity from a list of tagged entities.
+        void EraseMember(const Membership& membership);
+
+        // Called when an entity is created.
+        void OnEntityCreate(EntitySystem::Events::Create event);
+
+        // Called when an entity is destroyed.
+        void OnEntityDestroy(EntitySystem::Events::Destroy event);
+
+    private:
+        // Entity system that owns the entities.
+        EntitySystem* m_entitySystem;
+
+        // Interned strings and their identifiers by hashes.
+        StringList m_strings;
+        EntityMap<int, std::uint64_t> m_stringIds;
+
+        // Owners of names and lists of tagged entities, by string identifiers.
+        EntityList m_nameOwners;
+        TagList m_tagMembers;
+
+        // Entries indexed by entity handle identifiers.
+        EntryList m_entries;
+
+        // List returned for tags without entities.
+        EntityList m_emptyList;
+
+        // Entity system event receivers.
+        Receiver<void(EntitySystem::Events::Create)> m_entityCreate;
+        Receiver<void(EntitySystem::Events::Destroy)> m_entityDestroy;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
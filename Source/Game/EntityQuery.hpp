@@ -0,0 +1,374 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "EntityHandle.hpp"
+#include "ComponentPool.hpp"
+#include "EntityView.hpp"
+
+//
+// Entity Query
+//
+//  Keeps a packed list of entities that have components in all of the
+//  given pools. Unlike a view, membership is not recomputed on every
+//  iteration, but updated incrementally whenever a component is added to
+//  or removed from one of the pools. Destroyed entities leave the query
+//  when pools remove their components. Best suited for joins whose
+//  members stay the same over many frames. Query cleans itself up when
+//  any of its pools is cleaned up or destroyed.
+//
+//  Example usage:
+//      Game::EntityQuery<Transform, Velocity> query;
+//      query.Initialize(transforms, velocities);
+//
+//      query.ForEach([](const EntityHandle& entity, Transform& transform, Velocity& velocity)
+//      {
+//          transform.position += velocity.direction;
+//      });
+//
+
+namespace Game
+{
+    namespace Detail
+    {
+        // Holds a pool of a single component type and its event receivers.
+        template<typename Type>
+        struct EntityQueryPool
+        {
+            EntityQueryPool() :
+                pool(nullptr)
+            {
+            }
+
+            ComponentPool<Type>* pool;
+
+            Receiver<void(typename ComponentPool<Type>::Events::Add)> add;
+            Receiver<void(typename ComponentPool<Type>::Events::Remove)> remove;
+            Receiver<void(typename ComponentPool<Type>::Events::Cleanup)> cleanup;
+        };
+    }
+
+    // Entity query class.
+    template<typename... Types>
+    class EntityQuery : private NonCopyable, private Detail::EntityQueryPool<Types>...
+    {
+    public:
+        static_assert(sizeof...(Types) > 0, "Entity query needs at least one component type!");
+
+    public:
+        EntityQuery();
+        ~EntityQuery();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the query and gathers its current members.
+        // Pools must be initialized and outlive the query or be cleaned up before it.
+        bool Initialize(ComponentPool<Types>&... pools);
+
+        // Calls a function for each member entity.
+        template<typename Function>
+        void ForEach(Function function);
+
+        // Checks if an entity is a member of the query.
+        bool IsMember(const EntityHandle& entity) const;
+
+        // Gets the packed array of member entities.
+        const EntityHandle* GetMembers() const;
+
+        // Gets the number of member entities.
+        int GetMemberCount() const;
+
+        // Checks if the instance is initialized.
+        bool IsInitialized() const;
+
+    private:
+        // Type declarations.
+        typedef std::vector<EntityHandle> MemberList;
+        typedef std::vector<int> IndexList;
+
+    private:
+        // Gets the pool of a component type.
+        template<typename Type>
+        Detail::EntityQueryPool<Type>& GetPool();
+
+        template<typename Type>
+        const Detail::EntityQueryPool<Type>& GetPool() const;
+
+        // Subscribes to events of a pool.
+        template<typename Type>
+        void SubscribePool(ComponentPool<Type>& pool);
+
+        // Unsubscribes from events of a pool.
+        template<typename Type>
+        void UnsubscribePool();
+
+        // Checks if an entity has components in all pools.
+        bool HasAllComponents(const EntityHandle& entity) const;
+
+        // Adds or removes a member.
+        void AddMember(const EntityHandle& entity);
+        void RemoveMember(const EntityHandle& entity);
+
+        // Called when a component is added or removed.
+        template<typename Type>
+        void OnComponentAdd(typename ComponentPool<Type>::Events::Add event);
+
+        template<typename Type>
+        void OnComponentRemove(typename ComponentPool<Type>::Events::Remove event);
+
+        // Called when a pool is cleaned up.
+        template<typename Type>
+        void OnPoolCleanup(typename ComponentPool<Type>::Events::Cleanup event);
+
+    private:
+        // Packed list of member entities.
+        MemberList m_members;
+
+        // Member indices indexed by entity handle identifiers.
+        IndexList m_memberIndices;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
+
+// Template implementations.
+namespace Game
+{
+    template<typename... Types>
+    EntityQuery<Types...>::EntityQuery() :
+        m_initialized(false)
+    {
+    }
+
+    template<typename... Types>
+    EntityQuery<Types...>::~EntityQuery()
+    {
+        this->Cleanup();
+    }
+
+    template<typename... Types>
+    void EntityQuery<Types...>::Cleanup()
+    {
+        if(!m_initialized)
+            return;
+
+        // Unsubscribe from pool events.
+        int unsubscribe[] = { (this->template UnsubscribePool<Types>(), 0)... };
+        (void)unsubscribe;
+
+        // Clear the member list.
+        Utility::ClearContainer(m_members);
+        Utility::ClearContainer(m_memberIndices);
+
+        // Reset the initialization state.
+        m_initialized = false;
+    }
+
+    template<typename... Types>
+    bool EntityQuery<Types...>::Initialize(ComponentPool<Types>&... pools)
+    {
+        // Cleanup this instance.
+        this->Cleanup();
+
+        // Setup a cleanup guard.
+        SCOPE_GUARD
+        (
+            if(!m_initialized)
+            {
+                m_initialized = true;
+                this->Cleanup();
+            }
+        );
+
+        // Validate arguments.
+        bool initialized[] = { pools.IsInitialized()... };
+
+        for(bool pool : initialized)
+        {
+            if(!pool)
+            {
+                LogError() << "Failed to initialize an entity query! Invalid component pool.";
+                return false;
+            }
+        }
+
+        // Subscribe to pool events.
+        int subscribe[] = { (this->template SubscribePool<Types>(pools), 0)... };
+        (void)subscribe;
+
+        // Gather entities that already have all components.
+        EntityView<Types...> view(pools...);
+
+        view.ForEach([this](const EntityHandle& entity, Types&...)
+        {
+            this->AddMember(entity);
+        });
+
+        // Success!
+        return m_initialized = true;
+    }
+
+    template<typename... Types>
+    template<typename Function>
+    void EntityQuery<Types...>::ForEach(Function function)
+    {
+        // Iterate over a packed list of members without any filtering.
+        for(std::size_t i = 0; i < m_members.size(); ++i)
+        {
+            const EntityHandle& entity = m_members[i];
+            function(entity, *this->template GetPool<Types>().pool->Get(entity)...);
+        }
+    }
+
+    template<typename... Types>
+    bool EntityQuery<Types...>::IsMember(const EntityHandle& entity) const
+    {
+        int entityIndex = entity.GetIdentifier() - 1;
+
+        if(entityIndex < 0 || entityIndex >= (int)m_memberIndices.size())
+            return false;
+
+        int memberIndex = m_memberIndices[entityIndex];
+        return memberIndex >= 0 && m_members[memberIndex] == entity;
+    }
+
+    template<typename... Types>
+    const EntityHandle* EntityQuery<Types...>::GetMembers() const
+    {
+        return m_members.data();
+    }
+
+    template<typename... Types>
+    int EntityQuery<Types...>::GetMemberCount() const
+    {
+        return (int)m_members.size();
+    }
+
+    template<typename... Types>
+    bool EntityQuery<Types...>::IsInitialized() const
+    {
+        return m_initialized;
+    }
+
+    template<typename... Types>
+    template<typename Type>
+    Detail::EntityQueryPool<Type>& EntityQuery<Types...>::GetPool()
+    {
+        return *static_cast<Detail::EntityQueryPool<Type>*>(this);
+    }
+
+    template<typename... Types>
+    template<typename Type>
+    const Detail::EntityQueryPool<Type>& EntityQuery<Types...>::GetPool() const
+    {
+        return *static_cast<const Detail::EntityQueryPool<Type>*>(this);
+    }
+
+    template<typename... Types>
+    template<typename Type>
+    void EntityQuery<Types...>::SubscribePool(ComponentPool<Type>& pool)
+    {
+        Detail::EntityQueryPool<Type>& element = this->template GetPool<Type>();
+        element.pool = &pool;
+
+        element.add.template Bind<EntityQuery<Types...>, &EntityQuery<Types...>::template OnComponentAdd<Type>>(this);
+        element.add.Subscribe(pool.events.add);
+
+        element.remove.template Bind<EntityQuery<Types...>, &EntityQuery<Types...>::template OnComponentRemove<Type>>(this);
+        element.remove.Subscribe(pool.events.remove);
+
+        element.cleanup.template Bind<EntityQuery<Types...>, &EntityQuery<Types...>::template OnPoolCleanup<Type>>(this);
+        element.cleanup.Subscribe(pool.events.cleanup);
+    }
+
+    template<typename... Types>
+    template<typename Type>
+    void EntityQuery<Types...>::UnsubscribePool()
+    {
+        Detail::EntityQueryPool<Type>& element = this->template GetPool<Type>();
+        element.add.Cleanup();
+        element.remove.Cleanup();
+        element.cleanup.Cleanup();
+        element.pool = nullptr;
+    }
+
+    template<typename... Types>
+    bool EntityQuery<Types...>::HasAllComponents(const EntityHandle& entity) const
+    {
+        bool found[] = { this->template GetPool<Types>().pool->Has(entity)... };
+
+        for(bool component : found)
+        {
+            if(!component)
+                return false;
+        }
+
+        return true;
+    }
+
+    template<typename... Types>
+    void EntityQuery<Types...>::AddMember(const EntityHandle& entity)
+    {
+        Assert(!this->IsMember(entity), "Entity is already a member of the query!");
+
+        // Make sure the index array can hold the entity.
+        int entityIndex = entity.GetIdentifier() - 1;
+
+        if(entityIndex >= (int)m_memberIndices.size())
+        {
+            m_memberIndices.resize(entityIndex + 1, -1);
+        }
+
+        // Add the member at the end of the list.
+        m_memberIndices[entityIndex] = (int)m_members.size();
+        m_members.push_back(entity);
+    }
+
+    template<typename... Types>
+    void EntityQuery<Types...>::RemoveMember(const EntityHandle& entity)
+    {
+        Assert(this->IsMember(entity), "Entity is not a member of the query!");
+
+        int entityIndex = entity.GetIdentifier() - 1;
+        int memberIndex = m_memberIndices[entityIndex];
+
+        // Move the last member in place of the removed one.
+        const EntityHandle& lastMember = m_members.back();
+        m_memberIndices[lastMember.GetIdentifier() - 1] = memberIndex;
+        m_members[memberIndex] = lastMember;
+
+        m_members.pop_back();
+        m_memberIndices[entityIndex] = -1;
+    }
+
+    template<typename... Types>
+    template<typename Type>
+    void EntityQuery<Types...>::OnComponentAdd(typename ComponentPool<Type>::Events::Add event)
+    {
+        // Entity becomes a member once it has all components.
+        if(!this->IsMember(event.handle) && this->HasAllComponents(event.handle))
+        {
+            this->AddMember(event.handle);
+        }
+    }
+
+    template<typename... Types>
+    template<typename Type>
+    void EntityQuery<Types...>::OnComponentRemove(typename ComponentPool<Type>::Events::Remove event)
+    {
+        // Entity stops being a member when any component is removed.
+        if(this->IsMember(event.handle))
+        {
+            this->RemoveMember(event.handle);
+        }
+    }
+
+    template<typename... Types>
+    template<typename Type>
+    void EntityQuery<Types...>::OnPoolCleanup(typename ComponentPool<Type>::Events::Cleanup)
+    {
+        // Drop all pool pointers before any of them dangles.
+        this->Cleanup();
+    }
+}
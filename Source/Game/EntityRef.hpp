@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "EntityHandle.hpp"
+#include "ComponentPool.hpp"
+
+//
+// Entity Reference
+//
+//  Weak reference to a component of an entity, for holders that dereference
+//  the same entities every frame, such as targets and attachments. Caches
+//  the resolved component pointer along with the storage epoch of its pool,
+//  so dereferencing is a single integer comparison for as long as no
+//  components have been added to or removed from the pool. Otherwise the
+//  component is looked up again and the cache is refreshed.
+//
+//  Returns nullptr once the entity has been destroyed or its component has
+//  been removed, as the version of the handle is checked by the pool.
+//
+//  Example usage:
+//      Game::EntityRef<Transform> target(&transforms, entity);
+//
+//      if(Transform* transform = target.Get())
+//      {
+//          /* Component is valid until the pool is modified. */
+//      }
+//
+
+namespace Game
+{
+    // Entity reference class.
+    template<typename Type>
+    class EntityRef
+    {
+    public:
+        // Type declarations.
+        typedef typename ComponentPool<Type>::Epoch Epoch;
+
+    public:
+        // Constructors.
+        EntityRef() :
+            m_pool(nullptr),
+            m_component(nullptr),
+            m_epoch(0)
+        {
+        }
+
+        EntityRef(ComponentPool<Type>* pool, const EntityHandle& entity) :
+            m_pool(pool),
+            m_entity(entity),
+            m_component(nullptr),
+            m_epoch(0)
+        {
+        }
+
+        // Points the reference at another entity.
+        void Reset(const EntityHandle& entity = EntityHandle())
+        {
+            m_entity = entity;
+            m_component = nullptr;
+            m_epoch = 0;
+        }
+
+        // Gets the referenced component.
+        // Returns nullptr if the entity no longer has the component.
+        Type* Get()
+        {
+            if(m_pool == nullptr)
+                return nullptr;
+
+            // Resolve the component again if the pool has changed.
+            // Pool epochs start at one, so unresolved references never match.
+            if(m_epoch != m_pool->GetEpoch())
+            {
+                m_component = m_pool->Get(m_entity);
+                m_epoch = m_pool->GetEpoch();
+            }
+
+            return m_component;
+        }
+
+        // Gets the referenced entity handle.
+        const EntityHandle& GetHandle() const
+        {
+            return m_entity;
+        }
+
+        // Gets the referenced component pool.
+        ComponentPool<Type>* GetPool() const
+        {
+            return m_pool;
+        }
+
+    private:
+        // Pool storing the component.
+        ComponentPool<Type>* m_pool;
+
+        // Referenced entity.
+        EntityHandle m_entity;
+
+        // Cached component and epoch of the pool it was resolved at.
+        Type* m_component;
+        Epoch m_epoch;
+    };
+}
@@ -0,0 +1,282 @@
+#include "Precompiled.hpp"
+#include "EntityRelations.hpp"
+using namespace Game;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize entity relations! "
+
+    // Constant variables.
+    const int InvalidEdge = -1;
+
+    // Number of registered relation types.
+    std::atomic<int> registeredCount(0);
+}
+
+EntityRelations::Table::Table() :
+    edgeCount(0)
+{
+}
+
+EntityRelations::EntityRelations() :
+    m_entitySystem(nullptr),
+    m_initialized(false)
+{
+}
+
+EntityRelations::~EntityRelations()
+{
+    this->Cleanup();
+}
+
+void EntityRelations::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Unsubscribe from the entity system.
+    m_entityDestroy.Cleanup();
+    m_entitySystem = nullptr;
+
+    // Release relation tables.
+    for(std::unique_ptr<Table>& table : m_tables)
+    {
+        table.reset();
+    }
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool EntityRelations::Initialize(EntitySystem* entitySystem)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(entitySystem == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid entity system.";
+        return false;
+    }
+
+    m_entitySystem = entitySystem;
+
+    // Remove relations of destroyed entities.
+    m_entityDestroy.Bind<EntityRelations, &EntityRelations::OnEntityDestroy>(this);
+    m_entityDestroy.Subscribe(entitySystem->events.destroy);
+
+    // Success!
+    return m_initialized = true;
+}
+
+bool EntityRelations::AddRelation(int relation, const EntityHandle& source, const EntityHandle& target)
+{
+    Assert(relation >= 0 && relation < MaximumCount, "Invalid relation identifier!");
+
+    if(!m_initialized)
+        return false;
+
+    if(!m_entitySystem->IsHandleValid(source) || !m_entitySystem->IsHandleValid(target))
+        return false;
+
+    // Create the table on the first relation of its type.
+    if(m_tables[relation] == nullptr)
+    {
+        m_tables[relation].reset(new Table());
+    }
+
+    Table& table = *m_tables[relation];
+
+    if(FindEdge(table, source, target) != InvalidEdge)
+        return true;
+
+    // Reuse a free edge or append a new one.
+    int edge = 0;
+
+    if(!table.freeEdges.empty())
+    {
+        edge = table.freeEdges.back();
+        table.freeEdges.pop_back();
+    }
+    else
+    {
+        edge = (int)table.edges.size();
+        table.edges.emplace_back();
+    }
+
+    // Add the edge to lists of both entities.
+    EdgeList& outgoing = table.outgoing[source];
+    Edge& data = table.edges[edge];
+    data.source = source;
+    data.target = target;
+    data.sourceIndex = (int)outgoing.size();
+    outgoing.push_back(edge);
+
+    EdgeList& incoming = table.incoming[target];
+    data.targetIndex = (int)incoming.size();
+    incoming.push_back(edge);
+
+    table.edgeCount += 1;
+
+    return true;
+}
+
+bool EntityRelations::RemoveRelation(int relation, const EntityHandle& source, const EntityHandle& target)
+{
+    Assert(relation >= 0 && relation < MaximumCount, "Invalid relation identifier!");
+
+    if(m_tables[relation] == nullptr)
+        return false;
+
+    Table& table = *m_tables[relation];
+    int edge = FindEdge(table, source, target);
+
+    if(edge == InvalidEdge)
+        return false;
+
+    RemoveEdge(table, edge);
+
+    return true;
+}
+
+bool EntityRelations::HasRelation(int relation, const EntityHandle& source, const EntityHandle& target) const
+{
+    Assert(relation >= 0 && relation < MaximumCount, "Invalid relation identifier!");
+
+    const Table* table = this->FindTable(relation);
+
+    if(table == nullptr)
+        return false;
+
+    return FindEdge(*table, source, target) != InvalidEdge;
+}
+
+void EntityRelations::RemoveRelationTargets(int relation, const EntityHandle& source)
+{
+    Assert(relation >= 0 && relation < MaximumCount, "Invalid relation identifier!");
+
+    if(m_tables[relation] == nullptr)
+        return;
+
+    Table& table = *m_tables[relation];
+    RemoveEdges(table, table.outgoing, source);
+}
+
+void EntityRelations::ClearRelations(const EntityHandle& entity)
+{
+    for(std::unique_ptr<Table>& table : m_tables)
+    {
+        if(table == nullptr)
+            continue;
+
+        RemoveEdges(*table, table->outgoing, entity);
+        RemoveEdges(*table, table->incoming, entity);
+    }
+}
+
+const EntityRelations::Table* EntityRelations::FindTable(int relation) const
+{
+    Assert(relation >= 0 && relation < MaximumCount, "Invalid relation identifier!");
+
+    return m_tables[relation].get();
+}
+
+int EntityRelations::FindEdge(const Table& table, const EntityHandle& source, const EntityHandle& target)
+{
+    const EdgeList* outgoing = table.outgoing.Find(source);
+    const EdgeList* incoming = table.incoming.Find(target);
+
+    if(outgoing == nullptr || incoming == nullptr)
+        return InvalidEdge;
+
+    // Search the shorter of both lists.
+    if(outgoing->size() <= incoming->size())
+    {
+        for(int edge : *outgoing)
+        {
+            if(table.edges[edge].target == target)
+                return edge;
+        }
+    }
+    else
+    {
+        for(int edge : *incoming)
+        {
+            if(table.edges[edge].source == source)
+                return edge;
+        }
+    }
+
+    return InvalidEdge;
+}
+
+void EntityRelations::RemoveEdge(Table& table, int edge)
+{
+    Edge data = table.edges[edge];
+
+    EraseFromList(table, table.outgoing, data.source, data.sourceIndex, true);
+    EraseFromList(table, table.incoming, data.target, data.targetIndex, false);
+
+    table.edges[edge] = Edge();
+    table.freeEdges.push_back(edge);
+    table.edgeCount -= 1;
+}
+
+void EntityRelations::EraseFromList(Table& table, EntityMap<EdgeList>& lists, const EntityHandle& entity, int index, bool outgoing)
+{
+    EdgeList* list = lists.Find(entity);
+
+    Assert(list != nullptr && index >= 0 && index < (int)list->size(), "Invalid relation edge position!");
+
+    // Move the last edge into the removed one and update its position.
+    int last = list->back();
+
+    if(index != (int)list->size() - 1)
+    {
+        (*list)[index] = last;
+
+        if(outgoing)
+        {
+            table.edges[last].sourceIndex = index;
+        }
+        else
+        {
+            table.edges[last].targetIndex = index;
+        }
+    }
+
+    list->pop_back();
+
+    // Keep maps small by removing empty lists.
+    if(list->empty())
+    {
+        lists.Remove(entity);
+    }
+}
+
+void EntityRelations::RemoveEdges(Table& table, EntityMap<EdgeList>& lists, const EntityHandle& entity)
+{
+    // Removing the last edge does not move any other edges.
+    // The list is looked up again, as it is removed with its last edge.
+    while(const EdgeList* list = lists.Find(entity))
+    {
+        RemoveEdge(table, list->back());
+    }
+}
+
+int EntityRelations::Register()
+{
+    int identifier = registeredCount.fetch_add(1);
+
+    // Check if we reached the limit.
+    Verify(identifier < MaximumCount, "Reached the maximum number of relation types!");
+
+    return identifier;
+}
+
+void EntityRelations::OnEntityDestroy(EntitySystem::Events::Destroy event)
+{
+    this->ClearRelations(event.handle);
+}
@@ -0,0 +1,294 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "EntityHandle.hpp"
+#include "EntityMap.hpp"
+#include "EntitySystem.hpp"
+
+//
+// Entity Relations
+//
+//  Stores relationships between pairs of entities, such as (Targets, enemy)
+//  or (ChildOf, parent), as edges of a table per relation type. Each table
+//  indexes its edges in both directions, by source and by target, so both
+//  "what does this entity target" and "what targets this entity" visit only
+//  the related entities instead of scanning all of them. Each edge knows its
+//  position in both lists, so it is removed in constant time.
+//
+//  Relation types are empty structs registered on their first use, like tag
+//  types of EntityTags. Relations of destroyed entities are removed in both
+//  directions automatically. Relations must not be changed while iterating
+//  over them.
+//
+//  Example usage:
+//      struct Targets {};
+//
+//      Game::EntityRelations relations;
+//      relations.Initialize(&entitySystem);
+//
+//      relations.Add<Targets>(enemy, player);
+//
+//      relations.ForEachSource<Targets>(player, [](const EntityHandle& attacker)
+//      {
+//          /* Entities that target the player. */
+//      });
+//
+
+namespace Game
+{
+    // Entity relations class.
+    class EntityRelations : private NonCopyable
+    {
+    public:
+        // Maximum number of registered relation types.
+        static const int MaximumCount = 64;
+
+    public:
+        EntityRelations();
+        ~EntityRelations();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the relation storage.
+        bool Initialize(EntitySystem* entitySystem);
+
+        // Adds a relation from a source to a target entity.
+        // Returns false if either entity handle is not valid.
+        template<typename Type>
+        bool Add(const EntityHandle& source, const EntityHandle& target);
+
+        bool AddRelation(int relation, const EntityHandle& source, const EntityHandle& target);
+
+        // Removes a relation from a source to a target entity.
+        template<typename Type>
+        bool Remove(const EntityHandle& source, const EntityHandle& target);
+
+        bool RemoveRelation(int relation, const EntityHandle& source, const EntityHandle& target);
+
+        // Checks if a source entity is related to a target entity.
+        template<typename Type>
+        bool Has(const EntityHandle& source, const EntityHandle& target) const;
+
+        bool HasRelation(int relation, const EntityHandle& source, const EntityHandle& target) const;
+
+        // Removes all relations of a type that an entity is a source of.
+        template<typename Type>
+        void RemoveTargets(const EntityHandle& source);
+
+        void RemoveRelationTargets(int relation, const EntityHandle& source);
+
+        // Removes all relations of an entity in both directions.
+        void ClearRelations(const EntityHandle& entity);
+
+        // Calls a function for each target of a source entity.
+        template<typename Type, typename Function>
+        void ForEachTarget(const EntityHandle& source, Function function) const;
+
+        // Calls a function for each source of a target entity.
+        template<typename Type, typename Function>
+        void ForEachSource(const EntityHandle& target, Function function) const;
+
+        // Gets the first target of a source entity, such as the parent of a child.
+        // Returns an invalid handle if the entity has no targets.
+        template<typename Type>
+        EntityHandle GetTarget(const EntityHandle& source) const;
+
+        // Counts targets of a source entity and sources of a target entity.
+        template<typename Type>
+        int CountTargets(const EntityHandle& source) const;
+
+        template<typename Type>
+        int CountSources(const EntityHandle& target) const;
+
+        // Gets the number of relations of a type.
+        template<typename Type>
+        int GetRelationCount() const;
+
+        // Gets the identifier of a relation type.
+        template<typename Type>
+        static int GetIdentifier();
+
+    private:
+        // Relation between two entities.
+        struct Edge
+        {
+            EntityHandle source;
+            EntityHandle target;
+
+            // Positions of the edge in lists of its source and target.
+            int sourceIndex;
+            int targetIndex;
+        };
+
+        // Type declarations.
+        typedef std::vector<int> EdgeList;
+
+        // Edges of a relation type, indexed in both directions.
+        struct Table
+        {
+            Table();
+
+            std::vector<Edge> edges;
+            std::vector<int> freeEdges;
+            int edgeCount;
+
+            EntityMap<EdgeList> outgoing;
+            EntityMap<EdgeList> incoming;
+        };
+
+    private:
+        // Gets the table of a relation type or returns nullptr if it has no relations.
+        const Table* FindTable(int relation) const;
+
+        // Finds an edge from a source to a target or returns -1.
+        static int FindEdge(const Table& table, const EntityHandle& source, const EntityHandle& target);
+
+        // Removes an edge from both of its lists.
+        static void RemoveEdge(Table& table, int edge);
+
+        // Removes an edge from a list, updating the position of the edge moved into its place.
+        static void EraseFromList(Table& table, EntityMap<EdgeList>& lists, const EntityHandle& entity, int index, bool outgoing);
+
+        // Removes all edges of an entity in a list.
+        static void RemoveEdges(Table& table, EntityMap<EdgeList>& lists, const EntityHandle& entity);
+
+        // Registers a new relation type.
+        static int Register();
+
+        // Called when an entity is destroyed.
+        void OnEntityDestroy(EntitySystem::Events::Destroy event);
+
+    private:
+        // Entity system that owns the entities.
+        EntitySystem* m_entitySystem;
+
+        // Tables of relation types, created on their first relation.
+        std::unique_ptr<Table> m_tables[MaximumCount];
+
+        // Entity system event receiver.
+        Receiver<void(EntitySystem::Events::Destroy)> m_entityDestroy;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
+
+// Template implementations.
+namespace Game
+{
+    template<typename Type>
+    bool EntityRelations::Add(const EntityHandle& source, const EntityHandle& target)
+    {
+        return this->AddRelation(GetIdentifier<Type>(), source, target);
+    }
+
+    template<typename Type>
+    bool EntityRelations::Remove(const EntityHandle& source, const EntityHandle& target)
+    {
+        return this->RemoveRelation(GetIdentifier<Type>(), source, target);
+    }
+
+    template<typename Type>
+    bool EntityRelations::Has(const EntityHandle& source, const EntityHandle& target) const
+    {
+        return this->HasRelation(GetIdentifier<Type>(), source, target);
+    }
+
+    template<typename Type>
+    void EntityRelations::RemoveTargets(const EntityHandle& source)
+    {
+        this->RemoveRelationTargets(GetIdentifier<Type>(), source);
+    }
+
+    template<typename Type, typename Function>
+    void EntityRelations::ForEachTarget(const EntityHandle& source, Function function) const
+    {
+        const Table* table = this->FindTable(GetIdentifier<Type>());
+
+        if(table == nullptr)
+            return;
+
+        if(const EdgeList* edges = table->outgoing.Find(source))
+        {
+            for(int edge : *edges)
+            {
+                function(table->edges[edge].target);
+            }
+        }
+    }
+
+    template<typename Type, typename Function>
+    void EntityRelations::ForEachSource(const EntityHandle& target, Function function) const
+    {
+        const Table* table = this->FindTable(GetIdentifier<Type>());
+
+        if(table == nullptr)
+            return;
+
+        if(const EdgeList* edges = table->incoming.Find(target))
+        {
+            for(int edge : *edges)
+            {
+                function(table->edges[edge].source);
+            }
+        }
+    }
+
+    template<typename Type>
+    EntityHandle EntityRelations::GetTarget(const EntityHandle& source) const
+    {
+        const Table* table = this->FindTable(GetIdentifier<Type>());
+
+        if(table == nullptr)
+            return EntityHandle();
+
+        const EdgeList* edges = table->outgoing.Find(source);
+
+        if(edges == nullptr || edges->empty())
+            return EntityHandle();
+
+        return table->edges[edges->front()].target;
+    }
+
+    template<typename Type>
+    int EntityRelations::CountTargets(const EntityHandle& source) const
+    {
+        const Table* table = this->FindTable(GetIdentifier<Type>());
+
+        if(table == nullptr)
+            return 0;
+
+        const EdgeList* edges = table->outgoing.Find(source);
+        return edges != nullptr ? (int)edges->size() : 0;
+    }
+
+    template<typename Type>
+    int EntityRelations::CountSources(const EntityHandle& target) const
+    {
+        const Table* table = this->FindTable(GetIdentifier<Type>());
+
+        if(table == nullptr)
+            return 0;
+
+        const EdgeList* edges = table->incoming.Find(target);
+        return edges != nullptr ? (int)edges->size() : 0;
+    }
+
+    template<typename Type>
+    int EntityRelations::GetRelationCount() const
+    {
+        const Table* table = this->FindTable(GetIdentifier<Type>());
+        return table != nullptr ? table->edgeCount : 0;
+    }
+
+    template<typename Type>
+    int EntityRelations::GetIdentifier()
+    {
+        static_assert(std::is_empty<Type>::value, "Relation types must be empty!");
+
+        // Register the type once on the first use.
+        static const int identifier = Register();
+        return identifier;
+    }
+}
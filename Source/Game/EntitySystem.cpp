@@ -1,24 +1,117 @@
 #include "Precompiled.hpp"
 #include "EntitySystem.hpp"
+#include "Common/Checksum.hpp"
 using namespace Game;
 
 namespace
 {
     // Log message strings.
     #define LogInitializeError() "Failed to initialize the entity system! "
+    #define LogSaveSnapshotError() "Failed to save an entity system snapshot! "
+    #define LogLoadSnapshotError() "Failed to load an entity system snapshot! "
+    #define LogThreadOwnerError() "Entity system changed from a thread that does not own it!"
 
     // Constant variables.
-    const int MaximumIdentifier   = std::numeric_limits<int>::max();
+    const int MaximumIdentifier   = EntityHandle::MaximumIdentifier;
+    const int MaximumVersion      = EntityHandle::MaximumVersion;
     const int InvalidIdentifier   = 0;
     const int InvalidNextFree     = -1;
     const int InvalidQueueElement = -1;
+    const int InvalidDenseIndex   = -1;
+
+    // Number of entities destroyed between time checks of incremental teardown.
+    const int TeardownSliceSize = 256;
+
+    // Snapshot format identification.
+    const std::uint32_t SnapshotMagic   = 0x53544E45; // "ENTS"
+    const std::uint32_t SnapshotVersion = 3;
+
+    // Snapshot header.
+    struct SnapshotHeader
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::int32_t identifierBits;
+        std::int32_t entityCount;
+        std::int32_t freeListDequeue;
+        std::int32_t freeListEnqueue;
+        std::int32_t freeListSize;
+        std::int32_t freeListIsEmpty;
+        std::int32_t freeHandlePolicy;
+        std::int32_t initialVersion;
+    };
+
+    // Checks if indices read from a snapshot point into an array of a size.
+    // Invalid indices, which are all negative one, are accepted if they are allowed.
+    bool AreIndicesInRange(const int* indices, std::size_t count, std::size_t size, bool allowInvalid)
+    {
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            if(allowInvalid && indices[i] == -1)
+                continue;
+
+            if(indices[i] < 0 || (std::size_t)indices[i] >= size)
+                return false;
+        }
+
+        return true;
+    }
+
+    // Checks if handles read from a snapshot point into the handle table.
+    bool AreHandlesInRange(const EntityHandle* handles, std::size_t count, std::size_t handleCount)
+    {
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            int identifier = handles[i].GetIdentifier();
+
+            if(identifier == InvalidIdentifier || (std::size_t)identifier > handleCount)
+                return false;
+        }
+
+        return true;
+    }
+}
+
+EntitySystemInfo::EntitySystemInfo() :
+    initialCapacity(1024),
+    minimumFreeHandles(64),
+    growthFactor(2.0f),
+    concurrentHandles(256),
+    handleShards(0),
+    shardBlockSize(64),
+    freeHandlePolicy(FreeHandlePolicy::FirstInFirstOut)
+{
+}
+
+EntitySystemStatistics::EntitySystemStatistics() :
+    createdEntities(0),
+    destroyedEntities(0),
+    failedFinalizations(0),
+    cancelledEntities(0),
+    commandQueueHighWater(0),
+    processCommandsTime(0.0),
+    handleTableSize(0),
+    freeHandleCount(0),
+    activeEntities(0)
+{
+}
+
+EntitySystem::HandleShard::HandleShard() :
+    cursor(0)
+{
 }
 
 EntitySystem::EntitySystem() :
+    m_concurrentCursor(0),
+    m_shardBlockCount(0),
+    m_shardBlockCursor(0),
+    m_submittedBuffers(nullptr),
     m_entityCount(0),
     m_freeListDequeue(InvalidQueueElement),
     m_freeListEnqueue(InvalidQueueElement),
+    m_freeListSize(0),
     m_freeListIsEmpty(true),
+    m_initialVersion(0),
     m_initialized(false)
 {
 }
@@ -37,33 +130,80 @@ void EntitySystem::Cleanup()
     this->DestroyAllEntities();
 
     // Check the state before cleaning up.
-    Assert(m_commands.empty(), "Cleaning up the entity system while there are unprocessed command left!");
+    Assert(m_submittedBuffers.load() == nullptr, "Cleaning up the entity system while there are submitted command buffers left!");
+    Assert(m_commands.IsEmpty(), "Cleaning up the entity system while there are unprocessed command left!");
     Assert(m_entityCount == 0, "Cleaning up the entity system while there are alive entities left!");
 
     // Cleanup event dispatchers.
     this->events.finalize.Cleanup();
     this->events.create.Cleanup();
     this->events.destroy.Cleanup();
+    this->events.finalizeBatch.Cleanup();
+    this->events.createBatch.Cleanup();
+    this->events.destroyBatch.Cleanup();
+    this->events.commandsProcessed.Cleanup();
 
     // Clear the command list.
-    Utility::ClearContainer(m_commands);
-
-    // Clear the entity list.
-    Utility::ClearContainer(m_handles);
+    m_commands.Cleanup();
+
+    // Clear the handle table.
+    Utility::ClearContainer(m_handleVersions);
+    Utility::ClearContainer(m_handleFlags);
+    Utility::ClearContainer(m_handleNextFree);
+
+    // Clear the list of active entities.
+    Utility::ClearContainer(m_entities);
+    Utility::ClearContainer(m_handleDenseIndices);
+
+    // Clear batch lists.
+    Utility::ClearContainer(m_batchHandles);
+    Utility::ClearContainer(m_batchResults);
+    Utility::ClearContainer(m_batchCreated);
+    Utility::ClearContainer(m_batchFailed);
+    Utility::ClearContainer(m_batchCancelled);
+
+    // Clear the list of reserved handles.
+    Utility::ClearContainer(m_concurrentHandles);
+    Utility::ClearContainer(m_concurrentDeferred);
+    m_concurrentCursor = 0;
+
+    // Clear handle shards and their pool.
+    Utility::ClearContainer(m_shards);
+    Utility::ClearContainer(m_shardPool);
+    Utility::ClearContainer(m_shardDeferred);
+    Utility::ClearContainer(m_shardReturned);
+    m_shardBlockCount = 0;
+    m_shardBlockCursor = 0;
+
+    // Clear the list of discarded handles.
+    Utility::ClearContainer(m_discardedHandles);
 
     // Reset the entity counter.
     m_entityCount = 0;
 
+    // Reset initialization parameters.
+    m_info = EntitySystemInfo();
+
     // Reset the queue list of free handles.
     m_freeListDequeue = InvalidQueueElement;
     m_freeListEnqueue = InvalidQueueElement;
+    m_freeListSize = 0;
     m_freeListIsEmpty = true;
+    Utility::ClearContainer(m_freeHeap);
+
+    m_initialVersion = 0;
+
+    // Reset statistics counters.
+    m_statistics = EntitySystemStatistics();
+
+    // Let any thread initialize this instance again.
+    THREAD_OWNER_RELEASE(m_threadOwner);
 
     // Reset the initialization state.
     m_initialized = false;
 }
 
-bool EntitySystem::Initialize()
+bool EntitySystem::Initialize(const EntitySystemInfo& info)
 {
     // Cleanup this instance.
     this->Cleanup();
@@ -78,11 +218,70 @@ bool EntitySystem::Initialize()
         }
     );
 
-    // Preallocate entity handles.
-    // TODO: Implement me!
+    // Validate initialization parameters.
+    if(info.initialCapacity < 0)
+    {
+        LogError() << LogInitializeError() << "Initial capacity can't be negative.";
+        return false;
+    }
+
+    if(info.minimumFreeHandles < 0)
+    {
+        LogError() << LogInitializeError() << "Minimum number of free handles can't be negative.";
+        return false;
+    }
+
+    if(info.growthFactor < 1.0f)
+    {
+        LogError() << LogInitializeError() << "Growth factor can't be less than one.";
+        return false;
+    }
+
+    if(info.concurrentHandles < 0)
+    {
+        LogError() << LogInitializeError() << "Number of concurrent handles can't be negative.";
+        return false;
+    }
+
+    if(info.handleShards < 0)
+    {
+        LogError() << LogInitializeError() << "Number of handle shards can't be negative.";
+        return false;
+    }
+
+    if(info.handleShards > 0 && info.shardBlockSize <= 0)
+    {
+        LogError() << LogInitializeError() << "Shard block size must be positive.";
+        return false;
+    }
+
+    if(info.freeHandlePolicy < FreeHandlePolicy::FirstInFirstOut || info.freeHandlePolicy > FreeHandlePolicy::LowestIndexFirst)
+    {
+        LogError() << LogInitializeError() << "Invalid free handle policy.";
+        return false;
+    }
+
+    m_info = info;
+
+    // Create handle shards.
+    m_shards.resize(info.handleShards);
+
+    // Initializing thread owns this instance until another thread takes it over.
+    THREAD_OWNER_CLAIM(m_threadOwner);
 
     // Success!
-    return m_initialized = true;
+    m_initialized = true;
+
+    // Preallocate entity handles.
+    if(info.initialCapacity > 0)
+    {
+        this->AllocateHandles(info.initialCapacity);
+    }
+
+    // Reserve handles for concurrent creation.
+    this->ProcessConcurrentHandles();
+
+    return true;
 }
 
 EntityHandle EntitySystem::CreateEntity()
@@ -90,24 +289,114 @@ EntityHandle EntitySystem::CreateEntity()
     if(!m_initialized)
         return EntityHandle();
 
-    // Check if we reached the numerical limit.
-    Verify(m_handles.size() < MaximumIdentifier, "Entity handle identifier reached its numerical limit!");
+    THREAD_OWNER_CHECK(m_threadOwner, LogThreadOwnerError());
 
     // Retrieve a free handle.
-    HandleEntry& handleEntry = this->RetrieveHandle();
+    int handleIndex = this->RetrieveHandle();
+    EntityHandle handle = this->MakeHandle(handleIndex);
 
     // Mark the retrieved handle as valid.
-    handleEntry.flags |= HandleFlags::Valid;
+    m_handleFlags[handleIndex] |= HandleFlags::Valid;
 
     // Schedule an entity to be created.
-    EntityCommand command;
-    command.type = EntityCommands::Create;
-    command.handle = handleEntry.handle;
-
-    m_commands.push(command);
+    this->QueueCommand(EntityCommands::Create, handle, false);
 
     // Return a valid handle.
-    return handleEntry.handle;
+    return handle;
+}
+
+void EntitySystem::CreateEntities(int count, EntityHandle* handles)
+{
+    if(!m_initialized)
+        return;
+
+    THREAD_OWNER_CHECK(m_threadOwner, LogThreadOwnerError());
+
+    Assert(count >= 0, "Attempting to create a negative number of entities!");
+    Assert(handles != nullptr || count == 0, "Output array of entity handles is nullptr!");
+
+    if(count <= 0 || handles == nullptr)
+        return;
+
+    // Allocate missing handles in a single contiguous block.
+    int requiredFreeHandles = count + m_info.minimumFreeHandles;
+
+    if(m_freeListSize < requiredFreeHandles)
+    {
+        this->GrowHandles(requiredFreeHandles - m_freeListSize);
+    }
+
+    Assert(m_freeListSize >= count, "Not enough free handles after allocating a block of handles!");
+
+    // Retrieve free handles and schedule entities to be created.
+    for(int i = 0; i < count; ++i)
+    {
+        int handleIndex = this->RetrieveHandle();
+        EntityHandle handle = this->MakeHandle(handleIndex);
+
+        // Mark the retrieved handle as valid.
+        m_handleFlags[handleIndex] |= HandleFlags::Valid;
+
+        // Merge consecutive handles into a single range command.
+        this->QueueCommand(EntityCommands::Create, handle, i != 0);
+
+        // Write a valid handle.
+        handles[i] = handle;
+    }
+}
+
+EntityHandle EntitySystem::CreateEntityConcurrent()
+{
+    if(!m_initialized)
+        return EntityHandle();
+
+    // Claim a reserved handle that will become valid.
+    return this->ReserveHandleConcurrent(false);
+}
+
+EntityHandle EntitySystem::CreateEntityConcurrent(int shard)
+{
+    if(!m_initialized)
+        return EntityHandle();
+
+    // Claim a reserved handle from a block of the shard.
+    return this->ReserveHandleShard(shard, false);
+}
+
+void EntitySystem::CreateActiveEntities(int count, EntityHandle* handles)
+{
+    if(!m_initialized)
+        return;
+
+    THREAD_OWNER_CHECK(m_threadOwner, LogThreadOwnerError());
+
+    Assert(count >= 0, "Attempting to create a negative number of entities!");
+    Assert(handles != nullptr || count == 0, "Output array of entity handles is nullptr!");
+
+    if(count <= 0 || handles == nullptr)
+        return;
+
+    // Allocate missing handles in a single contiguous block.
+    int requiredFreeHandles = count + m_info.minimumFreeHandles;
+
+    if(m_freeListSize < requiredFreeHandles)
+    {
+        this->GrowHandles(requiredFreeHandles - m_freeListSize);
+    }
+
+    // Retrieve free handles and mark them as active right away.
+    for(int i = 0; i < count; ++i)
+    {
+        int handleIndex = this->RetrieveHandle();
+        m_handleFlags[handleIndex] = HandleFlags::Valid;
+        m_handleFlags[handleIndex] |= HandleFlags::Active;
+        this->InsertActiveEntity(handleIndex);
+
+        handles[i] = this->MakeHandle(handleIndex);
+    }
+
+    m_entityCount += count;
+    m_statistics.createdEntities += count;
 }
 
 void EntitySystem::DestroyEntity(const EntityHandle& entity)
@@ -115,26 +404,64 @@ void EntitySystem::DestroyEntity(const EntityHandle& entity)
     if(!m_initialized)
         return;
 
+    THREAD_OWNER_CHECK(m_threadOwner, LogThreadOwnerError());
+
     // Check if the handle is valid.
     if(!this->IsHandleValid(entity))
         return;
 
-    // Retrieve the handle entry.
+    // Retrieve the handle flags.
     int handleIndex = this->CalculateHandleIndex(entity);
-    HandleEntry& handleEntry = m_handles[handleIndex];
+    HandleFlags::Type& handleFlags = m_handleFlags[handleIndex];
 
-    Assert(handleEntry.flags & HandleFlags::Valid, "Attempting to destroy an entity that is not valid!");
-    Assert(!(handleEntry.flags & HandleFlags::Destroy), "Attempting to destroy an entity that is already being destroyed!");
+    Assert(handleFlags & HandleFlags::Valid, "Attempting to destroy an entity that is not valid!");
+    Assert(!(handleFlags & HandleFlags::Destroy), "Attempting to destroy an entity that is already being destroyed!");
 
     // Mark the handle to be destroyed.
-    handleEntry.flags |= HandleFlags::Destroy;
+    handleFlags |= HandleFlags::Destroy;
 
     // Schedule the entity to be destroyed.
-    EntityCommand command;
-    command.type = EntityCommands::Destroy;
-    command.handle = handleEntry.handle;
+    this->QueueCommand(EntityCommands::Destroy, entity, false);
+}
+
+void EntitySystem::DestroyEntities(const EntityHandle* handles, int count)
+{
+    if(!m_initialized)
+        return;
+
+    THREAD_OWNER_CHECK(m_threadOwner, LogThreadOwnerError());
+
+    Assert(count >= 0, "Attempting to destroy a negative number of entities!");
+    Assert(handles != nullptr || count == 0, "Input array of entity handles is nullptr!");
+
+    if(count <= 0 || handles == nullptr)
+        return;
+
+    // Schedule entities to be destroyed.
+    bool merge = false;
+
+    for(int i = 0; i < count; ++i)
+    {
+        const EntityHandle& entity = handles[i];
 
-    m_commands.push(command);
+        // Skip handles that are not valid.
+        if(!this->IsHandleValid(entity))
+            continue;
+
+        // Retrieve the handle flags.
+        int handleIndex = this->CalculateHandleIndex(entity);
+        HandleFlags::Type& handleFlags = m_handleFlags[handleIndex];
+
+        Assert(handleFlags & HandleFlags::Valid, "Attempting to destroy an entity that is not valid!");
+        Assert(!(handleFlags & HandleFlags::Destroy), "Attempting to destroy an entity that is already being destroyed!");
+
+        // Mark the handle to be destroyed.
+        handleFlags |= HandleFlags::Destroy;
+
+        // Merge consecutive handles into a single range command.
+        this->QueueCommand(EntityCommands::Destroy, entity, merge);
+        merge = true;
+    }
 }
 
 void EntitySystem::DestroyAllEntities()
@@ -142,24 +469,68 @@ void EntitySystem::DestroyAllEntities()
     if(!m_initialized)
         return;
 
-    // Process entity commands.
+    THREAD_OWNER_CHECK(m_threadOwner, LogThreadOwnerError());
+
+    // Repeat in case destroy subscribers have created new entities.
+    do
+    {
+        // Process entity commands.
+        this->ProcessCommands();
+
+        // Destroy all remaining entities in reverse order.
+        m_batchHandles.assign(m_entities.rbegin(), m_entities.rend());
+        this->DestroyHandles(m_batchHandles);
+    }
+    while(!m_commands.IsEmpty());
+}
+
+int EntitySystem::DestroyAllEntitiesIncremental(int entityLimit, double timeLimit)
+{
+    if(!m_initialized)
+        return 0;
+
+    THREAD_OWNER_CHECK(m_threadOwner, LogThreadOwnerError());
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    // Process entity commands first, so pending entities get destroyed too.
     this->ProcessCommands();
 
-    // Destroy all remaining entities.
-    for(auto it = m_handles.begin(); it != m_handles.end(); ++it)
+    // Destroy active entities in reverse order, in slices between time checks.
+    // Entities that have not been reached yet stay active and keep valid handles.
+    int destroyedCount = 0;
+
+    while(!m_entities.empty())
     {
-        // Get the handle entry.
-        HandleEntry& handleEntry = *it;
+        int sliceSize = std::min(TeardownSliceSize, (int)m_entities.size());
+
+        if(entityLimit > 0)
+        {
+            sliceSize = std::min(sliceSize, entityLimit - destroyedCount);
+        }
+
+        if(sliceSize <= 0)
+            break;
 
-        // Calculate the handle index.
-        int handleIndex = this->CalculateHandleIndex(handleEntry.handle);
+        m_batchHandles.assign(m_entities.rbegin(), m_entities.rbegin() + sliceSize);
+        this->DestroyHandles(m_batchHandles);
 
-        // Destroy entities that are still valid.
-        if(handleEntry.flags & HandleFlags::Valid)
+        destroyedCount += sliceSize;
+
+        // Process commands queued by destroy subscribers.
+        this->ProcessCommands();
+
+        // Stop once the time budget has been spent.
+        if(timeLimit > 0.0)
         {
-            this->DestroyHandle(handleIndex, handleEntry);
+            auto currentTime = std::chrono::high_resolution_clock::now();
+
+            if(std::chrono::duration<double>(currentTime - startTime).count() >= timeLimit)
+                break;
         }
     }
+
+    return (int)m_entities.size();
 }
 
 void EntitySystem::ProcessCommands()
@@ -167,223 +538,1249 @@ void EntitySystem::ProcessCommands()
     if(!m_initialized)
         return;
 
+    THREAD_OWNER_CHECK(m_threadOwner, LogThreadOwnerError());
+
+    // Measure the time spent processing commands.
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    // Schedule entities that have been created concurrently.
+    this->ProcessConcurrentHandles();
+
+    // Play back submitted command buffers.
+    this->ProcessSubmittedCommands();
+
+    // Free handles of command buffers that were never submitted.
+    this->ProcessDiscardedHandles();
+
     // Process entity commands.
-    while(!m_commands.empty())
+    while(!m_commands.IsEmpty())
     {
-        // Get the first command in the queue.
-        EntityCommand& command = m_commands.front();
+        // Gather handles of consecutive commands of the same type into a batch.
+        // Commands queued while processing the batch are placed after it.
+        EntityCommands::Type type = m_commands.Front().type;
+        m_batchHandles.clear();
+        m_batchCancelled.clear();
 
-        // Process the entity command.
-        switch(command.type)
+        while(!m_commands.IsEmpty() && m_commands.Front().type == type)
         {
-        case EntityCommands::Create:
-            {
-                // Locate the handle entry.
-                int handleIndex = this->CalculateHandleIndex(command.handle);
-                HandleEntry& handleEntry = m_handles[handleIndex];
+            EntityCommand command = m_commands.Front();
+            m_commands.Pop();
 
-                // Check if the entity handle matches the handle entry.
-                Assert(command.handle == handleEntry.handle, "Attempting to create a non existing entity!");
+            Assert(command.count > 0, "Entity command with an empty range of handles!");
 
-                // Create an entity.
-                this->CreateHandle(handleIndex, handleEntry);
-            }
-            break;
+            int firstIndex = this->CalculateHandleIndex(command.handle);
 
-        case EntityCommands::Destroy:
+            for(int i = 0; i < command.count; ++i)
             {
                 // Locate the handle entry.
-                int handleIndex = this->CalculateHandleIndex(command.handle);
-                HandleEntry& handleEntry = m_handles[handleIndex];
+                int handleIndex = firstIndex + i;
+
+                switch(type)
+                {
+                case EntityCommands::Create:
+                    // Check if the entity handle matches the handle entry.
+                    Assert(i != 0 || command.handle == this->MakeHandle(handleIndex), "Attempting to create a non existing entity!");
+
+                    // Cancel entities destroyed before they were ever created.
+                    // Their handles are recycled without finalizing them,
+                    // and the pending destroy command gets skipped.
+                    if(m_handleFlags[handleIndex] & HandleFlags::Destroy)
+                    {
+                        m_batchCancelled.push_back(this->MakeHandle(handleIndex));
+                        continue;
+                    }
+                    break;
+
+                case EntityCommands::Destroy:
+                    // Skip entities that have already been destroyed,
+                    // which happens when an entity fails to finalize.
+                    if(!(m_handleFlags[handleIndex] & HandleFlags::Destroy))
+                        continue;
+
+                    if(i == 0 && command.handle != this->MakeHandle(handleIndex))
+                        continue;
+                    break;
+                }
+
+                m_batchHandles.push_back(this->MakeHandle(handleIndex));
+            }
+        }
 
-                // Check if the entity handle matches the handle entry.
-                Assert(command.handle == handleEntry.handle, "Attempting to destroy a non existing entity!");
+        // Release storage filled for cancelled entities.
+        this->CancelHandles(m_batchCancelled);
 
-                // Destroy an entity.
-                this->DestroyHandle(handleIndex, handleEntry);
-            }
+        // Process the batch of entities.
+        switch(type)
+        {
+        case EntityCommands::Create:
+            this->CreateHandles(m_batchHandles);
             break;
-        }
 
-        // Remove the processed command from the queue.
-        m_commands.pop();
+        case EntityCommands::Destroy:
+            this->DestroyHandles(m_batchHandles);
+            break;
+        }
     }
-}
 
-int EntitySystem::GetEntityCount() const
-{
-    return m_entityCount;
-}
+    // Inform about the end of the tick.
+    this->events.commandsProcessed({});
 
-int EntitySystem::CalculateHandleIndex(const EntityHandle& handle) const
-{
-    // Return the index of the handle entry that corresponds to this entity handle.
-    return handle.m_identifier - 1;
+    // Accumulate the processing time.
+    auto endTime = std::chrono::high_resolution_clock::now();
+    m_statistics.processCommandsTime += std::chrono::duration<double>(endTime - startTime).count();
 }
 
-void EntitySystem::AllocateHandle()
+int EntitySystem::Compact()
 {
-    Assert(m_initialized, "Entity system is not initialized!");
-    
-    // Create an entity handle.
-    EntityHandle handle;
-    handle.m_identifier = m_handles.size() + 1;
-    handle.m_version = 0;
-
-    // Create a handle entry.
-    HandleEntry entry;
-    entry.handle = handle;
-    entry.flags = HandleFlags::Free;
-    entry.nextFree = InvalidNextFree;
-
-    m_handles.push_back(entry);
-
-    // Add the created handle entry to the free list queue.
-    int handleIndex = this->CalculateHandleIndex(handle);
+    if(!m_initialized)
+        return 0;
 
-    if(m_freeListIsEmpty)
-    {
-        // Add the handle as the only element of the queue.
-        m_freeListDequeue = handleIndex;
-        m_freeListEnqueue = handleIndex;
-        m_freeListIsEmpty = false;
-    }
-    else
-    {
-        // Add the handle at the end of the queue.
-        m_handles[m_freeListEnqueue].nextFree = handleIndex;
-        m_freeListEnqueue = handleIndex;
-    }
-}
+    THREAD_OWNER_CHECK(m_threadOwner, LogThreadOwnerError());
 
-EntitySystem::HandleEntry& EntitySystem::RetrieveHandle()
-{
-    Assert(m_initialized, "Entity system is not initialized!");
+    // Find free handle entries at the end of the table.
+    // Retired entries are kept, as their identifiers can never be used again.
+    int handleCount = (int)m_handleVersions.size();
+    int compactCount = handleCount;
+    int initialVersion = m_initialVersion;
 
-    // Allocate a handle if the free list queue is empty.
-    // TODO: Add a stable minimum amount of free list queue elements.
-    if(m_freeListIsEmpty)
+    while(compactCount > 0)
     {
-        Assert(m_freeListDequeue == InvalidQueueElement, "Free list dequeue is not invalid while the list is not empty!");
-        Assert(m_freeListEnqueue == InvalidQueueElement, "Free list enqueue is not invalid while the list is not empty!");
+        int handleIndex = compactCount - 1;
 
-        this->AllocateHandle();
+        if(m_handleFlags[handleIndex] != HandleFlags::Free || m_handleVersions[handleIndex] == MaximumVersion)
+            break;
 
-        Assert(m_freeListDequeue != InvalidQueueElement, "Free list dequeue is invalid after allocating a handle!");
-        Assert(m_freeListEnqueue != InvalidQueueElement, "Free list enqueue is invalid after allocating a handle!");
-        Assert(!m_freeListIsEmpty, "Free list queue is empty after allocating a handle!");
+        initialVersion = std::max(initialVersion, m_handleVersions[handleIndex]);
+        compactCount -= 1;
     }
 
-    // Retrieve an unused handle from the free list queue.
-    int handleIndex = m_freeListDequeue;
-    HandleEntry& handleEntry = m_handles[handleIndex];
+    if(compactCount == handleCount)
+        return 0;
 
-    Assert(handleEntry.flags == HandleFlags::Free, "Retrieved handle is not marked as free!");
-
-    // Remove the retrieved handle from the free list queue. 
-    if(m_freeListDequeue == m_freeListEnqueue)
+    // Remove released entries from the free list.
+    if(m_info.freeHandlePolicy == FreeHandlePolicy::LowestIndexFirst)
     {
-        // Remove the handle as the only element of the queue.
-        m_freeListDequeue = InvalidQueueElement;
-        m_freeListEnqueue = InvalidQueueElement;
-        m_freeListIsEmpty = true;
+        auto removed = std::remove_if(m_freeHeap.begin(), m_freeHeap.end(), [compactCount](int handleIndex)
+        {
+            return handleIndex >= compactCount;
+        });
+
+        m_freeHeap.erase(removed, m_freeHeap.end());
+        std::make_heap(m_freeHeap.begin(), m_freeHeap.end(), std::greater<int>());
+
+        m_freeListSize = (int)m_freeHeap.size();
     }
     else
     {
-        // Remove the handle from the beginning of the queue.
-        m_freeListDequeue = handleEntry.nextFree;
-        handleEntry.nextFree = InvalidNextFree;
-    }
+        // Gather remaining entries in their current order.
+        std::vector<int> remaining;
+        remaining.reserve(m_freeListSize);
 
-    return handleEntry;
-}
+        int handleIndex = m_freeListIsEmpty ? InvalidQueueElement : m_freeListDequeue;
 
-void EntitySystem::CreateHandle(const int handleIndex, HandleEntry& handleEntry)
-{
-    Assert(m_initialized, "Entity system is not initialized!");
+        while(handleIndex != InvalidQueueElement)
+        {
+            int nextFree = m_handleNextFree[handleIndex];
+            m_handleNextFree[handleIndex] = InvalidNextFree;
 
-    // Make sure we got the matching index.
-    Assert(handleIndex >= 0 && (std::size_t)handleIndex < m_handles.size(), "Invalid handle index!");
-    Assert(&m_handles[handleIndex] == &handleEntry, "Missmatch between passed handle index and entry!");
+            if(handleIndex < compactCount)
+            {
+                remaining.push_back(handleIndex);
+            }
 
-    // Check handle flags.
-    Assert(!(handleEntry.flags & HandleFlags::Active), "Attempting to create a handle that is already active!");
-    Assert(handleEntry.flags & HandleFlags::Valid, "Attemping to create a handle that is not valid!");
+            handleIndex = nextFree;
+        }
 
-    // Increment the counter of active entities.
-    m_entityCount += 1;
+        // Link remaining entries again.
+        m_freeListDequeue = InvalidQueueElement;
+        m_freeListEnqueue = InvalidQueueElement;
+        m_freeListSize = 0;
+        m_freeListIsEmpty = true;
 
-    // Inform that we want this entity finalized.
-    if(this->events.finalize.HasSubscribers())
-    {
-        if(!this->events.finalize({ handleEntry.handle }))
+        for(int remainingIndex : remaining)
         {
-            // Destroy the entity handle if finalization fails.
-            this->DestroyHandle(handleIndex, handleEntry);
-            return;
+            this->PushFreeHandle(remainingIndex, false);
         }
     }
 
-    // Mark the handle as active.
-    handleEntry.flags |= HandleFlags::Active;
+    // Shrink the handle table.
+    m_handleVersions.resize(compactCount);
+    m_handleFlags.resize(compactCount);
+    m_handleNextFree.resize(compactCount);
+    m_handleDenseIndices.resize(compactCount);
 
-    // Inform about a created entity.
-    this->events.create({ handleEntry.handle });
+    m_handleVersions.shrink_to_fit();
+    m_handleFlags.shrink_to_fit();
+    m_handleNextFree.shrink_to_fit();
+    m_handleDenseIndices.shrink_to_fit();
+
+    m_initialVersion = initialVersion;
+
+    return handleCount - compactCount;
 }
 
-void EntitySystem::DestroyHandle(const int handleIndex, HandleEntry& handleEntry)
+EntitySystemStatistics EntitySystem::GetStatistics() const
 {
-    Assert(m_initialized, "Entity system is not initialized!");
+    EntitySystemStatistics statistics = m_statistics;
 
-    // Make sure we got the matching index.
-    Assert(handleIndex >= 0 && (std::size_t)handleIndex < m_handles.size(), "Invalid handle index!");
-    Assert(&m_handles[handleIndex] == &handleEntry, "Missmatch between passed handle index and entry!");
-
-    // Inform about a destroyed entity.
-    this->events.destroy({ handleEntry.handle });
+    // Fill in values describing the current state.
+    statistics.handleTableSize = (int)m_handleFlags.size();
+    statistics.freeHandleCount = m_freeListSize;
+    statistics.activeEntities = (int)m_entities.size();
 
-    // Free entity handle.
-    this->FreeHandle(handleIndex, handleEntry);
+    return statistics;
+}
 
-    // Decrement the counter of active entities.
-    m_entityCount -= 1;
+void EntitySystem::SetOwnerThread()
+{
+    THREAD_OWNER_CLAIM(m_threadOwner);
 }
 
-void EntitySystem::FreeHandle(const int handleIndex, HandleEntry& handleEntry)
+void EntitySystem::ResetStatistics()
 {
-    Assert(m_initialized, "Entity system is not initialized!");
+    m_statistics = EntitySystemStatistics();
 
-    // Make sure we got the matching index.
-    Assert(handleIndex >= 0 && (std::size_t)handleIndex < m_handles.size(), "Invalid handle index!");
-    Assert(&m_handles[handleIndex] == &handleEntry, "Missmatch between passed handle index and entry!");
+    // Start tracking from the commands that are already queued.
+    m_statistics.commandQueueHighWater = (int)m_commands.GetSize();
+}
 
-    // Mark the handle as free.
-    Assert(!(handleEntry.flags & HandleFlags::Free), "Attempting to free a handle that is already free!");
-    Assert(handleEntry.flags & HandleFlags::Valid, "Attempting to free a handle that is not valid!");
+int EntitySystem::GetEntityCount() const
+{
+    return m_entityCount;
+}
+
+int EntitySystem::GetShardCount() const
+{
+    return (int)m_shards.size();
+}
+
+const EntityHandle* EntitySystem::GetEntities() const
+{
+    return m_entities.data();
+}
+
+void EntitySystem::UpdateChecksum(Checksum& checksum) const
+{
+    checksum.Update<std::int32_t>((std::int32_t)m_entities.size());
+    checksum.Update(m_entities.data(), m_entities.size() * sizeof(EntityHandle));
+}
+
+EntityHandle EntitySystem::MigrateEntity(EntitySystem& target, const EntityHandle& entity)
+{
+    if(!m_initialized || !target.m_initialized)
+        return EntityHandle();
+
+    THREAD_OWNER_CHECK(m_threadOwner, LogThreadOwnerError());
+    THREAD_OWNER_CHECK(target.m_threadOwner, LogThreadOwnerError());
+
+    Assert(&target != this, "Attempting to migrate an entity to the same entity system!");
+
+    // Only finalized entities that are not being destroyed can be migrated.
+    if(!this->IsHandleValid(entity))
+        return EntityHandle();
+
+    int handleIndex = this->CalculateHandleIndex(entity);
+
+    if(!(m_handleFlags[handleIndex] & HandleFlags::Active))
+        return EntityHandle();
+
+    // Retrieve a handle in the target system and mark it as active right away.
+    int targetIndex = target.RetrieveHandle();
+    target.m_handleFlags[targetIndex] = HandleFlags::Valid;
+    target.m_handleFlags[targetIndex] |= HandleFlags::Active;
+    target.InsertActiveEntity(targetIndex);
+    target.m_entityCount += 1;
+
+    // Inform storage of this system that the entity leaves it.
+    if(this->events.destroyBatch.HasSubscribers())
+    {
+        this->events.destroyBatch({ &entity, 1 });
+    }
+
+    this->events.destroy({ entity });
+
+    // Release the handle in this system.
+    this->EraseActiveEntity(handleIndex);
+    this->FreeHandle(handleIndex);
+    m_entityCount -= 1;
+
+    return target.MakeHandle(targetIndex);
+}
+
+void EntitySystem::MigrateEntities(EntitySystem& target, const EntityHandle* handles, int count, EntityMap<EntityHandle>& remap)
+{
+    if(!m_initialized || !target.m_initialized)
+        return;
+
+    THREAD_OWNER_CHECK(m_threadOwner, LogThreadOwnerError());
+    THREAD_OWNER_CHECK(target.m_threadOwner, LogThreadOwnerError());
+
+    Assert(count >= 0, "Attempting to migrate a negative number of entities!");
+    Assert(handles != nullptr || count == 0, "Input array of entity handles is nullptr!");
+
+    if(count <= 0 || handles == nullptr)
+        return;
+
+    // Make room for all entries of the remap table at once.
+    remap.Reserve(remap.GetSize() + count);
+
+    for(int i = 0; i < count; ++i)
+    {
+        EntityHandle migrated = this->MigrateEntity(target, handles[i]);
+
+        if(migrated != EntityHandle())
+        {
+            remap.Insert(handles[i], migrated);
+        }
+    }
+}
+
+bool EntitySystem::SaveSnapshot(BinaryWriter& writer) const
+{
+    if(!m_initialized)
+    {
+        LogError() << LogSaveSnapshotError() << "Entity system is not initialized.";
+        return false;
+    }
+
+    // Make sure there is no transient state that the snapshot can't hold.
+    if(!m_commands.IsEmpty() || m_concurrentCursor.load() != 0 || m_shardBlockCursor.load() != 0 || m_submittedBuffers.load() != nullptr || this->HasDiscardedHandles())
+    {
+        LogError() << LogSaveSnapshotError() << "There are unprocessed commands left.";
+        return false;
+    }
+
+    // Write the header.
+    SnapshotHeader header;
+    header.magic = SnapshotMagic;
+    header.version = SnapshotVersion;
+    header.identifierBits = EntityHandle::IdentifierBits;
+    header.entityCount = m_entityCount;
+    header.freeListDequeue = m_freeListDequeue;
+    header.freeListEnqueue = m_freeListEnqueue;
+    header.freeListSize = m_freeListSize;
+    header.freeListIsEmpty = m_freeListIsEmpty ? 1 : 0;
+    header.freeHandlePolicy = m_info.freeHandlePolicy;
+    header.initialVersion = m_initialVersion;
+
+    writer.Write(header);
+
+    // Write the handle table and lists of entities as flat arrays.
+    writer.WriteArray(m_handleVersions.data(), m_handleVersions.size());
+    writer.WriteArray(m_handleFlags.data(), m_handleFlags.size());
+    writer.WriteArray(m_handleNextFree.data(), m_handleNextFree.size());
+    writer.WriteArray(m_handleDenseIndices.data(), m_handleDenseIndices.size());
+    writer.WriteArray(m_entities.data(), m_entities.size());
+    writer.WriteArray(m_concurrentHandles.data(), m_concurrentHandles.size());
+    writer.WriteArray(m_shardPool.data(), m_shardPool.size());
+    writer.WriteArray(m_freeHeap.data(), m_freeHeap.size());
+
+    return true;
+}
+
+bool EntitySystem::LoadSnapshot(BinaryReader& reader)
+{
+    if(!m_initialized)
+    {
+        LogError() << LogLoadSnapshotError() << "Entity system is not initialized.";
+        return false;
+    }
+
+    THREAD_OWNER_CHECK(m_threadOwner, LogThreadOwnerError());
+
+    // Make sure no existing entity is going to be overwritten.
+    if(m_entityCount != 0 || !m_commands.IsEmpty() || m_concurrentCursor.load() != 0 || m_shardBlockCursor.load() != 0 || m_submittedBuffers.load() != nullptr || this->HasDiscardedHandles())
+    {
+        LogError() << LogLoadSnapshotError() << "Entity system is not empty.";
+        return false;
+    }
+
+    return this->ReadSnapshot(reader);
+}
+
+bool EntitySystem::RestoreSnapshot(BinaryReader& reader)
+{
+    if(!m_initialized)
+    {
+        LogError() << LogLoadSnapshotError() << "Entity system is not initialized.";
+        return false;
+    }
+
+    THREAD_OWNER_CHECK(m_threadOwner, LogThreadOwnerError());
+
+    // Make sure there is no transient state that would refer to replaced handles.
+    if(!m_commands.IsEmpty() || m_concurrentCursor.load() != 0 || m_shardBlockCursor.load() != 0 || m_submittedBuffers.load() != nullptr || this->HasDiscardedHandles())
+    {
+        LogError() << LogLoadSnapshotError() << "There are unprocessed commands left.";
+        return false;
+    }
+
+    return this->ReadSnapshot(reader);
+}
+
+bool EntitySystem::ReadSnapshot(BinaryReader& reader)
+{
+    // Read the header.
+    SnapshotHeader header;
+
+    if(!reader.Read(header) || header.magic != SnapshotMagic)
+    {
+        LogError() << LogLoadSnapshotError() << "Invalid snapshot data.";
+        return false;
+    }
+
+    if(header.version != SnapshotVersion)
+    {
+        LogError() << LogLoadSnapshotError() << "Unsupported snapshot version " << header.version << ".";
+        return false;
+    }
+
+    if(header.identifierBits != EntityHandle::IdentifierBits)
+    {
+        LogError() << LogLoadSnapshotError() << "Snapshot uses a different entity handle layout.";
+        return false;
+    }
+
+    if(header.freeHandlePolicy != m_info.freeHandlePolicy)
+    {
+        LogError() << LogLoadSnapshotError() << "Snapshot uses a different free handle policy.";
+        return false;
+    }
+
+    // Read arrays in place.
+    std::size_t versionCount = 0;
+    std::size_t flagCount = 0;
+    std::size_t nextFreeCount = 0;
+    std::size_t denseIndexCount = 0;
+    std::size_t entityCount = 0;
+    std::size_t concurrentCount = 0;
+    std::size_t shardPoolCount = 0;
+    std::size_t freeHeapCount = 0;
+
+    const int* versions = reader.ReadArray<int>(versionCount);
+    const HandleFlags::Type* flags = reader.ReadArray<HandleFlags::Type>(flagCount);
+    const int* nextFree = reader.ReadArray<int>(nextFreeCount);
+    const int* denseIndices = reader.ReadArray<int>(denseIndexCount);
+    const EntityHandle* entities = reader.ReadArray<EntityHandle>(entityCount);
+    const EntityHandle* concurrent = reader.ReadArray<EntityHandle>(concurrentCount);
+    const EntityHandle* shardPool = reader.ReadArray<EntityHandle>(shardPoolCount);
+    const int* freeHeap = reader.ReadArray<int>(freeHeapCount);
+
+    if(!reader.IsValid())
+    {
+        LogError() << LogLoadSnapshotError() << "Snapshot data is truncated.";
+        return false;
+    }
+
+    // Validate sizes and indices, so corrupted data can't index outside of arrays.
+    std::size_t handleCount = versionCount;
+
+    bool sizesMatch = flagCount == handleCount && nextFreeCount == handleCount && denseIndexCount == handleCount;
+    bool countsValid = header.entityCount >= 0 && (std::size_t)header.entityCount == entityCount && entityCount <= handleCount;
+    bool queueValid = header.freeListSize >= 0 && (std::size_t)header.freeListSize <= handleCount &&
+        header.freeListDequeue >= InvalidQueueElement && header.freeListDequeue < (int)handleCount &&
+        header.freeListEnqueue >= InvalidQueueElement && header.freeListEnqueue < (int)handleCount &&
+        freeHeapCount <= handleCount;
+
+    if(!sizesMatch || !countsValid || !queueValid || handleCount > (std::size_t)MaximumIdentifier)
+    {
+        LogError() << LogLoadSnapshotError() << "Snapshot data is inconsistent.";
+        return false;
+    }
+
+    bool indicesValid = AreIndicesInRange(nextFree, nextFreeCount, handleCount, true) &&
+        AreIndicesInRange(denseIndices, denseIndexCount, entityCount, true) &&
+        AreIndicesInRange(freeHeap, freeHeapCount, handleCount, false);
+
+    bool handlesValid = AreHandlesInRange(entities, entityCount, handleCount) &&
+        AreHandlesInRange(concurrent, concurrentCount, handleCount) &&
+        AreHandlesInRange(shardPool, shardPoolCount, handleCount);
+
+    if(!indicesValid || !handlesValid)
+    {
+        LogError() << LogLoadSnapshotError() << "Snapshot data points outside of the handle table.";
+        return false;
+    }
+
+    // Check that active entities and their dense indices point at each other.
+    for(std::size_t i = 0; i < entityCount; ++i)
+    {
+        if(denseIndices[entities[i].GetIdentifier() - 1] != (int)i)
+        {
+            LogError() << LogLoadSnapshotError() << "Snapshot entity list does not match the handle table.";
+            return false;
+        }
+    }
+
+    // Walk the free list, so retrieving handles can't run off its end.
+    bool freeListValid = true;
+
+    if(m_info.freeHandlePolicy == FreeHandlePolicy::LowestIndexFirst)
+    {
+        freeListValid = freeHeapCount == (std::size_t)header.freeListSize;
+    }
+    else if(header.freeListIsEmpty != 0)
+    {
+        freeListValid = header.freeListDequeue == InvalidQueueElement && header.freeListEnqueue == InvalidQueueElement;
+    }
+    else
+    {
+        int handleIndex = header.freeListDequeue;
+        int queueSize = 1;
+
+        while(handleIndex != InvalidQueueElement && handleIndex != header.freeListEnqueue && queueSize <= header.freeListSize)
+        {
+            handleIndex = nextFree[handleIndex];
+            queueSize += 1;
+        }
+
+        freeListValid = handleIndex != InvalidQueueElement && queueSize == header.freeListSize;
+    }
+
+    if(!freeListValid)
+    {
+        LogError() << LogLoadSnapshotError() << "Snapshot free list is broken.";
+        return false;
+    }
+
+    // Handles reserved for shards could never be claimed without them.
+    if(shardPoolCount != 0 && m_shards.empty())
+    {
+        LogError() << LogLoadSnapshotError() << "Snapshot has handles reserved for shards, which are disabled.";
+        return false;
+    }
+
+    // Replace the handle table with bulk copies of the arrays.
+    m_handleVersions.assign(versions, versions + versionCount);
+    m_handleFlags.assign(flags, flags + flagCount);
+    m_handleNextFree.assign(nextFree, nextFree + nextFreeCount);
+    m_handleDenseIndices.assign(denseIndices, denseIndices + denseIndexCount);
+
+    // Replace the lists of entities.
+    m_entities.assign(entities, entities + entityCount);
+    m_entityCount = header.entityCount;
+
+    m_concurrentHandles.assign(concurrent, concurrent + concurrentCount);
+    m_concurrentDeferred.assign(m_concurrentHandles.size(), 0);
+    m_concurrentCursor = 0;
+
+    m_shardPool.assign(shardPool, shardPool + shardPoolCount);
+    m_shardDeferred.assign(m_shardPool.size(), 0);
+    m_shardBlockCount = m_shards.empty() ? 0 : ((int)m_shardPool.size() + m_info.shardBlockSize - 1) / m_info.shardBlockSize;
+    m_shardBlockCursor = 0;
+
+    // Restore the free list queue.
+    m_freeListDequeue = header.freeListDequeue;
+    m_freeListEnqueue = header.freeListEnqueue;
+    m_freeListSize = header.freeListSize;
+    m_freeListIsEmpty = header.freeListIsEmpty != 0;
+    m_freeHeap.assign(freeHeap, freeHeap + freeHeapCount);
+
+    m_initialVersion = header.initialVersion;
+
+    return true;
+}
+
+int EntitySystem::CalculateHandleIndex(const EntityHandle& handle) const
+{
+    // Return the index of the handle entry that corresponds to this entity handle.
+    return handle.GetIdentifier() - 1;
+}
+
+EntityHandle EntitySystem::MakeHandle(const int handleIndex) const
+{
+    Assert(handleIndex >= 0 && (std::size_t)handleIndex < m_handleVersions.size(), "Invalid handle index!");
+
+    // Make a handle from its index and the current version.
+    return EntityHandle(handleIndex + 1, m_handleVersions[handleIndex]);
+}
+
+void EntitySystem::AllocateHandle()
+{
+    Assert(m_initialized, "Entity system is not initialized!");
+    
+    // Create a handle entry.
+    int handleIndex = (int)m_handleVersions.size();
+
+    HandleFlags::Type handleFlags = HandleFlags::Free;
+
+    m_handleVersions.push_back(m_initialVersion);
+    m_handleFlags.push_back(handleFlags);
+    m_handleNextFree.push_back(InvalidNextFree);
+    m_handleDenseIndices.push_back(InvalidDenseIndex);
+
+    // Add the created handle entry at the end of the free list, so handles
+    // of a newly allocated block are retrieved in the order of their indices.
+    this->PushFreeHandle(handleIndex, false);
+}
+
+void EntitySystem::AllocateHandles(int count)
+{
+    Assert(m_initialized, "Entity system is not initialized!");
+    Assert(count > 0, "Attempting to allocate an invalid number of handles!");
+
+    // Reserve memory for the whole block at once.
+    std::size_t requiredSize = m_handleVersions.size() + count;
+
+    if(requiredSize > m_handleVersions.capacity())
+    {
+        std::size_t grownSize = (std::size_t)(m_handleVersions.capacity() * m_info.growthFactor);
+        std::size_t capacity = std::max(requiredSize, grownSize);
+
+        m_handleVersions.reserve(capacity);
+        m_handleFlags.reserve(capacity);
+        m_handleNextFree.reserve(capacity);
+        m_handleDenseIndices.reserve(capacity);
+    }
+
+    // Allocate handles that will be placed next to each other.
+    for(int i = 0; i < count; ++i)
+    {
+        this->AllocateHandle();
+    }
+}
+
+void EntitySystem::GrowHandles(int required)
+{
+    Assert(m_initialized, "Entity system is not initialized!");
+    Assert(required > 0, "Attempting to grow handles by an invalid number!");
+
+    // Check if we reached the numerical limit.
+    int available = MaximumIdentifier - (int)m_handleVersions.size();
+    Verify(required <= available, "Entity handle identifier reached its numerical limit!");
+
+    // Grow the handle list by its growth factor to avoid frequent allocations.
+    int growth = (int)(m_handleVersions.size() * (m_info.growthFactor - 1.0f));
+    int count = std::min(std::max(required, growth), available);
+
+    this->AllocateHandles(count);
+}
+
+int EntitySystem::RetrieveHandle()
+{
+    Assert(m_initialized, "Entity system is not initialized!");
+
+    // Allocate handles if the free list queue is too short.
+    // Keeping a minimum number of free handles delays the reuse of recently freed
+    // handles, which slows down the growth of their version counters.
+    if(m_freeListSize <= m_info.minimumFreeHandles)
+    {
+        this->GrowHandles(m_info.minimumFreeHandles + 1 - m_freeListSize);
+
+        Assert(m_freeListSize > 0, "Free list is empty after allocating a handle!");
+    }
+
+    // Retrieve an unused handle from the free list.
+    int handleIndex = this->PopFreeHandle();
+
+    Assert(m_handleFlags[handleIndex] == HandleFlags::Free, "Retrieved handle is not marked as free!");
+
+    return handleIndex;
+}
+
+bool EntitySystem::CreateHandle(const int handleIndex, bool finalizeFailed)
+{
+    Assert(m_initialized, "Entity system is not initialized!");
+
+    // Make sure we got a valid index.
+    Assert(handleIndex >= 0 && (std::size_t)handleIndex < m_handleFlags.size(), "Invalid handle index!");
+
+    // Check handle flags.
+    Assert(!(m_handleFlags[handleIndex] & HandleFlags::Active), "Attempting to create a handle that is already active!");
+    Assert(m_handleFlags[handleIndex] & HandleFlags::Valid, "Attemping to create a handle that is not valid!");
+
+    // Increment the counter of active entities.
+    m_entityCount += 1;
+
+    // Check if a batch subscriber has already failed the finalization.
+    if(finalizeFailed)
+        return false;
+
+    // Inform that we want this entity finalized.
+    EntityHandle handle = this->MakeHandle(handleIndex);
+
+    if(this->events.finalize.HasSubscribers())
+    {
+        if(!this->events.finalize({ handle }))
+            return false;
+    }
+
+    // Mark the handle as active.
+    m_handleFlags[handleIndex] |= HandleFlags::Active;
+
+    // Add the entity to the packed list of active entities.
+    this->InsertActiveEntity(handleIndex);
+
+    // Inform about a created entity.
+    this->events.create({ handle });
+
+    m_statistics.createdEntities += 1;
+
+    return true;
+}
+
+void EntitySystem::CreateHandles(const EntityList& handles)
+{
+    Assert(m_initialized, "Entity system is not initialized!");
+
+    if(handles.empty())
+        return;
+
+    // Let batch subscribers finalize all entities at once.
+    m_batchResults.resize(BatchMask::CalculateWordCount((int)handles.size()));
+
+    BatchMask results = { m_batchResults.data(), (int)handles.size() };
+    results.SetAll();
+
+    if(this->events.finalizeBatch.HasSubscribers())
+    {
+        this->events.finalizeBatch({ handles.data(), (int)handles.size(), results });
+    }
+
+    // Create entities and collect the ones that failed to finalize.
+    m_batchCreated.clear();
+    m_batchFailed.clear();
+
+    for(std::size_t i = 0; i < handles.size(); ++i)
+    {
+        if(this->CreateHandle(this->CalculateHandleIndex(handles[i]), !results.Test((int)i)))
+        {
+            m_batchCreated.push_back(handles[i]);
+        }
+        else
+        {
+            m_batchFailed.push_back(handles[i]);
+        }
+    }
+
+    m_statistics.failedFinalizations += (int)m_batchFailed.size();
+
+    // Inform about created entities.
+    if(!m_batchCreated.empty() && this->events.createBatch.HasSubscribers())
+    {
+        this->events.createBatch({ m_batchCreated.data(), (int)m_batchCreated.size() });
+    }
 
-    handleEntry.flags = HandleFlags::Free;
+    // Destroy entity handles that failed to finalize.
+    if(!m_batchFailed.empty())
+    {
+        // Destroying can create another batch of handles.
+        EntityList failed;
+        failed.swap(m_batchFailed);
+
+        this->DestroyHandles(failed);
+    }
+}
+
+void EntitySystem::DestroyHandle(const int handleIndex)
+{
+    Assert(m_initialized, "Entity system is not initialized!");
+
+    // Make sure we got a valid index.
+    Assert(handleIndex >= 0 && (std::size_t)handleIndex < m_handleFlags.size(), "Invalid handle index!");
+
+    // Inform about a destroyed entity.
+    this->events.destroy({ this->MakeHandle(handleIndex) });
+
+    // Remove the entity from the packed list of active entities.
+    if(m_handleFlags[handleIndex] & HandleFlags::Active)
+    {
+        this->EraseActiveEntity(handleIndex);
+    }
+
+    // Free entity handle.
+    this->FreeHandle(handleIndex);
+
+    // Decrement the counter of active entities.
+    m_entityCount -= 1;
+
+    m_statistics.destroyedEntities += 1;
+}
+
+void EntitySystem::DestroyHandles(const EntityList& handles)
+{
+    Assert(m_initialized, "Entity system is not initialized!");
+
+    if(handles.empty())
+        return;
+
+    // Inform about destroyed entities while their handles are still valid.
+    if(this->events.destroyBatch.HasSubscribers())
+    {
+        this->events.destroyBatch({ handles.data(), (int)handles.size() });
+    }
+
+    // Destroy entities one by one.
+    for(const EntityHandle& handle : handles)
+    {
+        this->DestroyHandle(this->CalculateHandleIndex(handle));
+    }
+}
+
+void EntitySystem::CancelHandles(const EntityList& handles)
+{
+    Assert(m_initialized, "Entity system is not initialized!");
+
+    if(handles.empty())
+        return;
+
+    // Inform about destroyed entities, as storage may have been filled
+    // for them before creation, such as rows of instantiated prefabs.
+    if(this->events.destroyBatch.HasSubscribers())
+    {
+        this->events.destroyBatch({ handles.data(), (int)handles.size() });
+    }
+
+    // Free handles of entities that have never been active.
+    for(const EntityHandle& handle : handles)
+    {
+        this->events.destroy({ handle });
+        this->FreeHandle(this->CalculateHandleIndex(handle));
+    }
+
+    m_statistics.cancelledEntities += (int)handles.size();
+}
+
+void EntitySystem::FreeHandle(const int handleIndex)
+{
+    Assert(m_initialized, "Entity system is not initialized!");
+
+    // Make sure we got a valid index.
+    Assert(handleIndex >= 0 && (std::size_t)handleIndex < m_handleFlags.size(), "Invalid handle index!");
+
+    // Mark the handle as free.
+    Assert(!(m_handleFlags[handleIndex] & HandleFlags::Free), "Attempting to free a handle that is already free!");
+    Assert(m_handleFlags[handleIndex] & HandleFlags::Valid, "Attempting to free a handle that is not valid!");
+
+    m_handleFlags[handleIndex] = HandleFlags::Free;
+
+    // Retire the handle entry if its version cannot be increased anymore.
+    // Wrapping the version around would make stale handles valid again.
+    if(m_handleVersions[handleIndex] == MaximumVersion)
+        return;
 
     // Increment the handle version to invalidate it.
-    handleEntry.handle.m_version += 1;
+    m_handleVersions[handleIndex] += 1;
+
+    // Add the handle entry to the free list.
+    this->PushFreeHandle(handleIndex, true);
+}
 
-    // Add the handle entry to the free list queue.
-    if(m_freeListIsEmpty)
+void EntitySystem::PushFreeHandle(const int handleIndex, bool recentlyFreed)
+{
+    Assert(m_handleNextFree[handleIndex] == InvalidNextFree, "Freed handle entry is pointing to a next free handle!");
+
+    if(m_info.freeHandlePolicy == FreeHandlePolicy::LowestIndexFirst)
+    {
+        // Keep free handles in a min heap of indices.
+        m_freeHeap.push_back(handleIndex);
+        std::push_heap(m_freeHeap.begin(), m_freeHeap.end(), std::greater<int>());
+    }
+    else if(m_freeListIsEmpty)
     {
         // Add the handle as the only element of the queue.
         m_freeListDequeue = handleIndex;
         m_freeListEnqueue = handleIndex;
         m_freeListIsEmpty = false;
     }
+    else if(recentlyFreed && m_info.freeHandlePolicy == FreeHandlePolicy::LastInFirstOut)
+    {
+        // Add the handle at the beginning of the queue, so it is reused first.
+        m_handleNextFree[handleIndex] = m_freeListDequeue;
+        m_freeListDequeue = handleIndex;
+    }
     else
     {
         // Check if the end of the free list queue is valid.
-        Assert(m_handles[m_freeListEnqueue].nextFree == InvalidNextFree, "Last element in the free list queue is pointing at a next free handle!");
-        Assert(handleEntry.nextFree == InvalidNextFree, "Fried handle entry is poiting to a next free handle!");
+        Assert(m_handleNextFree[m_freeListEnqueue] == InvalidNextFree, "Last element in the free list queue is pointing at a next free handle!");
 
         // Add the handle at the end of the queue.
-        m_handles[m_freeListEnqueue].nextFree = handleIndex;
+        m_handleNextFree[m_freeListEnqueue] = handleIndex;
         m_freeListEnqueue = handleIndex;
     }
+
+    m_freeListSize += 1;
+}
+
+int EntitySystem::PopFreeHandle()
+{
+    Assert(m_freeListSize > 0, "Attempting to pop a handle from an empty free list!");
+
+    int handleIndex = InvalidQueueElement;
+
+    if(m_info.freeHandlePolicy == FreeHandlePolicy::LowestIndexFirst)
+    {
+        // Remove the lowest index from the min heap.
+        std::pop_heap(m_freeHeap.begin(), m_freeHeap.end(), std::greater<int>());
+        handleIndex = m_freeHeap.back();
+        m_freeHeap.pop_back();
+    }
+    else
+    {
+        handleIndex = m_freeListDequeue;
+
+        if(m_freeListDequeue == m_freeListEnqueue)
+        {
+            // Remove the handle as the only element of the queue.
+            m_freeListDequeue = InvalidQueueElement;
+            m_freeListEnqueue = InvalidQueueElement;
+            m_freeListIsEmpty = true;
+        }
+        else
+        {
+            // Remove the handle from the beginning of the queue.
+            m_freeListDequeue = m_handleNextFree[handleIndex];
+            m_handleNextFree[handleIndex] = InvalidNextFree;
+        }
+    }
+
+    m_freeListSize -= 1;
+
+    return handleIndex;
+}
+
+void EntitySystem::InsertActiveEntity(const int handleIndex)
+{
+    Assert(m_handleDenseIndices[handleIndex] == InvalidDenseIndex, "Active handle already has a dense index!");
+
+    m_handleDenseIndices[handleIndex] = (int)m_entities.size();
+    m_entities.push_back(this->MakeHandle(handleIndex));
+}
+
+void EntitySystem::EraseActiveEntity(const int handleIndex)
+{
+    int denseIndex = m_handleDenseIndices[handleIndex];
+    Assert(denseIndex != InvalidDenseIndex, "Active handle does not have a dense index!");
+
+    // Move the last entity in place of the removed one.
+    const EntityHandle& lastEntity = m_entities.back();
+    m_handleDenseIndices[this->CalculateHandleIndex(lastEntity)] = denseIndex;
+    m_entities[denseIndex] = lastEntity;
+
+    m_entities.pop_back();
+    m_handleDenseIndices[handleIndex] = InvalidDenseIndex;
+}
+
+void EntitySystem::QueueCommand(EntityCommands::Type type, const EntityHandle& handle, bool merge)
+{
+    Assert(m_initialized, "Entity system is not initialized!");
+
+    // Extend the last command if the handle directly follows its range.
+    if(merge && !m_commands.IsEmpty())
+    {
+        EntityCommand& last = m_commands.Back();
+
+        if(last.type == type && last.handle.GetIdentifier() + last.count == handle.GetIdentifier())
+        {
+            last.count += 1;
+            return;
+        }
+    }
+
+    // Add a new command to the queue.
+    EntityCommand command;
+    command.type = type;
+    command.handle = handle;
+    command.count = 1;
+
+    m_commands.Push(command);
+
+    // Track the highest number of queued commands.
+    m_statistics.commandQueueHighWater = std::max(m_statistics.commandQueueHighWater, (int)m_commands.GetSize());
+}
+
+EntityHandle EntitySystem::ReserveHandleConcurrent(bool deferred)
+{
+    Assert(m_initialized, "Entity system is not initialized!");
+
+    // Claim the next reserved handle.
+    int index = m_concurrentCursor.fetch_add(1, std::memory_order_relaxed);
+
+    if(index >= (int)m_concurrentHandles.size())
+        return EntityHandle();
+
+    // Each element is written only by the thread that claimed it.
+    m_concurrentDeferred[index] = deferred ? 1 : 0;
+
+    return m_concurrentHandles[index];
+}
+
+void EntitySystem::ProcessConcurrentHandles()
+{
+    Assert(m_initialized, "Entity system is not initialized!");
+
+    // Schedule claimed handles to be created in the order they were claimed.
+    int claimedCount = std::min(m_concurrentCursor.load(), (int)m_concurrentHandles.size());
+
+    for(int i = 0; i < claimedCount; ++i)
+    {
+        const EntityHandle& handle = m_concurrentHandles[i];
+        int handleIndex = this->CalculateHandleIndex(handle);
+
+        Assert(m_handleFlags[handleIndex] == HandleFlags::Reserve, "Claimed handle is not marked as reserved!");
+
+        // Deferred handles remain reserved until their command buffer is played back.
+        if(m_concurrentDeferred[i])
+            continue;
+
+        // Mark the claimed handle as valid.
+        m_handleFlags[handleIndex] = HandleFlags::Valid;
+
+        // Merge consecutive handles into a single range command.
+        this->QueueCommand(EntityCommands::Create, handle, i != 0);
+    }
+
+    // Remove claimed handles from the list.
+    m_concurrentHandles.erase(m_concurrentHandles.begin(), m_concurrentHandles.begin() + claimedCount);
+
+    // Reserve new handles.
+    while((int)m_concurrentHandles.size() < m_info.concurrentHandles)
+    {
+        int handleIndex = this->RetrieveHandle();
+        m_handleFlags[handleIndex] = HandleFlags::Reserve;
+
+        m_concurrentHandles.push_back(this->MakeHandle(handleIndex));
+    }
+
+    m_concurrentDeferred.assign(m_concurrentHandles.size(), 0);
+
+    // Reset the claim cursor.
+    m_concurrentCursor = 0;
+
+    // Process handles of shards.
+    if(!m_shards.empty())
+    {
+        this->ProcessShardHandles();
+    }
+}
+
+EntityHandle EntitySystem::ReserveHandleShard(int shard, bool deferred)
+{
+    Assert(m_initialized, "Entity system is not initialized!");
+    Assert(shard >= 0 && shard < (int)m_shards.size(), "Invalid handle shard index!");
+
+    HandleShard& owner = m_shards[shard];
+
+    // Borrow the next block from the pool when the current one runs out.
+    // Only this atomic increment is shared with other shards, once per block.
+    if(owner.blocks.empty() || owner.cursor == this->GetShardBlockSize(owner.blocks.back()))
+    {
+        int block = m_shardBlockCursor.fetch_add(1, std::memory_order_relaxed);
+
+        if(block >= m_shardBlockCount)
+            return EntityHandle();
+
+        owner.blocks.push_back(block);
+        owner.cursor = 0;
+    }
+
+    // Claim the next handle of the block.
+    int index = owner.blocks.back() * m_info.shardBlockSize + owner.cursor;
+    owner.cursor += 1;
+
+    // Each element is written only by the thread that owns the block.
+    m_shardDeferred[index] = deferred ? 1 : 0;
+
+    return m_shardPool[index];
+}
+
+int EntitySystem::GetShardBlockSize(int block) const
+{
+    // Last block of the pool can be smaller than others.
+    int begin = block * m_info.shardBlockSize;
+    return std::min(m_info.shardBlockSize, (int)m_shardPool.size() - begin);
+}
+
+void EntitySystem::ProcessShardHandles()
+{
+    Assert(m_initialized, "Entity system is not initialized!");
+
+    // Gather unclaimed handles that are returned to the pool.
+    m_shardReturned.clear();
+
+    // Schedule claimed handles to be created shard by shard, in the order they were claimed.
+    for(HandleShard& shard : m_shards)
+    {
+        for(std::size_t i = 0; i < shard.blocks.size(); ++i)
+        {
+            int block = shard.blocks[i];
+            int begin = block * m_info.shardBlockSize;
+            int end = begin + this->GetShardBlockSize(block);
+
+            // Only the last borrowed block can be claimed partially.
+            int claimedEnd = i + 1 == shard.blocks.size() ? begin + shard.cursor : end;
+
+            for(int index = begin; index < end; ++index)
+            {
+                const EntityHandle& handle = m_shardPool[index];
+
+                if(index >= claimedEnd)
+                {
+                    m_shardReturned.push_back(handle);
+                    continue;
+                }
+
+                int handleIndex = this->CalculateHandleIndex(handle);
+
+                Assert(m_handleFlags[handleIndex] == HandleFlags::Reserve, "Claimed handle is not marked as reserved!");
+
+                // Deferred handles remain reserved until their command buffer is played back.
+                if(m_shardDeferred[index])
+                    continue;
+
+                // Mark the claimed handle as valid.
+                m_handleFlags[handleIndex] = HandleFlags::Valid;
+
+                // Merge consecutive handles into a single range command.
+                this->QueueCommand(EntityCommands::Create, handle, index != begin);
+            }
+        }
+
+        shard.blocks.clear();
+        shard.cursor = 0;
+    }
+
+    // Return blocks that have not been borrowed to the pool, after the unclaimed handles.
+    int borrowedCount = std::min(m_shardBlockCursor.load(), m_shardBlockCount);
+    int borrowedEnd = std::min(borrowedCount * m_info.shardBlockSize, (int)m_shardPool.size());
+    m_shardReturned.insert(m_shardReturned.end(), m_shardPool.begin() + borrowedEnd, m_shardPool.end());
+    m_shardPool.swap(m_shardReturned);
+
+    // Reserve new handles.
+    while((int)m_shardPool.size() < m_info.concurrentHandles)
+    {
+        int handleIndex = this->RetrieveHandle();
+        m_handleFlags[handleIndex] = HandleFlags::Reserve;
+
+        m_shardPool.push_back(this->MakeHandle(handleIndex));
+    }
+
+    m_shardDeferred.assign(m_shardPool.size(), 0);
+    m_shardBlockCount = ((int)m_shardPool.size() + m_info.shardBlockSize - 1) / m_info.shardBlockSize;
+
+    // Reset the borrow cursor.
+    m_shardBlockCursor = 0;
+}
+
+void EntitySystem::SubmitCommands(EntityCommandBuffer& buffer)
+{
+    Assert(m_initialized, "Entity system is not initialized!");
+    Assert(buffer.m_entitySystem == this, "Submitting a command buffer to a different entity system!");
+
+    // Push the buffer at the beginning of the list.
+    buffer.m_next = m_submittedBuffers.load(std::memory_order_relaxed);
+
+    while(!m_submittedBuffers.compare_exchange_weak(buffer.m_next, &buffer, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+}
+
+void EntitySystem::ProcessSubmittedCommands()
+{
+    Assert(m_initialized, "Entity system is not initialized!");
+
+    // Take the list of submitted buffers.
+    EntityCommandBuffer* buffer = m_submittedBuffers.exchange(nullptr, std::memory_order_acquire);
+
+    // Reverse the list to get the submission order.
+    EntityCommandBuffer* reversed = nullptr;
+
+    while(buffer != nullptr)
+    {
+        EntityCommandBuffer* next = buffer->m_next;
+        buffer->m_next = reversed;
+        reversed = buffer;
+        buffer = next;
+    }
+
+    // Play back commands of each buffer.
+    for(buffer = reversed; buffer != nullptr; buffer = buffer->m_next)
+    {
+        for(const EntityCommand& command : buffer->m_commands)
+        {
+            switch(command.type)
+            {
+            case EntityCommands::Create:
+                {
+                    int handleIndex = this->CalculateHandleIndex(command.handle);
+
+                    Assert(command.handle == this->MakeHandle(handleIndex), "Attempting to create a non existing entity!");
+                    Assert(m_handleFlags[handleIndex] == HandleFlags::Reserve, "Recorded handle is not marked as reserved!");
+
+                    // Mark the recorded handle as valid.
+                    m_handleFlags[handleIndex] = HandleFlags::Valid;
+
+                    // Schedule an entity to be created.
+                    this->QueueCommand(EntityCommands::Create, command.handle, true);
+                }
+                break;
+
+            case EntityCommands::Destroy:
+                {
+                    // Schedule an entity to be destroyed.
+                    this->DestroyEntity(command.handle);
+                }
+                break;
+            }
+        }
+
+        // Clear played back commands.
+        buffer->ClearPlayedBack();
+    }
+
+    // Detach played back buffers.
+    while(reversed != nullptr)
+    {
+        EntityCommandBuffer* next = reversed->m_next;
+        reversed->m_next = nullptr;
+        reversed = next;
+    }
+}
+
+void EntitySystem::DiscardCommands(const EntityCommandBuffer& buffer)
+{
+    Assert(m_initialized, "Entity system is not initialized!");
+    Assert(buffer.m_entitySystem == this, "Discarding a command buffer of a different entity system!");
+
+    std::lock_guard<std::mutex> lock(m_discardedMutex);
+
+    // Gather handles that have been reserved for recorded creations.
+    for(const EntityCommand& command : buffer.m_commands)
+    {
+        if(command.type == EntityCommands::Create)
+        {
+            m_discardedHandles.push_back(command.handle);
+        }
+    }
+}
+
+void EntitySystem::ProcessDiscardedHandles()
+{
+    Assert(m_initialized, "Entity system is not initialized!");
+
+    std::lock_guard<std::mutex> lock(m_discardedMutex);
+
+    // Free discarded handles without dispatching any events,
+    // as their entities have never been scheduled to be created.
+    for(const EntityHandle& handle : m_discardedHandles)
+    {
+        int handleIndex = this->CalculateHandleIndex(handle);
+
+        Assert(handle == this->MakeHandle(handleIndex), "Discarding a non existing handle!");
+        Assert(m_handleFlags[handleIndex] == HandleFlags::Reserve, "Discarded handle is not marked as reserved!");
+
+        // Version is incremented, so handles returned by the buffer become invalid.
+        m_handleFlags[handleIndex] = HandleFlags::Valid;
+        this->FreeHandle(handleIndex);
+    }
+
+    m_discardedHandles.clear();
+}
+
+bool EntitySystem::HasDiscardedHandles() const
+{
+    std::lock_guard<std::mutex> lock(m_discardedMutex);
+    return !m_discardedHandles.empty();
 }
 
 bool EntitySystem::IsHandleValid(const EntityHandle& entity) const
@@ -392,27 +1789,70 @@ bool EntitySystem::IsHandleValid(const EntityHandle& entity) const
         return false;
 
     // Check if the handle identifier is valid.
-    if(entity.m_identifier == InvalidIdentifier)
+    if(entity.GetIdentifier() == InvalidIdentifier)
         return false;
 
-    Assert(entity.m_identifier > InvalidIdentifier, "Corrupted entity handle identifier encountered!");
-    Assert(entity.m_identifier <= (int)m_handles.size(), "Corrupted entity handle identifier encountered!");
+    Assert(entity.GetIdentifier() > InvalidIdentifier, "Corrupted entity handle identifier encountered!");
 
-    // Retrieve the handle entry.
+    // Check if the handle entry has been released by compacting.
+    if(entity.GetIdentifier() > (int)m_handleFlags.size())
+        return false;
+
+    // Retrieve the handle flags.
     int handleIndex = this->CalculateHandleIndex(entity);
-    const HandleEntry& handleEntry = m_handles[handleIndex];
+    HandleFlags::Type handleFlags = m_handleFlags[handleIndex];
 
     // Check if the handle entry is valid.
-    if(!(handleEntry.flags & HandleFlags::Valid))
+    if(!(handleFlags & HandleFlags::Valid))
         return false;
 
     // Check if the handle is scheduled to be destroyed.
-    if(handleEntry.flags & HandleFlags::Destroy)
+    if(handleFlags & HandleFlags::Destroy)
         return false;
 
     // Check if handle versions match.
-    if(handleEntry.handle.m_version != entity.m_version)
+    if(m_handleVersions[handleIndex] != entity.GetVersion())
+        return false;
+
+    return true;
+}
+
+bool EntitySystem::IsEntityActive(const EntityHandle& entity) const
+{
+    if(!this->IsHandleValid(entity))
         return false;
 
+    // Check if the entity has been finalized.
+    int handleIndex = this->CalculateHandleIndex(entity);
+    return (m_handleFlags[handleIndex] & HandleFlags::Active) != 0;
+}
+
+bool EntitySystem::AreHandlesValid(const EntityHandle* handles, int count) const
+{
+    if(!m_initialized)
+        return count == 0;
+
+    Assert(handles != nullptr || count == 0, "Input array of entity handles is nullptr!");
+
+    // Check handles in a single pass over the handle table.
+    const int handleCount = (int)m_handleFlags.size();
+
+    for(int i = 0; i < count; ++i)
+    {
+        int identifier = handles[i].GetIdentifier();
+
+        if(identifier <= InvalidIdentifier || identifier > handleCount)
+            return false;
+
+        int handleIndex = identifier - 1;
+        HandleFlags::Type handleFlags = m_handleFlags[handleIndex];
+
+        if((handleFlags & (HandleFlags::Valid | HandleFlags::Destroy)) != HandleFlags::Valid)
+            return false;
+
+        if(m_handleVersions[handleIndex] != handles[i].GetVersion())
+            return false;
+    }
+
     return true;
 }
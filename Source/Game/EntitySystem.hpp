@@ -1,7 +1,14 @@
 #pragma once
 
 #include "Precompiled.hpp"
+#include "Common/BinaryStream.hpp"
+#include "Common/ThreadOwner.hpp"
 #include "EntityHandle.hpp"
+#include "EntityMap.hpp"
+#include "EntityCommandBuffer.hpp"
+
+// Forward declarations.
+class Checksum;
 
 //
 // Entity System
@@ -9,8 +16,11 @@
 //  Manages lifetime of entities and gives means for their identification.
 //  
 //  Example usage:
+//      Game::EntitySystemInfo info;
+//      info.initialCapacity = 4096;
+//      
 //      Game::EntitySystem entitySystem;
-//      entitySystem.Initialize();
+//      entitySystem.Initialize(info);
 //      
 //      EntityHandle entity = entitySystem.CreateEntity();
 //      /*
@@ -25,12 +35,174 @@
 //      */
 //      entitySystem.ProcessCommands();
 //
+//  Cancelling creation of entities:
+//      EntityHandle entity = entitySystem.CreateEntity();
+//      entitySystem.DestroyEntity(entity);
+//      /*
+//          Entity destroyed before it has been created is never finalized
+//          or created, and its handle is recycled right away at the next
+//          ProcessCommands() call. Destroy events are still dispatched, so
+//          storage filled before creation, such as chunk rows of instantiated
+//          prefabs or pool components, releases the entity.
+//      */
+//
+//  Unloading a large world over multiple frames:
+//      while(entitySystem.DestroyAllEntitiesIncremental(0, 0.002) != 0)
+//      {
+//          /* Present a loading screen with the progress. */
+//      }
+//
+//  Creating and destroying entities in batches:
+//      EntityHandle entities[128];
+//      entitySystem.CreateEntities(128, &entities[0]);
+//      entitySystem.DestroyEntities(&entities[0], 128);
+//
+//  Creating entities from worker threads:
+//      // Does not lock and can be called from any thread,
+//      // but not while ProcessCommands() is running.
+//      EntityHandle entity = entitySystem.CreateEntityConcurrent();
+//      /*
+//          Entity becomes valid at the next ProcessCommands() call.
+//      */
+//
+//  Creating entities from worker threads that own handle shards:
+//      // Requires EntitySystemInfo::handleShards, usually one shard per job
+//      // system participant. Each thread claims handles from a block that only
+//      // its shard uses and borrows a block from a shared pool once per block.
+//      int shard = jobSystem.GetParticipantIndex();
+//      EntityHandle entity = entitySystem.CreateEntityConcurrent(shard);
+//
+//  Recording commands that are played back later:
+//      See EntityCommandBuffer class.
+//
+//  Handing the entity system over to another thread:
+//      // Builds with thread checks assert when entities are created, destroyed
+//      // or processed by a thread other than the one that initialized the
+//      // entity system, except for concurrent creation and command buffers.
+//      // Ownership is passed explicitly by the thread that takes over, such
+//      // as the main thread after the entity system was initialized by a job.
+//      entitySystem.SetOwnerThread();
+//
+//  Moving entities to another entity system:
+//      Game::EntityMap<EntityHandle> remap;
+//      entitySystem.MigrateEntities(otherSystem, &entities[0], 128, remap);
+//      /*
+//          Migrated entities are active in the other system right away
+//          and the remap table holds their new handles. Destroy events are
+//          dispatched in this system, so its storage drops the entities.
+//      */
+//
+//  Saving and loading the state of entities:
+//      See WorldSnapshot functions.
+//
+//  Sampling statistics once per frame:
+//      Game::EntitySystemStatistics statistics = entitySystem.GetStatistics();
+//      entitySystem.ResetStatistics();
+//
+//  Iterating over active entities:
+//      entitySystem.ForEachEntity([](const EntityHandle& entity)
+//      {
+//          /* ... */
+//      });
+//
+//  Validating handles once per query instead of once per access:
+//      Assert(entitySystem.AreHandlesValid(entities, count), "Query has stale handles!");
+//
+//      for(int i = 0; i < count; ++i)
+//      {
+//          int index = entitySystem.GetIndexUnchecked(entities[i]);
+//          /* ... */
+//      }
+//
 
 namespace Game
 {
+    // Order in which free handles are reused.
+    struct FreeHandlePolicy
+    {
+        enum Type
+        {
+            // Reuses the handle that has been free for the longest time.
+            // Spreads version increments evenly over the whole table.
+            FirstInFirstOut,
+
+            // Reuses the most recently freed handle.
+            // Keeps recently touched handle entries in use.
+            LastInFirstOut,
+
+            // Reuses the free handle with the lowest index.
+            // Keeps active handles packed at the beginning of the table.
+            LowestIndexFirst,
+        };
+    };
+
+    // Entity system initialization struct.
+    struct EntitySystemInfo
+    {
+        // Number of handles allocated up front.
+        int initialCapacity;
+
+        // Number of free handles kept in the queue before one is reused.
+        int minimumFreeHandles;
+
+        // Factor by which the handle list grows when more handles are needed.
+        float growthFactor;
+
+        // Number of handles reserved for concurrent creation between command processing.
+        int concurrentHandles;
+
+        // Number of shards that claim reserved handles in blocks, usually one per
+        // worker thread. Shards borrow blocks from a separate pool that holds the
+        // same number of reserved handles as above. Zero disables shards.
+        int handleShards;
+
+        // Number of consecutive reserved handles in a block borrowed by a shard.
+        int shardBlockSize;
+
+        // Order in which free handles are reused.
+        FreeHandlePolicy::Type freeHandlePolicy;
+
+        EntitySystemInfo();
+    };
+
+    // Entity system statistics struct.
+    // Counters accumulate since the last ResetStatistics() call,
+    // while the remaining values describe the current state.
+    struct EntitySystemStatistics
+    {
+        // Number of created and destroyed entities.
+        int createdEntities;
+        int destroyedEntities;
+
+        // Number of entities that failed to finalize.
+        int failedFinalizations;
+
+        // Number of entities destroyed before they were created.
+        int cancelledEntities;
+
+        // Highest number of queued commands.
+        int commandQueueHighWater;
+
+        // Time spent processing commands in seconds.
+        double processCommandsTime;
+
+        // Number of handle entries and free handles in the handle table.
+        int handleTableSize;
+        int freeHandleCount;
+
+        // Number of active entities.
+        int activeEntities;
+
+        EntitySystemStatistics();
+    };
+
     // Entity system class.
     class EntitySystem : private NonCopyable
     {
+    public:
+        // Friend declarations.
+        friend class EntityCommandBuffer;
+
     public:
         EntitySystem();
         ~EntitySystem();
@@ -39,26 +211,118 @@ namespace Game
         void Cleanup();
 
         // Initializes the entity system.
-        bool Initialize();
+        bool Initialize(const EntitySystemInfo& info = EntitySystemInfo());
 
         // Creates an entity.
         EntityHandle CreateEntity();
 
+        // Creates multiple entities at once.
+        void CreateEntities(int count, EntityHandle* handles);
+
+        // Creates an entity from any thread without locking.
+        // Returns an invalid handle if reserved handles have run out.
+        EntityHandle CreateEntityConcurrent();
+
+        // Creates an entity from a thread that owns a shard without locking.
+        // Only a single thread may use a shard between ProcessCommands() calls.
+        // Returns an invalid handle if the pool has run out of blocks.
+        EntityHandle CreateEntityConcurrent(int shard);
+
+        // Creates entities that are active right away, without finalize or create
+        // events being dispatched. Used to recreate entities handed off by another node.
+        void CreateActiveEntities(int count, EntityHandle* handles);
+
         // Destroys an entity.
         void DestroyEntity(const EntityHandle& handle);
 
+        // Destroys multiple entities at once.
+        void DestroyEntities(const EntityHandle* handles, int count);
+
         // Destroys all entities.
         void DestroyAllEntities();
 
+        // Destroys all entities over multiple calls, usually once per frame.
+        // Each call destroys up to a limit of entities or until a time limit in
+        // seconds is spent, with zero meaning no limit. Entities that have not
+        // been destroyed yet remain active and their handles remain valid.
+        // Returns the number of entities that remain, which is zero when done.
+        int DestroyAllEntitiesIncremental(int entityLimit, double timeLimit);
+
         // Processes entity commands.
         void ProcessCommands();
 
+        // Makes the calling thread the only one that can change entities,
+        // which is only checked in builds with thread checks.
+        void SetOwnerThread();
+
+        // Releases free handle entries at the end of the handle table.
+        // Returns the number of released handle entries.
+        int Compact();
+
+        // Gets entity system statistics.
+        EntitySystemStatistics GetStatistics() const;
+
+        // Resets statistics counters, usually once per frame.
+        void ResetStatistics();
+
         // Checks if an entity handle is valid.
         bool IsHandleValid(const EntityHandle& entity) const;
 
+        // Checks if an entity handle is valid and the entity has been created.
+        bool IsEntityActive(const EntityHandle& entity) const;
+
+        // Checks if all entity handles are valid.
+        // Validates handles of a query once, before they are accessed without checks.
+        bool AreHandlesValid(const EntityHandle* handles, int count) const;
+
+        // Gets the index of the handle entry of an entity without validating its handle.
+        // Handle must be valid, which is only asserted in debug builds.
+        int GetIndexUnchecked(const EntityHandle& entity) const;
+
         // Returns the number of active entities.
         int GetEntityCount() const;
 
+        // Returns the number of handle shards.
+        int GetShardCount() const;
+
+        // Calls a function for each active entity.
+        template<typename Function>
+        void ForEachEntity(Function function) const;
+
+        // Gets a packed array of active entities.
+        const EntityHandle* GetEntities() const;
+
+        // Moves an active entity to another entity system.
+        // Entity keeps being active under a new handle that is returned. Destroy
+        // events are dispatched in this system while the old handle is still valid,
+        // so storage subscribed to them drops the entity, while no events are
+        // dispatched in the target system.
+        // Returns an invalid handle if the entity is not active.
+        EntityHandle MigrateEntity(EntitySystem& target, const EntityHandle& entity);
+
+        // Moves multiple active entities to another entity system.
+        // Inserts new handles of migrated entities into the remap table.
+        void MigrateEntities(EntitySystem& target, const EntityHandle* handles, int count, EntityMap<EntityHandle>& remap);
+
+        // Adds handles of active entities in their iteration order to a checksum.
+        // Commands should be processed before, as pending entities are not included.
+        void UpdateChecksum(Checksum& checksum) const;
+
+        // Writes the handle table, free list and active entities.
+        // Commands must be processed before saving.
+        bool SaveSnapshot(BinaryWriter& writer) const;
+
+        // Replaces the handle table, free list and active entities.
+        // Entity system must not have any active entities or pending commands.
+        // Loaded entities are active right away, without any events being dispatched.
+        bool LoadSnapshot(BinaryReader& reader);
+
+        // Replaces the handle table, free list and active entities with a snapshot,
+        // overwriting existing entities without any events being dispatched.
+        // Used to roll back to a snapshot saved earlier by the same entity system.
+        // Commands must be processed before restoring.
+        bool RestoreSnapshot(BinaryReader& reader);
+
     public:
         // Entity events.
         struct Events
@@ -80,19 +344,66 @@ namespace Game
             Dispatcher<void(Create)> create;
 
             // Destroy event.
+            // Receivers are packed, as most systems listen to it.
             struct Destroy
             {
                 const EntityHandle handle;
             };
 
-            Dispatcher<void(Destroy)> destroy;
+            Dispatcher<void(Destroy), CollectDefault<void>, ReceiverStorage::PackedArray> destroy;
+
+            // Batch events.
+            // Dispatched once per batch of consecutive commands of the same type,
+            // before the matching per entity events of all entities in the batch.
+            // Spans are only valid for the duration of the dispatch.
+
+            // Finalize batch event.
+            // Receivers return the results mask, so propagation stops once
+            // every entity in the batch has failed to finalize.
+            struct FinalizeBatch
+            {
+                const EntityHandle* handles;
+                int count;
+
+                // Clear a result bit to fail finalization of an entity.
+                BatchMask results;
+            };
+
+            Dispatcher<BatchMask(FinalizeBatch), CollectBatchWhileTrue> finalizeBatch;
+
+            // Create batch event.
+            struct CreateBatch
+            {
+                const EntityHandle* handles;
+                int count;
+            };
+
+            Dispatcher<void(CreateBatch)> createBatch;
+
+            // Destroy batch event.
+            struct DestroyBatch
+            {
+                const EntityHandle* handles;
+                int count;
+            };
+
+            Dispatcher<void(DestroyBatch)> destroyBatch;
+
+            // Commands processed event.
+            // Dispatched at the end of every ProcessCommands() call,
+            // which marks the boundary between simulation ticks.
+            struct CommandsProcessed
+            {
+            };
+
+            Dispatcher<void(CommandsProcessed)> commandsProcessed;
         } events;
 
     private:
         // Handle flags.
         struct HandleFlags
         {
-            typedef int Type;
+            typedef std::uint8_t Type;
 
             enum Flag : Type
             {
@@ -100,76 +411,219 @@ namespace Game
                 Valid   = 1 << 0, // Handle has been created but not finalized.
                 Active  = 1 << 1, // Handle has been finalized and can be processed.
                 Destroy = 1 << 2, // Handle has been scheduled to be destroyed.
+                Reserve = 1 << 3, // Handle has been reserved for concurrent creation.
             };
 
             static const Type Free = None;
         };
 
-        // Handle entry structure.
-        struct HandleEntry
+        // Type declarations.
+        typedef RingBuffer<EntityCommand> CommandList;
+        typedef std::vector<int> VersionList;
+        typedef std::vector<HandleFlags::Type> FlagList;
+        typedef std::vector<int> NextFreeList;
+        typedef std::vector<int> DenseIndexList;
+        typedef std::vector<EntityHandle> EntityList;
+        typedef std::vector<std::uint8_t> DeferredList;
+        typedef std::vector<int> FreeHeap;
+        typedef std::vector<BatchMask::WordType> ResultList;
+        typedef std::vector<int> BlockList;
+
+        // Size of padding that keeps shards of different threads on separate cache lines.
+        static const std::size_t CacheLineSize = 64;
+
+        // Handle shard owned by a single thread.
+        struct HandleShard
         {
-            EntityHandle handle;
-            HandleFlags::Type flags;
-            int nextFree;
-        };
+            HandleShard();
 
-        // Entity command types.
-        struct EntityCommands
-        {
-            enum Type
-            {
-                Invalid,
-                Create,
-                Destroy,
-            };
-        };
+            // Blocks borrowed from the pool in the order they were borrowed.
+            BlockList blocks;
 
-        // Entity command structure.
-        struct EntityCommand
-        {
-            EntityCommands::Type type;
-            EntityHandle handle;
+            // Number of handles claimed from the last borrowed block.
+            int cursor;
+
+            char padding[CacheLineSize];
         };
 
-        // Type declarations.
-        typedef std::queue<EntityCommand> CommandList;
-        typedef std::vector<HandleEntry> HandleList;
+        typedef std::vector<HandleShard> ShardList;
 
     private:
         // Calculates handle index.
         int CalculateHandleIndex(const EntityHandle& handle) const;
 
+        // Makes an entity handle from a handle index.
+        EntityHandle MakeHandle(const int handleIndex) const;
+
         // Allocate an entity handle.
         void AllocateHandle();
 
-        // Retrieves a free entity handle.
-        HandleEntry& RetrieveHandle();
+        // Allocates multiple entity handles.
+        void AllocateHandles(int count);
+
+        // Grows the list of handles by at least the required number of handles.
+        void GrowHandles(int required);
+
+        // Retrieves a free entity handle and returns its index.
+        int RetrieveHandle();
 
         // Creates an entity handle.
-        void CreateHandle(const int handleIndex, HandleEntry& handEntry);
+        // Returns false without creating the handle if its finalization fails.
+        bool CreateHandle(const int handleIndex, bool finalizeFailed);
+
+        // Creates a batch of entity handles.
+        void CreateHandles(const EntityList& handles);
 
         // Destroys an entity handle.
-        void DestroyHandle(const int handleIndex, HandleEntry& handEntry);
+        void DestroyHandle(const int handleIndex);
+
+        // Destroys a batch of entity handles.
+        void DestroyHandles(const EntityList& handles);
+
+        // Frees a batch of entity handles destroyed before they were created.
+        void CancelHandles(const EntityList& handles);
 
         // Frees an entity handle.
-        void FreeHandle(const int handleIndex, HandleEntry& handEntry);
+        void FreeHandle(const int handleIndex);
+
+        // Adds a handle to the free list according to the reuse policy.
+        // Recently freed handles are placed at the front for the LIFO policy.
+        void PushFreeHandle(const int handleIndex, bool recentlyFreed);
+
+        // Removes the next handle to be reused from the free list.
+        int PopFreeHandle();
+
+        // Adds or removes an entity in the packed list of active entities.
+        void InsertActiveEntity(const int handleIndex);
+        void EraseActiveEntity(const int handleIndex);
+
+        // Queues an entity command, merging it with the previous one if possible.
+        void QueueCommand(EntityCommands::Type type, const EntityHandle& handle, bool merge);
+
+        // Claims a reserved handle from any thread.
+        // Deferred handles are created when their command buffer is played back.
+        EntityHandle ReserveHandleConcurrent(bool deferred);
+
+        // Claims a reserved handle from a block of a shard.
+        EntityHandle ReserveHandleShard(int shard, bool deferred);
+
+        // Gets the number of handles in a block of the shard pool.
+        int GetShardBlockSize(int block) const;
+
+        // Schedules concurrently created entities and reserves new handles.
+        void ProcessConcurrentHandles();
+
+        // Schedules entities created from shards and returns unclaimed handles to the pool.
+        void ProcessShardHandles();
+
+        // Submits a command buffer from any thread.
+        void SubmitCommands(EntityCommandBuffer& buffer);
+
+        // Plays back submitted command buffers in submission order.
+        void ProcessSubmittedCommands();
+
+        // Returns handles reserved by a command buffer that is never submitted.
+        // Called from any thread.
+        void DiscardCommands(const EntityCommandBuffer& buffer);
+
+        // Frees handles returned by discarded command buffers.
+        void ProcessDiscardedHandles();
+
+        // Checks if there are discarded handles that have not been freed yet.
+        bool HasDiscardedHandles() const;
+
+        // Reads the handle table, free list and active entities of a snapshot.
+        bool ReadSnapshot(BinaryReader& reader);
 
     private:
+        // Initialization parameters.
+        EntitySystemInfo m_info;
+
         // List of commands.
         CommandList m_commands;
 
-        // List of entity handles.
-        HandleList m_handles;
+        // Table of entity handles stored as separate arrays.
+        // Handle identifiers are implied by their indices.
+        VersionList  m_handleVersions;
+        FlagList     m_handleFlags;
+        NextFreeList m_handleNextFree;
+
+        // Packed list of active entities and their indices in it.
+        EntityList     m_entities;
+        DenseIndexList m_handleDenseIndices;
+
+        // List of handles reserved for concurrent creation.
+        // Claimed in order by atomically incrementing the cursor.
+        EntityList       m_concurrentHandles;
+        DeferredList     m_concurrentDeferred;
+        std::atomic<int> m_concurrentCursor;
+
+        // Pool of handles reserved for shards, split into blocks of consecutive elements.
+        // Blocks are borrowed in order by atomically incrementing the cursor.
+        ShardList        m_shards;
+        EntityList       m_shardPool;
+        DeferredList     m_shardDeferred;
+        EntityList       m_shardReturned;
+        int              m_shardBlockCount;
+        std::atomic<int> m_shardBlockCursor;
+
+        // Batch of handles being processed and its results.
+        EntityList m_batchHandles;
+        ResultList m_batchResults;
+        EntityList m_batchCreated;
+        EntityList m_batchFailed;
+        EntityList m_batchCancelled;
+
+        // Intrusive list of submitted command buffers.
+        std::atomic<EntityCommandBuffer*> m_submittedBuffers;
+
+        // Handles reserved by command buffers that were never submitted.
+        // Returned from any thread and freed during ProcessCommands().
+        EntityList         m_discardedHandles;
+        mutable std::mutex m_discardedMutex;
 
         // Number of active entities.
         int m_entityCount;
 
         // List of free handles.
+        // Min heap of indices is used instead of the queue by the lowest index policy.
         int  m_freeListDequeue;
         int  m_freeListEnqueue;
+        int  m_freeListSize;
         bool m_freeListIsEmpty;
+        FreeHeap m_freeHeap;
+
+        // Version of newly allocated handle entries.
+        // Raised when compacting, so released identifiers can't revive stale handles.
+        int m_initialVersion;
+
+        // Statistics counters.
+        EntitySystemStatistics m_statistics;
+
+#if defined(THREAD_OWNER_CHECKS)
+        // Thread that can change entities.
+        ThreadOwner m_threadOwner;
+#endif
 
         // Initialization state.
         bool m_initialized;
     };
+
+    // Template and inline implementations.
+    inline int EntitySystem::GetIndexUnchecked(const EntityHandle& entity) const
+    {
+        Assert(this->IsHandleValid(entity), "Accessing an entity with an invalid handle!");
+        return entity.GetIdentifier() - 1;
+    }
+
+    template<typename Function>
+    void EntitySystem::ForEachEntity(Function function) const
+    {
+        // Entities are destroyed in ProcessCommands(), so the list
+        // remains unchanged while the function is being called.
+        for(const EntityHandle& entity : m_entities)
+        {
+            function(entity);
+        }
+    }
 }
@@ -0,0 +1,341 @@
+#include "Precompiled.hpp"
+#include "EntityTags.hpp"
+using namespace Game;
+
+// Select the widest available instruction set for filtering blocks.
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define ENTITY_TAGS_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define ENTITY_TAGS_SSE2
+#endif
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize entity tags! "
+
+    // Constant variables.
+    const int InvalidEntity = -1;
+
+    // Number of registered tag types.
+    std::atomic<int> registeredCount(0);
+
+    // Combines a block of 256 bits of included and excluded tags.
+    // Excluded bit arrays that are shorter than the block are treated as empty.
+    void FilterBlock(std::size_t word, const std::uint64_t* const* included, int includedCount,
+        const std::uint64_t* const* excluded, const std::size_t* excludedSizes, int excludedCount, std::uint64_t* output)
+    {
+    #if defined(ENTITY_TAGS_AVX2)
+        __m256i bits = _mm256_loadu_si256((const __m256i*)(included[0] + word));
+
+        for(int i = 1; i < includedCount; ++i)
+        {
+            bits = _mm256_and_si256(bits, _mm256_loadu_si256((const __m256i*)(included[i] + word)));
+        }
+
+        for(int i = 0; i < excludedCount; ++i)
+        {
+            if(word < excludedSizes[i])
+            {
+                bits = _mm256_andnot_si256(_mm256_loadu_si256((const __m256i*)(excluded[i] + word)), bits);
+            }
+        }
+
+        _mm256_storeu_si256((__m256i*)(output + word), bits);
+    #elif defined(ENTITY_TAGS_SSE2)
+        __m128i low = _mm_loadu_si128((const __m128i*)(included[0] + word));
+        __m128i high = _mm_loadu_si128((const __m128i*)(included[0] + word + 2));
+
+        for(int i = 1; i < includedCount; ++i)
+        {
+            low = _mm_and_si128(low, _mm_loadu_si128((const __m128i*)(included[i] + word)));
+            high = _mm_and_si128(high, _mm_loadu_si128((const __m128i*)(included[i] + word + 2)));
+        }
+
+        for(int i = 0; i < excludedCount; ++i)
+        {
+            if(word < excludedSizes[i])
+            {
+                low = _mm_andnot_si128(_mm_loadu_si128((const __m128i*)(excluded[i] + word)), low);
+                high = _mm_andnot_si128(_mm_loadu_si128((const __m128i*)(excluded[i] + word + 2)), high);
+            }
+        }
+
+        _mm_storeu_si128((__m128i*)(output + word), low);
+        _mm_storeu_si128((__m128i*)(output + word + 2), high);
+    #else
+        for(int w = 0; w < 4; ++w)
+        {
+            std::uint64_t bits = included[0][word + w];
+
+            for(int i = 1; i < includedCount; ++i)
+            {
+                bits &= included[i][word + w];
+            }
+
+            for(int i = 0; i < excludedCount; ++i)
+            {
+                if(word < excludedSizes[i])
+                {
+                    bits &= ~excluded[i][word + w];
+                }
+            }
+
+            output[word + w] = bits;
+        }
+    #endif
+    }
+}
+
+EntityTags::EntityTags() :
+    m_entitySystem(nullptr),
+    m_initialized(false)
+{
+}
+
+EntityTags::~EntityTags()
+{
+    this->Cleanup();
+}
+
+void EntityTags::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Unsubscribe from the entity system.
+    m_entityDestroy.Cleanup();
+    m_entitySystem = nullptr;
+
+    // Clear tag storage.
+    Utility::ClearContainer(m_entities);
+    Utility::ClearContainer(m_masks);
+
+    for(BitList& bits : m_bits)
+    {
+        Utility::ClearContainer(bits);
+    }
+
+    Utility::ClearContainer(m_filtered);
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool EntityTags::Initialize(EntitySystem* entitySystem)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(entitySystem == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid entity system.";
+        return false;
+    }
+
+    m_entitySystem = entitySystem;
+
+    // Remove tags of destroyed entities.
+    m_entityDestroy.Bind<EntityTags, &EntityTags::OnEntityDestroy>(this);
+    m_entityDestroy.Subscribe(entitySystem->events.destroy);
+
+    // Success!
+    return m_initialized = true;
+}
+
+bool EntityTags::AddTag(const EntityHandle& entity, int tag)
+{
+    Assert(tag >= 0 && tag < MaximumCount, "Invalid tag identifier!");
+
+    if(!m_initialized)
+        return false;
+
+    if(!m_entitySystem->IsHandleValid(entity))
+        return false;
+
+    // Make sure there are entries for the entity.
+    int index = entity.GetIdentifier() - 1;
+
+    if(index >= (int)m_entities.size())
+    {
+        m_entities.resize(index + 1);
+        m_masks.resize(index + 1, 0);
+    }
+
+    // Claim the entry for this version of the entity.
+    if(m_entities[index] != entity)
+    {
+        Assert(m_masks[index] == 0, "Reusing a tag entry that has not been cleared!");
+        m_entities[index] = entity;
+    }
+
+    // Grow the bit array of the tag in whole blocks.
+    BitList& bits = m_bits[tag];
+    std::size_t word = index / 64;
+
+    if(word >= bits.size())
+    {
+        bits.resize((word / BlockWords + 1) * BlockWords, 0);
+    }
+
+    // Set the tag bit.
+    bits[word] |= (std::uint64_t)1 << (index % 64);
+    m_masks[index] |= (TagMask)1 << tag;
+
+    return true;
+}
+
+bool EntityTags::RemoveTag(const EntityHandle& entity, int tag)
+{
+    Assert(tag >= 0 && tag < MaximumCount, "Invalid tag identifier!");
+
+    int index = this->FindEntity(entity);
+
+    if(index == InvalidEntity || !(m_masks[index] & ((TagMask)1 << tag)))
+        return false;
+
+    // Clear the tag bit.
+    m_bits[tag][index / 64] &= ~((std::uint64_t)1 << (index % 64));
+    m_masks[index] &= ~((TagMask)1 << tag);
+
+    return true;
+}
+
+bool EntityTags::HasTag(const EntityHandle& entity, int tag) const
+{
+    Assert(tag >= 0 && tag < MaximumCount, "Invalid tag identifier!");
+
+    return (this->GetTags(entity) & ((TagMask)1 << tag)) != 0;
+}
+
+EntityTags::TagMask EntityTags::GetTags(const EntityHandle& entity) const
+{
+    int index = this->FindEntity(entity);
+
+    if(index == InvalidEntity)
+        return 0;
+
+    return m_masks[index];
+}
+
+void EntityTags::ClearTags(const EntityHandle& entity)
+{
+    int index = this->FindEntity(entity);
+
+    if(index == InvalidEntity)
+        return;
+
+    // Clear bits of tags the entity has.
+    TagMask mask = m_masks[index];
+
+    while(mask != 0)
+    {
+        int tag = Utility::CountTrailingZeros(mask);
+        mask &= mask - 1;
+
+        m_bits[tag][index / 64] &= ~((std::uint64_t)1 << (index % 64));
+    }
+
+    m_masks[index] = 0;
+    m_entities[index] = EntityHandle();
+}
+
+int EntityTags::Count(TagMask include, TagMask exclude)
+{
+    int wordCount = this->FilterBlocks(include, exclude);
+    int count = 0;
+
+    for(int word = 0; word < wordCount; ++word)
+    {
+        for(std::uint64_t bits = m_filtered[word]; bits != 0; bits &= bits - 1)
+        {
+            count += 1;
+        }
+    }
+
+    return count;
+}
+
+int EntityTags::FindEntity(const EntityHandle& entity) const
+{
+    int index = entity.GetIdentifier() - 1;
+
+    if(index < 0 || index >= (int)m_entities.size())
+        return InvalidEntity;
+
+    if(m_entities[index] != entity)
+        return InvalidEntity;
+
+    return index;
+}
+
+int EntityTags::FilterBlocks(TagMask include, TagMask exclude)
+{
+    Assert(include != 0, "Filtering tags requires at least one included tag!");
+
+    // Tags that are both included and excluded can't match.
+    if(include & exclude)
+        return 0;
+
+    // Gather bit arrays of included tags.
+    // Only blocks present in all of them can have any bits set.
+    const std::uint64_t* included[MaximumCount];
+    int includedCount = 0;
+    std::size_t wordCount = std::numeric_limits<std::size_t>::max();
+
+    for(TagMask mask = include; mask != 0; mask &= mask - 1)
+    {
+        const BitList& bits = m_bits[Utility::CountTrailingZeros(mask)];
+
+        wordCount = std::min(wordCount, bits.size());
+        included[includedCount++] = bits.data();
+    }
+
+    if(includedCount == 0 || wordCount == 0)
+        return 0;
+
+    // Gather bit arrays of excluded tags.
+    const std::uint64_t* excluded[MaximumCount];
+    std::size_t excludedSizes[MaximumCount];
+    int excludedCount = 0;
+
+    for(TagMask mask = exclude; mask != 0; mask &= mask - 1)
+    {
+        const BitList& bits = m_bits[Utility::CountTrailingZeros(mask)];
+
+        if(bits.empty())
+            continue;
+
+        excluded[excludedCount] = bits.data();
+        excludedSizes[excludedCount] = bits.size();
+        excludedCount += 1;
+    }
+
+    // Combine bits block by block.
+    m_filtered.resize(wordCount);
+
+    for(std::size_t word = 0; word < wordCount; word += BlockWords)
+    {
+        FilterBlock(word, included, includedCount, excluded, excludedSizes, excludedCount, m_filtered.data());
+    }
+
+    return (int)wordCount;
+}
+
+int EntityTags::Register()
+{
+    int identifier = registeredCount.fetch_add(1);
+
+    // Check if we reached the limit.
+    Verify(identifier < MaximumCount, "Reached the maximum number of tag types!");
+
+    return identifier;
+}
+
+void EntityTags::OnEntityDestroy(EntitySystem::Events::Destroy event)
+{
+    this->ClearTags(event.handle);
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "EntityHandle.hpp"
+#include "EntitySystem.hpp"
+
+//
+// Entity Tags
+//
+//  Stores marker components without any data as bits. Each tag type has a
+//  bit array indexed by entity handle identifiers, split into blocks of 256
+//  entities. Queries combine whole blocks of included and excluded tags with
+//  wide AND and AND NOT operations and only visit the bits that remain set.
+//  Each entity also keeps a mask of its tags for constant time lookups.
+//  Tags of destroyed entities are removed automatically.
+//
+//  Example usage:
+//      struct Enemy {};
+//      struct Dead {};
+//
+//      Game::EntityTags tags;
+//      tags.Initialize(&entitySystem);
+//
+//      tags.Add<Enemy>(entity);
+//
+//      tags.ForEach(Game::EntityTags::GetMask<Enemy>(), Game::EntityTags::GetMask<Dead>(), [](const EntityHandle& entity)
+//      {
+//          /* Enemies that are not dead. */
+//      });
+//
+
+namespace Game
+{
+    // Entity tags class.
+    class EntityTags : private NonCopyable
+    {
+    public:
+        // Type declarations.
+        typedef std::uint64_t TagMask;
+
+        // Maximum number of registered tag types.
+        static const int MaximumCount = 64;
+
+        // Number of entities in a single block of bits.
+        static const int BlockSize = 256;
+
+    public:
+        EntityTags();
+        ~EntityTags();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the tag storage.
+        bool Initialize(EntitySystem* entitySystem);
+
+        // Adds a tag to an entity.
+        // Returns false if the entity handle is not valid.
+        template<typename Type>
+        bool Add(const EntityHandle& entity);
+
+        bool AddTag(const EntityHandle& entity, int tag);
+
+        // Removes a tag from an entity.
+        template<typename Type>
+        bool Remove(const EntityHandle& entity);
+
+        bool RemoveTag(const EntityHandle& entity, int tag);
+
+        // Checks if an entity has a tag.
+        template<typename Type>
+        bool Has(const EntityHandle& entity) const;
+
+        bool HasTag(const EntityHandle& entity, int tag) const;
+
+        // Gets the mask of all tags of an entity.
+        TagMask GetTags(const EntityHandle& entity) const;
+
+        // Removes all tags from an entity.
+        void ClearTags(const EntityHandle& entity);
+
+        // Calls a function for each entity that has all included and none of the excluded tags.
+        // At least one tag must be included. Tags can be changed while iterating.
+        template<typename Function>
+        void ForEach(TagMask include, TagMask exclude, Function function);
+
+        // Counts entities that have all included and none of the excluded tags.
+        int Count(TagMask include, TagMask exclude);
+
+        // Gets the identifier of a tag type.
+        template<typename Type>
+        static int GetIdentifier();
+
+        // Gets the mask of one or more tag types.
+        template<typename... Types>
+        static TagMask GetMask();
+
+    private:
+        // Type declarations.
+        typedef std::vector<EntityHandle> EntityList;
+        typedef std::vector<TagMask> MaskList;
+        typedef std::vector<std::uint64_t> BitList;
+
+        // Number of 64bit words in a block.
+        static const int BlockWords = BlockSize / 64;
+
+    private:
+        // Gets the index of an entity or -1 if it has no tags.
+        int FindEntity(const EntityHandle& entity) const;
+
+        // Combines bits of tags into the filtered bit list.
+        // Returns the number of filtered words.
+        int FilterBlocks(TagMask include, TagMask exclude);
+
+        // Registers a new tag type.
+        static int Register();
+
+        // Called when an entity is destroyed.
+        void OnEntityDestroy(EntitySystem::Events::Destroy event);
+
+    private:
+        // Entity system that owns the entities.
+        EntitySystem* m_entitySystem;
+
+        // Handles and tag masks indexed by entity handle identifiers.
+        EntityList m_entities;
+        MaskList m_masks;
+
+        // Bit arrays of each tag type, grown in whole blocks.
+        BitList m_bits[MaximumCount];
+
+        // Result of the last filtering.
+        BitList m_filtered;
+
+        // Entity system event receiver.
+        Receiver<void(EntitySystem::Events::Destroy)> m_entityDestroy;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
+
+// Template implementations.
+namespace Game
+{
+    template<typename Type>
+    bool EntityTags::Add(const EntityHandle& entity)
+    {
+        return this->AddTag(entity, GetIdentifier<Type>());
+    }
+
+    template<typename Type>
+    bool EntityTags::Remove(const EntityHandle& entity)
+    {
+        return this->RemoveTag(entity, GetIdentifier<Type>());
+    }
+
+    template<typename Type>
+    bool EntityTags::Has(const EntityHandle& entity) const
+    {
+        return this->HasTag(entity, GetIdentifier<Type>());
+    }
+
+    template<typename Function>
+    void EntityTags::ForEach(TagMask include, TagMask exclude, Function function)
+    {
+        int wordCount = this->FilterBlocks(include, exclude);
+
+        // Visit set bits of the filtered words.
+        for(int word = 0; word < wordCount; ++word)
+        {
+            std::uint64_t bits = m_filtered[word];
+
+            while(bits != 0)
+            {
+                int index = word * 64 + Utility::CountTrailingZeros(bits);
+                bits &= bits - 1;
+
+                function(m_entities[index]);
+            }
+        }
+    }
+
+    template<typename Type>
+    int EntityTags::GetIdentifier()
+    {
+        static_assert(std::is_empty<Type>::value, "Tag types must be empty!");
+
+        // Register the type once on the first use.
+        static const int identifier = Register();
+        return identifier;
+    }
+
+    template<typename... Types>
+    EntityTags::TagMask EntityTags::GetMask()
+    {
+        TagMask masks[] = { 0, (TagMask)1 << GetIdentifier<Types>()... };
+        TagMask mask = 0;
+
+        for(TagMask element : masks)
+        {
+            mask |= element;
+        }
+
+        return mask;
+    }
+}
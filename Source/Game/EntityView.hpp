@@ -0,0 +1,263 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "EntityHandle.hpp"
+#include "ComponentPool.hpp"
+
+//
+// Entity View
+//
+//  Iterates over entities that have components in all of the given pools.
+//  The smallest pool drives the iteration and the remaining pools are
+//  probed for each of its entities until the first missing component, so
+//  the cost depends on the size of the smallest pool only. A view of a
+//  single pool walks its dense arrays. Components must not be added to or
+//  removed from the viewed pools while iterating.
+//
+//  Example usage:
+//      Game::EntityView<Transform, Velocity> view(transforms, velocities);
+//
+//      view.ForEach([](const EntityHandle& entity, Transform& transform, Velocity& velocity)
+//      {
+//          transform.position += velocity.direction;
+//      });
+//
+//  Iterating from multiple threads:
+//      view.ParallelForEach(jobSystem, 1024, [](const EntityHandle& entity, Transform& transform, Velocity& velocity)
+//      {
+//          /* ... */
+//      });
+//
+
+namespace Game
+{
+    namespace Detail
+    {
+        // Holds a pool of a single component type.
+        template<typename Type>
+        struct EntityViewPool
+        {
+            EntityViewPool(ComponentPool<Type>& instance) :
+                pool(&instance)
+            {
+            }
+
+            ComponentPool<Type>* pool;
+        };
+
+        // Lists component types that remain to be probed.
+        template<typename... Types>
+        struct EntityViewTypes
+        {
+        };
+    }
+
+    // Entity view class.
+    template<typename... Types>
+    class EntityView : private Detail::EntityViewPool<Types>...
+    {
+    public:
+        EntityView(ComponentPool<Types>&... pools);
+
+        // Calls a function for each entity that has all components.
+        template<typename Function>
+        void ForEach(Function function);
+
+        // Calls a function for each entity that has all components from multiple threads.
+        // Function must be safe to call for different entities at the same time.
+        template<typename Function>
+        void ParallelForEach(JobSystem& jobSystem, int grainSize, Function function);
+
+        // Gets the number of entities in the smallest pool.
+        // Upper bound of the number of iterated entities.
+        int GetSizeHint() const;
+
+    private:
+        // Gets the pool of a component type.
+        template<typename Type>
+        ComponentPool<Type>& GetPool() const;
+
+        // Selects the smallest pool as the one that drives the iteration.
+        template<typename Type>
+        void SelectDriver(const EntityHandle*& entities, int& count) const;
+
+        // Gathers components of an entity pool by pool and invokes a function
+        // if all were found. Components of the driving pool are taken by index.
+        template<typename Function, typename Type, typename... Remaining, typename... Pointers>
+        void Invoke(Detail::EntityViewTypes<Type, Remaining...>, Function& function, const EntityHandle* entities, int index, Pointers... components) const;
+
+        template<typename Function, typename... Pointers>
+        void Invoke(Detail::EntityViewTypes<>, Function& function, const EntityHandle* entities, int index, Pointers... components) const;
+    };
+
+    // Entity view specialization for a single component type.
+    template<typename Type>
+    class EntityView<Type>
+    {
+    public:
+        EntityView(ComponentPool<Type>& pool);
+
+        // Calls a function for each entity that has a component.
+        template<typename Function>
+        void ForEach(Function function);
+
+        // Calls a function for each entity that has a component from multiple threads.
+        // Function must be safe to call for different entities at the same time.
+        template<typename Function>
+        void ParallelForEach(JobSystem& jobSystem, int grainSize, Function function);
+
+        // Gets the number of entities.
+        int GetSizeHint() const;
+
+    private:
+        // Viewed component pool.
+        ComponentPool<Type>* m_pool;
+    };
+}
+
+// Template implementations.
+namespace Game
+{
+    template<typename... Types>
+    EntityView<Types...>::EntityView(ComponentPool<Types>&... pools) :
+        Detail::EntityViewPool<Types>(pools)...
+    {
+    }
+
+    template<typename... Types>
+    template<typename Function>
+    void EntityView<Types...>::ForEach(Function function)
+    {
+        // Find the smallest pool.
+        const EntityHandle* entities = nullptr;
+        int count = std::numeric_limits<int>::max();
+
+        int selection[] = { (this->template SelectDriver<Types>(entities, count), 0)... };
+        (void)selection;
+
+        // Probe other pools for each entity of the smallest one.
+        for(int i = 0; i < count; ++i)
+        {
+            this->Invoke(Detail::EntityViewTypes<Types...>(), function, entities, i);
+        }
+    }
+
+    template<typename... Types>
+    template<typename Function>
+    void EntityView<Types...>::ParallelForEach(JobSystem& jobSystem, int grainSize, Function function)
+    {
+        // Find the smallest pool.
+        const EntityHandle* entities = nullptr;
+        int count = std::numeric_limits<int>::max();
+
+        int selection[] = { (this->template SelectDriver<Types>(entities, count), 0)... };
+        (void)selection;
+
+        // Split the range of the smallest pool between threads.
+        jobSystem.ParallelFor(count, grainSize, [&](int begin, int end)
+        {
+            for(int i = begin; i < end; ++i)
+            {
+                this->Invoke(Detail::EntityViewTypes<Types...>(), function, entities, i);
+            }
+        });
+    }
+
+    template<typename... Types>
+    int EntityView<Types...>::GetSizeHint() const
+    {
+        const EntityHandle* entities = nullptr;
+        int count = std::numeric_limits<int>::max();
+
+        int selection[] = { (this->template SelectDriver<Types>(entities, count), 0)... };
+        (void)selection;
+
+        return count;
+    }
+
+    template<typename... Types>
+    template<typename Type>
+    ComponentPool<Type>& EntityView<Types...>::GetPool() const
+    {
+        return *static_cast<const Detail::EntityViewPool<Type>*>(this)->pool;
+    }
+
+    template<typename... Types>
+    template<typename Type>
+    void EntityView<Types...>::SelectDriver(const EntityHandle*& entities, int& count) const
+    {
+        ComponentPool<Type>& pool = this->template GetPool<Type>();
+
+        if(pool.GetSize() < count)
+        {
+            entities = pool.GetEntities();
+            count = pool.GetSize();
+        }
+    }
+
+    template<typename... Types>
+    template<typename Function, typename Type, typename... Remaining, typename... Pointers>
+    void EntityView<Types...>::Invoke(Detail::EntityViewTypes<Type, Remaining...>, Function& function, const EntityHandle* entities, int index, Pointers... components) const
+    {
+        ComponentPool<Type>& pool = this->template GetPool<Type>();
+
+        // Driving pool holds the entity at the iterated index.
+        Type* component = nullptr;
+
+        if(pool.GetEntities() == entities)
+        {
+            component = pool.GetComponents() + index;
+        }
+        else
+        {
+            // Skip the entity at the first missing component.
+            component = pool.Get(entities[index]);
+
+            if(component == nullptr)
+                return;
+        }
+
+        this->Invoke(Detail::EntityViewTypes<Remaining...>(), function, entities, index, components..., component);
+    }
+
+    template<typename... Types>
+    template<typename Function, typename... Pointers>
+    void EntityView<Types...>::Invoke(Detail::EntityViewTypes<>, Function& function, const EntityHandle* entities, int index, Pointers... components) const
+    {
+        function(entities[index], *components...);
+    }
+
+    template<typename Type>
+    EntityView<Type>::EntityView(ComponentPool<Type>& pool) :
+        m_pool(&pool)
+    {
+    }
+
+    template<typename Type>
+    template<typename Function>
+    void EntityView<Type>::ForEach(Function function)
+    {
+        // Walk the dense arrays directly.
+        const EntityHandle* entities = m_pool->GetEntities();
+        Type* components = m_pool->GetComponents();
+        int count = m_pool->GetSize();
+
+        for(int i = 0; i < count; ++i)
+        {
+            function(entities[i], components[i]);
+        }
+    }
+
+    template<typename Type>
+    template<typename Function>
+    void EntityView<Type>::ParallelForEach(JobSystem& jobSystem, int grainSize, Function function)
+    {
+        m_pool->ParallelForEach(jobSystem, grainSize, function);
+    }
+
+    template<typename Type>
+    int EntityView<Type>::GetSizeHint() const
+    {
+        return m_pool->GetSize();
+    }
+}
@@ -0,0 +1,422 @@
+#include "Precompiled.hpp"
+#include "FlowFieldNavigation.hpp"
+using namespace Game;
+
+// Select the instruction set for sampling.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define FLOW_FIELD_SSE2
+#endif
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize the flow field navigation! "
+
+    // Constant variables.
+    const float Infinity = std::numeric_limits<float>::infinity();
+    const float DiagonalLength = 1.41421356f;
+
+    // Offsets of neighbors, with orthogonal ones first.
+    const int NeighborCount = 8;
+    const int NeighborOffsetsX[NeighborCount] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+    const int NeighborOffsetsY[NeighborCount] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+}
+
+FlowFieldNavigationInfo::FlowFieldNavigationInfo() :
+    width(0),
+    height(0),
+    cellSize(1.0f),
+    origin(0.0f, 0.0f),
+    cacheSize(16)
+{
+}
+
+FlowFieldNavigation::Field::Field() :
+    goal(-1),
+    lastUse(0)
+{
+}
+
+FlowFieldNavigation::FlowFieldNavigation() :
+    m_requestCounter(0),
+    m_computeCount(0),
+    m_initialized(false)
+{
+}
+
+FlowFieldNavigation::~FlowFieldNavigation()
+{
+    this->Cleanup();
+}
+
+void FlowFieldNavigation::Cleanup()
+{
+    Utility::ClearContainer(m_costs);
+    Utility::ClearContainer(m_fields);
+    Utility::ClearContainer(m_pendingFields);
+
+    m_requestCounter = 0;
+    m_computeCount = 0;
+
+    // Reset initialization parameters.
+    m_info = FlowFieldNavigationInfo();
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool FlowFieldNavigation::Initialize(const FlowFieldNavigationInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.width <= 0 || info.height <= 0 || (std::int64_t)info.width * info.height > (1 << 24))
+    {
+        LogError() << LogInitializeError() << "Invalid grid size.";
+        return false;
+    }
+
+    if(!(info.cellSize > 0.0f))
+    {
+        LogError() << LogInitializeError() << "Invalid cell size.";
+        return false;
+    }
+
+    if(info.cacheSize <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid cache size.";
+        return false;
+    }
+
+    m_info = info;
+
+    // Allocate cells and cache slots.
+    m_costs.resize(info.width * info.height, 1);
+    m_fields.resize(info.cacheSize);
+
+    // Success!
+    return m_initialized = true;
+}
+
+void FlowFieldNavigation::SetCost(int x, int y, std::uint8_t cost)
+{
+    Assert(m_initialized, "Flow field navigation is not initialized!");
+    Assert(x >= 0 && x < m_info.width && y >= 0 && y < m_info.height, "Invalid cell coordinates!");
+
+    std::uint8_t& current = m_costs[y * m_info.width + x];
+
+    if(current == cost)
+        return;
+
+    current = cost;
+
+    // Cached fields no longer match costs.
+    for(Field& field : m_fields)
+    {
+        field.goal = -1;
+    }
+}
+
+std::uint8_t FlowFieldNavigation::GetCost(int x, int y) const
+{
+    Assert(m_initialized, "Flow field navigation is not initialized!");
+    Assert(x >= 0 && x < m_info.width && y >= 0 && y < m_info.height, "Invalid cell coordinates!");
+
+    return m_costs[y * m_info.width + x];
+}
+
+int FlowFieldNavigation::RequestField(const glm::vec2& goal, JobSystem* jobSystem)
+{
+    int field = InvalidField;
+    this->RequestFields(&goal, &field, 1, jobSystem);
+
+    return field;
+}
+
+void FlowFieldNavigation::RequestFields(const glm::vec2* goals, int* fields, int count, JobSystem* jobSystem)
+{
+    if(!m_initialized)
+    {
+        std::fill(fields, fields + count, (int)InvalidField);
+        return;
+    }
+
+    // Fields used by this request are never evicted by it.
+    m_requestCounter += 1;
+    m_pendingFields.clear();
+
+    for(int i = 0; i < count; ++i)
+    {
+        glm::ivec2 cell = this->CalculateCell(goals[i]);
+        int goal = cell.y * m_info.width + cell.x;
+
+        // Find a cached field or the least recently used slot.
+        int slot = InvalidField;
+        int evicted = InvalidField;
+
+        for(int j = 0; j < (int)m_fields.size(); ++j)
+        {
+            const Field& field = m_fields[j];
+
+            if(field.goal == goal)
+            {
+                slot = j;
+                break;
+            }
+
+            if(field.lastUse < m_requestCounter && (evicted == InvalidField || field.lastUse < m_fields[evicted].lastUse))
+            {
+                evicted = j;
+            }
+        }
+
+        if(slot == InvalidField)
+        {
+            Assert(evicted != InvalidField, "Too many distinct goals for the cache size!");
+
+            if(evicted == InvalidField)
+            {
+                fields[i] = InvalidField;
+                continue;
+            }
+
+            slot = evicted;
+            m_fields[slot].goal = goal;
+            m_pendingFields.push_back(slot);
+        }
+
+        m_fields[slot].lastUse = m_requestCounter;
+        fields[i] = slot;
+    }
+
+    // Compute new fields independently.
+    auto compute = [this](int begin, int end)
+    {
+        for(int i = begin; i < end; ++i)
+        {
+            this->ComputeField(m_fields[m_pendingFields[i]]);
+        }
+    };
+
+    if(jobSystem != nullptr)
+    {
+        jobSystem->ParallelFor((int)m_pendingFields.size(), 1, compute);
+    }
+    else
+    {
+        compute(0, (int)m_pendingFields.size());
+    }
+
+    m_computeCount += (int)m_pendingFields.size();
+}
+
+void FlowFieldNavigation::SampleDirections(int field, BatchMath::Stream<const glm::vec3> positions,
+    BatchMath::Stream<glm::vec2> directions, std::size_t count) const
+{
+    Assert(field >= 0 && field < (int)m_fields.size(), "Invalid field index!");
+
+    const Field& state = m_fields[field];
+    Assert(state.goal != -1, "Sampling an evicted field!");
+
+    const float* directionsX = state.directionsX.data();
+    const float* directionsY = state.directionsY.data();
+
+    float scale = 1.0f / m_info.cellSize;
+    float maximumX = (float)(m_info.width - 1);
+    float maximumY = (float)(m_info.height - 1);
+
+    // Convert blocks of positions to cells and gather their directions.
+    BatchMath::Vec3x8 block;
+    int cellsX[BatchMath::Vec3x8::Width];
+    int cellsY[BatchMath::Vec3x8::Width];
+
+    for(std::size_t first = 0; first < count; first += BatchMath::Vec3x8::Width)
+    {
+        std::size_t remaining = count - first;
+        int blockCount = remaining < (std::size_t)BatchMath::Vec3x8::Width ? (int)remaining : (int)BatchMath::Vec3x8::Width;
+
+        block.Load(positions, first, blockCount);
+
+    #if defined(FLOW_FIELD_SSE2)
+        for(int i = 0; i < BatchMath::Vec3x8::Width; i += 4)
+        {
+            // Clamping before truncation also turns NaNs into the first cell.
+            __m128 x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(block.x + i), _mm_set1_ps(m_info.origin.x)), _mm_set1_ps(scale));
+            __m128 y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(block.y + i), _mm_set1_ps(m_info.origin.y)), _mm_set1_ps(scale));
+
+            x = _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps(maximumX));
+            y = _mm_min_ps(_mm_max_ps(y, _mm_setzero_ps()), _mm_set1_ps(maximumY));
+
+            _mm_storeu_si128((__m128i*)(cellsX + i), _mm_cvttps_epi32(x));
+            _mm_storeu_si128((__m128i*)(cellsY + i), _mm_cvttps_epi32(y));
+        }
+    #else
+        for(int i = 0; i < BatchMath::Vec3x8::Width; ++i)
+        {
+            glm::ivec2 cell = this->CalculateCell(glm::vec2(block.x[i], block.y[i]));
+
+            cellsX[i] = cell.x;
+            cellsY[i] = cell.y;
+        }
+    #endif
+
+        for(int i = 0; i < blockCount; ++i)
+        {
+            int index = cellsY[i] * m_info.width + cellsX[i];
+            directions[first + i] = glm::vec2(directionsX[index], directionsY[index]);
+        }
+    }
+}
+
+float FlowFieldNavigation::GetRemainingCost(int field, const glm::vec2& position) const
+{
+    Assert(field >= 0 && field < (int)m_fields.size(), "Invalid field index!");
+
+    const Field& state = m_fields[field];
+    Assert(state.goal != -1, "Sampling an evicted field!");
+
+    glm::ivec2 cell = this->CalculateCell(position);
+    return state.costs[cell.y * m_info.width + cell.x];
+}
+
+glm::ivec2 FlowFieldNavigation::CalculateCell(const glm::vec2& position) const
+{
+    glm::vec2 cell = (position - m_info.origin) / m_info.cellSize;
+
+    cell.x = std::min(std::max(cell.x, 0.0f), (float)(m_info.width - 1));
+    cell.y = std::min(std::max(cell.y, 0.0f), (float)(m_info.height - 1));
+
+    return glm::ivec2((int)cell.x, (int)cell.y);
+}
+
+int FlowFieldNavigation::GetComputeCount() const
+{
+    return m_computeCount;
+}
+
+bool FlowFieldNavigation::IsInitialized() const
+{
+    return m_initialized;
+}
+
+void FlowFieldNavigation::ComputeField(Field& field) const
+{
+    int width = m_info.width;
+    int height = m_info.height;
+    int cellCount = width * height;
+
+    field.costs.assign(cellCount, Infinity);
+    field.directionsX.assign(cellCount, 0.0f);
+    field.directionsY.assign(cellCount, 0.0f);
+
+    // Checks if a move between cells is allowed.
+    // Diagonal moves must not cut corners of blocked cells.
+    auto canMove = [this, width](int x, int y, int offsetX, int offsetY) -> bool
+    {
+        if(m_costs[(y + offsetY) * width + x + offsetX] == BlockedCost)
+            return false;
+
+        if(offsetX != 0 && offsetY != 0)
+        {
+            if(m_costs[y * width + x + offsetX] == BlockedCost || m_costs[(y + offsetY) * width + x] == BlockedCost)
+                return false;
+        }
+
+        return true;
+    };
+
+    if(m_costs[field.goal] == BlockedCost)
+        return;
+
+    // Propagate remaining costs outwards from the goal.
+    // Reaching a neighbor costs entering the current cell on the way back.
+    typedef std::pair<float, int> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+    field.costs[field.goal] = 0.0f;
+    queue.push(QueueEntry(0.0f, field.goal));
+
+    while(!queue.empty())
+    {
+        QueueEntry entry = queue.top();
+        queue.pop();
+
+        int index = entry.second;
+
+        if(entry.first > field.costs[index])
+            continue;
+
+        int x = index % width;
+        int y = index / width;
+
+        float enterCost = (float)m_costs[index];
+
+        for(int i = 0; i < NeighborCount; ++i)
+        {
+            int neighborX = x + NeighborOffsetsX[i];
+            int neighborY = y + NeighborOffsetsY[i];
+
+            if(neighborX < 0 || neighborX >= width || neighborY < 0 || neighborY >= height)
+                continue;
+
+            if(!canMove(x, y, NeighborOffsetsX[i], NeighborOffsetsY[i]))
+                continue;
+
+            int neighbor = neighborY * width + neighborX;
+            float length = i < 4 ? 1.0f : DiagonalLength;
+            float cost = entry.first + enterCost * length;
+
+            if(cost < field.costs[neighbor])
+            {
+                field.costs[neighbor] = cost;
+                queue.push(QueueEntry(cost, neighbor));
+            }
+        }
+    }
+
+    // Point every reachable cell at its neighbor closest to the goal.
+    for(int y = 0; y < height; ++y)
+    {
+        for(int x = 0; x < width; ++x)
+        {
+            int index = y * width + x;
+
+            if(index == field.goal || field.costs[index] == Infinity)
+                continue;
+
+            float lowestCost = field.costs[index];
+            int lowestNeighbor = -1;
+
+            for(int i = 0; i < NeighborCount; ++i)
+            {
+                int neighborX = x + NeighborOffsetsX[i];
+                int neighborY = y + NeighborOffsetsY[i];
+
+                if(neighborX < 0 || neighborX >= width || neighborY < 0 || neighborY >= height)
+                    continue;
+
+                if(!canMove(x, y, NeighborOffsetsX[i], NeighborOffsetsY[i]))
+                    continue;
+
+                float cost = field.costs[neighborY * width + neighborX];
+
+                if(cost < lowestCost)
+                {
+                    lowestCost = cost;
+                    lowestNeighbor = i;
+                }
+            }
+
+            if(lowestNeighbor != -1)
+            {
+                glm::vec2 direction((float)NeighborOffsetsX[lowestNeighbor], (float)NeighborOffsetsY[lowestNeighbor]);
+                direction = glm::normalize(direction);
+
+                field.directionsX[index] = direction.x;
+                field.directionsY[index] = direction.y;
+            }
+        }
+    }
+}
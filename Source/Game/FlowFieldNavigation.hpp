@@ -0,0 +1,166 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/BatchMath.hpp"
+#include "Common/JobSystem.hpp"
+
+//
+// Flow Field Navigation
+//
+//  Steers large numbers of units towards shared goals over a grid of
+//  traversal costs. Instead of searching a path for every unit, a flow field
+//  is computed once per goal, holding the remaining cost to the goal for
+//  every cell and the direction towards the neighbor closest to the goal.
+//  Units then only sample the direction of the cell they stand in.
+//
+//  Fields of recently used goals are cached, and the least recently used
+//  field is evicted when a new goal needs a slot. Missing fields of several
+//  goals are computed in parallel on a job system. Changing costs of cells
+//  invalidates all cached fields.
+//
+//  Grid covers the XY plane, matching positions of transforms. Sampling
+//  converts positions of many units to cells with SIMD instructions, so it
+//  can be run over dense arrays of components directly.
+//
+//  Example usage:
+//      Game::FlowFieldNavigationInfo info;
+//      info.width = 256;
+//      info.height = 256;
+//      info.cellSize = 2.0f;
+//
+//      Game::FlowFieldNavigation navigation;
+//      navigation.Initialize(info);
+//      navigation.SetCost(10, 12, Game::FlowFieldNavigation::BlockedCost);
+//
+//      int field = navigation.RequestField(goalPosition, &jobSystem);
+//
+//      navigation.SampleDirections(field,
+//          BatchMath::MakeStream(transforms, &Transform::position),
+//          BatchMath::MakeStream(steering, &Steering::direction), count);
+//
+
+namespace Game
+{
+    // Flow field navigation initialization struct.
+    struct FlowFieldNavigationInfo
+    {
+        // Number of cells along each axis.
+        int width;
+        int height;
+
+        // Size of a cell in world units.
+        float cellSize;
+
+        // World position of the corner of the first cell.
+        glm::vec2 origin;
+
+        // Number of cached fields.
+        int cacheSize;
+
+        FlowFieldNavigationInfo();
+    };
+
+    // Flow field navigation class.
+    class FlowFieldNavigation : private NonCopyable
+    {
+    public:
+        // Constant variables.
+        static const std::uint8_t BlockedCost = 255;
+        static const int InvalidField = -1;
+
+    public:
+        FlowFieldNavigation();
+        ~FlowFieldNavigation();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the flow field navigation.
+        // All cells start with a cost of one.
+        bool Initialize(const FlowFieldNavigationInfo& info);
+
+        // Sets the cost of entering a cell.
+        // Blocked cells are never entered. Invalidates cached fields.
+        void SetCost(int x, int y, std::uint8_t cost);
+
+        // Gets the cost of entering a cell.
+        std::uint8_t GetCost(int x, int y) const;
+
+        // Gets a field towards a goal, computing it if it is not cached.
+        // Field indices remain valid until fields are evicted by later requests.
+        int RequestField(const glm::vec2& goal, JobSystem* jobSystem = nullptr);
+
+        // Gets fields towards a number of goals, computing missing ones in parallel.
+        // Number of distinct goals must not exceed the cache size.
+        void RequestFields(const glm::vec2* goals, int* fields, int count, JobSystem* jobSystem = nullptr);
+
+        // Samples directions towards the goal of a field at a number of positions.
+        // Directions are zero at the goal and where it cannot be reached.
+        void SampleDirections(int field, BatchMath::Stream<const glm::vec3> positions,
+            BatchMath::Stream<glm::vec2> directions, std::size_t count) const;
+
+        // Gets the remaining cost to the goal of a field from a position.
+        // Returns infinity if the goal cannot be reached.
+        float GetRemainingCost(int field, const glm::vec2& position) const;
+
+        // Calculates the cell that contains a position, clamped to the grid.
+        glm::ivec2 CalculateCell(const glm::vec2& position) const;
+
+        // Gets the number of fields computed since initialization.
+        int GetComputeCount() const;
+
+        // Checks if the instance is initialized.
+        bool IsInitialized() const;
+
+    private:
+        // Cached field.
+        struct Field
+        {
+            Field();
+
+            // Goal cell index or -1 if the slot is empty.
+            int goal;
+
+            // Request counter value at the last use.
+            std::uint64_t lastUse;
+
+            // Remaining costs to the goal of cells.
+            std::vector<float> costs;
+
+            // Directions of cells in separate component arrays.
+            std::vector<float> directionsX;
+            std::vector<float> directionsY;
+        };
+
+        // Type declarations.
+        typedef std::vector<Field> FieldList;
+        typedef std::vector<std::uint8_t> CostList;
+        typedef std::vector<int> IndexList;
+
+    private:
+        // Computes remaining costs and directions of a field.
+        void ComputeField(Field& field) const;
+
+    private:
+        // Initialization parameters.
+        FlowFieldNavigationInfo m_info;
+
+        // Costs of entering cells.
+        CostList m_costs;
+
+        // Cached fields.
+        FieldList m_fields;
+
+        // Fields that need to be computed in the current request.
+        IndexList m_pendingFields;
+
+        // Request counter for finding least recently used fields.
+        std::uint64_t m_requestCounter;
+
+        // Number of computed fields.
+        int m_computeCount;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,169 @@
+#include "Precompiled.hpp"
+#include "GameLoop.hpp"
+using namespace Game;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize the game loop! "
+}
+
+GameLoopInfo::GameLoopInfo() :
+    tickRate(60),
+    maximumSubsteps(5),
+    maximumFrameTime(0.25)
+{
+}
+
+GameLoop::GameLoop() :
+    m_tickTime(0.0),
+    m_frameTime(0.0),
+    m_accumulator(0.0),
+    m_tickIndex(0),
+    m_frameTicks(0),
+    m_initialized(false)
+{
+}
+
+GameLoop::~GameLoop()
+{
+    this->Cleanup();
+}
+
+void GameLoop::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Reset the loop state.
+    m_tickTime = 0.0;
+    m_frameTime = 0.0;
+    m_accumulator = 0.0;
+    m_tickIndex = 0;
+    m_frameTicks = 0;
+
+    // Reset initialization parameters.
+    m_info = GameLoopInfo();
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool GameLoop::Initialize(const GameLoopInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.tickRate <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid tick rate.";
+        return false;
+    }
+
+    if(info.maximumSubsteps <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid maximum substeps.";
+        return false;
+    }
+
+    if(!(info.maximumFrameTime > 0.0))
+    {
+        LogError() << LogInitializeError() << "Invalid maximum frame time.";
+        return false;
+    }
+
+    m_info = info;
+
+    // Start measuring time.
+    m_tickTime = 1.0 / info.tickRate;
+    m_timer.Reset();
+
+    // Success!
+    return m_initialized = true;
+}
+
+void GameLoop::BeginFrame()
+{
+    Assert(m_initialized, "Game loop is not initialized!");
+
+    // Measure the frame time.
+    this->BeginFrame(m_timer.Tick());
+}
+
+void GameLoop::BeginFrame(double frameTime)
+{
+    Assert(m_initialized, "Game loop is not initialized!");
+
+    // Accumulate the frame time.
+    m_frameTime = frameTime;
+    m_accumulator += std::min(frameTime, m_info.maximumFrameTime);
+
+    m_frameTicks = 0;
+}
+
+bool GameLoop::Tick()
+{
+    Assert(m_initialized, "Game loop is not initialized!");
+
+    // Check if a full tick is left.
+    if(m_accumulator < m_tickTime)
+        return false;
+
+    // Drop the time that can't be caught up with this frame.
+    if(m_frameTicks == m_info.maximumSubsteps)
+    {
+        m_accumulator = std::fmod(m_accumulator, m_tickTime);
+        return false;
+    }
+
+    // Consume the tick.
+    m_accumulator -= m_tickTime;
+
+    ++m_tickIndex;
+    ++m_frameTicks;
+
+    return true;
+}
+
+void GameLoop::Restore(std::uint64_t tickIndex, double accumulator)
+{
+    Assert(m_initialized, "Game loop is not initialized!");
+
+    m_tickIndex = tickIndex;
+    m_accumulator = accumulator;
+    m_frameTicks = 0;
+}
+
+double GameLoop::GetAccumulator() const
+{
+    return m_accumulator;
+}
+
+float GameLoop::GetAlpha() const
+{
+    if(!m_initialized)
+        return 0.0f;
+
+    return (float)std::min(m_accumulator / m_tickTime, 1.0);
+}
+
+double GameLoop::GetTickTime() const
+{
+    return m_tickTime;
+}
+
+double GameLoop::GetFrameTime() const
+{
+    return m_frameTime;
+}
+
+std::uint64_t GameLoop::GetTickIndex() const
+{
+    return m_tickIndex;
+}
+
+int GameLoop::GetFrameTicks() const
+{
+    return m_frameTicks;
+}
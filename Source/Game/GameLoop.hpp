@@ -0,0 +1,124 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "System/Timer.hpp"
+
+//
+// Game Loop
+//
+//  Advances the simulation in fixed time steps, independent of the frame rate.
+//  Each frame adds the measured frame time to an accumulator, which is then
+//  consumed in steps of the tick time. A frame runs at most a maximum number
+//  of ticks, so the simulation falls behind instead of spiraling when ticks
+//  take longer than real time. Time that couldn't be caught up with is dropped.
+//  Time left in the accumulator is exposed as an interpolation alpha, which
+//  rendering uses to blend between the previous and the current tick state.
+//
+//  Example usage:
+//      Game::GameLoopInfo info;
+//      info.tickRate = 60;
+//
+//      Game::GameLoop gameLoop;
+//      gameLoop.Initialize(info);
+//
+//      while(window.IsOpen())
+//      {
+//          gameLoop.BeginFrame();
+//
+//          while(gameLoop.Tick())
+//          {
+//              /* Simulate gameLoop.GetTickTime() seconds. */
+//          }
+//
+//          /* Render blended by gameLoop.GetAlpha(). */
+//      }
+//
+
+namespace Game
+{
+    // Game loop initialization struct.
+    struct GameLoopInfo
+    {
+        // Number of simulation ticks per second.
+        int tickRate;
+
+        // Maximum number of ticks run within a single frame.
+        int maximumSubsteps;
+
+        // Maximum frame time in seconds added to the accumulator.
+        // Limits the catch up after long stalls, such as breakpoints.
+        double maximumFrameTime;
+
+        GameLoopInfo();
+    };
+
+    // Game loop class.
+    class GameLoop : private NonCopyable
+    {
+    public:
+        GameLoop();
+        ~GameLoop();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the game loop.
+        bool Initialize(const GameLoopInfo& info = GameLoopInfo());
+
+        // Measures the frame time and adds it to the accumulator.
+        void BeginFrame();
+
+        // Adds a given frame time to the accumulator instead of measuring it.
+        // Used to replay recorded sessions deterministically.
+        void BeginFrame(double frameTime);
+
+        // Consumes a tick from the accumulator.
+        // Returns false once no full tick is left or the substep limit is reached.
+        bool Tick();
+
+        // Restores tick counters and time left in the accumulator.
+        // Used to resume recorded sessions from their keyframes.
+        void Restore(std::uint64_t tickIndex, double accumulator);
+
+        // Gets the time not yet consumed by ticks in seconds.
+        double GetAccumulator() const;
+
+        // Gets the fraction of a tick left in the accumulator, between zero and one.
+        float GetAlpha() const;
+
+        // Gets the duration of a tick in seconds.
+        double GetTickTime() const;
+
+        // Gets the measured duration of the last frame in seconds.
+        double GetFrameTime() const;
+
+        // Gets the number of ticks run since initialization.
+        std::uint64_t GetTickIndex() const;
+
+        // Gets the number of ticks run in the current frame.
+        int GetFrameTicks() const;
+
+    private:
+        // Initialization parameters.
+        GameLoopInfo m_info;
+
+        // Frame timer.
+        System::Timer m_timer;
+
+        // Duration of a tick in seconds.
+        double m_tickTime;
+
+        // Duration of the last frame in seconds.
+        double m_frameTime;
+
+        // Time not yet consumed by ticks.
+        double m_accumulator;
+
+        // Tick counters.
+        std::uint64_t m_tickIndex;
+        int m_frameTicks;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,78 @@
+#include "Precompiled.hpp"
+#include "GlobalEntityIds.hpp"
+using namespace Game;
+
+EntityIdAuthority::EntityIdAuthority() :
+    m_next(1)
+{
+}
+
+EntityIdBlock EntityIdAuthority::Reserve(std::uint64_t count)
+{
+    EntityIdBlock block;
+    block.first = m_next.fetch_add(count);
+    block.count = count;
+
+    return block;
+}
+
+std::uint64_t EntityIdAuthority::GetNext() const
+{
+    return m_next.load();
+}
+
+void EntityIdAuthority::SetNext(std::uint64_t next)
+{
+    std::uint64_t current = m_next.load();
+
+    // Never move back, which would reserve identifiers twice.
+    while(current < next && !m_next.compare_exchange_weak(current, next))
+    {
+    }
+}
+
+EntityIdPool::EntityIdPool() :
+    m_remaining(0)
+{
+}
+
+void EntityIdPool::Cleanup()
+{
+    Utility::ClearContainer(m_blocks);
+    m_remaining = 0;
+}
+
+void EntityIdPool::AddBlock(const EntityIdBlock& block)
+{
+    if(block.first == EntityIdAuthority::InvalidId || block.count == 0)
+        return;
+
+    m_blocks.push_back(block);
+    m_remaining += block.count;
+}
+
+std::uint64_t EntityIdPool::Allocate()
+{
+    if(m_blocks.empty())
+        return EntityIdAuthority::InvalidId;
+
+    // Take the next identifier of the first block.
+    EntityIdBlock& block = m_blocks.front();
+    std::uint64_t identifier = block.first;
+
+    block.first += 1;
+    block.count -= 1;
+    m_remaining -= 1;
+
+    if(block.count == 0)
+    {
+        m_blocks.pop_front();
+    }
+
+    return identifier;
+}
+
+std::uint64_t EntityIdPool::GetRemaining() const
+{
+    return m_remaining;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Global Entity Ids
+//
+//  Hands out identifiers that are unique across all nodes of a shard, so
+//  nodes can spawn entities that keep their identity when they are handed
+//  off between nodes. Entity handles can't serve this purpose, as they are
+//  only unique within the entity system of a single process.
+//
+//  A single authority, usually run by a coordinator, reserves consecutive
+//  blocks of identifiers. Each node keeps a pool of reserved blocks and
+//  allocates identifiers from it without any coordination, asking for
+//  another block ahead of time once the pool runs low. Zero is never
+//  reserved and marks an invalid identifier.
+//
+//  Example usage:
+//      // On the coordinator.
+//      Game::EntityIdAuthority authority;
+//      Game::EntityIdBlock block = authority.Reserve(4096);
+//
+//      // On a node, after receiving the block.
+//      Game::EntityIdPool pool;
+//      pool.AddBlock(block);
+//
+//      std::uint64_t globalId = pool.Allocate();
+//
+//      if(pool.GetRemaining() < 1024)
+//      {
+//          /* Request another block. */
+//      }
+//
+
+namespace Game
+{
+    // Block of consecutive global entity identifiers.
+    struct EntityIdBlock
+    {
+        std::uint64_t first;
+        std::uint64_t count;
+    };
+
+    // Global entity id authority class.
+    class EntityIdAuthority : private NonCopyable
+    {
+    public:
+        // Invalid global identifier.
+        static const std::uint64_t InvalidId = 0;
+
+    public:
+        EntityIdAuthority();
+
+        // Reserves a block of identifiers.
+        // Can be called from multiple threads.
+        EntityIdBlock Reserve(std::uint64_t count);
+
+        // Gets the first identifier that has not been reserved yet.
+        // Saved by the coordinator, so blocks are not reserved again after a restart.
+        std::uint64_t GetNext() const;
+
+        // Sets the first identifier that can be reserved.
+        // Ignored if it is lower than the current one.
+        void SetNext(std::uint64_t next);
+
+    private:
+        // First identifier of the next block.
+        std::atomic<std::uint64_t> m_next;
+    };
+
+    // Global entity id pool class.
+    class EntityIdPool : private NonCopyable
+    {
+    public:
+        EntityIdPool();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Adds a block of identifiers reserved by the authority.
+        void AddBlock(const EntityIdBlock& block);
+
+        // Allocates an identifier from reserved blocks.
+        // Returns an invalid identifier if there are no identifiers left.
+        std::uint64_t Allocate();
+
+        // Gets the number of identifiers left in reserved blocks.
+        std::uint64_t GetRemaining() const;
+
+    private:
+        // Type declarations.
+        typedef std::deque<EntityIdBlock> BlockQueue;
+
+    private:
+        // Reserved blocks, with the first one being allocated from.
+        BlockQueue m_blocks;
+
+        // Number of identifiers left in all blocks.
+        std::uint64_t m_remaining;
+    };
+}
@@ -0,0 +1,269 @@
+#include "Precompiled.hpp"
+#include "InterestManager.hpp"
+using namespace Game;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize the interest manager! "
+}
+
+InterestManagerInfo::InterestManagerInfo() :
+    grid(nullptr),
+    enterRadius(100.0f),
+    exitRadius(120.0f),
+    updatePeriod(4)
+{
+}
+
+InterestManager::Client::Client() :
+    active(false),
+    viewPosition(0.0f, 0.0f, 0.0f)
+{
+}
+
+InterestManager::InterestManager() :
+    m_tick(0),
+    m_initialized(false)
+{
+}
+
+InterestManager::~InterestManager()
+{
+    this->Cleanup();
+}
+
+void InterestManager::Cleanup()
+{
+    Utility::ClearContainer(m_clients);
+    Utility::ClearContainer(m_dueClients);
+
+    m_tick = 0;
+
+    // Reset initialization parameters.
+    m_info = InterestManagerInfo();
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool InterestManager::Initialize(const InterestManagerInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.grid == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid spatial grid.";
+        return false;
+    }
+
+    if(!(info.enterRadius >= 0.0f))
+    {
+        LogError() << LogInitializeError() << "Invalid enter radius.";
+        return false;
+    }
+
+    if(!(info.exitRadius >= info.enterRadius))
+    {
+        LogError() << LogInitializeError() << "Invalid exit radius.";
+        return false;
+    }
+
+    if(info.updatePeriod <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid update period.";
+        return false;
+    }
+
+    m_info = info;
+
+    // Success!
+    return m_initialized = true;
+}
+
+int InterestManager::AddClient()
+{
+    Assert(m_initialized, "Interest manager is not initialized!");
+
+    // Reuse a slot of a removed client.
+    std::size_t index = 0;
+
+    while(index < m_clients.size() && m_clients[index]->active)
+    {
+        ++index;
+    }
+
+    if(index == m_clients.size())
+    {
+        m_clients.emplace_back(new Client());
+    }
+
+    Client& client = *m_clients[index];
+    client.active = true;
+    client.viewPosition = glm::vec3(0.0f, 0.0f, 0.0f);
+
+    return (int)index;
+}
+
+void InterestManager::RemoveClient(int client)
+{
+    Assert(client >= 0 && client < (int)m_clients.size(), "Invalid client index!");
+
+    Client& state = *m_clients[client];
+    state.active = false;
+
+    state.relevant.clear();
+    state.entered.clear();
+    state.left.clear();
+}
+
+void InterestManager::SetViewPosition(int client, const glm::vec3& position)
+{
+    Assert(client >= 0 && client < (int)m_clients.size(), "Invalid client index!");
+
+    m_clients[client]->viewPosition = position;
+}
+
+void InterestManager::Update(JobSystem* jobSystem)
+{
+    if(!m_initialized)
+        return;
+
+    // Select clients whose turn it is, staggered by their indices.
+    m_dueClients.clear();
+
+    for(std::size_t i = 0; i < m_clients.size(); ++i)
+    {
+        if(m_clients[i]->active && (m_tick + i) % m_info.updatePeriod == 0)
+        {
+            m_dueClients.push_back((int)i);
+        }
+    }
+
+    m_tick += 1;
+
+    // Refresh due clients independently.
+    auto refresh = [this](int begin, int end)
+    {
+        for(int i = begin; i < end; ++i)
+        {
+            this->RefreshClient(*m_clients[m_dueClients[i]]);
+        }
+    };
+
+    if(jobSystem != nullptr)
+    {
+        jobSystem->ParallelFor((int)m_dueClients.size(), 1, refresh);
+    }
+    else
+    {
+        refresh(0, (int)m_dueClients.size());
+    }
+}
+
+const InterestManager::EntityList& InterestManager::GetRelevantEntities(int client) const
+{
+    Assert(client >= 0 && client < (int)m_clients.size(), "Invalid client index!");
+
+    return m_clients[client]->relevant;
+}
+
+const InterestManager::EntityList& InterestManager::GetEnteredEntities(int client) const
+{
+    Assert(client >= 0 && client < (int)m_clients.size(), "Invalid client index!");
+
+    return m_clients[client]->entered;
+}
+
+const InterestManager::EntityList& InterestManager::GetLeftEntities(int client) const
+{
+    Assert(client >= 0 && client < (int)m_clients.size(), "Invalid client index!");
+
+    return m_clients[client]->left;
+}
+
+bool InterestManager::IsRelevant(int client, const EntityHandle& entity) const
+{
+    Assert(client >= 0 && client < (int)m_clients.size(), "Invalid client index!");
+
+    const EntityList& relevant = m_clients[client]->relevant;
+    auto it = std::lower_bound(relevant.begin(), relevant.end(), entity);
+
+    return it != relevant.end() && *it == entity;
+}
+
+bool InterestManager::IsInitialized() const
+{
+    return m_initialized;
+}
+
+void InterestManager::RefreshClient(Client& client)
+{
+    // Query candidates within the exit radius.
+    client.candidates.clear();
+    m_info.grid->QueryRadius(client.viewPosition, m_info.exitRadius, client.candidates);
+
+    std::sort(client.candidates.begin(), client.candidates.end());
+
+    // Keep candidates within the enter radius or the ones that were relevant before.
+    client.previous.swap(client.relevant);
+    client.relevant.clear();
+
+    float enterRadiusSquared = m_info.enterRadius * m_info.enterRadius;
+
+    for(const EntityHandle& entity : client.candidates)
+    {
+        const glm::vec3* position = m_info.grid->GetPosition(entity);
+
+        if(position == nullptr)
+            continue;
+
+        glm::vec3 difference = *position - client.viewPosition;
+
+        if(glm::dot(difference, difference) <= enterRadiusSquared)
+        {
+            client.relevant.push_back(entity);
+            continue;
+        }
+
+        auto it = std::lower_bound(client.previous.begin(), client.previous.end(), entity);
+
+        if(it != client.previous.end() && *it == entity)
+        {
+            client.relevant.push_back(entity);
+        }
+    }
+
+    // Find differences between the previous and the new set.
+    // Entities with the same identifier but another version are different.
+    client.entered.clear();
+    client.left.clear();
+
+    std::size_t p = 0;
+    std::size_t r = 0;
+
+    while(p < client.previous.size() || r < client.relevant.size())
+    {
+        if(r == client.relevant.size() || (p < client.previous.size() && client.previous[p] < client.relevant[r]))
+        {
+            client.left.push_back(client.previous[p++]);
+        }
+        else if(p == client.previous.size() || client.relevant[r] < client.previous[p])
+        {
+            client.entered.push_back(client.relevant[r++]);
+        }
+        else
+        {
+            if(client.previous[p] != client.relevant[r])
+            {
+                client.left.push_back(client.previous[p]);
+                client.entered.push_back(client.relevant[r]);
+            }
+
+            ++p;
+            ++r;
+        }
+    }
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/JobSystem.hpp"
+#include "EntityHandle.hpp"
+#include "SpatialGrid.hpp"
+
+//
+// Interest Manager
+//
+//  Keeps a set of relevant entities for each client of a server, found with
+//  radius queries of a spatial grid around the view position of the client.
+//  Snapshots then only need to consider entities relevant to a client,
+//  instead of every entity in the world for every client.
+//
+//  Entities become relevant within the enter radius and stop being relevant
+//  beyond the larger exit radius, so entities moving along the border do not
+//  flicker in and out. Sets of clients are refreshed in turns spread over a
+//  number of ticks, which keeps the cost of each tick flat, and refreshes of
+//  due clients can run in parallel on a job system.
+//
+//  Relevant sets are sorted by entity identifiers and can still contain
+//  entities destroyed since the last refresh of a client.
+//
+//  Example usage:
+//      Game::InterestManagerInfo info;
+//      info.grid = &grid;
+//      info.enterRadius = 100.0f;
+//      info.exitRadius = 120.0f;
+//
+//      Game::InterestManager interest;
+//      interest.Initialize(info);
+//
+//      int client = interest.AddClient();
+//      replicator.SetRelevantEntities(client, &interest.GetRelevantEntities(client));
+//
+//      while(running)
+//      {
+//          grid.Update(&jobSystem);
+//
+//          interest.SetViewPosition(client, playerPosition);
+//          interest.Update(&jobSystem);
+//
+//          replicator.BuildSnapshots(&jobSystem);
+//      }
+//
+
+namespace Game
+{
+    // Interest manager initialization struct.
+    struct InterestManagerInfo
+    {
+        // Spatial grid with positions of entities.
+        SpatialGrid* grid;
+
+        // Distance within which entities become relevant.
+        float enterRadius;
+
+        // Distance beyond which relevant entities stop being relevant.
+        // Must not be smaller than the enter radius.
+        float exitRadius;
+
+        // Number of ticks between refreshes of each client.
+        int updatePeriod;
+
+        InterestManagerInfo();
+    };
+
+    // Interest manager class.
+    class InterestManager : private NonCopyable
+    {
+    public:
+        // Type declarations.
+        typedef std::vector<EntityHandle> EntityList;
+
+    public:
+        InterestManager();
+        ~InterestManager();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the interest manager.
+        bool Initialize(const InterestManagerInfo& info);
+
+        // Adds a client and returns its index.
+        // Indices of removed clients are reused.
+        int AddClient();
+
+        // Removes a client.
+        void RemoveClient(int client);
+
+        // Sets the position a client views the world from.
+        void SetViewPosition(int client, const glm::vec3& position);
+
+        // Refreshes relevant sets of clients that are due in this tick.
+        // Refreshes on the calling thread if no job system is given.
+        void Update(JobSystem* jobSystem = nullptr);
+
+        // Gets entities relevant to a client, sorted by their identifiers.
+        // Returned list remains at the same address for the lifetime of the client.
+        const EntityList& GetRelevantEntities(int client) const;
+
+        // Gets entities that became or stopped being relevant at the last refresh of a client.
+        const EntityList& GetEnteredEntities(int client) const;
+        const EntityList& GetLeftEntities(int client) const;
+
+        // Checks if an entity is relevant to a client.
+        bool IsRelevant(int client, const EntityHandle& entity) const;
+
+        // Checks if the instance is initialized.
+        bool IsInitialized() const;
+
+    private:
+        // Client state.
+        struct Client
+        {
+            Client();
+
+            bool active;
+            glm::vec3 viewPosition;
+
+            EntityList relevant;
+            EntityList entered;
+            EntityList left;
+
+            // Scratch lists reused between refreshes.
+            EntityList candidates;
+            EntityList previous;
+        };
+
+        // Type declarations.
+        typedef std::vector<std::unique_ptr<Client>> ClientList;
+        typedef std::vector<int> IndexList;
+
+    private:
+        // Refreshes the relevant set of a client.
+        void RefreshClient(Client& client);
+
+    private:
+        // Initialization parameters.
+        InterestManagerInfo m_info;
+
+        // Clients indexed by their indices.
+        // Clients are allocated separately to keep their lists in place.
+        ClientList m_clients;
+
+        // Indices of clients due in the current tick.
+        IndexList m_dueClients;
+
+        // Number of updates since initialization.
+        std::uint64_t m_tick;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
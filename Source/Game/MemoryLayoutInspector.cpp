@@ -0,0 +1,384 @@
+#include "Precompiled.hpp"
+#include "MemoryLayoutInspector.hpp"
+using namespace Game;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize a memory layout inspector! "
+
+    // Constant variables.
+    const int InvalidArchetype = -1;
+
+    // Checks if a system that accesses a set of types iterates over an archetype.
+    bool IsArchetypeTouched(ComponentSignature accessed, ComponentSignature archetype)
+    {
+        if(accessed == SystemScheduler::AllComponents)
+            return true;
+
+        return accessed != 0 && (archetype & accessed) == accessed;
+    }
+
+    // Checks if a system accesses a component type.
+    bool IsComponentAccessed(ComponentSignature accessed, int identifier)
+    {
+        return (accessed & ComponentTypes::GetSignatureBit(identifier)) != 0;
+    }
+}
+
+ArchetypeLayout::ArchetypeLayout() :
+    signature(0),
+    entityCount(0),
+    chunkCount(0),
+    chunkCapacity(0),
+    rowSize(0),
+    usedBytes(0),
+    allocatedBytes(0)
+{
+}
+
+ComponentTypeLayout::ComponentTypeLayout() :
+    identifier(0),
+    size(0),
+    count(0),
+    bytes(0),
+    archetypeCount(0)
+{
+}
+
+ComponentPoolLayout::ComponentPoolLayout() :
+    identifier(0),
+    componentSize(0),
+    count(0),
+    capacity(0),
+    sparseSize(0),
+    sparseHoles(0),
+    usedBytes(0),
+    allocatedBytes(0)
+{
+}
+
+SystemLayout::SystemLayout() :
+    readBytes(0),
+    writtenBytes(0)
+{
+}
+
+MemoryLayoutReport::MemoryLayoutReport() :
+    handleCount(0),
+    freeHandleCount(0),
+    activeEntities(0),
+    locationCount(0),
+    locationHoles(0),
+    chunkUsedBytes(0),
+    chunkAllocatedBytes(0),
+    poolUsedBytes(0),
+    poolAllocatedBytes(0)
+{
+}
+
+MemoryLayoutInspectorInfo::MemoryLayoutInspectorInfo() :
+    entitySystem(nullptr),
+    componentSystem(nullptr),
+    systemScheduler(nullptr)
+{
+}
+
+MemoryLayoutInspector::MemoryLayoutInspector() :
+    m_entitySystem(nullptr),
+    m_componentSystem(nullptr),
+    m_systemScheduler(nullptr),
+    m_initialized(false)
+{
+}
+
+MemoryLayoutInspector::~MemoryLayoutInspector()
+{
+    if(m_initialized)
+        this->Cleanup();
+}
+
+void MemoryLayoutInspector::Cleanup()
+{
+    m_entitySystem = nullptr;
+    m_componentSystem = nullptr;
+    m_systemScheduler = nullptr;
+
+    Utility::ClearContainer(m_pools);
+
+    m_report = MemoryLayoutReport();
+
+    m_initialized = false;
+}
+
+bool MemoryLayoutInspector::Initialize(const MemoryLayoutInspectorInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.entitySystem == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid entity system.";
+        return false;
+    }
+
+    m_entitySystem = info.entitySystem;
+    m_componentSystem = info.componentSystem;
+    m_systemScheduler = info.systemScheduler;
+
+    // Success!
+    return m_initialized = true;
+}
+
+const MemoryLayoutReport& MemoryLayoutInspector::Inspect()
+{
+    if(!m_initialized)
+        return m_report;
+
+    // Inspect the handle table.
+    EntitySystemStatistics statistics = m_entitySystem->GetStatistics();
+
+    m_report.handleCount = statistics.handleTableSize;
+    m_report.freeHandleCount = statistics.freeHandleCount;
+    m_report.activeEntities = statistics.activeEntities;
+
+    // Inspect component storage.
+    this->InspectArchetypes();
+    this->InspectPools();
+
+    return m_report;
+}
+
+void MemoryLayoutInspector::InspectArchetypes()
+{
+    m_report.locationCount = 0;
+    m_report.locationHoles = 0;
+    m_report.chunkUsedBytes = 0;
+    m_report.chunkAllocatedBytes = 0;
+    m_report.archetypes.clear();
+    m_report.componentTypes.clear();
+
+    // Prepare estimates of systems.
+    int systemCount = m_systemScheduler != nullptr ? m_systemScheduler->GetSystemCount() : 0;
+
+    m_report.systems.resize(systemCount);
+
+    for(int i = 0; i < systemCount; ++i)
+    {
+        SystemLayout& system = m_report.systems[i];
+        system.name = m_systemScheduler->GetSystemName(i);
+        system.readBytes = 0;
+        system.writtenBytes = 0;
+    }
+
+    if(m_componentSystem == nullptr)
+        return;
+
+    const ComponentSystem& components = *m_componentSystem;
+
+    // Types stored in pools do not select archetypes that systems iterate over.
+    ComponentSignature poolTypes = 0;
+
+    for(const PoolEntry& entry : m_pools)
+    {
+        poolTypes |= ComponentTypes::GetSignatureBit(entry.identifier);
+    }
+
+    // Count location entries of entities without components.
+    m_report.locationCount = (int)components.m_locations.size();
+
+    for(const ComponentSystem::EntityLocation& location : components.m_locations)
+    {
+        if(location.archetype == InvalidArchetype)
+        {
+            ++m_report.locationHoles;
+        }
+    }
+
+    // Inspect each archetype and its chunks.
+    int typeLayouts[ComponentTypes::MaximumCount];
+    std::fill(std::begin(typeLayouts), std::end(typeLayouts), -1);
+
+    for(const std::unique_ptr<ComponentSystem::Archetype>& pointer : components.m_archetypes)
+    {
+        const ComponentSystem::Archetype& archetype = *pointer;
+
+        ArchetypeLayout layout;
+        layout.signature = archetype.signature;
+        layout.entityCount = archetype.entityCount;
+        layout.chunkCount = (int)archetype.chunks.size();
+        layout.chunkCapacity = archetype.chunkCapacity;
+        layout.rowSize = sizeof(EntityHandle);
+
+        for(int component : archetype.components)
+        {
+            layout.rowSize += ComponentTypes::GetInfo(component).size;
+        }
+
+        layout.usedBytes = layout.rowSize * archetype.entityCount;
+        layout.allocatedBytes = ComponentSystem::GetChunkSize(archetype) * archetype.chunks.size();
+
+        m_report.chunkUsedBytes += layout.usedBytes;
+        m_report.chunkAllocatedBytes += layout.allocatedBytes;
+        m_report.archetypes.push_back(layout);
+
+        // Accumulate bytes of component types.
+        for(int component : archetype.components)
+        {
+            if(typeLayouts[component] < 0)
+            {
+                typeLayouts[component] = (int)m_report.componentTypes.size();
+
+                ComponentTypeLayout type;
+                type.identifier = component;
+                type.size = ComponentTypes::GetInfo(component).size;
+                m_report.componentTypes.push_back(type);
+            }
+
+            ComponentTypeLayout& type = m_report.componentTypes[typeLayouts[component]];
+            type.count += archetype.entityCount;
+            type.bytes += type.size * archetype.entityCount;
+            type.archetypeCount += 1;
+        }
+
+        // Estimate cache lines that systems touch in chunks of the archetype.
+        for(int i = 0; i < systemCount; ++i)
+        {
+            ComponentSignature reads = m_systemScheduler->GetSystemReads(i);
+            ComponentSignature writes = m_systemScheduler->GetSystemWrites(i);
+
+            ComponentSignature accessed = reads | writes;
+
+            if(accessed != SystemScheduler::AllComponents)
+            {
+                accessed &= ~poolTypes;
+            }
+
+            if(!IsArchetypeTouched(accessed, archetype.signature))
+                continue;
+
+            SystemLayout& system = m_report.systems[i];
+
+            for(const ComponentSystem::Chunk& chunk : archetype.chunks)
+            {
+                // Entity column is read to find which entities rows belong to.
+                system.readBytes += CountCacheLines(0, sizeof(EntityHandle) * chunk.count) * CacheLineSize;
+
+                for(std::size_t column = 0; column < archetype.components.size(); ++column)
+                {
+                    int component = archetype.components[column];
+                    std::size_t size = ComponentTypes::GetInfo(component).size * chunk.count;
+                    std::size_t bytes = CountCacheLines(archetype.columnOffsets[column], size) * CacheLineSize;
+
+                    if(IsComponentAccessed(writes, component))
+                    {
+                        system.writtenBytes += bytes;
+                    }
+                    else if(IsComponentAccessed(reads, component))
+                    {
+                        system.readBytes += bytes;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void MemoryLayoutInspector::InspectPools()
+{
+    m_report.poolUsedBytes = 0;
+    m_report.poolAllocatedBytes = 0;
+    m_report.pools.resize(m_pools.size());
+
+    for(std::size_t i = 0; i < m_pools.size(); ++i)
+    {
+        const PoolEntry& entry = m_pools[i];
+
+        ComponentPoolLayout& layout = m_report.pools[i];
+        layout = ComponentPoolLayout();
+        layout.name = entry.name;
+        layout.identifier = entry.identifier;
+        entry.inspect(layout);
+
+        m_report.poolUsedBytes += layout.usedBytes;
+        m_report.poolAllocatedBytes += layout.allocatedBytes;
+
+        // Systems that access the pool type walk its dense arrays.
+        std::size_t bytes = CountCacheLines(0, layout.componentSize * layout.count) * CacheLineSize;
+
+        for(std::size_t system = 0; system < m_report.systems.size(); ++system)
+        {
+            if(IsComponentAccessed(m_systemScheduler->GetSystemWrites((int)system), entry.identifier))
+            {
+                m_report.systems[system].writtenBytes += bytes;
+            }
+            else if(IsComponentAccessed(m_systemScheduler->GetSystemReads((int)system), entry.identifier))
+            {
+                m_report.systems[system].readBytes += bytes;
+            }
+        }
+    }
+}
+
+std::size_t MemoryLayoutInspector::CountCacheLines(std::size_t offset, std::size_t size)
+{
+    if(size == 0)
+        return 0;
+
+    // Chunks and dense arrays are assumed to start at cache line boundaries.
+    return (offset + size - 1) / CacheLineSize - offset / CacheLineSize + 1;
+}
+
+const MemoryLayoutReport& MemoryLayoutInspector::GetReport() const
+{
+    return m_report;
+}
+
+void MemoryLayoutInspector::LogReport() const
+{
+    if(!m_initialized)
+        return;
+
+    Log() << "Memory layout: " << m_report.activeEntities << " entities, "
+        << m_report.handleCount << " handles (" << m_report.freeHandleCount << " free), "
+        << m_report.locationCount << " locations (" << m_report.locationHoles << " without components).";
+
+    for(const ArchetypeLayout& archetype : m_report.archetypes)
+    {
+        float occupancy = archetype.allocatedBytes != 0 ? (float)archetype.usedBytes / archetype.allocatedBytes : 0.0f;
+
+        char signature[32];
+        std::snprintf(signature, sizeof(signature), "%016llx", (unsigned long long)archetype.signature);
+
+        Log() << "Archetype 0x" << signature << ": "
+            << archetype.entityCount << " entities in " << archetype.chunkCount << " chunks of "
+            << archetype.chunkCapacity << " rows, " << archetype.usedBytes << " of "
+            << archetype.allocatedBytes << " bytes used (" << (int)(occupancy * 100.0f) << "%).";
+    }
+
+    for(const ComponentTypeLayout& type : m_report.componentTypes)
+    {
+        Log() << "Component type " << type.identifier << ": " << type.count << " components of "
+            << type.size << " bytes in " << type.archetypeCount << " archetypes, " << type.bytes << " bytes.";
+    }
+
+    for(const ComponentPoolLayout& pool : m_report.pools)
+    {
+        Log() << "Component pool \"" << pool.name << "\": " << pool.count << " of "
+            << pool.capacity << " components, " << pool.sparseHoles << " of "
+            << pool.sparseSize << " sparse entries empty, " << pool.usedBytes << " of "
+            << pool.allocatedBytes << " bytes used.";
+    }
+
+    for(const SystemLayout& system : m_report.systems)
+    {
+        Log() << "System \"" << system.name << "\": touches about " << system.readBytes
+            << " bytes read and " << system.writtenBytes << " bytes written per frame.";
+    }
+}
+
+bool MemoryLayoutInspector::IsInitialized() const
+{
+    return m_initialized;
+}
@@ -0,0 +1,269 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "EntitySystem.hpp"
+#include "ComponentSystem.hpp"
+#include "ComponentPool.hpp"
+#include "SystemScheduler.hpp"
+
+//
+// Memory Layout Inspector
+//
+//  Reports how component storage is laid out in memory, so layout work can
+//  be aimed at storage that actually wastes memory or cache lines. A pass
+//  walks archetypes and their chunks, registered component pools and the
+//  handle table of the entity system, without touching component data.
+//
+//  Archetypes report their chunk occupancy, which drops when chunks are
+//  sized for many more rows than there are entities, along with padding at
+//  the end of chunks. Component types report bytes stored across archetypes.
+//  Pools report unused capacity of their dense arrays and holes of sparse
+//  arrays, which are entries of entities without a component. The entity
+//  system reports free slots of its handle table, and the component system
+//  location entries of entities without components.
+//
+//  Bytes touched per frame are estimated for each system of a scheduler from
+//  the component types it declares. A system is assumed to iterate over all
+//  entities that have every type it accesses outside of registered pools,
+//  loading whole cache lines of the columns it reads and writes, and whole
+//  dense arrays of pools. Systems that access all components are assumed to
+//  touch all columns.
+//
+//  Example usage:
+//      Game::MemoryLayoutInspectorInfo info;
+//      info.entitySystem = &entitySystem;
+//      info.componentSystem = &componentSystem;
+//      info.systemScheduler = &systemScheduler;
+//
+//      Game::MemoryLayoutInspector inspector;
+//      inspector.Initialize(info);
+//      inspector.AddPool("Velocity", velocities);
+//
+//      const Game::MemoryLayoutReport& report = inspector.Inspect();
+//      inspector.LogReport();
+//
+
+namespace Game
+{
+    // Memory layout of an archetype.
+    struct ArchetypeLayout
+    {
+        ArchetypeLayout();
+
+        // Component types of the archetype.
+        ComponentSignature signature;
+
+        // Number of entities and chunks.
+        int entityCount;
+        int chunkCount;
+
+        // Number of rows that fit in a chunk and the size of a row in bytes.
+        int chunkCapacity;
+        std::size_t rowSize;
+
+        // Bytes of rows and bytes allocated for chunks.
+        std::size_t usedBytes;
+        std::size_t allocatedBytes;
+    };
+
+    // Memory layout of a component type across archetypes.
+    struct ComponentTypeLayout
+    {
+        ComponentTypeLayout();
+
+        // Identifier and size of the type.
+        int identifier;
+        std::size_t size;
+
+        // Number of stored components and their bytes.
+        int count;
+        std::size_t bytes;
+
+        // Number of archetypes with the type.
+        int archetypeCount;
+    };
+
+    // Memory layout of a component pool.
+    struct ComponentPoolLayout
+    {
+        ComponentPoolLayout();
+
+        // Name that the pool was added with and its component type.
+        std::string name;
+        int identifier;
+        std::size_t componentSize;
+
+        // Number of components and the capacity of dense arrays.
+        int count;
+        int capacity;
+
+        // Number of sparse entries and the ones without a component.
+        int sparseSize;
+        int sparseHoles;
+
+        // Bytes of stored components and bytes allocated for arrays.
+        std::size_t usedBytes;
+        std::size_t allocatedBytes;
+    };
+
+    // Estimated memory traffic of a system in a frame.
+    struct SystemLayout
+    {
+        SystemLayout();
+
+        // Name of the system.
+        std::string name;
+
+        // Estimated bytes of cache lines read and written.
+        std::size_t readBytes;
+        std::size_t writtenBytes;
+    };
+
+    // Memory layout report.
+    struct MemoryLayoutReport
+    {
+        MemoryLayoutReport();
+
+        // Handle table of the entity system.
+        int handleCount;
+        int freeHandleCount;
+        int activeEntities;
+
+        // Location table of the component system and its entries without components.
+        int locationCount;
+        int locationHoles;
+
+        // Totals of archetype chunks.
+        std::size_t chunkUsedBytes;
+        std::size_t chunkAllocatedBytes;
+
+        // Totals of component pools.
+        std::size_t poolUsedBytes;
+        std::size_t poolAllocatedBytes;
+
+        // Detailed layouts.
+        std::vector<ArchetypeLayout> archetypes;
+        std::vector<ComponentTypeLayout> componentTypes;
+        std::vector<ComponentPoolLayout> pools;
+        std::vector<SystemLayout> systems;
+    };
+
+    // Memory layout inspector initialization struct.
+    struct MemoryLayoutInspectorInfo
+    {
+        // Inspected entity system.
+        EntitySystem* entitySystem;
+
+        // Optional component system whose archetypes are inspected.
+        ComponentSystem* componentSystem;
+
+        // Optional scheduler whose systems get estimates of touched bytes.
+        SystemScheduler* systemScheduler;
+
+        MemoryLayoutInspectorInfo();
+    };
+
+    // Memory layout inspector class.
+    class MemoryLayoutInspector : private NonCopyable
+    {
+    public:
+        // Size of cache lines that touched bytes are counted in.
+        static const std::size_t CacheLineSize = 64;
+
+    public:
+        MemoryLayoutInspector();
+        ~MemoryLayoutInspector();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the inspector.
+        bool Initialize(const MemoryLayoutInspectorInfo& info);
+
+        // Adds a component pool to inspect.
+        // Pool must outlive the inspector.
+        template<typename Type>
+        void AddPool(std::string name, const ComponentPool<Type>& pool);
+
+        // Inspects memory layout and returns the report.
+        // Must not run while other threads change inspected storage.
+        const MemoryLayoutReport& Inspect();
+
+        // Gets the report of the last inspection.
+        const MemoryLayoutReport& GetReport() const;
+
+        // Writes the report of the last inspection to the log.
+        void LogReport() const;
+
+        // Checks if the instance is initialized.
+        bool IsInitialized() const;
+
+    private:
+        // Type declarations.
+        typedef std::function<void(ComponentPoolLayout&)> PoolFunction;
+
+        // Pool that fills in its layout.
+        struct PoolEntry
+        {
+            std::string name;
+            int identifier;
+            PoolFunction inspect;
+        };
+
+    private:
+        // Inspects archetypes of the component system.
+        void InspectArchetypes();
+
+        // Inspects registered component pools.
+        void InspectPools();
+
+        // Counts cache lines that a range of bytes starting at an offset spans.
+        static std::size_t CountCacheLines(std::size_t offset, std::size_t size);
+
+    private:
+        // Inspected systems.
+        EntitySystem* m_entitySystem;
+        ComponentSystem* m_componentSystem;
+        SystemScheduler* m_systemScheduler;
+
+        // Registered component pools.
+        std::vector<PoolEntry> m_pools;
+
+        // Report of the last inspection.
+        MemoryLayoutReport m_report;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
+
+// Template implementations.
+namespace Game
+{
+    template<typename Type>
+    void MemoryLayoutInspector::AddPool(std::string name, const ComponentPool<Type>& pool)
+    {
+        if(!m_initialized)
+            return;
+
+        PoolEntry entry;
+        entry.name = std::move(name);
+        entry.identifier = ComponentTypes::GetIdentifier<Type>();
+        entry.inspect = [&pool](ComponentPoolLayout& layout)
+        {
+            // Rows hold components, entities and change ticks, with a second component for double buffering.
+            std::size_t components = pool.IsDoubleBuffered() ? 2 : 1;
+            std::size_t rowSize = sizeof(Type) * components + sizeof(EntityHandle) + sizeof(typename ComponentPool<Type>::Tick);
+
+            layout.componentSize = sizeof(Type);
+            layout.count = pool.GetSize();
+            layout.capacity = pool.GetCapacity();
+            layout.sparseSize = pool.GetSparseSize();
+            layout.sparseHoles = layout.sparseSize - layout.count;
+            layout.usedBytes = (std::size_t)layout.count * (rowSize + sizeof(int));
+            layout.allocatedBytes = (std::size_t)layout.capacity * rowSize + (std::size_t)layout.sparseSize * sizeof(int);
+        };
+
+        m_pools.push_back(std::move(entry));
+    }
+}
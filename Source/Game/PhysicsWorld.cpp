@@ -0,0 +1,556 @@
+#include "Precompiled.hpp"
+#include "PhysicsWorld.hpp"
+#include "Common/BatchMath.hpp"
+#include "Common/Checksum.hpp"
+using namespace Game;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize the physics world! "
+
+    // Constant variables.
+    const int InvalidBody = -1;
+    const int InvalidIsland = -1;
+
+    // Number of islands solved by a single job.
+    const int IslandGrainSize = 16;
+}
+
+PhysicsWorldInfo::PhysicsWorldInfo() :
+    entitySystem(nullptr),
+    gravity(0.0f, -9.81f, 0.0f),
+    solverIterations(8),
+    restitution(0.2f),
+    correctionFactor(0.8f),
+    penetrationSlop(0.01f)
+{
+}
+
+PhysicsWorld::PhysicsWorld() :
+    m_initialized(false)
+{
+}
+
+PhysicsWorld::~PhysicsWorld()
+{
+    this->Cleanup();
+}
+
+void PhysicsWorld::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Unsubscribe from the entity system.
+    m_entityDestroy.Cleanup();
+
+    // Cleanup the broadphase.
+    m_broadphase.Cleanup();
+
+    // Clear body arrays.
+    Utility::ClearContainer(m_bodyIndices);
+    Utility::ClearContainer(m_entities);
+    Utility::ClearContainer(m_positions);
+    Utility::ClearContainer(m_velocities);
+    Utility::ClearContainer(m_accelerations);
+    Utility::ClearContainer(m_inverseMasses);
+    Utility::ClearContainer(m_radii);
+
+    // Clear solver arrays.
+    Utility::ClearContainer(m_contacts);
+    Utility::ClearContainer(m_sortedContacts);
+    Utility::ClearContainer(m_parents);
+    Utility::ClearContainer(m_islandIndices);
+    Utility::ClearContainer(m_islands);
+
+    // Reset initialization parameters.
+    m_info = PhysicsWorldInfo();
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool PhysicsWorld::Initialize(const PhysicsWorldInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            m_initialized = true;
+            this->Cleanup();
+        }
+    );
+
+    // Validate arguments.
+    if(info.entitySystem == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid entity system.";
+        return false;
+    }
+
+    if(info.solverIterations <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid number of solver iterations.";
+        return false;
+    }
+
+    if(info.restitution < 0.0f || info.restitution > 1.0f)
+    {
+        LogError() << LogInitializeError() << "Invalid restitution.";
+        return false;
+    }
+
+    if(info.correctionFactor < 0.0f || info.correctionFactor > 1.0f)
+    {
+        LogError() << LogInitializeError() << "Invalid correction factor.";
+        return false;
+    }
+
+    if(info.penetrationSlop < 0.0f)
+    {
+        LogError() << LogInitializeError() << "Invalid penetration slop.";
+        return false;
+    }
+
+    m_info = info;
+
+    // Initialize the broadphase.
+    if(!m_broadphase.Initialize(info.entitySystem))
+    {
+        LogError() << LogInitializeError() << "Could not initialize the broadphase.";
+        return false;
+    }
+
+    // Remove bodies of destroyed entities.
+    m_entityDestroy.Bind<PhysicsWorld, &PhysicsWorld::OnEntityDestroy>(this);
+    m_entityDestroy.Subscribe(info.entitySystem->events.destroy);
+
+    // Success!
+    return m_initialized = true;
+}
+
+bool PhysicsWorld::AddBody(const EntityHandle& entity, const glm::vec3& position, float radius, float mass)
+{
+    if(!m_initialized)
+        return false;
+
+    Assert(radius >= 0.0f, "Invalid body radius!");
+    Assert(mass >= 0.0f, "Invalid body mass!");
+
+    // Insert bounds into the broadphase, which also validates the entity.
+    if(this->Contains(entity))
+        return false;
+
+    if(!m_broadphase.Insert(entity, position - glm::vec3(radius), position + glm::vec3(radius)))
+        return false;
+
+    // Make sure the index array can hold the entity.
+    int index = entity.GetIdentifier() - 1;
+
+    if(index >= (int)m_bodyIndices.size())
+    {
+        m_bodyIndices.resize(index + 1, InvalidBody);
+    }
+
+    // Append the body to dense arrays.
+    float inverseMass = mass > 0.0f ? 1.0f / mass : 0.0f;
+
+    m_bodyIndices[index] = (int)m_entities.size();
+
+    m_entities.push_back(entity);
+    m_positions.push_back(position);
+    m_velocities.push_back(glm::vec3(0.0f));
+    m_accelerations.push_back(inverseMass > 0.0f ? m_info.gravity : glm::vec3(0.0f));
+    m_inverseMasses.push_back(inverseMass);
+    m_radii.push_back(radius);
+
+    return true;
+}
+
+bool PhysicsWorld::RemoveBody(const EntityHandle& entity)
+{
+    int body = this->FindBody(entity);
+
+    if(body == InvalidBody)
+        return false;
+
+    m_broadphase.Remove(entity);
+
+    // Move the last body into the place of the removed one.
+    int last = (int)m_entities.size() - 1;
+
+    if(body != last)
+    {
+        m_entities[body] = m_entities[last];
+        m_positions[body] = m_positions[last];
+        m_velocities[body] = m_velocities[last];
+        m_accelerations[body] = m_accelerations[last];
+        m_inverseMasses[body] = m_inverseMasses[last];
+        m_radii[body] = m_radii[last];
+
+        m_bodyIndices[m_entities[body].GetIdentifier() - 1] = body;
+    }
+
+    m_entities.pop_back();
+    m_positions.pop_back();
+    m_velocities.pop_back();
+    m_accelerations.pop_back();
+    m_inverseMasses.pop_back();
+    m_radii.pop_back();
+
+    m_bodyIndices[entity.GetIdentifier() - 1] = InvalidBody;
+
+    return true;
+}
+
+bool PhysicsWorld::Contains(const EntityHandle& entity) const
+{
+    return this->FindBody(entity) != InvalidBody;
+}
+
+bool PhysicsWorld::SetPosition(const EntityHandle& entity, const glm::vec3& position)
+{
+    int body = this->FindBody(entity);
+
+    if(body == InvalidBody)
+        return false;
+
+    m_positions[body] = position;
+
+    return true;
+}
+
+bool PhysicsWorld::SetVelocity(const EntityHandle& entity, const glm::vec3& velocity)
+{
+    int body = this->FindBody(entity);
+
+    if(body == InvalidBody)
+        return false;
+
+    m_velocities[body] = velocity;
+
+    return true;
+}
+
+const glm::vec3* PhysicsWorld::GetPosition(const EntityHandle& entity) const
+{
+    int body = this->FindBody(entity);
+
+    if(body == InvalidBody)
+        return nullptr;
+
+    return &m_positions[body];
+}
+
+const glm::vec3* PhysicsWorld::GetVelocity(const EntityHandle& entity) const
+{
+    int body = this->FindBody(entity);
+
+    if(body == InvalidBody)
+        return nullptr;
+
+    return &m_velocities[body];
+}
+
+void PhysicsWorld::Update(float timeDelta, JobSystem* jobSystem)
+{
+    if(!m_initialized)
+        return;
+
+    std::size_t count = m_entities.size();
+
+    // Accelerate velocities first, so contacts act on velocities of this step.
+    BatchMath::IntegrateVelocities(BatchMath::Stream<glm::vec3>(m_velocities.data()),
+        BatchMath::Stream<const glm::vec3>(m_accelerations.data()), timeDelta, count);
+
+    // Find overlapping bodies.
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        glm::vec3 extent(m_radii[i]);
+        m_broadphase.SetBounds(m_entities[i], m_positions[i] - extent, m_positions[i] + extent);
+    }
+
+    m_broadphase.Update();
+
+    this->FindContacts();
+    this->BuildIslands();
+
+    // Solve islands independently.
+    auto solve = [this](int begin, int end)
+    {
+        for(int i = begin; i < end; ++i)
+        {
+            this->SolveIsland(m_islands[i]);
+        }
+    };
+
+    if(jobSystem != nullptr)
+    {
+        jobSystem->ParallelFor((int)m_islands.size(), IslandGrainSize, solve);
+    }
+    else
+    {
+        solve(0, (int)m_islands.size());
+    }
+
+    // Move positions with solved velocities.
+    BatchMath::IntegrateVelocities(BatchMath::Stream<glm::vec3>(m_positions.data()),
+        BatchMath::Stream<const glm::vec3>(m_velocities.data()), timeDelta, count);
+}
+
+void PhysicsWorld::UpdateChecksum(Checksum& checksum) const
+{
+    checksum.Update<std::int32_t>((std::int32_t)m_entities.size());
+    checksum.Update(m_entities.data(), m_entities.size() * sizeof(EntityHandle));
+    checksum.Update(m_positions.data(), m_positions.size() * sizeof(glm::vec3));
+    checksum.Update(m_velocities.data(), m_velocities.size() * sizeof(glm::vec3));
+}
+
+const EntityHandle* PhysicsWorld::GetEntities() const
+{
+    return m_entities.data();
+}
+
+const glm::vec3* PhysicsWorld::GetPositions() const
+{
+    return m_positions.data();
+}
+
+const glm::vec3* PhysicsWorld::GetVelocities() const
+{
+    return m_velocities.data();
+}
+
+int PhysicsWorld::GetBodyCount() const
+{
+    return (int)m_entities.size();
+}
+
+int PhysicsWorld::GetContactCount() const
+{
+    return (int)m_sortedContacts.size();
+}
+
+int PhysicsWorld::GetIslandCount() const
+{
+    return (int)m_islands.size();
+}
+
+bool PhysicsWorld::IsInitialized() const
+{
+    return m_initialized;
+}
+
+int PhysicsWorld::FindBody(const EntityHandle& entity) const
+{
+    int index = entity.GetIdentifier() - 1;
+
+    if(index < 0 || index >= (int)m_bodyIndices.size())
+        return InvalidBody;
+
+    int body = m_bodyIndices[index];
+
+    if(body == InvalidBody || m_entities[body] != entity)
+        return InvalidBody;
+
+    return body;
+}
+
+void PhysicsWorld::FindContacts()
+{
+    m_contacts.clear();
+
+    const Broadphase::Pair* pairs = m_broadphase.GetPairs();
+    int pairCount = m_broadphase.GetPairCount();
+
+    for(int i = 0; i < pairCount; ++i)
+    {
+        int first = this->FindBody(pairs[i].first);
+        int second = this->FindBody(pairs[i].second);
+
+        if(first == InvalidBody || second == InvalidBody)
+            continue;
+
+        // Kinematic bodies do not collide with each other.
+        if(m_inverseMasses[first] == 0.0f && m_inverseMasses[second] == 0.0f)
+            continue;
+
+        // Test overlapping bounds for overlapping spheres.
+        glm::vec3 difference = m_positions[second] - m_positions[first];
+        float radius = m_radii[first] + m_radii[second];
+        float distanceSquared = glm::dot(difference, difference);
+
+        if(distanceSquared >= radius * radius)
+            continue;
+
+        // Push concentric bodies apart along an arbitrary axis.
+        float distance = std::sqrt(distanceSquared);
+
+        Contact contact;
+        contact.first = first;
+        contact.second = second;
+        contact.normal = distance > 0.0f ? difference / distance : glm::vec3(0.0f, 1.0f, 0.0f);
+        contact.penetration = radius - distance;
+        contact.impulse = 0.0f;
+
+        // Bounce back with a fraction of the approach velocity.
+        float normalVelocity = glm::dot(m_velocities[second] - m_velocities[first], contact.normal);
+        contact.targetVelocity = normalVelocity < 0.0f ? -m_info.restitution * normalVelocity : 0.0f;
+
+        m_contacts.push_back(contact);
+    }
+}
+
+void PhysicsWorld::BuildIslands()
+{
+    int bodyCount = (int)m_entities.size();
+
+    // Join dynamic bodies connected by contacts into trees.
+    m_parents.resize(bodyCount);
+
+    for(int i = 0; i < bodyCount; ++i)
+    {
+        m_parents[i] = i;
+    }
+
+    for(const Contact& contact : m_contacts)
+    {
+        if(m_inverseMasses[contact.first] == 0.0f || m_inverseMasses[contact.second] == 0.0f)
+            continue;
+
+        int first = this->FindRoot(contact.first);
+        int second = this->FindRoot(contact.second);
+
+        // Lower indices become roots, so islands do not depend on the contact order.
+        if(first < second)
+        {
+            m_parents[second] = first;
+        }
+        else if(second < first)
+        {
+            m_parents[first] = second;
+        }
+    }
+
+    // Number islands in the order of their first contacts and count their contacts.
+    m_islandIndices.assign(bodyCount, InvalidIsland);
+    m_islands.clear();
+
+    for(Contact& contact : m_contacts)
+    {
+        int body = m_inverseMasses[contact.first] != 0.0f ? contact.first : contact.second;
+        int root = this->FindRoot(body);
+
+        if(m_islandIndices[root] == InvalidIsland)
+        {
+            m_islandIndices[root] = (int)m_islands.size();
+            m_islands.push_back({ 0, 0 });
+        }
+
+        m_islands[m_islandIndices[root]].end += 1;
+    }
+
+    // Turn counts into ranges and sort contacts into them, keeping their order.
+    int offset = 0;
+
+    for(Island& island : m_islands)
+    {
+        int count = island.end;
+
+        island.begin = offset;
+        island.end = offset;
+
+        offset += count;
+    }
+
+    m_sortedContacts.resize(m_contacts.size());
+
+    for(const Contact& contact : m_contacts)
+    {
+        int body = m_inverseMasses[contact.first] != 0.0f ? contact.first : contact.second;
+        Island& island = m_islands[m_islandIndices[this->FindRoot(body)]];
+
+        m_sortedContacts[island.end++] = contact;
+    }
+}
+
+int PhysicsWorld::FindRoot(int body)
+{
+    // Halve paths while walking up to the root.
+    while(m_parents[body] != body)
+    {
+        m_parents[body] = m_parents[m_parents[body]];
+        body = m_parents[body];
+    }
+
+    return body;
+}
+
+void PhysicsWorld::SolveIsland(const Island& island)
+{
+    // Apply impulses along contact normals until relative velocities
+    // reach their targets, keeping total impulses of contacts pushing.
+    for(int iteration = 0; iteration < m_info.solverIterations; ++iteration)
+    {
+        for(int i = island.begin; i < island.end; ++i)
+        {
+            Contact& contact = m_sortedContacts[i];
+
+            float firstInverseMass = m_inverseMasses[contact.first];
+            float secondInverseMass = m_inverseMasses[contact.second];
+
+            glm::vec3& firstVelocity = m_velocities[contact.first];
+            glm::vec3& secondVelocity = m_velocities[contact.second];
+
+            float normalVelocity = glm::dot(secondVelocity - firstVelocity, contact.normal);
+            float impulse = (contact.targetVelocity - normalVelocity) / (firstInverseMass + secondInverseMass);
+
+            float totalImpulse = std::max(contact.impulse + impulse, 0.0f);
+            impulse = totalImpulse - contact.impulse;
+            contact.impulse = totalImpulse;
+
+            // Kinematic bodies can be shared by islands and are never written.
+            if(firstInverseMass > 0.0f)
+            {
+                firstVelocity -= contact.normal * (impulse * firstInverseMass);
+            }
+
+            if(secondInverseMass > 0.0f)
+            {
+                secondVelocity += contact.normal * (impulse * secondInverseMass);
+            }
+        }
+    }
+
+    // Move penetrating bodies apart, which velocities alone would let sink.
+    for(int i = island.begin; i < island.end; ++i)
+    {
+        const Contact& contact = m_sortedContacts[i];
+
+        float firstInverseMass = m_inverseMasses[contact.first];
+        float secondInverseMass = m_inverseMasses[contact.second];
+
+        float depth = std::max(contact.penetration - m_info.penetrationSlop, 0.0f);
+        float correction = depth * m_info.correctionFactor / (firstInverseMass + secondInverseMass);
+
+        if(firstInverseMass > 0.0f)
+        {
+            m_positions[contact.first] -= contact.normal * (correction * firstInverseMass);
+        }
+
+        if(secondInverseMass > 0.0f)
+        {
+            m_positions[contact.second] += contact.normal * (correction * secondInverseMass);
+        }
+    }
+}
+
+void PhysicsWorld::OnEntityDestroy(EntitySystem::Events::Destroy event)
+{
+    this->RemoveBody(event.handle);
+}
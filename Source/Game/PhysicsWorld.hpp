@@ -0,0 +1,206 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/JobSystem.hpp"
+#include "EntityHandle.hpp"
+#include "EntitySystem.hpp"
+#include "Broadphase.hpp"
+
+// Forward declarations.
+class Checksum;
+
+//
+// Physics World
+//
+//  Simulates spherical bodies of entities with semi-implicit Euler
+//  integration. Body state is kept in separate dense arrays of positions,
+//  velocities and masses, which are integrated in batches with SIMD
+//  instructions. Bodies with zero mass are kinematic, moving with their
+//  velocities without being affected by gravity or contacts.
+//
+//  Overlapping bodies are found by a broadphase and turned into contacts,
+//  which are partitioned into islands of bodies that touch each other.
+//  Islands share no dynamic bodies, so they are solved independently in
+//  parallel on a job system, with sequential impulses followed by a
+//  positional correction of penetrations. Kinematic bodies do not join
+//  islands, as they are never written by the solver.
+//
+//  Each update advances the world by one fixed tick of the game loop. Results
+//  do not depend on the number of worker threads, because contacts and their
+//  islands are always processed in the same order.
+//
+//  Example usage:
+//      Game::PhysicsWorldInfo info;
+//      info.entitySystem = &entitySystem;
+//      info.gravity = glm::vec3(0.0f, -9.81f, 0.0f);
+//
+//      Game::PhysicsWorld physicsWorld;
+//      physicsWorld.Initialize(info);
+//
+//      physicsWorld.AddBody(entity, glm::vec3(0.0f, 10.0f, 0.0f), 0.5f, 1.0f);
+//
+//      while(gameLoop.Tick())
+//      {
+//          physicsWorld.Update((float)gameLoop.GetTickTime(), &jobSystem);
+//      }
+//
+
+namespace Game
+{
+    // Physics world initialization struct.
+    struct PhysicsWorldInfo
+    {
+        // Entity system that owns the entities.
+        EntitySystem* entitySystem;
+
+        // Acceleration applied to dynamic bodies.
+        glm::vec3 gravity;
+
+        // Number of velocity iterations over contacts of each island.
+        int solverIterations;
+
+        // Fraction of the approach velocity kept after a collision.
+        float restitution;
+
+        // Fraction of penetration corrected per update and the depth left uncorrected.
+        float correctionFactor;
+        float penetrationSlop;
+
+        PhysicsWorldInfo();
+    };
+
+    // Physics world class.
+    class PhysicsWorld : private NonCopyable
+    {
+    public:
+        PhysicsWorld();
+        ~PhysicsWorld();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the physics world.
+        bool Initialize(const PhysicsWorldInfo& info);
+
+        // Adds a body of an entity.
+        // Bodies with zero mass are kinematic.
+        // Returns false if the entity is not valid or already has a body.
+        bool AddBody(const EntityHandle& entity, const glm::vec3& position, float radius, float mass);
+
+        // Removes a body of an entity.
+        bool RemoveBody(const EntityHandle& entity);
+
+        // Checks if an entity has a body.
+        bool Contains(const EntityHandle& entity) const;
+
+        // Sets state of a body.
+        bool SetPosition(const EntityHandle& entity, const glm::vec3& position);
+        bool SetVelocity(const EntityHandle& entity, const glm::vec3& velocity);
+
+        // Gets state of a body.
+        // Returns nullptr if the entity has no body.
+        const glm::vec3* GetPosition(const EntityHandle& entity) const;
+        const glm::vec3* GetVelocity(const EntityHandle& entity) const;
+
+        // Advances the simulation by a time step.
+        // Solves islands on the calling thread if no job system is given.
+        void Update(float timeDelta, JobSystem* jobSystem = nullptr);
+
+        // Adds state of all bodies to a checksum.
+        void UpdateChecksum(Checksum& checksum) const;
+
+        // Gets dense arrays of bodies, for copying results into components.
+        const EntityHandle* GetEntities() const;
+        const glm::vec3* GetPositions() const;
+        const glm::vec3* GetVelocities() const;
+
+        // Gets the number of bodies.
+        int GetBodyCount() const;
+
+        // Gets the number of contacts and islands at the last update.
+        int GetContactCount() const;
+        int GetIslandCount() const;
+
+        // Checks if the instance is initialized.
+        bool IsInitialized() const;
+
+    private:
+        // Contact between two bodies.
+        struct Contact
+        {
+            int first;
+            int second;
+            glm::vec3 normal;
+            float penetration;
+            float targetVelocity;
+            float impulse;
+        };
+
+        // Range of sorted contacts of an island.
+        struct Island
+        {
+            int begin;
+            int end;
+        };
+
+        // Type declarations.
+        typedef std::vector<EntityHandle> EntityList;
+        typedef std::vector<glm::vec3> VectorList;
+        typedef std::vector<float> ScalarList;
+        typedef std::vector<int> IndexList;
+        typedef std::vector<Contact> ContactList;
+        typedef std::vector<Island> IslandList;
+
+    private:
+        // Finds the dense index of a body or returns -1.
+        int FindBody(const EntityHandle& entity) const;
+
+        // Creates contacts between overlapping bodies.
+        void FindContacts();
+
+        // Partitions contacts into islands of connected dynamic bodies.
+        void BuildIslands();
+
+        // Finds the root of a body in the island forest.
+        int FindRoot(int body);
+
+        // Solves contacts of an island.
+        void SolveIsland(const Island& island);
+
+        // Called when an entity is destroyed.
+        void OnEntityDestroy(EntitySystem::Events::Destroy event);
+
+    private:
+        // Initialization parameters.
+        PhysicsWorldInfo m_info;
+
+        // Dense body indices indexed by entity handle identifiers.
+        IndexList m_bodyIndices;
+
+        // Dense arrays of body state.
+        EntityList m_entities;
+        VectorList m_positions;
+        VectorList m_velocities;
+        VectorList m_accelerations;
+        ScalarList m_inverseMasses;
+        ScalarList m_radii;
+
+        // Broadphase of body bounds.
+        Broadphase m_broadphase;
+
+        // Contacts of the current update, sorted by islands.
+        ContactList m_contacts;
+        ContactList m_sortedContacts;
+
+        // Island forest of bodies and ranges of contacts of islands.
+        IndexList m_parents;
+        IndexList m_islandIndices;
+        IslandList m_islands;
+
+        // Entity system event receiver.
+        Receiver<void(EntitySystem::Events::Destroy)> m_entityDestroy;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
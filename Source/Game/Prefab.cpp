@@ -0,0 +1,54 @@
+#include "Precompiled.hpp"
+#include "Prefab.hpp"
+using namespace Game;
+
+Prefab::Prefab() :
+    m_signature(0)
+{
+}
+
+void Prefab::Cleanup()
+{
+    // Clear component data.
+    for(ComponentData& data : m_components)
+    {
+        Utility::ClearContainer(data);
+    }
+
+    m_signature = 0;
+}
+
+void Prefab::SetComponentData(int component, const void* data, std::size_t size)
+{
+    Assert(component >= 0 && component < ComponentTypes::MaximumCount, "Invalid component type identifier!");
+
+    // Copy the component value.
+    m_components[component].resize(size);
+    std::memcpy(m_components[component].data(), data, size);
+
+    m_signature |= ComponentTypes::GetSignatureBit(component);
+}
+
+void Prefab::RemoveComponentData(int component)
+{
+    Assert(component >= 0 && component < ComponentTypes::MaximumCount, "Invalid component type identifier!");
+
+    Utility::ClearContainer(m_components[component]);
+
+    m_signature &= ~ComponentTypes::GetSignatureBit(component);
+}
+
+const std::uint8_t* Prefab::GetComponentData(int component) const
+{
+    Assert(component >= 0 && component < ComponentTypes::MaximumCount, "Invalid component type identifier!");
+
+    if(!(m_signature & ComponentTypes::GetSignatureBit(component)))
+        return nullptr;
+
+    return m_components[component].data();
+}
+
+ComponentSignature Prefab::GetSignature() const
+{
+    return m_signature;
+}
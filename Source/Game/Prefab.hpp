@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "ComponentType.hpp"
+
+//
+// Prefab
+//
+//  Prebuilt set of component values that can be instantiated many times.
+//  Instances of a prefab share the same archetype, so their components are
+//  copied straight into archetype chunks. See ComponentSystem::Instantiate().
+//
+//  Example usage:
+//      Game::Prefab bullet;
+//      bullet.SetComponent(Transform());
+//      bullet.SetComponent(Velocity());
+//
+//      EntityHandle bullets[256];
+//      componentSystem.Instantiate(bullet, 256, &bullets[0]);
+//
+
+namespace Game
+{
+    // Prefab class.
+    class Prefab
+    {
+    public:
+        Prefab();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Sets or replaces a component value.
+        template<typename Type>
+        void SetComponent(const Type& component);
+
+        // Removes a component value.
+        template<typename Type>
+        void RemoveComponent();
+
+        // Gets the data of a component type or nullptr if not set.
+        const std::uint8_t* GetComponentData(int component) const;
+
+        // Gets the signature of set components.
+        ComponentSignature GetSignature() const;
+
+    private:
+        // Sets the data of a component type.
+        void SetComponentData(int component, const void* data, std::size_t size);
+
+        // Removes the data of a component type.
+        void RemoveComponentData(int component);
+
+    private:
+        // Type declarations.
+        typedef std::vector<std::uint8_t> ComponentData;
+
+    private:
+        // Set of component types.
+        ComponentSignature m_signature;
+
+        // Data of each component type.
+        ComponentData m_components[ComponentTypes::MaximumCount];
+    };
+}
+
+// Template implementations.
+namespace Game
+{
+    template<typename Type>
+    void Prefab::SetComponent(const Type& component)
+    {
+        this->SetComponentData(ComponentTypes::GetIdentifier<Type>(), &component, sizeof(Type));
+    }
+
+    template<typename Type>
+    void Prefab::RemoveComponent()
+    {
+        this->RemoveComponentData(ComponentTypes::GetIdentifier<Type>());
+    }
+}
@@ -0,0 +1,271 @@
+#include "Precompiled.hpp"
+#include "RollbackBuffer.hpp"
+using namespace Game;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize a rollback buffer! "
+    #define LogSaveError() "Failed to save a rollback tick! "
+    #define LogRestoreError() "Failed to restore a rollback tick! "
+}
+
+RollbackBufferInfo::RollbackBufferInfo() :
+    entitySystem(nullptr),
+    componentSystem(nullptr),
+    tickCount(8)
+{
+}
+
+RollbackBuffer::RollbackBuffer() :
+    m_copiedSize(0),
+    m_initialized(false)
+{
+}
+
+RollbackBuffer::~RollbackBuffer()
+{
+    this->Cleanup();
+}
+
+void RollbackBuffer::Cleanup()
+{
+    Utility::ClearContainer(m_slots);
+
+    m_copiedSize = 0;
+
+    // Reset initialization parameters.
+    m_info = RollbackBufferInfo();
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool RollbackBuffer::Initialize(const RollbackBufferInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.entitySystem == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid entity system.";
+        return false;
+    }
+
+    if(info.componentSystem == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid component system.";
+        return false;
+    }
+
+    if(info.tickCount <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid tick count.";
+        return false;
+    }
+
+    m_info = info;
+
+    // Create the ring of slots.
+    m_slots.resize(m_info.tickCount);
+
+    // Success!
+    return m_initialized = true;
+}
+
+bool RollbackBuffer::Save(Tick tick)
+{
+    Assert(m_initialized, "Rollback buffer is not initialized!");
+
+    if(!m_info.componentSystem->m_commands.empty())
+    {
+        LogError() << LogSaveError() << "There are unprocessed component commands left.";
+        return false;
+    }
+
+    Slot& slot = this->GetSlot(tick);
+
+    // Serialize the handle table into memory kept from earlier saves.
+    slot.entityState.clear();
+    BinaryWriter writer(slot.entityState);
+
+    if(!m_info.entitySystem->SaveSnapshot(writer))
+    {
+        LogError() << LogSaveError() << "Couldn't save the entity system.";
+        slot.valid = false;
+        return false;
+    }
+
+    // Copy chunks changed since the slot was last written.
+    this->SaveChunks(slot);
+
+    // Changes made after this point are stamped with a greater tick.
+    slot.tick = tick;
+    slot.changeTick = m_info.componentSystem->AdvanceTick();
+    slot.valid = true;
+
+    return true;
+}
+
+bool RollbackBuffer::Restore(Tick tick)
+{
+    Assert(m_initialized, "Rollback buffer is not initialized!");
+
+    if(!this->HasTick(tick))
+    {
+        LogError() << LogRestoreError() << "Tick " << tick << " is not saved.";
+        return false;
+    }
+
+    if(!m_info.componentSystem->m_commands.empty())
+    {
+        LogError() << LogRestoreError() << "There are unprocessed component commands left.";
+        return false;
+    }
+
+    const Slot& slot = this->GetSlot(tick);
+
+    // Restore the handle table with its free list.
+    BinaryReader reader(slot.entityState.data(), slot.entityState.size());
+
+    if(!m_info.entitySystem->RestoreSnapshot(reader))
+    {
+        LogError() << LogRestoreError() << "Couldn't restore the entity system.";
+        return false;
+    }
+
+    // Copy back chunks changed since the tick was saved.
+    this->RestoreChunks(slot);
+
+    // Discard later ticks, which are going to be simulated again.
+    for(Slot& other : m_slots)
+    {
+        if(other.valid && other.tick > tick)
+        {
+            other.valid = false;
+        }
+    }
+
+    return true;
+}
+
+bool RollbackBuffer::HasTick(Tick tick) const
+{
+    if(!m_initialized)
+        return false;
+
+    const Slot& slot = m_slots[tick % m_slots.size()];
+    return slot.valid && slot.tick == tick;
+}
+
+std::size_t RollbackBuffer::GetCopiedSize() const
+{
+    return m_copiedSize;
+}
+
+RollbackBuffer::Slot& RollbackBuffer::GetSlot(Tick tick)
+{
+    return m_slots[tick % m_slots.size()];
+}
+
+void RollbackBuffer::SaveChunks(Slot& slot)
+{
+    ComponentSystem& componentSystem = *m_info.componentSystem;
+
+    // Archetypes are only ever added, so indices of saved ones stay the same.
+    slot.archetypes.resize(componentSystem.m_archetypes.size());
+
+    m_copiedSize = 0;
+
+    for(std::size_t i = 0; i < componentSystem.m_archetypes.size(); ++i)
+    {
+        const ComponentSystem::Archetype& archetype = *componentSystem.m_archetypes[i];
+        SavedArchetype& saved = slot.archetypes[i];
+
+        std::size_t chunkSize = ComponentSystem::GetChunkSize(archetype);
+        std::size_t savedCount = saved.counts.size();
+
+        // Grow saved memory, but never shrink it.
+        if(saved.memory.size() < chunkSize * archetype.chunks.size())
+        {
+            saved.memory.resize(chunkSize * archetype.chunks.size());
+        }
+
+        saved.counts.resize(archetype.chunks.size());
+
+        for(std::size_t j = 0; j < archetype.chunks.size(); ++j)
+        {
+            const ComponentSystem::Chunk& chunk = archetype.chunks[j];
+            saved.counts[j] = chunk.count;
+
+            // Copies of unchanged chunks are still up to date.
+            if(j < savedCount && chunk.changeTick <= slot.changeTick)
+                continue;
+
+            std::memcpy(saved.memory.data() + chunkSize * j, chunk.memory.get(), chunkSize);
+            m_copiedSize += chunkSize;
+        }
+    }
+}
+
+void RollbackBuffer::RestoreChunks(const Slot& slot)
+{
+    ComponentSystem& componentSystem = *m_info.componentSystem;
+
+    m_copiedSize = 0;
+
+    for(std::size_t i = 0; i < componentSystem.m_archetypes.size(); ++i)
+    {
+        ComponentSystem::Archetype& archetype = *componentSystem.m_archetypes[i];
+
+        // Archetypes created after the tick was saved had no entities.
+        if(i >= slot.archetypes.size())
+        {
+            archetype.chunks.clear();
+            archetype.entityCount = 0;
+            continue;
+        }
+
+        const SavedArchetype& saved = slot.archetypes[i];
+
+        std::size_t chunkSize = ComponentSystem::GetChunkSize(archetype);
+        std::size_t chunkCount = saved.counts.size();
+
+        // Match the number of chunks, which frees or allocates them.
+        std::size_t existingCount = std::min(archetype.chunks.size(), chunkCount);
+        archetype.chunks.erase(archetype.chunks.begin() + existingCount, archetype.chunks.end());
+
+        while(archetype.chunks.size() < chunkCount)
+        {
+            ComponentSystem::Chunk chunk;
+            chunk.memory = componentSystem.AllocateChunk(chunkSize);
+            chunk.count = 0;
+            chunk.changeTick = componentSystem.m_tick;
+
+            archetype.chunks.push_back(std::move(chunk));
+        }
+
+        // Copy back chunks that changed after the tick was saved.
+        archetype.entityCount = 0;
+
+        for(std::size_t j = 0; j < chunkCount; ++j)
+        {
+            ComponentSystem::Chunk& chunk = archetype.chunks[j];
+
+            if(j >= existingCount || chunk.changeTick > slot.changeTick)
+            {
+                std::memcpy(chunk.memory.get(), saved.memory.data() + chunkSize * j, chunkSize);
+                m_copiedSize += chunkSize;
+
+                // Other slots may hold different copies of restored chunks.
+                chunk.changeTick = componentSystem.m_tick;
+            }
+
+            chunk.count = saved.counts[j];
+            archetype.entityCount += chunk.count;
+        }
+    }
+
+    componentSystem.RebuildLocations();
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "EntitySystem.hpp"
+#include "ComponentSystem.hpp"
+
+//
+// Rollback Buffer
+//
+//  Holds the state of entity and component systems for the last ticks of
+//  a deterministic simulation, so netcode can restore a past tick when late
+//  input arrives and simulate forward again. Ticks are stored in a ring of
+//  slots, where each slot keeps a full copy of every chunk and the handle
+//  table including the free list, so restored entities reuse the same
+//  handles when they are created again.
+//
+//  Saving a tick overwrites the slot of the tick a ring length ago. Chunks
+//  that did not change since that slot was written are already up to date
+//  and are skipped, based on change ticks of the component system. Memory
+//  of slots is kept between saves, so saving stops allocating once slots
+//  have grown to the size of the world. Restoring copies back only chunks
+//  that changed since the restored tick was saved.
+//
+//  Restoring replaces state without dispatching entity or component events,
+//  so only state stored in both systems is rolled back. Commands of both
+//  systems must be processed before saving and restoring. The buffer has
+//  to be initialized again after either system is cleaned up.
+//
+//  Example usage:
+//      Game::RollbackBufferInfo info;
+//      info.entitySystem = &entitySystem;
+//      info.componentSystem = &componentSystem;
+//      info.tickCount = 8;
+//
+//      Game::RollbackBuffer rollback;
+//      rollback.Initialize(info);
+//
+//      while(gameLoop.Tick())
+//      {
+//          if(lateInputTick < currentTick && rollback.Restore(lateInputTick))
+//          {
+//              for(std::uint64_t tick = lateInputTick; tick < currentTick; ++tick)
+//              {
+//                  /* Simulate the tick again and save it. */
+//              }
+//          }
+//
+//          rollback.Save(currentTick);
+//          /* Simulate the current tick. */
+//      }
+//
+
+namespace Game
+{
+    // Rollback buffer initialization struct.
+    struct RollbackBufferInfo
+    {
+        // Systems whose state is saved.
+        EntitySystem* entitySystem;
+        ComponentSystem* componentSystem;
+
+        // Number of ticks that can be rolled back.
+        int tickCount;
+
+        RollbackBufferInfo();
+    };
+
+    // Rollback buffer class.
+    class RollbackBuffer : private NonCopyable
+    {
+    public:
+        // Type declarations.
+        typedef std::uint64_t Tick;
+
+    public:
+        RollbackBuffer();
+        ~RollbackBuffer();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the rollback buffer.
+        bool Initialize(const RollbackBufferInfo& info);
+
+        // Saves the state of both systems at a simulation tick.
+        // Overwrites the tick saved a ring length ago.
+        bool Save(Tick tick);
+
+        // Restores the state of both systems at a saved simulation tick.
+        // Later ticks are discarded, as they are simulated again.
+        bool Restore(Tick tick);
+
+        // Checks if a simulation tick can be restored.
+        bool HasTick(Tick tick) const;
+
+        // Gets the number of chunk bytes copied by the last save or restore.
+        std::size_t GetCopiedSize() const;
+
+    private:
+        // Chunks of an archetype saved in a slot.
+        struct SavedArchetype
+        {
+            std::vector<std::uint8_t> memory;
+            std::vector<int> counts;
+        };
+
+        // State of a saved tick.
+        struct Slot
+        {
+            Slot() :
+                tick(0),
+                changeTick(0),
+                valid(false)
+            {
+            }
+
+            // Simulation tick and the component system tick it was saved at.
+            Tick tick;
+            ComponentSystem::Tick changeTick;
+            bool valid;
+
+            // Serialized entity system and copies of chunks.
+            std::vector<std::uint8_t> entityState;
+            std::vector<SavedArchetype> archetypes;
+        };
+
+        // Type declarations.
+        typedef std::vector<Slot> SlotList;
+
+    private:
+        // Gets the slot of a simulation tick.
+        Slot& GetSlot(Tick tick);
+
+        // Copies changed chunks into a slot.
+        void SaveChunks(Slot& slot);
+
+        // Copies changed chunks back from a slot and rebuilds entity locations.
+        void RestoreChunks(const Slot& slot);
+
+    private:
+        // Initialization parameters.
+        RollbackBufferInfo m_info;
+
+        // Ring of saved ticks.
+        SlotList m_slots;
+
+        // Statistics of the last save or restore.
+        std::size_t m_copiedSize;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,665 @@
+#include "Precompiled.hpp"
+#include "SessionRecording.hpp"
+#include "WorldSnapshot.hpp"
+using namespace Game;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeRecorderError() "Failed to initialize the session recorder! "
+    #define LogInitializePlayerError() "Failed to initialize the session player! "
+    #define LogSaveError(filename) "Failed to save a recorded session \"" << filename << "\"! "
+    #define LogPlayError() "Failed to play back a recorded session! "
+    #define LogSeekError() "Failed to seek a recorded session! "
+
+    // File format identification.
+    const std::uint32_t FileMagic   = 0x4E534553; // "SESN"
+    const std::uint32_t FileVersion = 4;
+}
+
+SessionRecorderInfo::SessionRecorderInfo() :
+    window(nullptr),
+    entitySystem(nullptr),
+    componentSystem(nullptr),
+    gameLoop(nullptr),
+    keyframeInterval(0)
+{
+}
+
+SessionRecorder::SessionRecorder() :
+    m_writer(m_buffer),
+    m_frameEnd(0),
+    m_frameCount(0),
+    m_entitySystem(nullptr),
+    m_componentSystem(nullptr),
+    m_gameLoop(nullptr),
+    m_keyframeInterval(0),
+    m_initialized(false)
+{
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    this->Cleanup();
+}
+
+void SessionRecorder::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Unsubscribe from recorded events.
+    m_windowMove.Cleanup();
+    m_windowResize.Cleanup();
+    m_windowFocus.Cleanup();
+    m_windowClose.Cleanup();
+    m_keyboardKey.Cleanup();
+    m_textInput.Cleanup();
+    m_mouseButton.Cleanup();
+    m_mouseScroll.Cleanup();
+    m_cursorPosition.Cleanup();
+    m_cursorEnter.Cleanup();
+
+    m_entityCreateBatch.Cleanup();
+    m_entityDestroyBatch.Cleanup();
+
+    // Clear the recorded log.
+    Utility::ClearContainer(m_buffer);
+
+    m_frameEnd = 0;
+    m_frameCount = 0;
+
+    // Clear recorded keyframes.
+    m_entitySystem = nullptr;
+    m_componentSystem = nullptr;
+    m_gameLoop = nullptr;
+
+    Utility::ClearContainer(m_keyframes);
+    Utility::ClearContainer(m_snapshot);
+    m_keyframeInterval = 0;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool SessionRecorder::Initialize(const SessionRecorderInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.window == nullptr && info.entitySystem == nullptr)
+    {
+        LogError() << LogInitializeRecorderError() << "Nothing to record.";
+        return false;
+    }
+
+    if(info.keyframeInterval < 0)
+    {
+        LogError() << LogInitializeRecorderError() << "Invalid keyframe interval.";
+        return false;
+    }
+
+    if(info.keyframeInterval > 0 && (info.entitySystem == nullptr || info.componentSystem == nullptr))
+    {
+        LogError() << LogInitializeRecorderError() << "Keyframes need entity and component systems.";
+        return false;
+    }
+
+    // Subscribe to window events.
+    if(info.window != nullptr)
+    {
+        typedef System::Window::Events Events;
+
+        m_windowMove.Bind<SessionRecorder, &SessionRecorder::OnWindowEvent<Events::Move, SessionRecords::WindowMove>>(this);
+        m_windowResize.Bind<SessionRecorder, &SessionRecorder::OnWindowEvent<Events::Resize, SessionRecords::WindowResize>>(this);
+        m_windowFocus.Bind<SessionRecorder, &SessionRecorder::OnWindowEvent<Events::Focus, SessionRecords::WindowFocus>>(this);
+        m_windowClose.Bind<SessionRecorder, &SessionRecorder::OnWindowEvent<Events::Close, SessionRecords::WindowClose>>(this);
+        m_keyboardKey.Bind<SessionRecorder, &SessionRecorder::OnWindowEvent<Events::KeyboardKey, SessionRecords::KeyboardKey>>(this);
+        m_textInput.Bind<SessionRecorder, &SessionRecorder::OnWindowEvent<Events::TextInput, SessionRecords::TextInput>>(this);
+        m_mouseButton.Bind<SessionRecorder, &SessionRecorder::OnWindowEvent<Events::MouseButton, SessionRecords::MouseButton>>(this);
+        m_mouseScroll.Bind<SessionRecorder, &SessionRecorder::OnWindowEvent<Events::MouseScroll, SessionRecords::MouseScroll>>(this);
+        m_cursorPosition.Bind<SessionRecorder, &SessionRecorder::OnWindowEvent<Events::CursorPosition, SessionRecords::CursorPosition>>(this);
+        m_cursorEnter.Bind<SessionRecorder, &SessionRecorder::OnWindowEvent<Events::CursorEnter, SessionRecords::CursorEnter>>(this);
+
+        // Record events before other receivers can react to them.
+        const int Priority = std::numeric_limits<int>::max();
+
+        m_windowMove.Subscribe(info.window->events.move, Priority);
+        m_windowResize.Subscribe(info.window->events.resize, Priority);
+        m_windowFocus.Subscribe(info.window->events.focus, Priority);
+        m_windowClose.Subscribe(info.window->events.close, Priority);
+        m_keyboardKey.Subscribe(info.window->events.keyboardKey, Priority);
+        m_textInput.Subscribe(info.window->events.textInput, Priority);
+        m_mouseButton.Subscribe(info.window->events.mouseButton, Priority);
+        m_mouseScroll.Subscribe(info.window->events.mouseScroll, Priority);
+        m_cursorPosition.Subscribe(info.window->events.cursorPosition, Priority);
+        m_cursorEnter.Subscribe(info.window->events.cursorEnter, Priority);
+    }
+
+    // Subscribe to entity batch events.
+    if(info.entitySystem != nullptr)
+    {
+        m_entityCreateBatch.Bind<SessionRecorder, &SessionRecorder::OnCreateBatch>(this);
+        m_entityCreateBatch.Subscribe(info.entitySystem->events.createBatch);
+
+        m_entityDestroyBatch.Bind<SessionRecorder, &SessionRecorder::OnDestroyBatch>(this);
+        m_entityDestroyBatch.Subscribe(info.entitySystem->events.destroyBatch);
+    }
+
+    m_entitySystem = info.entitySystem;
+    m_componentSystem = info.componentSystem;
+    m_gameLoop = info.gameLoop;
+    m_keyframeInterval = info.keyframeInterval;
+
+    // Success!
+    return m_initialized = true;
+}
+
+void SessionRecorder::RecordChecksum(std::uint64_t checksum)
+{
+    if(!m_initialized)
+        return;
+
+    m_writer.Write<SessionRecords::Type>(SessionRecords::StateChecksum);
+    m_writer.Write(checksum);
+}
+
+void SessionRecorder::EndFrame(double frameTime)
+{
+    if(!m_initialized)
+        return;
+
+    m_writer.Write<SessionRecords::Type>(SessionRecords::Frame);
+    m_writer.Write(frameTime);
+
+    m_frameEnd = m_buffer.size();
+    m_frameCount += 1;
+
+    if(m_keyframeInterval > 0 && m_frameCount % m_keyframeInterval == 0)
+    {
+        this->RecordKeyframe();
+    }
+}
+
+void SessionRecorder::RecordKeyframe()
+{
+    // Write the snapshot aside, so a failed one leaves no partial record behind.
+    m_snapshot.clear();
+    BinaryWriter writer(m_snapshot);
+
+    if(!WorldSnapshot::Write(writer, *m_entitySystem, *m_componentSystem))
+    {
+        LogWarning() << "Skipped a keyframe of the recorded session at frame " << m_frameCount << ".";
+        return;
+    }
+
+    // Pad the snapshot, so records after it stay aligned when seeking.
+    writer.Align();
+
+    SessionKeyframe keyframe;
+    keyframe.frame = m_frameCount;
+    keyframe.reserved = 0;
+    keyframe.tickIndex = m_gameLoop ? m_gameLoop->GetTickIndex() : 0;
+    keyframe.accumulator = m_gameLoop ? m_gameLoop->GetAccumulator() : 0.0;
+    keyframe.size = m_snapshot.size();
+
+    // Arrays of the snapshot are aligned relative to its beginning.
+    m_writer.Write<SessionRecords::Type>(SessionRecords::Keyframe);
+    m_writer.Write<std::uint64_t>(keyframe.size);
+    m_writer.Align();
+
+    keyframe.offset = m_buffer.size();
+    m_writer.WriteBytes(m_snapshot.data(), m_snapshot.size());
+
+    m_keyframes.push_back(keyframe);
+
+    // Keyframes belong to the end of the frame.
+    m_frameEnd = m_buffer.size();
+}
+
+bool SessionRecorder::Save(std::string filename) const
+{
+    if(!m_initialized)
+        return false;
+
+    // Write the file header.
+    std::vector<std::uint8_t> header;
+    BinaryWriter writer(header);
+
+    writer.Write(FileMagic);
+    writer.Write(FileVersion);
+    writer.Write<std::int32_t>(m_frameCount);
+    writer.WriteArray(m_keyframes.data(), m_keyframes.size());
+
+    // Start the log aligned, so offsets of keyframes are aligned in the file.
+    writer.Align();
+
+    // Write the header and the log up to the last ended frame.
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+
+    if(!file)
+    {
+        LogError() << LogSaveError(filename) << "Couldn't open the file.";
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+    file.write(reinterpret_cast<const char*>(m_buffer.data()), m_frameEnd);
+
+    if(!file)
+    {
+        LogError() << LogSaveError(filename) << "Couldn't write to the file.";
+        return false;
+    }
+
+    return true;
+}
+
+int SessionRecorder::GetFrameCount() const
+{
+    return m_frameCount;
+}
+
+int SessionRecorder::GetKeyframeCount() const
+{
+    return (int)m_keyframes.size();
+}
+
+std::size_t SessionRecorder::GetSize() const
+{
+    return m_buffer.size();
+}
+
+template<typename Event, SessionRecords::Record Record>
+void SessionRecorder::OnWindowEvent(const Event& event)
+{
+    m_writer.Write<SessionRecords::Type>(Record);
+    m_writer.Write(event);
+}
+
+void SessionRecorder::OnCreateBatch(EntitySystem::Events::CreateBatch event)
+{
+    // Handles are not written, as replayed entities get the same handles
+    // from an entity system that starts in the same state.
+    m_writer.Write<SessionRecords::Type>(SessionRecords::CreateEntities);
+    m_writer.Write<std::int32_t>(event.count);
+}
+
+void SessionRecorder::OnDestroyBatch(EntitySystem::Events::DestroyBatch event)
+{
+    m_writer.Write<SessionRecords::Type>(SessionRecords::DestroyEntities);
+    m_writer.Write<std::int32_t>(event.count);
+    m_writer.WriteBytes(event.handles, sizeof(EntityHandle) * event.count);
+}
+
+SessionPlayerInfo::SessionPlayerInfo() :
+    window(nullptr),
+    entitySystem(nullptr),
+    componentSystem(nullptr),
+    gameLoop(nullptr)
+{
+}
+
+SessionPlayer::SessionPlayer() :
+    m_window(nullptr),
+    m_entitySystem(nullptr),
+    m_componentSystem(nullptr),
+    m_gameLoop(nullptr),
+    m_log(nullptr),
+    m_logSize(0),
+    m_keyframes(nullptr),
+    m_keyframeCount(0),
+    m_frameCount(0),
+    m_frameTotal(0),
+    m_checksum(0),
+    m_hasChecksum(false),
+    m_initialized(false)
+{
+}
+
+SessionPlayer::~SessionPlayer()
+{
+    this->Cleanup();
+}
+
+void SessionPlayer::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Close the session log.
+    m_reader.reset();
+    m_file.Cleanup();
+
+    m_log = nullptr;
+    m_logSize = 0;
+
+    m_keyframes = nullptr;
+    m_keyframeCount = 0;
+
+    m_window = nullptr;
+    m_entitySystem = nullptr;
+    m_componentSystem = nullptr;
+    m_gameLoop = nullptr;
+
+    Utility::ClearContainer(m_handles);
+
+    m_frameCount = 0;
+    m_frameTotal = 0;
+
+    m_checksum = 0;
+    m_hasChecksum = false;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool SessionPlayer::Initialize(const SessionPlayerInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Map the session log into memory.
+    if(!m_file.Open(info.filename))
+    {
+        LogError() << LogInitializePlayerError() << "Couldn't map the file \"" << info.filename << "\".";
+        return false;
+    }
+
+    BinaryReader header(m_file.GetData(), m_file.GetSize());
+
+    // Check the file format.
+    std::uint32_t magic = 0;
+    std::uint32_t version = 0;
+    std::int32_t frameTotal = 0;
+
+    header.Read(magic);
+    header.Read(version);
+    header.Read(frameTotal);
+
+    std::size_t keyframeCount = 0;
+    const SessionKeyframe* keyframes = header.ReadArray<SessionKeyframe>(keyframeCount);
+    header.Align();
+
+    if(!header.IsValid() || magic != FileMagic || version != FileVersion || frameTotal < 0)
+    {
+        LogError() << LogInitializePlayerError() << "Invalid file format.";
+
+        m_file.Cleanup();
+        return false;
+    }
+
+    // Records of the log start after the header.
+    const std::uint8_t* log = static_cast<const std::uint8_t*>(m_file.GetData()) + header.GetOffset();
+    std::size_t logSize = m_file.GetSize() - header.GetOffset();
+
+    // Check that keyframes are ordered and lie within the log.
+    for(std::size_t i = 0; i < keyframeCount; ++i)
+    {
+        const SessionKeyframe& keyframe = keyframes[i];
+
+        bool isValid = keyframe.frame > 0 && keyframe.frame <= frameTotal;
+        isValid = isValid && (i == 0 || keyframes[i - 1].frame < keyframe.frame);
+        isValid = isValid && keyframe.offset % BinaryReader::Alignment == 0 && keyframe.size % BinaryReader::Alignment == 0;
+        isValid = isValid && keyframe.offset <= logSize && keyframe.size <= logSize - keyframe.offset;
+
+        if(!isValid)
+        {
+            LogError() << LogInitializePlayerError() << "Invalid keyframe index.";
+
+            m_file.Cleanup();
+            return false;
+        }
+    }
+
+    m_log = log;
+    m_logSize = logSize;
+    m_reader.reset(new BinaryReader(m_log, m_logSize));
+
+    m_keyframes = keyframes;
+    m_keyframeCount = keyframeCount;
+
+    m_window = info.window;
+    m_entitySystem = info.entitySystem;
+    m_componentSystem = info.componentSystem;
+    m_gameLoop = info.gameLoop;
+    m_frameTotal = frameTotal;
+
+    // Success!
+    return m_initialized = true;
+}
+
+bool SessionPlayer::PlayFrame(double& frameTime)
+{
+    if(!m_initialized)
+        return false;
+
+    // Check if all frames have been played.
+    if(m_frameCount == m_frameTotal)
+        return false;
+
+    // Play back records until the end of the frame.
+    SessionRecords::Type record = 0;
+    m_hasChecksum = false;
+
+    while(m_reader->Read(record))
+    {
+        switch(record)
+        {
+        case SessionRecords::Frame:
+            if(!m_reader->Read(frameTime))
+                break;
+
+            m_frameCount += 1;
+            return true;
+
+        case SessionRecords::WindowMove:
+            this->ReplayWindowEvent(m_window ? &m_window->events.move : nullptr);
+            break;
+
+        case SessionRecords::WindowResize:
+            this->ReplayWindowEvent(m_window ? &m_window->events.resize : nullptr);
+            break;
+
+        case SessionRecords::WindowFocus:
+            this->ReplayWindowEvent(m_window ? &m_window->events.focus : nullptr);
+            break;
+
+        case SessionRecords::WindowClose:
+            this->ReplayWindowEvent(m_window ? &m_window->events.close : nullptr);
+            break;
+
+        case SessionRecords::KeyboardKey:
+            this->ReplayWindowEvent(m_window ? &m_window->events.keyboardKey : nullptr);
+            break;
+
+        case SessionRecords::TextInput:
+            this->ReplayWindowEvent(m_window ? &m_window->events.textInput : nullptr);
+            break;
+
+        case SessionRecords::MouseButton:
+            this->ReplayWindowEvent(m_window ? &m_window->events.mouseButton : nullptr);
+            break;
+
+        case SessionRecords::MouseScroll:
+            this->ReplayWindowEvent(m_window ? &m_window->events.mouseScroll : nullptr);
+            break;
+
+        case SessionRecords::CursorPosition:
+            this->ReplayWindowEvent(m_window ? &m_window->events.cursorPosition : nullptr);
+            break;
+
+        case SessionRecords::CursorEnter:
+            this->ReplayWindowEvent(m_window ? &m_window->events.cursorEnter : nullptr);
+            break;
+
+        case SessionRecords::CreateEntities:
+            {
+                std::int32_t count = 0;
+
+                if(!m_reader->Read(count) || count < 0)
+                    break;
+
+                if(m_entitySystem != nullptr && count > 0)
+                {
+                    m_handles.resize(count);
+                    m_entitySystem->CreateEntities(count, m_handles.data());
+                }
+            }
+            break;
+
+        case SessionRecords::DestroyEntities:
+            {
+                std::int32_t count = 0;
+
+                if(!m_reader->Read(count) || count < 0)
+                    break;
+
+                const void* handles = m_reader->ReadBytes(sizeof(EntityHandle) * count);
+
+                if(handles == nullptr)
+                    break;
+
+                if(m_entitySystem != nullptr && count > 0)
+                {
+                    m_handles.resize(count);
+                    std::memcpy(m_handles.data(), handles, sizeof(EntityHandle) * count);
+                    m_entitySystem->DestroyEntities(m_handles.data(), count);
+                }
+            }
+            break;
+
+        case SessionRecords::StateChecksum:
+            if(!m_reader->Read(m_checksum))
+                break;
+
+            m_hasChecksum = true;
+            break;
+
+        case SessionRecords::Keyframe:
+            {
+                // Keyframes are only read when seeking.
+                std::uint64_t size = 0;
+
+                if(!m_reader->Read(size))
+                    break;
+
+                m_reader->Align();
+                m_reader->ReadBytes((std::size_t)size);
+            }
+            break;
+
+        default:
+            LogError() << LogPlayError() << "Unknown record type.";
+            return false;
+        }
+
+        if(!m_reader->IsValid())
+            break;
+    }
+
+    // Log ended before the last frame.
+    LogError() << LogPlayError() << "Log is truncated.";
+    return false;
+}
+
+bool SessionPlayer::Seek(int frame)
+{
+    if(!m_initialized)
+        return false;
+
+    if(frame < 0 || frame > m_frameTotal)
+    {
+        LogError() << LogSeekError() << "Frame " << frame << " is out of range.";
+        return false;
+    }
+
+    // Find the last keyframe at or before the frame.
+    const SessionKeyframe* keyframe = nullptr;
+
+    for(std::size_t i = 0; i < m_keyframeCount && m_keyframes[i].frame <= frame; ++i)
+    {
+        keyframe = &m_keyframes[i];
+    }
+
+    // Keep playing from the current position if no keyframe is closer.
+    if(frame >= m_frameCount && (keyframe == nullptr || keyframe->frame <= m_frameCount))
+        return true;
+
+    if(keyframe == nullptr)
+    {
+        LogError() << LogSeekError() << "There is no keyframe before frame " << frame << ".";
+        return false;
+    }
+
+    if(m_entitySystem == nullptr || m_componentSystem == nullptr)
+    {
+        LogError() << LogSeekError() << "Keyframes need entity and component systems.";
+        return false;
+    }
+
+    // Replace the world with the state of the keyframe.
+    m_entitySystem->DestroyAllEntities();
+    m_componentSystem->ProcessCommands();
+
+    BinaryReader reader(m_log + keyframe->offset, (std::size_t)keyframe->size);
+
+    if(!WorldSnapshot::Read(reader, *m_entitySystem, *m_componentSystem))
+    {
+        LogError() << LogSeekError() << "Couldn't restore the keyframe at frame " << keyframe->frame << ".";
+        return false;
+    }
+
+    if(m_gameLoop != nullptr)
+    {
+        m_gameLoop->Restore(keyframe->tickIndex, keyframe->accumulator);
+    }
+
+    // Continue with records that follow the keyframe.
+    std::size_t resume = (std::size_t)(keyframe->offset + keyframe->size);
+    m_reader.reset(new BinaryReader(m_log + resume, m_logSize - resume));
+
+    m_frameCount = keyframe->frame;
+    m_hasChecksum = false;
+
+    return true;
+}
+
+int SessionPlayer::GetFrameCount() const
+{
+    return m_frameCount;
+}
+
+int SessionPlayer::GetFrameTotal() const
+{
+    return m_frameTotal;
+}
+
+int SessionPlayer::GetKeyframeCount() const
+{
+    return (int)m_keyframeCount;
+}
+
+bool SessionPlayer::GetChecksum(std::uint64_t& checksum) const
+{
+    if(!m_hasChecksum)
+        return false;
+
+    checksum = m_checksum;
+    return true;
+}
+
+template<typename Event>
+void SessionPlayer::ReplayWindowEvent(Dispatcher<void(const Event&)>* dispatcher)
+{
+    Event event;
+
+    if(!m_reader->Read(event))
+        return;
+
+    if(dispatcher != nullptr)
+    {
+        dispatcher->Dispatch(event);
+    }
+}
@@ -0,0 +1,333 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/BinaryStream.hpp"
+#include "Common/MappedFile.hpp"
+#include "System/Window.hpp"
+#include "EntitySystem.hpp"
+#include "ComponentSystem.hpp"
+#include "GameLoop.hpp"
+
+//
+// Session Recording
+//
+//  Records window events and batches of created and destroyed entities into
+//  a compact binary log, split into frames with their measured frame times.
+//  The log can be played back without a window at full speed, dispatching
+//  the same events through the same dispatchers in the same order. Feeding
+//  recorded frame times to the game loop makes the simulation run the exact
+//  same ticks, which gives a repeatable benchmark of a gameplay session.
+//
+//  Entity records replay the outcome of entity commands, so code that
+//  creates or destroys the same entities in response to other events should
+//  not run during playback. Logs are meant to be played back by the same
+//  build that recorded them.
+//
+//  Checksums of simulation state can be recorded with frames. Playback then
+//  exposes the recorded checksum of each frame, so the first frame where
+//  the replayed simulation diverges from the recorded one can be detected.
+//
+//  Keyframes of the world are recorded every number of frames, in the format
+//  of world snapshots along with the tick counters of the game loop. The file
+//  header holds an index of keyframes, so playback can seek to a frame by
+//  restoring the last keyframe before it and simulating forward from there,
+//  instead of from the start of the session. Keyframes only hold state of
+//  entity and component systems, whose commands must be processed before
+//  frames end. Frames that end with pending commands skip their keyframes.
+//
+//  Example usage:
+//      Game::SessionRecorderInfo recorderInfo;
+//      recorderInfo.window = &window;
+//      recorderInfo.entitySystem = &entitySystem;
+//      recorderInfo.componentSystem = &componentSystem;
+//      recorderInfo.gameLoop = &gameLoop;
+//
+//      Game::SessionRecorder recorder;
+//      recorder.Initialize(recorderInfo);
+//
+//      while(window.IsOpen())
+//      {
+//          window.ProcessEvents();
+//          gameLoop.BeginFrame();
+//          /* ... */
+//          recorder.EndFrame(gameLoop.GetFrameTime());
+//      }
+//
+//      recorder.Save("Session.replay");
+//
+//  Playing back a recorded session:
+//      Game::SessionPlayerInfo playerInfo;
+//      playerInfo.filename = "Session.replay";
+//      playerInfo.window = &window;
+//      playerInfo.entitySystem = &entitySystem;
+//      playerInfo.componentSystem = &componentSystem;
+//      playerInfo.gameLoop = &gameLoop;
+//
+//      Game::SessionPlayer player;
+//      player.Initialize(playerInfo);
+//      player.Seek(seekFrame);
+//
+//      double frameTime = 0.0;
+//      while(player.PlayFrame(frameTime))
+//      {
+//          gameLoop.BeginFrame(frameTime);
+//          /* ... */
+//      }
+//
+
+namespace Game
+{
+    // Types of records in a session log.
+    struct SessionRecords
+    {
+        typedef std::uint8_t Type;
+
+        enum Record : Type
+        {
+            // End of a frame followed by its frame time.
+            Frame,
+
+            // Window events followed by their event structs.
+            WindowMove,
+            WindowResize,
+            WindowFocus,
+            WindowClose,
+            KeyboardKey,
+            TextInput,
+            MouseButton,
+            MouseScroll,
+            CursorPosition,
+            CursorEnter,
+
+            // Entity batches followed by the number of entities,
+            // and handles in case of destroyed entities.
+            CreateEntities,
+            DestroyEntities,
+
+            // Checksum of simulation state at the end of a frame.
+            StateChecksum,
+
+            // Keyframe followed by the size of its world snapshot
+            // and the snapshot itself, both aligned to arrays.
+            Keyframe,
+        };
+    };
+
+    // Entry of the keyframe index in the header of a session log.
+    struct SessionKeyframe
+    {
+        // Number of frames played before the keyframe.
+        std::int32_t frame;
+        std::int32_t reserved;
+
+        // Tick counters of the game loop.
+        std::uint64_t tickIndex;
+        double accumulator;
+
+        // Offset and size of the world snapshot in the log.
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    // Session recorder initialization struct.
+    struct SessionRecorderInfo
+    {
+        // Window whose events are recorded, optional.
+        System::Window* window;
+
+        // Entity system whose created and destroyed entities are recorded, optional.
+        EntitySystem* entitySystem;
+
+        // Component system and game loop whose state is saved in keyframes.
+        // Optional, keyframes are only recorded along with the entity system.
+        ComponentSystem* componentSystem;
+        GameLoop* gameLoop;
+
+        // Number of frames between keyframes, or zero to record none.
+        int keyframeInterval;
+
+        SessionRecorderInfo();
+    };
+
+    // Session recorder class.
+    class SessionRecorder : private NonCopyable
+    {
+    public:
+        SessionRecorder();
+        ~SessionRecorder();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the session recorder and starts recording.
+        bool Initialize(const SessionRecorderInfo& info);
+
+        // Records a checksum of simulation state for the current frame.
+        void RecordChecksum(std::uint64_t checksum);
+
+        // Ends the recorded frame with its frame time.
+        void EndFrame(double frameTime);
+
+        // Saves the recorded session to a file.
+        // Records after the last ended frame are not saved.
+        bool Save(std::string filename) const;
+
+        // Gets the number of recorded frames.
+        int GetFrameCount() const;
+
+        // Gets the number of recorded keyframes.
+        int GetKeyframeCount() const;
+
+        // Gets the size of the recorded log in bytes.
+        std::size_t GetSize() const;
+
+    private:
+        // Records a keyframe of the world after the last ended frame.
+        void RecordKeyframe();
+
+        // Records a window event.
+        template<typename Event, SessionRecords::Record Record>
+        void OnWindowEvent(const Event& event);
+
+        // Records entity batches.
+        void OnCreateBatch(EntitySystem::Events::CreateBatch event);
+        void OnDestroyBatch(EntitySystem::Events::DestroyBatch event);
+
+    private:
+        // Recorded log.
+        std::vector<std::uint8_t> m_buffer;
+        BinaryWriter m_writer;
+
+        // Size of the log up to the last ended frame.
+        std::size_t m_frameEnd;
+
+        // Number of recorded frames.
+        int m_frameCount;
+
+        // Systems whose state is saved in keyframes.
+        EntitySystem* m_entitySystem;
+        ComponentSystem* m_componentSystem;
+        GameLoop* m_gameLoop;
+
+        // Recorded keyframes and the snapshot being written.
+        std::vector<SessionKeyframe> m_keyframes;
+        std::vector<std::uint8_t> m_snapshot;
+        int m_keyframeInterval;
+
+        // Window event receivers.
+        Receiver<void(const System::Window::Events::Move&)> m_windowMove;
+        Receiver<void(const System::Window::Events::Resize&)> m_windowResize;
+        Receiver<void(const System::Window::Events::Focus&)> m_windowFocus;
+        Receiver<void(const System::Window::Events::Close&)> m_windowClose;
+        Receiver<void(const System::Window::Events::KeyboardKey&)> m_keyboardKey;
+        Receiver<void(const System::Window::Events::TextInput&)> m_textInput;
+        Receiver<void(const System::Window::Events::MouseButton&)> m_mouseButton;
+        Receiver<void(const System::Window::Events::MouseScroll&)> m_mouseScroll;
+        Receiver<void(const System::Window::Events::CursorPosition&)> m_cursorPosition;
+        Receiver<void(const System::Window::Events::CursorEnter&)> m_cursorEnter;
+
+        // Entity system event receivers.
+        Receiver<void(EntitySystem::Events::CreateBatch)> m_entityCreateBatch;
+        Receiver<void(EntitySystem::Events::DestroyBatch)> m_entityDestroyBatch;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+
+    // Session player initialization struct.
+    struct SessionPlayerInfo
+    {
+        // Recorded session file.
+        std::string filename;
+
+        // Window whose dispatchers receive recorded events, optional.
+        // Window does not have to be initialized.
+        System::Window* window;
+
+        // Entity system that creates and destroys recorded entities, optional.
+        EntitySystem* entitySystem;
+
+        // Component system and game loop that keyframes are restored into.
+        // Optional, seeking needs them along with the entity system.
+        ComponentSystem* componentSystem;
+        GameLoop* gameLoop;
+
+        SessionPlayerInfo();
+    };
+
+    // Session player class.
+    class SessionPlayer : private NonCopyable
+    {
+    public:
+        SessionPlayer();
+        ~SessionPlayer();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the session player and opens a recorded session.
+        bool Initialize(const SessionPlayerInfo& info);
+
+        // Plays back records of the next frame and returns its frame time.
+        // Returns false once all frames have been played or the log is invalid.
+        bool PlayFrame(double& frameTime);
+
+        // Seeks towards a frame by restoring the last keyframe before it.
+        // Frames from the keyframe up to the sought one still have to be played
+        // and simulated. Keeps the current position if it is closer to the frame.
+        bool Seek(int frame);
+
+        // Gets the number of played frames.
+        int GetFrameCount() const;
+
+        // Gets the number of recorded frames.
+        int GetFrameTotal() const;
+
+        // Gets the number of keyframes that can be sought to.
+        int GetKeyframeCount() const;
+
+        // Gets the checksum recorded for the last played frame.
+        // Returns false if the frame has no recorded checksum.
+        bool GetChecksum(std::uint64_t& checksum) const;
+
+    private:
+        // Reads a window event and dispatches it.
+        template<typename Event>
+        void ReplayWindowEvent(Dispatcher<void(const Event&)>* dispatcher);
+
+    private:
+        // Type declarations.
+        typedef std::vector<EntityHandle> EntityList;
+
+    private:
+        // Playback targets.
+        System::Window* m_window;
+        EntitySystem* m_entitySystem;
+        ComponentSystem* m_componentSystem;
+        GameLoop* m_gameLoop;
+
+        // Mapped session log, with records that start after the file header.
+        MappedFile m_file;
+        const std::uint8_t* m_log;
+        std::size_t m_logSize;
+        std::unique_ptr<BinaryReader> m_reader;
+
+        // Keyframe index of the mapped file.
+        const SessionKeyframe* m_keyframes;
+        std::size_t m_keyframeCount;
+
+        // Handles of the replayed entity batch.
+        EntityList m_handles;
+
+        // Number of played and recorded frames.
+        int m_frameCount;
+        int m_frameTotal;
+
+        // Checksum recorded for the last played frame.
+        std::uint64_t m_checksum;
+        bool m_hasChecksum;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,507 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/JobSystem.hpp"
+#include "EntityHandle.hpp"
+#include "ComponentPool.hpp"
+
+//
+// Simulation Lod
+//
+//  Lowers the update frequency of components of entities far away from
+//  observers, such as the camera or players. Entities are assigned to tiers
+//  by their distance to the nearest observer, and each tier is updated only
+//  every few ticks. Entities within a tier are spread over its ticks by their
+//  identifiers, so the cost of a far tier is shared evenly between ticks
+//  instead of arriving all at once.
+//
+//  Components of a pool are sorted into buckets by tier and tick, so a tick
+//  only iterates over the contiguous ranges of buckets that are due and never
+//  even touches the rest of the world. Sorting is stable, which keeps any
+//  earlier spatial order of components within a bucket.
+//
+//  Updates receive the time elapsed since the last update of the entity,
+//  which compensates for skipped ticks and remains correct when entities
+//  move between tiers. Tiers are assigned when refreshed, which should be
+//  done every few ticks as entities and observers move. Adding or removing
+//  components refreshes tiers automatically before the next update.
+//
+//  Example usage:
+//      Game::SimulationLodInfo<Animation> info;
+//      info.pool = &animations;
+//      info.position = [&](const EntityHandle& entity, const Animation& animation)
+//      {
+//          return transforms.Get(entity)->position;
+//      };
+//
+//      Game::SimulationLod<Animation> lod;
+//      lod.Initialize(info);
+//
+//      lod.SetObservers(playerPositions.data(), (int)playerPositions.size());
+//      lod.Refresh();
+//
+//      lod.ForEachDue(tick, timeDelta, [](const EntityHandle& entity, Animation& animation, float timeDelta)
+//      {
+//          animation.time += timeDelta;
+//      });
+//
+//  Updating due components from a system of a scheduler:
+//      scheduler.AddSystem("Animation", [&]()
+//      {
+//          lod.ParallelForEachDue(jobSystem, 256, tick, timeDelta, UpdateAnimation);
+//      }, access);
+//
+
+namespace Game
+{
+    // Simulation level of detail tier.
+    struct SimulationLodTier
+    {
+        SimulationLodTier(float distance, int period) :
+            distance(distance),
+            period(period)
+        {
+        }
+
+        // Distance to the nearest observer up to which entities belong to the tier.
+        float distance;
+
+        // Number of ticks between updates of entities in the tier.
+        int period;
+    };
+
+    // Simulation level of detail initialization struct.
+    template<typename Type>
+    struct SimulationLodInfo
+    {
+        // Type declarations.
+        typedef std::function<glm::vec3(const EntityHandle&, const Type&)> PositionFunction;
+        typedef std::vector<SimulationLodTier> TierList;
+
+        // Pool of components updated at lower frequencies.
+        ComponentPool<Type>* pool;
+
+        // Function returning the position of an entity.
+        PositionFunction position;
+
+        // Tiers ordered by increasing distance.
+        // Entities beyond the last tier belong to the last tier.
+        TierList tiers;
+
+        SimulationLodInfo();
+    };
+
+    // Simulation level of detail class.
+    template<typename Type>
+    class SimulationLod : private NonCopyable
+    {
+    public:
+        SimulationLod();
+        ~SimulationLod();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the simulation level of detail.
+        bool Initialize(const SimulationLodInfo<Type>& info);
+
+        // Sets positions of observers.
+        // Without observers all entities belong to the last tier.
+        void SetObservers(const glm::vec3* positions, int count);
+
+        // Assigns entities to tiers and sorts components into buckets.
+        void Refresh();
+
+        // Calls a function for each component due at a tick.
+        // Function receives the time elapsed since the last update of the entity.
+        template<typename Function>
+        void ForEachDue(std::uint64_t tick, float timeDelta, Function function);
+
+        // Calls a function for each component due at a tick from multiple threads.
+        // Function must be safe to call for different components at the same time.
+        template<typename Function>
+        void ParallelForEachDue(JobSystem& jobSystem, int grainSize, std::uint64_t tick, float timeDelta, Function function);
+
+        // Gets the number of tiers.
+        int GetTierCount() const;
+
+        // Gets the number of entities in a tier.
+        int GetTierSize(int tier) const;
+
+        // Gets the number of entities due at a tick.
+        int GetDueCount(std::uint64_t tick) const;
+
+        // Checks if the instance is initialized.
+        bool IsInitialized() const;
+
+    private:
+        // Type declarations.
+        typedef std::vector<glm::vec3> PositionList;
+        typedef std::vector<EntityHandle> EntityList;
+        typedef std::vector<std::uint64_t> TickList;
+        typedef std::vector<int> IndexList;
+
+        // Constant variables.
+        static const std::uint64_t NeverUpdated = ~(std::uint64_t)0;
+
+    private:
+        // Refreshes tiers if components have been added, removed or reordered.
+        void RefreshIfStale();
+
+        // Gets the bucket of a tier due at a tick.
+        int GetDueBucket(int tier, std::uint64_t tick) const;
+
+        // Gets the time elapsed since the last update of an entity and marks it updated.
+        float AdvanceEntity(const EntityHandle& entity, std::uint64_t tick, int period, float timeDelta);
+
+    private:
+        // Initialization parameters.
+        SimulationLodInfo<Type> m_info;
+
+        // Positions of observers.
+        PositionList m_observers;
+
+        // Handles, buckets and last update ticks indexed by entity handle identifiers.
+        EntityList m_entityHandles;
+        IndexList m_entityBuckets;
+        TickList m_updateTicks;
+
+        // First bucket of each tier, followed by the total bucket count.
+        IndexList m_tierBuckets;
+
+        // First dense index of each bucket, followed by the pool size.
+        IndexList m_bucketStarts;
+
+        // Pool epoch at the last refresh.
+        typename ComponentPool<Type>::Epoch m_epoch;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
+
+//
+// Template implementations.
+//
+
+namespace Game
+{
+    template<typename Type>
+    SimulationLodInfo<Type>::SimulationLodInfo() :
+        pool(nullptr)
+    {
+        tiers.push_back(SimulationLodTier(32.0f, 1));
+        tiers.push_back(SimulationLodTier(96.0f, 2));
+        tiers.push_back(SimulationLodTier(std::numeric_limits<float>::infinity(), 4));
+    }
+
+    template<typename Type>
+    SimulationLod<Type>::SimulationLod() :
+        m_epoch(0),
+        m_initialized(false)
+    {
+    }
+
+    template<typename Type>
+    SimulationLod<Type>::~SimulationLod()
+    {
+        this->Cleanup();
+    }
+
+    template<typename Type>
+    void SimulationLod<Type>::Cleanup()
+    {
+        if(!m_initialized)
+            return;
+
+        // Clear buckets.
+        Utility::ClearContainer(m_observers);
+        Utility::ClearContainer(m_entityHandles);
+        Utility::ClearContainer(m_entityBuckets);
+        Utility::ClearContainer(m_updateTicks);
+        Utility::ClearContainer(m_tierBuckets);
+        Utility::ClearContainer(m_bucketStarts);
+
+        // Reset initialization parameters.
+        m_info = SimulationLodInfo<Type>();
+        m_epoch = 0;
+
+        // Reset the initialization state.
+        m_initialized = false;
+    }
+
+    template<typename Type>
+    bool SimulationLod<Type>::Initialize(const SimulationLodInfo<Type>& info)
+    {
+        // Cleanup this instance.
+        this->Cleanup();
+
+        // Setup a cleanup guard.
+        SCOPE_GUARD
+        (
+            if(!m_initialized)
+            {
+                m_initialized = true;
+                this->Cleanup();
+            }
+        );
+
+        // Validate arguments.
+        if(info.pool == nullptr)
+        {
+            LogError() << "Failed to initialize a simulation lod! Invalid component pool.";
+            return false;
+        }
+
+        if(!info.position)
+        {
+            LogError() << "Failed to initialize a simulation lod! Invalid position function.";
+            return false;
+        }
+
+        if(info.tiers.empty())
+        {
+            LogError() << "Failed to initialize a simulation lod! Invalid tiers.";
+            return false;
+        }
+
+        for(std::size_t i = 0; i < info.tiers.size(); ++i)
+        {
+            bool ascending = i == 0 || info.tiers[i].distance > info.tiers[i - 1].distance;
+
+            if(info.tiers[i].period <= 0 || !ascending)
+            {
+                LogError() << "Failed to initialize a simulation lod! Invalid tiers.";
+                return false;
+            }
+        }
+
+        m_info = info;
+
+        // Lay out buckets of tiers, one for each tick of a period.
+        m_tierBuckets.reserve(m_info.tiers.size() + 1);
+        m_tierBuckets.push_back(0);
+
+        for(const SimulationLodTier& tier : m_info.tiers)
+        {
+            m_tierBuckets.push_back(m_tierBuckets.back() + tier.period);
+        }
+
+        m_bucketStarts.assign(m_tierBuckets.back() + 1, 0);
+
+        // Success!
+        m_initialized = true;
+
+        // Sort existing components into buckets.
+        this->Refresh();
+
+        return true;
+    }
+
+    template<typename Type>
+    void SimulationLod<Type>::SetObservers(const glm::vec3* positions, int count)
+    {
+        if(!m_initialized)
+            return;
+
+        m_observers.assign(positions, positions + std::max(count, 0));
+    }
+
+    template<typename Type>
+    void SimulationLod<Type>::Refresh()
+    {
+        if(!m_initialized)
+            return;
+
+        ComponentPool<Type>& pool = *m_info.pool;
+
+        const EntityHandle* entities = pool.GetEntities();
+        const Type* components = pool.GetComponents();
+        int count = pool.GetSize();
+
+        int lastTier = (int)m_info.tiers.size() - 1;
+
+        // Assign entities to buckets of their tiers.
+        // Squared distances avoid square roots per entity and observer.
+        std::fill(m_bucketStarts.begin(), m_bucketStarts.end(), 0);
+
+        for(int i = 0; i < count; ++i)
+        {
+            glm::vec3 position = m_info.position(entities[i], components[i]);
+
+            float nearestDistance = std::numeric_limits<float>::infinity();
+
+            for(const glm::vec3& observer : m_observers)
+            {
+                glm::vec3 offset = position - observer;
+                nearestDistance = std::min(nearestDistance, glm::dot(offset, offset));
+            }
+
+            int tier = 0;
+
+            while(tier < lastTier && nearestDistance > m_info.tiers[tier].distance * m_info.tiers[tier].distance)
+            {
+                tier += 1;
+            }
+
+            // Spread entities of a tier over ticks of its period.
+            int identifier = entities[i].GetIdentifier();
+            int phase = identifier % m_info.tiers[tier].period;
+            int bucket = m_tierBuckets[tier] + phase;
+
+            if(identifier > (int)m_entityBuckets.size())
+            {
+                m_entityHandles.resize(identifier);
+                m_entityBuckets.resize(identifier, 0);
+                m_updateTicks.resize(identifier, (std::uint64_t)NeverUpdated);
+            }
+
+            // Forget last updates of previous entities with the same identifier.
+            if(m_entityHandles[identifier - 1] != entities[i])
+            {
+                m_entityHandles[identifier - 1] = entities[i];
+                m_updateTicks[identifier - 1] = NeverUpdated;
+            }
+
+            m_entityBuckets[identifier - 1] = bucket;
+            m_bucketStarts[bucket + 1] += 1;
+        }
+
+        // Sort components into contiguous buckets.
+        pool.SortByKey([this](const EntityHandle& entity, const Type& component)
+        {
+            return (std::uint64_t)m_entityBuckets[entity.GetIdentifier() - 1];
+        });
+
+        // Turn bucket sizes into first dense indices.
+        for(std::size_t i = 1; i < m_bucketStarts.size(); ++i)
+        {
+            m_bucketStarts[i] += m_bucketStarts[i - 1];
+        }
+
+        m_epoch = pool.GetEpoch();
+    }
+
+    template<typename Type>
+    template<typename Function>
+    void SimulationLod<Type>::ForEachDue(std::uint64_t tick, float timeDelta, Function function)
+    {
+        if(!m_initialized)
+            return;
+
+        this->RefreshIfStale();
+
+        const EntityHandle* entities = m_info.pool->GetEntities();
+        Type* components = m_info.pool->GetComponents();
+
+        for(int tier = 0; tier < (int)m_info.tiers.size(); ++tier)
+        {
+            int bucket = this->GetDueBucket(tier, tick);
+            int period = m_info.tiers[tier].period;
+
+            for(int i = m_bucketStarts[bucket]; i < m_bucketStarts[bucket + 1]; ++i)
+            {
+                function(entities[i], components[i], this->AdvanceEntity(entities[i], tick, period, timeDelta));
+            }
+        }
+    }
+
+    template<typename Type>
+    template<typename Function>
+    void SimulationLod<Type>::ParallelForEachDue(JobSystem& jobSystem, int grainSize, std::uint64_t tick, float timeDelta, Function function)
+    {
+        if(!m_initialized)
+            return;
+
+        this->RefreshIfStale();
+
+        const EntityHandle* entities = m_info.pool->GetEntities();
+        Type* components = m_info.pool->GetComponents();
+
+        for(int tier = 0; tier < (int)m_info.tiers.size(); ++tier)
+        {
+            int bucket = this->GetDueBucket(tier, tick);
+            int period = m_info.tiers[tier].period;
+            int first = m_bucketStarts[bucket];
+
+            jobSystem.ParallelFor(m_bucketStarts[bucket + 1] - first, grainSize, [&](int begin, int end)
+            {
+                for(int i = first + begin; i < first + end; ++i)
+                {
+                    function(entities[i], components[i], this->AdvanceEntity(entities[i], tick, period, timeDelta));
+                }
+            });
+        }
+    }
+
+    template<typename Type>
+    void SimulationLod<Type>::RefreshIfStale()
+    {
+        if(m_epoch != m_info.pool->GetEpoch())
+        {
+            this->Refresh();
+        }
+    }
+
+    template<typename Type>
+    int SimulationLod<Type>::GetDueBucket(int tier, std::uint64_t tick) const
+    {
+        return m_tierBuckets[tier] + (int)(tick % (std::uint64_t)m_info.tiers[tier].period);
+    }
+
+    template<typename Type>
+    float SimulationLod<Type>::AdvanceEntity(const EntityHandle& entity, std::uint64_t tick, int period, float timeDelta)
+    {
+        std::uint64_t& updateTick = m_updateTicks[entity.GetIdentifier() - 1];
+
+        // Entities updated for the first time have waited for a full period.
+        std::uint64_t elapsedTicks = (std::uint64_t)period;
+
+        if(updateTick != NeverUpdated && tick > updateTick)
+        {
+            elapsedTicks = tick - updateTick;
+        }
+
+        updateTick = tick;
+
+        return (float)elapsedTicks * timeDelta;
+    }
+
+    template<typename Type>
+    int SimulationLod<Type>::GetTierCount() const
+    {
+        return (int)m_info.tiers.size();
+    }
+
+    template<typename Type>
+    int SimulationLod<Type>::GetTierSize(int tier) const
+    {
+        if(!m_initialized || tier < 0 || tier >= (int)m_info.tiers.size())
+            return 0;
+
+        return m_bucketStarts[m_tierBuckets[tier + 1]] - m_bucketStarts[m_tierBuckets[tier]];
+    }
+
+    template<typename Type>
+    int SimulationLod<Type>::GetDueCount(std::uint64_t tick) const
+    {
+        if(!m_initialized)
+            return 0;
+
+        int count = 0;
+
+        for(int tier = 0; tier < (int)m_info.tiers.size(); ++tier)
+        {
+            int bucket = this->GetDueBucket(tier, tick);
+            count += m_bucketStarts[bucket + 1] - m_bucketStarts[bucket];
+        }
+
+        return count;
+    }
+
+    template<typename Type>
+    bool SimulationLod<Type>::IsInitialized() const
+    {
+        return m_initialized;
+    }
+}
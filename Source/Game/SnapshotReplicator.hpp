@@ -0,0 +1,607 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/BitStream.hpp"
+#include "Common/JobSystem.hpp"
+#include "EntityHandle.hpp"
+#include "ComponentPool.hpp"
+
+//
+// Snapshot Replicator
+//
+//  Builds snapshot packets that replicate components of a pool to clients.
+//  Each packet is a delta against the last snapshot the client has
+//  acknowledged, listing entities that have been removed since and entities
+//  whose components have been added or changed after the tick of that
+//  snapshot, according to change ticks of the pool. Until a client
+//  acknowledges a snapshot, it receives all components.
+//
+//  Packets are bit packed, with entity identifiers written as variable
+//  length differences from the previous one and component fields written by
+//  an encode function, which usually quantizes them. Packets of all clients
+//  can be built in parallel on a job system. The encode function is then
+//  called from multiple threads and must not modify shared state.
+//
+//  Packets stay in per client buffers until the next build, so a transport
+//  can send them straight from there without copying. Sequence numbers start
+//  at one, with zero meaning no baseline snapshot.
+//
+//  Clients keep the states of recently received snapshots and apply a packet
+//  on top of the state of its baseline snapshot, or on top of an empty state
+//  if it has no baseline. Packets older than the last applied one are dropped.
+//
+//  Clients can be limited to a set of relevant entities, usually kept by an
+//  interest manager. Only relevant entities are then considered when building
+//  their packets, and entities that stop being relevant are sent as removed.
+//
+//  Example usage:
+//      Game::SnapshotReplicatorInfo<Transform> info;
+//      info.pool = &transforms;
+//      info.encode = [](BitWriter& writer, const Transform& transform)
+//      {
+//          writer.WriteQuantized(transform.position.x, -4096.0f, 4096.0f, 20);
+//          writer.WriteQuantized(transform.position.y, -4096.0f, 4096.0f, 20);
+//      };
+//
+//      Game::SnapshotReplicator<Transform> replicator;
+//      replicator.Initialize(info);
+//
+//      int client = replicator.AddClient();
+//
+//      replicator.BuildSnapshots(&jobSystem);
+//      socket.Send(replicator.GetPacketData(client), replicator.GetPacketSize(client));
+//
+//      replicator.Acknowledge(client, acknowledgedSequence);
+//
+//  Limiting a client to relevant entities:
+//      replicator.SetRelevantEntities(client, &interest.GetRelevantEntities(client));
+//
+//  Reading a packet on a client:
+//      Game::SnapshotReplicator<Transform>::ReadPacket(data, size, sequence, baseline,
+//          [&](int identifier, int version) { /* Remove the entity. */ },
+//          [&](int identifier, int version, BitReader& reader) { /* Read fields. */ });
+//
+
+namespace Game
+{
+    // Snapshot replicator initialization struct.
+    template<typename Type>
+    struct SnapshotReplicatorInfo
+    {
+        // Type declarations.
+        typedef std::function<void(BitWriter&, const Type&)> EncodeFunction;
+
+        // Pool whose components are replicated.
+        ComponentPool<Type>* pool;
+
+        // Writes fields of a component.
+        EncodeFunction encode;
+
+        // Number of sent snapshots remembered for each client.
+        // Acknowledgements of older snapshots are ignored.
+        int historySize;
+
+        SnapshotReplicatorInfo() :
+            pool(nullptr),
+            historySize(32)
+        {
+        }
+    };
+
+    // Snapshot replicator class.
+    template<typename Type>
+    class SnapshotReplicator : private NonCopyable
+    {
+    public:
+        // Type declarations.
+        typedef typename ComponentPool<Type>::Tick Tick;
+
+    public:
+        SnapshotReplicator();
+        ~SnapshotReplicator();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the snapshot replicator.
+        bool Initialize(const SnapshotReplicatorInfo<Type>& info);
+
+        // Adds a client and returns its index.
+        // Indices of removed clients are reused.
+        int AddClient();
+
+        // Removes a client.
+        void RemoveClient(int client);
+
+        // Acknowledges that a client has received a snapshot.
+        // Following packets of the client are deltas against it.
+        void Acknowledge(int client, std::uint32_t sequence);
+
+        // Limits entities replicated to a client to a list sorted by entity identifiers.
+        // List must remain valid while building snapshots. Null replicates all entities.
+        void SetRelevantEntities(int client, const std::vector<EntityHandle>* entities);
+
+        // Builds the next snapshot packet of every client.
+        // Builds packets on the calling thread if no job system is given.
+        // Pool must not be modified while building.
+        void BuildSnapshots(JobSystem* jobSystem = nullptr);
+
+        // Gets the last built packet of a client.
+        // Packet remains valid until the next build.
+        const std::uint8_t* GetPacketData(int client) const;
+        std::size_t GetPacketSize(int client) const;
+
+        // Reads a snapshot packet.
+        // Calls a remove function with identifiers and versions of removed entities,
+        // and an update function that has to read fields of each updated component.
+        // Returns false if the packet is invalid.
+        template<typename RemoveFunction, typename UpdateFunction>
+        static bool ReadPacket(const void* data, std::size_t size, std::uint32_t& sequence, std::uint32_t& baseline,
+            RemoveFunction remove, UpdateFunction update);
+
+        // Checks if the instance is initialized.
+        bool IsInitialized() const;
+
+    private:
+        // Type declarations.
+        typedef std::vector<EntityHandle> EntityList;
+        typedef std::shared_ptr<const EntityList> SharedEntityList;
+        typedef std::vector<int> IndexList;
+
+        // Snapshot sent to a client.
+        // Lists of entities are shared by clients that got the same snapshot.
+        struct SentSnapshot
+        {
+            SentSnapshot() :
+                sequence(0),
+                tick(0)
+            {
+            }
+
+            std::uint32_t sequence;
+            Tick tick;
+            SharedEntityList entities;
+        };
+
+        // Client state.
+        struct Client
+        {
+            Client() :
+                active(false),
+                nextSequence(1),
+                ackedSequence(0),
+                relevant(nullptr)
+            {
+            }
+
+            bool active;
+            std::uint32_t nextSequence;
+            std::uint32_t ackedSequence;
+            std::vector<SentSnapshot> history;
+            std::vector<std::uint8_t> packet;
+
+            // Sorted relevant entities and positions of them in the sorted pool.
+            const EntityList* relevant;
+            IndexList visible;
+
+            // Entities removed and indices of entities updated in the next packet.
+            EntityList removed;
+            IndexList updated;
+        };
+
+        typedef std::vector<Client> ClientList;
+
+    private:
+        // Builds a packet of a client from sorted entities of the pool.
+        void BuildPacket(Client& client, Tick tick, const SharedEntityList& entities);
+
+    private:
+        // Replicated pool and component encoder.
+        ComponentPool<Type>* m_pool;
+        typename SnapshotReplicatorInfo<Type>::EncodeFunction m_encode;
+
+        // Number of remembered snapshots per client.
+        int m_historySize;
+
+        // Clients indexed by their indices.
+        ClientList m_clients;
+
+        // Dense indices of components sorted by entity identifiers.
+        IndexList m_order;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
+
+// Template implementations.
+namespace Game
+{
+    template<typename Type>
+    SnapshotReplicator<Type>::SnapshotReplicator() :
+        m_pool(nullptr),
+        m_historySize(0),
+        m_initialized(false)
+    {
+    }
+
+    template<typename Type>
+    SnapshotReplicator<Type>::~SnapshotReplicator()
+    {
+        this->Cleanup();
+    }
+
+    template<typename Type>
+    void SnapshotReplicator<Type>::Cleanup()
+    {
+        m_pool = nullptr;
+        m_encode = nullptr;
+        m_historySize = 0;
+
+        Utility::ClearContainer(m_clients);
+        Utility::ClearContainer(m_order);
+
+        // Reset the initialization state.
+        m_initialized = false;
+    }
+
+    template<typename Type>
+    bool SnapshotReplicator<Type>::Initialize(const SnapshotReplicatorInfo<Type>& info)
+    {
+        // Cleanup this instance.
+        this->Cleanup();
+
+        // Validate arguments.
+        if(info.pool == nullptr)
+        {
+            LogError() << "Failed to initialize a snapshot replicator! Invalid component pool.";
+            return false;
+        }
+
+        if(info.encode == nullptr)
+        {
+            LogError() << "Failed to initialize a snapshot replicator! Invalid encode function.";
+            return false;
+        }
+
+        if(info.historySize <= 0)
+        {
+            LogError() << "Failed to initialize a snapshot replicator! Invalid history size.";
+            return false;
+        }
+
+        m_pool = info.pool;
+        m_encode = info.encode;
+        m_historySize = info.historySize;
+
+        // Success!
+        return m_initialized = true;
+    }
+
+    template<typename Type>
+    int SnapshotReplicator<Type>::AddClient()
+    {
+        Assert(m_initialized, "Snapshot replicator is not initialized!");
+
+        // Reuse a slot of a removed client.
+        std::size_t index = 0;
+
+        while(index < m_clients.size() && m_clients[index].active)
+        {
+            ++index;
+        }
+
+        if(index == m_clients.size())
+        {
+            m_clients.emplace_back();
+        }
+
+        Client& client = m_clients[index];
+        client = Client();
+        client.active = true;
+        client.history.resize(m_historySize);
+
+        return (int)index;
+    }
+
+    template<typename Type>
+    void SnapshotReplicator<Type>::RemoveClient(int client)
+    {
+        Assert(client >= 0 && client < (int)m_clients.size(), "Invalid client index!");
+
+        m_clients[client] = Client();
+    }
+
+    template<typename Type>
+    void SnapshotReplicator<Type>::Acknowledge(int client, std::uint32_t sequence)
+    {
+        Assert(client >= 0 && client < (int)m_clients.size(), "Invalid client index!");
+
+        Client& state = m_clients[client];
+
+        // Ignore acknowledgements that arrive out of order or that were never sent.
+        if(!state.active || sequence <= state.ackedSequence || sequence >= state.nextSequence)
+            return;
+
+        state.ackedSequence = sequence;
+    }
+
+    template<typename Type>
+    void SnapshotReplicator<Type>::SetRelevantEntities(int client, const std::vector<EntityHandle>* entities)
+    {
+        Assert(client >= 0 && client < (int)m_clients.size(), "Invalid client index!");
+
+        m_clients[client].relevant = entities;
+    }
+
+    template<typename Type>
+    void SnapshotReplicator<Type>::BuildSnapshots(JobSystem* jobSystem)
+    {
+        if(!m_initialized)
+            return;
+
+        // Start a new tick, so later changes are included in the next snapshot.
+        Tick tick = m_pool->AdvanceTick();
+
+        // Sort components by entity identifiers, so deltas merge sorted lists.
+        const EntityHandle* entities = m_pool->GetEntities();
+
+        m_order.resize(m_pool->GetSize());
+
+        for(std::size_t i = 0; i < m_order.size(); ++i)
+        {
+            m_order[i] = (int)i;
+        }
+
+        std::sort(m_order.begin(), m_order.end(), [entities](int first, int second)
+        {
+            return entities[first] < entities[second];
+        });
+
+        std::shared_ptr<EntityList> sorted = std::make_shared<EntityList>();
+        sorted->reserve(m_order.size());
+
+        for(int denseIndex : m_order)
+        {
+            sorted->push_back(entities[denseIndex]);
+        }
+
+        SharedEntityList shared = sorted;
+
+        // Build packets of clients independently.
+        auto build = [&](int begin, int end)
+        {
+            for(int i = begin; i < end; ++i)
+            {
+                if(m_clients[i].active)
+                {
+                    this->BuildPacket(m_clients[i], tick, shared);
+                }
+            }
+        };
+
+        if(jobSystem != nullptr)
+        {
+            jobSystem->ParallelFor((int)m_clients.size(), 1, build);
+        }
+        else
+        {
+            build(0, (int)m_clients.size());
+        }
+    }
+
+    template<typename Type>
+    const std::uint8_t* SnapshotReplicator<Type>::GetPacketData(int client) const
+    {
+        Assert(client >= 0 && client < (int)m_clients.size(), "Invalid client index!");
+
+        return m_clients[client].packet.data();
+    }
+
+    template<typename Type>
+    std::size_t SnapshotReplicator<Type>::GetPacketSize(int client) const
+    {
+        Assert(client >= 0 && client < (int)m_clients.size(), "Invalid client index!");
+
+        return m_clients[client].packet.size();
+    }
+
+    template<typename Type>
+    template<typename RemoveFunction, typename UpdateFunction>
+    bool SnapshotReplicator<Type>::ReadPacket(const void* data, std::size_t size, std::uint32_t& sequence, std::uint32_t& baseline,
+        RemoveFunction remove, UpdateFunction update)
+    {
+        BitReader reader(data, size);
+
+        sequence = (std::uint32_t)reader.ReadVarint();
+        baseline = (std::uint32_t)reader.ReadVarint();
+
+        // Read removed entities.
+        std::uint64_t removedCount = reader.ReadVarint();
+        std::uint64_t identifier = 0;
+
+        for(std::uint64_t i = 0; i < removedCount && reader.IsValid(); ++i)
+        {
+            identifier += reader.ReadVarint();
+            std::uint64_t version = reader.ReadVarint();
+
+            if(!reader.IsValid())
+                break;
+
+            remove((int)identifier, (int)version);
+        }
+
+        // Read updated entities.
+        std::uint64_t updatedCount = reader.ReadVarint();
+        identifier = 0;
+
+        for(std::uint64_t i = 0; i < updatedCount && reader.IsValid(); ++i)
+        {
+            identifier += reader.ReadVarint();
+            std::uint64_t version = reader.ReadVarint();
+
+            if(!reader.IsValid())
+                break;
+
+            update((int)identifier, (int)version, reader);
+        }
+
+        return reader.IsValid() && reader.IsAtEnd();
+    }
+
+    template<typename Type>
+    bool SnapshotReplicator<Type>::IsInitialized() const
+    {
+        return m_initialized;
+    }
+
+    template<typename Type>
+    void SnapshotReplicator<Type>::BuildPacket(Client& client, Tick tick, const SharedEntityList& entities)
+    {
+        // Find the acknowledged baseline snapshot, unless it has been overwritten.
+        const SentSnapshot* baseline = nullptr;
+
+        if(client.ackedSequence != 0)
+        {
+            const SentSnapshot& snapshot = client.history[client.ackedSequence % m_historySize];
+
+            if(snapshot.sequence == client.ackedSequence)
+            {
+                baseline = &snapshot;
+            }
+        }
+
+        // Intersect entities of the pool with relevant entities of the client.
+        SharedEntityList visible = entities;
+        client.visible.clear();
+
+        if(client.relevant != nullptr)
+        {
+            const EntityList& all = *entities;
+            const EntityList& relevant = *client.relevant;
+
+            std::shared_ptr<EntityList> intersection = std::make_shared<EntityList>();
+            intersection->reserve(std::min(all.size(), relevant.size()));
+
+            std::size_t a = 0;
+            std::size_t r = 0;
+
+            while(a < all.size() && r < relevant.size())
+            {
+                if(all[a] < relevant[r])
+                {
+                    ++a;
+                }
+                else if(relevant[r] < all[a])
+                {
+                    ++r;
+                }
+                else
+                {
+                    if(all[a] == relevant[r])
+                    {
+                        intersection->push_back(all[a]);
+                        client.visible.push_back((int)a);
+                    }
+
+                    ++a;
+                    ++r;
+                }
+            }
+
+            visible = intersection;
+        }
+
+        // Maps positions in the visible list to dense indices of the pool.
+        bool filtered = client.relevant != nullptr;
+
+        auto denseIndex = [&](int index)
+        {
+            return m_order[filtered ? client.visible[index] : index];
+        };
+
+        static const EntityList EmptyList;
+
+        const EntityList& previous = baseline != nullptr ? *baseline->entities : EmptyList;
+        const EntityList& current = *visible;
+        Tick baselineTick = baseline != nullptr ? baseline->tick : 0;
+
+        // Merge sorted lists of entities in the baseline and visible entities.
+        const Tick* changeTicks = m_pool->GetChangeTicks();
+
+        client.removed.clear();
+        client.updated.clear();
+
+        std::size_t p = 0;
+        std::size_t c = 0;
+
+        while(p < previous.size() || c < current.size())
+        {
+            if(c == current.size() || (p < previous.size() && previous[p] < current[c]))
+            {
+                client.removed.push_back(previous[p++]);
+            }
+            else if(p == previous.size() || current[c] < previous[p])
+            {
+                client.updated.push_back((int)c++);
+            }
+            else
+            {
+                // Same identifier with another version is a different entity.
+                if(previous[p] != current[c])
+                {
+                    client.removed.push_back(previous[p]);
+                    client.updated.push_back((int)c);
+                }
+                else if(changeTicks[denseIndex((int)c)] > baselineTick)
+                {
+                    client.updated.push_back((int)c);
+                }
+
+                ++p;
+                ++c;
+            }
+        }
+
+        // Write the packet.
+        std::uint32_t sequence = client.nextSequence++;
+
+        client.packet.clear();
+        BitWriter writer(client.packet);
+
+        writer.WriteVarint(sequence);
+        writer.WriteVarint(baseline != nullptr ? baseline->sequence : 0);
+
+        int identifier = 0;
+        writer.WriteVarint(client.removed.size());
+
+        for(const EntityHandle& entity : client.removed)
+        {
+            writer.WriteVarint(entity.GetIdentifier() - identifier);
+            writer.WriteVarint(entity.GetVersion());
+            identifier = entity.GetIdentifier();
+        }
+
+        const Type* components = m_pool->GetComponents();
+
+        identifier = 0;
+        writer.WriteVarint(client.updated.size());
+
+        for(int index : client.updated)
+        {
+            const EntityHandle& entity = current[index];
+
+            writer.WriteVarint(entity.GetIdentifier() - identifier);
+            writer.WriteVarint(entity.GetVersion());
+            identifier = entity.GetIdentifier();
+
+            m_encode(writer, components[denseIndex(index)]);
+        }
+
+        // Remember the sent snapshot.
+        SentSnapshot& snapshot = client.history[sequence % m_historySize];
+        snapshot.sequence = sequence;
+        snapshot.tick = tick;
+        snapshot.entities = visible;
+    }
+}
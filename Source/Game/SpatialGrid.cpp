@@ -0,0 +1,398 @@
+#include "Precompiled.hpp"
+#include "SpatialGrid.hpp"
+using namespace Game;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize the spatial grid! "
+
+    // Constant variables.
+    const int InvalidIndex = -1;
+
+    // Minimum number of handle entries per rebuild partition.
+    const int MinimumPartitionSize = 4096;
+}
+
+SpatialGridInfo::SpatialGridInfo() :
+    cellSize(1.0f),
+    bucketCount(4096)
+{
+}
+
+SpatialGrid::SpatialGrid() :
+    m_entitySystem(nullptr),
+    m_entityCount(0),
+    m_dirty(false),
+    m_initialized(false)
+{
+}
+
+SpatialGrid::~SpatialGrid()
+{
+    this->Cleanup();
+}
+
+void SpatialGrid::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Unsubscribe from the entity system.
+    m_entityDestroy.Cleanup();
+    m_entitySystem = nullptr;
+
+    // Clear entity arrays.
+    Utility::ClearContainer(m_entities);
+    Utility::ClearContainer(m_positions);
+    Utility::ClearContainer(m_denseIndices);
+
+    Utility::ClearContainer(m_denseEntities);
+    Utility::ClearContainer(m_densePositions);
+    Utility::ClearContainer(m_denseCells);
+
+    Utility::ClearContainer(m_bucketStarts);
+    Utility::ClearContainer(m_partitionOffsets);
+
+    m_entityCount = 0;
+    m_dirty = false;
+
+    // Reset initialization parameters.
+    m_info = SpatialGridInfo();
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool SpatialGrid::Initialize(EntitySystem* entitySystem, const SpatialGridInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(entitySystem == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid entity system.";
+        return false;
+    }
+
+    if(!(info.cellSize > 0.0f))
+    {
+        LogError() << LogInitializeError() << "Invalid cell size.";
+        return false;
+    }
+
+    if(info.bucketCount <= 0 || (info.bucketCount & (info.bucketCount - 1)) != 0)
+    {
+        LogError() << LogInitializeError() << "Invalid bucket count.";
+        return false;
+    }
+
+    m_info = info;
+    m_entitySystem = entitySystem;
+
+    // Start with all buckets being empty.
+    m_bucketStarts.resize(info.bucketCount + 1, 0);
+
+    // Remove destroyed entities.
+    m_entityDestroy.Bind<SpatialGrid, &SpatialGrid::OnEntityDestroy>(this);
+    m_entityDestroy.Subscribe(entitySystem->events.destroy);
+
+    // Success!
+    return m_initialized = true;
+}
+
+bool SpatialGrid::Insert(const EntityHandle& entity, const glm::vec3& position)
+{
+    if(!m_initialized)
+        return false;
+
+    // Check arguments.
+    if(!m_entitySystem->IsHandleValid(entity) || this->Contains(entity))
+        return false;
+
+    // Make sure the arrays can hold the entity.
+    int index = entity.GetIdentifier() - 1;
+
+    if(index >= (int)m_entities.size())
+    {
+        m_entities.resize(index + 1);
+        m_positions.resize(index + 1);
+        m_denseIndices.resize(index + 1, InvalidIndex);
+    }
+
+    // Store the entity until the next update.
+    m_entities[index] = entity;
+    m_positions[index] = position;
+    m_denseIndices[index] = InvalidIndex;
+
+    m_entityCount += 1;
+    m_dirty = true;
+
+    return true;
+}
+
+bool SpatialGrid::Insert(const EntityHandle& entity, const glm::vec2& position)
+{
+    return this->Insert(entity, glm::vec3(position, 0.0f));
+}
+
+bool SpatialGrid::SetPosition(const EntityHandle& entity, const glm::vec3& position)
+{
+    int index = this->FindEntity(entity);
+
+    if(index == InvalidIndex)
+        return false;
+
+    m_positions[index] = position;
+
+    // Update the dense array in place if the entity stays in its cell.
+    int denseIndex = m_denseIndices[index];
+
+    if(denseIndex != InvalidIndex && m_denseCells[denseIndex] == this->CalculateCell(position))
+    {
+        m_densePositions[denseIndex] = position;
+    }
+    else
+    {
+        m_dirty = true;
+    }
+
+    return true;
+}
+
+bool SpatialGrid::SetPosition(const EntityHandle& entity, const glm::vec2& position)
+{
+    return this->SetPosition(entity, glm::vec3(position, 0.0f));
+}
+
+bool SpatialGrid::Remove(const EntityHandle& entity)
+{
+    int index = this->FindEntity(entity);
+
+    if(index == InvalidIndex)
+        return false;
+
+    // Leave a hole in the dense arrays until the next update.
+    // Queries skip entries with invalid handles.
+    int denseIndex = m_denseIndices[index];
+
+    if(denseIndex != InvalidIndex)
+    {
+        m_denseEntities[denseIndex] = EntityHandle();
+    }
+
+    m_entities[index] = EntityHandle();
+    m_denseIndices[index] = InvalidIndex;
+
+    m_entityCount -= 1;
+    m_dirty = true;
+
+    return true;
+}
+
+bool SpatialGrid::Contains(const EntityHandle& entity) const
+{
+    return this->FindEntity(entity) != InvalidIndex;
+}
+
+const glm::vec3* SpatialGrid::GetPosition(const EntityHandle& entity) const
+{
+    int index = this->FindEntity(entity);
+
+    if(index == InvalidIndex)
+        return nullptr;
+
+    return &m_positions[index];
+}
+
+void SpatialGrid::Update(JobSystem* jobSystem)
+{
+    if(!m_initialized || !m_dirty)
+        return;
+
+    // Split handle entries into partitions that are sorted in parallel.
+    // Each partition counts its own entities per bucket, which keeps
+    // the sort stable and makes the result independent of threads.
+    int entryCount = (int)m_entities.size();
+    int bucketCount = m_info.bucketCount;
+    int partitionCount = 1;
+
+    if(jobSystem != nullptr)
+    {
+        partitionCount = std::max(1, std::min(jobSystem->GetWorkerCount() + 1, entryCount / MinimumPartitionSize));
+    }
+
+    // Count entities in buckets of each partition.
+    m_partitionOffsets.assign((std::size_t)partitionCount * bucketCount, 0);
+
+    this->ForEachPartition(jobSystem, partitionCount, [&](int partition, int begin, int end)
+    {
+        int* counts = &m_partitionOffsets[(std::size_t)partition * bucketCount];
+
+        for(int i = begin; i < end; ++i)
+        {
+            if(m_entities[i] == EntityHandle())
+                continue;
+
+            counts[this->CalculateBucket(this->CalculateCell(m_positions[i]))] += 1;
+        }
+    });
+
+    // Turn counts into offsets, ordered by buckets and then by partitions.
+    int offset = 0;
+
+    for(int bucket = 0; bucket < bucketCount; ++bucket)
+    {
+        m_bucketStarts[bucket] = offset;
+
+        for(int partition = 0; partition < partitionCount; ++partition)
+        {
+            int& element = m_partitionOffsets[(std::size_t)partition * bucketCount + bucket];
+            int count = element;
+
+            element = offset;
+            offset += count;
+        }
+    }
+
+    m_bucketStarts[bucketCount] = offset;
+
+    Assert(offset == m_entityCount, "Number of sorted entities does not match the entity count!");
+
+    // Scatter entities into the dense arrays.
+    m_denseEntities.resize(offset);
+    m_densePositions.resize(offset);
+    m_denseCells.resize(offset);
+
+    this->ForEachPartition(jobSystem, partitionCount, [&](int partition, int begin, int end)
+    {
+        int* offsets = &m_partitionOffsets[(std::size_t)partition * bucketCount];
+
+        for(int i = begin; i < end; ++i)
+        {
+            if(m_entities[i] == EntityHandle())
+                continue;
+
+            glm::ivec3 cell = this->CalculateCell(m_positions[i]);
+            int denseIndex = offsets[this->CalculateBucket(cell)]++;
+
+            m_denseEntities[denseIndex] = m_entities[i];
+            m_densePositions[denseIndex] = m_positions[i];
+            m_denseCells[denseIndex] = cell;
+            m_denseIndices[i] = denseIndex;
+        }
+    });
+
+    m_dirty = false;
+}
+
+void SpatialGrid::ForEachPartition(JobSystem* jobSystem, int partitionCount, const PartitionFunction& function)
+{
+    int entryCount = (int)m_entities.size();
+    int partitionSize = (entryCount + partitionCount - 1) / partitionCount;
+
+    auto RunPartitions = [&](int first, int last)
+    {
+        for(int partition = first; partition < last; ++partition)
+        {
+            int begin = std::min(partition * partitionSize, entryCount);
+            int end = std::min(begin + partitionSize, entryCount);
+
+            function(partition, begin, end);
+        }
+    };
+
+    if(jobSystem != nullptr && partitionCount > 1)
+    {
+        jobSystem->ParallelFor(partitionCount, 1, RunPartitions);
+    }
+    else
+    {
+        RunPartitions(0, partitionCount);
+    }
+}
+
+int SpatialGrid::QueryBox(const glm::vec3& minimum, const glm::vec3& maximum, EntityList& results) const
+{
+    return this->Query(minimum, maximum, [&](const glm::vec3& position)
+    {
+        return glm::all(glm::greaterThanEqual(position, minimum)) && glm::all(glm::lessThanEqual(position, maximum));
+    }, results);
+}
+
+int SpatialGrid::QueryBox(const glm::vec2& minimum, const glm::vec2& maximum, EntityList& results) const
+{
+    return this->QueryBox(glm::vec3(minimum, 0.0f), glm::vec3(maximum, 0.0f), results);
+}
+
+int SpatialGrid::QueryRadius(const glm::vec3& center, float radius, EntityList& results) const
+{
+    if(radius < 0.0f)
+        return 0;
+
+    float radiusSquared = radius * radius;
+
+    return this->Query(center - glm::vec3(radius), center + glm::vec3(radius), [&](const glm::vec3& position)
+    {
+        glm::vec3 difference = position - center;
+        return glm::dot(difference, difference) <= radiusSquared;
+    }, results);
+}
+
+int SpatialGrid::QueryRadius(const glm::vec2& center, float radius, EntityList& results) const
+{
+    if(radius < 0.0f)
+        return 0;
+
+    // Keep the query on the plane of two dimensional positions.
+    float radiusSquared = radius * radius;
+    glm::vec3 center3(center, 0.0f);
+    glm::vec3 extent(radius, radius, 0.0f);
+
+    return this->Query(center3 - extent, center3 + extent, [&](const glm::vec3& position)
+    {
+        glm::vec3 difference = position - center3;
+        return glm::dot(difference, difference) <= radiusSquared;
+    }, results);
+}
+
+int SpatialGrid::GetSize() const
+{
+    return m_entityCount;
+}
+
+bool SpatialGrid::IsDirty() const
+{
+    return m_dirty;
+}
+
+glm::ivec3 SpatialGrid::CalculateCell(const glm::vec3& position) const
+{
+    return glm::ivec3(glm::floor(position / m_info.cellSize));
+}
+
+int SpatialGrid::CalculateBucket(const glm::ivec3& cell) const
+{
+    // Hash cell coordinates with large primes.
+    std::uint32_t hash = (std::uint32_t)cell.x * 73856093u ^ (std::uint32_t)cell.y * 19349663u ^ (std::uint32_t)cell.z * 83492791u;
+    return (int)(hash & (std::uint32_t)(m_info.bucketCount - 1));
+}
+
+int SpatialGrid::FindEntity(const EntityHandle& entity) const
+{
+    int index = entity.GetIdentifier() - 1;
+
+    if(index < 0 || index >= (int)m_entities.size())
+        return InvalidIndex;
+
+    if(m_entities[index] != entity)
+        return InvalidIndex;
+
+    return index;
+}
+
+void SpatialGrid::OnEntityDestroy(EntitySystem::Events::Destroy event)
+{
+    this->Remove(event.handle);
+}
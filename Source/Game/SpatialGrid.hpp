@@ -0,0 +1,230 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/JobSystem.hpp"
+#include "EntityHandle.hpp"
+#include "EntitySystem.hpp"
+
+//
+// Spatial Grid
+//
+//  Indexes entity positions in a uniform grid of cells for proximity queries.
+//  Cells are hashed into a fixed number of buckets and entities are stored in
+//  dense arrays sorted by their buckets, so a query only scans the contiguous
+//  ranges of buckets of the cells it overlaps. Moving an entity within its
+//  cell is applied in place right away, while inserting entities, removing
+//  them or moving them to other cells takes effect at the next Update() call,
+//  which rebuilds the dense arrays with a counting sort. The rebuild can be
+//  split between threads of a job system. Two dimensional positions are kept
+//  on the plane of zero depth. Entities are removed when they are destroyed.
+//
+//  Example usage:
+//      Game::SpatialGridInfo info;
+//      info.cellSize = 8.0f;
+//
+//      Game::SpatialGrid grid;
+//      grid.Initialize(&entitySystem, info);
+//
+//      grid.Insert(entity, glm::vec3(1.0f, 2.0f, 3.0f));
+//      grid.Update(&jobSystem);
+//
+//      std::vector<EntityHandle> results;
+//      int count = grid.QueryRadius(glm::vec3(0.0f), 10.0f, results);
+//
+
+namespace Game
+{
+    // Spatial grid initialization struct.
+    struct SpatialGridInfo
+    {
+        // Edge length of a cell.
+        // Works best when close to the typical radius of queries.
+        float cellSize;
+
+        // Number of buckets that cells are hashed into.
+        // Must be a power of two.
+        int bucketCount;
+
+        SpatialGridInfo();
+    };
+
+    // Spatial grid class.
+    class SpatialGrid : private NonCopyable
+    {
+    public:
+        // Type declarations.
+        typedef std::vector<EntityHandle> EntityList;
+
+    public:
+        SpatialGrid();
+        ~SpatialGrid();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the spatial grid.
+        bool Initialize(EntitySystem* entitySystem, const SpatialGridInfo& info = SpatialGridInfo());
+
+        // Inserts an entity at a position.
+        // Returns false if the entity is not valid or has already been inserted.
+        bool Insert(const EntityHandle& entity, const glm::vec3& position);
+        bool Insert(const EntityHandle& entity, const glm::vec2& position);
+
+        // Changes the position of an entity.
+        bool SetPosition(const EntityHandle& entity, const glm::vec3& position);
+        bool SetPosition(const EntityHandle& entity, const glm::vec2& position);
+
+        // Removes an entity.
+        bool Remove(const EntityHandle& entity);
+
+        // Checks if an entity has been inserted.
+        bool Contains(const EntityHandle& entity) const;
+
+        // Gets the position of an entity.
+        // Returns nullptr if the entity has not been inserted.
+        const glm::vec3* GetPosition(const EntityHandle& entity) const;
+
+        // Applies pending changes by rebuilding the dense arrays.
+        // Splits the work between threads if a job system is given.
+        void Update(JobSystem* jobSystem = nullptr);
+
+        // Appends entities inside of a box or a sphere to the result list.
+        // Returns the number of appended entities. Can be called from multiple threads.
+        int QueryBox(const glm::vec3& minimum, const glm::vec3& maximum, EntityList& results) const;
+        int QueryBox(const glm::vec2& minimum, const glm::vec2& maximum, EntityList& results) const;
+
+        int QueryRadius(const glm::vec3& center, float radius, EntityList& results) const;
+        int QueryRadius(const glm::vec2& center, float radius, EntityList& results) const;
+
+        // Gets the number of inserted entities.
+        int GetSize() const;
+
+        // Checks if there are changes waiting for an update.
+        bool IsDirty() const;
+
+    private:
+        // Type declarations.
+        typedef std::vector<glm::vec3> PositionList;
+        typedef std::vector<glm::ivec3> CellList;
+        typedef std::vector<int> IndexList;
+        typedef std::function<void(int partition, int begin, int end)> PartitionFunction;
+
+    private:
+        // Calculates coordinates of the cell containing a position.
+        glm::ivec3 CalculateCell(const glm::vec3& position) const;
+
+        // Calculates the bucket of a cell.
+        int CalculateBucket(const glm::ivec3& cell) const;
+
+        // Finds the sparse index of an entity or returns -1.
+        int FindEntity(const EntityHandle& entity) const;
+
+        // Calls a function for partitions of handle entries, in parallel if a job system is given.
+        void ForEachPartition(JobSystem* jobSystem, int partitionCount, const PartitionFunction& function);
+
+        // Appends entities in a range of cells that pass a test.
+        template<typename Test>
+        int Query(const glm::vec3& minimum, const glm::vec3& maximum, Test test, EntityList& results) const;
+
+        // Called when an entity is destroyed.
+        void OnEntityDestroy(EntitySystem::Events::Destroy event);
+
+    private:
+        // Initialization parameters.
+        SpatialGridInfo m_info;
+
+        // Entity system that owns the entities.
+        EntitySystem* m_entitySystem;
+
+        // Handles, positions and dense indices indexed by entity handle identifiers.
+        EntityList   m_entities;
+        PositionList m_positions;
+        IndexList    m_denseIndices;
+
+        // Dense arrays sorted by buckets.
+        EntityList   m_denseEntities;
+        PositionList m_densePositions;
+        CellList     m_denseCells;
+
+        // Ranges of buckets in the dense arrays.
+        IndexList m_bucketStarts;
+
+        // Bucket offsets of each rebuild partition.
+        IndexList m_partitionOffsets;
+
+        // Number of inserted entities.
+        int m_entityCount;
+
+        // Pending changes state.
+        bool m_dirty;
+
+        // Entity system event receiver.
+        Receiver<void(EntitySystem::Events::Destroy)> m_entityDestroy;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
+
+// Template implementations.
+namespace Game
+{
+    template<typename Test>
+    int SpatialGrid::Query(const glm::vec3& minimum, const glm::vec3& maximum, Test test, EntityList& results) const
+    {
+        if(!m_initialized)
+            return 0;
+
+        std::size_t previousSize = results.size();
+
+        // Calculate the range of overlapped cells.
+        glm::ivec3 cellMinimum = this->CalculateCell(minimum);
+        glm::ivec3 cellMaximum = this->CalculateCell(maximum);
+
+        std::int64_t cellCount = 1;
+
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            cellCount *= (std::int64_t)cellMaximum[axis] - cellMinimum[axis] + 1;
+        }
+
+        // Scan all entities if there are more cells than entities.
+        if(cellCount > (std::int64_t)m_denseEntities.size())
+        {
+            for(std::size_t i = 0; i < m_denseEntities.size(); ++i)
+            {
+                if(m_denseEntities[i] != EntityHandle() && test(m_densePositions[i]))
+                {
+                    results.push_back(m_denseEntities[i]);
+                }
+            }
+
+            return (int)(results.size() - previousSize);
+        }
+
+        // Scan buckets of overlapped cells.
+        // Entities are only gathered from their own cells, which skips
+        // other cells hashed into the same buckets and avoids duplicates.
+        glm::ivec3 cell;
+
+        for(cell.z = cellMinimum.z; cell.z <= cellMaximum.z; ++cell.z)
+        for(cell.y = cellMinimum.y; cell.y <= cellMaximum.y; ++cell.y)
+        for(cell.x = cellMinimum.x; cell.x <= cellMaximum.x; ++cell.x)
+        {
+            int bucket = this->CalculateBucket(cell);
+
+            for(int i = m_bucketStarts[bucket]; i < m_bucketStarts[bucket + 1]; ++i)
+            {
+                if(m_denseCells[i] != cell)
+                    continue;
+
+                if(m_denseEntities[i] != EntityHandle() && test(m_densePositions[i]))
+                {
+                    results.push_back(m_denseEntities[i]);
+                }
+            }
+        }
+
+        return (int)(results.size() - previousSize);
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "EntityHandle.hpp"
+#include "ComponentPool.hpp"
+#include "Transform.hpp"
+
+//
+// Spatial Order
+//
+//  Reorders component pools by the Z-order curve of entity positions, so
+//  entities that are close in the world are also close in memory. Spatial
+//  queries and physics then touch neighboring cache lines instead of memory
+//  scattered in spawn order.
+//
+//  Positions are quantized into cells and coordinates of a cell are
+//  interleaved bit by bit into a Morton code. Cells should be about the size
+//  of typical queries, as entities within a cell keep their relative order.
+//  Entities without a transform are moved to the end of the pool.
+//
+//  Reordering moves every component that is out of place, so it is meant to
+//  run as an occasional pass between frames, such as every few seconds or
+//  after a level has been loaded. Pools that are already in order are not
+//  touched.
+//
+//  Example usage:
+//      Game::SortBySpatialOrder(transforms, transforms, 8.0f);
+//      Game::SortBySpatialOrder(bodies, transforms, 8.0f);
+//
+
+namespace Game
+{
+    namespace Detail
+    {
+        // Spreads the lower 21 bits of a value out to every third bit.
+        inline std::uint64_t SpreadMortonBits(std::uint64_t value)
+        {
+            value &= 0x1fffff;
+            value = (value | value << 32) & 0x001f00000000ffffULL;
+            value = (value | value << 16) & 0x001f0000ff0000ffULL;
+            value = (value | value << 8)  & 0x100f00f00f00f00fULL;
+            value = (value | value << 4)  & 0x10c30c30c30c30c3ULL;
+            value = (value | value << 2)  & 0x1249249249249249ULL;
+            return value;
+        }
+
+        // Quantizes a coordinate into an unsigned 21 bit cell coordinate.
+        inline std::uint64_t QuantizeMortonCoordinate(float coordinate, float inverseCellSize)
+        {
+            const double Bias = (double)(1 << 20);
+            const double Maximum = (double)((1 << 21) - 1);
+
+            double cell = std::floor((double)coordinate * inverseCellSize) + Bias;
+            return (std::uint64_t)std::min(std::max(cell, 0.0), Maximum);
+        }
+    }
+
+    // Calculates the Morton code of the cell containing a position.
+    // Never returns the maximum value, which is reserved for missing positions.
+    inline std::uint64_t CalculateMortonCode(const glm::vec3& position, float cellSize)
+    {
+        Assert(cellSize > 0.0f, "Invalid Morton cell size!");
+
+        float inverseCellSize = 1.0f / cellSize;
+
+        return Detail::SpreadMortonBits(Detail::QuantizeMortonCoordinate(position.x, inverseCellSize)) |
+            Detail::SpreadMortonBits(Detail::QuantizeMortonCoordinate(position.y, inverseCellSize)) << 1 |
+            Detail::SpreadMortonBits(Detail::QuantizeMortonCoordinate(position.z, inverseCellSize)) << 2;
+    }
+
+    // Reorders a pool by the Morton codes of transforms of its entities.
+    template<typename Type>
+    void SortBySpatialOrder(ComponentPool<Type>& pool, const ComponentPool<Transform>& transforms, float cellSize)
+    {
+        pool.SortByKey([&transforms, cellSize](const EntityHandle& entity, const Type&) -> std::uint64_t
+        {
+            const Transform* transform = transforms.Get(entity);
+
+            if(transform == nullptr)
+                return std::numeric_limits<std::uint64_t>::max();
+
+            return CalculateMortonCode(transform->position, cellSize);
+        });
+    }
+}
@@ -0,0 +1,314 @@
+#include "Precompiled.hpp"
+#include "SystemScheduler.hpp"
+#include "Common/ThreadOwner.hpp"
+using namespace Game;
+
+namespace
+{
+    // Component types that the system running on the calling thread declared.
+    // Threads outside of systems may access all component types.
+    struct SystemAccess
+    {
+        ComponentSignature reads;
+        ComponentSignature writes;
+    };
+
+    thread_local SystemAccess currentAccess = { SystemScheduler::AllComponents, SystemScheduler::AllComponents };
+
+    // Checks if two systems can't run at the same time.
+    // Reads of double buffered types do not conflict with their writes.
+    bool IsConflicting(ComponentSignature firstReads, ComponentSignature firstWrites,
+        ComponentSignature secondReads, ComponentSignature secondWrites, ComponentSignature doubleBuffered)
+    {
+        if((firstWrites & secondWrites) != 0)
+            return true;
+
+        return (((firstWrites & secondReads) | (secondWrites & firstReads)) & ~doubleBuffered) != 0;
+    }
+}
+
+SystemScheduler::SystemScheduler() :
+    m_doubleBuffered(0),
+    m_dirty(false)
+{
+}
+
+SystemScheduler::~SystemScheduler()
+{
+    this->Cleanup();
+}
+
+void SystemScheduler::Cleanup()
+{
+    // Remove all systems.
+    Utility::ClearContainer(m_systems);
+    Utility::ClearContainer(m_levelSystems);
+    Utility::ClearContainer(m_levelStarts);
+
+    m_doubleBuffered = 0;
+    m_dirty = false;
+}
+
+int SystemScheduler::AddSystem(std::string name, ComponentSignature reads, ComponentSignature writes, SystemFunction function)
+{
+    Assert(function != nullptr, "Adding a system without a function!");
+
+    // Add the system entry.
+    SystemEntry system;
+    system.name = std::move(name);
+    system.reads = reads;
+    system.writes = writes;
+    system.function = std::move(function);
+    system.level = 0;
+    system.timeBudget = 0.0;
+    system.sliceSize = 0;
+    system.cursor = 0;
+    system.passCount = 0;
+
+    m_systems.push_back(std::move(system));
+
+    // Rebuild the dependency graph before the next run.
+    m_dirty = true;
+
+    return (int)m_systems.size() - 1;
+}
+
+int SystemScheduler::AddBudgetedSystem(std::string name, ComponentSignature reads, ComponentSignature writes,
+    double timeBudget, int sliceSize, CountFunction count, SliceFunction slice)
+{
+    Assert(count != nullptr && slice != nullptr, "Adding a budgeted system without functions!");
+    Assert(sliceSize > 0, "Adding a budgeted system with an invalid slice size!");
+
+    // Add the system entry.
+    SystemEntry system;
+    system.name = std::move(name);
+    system.reads = reads;
+    system.writes = writes;
+    system.level = 0;
+    system.timeBudget = timeBudget;
+    system.sliceSize = std::max(sliceSize, 1);
+    system.count = std::move(count);
+    system.slice = std::move(slice);
+    system.cursor = 0;
+    system.passCount = 0;
+
+    m_systems.push_back(std::move(system));
+
+    // Rebuild the dependency graph before the next run.
+    m_dirty = true;
+
+    return (int)m_systems.size() - 1;
+}
+
+void SystemScheduler::SetDoubleBuffered(ComponentSignature types)
+{
+    m_doubleBuffered = types;
+
+    // Rebuild the dependency graph before the next run.
+    m_dirty = true;
+}
+
+void SystemScheduler::Run(JobSystem* jobSystem)
+{
+    if(m_dirty)
+    {
+        this->BuildLevels();
+    }
+
+    // Run levels one after another.
+    for(std::size_t level = 0; level + 1 < m_levelStarts.size(); ++level)
+    {
+        int begin = m_levelStarts[level];
+        int count = m_levelStarts[level + 1] - begin;
+
+        if(jobSystem == nullptr || count == 1)
+        {
+            for(int i = 0; i < count; ++i)
+            {
+                RunSystem(m_systems[m_levelSystems[begin + i]]);
+            }
+        }
+        else
+        {
+            jobSystem->ParallelFor(count, 1, [&](int first, int last)
+            {
+                for(int i = first; i < last; ++i)
+                {
+                    RunSystem(m_systems[m_levelSystems[begin + i]]);
+                }
+            });
+        }
+    }
+}
+
+void SystemScheduler::RunSystem(SystemEntry& system)
+{
+#if defined(THREAD_OWNER_CHECKS)
+    // Track declared access for checks of component storage, restoring the access of
+    // a system that runs this one while waiting for its own jobs.
+    SystemAccess previousAccess = currentAccess;
+    currentAccess.reads = system.reads | system.writes;
+    currentAccess.writes = system.writes;
+
+    SCOPE_GUARD(currentAccess = previousAccess);
+#endif
+
+    if(system.function)
+    {
+        system.function();
+    }
+    else
+    {
+        RunBudgetedSystem(system);
+    }
+}
+
+void SystemScheduler::RunBudgetedSystem(SystemEntry& system)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    // Range may have shrunk since the last run.
+    int count = system.count();
+    system.cursor = std::min(system.cursor, count);
+
+    // Process slices until the end of the range or the time budget.
+    // At least one slice is processed, so a pass always makes progress.
+    while(system.cursor < count)
+    {
+        int end = std::min(system.cursor + system.sliceSize, count);
+        system.slice(system.cursor, end);
+        system.cursor = end;
+
+        auto currentTime = std::chrono::high_resolution_clock::now();
+
+        if(std::chrono::duration<double>(currentTime - startTime).count() >= system.timeBudget)
+            break;
+    }
+
+    // Start a new pass at the next run.
+    if(count > 0 && system.cursor >= count)
+    {
+        system.cursor = 0;
+        system.passCount += 1;
+    }
+}
+
+int SystemScheduler::GetSystemCount() const
+{
+    return (int)m_systems.size();
+}
+
+const std::string& SystemScheduler::GetSystemName(int system) const
+{
+    Assert(system >= 0 && system < (int)m_systems.size(), "Invalid system index!");
+
+    return m_systems[system].name;
+}
+
+bool SystemScheduler::IsReadDeclared(ComponentSignature types)
+{
+    return (types & ~currentAccess.reads) == 0;
+}
+
+bool SystemScheduler::IsWriteDeclared(ComponentSignature types)
+{
+    return (types & ~currentAccess.writes) == 0;
+}
+
+ComponentSignature SystemScheduler::GetSystemReads(int system) const
+{
+    Assert(system >= 0 && system < (int)m_systems.size(), "Invalid system index!");
+
+    return m_systems[system].reads;
+}
+
+ComponentSignature SystemScheduler::GetSystemWrites(int system) const
+{
+    Assert(system >= 0 && system < (int)m_systems.size(), "Invalid system index!");
+
+    return m_systems[system].writes;
+}
+
+int SystemScheduler::GetSystemCursor(int system) const
+{
+    Assert(system >= 0 && system < (int)m_systems.size(), "Invalid system index!");
+
+    return m_systems[system].cursor;
+}
+
+int SystemScheduler::GetSystemPassCount(int system) const
+{
+    Assert(system >= 0 && system < (int)m_systems.size(), "Invalid system index!");
+
+    return m_systems[system].passCount;
+}
+
+int SystemScheduler::GetSystemLevel(int system)
+{
+    Assert(system >= 0 && system < (int)m_systems.size(), "Invalid system index!");
+
+    if(m_dirty)
+    {
+        this->BuildLevels();
+    }
+
+    return m_systems[system].level;
+}
+
+int SystemScheduler::GetLevelCount()
+{
+    if(m_dirty)
+    {
+        this->BuildLevels();
+    }
+
+    return std::max(0, (int)m_levelStarts.size() - 1);
+}
+
+void SystemScheduler::BuildLevels()
+{
+    // Place each system one level after the last earlier system it conflicts with.
+    // Levels then respect the order of conflicting systems as they were added.
+    int levelCount = 0;
+
+    for(std::size_t i = 0; i < m_systems.size(); ++i)
+    {
+        SystemEntry& system = m_systems[i];
+        system.level = 0;
+
+        for(std::size_t j = 0; j < i; ++j)
+        {
+            const SystemEntry& previous = m_systems[j];
+
+            if(IsConflicting(previous.reads, previous.writes, system.reads, system.writes, m_doubleBuffered))
+            {
+                system.level = std::max(system.level, previous.level + 1);
+            }
+        }
+
+        levelCount = std::max(levelCount, system.level + 1);
+    }
+
+    // Sort systems by levels while keeping their order within a level.
+    m_levelStarts.assign(levelCount + 1, 0);
+
+    for(const SystemEntry& system : m_systems)
+    {
+        m_levelStarts[system.level + 1] += 1;
+    }
+
+    for(int level = 0; level < levelCount; ++level)
+    {
+        m_levelStarts[level + 1] += m_levelStarts[level];
+    }
+
+    IndexList offsets(m_levelStarts.begin(), m_levelStarts.end() - 1);
+    m_levelSystems.resize(m_systems.size());
+
+    for(std::size_t i = 0; i < m_systems.size(); ++i)
+    {
+        m_levelSystems[offsets[m_systems[i].level]++] = (int)i;
+    }
+
+    m_dirty = false;
+}
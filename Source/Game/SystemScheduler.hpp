@@ -0,0 +1,176 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/JobSystem.hpp"
+#include "ComponentType.hpp"
+
+//
+// System Scheduler
+//
+//  Runs game systems once per frame and spreads them between threads.
+//  Each system declares the component types it reads and writes. Two systems
+//  conflict when one writes a type the other reads or writes, in which case
+//  the one added first runs first. Conflicts form a dependency graph that is
+//  split into levels, where systems in the same level never conflict and run
+//  in parallel. Levels run one after another. A level with a single system
+//  runs it on the calling thread, so it can use the job system by itself.
+//
+//  Component types stored in double buffered pools are read from the last
+//  tick and written for the next one, so their readers do not conflict with
+//  their writers. Only systems that write the same such type are ordered.
+//
+//  Example usage:
+//      Game::SystemScheduler scheduler;
+//
+//      scheduler.AddSystem("Movement",
+//          Game::ComponentTypes::GetSignature<Velocity>(),
+//          Game::ComponentTypes::GetSignature<Transform>(),
+//          [&]() { /* ... */ });
+//
+//      scheduler.AddSystem("Rendering",
+//          Game::ComponentTypes::GetSignature<Transform, Sprite>(), 0,
+//          [&]() { /* ... */ });
+//
+//      scheduler.SetDoubleBuffered(Game::ComponentTypes::GetSignature<Velocity>());
+//      scheduler.Run(&jobSystem);
+//
+//  Builds with thread checks track the component types declared by the system
+//  running on each thread, and component storage asserts when a system accesses
+//  types it did not declare. Access is tracked per thread, so it is not tracked
+//  reliably for systems that wait for jobs while running on fibers.
+//
+//  A system that is the only one of its level runs on the thread that runs the
+//  scheduler, while systems that share a level run on job threads. Systems on
+//  job threads must not create or destroy entities directly on an entity system
+//  owned by another thread, and use concurrent creation or command buffers.
+//
+//  Budgeted systems process a range of a dense array in slices until they
+//  have spent their time budget, and continue from a cursor at the next run.
+//  Work that may lag behind, such as planning or cleanup, is then spread over
+//  frames instead of spiking a single one. The cursor wraps around once the
+//  end has been reached, starting a new pass at the next run. Components that
+//  are added, removed or reordered between runs may be skipped or visited
+//  twice within a pass.
+//
+//  Budgeted system example:
+//      scheduler.AddBudgetedSystem("Planning",
+//          Game::ComponentTypes::GetSignature<Transform>(),
+//          Game::ComponentTypes::GetSignature<Planner>(),
+//          0.0005, 64, [&]() { return planners.GetSize(); },
+//          [&](int begin, int end) { /* Update planners from begin to end. */ });
+//
+
+namespace Game
+{
+    // System scheduler class.
+    class SystemScheduler : private NonCopyable
+    {
+    public:
+        // Type declarations.
+        typedef std::function<void()> SystemFunction;
+        typedef std::function<int()> CountFunction;
+        typedef std::function<void(int, int)> SliceFunction;
+
+        // Signature of a system that conflicts with all other systems.
+        static const ComponentSignature AllComponents = ~(ComponentSignature)0;
+
+    public:
+        SystemScheduler();
+        ~SystemScheduler();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Adds a system with its component access.
+        // Returns the index of the system.
+        int AddSystem(std::string name, ComponentSignature reads, ComponentSignature writes, SystemFunction function);
+
+        // Adds a system that processes slices of a range within a time budget in seconds.
+        // Count function returns the size of the range at each run.
+        // Returns the index of the system.
+        int AddBudgetedSystem(std::string name, ComponentSignature reads, ComponentSignature writes,
+            double timeBudget, int sliceSize, CountFunction count, SliceFunction slice);
+
+        // Sets component types that are stored in double buffered pools.
+        void SetDoubleBuffered(ComponentSignature types);
+
+        // Runs all systems and waits for them to finish.
+        // Systems run on the calling thread if no job system is given.
+        void Run(JobSystem* jobSystem = nullptr);
+
+        // Gets the number of systems.
+        int GetSystemCount() const;
+
+        // Gets the name of a system.
+        const std::string& GetSystemName(int system) const;
+
+        // Gets component types that a system reads and writes.
+        ComponentSignature GetSystemReads(int system) const;
+        ComponentSignature GetSystemWrites(int system) const;
+
+        // Checks if the system running on the calling thread declared reading or writing
+        // all of the component types. Always true outside of systems, which includes jobs
+        // that systems spread to other threads, and in builds without thread checks.
+        static bool IsReadDeclared(ComponentSignature types);
+        static bool IsWriteDeclared(ComponentSignature types);
+
+        // Gets the position where a budgeted system continues at the next run.
+        int GetSystemCursor(int system) const;
+
+        // Gets the number of passes a budgeted system has completed.
+        int GetSystemPassCount(int system) const;
+
+        // Gets the level of a system in the dependency graph.
+        int GetSystemLevel(int system);
+
+        // Gets the number of levels in the dependency graph.
+        int GetLevelCount();
+
+    private:
+        // System entry.
+        struct SystemEntry
+        {
+            std::string name;
+            ComponentSignature reads;
+            ComponentSignature writes;
+            SystemFunction function;
+            int level;
+
+            // Budgeted execution state.
+            double timeBudget;
+            int sliceSize;
+            CountFunction count;
+            SliceFunction slice;
+            int cursor;
+            int passCount;
+        };
+
+        // Type declarations.
+        typedef std::vector<SystemEntry> SystemList;
+        typedef std::vector<int> IndexList;
+
+    private:
+        // Builds levels of the dependency graph.
+        void BuildLevels();
+
+        // Runs a single system.
+        static void RunSystem(SystemEntry& system);
+
+        // Runs slices of a budgeted system until its time budget has been spent.
+        static void RunBudgetedSystem(SystemEntry& system);
+
+    private:
+        // List of systems in the order they were added.
+        SystemList m_systems;
+
+        // System indices sorted by levels and ranges of levels.
+        IndexList m_levelSystems;
+        IndexList m_levelStarts;
+
+        // Component types stored in double buffered pools.
+        ComponentSignature m_doubleBuffered;
+
+        // Dependency graph state.
+        bool m_dirty;
+    };
+}
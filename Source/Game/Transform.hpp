@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Transform
+//
+//  Component that places an entity in the world. Depth is stored as the z
+//  coordinate of the position.
+//
+//  Entities that never move can be marked with the Static component, which
+//  lets systems bake their data once instead of processing it every frame.
+//
+
+namespace Game
+{
+    // Transform component.
+    struct Transform
+    {
+        Transform() :
+            position(0.0f, 0.0f, 0.0f),
+            rotation(0.0f),
+            scale(1.0f, 1.0f)
+        {
+        }
+
+        // Position in world units.
+        glm::vec3 position;
+
+        // Rotation in radians.
+        float rotation;
+
+        // Scale along local axes.
+        glm::vec2 scale;
+    };
+
+    // Marks entities whose transforms never change.
+    struct Static
+    {
+    };
+}
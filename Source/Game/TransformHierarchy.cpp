@@ -0,0 +1,366 @@
+#include "Precompiled.hpp"
+#include "TransformHierarchy.hpp"
+using namespace Game;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize the transform hierarchy! "
+
+    // Constant variables.
+    const int InvalidNode = -1;
+}
+
+TransformHierarchy::TransformHierarchy() :
+    m_entitySystem(nullptr),
+    m_initialized(false)
+{
+}
+
+TransformHierarchy::~TransformHierarchy()
+{
+    this->Cleanup();
+}
+
+void TransformHierarchy::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Unsubscribe from the entity system.
+    m_entityDestroy.Cleanup();
+    m_entitySystem = nullptr;
+
+    // Clear node arrays.
+    Utility::ClearContainer(m_entities);
+    Utility::ClearContainer(m_parents);
+    Utility::ClearContainer(m_sizes);
+    Utility::ClearContainer(m_localTransforms);
+    Utility::ClearContainer(m_worldTransforms);
+    Utility::ClearContainer(m_nodeIndices);
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool TransformHierarchy::Initialize(EntitySystem* entitySystem)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(entitySystem == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid entity system.";
+        return false;
+    }
+
+    m_entitySystem = entitySystem;
+
+    // Destroy descendants of destroyed entities.
+    m_entityDestroy.Bind<TransformHierarchy, &TransformHierarchy::OnEntityDestroy>(this);
+    m_entityDestroy.Subscribe(entitySystem->events.destroy);
+
+    // Success!
+    return m_initialized = true;
+}
+
+bool TransformHierarchy::Insert(const EntityHandle& entity, const EntityHandle& parent)
+{
+    if(!m_initialized)
+        return false;
+
+    // Check arguments.
+    if(!m_entitySystem->IsHandleValid(entity) || this->Contains(entity))
+        return false;
+
+    int parentIndex = InvalidNode;
+
+    if(parent != EntityHandle())
+    {
+        parentIndex = this->FindNode(parent);
+
+        if(parentIndex == InvalidNode)
+            return false;
+    }
+
+    // Make sure the index array can hold the entity.
+    int entityIndex = entity.GetIdentifier() - 1;
+
+    if(entityIndex >= (int)m_nodeIndices.size())
+    {
+        m_nodeIndices.resize(entityIndex + 1, InvalidNode);
+    }
+
+    // Insert a single node range.
+    NodeRange range;
+    range.entities.push_back(entity);
+    range.parents.push_back(InvalidNode);
+    range.sizes.push_back(1);
+    range.localTransforms.push_back(glm::mat4(1.0f));
+    range.worldTransforms.push_back(parentIndex != InvalidNode ? m_worldTransforms[parentIndex] : glm::mat4(1.0f));
+
+    this->InsertRange(parentIndex, range);
+
+    return true;
+}
+
+bool TransformHierarchy::SetParent(const EntityHandle& entity, const EntityHandle& parent)
+{
+    if(!m_initialized)
+        return false;
+
+    int nodeIndex = this->FindNode(entity);
+
+    if(nodeIndex == InvalidNode)
+        return false;
+
+    // Find the new parent outside of the moved subtree.
+    int parentIndex = InvalidNode;
+
+    if(parent != EntityHandle())
+    {
+        parentIndex = this->FindNode(parent);
+
+        if(parentIndex == InvalidNode)
+            return false;
+
+        if(parentIndex >= nodeIndex && parentIndex < nodeIndex + m_sizes[nodeIndex])
+            return false;
+    }
+
+    // Move the subtree as a single range.
+    NodeRange range;
+    this->ExtractRange(nodeIndex, range);
+
+    parentIndex = parent != EntityHandle() ? this->FindNode(parent) : InvalidNode;
+    this->InsertRange(parentIndex, range);
+
+    return true;
+}
+
+bool TransformHierarchy::Remove(const EntityHandle& entity)
+{
+    if(!m_initialized)
+        return false;
+
+    int nodeIndex = this->FindNode(entity);
+
+    if(nodeIndex == InvalidNode)
+        return false;
+
+    // Remove the whole subtree.
+    NodeRange range;
+    this->ExtractRange(nodeIndex, range);
+
+    return true;
+}
+
+bool TransformHierarchy::Contains(const EntityHandle& entity) const
+{
+    return this->FindNode(entity) != InvalidNode;
+}
+
+EntityHandle TransformHierarchy::GetParent(const EntityHandle& entity) const
+{
+    int nodeIndex = this->FindNode(entity);
+
+    if(nodeIndex == InvalidNode || m_parents[nodeIndex] == InvalidNode)
+        return EntityHandle();
+
+    return m_entities[m_parents[nodeIndex]];
+}
+
+void TransformHierarchy::SetLocalTransform(const EntityHandle& entity, const glm::mat4& transform)
+{
+    int nodeIndex = this->FindNode(entity);
+
+    if(nodeIndex == InvalidNode)
+        return;
+
+    m_localTransforms[nodeIndex] = transform;
+}
+
+const glm::mat4* TransformHierarchy::GetLocalTransform(const EntityHandle& entity) const
+{
+    int nodeIndex = this->FindNode(entity);
+
+    if(nodeIndex == InvalidNode)
+        return nullptr;
+
+    return &m_localTransforms[nodeIndex];
+}
+
+const glm::mat4* TransformHierarchy::GetWorldTransform(const EntityHandle& entity) const
+{
+    int nodeIndex = this->FindNode(entity);
+
+    if(nodeIndex == InvalidNode)
+        return nullptr;
+
+    return &m_worldTransforms[nodeIndex];
+}
+
+void TransformHierarchy::UpdateTransforms()
+{
+    // Parents always precede their children, so their world
+    // transforms are already up to date when a child is reached.
+    for(std::size_t i = 0; i < m_entities.size(); ++i)
+    {
+        int parentIndex = m_parents[i];
+
+        if(parentIndex == InvalidNode)
+        {
+            m_worldTransforms[i] = m_localTransforms[i];
+        }
+        else
+        {
+            m_worldTransforms[i] = m_worldTransforms[parentIndex] * m_localTransforms[i];
+        }
+    }
+}
+
+int TransformHierarchy::GetSize() const
+{
+    return (int)m_entities.size();
+}
+
+const EntityHandle* TransformHierarchy::GetEntities() const
+{
+    return m_entities.data();
+}
+
+const glm::mat4* TransformHierarchy::GetWorldTransforms() const
+{
+    return m_worldTransforms.data();
+}
+
+int TransformHierarchy::FindNode(const EntityHandle& entity) const
+{
+    int entityIndex = entity.GetIdentifier() - 1;
+
+    if(entityIndex < 0 || entityIndex >= (int)m_nodeIndices.size())
+        return InvalidNode;
+
+    int nodeIndex = m_nodeIndices[entityIndex];
+
+    if(nodeIndex == InvalidNode || m_entities[nodeIndex] != entity)
+        return InvalidNode;
+
+    return nodeIndex;
+}
+
+void TransformHierarchy::ResizeAncestors(int nodeIndex, int difference)
+{
+    for(int ancestor = nodeIndex; ancestor != InvalidNode; ancestor = m_parents[ancestor])
+    {
+        m_sizes[ancestor] += difference;
+    }
+}
+
+void TransformHierarchy::UpdateIndices(int firstNode)
+{
+    for(int i = firstNode; i < (int)m_entities.size(); ++i)
+    {
+        m_nodeIndices[m_entities[i].GetIdentifier() - 1] = i;
+    }
+}
+
+void TransformHierarchy::ExtractRange(int nodeIndex, NodeRange& range)
+{
+    int count = m_sizes[nodeIndex];
+    int end = nodeIndex + count;
+
+    // Copy nodes of the subtree with parents relative to its root.
+    range.entities.assign(m_entities.begin() + nodeIndex, m_entities.begin() + end);
+    range.parents.assign(m_parents.begin() + nodeIndex, m_parents.begin() + end);
+    range.sizes.assign(m_sizes.begin() + nodeIndex, m_sizes.begin() + end);
+    range.localTransforms.assign(m_localTransforms.begin() + nodeIndex, m_localTransforms.begin() + end);
+    range.worldTransforms.assign(m_worldTransforms.begin() + nodeIndex, m_worldTransforms.begin() + end);
+
+    range.parents[0] = InvalidNode;
+
+    for(int i = 1; i < count; ++i)
+    {
+        range.parents[i] -= nodeIndex;
+    }
+
+    // Shrink subtrees of ancestors.
+    this->ResizeAncestors(m_parents[nodeIndex], -count);
+
+    // Erase the range from node arrays.
+    m_entities.erase(m_entities.begin() + nodeIndex, m_entities.begin() + end);
+    m_parents.erase(m_parents.begin() + nodeIndex, m_parents.begin() + end);
+    m_sizes.erase(m_sizes.begin() + nodeIndex, m_sizes.begin() + end);
+    m_localTransforms.erase(m_localTransforms.begin() + nodeIndex, m_localTransforms.begin() + end);
+    m_worldTransforms.erase(m_worldTransforms.begin() + nodeIndex, m_worldTransforms.begin() + end);
+
+    // Shift parent indices that pointed past the range.
+    for(int i = nodeIndex; i < (int)m_parents.size(); ++i)
+    {
+        if(m_parents[i] >= end)
+        {
+            m_parents[i] -= count;
+        }
+    }
+
+    // Remove extracted entities from the index array.
+    for(const EntityHandle& entity : range.entities)
+    {
+        m_nodeIndices[entity.GetIdentifier() - 1] = InvalidNode;
+    }
+
+    this->UpdateIndices(nodeIndex);
+}
+
+void TransformHierarchy::InsertRange(int parentIndex, NodeRange& range)
+{
+    int count = (int)range.entities.size();
+
+    // New last child is placed at the end of the parent's subtree.
+    int nodeIndex = parentIndex != InvalidNode ? parentIndex + m_sizes[parentIndex] : (int)m_entities.size();
+
+    // Shift parent indices that point past the insertion point.
+    for(int i = nodeIndex; i < (int)m_parents.size(); ++i)
+    {
+        if(m_parents[i] >= nodeIndex)
+        {
+            m_parents[i] += count;
+        }
+    }
+
+    // Make parents of the range absolute.
+    range.parents[0] = parentIndex;
+
+    for(int i = 1; i < count; ++i)
+    {
+        range.parents[i] += nodeIndex;
+    }
+
+    // Insert the range into node arrays.
+    m_entities.insert(m_entities.begin() + nodeIndex, range.entities.begin(), range.entities.end());
+    m_parents.insert(m_parents.begin() + nodeIndex, range.parents.begin(), range.parents.end());
+    m_sizes.insert(m_sizes.begin() + nodeIndex, range.sizes.begin(), range.sizes.end());
+    m_localTransforms.insert(m_localTransforms.begin() + nodeIndex, range.localTransforms.begin(), range.localTransforms.end());
+    m_worldTransforms.insert(m_worldTransforms.begin() + nodeIndex, range.worldTransforms.begin(), range.worldTransforms.end());
+
+    // Grow subtrees of ancestors.
+    this->ResizeAncestors(parentIndex, count);
+
+    this->UpdateIndices(nodeIndex);
+}
+
+void TransformHierarchy::OnEntityDestroy(EntitySystem::Events::Destroy event)
+{
+    int nodeIndex = this->FindNode(event.handle);
+
+    if(nodeIndex == InvalidNode)
+        return;
+
+    // Remove the subtree and destroy its descendants.
+    // Their destroy commands are processed in the same ProcessCommands() call.
+    NodeRange range;
+    this->ExtractRange(nodeIndex, range);
+
+    m_entitySystem->DestroyEntities(range.entities.data() + 1, (int)range.entities.size() - 1);
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "EntityHandle.hpp"
+#include "EntitySystem.hpp"
+
+//
+// Transform Hierarchy
+//
+//  Keeps parent and child relationships between entities along with their
+//  local and world transforms. Nodes are stored in contiguous arrays sorted
+//  in depth first order, so every parent precedes its children and world
+//  transforms are propagated in a single linear pass without following any
+//  pointers. Each node also stores the size of its subtree, which makes a
+//  subtree a contiguous range of the arrays. Changing the structure shifts
+//  the arrays and costs linear time, while iterating does not. Destroying
+//  an entity destroys all of its descendants as well.
+//
+//  Example usage:
+//      Game::TransformHierarchy hierarchy;
+//      hierarchy.Initialize(&entitySystem);
+//
+//      hierarchy.Insert(body);
+//      hierarchy.Insert(arm, body);
+//      hierarchy.SetLocalTransform(arm, glm::mat4(1.0f));
+//
+//      hierarchy.UpdateTransforms();
+//      const glm::mat4* world = hierarchy.GetWorldTransform(arm);
+//
+
+namespace Game
+{
+    // Transform hierarchy class.
+    class TransformHierarchy : private NonCopyable
+    {
+    public:
+        TransformHierarchy();
+        ~TransformHierarchy();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the transform hierarchy.
+        bool Initialize(EntitySystem* entitySystem);
+
+        // Inserts an entity as the last child of a parent.
+        // Entity becomes a root if the parent handle is invalid.
+        bool Insert(const EntityHandle& entity, const EntityHandle& parent = EntityHandle());
+
+        // Moves an entity with all of its descendants under another parent.
+        // Fails if the new parent is the entity itself or one of its descendants.
+        bool SetParent(const EntityHandle& entity, const EntityHandle& parent);
+
+        // Removes an entity with all of its descendants without destroying them.
+        bool Remove(const EntityHandle& entity);
+
+        // Checks if an entity is a node of the hierarchy.
+        bool Contains(const EntityHandle& entity) const;
+
+        // Gets the parent of an entity.
+        // Returns an invalid handle for roots and entities that are not in the hierarchy.
+        EntityHandle GetParent(const EntityHandle& entity) const;
+
+        // Sets the transform of an entity relative to its parent.
+        void SetLocalTransform(const EntityHandle& entity, const glm::mat4& transform);
+
+        // Gets transforms of an entity.
+        // Returns nullptr if the entity is not in the hierarchy.
+        const glm::mat4* GetLocalTransform(const EntityHandle& entity) const;
+        const glm::mat4* GetWorldTransform(const EntityHandle& entity) const;
+
+        // Calculates world transforms of all nodes.
+        void UpdateTransforms();
+
+        // Gets the number of nodes.
+        int GetSize() const;
+
+        // Gets arrays of entities and their world transforms in depth first order.
+        const EntityHandle* GetEntities() const;
+        const glm::mat4* GetWorldTransforms() const;
+
+    private:
+        // Type declarations.
+        typedef std::vector<EntityHandle> EntityList;
+        typedef std::vector<int> IndexList;
+        typedef std::vector<glm::mat4> TransformList;
+
+        // Detached range of nodes.
+        struct NodeRange
+        {
+            EntityList entities;
+            IndexList parents;
+            IndexList sizes;
+            TransformList localTransforms;
+            TransformList worldTransforms;
+        };
+
+    private:
+        // Finds the node index of an entity or returns -1.
+        int FindNode(const EntityHandle& entity) const;
+
+        // Changes subtree sizes of a node and all of its ancestors.
+        void ResizeAncestors(int nodeIndex, int difference);
+
+        // Updates sparse indices of nodes starting at an index.
+        void UpdateIndices(int firstNode);
+
+        // Removes a subtree and returns its nodes with parents relative to its root.
+        void ExtractRange(int nodeIndex, NodeRange& range);
+
+        // Inserts a range of nodes as the last child of a parent.
+        void InsertRange(int parentIndex, NodeRange& range);
+
+        // Called when an entity is destroyed.
+        void OnEntityDestroy(EntitySystem::Events::Destroy event);
+
+    private:
+        // Entity system that owns the entities.
+        EntitySystem* m_entitySystem;
+
+        // Node arrays sorted in depth first order.
+        EntityList m_entities;
+        IndexList m_parents;
+        IndexList m_sizes;
+        TransformList m_localTransforms;
+        TransformList m_worldTransforms;
+
+        // Node indices indexed by entity handle identifiers.
+        IndexList m_nodeIndices;
+
+        // Entity system event receiver.
+        Receiver<void(EntitySystem::Events::Destroy)> m_entityDestroy;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,644 @@
+#include "Precompiled.hpp"
+#include "WorldPartition.hpp"
+#include "Common/BinaryStream.hpp"
+using namespace Game;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize a world partition! "
+    #define LogLoadCellError(name) "Failed to load a world cell \"" << name << "\"! "
+    #define LogWriteCellError() "Failed to write a world cell! "
+
+    // Cell format identification.
+    const std::uint32_t CellMagic   = 0x4C454357; // "WCEL"
+    const std::uint32_t CellVersion = 1;
+
+    // Cell header.
+    struct CellHeader
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::int32_t groupCount;
+        std::int32_t entityCount;
+    };
+
+    // Header of a group of entities with the same components.
+    struct CellGroup
+    {
+        std::uint64_t signature;
+        std::int32_t entityCount;
+        std::int32_t reserved;
+    };
+
+    // Counts component types in a signature.
+    int CountComponents(ComponentSignature signature)
+    {
+        int count = 0;
+
+        for(; signature != 0; signature &= signature - 1)
+        {
+            ++count;
+        }
+
+        return count;
+    }
+}
+
+WorldPartitionInfo::WorldPartitionInfo() :
+    entitySystem(nullptr),
+    componentSystem(nullptr),
+    archive(nullptr),
+    cellPrefix("Cells/"),
+    cellSize(64.0f),
+    loadRadius(2),
+    threadCount(2),
+    destroyLimit(1024)
+{
+}
+
+WorldPartition::WorldPartition() :
+    m_exit(false),
+    m_initialized(false)
+{
+}
+
+WorldPartition::~WorldPartition()
+{
+    this->Cleanup();
+}
+
+void WorldPartition::Cleanup()
+{
+    // Stop IO threads after they finish loading their cells.
+    // Also called on a partially initialized partition when initialization fails.
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_exit = true;
+    }
+
+    m_condition.notify_all();
+
+    for(std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+
+    Utility::ClearContainer(m_workers);
+
+    // Drop queued and staged cells.
+    Utility::ClearContainer(m_cells);
+    Utility::ClearContainer(m_requests);
+    Utility::ClearContainer(m_staged);
+    Utility::ClearContainer(m_committed);
+    Utility::ClearContainer(m_handles);
+
+    m_exit = false;
+
+    // Reset initialization parameters.
+    m_info = WorldPartitionInfo();
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool WorldPartition::Initialize(const WorldPartitionInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            this->Cleanup();
+        }
+    );
+
+    // Validate arguments.
+    if(info.entitySystem == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid entity system.";
+        return false;
+    }
+
+    if(info.componentSystem == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid component system.";
+        return false;
+    }
+
+    if(info.archive == nullptr || !info.archive->IsOpen())
+    {
+        LogError() << LogInitializeError() << "Invalid archive.";
+        return false;
+    }
+
+    if(info.cellSize <= 0.0f)
+    {
+        LogError() << LogInitializeError() << "Invalid cell size.";
+        return false;
+    }
+
+    if(info.loadRadius < 0)
+    {
+        LogError() << LogInitializeError() << "Invalid load radius.";
+        return false;
+    }
+
+    if(info.threadCount <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid thread count.";
+        return false;
+    }
+
+    m_info = info;
+
+    // Start IO threads.
+    for(int i = 0; i < m_info.threadCount; ++i)
+    {
+        m_workers.emplace_back(&WorldPartition::RunWorker, this);
+    }
+
+    // Success!
+    return m_initialized = true;
+}
+
+void WorldPartition::SetFocus(const glm::vec3& position)
+{
+    if(!m_initialized)
+        return;
+
+    glm::ivec2 focus = this->CalculateCell(position);
+    int unloadRadius = m_info.loadRadius + 1;
+
+    // Unload cells out of range, or cancel their loads.
+    std::vector<std::uint64_t> cancelled;
+
+    for(auto& pair : m_cells)
+    {
+        glm::ivec2 cell = GetCell(pair.first);
+        int distance = std::max(std::abs(cell.x - focus.x), std::abs(cell.y - focus.y));
+
+        Cell& streamed = pair.second;
+
+        if(distance > unloadRadius)
+        {
+            if(streamed.state == CellStates::Loading && !streamed.cancelled)
+            {
+                streamed.cancelled = true;
+                cancelled.push_back(pair.first);
+            }
+            else if(streamed.state == CellStates::Loaded)
+            {
+                streamed.state = CellStates::Unloading;
+            }
+        }
+        else if(distance <= m_info.loadRadius && streamed.state == CellStates::Loading)
+        {
+            streamed.cancelled = false;
+        }
+    }
+
+    if(!cancelled.empty())
+    {
+        this->CancelRequests(cancelled);
+    }
+
+    // Find cells in range that are not streamed yet.
+    std::vector<std::uint64_t> loads;
+
+    for(int z = focus.y - m_info.loadRadius; z <= focus.y + m_info.loadRadius; ++z)
+    {
+        for(int x = focus.x - m_info.loadRadius; x <= focus.x + m_info.loadRadius; ++x)
+        {
+            std::uint64_t key = MakeKey(glm::ivec2(x, z));
+
+            if(m_cells.find(key) != m_cells.end())
+                continue;
+
+            Cell& cell = m_cells[key];
+            cell.state = CellStates::Loading;
+            cell.cancelled = false;
+
+            loads.push_back(key);
+        }
+    }
+
+    if(loads.empty())
+        return;
+
+    // Queue the nearest cells first.
+    std::sort(loads.begin(), loads.end(), [&focus](std::uint64_t a, std::uint64_t b)
+    {
+        glm::ivec2 cellA = GetCell(a) - focus;
+        glm::ivec2 cellB = GetCell(b) - focus;
+
+        return cellA.x * cellA.x + cellA.y * cellA.y < cellB.x * cellB.x + cellB.y * cellB.y;
+    });
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests.insert(m_requests.end(), loads.begin(), loads.end());
+    }
+
+    m_condition.notify_all();
+}
+
+void WorldPartition::CancelRequests(const std::vector<std::uint64_t>& keys)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Cells that are not queued anymore are discarded once they are staged.
+    for(std::uint64_t key : keys)
+    {
+        auto it = std::find(m_requests.begin(), m_requests.end(), key);
+
+        if(it != m_requests.end())
+        {
+            m_requests.erase(it);
+            m_cells.erase(key);
+        }
+    }
+}
+
+void WorldPartition::ProcessCommands()
+{
+    if(!m_initialized)
+        return;
+
+    // Take cells staged by IO threads.
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_committed.swap(m_staged);
+    }
+
+    // Commit staged cells in a single batch.
+    for(const StagedCell& staged : m_committed)
+    {
+        auto it = m_cells.find(staged.key);
+        Assert(it != m_cells.end() && it->second.state == CellStates::Loading, "Staged cell is not being loaded!");
+
+        if(it->second.cancelled)
+        {
+            m_cells.erase(it);
+            continue;
+        }
+
+        // Cells that failed to load stay empty, so they are not loaded again.
+        if(staged.succeeded)
+        {
+            this->CommitCell(it->second, staged);
+        }
+
+        it->second.state = CellStates::Loaded;
+    }
+
+    m_committed.clear();
+
+    // Destroy entities of unloading cells up to the limit.
+    int destroyBudget = m_info.destroyLimit;
+
+    for(auto it = m_cells.begin(); it != m_cells.end(); )
+    {
+        Cell& cell = it->second;
+
+        if(cell.state != CellStates::Unloading)
+        {
+            ++it;
+            continue;
+        }
+
+        if(m_info.destroyLimit > 0 && destroyBudget <= 0)
+            break;
+
+        int destroyCount = (int)cell.entities.size();
+
+        if(m_info.destroyLimit > 0)
+        {
+            destroyCount = std::min(destroyCount, destroyBudget);
+            destroyBudget -= destroyCount;
+        }
+
+        // Destroy entities from the back of the list, so it only shrinks.
+        std::size_t remaining = cell.entities.size() - destroyCount;
+        m_info.entitySystem->DestroyEntities(cell.entities.data() + remaining, destroyCount);
+        cell.entities.resize(remaining);
+
+        if(cell.entities.empty())
+        {
+            it = m_cells.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void WorldPartition::CommitCell(Cell& cell, const StagedCell& staged)
+{
+    for(const StagedGroup& group : staged.groups)
+    {
+        if(group.count == 0)
+            continue;
+
+        // Check that component types match this build.
+        bool matching = true;
+        int column = 0;
+
+        for(int component = 0; component < ComponentTypes::MaximumCount; ++component)
+        {
+            if(!(group.signature & ComponentTypes::GetSignatureBit(component)))
+                continue;
+
+            matching = matching && component < ComponentTypes::GetCount();
+            matching = matching && ComponentTypes::GetInfo(component).size == group.componentSizes[column];
+            ++column;
+        }
+
+        if(!matching)
+        {
+            LogError() << LogLoadCellError(GetCellName(m_info.cellPrefix, GetCell(staged.key))) << "Component types do not match.";
+            continue;
+        }
+
+        // Copy columns straight into archetype chunks.
+        m_handles.resize(group.count);
+        m_info.componentSystem->InstantiateColumns(group.signature, group.count, group.columns.data(), m_handles.data());
+
+        cell.entities.insert(cell.entities.end(), m_handles.begin(), m_handles.end());
+    }
+}
+
+void WorldPartition::LoadCell(StagedCell& staged) const
+{
+    staged.succeeded = false;
+
+    std::string name = GetCellName(m_info.cellPrefix, GetCell(staged.key));
+
+    // Cells without entries have no entities.
+    const ArchiveEntry* entry = m_info.archive->Find(name);
+
+    if(entry == nullptr)
+    {
+        staged.succeeded = true;
+        return;
+    }
+
+    if(!m_info.archive->Read(*entry, staged.content))
+    {
+        LogError() << LogLoadCellError(name) << "Couldn't read the entry.";
+        return;
+    }
+
+    // Parse groups with columns left in place.
+    BinaryReader reader(staged.content.data(), staged.content.size());
+
+    CellHeader header;
+
+    if(!reader.Read(header) || header.magic != CellMagic || header.version != CellVersion || header.groupCount < 0)
+    {
+        LogError() << LogLoadCellError(name) << "Invalid cell header.";
+        return;
+    }
+
+    staged.groups.resize(header.groupCount);
+
+    for(StagedGroup& group : staged.groups)
+    {
+        CellGroup groupHeader;
+
+        if(!reader.Read(groupHeader) || groupHeader.entityCount < 0)
+        {
+            LogError() << LogLoadCellError(name) << "Invalid group header.";
+            return;
+        }
+
+        group.signature = groupHeader.signature;
+        group.count = groupHeader.entityCount;
+
+        std::size_t componentCount = 0;
+        const std::uint32_t* componentSizes = reader.ReadArray<std::uint32_t>(componentCount);
+
+        if(!reader.IsValid())
+        {
+            LogError() << LogLoadCellError(name) << "Unexpected end of the entry.";
+            return;
+        }
+
+        if((int)componentCount != CountComponents(group.signature))
+        {
+            LogError() << LogLoadCellError(name) << "Component count does not match the signature.";
+            return;
+        }
+
+        group.componentSizes.assign(componentSizes, componentSizes + componentCount);
+
+        for(std::size_t i = 0; i < componentCount; ++i)
+        {
+            std::size_t columnSize = 0;
+            const std::uint8_t* column = reader.ReadArray<std::uint8_t>(columnSize);
+
+            if(!reader.IsValid() || columnSize != (std::size_t)componentSizes[i] * group.count)
+            {
+                LogError() << LogLoadCellError(name) << "Invalid component column.";
+                return;
+            }
+
+            group.columns.push_back(column);
+        }
+    }
+
+    staged.succeeded = true;
+}
+
+void WorldPartition::RunWorker()
+{
+    while(true)
+    {
+        StagedCell staged;
+
+        // Wait for a queued cell.
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_exit || !m_requests.empty(); });
+
+            if(m_exit)
+                return;
+
+            staged.key = m_requests.front();
+            m_requests.pop_front();
+        }
+
+        // Load the cell without holding the lock.
+        this->LoadCell(staged);
+
+        // Moving the content keeps columns pointing into it.
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_staged.push_back(std::move(staged));
+        }
+    }
+}
+
+glm::ivec2 WorldPartition::CalculateCell(const glm::vec3& position) const
+{
+    return glm::ivec2((int)std::floor(position.x / m_info.cellSize), (int)std::floor(position.z / m_info.cellSize));
+}
+
+bool WorldPartition::IsCellLoaded(const glm::ivec2& cell) const
+{
+    auto it = m_cells.find(MakeKey(cell));
+    return it != m_cells.end() && it->second.state == CellStates::Loaded;
+}
+
+int WorldPartition::GetLoadedCellCount() const
+{
+    int count = 0;
+
+    for(const auto& pair : m_cells)
+    {
+        count += pair.second.state == CellStates::Loaded ? 1 : 0;
+    }
+
+    return count;
+}
+
+int WorldPartition::GetLoadingCellCount() const
+{
+    int count = 0;
+
+    for(const auto& pair : m_cells)
+    {
+        count += pair.second.state == CellStates::Loading ? 1 : 0;
+    }
+
+    return count;
+}
+
+int WorldPartition::GetUnloadingEntityCount() const
+{
+    int count = 0;
+
+    for(const auto& pair : m_cells)
+    {
+        count += pair.second.state == CellStates::Unloading ? (int)pair.second.entities.size() : 0;
+    }
+
+    return count;
+}
+
+std::string WorldPartition::GetCellName(const std::string& prefix, const glm::ivec2& cell)
+{
+    std::ostringstream name;
+    name << prefix << cell.x << "_" << cell.y;
+    return name.str();
+}
+
+bool WorldPartition::WriteCell(const ComponentSystem& componentSystem, const EntityHandle* entities, int count, std::vector<std::uint8_t>& data)
+{
+    Assert(count >= 0, "Attempting to write a negative number of entities!");
+    Assert(entities != nullptr || count == 0, "Input array of entity handles is nullptr!");
+
+    if(!componentSystem.m_initialized)
+    {
+        LogError() << LogWriteCellError() << "Component system is not initialized.";
+        return false;
+    }
+
+    if(!componentSystem.m_commands.empty())
+    {
+        LogError() << LogWriteCellError() << "There are unprocessed component commands left.";
+        return false;
+    }
+
+    // Group entities by their archetypes, keeping their order.
+    // Entities without components are grouped under an empty signature.
+    std::map<ComponentSignature, std::vector<const ComponentSystem::EntityLocation*>> groups;
+
+    for(int i = 0; i < count; ++i)
+    {
+        if(!componentSystem.m_info.entitySystem->IsHandleValid(entities[i]))
+        {
+            LogError() << LogWriteCellError() << "Invalid entity handle.";
+            return false;
+        }
+
+        const ComponentSystem::EntityLocation* location = componentSystem.FindLocation(entities[i]);
+        ComponentSignature signature = location != nullptr ? componentSystem.m_archetypes[location->archetype]->signature : 0;
+
+        groups[signature].push_back(location);
+    }
+
+    // Write groups with a packed column per component.
+    data.clear();
+    BinaryWriter writer(data);
+
+    CellHeader header;
+    header.magic = CellMagic;
+    header.version = CellVersion;
+    header.groupCount = (std::int32_t)groups.size();
+    header.entityCount = count;
+
+    writer.Write(header);
+
+    std::vector<std::uint32_t> componentSizes;
+    std::vector<std::uint8_t> column;
+
+    for(const auto& pair : groups)
+    {
+        const std::vector<const ComponentSystem::EntityLocation*>& locations = pair.second;
+
+        CellGroup group;
+        group.signature = pair.first;
+        group.entityCount = (std::int32_t)locations.size();
+        group.reserved = 0;
+
+        writer.Write(group);
+
+        if(pair.first == 0)
+        {
+            writer.WriteArray(componentSizes.data(), 0);
+            continue;
+        }
+
+        const ComponentSystem::Archetype& archetype = *componentSystem.m_archetypes[locations.front()->archetype];
+
+        componentSizes.clear();
+
+        for(int component : archetype.components)
+        {
+            componentSizes.push_back((std::uint32_t)ComponentTypes::GetInfo(component).size);
+        }
+
+        writer.WriteArray(componentSizes.data(), componentSizes.size());
+
+        for(std::size_t index = 0; index < archetype.components.size(); ++index)
+        {
+            std::size_t size = componentSizes[index];
+            column.resize(size * locations.size());
+
+            for(std::size_t i = 0; i < locations.size(); ++i)
+            {
+                const ComponentSystem::Chunk& chunk = archetype.chunks[locations[i]->chunk];
+                std::memcpy(column.data() + size * i, chunk.memory.get() + archetype.columnOffsets[index] + size * locations[i]->row, size);
+            }
+
+            writer.WriteArray(column.data(), column.size());
+        }
+    }
+
+    return true;
+}
+
+std::uint64_t WorldPartition::MakeKey(const glm::ivec2& cell)
+{
+    return (std::uint64_t)(std::uint32_t)cell.x << 32 | (std::uint32_t)cell.y;
+}
+
+glm::ivec2 WorldPartition::GetCell(std::uint64_t key)
+{
+    return glm::ivec2((std::int32_t)(std::uint32_t)(key >> 32), (std::int32_t)(std::uint32_t)key);
+}
@@ -0,0 +1,230 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/Archive.hpp"
+#include "EntityHandle.hpp"
+#include "EntitySystem.hpp"
+#include "ComponentSystem.hpp"
+
+//
+// World Partition
+//
+//  Streams entities of an open world in spatial cells around a focus point,
+//  so memory stays bounded by the number of cells in range regardless of the
+//  size of the map. Cells lie in a grid on the horizontal plane and are stored
+//  as entries of a packed archive, written at build time from entities already
+//  assigned to cells.
+//
+//  Cells entering the load radius are queued to IO threads, which read and
+//  decompress their entries and parse them into staging buffers that hold
+//  packed columns of components grouped by signature. Staged cells are then
+//  committed together in a single batch at the next ProcessCommands() call,
+//  where columns are copied straight into archetype chunks and entities of
+//  all cells become active at the same EntitySystem::ProcessCommands() call.
+//
+//  Cells leaving the unload radius, which is one cell larger than the load
+//  radius to avoid thrashing at borders, are destroyed over multiple calls
+//  with a limit of entities per call, so unloading a dense cell does not
+//  stall a frame. Cells that leave the range while loading are discarded
+//  once they are staged, and cells that return while unloading are loaded
+//  again after their entities are gone.
+//
+//  Cell entries are meant to be read by the same build that wrote them,
+//  as component types are identified by their registration order.
+//
+//  Example usage:
+//      std::vector<std::uint8_t> data;
+//      Game::WorldPartition::WriteCell(componentSystem, &entities[0], count, data);
+//      writer.AddEntry(Game::WorldPartition::GetCellName("Cells/", cell), data.data(), data.size(), true);
+//
+//      Game::WorldPartitionInfo info;
+//      info.entitySystem = &entitySystem;
+//      info.componentSystem = &componentSystem;
+//      info.archive = &archive;
+//      info.cellSize = 64.0f;
+//      info.loadRadius = 2;
+//
+//      Game::WorldPartition partition;
+//      partition.Initialize(info);
+//
+//      while(gameLoop.Tick())
+//      {
+//          partition.SetFocus(playerPosition);
+//          partition.ProcessCommands();
+//
+//          entitySystem.ProcessCommands();
+//          componentSystem.ProcessCommands();
+//      }
+//
+
+namespace Game
+{
+    // World partition initialization struct.
+    struct WorldPartitionInfo
+    {
+        // Systems that streamed entities are created in.
+        EntitySystem* entitySystem;
+        ComponentSystem* componentSystem;
+
+        // Archive with cell entries, which must stay open.
+        const Archive* archive;
+
+        // Prefix of names of cell entries.
+        std::string cellPrefix;
+
+        // Edge length of a cell.
+        float cellSize;
+
+        // Distance in cells around the focus cell that are loaded.
+        int loadRadius;
+
+        // Number of threads that load cells.
+        int threadCount;
+
+        // Maximum number of entities destroyed by unloading cells per call.
+        int destroyLimit;
+
+        WorldPartitionInfo();
+    };
+
+    // World partition class.
+    class WorldPartition : private NonCopyable
+    {
+    public:
+        WorldPartition();
+        ~WorldPartition();
+
+        // Restores instance to its original state.
+        // Waits for cells being loaded, but leaves loaded entities in place.
+        void Cleanup();
+
+        // Initializes the partition and starts IO threads.
+        bool Initialize(const WorldPartitionInfo& info);
+
+        // Moves the focus point, which queues loads and unloads of cells.
+        void SetFocus(const glm::vec3& position);
+
+        // Commits staged cells in a single batch and destroys entities of unloading cells.
+        // Must be called before entity and component systems process their commands.
+        void ProcessCommands();
+
+        // Calculates the cell of a position.
+        glm::ivec2 CalculateCell(const glm::vec3& position) const;
+
+        // Checks if entities of a cell have been committed.
+        bool IsCellLoaded(const glm::ivec2& cell) const;
+
+        // Gets the number of cells with committed entities.
+        int GetLoadedCellCount() const;
+
+        // Gets the number of cells queued or being loaded.
+        int GetLoadingCellCount() const;
+
+        // Gets the number of entities left to be destroyed by unloading cells.
+        int GetUnloadingEntityCount() const;
+
+        // Gets the name of an archive entry of a cell.
+        static std::string GetCellName(const std::string& prefix, const glm::ivec2& cell);
+
+        // Serializes active entities with their components into cell data.
+        // Commands of the component system must be processed before writing.
+        static bool WriteCell(const ComponentSystem& componentSystem, const EntityHandle* entities, int count, std::vector<std::uint8_t>& data);
+
+    private:
+        // Cell states.
+        struct CellStates
+        {
+            enum Type
+            {
+                Loading,
+                Loaded,
+                Unloading,
+            };
+        };
+
+        // Streamed cell.
+        struct Cell
+        {
+            CellStates::Type state;
+
+            // Cell left the range while loading.
+            bool cancelled;
+
+            // Entities created from the cell.
+            std::vector<EntityHandle> entities;
+        };
+
+        // Group of entities with the same components in a staged cell.
+        struct StagedGroup
+        {
+            ComponentSignature signature;
+            int count;
+
+            // Component columns within the entry content.
+            std::vector<const std::uint8_t*> columns;
+            std::vector<std::uint32_t> componentSizes;
+        };
+
+        // Cell loaded by an IO thread, waiting to be committed.
+        struct StagedCell
+        {
+            std::uint64_t key;
+            bool succeeded;
+
+            // Entry content that staged groups point into.
+            std::vector<std::uint8_t> content;
+            std::vector<StagedGroup> groups;
+        };
+
+        // Type declarations.
+        typedef std::map<std::uint64_t, Cell> CellMap;
+        typedef std::deque<std::uint64_t> RequestQueue;
+        typedef std::vector<StagedCell> StagedList;
+        typedef std::vector<std::thread> ThreadList;
+
+    private:
+        // Packs cell coordinates into a key.
+        static std::uint64_t MakeKey(const glm::ivec2& cell);
+
+        // Unpacks cell coordinates from a key.
+        static glm::ivec2 GetCell(std::uint64_t key);
+
+        // Reads and parses a cell on an IO thread.
+        void LoadCell(StagedCell& staged) const;
+
+        // Creates entities of a staged cell.
+        void CommitCell(Cell& cell, const StagedCell& staged);
+
+        // Drops queued loads of cells that left the range.
+        void CancelRequests(const std::vector<std::uint64_t>& keys);
+
+        // Main function of IO threads.
+        void RunWorker();
+
+    private:
+        // Initialization parameters.
+        WorldPartitionInfo m_info;
+
+        // Streamed cells.
+        CellMap m_cells;
+
+        // Queued and staged cells.
+        RequestQueue m_requests;
+        StagedList m_staged;
+        StagedList m_committed;
+
+        // Buffer of handles of committed entities.
+        std::vector<EntityHandle> m_handles;
+
+        // Synchronization of IO threads.
+        mutable std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_exit;
+
+        // Threads that load cells.
+        ThreadList m_workers;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,684 @@
+#include "Precompiled.hpp"
+#include "WorldPersistence.hpp"
+#include "Common/BinaryStream.hpp"
+#include "Common/Compression.hpp"
+#include "Common/MappedFile.hpp"
+using namespace Game;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize world persistence! "
+    #define LogSaveError() "Failed to save the world! "
+    #define LogWriteError(filename) "Failed to write a world save \"" << filename << "\"! "
+    #define LogLoadError(filename) "Failed to load a world save \"" << filename << "\"! "
+
+    // Record format identification.
+    const std::uint32_t RecordMagic   = 0x53525057; // "WPRS"
+    const std::uint32_t RecordVersion = 1;
+
+    // Record header.
+    struct RecordHeader
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t sequence;
+        std::int32_t full;
+        std::int32_t archetypeCount;
+        std::uint64_t entityStateSize;
+    };
+
+    // Archetype header within a record.
+    struct RecordArchetype
+    {
+        std::uint64_t signature;
+        std::uint64_t chunkSize;
+        std::int32_t chunkCapacity;
+        std::int32_t chunkCount;
+        std::int32_t savedCount;
+        std::int32_t reserved;
+    };
+
+    // Gets the filename of the journal next to a base file.
+    std::string GetJournalFilename(const std::string& filename)
+    {
+        return filename + ".journal";
+    }
+
+    // Appends a block compressed with a scratch buffer.
+    void WriteCompressed(BinaryWriter& writer, const std::uint8_t* data, std::size_t size, std::vector<std::uint8_t>& scratch)
+    {
+        scratch.resize(Compression::GetCompressBound(size));
+        std::size_t compressedSize = Compression::Compress(data, size, scratch.data(), scratch.size());
+        writer.WriteArray(scratch.data(), compressedSize);
+    }
+
+    // Reads a compressed block of a known size.
+    bool ReadCompressed(BinaryReader& reader, std::uint8_t* data, std::size_t size)
+    {
+        std::size_t compressedSize = 0;
+        const std::uint8_t* compressed = reader.ReadArray<std::uint8_t>(compressedSize);
+
+        if(!reader.IsValid())
+            return false;
+
+        return Compression::Decompress(compressed, compressedSize, data, size);
+    }
+}
+
+WorldPersistenceInfo::WorldPersistenceInfo() :
+    entitySystem(nullptr),
+    componentSystem(nullptr),
+    compactInterval(32)
+{
+}
+
+WorldPersistence::WorldPersistence() :
+    m_savedTick(0),
+    m_sequence(0),
+    m_capturedSize(0),
+    m_journalCount(0),
+    m_baseWritten(false),
+    m_saving(false),
+    m_exit(false),
+    m_initialized(false)
+{
+}
+
+WorldPersistence::~WorldPersistence()
+{
+    this->Cleanup();
+}
+
+void WorldPersistence::Cleanup()
+{
+    // Stop the background thread after it finishes writing.
+    // Also called on a partially initialized instance when initialization fails.
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_exit = true;
+    }
+
+    m_condition.notify_all();
+
+    if(m_worker.joinable())
+    {
+        m_worker.join();
+    }
+
+    m_saving = false;
+    m_exit = false;
+
+    // Free captured and mirrored state.
+    m_savedTick = 0;
+    m_sequence = 0;
+    Utility::ClearContainer(m_entityState);
+    Utility::ClearContainer(m_capture);
+    m_capturedSize = 0;
+
+    Utility::ClearContainer(m_mirror);
+    Utility::ClearContainer(m_record);
+    Utility::ClearContainer(m_compressed);
+    m_journalCount = 0;
+    m_baseWritten = false;
+
+    // Reset initialization parameters.
+    m_info = WorldPersistenceInfo();
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool WorldPersistence::Initialize(const WorldPersistenceInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.entitySystem == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid entity system.";
+        return false;
+    }
+
+    if(info.componentSystem == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid component system.";
+        return false;
+    }
+
+    if(info.filename.empty())
+    {
+        LogError() << LogInitializeError() << "Invalid filename.";
+        return false;
+    }
+
+    if(info.compactInterval <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid compact interval.";
+        return false;
+    }
+
+    m_info = info;
+
+    // Start the background thread.
+    m_worker = std::thread(&WorldPersistence::RunWorker, this);
+
+    // Success!
+    return m_initialized = true;
+}
+
+bool WorldPersistence::Save()
+{
+    Assert(m_initialized, "World persistence is not initialized!");
+
+    // Carry changes over to the next save while the previous one is written.
+    if(this->IsSaving())
+        return false;
+
+    if(!m_info.componentSystem->m_commands.empty())
+    {
+        LogError() << LogSaveError() << "There are unprocessed component commands left.";
+        return false;
+    }
+
+    // Serialize the handle table.
+    m_entityState.clear();
+    BinaryWriter writer(m_entityState);
+
+    if(!m_info.entitySystem->SaveSnapshot(writer))
+    {
+        LogError() << LogSaveError() << "Couldn't save the entity system.";
+        return false;
+    }
+
+    // Copy chunks changed since the last save.
+    this->CaptureChunks();
+
+    m_savedTick = m_info.componentSystem->AdvanceTick();
+    m_sequence += 1;
+
+    // Hand the capture over to the background thread.
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_saving = true;
+    }
+
+    m_condition.notify_all();
+
+    return true;
+}
+
+void WorldPersistence::Flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this]() { return !m_saving; });
+}
+
+bool WorldPersistence::IsSaving() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_saving;
+}
+
+std::size_t WorldPersistence::GetCapturedSize() const
+{
+    return m_capturedSize;
+}
+
+bool WorldPersistence::IsInitialized() const
+{
+    return m_initialized;
+}
+
+void WorldPersistence::CaptureChunks()
+{
+    const ComponentSystem& componentSystem = *m_info.componentSystem;
+
+    // Archetypes are only ever added, so their indices identify them between saves.
+    m_capture.resize(componentSystem.m_archetypes.size());
+    m_capturedSize = 0;
+
+    for(std::size_t i = 0; i < componentSystem.m_archetypes.size(); ++i)
+    {
+        const ComponentSystem::Archetype& archetype = *componentSystem.m_archetypes[i];
+        ArchetypeChunks& captured = m_capture[i];
+
+        captured.signature = archetype.signature;
+        captured.chunkCapacity = archetype.chunkCapacity;
+        captured.chunkSize = ComponentSystem::GetChunkSize(archetype);
+
+        captured.componentSizes.clear();
+
+        for(int component : archetype.components)
+        {
+            captured.componentSizes.push_back((std::uint32_t)ComponentTypes::GetInfo(component).size);
+        }
+
+        captured.counts.clear();
+        captured.indices.clear();
+
+        // Find changed chunks first, so memory is resized once.
+        for(std::size_t j = 0; j < archetype.chunks.size(); ++j)
+        {
+            const ComponentSystem::Chunk& chunk = archetype.chunks[j];
+            captured.counts.push_back(chunk.count);
+
+            if(chunk.changeTick > m_savedTick)
+            {
+                captured.indices.push_back((std::int32_t)j);
+            }
+        }
+
+        captured.memory.resize(captured.indices.size() * captured.chunkSize);
+
+        for(std::size_t j = 0; j < captured.indices.size(); ++j)
+        {
+            const ComponentSystem::Chunk& chunk = archetype.chunks[captured.indices[j]];
+            std::memcpy(captured.memory.data() + j * captured.chunkSize, chunk.memory.get(), captured.chunkSize);
+        }
+
+        m_capturedSize += captured.memory.size();
+    }
+}
+
+void WorldPersistence::ApplyCapture()
+{
+    m_mirror.resize(m_capture.size());
+
+    for(std::size_t i = 0; i < m_capture.size(); ++i)
+    {
+        const ArchetypeChunks& captured = m_capture[i];
+        ArchetypeChunks& mirrored = m_mirror[i];
+
+        mirrored.signature = captured.signature;
+        mirrored.chunkCapacity = captured.chunkCapacity;
+        mirrored.chunkSize = captured.chunkSize;
+        mirrored.componentSizes = captured.componentSizes;
+        mirrored.counts = captured.counts;
+
+        // Removed chunks are dropped, while added ones are always captured.
+        mirrored.memory.resize(captured.counts.size() * captured.chunkSize);
+
+        for(std::size_t j = 0; j < captured.indices.size(); ++j)
+        {
+            std::memcpy(mirrored.memory.data() + captured.indices[j] * captured.chunkSize, captured.memory.data() + j * captured.chunkSize, captured.chunkSize);
+        }
+    }
+}
+
+void WorldPersistence::WriteRecord(std::vector<std::uint8_t>& buffer, bool full)
+{
+    buffer.clear();
+    BinaryWriter writer(buffer);
+
+    RecordHeader header;
+    header.magic = RecordMagic;
+    header.version = RecordVersion;
+    header.sequence = m_sequence;
+    header.full = full ? 1 : 0;
+    header.archetypeCount = (std::int32_t)m_mirror.size();
+    header.entityStateSize = m_entityState.size();
+
+    writer.Write(header);
+    WriteCompressed(writer, m_entityState.data(), m_entityState.size(), m_compressed);
+
+    for(std::size_t i = 0; i < m_mirror.size(); ++i)
+    {
+        const ArchetypeChunks& mirrored = m_mirror[i];
+        const ArchetypeChunks& captured = m_capture[i];
+
+        std::size_t savedCount = full ? mirrored.counts.size() : captured.indices.size();
+
+        RecordArchetype archetype;
+        archetype.signature = mirrored.signature;
+        archetype.chunkSize = mirrored.chunkSize;
+        archetype.chunkCapacity = mirrored.chunkCapacity;
+        archetype.chunkCount = (std::int32_t)mirrored.counts.size();
+        archetype.savedCount = (std::int32_t)savedCount;
+        archetype.reserved = 0;
+
+        writer.Write(archetype);
+        writer.WriteArray(mirrored.componentSizes.data(), mirrored.componentSizes.size());
+
+        // Write chunks from the mirror, which already holds the capture.
+        for(std::size_t j = 0; j < savedCount; ++j)
+        {
+            std::int32_t index = full ? (std::int32_t)j : captured.indices[j];
+
+            writer.Write(index);
+            writer.Write(mirrored.counts[index]);
+            WriteCompressed(writer, mirrored.memory.data() + index * mirrored.chunkSize, mirrored.chunkSize, m_compressed);
+        }
+    }
+
+    // Keep records aligned within files.
+    writer.Align();
+}
+
+bool WorldPersistence::WriteCapture()
+{
+    this->ApplyCapture();
+
+    std::string journalFilename = GetJournalFilename(m_info.filename);
+
+    // Write a new base file, which makes the journal obsolete.
+    if(!m_baseWritten || m_journalCount >= m_info.compactInterval)
+    {
+        this->WriteRecord(m_record, true);
+
+        std::string temporaryFilename = m_info.filename + ".tmp";
+        std::ofstream file(temporaryFilename, std::ios::binary | std::ios::trunc);
+
+        std::uint64_t size = m_record.size();
+        file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        file.write(reinterpret_cast<const char*>(m_record.data()), m_record.size());
+        file.close();
+
+        if(!file)
+        {
+            LogError() << LogWriteError(temporaryFilename) << "Couldn't write to the file.";
+            return false;
+        }
+
+        // Replace the base file, then truncate the journal.
+        // Records of a journal that survives a crash here are older and get skipped.
+        std::remove(m_info.filename.c_str());
+
+        if(std::rename(temporaryFilename.c_str(), m_info.filename.c_str()) != 0)
+        {
+            LogError() << LogWriteError(m_info.filename) << "Couldn't replace the file.";
+            return false;
+        }
+
+        std::ofstream journal(journalFilename, std::ios::binary | std::ios::trunc);
+
+        m_baseWritten = true;
+        m_journalCount = 0;
+
+        return true;
+    }
+
+    // Append changed chunks to the journal.
+    this->WriteRecord(m_record, false);
+
+    std::ofstream journal(journalFilename, std::ios::binary | std::ios::app);
+
+    std::uint64_t size = m_record.size();
+    journal.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    journal.write(reinterpret_cast<const char*>(m_record.data()), m_record.size());
+    journal.close();
+
+    if(!journal)
+    {
+        LogError() << LogWriteError(journalFilename) << "Couldn't write to the file.";
+        return false;
+    }
+
+    m_journalCount += 1;
+
+    return true;
+}
+
+void WorldPersistence::RunWorker()
+{
+    while(true)
+    {
+        // Wait for a capture.
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_saving || m_exit; });
+
+            if(!m_saving && m_exit)
+                return;
+        }
+
+        // A failed write leaves a gap in the journal, so start over with a base file.
+        if(!this->WriteCapture())
+        {
+            m_baseWritten = false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_saving = false;
+        }
+
+        m_condition.notify_all();
+    }
+}
+
+bool WorldPersistence::Load(const std::string& filename, EntitySystem& entitySystem, ComponentSystem& componentSystem)
+{
+    if(!componentSystem.m_initialized)
+    {
+        LogError() << LogLoadError(filename) << "Component system is not initialized.";
+        return false;
+    }
+
+    // Make sure no existing component is going to be overwritten.
+    bool isEmpty = componentSystem.m_commands.empty();
+
+    for(const std::unique_ptr<ComponentSystem::Archetype>& archetype : componentSystem.m_archetypes)
+    {
+        isEmpty = isEmpty && archetype->entityCount == 0;
+    }
+
+    if(!isEmpty)
+    {
+        LogError() << LogLoadError(filename) << "Component system is not empty.";
+        return false;
+    }
+
+    // Replay the base file and then the journal into a mirror of chunks.
+    ArchetypeList mirror;
+    std::vector<std::uint8_t> entityState;
+    std::uint64_t baseSequence = 0;
+
+    const std::string filenames[] = { filename, GetJournalFilename(filename) };
+
+    for(int fileIndex = 0; fileIndex < 2; ++fileIndex)
+    {
+        bool isBase = fileIndex == 0;
+
+        MappedFile file;
+
+        if(!file.Open(filenames[fileIndex]))
+        {
+            if(isBase)
+            {
+                LogError() << LogLoadError(filename) << "Couldn't map the base file.";
+                return false;
+            }
+
+            break;
+        }
+
+        BinaryReader fileReader(file.GetData(), file.GetSize());
+
+        while(fileReader.IsValid() && !fileReader.IsEnd())
+        {
+            // Read a whole record, which ends the journal if it was cut short.
+            std::uint64_t recordSize = 0;
+            fileReader.Read(recordSize);
+
+            const void* recordData = fileReader.ReadBytes((std::size_t)recordSize);
+
+            if(!fileReader.IsValid() || recordData == nullptr)
+            {
+                if(isBase)
+                {
+                    LogError() << LogLoadError(filename) << "Base file is truncated.";
+                    return false;
+                }
+
+                LogWarning() << "Skipping a truncated record at the end of the journal of \"" << filename << "\".";
+                break;
+            }
+
+            BinaryReader reader(recordData, (std::size_t)recordSize);
+
+            RecordHeader header;
+
+            if(!reader.Read(header) || header.magic != RecordMagic || header.version != RecordVersion)
+            {
+                LogError() << LogLoadError(filename) << "Invalid record format.";
+                return false;
+            }
+
+            if(isBase != (header.full != 0))
+            {
+                LogError() << LogLoadError(filename) << "Unexpected record type.";
+                return false;
+            }
+
+            // Skip records written before the base file.
+            if(isBase)
+            {
+                baseSequence = header.sequence;
+            }
+            else if(header.sequence <= baseSequence)
+            {
+                continue;
+            }
+
+            entityState.resize((std::size_t)header.entityStateSize);
+
+            if(!ReadCompressed(reader, entityState.data(), entityState.size()))
+            {
+                LogError() << LogLoadError(filename) << "Invalid entity state.";
+                return false;
+            }
+
+            // Archetypes are only ever added between records.
+            if(header.archetypeCount < (std::int32_t)mirror.size())
+            {
+                LogError() << LogLoadError(filename) << "Inconsistent archetype count.";
+                return false;
+            }
+
+            mirror.resize(header.archetypeCount);
+
+            for(ArchetypeChunks& mirrored : mirror)
+            {
+                RecordArchetype archetype;
+                reader.Read(archetype);
+
+                std::size_t componentCount = 0;
+                const std::uint32_t* componentSizes = reader.ReadArray<std::uint32_t>(componentCount);
+
+                bool valid = reader.IsValid() && archetype.chunkCount >= 0 && archetype.savedCount >= 0 &&
+                    archetype.savedCount <= archetype.chunkCount && archetype.chunkCapacity > 0 && archetype.chunkSize > 0;
+
+                if(!valid)
+                {
+                    LogError() << LogLoadError(filename) << "Invalid archetype data.";
+                    return false;
+                }
+
+                mirrored.signature = archetype.signature;
+                mirrored.chunkCapacity = archetype.chunkCapacity;
+                mirrored.chunkSize = (std::size_t)archetype.chunkSize;
+                mirrored.componentSizes.assign(componentSizes, componentSizes + componentCount);
+                mirrored.counts.resize(archetype.chunkCount, 0);
+                mirrored.memory.resize(mirrored.counts.size() * mirrored.chunkSize);
+
+                for(std::int32_t j = 0; j < archetype.savedCount; ++j)
+                {
+                    std::int32_t index = -1;
+                    std::int32_t count = 0;
+
+                    reader.Read(index);
+                    reader.Read(count);
+
+                    if(!reader.IsValid() || index < 0 || index >= archetype.chunkCount || count < 0 || count > archetype.chunkCapacity)
+                    {
+                        LogError() << LogLoadError(filename) << "Invalid chunk data.";
+                        return false;
+                    }
+
+                    mirrored.counts[index] = count;
+
+                    if(!ReadCompressed(reader, mirrored.memory.data() + index * mirrored.chunkSize, mirrored.chunkSize))
+                    {
+                        LogError() << LogLoadError(filename) << "Invalid chunk data.";
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+
+    // Load entities before their components.
+    BinaryReader entityReader(entityState.data(), entityState.size());
+
+    if(!entitySystem.LoadSnapshot(entityReader))
+    {
+        LogError() << LogLoadError(filename) << "Couldn't load the entity system.";
+        return false;
+    }
+
+    // Don't leave entities without their components behind.
+    bool loaded = false;
+
+    SCOPE_GUARD_IF(!loaded,
+        for(std::unique_ptr<ComponentSystem::Archetype>& archetype : componentSystem.m_archetypes)
+        {
+            archetype->chunks.clear();
+            archetype->entityCount = 0;
+        }
+
+        entitySystem.DestroyAllEntities();
+    );
+
+    // Copy mirrored chunks into matching archetypes.
+    for(const ArchetypeChunks& mirrored : mirror)
+    {
+        if(mirrored.counts.empty())
+            continue;
+
+        int archetypeIndex = componentSystem.AcquireArchetype(mirrored.signature);
+
+        if(archetypeIndex < 0)
+        {
+            LogError() << LogLoadError(filename) << "Couldn't create an archetype.";
+            return false;
+        }
+
+        ComponentSystem::Archetype& archetype = *componentSystem.m_archetypes[archetypeIndex];
+
+        // Check that component types were registered the same way.
+        bool layoutMatches = archetype.chunkCapacity == mirrored.chunkCapacity &&
+            ComponentSystem::GetChunkSize(archetype) == mirrored.chunkSize &&
+            archetype.components.size() == mirrored.componentSizes.size();
+
+        for(std::size_t column = 0; layoutMatches && column < archetype.components.size(); ++column)
+        {
+            layoutMatches = ComponentTypes::GetInfo(archetype.components[column]).size == mirrored.componentSizes[column];
+        }
+
+        if(!layoutMatches)
+        {
+            LogError() << LogLoadError(filename) << "Component types do not match the save.";
+            return false;
+        }
+
+        for(std::size_t j = 0; j < mirrored.counts.size(); ++j)
+        {
+            ComponentSystem::Chunk chunk;
+            chunk.memory = componentSystem.AllocateChunk(mirrored.chunkSize);
+            chunk.count = mirrored.counts[j];
+            chunk.changeTick = componentSystem.m_tick;
+
+            std::memcpy(chunk.memory.get(), mirrored.memory.data() + j * mirrored.chunkSize, mirrored.chunkSize);
+
+            archetype.entityCount += chunk.count;
+            archetype.chunks.push_back(std::move(chunk));
+        }
+    }
+
+    componentSystem.RebuildLocations();
+
+    // Success!
+    return loaded = true;
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "EntitySystem.hpp"
+#include "ComponentSystem.hpp"
+
+//
+// World Persistence
+//
+//  Saves entities and their components to disk incrementally, without
+//  stalling the thread that runs ticks. A save copies the handle table and
+//  only chunks that changed since the previous save, based on change ticks
+//  of the component system, into a capture buffer. Compression and file
+//  writes then run on a background thread, while ticks continue.
+//
+//  The background thread keeps a mirror of all chunks, which captures are
+//  applied to. Changed chunks are compressed and appended to a journal file
+//  next to the base file. After a number of journal records, the mirror is
+//  written as a new base file and the journal is truncated, so full saves
+//  never read the live world either. Records are numbered, so a journal
+//  left behind by an interrupted compaction is skipped when loading, and
+//  a record cut short by a crash ends the journal.
+//
+//  A save is skipped while the previous one is still being written, and its
+//  changes are carried over to the next save. Captures only cover state
+//  stored in entity and component systems, which must have their commands
+//  processed before saving.
+//
+//  Example usage:
+//      Game::WorldPersistenceInfo info;
+//      info.entitySystem = &entitySystem;
+//      info.componentSystem = &componentSystem;
+//      info.filename = "World.save";
+//
+//      Game::WorldPersistence persistence;
+//      persistence.Initialize(info);
+//
+//      while(gameLoop.Tick())
+//      {
+//          /* ... */
+//          persistence.Save();
+//      }
+//
+//  Loading saved state into empty systems:
+//      Game::WorldPersistence::Load("World.save", entitySystem, componentSystem);
+//
+
+namespace Game
+{
+    // World persistence initialization struct.
+    struct WorldPersistenceInfo
+    {
+        // Systems whose state is saved.
+        EntitySystem* entitySystem;
+        ComponentSystem* componentSystem;
+
+        // Path of the base file, with the journal stored next to it.
+        std::string filename;
+
+        // Number of journal records written before the base file is rewritten.
+        int compactInterval;
+
+        WorldPersistenceInfo();
+    };
+
+    // World persistence class.
+    class WorldPersistence : private NonCopyable
+    {
+    public:
+        WorldPersistence();
+        ~WorldPersistence();
+
+        // Restores instance to its original state.
+        // Waits for the save being written.
+        void Cleanup();
+
+        // Initializes persistence and starts the background thread.
+        bool Initialize(const WorldPersistenceInfo& info);
+
+        // Captures changes since the last save and writes them in the background.
+        // Returns false if the previous save is still being written.
+        bool Save();
+
+        // Waits until the save being written is finished.
+        void Flush();
+
+        // Checks if a save is being written.
+        bool IsSaving() const;
+
+        // Gets the number of chunk bytes copied by the last capture.
+        std::size_t GetCapturedSize() const;
+
+        // Checks if persistence is initialized.
+        bool IsInitialized() const;
+
+        // Loads state saved by persistence into systems without any entities.
+        static bool Load(const std::string& filename, EntitySystem& entitySystem, ComponentSystem& componentSystem);
+
+    private:
+        // Chunks of an archetype.
+        // Captures hold changed chunks, while mirrors hold all of them.
+        struct ArchetypeChunks
+        {
+            ComponentSignature signature;
+            int chunkCapacity;
+            std::size_t chunkSize;
+            std::vector<std::uint32_t> componentSizes;
+
+            // Number of rows of every chunk.
+            std::vector<std::int32_t> counts;
+
+            // Indices of captured chunks and their memory.
+            std::vector<std::int32_t> indices;
+            std::vector<std::uint8_t> memory;
+        };
+
+        // Type declarations.
+        typedef std::vector<ArchetypeChunks> ArchetypeList;
+
+    private:
+        // Copies changed chunks of the component system into the capture.
+        void CaptureChunks();
+
+        // Applies the capture to the mirror.
+        void ApplyCapture();
+
+        // Serializes a record of mirrored chunks that were captured, or of all of them.
+        void WriteRecord(std::vector<std::uint8_t>& buffer, bool full);
+
+        // Writes the capture into the journal or a new base file.
+        bool WriteCapture();
+
+        // Runs the background thread.
+        void RunWorker();
+
+    private:
+        // Initialization parameters.
+        WorldPersistenceInfo m_info;
+
+        // Component system tick of the last save.
+        ComponentSystem::Tick m_savedTick;
+
+        // Captured state, only touched by the background thread while saving.
+        std::uint64_t m_sequence;
+        std::vector<std::uint8_t> m_entityState;
+        ArchetypeList m_capture;
+        std::size_t m_capturedSize;
+
+        // State kept by the background thread.
+        ArchetypeList m_mirror;
+        std::vector<std::uint8_t> m_record;
+        std::vector<std::uint8_t> m_compressed;
+        int m_journalCount;
+        bool m_baseWritten;
+
+        // Background thread and its synchronization.
+        std::thread m_worker;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_saving;
+        bool m_exit;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,131 @@
+#include "Precompiled.hpp"
+#include "WorldSnapshot.hpp"
+#include "Common/MappedFile.hpp"
+using namespace Game;
+
+namespace
+{
+    // Log message strings.
+    #define LogSaveError(filename) "Failed to save a world snapshot \"" << filename << "\"! "
+    #define LogLoadError(filename) "Failed to load a world snapshot \"" << filename << "\"! "
+    #define LogWriteError() "Failed to write a world snapshot! "
+    #define LogReadError() "Failed to read a world snapshot! "
+
+    // File format identification.
+    const std::uint32_t FileMagic   = 0x444C5257; // "WRLD"
+    const std::uint32_t FileVersion = 1;
+}
+
+bool WorldSnapshot::Save(std::string filename, const EntitySystem& entitySystem, const ComponentSystem& componentSystem)
+{
+    // Serialize both systems into a single block.
+    std::vector<std::uint8_t> buffer;
+    BinaryWriter writer(buffer);
+
+    if(!WorldSnapshot::Write(writer, entitySystem, componentSystem))
+    {
+        LogError() << LogSaveError(filename) << "Couldn't write the snapshot.";
+        return false;
+    }
+
+    // Write the block to a file.
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+
+    if(!file)
+    {
+        LogError() << LogSaveError(filename) << "Couldn't open the file.";
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+
+    if(!file)
+    {
+        LogError() << LogSaveError(filename) << "Couldn't write to the file.";
+        return false;
+    }
+
+    return true;
+}
+
+bool WorldSnapshot::Load(std::string filename, EntitySystem& entitySystem, ComponentSystem& componentSystem)
+{
+    // Map the file into memory.
+    MappedFile file;
+
+    if(!file.Open(filename))
+    {
+        LogError() << LogLoadError(filename) << "Couldn't map the file.";
+        return false;
+    }
+
+    BinaryReader reader(file.GetData(), file.GetSize());
+
+    if(!WorldSnapshot::Read(reader, entitySystem, componentSystem))
+    {
+        LogError() << LogLoadError(filename) << "Couldn't read the snapshot.";
+        return false;
+    }
+
+    return true;
+}
+
+bool WorldSnapshot::Write(BinaryWriter& writer, const EntitySystem& entitySystem, const ComponentSystem& componentSystem)
+{
+    writer.Write(FileMagic);
+    writer.Write(FileVersion);
+
+    if(!entitySystem.SaveSnapshot(writer))
+    {
+        LogError() << LogWriteError() << "Couldn't save the entity system.";
+        return false;
+    }
+
+    if(!componentSystem.SaveSnapshot(writer))
+    {
+        LogError() << LogWriteError() << "Couldn't save the component system.";
+        return false;
+    }
+
+    return true;
+}
+
+bool WorldSnapshot::Read(BinaryReader& reader, EntitySystem& entitySystem, ComponentSystem& componentSystem)
+{
+    // Check the format.
+    std::uint32_t magic = 0;
+    std::uint32_t version = 0;
+
+    reader.Read(magic);
+    reader.Read(version);
+
+    if(!reader.IsValid() || magic != FileMagic)
+    {
+        LogError() << LogReadError() << "Invalid format.";
+        return false;
+    }
+
+    if(version != FileVersion)
+    {
+        LogError() << LogReadError() << "Unsupported version " << version << ".";
+        return false;
+    }
+
+    // Load entities before their components.
+    if(!entitySystem.LoadSnapshot(reader))
+    {
+        LogError() << LogReadError() << "Couldn't load the entity system.";
+        return false;
+    }
+
+    if(!componentSystem.LoadSnapshot(reader))
+    {
+        LogError() << LogReadError() << "Couldn't load the component system.";
+
+        // Don't leave entities without their components behind.
+        entitySystem.DestroyAllEntities();
+        return false;
+    }
+
+    return true;
+}
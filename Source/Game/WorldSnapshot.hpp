@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "EntitySystem.hpp"
+#include "ComponentSystem.hpp"
+
+//
+// World Snapshot
+//
+//  Saves entities and their components into a single flat binary file.
+//  The file holds the handle table, the free list and raw chunks of
+//  components laid out as aligned arrays. Loading maps the file into memory
+//  and copies whole arrays and chunks, without parsing individual entities.
+//  Snapshots are meant to be loaded by the same build that saved them, as
+//  component types are identified by their registration order.
+//
+//  Snapshots can also be written into and read from a block of memory that
+//  is embedded in another file, such as keyframes of recorded sessions. The
+//  block must start at an offset aligned to the array alignment of binary
+//  streams, as arrays are aligned relative to its beginning.
+//
+//  Example usage:
+//      Game::WorldSnapshot::Save("World.snapshot", entitySystem, componentSystem);
+//
+//      Game::WorldSnapshot::Load("World.snapshot", entitySystem, componentSystem);
+//
+
+namespace Game
+{
+    namespace WorldSnapshot
+    {
+        // Saves the state of entity and component systems to a file.
+        // Pending commands of both systems must be processed before saving.
+        bool Save(std::string filename, const EntitySystem& entitySystem, const ComponentSystem& componentSystem);
+
+        // Loads the state of entity and component systems from a file.
+        // Both systems must be initialized and must not have any entities.
+        bool Load(std::string filename, EntitySystem& entitySystem, ComponentSystem& componentSystem);
+
+        // Writes the state of entity and component systems into a block.
+        // Pending commands of both systems must be processed before writing.
+        bool Write(BinaryWriter& writer, const EntitySystem& entitySystem, const ComponentSystem& componentSystem);
+
+        // Reads the state of entity and component systems from a block.
+        // Both systems must be initialized and must not have any entities.
+        bool Read(BinaryReader& reader, EntitySystem& entitySystem, ComponentSystem& componentSystem);
+    }
+}
@@ -0,0 +1,373 @@
+#include "Precompiled.hpp"
+#include "Animation.hpp"
+using namespace Graphics;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeSkeletonError() "Failed to initialize a skeleton! "
+    #define LogInitializeClipError() "Failed to initialize an animation clip! "
+
+    // Largest quantized sample.
+    const float QuantizedMaximum = 65535.0f;
+
+    // Tracks with a smaller range are stored as constants.
+    const float ConstantRange = 1.0e-6f;
+
+    // Gets a channel of a bone transform.
+    float GetChannel(const BoneTransform& transform, int channel)
+    {
+        switch(channel)
+        {
+        case AnimationClip::Channels::TranslationX: return transform.translation.x;
+        case AnimationClip::Channels::TranslationY: return transform.translation.y;
+        case AnimationClip::Channels::Rotation: return transform.rotation;
+        case AnimationClip::Channels::ScaleX: return transform.scale.x;
+        case AnimationClip::Channels::ScaleY: return transform.scale.y;
+        }
+
+        return 0.0f;
+    }
+}
+
+BoneTransform BoneTransform::Blend(const BoneTransform& from, const BoneTransform& to, float weight)
+{
+    // Wrap the difference of rotations to the shorter arc.
+    float difference = std::remainder(to.rotation - from.rotation, 2.0f * glm::pi<float>());
+
+    BoneTransform result;
+    result.translation = glm::mix(from.translation, to.translation, weight);
+    result.rotation = from.rotation + difference * weight;
+    result.scale = glm::mix(from.scale, to.scale, weight);
+
+    return result;
+}
+
+glm::mat3 BoneTransform::ToMatrix() const
+{
+    float cosine = std::cos(rotation);
+    float sine = std::sin(rotation);
+
+    glm::mat3 matrix;
+    matrix[0] = glm::vec3(cosine * scale.x, sine * scale.x, 0.0f);
+    matrix[1] = glm::vec3(-sine * scale.y, cosine * scale.y, 0.0f);
+    matrix[2] = glm::vec3(translation, 1.0f);
+
+    return matrix;
+}
+
+Skeleton::Skeleton() :
+    m_initialized(false)
+{
+}
+
+Skeleton::~Skeleton()
+{
+    this->Cleanup();
+}
+
+void Skeleton::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    Utility::ClearContainer(m_parents);
+    Utility::ClearContainer(m_bindPose);
+    Utility::ClearContainer(m_inverseBind);
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool Skeleton::Initialize(const SkeletonInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.parents.empty() || info.parents.size() > MaximumBones)
+    {
+        LogError() << LogInitializeSkeletonError() << "Invalid number of bones.";
+        return false;
+    }
+
+    if(info.bindPose.size() != info.parents.size())
+    {
+        LogError() << LogInitializeSkeletonError() << "Bind pose does not match bones.";
+        return false;
+    }
+
+    for(std::size_t i = 0; i < info.parents.size(); ++i)
+    {
+        if(info.parents[i] < -1 || info.parents[i] >= (int)i)
+        {
+            LogError() << LogInitializeSkeletonError() << "Bones are not ordered after their parents.";
+            return false;
+        }
+    }
+
+    m_parents = info.parents;
+    m_bindPose = info.bindPose;
+
+    // Invert model matrices of the bind pose, which moves vertices into bone space.
+    std::vector<glm::mat3> model(m_parents.size());
+    m_inverseBind.resize(m_parents.size());
+
+    for(std::size_t i = 0; i < m_parents.size(); ++i)
+    {
+        glm::mat3 local = m_bindPose[i].ToMatrix();
+        model[i] = m_parents[i] < 0 ? local : model[m_parents[i]] * local;
+        m_inverseBind[i] = glm::inverse(model[i]);
+    }
+
+    // Success!
+    return m_initialized = true;
+}
+
+void Skeleton::ComputeSkinning(const BoneTransform* pose, const glm::mat3& world, glm::vec4* output) const
+{
+    if(!m_initialized)
+        return;
+
+    glm::mat3 model[MaximumBones];
+
+    for(std::size_t i = 0; i < m_parents.size(); ++i)
+    {
+        glm::mat3 local = pose[i].ToMatrix();
+        model[i] = m_parents[i] < 0 ? world * local : model[m_parents[i]] * local;
+
+        // Store rows, which the vertex shader dots with positions.
+        glm::mat3 skinning = model[i] * m_inverseBind[i];
+        output[i * 2 + 0] = glm::vec4(skinning[0][0], skinning[1][0], skinning[2][0], 0.0f);
+        output[i * 2 + 1] = glm::vec4(skinning[0][1], skinning[1][1], skinning[2][1], 0.0f);
+    }
+}
+
+int Skeleton::GetBoneCount() const
+{
+    return (int)m_parents.size();
+}
+
+const BoneTransform* Skeleton::GetBindPose() const
+{
+    return m_bindPose.data();
+}
+
+AnimationClipInfo::AnimationClipInfo() :
+    boneCount(0),
+    sampleRate(30.0f),
+    looping(true)
+{
+}
+
+AnimationClip::AnimationClip() :
+    m_boneCount(0),
+    m_frameCount(0),
+    m_sampleRate(0.0f),
+    m_looping(false),
+    m_slotCount(0),
+    m_initialized(false)
+{
+}
+
+AnimationClip::~AnimationClip()
+{
+    this->Cleanup();
+}
+
+void AnimationClip::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    m_boneCount = 0;
+    m_frameCount = 0;
+    m_sampleRate = 0.0f;
+    m_looping = false;
+
+    Utility::ClearContainer(m_minimum);
+    Utility::ClearContainer(m_range);
+    Utility::ClearContainer(m_trackSlots);
+    Utility::ClearContainer(m_samples);
+
+    m_slotCount = 0;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool AnimationClip::Initialize(const AnimationClipInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.boneCount <= 0 || info.boneCount > Skeleton::MaximumBones)
+    {
+        LogError() << LogInitializeClipError() << "Invalid number of bones.";
+        return false;
+    }
+
+    if(info.sampleRate <= 0.0f)
+    {
+        LogError() << LogInitializeClipError() << "Invalid sample rate.";
+        return false;
+    }
+
+    if(info.samples.empty() || info.samples.size() % info.boneCount != 0)
+    {
+        LogError() << LogInitializeClipError() << "Samples do not form whole frames.";
+        return false;
+    }
+
+    m_boneCount = info.boneCount;
+    m_frameCount = (int)(info.samples.size() / info.boneCount);
+    m_sampleRate = info.sampleRate;
+    m_looping = info.looping;
+
+    // Find the range of every track and give varying ones a slot.
+    const int trackCount = Channels::Count * m_boneCount;
+
+    m_minimum.resize(trackCount);
+    m_range.resize(trackCount);
+    m_trackSlots.resize(trackCount);
+    m_slotCount = 0;
+
+    for(int channel = 0; channel < Channels::Count; ++channel)
+    {
+        for(int bone = 0; bone < m_boneCount; ++bone)
+        {
+            float minimum = std::numeric_limits<float>::max();
+            float maximum = -std::numeric_limits<float>::max();
+
+            for(int frame = 0; frame < m_frameCount; ++frame)
+            {
+                float value = GetChannel(info.samples[(std::size_t)frame * m_boneCount + bone], channel);
+                minimum = std::min(minimum, value);
+                maximum = std::max(maximum, value);
+            }
+
+            int track = channel * m_boneCount + bone;
+            m_minimum[track] = minimum;
+            m_range[track] = maximum - minimum;
+            m_trackSlots[track] = m_range[track] > ConstantRange ? m_slotCount++ : -1;
+        }
+    }
+
+    // Quantize varying tracks within their ranges.
+    m_samples.resize((std::size_t)m_frameCount * m_slotCount);
+
+    for(int frame = 0; frame < m_frameCount; ++frame)
+    {
+        std::uint16_t* samples = m_samples.data() + (std::size_t)frame * m_slotCount;
+
+        for(int track = 0; track < trackCount; ++track)
+        {
+            int slot = m_trackSlots[track];
+
+            if(slot < 0)
+                continue;
+
+            int channel = track / m_boneCount;
+            int bone = track % m_boneCount;
+
+            float value = GetChannel(info.samples[(std::size_t)frame * m_boneCount + bone], channel);
+            float normalized = (value - m_minimum[track]) / m_range[track];
+
+            samples[slot] = (std::uint16_t)(glm::clamp(normalized, 0.0f, 1.0f) * QuantizedMaximum + 0.5f);
+        }
+    }
+
+    // Success!
+    return m_initialized = true;
+}
+
+void AnimationClip::Sample(float time, BoneTransform* pose) const
+{
+    if(!m_initialized)
+        return;
+
+    // Find frames around the time.
+    float position = this->WrapTime(time) * m_sampleRate;
+    int first = std::min((int)position, m_frameCount - 1);
+    int second = first + 1;
+    float weight = position - (float)first;
+
+    if(second >= m_frameCount)
+    {
+        second = m_looping ? 0 : m_frameCount - 1;
+    }
+
+    // Decode channels of both frames and interpolate them.
+    float firstValues[Skeleton::MaximumBones];
+    float secondValues[Skeleton::MaximumBones];
+
+    for(int channel = 0; channel < Channels::Count; ++channel)
+    {
+        this->DecodeChannel(first, channel, firstValues);
+        this->DecodeChannel(second, channel, secondValues);
+
+        for(int bone = 0; bone < m_boneCount; ++bone)
+        {
+            float value = glm::mix(firstValues[bone], secondValues[bone], weight);
+
+            switch(channel)
+            {
+            case Channels::TranslationX: pose[bone].translation.x = value; break;
+            case Channels::TranslationY: pose[bone].translation.y = value; break;
+            case Channels::Rotation: pose[bone].rotation = value; break;
+            case Channels::ScaleX: pose[bone].scale.x = value; break;
+            case Channels::ScaleY: pose[bone].scale.y = value; break;
+            }
+        }
+    }
+}
+
+float AnimationClip::WrapTime(float time) const
+{
+    float duration = this->GetDuration();
+
+    if(duration <= 0.0f)
+        return 0.0f;
+
+    if(m_looping)
+    {
+        time = std::fmod(time, duration);
+        return time < 0.0f ? time + duration : time;
+    }
+
+    return glm::clamp(time, 0.0f, (float)(m_frameCount - 1) / m_sampleRate);
+}
+
+int AnimationClip::GetBoneCount() const
+{
+    return m_boneCount;
+}
+
+float AnimationClip::GetDuration() const
+{
+    // Looping clips interpolate from the last frame back to the first.
+    if(!m_initialized)
+        return 0.0f;
+
+    return (float)(m_looping ? m_frameCount : m_frameCount - 1) / m_sampleRate;
+}
+
+std::size_t AnimationClip::GetCompressedSize() const
+{
+    return m_samples.size() * sizeof(std::uint16_t) + (m_minimum.size() + m_range.size()) * sizeof(float) + m_trackSlots.size() * sizeof(int);
+}
+
+void AnimationClip::DecodeChannel(int frame, int channel, float* output) const
+{
+    const std::uint16_t* samples = m_samples.data() + (std::size_t)frame * m_slotCount;
+    const int first = channel * m_boneCount;
+
+    for(int bone = 0; bone < m_boneCount; ++bone)
+    {
+        int track = first + bone;
+        int slot = m_trackSlots[track];
+
+        output[bone] = slot < 0 ? m_minimum[track] : m_minimum[track] + m_range[track] * ((float)samples[slot] / QuantizedMaximum);
+    }
+}
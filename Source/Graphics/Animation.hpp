@@ -0,0 +1,205 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Animation
+//
+//  Skeletons and clips of two dimensional skeletal animation. A skeleton
+//  is a hierarchy of bones ordered so that parents come before children,
+//  with a bind pose that skinned vertices are defined in. A clip holds
+//  local transforms of every bone sampled at a fixed rate.
+//
+//  Clips are compressed into structure of arrays tracks, with a track for
+//  every channel of every bone. Each sample is quantized to sixteen bits
+//  within the range of its track, which halves the memory of clips, and
+//  samples of a frame are stored channel by channel, so sampling reads
+//  contiguous arrays of all bones. Tracks that never change store no
+//  samples at all.
+//
+//  Sampling is thread safe, so poses of many entities can be sampled in
+//  parallel, and writes into buffers given by the caller.
+//
+//  Example usage:
+//      Graphics::SkeletonInfo skeletonInfo;
+//      skeletonInfo.parents = { -1, 0, 1 };
+//      skeletonInfo.bindPose.resize(3);
+//
+//      Graphics::Skeleton skeleton;
+//      skeleton.Initialize(skeletonInfo);
+//
+//      Graphics::AnimationClipInfo clipInfo;
+//      clipInfo.boneCount = 3;
+//      clipInfo.sampleRate = 30.0f;
+//      clipInfo.samples = { /* Frame major local transforms. */ };
+//
+//      Graphics::AnimationClip clip;
+//      clip.Initialize(clipInfo);
+//
+//      Graphics::BoneTransform pose[3];
+//      clip.Sample(time, pose);
+//
+//      glm::vec4 skinning[6];
+//      skeleton.ComputeSkinning(pose, glm::mat3(1.0f), skinning);
+//
+
+namespace Graphics
+{
+    // Local transform of a bone relative to its parent.
+    struct BoneTransform
+    {
+        BoneTransform() :
+            translation(0.0f, 0.0f),
+            rotation(0.0f),
+            scale(1.0f, 1.0f)
+        {
+        }
+
+        glm::vec2 translation;
+        float rotation;
+        glm::vec2 scale;
+
+        // Interpolates between transforms, rotating along the shorter arc.
+        static BoneTransform Blend(const BoneTransform& from, const BoneTransform& to, float weight);
+
+        // Builds an affine matrix that scales, rotates and translates.
+        glm::mat3 ToMatrix() const;
+    };
+
+    // Skeleton initialization struct.
+    struct SkeletonInfo
+    {
+        // Parent index of every bone, or minus one for roots.
+        std::vector<int> parents;
+
+        // Local transforms that skinned vertices are defined in.
+        std::vector<BoneTransform> bindPose;
+    };
+
+    // Skeleton class.
+    class Skeleton : private NonCopyable
+    {
+    public:
+        // Maximum number of bones of a skeleton.
+        static const int MaximumBones = 128;
+
+    public:
+        Skeleton();
+        ~Skeleton();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the skeleton instance.
+        bool Initialize(const SkeletonInfo& info);
+
+        // Computes skinning matrices of a local pose placed with a world transform.
+        // Writes the first two rows of every affine matrix, so output has two vectors per bone.
+        void ComputeSkinning(const BoneTransform* pose, const glm::mat3& world, glm::vec4* output) const;
+
+        // Gets the number of bones.
+        int GetBoneCount() const;
+
+        // Gets the bind pose.
+        const BoneTransform* GetBindPose() const;
+
+    private:
+        // Hierarchy of bones.
+        std::vector<int> m_parents;
+
+        // Bind pose and inverse model matrices of bones in it.
+        std::vector<BoneTransform> m_bindPose;
+        std::vector<glm::mat3> m_inverseBind;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+
+    // Animation clip initialization struct.
+    struct AnimationClipInfo
+    {
+        // Number of bones of every frame.
+        int boneCount;
+
+        // Number of frames per second.
+        float sampleRate;
+
+        // Local transforms of all bones of every frame, one frame after another.
+        std::vector<BoneTransform> samples;
+
+        // Wraps time around the end of the clip.
+        bool looping;
+
+        AnimationClipInfo();
+    };
+
+    // Animation clip class.
+    class AnimationClip : private NonCopyable
+    {
+    public:
+        // Channels of a bone transform.
+        struct Channels
+        {
+            enum Type
+            {
+                TranslationX,
+                TranslationY,
+                Rotation,
+                ScaleX,
+                ScaleY,
+
+                Count,
+            };
+        };
+
+    public:
+        AnimationClip();
+        ~AnimationClip();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the animation clip instance.
+        bool Initialize(const AnimationClipInfo& info);
+
+        // Samples local transforms of all bones at a time in seconds.
+        void Sample(float time, BoneTransform* pose) const;
+
+        // Wraps or clamps time to the duration of the clip.
+        float WrapTime(float time) const;
+
+        // Gets the number of bones.
+        int GetBoneCount() const;
+
+        // Gets the duration in seconds.
+        float GetDuration() const;
+
+        // Gets the size of compressed tracks in bytes.
+        std::size_t GetCompressedSize() const;
+
+    private:
+        // Decodes a channel of all bones at a frame.
+        void DecodeChannel(int frame, int channel, float* output) const;
+
+    private:
+        // Layout of frames.
+        int m_boneCount;
+        int m_frameCount;
+        float m_sampleRate;
+        bool m_looping;
+
+        // Minimum and range of every track, ordered by channel and then bone.
+        std::vector<float> m_minimum;
+        std::vector<float> m_range;
+
+        // Index of every track into samples of a frame, or minus one for constant tracks.
+        std::vector<int> m_trackSlots;
+        int m_slotCount;
+
+        // Quantized samples, ordered by frame and then by slot.
+        std::vector<std::uint16_t> m_samples;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
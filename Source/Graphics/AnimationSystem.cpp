@@ -0,0 +1,692 @@
+#include "Precompiled.hpp"
+#include "AnimationSystem.hpp"
+#include "StreamBuffer.hpp"
+#include "Common/Parallel.hpp"
+using namespace Graphics;
+
+namespace Graphics
+{
+    namespace Detail
+    {
+        // Buffers of a skinned mesh.
+        struct AnimationMesh
+        {
+            AnimationMesh() :
+                state(nullptr),
+                vertexArray(0),
+                vertexBuffer(0),
+                indexBuffer(0),
+                indexCount(0)
+            {
+            }
+
+            AnimationSystemState* state;
+
+            // Data uploaded on creation and released afterwards.
+            std::vector<SkinnedVertex> vertices;
+            std::vector<std::uint16_t> indices;
+
+            GLuint vertexArray;
+            GLuint vertexBuffer;
+            GLuint indexBuffer;
+            GLsizei indexCount;
+        };
+
+        // Instanced draw of a mesh.
+        struct AnimationDraw
+        {
+            AnimationMesh* mesh;
+            GLuint texture;
+            int boneCount;
+            int poseOffset;
+            int instanceCount;
+        };
+
+        // Poses and draws of a frame recorded for the render thread.
+        struct AnimationFrame
+        {
+            AnimationFrame() :
+                state(nullptr)
+            {
+            }
+
+            AnimationSystemState* state;
+
+            std::vector<glm::vec4> poses;
+            std::vector<AnimationDraw> draws;
+            glm::mat4 viewProjection;
+        };
+
+        // State shared with the render thread.
+        struct AnimationSystemState
+        {
+            AnimationSystemState() :
+                programCache(nullptr),
+                boneCapacity(0),
+                program(0),
+                viewProjectionLocation(-1),
+                poseBaseLocation(-1),
+                boneCountLocation(-1),
+                posesLocation(-1),
+                textureLocation(-1),
+                poseTexture(0),
+                whiteTexture(0)
+            {
+            }
+
+            ProgramCache* programCache;
+            std::size_t boneCapacity;
+
+            GLuint program;
+            GLint viewProjectionLocation;
+            GLint poseBaseLocation;
+            GLint boneCountLocation;
+            GLint posesLocation;
+            GLint textureLocation;
+
+            GLuint poseTexture;
+            GLuint whiteTexture;
+            StreamBuffer stream;
+
+            std::vector<std::unique_ptr<AnimationMesh>> meshes;
+
+            AnimationFrame frames[AnimationSystem::FrameCount];
+        };
+    }
+}
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize an animation system! "
+    #define LogCreateResourcesError() "Failed to create animation system resources! "
+    #define LogCreateMeshError() "Failed to create a skinned mesh! "
+
+    // Number of instances sampled by a single chunk.
+    const int SampleGrainSize = 16;
+
+    // Number of texels of skinning matrices per bone.
+    const int TexelsPerBone = 2;
+
+    // Skinning shaders.
+    const char* VertexShader =
+        "#version 330 core\n"
+        "layout(location = 0) in vec2 vertexPosition;\n"
+        "layout(location = 1) in vec2 vertexTexture;\n"
+        "layout(location = 2) in uvec4 vertexBones;\n"
+        "layout(location = 3) in vec4 vertexWeights;\n"
+        "uniform mat4 viewProjection;\n"
+        "uniform samplerBuffer poses;\n"
+        "uniform int poseBase;\n"
+        "uniform int boneCount;\n"
+        "out vec2 fragmentTexture;\n"
+        "void main()\n"
+        "{\n"
+        "    int base = poseBase + gl_InstanceID * boneCount * 2;\n"
+        "    vec3 position = vec3(vertexPosition, 1.0);\n"
+        "    vec2 skinned = vec2(0.0);\n"
+        "    for(int i = 0; i < 4; ++i)\n"
+        "    {\n"
+        "        int texel = base + int(vertexBones[i]) * 2;\n"
+        "        vec3 first = texelFetch(poses, texel).xyz;\n"
+        "        vec3 second = texelFetch(poses, texel + 1).xyz;\n"
+        "        skinned += vertexWeights[i] * vec2(dot(first, position), dot(second, position));\n"
+        "    }\n"
+        "    float depth = texelFetch(poses, base).w;\n"
+        "    gl_Position = viewProjection * vec4(skinned, depth, 1.0);\n"
+        "    fragmentTexture = vertexTexture;\n"
+        "}\n";
+
+    const char* FragmentShader =
+        "#version 330 core\n"
+        "in vec2 fragmentTexture;\n"
+        "uniform sampler2D meshTexture;\n"
+        "out vec4 outputColor;\n"
+        "void main()\n"
+        "{\n"
+        "    outputColor = texture(meshTexture, fragmentTexture);\n"
+        "}\n";
+
+    // Links the skinning program, loading its binary when it has been cached.
+    GLuint LinkProgram(ProgramCache* programCache)
+    {
+        ShaderStage stages[2];
+        stages[0].type = GL_VERTEX_SHADER;
+        stages[0].source = VertexShader;
+        stages[1].type = GL_FRAGMENT_SHADER;
+        stages[1].source = FragmentShader;
+
+        if(programCache != nullptr)
+            return programCache->Link(stages, 2, "AnimationSystem");
+
+        return ProgramCache::CompileAndLink(stages, 2, "AnimationSystem");
+    }
+
+    // Creates OpenGL objects on the render thread.
+    void CreateResources(StateCache& cache, void* argument)
+    {
+        auto state = static_cast<Detail::AnimationSystemState*>(argument);
+
+        // Check that poses of all frames in flight fit into a texture buffer.
+        GLint maximumTexels = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maximumTexels);
+
+        if(state->boneCapacity * TexelsPerBone * AnimationSystem::FrameCount > (std::size_t)maximumTexels)
+        {
+            LogError() << LogCreateResourcesError() << "Bone capacity exceeds the texture buffer size.";
+            return;
+        }
+
+        // Create the stream buffer with a region per frame in flight.
+        StreamBufferInfo streamInfo;
+        streamInfo.target = GL_TEXTURE_BUFFER;
+        streamInfo.regionSize = sizeof(glm::vec4) * TexelsPerBone * state->boneCapacity;
+        streamInfo.regionCount = AnimationSystem::FrameCount;
+
+        if(!state->stream.Initialize(streamInfo))
+            return;
+
+        // Create the program.
+        state->program = LinkProgram(state->programCache);
+
+        if(state->program == 0)
+            return;
+
+        state->viewProjectionLocation = glGetUniformLocation(state->program, "viewProjection");
+        state->poseBaseLocation = glGetUniformLocation(state->program, "poseBase");
+        state->boneCountLocation = glGetUniformLocation(state->program, "boneCount");
+        state->posesLocation = glGetUniformLocation(state->program, "poses");
+        state->textureLocation = glGetUniformLocation(state->program, "meshTexture");
+
+        // Create the texture buffer that views the whole stream buffer.
+        glGenTextures(1, &state->poseTexture);
+        cache.BindTexture(1, GL_TEXTURE_BUFFER, state->poseTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, state->stream.GetHandle());
+        cache.BindTexture(1, GL_TEXTURE_BUFFER, 0);
+
+        // Create a white texture for meshes without one.
+        const std::uint32_t WhitePixel = 0xFFFFFFFF;
+
+        glGenTextures(1, &state->whiteTexture);
+        cache.BindTexture(0, GL_TEXTURE_2D, state->whiteTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &WhitePixel);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        cache.BindTexture(0, GL_TEXTURE_2D, 0);
+    }
+
+    // Destroys OpenGL objects and the state on the render thread.
+    void DestroyResources(StateCache& cache, void* argument)
+    {
+        auto state = static_cast<Detail::AnimationSystemState*>(argument);
+
+        for(auto& mesh : state->meshes)
+        {
+            glDeleteVertexArrays(1, &mesh->vertexArray);
+            glDeleteBuffers(1, &mesh->vertexBuffer);
+            glDeleteBuffers(1, &mesh->indexBuffer);
+        }
+
+        state->stream.Cleanup();
+
+        glDeleteTextures(1, &state->poseTexture);
+        glDeleteTextures(1, &state->whiteTexture);
+        glDeleteProgram(state->program);
+
+        // Deleted objects may have been bound.
+        cache.Invalidate();
+
+        delete state;
+    }
+
+    // Uploads a mesh and takes its ownership on the render thread.
+    void CreateMeshResources(StateCache& cache, void* argument)
+    {
+        auto mesh = static_cast<Detail::AnimationMesh*>(argument);
+        mesh->state->meshes.emplace_back(mesh);
+
+        glGenVertexArrays(1, &mesh->vertexArray);
+        cache.BindVertexArray(mesh->vertexArray);
+
+        glGenBuffers(1, &mesh->vertexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(SkinnedVertex) * mesh->vertices.size(), mesh->vertices.data(), GL_STATIC_DRAW);
+
+        glGenBuffers(1, &mesh->indexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(std::uint16_t) * mesh->indices.size(), mesh->indices.data(), GL_STATIC_DRAW);
+
+        const GLsizei stride = sizeof(SkinnedVertex);
+
+        for(GLuint attribute = 0; attribute <= 3; ++attribute)
+        {
+            glEnableVertexAttribArray(attribute);
+        }
+
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offsetof(SkinnedVertex, position)));
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offsetof(SkinnedVertex, texture)));
+        glVertexAttribIPointer(2, 4, GL_UNSIGNED_BYTE, stride, reinterpret_cast<const void*>(offsetof(SkinnedVertex, bones)));
+        glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, reinterpret_cast<const void*>(offsetof(SkinnedVertex, weights)));
+
+        // The element buffer stays bound to the vertex array.
+        cache.BindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        mesh->indexCount = (GLsizei)mesh->indices.size();
+
+        Utility::ClearContainer(mesh->vertices);
+        Utility::ClearContainer(mesh->indices);
+    }
+
+    // Streams poses of a frame and draws its meshes on the render thread.
+    void DrawFrame(StateCache& cache, void* argument)
+    {
+        auto frame = static_cast<Detail::AnimationFrame*>(argument);
+        auto state = frame->state;
+
+        if(state->program == 0 || frame->draws.empty())
+            return;
+
+        // Copy skinning matrices of all instances.
+        std::size_t size = sizeof(glm::vec4) * frame->poses.size();
+        std::size_t offset = 0;
+
+        void* data = state->stream.Map(size, sizeof(glm::vec4), offset);
+
+        if(data == nullptr)
+            return;
+
+        std::memcpy(data, frame->poses.data(), size);
+        state->stream.Unmap();
+
+        // Draw instances of every mesh with a single call.
+        const GLint base = (GLint)(offset / sizeof(glm::vec4));
+
+        cache.UseProgram(state->program);
+        glUniformMatrix4fv(state->viewProjectionLocation, 1, GL_FALSE, &frame->viewProjection[0][0]);
+        glUniform1i(state->textureLocation, 0);
+        glUniform1i(state->posesLocation, 1);
+
+        cache.BindTexture(1, GL_TEXTURE_BUFFER, state->poseTexture);
+
+        for(const auto& draw : frame->draws)
+        {
+            glUniform1i(state->poseBaseLocation, base + draw.poseOffset);
+            glUniform1i(state->boneCountLocation, draw.boneCount);
+
+            cache.BindVertexArray(draw.mesh->vertexArray);
+            cache.BindTexture(0, GL_TEXTURE_2D, draw.texture != 0 ? draw.texture : state->whiteTexture);
+            glDrawElementsInstanced(GL_TRIANGLES, draw.mesh->indexCount, GL_UNSIGNED_SHORT, nullptr, draw.instanceCount);
+        }
+
+        cache.BindVertexArray(0);
+
+        state->stream.EndFrame();
+    }
+}
+
+SkinnedMeshInfo::SkinnedMeshInfo() :
+    skeleton(-1),
+    texture(0)
+{
+}
+
+AnimationSystemInfo::AnimationSystemInfo() :
+    renderer(nullptr),
+    componentSystem(nullptr),
+    jobSystem(nullptr),
+    programCache(nullptr),
+    boneCapacity(8192)
+{
+}
+
+AnimationSystem::AnimationSystem() :
+    m_renderer(nullptr),
+    m_componentSystem(nullptr),
+    m_jobSystem(nullptr),
+    m_state(nullptr),
+    m_boneCapacity(0),
+    m_frameIndex(0),
+    m_animatedCount(0),
+    m_boneCount(0),
+    m_initialized(false)
+{
+}
+
+AnimationSystem::~AnimationSystem()
+{
+    this->Cleanup();
+}
+
+void AnimationSystem::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Destroy the state on the render thread after frames that use it.
+    m_renderer->GetCommands().Call(&DestroyResources, m_state);
+    m_state = nullptr;
+
+    m_renderer = nullptr;
+    m_componentSystem = nullptr;
+    m_jobSystem = nullptr;
+
+    Utility::ClearContainer(m_skeletons);
+    Utility::ClearContainer(m_clips);
+    Utility::ClearContainer(m_meshes);
+
+    Utility::ClearContainer(m_keys);
+    Utility::ClearContainer(m_instances);
+    Utility::ClearContainer(m_sortedInstances);
+    m_boneCapacity = 0;
+
+    m_frameIndex = 0;
+    m_animatedCount = 0;
+    m_boneCount = 0;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool AnimationSystem::Initialize(const AnimationSystemInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.renderer == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid renderer.";
+        return false;
+    }
+
+    if(info.componentSystem == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid component system.";
+        return false;
+    }
+
+    if(info.boneCapacity <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid bone capacity.";
+        return false;
+    }
+
+    m_renderer = info.renderer;
+    m_componentSystem = info.componentSystem;
+    m_jobSystem = info.jobSystem;
+    m_boneCapacity = info.boneCapacity;
+
+    // Create the state and its OpenGL objects on the render thread.
+    m_state = new Detail::AnimationSystemState();
+    m_state->programCache = info.programCache;
+    m_state->boneCapacity = info.boneCapacity;
+
+    for(auto& frame : m_state->frames)
+    {
+        frame.state = m_state;
+    }
+
+    m_renderer->GetCommands().Call(&CreateResources, m_state);
+
+    // Success!
+    return m_initialized = true;
+}
+
+int AnimationSystem::CreateSkeleton(const SkeletonInfo& info)
+{
+    if(!m_initialized)
+        return -1;
+
+    std::unique_ptr<Skeleton> skeleton(new Skeleton());
+
+    if(!skeleton->Initialize(info))
+        return -1;
+
+    m_skeletons.push_back(std::move(skeleton));
+
+    return (int)m_skeletons.size() - 1;
+}
+
+int AnimationSystem::CreateClip(const AnimationClipInfo& info)
+{
+    if(!m_initialized)
+        return -1;
+
+    std::unique_ptr<AnimationClip> clip(new AnimationClip());
+
+    if(!clip->Initialize(info))
+        return -1;
+
+    m_clips.push_back(std::move(clip));
+
+    return (int)m_clips.size() - 1;
+}
+
+int AnimationSystem::CreateMesh(const SkinnedMeshInfo& info)
+{
+    if(!m_initialized)
+        return -1;
+
+    // Validate arguments.
+    if(info.skeleton < 0 || info.skeleton >= (int)m_skeletons.size())
+    {
+        LogError() << LogCreateMeshError() << "Invalid skeleton.";
+        return -1;
+    }
+
+    if(info.vertices.empty() || info.indices.empty() || info.indices.size() % 3 != 0)
+    {
+        LogError() << LogCreateMeshError() << "Invalid triangles.";
+        return -1;
+    }
+
+    const int boneCount = m_skeletons[info.skeleton]->GetBoneCount();
+
+    for(const SkinnedVertex& vertex : info.vertices)
+    {
+        for(int i = 0; i < 4; ++i)
+        {
+            if(vertex.weights[i] != 0 && vertex.bones[i] >= boneCount)
+            {
+                LogError() << LogCreateMeshError() << "Vertex references a missing bone.";
+                return -1;
+            }
+        }
+    }
+
+    for(std::uint16_t index : info.indices)
+    {
+        if(index >= info.vertices.size())
+        {
+            LogError() << LogCreateMeshError() << "Index references a missing vertex.";
+            return -1;
+        }
+    }
+
+    // Upload buffers on the render thread, which takes ownership of them.
+    auto resources = new Detail::AnimationMesh();
+    resources->state = m_state;
+    resources->vertices = info.vertices;
+    resources->indices = info.indices;
+
+    m_renderer->GetCommands().Call(&CreateMeshResources, resources);
+
+    Mesh mesh;
+    mesh.resources = resources;
+    mesh.skeleton = info.skeleton;
+    mesh.texture = info.texture;
+
+    m_meshes.push_back(mesh);
+
+    return (int)m_meshes.size() - 1;
+}
+
+void AnimationSystem::Update(float timeDelta)
+{
+    if(!m_initialized)
+        return;
+
+    Detail::AnimationFrame& frame = m_state->frames[m_frameIndex % FrameCount];
+    frame.draws.clear();
+
+    // Advance animators and gather those that can be played.
+    m_keys.clear();
+    m_instances.clear();
+
+    m_componentSystem->ForEachChunk<Game::Transform, Animator>([this, timeDelta](int count, const Game::EntityHandle* entities, Game::Transform* transforms, Animator* animators)
+    {
+        for(int i = 0; i < count; ++i)
+        {
+            Animator& animator = animators[i];
+
+            if(!this->IsPlayable(animator))
+                continue;
+
+            animator.time = m_clips[animator.clip]->WrapTime(animator.time + timeDelta * animator.speed);
+
+            if(animator.blendClip >= 0)
+            {
+                animator.blendTime = m_clips[animator.blendClip]->WrapTime(animator.blendTime + timeDelta * animator.speed);
+            }
+
+            Instance instance;
+            instance.transform = transforms[i];
+            instance.animator = animator;
+            instance.poseOffset = 0;
+
+            m_keys.push_back((std::uint64_t)animator.mesh << 32 | (std::uint64_t)m_instances.size());
+            m_instances.push_back(instance);
+        }
+    });
+
+    // Sort instances by mesh and assign their ranges of the pose buffer.
+    Parallel::Sort(m_jobSystem, m_keys.data(), (int)m_keys.size());
+
+    m_sortedInstances.clear();
+    m_sortedInstances.reserve(m_keys.size());
+
+    int boneCount = 0;
+
+    for(std::uint64_t key : m_keys)
+    {
+        const Mesh& mesh = m_meshes[key >> 32];
+        const int meshBones = m_skeletons[mesh.skeleton]->GetBoneCount();
+
+        if(boneCount + meshBones > m_boneCapacity)
+        {
+            LogWarning() << "Animation system capacity of " << m_boneCapacity << " bones has been exceeded.";
+            break;
+        }
+
+        Instance instance = m_instances[key & 0xFFFFFFFF];
+        instance.poseOffset = boneCount * TexelsPerBone;
+
+        if(frame.draws.empty() || frame.draws.back().mesh != mesh.resources)
+        {
+            Detail::AnimationDraw draw;
+            draw.mesh = mesh.resources;
+            draw.texture = mesh.texture;
+            draw.boneCount = meshBones;
+            draw.poseOffset = instance.poseOffset;
+            draw.instanceCount = 0;
+
+            frame.draws.push_back(draw);
+        }
+
+        frame.draws.back().instanceCount += 1;
+
+        m_sortedInstances.push_back(instance);
+        boneCount += meshBones;
+    }
+
+    // Sample poses in parallel, with every instance writing its own range.
+    frame.poses.resize((std::size_t)boneCount * TexelsPerBone);
+
+    Parallel::For(m_jobSystem, (int)m_sortedInstances.size(), SampleGrainSize, [&](int begin, int end)
+    {
+        for(int i = begin; i < end; ++i)
+        {
+            const Instance& instance = m_sortedInstances[i];
+            this->SampleInstance(instance, frame.poses.data() + instance.poseOffset);
+        }
+    });
+
+    m_animatedCount = (int)m_sortedInstances.size();
+    m_boneCount = boneCount;
+}
+
+void AnimationSystem::Draw(CommandBuffer& commands, const glm::mat4& viewProjection)
+{
+    if(!m_initialized)
+        return;
+
+    Detail::AnimationFrame& frame = m_state->frames[m_frameIndex % FrameCount];
+    frame.viewProjection = viewProjection;
+
+    // Draw the frame on the render thread.
+    commands.Call(&DrawFrame, &frame);
+
+    m_frameIndex += 1;
+}
+
+int AnimationSystem::GetAnimatedCount() const
+{
+    return m_animatedCount;
+}
+
+int AnimationSystem::GetBoneCount() const
+{
+    return m_boneCount;
+}
+
+bool AnimationSystem::IsPlayable(const Animator& animator) const
+{
+    if(animator.mesh < 0 || animator.mesh >= (int)m_meshes.size())
+        return false;
+
+    const int boneCount = m_skeletons[m_meshes[animator.mesh].skeleton]->GetBoneCount();
+
+    if(animator.clip < 0 || animator.clip >= (int)m_clips.size() || m_clips[animator.clip]->GetBoneCount() != boneCount)
+        return false;
+
+    if(animator.blendClip >= (int)m_clips.size() || (animator.blendClip >= 0 && m_clips[animator.blendClip]->GetBoneCount() != boneCount))
+        return false;
+
+    return true;
+}
+
+void AnimationSystem::SampleInstance(const Instance& instance, glm::vec4* output) const
+{
+    const Animator& animator = instance.animator;
+    const Skeleton& skeleton = *m_skeletons[m_meshes[animator.mesh].skeleton];
+    const int boneCount = skeleton.GetBoneCount();
+
+    // Sample the clip and blend the second one over it.
+    BoneTransform pose[Skeleton::MaximumBones];
+    m_clips[animator.clip]->Sample(animator.time, pose);
+
+    float blendWeight = glm::clamp(animator.blendWeight, 0.0f, 1.0f);
+
+    if(animator.blendClip >= 0 && blendWeight > 0.0f)
+    {
+        BoneTransform blended[Skeleton::MaximumBones];
+        m_clips[animator.blendClip]->Sample(animator.blendTime, blended);
+
+        for(int bone = 0; bone < boneCount; ++bone)
+        {
+            pose[bone] = BoneTransform::Blend(pose[bone], blended[bone], blendWeight);
+        }
+    }
+
+    // Place the skeleton with the transform of the entity.
+    BoneTransform world;
+    world.translation = glm::vec2(instance.transform.position);
+    world.rotation = instance.transform.rotation;
+    world.scale = instance.transform.scale;
+
+    skeleton.ComputeSkinning(pose, world.ToMatrix(), output);
+
+    // The first texel carries the depth of the instance.
+    output[0].w = instance.transform.position.z;
+}
@@ -0,0 +1,239 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/JobSystem.hpp"
+#include "Game/Transform.hpp"
+#include "Game/ComponentSystem.hpp"
+#include "Renderer.hpp"
+#include "ProgramCache.hpp"
+#include "Animation.hpp"
+
+//
+// Animation System
+//
+//  Animates and draws entities with Transform and Animator components as
+//  skinned meshes. Once per frame, times of animators are advanced and
+//  poses of all entities are sampled from their clips, blended and turned
+//  into skinning matrices in parallel on the job system. Every entity
+//  writes its matrices into its own range of a single pose buffer.
+//
+//  The pose buffer is streamed to the GPU through a ring buffer with a
+//  region per frame in flight, which is read by the vertex shader as a
+//  texture buffer. Entities are sorted by mesh and every mesh is drawn
+//  with a single instanced draw call, where each instance fetches its
+//  matrices by its index and skins vertices with up to four bones.
+//
+//  Skeletons, clips and meshes are created up front and referenced by
+//  components with their indices. Clips have to animate as many bones as
+//  the skeleton of the mesh they are played on.
+//
+//  Example usage:
+//      Graphics::AnimationSystemInfo info;
+//      info.renderer = &renderer;
+//      info.componentSystem = &componentSystem;
+//      info.jobSystem = &jobSystem;
+//
+//      Graphics::AnimationSystem animationSystem;
+//      animationSystem.Initialize(info);
+//
+//      int skeleton = animationSystem.CreateSkeleton(skeletonInfo);
+//      int clip = animationSystem.CreateClip(clipInfo);
+//      int mesh = animationSystem.CreateMesh(meshInfo);
+//
+//      Graphics::Animator animator;
+//      animator.mesh = mesh;
+//      animator.clip = clip;
+//
+//      componentSystem.AddComponent(entity, Game::Transform());
+//      componentSystem.AddComponent(entity, animator);
+//
+//      animationSystem.Update(timeDelta);
+//      animationSystem.Draw(renderer.GetCommands(), viewProjection);
+//      renderer.Submit();
+//
+
+namespace Graphics
+{
+    // Implementation details.
+    namespace Detail
+    {
+        struct AnimationSystemState;
+        struct AnimationMesh;
+    }
+
+    // Animator component.
+    struct Animator
+    {
+        Animator() :
+            mesh(-1),
+            clip(-1),
+            blendClip(-1),
+            time(0.0f),
+            blendTime(0.0f),
+            blendWeight(0.0f),
+            speed(1.0f)
+        {
+        }
+
+        // Indices of the mesh and the clip it plays.
+        int mesh;
+        int clip;
+
+        // Optional index of a clip blended over the first one.
+        int blendClip;
+
+        // Playback times of both clips in seconds.
+        float time;
+        float blendTime;
+
+        // Weight of the blended clip between zero and one.
+        float blendWeight;
+
+        // Multiplier of playback time.
+        float speed;
+    };
+
+    // Skinned mesh vertex.
+    struct SkinnedVertex
+    {
+        glm::vec2 position;
+        glm::vec2 texture;
+
+        // Indices of bones and their normalized weights.
+        std::uint8_t bones[4];
+        std::uint8_t weights[4];
+    };
+
+    // Skinned mesh initialization struct.
+    struct SkinnedMeshInfo
+    {
+        // Index of the skeleton that vertices are bound to.
+        int skeleton;
+
+        // Triangles in the bind pose of the skeleton.
+        std::vector<SkinnedVertex> vertices;
+        std::vector<std::uint16_t> indices;
+
+        // Optional texture of the mesh.
+        GLuint texture;
+
+        SkinnedMeshInfo();
+    };
+
+    // Animation system initialization struct.
+    struct AnimationSystemInfo
+    {
+        // Renderer that executes draws.
+        Renderer* renderer;
+
+        // Component system with animators.
+        Game::ComponentSystem* componentSystem;
+
+        // Optional job system that sampling is split between.
+        JobSystem* jobSystem;
+
+        // Optional cache of program binaries.
+        ProgramCache* programCache;
+
+        // Maximum number of bones animated in a frame.
+        int boneCapacity;
+
+        AnimationSystemInfo();
+    };
+
+    // Animation system class.
+    class AnimationSystem : private NonCopyable
+    {
+    public:
+        // Number of frames that can be in flight.
+        static const int FrameCount = 3;
+
+    public:
+        AnimationSystem();
+        ~AnimationSystem();
+
+        // Restores instance to its original state.
+        // Must be called before the renderer is cleaned up.
+        void Cleanup();
+
+        // Initializes the animation system instance.
+        bool Initialize(const AnimationSystemInfo& info);
+
+        // Creates a skeleton and returns its index, or minus one on failure.
+        int CreateSkeleton(const SkeletonInfo& info);
+
+        // Creates an animation clip and returns its index, or minus one on failure.
+        int CreateClip(const AnimationClipInfo& info);
+
+        // Creates a skinned mesh and returns its index, or minus one on failure.
+        int CreateMesh(const SkinnedMeshInfo& info);
+
+        // Advances animators and samples poses of all entities.
+        void Update(float timeDelta);
+
+        // Records draws of poses sampled in the last update.
+        // Has to be called at most once per submitted frame, after an update.
+        void Draw(CommandBuffer& commands, const glm::mat4& viewProjection);
+
+        // Gets the number of entities animated in the last update.
+        int GetAnimatedCount() const;
+
+        // Gets the number of bones animated in the last update.
+        int GetBoneCount() const;
+
+    private:
+        // Mesh with its skeleton.
+        struct Mesh
+        {
+            Detail::AnimationMesh* resources;
+            int skeleton;
+            GLuint texture;
+        };
+
+        // Entity gathered for sampling.
+        struct Instance
+        {
+            Game::Transform transform;
+            Animator animator;
+            int poseOffset;
+        };
+
+        // Checks if an animator references a mesh and clips that match its skeleton.
+        bool IsPlayable(const Animator& animator) const;
+
+        // Samples a pose of an instance and writes its skinning matrices.
+        void SampleInstance(const Instance& instance, glm::vec4* output) const;
+
+    private:
+        // Renderer that executes draws.
+        Renderer* m_renderer;
+
+        // Systems that components and jobs come from.
+        Game::ComponentSystem* m_componentSystem;
+        JobSystem* m_jobSystem;
+
+        // State shared with the render thread.
+        Detail::AnimationSystemState* m_state;
+
+        // Resources referenced by animators.
+        std::vector<std::unique_ptr<Skeleton>> m_skeletons;
+        std::vector<std::unique_ptr<AnimationClip>> m_clips;
+        std::vector<Mesh> m_meshes;
+
+        // Gathered instances and their order sorted by mesh.
+        std::vector<std::uint64_t> m_keys;
+        std::vector<Instance> m_instances;
+        std::vector<Instance> m_sortedInstances;
+        int m_boneCapacity;
+
+        // Index of the next frame.
+        std::uint64_t m_frameIndex;
+
+        // Statistics of the last update.
+        int m_animatedCount;
+        int m_boneCount;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Asset Handle
+//
+//  References an asset loaded by an asset manager. Consists of two integers -
+//  an identifier and a version, packed together into a single 64bit value.
+//  The version counter is increased everytime an identifier is reused, so
+//  handles of released assets never refer to assets loaded afterwards.
+//  Default constructed handles refer to no asset.
+//
+
+namespace Graphics
+{
+    // Asset handle class.
+    class AssetHandle
+    {
+    public:
+        // Friend declarations.
+        friend class AssetManager;
+
+        // Type declarations.
+        typedef std::uint64_t ValueType;
+
+    public:
+        // Constructor.
+        AssetHandle() :
+            m_value(0)
+        {
+        }
+
+        // Comparison operators.
+        bool operator==(const AssetHandle& other) const
+        {
+            return m_value == other.m_value;
+        }
+
+        bool operator!=(const AssetHandle& other) const
+        {
+            return m_value != other.m_value;
+        }
+
+        // Gets the identifier.
+        int GetIdentifier() const
+        {
+            return (int)(m_value & 0xFFFFFFFF);
+        }
+
+        // Gets the version.
+        int GetVersion() const
+        {
+            return (int)(m_value >> 32);
+        }
+
+        // Gets the packed value.
+        ValueType GetValue() const
+        {
+            return m_value;
+        }
+
+    private:
+        // Creates a handle from its parts.
+        AssetHandle(int identifier, int version) :
+            m_value(((ValueType)(std::uint32_t)version << 32) | (ValueType)(std::uint32_t)identifier)
+        {
+        }
+
+    private:
+        // Packed handle data.
+        ValueType m_value;
+    };
+}
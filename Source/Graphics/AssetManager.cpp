@@ -0,0 +1,1052 @@
+#include "Precompiled.hpp"
+#include "AssetManager.hpp"
+#include "Targa.hpp"
+#include "CompressedTexture.hpp"
+using namespace Graphics;
+
+namespace Graphics
+{
+    namespace Detail
+    {
+        // Asset stored in a slot that is reused after the asset is released.
+        struct AssetSlot
+        {
+            AssetSlot() :
+                version(1),
+                type(AssetTypes::Texture),
+                state(AssetStates::Invalid),
+                references(0),
+                released(false),
+                width(0),
+                height(0),
+                uploadedRows(0),
+                format(GL_NONE),
+                uploadedLevels(0),
+                object(0)
+            {
+            }
+
+            int version;
+            AssetTypes::Type type;
+            AssetStates::Type state;
+            int references;
+            bool released;
+
+            std::string filename;
+
+            // Decoded pixels or shader source waiting for upload.
+            std::vector<std::uint8_t> data;
+            int width;
+            int height;
+            int uploadedRows;
+
+            // Levels of a compressed texture, pointing into data or a mapped archive.
+            GLenum format;
+            std::vector<CompressedLevel> levels;
+            int uploadedLevels;
+
+            // Texture or program name.
+            GLuint object;
+        };
+
+        // State shared with IO threads and the render thread.
+        struct AssetManagerState
+        {
+            AssetManagerState() :
+                programCache(nullptr),
+                archive(nullptr),
+                readChunkSize(0),
+                uploadBudget(0),
+                pendingCount(0),
+                uploadThread(false),
+                exit(false),
+                pixelBuffer(0)
+            {
+            }
+
+            ProgramCache* programCache;
+            const Archive* archive;
+            std::size_t readChunkSize;
+            std::size_t uploadBudget;
+
+            // Slots are kept in a deque, so references to them stay valid as it grows.
+            std::deque<AssetSlot> slots;
+            std::vector<int> freeSlots;
+            std::map<std::string, int> files;
+            int pendingCount;
+
+            // Slots waiting to be loaded, uploaded or destroyed.
+            std::deque<int> loadQueue;
+            std::deque<int> uploadQueue;
+            std::vector<int> destroyQueue;
+
+            // Textures waiting for the upload thread, if there is one.
+            bool uploadThread;
+            std::deque<int> textureQueue;
+
+            std::mutex mutex;
+            std::condition_variable loadCondition;
+            std::condition_variable uploadCondition;
+            std::atomic<bool> exit;
+
+            // Pixel buffer used by the render thread.
+            GLuint pixelBuffer;
+        };
+    }
+}
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize an asset manager! "
+    #define LogLoadError(filename) "Failed to load \"" << filename << "\" asset! "
+
+    // Type declarations.
+    typedef std::vector<std::uint8_t> ByteList;
+
+    // Reads a file in chunks and stops early when asked to exit.
+    bool ReadFile(const std::string& filename, std::size_t chunkSize, const std::atomic<bool>& exit, ByteList& content)
+    {
+        std::ifstream file(filename, std::ios::binary);
+
+        if(!file)
+        {
+            LogError() << LogLoadError(filename) << "Couldn't open the file.";
+            return false;
+        }
+
+        content.clear();
+
+        while(!exit.load(std::memory_order_relaxed))
+        {
+            std::size_t offset = content.size();
+            content.resize(offset + chunkSize);
+
+            file.read(reinterpret_cast<char*>(content.data() + offset), chunkSize);
+            content.resize(offset + (std::size_t)file.gcount());
+
+            if(file.eof())
+                return true;
+
+            if(!file)
+            {
+                LogError() << LogLoadError(filename) << "Couldn't read the file.";
+                return false;
+            }
+        }
+
+        return false;
+    }
+
+    // Reads a file from the archive if it has an entry for it, or from the file system otherwise.
+    // Stored entries of compressed textures are accessed in place instead of being copied.
+    bool ReadAsset(Detail::AssetManagerState* state, AssetTypes::Type type, const std::string& filename, ByteList& content, const std::uint8_t*& mapped, std::size_t& mappedSize)
+    {
+        mapped = nullptr;
+        mappedSize = 0;
+
+        const ArchiveEntry* entry = state->archive != nullptr ? state->archive->Find(filename) : nullptr;
+
+        if(entry == nullptr)
+            return ReadFile(filename, state->readChunkSize, state->exit, content);
+
+        if(type == AssetTypes::Texture && !entry->IsCompressed())
+        {
+            const void* data = state->archive->GetData(*entry);
+
+            if(CompressedTexture::IsContainer(data, (std::size_t)entry->size))
+            {
+                mapped = static_cast<const std::uint8_t*>(data);
+                mappedSize = (std::size_t)entry->size;
+                return true;
+            }
+        }
+
+        if(!state->archive->Read(*entry, content))
+        {
+            LogError() << LogLoadError(filename) << "Couldn't read the archive entry.";
+            return false;
+        }
+
+        return true;
+    }
+
+    // Parses levels of a compressed texture and checks that the context supports its format.
+    bool ParseCompressedTexture(const std::string& filename, const std::uint8_t* data, std::size_t size, CompressedImage& image)
+    {
+        if(!CompressedTexture::Parse(filename, data, size, image))
+            return false;
+
+        if(!CompressedTexture::IsFormatSupported(image.format))
+        {
+            LogError() << LogLoadError(filename) << "Compressed texture format is not supported by the context.";
+            return false;
+        }
+
+        return true;
+    }
+
+    // Links a program from a shader source, compiling it once for each stage.
+    GLuint LinkProgram(ProgramCache* programCache, const std::string& filename, const ByteList& source)
+    {
+        // Insert the stage define after the version directive.
+        const char* text = reinterpret_cast<const char*>(source.data());
+        std::size_t versionLength = 0;
+
+        if(source.size() >= 8 && std::memcmp(text, "#version", 8) == 0)
+        {
+            const void* newline = std::memchr(text, '\n', source.size());
+            versionLength = newline != nullptr ? (const char*)newline - text + 1 : source.size();
+        }
+
+        const char* vertexParts[] = { text, "#define VERTEX_SHADER\n", text + versionLength };
+        const char* fragmentParts[] = { text, "#define FRAGMENT_SHADER\n", text + versionLength };
+        const GLint lengths[] = { (GLint)versionLength, -1, (GLint)(source.size() - versionLength) };
+
+        ShaderStage stages[2];
+        stages[0].type = GL_VERTEX_SHADER;
+        stages[0].parts = vertexParts;
+        stages[0].lengths = lengths;
+        stages[0].partCount = 3;
+        stages[1].type = GL_FRAGMENT_SHADER;
+        stages[1].parts = fragmentParts;
+        stages[1].lengths = lengths;
+        stages[1].partCount = 3;
+
+        if(programCache != nullptr)
+            return programCache->Link(stages, 2, filename.c_str());
+
+        return ProgramCache::CompileAndLink(stages, 2, filename.c_str());
+    }
+
+    // Returns a slot to the free list.
+    // Has to be called with the mutex locked.
+    void FreeSlot(Detail::AssetManagerState* state, int identifier)
+    {
+        Detail::AssetSlot& slot = state->slots[identifier];
+
+        if(slot.state == AssetStates::Loading || slot.state == AssetStates::Uploading)
+        {
+            state->pendingCount -= 1;
+        }
+
+        slot.state = AssetStates::Invalid;
+        slot.references = 0;
+        slot.released = false;
+        slot.filename.clear();
+        Utility::ClearContainer(slot.data);
+        slot.width = 0;
+        slot.height = 0;
+        slot.uploadedRows = 0;
+        slot.format = GL_NONE;
+        Utility::ClearContainer(slot.levels);
+        slot.uploadedLevels = 0;
+        slot.object = 0;
+
+        state->freeSlots.push_back(identifier);
+    }
+
+    // Deletes the object of a slot on the render thread.
+    void DeleteObject(Detail::AssetSlot& slot)
+    {
+        if(slot.object == 0)
+            return;
+
+        if(slot.type == AssetTypes::Texture)
+        {
+            glDeleteTextures(1, &slot.object);
+        }
+        else
+        {
+            glDeleteProgram(slot.object);
+        }
+
+        slot.object = 0;
+    }
+
+    // Sets sampling parameters of the bound texture with a number of levels.
+    void SetTextureParameters(int levelCount)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+    }
+
+    // Uploads a level of a compressed texture as it is stored.
+    void UploadCompressedLevel(Detail::AssetSlot& slot)
+    {
+        const CompressedLevel& level = slot.levels[slot.uploadedLevels];
+
+        glCompressedTexImage2D(GL_TEXTURE_2D, slot.uploadedLevels, slot.format, level.width, level.height, 0, (GLsizei)level.size, level.data);
+
+        slot.uploadedLevels += 1;
+    }
+
+    // Uploads whole levels of a compressed texture within the budget and tells whether all levels are done.
+    bool UploadCompressedTexture(StateCache& cache, Detail::AssetSlot& slot, std::size_t budget, std::size_t& spent)
+    {
+        if(slot.object == 0)
+        {
+            glGenTextures(1, &slot.object);
+            cache.BindTexture(0, GL_TEXTURE_2D, slot.object);
+
+            SetTextureParameters((int)slot.levels.size());
+        }
+        else
+        {
+            cache.BindTexture(0, GL_TEXTURE_2D, slot.object);
+        }
+
+        // Upload as many levels as the budget allows, but at least one.
+        std::size_t uploaded = 0;
+
+        do
+        {
+            uploaded += slot.levels[slot.uploadedLevels].size;
+            UploadCompressedLevel(slot);
+        }
+        while(slot.uploadedLevels < (int)slot.levels.size() && uploaded + slot.levels[slot.uploadedLevels].size <= budget);
+
+        spent += uploaded;
+
+        return slot.uploadedLevels == (int)slot.levels.size();
+    }
+
+    // Uploads rows of a texture within the budget and tells whether all rows are done.
+    bool UploadTexture(StateCache& cache, Detail::AssetManagerState* state, Detail::AssetSlot& slot, std::size_t budget, std::size_t& spent)
+    {
+        if(!slot.levels.empty())
+            return UploadCompressedTexture(cache, slot, budget, spent);
+
+        // Allocate the texture with the first slice.
+        if(slot.object == 0)
+        {
+            glGenTextures(1, &slot.object);
+            cache.BindTexture(0, GL_TEXTURE_2D, slot.object);
+
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, slot.width, slot.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            SetTextureParameters(1);
+        }
+        else
+        {
+            cache.BindTexture(0, GL_TEXTURE_2D, slot.object);
+        }
+
+        // Copy as many rows as the budget allows, but at least one.
+        std::size_t rowSize = (std::size_t)slot.width * 4;
+        int rows = (int)std::min<std::size_t>(std::max<std::size_t>(budget / rowSize, 1), slot.height - slot.uploadedRows);
+        std::size_t size = rows * rowSize;
+
+        const std::uint8_t* source = slot.data.data() + slot.uploadedRows * rowSize;
+
+        // Orphan the pixel buffer, so the driver can keep transferring previous slices.
+        if(state->pixelBuffer == 0)
+        {
+            glGenBuffers(1, &state->pixelBuffer);
+        }
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, state->pixelBuffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+
+        void* destination = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+        if(destination != nullptr)
+        {
+            std::memcpy(destination, source, size);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, slot.uploadedRows, slot.width, rows, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        else
+        {
+            // Copy from client memory if the buffer can't be mapped.
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, slot.uploadedRows, slot.width, rows, GL_RGBA, GL_UNSIGNED_BYTE, source);
+        }
+
+        slot.uploadedRows += rows;
+        spent += size;
+
+        return slot.uploadedRows == slot.height;
+    }
+
+    // Queues a decoded asset for the thread that uploads it.
+    // Has to be called with the mutex locked.
+    void QueueUpload(Detail::AssetManagerState* state, int identifier)
+    {
+        if(state->uploadThread && state->slots[identifier].type == AssetTypes::Texture)
+        {
+            state->textureQueue.push_back(identifier);
+            state->uploadCondition.notify_one();
+        }
+        else
+        {
+            state->uploadQueue.push_back(identifier);
+        }
+    }
+
+    // Deletes released assets and uploads decoded ones on the render thread.
+    void UploadAssets(StateCache& cache, void* argument)
+    {
+        Detail::AssetManagerState* state = static_cast<Detail::AssetManagerState*>(argument);
+
+        // Delete objects of released assets.
+        std::vector<int> destroyed;
+
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            destroyed.swap(state->destroyQueue);
+        }
+
+        if(!destroyed.empty())
+        {
+            for(int identifier : destroyed)
+            {
+                DeleteObject(state->slots[identifier]);
+            }
+
+            cache.Invalidate();
+
+            std::lock_guard<std::mutex> lock(state->mutex);
+
+            for(int identifier : destroyed)
+            {
+                FreeSlot(state, identifier);
+            }
+        }
+
+        // Upload assets in order until the budget is spent.
+        std::size_t spent = 0;
+
+        while(spent < state->uploadBudget)
+        {
+            int identifier;
+
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+
+                if(state->uploadQueue.empty())
+                    break;
+
+                identifier = state->uploadQueue.front();
+
+                // Drop partially uploaded assets that have been released.
+                if(state->slots[identifier].released)
+                {
+                    DeleteObject(state->slots[identifier]);
+                    cache.Invalidate();
+
+                    state->uploadQueue.pop_front();
+                    FreeSlot(state, identifier);
+                    continue;
+                }
+            }
+
+            // Only the render thread touches data of uploading slots.
+            Detail::AssetSlot& slot = state->slots[identifier];
+            bool done = true;
+
+            if(slot.type == AssetTypes::Texture)
+            {
+                done = UploadTexture(cache, state, slot, state->uploadBudget - spent, spent);
+            }
+            else
+            {
+                slot.object = LinkProgram(state->programCache, slot.filename, slot.data);
+                spent += slot.data.size();
+            }
+
+            if(done)
+            {
+                Utility::ClearContainer(slot.data);
+                Utility::ClearContainer(slot.levels);
+
+                std::lock_guard<std::mutex> lock(state->mutex);
+
+                slot.state = slot.object != 0 ? AssetStates::Ready : AssetStates::Failed;
+                state->pendingCount -= 1;
+                state->uploadQueue.pop_front();
+            }
+        }
+    }
+
+    // Deletes all objects and the state on the render thread.
+    void DestroyResources(StateCache& cache, void* argument)
+    {
+        Detail::AssetManagerState* state = static_cast<Detail::AssetManagerState*>(argument);
+
+        for(Detail::AssetSlot& slot : state->slots)
+        {
+            DeleteObject(slot);
+        }
+
+        glDeleteBuffers(1, &state->pixelBuffer);
+
+        // Deleted objects may have been bound.
+        cache.Invalidate();
+
+        delete state;
+    }
+}
+
+AssetManagerInfo::AssetManagerInfo() :
+    renderer(nullptr),
+    programCache(nullptr),
+    ioThreadCount(2),
+    readChunkSize(64 * 1024),
+    uploadBudget(4 * 1024 * 1024),
+    uploadWindow(nullptr),
+    archive(nullptr)
+{
+}
+
+AssetManager::AssetManager() :
+    m_renderer(nullptr),
+    m_state(nullptr),
+    m_uploadWindow(nullptr),
+    m_initialized(false)
+{
+}
+
+AssetManager::~AssetManager()
+{
+    this->Cleanup();
+}
+
+void AssetManager::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Stop IO threads.
+    {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        m_state->exit = true;
+    }
+
+    m_state->loadCondition.notify_all();
+    m_state->uploadCondition.notify_all();
+
+    for(std::thread& loader : m_loaders)
+    {
+        loader.join();
+    }
+
+    Utility::ClearContainer(m_loaders);
+
+    if(m_uploader.joinable())
+    {
+        m_uploader.join();
+    }
+
+    m_uploadWindow = nullptr;
+
+    // Destroy the state on the render thread after frames that use it.
+    m_renderer->GetCommands().Call(&DestroyResources, m_state);
+    m_state = nullptr;
+
+    m_renderer = nullptr;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool AssetManager::Initialize(const AssetManagerInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.renderer == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid renderer.";
+        return false;
+    }
+
+    if(info.ioThreadCount <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid IO thread count.";
+        return false;
+    }
+
+    if(info.readChunkSize == 0)
+    {
+        LogError() << LogInitializeError() << "Invalid read chunk size.";
+        return false;
+    }
+
+    if(info.uploadBudget == 0)
+    {
+        LogError() << LogInitializeError() << "Invalid upload budget.";
+        return false;
+    }
+
+    m_renderer = info.renderer;
+
+    // Create the shared state and start IO threads.
+    m_state = new Detail::AssetManagerState();
+    m_state->programCache = info.programCache;
+    m_state->archive = info.archive;
+    m_state->readChunkSize = info.readChunkSize;
+    m_state->uploadBudget = info.uploadBudget;
+
+    for(int i = 0; i < info.ioThreadCount; ++i)
+    {
+        m_loaders.emplace_back(&AssetManager::RunLoader, this);
+    }
+
+    // Upload textures on a separate thread through the shared context.
+    if(info.uploadWindow != nullptr && info.uploadWindow->HasUploadContext())
+    {
+        m_uploadWindow = info.uploadWindow;
+        m_state->uploadThread = true;
+        m_uploader = std::thread(&AssetManager::RunUploader, this);
+    }
+
+    // Success!
+    return m_initialized = true;
+}
+
+AssetHandle AssetManager::LoadTexture(const std::string& filename)
+{
+    return this->Load(AssetTypes::Texture, filename);
+}
+
+AssetHandle AssetManager::LoadShader(const std::string& filename)
+{
+    return this->Load(AssetTypes::Shader, filename);
+}
+
+AssetHandle AssetManager::LoadTexture(const std::string& name, int width, int height, std::vector<std::uint8_t>& pixels)
+{
+    if(width <= 0 || height <= 0 || pixels.size() < (std::size_t)width * height * 4)
+    {
+        LogError() << LogLoadError(name) << "Invalid texture size.";
+        return AssetHandle();
+    }
+
+    return this->Load(AssetTypes::Texture, name, &pixels, width, height);
+}
+
+AssetHandle AssetManager::Load(AssetTypes::Type type, const std::string& filename, std::vector<std::uint8_t>* pixels, int width, int height)
+{
+    if(!m_initialized)
+        return AssetHandle();
+
+    std::unique_lock<std::mutex> lock(m_state->mutex);
+
+    // Reference an asset that has already been loaded.
+    auto it = m_state->files.find(filename);
+
+    if(it != m_state->files.end())
+    {
+        Detail::AssetSlot& slot = m_state->slots[it->second];
+
+        if(slot.type != type)
+        {
+            LogError() << LogLoadError(filename) << "Asset has already been loaded with another type.";
+            return AssetHandle();
+        }
+
+        slot.references += 1;
+        return AssetHandle(it->second, slot.version);
+    }
+
+    // Take a free slot and queue the file for loading.
+    int identifier;
+
+    if(m_state->freeSlots.empty())
+    {
+        identifier = (int)m_state->slots.size();
+        m_state->slots.emplace_back();
+    }
+    else
+    {
+        identifier = m_state->freeSlots.back();
+        m_state->freeSlots.pop_back();
+    }
+
+    Detail::AssetSlot& slot = m_state->slots[identifier];
+    slot.type = type;
+    slot.state = AssetStates::Loading;
+    slot.references = 1;
+    slot.filename = filename;
+
+    m_state->files[filename] = identifier;
+    m_state->pendingCount += 1;
+
+    AssetHandle handle(identifier, slot.version);
+
+    // Decoded pixels skip IO threads and go straight to uploading.
+    if(pixels != nullptr)
+    {
+        slot.data.swap(*pixels);
+        slot.width = width;
+        slot.height = height;
+        slot.state = AssetStates::Uploading;
+
+        QueueUpload(m_state, identifier);
+        return handle;
+    }
+
+    m_state->loadQueue.push_back(identifier);
+
+    lock.unlock();
+    m_state->loadCondition.notify_one();
+
+    return handle;
+}
+
+void AssetManager::Release(const AssetHandle& handle)
+{
+    if(!m_initialized)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+
+    int identifier = handle.GetIdentifier();
+
+    if(identifier < 0 || identifier >= (int)m_state->slots.size())
+        return;
+
+    Detail::AssetSlot& slot = m_state->slots[identifier];
+
+    if(slot.version != handle.GetVersion() || slot.state == AssetStates::Invalid || slot.released)
+        return;
+
+    if(--slot.references > 0)
+        return;
+
+    // Invalidate handles and let the thread that owns the slot free it.
+    slot.version += 1;
+    slot.released = true;
+
+    m_state->files.erase(slot.filename);
+
+    switch(slot.state)
+    {
+    case AssetStates::Ready:
+        m_state->destroyQueue.push_back(identifier);
+        break;
+
+    case AssetStates::Failed:
+        FreeSlot(m_state, identifier);
+        break;
+
+    default:
+        // IO threads or the render thread free slots they are working on.
+        break;
+    }
+}
+
+void AssetManager::Update(CommandBuffer& commands)
+{
+    if(!m_initialized)
+        return;
+
+    commands.Call(&UploadAssets, m_state);
+}
+
+AssetStates::Type AssetManager::GetState(const AssetHandle& handle) const
+{
+    if(!m_initialized)
+        return AssetStates::Invalid;
+
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+
+    int identifier = handle.GetIdentifier();
+
+    if(identifier < 0 || identifier >= (int)m_state->slots.size())
+        return AssetStates::Invalid;
+
+    const Detail::AssetSlot& slot = m_state->slots[identifier];
+
+    if(slot.version != handle.GetVersion() || slot.released)
+        return AssetStates::Invalid;
+
+    return slot.state;
+}
+
+bool AssetManager::IsReady(const AssetHandle& handle) const
+{
+    return this->GetState(handle) == AssetStates::Ready;
+}
+
+GLuint AssetManager::GetTexture(const AssetHandle& handle) const
+{
+    return this->GetObject(handle, AssetTypes::Texture);
+}
+
+GLuint AssetManager::GetProgram(const AssetHandle& handle) const
+{
+    return this->GetObject(handle, AssetTypes::Shader);
+}
+
+GLuint AssetManager::GetObject(const AssetHandle& handle, AssetTypes::Type type) const
+{
+    if(!m_initialized)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+
+    int identifier = handle.GetIdentifier();
+
+    if(identifier < 0 || identifier >= (int)m_state->slots.size())
+        return 0;
+
+    const Detail::AssetSlot& slot = m_state->slots[identifier];
+
+    if(slot.version != handle.GetVersion() || slot.released || slot.type != type || slot.state != AssetStates::Ready)
+        return 0;
+
+    return slot.object;
+}
+
+int AssetManager::GetPendingCount() const
+{
+    if(!m_initialized)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    return m_state->pendingCount;
+}
+
+void AssetManager::RunLoader()
+{
+    Detail::AssetManagerState* state = m_state;
+
+    while(true)
+    {
+        int identifier;
+        AssetTypes::Type type;
+        std::string filename;
+
+        // Take the next queued asset.
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->loadCondition.wait(lock, [state]() { return state->exit || !state->loadQueue.empty(); });
+
+            if(state->exit)
+                break;
+
+            identifier = state->loadQueue.front();
+            state->loadQueue.pop_front();
+
+            Detail::AssetSlot& slot = state->slots[identifier];
+
+            if(slot.released)
+            {
+                FreeSlot(state, identifier);
+                continue;
+            }
+
+            type = slot.type;
+            filename = slot.filename;
+        }
+
+        // Read and decode the file without holding the lock.
+        // Compressed textures are only parsed, with levels pointing into their content.
+        ByteList content;
+        ByteList data;
+        int width = 0;
+        int height = 0;
+
+        CompressedImage compressed;
+        const std::uint8_t* mapped = nullptr;
+        std::size_t mappedSize = 0;
+
+        bool success = ReadAsset(state, type, filename, content, mapped, mappedSize);
+
+        if(success)
+        {
+            if(mapped != nullptr)
+            {
+                success = ParseCompressedTexture(filename, mapped, mappedSize, compressed);
+            }
+            else if(type == AssetTypes::Texture && CompressedTexture::IsContainer(content.data(), content.size()))
+            {
+                success = ParseCompressedTexture(filename, content.data(), content.size(), compressed);
+                data.swap(content);
+            }
+            else if(type == AssetTypes::Texture)
+            {
+                success = Targa::Decode(filename, content, data, width, height);
+            }
+            else if(content.empty())
+            {
+                LogError() << LogLoadError(filename) << "Empty shader source.";
+                success = false;
+            }
+            else
+            {
+                data.swap(content);
+            }
+        }
+
+        // Hand the decoded asset over to the render thread.
+        std::lock_guard<std::mutex> lock(state->mutex);
+
+        Detail::AssetSlot& slot = state->slots[identifier];
+
+        if(slot.released)
+        {
+            FreeSlot(state, identifier);
+            continue;
+        }
+
+        if(!success)
+        {
+            slot.state = AssetStates::Failed;
+            state->pendingCount -= 1;
+            continue;
+        }
+
+        // Swapping keeps levels pointing into the same content.
+        slot.data.swap(data);
+        slot.width = width;
+        slot.height = height;
+        slot.state = AssetStates::Uploading;
+
+        if(!compressed.levels.empty())
+        {
+            slot.width = compressed.levels.front().width;
+            slot.height = compressed.levels.front().height;
+            slot.format = compressed.format;
+            slot.levels.swap(compressed.levels);
+            slot.uploadedLevels = 0;
+        }
+
+        QueueUpload(state, identifier);
+    }
+}
+
+void AssetManager::RunUploader()
+{
+    Detail::AssetManagerState* state = m_state;
+
+    // Uploaded textures waiting for their fences.
+    std::vector<std::pair<int, GLsync>> fenced;
+
+    m_uploadWindow->MakeUploadContextCurrent();
+
+    while(true)
+    {
+        int identifier;
+
+        // Take the next texture, polling fences while waiting for it.
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+
+            auto hasWork = [state]() { return state->exit || !state->textureQueue.empty(); };
+
+            if(fenced.empty())
+            {
+                state->uploadCondition.wait(lock, hasWork);
+            }
+            else
+            {
+                state->uploadCondition.wait_for(lock, std::chrono::milliseconds(1), hasWork);
+            }
+
+            if(state->exit)
+                break;
+
+            identifier = -1;
+
+            if(!state->textureQueue.empty())
+            {
+                identifier = state->textureQueue.front();
+                state->textureQueue.pop_front();
+
+                if(state->slots[identifier].released)
+                {
+                    FreeSlot(state, identifier);
+                    identifier = -1;
+                }
+            }
+        }
+
+        // Upload the whole texture, as this thread has no frame to hold up.
+        // Only the upload thread touches data of uploading textures.
+        if(identifier != -1)
+        {
+            Detail::AssetSlot& slot = state->slots[identifier];
+
+            glGenTextures(1, &slot.object);
+            glBindTexture(GL_TEXTURE_2D, slot.object);
+
+            if(!slot.levels.empty())
+            {
+                SetTextureParameters((int)slot.levels.size());
+
+                while(slot.uploadedLevels < (int)slot.levels.size())
+                {
+                    UploadCompressedLevel(slot);
+                }
+            }
+            else
+            {
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, slot.width, slot.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, slot.data.data());
+                SetTextureParameters(1);
+            }
+
+            glBindTexture(GL_TEXTURE_2D, 0);
+
+            // Flush, so the fence is signaled without waiting on it.
+            fenced.emplace_back(identifier, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+            glFlush();
+
+            Utility::ClearContainer(slot.data);
+            Utility::ClearContainer(slot.levels);
+        }
+
+        // Make textures with signaled fences ready.
+        for(std::size_t i = 0; i < fenced.size();)
+        {
+            GLenum result = glClientWaitSync(fenced[i].second, 0, 0);
+
+            if(result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED && result != GL_WAIT_FAILED)
+            {
+                ++i;
+                continue;
+            }
+
+            glDeleteSync(fenced[i].second);
+
+            int texture = fenced[i].first;
+            fenced[i] = fenced.back();
+            fenced.pop_back();
+
+            std::lock_guard<std::mutex> lock(state->mutex);
+
+            Detail::AssetSlot& slot = state->slots[texture];
+
+            if(slot.released || result == GL_WAIT_FAILED)
+            {
+                DeleteObject(slot);
+            }
+
+            if(slot.released)
+            {
+                FreeSlot(state, texture);
+                continue;
+            }
+
+            slot.state = slot.object != 0 ? AssetStates::Ready : AssetStates::Failed;
+            state->pendingCount -= 1;
+        }
+    }
+
+    // Textures with pending fences are deleted with the state.
+    for(const auto& pair : fenced)
+    {
+        glDeleteSync(pair.second);
+    }
+
+    glFinish();
+
+    m_uploadWindow->ReleaseUploadContext();
+}
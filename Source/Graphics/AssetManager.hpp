@@ -0,0 +1,200 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/Archive.hpp"
+#include "AssetHandle.hpp"
+#include "Renderer.hpp"
+#include "ProgramCache.hpp"
+
+//
+// Asset Manager
+//
+//  Loads textures and shaders without blocking the calling thread. Files are
+//  read in chunks and decoded on IO threads, after which the render thread
+//  uploads them in time slices limited by a byte budget per frame. Texture
+//  rows are copied through a pixel buffer, so the driver can transfer them
+//  asynchronously. Each frame records its upload slice into the renderer's
+//  command buffer when Update() is called.
+//
+//  If the window has a shared upload context, textures are uploaded whole on
+//  a separate upload thread instead, followed by a fence. Textures become
+//  ready once their fence has been signaled, so the render thread never
+//  waits for their transfers. Shaders are still linked on the render thread.
+//
+//  Loads return handles right away and assets can be used once they are
+//  ready. Loading the same file again returns the handle of the loaded asset
+//  and counts a reference, which has to be released as well. Released assets
+//  are deleted on the render thread and their handles become invalid.
+//
+//  Textures are read from uncompressed or run length encoded TGA files with
+//  24 or 32 bits per pixel, or from DDS and KTX files with block compressed
+//  levels, which are uploaded as they are stored without decoding them.
+//  Files are read from an archive when it has entries for them. Compressed
+//  textures stored in it without LZ4 compression are uploaded in place from
+//  the mapped archive, without being copied first. Compressed textures are
+//  uploaded in whole levels, with at least one level per frame.
+//
+//  Shaders are read from a single GLSL file that is compiled once for each
+//  stage with VERTEX_SHADER or FRAGMENT_SHADER defined after its version
+//  directive. Textures can also be uploaded from pixels decoded or generated
+//  in memory.
+//
+//  Example usage:
+//      Graphics::AssetManagerInfo info;
+//      info.renderer = &renderer;
+//
+//      Graphics::AssetManager assets;
+//      assets.Initialize(info);
+//
+//      Graphics::AssetHandle texture = assets.LoadTexture("Data/Player.tga");
+//
+//      while(window.IsOpen())
+//      {
+//          assets.Update(renderer.GetCommands());
+//          sprite.texture = assets.GetTexture(texture);
+//          /* ... */
+//      }
+//
+//      assets.Release(texture);
+//
+
+namespace Graphics
+{
+    // Asset types.
+    struct AssetTypes
+    {
+        enum Type
+        {
+            Texture,
+            Shader,
+        };
+    };
+
+    // Asset states.
+    struct AssetStates
+    {
+        enum Type
+        {
+            Invalid,
+            Loading,
+            Uploading,
+            Ready,
+            Failed,
+        };
+    };
+
+    // Implementation details.
+    namespace Detail
+    {
+        struct AssetManagerState;
+    }
+
+    // Asset manager initialization struct.
+    struct AssetManagerInfo
+    {
+        // Renderer that uploads assets.
+        Renderer* renderer;
+
+        // Optional cache of program binaries.
+        ProgramCache* programCache;
+
+        // Number of threads that read and decode files.
+        int ioThreadCount;
+
+        // Size of chunks that files are read in.
+        std::size_t readChunkSize;
+
+        // Maximum number of bytes uploaded in a frame.
+        // At least a single texture row or shader is uploaded per frame.
+        std::size_t uploadBudget;
+
+        // Optional window whose upload context is used to upload textures on a separate thread.
+        // Textures are uploaded on the render thread if the window has no upload context.
+        System::Window* uploadWindow;
+
+        // Optional archive that files are read from before the file system.
+        // Has to stay open until the asset manager is cleaned up.
+        const Archive* archive;
+
+        AssetManagerInfo();
+    };
+
+    // Asset manager class.
+    class AssetManager : private NonCopyable
+    {
+    public:
+        AssetManager();
+        ~AssetManager();
+
+        // Restores instance to its original state.
+        // Must be called before the renderer is cleaned up.
+        void Cleanup();
+
+        // Initializes the asset manager and starts IO threads.
+        bool Initialize(const AssetManagerInfo& info);
+
+        // Starts loading assets and returns their handles.
+        AssetHandle LoadTexture(const std::string& filename);
+        AssetHandle LoadShader(const std::string& filename);
+
+        // Starts uploading a texture from decoded RGBA pixels with rows starting
+        // at the bottom, such as a texture atlas packed at load time. Pixels are
+        // taken over and the name is referenced like a filename.
+        AssetHandle LoadTexture(const std::string& name, int width, int height, std::vector<std::uint8_t>& pixels);
+
+        // Releases a reference to an asset.
+        void Release(const AssetHandle& handle);
+
+        // Records uploads of the frame.
+        // Has to be called once per submitted frame.
+        void Update(CommandBuffer& commands);
+
+        // Gets the state of an asset.
+        AssetStates::Type GetState(const AssetHandle& handle) const;
+
+        // Checks if an asset is ready to be used.
+        bool IsReady(const AssetHandle& handle) const;
+
+        // Gets the texture or program name of a ready asset, or zero otherwise.
+        GLuint GetTexture(const AssetHandle& handle) const;
+        GLuint GetProgram(const AssetHandle& handle) const;
+
+        // Gets the number of assets that are not ready or failed yet.
+        int GetPendingCount() const;
+
+    private:
+        // Type declarations.
+        typedef std::vector<std::thread> ThreadList;
+
+    private:
+        // Starts loading an asset or references a loaded one.
+        // Given pixels are uploaded without reading the file.
+        AssetHandle Load(AssetTypes::Type type, const std::string& filename, std::vector<std::uint8_t>* pixels = nullptr, int width = 0, int height = 0);
+
+        // Gets the name of a ready asset of a type.
+        GLuint GetObject(const AssetHandle& handle, AssetTypes::Type type) const;
+
+        // Main function of IO threads.
+        void RunLoader();
+
+        // Main function of the upload thread.
+        void RunUploader();
+
+    private:
+        // Renderer that uploads assets.
+        Renderer* m_renderer;
+
+        // State shared with IO threads and the render thread.
+        Detail::AssetManagerState* m_state;
+
+        // Threads that read and decode files.
+        ThreadList m_loaders;
+
+        // Thread that uploads textures through the upload context.
+        System::Window* m_uploadWindow;
+        std::thread m_uploader;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,519 @@
+#include "Precompiled.hpp"
+#include "CommandBuffer.hpp"
+using namespace Graphics;
+
+namespace
+{
+    // Header written before the arguments of every command.
+    struct CommandHeader
+    {
+        CommandTypes::Type type;
+        std::uint8_t padding;
+        std::uint16_t size;
+    };
+
+    // Command arguments.
+    struct ClearArguments
+    {
+        float color[4];
+        float depth;
+        GLbitfield mask;
+    };
+
+    struct ViewportArguments
+    {
+        GLint x;
+        GLint y;
+        GLsizei width;
+        GLsizei height;
+    };
+
+    struct CapabilityArguments
+    {
+        GLenum capability;
+    };
+
+    struct BlendFunctionArguments
+    {
+        GLenum source;
+        GLenum destination;
+    };
+
+    struct ObjectArguments
+    {
+        GLuint object;
+    };
+
+    struct TextureArguments
+    {
+        GLuint unit;
+        GLenum target;
+        GLuint texture;
+    };
+
+    struct IndirectTextureArguments
+    {
+        GLuint unit;
+        GLenum target;
+        const GLuint* texture;
+    };
+
+    struct IndirectUniformBufferArguments
+    {
+        GLuint index;
+        const BufferRange* range;
+        GLintptr offset;
+        GLsizeiptr size;
+    };
+
+    struct UniformArguments
+    {
+        GLint location;
+        std::uint8_t type;
+    };
+
+    struct DrawArguments
+    {
+        GLenum mode;
+        GLint first;
+        GLsizei count;
+    };
+
+    struct DrawIndexedArguments
+    {
+        GLenum mode;
+        GLsizei count;
+        GLenum indexType;
+        std::uint64_t indexOffset;
+    };
+
+    struct TimerArguments
+    {
+        FrameProfiler* profiler;
+        const char* name;
+    };
+
+    struct CallArguments
+    {
+        CommandBuffer::CallFunction function;
+        void* argument;
+    };
+
+    // Reads a value from unaligned memory.
+    template<typename Type>
+    Type ReadValue(const std::uint8_t* data)
+    {
+        Type value;
+        std::memcpy(&value, data, sizeof(Type));
+        return value;
+    }
+}
+
+CommandBuffer::CommandBuffer() :
+    m_commandCount(0)
+{
+}
+
+void CommandBuffer::Reset()
+{
+    m_buffer.clear();
+    m_commandCount = 0;
+}
+
+void CommandBuffer::Cleanup()
+{
+    Utility::ClearContainer(m_buffer);
+    m_commandCount = 0;
+}
+
+template<typename Arguments>
+void CommandBuffer::Record(CommandTypes::Type type, const Arguments& arguments, const void* data, std::size_t dataSize)
+{
+    static_assert(std::is_trivially_copyable<Arguments>::value, "Command arguments must be trivially copyable!");
+
+    Assert(sizeof(Arguments) + dataSize <= std::numeric_limits<std::uint16_t>::max());
+
+    CommandHeader header;
+    header.type = type;
+    header.padding = 0;
+    header.size = (std::uint16_t)(sizeof(Arguments) + dataSize);
+
+    // Append the command to the end of the buffer.
+    std::size_t offset = m_buffer.size();
+    m_buffer.resize(offset + sizeof(CommandHeader) + header.size);
+
+    std::uint8_t* destination = m_buffer.data() + offset;
+    std::memcpy(destination, &header, sizeof(CommandHeader));
+    destination += sizeof(CommandHeader);
+
+    std::memcpy(destination, &arguments, sizeof(Arguments));
+    destination += sizeof(Arguments);
+
+    if(dataSize != 0)
+    {
+        std::memcpy(destination, data, dataSize);
+    }
+
+    m_commandCount += 1;
+}
+
+void CommandBuffer::Clear(const glm::vec4& color, float depth, GLbitfield mask)
+{
+    ClearArguments arguments;
+    arguments.color[0] = color.r;
+    arguments.color[1] = color.g;
+    arguments.color[2] = color.b;
+    arguments.color[3] = color.a;
+    arguments.depth = depth;
+    arguments.mask = mask;
+
+    this->Record(CommandTypes::Clear, arguments);
+}
+
+void CommandBuffer::SetViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    ViewportArguments arguments;
+    arguments.x = x;
+    arguments.y = y;
+    arguments.width = width;
+    arguments.height = height;
+
+    this->Record(CommandTypes::Viewport, arguments);
+}
+
+void CommandBuffer::Enable(GLenum capability)
+{
+    CapabilityArguments arguments;
+    arguments.capability = capability;
+
+    this->Record(CommandTypes::Enable, arguments);
+}
+
+void CommandBuffer::Disable(GLenum capability)
+{
+    CapabilityArguments arguments;
+    arguments.capability = capability;
+
+    this->Record(CommandTypes::Disable, arguments);
+}
+
+void CommandBuffer::SetBlendFunction(GLenum source, GLenum destination)
+{
+    BlendFunctionArguments arguments;
+    arguments.source = source;
+    arguments.destination = destination;
+
+    this->Record(CommandTypes::BlendFunction, arguments);
+}
+
+void CommandBuffer::BindProgram(GLuint program)
+{
+    ObjectArguments arguments;
+    arguments.object = program;
+
+    this->Record(CommandTypes::BindProgram, arguments);
+}
+
+void CommandBuffer::BindVertexArray(GLuint vertexArray)
+{
+    ObjectArguments arguments;
+    arguments.object = vertexArray;
+
+    this->Record(CommandTypes::BindVertexArray, arguments);
+}
+
+void CommandBuffer::BindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    TextureArguments arguments;
+    arguments.unit = unit;
+    arguments.target = target;
+    arguments.texture = texture;
+
+    this->Record(CommandTypes::BindTexture, arguments);
+}
+
+void CommandBuffer::BindTextureIndirect(GLuint unit, GLenum target, const GLuint* texture)
+{
+    Assert(texture != nullptr, "Texture name address is null!");
+
+    IndirectTextureArguments arguments;
+    arguments.unit = unit;
+    arguments.target = target;
+    arguments.texture = texture;
+
+    this->Record(CommandTypes::BindTextureIndirect, arguments);
+}
+
+void CommandBuffer::BindUniformBufferIndirect(GLuint index, const BufferRange* range, GLintptr offset, GLsizeiptr size)
+{
+    Assert(range != nullptr, "Buffer range address is null!");
+
+    IndirectUniformBufferArguments arguments;
+    arguments.index = index;
+    arguments.range = range;
+    arguments.offset = offset;
+    arguments.size = size;
+
+    this->Record(CommandTypes::BindUniformBufferIndirect, arguments);
+}
+
+void CommandBuffer::RecordUniform(GLint location, UniformTypes::Type type, const void* data, std::size_t size)
+{
+    UniformArguments arguments;
+    arguments.location = location;
+    arguments.type = type;
+
+    this->Record(CommandTypes::Uniform, arguments, data, size);
+}
+
+void CommandBuffer::SetUniform(GLint location, int value)
+{
+    this->RecordUniform(location, UniformTypes::Int, &value, sizeof(value));
+}
+
+void CommandBuffer::SetUniform(GLint location, float value)
+{
+    this->RecordUniform(location, UniformTypes::Float, &value, sizeof(value));
+}
+
+void CommandBuffer::SetUniform(GLint location, const glm::vec2& value)
+{
+    this->RecordUniform(location, UniformTypes::Vec2, &value[0], sizeof(value));
+}
+
+void CommandBuffer::SetUniform(GLint location, const glm::vec3& value)
+{
+    this->RecordUniform(location, UniformTypes::Vec3, &value[0], sizeof(value));
+}
+
+void CommandBuffer::SetUniform(GLint location, const glm::vec4& value)
+{
+    this->RecordUniform(location, UniformTypes::Vec4, &value[0], sizeof(value));
+}
+
+void CommandBuffer::SetUniform(GLint location, const glm::mat4& value)
+{
+    this->RecordUniform(location, UniformTypes::Mat4, &value[0][0], sizeof(value));
+}
+
+void CommandBuffer::Draw(GLenum mode, GLint first, GLsizei count)
+{
+    DrawArguments arguments;
+    arguments.mode = mode;
+    arguments.first = first;
+    arguments.count = count;
+
+    this->Record(CommandTypes::Draw, arguments);
+}
+
+void CommandBuffer::DrawIndexed(GLenum mode, GLsizei count, GLenum indexType, std::size_t indexOffset)
+{
+    DrawIndexedArguments arguments;
+    arguments.mode = mode;
+    arguments.count = count;
+    arguments.indexType = indexType;
+    arguments.indexOffset = indexOffset;
+
+    this->Record(CommandTypes::DrawIndexed, arguments);
+}
+
+void CommandBuffer::BeginGpuTimer(FrameProfiler* profiler, const char* name)
+{
+    if(profiler == nullptr)
+        return;
+
+    TimerArguments arguments;
+    arguments.profiler = profiler;
+    arguments.name = name;
+
+    this->Record(CommandTypes::BeginTimer, arguments);
+}
+
+void CommandBuffer::EndGpuTimer(FrameProfiler* profiler)
+{
+    if(profiler == nullptr)
+        return;
+
+    TimerArguments arguments;
+    arguments.profiler = profiler;
+    arguments.name = nullptr;
+
+    this->Record(CommandTypes::EndTimer, arguments);
+}
+
+void CommandBuffer::Call(CallFunction function, void* argument)
+{
+    Assert(function != nullptr);
+
+    CallArguments arguments;
+    arguments.function = function;
+    arguments.argument = argument;
+
+    this->Record(CommandTypes::Call, arguments);
+}
+
+void CommandBuffer::Execute(StateCache& state) const
+{
+    const std::uint8_t* data = m_buffer.data();
+    const std::uint8_t* end = data + m_buffer.size();
+
+    while(data != end)
+    {
+        CommandHeader header = ReadValue<CommandHeader>(data);
+        const std::uint8_t* arguments = data + sizeof(CommandHeader);
+
+        switch(header.type)
+        {
+        case CommandTypes::Clear:
+            {
+                ClearArguments clear = ReadValue<ClearArguments>(arguments);
+                glClearColor(clear.color[0], clear.color[1], clear.color[2], clear.color[3]);
+                glClearDepth(clear.depth);
+                glClear(clear.mask);
+            }
+            break;
+
+        case CommandTypes::Viewport:
+            {
+                ViewportArguments viewport = ReadValue<ViewportArguments>(arguments);
+                state.SetViewport(viewport.x, viewport.y, viewport.width, viewport.height);
+            }
+            break;
+
+        case CommandTypes::Enable:
+            state.Enable(ReadValue<CapabilityArguments>(arguments).capability);
+            break;
+
+        case CommandTypes::Disable:
+            state.Disable(ReadValue<CapabilityArguments>(arguments).capability);
+            break;
+
+        case CommandTypes::BlendFunction:
+            {
+                BlendFunctionArguments blend = ReadValue<BlendFunctionArguments>(arguments);
+                state.SetBlendFunction(blend.source, blend.destination);
+            }
+            break;
+
+        case CommandTypes::BindProgram:
+            state.UseProgram(ReadValue<ObjectArguments>(arguments).object);
+            break;
+
+        case CommandTypes::BindVertexArray:
+            state.BindVertexArray(ReadValue<ObjectArguments>(arguments).object);
+            break;
+
+        case CommandTypes::BindTexture:
+            {
+                TextureArguments texture = ReadValue<TextureArguments>(arguments);
+                state.BindTexture(texture.unit, texture.target, texture.texture);
+            }
+            break;
+
+        case CommandTypes::BindTextureIndirect:
+            {
+                IndirectTextureArguments texture = ReadValue<IndirectTextureArguments>(arguments);
+                state.BindTexture(texture.unit, texture.target, *texture.texture);
+            }
+            break;
+
+        case CommandTypes::BindUniformBufferIndirect:
+            {
+                IndirectUniformBufferArguments uniformBuffer = ReadValue<IndirectUniformBufferArguments>(arguments);
+                state.BindUniformBuffer(uniformBuffer.index, uniformBuffer.range->buffer, uniformBuffer.range->offset + uniformBuffer.offset, uniformBuffer.size);
+            }
+            break;
+
+        case CommandTypes::Uniform:
+            {
+                UniformArguments uniform = ReadValue<UniformArguments>(arguments);
+                const std::uint8_t* value = arguments + sizeof(UniformArguments);
+
+                // Copy the value, as it is not aligned within the buffer.
+                float values[16];
+                std::memcpy(values, value, header.size - sizeof(UniformArguments));
+
+                switch(uniform.type)
+                {
+                case UniformTypes::Int:
+                    glUniform1i(uniform.location, ReadValue<int>(value));
+                    break;
+
+                case UniformTypes::Float:
+                    glUniform1fv(uniform.location, 1, values);
+                    break;
+
+                case UniformTypes::Vec2:
+                    glUniform2fv(uniform.location, 1, values);
+                    break;
+
+                case UniformTypes::Vec3:
+                    glUniform3fv(uniform.location, 1, values);
+                    break;
+
+                case UniformTypes::Vec4:
+                    glUniform4fv(uniform.location, 1, values);
+                    break;
+
+                case UniformTypes::Mat4:
+                    glUniformMatrix4fv(uniform.location, 1, GL_FALSE, values);
+                    break;
+                }
+            }
+            break;
+
+        case CommandTypes::Draw:
+            {
+                DrawArguments draw = ReadValue<DrawArguments>(arguments);
+                glDrawArrays(draw.mode, draw.first, draw.count);
+            }
+            break;
+
+        case CommandTypes::DrawIndexed:
+            {
+                DrawIndexedArguments draw = ReadValue<DrawIndexedArguments>(arguments);
+                glDrawElements(draw.mode, draw.count, draw.indexType, reinterpret_cast<const void*>((std::uintptr_t)draw.indexOffset));
+            }
+            break;
+
+        case CommandTypes::BeginTimer:
+            {
+                TimerArguments timer = ReadValue<TimerArguments>(arguments);
+                timer.profiler->BeginGpuTimer(timer.name);
+            }
+            break;
+
+        case CommandTypes::EndTimer:
+            ReadValue<TimerArguments>(arguments).profiler->EndGpuTimer();
+            break;
+
+        case CommandTypes::Call:
+            {
+                CallArguments call = ReadValue<CallArguments>(arguments);
+                call.function(state, call.argument);
+            }
+            break;
+
+        default:
+            Assert(false, "Unknown render command!");
+            break;
+        }
+
+        data = arguments + header.size;
+    }
+}
+
+std::size_t CommandBuffer::GetCommandCount() const
+{
+    return m_commandCount;
+}
+
+std::size_t CommandBuffer::GetSize() const
+{
+    return m_buffer.size();
+}
+
+bool CommandBuffer::IsEmpty() const
+{
+    return m_commandCount == 0;
+}
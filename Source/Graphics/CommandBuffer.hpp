@@ -0,0 +1,184 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "StateCache.hpp"
+#include "FrameProfiler.hpp"
+
+//
+// Command Buffer
+//
+//  Records render commands into a linear block of memory, so a frame can be
+//  built on one thread and executed on the thread that owns the context.
+//  Each command is a small header followed by its arguments, and uniform
+//  values are stored inline with only as many bytes as they use. Memory is
+//  kept between frames, so recording does not allocate once the buffer has
+//  grown to the size of a frame.
+//
+//  State commands go through a state cache, which skips redundant calls.
+//  Commands only refer to OpenGL objects by their names. Objects have to be
+//  created on the thread that executes the commands, which can be done by
+//  recording a call of a function that runs in order with other commands.
+//
+//  Example usage:
+//      Graphics::CommandBuffer commands;
+//      commands.Clear(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+//      commands.BindProgram(program);
+//      commands.SetUniform(location, transform);
+//      commands.BindVertexArray(vertexArray);
+//      commands.Draw(GL_TRIANGLES, 0, 3);
+//
+//      commands.Execute(stateCache);
+//      commands.Reset();
+//
+
+namespace Graphics
+{
+    // Types of recorded commands.
+    struct CommandTypes
+    {
+        typedef std::uint8_t Type;
+
+        enum Command : Type
+        {
+            Clear,
+            Viewport,
+            Enable,
+            Disable,
+            BlendFunction,
+            BindProgram,
+            BindVertexArray,
+            BindTexture,
+            BindTextureIndirect,
+            BindUniformBufferIndirect,
+            Uniform,
+            Draw,
+            DrawIndexed,
+            BeginTimer,
+            EndTimer,
+            Call,
+        };
+    };
+
+    // Range of a buffer that is only known when commands are executed.
+    struct BufferRange
+    {
+        BufferRange() :
+            buffer(0),
+            offset(0)
+        {
+        }
+
+        GLuint buffer;
+        GLintptr offset;
+    };
+
+    // Command buffer class.
+    class CommandBuffer : private NonCopyable
+    {
+    public:
+        CommandBuffer();
+
+        // Removes all recorded commands and keeps the memory.
+        void Reset();
+
+        // Frees the memory of the buffer.
+        void Cleanup();
+
+        // Records clearing of the framebuffer.
+        void Clear(const glm::vec4& color, float depth = 1.0f, GLbitfield mask = GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // Records setting of the viewport.
+        void SetViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+        // Records enabling and disabling of a capability.
+        void Enable(GLenum capability);
+        void Disable(GLenum capability);
+
+        // Records setting of the blend function.
+        void SetBlendFunction(GLenum source, GLenum destination);
+
+        // Records binding of a program.
+        void BindProgram(GLuint program);
+
+        // Records binding of a vertex array.
+        void BindVertexArray(GLuint vertexArray);
+
+        // Records binding of a texture to a texture unit.
+        void BindTexture(GLuint unit, GLenum target, GLuint texture);
+
+        // Records binding of a texture whose name is read when the command is executed,
+        // such as a render target that is created on the executing thread.
+        // The name has to stay at its address until then.
+        void BindTextureIndirect(GLuint unit, GLenum target, const GLuint* texture);
+
+        // Records binding of a range within a buffer range to a uniform buffer binding.
+        // The buffer range is read when the command is executed and has to stay at its address until then.
+        void BindUniformBufferIndirect(GLuint index, const BufferRange* range, GLintptr offset, GLsizeiptr size);
+
+        // Records setting of a uniform of the bound program.
+        void SetUniform(GLint location, int value);
+        void SetUniform(GLint location, float value);
+        void SetUniform(GLint location, const glm::vec2& value);
+        void SetUniform(GLint location, const glm::vec3& value);
+        void SetUniform(GLint location, const glm::vec4& value);
+        void SetUniform(GLint location, const glm::mat4& value);
+
+        // Records drawing of vertices.
+        void Draw(GLenum mode, GLint first, GLsizei count);
+
+        // Records drawing of indexed vertices.
+        void DrawIndexed(GLenum mode, GLsizei count, GLenum indexType, std::size_t indexOffset);
+
+        // Records the beginning and the end of a pass measured on the GPU.
+        // Does nothing if the profiler is null.
+        void BeginGpuTimer(FrameProfiler* profiler, const char* name);
+        void EndGpuTimer(FrameProfiler* profiler);
+
+        // Records a call of a function on the executing thread.
+        // Function receives the state cache of the execution.
+        typedef void (*CallFunction)(StateCache& state, void* argument);
+        void Call(CallFunction function, void* argument);
+
+        // Executes recorded commands in the order they were recorded.
+        // Has to be called on a thread with a current context.
+        void Execute(StateCache& state) const;
+
+        // Gets the number of recorded commands.
+        std::size_t GetCommandCount() const;
+
+        // Gets the size of recorded commands in bytes.
+        std::size_t GetSize() const;
+
+        // Checks if there are no recorded commands.
+        bool IsEmpty() const;
+
+    private:
+        // Types of uniform values.
+        struct UniformTypes
+        {
+            typedef std::uint8_t Type;
+
+            enum Uniform : Type
+            {
+                Int,
+                Float,
+                Vec2,
+                Vec3,
+                Vec4,
+                Mat4,
+            };
+        };
+
+        // Records a command with its arguments.
+        template<typename Arguments>
+        void Record(CommandTypes::Type type, const Arguments& arguments, const void* data = nullptr, std::size_t dataSize = 0);
+
+        // Records a uniform value.
+        void RecordUniform(GLint location, UniformTypes::Type type, const void* data, std::size_t size);
+
+    private:
+        // Recorded commands.
+        std::vector<std::uint8_t> m_buffer;
+        std::size_t m_commandCount;
+    };
+}
@@ -0,0 +1,664 @@
+#include "Precompiled.hpp"
+#include "CompressedTexture.hpp"
+#include "Targa.hpp"
+using namespace Graphics;
+
+namespace
+{
+    // Log message strings.
+    #define LogParseError(filename) "Failed to parse \"" << filename << "\" compressed texture! "
+    #define LogConvertError(filename) "Failed to convert \"" << filename << "\" texture! "
+
+    // Identifier of DDS files.
+    const std::uint32_t DdsMagic = 0x20534444; // "DDS "
+
+    // Four character codes of DDS pixel formats.
+    const std::uint32_t FourCCDxt1 = 0x31545844; // "DXT1"
+    const std::uint32_t FourCCDxt5 = 0x35545844; // "DXT5"
+    const std::uint32_t FourCCDx10 = 0x30315844; // "DX10"
+
+    // DDS header flags.
+    const std::uint32_t DdsCaps = 0x1;
+    const std::uint32_t DdsHeight = 0x2;
+    const std::uint32_t DdsWidth = 0x4;
+    const std::uint32_t DdsPixelFormat = 0x1000;
+    const std::uint32_t DdsMipmapCount = 0x20000;
+    const std::uint32_t DdsLinearSize = 0x80000;
+    const std::uint32_t DdsFourCC = 0x4;
+    const std::uint32_t DdsCapsComplex = 0x8;
+    const std::uint32_t DdsCapsTexture = 0x1000;
+    const std::uint32_t DdsCapsMipmap = 0x400000;
+
+    // DXGI formats of DDS files with the extended header.
+    const std::uint32_t DxgiBC1 = 71;
+    const std::uint32_t DxgiBC1Srgb = 72;
+    const std::uint32_t DxgiBC3 = 77;
+    const std::uint32_t DxgiBC3Srgb = 78;
+    const std::uint32_t DxgiBC7 = 98;
+    const std::uint32_t DxgiBC7Srgb = 99;
+
+    // DDS pixel format.
+    struct DdsPixelFormatHeader
+    {
+        std::uint32_t size;
+        std::uint32_t flags;
+        std::uint32_t fourCC;
+        std::uint32_t bitCount;
+        std::uint32_t masks[4];
+    };
+
+    // DDS file header following the identifier.
+    struct DdsHeader
+    {
+        std::uint32_t size;
+        std::uint32_t flags;
+        std::uint32_t height;
+        std::uint32_t width;
+        std::uint32_t linearSize;
+        std::uint32_t depth;
+        std::uint32_t mipmapCount;
+        std::uint32_t reserved[11];
+        DdsPixelFormatHeader pixelFormat;
+        std::uint32_t caps[4];
+        std::uint32_t reserved2;
+    };
+
+    // Extended DDS header of DX10 files.
+    struct DdsExtendedHeader
+    {
+        std::uint32_t format;
+        std::uint32_t dimension;
+        std::uint32_t flags;
+        std::uint32_t arraySize;
+        std::uint32_t flags2;
+    };
+
+    // Identifier of KTX files.
+    const std::uint8_t KtxIdentifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+    // Value of the endianness field written on the same endianness.
+    const std::uint32_t KtxEndianness = 0x04030201;
+
+    // KTX file header following the identifier.
+    struct KtxHeader
+    {
+        std::uint32_t endianness;
+        std::uint32_t type;
+        std::uint32_t typeSize;
+        std::uint32_t format;
+        std::uint32_t internalFormat;
+        std::uint32_t baseInternalFormat;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint32_t depth;
+        std::uint32_t arrayElementCount;
+        std::uint32_t faceCount;
+        std::uint32_t levelCount;
+        std::uint32_t keyValueSize;
+    };
+
+    // Size of a decoded pixel.
+    const std::size_t PixelSize = 4;
+
+    // Gets the size of a level in blocks.
+    std::size_t GetLevelSize(int width, int height, std::size_t blockSize)
+    {
+        return (std::size_t)((width + 3) / 4) * (std::size_t)((height + 3) / 4) * blockSize;
+    }
+
+    // Adds levels stored one after another, starting at an offset.
+    bool AddLevels(const std::string& filename, const std::uint8_t* data, std::size_t size, std::size_t offset, int width, int height, int levelCount, CompressedImage& image)
+    {
+        std::size_t blockSize = CompressedTexture::GetBlockSize(image.format);
+
+        for(int i = 0; i < levelCount; ++i)
+        {
+            CompressedLevel level;
+            level.width = std::max(width >> i, 1);
+            level.height = std::max(height >> i, 1);
+            level.size = GetLevelSize(level.width, level.height, blockSize);
+
+            if(offset + level.size > size)
+            {
+                LogError() << LogParseError(filename) << "Levels exceed the file.";
+                return false;
+            }
+
+            level.data = data + offset;
+            offset += level.size;
+
+            image.levels.push_back(level);
+        }
+
+        return true;
+    }
+
+    // Parses a DDS container.
+    bool ParseDds(const std::string& filename, const std::uint8_t* data, std::size_t size, CompressedImage& image)
+    {
+        DdsHeader header;
+
+        if(size < sizeof(DdsMagic) + sizeof(DdsHeader))
+        {
+            LogError() << LogParseError(filename) << "Invalid DDS header.";
+            return false;
+        }
+
+        std::memcpy(&header, data + sizeof(DdsMagic), sizeof(DdsHeader));
+        std::size_t offset = sizeof(DdsMagic) + sizeof(DdsHeader);
+
+        if(header.size != sizeof(DdsHeader) || !(header.pixelFormat.flags & DdsFourCC))
+        {
+            LogError() << LogParseError(filename) << "Unsupported DDS pixel format.";
+            return false;
+        }
+
+        // Find the format from its four character code or DXGI format.
+        switch(header.pixelFormat.fourCC)
+        {
+        case FourCCDxt1:
+            image.format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+            break;
+
+        case FourCCDxt5:
+            image.format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            break;
+
+        case FourCCDx10:
+            {
+                DdsExtendedHeader extended;
+
+                if(size < offset + sizeof(DdsExtendedHeader))
+                {
+                    LogError() << LogParseError(filename) << "Invalid DDS extended header.";
+                    return false;
+                }
+
+                std::memcpy(&extended, data + offset, sizeof(DdsExtendedHeader));
+                offset += sizeof(DdsExtendedHeader);
+
+                if(extended.arraySize > 1)
+                {
+                    LogError() << LogParseError(filename) << "DDS texture arrays are not supported.";
+                    return false;
+                }
+
+                switch(extended.format)
+                {
+                case DxgiBC1:     image.format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; break;
+                case DxgiBC1Srgb: image.format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT; break;
+                case DxgiBC3:     image.format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+                case DxgiBC3Srgb: image.format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT; break;
+                case DxgiBC7:     image.format = GL_COMPRESSED_RGBA_BPTC_UNORM; break;
+                case DxgiBC7Srgb: image.format = GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM; break;
+
+                default:
+                    LogError() << LogParseError(filename) << "Unsupported DXGI format " << extended.format << ".";
+                    return false;
+                }
+            }
+            break;
+
+        default:
+            LogError() << LogParseError(filename) << "Unsupported DDS pixel format.";
+            return false;
+        }
+
+        if(header.width == 0 || header.height == 0 || header.width > 16384 || header.height > 16384)
+        {
+            LogError() << LogParseError(filename) << "Invalid DDS texture size.";
+            return false;
+        }
+
+        int levelCount = (header.flags & DdsMipmapCount) && header.mipmapCount > 0 ? (int)std::min<std::uint32_t>(header.mipmapCount, 15) : 1;
+
+        return AddLevels(filename, data, size, offset, (int)header.width, (int)header.height, levelCount, image);
+    }
+
+    // Parses a KTX container.
+    bool ParseKtx(const std::string& filename, const std::uint8_t* data, std::size_t size, CompressedImage& image)
+    {
+        KtxHeader header;
+
+        if(size < sizeof(KtxIdentifier) + sizeof(KtxHeader))
+        {
+            LogError() << LogParseError(filename) << "Invalid KTX header.";
+            return false;
+        }
+
+        std::memcpy(&header, data + sizeof(KtxIdentifier), sizeof(KtxHeader));
+
+        if(header.endianness != KtxEndianness)
+        {
+            LogError() << LogParseError(filename) << "KTX file has a different endianness.";
+            return false;
+        }
+
+        if(header.type != 0 || CompressedTexture::GetBlockSize(header.internalFormat) == 0)
+        {
+            LogError() << LogParseError(filename) << "Unsupported KTX internal format.";
+            return false;
+        }
+
+        if(header.depth > 1 || header.arrayElementCount > 0 || header.faceCount != 1)
+        {
+            LogError() << LogParseError(filename) << "Only two dimensional KTX textures are supported.";
+            return false;
+        }
+
+        if(header.width == 0 || header.height == 0 || header.width > 16384 || header.height > 16384)
+        {
+            LogError() << LogParseError(filename) << "Invalid KTX texture size.";
+            return false;
+        }
+
+        image.format = header.internalFormat;
+
+        // Each level is preceded by its size and padded to four bytes.
+        std::size_t offset = sizeof(KtxIdentifier) + sizeof(KtxHeader) + (std::size_t)header.keyValueSize;
+        int levelCount = (int)std::max<std::uint32_t>(std::min<std::uint32_t>(header.levelCount, 15), 1);
+
+        for(int i = 0; i < levelCount; ++i)
+        {
+            std::uint32_t levelSize = 0;
+
+            if(offset + sizeof(levelSize) > size)
+            {
+                LogError() << LogParseError(filename) << "Levels exceed the file.";
+                return false;
+            }
+
+            std::memcpy(&levelSize, data + offset, sizeof(levelSize));
+            offset += sizeof(levelSize);
+
+            if(!AddLevels(filename, data, size, offset, std::max((int)header.width >> i, 1), std::max((int)header.height >> i, 1), 1, image))
+                return false;
+
+            if(image.levels.back().size != levelSize)
+            {
+                LogError() << LogParseError(filename) << "Invalid KTX level size.";
+                return false;
+            }
+
+            offset += (levelSize + 3) & ~3u;
+        }
+
+        return true;
+    }
+
+    // Packs a color into the 5:6:5 format.
+    std::uint16_t PackColor(const glm::ivec3& color)
+    {
+        return (std::uint16_t)(((color.r * 31 + 127) / 255) << 11 | ((color.g * 63 + 127) / 255) << 5 | ((color.b * 31 + 127) / 255));
+    }
+
+    // Unpacks a color from the 5:6:5 format.
+    glm::ivec3 UnpackColor(std::uint16_t packed)
+    {
+        int r = packed >> 11 & 31;
+        int g = packed >> 5 & 63;
+        int b = packed & 31;
+
+        return glm::ivec3(r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2);
+    }
+
+    // Encodes colors of a block with endpoints at the corners of their bounding box.
+    void EncodeColorBlock(const std::uint8_t (&block)[16][4], std::uint8_t* output)
+    {
+        glm::ivec3 minimum(255);
+        glm::ivec3 maximum(0);
+
+        for(const auto& pixel : block)
+        {
+            glm::ivec3 color(pixel[0], pixel[1], pixel[2]);
+            minimum = glm::min(minimum, color);
+            maximum = glm::max(maximum, color);
+        }
+
+        // Inset the box, which lowers the error of colors between endpoints.
+        glm::ivec3 inset = (maximum - minimum) / 16;
+        minimum = glm::clamp(minimum + inset, 0, 255);
+        maximum = glm::clamp(maximum - inset, 0, 255);
+
+        std::uint16_t first = PackColor(maximum);
+        std::uint16_t second = PackColor(minimum);
+
+        // The first endpoint has to be larger for four color blocks.
+        if(first < second)
+        {
+            std::swap(first, second);
+        }
+
+        std::uint32_t indices = 0;
+
+        if(first != second)
+        {
+            glm::ivec3 palette[4];
+            palette[0] = UnpackColor(first);
+            palette[1] = UnpackColor(second);
+            palette[2] = (palette[0] * 2 + palette[1]) / 3;
+            palette[3] = (palette[0] + palette[1] * 2) / 3;
+
+            for(int i = 0; i < 16; ++i)
+            {
+                glm::ivec3 color(block[i][0], block[i][1], block[i][2]);
+
+                int best = 0;
+                int bestDistance = std::numeric_limits<int>::max();
+
+                for(int j = 0; j < 4; ++j)
+                {
+                    glm::ivec3 difference = color - palette[j];
+                    int distance = difference.r * difference.r + difference.g * difference.g + difference.b * difference.b;
+
+                    if(distance < bestDistance)
+                    {
+                        best = j;
+                        bestDistance = distance;
+                    }
+                }
+
+                indices |= (std::uint32_t)best << (i * 2);
+            }
+        }
+
+        std::memcpy(output + 0, &first, sizeof(first));
+        std::memcpy(output + 2, &second, sizeof(second));
+        std::memcpy(output + 4, &indices, sizeof(indices));
+    }
+
+    // Encodes alpha of a block with eight interpolated values.
+    void EncodeAlphaBlock(const std::uint8_t (&block)[16][4], std::uint8_t* output)
+    {
+        int minimum = 255;
+        int maximum = 0;
+
+        for(const auto& pixel : block)
+        {
+            minimum = std::min<int>(minimum, pixel[3]);
+            maximum = std::max<int>(maximum, pixel[3]);
+        }
+
+        std::uint64_t indices = 0;
+
+        if(maximum != minimum)
+        {
+            int palette[8];
+            palette[0] = maximum;
+            palette[1] = minimum;
+
+            for(int i = 1; i < 7; ++i)
+            {
+                palette[i + 1] = ((7 - i) * maximum + i * minimum) / 7;
+            }
+
+            for(int i = 0; i < 16; ++i)
+            {
+                int best = 0;
+                int bestDistance = std::numeric_limits<int>::max();
+
+                for(int j = 0; j < 8; ++j)
+                {
+                    int distance = std::abs(block[i][3] - palette[j]);
+
+                    if(distance < bestDistance)
+                    {
+                        best = j;
+                        bestDistance = distance;
+                    }
+                }
+
+                indices |= (std::uint64_t)best << (i * 3);
+            }
+        }
+
+        output[0] = (std::uint8_t)maximum;
+        output[1] = (std::uint8_t)minimum;
+
+        for(int i = 0; i < 6; ++i)
+        {
+            output[2 + i] = (std::uint8_t)(indices >> (i * 8));
+        }
+    }
+
+    // Halves an image, averaging pixels that are clamped to its edges.
+    void Downsample(int width, int height, const std::vector<std::uint8_t>& pixels, std::vector<std::uint8_t>& output)
+    {
+        int outputWidth = std::max(width / 2, 1);
+        int outputHeight = std::max(height / 2, 1);
+
+        output.resize((std::size_t)outputWidth * outputHeight * PixelSize);
+
+        for(int y = 0; y < outputHeight; ++y)
+        {
+            for(int x = 0; x < outputWidth; ++x)
+            {
+                int x0 = std::min(x * 2, width - 1);
+                int x1 = std::min(x * 2 + 1, width - 1);
+                int y0 = std::min(y * 2, height - 1);
+                int y1 = std::min(y * 2 + 1, height - 1);
+
+                for(std::size_t c = 0; c < PixelSize; ++c)
+                {
+                    int sum = pixels[((std::size_t)y0 * width + x0) * PixelSize + c] + pixels[((std::size_t)y0 * width + x1) * PixelSize + c]
+                        + pixels[((std::size_t)y1 * width + x0) * PixelSize + c] + pixels[((std::size_t)y1 * width + x1) * PixelSize + c];
+
+                    output[((std::size_t)y * outputWidth + x) * PixelSize + c] = (std::uint8_t)((sum + 2) / 4);
+                }
+            }
+        }
+    }
+
+    // Appends blocks of a level.
+    void EncodeLevel(BlockFormats::Type format, int width, int height, const std::vector<std::uint8_t>& pixels, std::vector<std::uint8_t>& content)
+    {
+        std::size_t blockSize = format == BlockFormats::BC1 ? 8 : 16;
+
+        for(int by = 0; by < height; by += 4)
+        {
+            for(int bx = 0; bx < width; bx += 4)
+            {
+                // Gather pixels of the block, clamping those past the edges.
+                std::uint8_t block[16][4];
+
+                for(int i = 0; i < 16; ++i)
+                {
+                    int x = std::min(bx + i % 4, width - 1);
+                    int y = std::min(by + i / 4, height - 1);
+
+                    std::memcpy(block[i], &pixels[((std::size_t)y * width + x) * PixelSize], PixelSize);
+                }
+
+                std::size_t offset = content.size();
+                content.resize(offset + blockSize);
+
+                if(format == BlockFormats::BC1)
+                {
+                    EncodeColorBlock(block, content.data() + offset);
+                }
+                else
+                {
+                    EncodeAlphaBlock(block, content.data() + offset);
+                    EncodeColorBlock(block, content.data() + offset + 8);
+                }
+            }
+        }
+    }
+}
+
+CompressedLevel::CompressedLevel() :
+    width(0),
+    height(0),
+    data(nullptr),
+    size(0)
+{
+}
+
+CompressedImage::CompressedImage() :
+    format(GL_NONE)
+{
+}
+
+bool CompressedTexture::IsContainer(const void* data, std::size_t size)
+{
+    if(data == nullptr)
+        return false;
+
+    if(size >= sizeof(DdsMagic) && std::memcmp(data, &DdsMagic, sizeof(DdsMagic)) == 0)
+        return true;
+
+    if(size >= sizeof(KtxIdentifier) && std::memcmp(data, KtxIdentifier, sizeof(KtxIdentifier)) == 0)
+        return true;
+
+    return false;
+}
+
+bool CompressedTexture::Parse(const std::string& filename, const void* data, std::size_t size, CompressedImage& image)
+{
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+
+    image = CompressedImage();
+
+    if(!IsContainer(data, size))
+    {
+        LogError() << LogParseError(filename) << "Unknown container format.";
+        return false;
+    }
+
+    if(std::memcmp(bytes, &DdsMagic, sizeof(DdsMagic)) == 0)
+        return ParseDds(filename, bytes, size, image);
+
+    return ParseKtx(filename, bytes, size, image);
+}
+
+std::size_t CompressedTexture::GetBlockSize(GLenum format)
+{
+    switch(format)
+    {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGB8_ETC2:
+    case GL_COMPRESSED_SRGB8_ETC2:
+        return 8;
+
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:
+    case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+    case GL_COMPRESSED_RGBA8_ETC2_EAC:
+    case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+        return 16;
+
+    default:
+        return 0;
+    }
+}
+
+bool CompressedTexture::IsFormatSupported(GLenum format)
+{
+    switch(format)
+    {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        return GLEW_EXT_texture_compression_s3tc != GL_FALSE;
+
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+        return GLEW_EXT_texture_compression_s3tc && GLEW_EXT_texture_sRGB;
+
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:
+    case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+        return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+
+    case GL_COMPRESSED_RGB8_ETC2:
+    case GL_COMPRESSED_SRGB8_ETC2:
+    case GL_COMPRESSED_RGBA8_ETC2_EAC:
+    case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+        return GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility;
+
+    default:
+        return false;
+    }
+}
+
+void CompressedTexture::Encode(BlockFormats::Type format, int width, int height, const std::vector<std::uint8_t>& pixels, bool mipmaps, std::vector<std::uint8_t>& content)
+{
+    Assert(width > 0 && height > 0, "Invalid image size!");
+    Assert(pixels.size() >= (std::size_t)width * height * PixelSize, "Not enough pixels for the image size!");
+
+    // Count levels down to a single pixel.
+    int levelCount = 1;
+
+    while(mipmaps && std::max(width >> levelCount, height >> levelCount) > 0)
+    {
+        ++levelCount;
+    }
+
+    // Write the header.
+    DdsHeader header = DdsHeader();
+    header.size = sizeof(DdsHeader);
+    header.flags = DdsCaps | DdsHeight | DdsWidth | DdsPixelFormat | DdsMipmapCount | DdsLinearSize;
+    header.height = height;
+    header.width = width;
+    header.linearSize = (std::uint32_t)GetLevelSize(width, height, format == BlockFormats::BC1 ? 8 : 16);
+    header.mipmapCount = levelCount;
+    header.pixelFormat.size = sizeof(DdsPixelFormatHeader);
+    header.pixelFormat.flags = DdsFourCC;
+    header.pixelFormat.fourCC = format == BlockFormats::BC1 ? FourCCDxt1 : FourCCDxt5;
+    header.caps[0] = DdsCapsTexture | (levelCount > 1 ? DdsCapsComplex | DdsCapsMipmap : 0);
+
+    content.resize(sizeof(DdsMagic) + sizeof(DdsHeader));
+    std::memcpy(content.data(), &DdsMagic, sizeof(DdsMagic));
+    std::memcpy(content.data() + sizeof(DdsMagic), &header, sizeof(DdsHeader));
+
+    // Encode levels, each halved from the previous one.
+    std::vector<std::uint8_t> level = pixels;
+    std::vector<std::uint8_t> next;
+
+    for(int i = 0; i < levelCount; ++i)
+    {
+        int levelWidth = std::max(width >> i, 1);
+        int levelHeight = std::max(height >> i, 1);
+
+        EncodeLevel(format, levelWidth, levelHeight, level, content);
+
+        if(i + 1 < levelCount)
+        {
+            Downsample(levelWidth, levelHeight, level, next);
+            level.swap(next);
+        }
+    }
+}
+
+bool CompressedTexture::Convert(const std::string& source, const std::string& destination, BlockFormats::Type format)
+{
+    std::vector<std::uint8_t> pixels;
+    int width = 0;
+    int height = 0;
+
+    if(!Targa::Load(source, pixels, width, height))
+        return false;
+
+    std::vector<std::uint8_t> content;
+    Encode(format, width, height, pixels, true, content);
+
+    std::ofstream file(destination, std::ios::binary);
+
+    if(!file)
+    {
+        LogError() << LogConvertError(source) << "Couldn't open \"" << destination << "\" file.";
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(content.data()), content.size());
+
+    if(!file)
+    {
+        LogError() << LogConvertError(source) << "Couldn't write \"" << destination << "\" file.";
+        return false;
+    }
+
+    return true;
+}
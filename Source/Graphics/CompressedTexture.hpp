@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Compressed Texture
+//
+//  Reads block compressed textures from DDS and KTX containers, which are
+//  uploaded as they are stored without decoding them, and take four to
+//  eight times less memory than RGBA pixels. DDS files can hold BC1, BC3
+//  and BC7 textures, while KTX files can hold any of these or ETC2 ones.
+//  Parsed levels point into the content of the container, so it can be
+//  uploaded straight from a mapped archive.
+//
+//  Blocks are uploaded in the order they are stored, so images have to be
+//  compressed with rows starting at the bottom, like decoded TGA images.
+//  The converter encodes BC1 and BC3 textures with all mipmap levels in
+//  this order, and is run as a build step by the ArchivePacker tool. BC7
+//  and ETC2 textures have to be compressed by external tools.
+//
+//  Example usage:
+//      Graphics::CompressedTexture::Convert("Data/Player.tga", "Data/Player.dds", Graphics::BlockFormats::BC3);
+//
+//      Graphics::CompressedImage image;
+//
+//      if(Graphics::CompressedTexture::Parse("Data/Player.dds", content.data(), content.size(), image))
+//      {
+//          for(std::size_t i = 0; i < image.levels.size(); ++i)
+//          {
+//              const Graphics::CompressedLevel& level = image.levels[i];
+//              glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, image.format, level.width, level.height, 0, (GLsizei)level.size, level.data);
+//          }
+//      }
+//
+
+namespace Graphics
+{
+    // Block formats that textures can be converted to.
+    struct BlockFormats
+    {
+        enum Type
+        {
+            // Opaque colors in 8 bytes per block.
+            BC1,
+
+            // Colors with alpha in 16 bytes per block.
+            BC3,
+        };
+    };
+
+    // Mipmap level of a compressed texture.
+    struct CompressedLevel
+    {
+        CompressedLevel();
+
+        int width;
+        int height;
+
+        // Blocks of the level within the container.
+        const std::uint8_t* data;
+        std::size_t size;
+    };
+
+    // Compressed texture parsed from a container.
+    struct CompressedImage
+    {
+        CompressedImage();
+
+        // Internal format of the texture.
+        GLenum format;
+
+        // Levels starting with the largest one.
+        std::vector<CompressedLevel> levels;
+    };
+
+    namespace CompressedTexture
+    {
+        // Checks if content starts with a DDS or KTX identifier.
+        bool IsContainer(const void* data, std::size_t size);
+
+        // Parses levels of a DDS or KTX container.
+        // Levels point into the content, which has to outlive their use.
+        // The filename is only used for error messages.
+        bool Parse(const std::string& filename, const void* data, std::size_t size, CompressedImage& image);
+
+        // Gets the size of a four by four block of a compressed format.
+        // Returns zero if the format is not supported.
+        std::size_t GetBlockSize(GLenum format);
+
+        // Checks if the current context can sample a compressed format.
+        bool IsFormatSupported(GLenum format);
+
+        // Compresses RGBA pixels into the content of a DDS container.
+        void Encode(BlockFormats::Type format, int width, int height, const std::vector<std::uint8_t>& pixels, bool mipmaps, std::vector<std::uint8_t>& content);
+
+        // Compresses an image file into a DDS file with all mipmap levels.
+        bool Convert(const std::string& source, const std::string& destination, BlockFormats::Type format);
+    }
+}
@@ -0,0 +1,595 @@
+#include "Precompiled.hpp"
+#include "DebugDraw.hpp"
+#include "StreamBuffer.hpp"
+using namespace Graphics;
+
+namespace Graphics
+{
+    namespace Detail
+    {
+        // Vertices of a frame recorded for the render thread.
+        struct DebugDrawFrame
+        {
+            DebugDrawFrame() :
+                state(nullptr)
+            {
+            }
+
+            DebugDrawState* state;
+
+            std::vector<DebugVertex> lines;
+            std::vector<DebugVertex> triangles;
+            glm::mat4 viewProjection;
+        };
+
+        // State shared with the render thread.
+        struct DebugDrawState
+        {
+            DebugDrawState() :
+                programCache(nullptr),
+                capacity(0),
+                program(0),
+                viewProjectionLocation(-1),
+                vertexArray(0)
+            {
+            }
+
+            ProgramCache* programCache;
+            std::size_t capacity;
+
+            GLuint program;
+            GLint viewProjectionLocation;
+            GLuint vertexArray;
+            StreamBuffer stream;
+
+            DebugDrawFrame frames[DebugDraw::FrameCount];
+        };
+    }
+}
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize a debug draw! "
+
+    // Instance used by debug draw macros.
+    std::atomic<DebugDraw*> GlobalDebugDraw(nullptr);
+
+    // Generations tell apart instances cached by threads.
+    std::atomic<std::uint64_t> DebugDrawGeneration(0);
+
+    // Debug draw shaders.
+    const char* VertexShader =
+        "#version 330 core\n"
+        "layout(location = 0) in vec3 vertexPosition;\n"
+        "layout(location = 1) in vec4 vertexColor;\n"
+        "uniform mat4 viewProjection;\n"
+        "out vec4 fragmentColor;\n"
+        "void main()\n"
+        "{\n"
+        "    gl_Position = viewProjection * vec4(vertexPosition, 1.0);\n"
+        "    fragmentColor = vertexColor;\n"
+        "}\n";
+
+    const char* FragmentShader =
+        "#version 330 core\n"
+        "in vec4 fragmentColor;\n"
+        "out vec4 outputColor;\n"
+        "void main()\n"
+        "{\n"
+        "    outputColor = fragmentColor;\n"
+        "}\n";
+
+    // Segments of the text font on a glyph with corners at zero and one.
+    // Outer edges and the middle line are split in halves, with diagonals
+    // and verticals meeting at the center.
+    const float FontSegments[16][4] =
+    {
+        { 0.0f, 1.0f, 0.5f, 1.0f }, // a: Top left.
+        { 0.5f, 1.0f, 1.0f, 1.0f }, // b: Top right.
+        { 1.0f, 1.0f, 1.0f, 0.5f }, // c: Upper right.
+        { 1.0f, 0.5f, 1.0f, 0.0f }, // d: Lower right.
+        { 1.0f, 0.0f, 0.5f, 0.0f }, // e: Bottom right.
+        { 0.5f, 0.0f, 0.0f, 0.0f }, // f: Bottom left.
+        { 0.0f, 0.0f, 0.0f, 0.5f }, // g: Lower left.
+        { 0.0f, 0.5f, 0.0f, 1.0f }, // h: Upper left.
+        { 0.0f, 0.5f, 0.5f, 0.5f }, // i: Middle left.
+        { 0.5f, 0.5f, 1.0f, 0.5f }, // j: Middle right.
+        { 0.0f, 1.0f, 0.5f, 0.5f }, // k: Upper left diagonal.
+        { 0.5f, 1.0f, 0.5f, 0.5f }, // l: Upper vertical.
+        { 1.0f, 1.0f, 0.5f, 0.5f }, // m: Upper right diagonal.
+        { 0.0f, 0.0f, 0.5f, 0.5f }, // n: Lower left diagonal.
+        { 0.5f, 0.0f, 0.5f, 0.5f }, // o: Lower vertical.
+        { 1.0f, 0.0f, 0.5f, 0.5f }, // p: Lower right diagonal.
+    };
+
+    // Glyphs of the text font as letters of their segments.
+    const struct
+    {
+        char character;
+        const char* segments;
+    }
+    FontGlyphs[] =
+    {
+        { '0', "abcdefghmn" }, { '1', "cd" }, { '2', "abcjigfe" }, { '3', "abcdefj" },
+        { '4', "hijcd" }, { '5', "abhijdef" }, { '6', "abhgfedji" }, { '7', "abcd" },
+        { '8', "abcdefghij" }, { '9', "abchijdef" },
+        { 'A', "ghabcdij" }, { 'B', "abcdefloj" }, { 'C', "abhgfe" }, { 'D', "abcdeflo" },
+        { 'E', "abhgfei" }, { 'F', "abhgi" }, { 'G', "abhgfedj" }, { 'H', "hgcdij" },
+        { 'I', "abloef" }, { 'J', "cdefg" }, { 'K', "hgimp" }, { 'L', "hgfe" },
+        { 'M', "hgkmcd" }, { 'N', "hgkpcd" }, { 'O', "abcdefgh" }, { 'P', "abcjihg" },
+        { 'Q', "abcdefghp" }, { 'R', "abcjihgp" }, { 'S', "abhijdef" }, { 'T', "ablo" },
+        { 'U', "hgfedc" }, { 'V', "hgnm" }, { 'W', "hgnpcd" }, { 'X', "kmnp" },
+        { 'Y', "kmo" }, { 'Z', "abmnfe" },
+        { '-', "ij" }, { '+', "ijlo" }, { '=', "ijef" }, { '_', "ef" },
+        { '/', "mn" }, { '\\', "kp" }, { '*', "ijkmnp" }, { '|', "lo" },
+        { '(', "mp" }, { ')', "kn" }, { '<', "mp" }, { '>', "kn" },
+        { '[', "ahgf" }, { ']', "bcde" }, { '.', "f" }, { ',', "n" },
+        { ':', "lo" }, { '\'', "l" }, { '"', "hl" }, { '%', "mnhf" },
+    };
+
+    // Gets segment masks of characters, built on first use.
+    const std::uint16_t* GetFontMasks()
+    {
+        static const std::vector<std::uint16_t> masks = []()
+        {
+            std::vector<std::uint16_t> result(128, 0);
+
+            for(const auto& glyph : FontGlyphs)
+            {
+                for(const char* segment = glyph.segments; *segment != '\0'; ++segment)
+                {
+                    result[(int)glyph.character] |= (std::uint16_t)(1 << (*segment - 'a'));
+                }
+            }
+
+            return result;
+        }();
+
+        return masks.data();
+    }
+
+    // Packs a color into normalized bytes.
+    std::uint32_t PackColor(const glm::vec4& color)
+    {
+        glm::vec4 clamped = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+
+        return (std::uint32_t)clamped.r | (std::uint32_t)clamped.g << 8 | (std::uint32_t)clamped.b << 16 | (std::uint32_t)clamped.a << 24;
+    }
+
+    // Appends a vertex.
+    void AddVertex(std::vector<DebugVertex>& vertices, const glm::vec3& position, std::uint32_t color)
+    {
+        DebugVertex vertex;
+        vertex.position = position;
+        vertex.color = color;
+
+        vertices.push_back(vertex);
+    }
+
+    // Links the debug draw program, loading its binary when it has been cached.
+    GLuint LinkProgram(ProgramCache* programCache)
+    {
+        ShaderStage stages[2];
+        stages[0].type = GL_VERTEX_SHADER;
+        stages[0].source = VertexShader;
+        stages[1].type = GL_FRAGMENT_SHADER;
+        stages[1].source = FragmentShader;
+
+        if(programCache != nullptr)
+            return programCache->Link(stages, 2, "DebugDraw");
+
+        return ProgramCache::CompileAndLink(stages, 2, "DebugDraw");
+    }
+
+    // Points vertex attributes at an offset of the stream buffer.
+    void SetVertexAttributes(std::size_t offset)
+    {
+        const GLsizei stride = sizeof(DebugVertex);
+
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offset + offsetof(DebugVertex, position)));
+        glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, reinterpret_cast<const void*>(offset + offsetof(DebugVertex, color)));
+    }
+
+    // Creates OpenGL objects on the render thread.
+    void CreateResources(StateCache& cache, void* argument)
+    {
+        auto state = static_cast<Detail::DebugDrawState*>(argument);
+
+        // Create the stream buffer with a region per frame in flight.
+        StreamBufferInfo streamInfo;
+        streamInfo.target = GL_ARRAY_BUFFER;
+        streamInfo.regionSize = sizeof(DebugVertex) * state->capacity;
+        streamInfo.regionCount = DebugDraw::FrameCount;
+
+        if(!state->stream.Initialize(streamInfo))
+            return;
+
+        // Create the program.
+        state->program = LinkProgram(state->programCache);
+
+        if(state->program == 0)
+            return;
+
+        state->viewProjectionLocation = glGetUniformLocation(state->program, "viewProjection");
+
+        // Create the vertex array, which is pointed at vertices of each draw.
+        glGenVertexArrays(1, &state->vertexArray);
+        cache.BindVertexArray(state->vertexArray);
+
+        glBindBuffer(GL_ARRAY_BUFFER, state->stream.GetHandle());
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        SetVertexAttributes(0);
+
+        cache.BindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // Destroys OpenGL objects and the state on the render thread.
+    void DestroyResources(StateCache& cache, void* argument)
+    {
+        auto state = static_cast<Detail::DebugDrawState*>(argument);
+
+        state->stream.Cleanup();
+
+        glDeleteVertexArrays(1, &state->vertexArray);
+        glDeleteProgram(state->program);
+
+        // Deleted objects may have been bound.
+        cache.Invalidate();
+
+        delete state;
+    }
+
+    // Streams vertices of a frame and draws them on the render thread.
+    void DrawFrame(StateCache& cache, void* argument)
+    {
+        auto frame = static_cast<Detail::DebugDrawFrame*>(argument);
+        auto state = frame->state;
+
+        if(state->program == 0)
+            return;
+
+        std::size_t lineSize = sizeof(DebugVertex) * frame->lines.size();
+        std::size_t triangleSize = sizeof(DebugVertex) * frame->triangles.size();
+
+        if(lineSize + triangleSize == 0)
+            return;
+
+        // Copy lines and triangles into a single allocation.
+        std::size_t offset = 0;
+        std::uint8_t* data = static_cast<std::uint8_t*>(state->stream.Map(lineSize + triangleSize, sizeof(DebugVertex), offset));
+
+        if(data == nullptr)
+            return;
+
+        std::memcpy(data, frame->lines.data(), lineSize);
+        std::memcpy(data + lineSize, frame->triangles.data(), triangleSize);
+        state->stream.Unmap();
+
+        // Draw triangles below lines with a call for each.
+        cache.UseProgram(state->program);
+        glUniformMatrix4fv(state->viewProjectionLocation, 1, GL_FALSE, &frame->viewProjection[0][0]);
+
+        cache.BindVertexArray(state->vertexArray);
+        glBindBuffer(GL_ARRAY_BUFFER, state->stream.GetHandle());
+
+        if(!frame->triangles.empty())
+        {
+            SetVertexAttributes(offset + lineSize);
+            glDrawArrays(GL_TRIANGLES, 0, (GLsizei)frame->triangles.size());
+        }
+
+        if(!frame->lines.empty())
+        {
+            SetVertexAttributes(offset);
+            glDrawArrays(GL_LINES, 0, (GLsizei)frame->lines.size());
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        state->stream.EndFrame();
+    }
+}
+
+DebugDrawInfo::DebugDrawInfo() :
+    renderer(nullptr),
+    programCache(nullptr),
+    capacity(1024 * 1024)
+{
+}
+
+DebugDraw::DebugDraw() :
+    m_renderer(nullptr),
+    m_state(nullptr),
+    m_generation(0),
+    m_frameIndex(0),
+    m_vertexCount(0),
+    m_initialized(false)
+{
+}
+
+DebugDraw::~DebugDraw()
+{
+    this->Cleanup();
+}
+
+void DebugDraw::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Destroy the state on the render thread after frames that use it.
+    m_renderer->GetCommands().Call(&DestroyResources, m_state);
+    m_state = nullptr;
+
+    m_renderer = nullptr;
+
+    Utility::ClearContainer(m_threadBuffers);
+
+    m_generation = 0;
+    m_frameIndex = 0;
+    m_vertexCount = 0;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool DebugDraw::Initialize(const DebugDrawInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.renderer == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid renderer.";
+        return false;
+    }
+
+    if(info.capacity <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid capacity.";
+        return false;
+    }
+
+    m_renderer = info.renderer;
+    m_generation = ++DebugDrawGeneration;
+
+    // Create the state and its OpenGL objects on the render thread.
+    m_state = new Detail::DebugDrawState();
+    m_state->programCache = info.programCache;
+    m_state->capacity = info.capacity;
+
+    for(auto& frame : m_state->frames)
+    {
+        frame.state = m_state;
+    }
+
+    m_renderer->GetCommands().Call(&CreateResources, m_state);
+
+    // Success!
+    return m_initialized = true;
+}
+
+void DebugDraw::Line(const glm::vec3& from, const glm::vec3& to, const glm::vec4& color)
+{
+    if(!m_initialized)
+        return;
+
+    ThreadBuffer& buffer = this->GetThreadBuffer();
+    std::uint32_t packed = PackColor(color);
+
+    AddVertex(buffer.lines, from, packed);
+    AddVertex(buffer.lines, to, packed);
+}
+
+void DebugDraw::Box(const glm::vec3& minimum, const glm::vec3& maximum, const glm::vec4& color)
+{
+    if(!m_initialized)
+        return;
+
+    ThreadBuffer& buffer = this->GetThreadBuffer();
+    std::uint32_t packed = PackColor(color);
+
+    // Corners are indexed by bits of their maximum coordinates.
+    glm::vec3 corners[8];
+
+    for(int i = 0; i < 8; ++i)
+    {
+        corners[i].x = (i & 1) ? maximum.x : minimum.x;
+        corners[i].y = (i & 2) ? maximum.y : minimum.y;
+        corners[i].z = (i & 4) ? maximum.z : minimum.z;
+    }
+
+    // Connect corners that differ in a single coordinate.
+    for(int i = 0; i < 8; ++i)
+    {
+        for(int bit = 1; bit < 8; bit <<= 1)
+        {
+            if(i & bit)
+                continue;
+
+            AddVertex(buffer.lines, corners[i], packed);
+            AddVertex(buffer.lines, corners[i | bit], packed);
+        }
+    }
+}
+
+void DebugDraw::Circle(const glm::vec3& center, float radius, const glm::vec4& color, int segments)
+{
+    if(!m_initialized || segments < 3)
+        return;
+
+    ThreadBuffer& buffer = this->GetThreadBuffer();
+    std::uint32_t packed = PackColor(color);
+
+    glm::vec3 previous = center + glm::vec3(radius, 0.0f, 0.0f);
+
+    for(int i = 1; i <= segments; ++i)
+    {
+        float angle = 2.0f * glm::pi<float>() * i / segments;
+        glm::vec3 current = center + glm::vec3(std::cos(angle) * radius, std::sin(angle) * radius, 0.0f);
+
+        AddVertex(buffer.lines, previous, packed);
+        AddVertex(buffer.lines, current, packed);
+
+        previous = current;
+    }
+}
+
+void DebugDraw::Triangle(const glm::vec3& first, const glm::vec3& second, const glm::vec3& third, const glm::vec4& color)
+{
+    if(!m_initialized)
+        return;
+
+    ThreadBuffer& buffer = this->GetThreadBuffer();
+    std::uint32_t packed = PackColor(color);
+
+    AddVertex(buffer.triangles, first, packed);
+    AddVertex(buffer.triangles, second, packed);
+    AddVertex(buffer.triangles, third, packed);
+}
+
+void DebugDraw::Rectangle(const glm::vec3& minimum, const glm::vec3& maximum, const glm::vec4& color)
+{
+    if(!m_initialized)
+        return;
+
+    ThreadBuffer& buffer = this->GetThreadBuffer();
+    std::uint32_t packed = PackColor(color);
+
+    glm::vec3 corners[4] =
+    {
+        glm::vec3(minimum.x, minimum.y, minimum.z),
+        glm::vec3(maximum.x, minimum.y, minimum.z),
+        glm::vec3(maximum.x, maximum.y, minimum.z),
+        glm::vec3(minimum.x, maximum.y, minimum.z),
+    };
+
+    const int Indices[6] = { 0, 1, 2, 0, 2, 3 };
+
+    for(int index : Indices)
+    {
+        AddVertex(buffer.triangles, corners[index], packed);
+    }
+}
+
+void DebugDraw::Text(const glm::vec3& position, const char* text, float size, const glm::vec4& color)
+{
+    if(!m_initialized || text == nullptr)
+        return;
+
+    ThreadBuffer& buffer = this->GetThreadBuffer();
+    std::uint32_t packed = PackColor(color);
+
+    const std::uint16_t* masks = GetFontMasks();
+
+    // Glyphs are narrower than they are tall, with a gap between them.
+    const float GlyphWidth = size * 0.6f;
+    const float GlyphAdvance = size * 0.8f;
+
+    glm::vec3 origin = position;
+
+    for(const char* character = text; *character != '\0'; ++character)
+    {
+        int code = std::toupper((unsigned char)*character);
+        std::uint16_t mask = code < 128 ? masks[code] : 0;
+
+        for(int segment = 0; mask != 0; ++segment, mask >>= 1)
+        {
+            if((mask & 1) == 0)
+                continue;
+
+            const float* points = FontSegments[segment];
+
+            AddVertex(buffer.lines, origin + glm::vec3(points[0] * GlyphWidth, points[1] * size, 0.0f), packed);
+            AddVertex(buffer.lines, origin + glm::vec3(points[2] * GlyphWidth, points[3] * size, 0.0f), packed);
+        }
+
+        origin.x += GlyphAdvance;
+    }
+}
+
+void DebugDraw::Draw(CommandBuffer& commands, const glm::mat4& viewProjection)
+{
+    if(!m_initialized)
+        return;
+
+    Detail::DebugDrawFrame& frame = m_state->frames[m_frameIndex % FrameCount];
+    frame.lines.clear();
+    frame.triangles.clear();
+    frame.viewProjection = viewProjection;
+
+    // Merge buffers of all threads, keeping their memory for the next frame.
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for(auto& buffer : m_threadBuffers)
+        {
+            frame.lines.insert(frame.lines.end(), buffer->lines.begin(), buffer->lines.end());
+            frame.triangles.insert(frame.triangles.end(), buffer->triangles.begin(), buffer->triangles.end());
+
+            buffer->lines.clear();
+            buffer->triangles.clear();
+        }
+    }
+
+    // Drop whole primitives over the capacity, preferring lines.
+    const std::size_t capacity = m_state->capacity;
+
+    if(frame.lines.size() + frame.triangles.size() > capacity)
+    {
+        LogWarning() << "Debug draw capacity of " << capacity << " vertices has been exceeded.";
+
+        frame.lines.resize(std::min(frame.lines.size(), capacity) / 2 * 2);
+        frame.triangles.resize((capacity - frame.lines.size()) / 3 * 3);
+    }
+
+    // Draw the frame on the render thread.
+    commands.Call(&DrawFrame, &frame);
+
+    m_vertexCount = (int)(frame.lines.size() + frame.triangles.size());
+    m_frameIndex += 1;
+}
+
+int DebugDraw::GetVertexCount() const
+{
+    return m_vertexCount;
+}
+
+void DebugDraw::SetGlobal(DebugDraw* debugDraw)
+{
+    GlobalDebugDraw.store(debugDraw, std::memory_order_release);
+}
+
+DebugDraw* DebugDraw::GetGlobal()
+{
+    return GlobalDebugDraw.load(std::memory_order_acquire);
+}
+
+DebugDraw::ThreadBuffer& DebugDraw::GetThreadBuffer()
+{
+    // Cache of the calling thread.
+    struct ThreadCache
+    {
+        std::uint64_t generation;
+        ThreadBuffer* buffer;
+    };
+
+    static thread_local ThreadCache cache = {};
+
+    // Register a buffer only when the thread has not cached this instance.
+    if(cache.generation != m_generation)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_threadBuffers.emplace_back(new ThreadBuffer());
+
+        cache.buffer = m_threadBuffers.back().get();
+        cache.generation = m_generation;
+    }
+
+    return *cache.buffer;
+}
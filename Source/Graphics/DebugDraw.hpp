@@ -0,0 +1,201 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Renderer.hpp"
+#include "ProgramCache.hpp"
+
+//
+// Debug Draw
+//
+//  Draws lines, boxes, circles, filled shapes and text for visualizing
+//  systems, such as physics bodies, navigation or cells of a spatial grid.
+//  Primitives are added in immediate mode from any thread, including jobs,
+//  and each thread appends vertices to its own buffers without locking.
+//  Drawing merges buffers of all threads and submits a single draw call for
+//  lines and another one for triangles, with vertices streamed through a
+//  buffer with a region per frame in flight.
+//
+//  Primitives are kept for a single frame. They have to be added before the
+//  frame is drawn, and threads must not add primitives while it is, so jobs
+//  that add them need to complete first. Wire shapes and text are made of
+//  lines, with text drawn in a simple segment font of digits, letters and
+//  common symbols, where lower case letters are drawn as upper case ones.
+//  Vertices over the capacity are dropped with a warning.
+//
+//  A global instance can be set for the debug draw macros, which compile to
+//  nothing, without evaluating their arguments, unless DEBUG_DRAW is defined.
+//
+//  Example usage:
+//      Graphics::DebugDrawInfo info;
+//      info.renderer = &renderer;
+//
+//      Graphics::DebugDraw debugDraw;
+//      debugDraw.Initialize(info);
+//      Graphics::DebugDraw::SetGlobal(&debugDraw);
+//
+//      DEBUG_DRAW_LINE(glm::vec3(0.0f), glm::vec3(100.0f), glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
+//      DEBUG_DRAW_TEXT(glm::vec3(10.0f, 10.0f, 0.0f), "Cell 12", 16.0f, glm::vec4(1.0f));
+//
+//      debugDraw.Draw(renderer.GetCommands(), viewProjection);
+//      renderer.Submit();
+//
+
+namespace Graphics
+{
+    // Implementation details.
+    namespace Detail
+    {
+        struct DebugDrawState;
+    }
+
+    // Debug draw vertex.
+    struct DebugVertex
+    {
+        glm::vec3 position;
+
+        // Color as normalized RGBA bytes.
+        std::uint32_t color;
+    };
+
+    // Debug draw initialization struct.
+    struct DebugDrawInfo
+    {
+        // Renderer that executes draws.
+        Renderer* renderer;
+
+        // Optional cache of program binaries.
+        ProgramCache* programCache;
+
+        // Maximum number of vertices drawn in a frame.
+        int capacity;
+
+        DebugDrawInfo();
+    };
+
+    // Debug draw class.
+    class DebugDraw : private NonCopyable
+    {
+    public:
+        // Number of frames that can be in flight.
+        static const int FrameCount = 2;
+
+    public:
+        DebugDraw();
+        ~DebugDraw();
+
+        // Restores instance to its original state.
+        // Must be called before the renderer is cleaned up.
+        void Cleanup();
+
+        // Initializes the debug draw instance.
+        bool Initialize(const DebugDrawInfo& info);
+
+        // Adds a line.
+        void Line(const glm::vec3& from, const glm::vec3& to, const glm::vec4& color);
+
+        // Adds edges of an axis aligned box.
+        void Box(const glm::vec3& minimum, const glm::vec3& maximum, const glm::vec4& color);
+
+        // Adds an outline of a circle facing the z axis.
+        void Circle(const glm::vec3& center, float radius, const glm::vec4& color, int segments = 24);
+
+        // Adds a filled triangle.
+        void Triangle(const glm::vec3& first, const glm::vec3& second, const glm::vec3& third, const glm::vec4& color);
+
+        // Adds a filled rectangle facing the z axis at the depth of its minimum.
+        void Rectangle(const glm::vec3& minimum, const glm::vec3& maximum, const glm::vec4& color);
+
+        // Adds a line of text starting at its bottom left corner.
+        void Text(const glm::vec3& position, const char* text, float size, const glm::vec4& color);
+
+        // Merges primitives of all threads and records their draws.
+        // Has to be called at most once per submitted frame.
+        void Draw(CommandBuffer& commands, const glm::mat4& viewProjection);
+
+        // Gets the number of vertices drawn in the last frame.
+        int GetVertexCount() const;
+
+        // Sets the instance used by debug draw macros.
+        // Has to outlive its use and be cleared before it is cleaned up.
+        static void SetGlobal(DebugDraw* debugDraw);
+
+        // Gets the instance used by debug draw macros.
+        static DebugDraw* GetGlobal();
+
+    private:
+        // Vertices added by a thread.
+        struct ThreadBuffer
+        {
+            std::vector<DebugVertex> lines;
+            std::vector<DebugVertex> triangles;
+        };
+
+        // Gets the buffer of the calling thread.
+        ThreadBuffer& GetThreadBuffer();
+
+    private:
+        // Renderer that executes draws.
+        Renderer* m_renderer;
+
+        // State shared with the render thread.
+        Detail::DebugDrawState* m_state;
+
+        // Buffers of threads that added primitives.
+        std::vector<std::unique_ptr<ThreadBuffer>> m_threadBuffers;
+        std::mutex m_mutex;
+
+        // Generation that tells apart instances in caches of threads.
+        std::uint64_t m_generation;
+
+        // Index of the next frame.
+        std::uint64_t m_frameIndex;
+
+        // Statistics of the last frame.
+        int m_vertexCount;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
+
+//
+// Debug draw macros.
+//
+
+#if defined(DEBUG_DRAW)
+    #define DEBUG_DRAW_LINE(from, to, color)                                         \
+        if(Graphics::DebugDraw* debugDraw = Graphics::DebugDraw::GetGlobal())      \
+        {                                                                          \
+            debugDraw->Line(from, to, color);                                      \
+        }
+
+    #define DEBUG_DRAW_BOX(minimum, maximum, color)                                  \
+        if(Graphics::DebugDraw* debugDraw = Graphics::DebugDraw::GetGlobal())      \
+        {                                                                          \
+            debugDraw->Box(minimum, maximum, color);                               \
+        }
+
+    #define DEBUG_DRAW_CIRCLE(center, radius, color)                                 \
+        if(Graphics::DebugDraw* debugDraw = Graphics::DebugDraw::GetGlobal())      \
+        {                                                                          \
+            debugDraw->Circle(center, radius, color);                              \
+        }
+
+    #define DEBUG_DRAW_RECTANGLE(minimum, maximum, color)                            \
+        if(Graphics::DebugDraw* debugDraw = Graphics::DebugDraw::GetGlobal())      \
+        {                                                                          \
+            debugDraw->Rectangle(minimum, maximum, color);                         \
+        }
+
+    #define DEBUG_DRAW_TEXT(position, text, size, color)                             \
+        if(Graphics::DebugDraw* debugDraw = Graphics::DebugDraw::GetGlobal())      \
+        {                                                                          \
+            debugDraw->Text(position, text, size, color);                          \
+        }
+#else
+    #define DEBUG_DRAW_LINE(from, to, color) ((void)0)
+    #define DEBUG_DRAW_BOX(minimum, maximum, color) ((void)0)
+    #define DEBUG_DRAW_CIRCLE(center, radius, color) ((void)0)
+    #define DEBUG_DRAW_RECTANGLE(minimum, maximum, color) ((void)0)
+    #define DEBUG_DRAW_TEXT(position, text, size, color) ((void)0)
+#endif
@@ -0,0 +1,588 @@
+#include "Precompiled.hpp"
+#include "FrameProfiler.hpp"
+using namespace Graphics;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize a frame profiler! "
+    #define LogWriteTraceError(filename) "Failed to write a trace to \"" << filename << "\" file! "
+
+    // Writes a string as a quoted JSON string.
+    void WriteString(std::ostream& stream, const char* string)
+    {
+        stream << '"';
+
+        for(const char* character = string; *character != '\0'; ++character)
+        {
+            if(*character == '"' || *character == '\\')
+            {
+                stream << '\\';
+            }
+
+            stream << *character;
+        }
+
+        stream << '"';
+    }
+
+    // Profiler used by the profile macros.
+    std::atomic<FrameProfiler*> GlobalProfiler(nullptr);
+
+    // Generations tell apart profilers cached by threads.
+    // Zero marks thread caches that have never been used.
+    std::atomic<std::uint64_t> ProfilerGeneration(0);
+}
+
+FrameProfilerInfo::FrameProfilerInfo() :
+    eventCapacity(256 * 1024),
+    timerCapacity(64),
+    threadEventCapacity(16 * 1024),
+    hardwareCounters(false)
+{
+}
+
+FrameProfiler::CpuScope::CpuScope(FrameProfiler* profiler, const char* name) :
+    m_profiler(profiler),
+    m_name(name),
+    m_counted(false)
+{
+    if(m_profiler != nullptr)
+    {
+        // Read counters before the clock to keep the read out of the measured time.
+        m_counted = m_profiler->ReadCounters(m_startCounters);
+        m_start = Clock::now();
+    }
+}
+
+FrameProfiler::CpuScope::~CpuScope()
+{
+    if(m_profiler != nullptr)
+    {
+        Clock::time_point end = Clock::now();
+
+        System::HardwareCounters::Values endCounters;
+
+        if(m_counted && m_profiler->ReadCounters(endCounters))
+        {
+            for(int type = 0; type < System::HardwareCounterTypes::Count; ++type)
+            {
+                endCounters[type] -= m_startCounters[type];
+            }
+
+            m_profiler->RecordCpu(m_name, m_start, end, &endCounters);
+        }
+        else
+        {
+            m_profiler->RecordCpu(m_name, m_start, end);
+        }
+    }
+}
+
+FrameProfiler::FrameProfiler() :
+    m_eventCapacity(0),
+    m_timerCapacity(0),
+    m_threadEventCapacity(0),
+    m_hardwareCounters(false),
+    m_generation(0),
+    m_gpuDepth(0),
+    m_gpuActive(false),
+    m_gpuEnd(0.0),
+    m_initialized(false)
+{
+}
+
+FrameProfiler::~FrameProfiler()
+{
+    this->Cleanup();
+}
+
+void FrameProfiler::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    Assert(m_pendingTimers.empty() && m_freeQueries.empty(), "Cleaning up a frame profiler with unreleased GPU timers!");
+
+    m_eventCapacity = 0;
+    m_timerCapacity = 0;
+    m_threadEventCapacity = 0;
+    m_hardwareCounters = false;
+    m_generation = 0;
+
+    m_events.Cleanup();
+    Utility::ClearContainer(m_tracks);
+
+    Utility::ClearContainer(m_pendingTimers);
+    Utility::ClearContainer(m_freeQueries);
+    m_gpuDepth = 0;
+    m_gpuActive = false;
+    m_gpuEnd = 0.0;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool FrameProfiler::Initialize(const FrameProfilerInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.eventCapacity <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid event capacity.";
+        return false;
+    }
+
+    if(info.timerCapacity <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid timer capacity.";
+        return false;
+    }
+
+    if(info.threadEventCapacity <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid thread event capacity.";
+        return false;
+    }
+
+    m_eventCapacity = info.eventCapacity;
+    m_timerCapacity = info.timerCapacity;
+    m_threadEventCapacity = info.threadEventCapacity;
+    m_hardwareCounters = info.hardwareCounters;
+    m_generation = ++ProfilerGeneration;
+
+    m_events.Reserve(m_eventCapacity);
+    m_origin = Clock::now();
+
+    // Add the track of GPU passes.
+    Track track;
+    track.name = "GPU";
+
+    m_tracks.push_back(std::move(track));
+
+    // Success!
+    return m_initialized = true;
+}
+
+void FrameProfiler::SetGlobal(FrameProfiler* profiler)
+{
+    GlobalProfiler.store(profiler, std::memory_order_release);
+}
+
+FrameProfiler* FrameProfiler::GetGlobal()
+{
+    return GlobalProfiler.load(std::memory_order_acquire);
+}
+
+void FrameProfiler::NameThread(const char* name)
+{
+    if(!m_initialized)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tracks[this->AcquireTrack()].name = name;
+}
+
+void FrameProfiler::RecordCpu(const char* name, Clock::time_point start, Clock::time_point end, const System::HardwareCounters::Values* counters)
+{
+    if(!m_initialized)
+        return;
+
+    Event event;
+    event.name = name;
+    event.start = this->ToMicroseconds(start);
+    event.duration = this->ToMicroseconds(end) - event.start;
+    event.instant = false;
+    event.counted = counters != nullptr;
+
+    if(counters != nullptr)
+    {
+        event.counters = *counters;
+    }
+
+    this->PushEvent(event);
+}
+
+bool FrameProfiler::ReadCounters(System::HardwareCounters::Values& values)
+{
+    if(!m_initialized || !m_hardwareCounters)
+        return false;
+
+    return this->GetThreadBuffer().counters.Read(values);
+}
+
+void FrameProfiler::MarkFrame()
+{
+    if(!m_initialized)
+        return;
+
+    Event event;
+    event.name = "Frame";
+    event.start = this->ToMicroseconds(Clock::now());
+    event.duration = 0.0;
+    event.instant = true;
+    event.counted = false;
+
+    this->PushEvent(event);
+
+    // Collect events of all threads once per frame.
+    std::lock_guard<std::mutex> lock(m_mutex);
+    this->CollectEvents();
+}
+
+void FrameProfiler::BeginGpuTimer(const char* name)
+{
+    if(!m_initialized)
+        return;
+
+    // Only measure the outermost pass.
+    if(m_gpuDepth++ != 0)
+        return;
+
+    // Skip passes when timer queries are not supported
+    // or too many results are still pending.
+    if(!(GLEW_VERSION_3_3 || GLEW_ARB_timer_query))
+        return;
+
+    if(m_pendingTimers.size() >= m_timerCapacity)
+        return;
+
+    // Start a query with a name from the free list.
+    PendingTimer timer;
+    timer.name = name;
+    timer.submitted = Clock::now();
+
+    if(m_freeQueries.empty())
+    {
+        glGenQueries(1, &timer.query);
+    }
+    else
+    {
+        timer.query = m_freeQueries.back();
+        m_freeQueries.pop_back();
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, timer.query);
+
+    m_pendingTimers.push_back(timer);
+    m_gpuActive = true;
+}
+
+void FrameProfiler::EndGpuTimer()
+{
+    if(!m_initialized)
+        return;
+
+    Assert(m_gpuDepth > 0, "Ending a GPU timer that has not begun!");
+
+    if(--m_gpuDepth != 0)
+        return;
+
+    if(m_gpuActive)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        m_gpuActive = false;
+    }
+}
+
+void FrameProfiler::CollectGpuTimers()
+{
+    if(!m_initialized)
+        return;
+
+    // Results become available in order of submission.
+    // The last timer can't be read while its query is still active.
+    std::size_t endedCount = m_pendingTimers.size() - (m_gpuActive ? 1 : 0);
+
+    while(endedCount != 0)
+    {
+        PendingTimer& timer = m_pendingTimers.front();
+
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(timer.query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if(available == GL_FALSE)
+            break;
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(timer.query, GL_QUERY_RESULT, &nanoseconds);
+
+        // Place the pass after the previous one.
+        Event event;
+        event.name = timer.name;
+        event.track = GpuTrack;
+        event.start = std::max(this->ToMicroseconds(timer.submitted), m_gpuEnd);
+        event.duration = (double)nanoseconds / 1000.0;
+        event.instant = false;
+        event.counted = false;
+
+        m_gpuEnd = event.start + event.duration;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            this->AddEvent(event);
+        }
+
+        m_freeQueries.push_back(timer.query);
+        m_pendingTimers.pop_front();
+        endedCount -= 1;
+    }
+}
+
+void FrameProfiler::ReleaseGpuTimers()
+{
+    if(!m_initialized)
+        return;
+
+    if(m_gpuActive)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+    }
+
+    for(const PendingTimer& timer : m_pendingTimers)
+    {
+        glDeleteQueries(1, &timer.query);
+    }
+
+    if(!m_freeQueries.empty())
+    {
+        glDeleteQueries((GLsizei)m_freeQueries.size(), m_freeQueries.data());
+    }
+
+    m_pendingTimers.clear();
+    m_freeQueries.clear();
+    m_gpuDepth = 0;
+    m_gpuActive = false;
+}
+
+FrameProfiler::EventList FrameProfiler::GetEvents()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    this->CollectEvents();
+
+    EventList events;
+    events.reserve(m_events.GetSize());
+
+    for(std::size_t i = 0; i < m_events.GetSize(); ++i)
+    {
+        events.push_back(m_events[i]);
+    }
+
+    return events;
+}
+
+bool FrameProfiler::WriteTrace(const std::string& filename)
+{
+    if(!m_initialized)
+        return false;
+
+    EventList events = this->GetEvents();
+
+    std::vector<const char*> trackNames;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for(const Track& track : m_tracks)
+        {
+            trackNames.push_back(track.name);
+        }
+    }
+
+    std::ofstream file(filename, std::ios::trunc);
+
+    if(!file)
+    {
+        LogError() << LogWriteTraceError(filename) << "Couldn't open the file.";
+        return false;
+    }
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\"traceEvents\":[\n";
+
+    // Write names of tracks.
+    for(std::size_t i = 0; i < trackNames.size(); ++i)
+    {
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i << ",\"args\":{\"name\":";
+        WriteString(file, trackNames[i] != nullptr ? trackNames[i] : "Thread");
+        file << "}}";
+
+        if(i + 1 != trackNames.size() || !events.empty())
+        {
+            file << ",";
+        }
+
+        file << "\n";
+    }
+
+    // Write complete and instant events.
+    for(std::size_t i = 0; i < events.size(); ++i)
+    {
+        const Event& event = events[i];
+
+        file << "{\"name\":";
+        WriteString(file, event.name);
+
+        if(event.instant)
+        {
+            file << ",\"ph\":\"i\",\"s\":\"t\"";
+        }
+        else
+        {
+            file << ",\"ph\":\"X\",\"dur\":" << event.duration;
+        }
+
+        file << ",\"pid\":0,\"tid\":" << event.track << ",\"ts\":" << event.start;
+
+        // Write hardware counters as arguments.
+        if(event.counted)
+        {
+            file << ",\"args\":{";
+
+            for(int type = 0; type < System::HardwareCounterTypes::Count; ++type)
+            {
+                file << (type != 0 ? "," : "");
+                WriteString(file, System::HardwareCounters::GetTypeName((System::HardwareCounterTypes::Type)type));
+                file << ":" << event.counters[type];
+            }
+
+            file << "}";
+        }
+
+        file << "}";
+
+        if(i + 1 != events.size())
+        {
+            file << ",";
+        }
+
+        file << "\n";
+    }
+
+    file << "]}\n";
+
+    if(!file)
+    {
+        LogError() << LogWriteTraceError(filename) << "Couldn't write to the file.";
+        return false;
+    }
+
+    return true;
+}
+
+bool FrameProfiler::IsInitialized() const
+{
+    return m_initialized;
+}
+
+double FrameProfiler::ToMicroseconds(Clock::time_point time) const
+{
+    return std::chrono::duration<double, std::micro>(time - m_origin).count();
+}
+
+int FrameProfiler::AcquireTrack()
+{
+    std::thread::id thread = std::this_thread::get_id();
+
+    for(std::size_t i = 1; i < m_tracks.size(); ++i)
+    {
+        if(m_tracks[i].thread == thread)
+            return (int)i;
+    }
+
+    Track track;
+    track.thread = thread;
+    track.name = nullptr;
+
+    track.buffer.reset(new ThreadBuffer());
+    track.buffer->events.reset(new Event[m_threadEventCapacity]);
+    track.buffer->capacity = m_threadEventCapacity;
+    track.buffer->track = (int)m_tracks.size();
+    track.buffer->written = 0;
+    track.buffer->read = 0;
+
+    // Open counters on the thread that they will count.
+    if(m_hardwareCounters)
+    {
+        track.buffer->counters.Initialize();
+    }
+
+    m_tracks.push_back(std::move(track));
+    return (int)m_tracks.size() - 1;
+}
+
+FrameProfiler::ThreadBuffer& FrameProfiler::GetThreadBuffer()
+{
+    // Cache of the calling thread.
+    struct ThreadCache
+    {
+        std::uint64_t generation;
+        ThreadBuffer* buffer;
+    };
+
+    static thread_local ThreadCache cache = {};
+
+    // Look up the track only when the thread has not cached this profiler.
+    if(cache.generation != m_generation)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        cache.buffer = m_tracks[this->AcquireTrack()].buffer.get();
+        cache.generation = m_generation;
+    }
+
+    return *cache.buffer;
+}
+
+void FrameProfiler::PushEvent(const Event& event)
+{
+    // Buffers are kept until cleanup, so track lookups are cached.
+    ThreadBuffer& buffer = this->GetThreadBuffer();
+
+    std::size_t written = buffer.written.load(std::memory_order_relaxed);
+    std::size_t read = buffer.read.load(std::memory_order_acquire);
+
+    // Drop the event if the buffer has not been collected in time.
+    if(written - read == buffer.capacity)
+        return;
+
+    Event& slot = buffer.events[written % buffer.capacity];
+    slot = event;
+    slot.track = buffer.track;
+
+    buffer.written.store(written + 1, std::memory_order_release);
+}
+
+void FrameProfiler::CollectEvents()
+{
+    for(Track& track : m_tracks)
+    {
+        ThreadBuffer* buffer = track.buffer.get();
+
+        if(buffer == nullptr)
+            continue;
+
+        std::size_t read = buffer->read.load(std::memory_order_relaxed);
+        std::size_t written = buffer->written.load(std::memory_order_acquire);
+
+        for(; read != written; ++read)
+        {
+            this->AddEvent(buffer->events[read % buffer->capacity]);
+        }
+
+        buffer->read.store(read, std::memory_order_release);
+    }
+}
+
+void FrameProfiler::AddEvent(const Event& event)
+{
+    if(m_events.GetSize() == m_eventCapacity)
+    {
+        m_events.Pop();
+    }
+
+    m_events.Push(event);
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "System/Clock.hpp"
+#include "System/HardwareCounters.hpp"
+
+//
+// Frame Profiler
+//
+//  Records a timeline of CPU and GPU work. CPU time is measured by scoped
+//  timers on any thread, and each thread gets its own track. Threads write
+//  CPU events into their own buffers without locking, which are collected
+//  when a frame is marked or events are read. A thread that records more
+//  events between collections than its buffer holds drops the newest ones.
+//  GPU time is
+//  measured by timer queries around passes on the render thread, which are
+//  read back without blocking once their results become available, usually
+//  a few frames later. Elapsed time queries can't be nested, so only the
+//  outermost pass of a nesting is measured. GPU passes are placed on their
+//  own track, starting when they were submitted or when the previous pass
+//  ended, whichever is later.
+//
+//  The most recent events are kept up to a fixed capacity and can be written
+//  to a file in the trace event format of Chrome, which can be opened in its
+//  tracing tools. Event names are not copied and must outlive the profiler,
+//  which string literals do.
+//
+//  Hardware counters, such as cache and branch misses, can be read for CPU
+//  scopes as well. Counters of each thread are opened when the thread first
+//  records an event, and their differences are added to events as arguments
+//  that the tracing tools show next to durations. Reading counters costs a
+//  system call on both ends of a scope, which is not included in its time.
+//
+//  A global profiler can be set for the profile macros declared next to the
+//  assert macros, which compile to nothing unless PROFILING is defined.
+//
+//  Example usage:
+//      Graphics::FrameProfiler profiler;
+//      profiler.Initialize();
+//
+//      {
+//          Graphics::FrameProfiler::CpuScope scope(&profiler, "Update");
+//          /* ... */
+//      }
+//
+//      profiler.BeginGpuTimer("Sprites");
+//      /* ... */
+//      profiler.EndGpuTimer();
+//
+//      profiler.CollectGpuTimers();
+//      profiler.MarkFrame();
+//
+//      profiler.WriteTrace("Profile.json");
+//
+
+namespace Graphics
+{
+    // Frame profiler initialization struct.
+    struct FrameProfilerInfo
+    {
+        // Maximum number of kept events.
+        int eventCapacity;
+
+        // Maximum number of GPU timers waiting for their results.
+        int timerCapacity;
+
+        // Maximum number of events buffered by each thread between collections.
+        int threadEventCapacity;
+
+        // Reads hardware counters of threads in CPU scopes.
+        bool hardwareCounters;
+
+        FrameProfilerInfo();
+    };
+
+    // Frame profiler class.
+    class FrameProfiler : private NonCopyable
+    {
+    public:
+        // Type declarations.
+        typedef System::Clock Clock;
+
+        // Track of GPU passes.
+        static const int GpuTrack = 0;
+
+        // Recorded event with times in microseconds since initialization.
+        struct Event
+        {
+            const char* name;
+            int track;
+            double start;
+            double duration;
+            bool instant;
+
+            // Differences of hardware counters, if they were read.
+            bool counted;
+            System::HardwareCounters::Values counters;
+        };
+
+        typedef std::vector<Event> EventList;
+
+        // Measures CPU time within its scope.
+        class CpuScope : private NonCopyable
+        {
+        public:
+            CpuScope(FrameProfiler* profiler, const char* name);
+            ~CpuScope();
+
+        private:
+            FrameProfiler* m_profiler;
+            const char* m_name;
+            Clock::time_point m_start;
+            System::HardwareCounters::Values m_startCounters;
+            bool m_counted;
+        };
+
+    public:
+        FrameProfiler();
+        ~FrameProfiler();
+
+        // Restores instance to its original state.
+        // GPU timers have to be released before.
+        void Cleanup();
+
+        // Initializes the frame profiler.
+        bool Initialize(const FrameProfilerInfo& info = FrameProfilerInfo());
+
+        // Sets and gets the profiler used by the profile macros.
+        static void SetGlobal(FrameProfiler* profiler);
+        static FrameProfiler* GetGlobal();
+
+        // Names the track of the calling thread.
+        void NameThread(const char* name);
+
+        // Records CPU work of the calling thread.
+        // Counters are differences of hardware counters, if they were read.
+        void RecordCpu(const char* name, Clock::time_point start, Clock::time_point end, const System::HardwareCounters::Values* counters = nullptr);
+
+        // Reads hardware counters of the calling thread.
+        // Returns false if hardware counters are disabled or unavailable.
+        bool ReadCounters(System::HardwareCounters::Values& values);
+
+        // Marks the end of a frame on the track of the calling thread.
+        void MarkFrame();
+
+        // Begins and ends a GPU pass.
+        // Has to be called on the thread with the current context.
+        void BeginGpuTimer(const char* name);
+        void EndGpuTimer();
+
+        // Records GPU passes with available results without waiting.
+        // Has to be called on the thread with the current context.
+        void CollectGpuTimers();
+
+        // Deletes timer queries and drops their pending results.
+        // Has to be called on the thread with the current context.
+        void ReleaseGpuTimers();
+
+        // Collects buffered events and gets a copy of kept events.
+        EventList GetEvents();
+
+        // Writes kept events to a file in the Chrome trace event format.
+        bool WriteTrace(const std::string& filename);
+
+        // Checks if the instance is initialized.
+        bool IsInitialized() const;
+
+    private:
+        // GPU timer waiting for its result.
+        struct PendingTimer
+        {
+            GLuint query;
+            const char* name;
+            Clock::time_point submitted;
+        };
+
+        // Events written by a single thread and read under the mutex.
+        // Counters only grow and are wrapped around the capacity.
+        struct ThreadBuffer
+        {
+            std::unique_ptr<Event[]> events;
+            std::size_t capacity;
+            int track;
+            std::atomic<std::size_t> written;
+            std::atomic<std::size_t> read;
+
+            // Hardware counters opened on the thread.
+            System::HardwareCounters counters;
+        };
+
+        // Named track of a thread.
+        struct Track
+        {
+            std::thread::id thread;
+            const char* name;
+            std::unique_ptr<ThreadBuffer> buffer;
+        };
+
+        typedef std::deque<PendingTimer> PendingTimerList;
+        typedef std::vector<GLuint> QueryList;
+        typedef std::vector<Track> TrackList;
+
+    private:
+        // Converts a time point to microseconds since initialization.
+        double ToMicroseconds(Clock::time_point time) const;
+
+        // Finds or adds the track of the calling thread.
+        // Has to be called with the mutex locked.
+        int AcquireTrack();
+
+        // Gets the buffer of the calling thread.
+        ThreadBuffer& GetThreadBuffer();
+
+        // Writes an event into the buffer of the calling thread.
+        void PushEvent(const Event& event);
+
+        // Moves events from thread buffers to kept events.
+        // Has to be called with the mutex locked.
+        void CollectEvents();
+
+        // Adds an event and drops the oldest one if there is no room left.
+        // Has to be called with the mutex locked.
+        void AddEvent(const Event& event);
+
+    private:
+        // Maximum number of kept events and pending timers.
+        std::size_t m_eventCapacity;
+        std::size_t m_timerCapacity;
+        std::size_t m_threadEventCapacity;
+
+        // Whether threads read hardware counters.
+        bool m_hardwareCounters;
+
+        // Generation that tells apart profilers in caches of threads.
+        std::uint64_t m_generation;
+
+        // Time of initialization.
+        Clock::time_point m_origin;
+
+        // Kept events and thread tracks.
+        RingBuffer<Event> m_events;
+        TrackList m_tracks;
+        mutable std::mutex m_mutex;
+
+        // GPU timers used on the render thread.
+        PendingTimerList m_pendingTimers;
+        QueryList m_freeQueries;
+        int m_gpuDepth;
+        bool m_gpuActive;
+        double m_gpuEnd;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,266 @@
+#include "Precompiled.hpp"
+#include "FrustumCuller.hpp"
+using namespace Graphics;
+
+// Select the widest available instruction set for testing blocks.
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define FRUSTUM_CULLER_AVX
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define FRUSTUM_CULLER_SSE
+#endif
+
+namespace
+{
+    // Number of bounds tested at once.
+#if defined(FRUSTUM_CULLER_AVX)
+    const int BlockSize = 8;
+#else
+    const int BlockSize = 4;
+#endif
+
+    // Minimum number of blocks worth testing on a separate thread.
+    const int MinimumPartitionBlocks = 256;
+
+    // Radius of padding bounds, which never pass the test.
+    const float PaddingRadius = -std::numeric_limits<float>::max();
+}
+
+FrustumCuller::FrustumCuller() :
+    m_count(0)
+{
+}
+
+FrustumCuller::~FrustumCuller()
+{
+}
+
+void FrustumCuller::Clear()
+{
+    m_centerX.clear();
+    m_centerY.clear();
+    m_centerZ.clear();
+    m_radius.clear();
+
+    m_count = 0;
+
+    m_visible.clear();
+}
+
+void FrustumCuller::Reserve(int count)
+{
+    std::size_t size = (std::size_t)(count + BlockSize - 1) / BlockSize * BlockSize;
+
+    m_centerX.reserve(size);
+    m_centerY.reserve(size);
+    m_centerZ.reserve(size);
+    m_radius.reserve(size);
+}
+
+int FrustumCuller::AddSphere(const glm::vec3& center, float radius)
+{
+    // Append a block of padding bounds when the last one is full.
+    if(m_count == (int)m_radius.size())
+    {
+        std::size_t size = m_radius.size() + BlockSize;
+
+        m_centerX.resize(size, 0.0f);
+        m_centerY.resize(size, 0.0f);
+        m_centerZ.resize(size, 0.0f);
+        m_radius.resize(size, PaddingRadius);
+    }
+
+    int index = m_count++;
+
+    m_centerX[index] = center.x;
+    m_centerY[index] = center.y;
+    m_centerZ[index] = center.z;
+    m_radius[index] = radius;
+
+    return index;
+}
+
+int FrustumCuller::AddBox(const glm::vec3& minimum, const glm::vec3& maximum)
+{
+    return this->AddSphere((minimum + maximum) * 0.5f, glm::length(maximum - minimum) * 0.5f);
+}
+
+void FrustumCuller::GetPlanes(const glm::mat4& viewProjection, glm::vec4* planes)
+{
+    // Extract planes from rows of the matrix.
+    glm::vec4 rows[4];
+
+    for(int i = 0; i < 4; ++i)
+    {
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+
+    glm::vec4 equations[PlaneCount] =
+    {
+        rows[3] + rows[0],
+        rows[3] - rows[0],
+        rows[3] + rows[1],
+        rows[3] - rows[1],
+        rows[3] + rows[2],
+        rows[3] - rows[2],
+    };
+
+    for(int i = 0; i < PlaneCount; ++i)
+    {
+        // Normalize planes so distances can be compared with radii.
+        planes[i] = equations[i] / glm::length(glm::vec3(equations[i]));
+    }
+}
+
+void FrustumCuller::Cull(const glm::mat4& viewProjection, JobSystem* jobSystem)
+{
+    glm::vec4 equations[PlaneCount];
+    GetPlanes(viewProjection, equations);
+
+    Plane planes[PlaneCount];
+
+    for(int i = 0; i < PlaneCount; ++i)
+    {
+        const glm::vec4& equation = equations[i];
+
+        planes[i].x = equation.x;
+        planes[i].y = equation.y;
+        planes[i].z = equation.z;
+        planes[i].w = equation.w;
+    }
+
+    // Split blocks into partitions that are tested in parallel.
+    int blockCount = (int)m_radius.size() / BlockSize;
+    int partitionCount = 1;
+
+    if(jobSystem != nullptr)
+    {
+        partitionCount = std::max(1, std::min(jobSystem->GetWorkerCount() + 1, blockCount / MinimumPartitionBlocks));
+    }
+
+    int partitionSize = (blockCount + partitionCount - 1) / std::max(partitionCount, 1);
+
+    m_visible.resize((std::size_t)blockCount * BlockSize);
+    m_partitionCounts.assign(partitionCount, 0);
+
+    // Each partition writes visible indices at the start of its own range.
+    auto RunPartitions = [&](int first, int last)
+    {
+        for(int partition = first; partition < last; ++partition)
+        {
+            int begin = std::min(partition * partitionSize, blockCount);
+            int end = std::min(begin + partitionSize, blockCount);
+
+            m_partitionCounts[partition] = this->CullBlocks(planes, begin, end, m_visible.data() + (std::size_t)begin * BlockSize);
+        }
+    };
+
+    if(jobSystem != nullptr && partitionCount > 1)
+    {
+        jobSystem->ParallelFor(partitionCount, 1, RunPartitions);
+    }
+    else
+    {
+        RunPartitions(0, partitionCount);
+    }
+
+    // Join visible indices of partitions.
+    std::size_t visibleCount = 0;
+
+    for(int partition = 0; partition < partitionCount; ++partition)
+    {
+        auto begin = m_visible.begin() + (std::size_t)std::min(partition * partitionSize, blockCount) * BlockSize;
+        auto end = begin + m_partitionCounts[partition];
+
+        std::copy(begin, end, m_visible.begin() + visibleCount);
+        visibleCount += m_partitionCounts[partition];
+    }
+
+    m_visible.resize(visibleCount);
+}
+
+int FrustumCuller::CullBlocks(const Plane* planes, int firstBlock, int lastBlock, int* output) const
+{
+    int visibleCount = 0;
+
+    for(int block = firstBlock; block < lastBlock; ++block)
+    {
+        int first = block * BlockSize;
+
+        // Test bounds of the block against all planes.
+        // Bounds are visible unless they are fully behind a plane.
+        int mask = 0;
+
+    #if defined(FRUSTUM_CULLER_AVX)
+        __m256 centerX = _mm256_loadu_ps(&m_centerX[first]);
+        __m256 centerY = _mm256_loadu_ps(&m_centerY[first]);
+        __m256 centerZ = _mm256_loadu_ps(&m_centerZ[first]);
+        __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&m_radius[first]));
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        for(int i = 0; i < PlaneCount; ++i)
+        {
+            __m256 distance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(centerX, _mm256_set1_ps(planes[i].x)), _mm256_mul_ps(centerY, _mm256_set1_ps(planes[i].y))),
+                _mm256_add_ps(_mm256_mul_ps(centerZ, _mm256_set1_ps(planes[i].z)), _mm256_set1_ps(planes[i].w)));
+
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+        }
+
+        mask = _mm256_movemask_ps(inside);
+    #elif defined(FRUSTUM_CULLER_SSE)
+        __m128 centerX = _mm_loadu_ps(&m_centerX[first]);
+        __m128 centerY = _mm_loadu_ps(&m_centerY[first]);
+        __m128 centerZ = _mm_loadu_ps(&m_centerZ[first]);
+        __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&m_radius[first]));
+        __m128 inside = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+
+        for(int i = 0; i < PlaneCount; ++i)
+        {
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(centerX, _mm_set1_ps(planes[i].x)), _mm_mul_ps(centerY, _mm_set1_ps(planes[i].y))),
+                _mm_add_ps(_mm_mul_ps(centerZ, _mm_set1_ps(planes[i].z)), _mm_set1_ps(planes[i].w)));
+
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+        }
+
+        mask = _mm_movemask_ps(inside);
+    #else
+        for(int lane = 0; lane < BlockSize; ++lane)
+        {
+            int index = first + lane;
+            bool inside = true;
+
+            for(int i = 0; i < PlaneCount && inside; ++i)
+            {
+                float distance = m_centerX[index] * planes[i].x + m_centerY[index] * planes[i].y + m_centerZ[index] * planes[i].z + planes[i].w;
+                inside = distance >= -m_radius[index];
+            }
+
+            mask |= (inside ? 1 : 0) << lane;
+        }
+    #endif
+
+        // Write indices of visible bounds.
+        for(int lane = 0; lane < BlockSize; ++lane)
+        {
+            if(mask & (1 << lane))
+            {
+                output[visibleCount++] = first + lane;
+            }
+        }
+    }
+
+    return visibleCount;
+}
+
+const FrustumCuller::IndexList& FrustumCuller::GetVisible() const
+{
+    return m_visible;
+}
+
+int FrustumCuller::GetSize() const
+{
+    return m_count;
+}
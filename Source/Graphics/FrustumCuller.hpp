@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/JobSystem.hpp"
+
+//
+// Frustum Culler
+//
+//  Tests bounding spheres against the view frustum and outputs a compact list
+//  of indices of visible ones. Bounds are packed into separate arrays of
+//  center coordinates and radii, which lets a single test cover several
+//  spheres at once with the widest available vector instructions. Boxes are
+//  added as their enclosing spheres. The arrays are split into partitions
+//  that are tested in parallel when a job system is given, and visible
+//  indices of partitions are joined in order, so the result does not depend
+//  on the number of threads.
+//
+//  Example usage:
+//      Graphics::FrustumCuller culler;
+//      culler.AddSphere(glm::vec3(0.0f, 0.0f, 0.0f), 1.0f);
+//      culler.AddBox(glm::vec3(-1.0f), glm::vec3(1.0f));
+//
+//      culler.Cull(viewProjection, &jobSystem);
+//
+//      for(int index : culler.GetVisible()) { /* ... */ }
+//
+
+namespace Graphics
+{
+    // Frustum culler class.
+    class FrustumCuller : private NonCopyable
+    {
+    public:
+        // Type declarations.
+        typedef std::vector<int> IndexList;
+
+        // Number of frustum planes.
+        static const int PlaneCount = 6;
+
+    public:
+        FrustumCuller();
+        ~FrustumCuller();
+
+        // Removes all bounds and visible indices.
+        void Clear();
+
+        // Reserves memory for a number of bounds.
+        void Reserve(int count);
+
+        // Adds bounds and returns their index.
+        int AddSphere(const glm::vec3& center, float radius);
+        int AddBox(const glm::vec3& minimum, const glm::vec3& maximum);
+
+        // Tests bounds against the frustum of a view projection matrix.
+        // Splits the work between threads if a job system is given.
+        void Cull(const glm::mat4& viewProjection, JobSystem* jobSystem = nullptr);
+
+        // Gets ascending indices of bounds that were visible in the last test.
+        const IndexList& GetVisible() const;
+
+        // Gets the number of added bounds.
+        int GetSize() const;
+
+        // Extracts normalized frustum planes of a view projection matrix.
+        // Plane normals point inside, so visible spheres are those with
+        // distances to all planes larger than their negated radii.
+        static void GetPlanes(const glm::mat4& viewProjection, glm::vec4* planes);
+
+    private:
+        // Type declarations.
+        typedef std::vector<float> FloatList;
+
+        // Frustum plane with a normal pointing inside.
+        struct Plane
+        {
+            float x, y, z, w;
+        };
+
+    private:
+        // Tests a range of blocks and writes visible indices to the output.
+        // Returns the number of written indices.
+        int CullBlocks(const Plane* planes, int firstBlock, int lastBlock, int* output) const;
+
+    private:
+        // Packed bounds, padded to a whole number of blocks.
+        FloatList m_centerX;
+        FloatList m_centerY;
+        FloatList m_centerZ;
+        FloatList m_radius;
+
+        // Number of added bounds.
+        int m_count;
+
+        // Visible indices and counts of visible bounds per partition.
+        IndexList m_visible;
+        IndexList m_partitionCounts;
+    };
+}
@@ -0,0 +1,384 @@
+#include "Precompiled.hpp"
+#include "MeshFile.hpp"
+using namespace Graphics;
+
+namespace
+{
+    // Log message strings.
+    #define LogOpenError(filename) "Failed to open \"" << filename << "\" mesh! "
+    #define LogWriteError(filename) "Failed to write \"" << filename << "\" mesh! "
+    #define LogCreateBuffersError() "Failed to create mesh buffers! "
+
+    // Identifier and version of mesh files.
+    const std::uint32_t FileMagic = 0x4853454D; // "MESH"
+    const std::uint32_t FileVersion = 1;
+
+    // Alignment of vertex and index data within files.
+    const std::size_t DataAlignment = 16;
+
+    // Mesh file header.
+    struct FileHeader
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint32_t vertexCount;
+        std::uint32_t indexCount;
+        std::uint32_t indexSize;
+        std::uint32_t reserved;
+        std::uint64_t vertexOffset;
+        std::uint64_t indexOffset;
+        float positionOffset[3];
+        float positionScale[3];
+        float textureOffset[2];
+        float textureScale[2];
+    };
+
+    static_assert(sizeof(FileHeader) % DataAlignment == 0, "Mesh file header has to keep data aligned!");
+
+    // Aligns an offset within a file.
+    std::size_t AlignOffset(std::size_t offset)
+    {
+        return (offset + DataAlignment - 1) / DataAlignment * DataAlignment;
+    }
+}
+
+MeshQuantization::MeshQuantization() :
+    positionOffset(0.0f),
+    positionScale(1.0f),
+    textureOffset(0.0f),
+    textureScale(1.0f)
+{
+}
+
+MeshBuffers::MeshBuffers() :
+    vertexArray(0),
+    vertexBuffer(0),
+    indexBuffer(0),
+    indexCount(0),
+    indexType(GL_UNSIGNED_SHORT)
+{
+}
+
+MeshFile::MeshFile() :
+    m_vertices(nullptr),
+    m_vertexCount(0),
+    m_indices(nullptr),
+    m_indexCount(0),
+    m_indexType(GL_UNSIGNED_SHORT),
+    m_initialized(false)
+{
+}
+
+MeshFile::~MeshFile()
+{
+    this->Cleanup();
+}
+
+void MeshFile::Cleanup()
+{
+    m_file.Cleanup();
+
+    m_vertices = nullptr;
+    m_vertexCount = 0;
+    m_indices = nullptr;
+    m_indexCount = 0;
+    m_indexType = GL_UNSIGNED_SHORT;
+    m_quantization = MeshQuantization();
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool MeshFile::Open(const std::string& filename)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            this->Cleanup();
+        }
+    );
+
+    // Map the file, which parsed data points into.
+    if(!m_file.Open(filename))
+    {
+        LogError() << LogOpenError(filename) << "Couldn't map the file.";
+        return false;
+    }
+
+    if(!this->ParseContent(filename, m_file.GetData(), m_file.GetSize()))
+        return false;
+
+    // Success!
+    return m_initialized = true;
+}
+
+bool MeshFile::Parse(const std::string& filename, const void* data, std::size_t size)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            this->Cleanup();
+        }
+    );
+
+    if(!this->ParseContent(filename, data, size))
+        return false;
+
+    // Success!
+    return m_initialized = true;
+}
+
+bool MeshFile::CreateBuffers(StateCache& cache, MeshBuffers& buffers) const
+{
+    if(!m_initialized)
+    {
+        LogError() << LogCreateBuffersError() << "Mesh has not been parsed.";
+        return false;
+    }
+
+    MeshBuffers result;
+
+    glGenVertexArrays(1, &result.vertexArray);
+    cache.BindVertexArray(result.vertexArray);
+
+    // Fill buffers straight from the content, which is laid out as they expect it.
+    glGenBuffers(1, &result.vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, result.vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(MeshVertex) * m_vertexCount, m_vertices, GL_STATIC_DRAW);
+
+    std::size_t indexSize = m_indexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+
+    glGenBuffers(1, &result.indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, result.indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize * m_indexCount, m_indices, GL_STATIC_DRAW);
+
+    const GLsizei stride = sizeof(MeshVertex);
+
+    for(GLuint attribute = 0; attribute <= 2; ++attribute)
+    {
+        glEnableVertexAttribArray(attribute);
+    }
+
+    glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, reinterpret_cast<const void*>(offsetof(MeshVertex, position)));
+    glVertexAttribPointer(1, 3, GL_BYTE, GL_TRUE, stride, reinterpret_cast<const void*>(offsetof(MeshVertex, normal)));
+    glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, reinterpret_cast<const void*>(offsetof(MeshVertex, texture)));
+
+    // The element buffer stays bound to the vertex array.
+    cache.BindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if(glGetError() != GL_NO_ERROR)
+    {
+        LogError() << LogCreateBuffersError() << "Couldn't fill buffers.";
+        DeleteBuffers(result);
+        return false;
+    }
+
+    result.indexCount = (GLsizei)m_indexCount;
+    result.indexType = m_indexType;
+
+    buffers = result;
+    return true;
+}
+
+const MeshVertex* MeshFile::GetVertices() const
+{
+    return m_vertices;
+}
+
+std::size_t MeshFile::GetVertexCount() const
+{
+    return m_vertexCount;
+}
+
+const void* MeshFile::GetIndices() const
+{
+    return m_indices;
+}
+
+std::size_t MeshFile::GetIndexCount() const
+{
+    return m_indexCount;
+}
+
+GLenum MeshFile::GetIndexType() const
+{
+    return m_indexType;
+}
+
+const MeshQuantization& MeshFile::GetQuantization() const
+{
+    return m_quantization;
+}
+
+bool MeshFile::IsValid() const
+{
+    return m_initialized;
+}
+
+bool MeshFile::Write(const std::string& filename, const std::vector<MeshVertex>& vertices, const std::vector<std::uint32_t>& indices, const MeshQuantization& quantization)
+{
+    if(vertices.empty() || indices.empty() || indices.size() % 3 != 0)
+    {
+        LogError() << LogWriteError(filename) << "Invalid triangle list.";
+        return false;
+    }
+
+    if(vertices.size() > std::numeric_limits<std::uint32_t>::max() || indices.size() > std::numeric_limits<std::uint32_t>::max())
+    {
+        LogError() << LogWriteError(filename) << "Mesh is too large.";
+        return false;
+    }
+
+    // Use 16 bit indices if all vertices can be addressed with them.
+    bool shortIndices = vertices.size() <= std::numeric_limits<std::uint16_t>::max() + 1;
+    std::size_t indexSize = shortIndices ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+
+    // Lay out the header, vertices and indices.
+    FileHeader header = FileHeader();
+    header.magic = FileMagic;
+    header.version = FileVersion;
+    header.vertexCount = (std::uint32_t)vertices.size();
+    header.indexCount = (std::uint32_t)indices.size();
+    header.indexSize = (std::uint32_t)indexSize;
+    header.vertexOffset = AlignOffset(sizeof(FileHeader));
+    header.indexOffset = AlignOffset((std::size_t)header.vertexOffset + sizeof(MeshVertex) * vertices.size());
+
+    for(int i = 0; i < 3; ++i)
+    {
+        header.positionOffset[i] = quantization.positionOffset[i];
+        header.positionScale[i] = quantization.positionScale[i];
+    }
+
+    for(int i = 0; i < 2; ++i)
+    {
+        header.textureOffset[i] = quantization.textureOffset[i];
+        header.textureScale[i] = quantization.textureScale[i];
+    }
+
+    std::vector<std::uint8_t> content(AlignOffset((std::size_t)header.indexOffset + indexSize * indices.size()), 0);
+    std::memcpy(content.data(), &header, sizeof(FileHeader));
+    std::memcpy(content.data() + header.vertexOffset, vertices.data(), sizeof(MeshVertex) * vertices.size());
+
+    for(std::size_t i = 0; i < indices.size(); ++i)
+    {
+        if(indices[i] >= vertices.size())
+        {
+            LogError() << LogWriteError(filename) << "Index out of range.";
+            return false;
+        }
+
+        std::uint8_t* destination = content.data() + header.indexOffset + i * indexSize;
+
+        if(shortIndices)
+        {
+            std::uint16_t index = (std::uint16_t)indices[i];
+            std::memcpy(destination, &index, sizeof(index));
+        }
+        else
+        {
+            std::memcpy(destination, &indices[i], sizeof(std::uint32_t));
+        }
+    }
+
+    // Write the file.
+    std::ofstream file(filename, std::ios::binary);
+
+    if(!file)
+    {
+        LogError() << LogWriteError(filename) << "Couldn't open the file.";
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(content.data()), content.size());
+
+    if(!file)
+    {
+        LogError() << LogWriteError(filename) << "Couldn't write the file.";
+        return false;
+    }
+
+    return true;
+}
+
+void MeshFile::DeleteBuffers(MeshBuffers& buffers)
+{
+    glDeleteVertexArrays(1, &buffers.vertexArray);
+    glDeleteBuffers(1, &buffers.vertexBuffer);
+    glDeleteBuffers(1, &buffers.indexBuffer);
+
+    buffers = MeshBuffers();
+}
+
+bool MeshFile::ParseContent(const std::string& filename, const void* data, std::size_t size)
+{
+    // Validate the header.
+    if(data == nullptr || size < sizeof(FileHeader))
+    {
+        LogError() << LogOpenError(filename) << "File is too small.";
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(FileHeader));
+
+    if(header.magic != FileMagic || header.version != FileVersion)
+    {
+        LogError() << LogOpenError(filename) << "Unsupported file format.";
+        return false;
+    }
+
+    if(header.indexSize != sizeof(std::uint16_t) && header.indexSize != sizeof(std::uint32_t))
+    {
+        LogError() << LogOpenError(filename) << "Unsupported index size.";
+        return false;
+    }
+
+    if(header.vertexCount == 0 || header.indexCount == 0 || header.indexCount % 3 != 0)
+    {
+        LogError() << LogOpenError(filename) << "Invalid triangle list.";
+        return false;
+    }
+
+    // Validate ranges of vertex and index data.
+    // Offsets have to be aligned, since buffers are filled straight from the content.
+    std::uint64_t vertexSize = (std::uint64_t)header.vertexCount * sizeof(MeshVertex);
+    std::uint64_t indexSize = (std::uint64_t)header.indexCount * header.indexSize;
+
+    if(header.vertexOffset % DataAlignment != 0 || header.vertexOffset > size || vertexSize > size - header.vertexOffset)
+    {
+        LogError() << LogOpenError(filename) << "Invalid vertex data.";
+        return false;
+    }
+
+    if(header.indexOffset % DataAlignment != 0 || header.indexOffset > size || indexSize > size - header.indexOffset)
+    {
+        LogError() << LogOpenError(filename) << "Invalid index data.";
+        return false;
+    }
+
+    const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(data);
+
+    m_vertices = reinterpret_cast<const MeshVertex*>(bytes + header.vertexOffset);
+    m_vertexCount = header.vertexCount;
+    m_indices = bytes + header.indexOffset;
+    m_indexCount = header.indexCount;
+    m_indexType = header.indexSize == sizeof(std::uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+    m_quantization.positionOffset = glm::vec3(header.positionOffset[0], header.positionOffset[1], header.positionOffset[2]);
+    m_quantization.positionScale = glm::vec3(header.positionScale[0], header.positionScale[1], header.positionScale[2]);
+    m_quantization.textureOffset = glm::vec2(header.textureOffset[0], header.textureOffset[1]);
+    m_quantization.textureScale = glm::vec2(header.textureScale[0], header.textureScale[1]);
+
+    return true;
+}
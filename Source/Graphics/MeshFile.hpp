@@ -0,0 +1,145 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/MappedFile.hpp"
+#include "StateCache.hpp"
+
+//
+// Mesh File
+//
+//  Binary format of meshes processed offline, which is laid out the way
+//  buffers expect it, so loading a mesh only maps the file and copies its
+//  vertices and indices into buffers without parsing them. Files are written
+//  by the mesh processor, see MeshProcessor, and can also be parsed in place
+//  from stored entries of a mapped archive.
+//
+//  Vertices are quantized to 16 bytes. Positions and texture coordinates are
+//  stored as normalized 16 bit integers within the bounds of the mesh, which
+//  the vertex shader maps back with the offset and scale of the mesh, and
+//  normals are stored as normalized signed bytes. Indices are 16 bit if all
+//  vertices can be addressed with them, or 32 bit otherwise.
+//
+//  Created vertex arrays read positions from attribute 0, normals from
+//  attribute 1 and texture coordinates from attribute 2.
+//
+//  Example usage:
+//      Graphics::MeshFile file;
+//      file.Open("Data/Rock.mesh");
+//
+//      Graphics::MeshBuffers buffers;
+//      file.CreateBuffers(stateCache, buffers);
+//
+//      const Graphics::MeshQuantization& quantization = file.GetQuantization();
+//      glUniform3fv(positionOffsetLocation, 1, &quantization.positionOffset[0]);
+//      glUniform3fv(positionScaleLocation, 1, &quantization.positionScale[0]);
+//
+//      stateCache.BindVertexArray(buffers.vertexArray);
+//      glDrawElements(GL_TRIANGLES, buffers.indexCount, buffers.indexType, nullptr);
+//
+//      Graphics::MeshFile::DeleteBuffers(buffers);
+//
+
+namespace Graphics
+{
+    // Quantized mesh vertex.
+    struct MeshVertex
+    {
+        // Position within the bounds of the mesh, with unused padding.
+        std::uint16_t position[4];
+
+        // Unit normal, with unused padding.
+        std::int8_t normal[4];
+
+        // Texture coordinates within the bounds of the mesh.
+        std::uint16_t texture[2];
+    };
+
+    static_assert(sizeof(MeshVertex) == 16, "Mesh vertex must be 16 bytes!");
+
+    // Mapping of quantized values back to their range.
+    struct MeshQuantization
+    {
+        MeshQuantization();
+
+        glm::vec3 positionOffset;
+        glm::vec3 positionScale;
+        glm::vec2 textureOffset;
+        glm::vec2 textureScale;
+    };
+
+    // Buffers created from a mesh file.
+    struct MeshBuffers
+    {
+        MeshBuffers();
+
+        GLuint vertexArray;
+        GLuint vertexBuffer;
+        GLuint indexBuffer;
+
+        GLsizei indexCount;
+        GLenum indexType;
+    };
+
+    // Mesh file class.
+    class MeshFile : private NonCopyable
+    {
+    public:
+        MeshFile();
+        ~MeshFile();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Opens and maps a mesh file.
+        bool Open(const std::string& filename);
+
+        // Parses a mesh in memory, which has to outlive the instance.
+        // The filename is only used for error messages.
+        bool Parse(const std::string& filename, const void* data, std::size_t size);
+
+        // Creates buffers and a vertex array from the mesh.
+        // Has to be called on a thread with a current context.
+        bool CreateBuffers(StateCache& cache, MeshBuffers& buffers) const;
+
+        // Gets vertices of the mesh.
+        const MeshVertex* GetVertices() const;
+        std::size_t GetVertexCount() const;
+
+        // Gets indices of the mesh and their type.
+        const void* GetIndices() const;
+        std::size_t GetIndexCount() const;
+        GLenum GetIndexType() const;
+
+        // Gets the mapping of quantized values.
+        const MeshQuantization& GetQuantization() const;
+
+        // Checks if a mesh has been parsed.
+        bool IsValid() const;
+
+        // Writes a mesh file, with 16 bit indices if possible.
+        static bool Write(const std::string& filename, const std::vector<MeshVertex>& vertices, const std::vector<std::uint32_t>& indices, const MeshQuantization& quantization);
+
+        // Deletes buffers created from a mesh file.
+        // Has to be called on a thread with a current context.
+        static void DeleteBuffers(MeshBuffers& buffers);
+
+    private:
+        // Parses a mesh that data points into.
+        bool ParseContent(const std::string& filename, const void* data, std::size_t size);
+
+    private:
+        // Mapped file.
+        MappedFile m_file;
+
+        // Parsed mesh data.
+        const MeshVertex* m_vertices;
+        std::size_t m_vertexCount;
+        const void* m_indices;
+        std::size_t m_indexCount;
+        GLenum m_indexType;
+        MeshQuantization m_quantization;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,765 @@
+#include "Precompiled.hpp"
+#include "MeshProcessor.hpp"
+using namespace Graphics;
+
+namespace
+{
+    // Log message strings.
+    #define LogImportError(filename) "Failed to import \"" << filename << "\" mesh! "
+
+    // Size of the cache modeled when scoring triangles.
+    const int ScoringCacheSize = 32;
+
+    // Weights of vertex scores.
+    const float CacheDecayPower = 1.5f;
+    const float LastTriangleScore = 0.75f;
+    const float ValenceBoostScale = 2.0f;
+    const float ValenceBoostPower = 0.5f;
+
+    // Minimum number of triangles in a cluster sorted for overdraw.
+    const std::size_t MinimumClusterSize = 32;
+
+    // Marks vertices that are not used by any triangle.
+    const std::uint32_t UnusedVertex = std::numeric_limits<std::uint32_t>::max();
+
+    // Attributes of a vertex compared when welding.
+    struct VertexKey
+    {
+        float values[8];
+
+        bool operator<(const VertexKey& other) const
+        {
+            return std::lexicographical_compare(values, values + 8, other.values, other.values + 8);
+        }
+    };
+
+    // Scores a vertex by its position in the cache and its remaining triangles.
+    float ComputeVertexScore(int cachePosition, int remainingTriangles)
+    {
+        // Vertices without triangles left can't contribute.
+        if(remainingTriangles == 0)
+            return -1.0f;
+
+        float score = 0.0f;
+
+        if(cachePosition >= 0)
+        {
+            // Vertices of the last triangle get a fixed score, so it isn't simply repeated.
+            if(cachePosition < 3)
+            {
+                score = LastTriangleScore;
+            }
+            else
+            {
+                float scale = 1.0f / (ScoringCacheSize - 3);
+                score = std::pow(1.0f - (cachePosition - 3) * scale, CacheDecayPower);
+            }
+        }
+
+        // Boost vertices with few triangles left, so they don't linger as lone triangles.
+        score += ValenceBoostScale * std::pow((float)remainingTriangles, -ValenceBoostPower);
+
+        return score;
+    }
+
+    // Computes smooth normals weighted by triangle areas.
+    void GenerateNormals(MeshSource& mesh)
+    {
+        mesh.normals.assign(mesh.positions.size(), glm::vec3(0.0f));
+
+        for(std::size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            const glm::vec3& a = mesh.positions[mesh.indices[i + 0]];
+            const glm::vec3& b = mesh.positions[mesh.indices[i + 1]];
+            const glm::vec3& c = mesh.positions[mesh.indices[i + 2]];
+
+            glm::vec3 normal = glm::cross(b - a, c - a);
+
+            for(int j = 0; j < 3; ++j)
+            {
+                mesh.normals[mesh.indices[i + j]] += normal;
+            }
+        }
+
+        for(glm::vec3& normal : mesh.normals)
+        {
+            float length = glm::length(normal);
+            normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+        }
+    }
+
+    // Parses an OBJ reference to an attribute, which is one based or relative to the end.
+    bool ParseObjIndex(const std::string& token, std::size_t count, int& index)
+    {
+        if(token.empty())
+        {
+            index = -1;
+            return true;
+        }
+
+        char* end = nullptr;
+        long value = std::strtol(token.c_str(), &end, 10);
+
+        if(*end != '\0' || value == 0)
+            return false;
+
+        long resolved = value > 0 ? value - 1 : (long)count + value;
+
+        if(resolved < 0 || resolved >= (long)count)
+            return false;
+
+        index = (int)resolved;
+        return true;
+    }
+
+    // Quantizes a value within a range to a normalized 16 bit integer.
+    std::uint16_t QuantizeUnorm(float value, float offset, float scale)
+    {
+        float normalized = glm::clamp((value - offset) / scale, 0.0f, 1.0f);
+        return (std::uint16_t)(normalized * 65535.0f + 0.5f);
+    }
+}
+
+bool MeshProcessor::ImportObj(const std::string& filename, MeshSource& mesh)
+{
+    mesh = MeshSource();
+
+    std::ifstream file(filename);
+
+    if(!file)
+    {
+        LogError() << LogImportError(filename) << "Couldn't open the file.";
+        return false;
+    }
+
+    // Attributes referenced by faces.
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> textures;
+
+    // Vertices created for combinations of attributes.
+    std::map<std::tuple<int, int, int>, std::uint32_t> vertices;
+    bool hasNormals = false;
+    bool hasTextures = false;
+
+    std::string line;
+    int lineNumber = 0;
+
+    while(std::getline(file, line))
+    {
+        ++lineNumber;
+
+        std::istringstream stream(line);
+        std::string type;
+
+        if(!(stream >> type) || type[0] == '#')
+            continue;
+
+        if(type == "v")
+        {
+            glm::vec3 position;
+            stream >> position.x >> position.y >> position.z;
+            positions.push_back(position);
+        }
+        else if(type == "vn")
+        {
+            glm::vec3 normal;
+            stream >> normal.x >> normal.y >> normal.z;
+            normals.push_back(normal);
+        }
+        else if(type == "vt")
+        {
+            glm::vec2 texture;
+            stream >> texture.x >> texture.y;
+            textures.push_back(texture);
+        }
+        else if(type == "f")
+        {
+            std::vector<std::uint32_t> polygon;
+            std::string token;
+
+            while(stream >> token)
+            {
+                // References are written as "v", "v/vt", "v//vn" or "v/vt/vn".
+                std::string references[3];
+                std::istringstream tokenStream(token);
+
+                for(int i = 0; i < 3; ++i)
+                {
+                    if(!std::getline(tokenStream, references[i], '/'))
+                        break;
+                }
+
+                int position = -1;
+                int texture = -1;
+                int normal = -1;
+
+                if(references[0].empty() || !ParseObjIndex(references[0], positions.size(), position) ||
+                    !ParseObjIndex(references[1], textures.size(), texture) || !ParseObjIndex(references[2], normals.size(), normal))
+                {
+                    LogError() << LogImportError(filename) << "Invalid face reference \"" << token << "\" on line " << lineNumber << ".";
+                    return false;
+                }
+
+                auto result = vertices.emplace(std::make_tuple(position, texture, normal), (std::uint32_t)mesh.positions.size());
+
+                if(result.second)
+                {
+                    mesh.positions.push_back(positions[position]);
+                    mesh.textures.push_back(texture >= 0 ? textures[texture] : glm::vec2(0.0f));
+                    mesh.normals.push_back(normal >= 0 ? normals[normal] : glm::vec3(0.0f));
+
+                    hasTextures = hasTextures || texture >= 0;
+                    hasNormals = hasNormals || normal >= 0;
+                }
+
+                polygon.push_back(result.first->second);
+            }
+
+            if(polygon.size() < 3)
+            {
+                LogError() << LogImportError(filename) << "Face with less than three vertices on line " << lineNumber << ".";
+                return false;
+            }
+
+            // Triangulate the polygon as a fan.
+            for(std::size_t i = 1; i + 1 < polygon.size(); ++i)
+            {
+                mesh.indices.push_back(polygon[0]);
+                mesh.indices.push_back(polygon[i]);
+                mesh.indices.push_back(polygon[i + 1]);
+            }
+        }
+    }
+
+    if(mesh.indices.empty())
+    {
+        LogError() << LogImportError(filename) << "File has no faces.";
+        return false;
+    }
+
+    // Leave out attributes that no face references.
+    if(!hasTextures)
+    {
+        Utility::ClearContainer(mesh.textures);
+    }
+
+    if(!hasNormals)
+    {
+        Utility::ClearContainer(mesh.normals);
+    }
+
+    return true;
+}
+
+void MeshProcessor::WeldVertices(MeshSource& mesh)
+{
+    bool hasNormals = !mesh.normals.empty();
+    bool hasTextures = !mesh.textures.empty();
+
+    Assert(!hasNormals || mesh.normals.size() == mesh.positions.size(), "Invalid number of normals!");
+    Assert(!hasTextures || mesh.textures.size() == mesh.positions.size(), "Invalid number of texture coordinates!");
+
+    // Map each vertex to the first one with identical attributes.
+    std::map<VertexKey, std::uint32_t> unique;
+    std::vector<std::uint32_t> remap(mesh.positions.size());
+
+    MeshSource welded;
+    welded.positions.reserve(mesh.positions.size());
+
+    for(std::size_t i = 0; i < mesh.positions.size(); ++i)
+    {
+        VertexKey key = VertexKey();
+        key.values[0] = mesh.positions[i].x;
+        key.values[1] = mesh.positions[i].y;
+        key.values[2] = mesh.positions[i].z;
+
+        if(hasNormals)
+        {
+            key.values[3] = mesh.normals[i].x;
+            key.values[4] = mesh.normals[i].y;
+            key.values[5] = mesh.normals[i].z;
+        }
+
+        if(hasTextures)
+        {
+            key.values[6] = mesh.textures[i].x;
+            key.values[7] = mesh.textures[i].y;
+        }
+
+        auto result = unique.emplace(key, (std::uint32_t)welded.positions.size());
+
+        if(result.second)
+        {
+            welded.positions.push_back(mesh.positions[i]);
+
+            if(hasNormals)
+                welded.normals.push_back(mesh.normals[i]);
+
+            if(hasTextures)
+                welded.textures.push_back(mesh.textures[i]);
+        }
+
+        remap[i] = result.first->second;
+    }
+
+    // Remap triangles, dropping ones that collapsed into a line or a point.
+    welded.indices.reserve(mesh.indices.size());
+
+    for(std::size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+        std::uint32_t a = remap[mesh.indices[i + 0]];
+        std::uint32_t b = remap[mesh.indices[i + 1]];
+        std::uint32_t c = remap[mesh.indices[i + 2]];
+
+        if(a == b || b == c || c == a)
+            continue;
+
+        welded.indices.push_back(a);
+        welded.indices.push_back(b);
+        welded.indices.push_back(c);
+    }
+
+    mesh = std::move(welded);
+}
+
+void MeshProcessor::OptimizeVertexCache(std::vector<std::uint32_t>& indices, std::size_t vertexCount)
+{
+    std::size_t triangleCount = indices.size() / 3;
+
+    if(triangleCount == 0)
+        return;
+
+    // Build lists of triangles that use each vertex.
+    // Only the first remaining entries of a list are triangles that haven't been added yet.
+    std::vector<int> remainingTriangles(vertexCount, 0);
+
+    for(std::uint32_t index : indices)
+    {
+        ++remainingTriangles[index];
+    }
+
+    std::vector<std::size_t> adjacencyOffsets(vertexCount + 1, 0);
+
+    for(std::size_t i = 0; i < vertexCount; ++i)
+    {
+        adjacencyOffsets[i + 1] = adjacencyOffsets[i] + remainingTriangles[i];
+    }
+
+    std::vector<std::uint32_t> adjacency(indices.size());
+    std::vector<std::size_t> adjacencyCursors(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+    for(std::size_t i = 0; i < indices.size(); ++i)
+    {
+        adjacency[adjacencyCursors[indices[i]]++] = (std::uint32_t)(i / 3);
+    }
+
+    // Score vertices and triangles.
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+
+    for(std::size_t i = 0; i < vertexCount; ++i)
+    {
+        vertexScores[i] = ComputeVertexScore(-1, remainingTriangles[i]);
+    }
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> triangleAdded(triangleCount, false);
+
+    for(std::size_t i = 0; i < triangleCount; ++i)
+    {
+        triangleScores[i] = vertexScores[indices[i * 3 + 0]] + vertexScores[indices[i * 3 + 1]] + vertexScores[indices[i * 3 + 2]];
+    }
+
+    // Start with the best triangle.
+    std::size_t bestTriangle = std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin();
+    std::size_t nextUnadded = 0;
+
+    std::vector<std::uint32_t> cache;
+    std::vector<std::uint32_t> nextCache;
+    cache.reserve(ScoringCacheSize + 3);
+    nextCache.reserve(ScoringCacheSize + 3);
+
+    std::vector<std::uint32_t> output;
+    output.reserve(indices.size());
+
+    while(output.size() < indices.size())
+    {
+        // Fall back to the next triangle in the original order when the cache offers none.
+        if(bestTriangle == triangleCount)
+        {
+            while(triangleAdded[nextUnadded])
+            {
+                ++nextUnadded;
+            }
+
+            bestTriangle = nextUnadded;
+        }
+
+        // Add the triangle and remove it from lists of its vertices.
+        triangleAdded[bestTriangle] = true;
+        const std::uint32_t* triangle = &indices[bestTriangle * 3];
+
+        for(int i = 0; i < 3; ++i)
+        {
+            std::uint32_t vertex = triangle[i];
+            output.push_back(vertex);
+
+            std::uint32_t* begin = &adjacency[adjacencyOffsets[vertex]];
+            std::uint32_t* end = begin + remainingTriangles[vertex];
+            std::uint32_t* found = std::find(begin, end, (std::uint32_t)bestTriangle);
+
+            Assert(found != end, "Triangle is missing from adjacency of its vertex!");
+
+            std::swap(*found, *(end - 1));
+            --remainingTriangles[vertex];
+        }
+
+        // Move vertices of the triangle to the front of the cache.
+        nextCache.assign(triangle, triangle + 3);
+
+        for(std::uint32_t vertex : cache)
+        {
+            if(vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+            {
+                nextCache.push_back(vertex);
+            }
+        }
+
+        // Vertices pushed out of the cache lose their cache score.
+        for(std::size_t i = ScoringCacheSize; i < nextCache.size(); ++i)
+        {
+            cachePositions[nextCache[i]] = -1;
+        }
+
+        // Update scores of vertices whose position changed and of their triangles.
+        for(std::size_t i = 0; i < nextCache.size(); ++i)
+        {
+            std::uint32_t vertex = nextCache[i];
+
+            if(i < (std::size_t)ScoringCacheSize)
+            {
+                cachePositions[vertex] = (int)i;
+            }
+
+            float score = ComputeVertexScore(cachePositions[vertex], remainingTriangles[vertex]);
+            float difference = score - vertexScores[vertex];
+            vertexScores[vertex] = score;
+
+            for(int j = 0; j < remainingTriangles[vertex]; ++j)
+            {
+                triangleScores[adjacency[adjacencyOffsets[vertex] + j]] += difference;
+            }
+        }
+
+        if(nextCache.size() > (std::size_t)ScoringCacheSize)
+        {
+            nextCache.resize(ScoringCacheSize);
+        }
+
+        cache.swap(nextCache);
+
+        // Pick the best triangle that uses a cached vertex.
+        bestTriangle = triangleCount;
+        float bestScore = -std::numeric_limits<float>::max();
+
+        for(std::uint32_t vertex : cache)
+        {
+            for(int j = 0; j < remainingTriangles[vertex]; ++j)
+            {
+                std::uint32_t candidate = adjacency[adjacencyOffsets[vertex] + j];
+
+                if(triangleScores[candidate] > bestScore)
+                {
+                    bestTriangle = candidate;
+                    bestScore = triangleScores[candidate];
+                }
+            }
+        }
+    }
+
+    indices.swap(output);
+}
+
+void MeshProcessor::OptimizeOverdraw(const std::vector<glm::vec3>& positions, std::vector<std::uint32_t>& indices, float threshold)
+{
+    std::size_t triangleCount = indices.size() / 3;
+
+    if(triangleCount < MinimumClusterSize * 2)
+        return;
+
+    // Split triangles into clusters where all vertices of a triangle miss the cache,
+    // which are points that the cache optimization started over from anyway.
+    std::vector<std::size_t> clusterStarts;
+    std::vector<std::uint32_t> insertionTimes(positions.size(), 0);
+    std::uint32_t time = CacheSize + 1;
+
+    for(std::size_t i = 0; i < triangleCount; ++i)
+    {
+        int misses = 0;
+
+        for(int j = 0; j < 3; ++j)
+        {
+            std::uint32_t vertex = indices[i * 3 + j];
+
+            if(time - insertionTimes[vertex] > (std::uint32_t)CacheSize)
+            {
+                insertionTimes[vertex] = time++;
+                ++misses;
+            }
+        }
+
+        if(clusterStarts.empty() || (misses == 3 && i - clusterStarts.back() >= MinimumClusterSize))
+        {
+            clusterStarts.push_back(i);
+        }
+    }
+
+    if(clusterStarts.size() < 2)
+        return;
+
+    clusterStarts.push_back(triangleCount);
+
+    // Compute the centroid of the mesh and of each cluster, weighted by triangle areas.
+    std::size_t clusterCount = clusterStarts.size() - 1;
+    std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+    std::vector<float> clusterAreas(clusterCount, 0.0f);
+
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for(std::size_t cluster = 0; cluster < clusterCount; ++cluster)
+    {
+        for(std::size_t i = clusterStarts[cluster]; i < clusterStarts[cluster + 1]; ++i)
+        {
+            const glm::vec3& a = positions[indices[i * 3 + 0]];
+            const glm::vec3& b = positions[indices[i * 3 + 1]];
+            const glm::vec3& c = positions[indices[i * 3 + 2]];
+
+            glm::vec3 normal = glm::cross(b - a, c - a);
+            float area = glm::length(normal);
+            glm::vec3 centroid = (a + b + c) / 3.0f;
+
+            clusterCentroids[cluster] += centroid * area;
+            clusterNormals[cluster] += normal;
+            clusterAreas[cluster] += area;
+        }
+
+        meshCentroid += clusterCentroids[cluster];
+        meshArea += clusterAreas[cluster];
+    }
+
+    if(meshArea <= 0.0f)
+        return;
+
+    meshCentroid /= meshArea;
+
+    // Sort clusters facing outwards of the mesh first, since they are likely to occlude others.
+    std::vector<float> clusterKeys(clusterCount, 0.0f);
+
+    for(std::size_t cluster = 0; cluster < clusterCount; ++cluster)
+    {
+        float normalLength = glm::length(clusterNormals[cluster]);
+
+        if(clusterAreas[cluster] > 0.0f && normalLength > 0.0f)
+        {
+            glm::vec3 centroid = clusterCentroids[cluster] / clusterAreas[cluster];
+            clusterKeys[cluster] = glm::dot(centroid - meshCentroid, clusterNormals[cluster] / normalLength);
+        }
+    }
+
+    std::vector<std::size_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+
+    std::stable_sort(order.begin(), order.end(), [&clusterKeys](std::size_t a, std::size_t b)
+    {
+        return clusterKeys[a] > clusterKeys[b];
+    });
+
+    std::vector<std::uint32_t> sorted;
+    sorted.reserve(indices.size());
+
+    for(std::size_t cluster : order)
+    {
+        sorted.insert(sorted.end(), indices.begin() + clusterStarts[cluster] * 3, indices.begin() + clusterStarts[cluster + 1] * 3);
+    }
+
+    // Keep the order only if the cache doesn't suffer from it.
+    float ratio = ComputeCacheMissRatio(indices, positions.size());
+    float sortedRatio = ComputeCacheMissRatio(sorted, positions.size());
+
+    if(sortedRatio <= ratio * threshold)
+    {
+        indices.swap(sorted);
+    }
+}
+
+void MeshProcessor::OptimizeVertexFetch(MeshSource& mesh)
+{
+    bool hasNormals = !mesh.normals.empty();
+    bool hasTextures = !mesh.textures.empty();
+
+    // Assign new indices in the order vertices are first used.
+    std::vector<std::uint32_t> remap(mesh.positions.size(), UnusedVertex);
+
+    MeshSource reordered;
+    reordered.indices.reserve(mesh.indices.size());
+
+    for(std::uint32_t index : mesh.indices)
+    {
+        if(remap[index] == UnusedVertex)
+        {
+            remap[index] = (std::uint32_t)reordered.positions.size();
+            reordered.positions.push_back(mesh.positions[index]);
+
+            if(hasNormals)
+                reordered.normals.push_back(mesh.normals[index]);
+
+            if(hasTextures)
+                reordered.textures.push_back(mesh.textures[index]);
+        }
+
+        reordered.indices.push_back(remap[index]);
+    }
+
+    mesh = std::move(reordered);
+}
+
+void MeshProcessor::Quantize(const MeshSource& mesh, std::vector<MeshVertex>& vertices, MeshQuantization& quantization)
+{
+    quantization = MeshQuantization();
+
+    // Compute bounds that positions and texture coordinates are quantized within.
+    if(!mesh.positions.empty())
+    {
+        glm::vec3 minimum = mesh.positions[0];
+        glm::vec3 maximum = mesh.positions[0];
+
+        for(const glm::vec3& position : mesh.positions)
+        {
+            minimum = glm::min(minimum, position);
+            maximum = glm::max(maximum, position);
+        }
+
+        glm::vec3 extent = maximum - minimum;
+
+        quantization.positionOffset = minimum;
+        quantization.positionScale = glm::vec3(
+            extent.x > 0.0f ? extent.x : 1.0f,
+            extent.y > 0.0f ? extent.y : 1.0f,
+            extent.z > 0.0f ? extent.z : 1.0f);
+    }
+
+    if(!mesh.textures.empty())
+    {
+        glm::vec2 minimum = mesh.textures[0];
+        glm::vec2 maximum = mesh.textures[0];
+
+        for(const glm::vec2& texture : mesh.textures)
+        {
+            minimum = glm::min(minimum, texture);
+            maximum = glm::max(maximum, texture);
+        }
+
+        glm::vec2 extent = maximum - minimum;
+
+        quantization.textureOffset = minimum;
+        quantization.textureScale = glm::vec2(
+            extent.x > 0.0f ? extent.x : 1.0f,
+            extent.y > 0.0f ? extent.y : 1.0f);
+    }
+
+    // Quantize vertices.
+    vertices.assign(mesh.positions.size(), MeshVertex());
+
+    for(std::size_t i = 0; i < mesh.positions.size(); ++i)
+    {
+        MeshVertex& vertex = vertices[i];
+
+        for(int j = 0; j < 3; ++j)
+        {
+            vertex.position[j] = QuantizeUnorm(mesh.positions[i][j], quantization.positionOffset[j], quantization.positionScale[j]);
+        }
+
+        if(!mesh.normals.empty())
+        {
+            float length = glm::length(mesh.normals[i]);
+            glm::vec3 normal = length > 0.0f ? mesh.normals[i] / length : glm::vec3(0.0f);
+
+            for(int j = 0; j < 3; ++j)
+            {
+                vertex.normal[j] = (std::int8_t)std::floor(normal[j] * 127.0f + 0.5f);
+            }
+        }
+
+        if(!mesh.textures.empty())
+        {
+            for(int j = 0; j < 2; ++j)
+            {
+                vertex.texture[j] = QuantizeUnorm(mesh.textures[i][j], quantization.textureOffset[j], quantization.textureScale[j]);
+            }
+        }
+    }
+}
+
+float MeshProcessor::ComputeCacheMissRatio(const std::vector<std::uint32_t>& indices, std::size_t vertexCount, int cacheSize)
+{
+    std::size_t triangleCount = indices.size() / 3;
+
+    if(triangleCount == 0)
+        return 0.0f;
+
+    // Vertices stay in a FIFO cache until as many others have been inserted after them.
+    std::vector<std::uint32_t> insertionTimes(vertexCount, 0);
+    std::uint32_t time = cacheSize + 1;
+    std::size_t misses = 0;
+
+    for(std::uint32_t index : indices)
+    {
+        if(time - insertionTimes[index] > (std::uint32_t)cacheSize)
+        {
+            insertionTimes[index] = time++;
+            ++misses;
+        }
+    }
+
+    return (float)misses / triangleCount;
+}
+
+void MeshProcessor::Optimize(MeshSource& mesh)
+{
+    WeldVertices(mesh);
+    OptimizeVertexCache(mesh.indices, mesh.positions.size());
+    OptimizeOverdraw(mesh.positions, mesh.indices);
+    OptimizeVertexFetch(mesh);
+}
+
+bool MeshProcessor::Convert(const std::string& source, const std::string& destination)
+{
+    MeshSource mesh;
+
+    if(!ImportObj(source, mesh))
+        return false;
+
+    // Shade faces smoothly if the file has no normals.
+    if(mesh.normals.empty())
+    {
+        WeldVertices(mesh);
+        GenerateNormals(mesh);
+    }
+
+    Optimize(mesh);
+
+    if(mesh.indices.empty())
+    {
+        LogError() << LogImportError(source) << "Mesh has only degenerate triangles.";
+        return false;
+    }
+
+    std::vector<MeshVertex> vertices;
+    MeshQuantization quantization;
+    Quantize(mesh, vertices, quantization);
+
+    return MeshFile::Write(destination, vertices, mesh.indices, quantization);
+}
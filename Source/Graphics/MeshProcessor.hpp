@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "MeshFile.hpp"
+
+//
+// Mesh Processor
+//
+//  Offline stage that turns source meshes into mesh files, which is run as
+//  a build step by the ArchivePacker tool. Triangles are imported from OBJ
+//  files, identical vertices are welded into an index buffer, and the mesh
+//  is then optimized for the way the GPU reads it:
+//
+//  - Triangles are reordered for the post transform vertex cache with the
+//    algorithm by Tom Forsyth, which greedily picks triangles whose vertices
+//    were transformed recently or have few triangles left to use them.
+//  - Runs of triangles that start with a cold cache are treated as clusters
+//    and sorted so that clusters facing outwards of the mesh come first, as
+//    in the overdraw pass of Tipsify, which lets them occlude later ones. The
+//    order is kept only if it doesn't make the cache noticeably worse.
+//  - Vertices are reordered in the order triangles first use them, so that
+//    vertex fetches read memory linearly.
+//  - Vertices are quantized into the format of mesh files.
+//
+//  The average cache miss ratio, which is the number of transformed vertices
+//  per triangle, can be computed to measure the effect of the optimizations.
+//
+//  Example usage:
+//      Graphics::MeshProcessor::Convert("Assets/Rock.obj", "Data/Rock.mesh");
+//
+//      Graphics::MeshSource mesh;
+//      Graphics::MeshProcessor::ImportObj("Assets/Rock.obj", mesh);
+//      Graphics::MeshProcessor::OptimizeVertexCache(mesh.indices, mesh.positions.size());
+//      float ratio = Graphics::MeshProcessor::ComputeCacheMissRatio(mesh.indices, mesh.positions.size());
+//
+
+namespace Graphics
+{
+    // Mesh before it is quantized.
+    struct MeshSource
+    {
+        // Attributes of vertices, where normals and texture coordinates
+        // are either empty or have an element for every position.
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<glm::vec2> textures;
+
+        // Triangle list.
+        std::vector<std::uint32_t> indices;
+    };
+
+    namespace MeshProcessor
+    {
+        // Size of the simulated cache used to measure miss ratios.
+        const int CacheSize = 16;
+
+        // Imports triangles of an OBJ file, triangulating polygons as fans.
+        // Each distinct combination of attributes becomes a single vertex.
+        bool ImportObj(const std::string& filename, MeshSource& mesh);
+
+        // Merges vertices with identical attributes and drops degenerate triangles.
+        void WeldVertices(MeshSource& mesh);
+
+        // Reorders triangles for the post transform vertex cache.
+        void OptimizeVertexCache(std::vector<std::uint32_t>& indices, std::size_t vertexCount);
+
+        // Reorders clusters of cache optimized triangles to reduce overdraw.
+        // Keeps the order only if the miss ratio grows by less than the threshold.
+        void OptimizeOverdraw(const std::vector<glm::vec3>& positions, std::vector<std::uint32_t>& indices, float threshold = 1.05f);
+
+        // Reorders vertices in the order triangles use them and drops unused ones.
+        void OptimizeVertexFetch(MeshSource& mesh);
+
+        // Quantizes vertices into the format of mesh files.
+        void Quantize(const MeshSource& mesh, std::vector<MeshVertex>& vertices, MeshQuantization& quantization);
+
+        // Computes the average number of cache misses per triangle with a FIFO cache.
+        float ComputeCacheMissRatio(const std::vector<std::uint32_t>& indices, std::size_t vertexCount, int cacheSize = CacheSize);
+
+        // Runs all optimizations on a mesh.
+        void Optimize(MeshSource& mesh);
+
+        // Imports, optimizes and writes a mesh file.
+        bool Convert(const std::string& source, const std::string& destination);
+    }
+}
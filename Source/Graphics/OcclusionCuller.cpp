@@ -0,0 +1,397 @@
+#include "Precompiled.hpp"
+#include "OcclusionCuller.hpp"
+#include "Common/Parallel.hpp"
+using namespace Graphics;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize the occlusion culler! "
+
+    // Number of rows rasterized or reduced by a single chunk.
+    const int RowGrainSize = 16;
+
+    // Number of bounds tested by a single chunk.
+    const int TestGrainSize = 1024;
+
+    // Depth of pixels not covered by any occluder, which hides nothing.
+    const float EmptyDepth = std::numeric_limits<float>::max();
+}
+
+OcclusionCullerInfo::OcclusionCullerInfo() :
+    jobSystem(nullptr),
+    width(256),
+    height(128),
+    temporal(false)
+{
+}
+
+OcclusionCuller::OcclusionCuller() :
+    m_jobSystem(nullptr),
+    m_width(0),
+    m_height(0),
+    m_currentPyramid(0),
+    m_temporal(false),
+    m_initialized(false)
+{
+    for(DepthPyramid& pyramid : m_pyramids)
+    {
+        pyramid.valid = false;
+    }
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+    this->Cleanup();
+}
+
+void OcclusionCuller::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Wait for a pyramid that is still being built.
+    if(m_jobSystem != nullptr)
+    {
+        m_jobSystem->Wait(m_buildCounter);
+    }
+
+    m_jobSystem = nullptr;
+    m_width = 0;
+    m_height = 0;
+
+    Utility::ClearContainer(m_occluders);
+    Utility::ClearContainer(m_bounds);
+    Utility::ClearContainer(m_projectedOccluders);
+
+    for(DepthPyramid& pyramid : m_pyramids)
+    {
+        Utility::ClearContainer(pyramid.levels);
+        Utility::ClearContainer(pyramid.sizes);
+        pyramid.valid = false;
+    }
+
+    m_currentPyramid = 0;
+    m_temporal = false;
+
+    Utility::ClearContainer(m_occluded);
+    Utility::ClearContainer(m_visible);
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool OcclusionCuller::Initialize(const OcclusionCullerInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.width <= 0 || info.height <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid depth buffer resolution.";
+        return false;
+    }
+
+    m_jobSystem = info.jobSystem;
+    m_width = info.width;
+    m_height = info.height;
+    m_temporal = info.temporal;
+
+    // Allocate levels down to a single pixel.
+    for(DepthPyramid& pyramid : m_pyramids)
+    {
+        glm::ivec2 size(m_width, m_height);
+
+        while(true)
+        {
+            pyramid.sizes.push_back(size);
+            pyramid.levels.emplace_back((std::size_t)size.x * size.y, EmptyDepth);
+
+            if(size.x == 1 && size.y == 1)
+                break;
+
+            size = glm::max((size + 1) / 2, glm::ivec2(1, 1));
+        }
+
+        pyramid.valid = false;
+    }
+
+    // Success!
+    return m_initialized = true;
+}
+
+void OcclusionCuller::Clear()
+{
+    m_occluders.clear();
+    m_bounds.clear();
+    m_visible.clear();
+}
+
+void OcclusionCuller::Reserve(int count)
+{
+    m_bounds.reserve((std::size_t)count * 2);
+}
+
+void OcclusionCuller::AddOccluder(const glm::vec3& minimum, const glm::vec3& maximum)
+{
+    m_occluders.push_back(minimum);
+    m_occluders.push_back(maximum);
+}
+
+int OcclusionCuller::AddBounds(const glm::vec3& minimum, const glm::vec3& maximum)
+{
+    m_bounds.push_back(minimum);
+    m_bounds.push_back(maximum);
+
+    return (int)m_bounds.size() / 2 - 1;
+}
+
+void OcclusionCuller::Cull(const glm::mat4& viewProjection, const IndexList& candidates)
+{
+    if(!m_initialized)
+    {
+        m_visible = candidates;
+        return;
+    }
+
+    // Finish building the pyramid of the previous frame.
+    if(m_temporal && m_jobSystem != nullptr)
+    {
+        m_jobSystem->Wait(m_buildCounter);
+    }
+
+    // Project occluders to pixels they cover whole.
+    bool axisAligned = IsAxisAligned(viewProjection);
+
+    m_projectedOccluders.clear();
+
+    for(std::size_t i = 0; axisAligned && i < m_occluders.size(); i += 2)
+    {
+        glm::vec3 minimum, maximum;
+        ProjectBox(viewProjection, m_occluders[i], m_occluders[i + 1], minimum, maximum);
+
+        ProjectedOccluder occluder;
+        occluder.minimumX = std::max((int)std::ceil((minimum.x * 0.5f + 0.5f) * m_width), 0);
+        occluder.minimumY = std::max((int)std::ceil((minimum.y * 0.5f + 0.5f) * m_height), 0);
+        occluder.maximumX = std::min((int)std::floor((maximum.x * 0.5f + 0.5f) * m_width), m_width);
+        occluder.maximumY = std::min((int)std::floor((maximum.y * 0.5f + 0.5f) * m_height), m_height);
+        occluder.depth = maximum.z;
+
+        if(occluder.minimumX < occluder.maximumX && occluder.minimumY < occluder.maximumY)
+        {
+            m_projectedOccluders.push_back(occluder);
+        }
+    }
+
+    // Pick the pyramid to test against and build the next one.
+    const DepthPyramid* tested = nullptr;
+
+    if(m_temporal)
+    {
+        tested = &m_pyramids[m_currentPyramid];
+
+        DepthPyramid& next = m_pyramids[1 - m_currentPyramid];
+        next.valid = false;
+
+        if(axisAligned)
+        {
+            if(m_jobSystem != nullptr)
+            {
+                m_jobSystem->Schedule([this, &next, viewProjection]()
+                {
+                    this->BuildPyramid(next, m_projectedOccluders, viewProjection);
+                }, &m_buildCounter);
+            }
+            else
+            {
+                this->BuildPyramid(next, m_projectedOccluders, viewProjection);
+            }
+        }
+
+        m_currentPyramid = 1 - m_currentPyramid;
+    }
+    else
+    {
+        m_pyramids[0].valid = false;
+
+        if(axisAligned)
+        {
+            this->BuildPyramid(m_pyramids[0], m_projectedOccluders, viewProjection);
+        }
+
+        tested = &m_pyramids[0];
+    }
+
+    // Keep all candidates without a pyramid to test against.
+    if(!tested->valid || !axisAligned)
+    {
+        m_visible = candidates;
+        return;
+    }
+
+    // Test candidates in parallel and join visible ones in order.
+    m_occluded.resize(candidates.size());
+
+    Parallel::For(m_jobSystem, (int)candidates.size(), TestGrainSize, [&](int begin, int end)
+    {
+        for(int i = begin; i < end; ++i)
+        {
+            std::size_t bounds = (std::size_t)candidates[i] * 2;
+            m_occluded[i] = this->IsOccluded(*tested, m_bounds[bounds], m_bounds[bounds + 1]) ? 1 : 0;
+        }
+    });
+
+    m_visible.clear();
+
+    for(std::size_t i = 0; i < candidates.size(); ++i)
+    {
+        if(!m_occluded[i])
+        {
+            m_visible.push_back(candidates[i]);
+        }
+    }
+}
+
+const OcclusionCuller::IndexList& OcclusionCuller::GetVisible() const
+{
+    return m_visible;
+}
+
+int OcclusionCuller::GetOccluderCount() const
+{
+    return (int)m_occluders.size() / 2;
+}
+
+bool OcclusionCuller::IsAxisAligned(const glm::mat4& viewProjection)
+{
+    // Each axis may only be scaled and translated, without a perspective divide.
+    for(int column = 0; column < 3; ++column)
+    {
+        for(int row = 0; row < 4; ++row)
+        {
+            if(row != column && viewProjection[column][row] != 0.0f)
+                return false;
+        }
+    }
+
+    return viewProjection[3][3] == 1.0f;
+}
+
+void OcclusionCuller::ProjectBox(const glm::mat4& viewProjection, const glm::vec3& minimum, const glm::vec3& maximum, glm::vec3& projectedMinimum, glm::vec3& projectedMaximum)
+{
+    // Axes are projected independently, but may be flipped.
+    glm::vec3 first(viewProjection * glm::vec4(minimum, 1.0f));
+    glm::vec3 second(viewProjection * glm::vec4(maximum, 1.0f));
+
+    projectedMinimum = glm::min(first, second);
+    projectedMaximum = glm::max(first, second);
+}
+
+void OcclusionCuller::BuildPyramid(DepthPyramid& pyramid, const std::vector<ProjectedOccluder>& occluders, const glm::mat4& viewProjection) const
+{
+    // Nothing can be hidden without occluders.
+    if(occluders.empty())
+    {
+        pyramid.valid = false;
+        return;
+    }
+
+    // Rasterize rows with the nearest depth of occluders covering their pixels.
+    std::vector<float>& pixels = pyramid.levels[0];
+
+    Parallel::For(m_jobSystem, m_height, RowGrainSize, [&](int begin, int end)
+    {
+        std::fill(pixels.begin() + (std::size_t)begin * m_width, pixels.begin() + (std::size_t)end * m_width, EmptyDepth);
+
+        for(const ProjectedOccluder& occluder : occluders)
+        {
+            int firstRow = std::max(occluder.minimumY, begin);
+            int lastRow = std::min(occluder.maximumY, end);
+
+            for(int y = firstRow; y < lastRow; ++y)
+            {
+                float* row = pixels.data() + (std::size_t)y * m_width;
+
+                for(int x = occluder.minimumX; x < occluder.maximumX; ++x)
+                {
+                    row[x] = std::min(row[x], occluder.depth);
+                }
+            }
+        }
+    });
+
+    // Reduce levels with the farthest depth of their pixels.
+    // Odd sizes clamp to the last pixel, so it is covered by the next level too.
+    for(std::size_t level = 1; level < pyramid.levels.size(); ++level)
+    {
+        const std::vector<float>& source = pyramid.levels[level - 1];
+        std::vector<float>& destination = pyramid.levels[level];
+        glm::ivec2 sourceSize = pyramid.sizes[level - 1];
+        glm::ivec2 size = pyramid.sizes[level];
+
+        Parallel::For(m_jobSystem, size.y, RowGrainSize, [&](int begin, int end)
+        {
+            for(int y = begin; y < end; ++y)
+            {
+                const float* first = source.data() + (std::size_t)std::min(y * 2, sourceSize.y - 1) * sourceSize.x;
+                const float* second = source.data() + (std::size_t)std::min(y * 2 + 1, sourceSize.y - 1) * sourceSize.x;
+
+                for(int x = 0; x < size.x; ++x)
+                {
+                    int left = std::min(x * 2, sourceSize.x - 1);
+                    int right = std::min(x * 2 + 1, sourceSize.x - 1);
+
+                    destination[(std::size_t)y * size.x + x] = std::max(
+                        std::max(first[left], first[right]),
+                        std::max(second[left], second[right]));
+                }
+            }
+        });
+    }
+
+    pyramid.viewProjection = viewProjection;
+    pyramid.valid = true;
+}
+
+bool OcclusionCuller::IsOccluded(const DepthPyramid& pyramid, const glm::vec3& minimum, const glm::vec3& maximum) const
+{
+    glm::vec3 projectedMinimum, projectedMaximum;
+    ProjectBox(pyramid.viewProjection, minimum, maximum, projectedMinimum, projectedMaximum);
+
+    // Find pixels the bounds overlap, clamped to the buffer.
+    int minimumX = std::max((int)std::floor((projectedMinimum.x * 0.5f + 0.5f) * m_width), 0);
+    int minimumY = std::max((int)std::floor((projectedMinimum.y * 0.5f + 0.5f) * m_height), 0);
+    int maximumX = std::min((int)std::ceil((projectedMaximum.x * 0.5f + 0.5f) * m_width), m_width) - 1;
+    int maximumY = std::min((int)std::ceil((projectedMaximum.y * 0.5f + 0.5f) * m_height), m_height) - 1;
+
+    if(minimumX > maximumX || minimumY > maximumY)
+        return false;
+
+    // Move up levels until the bounds span at most two pixels on each axis.
+    std::size_t level = 0;
+
+    while(level + 1 < pyramid.levels.size() && (maximumX - minimumX > 1 || maximumY - minimumY > 1))
+    {
+        minimumX /= 2;
+        minimumY /= 2;
+        maximumX /= 2;
+        maximumY /= 2;
+        level += 1;
+    }
+
+    // Bounds are hidden if they are farther than every pixel they overlap.
+    const std::vector<float>& pixels = pyramid.levels[level];
+    int width = pyramid.sizes[level].x;
+
+    for(int y = minimumY; y <= maximumY; ++y)
+    {
+        for(int x = minimumX; x <= maximumX; ++x)
+        {
+            if(projectedMinimum.z <= pixels[(std::size_t)y * width + x])
+                return false;
+        }
+    }
+
+    return true;
+}
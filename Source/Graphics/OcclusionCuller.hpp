@@ -0,0 +1,168 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/JobSystem.hpp"
+#include "FrustumCuller.hpp"
+
+//
+// Occlusion Culler
+//
+//  Removes bounds hidden behind large opaque occluders from candidates, such
+//  as those that passed frustum culling. Occluders are rasterized in software
+//  into a small depth buffer, where every pixel keeps the depth of the nearest
+//  occluder that covers it whole, and the buffer is reduced into a hierarchy
+//  of levels that keep the farthest depth of their four pixels. Bounds are tested against
+//  the level where their screen rectangle spans at most two by two pixels,
+//  and are hidden when they are farther than all of those pixels. Depth is
+//  compared in normalized device coordinates, where smaller is nearer.
+//
+//  Rows of the buffer are rasterized, levels are reduced and bounds are
+//  tested in parallel when a job system is given. Only orthographic
+//  projections without rotation, such as those used for sprites, are
+//  supported, as their boxes project to exact rectangles. Occlusion culling
+//  is skipped for other projections and every candidate stays visible.
+//
+//  With temporal reprojection, bounds are tested against the buffer built
+//  from occluders of the previous frame, projected with the view projection
+//  of that frame, while the buffer of this frame is built in a job that runs
+//  until the next test. Culling then never waits for rasterization, but
+//  objects can be hidden for a frame behind occluders that have just moved
+//  away, so it suits static occluders.
+//
+//  Example usage:
+//      Graphics::OcclusionCullerInfo info;
+//      info.jobSystem = &jobSystem;
+//
+//      Graphics::OcclusionCuller occlusionCuller;
+//      occlusionCuller.Initialize(info);
+//
+//      occlusionCuller.Clear();
+//      occlusionCuller.AddOccluder(glm::vec3(0.0f, 0.0f, 0.5f), glm::vec3(400.0f, 300.0f, 0.5f));
+//      occlusionCuller.AddBounds(glm::vec3(10.0f, 10.0f, 0.0f), glm::vec3(20.0f, 20.0f, 0.0f));
+//
+//      frustumCuller.Cull(viewProjection, &jobSystem);
+//      occlusionCuller.Cull(viewProjection, frustumCuller.GetVisible());
+//
+//      for(int index : occlusionCuller.GetVisible()) { /* ... */ }
+//
+
+namespace Graphics
+{
+    // Occlusion culler initialization struct.
+    struct OcclusionCullerInfo
+    {
+        // Optional job system that rasterization and tests are split between.
+        JobSystem* jobSystem;
+
+        // Resolution of the depth buffer.
+        int width;
+        int height;
+
+        // Tests against occluders of the previous frame while building the next buffer.
+        bool temporal;
+
+        OcclusionCullerInfo();
+    };
+
+    // Occlusion culler class.
+    class OcclusionCuller : private NonCopyable
+    {
+    public:
+        // Type declarations.
+        typedef FrustumCuller::IndexList IndexList;
+
+    public:
+        OcclusionCuller();
+        ~OcclusionCuller();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the occlusion culler instance.
+        bool Initialize(const OcclusionCullerInfo& info);
+
+        // Removes all occluders, bounds and visible indices.
+        void Clear();
+
+        // Reserves memory for a number of bounds.
+        void Reserve(int count);
+
+        // Adds a box that is opaque over its whole extent.
+        void AddOccluder(const glm::vec3& minimum, const glm::vec3& maximum);
+
+        // Adds bounds that can be hidden and returns their index.
+        int AddBounds(const glm::vec3& minimum, const glm::vec3& maximum);
+
+        // Tests bounds with indices in an ascending list, such as those visible after frustum culling.
+        void Cull(const glm::mat4& viewProjection, const IndexList& candidates);
+
+        // Gets ascending indices of bounds that were visible in the last test.
+        const IndexList& GetVisible() const;
+
+        // Gets the number of occluders added since the last clear.
+        int GetOccluderCount() const;
+
+    private:
+        // Occluder projected to pixels of the depth buffer.
+        struct ProjectedOccluder
+        {
+            int minimumX;
+            int minimumY;
+            int maximumX;
+            int maximumY;
+            float depth;
+        };
+
+        // Depth buffer with its reduced levels.
+        struct DepthPyramid
+        {
+            std::vector<std::vector<float>> levels;
+            std::vector<glm::ivec2> sizes;
+            glm::mat4 viewProjection;
+            bool valid;
+        };
+
+        // Checks if a view projection keeps boxes axis aligned.
+        static bool IsAxisAligned(const glm::mat4& viewProjection);
+
+        // Projects a box to normalized device coordinates with an axis aligned view projection.
+        static void ProjectBox(const glm::mat4& viewProjection, const glm::vec3& minimum, const glm::vec3& maximum, glm::vec3& projectedMinimum, glm::vec3& projectedMaximum);
+
+        // Rasterizes occluders and reduces levels of a depth pyramid.
+        void BuildPyramid(DepthPyramid& pyramid, const std::vector<ProjectedOccluder>& occluders, const glm::mat4& viewProjection) const;
+
+        // Checks if a box is hidden by occluders of a depth pyramid.
+        bool IsOccluded(const DepthPyramid& pyramid, const glm::vec3& minimum, const glm::vec3& maximum) const;
+
+    private:
+        // Job system that work is split between.
+        JobSystem* m_jobSystem;
+
+        // Resolution of the depth buffer.
+        int m_width;
+        int m_height;
+
+        // Occluders and bounds added since the last clear,
+        // stored as their minimum and maximum corners.
+        std::vector<glm::vec3> m_occluders;
+        std::vector<glm::vec3> m_bounds;
+
+        // Occluders of the pyramid being built.
+        std::vector<ProjectedOccluder> m_projectedOccluders;
+
+        // Pyramids that are tested and built, swapped every frame with temporal reprojection.
+        DepthPyramid m_pyramids[2];
+        int m_currentPyramid;
+
+        // Temporal reprojection state.
+        JobCounter m_buildCounter;
+        bool m_temporal;
+
+        // Hidden flags of candidates and indices of visible ones.
+        std::vector<std::uint8_t> m_occluded;
+        IndexList m_visible;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,335 @@
+#include "Precompiled.hpp"
+#include "ParticleSystem.hpp"
+#include "Common/BatchMath.hpp"
+#include "Common/Parallel.hpp"
+using namespace Graphics;
+
+namespace
+{
+    // Log message strings.
+    #define LogCreateEmitterError() "Failed to create a particle emitter! "
+
+    // Gets a random value in a range.
+    float GetRandom(std::mt19937& random, float minimum, float maximum)
+    {
+        return minimum + (maximum - minimum) * std::generate_canonical<float, 24>(random);
+    }
+}
+
+ParticleEmitterInfo::ParticleEmitterInfo() :
+    capacity(1024),
+    emitRate(64.0f),
+    minimumLifetime(1.0f),
+    maximumLifetime(2.0f),
+    minimumVelocity(-50.0f, -50.0f),
+    maximumVelocity(50.0f, 50.0f),
+    acceleration(0.0f, 0.0f),
+    startSize(8.0f),
+    endSize(0.0f),
+    startColor(1.0f, 1.0f, 1.0f, 1.0f),
+    endColor(1.0f, 1.0f, 1.0f, 0.0f),
+    texture(0),
+    textureRect(0.0f, 0.0f, 1.0f, 1.0f),
+    seed(0)
+{
+}
+
+ParticleSystemInfo::ParticleSystemInfo() :
+    jobSystem(nullptr)
+{
+}
+
+ParticleSystem::ParticleSystem() :
+    m_jobSystem(nullptr),
+    m_initialized(false)
+{
+}
+
+ParticleSystem::~ParticleSystem()
+{
+    this->Cleanup();
+}
+
+void ParticleSystem::Cleanup()
+{
+    m_jobSystem = nullptr;
+
+    Utility::ClearContainer(m_emitters);
+    Utility::ClearContainer(m_freeEmitters);
+    Utility::ClearContainer(m_ranges);
+    Utility::ClearContainer(m_rangeEmitters);
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool ParticleSystem::Initialize(const ParticleSystemInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    m_jobSystem = info.jobSystem;
+
+    // Success!
+    return m_initialized = true;
+}
+
+int ParticleSystem::CreateEmitter(const ParticleEmitterInfo& info)
+{
+    if(!m_initialized)
+        return -1;
+
+    // Validate arguments.
+    if(info.capacity <= 0)
+    {
+        LogError() << LogCreateEmitterError() << "Invalid capacity.";
+        return -1;
+    }
+
+    if(info.emitRate < 0.0f)
+    {
+        LogError() << LogCreateEmitterError() << "Invalid emit rate.";
+        return -1;
+    }
+
+    if(info.minimumLifetime <= 0.0f || info.maximumLifetime < info.minimumLifetime)
+    {
+        LogError() << LogCreateEmitterError() << "Invalid lifetime range.";
+        return -1;
+    }
+
+    // Reuse an inactive emitter along with its arrays.
+    int identifier;
+
+    if(m_freeEmitters.empty())
+    {
+        identifier = (int)m_emitters.size();
+        m_emitters.emplace_back();
+    }
+    else
+    {
+        identifier = m_freeEmitters.back();
+        m_freeEmitters.pop_back();
+    }
+
+    Emitter& emitter = m_emitters[identifier];
+    emitter.info = info;
+    emitter.position = glm::vec3(0.0f, 0.0f, 0.0f);
+    emitter.spawnDebt = 0.0f;
+    emitter.burstCount = 0;
+    emitter.active = true;
+    emitter.random.seed(info.seed);
+    emitter.count = 0;
+
+    emitter.positionsX.resize(info.capacity);
+    emitter.positionsY.resize(info.capacity);
+    emitter.velocitiesX.resize(info.capacity);
+    emitter.velocitiesY.resize(info.capacity);
+    emitter.ages.resize(info.capacity);
+    emitter.inverseLifetimes.resize(info.capacity);
+    emitter.progress.resize(info.capacity);
+
+    return identifier;
+}
+
+void ParticleSystem::DestroyEmitter(int emitter)
+{
+    if(!this->IsValid(emitter))
+        return;
+
+    m_emitters[emitter].active = false;
+    m_emitters[emitter].count = 0;
+    m_freeEmitters.push_back(emitter);
+}
+
+void ParticleSystem::SetEmitterPosition(int emitter, const glm::vec3& position)
+{
+    if(!this->IsValid(emitter))
+        return;
+
+    m_emitters[emitter].position = position;
+}
+
+void ParticleSystem::SetEmitRate(int emitter, float emitRate)
+{
+    if(!this->IsValid(emitter))
+        return;
+
+    m_emitters[emitter].info.emitRate = std::max(emitRate, 0.0f);
+}
+
+void ParticleSystem::Emit(int emitter, int count)
+{
+    if(!this->IsValid(emitter))
+        return;
+
+    m_emitters[emitter].burstCount += std::max(count, 0);
+}
+
+void ParticleSystem::Update(float timeDelta)
+{
+    if(!m_initialized)
+        return;
+
+    // Emitters are independent, so each is simulated by a single thread.
+    Parallel::For(m_jobSystem, (int)m_emitters.size(), 1, [this, timeDelta](int begin, int end)
+    {
+        for(int i = begin; i < end; ++i)
+        {
+            if(m_emitters[i].active)
+            {
+                Simulate(m_emitters[i], timeDelta);
+            }
+        }
+    });
+}
+
+void ParticleSystem::Simulate(Emitter& emitter, float timeDelta)
+{
+    const ParticleEmitterInfo& info = emitter.info;
+
+    // Age particles and remove expired ones by moving the last one in their place.
+    BatchMath::AddScalar(emitter.ages.data(), timeDelta, emitter.count);
+
+    for(int i = 0; i < emitter.count; )
+    {
+        if(emitter.ages[i] * emitter.inverseLifetimes[i] < 1.0f)
+        {
+            ++i;
+            continue;
+        }
+
+        int last = emitter.count - 1;
+        emitter.positionsX[i] = emitter.positionsX[last];
+        emitter.positionsY[i] = emitter.positionsY[last];
+        emitter.velocitiesX[i] = emitter.velocitiesX[last];
+        emitter.velocitiesY[i] = emitter.velocitiesY[last];
+        emitter.ages[i] = emitter.ages[last];
+        emitter.inverseLifetimes[i] = emitter.inverseLifetimes[last];
+        emitter.count -= 1;
+    }
+
+    // Integrate velocities and positions of live particles.
+    BatchMath::AddScalar(emitter.velocitiesX.data(), info.acceleration.x * timeDelta, emitter.count);
+    BatchMath::AddScalar(emitter.velocitiesY.data(), info.acceleration.y * timeDelta, emitter.count);
+    BatchMath::MultiplyAdd(emitter.positionsX.data(), emitter.velocitiesX.data(), timeDelta, emitter.count);
+    BatchMath::MultiplyAdd(emitter.positionsY.data(), emitter.velocitiesY.data(), timeDelta, emitter.count);
+
+    // Spawn new particles, carrying fractions over to the next update.
+    emitter.spawnDebt += info.emitRate * timeDelta;
+
+    int spawnCount = (int)emitter.spawnDebt;
+    emitter.spawnDebt -= (float)spawnCount;
+
+    spawnCount += emitter.burstCount;
+    emitter.burstCount = 0;
+
+    spawnCount = std::min(spawnCount, info.capacity - emitter.count);
+
+    for(int i = 0; i < spawnCount; ++i)
+    {
+        int index = emitter.count + i;
+
+        emitter.positionsX[index] = emitter.position.x;
+        emitter.positionsY[index] = emitter.position.y;
+        emitter.velocitiesX[index] = GetRandom(emitter.random, info.minimumVelocity.x, info.maximumVelocity.x);
+        emitter.velocitiesY[index] = GetRandom(emitter.random, info.minimumVelocity.y, info.maximumVelocity.y);
+        emitter.ages[index] = 0.0f;
+        emitter.inverseLifetimes[index] = 1.0f / GetRandom(emitter.random, info.minimumLifetime, info.maximumLifetime);
+    }
+
+    emitter.count += spawnCount;
+}
+
+int ParticleSystem::Write(SpriteInstance* destination, int capacity)
+{
+    m_ranges.clear();
+    m_rangeEmitters.clear();
+
+    if(!m_initialized)
+        return 0;
+
+    // Assign consecutive ranges to emitters with live particles.
+    int total = 0;
+
+    for(std::size_t i = 0; i < m_emitters.size() && total < capacity; ++i)
+    {
+        const Emitter& emitter = m_emitters[i];
+
+        if(!emitter.active || emitter.count == 0)
+            continue;
+
+        ParticleRange range;
+        range.texture = emitter.info.texture;
+        range.first = total;
+        range.count = std::min(emitter.count, capacity - total);
+
+        m_ranges.push_back(range);
+        m_rangeEmitters.push_back((int)i);
+
+        total += range.count;
+    }
+
+    // Write ranges of emitters in parallel.
+    Parallel::For(m_jobSystem, (int)m_ranges.size(), 1, [&](int begin, int end)
+    {
+        for(int i = begin; i < end; ++i)
+        {
+            WriteInstances(m_emitters[m_rangeEmitters[i]], destination + m_ranges[i].first, m_ranges[i].count);
+        }
+    });
+
+    return total;
+}
+
+void ParticleSystem::WriteInstances(Emitter& emitter, SpriteInstance* destination, int count)
+{
+    const ParticleEmitterInfo& info = emitter.info;
+
+    // Calculate how far particles are through their lifetimes.
+    BatchMath::Multiply(emitter.ages.data(), emitter.inverseLifetimes.data(), emitter.progress.data(), count);
+
+    // Whole instances are written in order, as the destination may be write combined memory.
+    for(int i = 0; i < count; ++i)
+    {
+        float progress = std::min(emitter.progress[i], 1.0f);
+        float size = info.startSize + (info.endSize - info.startSize) * progress;
+
+        SpriteInstance instance;
+        instance.position = glm::vec2(emitter.positionsX[i], emitter.positionsY[i]);
+        instance.size = glm::vec2(size, size);
+        instance.rotation = 0.0f;
+        instance.depth = emitter.position.z;
+        instance.color = glm::mix(info.startColor, info.endColor, progress);
+        instance.textureRect = info.textureRect;
+
+        destination[i] = instance;
+    }
+}
+
+const std::vector<ParticleRange>& ParticleSystem::GetRanges() const
+{
+    return m_ranges;
+}
+
+int ParticleSystem::GetParticleCount() const
+{
+    int count = 0;
+
+    for(const Emitter& emitter : m_emitters)
+    {
+        count += emitter.active ? emitter.count : 0;
+    }
+
+    return count;
+}
+
+int ParticleSystem::GetEmitterCount() const
+{
+    return (int)(m_emitters.size() - m_freeEmitters.size());
+}
+
+bool ParticleSystem::IsValid(int emitter) const
+{
+    return m_initialized && emitter >= 0 && emitter < (int)m_emitters.size() && m_emitters[emitter].active;
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/JobSystem.hpp"
+#include "SpriteBatch.hpp"
+
+//
+// Particle System
+//
+//  Simulates short lived particles without creating entities for them.
+//  Particles belong to emitters, which store them as a structure of arrays
+//  with a fixed capacity allocated once. Emitters are pooled, so destroyed
+//  ones keep their arrays for the next emitter that is created.
+//
+//  Updating splits emitters between threads of the job system, and each
+//  emitter ages, removes, integrates and spawns its particles with batch
+//  math kernels over its arrays. Every emitter has its own random engine,
+//  so results don't depend on how emitters are split between threads.
+//
+//  The sprite batch draws particles after sprites by having them written
+//  straight into its instance buffer, which is persistently mapped when the
+//  context supports it, with one draw call per emitter. Particle positions
+//  are in world space, so particles stay behind when emitters are moved.
+//
+//  Example usage:
+//      Graphics::ParticleSystemInfo info;
+//      info.jobSystem = &jobSystem;
+//
+//      Graphics::ParticleSystem particleSystem;
+//      particleSystem.Initialize(info);
+//
+//      Graphics::ParticleEmitterInfo emitterInfo;
+//      emitterInfo.emitRate = 200.0f;
+//      emitterInfo.acceleration = glm::vec2(0.0f, -100.0f);
+//
+//      int emitter = particleSystem.CreateEmitter(emitterInfo);
+//      particleSystem.SetEmitterPosition(emitter, glm::vec3(100.0f, 100.0f, 0.0f));
+//
+//      spriteBatchInfo.particleSystem = &particleSystem;
+//
+//      while(window.IsOpen())
+//      {
+//          particleSystem.Update(timeDelta);
+//          spriteBatch.Draw(commands, viewProjection);
+//      }
+//
+
+namespace Graphics
+{
+    // Particle emitter initialization struct.
+    struct ParticleEmitterInfo
+    {
+        // Maximum number of live particles.
+        int capacity;
+
+        // Number of particles spawned per second.
+        float emitRate;
+
+        // Range of lifetimes in seconds.
+        float minimumLifetime;
+        float maximumLifetime;
+
+        // Range of initial velocities.
+        glm::vec2 minimumVelocity;
+        glm::vec2 maximumVelocity;
+
+        // Constant acceleration, such as gravity.
+        glm::vec2 acceleration;
+
+        // Size and color at the start and end of lifetimes.
+        float startSize;
+        float endSize;
+        glm::vec4 startColor;
+        glm::vec4 endColor;
+
+        // Texture and its coordinates, such as a region of an atlas.
+        GLuint texture;
+        glm::vec4 textureRect;
+
+        // Seed of the random engine.
+        std::uint32_t seed;
+
+        ParticleEmitterInfo();
+    };
+
+    // Particle system initialization struct.
+    struct ParticleSystemInfo
+    {
+        // Optional job system that emitters are split between.
+        JobSystem* jobSystem;
+
+        ParticleSystemInfo();
+    };
+
+    // Range of instances written for an emitter.
+    struct ParticleRange
+    {
+        GLuint texture;
+        int first;
+        int count;
+    };
+
+    // Particle system class.
+    class ParticleSystem : private NonCopyable
+    {
+    public:
+        ParticleSystem();
+        ~ParticleSystem();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the particle system instance.
+        bool Initialize(const ParticleSystemInfo& info = ParticleSystemInfo());
+
+        // Creates an emitter and returns its identifier, or -1 on failure.
+        int CreateEmitter(const ParticleEmitterInfo& info);
+
+        // Destroys an emitter along with its particles.
+        void DestroyEmitter(int emitter);
+
+        // Sets the position particles are spawned at.
+        // The z coordinate is used as the depth of particles.
+        void SetEmitterPosition(int emitter, const glm::vec3& position);
+
+        // Sets the number of particles spawned per second.
+        void SetEmitRate(int emitter, float emitRate);
+
+        // Spawns a number of particles at the next update.
+        void Emit(int emitter, int count);
+
+        // Simulates particles over a time.
+        void Update(float timeDelta);
+
+        // Writes instances of live particles grouped by emitter, up to a capacity.
+        // Returns the number of written instances.
+        int Write(SpriteInstance* destination, int capacity);
+
+        // Gets ranges of emitters written in the last call.
+        const std::vector<ParticleRange>& GetRanges() const;
+
+        // Gets the number of live particles.
+        int GetParticleCount() const;
+
+        // Gets the number of emitters.
+        int GetEmitterCount() const;
+
+    private:
+        // Emitter with particles stored as a structure of arrays.
+        struct Emitter
+        {
+            ParticleEmitterInfo info;
+            glm::vec3 position;
+            float spawnDebt;
+            int burstCount;
+            bool active;
+
+            std::mt19937 random;
+
+            std::vector<float> positionsX;
+            std::vector<float> positionsY;
+            std::vector<float> velocitiesX;
+            std::vector<float> velocitiesY;
+            std::vector<float> ages;
+            std::vector<float> inverseLifetimes;
+            std::vector<float> progress;
+            int count;
+        };
+
+        // Checks if an identifier refers to an active emitter.
+        bool IsValid(int emitter) const;
+
+        // Simulates particles of an emitter.
+        static void Simulate(Emitter& emitter, float timeDelta);
+
+        // Writes instances of particles of an emitter.
+        static void WriteInstances(Emitter& emitter, SpriteInstance* destination, int count);
+
+    private:
+        // Job system that emitters are split between.
+        JobSystem* m_jobSystem;
+
+        // Pooled emitters and identifiers of inactive ones.
+        std::vector<Emitter> m_emitters;
+        std::vector<int> m_freeEmitters;
+
+        // Ranges written in the last call and their emitters.
+        std::vector<ParticleRange> m_ranges;
+        std::vector<int> m_rangeEmitters;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,431 @@
+#include "Precompiled.hpp"
+#include "PerformanceOverlay.hpp"
+#include "Common/MemoryTracker.hpp"
+#include "System/Clock.hpp"
+using namespace Graphics;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize the performance overlay! "
+
+    // Layout in pixels.
+    const float Margin = 10.0f;
+    const float Padding = 8.0f;
+    const float ContentWidth = 300.0f;
+    const float TextSize = 10.0f;
+    const float RowHeight = 16.0f;
+    const float GraphHeight = 80.0f;
+    const float LabelWidth = 96.0f;
+    const float BarWidth = 140.0f;
+
+    // Number of recent frames that phase times are averaged over.
+    const int PhaseAverageFrames = 30;
+
+    // Factor that smooths worker utilization between frames.
+    const float UtilizationSmoothing = 0.1f;
+
+    // Colors of overlay elements.
+    const glm::vec4 BackgroundColor(0.0f, 0.0f, 0.0f, 0.6f);
+    const glm::vec4 TextColor(1.0f, 1.0f, 1.0f, 1.0f);
+    const glm::vec4 OutlineColor(0.5f, 0.5f, 0.5f, 1.0f);
+    const glm::vec4 BudgetColor(1.0f, 0.85f, 0.3f, 1.0f);
+    const glm::vec4 WithinBudgetColor(0.3f, 0.9f, 0.3f, 1.0f);
+    const glm::vec4 OverBudgetColor(1.0f, 0.3f, 0.3f, 1.0f);
+    const glm::vec4 WorkerColor(0.3f, 0.6f, 1.0f, 1.0f);
+}
+
+PerformanceOverlayInfo::PerformanceOverlayInfo() :
+    renderer(nullptr),
+    programCache(nullptr),
+    window(nullptr),
+    frameStatistics(nullptr),
+    entitySystem(nullptr),
+    jobSystem(nullptr),
+    memoryLayout(nullptr),
+    toggleKey(GLFW_KEY_F3),
+    frameBudget(1.0f / 60.0f),
+    visible(false)
+{
+}
+
+PerformanceOverlay::PerformanceOverlay() :
+    m_frameStatistics(nullptr),
+    m_entitySystem(nullptr),
+    m_jobSystem(nullptr),
+    m_memoryLayout(nullptr),
+    m_frameBudget(0.0f),
+    m_ticks(0),
+    m_visible(false),
+    m_initialized(false)
+{
+}
+
+PerformanceOverlay::~PerformanceOverlay()
+{
+    this->Cleanup();
+}
+
+void PerformanceOverlay::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    m_keyboardKey.Cleanup();
+    m_debugDraw.Cleanup();
+
+    m_frameStatistics = nullptr;
+    m_entitySystem = nullptr;
+    m_jobSystem = nullptr;
+    m_memoryLayout = nullptr;
+    m_frameBudget = 0.0f;
+
+    Utility::ClearContainer(m_idleTicks);
+    Utility::ClearContainer(m_utilization);
+    m_ticks = 0;
+
+    m_visible = false;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool PerformanceOverlay::Initialize(const PerformanceOverlayInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            m_initialized = true;
+            this->Cleanup();
+        }
+    );
+
+    // Validate arguments.
+    if(info.frameBudget <= 0.0f)
+    {
+        LogError() << LogInitializeError() << "Invalid frame budget.";
+        return false;
+    }
+
+    // Initialize the debug draw that the overlay is drawn with.
+    DebugDrawInfo debugDrawInfo;
+    debugDrawInfo.renderer = info.renderer;
+    debugDrawInfo.programCache = info.programCache;
+    debugDrawInfo.capacity = 64 * 1024;
+
+    if(!m_debugDraw.Initialize(debugDrawInfo))
+    {
+        LogError() << LogInitializeError() << "Couldn't initialize the debug draw.";
+        return false;
+    }
+
+    m_frameStatistics = info.frameStatistics;
+    m_entitySystem = info.entitySystem;
+    m_jobSystem = info.jobSystem;
+    m_memoryLayout = info.memoryLayout;
+    m_frameBudget = info.frameBudget;
+    m_visible = info.visible;
+
+    // Receive presses of the toggle key.
+    if(info.window != nullptr)
+    {
+        m_keyboardKey.Bind<PerformanceOverlay, &PerformanceOverlay::OnKeyboardKey>(this);
+        m_keyboardKey.SetKey(info.toggleKey);
+        m_keyboardKey.Subscribe(info.window->events.keyboardKey);
+    }
+
+    // Success!
+    return m_initialized = true;
+}
+
+void PerformanceOverlay::Draw(CommandBuffer& commands, int width, int height)
+{
+    if(!m_initialized || !m_visible)
+        return;
+
+    this->UpdateUtilization();
+
+    // Count rows of displayed sections to size the background.
+    bool memoryTracking = MemoryTracker::IsEnabled();
+    int workerCount = (int)m_utilization.size();
+
+    int rowCount = 0;
+    float contentHeight = 0.0f;
+
+    if(m_frameStatistics != nullptr)
+    {
+        rowCount += 1 + System::FramePhases::Count;
+        contentHeight += GraphHeight + Padding;
+    }
+
+    if(m_entitySystem != nullptr)
+    {
+        rowCount += 1;
+    }
+
+    if(m_memoryLayout != nullptr)
+    {
+        rowCount += 3 + (int)m_memoryLayout->systems.size();
+    }
+
+    if(memoryTracking)
+    {
+        rowCount += 1 + MemoryTags::Count;
+    }
+
+    rowCount += workerCount;
+    contentHeight += rowCount * RowHeight;
+
+    // Anchor the panel to the top left corner, with y pointing up.
+    float left = Margin + Padding;
+    float top = (float)height - Margin - Padding;
+
+    m_debugDraw.Rectangle(
+        glm::vec3(Margin, top - contentHeight - Padding, 0.0f),
+        glm::vec3(Margin + ContentWidth + Padding * 2.0f, (float)height - Margin, 0.0f),
+        BackgroundColor);
+
+    // Formats into a fixed buffer, so the overlay doesn't allocate while drawing.
+    char text[128];
+    float cursor = top;
+
+    auto addRow = [&](const glm::vec4& color)
+    {
+        cursor -= RowHeight;
+        m_debugDraw.Text(glm::vec3(left, cursor + (RowHeight - TextSize) * 0.5f, 0.0f), text, TextSize, color);
+    };
+
+    // Draw a graph of recent frame times against the frame budget,
+    // which is placed halfway up, with the newest frame on the right.
+    if(m_frameStatistics != nullptr)
+    {
+        std::size_t frameCount = m_frameStatistics->GetRecentFrameCount();
+        std::size_t graphFrames = std::min(frameCount, (std::size_t)ContentWidth);
+
+        double lastFrameTime = frameCount != 0 ? m_frameStatistics->GetRecentFrameTime(frameCount - 1) : 0.0;
+        double maximumFrameTime = 0.0;
+
+        for(std::size_t i = frameCount - graphFrames; i < frameCount; ++i)
+        {
+            maximumFrameTime = std::max(maximumFrameTime, m_frameStatistics->GetRecentFrameTime(i));
+        }
+
+        std::snprintf(text, sizeof(text), "FRAME %.2f MS  MAX %.2f MS  HITCHES %llu",
+            lastFrameTime * 1000.0, maximumFrameTime * 1000.0, (unsigned long long)m_frameStatistics->GetHitchCount());
+
+        addRow(TextColor);
+
+        cursor -= GraphHeight + Padding;
+        float graphBottom = cursor;
+
+        for(std::size_t i = 0; i < graphFrames; ++i)
+        {
+            double frameTime = m_frameStatistics->GetRecentFrameTime(frameCount - graphFrames + i);
+            float barHeight = std::min((float)frameTime / (m_frameBudget * 2.0f), 1.0f) * GraphHeight;
+            float x = left + ContentWidth - (float)(graphFrames - i) + 0.5f;
+
+            m_debugDraw.Line(glm::vec3(x, graphBottom, 0.0f), glm::vec3(x, graphBottom + barHeight, 0.0f),
+                frameTime > m_frameBudget ? OverBudgetColor : WithinBudgetColor);
+        }
+
+        float budgetY = graphBottom + GraphHeight * 0.5f;
+        m_debugDraw.Line(glm::vec3(left, budgetY, 0.0f), glm::vec3(left + ContentWidth, budgetY, 0.0f), BudgetColor);
+        this->AddBar(glm::vec2(left, graphBottom), glm::vec2(ContentWidth, GraphHeight), 0.0f, OutlineColor);
+
+        // Draw bars of phase times averaged over recent frames.
+        std::size_t averageFrames = std::min(frameCount, (std::size_t)PhaseAverageFrames);
+
+        for(int phase = 0; phase < System::FramePhases::Count; ++phase)
+        {
+            double phaseTime = 0.0;
+
+            for(std::size_t i = frameCount - averageFrames; i < frameCount; ++i)
+            {
+                phaseTime += m_frameStatistics->GetRecentPhaseTime(i, (System::FramePhases::Type)phase);
+            }
+
+            phaseTime /= (double)std::max<std::size_t>(averageFrames, 1);
+
+            std::snprintf(text, sizeof(text), "%s", System::FrameStatistics::GetPhaseName((System::FramePhases::Type)phase));
+            addRow(TextColor);
+
+            float fill = (float)phaseTime / m_frameBudget;
+            this->AddBar(glm::vec2(left + LabelWidth, cursor + 3.0f), glm::vec2(BarWidth, RowHeight - 6.0f),
+                fill, fill > 1.0f ? OverBudgetColor : WithinBudgetColor);
+
+            std::snprintf(text, sizeof(text), "%.2f MS", phaseTime * 1000.0);
+            m_debugDraw.Text(glm::vec3(left + LabelWidth + BarWidth + Padding, cursor + (RowHeight - TextSize) * 0.5f, 0.0f), text, TextSize, TextColor);
+        }
+    }
+
+    // Write the number of entities.
+    if(m_entitySystem != nullptr)
+    {
+        std::snprintf(text, sizeof(text), "ENTITIES %d", m_entitySystem->GetEntityCount());
+        addRow(TextColor);
+    }
+
+    // Draw bars of component storage occupancy and write estimated bytes touched by systems.
+    if(m_memoryLayout != nullptr)
+    {
+        const Game::MemoryLayoutReport& layout = *m_memoryLayout;
+
+        auto addOccupancyRow = [&](const char* label, std::size_t usedBytes, std::size_t allocatedBytes)
+        {
+            std::snprintf(text, sizeof(text), "%s", label);
+            addRow(TextColor);
+
+            float occupancy = allocatedBytes != 0 ? (float)usedBytes / (float)allocatedBytes : 0.0f;
+            this->AddBar(glm::vec2(left + LabelWidth, cursor + 3.0f), glm::vec2(BarWidth, RowHeight - 6.0f),
+                occupancy, WithinBudgetColor);
+
+            std::snprintf(text, sizeof(text), "%.0f%% %.0f KB", occupancy * 100.0f, allocatedBytes / 1024.0);
+            m_debugDraw.Text(glm::vec3(left + LabelWidth + BarWidth + Padding, cursor + (RowHeight - TextSize) * 0.5f, 0.0f), text, TextSize, TextColor);
+        };
+
+        addOccupancyRow("CHUNKS", layout.chunkUsedBytes, layout.chunkAllocatedBytes);
+        addOccupancyRow("POOLS", layout.poolUsedBytes, layout.poolAllocatedBytes);
+
+        std::snprintf(text, sizeof(text), "ARCHETYPES %d  FREE HANDLES %d/%d  HOLES %d", (int)layout.archetypes.size(),
+            layout.freeHandleCount, layout.handleCount, layout.locationHoles);
+        addRow(TextColor);
+
+        for(const Game::SystemLayout& system : layout.systems)
+        {
+            std::snprintf(text, sizeof(text), "  %-10.10s R %.1f KB  W %.1f KB", system.name.c_str(),
+                system.readBytes / 1024.0, system.writtenBytes / 1024.0);
+            addRow(TextColor);
+        }
+    }
+
+    // Write allocations of the last ended frame by tag.
+    if(memoryTracking)
+    {
+        MemoryTracker::Statistics total;
+        MemoryTracker::Statistics statistics[MemoryTags::Count];
+
+        for(int tag = 0; tag < MemoryTags::Count; ++tag)
+        {
+            statistics[tag] = MemoryTracker::GetStatistics((MemoryTags::Type)tag);
+            total.frameAllocations += statistics[tag].frameAllocations;
+            total.frameBytes += statistics[tag].frameBytes;
+        }
+
+        std::snprintf(text, sizeof(text), "ALLOCATIONS %llu  %.1f KB",
+            (unsigned long long)total.frameAllocations, total.frameBytes / 1024.0);
+        addRow(TextColor);
+
+        for(int tag = 0; tag < MemoryTags::Count; ++tag)
+        {
+            std::snprintf(text, sizeof(text), "  %-10s %6llu  %.1f KB", MemoryTracker::GetTagName((MemoryTags::Type)tag),
+                (unsigned long long)statistics[tag].frameAllocations, statistics[tag].frameBytes / 1024.0);
+
+            bool overBudget = statistics[tag].frameBudget != 0 && statistics[tag].frameAllocations > statistics[tag].frameBudget;
+            addRow(overBudget ? OverBudgetColor : TextColor);
+        }
+    }
+
+    // Draw bars of worker utilization.
+    for(int worker = 0; worker < workerCount; ++worker)
+    {
+        std::snprintf(text, sizeof(text), "WORKER %d", worker + 1);
+        addRow(TextColor);
+
+        this->AddBar(glm::vec2(left + LabelWidth, cursor + 3.0f), glm::vec2(BarWidth, RowHeight - 6.0f),
+            m_utilization[worker], WorkerColor);
+
+        std::snprintf(text, sizeof(text), "%.0f%%", m_utilization[worker] * 100.0f);
+        m_debugDraw.Text(glm::vec3(left + LabelWidth + BarWidth + Padding, cursor + (RowHeight - TextSize) * 0.5f, 0.0f), text, TextSize, TextColor);
+    }
+
+    // Draw the overlay in window coordinates.
+    glm::mat4 viewProjection = glm::ortho(0.0f, (float)width, 0.0f, (float)height, -1.0f, 1.0f);
+    m_debugDraw.Draw(commands, viewProjection);
+}
+
+void PerformanceOverlay::SetVisible(bool visible)
+{
+    if(m_visible == visible)
+        return;
+
+    // Start measuring utilization anew when shown.
+    m_visible = visible;
+    m_ticks = 0;
+}
+
+bool PerformanceOverlay::IsVisible() const
+{
+    return m_visible;
+}
+
+void PerformanceOverlay::OnKeyboardKey(const System::Window::Events::KeyboardKey& event)
+{
+    if(event.action == GLFW_PRESS)
+    {
+        this->SetVisible(!m_visible);
+    }
+}
+
+void PerformanceOverlay::UpdateUtilization()
+{
+    if(m_jobSystem == nullptr)
+        return;
+
+    // Workers follow the initializing thread in participant indices.
+    int workerCount = m_jobSystem->GetWorkerCount();
+
+    if((int)m_utilization.size() != workerCount)
+    {
+        m_idleTicks.assign(workerCount, 0);
+        m_utilization.assign(workerCount, 0.0f);
+        m_ticks = 0;
+    }
+
+    std::uint64_t ticks = System::Clock::ReadTicks();
+
+    for(int worker = 0; worker < workerCount; ++worker)
+    {
+        std::uint64_t idleTicks = m_jobSystem->GetIdleTicks(worker + 1);
+
+        if(m_ticks != 0 && ticks > m_ticks)
+        {
+            double idleShare = (double)(idleTicks - std::min(idleTicks, m_idleTicks[worker])) / (double)(ticks - m_ticks);
+            float utilization = (float)(1.0 - std::min(idleShare, 1.0));
+
+            m_utilization[worker] += (utilization - m_utilization[worker]) * UtilizationSmoothing;
+        }
+
+        m_idleTicks[worker] = idleTicks;
+    }
+
+    m_ticks = ticks;
+}
+
+void PerformanceOverlay::AddBar(const glm::vec2& position, const glm::vec2& size, float fill, const glm::vec4& color)
+{
+    // Fill the bar up to its width and outline it.
+    float fillWidth = size.x * glm::clamp(fill, 0.0f, 1.0f);
+
+    if(fillWidth > 0.0f)
+    {
+        m_debugDraw.Rectangle(glm::vec3(position, 0.0f), glm::vec3(position.x + fillWidth, position.y + size.y, 0.0f), color);
+    }
+
+    glm::vec3 corners[4] =
+    {
+        glm::vec3(position.x, position.y, 0.0f),
+        glm::vec3(position.x + size.x, position.y, 0.0f),
+        glm::vec3(position.x + size.x, position.y + size.y, 0.0f),
+        glm::vec3(position.x, position.y + size.y, 0.0f),
+    };
+
+    for(int i = 0; i < 4; ++i)
+    {
+        m_debugDraw.Line(corners[i], corners[(i + 1) % 4], OutlineColor);
+    }
+}
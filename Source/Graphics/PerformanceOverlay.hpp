@@ -0,0 +1,136 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/JobSystem.hpp"
+#include "System/Window.hpp"
+#include "System/FrameStatistics.hpp"
+#include "Game/EntitySystem.hpp"
+#include "Game/MemoryLayoutInspector.hpp"
+#include "DebugDraw.hpp"
+
+//
+// Performance Overlay
+//
+//  Draws live performance data over the frame in the window, so changes
+//  can be seen while playing instead of after reading logs or traces.
+//  It shows a graph of recent frame times against the frame budget, bars
+//  of phase times averaged over recent frames, the number of entities,
+//  allocations per frame of every memory tag and utilization of every
+//  worker of the job system. A memory layout report adds occupancy of
+//  component chunks and pools, free handles and estimated bytes touched
+//  by each system. Sources that are not set are skipped.
+//
+//  The overlay has its own debug draw instance, so it is available even
+//  when debug draw macros are compiled out, and formats text into fixed
+//  buffers, so drawing it does not add to allocations it reports. It is
+//  toggled with a key and only measures worker utilization while visible.
+//
+//  Example usage:
+//      Graphics::PerformanceOverlayInfo info;
+//      info.renderer = &renderer;
+//      info.window = &window;
+//      info.frameStatistics = &frameStatistics;
+//      info.entitySystem = &entitySystem;
+//      info.jobSystem = &jobSystem;
+//
+//      Graphics::PerformanceOverlay overlay;
+//      overlay.Initialize(info);
+//
+//      overlay.Draw(commands, window.GetWidth(), window.GetHeight());
+//      renderer.Submit();
+//
+
+namespace Graphics
+{
+    // Performance overlay initialization struct.
+    struct PerformanceOverlayInfo
+    {
+        // Renderer that executes draws.
+        Renderer* renderer;
+
+        // Optional cache of program binaries.
+        ProgramCache* programCache;
+
+        // Optional window whose key events toggle the overlay.
+        System::Window* window;
+
+        // Optional sources of displayed data.
+        const System::FrameStatistics* frameStatistics;
+        const Game::EntitySystem* entitySystem;
+        const JobSystem* jobSystem;
+        const Game::MemoryLayoutReport* memoryLayout;
+
+        // Key that toggles the overlay.
+        int toggleKey;
+
+        // Frame time in seconds that graphs and bars are measured against.
+        float frameBudget;
+
+        // Initial visibility.
+        bool visible;
+
+        PerformanceOverlayInfo();
+    };
+
+    // Performance overlay class.
+    class PerformanceOverlay : private NonCopyable
+    {
+    public:
+        PerformanceOverlay();
+        ~PerformanceOverlay();
+
+        // Restores instance to its original state.
+        // Must be called before the renderer is cleaned up.
+        void Cleanup();
+
+        // Initializes the performance overlay instance.
+        bool Initialize(const PerformanceOverlayInfo& info);
+
+        // Records draws of the overlay in window coordinates, if it is visible.
+        // Has to be called at most once per submitted frame.
+        void Draw(CommandBuffer& commands, int width, int height);
+
+        // Sets the visibility of the overlay.
+        void SetVisible(bool visible);
+
+        // Checks if the overlay is visible.
+        bool IsVisible() const;
+
+    private:
+        // Toggles the overlay on key presses.
+        void OnKeyboardKey(const System::Window::Events::KeyboardKey& event);
+
+        // Measures utilization of workers since the previous call.
+        void UpdateUtilization();
+
+        // Adds a bar with its fill and outline.
+        void AddBar(const glm::vec2& position, const glm::vec2& size, float fill, const glm::vec4& color);
+
+    private:
+        // Debug draw instance that the overlay is drawn with.
+        DebugDraw m_debugDraw;
+
+        // Receiver of key events.
+        Receiver<void(const System::Window::Events::KeyboardKey&)> m_keyboardKey;
+
+        // Sources of displayed data.
+        const System::FrameStatistics* m_frameStatistics;
+        const Game::EntitySystem* m_entitySystem;
+        const JobSystem* m_jobSystem;
+        const Game::MemoryLayoutReport* m_memoryLayout;
+
+        // Frame time that graphs and bars are measured against.
+        float m_frameBudget;
+
+        // Idle ticks of workers and clock ticks at the previous measurement.
+        std::vector<std::uint64_t> m_idleTicks;
+        std::vector<float> m_utilization;
+        std::uint64_t m_ticks;
+
+        // Visibility state.
+        bool m_visible;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,434 @@
+#include "Precompiled.hpp"
+#include "ProgramCache.hpp"
+#include "Common/BinaryStream.hpp"
+#include "Common/MappedFile.hpp"
+using namespace Graphics;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize a program cache! "
+    #define LogSaveError(filename) "Failed to save a program cache to \"" << filename << "\" file! "
+    #define LogLinkError(name) "Failed to link \"" << name << "\" program! "
+
+    // File format.
+    const std::uint32_t FileMagic   = 0x43475250; // "PRGC"
+    const std::uint32_t FileVersion = 1;
+
+    // Hashes bytes with the 64bit FNV-1a function.
+    const std::uint64_t HashBasis = 0xcbf29ce484222325ULL;
+
+    std::uint64_t HashBytes(std::uint64_t hash, const void* data, std::size_t size)
+    {
+        const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(data);
+
+        for(std::size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ULL;
+        }
+
+        return hash;
+    }
+
+    std::uint64_t HashString(std::uint64_t hash, const char* string)
+    {
+        return HashBytes(hash, string, string != nullptr ? std::strlen(string) : 0);
+    }
+
+    // Calls a function for each part of a stage source.
+    template<typename Function>
+    void ForEachPart(const ShaderStage& stage, Function function)
+    {
+        if(stage.partCount == 0)
+        {
+            function(stage.source, std::strlen(stage.source));
+            return;
+        }
+
+        for(int i = 0; i < stage.partCount; ++i)
+        {
+            bool terminated = stage.lengths == nullptr || stage.lengths[i] < 0;
+            function(stage.parts[i], terminated ? std::strlen(stage.parts[i]) : (std::size_t)stage.lengths[i]);
+        }
+    }
+
+    // Compiles a shader stage and logs its errors.
+    GLuint CompileShader(const ShaderStage& stage, const char* name)
+    {
+        GLuint shader = glCreateShader(stage.type);
+
+        if(stage.partCount == 0)
+        {
+            glShaderSource(shader, 1, &stage.source, nullptr);
+        }
+        else
+        {
+            glShaderSource(shader, stage.partCount, stage.parts, stage.lengths);
+        }
+
+        glCompileShader(shader);
+
+        GLint compiled = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+
+        if(compiled != GL_TRUE)
+        {
+            char errorLog[1024] = { 0 };
+            glGetShaderInfoLog(shader, sizeof(errorLog), nullptr, errorLog);
+
+            LogError() << LogLinkError(name) << "Couldn't compile a shader: " << errorLog;
+
+            glDeleteShader(shader);
+            return 0;
+        }
+
+        return shader;
+    }
+
+    // Checks the link status of a program.
+    bool IsLinked(GLuint program)
+    {
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        return linked == GL_TRUE;
+    }
+}
+
+ShaderStage::ShaderStage() :
+    type(GL_VERTEX_SHADER),
+    parts(nullptr),
+    lengths(nullptr),
+    partCount(0),
+    source("")
+{
+}
+
+ProgramCacheInfo::ProgramCacheInfo() :
+    filename("Programs.cache")
+{
+}
+
+ProgramCache::ProgramCache() :
+    m_modified(false),
+    m_driverHash(0),
+    m_driverHashed(false),
+    m_hitCount(0),
+    m_missCount(0),
+    m_initialized(false)
+{
+}
+
+ProgramCache::~ProgramCache()
+{
+    this->Cleanup();
+}
+
+void ProgramCache::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    m_filename.clear();
+
+    Utility::ClearContainer(m_binaries);
+    m_modified = false;
+
+    m_driverHash = 0;
+    m_driverHashed = false;
+
+    m_hitCount = 0;
+    m_missCount = 0;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool ProgramCache::Initialize(const ProgramCacheInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.filename.empty())
+    {
+        LogError() << LogInitializeError() << "Invalid filename.";
+        return false;
+    }
+
+    m_filename = info.filename;
+
+    // Read kept binaries straight from the mapped file.
+    // Check if the file exists first, as a missing cache is expected.
+    MappedFile file;
+
+    if(std::ifstream(m_filename).good() && file.Open(m_filename) && file.GetSize() != 0)
+    {
+        BinaryReader reader(file.GetData(), file.GetSize());
+
+        std::uint32_t magic = 0;
+        std::uint32_t version = 0;
+        std::uint32_t count = 0;
+
+        reader.Read(magic);
+        reader.Read(version);
+        reader.Read(count);
+
+        bool valid = reader.IsValid() && magic == FileMagic && version == FileVersion;
+
+        for(std::uint32_t i = 0; valid && i < count; ++i)
+        {
+            std::uint64_t key = 0;
+            std::uint32_t format = 0;
+
+            reader.Read(key);
+            reader.Read(format);
+
+            std::size_t size = 0;
+            const std::uint8_t* data = reader.ReadArray<std::uint8_t>(size);
+
+            if(!reader.IsValid())
+                break;
+
+            Binary& binary = m_binaries[key];
+            binary.format = format;
+            binary.data.assign(data, data + size);
+        }
+
+        if(!valid || !reader.IsValid())
+        {
+            LogWarning() << "Ignoring an invalid program cache file \"" << m_filename << "\".";
+            m_binaries.clear();
+        }
+    }
+
+    // Success!
+    return m_initialized = true;
+}
+
+GLuint ProgramCache::Link(const ShaderStage* stages, int stageCount, const char* name)
+{
+    if(!m_initialized || !IsSupported())
+        return CompileAndLink(stages, stageCount, name);
+
+    std::uint64_t key = this->CalculateKey(stages, stageCount);
+
+    // Try to load a kept binary.
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        auto it = m_binaries.find(key);
+
+        if(it != m_binaries.end())
+        {
+            GLuint program = glCreateProgram();
+            glProgramBinary(program, it->second.format, it->second.data.data(), (GLsizei)it->second.data.size());
+
+            if(IsLinked(program))
+            {
+                m_hitCount += 1;
+                return program;
+            }
+
+            // Drop binaries that the driver rejects.
+            glDeleteProgram(program);
+
+            m_binaries.erase(it);
+            m_modified = true;
+        }
+
+        m_missCount += 1;
+    }
+
+    // Compile and link the program and keep its binary.
+    GLuint program = CompileAndLink(stages, stageCount, name);
+
+    if(program == 0)
+        return 0;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+
+    if(length > 0)
+    {
+        Binary binary;
+        binary.data.resize(length);
+
+        GLsizei written = 0;
+        glGetProgramBinary(program, length, &written, &binary.format, binary.data.data());
+
+        if(written > 0)
+        {
+            binary.data.resize(written);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_binaries[key] = std::move(binary);
+            m_modified = true;
+        }
+    }
+
+    return program;
+}
+
+bool ProgramCache::Save()
+{
+    if(!m_initialized)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(!m_modified)
+        return true;
+
+    // Serialize kept binaries.
+    std::vector<std::uint8_t> buffer;
+    BinaryWriter writer(buffer);
+
+    writer.Write(FileMagic);
+    writer.Write(FileVersion);
+    writer.Write<std::uint32_t>((std::uint32_t)m_binaries.size());
+
+    for(const auto& pair : m_binaries)
+    {
+        writer.Write(pair.first);
+        writer.Write<std::uint32_t>(pair.second.format);
+        writer.WriteArray(pair.second.data.data(), pair.second.data.size());
+    }
+
+    // Write the file.
+    std::ofstream file(m_filename, std::ios::binary | std::ios::trunc);
+
+    if(!file)
+    {
+        LogError() << LogSaveError(m_filename) << "Couldn't open the file.";
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+
+    if(!file)
+    {
+        LogError() << LogSaveError(m_filename) << "Couldn't write to the file.";
+        return false;
+    }
+
+    m_modified = false;
+
+    return true;
+}
+
+GLuint ProgramCache::CompileAndLink(const ShaderStage* stages, int stageCount, const char* name)
+{
+    Assert(stages != nullptr && stageCount > 0);
+
+    // Compile all stages.
+    std::vector<GLuint> shaders;
+
+    SCOPE_GUARD
+    (
+        for(GLuint shader : shaders)
+        {
+            glDeleteShader(shader);
+        }
+    );
+
+    for(int i = 0; i < stageCount; ++i)
+    {
+        GLuint shader = CompileShader(stages[i], name);
+
+        if(shader == 0)
+            return 0;
+
+        shaders.push_back(shader);
+    }
+
+    // Link the program.
+    GLuint program = glCreateProgram();
+
+    if(IsSupported())
+    {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    for(GLuint shader : shaders)
+    {
+        glAttachShader(program, shader);
+    }
+
+    glLinkProgram(program);
+
+    for(GLuint shader : shaders)
+    {
+        glDetachShader(program, shader);
+    }
+
+    if(!IsLinked(program))
+    {
+        char errorLog[1024] = { 0 };
+        glGetProgramInfoLog(program, sizeof(errorLog), nullptr, errorLog);
+
+        LogError() << LogLinkError(name) << "Couldn't link a program: " << errorLog;
+
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+int ProgramCache::GetHitCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hitCount;
+}
+
+int ProgramCache::GetMissCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_missCount;
+}
+
+bool ProgramCache::IsSupported()
+{
+    if(!(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary))
+        return false;
+
+    // Some drivers expose the extension without any binary formats.
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+
+    return formatCount > 0;
+}
+
+std::uint64_t ProgramCache::CalculateKey(const ShaderStage* stages, int stageCount)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Hash driver strings once a context is available.
+    if(!m_driverHashed)
+    {
+        m_driverHash = HashBasis;
+        m_driverHash = HashString(m_driverHash, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+        m_driverHash = HashString(m_driverHash, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+        m_driverHash = HashString(m_driverHash, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+        m_driverHashed = true;
+    }
+
+    // Hash types and sources of stages.
+    std::uint64_t hash = m_driverHash;
+
+    for(int i = 0; i < stageCount; ++i)
+    {
+        hash = HashBytes(hash, &stages[i].type, sizeof(GLenum));
+
+        ForEachPart(stages[i], [&hash](const char* part, std::size_t size)
+        {
+            hash = HashBytes(hash, part, size);
+        });
+
+        // Separate stages, so moving text between them changes the key.
+        hash = HashBytes(hash, "\0", 1);
+    }
+
+    return hash;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Program Cache
+//
+//  Links shader programs and keeps their binaries, so later runs can load
+//  them without compiling shaders. Binaries are keyed by a hash of shader
+//  sources and the vendor, renderer and version strings of the driver, so
+//  a driver update makes them miss instead of failing. Programs fall back
+//  to compiling and linking when there is no binary, when the driver
+//  rejects one, or when program binaries are not supported.
+//
+//  Binaries are read from a file when the cache is initialized and written
+//  back when new ones are saved. An uninitialized cache still links programs
+//  but does not keep their binaries.
+//
+//  Example usage:
+//      Graphics::ProgramCacheInfo info;
+//      info.filename = "Programs.cache";
+//
+//      Graphics::ProgramCache cache;
+//      cache.Initialize(info);
+//
+//      Graphics::ShaderStage stages[2];
+//      stages[0].type = GL_VERTEX_SHADER;
+//      stages[0].source = vertexSource;
+//      stages[1].type = GL_FRAGMENT_SHADER;
+//      stages[1].source = fragmentSource;
+//
+//      GLuint program = cache.Link(stages, 2, "Sprite");
+//
+//      cache.Save();
+//
+
+namespace Graphics
+{
+    // Shader stage source.
+    struct ShaderStage
+    {
+        ShaderStage();
+
+        // Type of the shader.
+        GLenum type;
+
+        // Source of the shader.
+        // Can be split into parts with the same layout as glShaderSource() takes.
+        const char* const* parts;
+        const GLint* lengths;
+        int partCount;
+
+        // Single null terminated source used when there are no parts.
+        const char* source;
+    };
+
+    // Program cache initialization struct.
+    struct ProgramCacheInfo
+    {
+        // File that binaries are kept in.
+        std::string filename;
+
+        ProgramCacheInfo();
+    };
+
+    // Program cache class.
+    class ProgramCache : private NonCopyable
+    {
+    public:
+        ProgramCache();
+        ~ProgramCache();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the cache and reads binaries from its file.
+        // A missing or invalid file starts an empty cache.
+        bool Initialize(const ProgramCacheInfo& info);
+
+        // Links a program from shader stages, using a kept binary if possible.
+        // Returns zero and logs errors with the given name on failure.
+        // Has to be called on a thread with a current context.
+        GLuint Link(const ShaderStage* stages, int stageCount, const char* name);
+
+        // Writes binaries to the file if new ones have been added.
+        bool Save();
+
+        // Compiles and links a program without using a cache.
+        static GLuint CompileAndLink(const ShaderStage* stages, int stageCount, const char* name);
+
+        // Gets the number of programs loaded from binaries.
+        int GetHitCount() const;
+
+        // Gets the number of programs that had to be compiled.
+        int GetMissCount() const;
+
+    private:
+        // Kept program binary.
+        struct Binary
+        {
+            GLenum format;
+            std::vector<std::uint8_t> data;
+        };
+
+        typedef std::map<std::uint64_t, Binary> BinaryMap;
+
+    private:
+        // Checks if the context supports program binaries.
+        static bool IsSupported();
+
+        // Calculates the key of a program for the current driver.
+        std::uint64_t CalculateKey(const ShaderStage* stages, int stageCount);
+
+    private:
+        // File that binaries are kept in.
+        std::string m_filename;
+
+        // Kept binaries.
+        BinaryMap m_binaries;
+        bool m_modified;
+        mutable std::mutex m_mutex;
+
+        // Hash of the driver strings, calculated with the first context.
+        std::uint64_t m_driverHash;
+        bool m_driverHashed;
+
+        // Statistics.
+        int m_hitCount;
+        int m_missCount;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,418 @@
+#include "Precompiled.hpp"
+#include "ReadbackService.hpp"
+#include "Targa.hpp"
+using namespace Graphics;
+
+namespace Graphics
+{
+    namespace Detail
+    {
+        // Status of a readback slot.
+        struct ReadbackStatus
+        {
+            enum Type
+            {
+                Free,
+                Requested,
+                Finished,
+            };
+        };
+
+        // Slot of a read in flight.
+        // The recording thread fills free slots and frees finished ones,
+        // while the render thread finishes requested ones.
+        struct ReadbackSlot
+        {
+            ReadbackSlot() :
+                status(ReadbackStatus::Free),
+                request(0),
+                type(ReadbackTypes::Screenshot),
+                x(0),
+                y(0),
+                width(0),
+                height(0),
+                pixelBuffer(0),
+                bufferSize(0),
+                fence(nullptr),
+                succeeded(false)
+            {
+            }
+
+            std::atomic<int> status;
+
+            int request;
+            ReadbackTypes::Type type;
+            int x;
+            int y;
+            int width;
+            int height;
+
+            GLuint pixelBuffer;
+            std::size_t bufferSize;
+            GLsync fence;
+
+            std::vector<std::uint8_t> pixels;
+            bool succeeded;
+        };
+
+        // State shared with the render thread.
+        struct ReadbackState
+        {
+            explicit ReadbackState(int slotCount) :
+                slots(new ReadbackSlot[slotCount]),
+                slotCount(slotCount)
+            {
+            }
+
+            std::unique_ptr<ReadbackSlot[]> slots;
+            int slotCount;
+        };
+    }
+}
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize a readback service! "
+    #define LogRequestError() "Failed to request a readback! "
+
+    // Size of a pixel in bytes.
+    const std::size_t PixelSize = 4;
+
+    // Maps a completed event to the identifier of its request.
+    int GetCompletedKey(const ReadbackService::Events::Completed& event)
+    {
+        return event.request;
+    }
+
+    // Reads pixels into the pixel buffer of a slot on the render thread.
+    void IssueRead(StateCache& cache, void* argument)
+    {
+        auto slot = static_cast<Detail::ReadbackSlot*>(argument);
+
+        std::size_t size = (std::size_t)slot->width * slot->height * PixelSize;
+
+        if(slot->pixelBuffer == 0)
+        {
+            glGenBuffers(1, &slot->pixelBuffer);
+        }
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pixelBuffer);
+
+        // Reallocate only when the size changes, such as after resizing.
+        if(slot->bufferSize != size)
+        {
+            glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)size, nullptr, GL_STREAM_READ);
+            slot->bufferSize = size;
+        }
+
+        // Copy into the buffer asynchronously instead of into client memory.
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(slot->x, slot->y, slot->width, slot->height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    // Finishes reads whose fences have been signaled on the render thread.
+    void PollReads(StateCache& cache, void* argument)
+    {
+        auto state = static_cast<Detail::ReadbackState*>(argument);
+
+        for(int i = 0; i < state->slotCount; ++i)
+        {
+            Detail::ReadbackSlot& slot = state->slots[i];
+
+            if(slot.status.load(std::memory_order_acquire) != Detail::ReadbackStatus::Requested || slot.fence == nullptr)
+                continue;
+
+            // Check the fence without waiting.
+            GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+
+            if(result == GL_TIMEOUT_EXPIRED)
+                continue;
+
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+
+            slot.succeeded = false;
+
+            if(result != GL_WAIT_FAILED)
+            {
+                // Copy pixels out of the buffer, which no longer waits for the GPU.
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuffer);
+
+                const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)slot.bufferSize, GL_MAP_READ_BIT);
+
+                if(data != nullptr)
+                {
+                    slot.pixels.resize(slot.bufferSize);
+                    std::memcpy(slot.pixels.data(), data, slot.bufferSize);
+
+                    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                    slot.succeeded = true;
+                }
+
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            }
+
+            slot.status.store(Detail::ReadbackStatus::Finished, std::memory_order_release);
+        }
+    }
+
+    // Destroys OpenGL objects and the state on the render thread.
+    void DestroyResources(StateCache& cache, void* argument)
+    {
+        auto state = static_cast<Detail::ReadbackState*>(argument);
+
+        for(int i = 0; i < state->slotCount; ++i)
+        {
+            Detail::ReadbackSlot& slot = state->slots[i];
+
+            if(slot.fence != nullptr)
+            {
+                glDeleteSync(slot.fence);
+            }
+
+            glDeleteBuffers(1, &slot.pixelBuffer);
+        }
+
+        delete state;
+    }
+}
+
+ReadbackServiceInfo::ReadbackServiceInfo() :
+    renderer(nullptr),
+    window(nullptr),
+    slotCount(8)
+{
+}
+
+ReadbackService::ReadbackService() :
+    m_renderer(nullptr),
+    m_window(nullptr),
+    m_state(nullptr),
+    m_cursorX(0.0),
+    m_cursorY(0.0),
+    m_requestCounter(0),
+    m_pendingCount(0),
+    m_initialized(false)
+{
+    events.completed.SetKeyFunction(&GetCompletedKey);
+}
+
+ReadbackService::~ReadbackService()
+{
+    this->Cleanup();
+}
+
+void ReadbackService::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Destroy the state on the render thread after frames that use it.
+    if(m_state != nullptr)
+    {
+        m_renderer->GetCommands().Call(&DestroyResources, m_state);
+        m_state = nullptr;
+    }
+
+    m_cursorReceiver.Unsubscribe();
+    m_cursorX = 0.0;
+    m_cursorY = 0.0;
+
+    Utility::ClearContainer(m_finished);
+
+    m_renderer = nullptr;
+    m_window = nullptr;
+
+    m_requestCounter = 0;
+    m_pendingCount = 0;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool ReadbackService::Initialize(const ReadbackServiceInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            m_initialized = true;
+            this->Cleanup();
+        }
+    );
+
+    // Validate arguments.
+    if(info.renderer == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid renderer.";
+        return false;
+    }
+
+    if(info.slotCount <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid slot count.";
+        return false;
+    }
+
+    m_renderer = info.renderer;
+    m_window = info.window;
+
+    // Track the cursor for picking.
+    if(m_window != nullptr)
+    {
+        m_cursorReceiver.Bind<ReadbackService, &ReadbackService::OnCursorPosition>(this);
+        m_cursorReceiver.Subscribe(m_window->events.cursorPosition);
+    }
+
+    // Create the state, which buffers are created for on the render thread.
+    m_state = new Detail::ReadbackState(info.slotCount);
+    m_finished.reserve(info.slotCount);
+
+    // Success!
+    return m_initialized = true;
+}
+
+int ReadbackService::RequestScreenshot(CommandBuffer& commands)
+{
+    if(!m_initialized)
+        return 0;
+
+    if(m_window == nullptr)
+    {
+        LogError() << LogRequestError() << "Screenshots need a window.";
+        return 0;
+    }
+
+    return this->Request(commands, ReadbackTypes::Screenshot, 0, 0, m_window->GetWidth(), m_window->GetHeight());
+}
+
+int ReadbackService::RequestPick(CommandBuffer& commands)
+{
+    if(!m_initialized)
+        return 0;
+
+    if(m_window == nullptr)
+    {
+        LogError() << LogRequestError() << "Picking needs a window.";
+        return 0;
+    }
+
+    // Flip the cursor, which has its origin at the top left.
+    int x = (int)std::floor(m_cursorX);
+    int y = m_window->GetHeight() - 1 - (int)std::floor(m_cursorY);
+
+    if(x < 0 || y < 0 || x >= m_window->GetWidth() || y >= m_window->GetHeight())
+        return 0;
+
+    return this->Request(commands, ReadbackTypes::Pick, x, y, 1, 1);
+}
+
+int ReadbackService::RequestCapture(CommandBuffer& commands, int x, int y, int width, int height)
+{
+    if(!m_initialized)
+        return 0;
+
+    return this->Request(commands, ReadbackTypes::Capture, x, y, width, height);
+}
+
+int ReadbackService::Request(CommandBuffer& commands, ReadbackTypes::Type type, int x, int y, int width, int height)
+{
+    if(width <= 0 || height <= 0)
+    {
+        LogError() << LogRequestError() << "Invalid rectangle size (" << width << "x" << height << ").";
+        return 0;
+    }
+
+    // Find a free slot.
+    for(int i = 0; i < m_state->slotCount; ++i)
+    {
+        Detail::ReadbackSlot& slot = m_state->slots[i];
+
+        if(slot.status.load(std::memory_order_acquire) != Detail::ReadbackStatus::Free)
+            continue;
+
+        slot.request = ++m_requestCounter;
+        slot.type = type;
+        slot.x = x;
+        slot.y = y;
+        slot.width = width;
+        slot.height = height;
+        slot.succeeded = false;
+
+        slot.status.store(Detail::ReadbackStatus::Requested, std::memory_order_release);
+
+        // Read after commands recorded so far.
+        commands.Call(&IssueRead, &slot);
+
+        m_pendingCount += 1;
+
+        return slot.request;
+    }
+
+    LogWarning() << LogRequestError() << "All " << m_state->slotCount << " slots are in flight.";
+    return 0;
+}
+
+void ReadbackService::ProcessCompletions(CommandBuffer& commands)
+{
+    if(!m_initialized)
+        return;
+
+    // Collect finished reads in the order of their requests.
+    m_finished.clear();
+
+    for(int i = 0; i < m_state->slotCount; ++i)
+    {
+        if(m_state->slots[i].status.load(std::memory_order_acquire) == Detail::ReadbackStatus::Finished)
+        {
+            m_finished.push_back(i);
+        }
+    }
+
+    std::sort(m_finished.begin(), m_finished.end(), [this](int first, int second)
+    {
+        return m_state->slots[first].request < m_state->slots[second].request;
+    });
+
+    // Dispatch events and free their slots.
+    for(int index : m_finished)
+    {
+        Detail::ReadbackSlot& slot = m_state->slots[index];
+
+        Events::Completed eventData = { slot.request, slot.type, slot.x, slot.y, slot.width, slot.height, slot.pixels, slot.succeeded };
+        events.completed(eventData);
+
+        slot.status.store(Detail::ReadbackStatus::Free, std::memory_order_release);
+        m_pendingCount -= 1;
+    }
+
+    // Poll reads in flight when the frame is rendered.
+    if(m_pendingCount != 0)
+    {
+        commands.Call(&PollReads, m_state);
+    }
+}
+
+int ReadbackService::GetPendingCount() const
+{
+    return m_pendingCount;
+}
+
+bool ReadbackService::SaveImage(const std::string& filename, int width, int height, const std::vector<std::uint8_t>& pixels)
+{
+    return Targa::Save(filename, width, height, pixels);
+}
+
+void ReadbackService::OnCursorPosition(const System::Window::Events::CursorPosition& event)
+{
+    m_cursorX = event.x;
+    m_cursorY = event.y;
+}
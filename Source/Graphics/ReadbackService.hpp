@@ -0,0 +1,176 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "System/Window.hpp"
+#include "Renderer.hpp"
+
+//
+// Readback Service
+//
+//  Reads pixels back from the GPU without stalling the pipeline. Requests
+//  record a read of the framebuffer into a pixel buffer object at their place
+//  in the command buffer, followed by a fence. Processing completions polls
+//  fences on the render thread without waiting, copies pixels of signaled
+//  reads out of their buffers, and dispatches a completed event for each of
+//  them on the calling thread a few frames later.
+//
+//  Screenshots read the whole framebuffer, picks read the pixel under the
+//  cursor tracked from window events, and captures read any rectangle, such
+//  as for telemetry. Pixels are tightly packed RGBA bytes with rows starting
+//  at the bottom of the rectangle. Cursor coordinates are assumed to match
+//  framebuffer pixels.
+//
+//  Requests return identifiers that completed events carry. Receivers can
+//  set a request identifier as their key to only receive that request. The
+//  number of requests in flight is limited by the number of slots, and
+//  requests are refused while all slots are busy.
+//
+//  Example usage:
+//      Graphics::ReadbackServiceInfo info;
+//      info.renderer = &renderer;
+//      info.window = &window;
+//
+//      Graphics::ReadbackService readback;
+//      readback.Initialize(info);
+//
+//      Receiver<void(const Graphics::ReadbackService::Events::Completed&)> receiver;
+//      receiver.Bind<Class, &Class::OnScreenshot>(&instance);
+//      receiver.Subscribe(readback.events.completed);
+//
+//      while(window.IsOpen())
+//      {
+//          Graphics::CommandBuffer& commands = renderer.GetCommands();
+//          /* Draw... */
+//
+//          readback.RequestScreenshot(commands);
+//          readback.ProcessCompletions(commands);
+//
+//          renderer.Submit();
+//      }
+//
+
+namespace Graphics
+{
+    // Readback types.
+    struct ReadbackTypes
+    {
+        enum Type
+        {
+            Screenshot,
+            Pick,
+            Capture,
+        };
+    };
+
+    // Implementation details.
+    namespace Detail
+    {
+        struct ReadbackState;
+    }
+
+    // Readback service initialization struct.
+    struct ReadbackServiceInfo
+    {
+        // Renderer that executes reads.
+        Renderer* renderer;
+
+        // Optional window, which picks track the cursor of.
+        System::Window* window;
+
+        // Maximum number of requests in flight.
+        int slotCount;
+
+        ReadbackServiceInfo();
+    };
+
+    // Readback service class.
+    class ReadbackService : private NonCopyable
+    {
+    public:
+        ReadbackService();
+        ~ReadbackService();
+
+        // Restores instance to its original state.
+        // Requests in flight are dropped without dispatching their events.
+        // Must be called before the renderer is cleaned up.
+        void Cleanup();
+
+        // Initializes the readback service instance.
+        bool Initialize(const ReadbackServiceInfo& info);
+
+        // Requests a read of the whole framebuffer.
+        // Returns the identifier of the request, or zero on failure.
+        int RequestScreenshot(CommandBuffer& commands);
+
+        // Requests a read of the pixel under the cursor.
+        // Returns the identifier of the request, or zero on failure.
+        int RequestPick(CommandBuffer& commands);
+
+        // Requests a read of a rectangle with the origin at the bottom left.
+        // Returns the identifier of the request, or zero on failure.
+        int RequestCapture(CommandBuffer& commands, int x, int y, int width, int height);
+
+        // Dispatches events of finished reads on the calling thread
+        // and records polling of reads in flight.
+        void ProcessCompletions(CommandBuffer& commands);
+
+        // Gets the number of requests that have not been processed yet.
+        int GetPendingCount() const;
+
+        // Saves pixels of a completed read as an uncompressed TGA image.
+        static bool SaveImage(const std::string& filename, int width, int height, const std::vector<std::uint8_t>& pixels);
+
+    public:
+        // Public events.
+        struct Events
+        {
+            // Read completed event.
+            // Receivers can set a request identifier key to only receive that request.
+            struct Completed
+            {
+                int request;
+                ReadbackTypes::Type type;
+                int x;
+                int y;
+                int width;
+                int height;
+                const std::vector<std::uint8_t>& pixels;
+                bool succeeded;
+            };
+
+            Dispatcher<void(const Completed&)> completed;
+        } events;
+
+    private:
+        // Records a read into a free slot.
+        int Request(CommandBuffer& commands, ReadbackTypes::Type type, int x, int y, int width, int height);
+
+        // Tracks the cursor for picking.
+        void OnCursorPosition(const System::Window::Events::CursorPosition& event);
+
+    private:
+        // Renderer that executes reads.
+        Renderer* m_renderer;
+
+        // Window of the framebuffer.
+        System::Window* m_window;
+
+        // State shared with the render thread.
+        Detail::ReadbackState* m_state;
+
+        // Slots finished in the current processing, ordered by request.
+        std::vector<int> m_finished;
+
+        // Cursor position in window coordinates.
+        Receiver<void(const System::Window::Events::CursorPosition&)> m_cursorReceiver;
+        double m_cursorX;
+        double m_cursorY;
+
+        // Request counters.
+        int m_requestCounter;
+        int m_pendingCount;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
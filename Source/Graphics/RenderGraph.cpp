@@ -0,0 +1,817 @@
+#include "Precompiled.hpp"
+#include "RenderGraph.hpp"
+using namespace Graphics;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize a render graph! "
+    #define LogExecuteError() "Failed to execute a render graph! "
+}
+
+namespace Graphics
+{
+    namespace Detail
+    {
+        // Render target declared in a frame.
+        struct GraphResource
+        {
+            std::string name;
+            RenderTargetDesc desc;
+            bool imported;
+            bool output;
+
+            // Passes that write and read the target, in the order they were added.
+            std::vector<int> writers;
+            std::vector<int> readers;
+
+            // Positions of the first and the last executed pass using the target.
+            int firstUse;
+            int lastUse;
+
+            // Index of the texture shared by aliased targets.
+            int texture;
+        };
+
+        // Pass declared in a frame.
+        struct GraphPass
+        {
+            std::string name;
+            RenderGraph::PassFunction function;
+
+            std::vector<int> reads;
+            std::vector<int> writes;
+
+            bool culled;
+        };
+
+        // Pass executed on the render thread.
+        struct ExecutedPass
+        {
+            RenderGraphFrame* frame;
+            int pass;
+            int framebuffer;
+        };
+
+        // Graph of a frame, recorded on the main thread and executed on the render thread.
+        struct RenderGraphFrame
+        {
+            RenderGraphFrame() :
+                state(nullptr),
+                culledCount(0)
+            {
+            }
+
+            RenderGraphState* state;
+
+            std::vector<GraphResource> resources;
+            std::vector<GraphPass> passes;
+            std::vector<int> order;
+            int culledCount;
+
+            // Descriptions of textures after aliasing and targets acquired for them.
+            std::vector<RenderTargetDesc> textureDescs;
+            std::vector<RenderTarget> targets;
+
+            // Texture of each resource, filled on the render thread before passes run.
+            std::vector<GLuint> textures;
+
+            // Passes in the order of execution and their command buffers.
+            std::vector<ExecutedPass> executed;
+            std::vector<std::unique_ptr<CommandBuffer>> commands;
+        };
+
+        // State owned by the render thread after initialization.
+        struct RenderGraphState
+        {
+            RenderTargetPool pool;
+
+            // Framebuffers that outputs of executed passes are attached to.
+            std::vector<GLuint> framebuffers;
+
+            // Frames double buffered like command buffers of the renderer.
+            RenderGraphFrame frames[2];
+        };
+    }
+}
+
+namespace
+{
+    // Acquires textures of a frame before its passes run.
+    void BeginGraph(StateCache& cache, void* argument)
+    {
+        Detail::RenderGraphFrame* frame = static_cast<Detail::RenderGraphFrame*>(argument);
+        Detail::RenderGraphState* state = frame->state;
+
+        frame->targets.resize(frame->textureDescs.size());
+
+        for(std::size_t i = 0; i < frame->textureDescs.size(); ++i)
+        {
+            frame->targets[i] = state->pool.Acquire(cache, frame->textureDescs[i]);
+        }
+
+        for(std::size_t i = 0; i < frame->resources.size(); ++i)
+        {
+            const Detail::GraphResource& resource = frame->resources[i];
+            frame->textures[i] = resource.texture >= 0 ? frame->targets[resource.texture].texture : 0;
+        }
+
+        while(state->framebuffers.size() < frame->executed.size())
+        {
+            GLuint framebuffer = 0;
+            glGenFramebuffers(1, &framebuffer);
+            state->framebuffers.push_back(framebuffer);
+        }
+    }
+
+    // Binds outputs of a pass and runs its commands.
+    void RunPass(StateCache& cache, void* argument)
+    {
+        Detail::ExecutedPass* executed = static_cast<Detail::ExecutedPass*>(argument);
+        Detail::RenderGraphFrame* frame = executed->frame;
+        const Detail::GraphPass& pass = frame->passes[executed->pass];
+
+        const Detail::GraphResource& first = frame->resources[pass.writes.front()];
+
+        if(first.imported)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        }
+        else
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, frame->state->framebuffers[executed->framebuffer]);
+
+            // Attach outputs, detaching textures of previous frames.
+            GLenum drawBuffers[RenderGraph::MaximumColorOutputs];
+            GLuint colors[RenderGraph::MaximumColorOutputs] = { 0 };
+            int colorCount = 0;
+
+            GLuint depth = 0;
+            GLenum depthAttachment = GL_DEPTH_STENCIL_ATTACHMENT;
+
+            for(int resource : pass.writes)
+            {
+                GLenum attachment = RenderTargetPool::GetAttachment(frame->resources[resource].desc.format);
+
+                if(attachment == GL_COLOR_ATTACHMENT0)
+                {
+                    drawBuffers[colorCount] = GL_COLOR_ATTACHMENT0 + colorCount;
+                    colors[colorCount++] = frame->textures[resource];
+                }
+                else
+                {
+                    depth = frame->textures[resource];
+                    depthAttachment = attachment;
+                }
+            }
+
+            for(int i = 0; i < RenderGraph::MaximumColorOutputs; ++i)
+            {
+                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colors[i], 0);
+            }
+
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, 0, 0);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, depthAttachment, GL_TEXTURE_2D, depth, 0);
+
+            if(colorCount != 0)
+            {
+                glDrawBuffers(colorCount, drawBuffers);
+            }
+            else
+            {
+                glDrawBuffer(GL_NONE);
+            }
+        }
+
+        cache.SetViewport(0, 0, first.desc.width, first.desc.height);
+
+        frame->commands[executed->framebuffer]->Execute(cache);
+    }
+
+    // Releases textures of a frame after its passes ran.
+    void EndGraph(StateCache& cache, void* argument)
+    {
+        Detail::RenderGraphFrame* frame = static_cast<Detail::RenderGraphFrame*>(argument);
+        Detail::RenderGraphState* state = frame->state;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        for(const RenderTarget& target : frame->targets)
+        {
+            if(target.IsValid())
+            {
+                state->pool.Release(target);
+            }
+        }
+
+        frame->targets.clear();
+
+        state->pool.EndFrame(cache);
+    }
+
+    // Destroys the state on the render thread.
+    void DestroyResources(StateCache& cache, void* argument)
+    {
+        Detail::RenderGraphState* state = static_cast<Detail::RenderGraphState*>(argument);
+
+        if(!state->framebuffers.empty())
+        {
+            glDeleteFramebuffers((GLsizei)state->framebuffers.size(), state->framebuffers.data());
+        }
+
+        state->pool.Cleanup();
+        cache.Invalidate();
+
+        delete state;
+    }
+}
+
+RenderPassContext::RenderPassContext() :
+    graph(nullptr),
+    commands(nullptr),
+    width(0),
+    height(0)
+{
+}
+
+RenderGraphInfo::RenderGraphInfo() :
+    renderer(nullptr),
+    maximumUnusedFrames(RenderTargetPoolInfo().maximumUnusedFrames)
+{
+}
+
+RenderGraph::RenderGraph() :
+    m_renderer(nullptr),
+    m_state(nullptr),
+    m_frameIndex(0),
+    m_initialized(false)
+{
+}
+
+RenderGraph::~RenderGraph()
+{
+    this->Cleanup();
+}
+
+void RenderGraph::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Destroy the state on the render thread after frames that use it.
+    m_renderer->GetCommands().Call(&DestroyResources, m_state);
+    m_state = nullptr;
+
+    m_renderer = nullptr;
+    m_frameIndex = 0;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool RenderGraph::Initialize(const RenderGraphInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.renderer == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid renderer.";
+        return false;
+    }
+
+    // Create the state with the pool of textures.
+    std::unique_ptr<Detail::RenderGraphState> state(new Detail::RenderGraphState());
+
+    RenderTargetPoolInfo poolInfo;
+    poolInfo.maximumUnusedFrames = info.maximumUnusedFrames;
+
+    if(!state->pool.Initialize(poolInfo))
+    {
+        LogError() << LogInitializeError() << "Couldn't initialize the render target pool.";
+        return false;
+    }
+
+    for(Detail::RenderGraphFrame& frame : state->frames)
+    {
+        frame.state = state.get();
+    }
+
+    m_renderer = info.renderer;
+    m_state = state.release();
+
+    // Success!
+    return m_initialized = true;
+}
+
+void RenderGraph::BeginFrame()
+{
+    Assert(m_initialized, "Render graph is not initialized!");
+
+    // The render thread is done with the other frame once the previous one has been submitted.
+    m_frameIndex ^= 1;
+
+    Detail::RenderGraphFrame& frame = m_state->frames[m_frameIndex];
+    frame.resources.clear();
+    frame.passes.clear();
+    frame.order.clear();
+    frame.culledCount = 0;
+    frame.textureDescs.clear();
+    frame.textures.clear();
+    frame.executed.clear();
+}
+
+int RenderGraph::CreateTarget(const std::string& name, const RenderTargetDesc& desc)
+{
+    Assert(m_initialized, "Render graph is not initialized!");
+    Assert(RenderTargetPool::GetAttachment(desc.format) != GL_NONE, "Unsupported render target format!");
+
+    Detail::RenderGraphFrame& frame = m_state->frames[m_frameIndex];
+
+    Detail::GraphResource resource;
+    resource.name = name;
+    resource.desc = desc;
+    resource.imported = false;
+    resource.output = false;
+    resource.firstUse = InvalidIndex;
+    resource.lastUse = InvalidIndex;
+    resource.texture = InvalidIndex;
+
+    frame.resources.push_back(std::move(resource));
+    return (int)frame.resources.size() - 1;
+}
+
+int RenderGraph::ImportBackbuffer(int width, int height)
+{
+    Assert(m_initialized, "Render graph is not initialized!");
+
+    Detail::RenderGraphFrame& frame = m_state->frames[m_frameIndex];
+
+    Detail::GraphResource resource;
+    resource.name = "Backbuffer";
+    resource.desc = RenderTargetDesc(width, height, GL_RGBA8);
+    resource.imported = true;
+    resource.output = true;
+    resource.firstUse = InvalidIndex;
+    resource.lastUse = InvalidIndex;
+    resource.texture = InvalidIndex;
+
+    frame.resources.push_back(std::move(resource));
+    return (int)frame.resources.size() - 1;
+}
+
+void RenderGraph::MarkOutput(int resource)
+{
+    Assert(m_initialized, "Render graph is not initialized!");
+
+    Detail::RenderGraphFrame& frame = m_state->frames[m_frameIndex];
+    Assert(resource >= 0 && resource < (int)frame.resources.size(), "Invalid render graph resource!");
+
+    frame.resources[resource].output = true;
+}
+
+int RenderGraph::AddPass(const std::string& name, PassFunction function)
+{
+    Assert(m_initialized, "Render graph is not initialized!");
+    Assert(function != nullptr, "Render graph pass has no function!");
+
+    Detail::RenderGraphFrame& frame = m_state->frames[m_frameIndex];
+
+    Detail::GraphPass pass;
+    pass.name = name;
+    pass.function = std::move(function);
+    pass.culled = false;
+
+    frame.passes.push_back(std::move(pass));
+    return (int)frame.passes.size() - 1;
+}
+
+void RenderGraph::Read(int pass, int resource)
+{
+    Assert(m_initialized, "Render graph is not initialized!");
+
+    Detail::RenderGraphFrame& frame = m_state->frames[m_frameIndex];
+    Assert(pass >= 0 && pass < (int)frame.passes.size(), "Invalid render graph pass!");
+    Assert(resource >= 0 && resource < (int)frame.resources.size(), "Invalid render graph resource!");
+    Assert(!frame.resources[resource].imported, "Imported backbuffer can't be read!");
+
+    frame.passes[pass].reads.push_back(resource);
+    frame.resources[resource].readers.push_back(pass);
+}
+
+void RenderGraph::Write(int pass, int resource)
+{
+    Assert(m_initialized, "Render graph is not initialized!");
+
+    Detail::RenderGraphFrame& frame = m_state->frames[m_frameIndex];
+    Assert(pass >= 0 && pass < (int)frame.passes.size(), "Invalid render graph pass!");
+    Assert(resource >= 0 && resource < (int)frame.resources.size(), "Invalid render graph resource!");
+
+    frame.passes[pass].writes.push_back(resource);
+    frame.resources[resource].writers.push_back(pass);
+}
+
+bool RenderGraph::Execute(CommandBuffer& commands, JobSystem* jobSystem)
+{
+    Assert(m_initialized, "Render graph is not initialized!");
+
+    Detail::RenderGraphFrame& frame = m_state->frames[m_frameIndex];
+
+    // Compile the graph.
+    if(!this->ValidatePasses(frame))
+        return false;
+
+    this->CullPasses(frame);
+
+    if(!this->OrderPasses(frame))
+        return false;
+
+    this->AliasTargets(frame);
+
+    // Textures are bound through pointers into this array, so it must not grow during recording.
+    frame.textures.assign(frame.resources.size(), 0);
+
+    while(frame.commands.size() < frame.order.size())
+    {
+        frame.commands.emplace_back(new CommandBuffer());
+    }
+
+    for(std::size_t i = 0; i < frame.order.size(); ++i)
+    {
+        Detail::ExecutedPass executed;
+        executed.frame = &frame;
+        executed.pass = frame.order[i];
+        executed.framebuffer = (int)i;
+
+        frame.executed.push_back(executed);
+    }
+
+    // Record passes into their own command buffers.
+    auto recordPasses = [this, &frame](int begin, int end)
+    {
+        for(int i = begin; i < end; ++i)
+        {
+            const Detail::GraphPass& pass = frame.passes[frame.order[i]];
+            const Detail::GraphResource& output = frame.resources[pass.writes.front()];
+
+            CommandBuffer& passCommands = *frame.commands[i];
+            passCommands.Reset();
+
+            RenderPassContext context;
+            context.graph = this;
+            context.commands = &passCommands;
+            context.width = output.desc.width;
+            context.height = output.desc.height;
+
+            pass.function(context);
+        }
+    };
+
+    int passCount = (int)frame.order.size();
+
+    if(jobSystem != nullptr && passCount > 1)
+    {
+        jobSystem->ParallelFor(passCount, 1, recordPasses);
+    }
+    else
+    {
+        recordPasses(0, passCount);
+    }
+
+    // Run passes in order on the render thread.
+    commands.Call(&BeginGraph, &frame);
+
+    for(Detail::ExecutedPass& executed : frame.executed)
+    {
+        commands.Call(&RunPass, &executed);
+    }
+
+    commands.Call(&EndGraph, &frame);
+
+    return true;
+}
+
+void RenderGraph::BindTexture(CommandBuffer& commands, GLuint unit, int resource) const
+{
+    Assert(m_initialized, "Render graph is not initialized!");
+
+    const Detail::RenderGraphFrame& frame = m_state->frames[m_frameIndex];
+    Assert(resource >= 0 && resource < (int)frame.textures.size(), "Invalid render graph resource!");
+    Assert(!frame.resources[resource].imported, "Imported backbuffer can't be bound!");
+
+    commands.BindTextureIndirect(unit, GL_TEXTURE_2D, &frame.textures[resource]);
+}
+
+int RenderGraph::GetPassCount() const
+{
+    Assert(m_initialized, "Render graph is not initialized!");
+
+    return (int)m_state->frames[m_frameIndex].passes.size();
+}
+
+int RenderGraph::GetCulledPassCount() const
+{
+    Assert(m_initialized, "Render graph is not initialized!");
+
+    return m_state->frames[m_frameIndex].culledCount;
+}
+
+int RenderGraph::GetTransientCount() const
+{
+    Assert(m_initialized, "Render graph is not initialized!");
+
+    int count = 0;
+
+    for(const Detail::GraphResource& resource : m_state->frames[m_frameIndex].resources)
+    {
+        if(resource.texture >= 0)
+        {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+int RenderGraph::GetTextureCount() const
+{
+    Assert(m_initialized, "Render graph is not initialized!");
+
+    return (int)m_state->frames[m_frameIndex].textureDescs.size();
+}
+
+int RenderGraph::GetExecutedPassCount() const
+{
+    Assert(m_initialized, "Render graph is not initialized!");
+
+    return (int)m_state->frames[m_frameIndex].order.size();
+}
+
+const std::string& RenderGraph::GetExecutedPassName(int index) const
+{
+    Assert(m_initialized, "Render graph is not initialized!");
+
+    const Detail::RenderGraphFrame& frame = m_state->frames[m_frameIndex];
+    Assert(index >= 0 && index < (int)frame.order.size(), "Invalid executed pass index!");
+
+    return frame.passes[frame.order[index]].name;
+}
+
+bool RenderGraph::ValidatePasses(Detail::RenderGraphFrame& frame)
+{
+    for(const Detail::GraphPass& pass : frame.passes)
+    {
+        int colorCount = 0;
+        int depthCount = 0;
+        bool backbuffer = false;
+
+        for(int resource : pass.writes)
+        {
+            const Detail::GraphResource& output = frame.resources[resource];
+            const Detail::GraphResource& first = frame.resources[pass.writes.front()];
+
+            if(output.desc.width != first.desc.width || output.desc.height != first.desc.height)
+            {
+                LogError() << LogExecuteError() << "Outputs of pass \"" << pass.name << "\" differ in size.";
+                return false;
+            }
+
+            if(std::find(pass.reads.begin(), pass.reads.end(), resource) != pass.reads.end())
+            {
+                LogError() << LogExecuteError() << "Pass \"" << pass.name << "\" reads and writes \"" << output.name << "\".";
+                return false;
+            }
+
+            if(output.imported)
+            {
+                backbuffer = true;
+            }
+            else if(RenderTargetPool::GetAttachment(output.desc.format) == GL_COLOR_ATTACHMENT0)
+            {
+                ++colorCount;
+            }
+            else
+            {
+                ++depthCount;
+            }
+        }
+
+        if(backbuffer && pass.writes.size() != 1)
+        {
+            LogError() << LogExecuteError() << "Pass \"" << pass.name << "\" writes the backbuffer with other targets.";
+            return false;
+        }
+
+        if(colorCount > MaximumColorOutputs || depthCount > 1)
+        {
+            LogError() << LogExecuteError() << "Pass \"" << pass.name << "\" has too many outputs.";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void RenderGraph::CullPasses(Detail::RenderGraphFrame& frame)
+{
+    // Keep writers of outputs and, transitively, writers of what kept passes read.
+    std::vector<bool> kept(frame.passes.size(), false);
+    std::vector<int> stack;
+
+    for(const Detail::GraphResource& resource : frame.resources)
+    {
+        if(!resource.output)
+            continue;
+
+        for(int writer : resource.writers)
+        {
+            if(!kept[writer])
+            {
+                kept[writer] = true;
+                stack.push_back(writer);
+            }
+        }
+    }
+
+    while(!stack.empty())
+    {
+        int pass = stack.back();
+        stack.pop_back();
+
+        for(int resource : frame.passes[pass].reads)
+        {
+            for(int writer : frame.resources[resource].writers)
+            {
+                if(!kept[writer])
+                {
+                    kept[writer] = true;
+                    stack.push_back(writer);
+                }
+            }
+        }
+    }
+
+    frame.culledCount = 0;
+
+    for(std::size_t i = 0; i < frame.passes.size(); ++i)
+    {
+        frame.passes[i].culled = !kept[i];
+
+        if(frame.passes[i].culled)
+        {
+            ++frame.culledCount;
+        }
+    }
+}
+
+bool RenderGraph::OrderPasses(Detail::RenderGraphFrame& frame)
+{
+    // Build edges from writers to later writers and to readers of the same target.
+    std::size_t passCount = frame.passes.size();
+    std::vector<std::vector<int>> edges(passCount);
+    std::vector<int> incoming(passCount, 0);
+
+    auto addEdge = [&](int from, int to)
+    {
+        if(from == to || frame.passes[from].culled || frame.passes[to].culled)
+            return;
+
+        edges[from].push_back(to);
+        ++incoming[to];
+    };
+
+    for(const Detail::GraphResource& resource : frame.resources)
+    {
+        for(std::size_t i = 1; i < resource.writers.size(); ++i)
+        {
+            addEdge(resource.writers[i - 1], resource.writers[i]);
+        }
+
+        for(int writer : resource.writers)
+        {
+            for(int reader : resource.readers)
+            {
+                addEdge(writer, reader);
+            }
+        }
+    }
+
+    // Sort topologically, preferring passes added earlier.
+    std::priority_queue<int, std::vector<int>, std::greater<int>> ready;
+
+    for(std::size_t i = 0; i < passCount; ++i)
+    {
+        if(!frame.passes[i].culled && incoming[i] == 0)
+        {
+            ready.push((int)i);
+        }
+    }
+
+    frame.order.clear();
+
+    while(!ready.empty())
+    {
+        int pass = ready.top();
+        ready.pop();
+
+        frame.order.push_back(pass);
+
+        for(int next : edges[pass])
+        {
+            if(--incoming[next] == 0)
+            {
+                ready.push(next);
+            }
+        }
+    }
+
+    if(frame.order.size() != passCount - frame.culledCount)
+    {
+        LogError() << LogExecuteError() << "Passes have cyclic dependencies.";
+        frame.order.clear();
+        return false;
+    }
+
+    return true;
+}
+
+void RenderGraph::AliasTargets(Detail::RenderGraphFrame& frame)
+{
+    // Find lifetimes of targets within the order of execution.
+    for(Detail::GraphResource& resource : frame.resources)
+    {
+        resource.firstUse = InvalidIndex;
+        resource.lastUse = InvalidIndex;
+        resource.texture = InvalidIndex;
+    }
+
+    for(std::size_t position = 0; position < frame.order.size(); ++position)
+    {
+        const Detail::GraphPass& pass = frame.passes[frame.order[position]];
+
+        auto use = [&](int index)
+        {
+            Detail::GraphResource& resource = frame.resources[index];
+
+            if(resource.firstUse == InvalidIndex)
+            {
+                resource.firstUse = (int)position;
+            }
+
+            resource.lastUse = (int)position;
+        };
+
+        std::for_each(pass.reads.begin(), pass.reads.end(), use);
+        std::for_each(pass.writes.begin(), pass.writes.end(), use);
+    }
+
+    // Outputs have to live until the end of the frame.
+    std::vector<int> transients;
+
+    for(std::size_t i = 0; i < frame.resources.size(); ++i)
+    {
+        Detail::GraphResource& resource = frame.resources[i];
+
+        if(resource.imported || resource.firstUse == InvalidIndex)
+            continue;
+
+        if(resource.output)
+        {
+            resource.lastUse = (int)frame.order.size();
+        }
+
+        transients.push_back((int)i);
+    }
+
+    // Assign textures in the order of first use, reusing textures that are no longer used.
+    std::stable_sort(transients.begin(), transients.end(), [&](int a, int b)
+    {
+        return frame.resources[a].firstUse < frame.resources[b].firstUse;
+    });
+
+    std::vector<int> textureLastUse;
+
+    for(int index : transients)
+    {
+        Detail::GraphResource& resource = frame.resources[index];
+
+        for(std::size_t texture = 0; texture < frame.textureDescs.size(); ++texture)
+        {
+            if(frame.textureDescs[texture] == resource.desc && textureLastUse[texture] < resource.firstUse)
+            {
+                resource.texture = (int)texture;
+                break;
+            }
+        }
+
+        if(resource.texture == InvalidIndex)
+        {
+            resource.texture = (int)frame.textureDescs.size();
+            frame.textureDescs.push_back(resource.desc);
+            textureLastUse.push_back(resource.lastUse);
+        }
+
+        textureLastUse[resource.texture] = resource.lastUse;
+    }
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/JobSystem.hpp"
+#include "Renderer.hpp"
+#include "RenderTargetPool.hpp"
+
+//
+// Render Graph
+//
+//  Builds the passes of a frame, such as shadows, geometry and post
+//  processing, from declarations of the render targets they read and write.
+//  Passes whose outputs are never used are culled, and passes run in an
+//  order derived from their dependencies, with writers of a target before
+//  its readers and multiple writers in the order they were added.
+//
+//  Render targets created by the graph are transient and only live between
+//  their first and last use within a frame. Transients of the same size and
+//  format with lifetimes that don't overlap share a single texture, and
+//  textures are taken from a render target pool, so they are reused across
+//  frames as well. The backbuffer can be imported, which makes passes that
+//  write to it outputs of the graph. Other targets can be marked as outputs,
+//  so passes writing them are never culled.
+//
+//  Each pass records into its own command buffer, so passes can be recorded
+//  in parallel on the job system. Textures of targets are only known on the
+//  render thread, so passes bind them through the graph. The graph binds the
+//  framebuffer with the outputs of a pass and sets the viewport to their
+//  size before the commands of the pass run.
+//
+//  A graph is built, compiled and recorded anew every frame. Frames are
+//  double buffered like the renderer's command buffers.
+//
+//  Example usage:
+//      Graphics::RenderGraphInfo info;
+//      info.renderer = &renderer;
+//
+//      Graphics::RenderGraph graph;
+//      graph.Initialize(info);
+//
+//      graph.BeginFrame();
+//
+//      int backbuffer = graph.ImportBackbuffer(width, height);
+//      int scene = graph.CreateTarget("Scene", Graphics::RenderTargetDesc(width, height, GL_RGBA16F));
+//
+//      int scenePass = graph.AddPass("Scene", [&](const Graphics::RenderPassContext& context)
+//      {
+//          context.commands->Clear(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+//          /* ... */
+//      });
+//
+//      int postPass = graph.AddPass("Post", [&](const Graphics::RenderPassContext& context)
+//      {
+//          context.graph->BindTexture(*context.commands, 0, scene);
+//          /* ... */
+//      });
+//
+//      graph.Write(scenePass, scene);
+//      graph.Read(postPass, scene);
+//      graph.Write(postPass, backbuffer);
+//
+//      graph.Execute(renderer.GetCommands(), &jobSystem);
+//
+
+namespace Graphics
+{
+    // Forward declarations.
+    class RenderGraph;
+
+    // Implementation details.
+    namespace Detail
+    {
+        struct RenderGraphState;
+        struct RenderGraphFrame;
+    }
+
+    // Context of a pass being recorded.
+    struct RenderPassContext
+    {
+        RenderPassContext();
+
+        // Graph that the pass belongs to.
+        const RenderGraph* graph;
+
+        // Command buffer of the pass.
+        CommandBuffer* commands;
+
+        // Size of outputs of the pass.
+        int width;
+        int height;
+    };
+
+    // Render graph initialization struct.
+    struct RenderGraphInfo
+    {
+        // Renderer that executes passes.
+        Renderer* renderer;
+
+        // Number of frames an unused texture is kept for transient targets.
+        int maximumUnusedFrames;
+
+        RenderGraphInfo();
+    };
+
+    // Render graph class.
+    class RenderGraph : private NonCopyable
+    {
+    public:
+        // Type declarations.
+        typedef std::function<void(const RenderPassContext& context)> PassFunction;
+
+        // Maximum number of color targets written by a pass.
+        static const int MaximumColorOutputs = 4;
+
+        // Invalid pass or resource index.
+        static const int InvalidIndex = -1;
+
+    public:
+        RenderGraph();
+        ~RenderGraph();
+
+        // Restores instance to its original state.
+        // Must be called before the renderer is cleaned up.
+        void Cleanup();
+
+        // Initializes the render graph.
+        bool Initialize(const RenderGraphInfo& info);
+
+        // Starts building the graph of a new frame.
+        void BeginFrame();
+
+        // Declares a transient render target and returns its index.
+        int CreateTarget(const std::string& name, const RenderTargetDesc& desc);
+
+        // Imports the backbuffer and returns its index.
+        // Passes that write to it can't write other targets.
+        int ImportBackbuffer(int width, int height);
+
+        // Marks a target as an output, so passes writing it are never culled.
+        void MarkOutput(int resource);
+
+        // Adds a pass and returns its index.
+        int AddPass(const std::string& name, PassFunction function);
+
+        // Declares that a pass samples a target.
+        void Read(int pass, int resource);
+
+        // Declares that a pass renders into a target.
+        void Write(int pass, int resource);
+
+        // Compiles the graph and records passes in their order.
+        // Passes are recorded in parallel if the job system is not null.
+        // Returns false if the graph is invalid, in which case nothing is recorded.
+        bool Execute(CommandBuffer& commands, JobSystem* jobSystem);
+
+        // Records binding of the texture of a target read by the pass being recorded.
+        void BindTexture(CommandBuffer& commands, GLuint unit, int resource) const;
+
+        // Gets numbers of passes and targets of the frame, which are final once it has been executed.
+        int GetPassCount() const;
+        int GetCulledPassCount() const;
+        int GetTransientCount() const;
+        int GetTextureCount() const;
+
+        // Gets names of executed passes in the order of execution.
+        int GetExecutedPassCount() const;
+        const std::string& GetExecutedPassName(int index) const;
+
+    private:
+        // Checks outputs of passes.
+        bool ValidatePasses(Detail::RenderGraphFrame& frame);
+
+        // Culls passes that don't contribute to outputs.
+        void CullPasses(Detail::RenderGraphFrame& frame);
+
+        // Orders remaining passes by their dependencies.
+        bool OrderPasses(Detail::RenderGraphFrame& frame);
+
+        // Assigns textures to transient targets with lifetimes that don't overlap.
+        void AliasTargets(Detail::RenderGraphFrame& frame);
+
+    private:
+        // Renderer that executes passes.
+        Renderer* m_renderer;
+
+        // State shared with the render thread.
+        Detail::RenderGraphState* m_state;
+
+        // Index of the frame being built.
+        int m_frameIndex;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,147 @@
+#include "Precompiled.hpp"
+#include "RenderQueue.hpp"
+#include "Common/Parallel.hpp"
+using namespace Graphics;
+
+namespace
+{
+    // Type declarations.
+    typedef RenderQueue::SortKey SortKey;
+
+    // Number of bits of shader, material and mesh fields together.
+    const int StateBits = RenderQueue::ShaderBits + RenderQueue::MaterialBits + RenderQueue::MeshBits;
+
+    static_assert(RenderQueue::PassBits + RenderQueue::TransparencyBits + RenderQueue::DepthBits + StateBits == 64, "Render key fields must add up to 64 bits!");
+
+    // Largest quantized depth.
+    const SortKey MaximumDepth = ((SortKey)1 << RenderQueue::DepthBits) - 1;
+
+    // Gets the mask of a field with a number of bits.
+    SortKey GetMask(int bits)
+    {
+        return ((SortKey)1 << bits) - 1;
+    }
+
+    // Wraps a value into a field with a number of bits.
+    SortKey Pack(int value, int bits)
+    {
+        return (SortKey)(std::uint32_t)value & GetMask(bits);
+    }
+
+    // Quantizes a depth between zero and one.
+    SortKey QuantizeDepth(float depth)
+    {
+        double clamped = std::min(std::max((double)depth, 0.0), 1.0);
+        return (SortKey)(clamped * (double)MaximumDepth + 0.5);
+    }
+}
+
+RenderKey::RenderKey() :
+    pass(0),
+    transparent(false),
+    depth(0.0f),
+    shader(0),
+    material(0),
+    mesh(0)
+{
+}
+
+RenderQueue::RenderQueue()
+{
+}
+
+RenderQueue::~RenderQueue()
+{
+}
+
+void RenderQueue::Clear()
+{
+    m_keys.clear();
+    m_payloads.clear();
+}
+
+void RenderQueue::Reserve(int count)
+{
+    m_keys.reserve(count);
+    m_payloads.reserve(count);
+}
+
+void RenderQueue::Add(SortKey key, std::uint32_t payload)
+{
+    m_keys.push_back(key);
+    m_payloads.push_back(payload);
+}
+
+void RenderQueue::Sort(JobSystem* jobSystem)
+{
+    Parallel::Sort(jobSystem, m_keys.data(), m_payloads.data(), (int)m_keys.size());
+}
+
+const std::vector<RenderQueue::SortKey>& RenderQueue::GetKeys() const
+{
+    return m_keys;
+}
+
+const std::vector<std::uint32_t>& RenderQueue::GetPayloads() const
+{
+    return m_payloads;
+}
+
+int RenderQueue::GetSize() const
+{
+    return (int)m_keys.size();
+}
+
+RenderQueue::SortKey RenderQueue::Encode(const RenderKey& key)
+{
+    SortKey state = Pack(key.shader, ShaderBits) << (MaterialBits + MeshBits);
+    state |= Pack(key.material, MaterialBits) << MeshBits;
+    state |= Pack(key.mesh, MeshBits);
+
+    SortKey depth = QuantizeDepth(key.depth);
+
+    SortKey result = Pack(key.pass, PassBits) << TransparencyBits;
+    result |= key.transparent ? 1 : 0;
+
+    // Transparent draws are ordered back to front before their state.
+    if(key.transparent)
+    {
+        result = (result << DepthBits) | (MaximumDepth - depth);
+        result = (result << StateBits) | state;
+    }
+    else
+    {
+        result = (result << StateBits) | state;
+        result = (result << DepthBits) | depth;
+    }
+
+    return result;
+}
+
+RenderKey RenderQueue::Decode(SortKey key)
+{
+    RenderKey result;
+    result.transparent = ((key >> (DepthBits + StateBits)) & 1) != 0;
+    result.pass = (int)(key >> (TransparencyBits + DepthBits + StateBits));
+
+    SortKey state = 0;
+    SortKey depth = 0;
+
+    if(result.transparent)
+    {
+        state = key & GetMask(StateBits);
+        depth = MaximumDepth - ((key >> StateBits) & MaximumDepth);
+    }
+    else
+    {
+        state = (key >> DepthBits) & GetMask(StateBits);
+        depth = key & MaximumDepth;
+    }
+
+    result.depth = (float)((double)depth / (double)MaximumDepth);
+    result.shader = (int)(state >> (MaterialBits + MeshBits));
+    result.material = (int)((state >> MeshBits) & GetMask(MaterialBits));
+    result.mesh = (int)(state & GetMask(MeshBits));
+
+    return result;
+}
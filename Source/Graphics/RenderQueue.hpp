@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/JobSystem.hpp"
+
+//
+// Render Queue
+//
+//  Collects draws as pairs of a 64-bit sort key and a payload index, which
+//  points into an array of draw data owned by the caller. Sorting orders the
+//  keys with the parallel radix sort, so draws are submitted grouped by state
+//  without comparing objects, and equal keys keep the order they were added.
+//
+//  Keys are layered with the pass in the highest bits and the transparency
+//  bit below it, so opaque draws of a pass come before transparent ones.
+//  Opaque draws are then ordered by shader, material and mesh, which keeps
+//  state changes low, with depth front to back in the lowest bits. Transparent
+//  draws need to be blended back to front, so their depth comes right after
+//  the transparency bit, inverted, followed by shader, material and mesh.
+//
+//  Depth is expected between zero and one, such as a view distance divided
+//  by the far plane distance, and is quantized. Values out of range are clamped.
+//
+//  Example usage:
+//      Graphics::RenderKey key;
+//      key.pass = 0;
+//      key.transparent = false;
+//      key.depth = distance / farPlane;
+//      key.shader = shaderIndex;
+//      key.material = materialIndex;
+//      key.mesh = meshIndex;
+//
+//      queue.Add(Graphics::RenderQueue::Encode(key), (std::uint32_t)draws.size());
+//      draws.push_back(draw);
+//
+//      queue.Sort(&jobSystem);
+//      queue.Submit([&](Graphics::RenderQueue::SortKey key, std::uint32_t payload)
+//      {
+//          /* Bind state that changed and issue draws[payload]. */
+//      });
+//
+
+namespace Graphics
+{
+    // Render key fields.
+    struct RenderKey
+    {
+        RenderKey();
+
+        int pass;
+        bool transparent;
+        float depth;
+        int shader;
+        int material;
+        int mesh;
+    };
+
+    // Render queue class.
+    class RenderQueue : private NonCopyable
+    {
+    public:
+        // Type declarations.
+        typedef std::uint64_t SortKey;
+
+        // Number of bits of key fields, which add up to the key size.
+        static const int PassBits = 4;
+        static const int TransparencyBits = 1;
+        static const int DepthBits = 24;
+        static const int ShaderBits = 10;
+        static const int MaterialBits = 15;
+        static const int MeshBits = 10;
+
+    public:
+        RenderQueue();
+        ~RenderQueue();
+
+        // Removes all draws.
+        void Clear();
+
+        // Reserves memory for a number of draws.
+        void Reserve(int count);
+
+        // Adds a draw with its sort key and payload index.
+        void Add(SortKey key, std::uint32_t payload);
+
+        // Sorts draws by their keys.
+        // Splits the work between threads if a job system is given.
+        void Sort(JobSystem* jobSystem = nullptr);
+
+        // Calls a function with the key and payload of every draw in order.
+        template<typename Function>
+        void Submit(Function function) const;
+
+        // Gets keys of draws, sorted after sorting.
+        const std::vector<SortKey>& GetKeys() const;
+
+        // Gets payloads of draws in the order of keys.
+        const std::vector<std::uint32_t>& GetPayloads() const;
+
+        // Gets the number of draws.
+        int GetSize() const;
+
+        // Encodes fields into a sort key.
+        // Indices out of range of their fields are wrapped.
+        static SortKey Encode(const RenderKey& key);
+
+        // Decodes fields of a sort key, with depth quantized.
+        static RenderKey Decode(SortKey key);
+
+    private:
+        // Keys and payloads of draws.
+        std::vector<SortKey> m_keys;
+        std::vector<std::uint32_t> m_payloads;
+    };
+}
+
+//
+// Template implementations.
+//
+
+namespace Graphics
+{
+    template<typename Function>
+    void RenderQueue::Submit(Function function) const
+    {
+        for(std::size_t i = 0; i < m_keys.size(); ++i)
+        {
+            function(m_keys[i], m_payloads[i]);
+        }
+    }
+}
@@ -0,0 +1,342 @@
+#include "Precompiled.hpp"
+#include "RenderTargetPool.hpp"
+using namespace Graphics;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize a render target pool! "
+    #define LogCreateError() "Failed to create a render target! "
+
+    // Pixel transfer parameters and attachment point of an internal format.
+    struct FormatTraits
+    {
+        GLenum format;
+        GLenum type;
+        GLenum attachment;
+    };
+
+    // Gets traits of a supported internal format.
+    bool GetFormatTraits(GLenum internalFormat, FormatTraits& traits)
+    {
+        switch(internalFormat)
+        {
+        case GL_R8:
+        case GL_R16F:
+        case GL_R32F:
+            traits.format = GL_RED;
+            traits.type = internalFormat == GL_R8 ? GL_UNSIGNED_BYTE : GL_FLOAT;
+            traits.attachment = GL_COLOR_ATTACHMENT0;
+            return true;
+
+        case GL_RG8:
+        case GL_RG16F:
+        case GL_RG32F:
+            traits.format = GL_RG;
+            traits.type = internalFormat == GL_RG8 ? GL_UNSIGNED_BYTE : GL_FLOAT;
+            traits.attachment = GL_COLOR_ATTACHMENT0;
+            return true;
+
+        case GL_RGBA8:
+        case GL_SRGB8_ALPHA8:
+        case GL_RGBA16F:
+        case GL_RGBA32F:
+            traits.format = GL_RGBA;
+            traits.type = (internalFormat == GL_RGBA8 || internalFormat == GL_SRGB8_ALPHA8) ? GL_UNSIGNED_BYTE : GL_FLOAT;
+            traits.attachment = GL_COLOR_ATTACHMENT0;
+            return true;
+
+        case GL_DEPTH_COMPONENT16:
+        case GL_DEPTH_COMPONENT24:
+        case GL_DEPTH_COMPONENT32F:
+            traits.format = GL_DEPTH_COMPONENT;
+            traits.type = GL_FLOAT;
+            traits.attachment = GL_DEPTH_ATTACHMENT;
+            return true;
+
+        case GL_DEPTH24_STENCIL8:
+            traits.format = GL_DEPTH_STENCIL;
+            traits.type = GL_UNSIGNED_INT_24_8;
+            traits.attachment = GL_DEPTH_STENCIL_ATTACHMENT;
+            return true;
+
+        default:
+            return false;
+        }
+    }
+}
+
+RenderTargetDesc::RenderTargetDesc() :
+    width(0),
+    height(0),
+    format(GL_RGBA8)
+{
+}
+
+RenderTargetDesc::RenderTargetDesc(int width, int height, GLenum format) :
+    width(width),
+    height(height),
+    format(format)
+{
+}
+
+bool RenderTargetDesc::operator==(const RenderTargetDesc& other) const
+{
+    return width == other.width && height == other.height && format == other.format;
+}
+
+RenderTarget::RenderTarget() :
+    desc(),
+    texture(0),
+    framebuffer(0)
+{
+}
+
+bool RenderTarget::IsValid() const
+{
+    return texture != 0 && framebuffer != 0;
+}
+
+RenderTargetPoolInfo::RenderTargetPoolInfo() :
+    maximumUnusedFrames(3)
+{
+}
+
+RenderTargetPool::RenderTargetPool() :
+    m_acquiredCount(0),
+    m_initialized(false)
+{
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+    this->Cleanup();
+}
+
+void RenderTargetPool::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    Assert(m_acquiredCount == 0, "Cleaning up a render target pool with acquired targets!");
+
+    // Delete released targets.
+    for(FreeTarget& freeTarget : m_freeTargets)
+    {
+        this->DeleteTarget(freeTarget.target);
+    }
+
+    Utility::ClearContainer(m_freeTargets);
+
+    m_info = RenderTargetPoolInfo();
+    m_acquiredCount = 0;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool RenderTargetPool::Initialize(const RenderTargetPoolInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            m_initialized = true;
+            this->Cleanup();
+        }
+    );
+
+    // Validate arguments.
+    if(info.maximumUnusedFrames < 0)
+    {
+        LogError() << LogInitializeError() << "Invalid maximum number of unused frames.";
+        return false;
+    }
+
+    m_info = info;
+
+    // Success!
+    return m_initialized = true;
+}
+
+RenderTarget RenderTargetPool::Acquire(StateCache& cache, const RenderTargetDesc& desc)
+{
+    Assert(m_initialized, "Render target pool has not been initialized!");
+
+    // Reuse a released target of the same size and format.
+    for(std::size_t i = 0; i < m_freeTargets.size(); ++i)
+    {
+        if(!(m_freeTargets[i].target.desc == desc))
+            continue;
+
+        RenderTarget target = m_freeTargets[i].target;
+
+        m_freeTargets[i] = m_freeTargets.back();
+        m_freeTargets.pop_back();
+
+        m_acquiredCount += 1;
+
+        return target;
+    }
+
+    // Create a new target.
+    RenderTarget target = this->CreateTarget(cache, desc);
+
+    if(target.IsValid())
+    {
+        m_acquiredCount += 1;
+    }
+
+    return target;
+}
+
+void RenderTargetPool::Release(const RenderTarget& target)
+{
+    Assert(m_initialized, "Render target pool has not been initialized!");
+
+    if(!target.IsValid())
+        return;
+
+    Assert(m_acquiredCount != 0, "Releasing a render target that was not acquired!");
+    m_acquiredCount -= 1;
+
+    FreeTarget freeTarget;
+    freeTarget.target = target;
+    freeTarget.unusedFrames = 0;
+
+    m_freeTargets.push_back(freeTarget);
+}
+
+void RenderTargetPool::EndFrame(StateCache& cache)
+{
+    if(!m_initialized)
+        return;
+
+    // Delete targets that have not been reused for too long.
+    bool deleted = false;
+
+    for(std::size_t i = 0; i < m_freeTargets.size(); )
+    {
+        FreeTarget& freeTarget = m_freeTargets[i];
+
+        if(++freeTarget.unusedFrames <= m_info.maximumUnusedFrames)
+        {
+            ++i;
+            continue;
+        }
+
+        this->DeleteTarget(freeTarget.target);
+        deleted = true;
+
+        m_freeTargets[i] = m_freeTargets.back();
+        m_freeTargets.pop_back();
+    }
+
+    // Deleted textures may still be cached as bound.
+    if(deleted)
+    {
+        cache.Invalidate();
+    }
+}
+
+RenderTarget RenderTargetPool::CreateTarget(StateCache& cache, const RenderTargetDesc& desc)
+{
+    RenderTarget target;
+
+    // Validate the description.
+    if(desc.width <= 0 || desc.height <= 0)
+    {
+        LogError() << LogCreateError() << "Invalid size (" << desc.width << "x" << desc.height << ").";
+        return target;
+    }
+
+    FormatTraits traits;
+
+    if(!GetFormatTraits(desc.format, traits))
+    {
+        LogError() << LogCreateError() << "Unsupported format (" << desc.format << ").";
+        return target;
+    }
+
+    target.desc = desc;
+
+    // Create the texture.
+    GLenum filter = traits.attachment == GL_COLOR_ATTACHMENT0 ? GL_LINEAR : GL_NEAREST;
+
+    glGenTextures(1, &target.texture);
+    cache.BindTexture(0, GL_TEXTURE_2D, target.texture);
+
+    glTexImage2D(GL_TEXTURE_2D, 0, desc.format, desc.width, desc.height, 0, traits.format, traits.type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // Attach the texture to a framebuffer.
+    // The state cache does not cover framebuffers, so the binding is restored.
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+    glGenFramebuffers(1, &target.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, traits.attachment, GL_TEXTURE_2D, target.texture, 0);
+
+    // Depth only targets have no color buffer to draw into.
+    if(traits.attachment != GL_COLOR_ATTACHMENT0)
+    {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)previousFramebuffer);
+
+    if(status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        LogError() << LogCreateError() << "Framebuffer is not complete (" << status << ").";
+        this->DeleteTarget(target);
+        cache.Invalidate();
+        return target;
+    }
+
+    return target;
+}
+
+void RenderTargetPool::DeleteTarget(RenderTarget& target)
+{
+    if(target.framebuffer != 0)
+    {
+        glDeleteFramebuffers(1, &target.framebuffer);
+        target.framebuffer = 0;
+    }
+
+    if(target.texture != 0)
+    {
+        glDeleteTextures(1, &target.texture);
+        target.texture = 0;
+    }
+}
+
+std::size_t RenderTargetPool::GetTargetCount() const
+{
+    return m_freeTargets.size() + m_acquiredCount;
+}
+
+std::size_t RenderTargetPool::GetFreeCount() const
+{
+    return m_freeTargets.size();
+}
+
+GLenum RenderTargetPool::GetAttachment(GLenum format)
+{
+    FormatTraits traits;
+
+    if(!GetFormatTraits(format, traits))
+        return GL_NONE;
+
+    return traits.attachment;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "StateCache.hpp"
+
+//
+// Render Target Pool
+//
+//  Hands out textures with framebuffers attached, which passes render into
+//  and sample from later. Released targets are kept and reused by the next
+//  acquire of the same size and format, so passes that need a target every
+//  frame don't reallocate GPU memory. Targets that stay unused for a number
+//  of frames are deleted, which frees targets of previous sizes after the
+//  window has been resized.
+//
+//  Color formats are attached as color, depth formats as depth and packed
+//  depth stencil formats as both depth and stencil.
+//
+//  All methods have to be called on a thread with a current context, such
+//  as from functions called by command buffers on the render thread.
+//
+//  Example usage:
+//      Graphics::RenderTargetPool pool;
+//      pool.Initialize();
+//
+//      Graphics::RenderTargetDesc desc(width, height, GL_RGBA16F);
+//      Graphics::RenderTarget target = pool.Acquire(stateCache, desc);
+//
+//      glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+//      /* Render... */
+//      glBindFramebuffer(GL_FRAMEBUFFER, 0);
+//
+//      stateCache.BindTexture(0, GL_TEXTURE_2D, target.texture);
+//      /* Sample... */
+//
+//      pool.Release(target);
+//      pool.EndFrame(stateCache);
+//
+
+namespace Graphics
+{
+    // Render target description.
+    struct RenderTargetDesc
+    {
+        RenderTargetDesc();
+        RenderTargetDesc(int width, int height, GLenum format);
+
+        bool operator==(const RenderTargetDesc& other) const;
+
+        int width;
+        int height;
+
+        // Internal format of the texture.
+        GLenum format;
+    };
+
+    // Render target.
+    struct RenderTarget
+    {
+        RenderTarget();
+
+        // Checks if the target has been created.
+        bool IsValid() const;
+
+        RenderTargetDesc desc;
+        GLuint texture;
+        GLuint framebuffer;
+    };
+
+    // Render target pool initialization struct.
+    struct RenderTargetPoolInfo
+    {
+        // Number of frames a released target is kept without being used.
+        int maximumUnusedFrames;
+
+        RenderTargetPoolInfo();
+    };
+
+    // Render target pool class.
+    class RenderTargetPool : private NonCopyable
+    {
+    public:
+        RenderTargetPool();
+        ~RenderTargetPool();
+
+        // Restores instance to its original state.
+        // Deletes released targets, which all acquired targets have to be.
+        // State caches that may have the textures bound have to be invalidated.
+        void Cleanup();
+
+        // Initializes the render target pool instance.
+        bool Initialize(const RenderTargetPoolInfo& info = RenderTargetPoolInfo());
+
+        // Acquires a target, reusing a released one if it matches.
+        // Returns an invalid target if it couldn't be created.
+        RenderTarget Acquire(StateCache& cache, const RenderTargetDesc& desc);
+
+        // Releases a target back to the pool.
+        void Release(const RenderTarget& target);
+
+        // Ages released targets and deletes those unused for too long.
+        // Invalidates the state cache if any target was deleted.
+        void EndFrame(StateCache& cache);
+
+        // Gets the number of created targets, acquired or not.
+        std::size_t GetTargetCount() const;
+
+        // Gets the number of released targets kept for reuse.
+        std::size_t GetFreeCount() const;
+
+        // Gets the framebuffer attachment point of an internal format.
+        // Returns GL_NONE if the format is not supported.
+        static GLenum GetAttachment(GLenum format);
+
+    private:
+        // Released target.
+        struct FreeTarget
+        {
+            RenderTarget target;
+            int unusedFrames;
+        };
+
+        // Creates a new target.
+        RenderTarget CreateTarget(StateCache& cache, const RenderTargetDesc& desc);
+
+        // Deletes a target.
+        void DeleteTarget(RenderTarget& target);
+
+    private:
+        // Initialization parameters.
+        RenderTargetPoolInfo m_info;
+
+        // Targets released for reuse.
+        std::vector<FreeTarget> m_freeTargets;
+
+        // Number of targets currently acquired.
+        std::size_t m_acquiredCount;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,220 @@
+#include "Precompiled.hpp"
+#include "Renderer.hpp"
+#include "Common/MemoryTracker.hpp"
+using namespace Graphics;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize a renderer! "
+}
+
+RendererInfo::RendererInfo() :
+    window(nullptr),
+    profiler(nullptr)
+{
+}
+
+Renderer::Renderer() :
+    m_window(nullptr),
+    m_profiler(nullptr),
+    m_recordIndex(0),
+    m_frameSubmitted(false),
+    m_rendererExit(false),
+    m_submittedInputTime(System::Window::NoInputTime),
+    m_frameCount(0),
+    m_issuedStateCalls(0),
+    m_avoidedStateCalls(0),
+    m_initialized(false)
+{
+}
+
+Renderer::~Renderer()
+{
+    this->Cleanup();
+}
+
+void Renderer::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Stop the render thread after the submitted frame.
+    {
+        std::lock_guard<std::mutex> lock(m_rendererMutex);
+        m_rendererExit = true;
+    }
+
+    m_rendererCondition.notify_all();
+    m_renderer.join();
+
+    // Take the context back.
+    m_window->MakeContextCurrent();
+
+    // Execute commands that were not submitted, so resources released by them are freed.
+    m_commands[m_recordIndex].Execute(m_stateCache);
+
+    // Delete timer queries while the context is current.
+    if(m_profiler != nullptr)
+    {
+        m_profiler->ReleaseGpuTimers();
+    }
+
+    // Free command buffers.
+    m_commands[0].Cleanup();
+    m_commands[1].Cleanup();
+
+    m_window = nullptr;
+    m_profiler = nullptr;
+    m_recordIndex = 0;
+    m_frameSubmitted = false;
+    m_rendererExit = false;
+    m_submittedInputTime = System::Window::NoInputTime;
+    m_frameCount = 0;
+
+    m_stateCache.Invalidate();
+    m_stateCache.ResetStatistics();
+    m_issuedStateCalls = 0;
+    m_avoidedStateCalls = 0;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool Renderer::Initialize(const RendererInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.window == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid window.";
+        return false;
+    }
+
+    m_window = info.window;
+    m_profiler = info.profiler;
+
+    // Hand the context over to the render thread.
+    m_window->ReleaseContext();
+    m_renderer = std::thread(&Renderer::RunRenderer, this);
+
+    // Success!
+    return m_initialized = true;
+}
+
+CommandBuffer& Renderer::GetCommands()
+{
+    return m_commands[m_recordIndex];
+}
+
+void Renderer::Submit()
+{
+    if(!m_initialized)
+        return;
+
+    std::unique_lock<std::mutex> lock(m_rendererMutex);
+
+    // Wait until the render thread is done with the other buffer.
+    m_rendererCondition.wait(lock, [this]() { return !m_frameSubmitted; });
+
+    // Swap command buffers.
+    m_recordIndex ^= 1;
+    m_commands[m_recordIndex].Reset();
+
+    // Measure input latency of the frame when it is presented.
+    m_submittedInputTime = m_window->TakeInputTime();
+    m_frameSubmitted = true;
+
+    lock.unlock();
+    m_rendererCondition.notify_all();
+}
+
+void Renderer::Finish()
+{
+    if(!m_initialized)
+        return;
+
+    std::unique_lock<std::mutex> lock(m_rendererMutex);
+    m_rendererCondition.wait(lock, [this]() { return !m_frameSubmitted; });
+}
+
+std::uint64_t Renderer::GetFrameCount() const
+{
+    return m_frameCount.load(std::memory_order_relaxed);
+}
+
+StateCache::Statistics Renderer::GetStateStatistics() const
+{
+    StateCache::Statistics statistics;
+    statistics.issuedCalls = m_issuedStateCalls.load(std::memory_order_relaxed);
+    statistics.avoidedCalls = m_avoidedStateCalls.load(std::memory_order_relaxed);
+    return statistics;
+}
+
+void Renderer::RunRenderer()
+{
+    MemoryTracker::SetThreadTag(MemoryTags::Render);
+
+    if(m_profiler != nullptr)
+    {
+        m_profiler->NameThread("Render");
+    }
+
+    std::unique_lock<std::mutex> lock(m_rendererMutex);
+
+    while(true)
+    {
+        m_rendererCondition.wait(lock, [this]() { return m_frameSubmitted || m_rendererExit; });
+
+        if(!m_frameSubmitted)
+            break;
+
+        // Render the submitted frame without holding the lock.
+        // Recording has moved on to the other buffer.
+        const CommandBuffer& commands = m_commands[m_recordIndex ^ 1];
+        double inputTime = m_submittedInputTime;
+
+        lock.unlock();
+
+        {
+            FrameProfiler::CpuScope scope(m_profiler, "MakeContextCurrent");
+            m_window->MakeContextCurrent();
+        }
+
+        {
+            FrameProfiler::CpuScope scope(m_profiler, "Execute");
+            commands.Execute(m_stateCache);
+        }
+
+        {
+            FrameProfiler::CpuScope scope(m_profiler, "Present");
+            m_window->Present(inputTime);
+        }
+
+        // Read back GPU timers of earlier frames.
+        if(m_profiler != nullptr)
+        {
+            m_profiler->CollectGpuTimers();
+            m_profiler->MarkFrame();
+        }
+
+        // Publish counts of state calls of the frame.
+        const StateCache::Statistics& statistics = m_stateCache.GetStatistics();
+        m_issuedStateCalls.store(statistics.issuedCalls, std::memory_order_relaxed);
+        m_avoidedStateCalls.store(statistics.avoidedCalls, std::memory_order_relaxed);
+        m_stateCache.ResetStatistics();
+
+        m_frameCount.fetch_add(1, std::memory_order_relaxed);
+
+        lock.lock();
+
+        // Let the next frame be submitted.
+        m_frameSubmitted = false;
+        m_rendererCondition.notify_all();
+    }
+
+    // Release the context for the thread that cleans up.
+    m_window->ReleaseContext();
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "System/Window.hpp"
+#include "CommandBuffer.hpp"
+
+//
+// Renderer
+//
+//  Executes render commands on a thread that owns the window's context,
+//  so the simulation of the next frame runs in parallel with rendering of
+//  the previous one. Commands are recorded into one of two command buffers
+//  while the other is executed. Submitting a frame waits only if the render
+//  thread is still busy with the previous frame, so recording can be at
+//  most a single frame ahead of rendering.
+//
+//  The context is released from the initializing thread and taken back
+//  when the renderer is cleaned up.
+//
+//  Example usage:
+//      Graphics::RendererInfo info;
+//      info.window = &window;
+//
+//      Graphics::Renderer renderer;
+//      renderer.Initialize(info);
+//
+//      while(window.IsOpen())
+//      {
+//          window.ProcessEvents();
+//          /* ... */
+//
+//          Graphics::CommandBuffer& commands = renderer.GetCommands();
+//          commands.Clear(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+//          /* ... */
+//
+//          renderer.Submit();
+//      }
+//
+
+namespace Graphics
+{
+    // Renderer initialization struct.
+    struct RendererInfo
+    {
+        // Window which context is used for rendering.
+        System::Window* window;
+
+        // Optional profiler of the render thread.
+        FrameProfiler* profiler;
+
+        RendererInfo();
+    };
+
+    // Renderer class.
+    class Renderer : private NonCopyable
+    {
+    public:
+        Renderer();
+        ~Renderer();
+
+        // Restores instance to its original state.
+        // Waits for submitted frames to be rendered and executes commands
+        // that were not submitted on the calling thread without presenting.
+        void Cleanup();
+
+        // Initializes the renderer instance and starts the render thread.
+        bool Initialize(const RendererInfo& info);
+
+        // Gets the command buffer of the frame being recorded.
+        CommandBuffer& GetCommands();
+
+        // Submits the recorded frame for rendering.
+        // Waits for the render thread to finish the previous frame.
+        // The frame reflects input dispatched by the window since the last submit.
+        void Submit();
+
+        // Waits for the render thread to finish submitted frames.
+        void Finish();
+
+        // Gets the number of rendered frames.
+        std::uint64_t GetFrameCount() const;
+
+        // Gets counts of state calls issued and avoided in the last rendered frame.
+        StateCache::Statistics GetStateStatistics() const;
+
+    private:
+        // Runs the render thread.
+        void RunRenderer();
+
+    private:
+        // Rendered window.
+        System::Window* m_window;
+
+        // Profiler of the render thread.
+        FrameProfiler* m_profiler;
+
+        // Command buffers of the recorded and rendered frame.
+        CommandBuffer m_commands[2];
+        int m_recordIndex;
+
+        // Render thread.
+        std::thread m_renderer;
+        std::mutex m_rendererMutex;
+        std::condition_variable m_rendererCondition;
+        bool m_frameSubmitted;
+        bool m_rendererExit;
+
+        // Arrival time of input reflected by the submitted frame.
+        double m_submittedInputTime;
+
+        // State of the context.
+        StateCache m_stateCache;
+
+        // Number of rendered frames.
+        std::atomic<std::uint64_t> m_frameCount;
+
+        // Counts of state calls in the last rendered frame.
+        std::atomic<std::uint32_t> m_issuedStateCalls;
+        std::atomic<std::uint32_t> m_avoidedStateCalls;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,1261 @@
+#include "Precompiled.hpp"
+#include "SpriteBatch.hpp"
+#include "StreamBuffer.hpp"
+#include "ParticleSystem.hpp"
+#include "TextRenderer.hpp"
+#include "Common/Parallel.hpp"
+using namespace Graphics;
+
+namespace Graphics
+{
+    namespace Detail
+    {
+        // Instanced draw of sprites with the same texture.
+        struct SpriteBatchDraw
+        {
+            GLuint texture;
+            GLint first;
+            GLsizei count;
+        };
+
+        // Indirect draw command, laid out as OpenGL reads it.
+        struct SpriteBatchIndirectCommand
+        {
+            GLuint count;
+            GLuint instanceCount;
+            GLuint first;
+            GLuint baseInstance;
+        };
+
+        // Frame data passed to the render thread.
+        struct SpriteBatchFrame
+        {
+            SpriteBatchFrame() :
+                state(nullptr),
+                region(0),
+                staged(false),
+                indirect(false),
+                viewProjection(1.0f),
+                fence(nullptr)
+            {
+            }
+
+            SpriteBatchState* state;
+            int region;
+
+            std::vector<SpriteBatchDraw> draws;
+            std::vector<SpriteInstance> staging;
+            bool staged;
+
+            // Draws of baked static sprites in visible cells.
+            std::vector<SpriteBatchDraw> staticDraws;
+
+            // Instances in staging are culled on the GPU and drawn indirectly.
+            // Draw index of every staged instance and commands built from draws.
+            bool indirect;
+            std::vector<GLuint> drawIndices;
+            std::vector<SpriteBatchIndirectCommand> commands;
+
+            glm::mat4 viewProjection;
+            GLsync fence;
+        };
+
+        // State shared with the render thread.
+        struct SpriteBatchState
+        {
+            SpriteBatchState() :
+                capacity(0),
+                programCache(nullptr),
+                program(0),
+                viewProjectionLocation(-1),
+                textureLocation(-1),
+                vertexArray(0),
+                quadBuffer(0),
+                instanceBuffer(0),
+                whiteTexture(0),
+                mapped(nullptr),
+                gpuCulling(false),
+                cullProgram(0),
+                planesLocation(-1),
+                instanceCountLocation(-1),
+                cullInstanceBuffer(0),
+                cullDrawBuffer(0),
+                visibleBuffer(0),
+                indirectBuffer(0),
+                indirect(false),
+                staticBuffer(0),
+                previousRegion(-1)
+            {
+            }
+
+            int capacity;
+
+            ProgramCache* programCache;
+            GLuint program;
+            GLint viewProjectionLocation;
+            GLint textureLocation;
+
+            GLuint vertexArray;
+            GLuint quadBuffer;
+            GLuint instanceBuffer;
+            GLuint whiteTexture;
+
+            std::atomic<SpriteInstance*> mapped;
+            StreamBuffer stream;
+
+            // Culling on the GPU, enabled once its objects have been created.
+            bool gpuCulling;
+            GLuint cullProgram;
+            GLint planesLocation;
+            GLint instanceCountLocation;
+
+            GLuint cullInstanceBuffer;
+            GLuint cullDrawBuffer;
+            GLuint visibleBuffer;
+            GLuint indirectBuffer;
+
+            std::atomic<bool> indirect;
+
+            // Instances of baked static sprites.
+            GLuint staticBuffer;
+
+            SpriteBatchFrame frames[SpriteBatch::FrameCount];
+            int previousRegion;
+        };
+
+        // Baked static sprites passed to the render thread.
+        struct SpriteBatchBake
+        {
+            SpriteBatchState* state;
+            std::vector<SpriteInstance> instances;
+        };
+    }
+}
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize a sprite batch! "
+    #define LogCreateResourcesError() "Failed to create sprite batch resources! "
+
+    // Time to wait for the GPU to read a region of the instance buffer.
+    const GLuint64 FenceTimeout = 1000000000;
+
+    // Number of sprites culled by a single compute work group.
+    const GLuint CullGroupSize = 64;
+
+    // Culling shader reads instances as floats, so it doesn't depend on structure layout rules.
+    static_assert(sizeof(SpriteInstance) == 14 * sizeof(float), "Culling shader expects sprite instances of 14 floats!");
+
+    // Sprite shaders.
+    const char* VertexShader =
+        "#version 330 core\n"
+        "layout(location = 0) in vec2 vertexCorner;\n"
+        "layout(location = 1) in vec4 instancePositionSize;\n"
+        "layout(location = 2) in vec2 instanceRotationDepth;\n"
+        "layout(location = 3) in vec4 instanceColor;\n"
+        "layout(location = 4) in vec4 instanceTextureRect;\n"
+        "uniform mat4 viewProjection;\n"
+        "out vec2 fragmentTexture;\n"
+        "out vec4 fragmentColor;\n"
+        "void main()\n"
+        "{\n"
+        "    vec2 corner = vertexCorner * instancePositionSize.zw;\n"
+        "    float s = sin(instanceRotationDepth.x);\n"
+        "    float c = cos(instanceRotationDepth.x);\n"
+        "    vec2 position = instancePositionSize.xy + vec2(c * corner.x - s * corner.y, s * corner.x + c * corner.y);\n"
+        "    gl_Position = viewProjection * vec4(position, instanceRotationDepth.y, 1.0);\n"
+        "    fragmentTexture = mix(instanceTextureRect.xy, instanceTextureRect.zw, vertexCorner + 0.5);\n"
+        "    fragmentColor = instanceColor;\n"
+        "}\n";
+
+    const char* FragmentShader =
+        "#version 330 core\n"
+        "uniform sampler2D spriteTexture;\n"
+        "in vec2 fragmentTexture;\n"
+        "in vec4 fragmentColor;\n"
+        "out vec4 outputColor;\n"
+        "void main()\n"
+        "{\n"
+        "    outputColor = fragmentColor * texture(spriteTexture, fragmentTexture);\n"
+        "}\n";
+
+    // Culls sprites against frustum planes and appends visible ones to their draws.
+    // Every draw has a range of the visible buffer starting at its base instance,
+    // large enough for all of its sprites, and counts visible ones atomically.
+    const char* CullShader =
+        "#version 430 core\n"
+        "layout(local_size_x = 64) in;\n"
+        "struct DrawCommand\n"
+        "{\n"
+        "    uint count;\n"
+        "    uint instanceCount;\n"
+        "    uint first;\n"
+        "    uint baseInstance;\n"
+        "};\n"
+        "layout(std430, binding = 0) readonly buffer Instances { float instances[]; };\n"
+        "layout(std430, binding = 1) readonly buffer DrawIndices { uint drawIndices[]; };\n"
+        "layout(std430, binding = 2) writeonly buffer Visible { float visible[]; };\n"
+        "layout(std430, binding = 3) buffer Commands { DrawCommand commands[]; };\n"
+        "uniform vec4 planes[6];\n"
+        "uniform uint instanceCount;\n"
+        "void main()\n"
+        "{\n"
+        "    uint index = gl_GlobalInvocationID.x;\n"
+        "    if(index >= instanceCount)\n"
+        "        return;\n"
+        "    uint source = index * 14u;\n"
+        "    vec3 center = vec3(instances[source + 0u], instances[source + 1u], instances[source + 5u]);\n"
+        "    float radius = length(vec2(instances[source + 2u], instances[source + 3u])) * 0.5;\n"
+        "    for(int i = 0; i < 6; ++i)\n"
+        "    {\n"
+        "        if(dot(planes[i].xyz, center) + planes[i].w < -radius)\n"
+        "            return;\n"
+        "    }\n"
+        "    uint draw = drawIndices[index];\n"
+        "    uint slot = atomicAdd(commands[draw].instanceCount, 1u);\n"
+        "    uint destination = (commands[draw].baseInstance + slot) * 14u;\n"
+        "    for(uint i = 0u; i < 14u; ++i)\n"
+        "    {\n"
+        "        visible[destination + i] = instances[source + i];\n"
+        "    }\n"
+        "}\n";
+
+    // Creates an instance of a sprite placed by a transform.
+    SpriteInstance CreateInstance(const Game::Transform& transform, const Sprite& sprite)
+    {
+        SpriteInstance instance;
+        instance.position = glm::vec2(transform.position);
+        instance.size = sprite.size * transform.scale;
+        instance.rotation = transform.rotation;
+        instance.depth = transform.position.z;
+        instance.color = sprite.color;
+        instance.textureRect = sprite.textureRect;
+
+        return instance;
+    }
+
+    // Links the sprite program, loading its binary when it has been cached.
+    GLuint LinkProgram(ProgramCache* programCache)
+    {
+        ShaderStage stages[2];
+        stages[0].type = GL_VERTEX_SHADER;
+        stages[0].source = VertexShader;
+        stages[1].type = GL_FRAGMENT_SHADER;
+        stages[1].source = FragmentShader;
+
+        if(programCache != nullptr)
+            return programCache->Link(stages, 2, "Sprite");
+
+        return ProgramCache::CompileAndLink(stages, 2, "Sprite");
+    }
+
+    // Links the culling program, loading its binary when it has been cached.
+    GLuint LinkCullProgram(ProgramCache* programCache)
+    {
+        ShaderStage stage;
+        stage.type = GL_COMPUTE_SHADER;
+        stage.source = CullShader;
+
+        if(programCache != nullptr)
+            return programCache->Link(&stage, 1, "SpriteCulling");
+
+        return ProgramCache::CompileAndLink(&stage, 1, "SpriteCulling");
+    }
+
+    // Creates OpenGL objects of culling on the GPU.
+    // Compute shaders and indirect draws with base instances need OpenGL 4.3.
+    void CreateCullResources(Detail::SpriteBatchState* state)
+    {
+        if(!GLEW_VERSION_4_3)
+        {
+            LogWarning() << "Culling sprites on the GPU needs OpenGL 4.3, falling back to culling on the CPU.";
+            return;
+        }
+
+        state->cullProgram = LinkCullProgram(state->programCache);
+
+        if(state->cullProgram == 0)
+        {
+            LogWarning() << "Couldn't link the sprite culling program, falling back to culling on the CPU.";
+            return;
+        }
+
+        state->planesLocation = glGetUniformLocation(state->cullProgram, "planes");
+        state->instanceCountLocation = glGetUniformLocation(state->cullProgram, "instanceCount");
+
+        // Instances and commands are uploaded every frame, visible instances never leave the GPU.
+        glGenBuffers(1, &state->cullInstanceBuffer);
+        glGenBuffers(1, &state->cullDrawBuffer);
+        glGenBuffers(1, &state->indirectBuffer);
+
+        glGenBuffers(1, &state->visibleBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, state->visibleBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)sizeof(SpriteInstance) * state->capacity, nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        state->indirect.store(true, std::memory_order_release);
+    }
+
+    // Points instance attributes at the first instance of a draw.
+    void SetInstanceAttributes(std::size_t offset)
+    {
+        const GLsizei stride = sizeof(SpriteInstance);
+
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offset + offsetof(SpriteInstance, position)));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offset + offsetof(SpriteInstance, rotation)));
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offset + offsetof(SpriteInstance, color)));
+        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offset + offsetof(SpriteInstance, textureRect)));
+    }
+
+    // Creates OpenGL objects on the render thread.
+    void CreateResources(StateCache& cache, void* argument)
+    {
+        auto state = static_cast<Detail::SpriteBatchState*>(argument);
+
+        // Create the program.
+        state->program = LinkProgram(state->programCache);
+
+        if(state->program == 0)
+            return;
+
+        state->viewProjectionLocation = glGetUniformLocation(state->program, "viewProjection");
+        state->textureLocation = glGetUniformLocation(state->program, "spriteTexture");
+
+        // Create the quad, which is drawn as a triangle strip.
+        const float QuadCorners[] =
+        {
+            -0.5f, -0.5f,
+             0.5f, -0.5f,
+            -0.5f,  0.5f,
+             0.5f,  0.5f,
+        };
+
+        glGenVertexArrays(1, &state->vertexArray);
+        cache.BindVertexArray(state->vertexArray);
+
+        glGenBuffers(1, &state->quadBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, state->quadBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(QuadCorners), QuadCorners, GL_STATIC_DRAW);
+
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+        // Create the instance buffer with a region per frame in flight.
+        // Without buffer storage, staged instances are streamed instead.
+        if(GLEW_ARB_buffer_storage)
+        {
+            GLsizeiptr instanceBufferSize = (GLsizeiptr)sizeof(SpriteInstance) * state->capacity * SpriteBatch::FrameCount;
+
+            const GLbitfield MapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+            glGenBuffers(1, &state->instanceBuffer);
+            glBindBuffer(GL_ARRAY_BUFFER, state->instanceBuffer);
+            glBufferStorage(GL_ARRAY_BUFFER, instanceBufferSize, nullptr, MapFlags);
+
+            state->mapped.store(static_cast<SpriteInstance*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, instanceBufferSize, MapFlags)), std::memory_order_release);
+        }
+        else
+        {
+            StreamBufferInfo streamInfo;
+            streamInfo.target = GL_ARRAY_BUFFER;
+            streamInfo.regionSize = sizeof(SpriteInstance) * state->capacity;
+            streamInfo.regionCount = SpriteBatch::FrameCount;
+            streamInfo.persistent = false;
+
+            if(!state->stream.Initialize(streamInfo))
+            {
+                cache.BindVertexArray(0);
+                glDeleteProgram(state->program);
+                state->program = 0;
+                return;
+            }
+
+            glBindBuffer(GL_ARRAY_BUFFER, state->stream.GetHandle());
+        }
+
+        for(GLuint attribute = 1; attribute <= 4; ++attribute)
+        {
+            glEnableVertexAttribArray(attribute);
+            glVertexAttribDivisor(attribute, 1);
+        }
+
+        SetInstanceAttributes(0);
+
+        cache.BindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // Create a white texture for sprites without one.
+        const std::uint32_t WhitePixel = 0xFFFFFFFF;
+
+        glGenTextures(1, &state->whiteTexture);
+        cache.BindTexture(0, GL_TEXTURE_2D, state->whiteTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &WhitePixel);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        cache.BindTexture(0, GL_TEXTURE_2D, 0);
+
+        // Create objects of culling on the GPU if requested.
+        if(state->gpuCulling)
+        {
+            CreateCullResources(state);
+        }
+    }
+
+    // Destroys OpenGL objects and the state on the render thread.
+    void DestroyResources(StateCache& cache, void* argument)
+    {
+        auto state = static_cast<Detail::SpriteBatchState*>(argument);
+
+        for(auto& frame : state->frames)
+        {
+            if(frame.fence != nullptr)
+            {
+                glDeleteSync(frame.fence);
+            }
+        }
+
+        state->stream.Cleanup();
+
+        glDeleteBuffers(1, &state->indirectBuffer);
+        glDeleteBuffers(1, &state->visibleBuffer);
+        glDeleteBuffers(1, &state->cullDrawBuffer);
+        glDeleteBuffers(1, &state->cullInstanceBuffer);
+        glDeleteProgram(state->cullProgram);
+
+        glDeleteBuffers(1, &state->staticBuffer);
+        glDeleteTextures(1, &state->whiteTexture);
+        glDeleteBuffers(1, &state->instanceBuffer);
+        glDeleteBuffers(1, &state->quadBuffer);
+        glDeleteVertexArrays(1, &state->vertexArray);
+        glDeleteProgram(state->program);
+
+        // Deleted objects may have been bound.
+        cache.Invalidate();
+
+        delete state;
+    }
+
+    // Uploads baked static sprites on the render thread.
+    void UploadStatic(StateCache& cache, void* argument)
+    {
+        auto bake = static_cast<Detail::SpriteBatchBake*>(argument);
+        auto state = bake->state;
+
+        if(state->staticBuffer == 0)
+        {
+            glGenBuffers(1, &state->staticBuffer);
+        }
+
+        // Static sprites are written once and drawn every frame.
+        glBindBuffer(GL_ARRAY_BUFFER, state->staticBuffer);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(sizeof(SpriteInstance) * bake->instances.size()), bake->instances.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        delete bake;
+    }
+
+    // Draws ranges of baked static sprites in visible cells.
+    void DrawStatic(StateCache& cache, Detail::SpriteBatchFrame* frame)
+    {
+        auto state = frame->state;
+
+        if(frame->staticDraws.empty() || state->staticBuffer == 0)
+            return;
+
+        cache.UseProgram(state->program);
+        glUniformMatrix4fv(state->viewProjectionLocation, 1, GL_FALSE, &frame->viewProjection[0][0]);
+        glUniform1i(state->textureLocation, 0);
+
+        cache.BindVertexArray(state->vertexArray);
+        glBindBuffer(GL_ARRAY_BUFFER, state->staticBuffer);
+
+        for(const auto& draw : frame->staticDraws)
+        {
+            SetInstanceAttributes(sizeof(SpriteInstance) * draw.first);
+
+            cache.BindTexture(0, GL_TEXTURE_2D, draw.texture != 0 ? draw.texture : state->whiteTexture);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, draw.count);
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // Culls staged instances on the GPU and draws visible ones indirectly.
+    void DrawIndirect(StateCache& cache, Detail::SpriteBatchFrame* frame)
+    {
+        auto state = frame->state;
+
+        if(frame->staging.empty())
+            return;
+
+        GLuint instanceCount = (GLuint)frame->staging.size();
+
+        // Upload all instances along with the draw each of them belongs to.
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, state->cullInstanceBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)sizeof(SpriteInstance) * instanceCount, frame->staging.data(), GL_STREAM_DRAW);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, state->cullDrawBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)sizeof(GLuint) * instanceCount, frame->drawIndices.data(), GL_STREAM_DRAW);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        // Upload commands with no instances, which culling counts.
+        frame->commands.resize(frame->draws.size());
+
+        for(std::size_t i = 0; i < frame->draws.size(); ++i)
+        {
+            Detail::SpriteBatchIndirectCommand& command = frame->commands[i];
+            command.count = 4;
+            command.instanceCount = 0;
+            command.first = 0;
+            command.baseInstance = (GLuint)frame->draws[i].first;
+        }
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, state->indirectBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, (GLsizeiptr)(sizeof(Detail::SpriteBatchIndirectCommand) * frame->commands.size()), frame->commands.data(), GL_STREAM_DRAW);
+
+        // Cull instances into ranges of their draws.
+        glm::vec4 planes[FrustumCuller::PlaneCount];
+        FrustumCuller::GetPlanes(frame->viewProjection, planes);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, state->cullInstanceBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, state->cullDrawBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, state->visibleBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, state->indirectBuffer);
+
+        cache.UseProgram(state->cullProgram);
+        glUniform4fv(state->planesLocation, FrustumCuller::PlaneCount, &planes[0][0]);
+        glUniform1ui(state->instanceCountLocation, instanceCount);
+
+        glDispatchCompute((instanceCount + CullGroupSize - 1) / CullGroupSize, 1, 1);
+
+        // Make counts and visible instances written by culling visible to draws.
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+        for(GLuint binding = 0; binding < 4; ++binding)
+        {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0);
+        }
+
+        // Draw visible sprites with the same texture at once.
+        // Base instances of commands offset instance attributes to ranges of draws.
+        cache.UseProgram(state->program);
+        glUniformMatrix4fv(state->viewProjectionLocation, 1, GL_FALSE, &frame->viewProjection[0][0]);
+        glUniform1i(state->textureLocation, 0);
+
+        cache.BindVertexArray(state->vertexArray);
+
+        glBindBuffer(GL_ARRAY_BUFFER, state->visibleBuffer);
+        SetInstanceAttributes(0);
+
+        for(std::size_t i = 0; i < frame->draws.size(); ++i)
+        {
+            const Detail::SpriteBatchDraw& draw = frame->draws[i];
+
+            cache.BindTexture(0, GL_TEXTURE_2D, draw.texture != 0 ? draw.texture : state->whiteTexture);
+            glDrawArraysIndirect(GL_TRIANGLE_STRIP, reinterpret_cast<const void*>(sizeof(Detail::SpriteBatchIndirectCommand) * i));
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    // Draws instances culled on the CPU.
+    void DrawInstanced(StateCache& cache, Detail::SpriteBatchFrame* frame)
+    {
+        auto state = frame->state;
+
+        std::size_t regionOffset = sizeof(SpriteInstance) * state->capacity * frame->region;
+
+        // Stream staged instances.
+        if(frame->staged)
+        {
+            if(frame->staging.empty())
+                return;
+
+            std::size_t stagingSize = sizeof(SpriteInstance) * frame->staging.size();
+            void* data = state->stream.Map(stagingSize, sizeof(SpriteInstance), regionOffset);
+
+            if(data == nullptr)
+                return;
+
+            std::memcpy(data, frame->staging.data(), stagingSize);
+            state->stream.Unmap();
+
+            glBindBuffer(GL_ARRAY_BUFFER, state->stream.GetHandle());
+        }
+        else
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, state->instanceBuffer);
+        }
+
+        // Draw sprites with the same texture at once.
+        cache.UseProgram(state->program);
+        glUniformMatrix4fv(state->viewProjectionLocation, 1, GL_FALSE, &frame->viewProjection[0][0]);
+        glUniform1i(state->textureLocation, 0);
+
+        cache.BindVertexArray(state->vertexArray);
+
+        for(const auto& draw : frame->draws)
+        {
+            SetInstanceAttributes(regionOffset + sizeof(SpriteInstance) * draw.first);
+
+            cache.BindTexture(0, GL_TEXTURE_2D, draw.texture != 0 ? draw.texture : state->whiteTexture);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, draw.count);
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // Move streamed instances to the next region.
+        if(frame->staged)
+        {
+            state->stream.EndFrame();
+        }
+    }
+
+    // Draws a frame on the render thread.
+    void RenderFrame(StateCache& cache, void* argument)
+    {
+        auto frame = static_cast<Detail::SpriteBatchFrame*>(argument);
+        auto state = frame->state;
+
+        if(state->program == 0)
+            return;
+
+        // Static sprites are drawn before gathered ones.
+        DrawStatic(cache, frame);
+
+        if(frame->indirect)
+        {
+            DrawIndirect(cache, frame);
+        }
+        else
+        {
+            DrawInstanced(cache, frame);
+        }
+
+        // Keep the recording thread from writing regions that the GPU still reads.
+        // Waiting for the previous frame lets the recording thread reuse its region
+        // when it records the frame after the next one.
+        if(state->mapped.load(std::memory_order_relaxed) != nullptr)
+        {
+            if(frame->fence != nullptr)
+            {
+                glDeleteSync(frame->fence);
+            }
+
+            frame->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+            if(state->previousRegion >= 0)
+            {
+                Detail::SpriteBatchFrame& previous = state->frames[state->previousRegion];
+
+                if(previous.fence != nullptr)
+                {
+                    if(glClientWaitSync(previous.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FenceTimeout) == GL_TIMEOUT_EXPIRED)
+                    {
+                        LogWarning() << "Timed out waiting for the GPU to read sprite instances.";
+                    }
+
+                    glDeleteSync(previous.fence);
+                    previous.fence = nullptr;
+                }
+            }
+        }
+
+        state->previousRegion = frame->region;
+    }
+}
+
+SpriteBatchInfo::SpriteBatchInfo() :
+    renderer(nullptr),
+    componentSystem(nullptr),
+    jobSystem(nullptr),
+    programCache(nullptr),
+    capacity(64 * 1024),
+    gpuCulling(false),
+    occlusionCulling(false),
+    temporalOcclusion(false),
+    staticCellSize(1024.0f),
+    particleSystem(nullptr),
+    textRenderer(nullptr)
+{
+}
+
+SpriteBatch::SpriteBatch() :
+    m_componentSystem(nullptr),
+    m_renderer(nullptr),
+    m_jobSystem(nullptr),
+    m_particleSystem(nullptr),
+    m_textRenderer(nullptr),
+    m_state(nullptr),
+    m_staticCellSize(0.0f),
+    m_occlusionCulling(false),
+    m_frameIndex(0),
+    m_spriteCount(0),
+    m_staticSpriteCount(0),
+    m_culledCount(0),
+    m_occludedCount(0),
+    m_particleCount(0),
+    m_textCount(0),
+    m_batchCount(0),
+    m_initialized(false)
+{
+}
+
+SpriteBatch::~SpriteBatch()
+{
+    this->Cleanup();
+}
+
+void SpriteBatch::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Destroy the state on the render thread after frames that use it.
+    m_renderer->GetCommands().Call(&DestroyResources, m_state);
+    m_state = nullptr;
+
+    m_componentSystem = nullptr;
+    m_renderer = nullptr;
+    m_jobSystem = nullptr;
+    m_particleSystem = nullptr;
+    m_textRenderer = nullptr;
+
+    Utility::ClearContainer(m_instances);
+    Utility::ClearContainer(m_keys);
+    m_culler.Clear();
+
+    Utility::ClearContainer(m_staticCells);
+    Utility::ClearContainer(m_staticDraws);
+    m_staticCuller.Clear();
+    m_staticCellSize = 0.0f;
+
+    m_occlusionCuller.Cleanup();
+    m_occlusionCulling = false;
+
+    m_frameIndex = 0;
+    m_spriteCount = 0;
+    m_staticSpriteCount = 0;
+    m_culledCount = 0;
+    m_occludedCount = 0;
+    m_particleCount = 0;
+    m_textCount = 0;
+    m_batchCount = 0;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool SpriteBatch::Initialize(const SpriteBatchInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.renderer == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid renderer.";
+        return false;
+    }
+
+    if(info.componentSystem == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid component system.";
+        return false;
+    }
+
+    if(info.capacity <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid capacity.";
+        return false;
+    }
+
+    if(info.staticCellSize <= 0.0f)
+    {
+        LogError() << LogInitializeError() << "Invalid static cell size.";
+        return false;
+    }
+
+    m_renderer = info.renderer;
+    m_componentSystem = info.componentSystem;
+    m_jobSystem = info.jobSystem;
+    m_particleSystem = info.particleSystem;
+    m_textRenderer = info.textRenderer;
+    m_staticCellSize = info.staticCellSize;
+
+    // Initialize culling against occluders.
+    if(info.occlusionCulling)
+    {
+        OcclusionCullerInfo occlusionCullerInfo;
+        occlusionCullerInfo.jobSystem = info.jobSystem;
+        occlusionCullerInfo.temporal = info.temporalOcclusion;
+
+        if(!m_occlusionCuller.Initialize(occlusionCullerInfo))
+        {
+            LogError() << LogInitializeError() << "Couldn't initialize the occlusion culler.";
+            return false;
+        }
+
+        m_occlusionCulling = true;
+    }
+
+    // Create the state and its OpenGL objects on the render thread.
+    m_state = new Detail::SpriteBatchState();
+    m_state->capacity = info.capacity;
+    m_state->programCache = info.programCache;
+    m_state->gpuCulling = info.gpuCulling;
+
+    for(int i = 0; i < FrameCount; ++i)
+    {
+        m_state->frames[i].state = m_state;
+        m_state->frames[i].region = i;
+    }
+
+    m_renderer->GetCommands().Call(&CreateResources, m_state);
+
+    // Success!
+    return m_initialized = true;
+}
+
+void SpriteBatch::Draw(CommandBuffer& commands, const glm::mat4& viewProjection)
+{
+    if(!m_initialized)
+        return;
+
+    // Cull on the GPU once its objects have been created on the render thread.
+    bool indirect = m_state->indirect.load(std::memory_order_acquire);
+
+    // Gather sprites that are not baked along with their bounds.
+    m_instances.clear();
+    m_keys.clear();
+    m_culler.Clear();
+    m_occlusionCuller.Clear();
+
+    const Game::ComponentSignature staticSignature = Game::ComponentTypes::GetSignature<Game::Static>();
+
+    m_componentSystem->ForEachChunkExcluding<Game::Transform, Sprite>(staticSignature, [&](int count, const Game::EntityHandle* entities, Game::Transform* transforms, Sprite* sprites)
+    {
+        for(int i = 0; i < count; ++i)
+        {
+            const Sprite& sprite = sprites[i];
+            SpriteInstance instance = CreateInstance(transforms[i], sprite);
+
+            // Bound the rotated quad with a sphere around its center.
+            if(!indirect)
+            {
+                m_culler.AddSphere(glm::vec3(instance.position, instance.depth), glm::length(instance.size) * 0.5f);
+            }
+
+            // Sprites are flat, so their bounds and occluders have no depth extent.
+            if(!indirect && m_occlusionCulling)
+            {
+                glm::vec3 center(instance.position, instance.depth);
+                float radius = glm::length(instance.size) * 0.5f;
+
+                m_occlusionCuller.AddBounds(center - glm::vec3(radius, radius, 0.0f), center + glm::vec3(radius, radius, 0.0f));
+
+                // Rotated occluders only cover the largest square that fits inside them.
+                if(sprite.occluder)
+                {
+                    glm::vec2 extent = glm::abs(instance.size) * 0.5f;
+
+                    if(instance.rotation != 0.0f)
+                    {
+                        float side = std::min(extent.x, extent.y) / (std::abs(std::cos(instance.rotation)) + std::abs(std::sin(instance.rotation)));
+                        extent = glm::vec2(side, side);
+                    }
+
+                    m_occlusionCuller.AddOccluder(center - glm::vec3(extent, 0.0f), center + glm::vec3(extent, 0.0f));
+                }
+            }
+
+            m_keys.push_back((SortKey)sprite.texture << 32 | (SortKey)m_instances.size());
+            m_instances.push_back(instance);
+        }
+    });
+
+    // Cull sprites and keep visible ones up to the capacity.
+    // Sprites culled on the GPU are all submitted, as their visibility is never read back.
+    const std::size_t capacity = m_state->capacity;
+    std::size_t visibleCount = m_keys.size();
+    std::size_t occludedCount = 0;
+
+    if(!indirect)
+    {
+        m_culler.Cull(viewProjection, m_jobSystem);
+        visibleCount = m_culler.GetVisible().size();
+
+        // Test sprites that passed frustum culling against occluders.
+        if(m_occlusionCulling)
+        {
+            m_occlusionCuller.Cull(viewProjection, m_culler.GetVisible());
+            visibleCount = m_occlusionCuller.GetVisible().size();
+            occludedCount = m_culler.GetVisible().size() - visibleCount;
+        }
+    }
+
+    if(visibleCount > capacity)
+    {
+        LogWarning() << "Sprite batch capacity of " << capacity << " sprites has been exceeded.";
+    }
+
+    std::size_t culledCount = m_keys.size() - visibleCount;
+    visibleCount = std::min(visibleCount, capacity);
+
+    if(!indirect)
+    {
+        // Visible indices are ascending, so keys can be compacted in place.
+        const FrustumCuller::IndexList& visible = m_occlusionCulling ? m_occlusionCuller.GetVisible() : m_culler.GetVisible();
+
+        for(std::size_t i = 0; i < visibleCount; ++i)
+        {
+            m_keys[i] = m_keys[visible[i]];
+        }
+    }
+
+    m_keys.resize(visibleCount);
+
+    // Sort sprites by texture.
+    Parallel::Sort(m_jobSystem, m_keys.data(), (int)m_keys.size());
+
+    // Particles fill the capacity left by visible sprites.
+    std::size_t particleCount = 0;
+
+    if(m_particleSystem != nullptr)
+    {
+        std::size_t liveCount = (std::size_t)m_particleSystem->GetParticleCount();
+
+        if(liveCount > capacity - m_keys.size())
+        {
+            LogWarning() << "Sprite batch capacity of " << capacity << " sprites has been exceeded by particles.";
+        }
+
+        particleCount = std::min(liveCount, capacity - m_keys.size());
+    }
+
+    // Text is drawn last and fills what is left.
+    std::size_t textCount = 0;
+    GLuint textTexture = 0;
+
+    if(m_textRenderer != nullptr)
+    {
+        // Glyphs rasterized in this frame are uploaded before the draw that uses them.
+        m_textRenderer->Flush(commands);
+        textTexture = m_textRenderer->GetTexture();
+
+        if(textTexture != 0)
+        {
+            std::size_t queuedCount = (std::size_t)m_textRenderer->GetInstanceCount();
+            std::size_t remaining = capacity - m_keys.size() - particleCount;
+
+            if(queuedCount > remaining)
+            {
+                LogWarning() << "Sprite batch capacity of " << capacity << " sprites has been exceeded by text.";
+            }
+
+            textCount = std::min(queuedCount, remaining);
+        }
+    }
+
+    std::size_t instanceCount = m_keys.size() + particleCount + textCount;
+
+    // Write sprites into the region of this frame.
+    Detail::SpriteBatchFrame& frame = m_state->frames[m_frameIndex % FrameCount];
+    SpriteInstance* destination = m_state->mapped.load(std::memory_order_acquire);
+
+    frame.staged = !indirect && destination == nullptr;
+    frame.indirect = indirect;
+
+    if(frame.staged || frame.indirect)
+    {
+        frame.staging.resize(instanceCount);
+        destination = frame.staging.data();
+    }
+    else
+    {
+        frame.staging.clear();
+        destination += capacity * frame.region;
+    }
+
+    frame.draws.clear();
+    frame.drawIndices.resize(indirect ? instanceCount : 0);
+
+    // Cull cells of static sprites and draw whole ranges of visible ones.
+    // Draws of neighboring cells are joined when they continue each other.
+    frame.staticDraws.clear();
+    int staticSpriteCount = 0;
+
+    if(!m_staticCells.empty())
+    {
+        m_staticCuller.Cull(viewProjection, m_jobSystem);
+
+        for(int index : m_staticCuller.GetVisible())
+        {
+            const StaticCell& cell = m_staticCells[index];
+
+            for(int i = cell.firstDraw; i < cell.firstDraw + cell.drawCount; ++i)
+            {
+                const StaticDraw& staticDraw = m_staticDraws[i];
+
+                if(!frame.staticDraws.empty())
+                {
+                    Detail::SpriteBatchDraw& previous = frame.staticDraws.back();
+
+                    if(previous.texture == staticDraw.texture && previous.first + previous.count == staticDraw.first)
+                    {
+                        previous.count += staticDraw.count;
+                        continue;
+                    }
+                }
+
+                Detail::SpriteBatchDraw draw;
+                draw.texture = staticDraw.texture;
+                draw.first = (GLint)staticDraw.first;
+                draw.count = (GLsizei)staticDraw.count;
+
+                frame.staticDraws.push_back(draw);
+            }
+
+            staticSpriteCount += cell.spriteCount;
+        }
+    }
+
+    for(std::size_t i = 0; i < m_keys.size(); ++i)
+    {
+        GLuint texture = (GLuint)(m_keys[i] >> 32);
+        std::size_t index = (std::size_t)(m_keys[i] & 0xFFFFFFFF);
+
+        destination[i] = m_instances[index];
+
+        // Start a new draw when the texture changes.
+        if(frame.draws.empty() || frame.draws.back().texture != texture)
+        {
+            Detail::SpriteBatchDraw draw;
+            draw.texture = texture;
+            draw.first = (GLint)i;
+            draw.count = 0;
+
+            frame.draws.push_back(draw);
+        }
+
+        frame.draws.back().count += 1;
+
+        // Culling on the GPU appends visible sprites to their draws.
+        if(indirect)
+        {
+            frame.drawIndices[i] = (GLuint)(frame.draws.size() - 1);
+        }
+    }
+
+    // Write particles straight after sprites, with a draw per emitter.
+    if(particleCount > 0)
+    {
+        std::size_t first = m_keys.size();
+        m_particleSystem->Write(destination + first, (int)particleCount);
+
+        for(const ParticleRange& range : m_particleSystem->GetRanges())
+        {
+            Detail::SpriteBatchDraw draw;
+            draw.texture = range.texture;
+            draw.first = (GLint)(first + range.first);
+            draw.count = (GLsizei)range.count;
+
+            frame.draws.push_back(draw);
+
+            if(indirect)
+            {
+                std::fill(frame.drawIndices.begin() + draw.first, frame.drawIndices.begin() + draw.first + draw.count, (GLuint)(frame.draws.size() - 1));
+            }
+        }
+    }
+
+    // Write text after particles, with a single draw from the glyph atlas.
+    if(textCount > 0)
+    {
+        std::size_t first = m_keys.size() + particleCount;
+        m_textRenderer->Write(destination + first, (int)textCount);
+
+        Detail::SpriteBatchDraw draw;
+        draw.texture = textTexture;
+        draw.first = (GLint)first;
+        draw.count = (GLsizei)textCount;
+
+        frame.draws.push_back(draw);
+
+        if(indirect)
+        {
+            std::fill(frame.drawIndices.begin() + draw.first, frame.drawIndices.end(), (GLuint)(frame.draws.size() - 1));
+        }
+    }
+
+    // Text is queued anew every frame.
+    if(m_textRenderer != nullptr)
+    {
+        m_textRenderer->EndFrame();
+    }
+
+    frame.viewProjection = viewProjection;
+
+    // Draw the frame on the render thread.
+    commands.Call(&RenderFrame, &frame);
+
+    m_spriteCount = (int)m_keys.size();
+    m_staticSpriteCount = staticSpriteCount;
+    m_culledCount = (int)culledCount;
+    m_occludedCount = (int)occludedCount;
+    m_particleCount = (int)particleCount;
+    m_textCount = (int)textCount;
+    m_batchCount = (int)(frame.draws.size() + frame.staticDraws.size());
+    m_frameIndex += 1;
+}
+
+void SpriteBatch::BakeStatic(CommandBuffer& commands)
+{
+    if(!m_initialized)
+        return;
+
+    // Static sprite with the cell it belongs to.
+    struct BakedSprite
+    {
+        int cellX;
+        int cellY;
+        GLuint texture;
+        int index;
+    };
+
+    std::vector<SpriteInstance> instances;
+    std::vector<BakedSprite> sprites;
+
+    m_componentSystem->ForEachChunk<Game::Transform, Sprite, Game::Static>([&](int count, const Game::EntityHandle* entities, Game::Transform* transforms, Sprite* spriteColumn, Game::Static* statics)
+    {
+        for(int i = 0; i < count; ++i)
+        {
+            BakedSprite sprite;
+            sprite.cellX = (int)std::floor(transforms[i].position.x / m_staticCellSize);
+            sprite.cellY = (int)std::floor(transforms[i].position.y / m_staticCellSize);
+            sprite.texture = spriteColumn[i].texture;
+            sprite.index = (int)instances.size();
+
+            sprites.push_back(sprite);
+            instances.push_back(CreateInstance(transforms[i], spriteColumn[i]));
+        }
+    });
+
+    // Group sprites by cells and by textures within cells.
+    std::sort(sprites.begin(), sprites.end(), [](const BakedSprite& first, const BakedSprite& second)
+    {
+        return std::tie(first.cellX, first.cellY, first.texture, first.index) < std::tie(second.cellX, second.cellY, second.texture, second.index);
+    });
+
+    m_staticCells.clear();
+    m_staticDraws.clear();
+    m_staticCuller.Clear();
+
+    auto bake = new Detail::SpriteBatchBake();
+    bake->state = m_state;
+    bake->instances.reserve(instances.size());
+
+    // Bound every cell by spheres of its sprites.
+    glm::vec3 minimum, maximum;
+
+    for(std::size_t i = 0; i < sprites.size(); ++i)
+    {
+        const BakedSprite& sprite = sprites[i];
+        const SpriteInstance& instance = instances[sprite.index];
+
+        bool newCell = i == 0 || sprite.cellX != sprites[i - 1].cellX || sprite.cellY != sprites[i - 1].cellY;
+
+        if(newCell)
+        {
+            if(i != 0)
+            {
+                m_staticCuller.AddBox(minimum, maximum);
+            }
+
+            StaticCell cell;
+            cell.firstDraw = (int)m_staticDraws.size();
+            cell.drawCount = 0;
+            cell.spriteCount = 0;
+
+            m_staticCells.push_back(cell);
+
+            minimum = glm::vec3(std::numeric_limits<float>::max());
+            maximum = glm::vec3(-std::numeric_limits<float>::max());
+        }
+
+        StaticCell& cell = m_staticCells.back();
+
+        if(newCell || m_staticDraws.back().texture != sprite.texture)
+        {
+            StaticDraw draw;
+            draw.texture = sprite.texture;
+            draw.first = (int)bake->instances.size();
+            draw.count = 0;
+
+            m_staticDraws.push_back(draw);
+            cell.drawCount += 1;
+        }
+
+        m_staticDraws.back().count += 1;
+        cell.spriteCount += 1;
+
+        glm::vec3 center(instance.position, instance.depth);
+        float radius = glm::length(instance.size) * 0.5f;
+
+        minimum = glm::min(minimum, center - radius);
+        maximum = glm::max(maximum, center + radius);
+
+        bake->instances.push_back(instance);
+    }
+
+    if(!sprites.empty())
+    {
+        m_staticCuller.AddBox(minimum, maximum);
+    }
+
+    // Replace the baked buffer on the render thread.
+    commands.Call(&UploadStatic, bake);
+}
+
+int SpriteBatch::GetSpriteCount() const
+{
+    return m_spriteCount;
+}
+
+int SpriteBatch::GetStaticSpriteCount() const
+{
+    return m_staticSpriteCount;
+}
+
+int SpriteBatch::GetStaticCellCount() const
+{
+    return (int)m_staticCells.size();
+}
+
+int SpriteBatch::GetCulledCount() const
+{
+    return m_culledCount;
+}
+
+int SpriteBatch::GetOccludedCount() const
+{
+    return m_occludedCount;
+}
+
+int SpriteBatch::GetParticleCount() const
+{
+    return m_particleCount;
+}
+
+int SpriteBatch::GetTextCount() const
+{
+    return m_textCount;
+}
+
+int SpriteBatch::GetBatchCount() const
+{
+    return m_batchCount;
+}
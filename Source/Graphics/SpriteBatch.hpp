@@ -0,0 +1,293 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Game/Transform.hpp"
+#include "Game/ComponentSystem.hpp"
+#include "Renderer.hpp"
+#include "FrustumCuller.hpp"
+#include "OcclusionCuller.hpp"
+#include "ProgramCache.hpp"
+
+//
+// Sprite Batch
+//
+//  Draws entities with Transform and Sprite components as instanced quads.
+//  Components are gathered once per frame, culled against the view frustum,
+//  and visible ones are written into an instance buffer, sorted by texture
+//  and drawn with a single instanced draw call per texture.
+//
+//  The instance buffer is split into a region per frame in flight. When the
+//  context supports buffer storage, the buffer is persistently mapped and
+//  instances are written straight into it on the recording thread, while
+//  fences keep regions from being overwritten before the GPU reads them.
+//  Otherwise instances are staged in memory and streamed on the render
+//  thread. OpenGL objects are created and destroyed by calls recorded into
+//  the renderer's command buffer, so they live on the render thread.
+//
+//  For very large numbers of sprites, culling can be moved to the GPU. All
+//  sprites are then uploaded once per frame, sorted by texture, and a compute
+//  shader appends visible ones to ranges of their draws, counting them in
+//  indirect draw commands. Nothing is culled or compacted on the CPU and the
+//  counts are never read back. Contexts without OpenGL 4.3 keep culling on
+//  the CPU, and so do frames recorded before the objects have been created.
+//
+//  Sprites culled on the CPU can also be culled against occluders, which are
+//  sprites marked as opaque over their whole quad. Occluders are rasterized
+//  into a hierarchical depth buffer after frustum culling, and sprites that
+//  are farther than the occluders covering them are skipped. Depth follows
+//  the view projection, so a sprite is nearer when its projected depth is
+//  smaller. Occluders should be drawn in front of what they hide, as sprites
+//  are drawn in the order of their textures without depth testing.
+//
+//  Sprites of entities marked with the Static component are not gathered
+//  every frame. Baking groups them into square cells of the world, sorts
+//  them by texture within cells and uploads them once into a buffer that
+//  stays on the GPU. Frames then only cull the bounds of cells and draw
+//  whole ranges of visible ones, before sprites that are gathered. Static
+//  sprites have to be baked again after they are added, removed or changed.
+//
+//  Particles of an optional particle system are written after sprites into
+//  the same instance buffer and drawn with a call per emitter. They are not
+//  culled on the CPU and count towards the capacity.
+//
+//  Text of an optional text renderer is written last, after particles, and
+//  drawn with a single call from its glyph atlas. It also counts towards the
+//  capacity and is drawn without a view projection change, so its positions
+//  are in the same coordinates as sprites.
+//
+//  Example usage:
+//      Graphics::SpriteBatchInfo info;
+//      info.renderer = &renderer;
+//      info.componentSystem = &componentSystem;
+//
+//      Graphics::SpriteBatch spriteBatch;
+//      spriteBatch.Initialize(info);
+//
+//      componentSystem.AddComponent(entity, Game::Transform());
+//      componentSystem.AddComponent(entity, Graphics::Sprite());
+//
+//      spriteBatch.Draw(renderer.GetCommands(), viewProjection);
+//      renderer.Submit();
+//
+//  Baking sprites that never move:
+//      componentSystem.AddComponent(entity, Game::Static());
+//      componentSystem.ProcessCommands();
+//
+//      spriteBatch.BakeStatic(renderer.GetCommands());
+//
+
+namespace Graphics
+{
+    // Sprite component.
+    struct Sprite
+    {
+        Sprite() :
+            size(1.0f, 1.0f),
+            color(1.0f, 1.0f, 1.0f, 1.0f),
+            textureRect(0.0f, 0.0f, 1.0f, 1.0f),
+            texture(0),
+            occluder(false)
+        {
+        }
+
+        // Size in world units.
+        glm::vec2 size;
+
+        // Color multiplied with the texture.
+        glm::vec4 color;
+
+        // Texture coordinates of the bottom left and top right corners.
+        glm::vec4 textureRect;
+
+        // Texture name, or zero for a plain color.
+        GLuint texture;
+
+        // Hides sprites behind it when occlusion culling is enabled.
+        // Must only be set for sprites that are opaque over their whole quad.
+        bool occluder;
+    };
+
+    // Sprite instance written to the instance buffer.
+    struct SpriteInstance
+    {
+        glm::vec2 position;
+        glm::vec2 size;
+        float rotation;
+        float depth;
+        glm::vec4 color;
+        glm::vec4 textureRect;
+    };
+
+    // Forward declarations.
+    class ParticleSystem;
+    class TextRenderer;
+
+    // Implementation details.
+    namespace Detail
+    {
+        struct SpriteBatchState;
+    }
+
+    // Sprite batch initialization struct.
+    struct SpriteBatchInfo
+    {
+        // Renderer that executes draws.
+        Renderer* renderer;
+
+        // Component system with sprites.
+        Game::ComponentSystem* componentSystem;
+
+        // Optional job system that culling is split between.
+        JobSystem* jobSystem;
+
+        // Optional cache of program binaries.
+        ProgramCache* programCache;
+
+        // Maximum number of sprites drawn in a frame.
+        int capacity;
+
+        // Culls sprites on the GPU and draws them indirectly if the context supports it.
+        bool gpuCulling;
+
+        // Culls sprites hidden behind occluders on the CPU.
+        bool occlusionCulling;
+
+        // Culls against occluders of the previous frame, which never waits for rasterization.
+        bool temporalOcclusion;
+
+        // Size of square cells that static sprites are grouped by in world units.
+        float staticCellSize;
+
+        // Optional particle system whose particles are drawn after sprites.
+        ParticleSystem* particleSystem;
+
+        // Optional text renderer whose glyphs are drawn after particles.
+        TextRenderer* textRenderer;
+
+        SpriteBatchInfo();
+    };
+
+    // Sprite batch class.
+    class SpriteBatch : private NonCopyable
+    {
+    public:
+        // Number of frames that can be in flight.
+        static const int FrameCount = 3;
+
+    public:
+        SpriteBatch();
+        ~SpriteBatch();
+
+        // Restores instance to its original state.
+        // Must be called before the renderer is cleaned up.
+        void Cleanup();
+
+        // Initializes the sprite batch instance.
+        bool Initialize(const SpriteBatchInfo& info);
+
+        // Gathers sprites and records their draws.
+        // Has to be called at most once per submitted frame.
+        void Draw(CommandBuffer& commands, const glm::mat4& viewProjection);
+
+        // Bakes sprites of static entities into cells and records their upload.
+        // Commands of the component system must be processed before baking.
+        void BakeStatic(CommandBuffer& commands);
+
+        // Gets the number of sprites drawn in the last frame.
+        // Includes sprites culled on the GPU, which are not counted.
+        int GetSpriteCount() const;
+
+        // Gets the number of static sprites in visible cells drawn in the last frame.
+        int GetStaticSpriteCount() const;
+
+        // Gets the number of cells that static sprites are baked into.
+        int GetStaticCellCount() const;
+
+        // Gets the number of sprites culled on the CPU in the last frame.
+        // Includes sprites hidden behind occluders.
+        int GetCulledCount() const;
+
+        // Gets the number of sprites hidden behind occluders in the last frame.
+        int GetOccludedCount() const;
+
+        // Gets the number of particles drawn in the last frame.
+        int GetParticleCount() const;
+
+        // Gets the number of glyphs drawn in the last frame.
+        int GetTextCount() const;
+
+        // Gets the number of draw calls in the last frame.
+        int GetBatchCount() const;
+
+    private:
+        // Sprite sort key with a texture in the high bits and an instance index in the low bits.
+        typedef std::uint64_t SortKey;
+
+        // Cell of baked static sprites with a range of their draws.
+        struct StaticCell
+        {
+            int firstDraw;
+            int drawCount;
+            int spriteCount;
+        };
+
+        // Draw of baked static sprites with the same texture.
+        struct StaticDraw
+        {
+            GLuint texture;
+            int first;
+            int count;
+        };
+
+    private:
+        // Component system with sprites.
+        Game::ComponentSystem* m_componentSystem;
+
+        // Renderer that executes draws.
+        Renderer* m_renderer;
+
+        // Job system that culling is split between.
+        JobSystem* m_jobSystem;
+
+        // Particle system drawn after sprites.
+        ParticleSystem* m_particleSystem;
+
+        // Text renderer drawn after particles.
+        TextRenderer* m_textRenderer;
+
+        // State shared with the render thread.
+        Detail::SpriteBatchState* m_state;
+
+        // Gathered sprites and their sort keys.
+        std::vector<SpriteInstance> m_instances;
+        std::vector<SortKey> m_keys;
+
+        // Bounds of gathered sprites.
+        FrustumCuller m_culler;
+
+        // Cells of baked static sprites with their draws and bounds.
+        std::vector<StaticCell> m_staticCells;
+        std::vector<StaticDraw> m_staticDraws;
+        FrustumCuller m_staticCuller;
+        float m_staticCellSize;
+
+        // Occluders and flat bounds of gathered sprites.
+        OcclusionCuller m_occlusionCuller;
+        bool m_occlusionCulling;
+
+        // Index of the next frame.
+        std::uint64_t m_frameIndex;
+
+        // Statistics of the last frame.
+        int m_spriteCount;
+        int m_staticSpriteCount;
+        int m_culledCount;
+        int m_occludedCount;
+        int m_particleCount;
+        int m_textCount;
+        int m_batchCount;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,207 @@
+#include "Precompiled.hpp"
+#include "StateCache.hpp"
+using namespace Graphics;
+
+StateCache::StateCache()
+{
+}
+
+void StateCache::Invalidate()
+{
+    m_program.known = false;
+    m_vertexArray.known = false;
+    m_activeTexture.known = false;
+
+    for(auto& texture : m_textures)
+    {
+        texture.known = false;
+    }
+
+    for(auto& uniformBuffer : m_uniformBuffers)
+    {
+        uniformBuffer.known = false;
+    }
+
+    for(auto& capability : m_capabilities)
+    {
+        capability.known = false;
+    }
+
+    m_blendFunction.known = false;
+    m_depthFunction.known = false;
+    m_depthMask.known = false;
+    m_viewport.known = false;
+}
+
+template<typename Type>
+bool StateCache::Update(Cached<Type>& cached, const Type& value)
+{
+    if(cached.known && cached.value == value)
+    {
+        m_statistics.avoidedCalls += 1;
+        return false;
+    }
+
+    cached.value = value;
+    cached.known = true;
+
+    m_statistics.issuedCalls += 1;
+    return true;
+}
+
+void StateCache::UseProgram(GLuint program)
+{
+    if(this->Update(m_program, program))
+    {
+        glUseProgram(program);
+    }
+}
+
+void StateCache::BindVertexArray(GLuint vertexArray)
+{
+    if(this->Update(m_vertexArray, vertexArray))
+    {
+        glBindVertexArray(vertexArray);
+    }
+}
+
+void StateCache::BindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    // Bind textures of units that are not cached directly.
+    if(unit >= (GLuint)TextureUnitCount)
+    {
+        m_activeTexture.known = false;
+        m_statistics.issuedCalls += 2;
+
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+        return;
+    }
+
+    if(!this->Update(m_textures[unit], std::make_pair(target, texture)))
+        return;
+
+    if(this->Update(m_activeTexture, unit))
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    glBindTexture(target, texture);
+}
+
+void StateCache::BindUniformBuffer(GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    // Bind ranges of bindings that are not cached directly.
+    if(index >= (GLuint)UniformBindingCount)
+    {
+        m_statistics.issuedCalls += 1;
+
+        glBindBufferRange(GL_UNIFORM_BUFFER, index, buffer, offset, size);
+        return;
+    }
+
+    if(!this->Update(m_uniformBuffers[index], std::make_tuple(buffer, offset, size)))
+        return;
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, index, buffer, offset, size);
+}
+
+void StateCache::Enable(GLenum capability)
+{
+    this->SetCapability(capability, true);
+}
+
+void StateCache::Disable(GLenum capability)
+{
+    this->SetCapability(capability, false);
+}
+
+void StateCache::SetCapability(GLenum capability, bool enabled)
+{
+    int index = -1;
+
+    switch(capability)
+    {
+    case GL_BLEND:
+        index = Capabilities::Blend;
+        break;
+
+    case GL_DEPTH_TEST:
+        index = Capabilities::DepthTest;
+        break;
+
+    case GL_CULL_FACE:
+        index = Capabilities::CullFace;
+        break;
+
+    case GL_SCISSOR_TEST:
+        index = Capabilities::ScissorTest;
+        break;
+
+    case GL_STENCIL_TEST:
+        index = Capabilities::StencilTest;
+        break;
+    }
+
+    if(index >= 0)
+    {
+        if(!this->Update(m_capabilities[index], enabled))
+            return;
+    }
+    else
+    {
+        // Set capabilities that are not cached directly.
+        m_statistics.issuedCalls += 1;
+    }
+
+    if(enabled)
+    {
+        glEnable(capability);
+    }
+    else
+    {
+        glDisable(capability);
+    }
+}
+
+void StateCache::SetBlendFunction(GLenum source, GLenum destination)
+{
+    if(this->Update(m_blendFunction, std::make_pair(source, destination)))
+    {
+        glBlendFunc(source, destination);
+    }
+}
+
+void StateCache::SetDepthFunction(GLenum function)
+{
+    if(this->Update(m_depthFunction, function))
+    {
+        glDepthFunc(function);
+    }
+}
+
+void StateCache::SetDepthMask(bool enabled)
+{
+    if(this->Update(m_depthMask, enabled))
+    {
+        glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+    }
+}
+
+void StateCache::SetViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    if(this->Update(m_viewport, glm::ivec4(x, y, width, height)))
+    {
+        glViewport(x, y, width, height);
+    }
+}
+
+const StateCache::Statistics& StateCache::GetStatistics() const
+{
+    return m_statistics;
+}
+
+void StateCache::ResetStatistics()
+{
+    m_statistics = Statistics();
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// State Cache
+//
+//  Shadows OpenGL state of a context and skips calls that would set state
+//  to the value it already has. Covers the bound program, vertex array and
+//  textures, the active texture unit, ranges of uniform buffer bindings,
+//  commonly toggled capabilities, blend and depth state, and the viewport. Counts issued and avoided calls, so
+//  the savings can be measured per frame.
+//
+//  Code that changes covered state without the cache has to call
+//  Invalidate() afterwards, which makes the next call of each kind go to
+//  the driver. Deleting bound objects counts as such a change.
+//
+//  Example usage:
+//      Graphics::StateCache state;
+//      state.UseProgram(program);
+//      state.BindVertexArray(vertexArray);
+//      state.BindTexture(0, GL_TEXTURE_2D, texture);
+//      state.Enable(GL_BLEND);
+//
+//      glDrawArrays(GL_TRIANGLES, 0, 3);
+//
+//      Graphics::StateCache::Statistics statistics = state.GetStatistics();
+//      state.ResetStatistics();
+//
+
+namespace Graphics
+{
+    // State cache class.
+    class StateCache : private NonCopyable
+    {
+    public:
+        // Maximum number of cached texture units.
+        static const int TextureUnitCount = 16;
+
+        // Maximum number of cached uniform buffer bindings.
+        static const int UniformBindingCount = 16;
+
+        // Counts of state calls.
+        struct Statistics
+        {
+            Statistics() :
+                issuedCalls(0),
+                avoidedCalls(0)
+            {
+            }
+
+            std::uint32_t issuedCalls;
+            std::uint32_t avoidedCalls;
+        };
+
+    public:
+        StateCache();
+
+        // Forgets all cached state.
+        void Invalidate();
+
+        // Sets the current program.
+        void UseProgram(GLuint program);
+
+        // Binds a vertex array.
+        void BindVertexArray(GLuint vertexArray);
+
+        // Binds a texture to a texture unit.
+        void BindTexture(GLuint unit, GLenum target, GLuint texture);
+
+        // Binds a range of a buffer to a uniform buffer binding.
+        void BindUniformBuffer(GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+        // Enables or disables a capability.
+        void Enable(GLenum capability);
+        void Disable(GLenum capability);
+
+        // Sets the blend function.
+        void SetBlendFunction(GLenum source, GLenum destination);
+
+        // Sets the depth function.
+        void SetDepthFunction(GLenum function);
+
+        // Enables or disables writing to the depth buffer.
+        void SetDepthMask(bool enabled);
+
+        // Sets the viewport.
+        void SetViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+        // Gets counts of state calls since the last reset.
+        const Statistics& GetStatistics() const;
+
+        // Resets counts of state calls.
+        void ResetStatistics();
+
+    private:
+        // Capabilities with cached state.
+        struct Capabilities
+        {
+            enum Type
+            {
+                Blend,
+                DepthTest,
+                CullFace,
+                ScissorTest,
+                StencilTest,
+
+                Count,
+            };
+        };
+
+        // Cached value that can be unknown.
+        template<typename Type>
+        struct Cached
+        {
+            Cached() :
+                value(),
+                known(false)
+            {
+            }
+
+            Type value;
+            bool known;
+        };
+
+        // Updates a cached value and tells whether it has changed.
+        template<typename Type>
+        bool Update(Cached<Type>& cached, const Type& value);
+
+        // Sets a capability.
+        void SetCapability(GLenum capability, bool enabled);
+
+    private:
+        // Cached bindings.
+        Cached<GLuint> m_program;
+        Cached<GLuint> m_vertexArray;
+        Cached<GLuint> m_activeTexture;
+        Cached<std::pair<GLenum, GLuint>> m_textures[TextureUnitCount];
+        Cached<std::tuple<GLuint, GLintptr, GLsizeiptr>> m_uniformBuffers[UniformBindingCount];
+
+        // Cached capabilities.
+        Cached<bool> m_capabilities[Capabilities::Count];
+
+        // Cached blend and depth state.
+        Cached<std::pair<GLenum, GLenum>> m_blendFunction;
+        Cached<GLenum> m_depthFunction;
+        Cached<bool> m_depthMask;
+
+        // Cached viewport.
+        Cached<glm::ivec4> m_viewport;
+
+        // Counts of state calls.
+        Statistics m_statistics;
+    };
+}
@@ -0,0 +1,229 @@
+#include "Precompiled.hpp"
+#include "StreamBuffer.hpp"
+using namespace Graphics;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize a stream buffer! "
+
+    // Time to wait for the GPU to finish reading a region.
+    const GLuint64 FenceTimeout = 1000000000;
+}
+
+StreamBufferInfo::StreamBufferInfo() :
+    target(GL_ARRAY_BUFFER),
+    regionSize(0),
+    regionCount(3),
+    persistent(true)
+{
+}
+
+StreamBuffer::StreamBuffer() :
+    m_handle(0),
+    m_target(GL_ARRAY_BUFFER),
+    m_regionSize(0),
+    m_region(0),
+    m_regionOffset(0),
+    m_persistentData(nullptr),
+    m_mapped(false),
+    m_initialized(false)
+{
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    this->Cleanup();
+}
+
+void StreamBuffer::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    Assert(!m_mapped, "Cleaning up a stream buffer with a mapped range!");
+
+    // Delete fences.
+    for(GLsync fence : m_fences)
+    {
+        if(fence != nullptr)
+        {
+            glDeleteSync(fence);
+        }
+    }
+
+    Utility::ClearContainer(m_fences);
+
+    // Delete the buffer, which also unmaps it.
+    glDeleteBuffers(1, &m_handle);
+    m_handle = 0;
+
+    m_target = GL_ARRAY_BUFFER;
+    m_regionSize = 0;
+    m_region = 0;
+    m_regionOffset = 0;
+    m_persistentData = nullptr;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool StreamBuffer::Initialize(const StreamBufferInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            m_initialized = true;
+            this->Cleanup();
+        }
+    );
+
+    // Validate arguments.
+    if(info.regionSize == 0)
+    {
+        LogError() << LogInitializeError() << "Invalid region size.";
+        return false;
+    }
+
+    if(info.regionCount <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid region count.";
+        return false;
+    }
+
+    m_target = info.target;
+    m_regionSize = info.regionSize;
+    m_fences.resize(info.regionCount, nullptr);
+
+    // Create the buffer.
+    GLsizeiptr bufferSize = (GLsizeiptr)(info.regionSize * info.regionCount);
+
+    glGenBuffers(1, &m_handle);
+    glBindBuffer(m_target, m_handle);
+
+    if(info.persistent && GLEW_ARB_buffer_storage)
+    {
+        const GLbitfield MapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        glBufferStorage(m_target, bufferSize, nullptr, MapFlags);
+        m_persistentData = static_cast<std::uint8_t*>(glMapBufferRange(m_target, 0, bufferSize, MapFlags));
+
+        if(m_persistentData == nullptr)
+        {
+            LogError() << LogInitializeError() << "Couldn't map the buffer.";
+            glBindBuffer(m_target, 0);
+            return false;
+        }
+    }
+    else
+    {
+        glBufferData(m_target, bufferSize, nullptr, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(m_target, 0);
+
+    if(glGetError() != GL_NO_ERROR)
+    {
+        LogError() << LogInitializeError() << "Couldn't create the buffer.";
+        return false;
+    }
+
+    // Success!
+    return m_initialized = true;
+}
+
+void* StreamBuffer::Map(std::size_t size, std::size_t alignment, std::size_t& offset)
+{
+    if(!m_initialized)
+        return nullptr;
+
+    Assert(!m_mapped, "Mapping a stream buffer range while another one is mapped!");
+    Assert(alignment != 0);
+
+    // Allocate the range from the current region.
+    std::size_t rangeOffset = (m_regionOffset + alignment - 1) / alignment * alignment;
+
+    if(rangeOffset + size > m_regionSize)
+        return nullptr;
+
+    m_regionOffset = rangeOffset + size;
+    offset = m_regionSize * m_region + rangeOffset;
+
+    // Return persistently mapped memory.
+    if(m_persistentData != nullptr)
+        return m_persistentData + offset;
+
+    // Map the range without waiting for the driver.
+    // Fences guarantee that the GPU no longer reads it.
+    const GLbitfield MapFlags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+
+    glBindBuffer(m_target, m_handle);
+    void* data = glMapBufferRange(m_target, offset, size, MapFlags);
+
+    m_mapped = data != nullptr;
+    return data;
+}
+
+void StreamBuffer::Unmap()
+{
+    if(!m_mapped)
+        return;
+
+    glBindBuffer(m_target, m_handle);
+    glUnmapBuffer(m_target);
+
+    m_mapped = false;
+}
+
+void StreamBuffer::EndFrame()
+{
+    if(!m_initialized)
+        return;
+
+    Assert(!m_mapped, "Ending a frame of a stream buffer with a mapped range!");
+
+    // Fence draws that read the current region.
+    if(m_fences[m_region] != nullptr)
+    {
+        glDeleteSync(m_fences[m_region]);
+    }
+
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    // Move to the next region and wait until it is no longer read.
+    m_region = (m_region + 1) % (int)m_fences.size();
+    m_regionOffset = 0;
+
+    GLsync& fence = m_fences[m_region];
+
+    if(fence != nullptr)
+    {
+        if(glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FenceTimeout) == GL_TIMEOUT_EXPIRED)
+        {
+            LogWarning() << "Timed out waiting for the GPU to read a stream buffer region.";
+        }
+
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+GLuint StreamBuffer::GetHandle() const
+{
+    return m_handle;
+}
+
+bool StreamBuffer::IsPersistent() const
+{
+    return m_persistentData != nullptr;
+}
+
+std::size_t StreamBuffer::GetUsedSize() const
+{
+    return m_regionOffset;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Stream Buffer
+//
+//  Streams per frame data, such as dynamic vertices and uniform blocks, to
+//  the GPU without implicit synchronization. The buffer is split into one
+//  region per frame in flight and data of a frame is suballocated linearly
+//  from its region. Ending a frame places a fence after its draws, and a
+//  region is only reused once the fence of the frame that last used it has
+//  been signaled, so writes never wait for the driver to finish reading.
+//
+//  When the context supports buffer storage, the whole buffer is mapped
+//  persistently once. Otherwise every allocation is mapped separately with
+//  unsynchronized and invalidated ranges, which the fences make safe.
+//
+//  All methods have to be called on a thread with a current context.
+//
+//  Example usage:
+//      Graphics::StreamBufferInfo info;
+//      info.target = GL_ARRAY_BUFFER;
+//      info.regionSize = 4 * 1024 * 1024;
+//
+//      Graphics::StreamBuffer buffer;
+//      buffer.Initialize(info);
+//
+//      std::size_t offset = 0;
+//      void* data = buffer.Map(sizeof(Vertex) * count, sizeof(Vertex), offset);
+//      std::memcpy(data, vertices, sizeof(Vertex) * count);
+//      buffer.Unmap();
+//
+//      glBindBuffer(GL_ARRAY_BUFFER, buffer.GetHandle());
+//      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offset);
+//      /* Draw... */
+//
+//      buffer.EndFrame();
+//
+
+namespace Graphics
+{
+    // Stream buffer initialization struct.
+    struct StreamBufferInfo
+    {
+        // Target the buffer is bound to while mapping.
+        GLenum target;
+
+        // Size of data that can be streamed in a frame.
+        std::size_t regionSize;
+
+        // Number of frames in flight.
+        int regionCount;
+
+        // Allows persistent mapping if the context supports it.
+        bool persistent;
+
+        StreamBufferInfo();
+    };
+
+    // Stream buffer class.
+    class StreamBuffer : private NonCopyable
+    {
+    public:
+        StreamBuffer();
+        ~StreamBuffer();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the stream buffer instance.
+        bool Initialize(const StreamBufferInfo& info);
+
+        // Allocates and maps a range of the current region.
+        // Returns nullptr if the region has no space left.
+        void* Map(std::size_t size, std::size_t alignment, std::size_t& offset);
+
+        // Unmaps the last mapped range.
+        void Unmap();
+
+        // Fences the current region and moves to the next one.
+        // Waits if the GPU still reads the next region.
+        void EndFrame();
+
+        // Gets the buffer handle.
+        GLuint GetHandle() const;
+
+        // Checks if the buffer is persistently mapped.
+        bool IsPersistent() const;
+
+        // Gets the number of bytes allocated in the current region.
+        std::size_t GetUsedSize() const;
+
+    private:
+        // Buffer object.
+        GLuint m_handle;
+        GLenum m_target;
+
+        // Regions of frames in flight.
+        std::size_t m_regionSize;
+        std::vector<GLsync> m_fences;
+        int m_region;
+
+        // Offset of the next allocation in the current region.
+        std::size_t m_regionOffset;
+
+        // Persistently mapped memory.
+        std::uint8_t* m_persistentData;
+
+        // Mapping state.
+        bool m_mapped;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
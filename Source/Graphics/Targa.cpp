@@ -0,0 +1,197 @@
+#include "Precompiled.hpp"
+#include "Targa.hpp"
+using namespace Graphics;
+
+namespace
+{
+    // Log message strings.
+    #define LogDecodeError(filename) "Failed to decode \"" << filename << "\" image! "
+    #define LogSaveError(filename) "Failed to save an image to \"" << filename << "\" file! "
+
+    // Size of the file header.
+    const std::size_t HeaderSize = 18;
+
+    // Size of a decoded pixel.
+    const std::size_t PixelSize = 4;
+}
+
+bool Targa::Decode(const std::string& filename, const std::vector<std::uint8_t>& content, std::vector<std::uint8_t>& pixels, int& width, int& height)
+{
+    if(content.size() < HeaderSize)
+    {
+        LogError() << LogDecodeError(filename) << "Invalid TGA header.";
+        return false;
+    }
+
+    int idLength = content[0];
+    int colorMapType = content[1];
+    int imageType = content[2];
+    int bitsPerPixel = content[16];
+    int descriptor = content[17];
+
+    width = content[12] | content[13] << 8;
+    height = content[14] | content[15] << 8;
+
+    bool compressed = imageType == 10;
+
+    if(colorMapType != 0 || (imageType != 2 && imageType != 10))
+    {
+        LogError() << LogDecodeError(filename) << "Unsupported TGA image type.";
+        return false;
+    }
+
+    if(bitsPerPixel != 24 && bitsPerPixel != 32)
+    {
+        LogError() << LogDecodeError(filename) << "Unsupported TGA pixel format.";
+        return false;
+    }
+
+    if(width == 0 || height == 0)
+    {
+        LogError() << LogDecodeError(filename) << "Invalid TGA image size.";
+        return false;
+    }
+
+    // Convert BGR or BGRA pixels to RGBA.
+    const std::size_t sourceSize = bitsPerPixel / 8;
+    const std::size_t pixelCount = (std::size_t)width * height;
+
+    pixels.resize(pixelCount * PixelSize);
+
+    std::size_t source = HeaderSize + idLength;
+    std::size_t pixel = 0;
+
+    auto CopyPixel = [&](std::size_t from)
+    {
+        std::uint8_t* destination = &pixels[pixel * PixelSize];
+        destination[0] = content[from + 2];
+        destination[1] = content[from + 1];
+        destination[2] = content[from + 0];
+        destination[3] = sourceSize == 4 ? content[from + 3] : 255;
+        pixel += 1;
+    };
+
+    while(pixel < pixelCount)
+    {
+        // Uncompressed images are a single raw packet.
+        std::size_t count = pixelCount;
+        bool repeated = false;
+
+        if(compressed)
+        {
+            if(source >= content.size())
+                break;
+
+            count = (content[source] & 0x7F) + 1;
+            repeated = (content[source] & 0x80) != 0;
+            source += 1;
+        }
+
+        count = std::min(count, pixelCount - pixel);
+
+        if(source + (repeated ? 1 : count) * sourceSize > content.size())
+            break;
+
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            CopyPixel(repeated ? source : source + i * sourceSize);
+        }
+
+        source += (repeated ? 1 : count) * sourceSize;
+    }
+
+    if(pixel != pixelCount)
+    {
+        LogError() << LogDecodeError(filename) << "Truncated TGA pixel data.";
+        return false;
+    }
+
+    // Flip images stored from the top.
+    if(descriptor & 0x20)
+    {
+        std::size_t rowSize = (std::size_t)width * PixelSize;
+
+        for(int row = 0; row < height / 2; ++row)
+        {
+            std::swap_ranges(pixels.begin() + row * rowSize, pixels.begin() + (row + 1) * rowSize, pixels.begin() + (height - row - 1) * rowSize);
+        }
+    }
+
+    return true;
+}
+
+bool Targa::Load(const std::string& filename, std::vector<std::uint8_t>& pixels, int& width, int& height)
+{
+    std::ifstream file(filename, std::ios::binary);
+
+    if(!file)
+    {
+        LogError() << LogDecodeError(filename) << "Couldn't open the file.";
+        return false;
+    }
+
+    std::vector<std::uint8_t> content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if(file.bad())
+    {
+        LogError() << LogDecodeError(filename) << "Couldn't read the file.";
+        return false;
+    }
+
+    return Targa::Decode(filename, content, pixels, width, height);
+}
+
+bool Targa::Save(const std::string& filename, int width, int height, const std::vector<std::uint8_t>& pixels)
+{
+    if(width <= 0 || height <= 0 || width > 0xFFFF || height > 0xFFFF || pixels.size() < (std::size_t)width * height * PixelSize)
+    {
+        LogError() << LogSaveError(filename) << "Invalid image size.";
+        return false;
+    }
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+
+    if(!file.is_open())
+    {
+        LogError() << LogSaveError(filename) << "Couldn't open the file.";
+        return false;
+    }
+
+    // Write an uncompressed true color header, with rows from the bottom like OpenGL.
+    std::uint8_t header[HeaderSize] = { 0 };
+    header[2] = 2;
+    header[12] = (std::uint8_t)(width & 0xFF);
+    header[13] = (std::uint8_t)(width >> 8);
+    header[14] = (std::uint8_t)(height & 0xFF);
+    header[15] = (std::uint8_t)(height >> 8);
+    header[16] = 32;
+    header[17] = 8;
+
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    // Swap red and blue channels, as pixels are stored in BGRA order.
+    std::vector<std::uint8_t> row((std::size_t)width * PixelSize);
+
+    for(int y = 0; y < height; ++y)
+    {
+        const std::uint8_t* source = pixels.data() + (std::size_t)y * width * PixelSize;
+
+        for(int x = 0; x < width; ++x)
+        {
+            row[x * PixelSize + 0] = source[x * PixelSize + 2];
+            row[x * PixelSize + 1] = source[x * PixelSize + 1];
+            row[x * PixelSize + 2] = source[x * PixelSize + 0];
+            row[x * PixelSize + 3] = source[x * PixelSize + 3];
+        }
+
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+
+    if(!file.good())
+    {
+        LogError() << LogSaveError(filename) << "Couldn't write to the file.";
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Targa
+//
+//  Decodes and encodes TGA images. Decoded pixels are tightly packed RGBA
+//  bytes with rows starting at the bottom, like OpenGL expects them.
+//  Uncompressed and run length encoded images with 24 or 32 bits per pixel
+//  can be decoded, while images are saved uncompressed with 32 bits per pixel.
+//
+//  Example usage:
+//      std::vector<std::uint8_t> pixels;
+//      int width = 0;
+//      int height = 0;
+//
+//      if(Graphics::Targa::Load("Data/Player.tga", pixels, width, height))
+//      {
+//          Graphics::Targa::Save("Player.tga", width, height, pixels);
+//      }
+//
+
+namespace Graphics
+{
+    namespace Targa
+    {
+        // Decodes an image from the content of a file.
+        // The filename is only used for error messages.
+        bool Decode(const std::string& filename, const std::vector<std::uint8_t>& content, std::vector<std::uint8_t>& pixels, int& width, int& height);
+
+        // Reads and decodes an image file.
+        bool Load(const std::string& filename, std::vector<std::uint8_t>& pixels, int& width, int& height);
+
+        // Saves pixels as an uncompressed image file.
+        bool Save(const std::string& filename, int width, int height, const std::vector<std::uint8_t>& pixels);
+    }
+}
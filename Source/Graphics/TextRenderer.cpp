@@ -0,0 +1,811 @@
+#include "Precompiled.hpp"
+#include "TextRenderer.hpp"
+using namespace Graphics;
+
+namespace Graphics
+{
+    namespace Detail
+    {
+        // Region of the atlas written by a rasterized glyph.
+        struct GlyphUpload
+        {
+            int x;
+            int y;
+            int width;
+            int height;
+            std::size_t offset;
+        };
+
+        // Glyph uploads of a frame recorded for the render thread.
+        struct TextRendererFrame
+        {
+            TextRendererFrame() :
+                state(nullptr)
+            {
+            }
+
+            TextRendererState* state;
+
+            std::vector<GlyphUpload> uploads;
+            std::vector<std::uint8_t> pixels;
+        };
+
+        // State shared with the render thread.
+        struct TextRendererState
+        {
+            TextRendererState() :
+                atlasSize(0),
+                texture(0)
+            {
+            }
+
+            int atlasSize;
+            std::atomic<GLuint> texture;
+
+            TextRendererFrame frames[TextRenderer::FrameCount];
+        };
+    }
+}
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize a text renderer! "
+
+    // Constant variables.
+    const int InvalidIndex = -1;
+
+    // Font cell in font units, with a column and two rows of spacing around 5 by 8 glyphs.
+    const int GlyphColumns = 5;
+    const int GlyphRows = 8;
+    const int CellColumns = 6;
+    const int CellRows = 10;
+
+    // Transparent pixels around glyphs, which keep filtering from bleeding neighbours in.
+    const int GlyphPadding = 1;
+
+    // Subsamples per pixel along each axis when rasterizing.
+    const int Supersampling = 4;
+
+    // Characters of the built-in font and the one drawn in place of others.
+    const unsigned int FirstCharacter = 32;
+    const unsigned int LastCharacter = 126;
+    const unsigned int FallbackCharacter = '?';
+
+    // Columns of printable ASCII glyphs from left to right, with the top row in the lowest bit.
+    const std::uint8_t FontColumns[LastCharacter - FirstCharacter + 1][GlyphColumns] =
+    {
+        { 0x00, 0x00, 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0x5F, 0x00, 0x00 }, { 0x00, 0x07, 0x00, 0x07, 0x00 }, { 0x14, 0x7F, 0x14, 0x7F, 0x14 },
+        { 0x24, 0x2A, 0x7F, 0x2A, 0x12 }, { 0x23, 0x13, 0x08, 0x64, 0x62 }, { 0x36, 0x49, 0x56, 0x20, 0x50 }, { 0x00, 0x08, 0x07, 0x03, 0x00 },
+        { 0x00, 0x1C, 0x22, 0x41, 0x00 }, { 0x00, 0x41, 0x22, 0x1C, 0x00 }, { 0x2A, 0x1C, 0x7F, 0x1C, 0x2A }, { 0x08, 0x08, 0x3E, 0x08, 0x08 },
+        { 0x00, 0x80, 0x70, 0x30, 0x00 }, { 0x08, 0x08, 0x08, 0x08, 0x08 }, { 0x00, 0x00, 0x60, 0x60, 0x00 }, { 0x20, 0x10, 0x08, 0x04, 0x02 },
+        { 0x3E, 0x51, 0x49, 0x45, 0x3E }, { 0x00, 0x42, 0x7F, 0x40, 0x00 }, { 0x72, 0x49, 0x49, 0x49, 0x46 }, { 0x21, 0x41, 0x49, 0x4D, 0x33 },
+        { 0x18, 0x14, 0x12, 0x7F, 0x10 }, { 0x27, 0x45, 0x45, 0x45, 0x39 }, { 0x3C, 0x4A, 0x49, 0x49, 0x31 }, { 0x41, 0x21, 0x11, 0x09, 0x07 },
+        { 0x36, 0x49, 0x49, 0x49, 0x36 }, { 0x46, 0x49, 0x49, 0x29, 0x1E }, { 0x00, 0x00, 0x14, 0x00, 0x00 }, { 0x00, 0x40, 0x34, 0x00, 0x00 },
+        { 0x00, 0x08, 0x14, 0x22, 0x41 }, { 0x14, 0x14, 0x14, 0x14, 0x14 }, { 0x00, 0x41, 0x22, 0x14, 0x08 }, { 0x02, 0x01, 0x59, 0x09, 0x06 },
+        { 0x3E, 0x41, 0x5D, 0x59, 0x4E }, { 0x7C, 0x12, 0x11, 0x12, 0x7C }, { 0x7F, 0x49, 0x49, 0x49, 0x36 }, { 0x3E, 0x41, 0x41, 0x41, 0x22 },
+        { 0x7F, 0x41, 0x41, 0x41, 0x3E }, { 0x7F, 0x49, 0x49, 0x49, 0x41 }, { 0x7F, 0x09, 0x09, 0x09, 0x01 }, { 0x3E, 0x41, 0x41, 0x51, 0x73 },
+        { 0x7F, 0x08, 0x08, 0x08, 0x7F }, { 0x00, 0x41, 0x7F, 0x41, 0x00 }, { 0x20, 0x40, 0x41, 0x3F, 0x01 }, { 0x7F, 0x08, 0x14, 0x22, 0x41 },
+        { 0x7F, 0x40, 0x40, 0x40, 0x40 }, { 0x7F, 0x02, 0x1C, 0x02, 0x7F }, { 0x7F, 0x04, 0x08, 0x10, 0x7F }, { 0x3E, 0x41, 0x41, 0x41, 0x3E },
+        { 0x7F, 0x09, 0x09, 0x09, 0x06 }, { 0x3E, 0x41, 0x51, 0x21, 0x5E }, { 0x7F, 0x09, 0x19, 0x29, 0x46 }, { 0x26, 0x49, 0x49, 0x49, 0x32 },
+        { 0x03, 0x01, 0x7F, 0x01, 0x03 }, { 0x3F, 0x40, 0x40, 0x40, 0x3F }, { 0x1F, 0x20, 0x40, 0x20, 0x1F }, { 0x3F, 0x40, 0x38, 0x40, 0x3F },
+        { 0x63, 0x14, 0x08, 0x14, 0x63 }, { 0x03, 0x04, 0x78, 0x04, 0x03 }, { 0x61, 0x59, 0x49, 0x4D, 0x43 }, { 0x00, 0x7F, 0x41, 0x41, 0x41 },
+        { 0x02, 0x04, 0x08, 0x10, 0x20 }, { 0x00, 0x41, 0x41, 0x41, 0x7F }, { 0x04, 0x02, 0x01, 0x02, 0x04 }, { 0x40, 0x40, 0x40, 0x40, 0x40 },
+        { 0x00, 0x03, 0x07, 0x08, 0x00 }, { 0x20, 0x54, 0x54, 0x78, 0x40 }, { 0x7F, 0x28, 0x44, 0x44, 0x38 }, { 0x38, 0x44, 0x44, 0x44, 0x28 },
+        { 0x38, 0x44, 0x44, 0x28, 0x7F }, { 0x38, 0x54, 0x54, 0x54, 0x18 }, { 0x00, 0x08, 0x7E, 0x09, 0x02 }, { 0x18, 0xA4, 0xA4, 0x9C, 0x78 },
+        { 0x7F, 0x08, 0x04, 0x04, 0x78 }, { 0x00, 0x44, 0x7D, 0x40, 0x00 }, { 0x20, 0x40, 0x40, 0x3D, 0x00 }, { 0x7F, 0x10, 0x28, 0x44, 0x00 },
+        { 0x00, 0x41, 0x7F, 0x40, 0x00 }, { 0x7C, 0x04, 0x78, 0x04, 0x78 }, { 0x7C, 0x08, 0x04, 0x04, 0x78 }, { 0x38, 0x44, 0x44, 0x44, 0x38 },
+        { 0xFC, 0x18, 0x24, 0x24, 0x18 }, { 0x18, 0x24, 0x24, 0x18, 0xFC }, { 0x7C, 0x08, 0x04, 0x04, 0x08 }, { 0x48, 0x54, 0x54, 0x54, 0x24 },
+        { 0x04, 0x04, 0x3F, 0x44, 0x24 }, { 0x3C, 0x40, 0x40, 0x20, 0x7C }, { 0x1C, 0x20, 0x40, 0x20, 0x1C }, { 0x3C, 0x40, 0x30, 0x40, 0x3C },
+        { 0x44, 0x28, 0x10, 0x28, 0x44 }, { 0x4C, 0x90, 0x90, 0x90, 0x7C }, { 0x44, 0x64, 0x54, 0x4C, 0x44 }, { 0x00, 0x08, 0x36, 0x41, 0x00 },
+        { 0x00, 0x00, 0x77, 0x00, 0x00 }, { 0x00, 0x41, 0x36, 0x08, 0x00 }, { 0x02, 0x01, 0x02, 0x04, 0x02 },
+    };
+
+    // Makes a key of a glyph at a pixel size.
+    std::uint64_t MakeGlyphKey(unsigned int character, int pixelSize)
+    {
+        return (std::uint64_t)character << 16 | (std::uint64_t)pixelSize;
+    }
+
+    // Gets the size of a glyph slot at a pixel size, including padding.
+    void GetGlyphSize(int pixelSize, int& width, int& height)
+    {
+        float scale = (float)pixelSize / CellRows;
+
+        width = (int)std::ceil(GlyphColumns * scale) + GlyphPadding * 2;
+        height = (int)std::ceil(GlyphRows * scale) + GlyphPadding * 2;
+    }
+
+    // Decodes the next character of an UTF-8 string.
+    // Malformed sequences are decoded as the fallback character.
+    unsigned int DecodeCharacter(const std::string& text, std::size_t& index)
+    {
+        unsigned char lead = (unsigned char)text[index++];
+
+        if(lead < 0x80)
+            return lead;
+
+        int length = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : 0;
+        unsigned int character = lead & (0x3F >> length);
+
+        for(int i = 0; i < length; ++i)
+        {
+            if(index >= text.size() || ((unsigned char)text[index] & 0xC0) != 0x80)
+                return FallbackCharacter;
+
+            character = character << 6 | ((unsigned char)text[index++] & 0x3F);
+        }
+
+        return length == 0 ? FallbackCharacter : character;
+    }
+
+    // Hashes a string along with its pixel size.
+    std::uint64_t HashLayout(const std::string& text, int pixelSize)
+    {
+        std::uint64_t hash = 14695981039346656037ull;
+
+        for(char character : text)
+        {
+            hash = (hash ^ (std::uint8_t)character) * 1099511628211ull;
+        }
+
+        hash = (hash ^ (std::uint64_t)pixelSize) * 1099511628211ull;
+
+        // A zero key marks empty slots of the map.
+        return hash != 0 ? hash : 1;
+    }
+
+    // Creates the atlas texture on the render thread.
+    void CreateResources(StateCache& cache, void* argument)
+    {
+        auto state = static_cast<Detail::TextRendererState*>(argument);
+
+        // Start from transparent pixels, so unused parts of slots stay empty.
+        std::vector<std::uint8_t> pixels((std::size_t)state->atlasSize * state->atlasSize * 4, 0);
+
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        cache.BindTexture(0, GL_TEXTURE_2D, texture);
+
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, state->atlasSize, state->atlasSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        state->texture.store(texture, std::memory_order_release);
+    }
+
+    // Destroys the atlas texture and the state on the render thread.
+    void DestroyResources(StateCache& cache, void* argument)
+    {
+        auto state = static_cast<Detail::TextRendererState*>(argument);
+
+        GLuint texture = state->texture.load(std::memory_order_relaxed);
+        glDeleteTextures(1, &texture);
+
+        // Deleted objects may have been bound.
+        cache.Invalidate();
+
+        delete state;
+    }
+
+    // Uploads glyphs rasterized in a frame on the render thread.
+    void UploadGlyphs(StateCache& cache, void* argument)
+    {
+        auto frame = static_cast<Detail::TextRendererFrame*>(argument);
+
+        GLuint texture = frame->state->texture.load(std::memory_order_relaxed);
+
+        if(texture == 0)
+            return;
+
+        cache.BindTexture(0, GL_TEXTURE_2D, texture);
+
+        for(const Detail::GlyphUpload& upload : frame->uploads)
+        {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, upload.x, upload.y, upload.width, upload.height, GL_RGBA, GL_UNSIGNED_BYTE, frame->pixels.data() + upload.offset);
+        }
+    }
+}
+
+TextRendererInfo::TextRendererInfo() :
+    renderer(nullptr),
+    atlasSize(512),
+    capacity(16 * 1024),
+    layoutCapacity(1024),
+    minimumSize(6),
+    maximumSize(96)
+{
+}
+
+TextRenderer::TextRenderer() :
+    m_renderer(nullptr),
+    m_state(nullptr),
+    m_shelfTop(0),
+    m_capacityWarned(false),
+    m_frameIndex(0),
+    m_initialized(false)
+{
+}
+
+TextRenderer::~TextRenderer()
+{
+    this->Cleanup();
+}
+
+void TextRenderer::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Destroy the state on the render thread after frames that use it.
+    m_renderer->GetCommands().Call(&DestroyResources, m_state);
+    m_state = nullptr;
+
+    m_renderer = nullptr;
+    m_info = TextRendererInfo();
+
+    // Clear glyphs and layouts.
+    Utility::ClearContainer(m_glyphs);
+    Utility::ClearContainer(m_freeGlyphs);
+    m_glyphIds.Cleanup();
+    Utility::ClearContainer(m_shelves);
+    m_shelfTop = 0;
+
+    Utility::ClearContainer(m_layouts);
+    Utility::ClearContainer(m_freeLayouts);
+    m_layoutIds.Cleanup();
+    m_uncachedLayout = Layout();
+
+    Utility::ClearContainer(m_instances);
+    m_capacityWarned = false;
+
+    m_frameIndex = 0;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool TextRenderer::Initialize(const TextRendererInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.renderer == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid renderer.";
+        return false;
+    }
+
+    if(info.capacity <= 0 || info.layoutCapacity <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid capacity.";
+        return false;
+    }
+
+    if(info.minimumSize <= 0 || info.maximumSize < info.minimumSize)
+    {
+        LogError() << LogInitializeError() << "Invalid range of sizes.";
+        return false;
+    }
+
+    // The largest glyph has to fit the atlas.
+    int largestWidth = 0;
+    int largestHeight = 0;
+    GetGlyphSize(info.maximumSize, largestWidth, largestHeight);
+
+    if(info.atlasSize < largestWidth || info.atlasSize < largestHeight)
+    {
+        LogError() << LogInitializeError() << "Atlas is too small for the maximum size.";
+        return false;
+    }
+
+    m_renderer = info.renderer;
+    m_info = info;
+
+    // Create the state and the atlas texture on the render thread.
+    m_state = new Detail::TextRendererState();
+    m_state->atlasSize = info.atlasSize;
+
+    for(auto& frame : m_state->frames)
+    {
+        frame.state = m_state;
+    }
+
+    m_renderer->GetCommands().Call(&CreateResources, m_state);
+
+    // Success!
+    return m_initialized = true;
+}
+
+void TextRenderer::AddText(const std::string& text, const glm::vec2& position, float size, const glm::vec4& color, float depth)
+{
+    if(!m_initialized || text.empty())
+        return;
+
+    int pixelSize = this->GetPixelSize(size);
+    float scale = size / pixelSize;
+
+    const Layout& layout = this->AcquireLayout(text, pixelSize);
+
+    for(const LayoutGlyph& layoutGlyph : layout.glyphs)
+    {
+        if(m_instances.size() >= (std::size_t)m_info.capacity)
+        {
+            if(!m_capacityWarned)
+            {
+                LogWarning() << "Text renderer capacity of " << m_info.capacity << " glyphs has been exceeded.";
+                m_capacityWarned = true;
+            }
+
+            return;
+        }
+
+        const Glyph* glyph = this->AcquireGlyph(layoutGlyph.key);
+
+        if(glyph == nullptr)
+            continue;
+
+        SpriteInstance instance;
+        instance.position = position + layoutGlyph.center * scale;
+        instance.size = glyph->size * scale;
+        instance.rotation = 0.0f;
+        instance.depth = depth;
+        instance.color = color;
+        instance.textureRect = glyph->textureRect;
+
+        m_instances.push_back(instance);
+    }
+}
+
+glm::vec2 TextRenderer::MeasureText(const std::string& text, float size)
+{
+    if(!m_initialized || text.empty())
+        return glm::vec2(0.0f, 0.0f);
+
+    int pixelSize = this->GetPixelSize(size);
+    const Layout& layout = this->AcquireLayout(text, pixelSize);
+
+    return layout.extent * (size / pixelSize);
+}
+
+void TextRenderer::Flush(CommandBuffer& commands)
+{
+    if(!m_initialized)
+        return;
+
+    Detail::TextRendererFrame& frame = m_state->frames[m_frameIndex % FrameCount];
+
+    if(frame.uploads.empty())
+        return;
+
+    commands.Call(&UploadGlyphs, &frame);
+}
+
+int TextRenderer::Write(SpriteInstance* destination, int capacity) const
+{
+    int count = std::min((int)m_instances.size(), capacity);
+
+    // Whole instances are written in order, as the destination may be write combined memory.
+    for(int i = 0; i < count; ++i)
+    {
+        destination[i] = m_instances[i];
+    }
+
+    return count;
+}
+
+void TextRenderer::EndFrame()
+{
+    if(!m_initialized)
+        return;
+
+    m_instances.clear();
+    m_capacityWarned = false;
+
+    // Drop layouts that were not used in this frame once there are too many.
+    if(m_layoutIds.GetSize() > (std::size_t)m_info.layoutCapacity)
+    {
+        for(int i = 0; i < (int)m_layouts.size(); ++i)
+        {
+            Layout& layout = m_layouts[i];
+
+            if(layout.pixelSize == 0 || layout.lastUsed == m_frameIndex)
+                continue;
+
+            m_layoutIds.Remove(HashLayout(layout.text, layout.pixelSize));
+            layout = Layout();
+            layout.pixelSize = 0;
+            m_freeLayouts.push_back(i);
+        }
+    }
+
+    // Start the next frame with empty uploads.
+    m_frameIndex += 1;
+
+    Detail::TextRendererFrame& frame = m_state->frames[m_frameIndex % FrameCount];
+    frame.uploads.clear();
+    frame.pixels.clear();
+}
+
+GLuint TextRenderer::GetTexture() const
+{
+    if(!m_initialized)
+        return 0;
+
+    return m_state->texture.load(std::memory_order_acquire);
+}
+
+int TextRenderer::GetInstanceCount() const
+{
+    return (int)m_instances.size();
+}
+
+int TextRenderer::GetGlyphCount() const
+{
+    return (int)m_glyphIds.GetSize();
+}
+
+int TextRenderer::GetLayoutCount() const
+{
+    return (int)m_layoutIds.GetSize();
+}
+
+bool TextRenderer::IsInitialized() const
+{
+    return m_initialized;
+}
+
+int TextRenderer::GetPixelSize(float size) const
+{
+    int pixelSize = (int)(size + 0.5f);
+    return std::min(std::max(pixelSize, m_info.minimumSize), m_info.maximumSize);
+}
+
+const TextRenderer::Layout& TextRenderer::AcquireLayout(const std::string& text, int pixelSize)
+{
+    std::uint64_t hash = HashLayout(text, pixelSize);
+
+    if(const int* index = m_layoutIds.Find(hash))
+    {
+        Layout& layout = m_layouts[*index];
+
+        if(layout.pixelSize == pixelSize && layout.text == text)
+        {
+            layout.lastUsed = m_frameIndex;
+            return layout;
+        }
+
+        // Strings whose hash collides with a cached one are laid out every time.
+        LayoutText(text, pixelSize, m_uncachedLayout);
+        return m_uncachedLayout;
+    }
+
+    // Reuse a dropped layout or append a new one.
+    int index = 0;
+
+    if(!m_freeLayouts.empty())
+    {
+        index = m_freeLayouts.back();
+        m_freeLayouts.pop_back();
+    }
+    else
+    {
+        index = (int)m_layouts.size();
+        m_layouts.emplace_back();
+    }
+
+    Layout& layout = m_layouts[index];
+    LayoutText(text, pixelSize, layout);
+    layout.lastUsed = m_frameIndex;
+
+    m_layoutIds.Insert(hash, index);
+
+    return layout;
+}
+
+void TextRenderer::LayoutText(const std::string& text, int pixelSize, Layout& layout)
+{
+    layout.text = text;
+    layout.pixelSize = pixelSize;
+    layout.glyphs.clear();
+
+    float scale = (float)pixelSize / CellRows;
+    float advance = CellColumns * scale;
+    float lineHeight = CellRows * scale;
+
+    int width = 0;
+    int height = 0;
+    GetGlyphSize(pixelSize, width, height);
+
+    // Quads cover whole slots, which start at the top left corner of cells minus padding.
+    glm::vec2 center(width * 0.5f - GlyphPadding, GlyphPadding - height * 0.5f);
+
+    int column = 0;
+    int line = 0;
+    int longestLine = 0;
+
+    for(std::size_t i = 0; i < text.size();)
+    {
+        unsigned int character = DecodeCharacter(text, i);
+
+        if(character == '\n')
+        {
+            longestLine = std::max(longestLine, column);
+            column = 0;
+            line += 1;
+            continue;
+        }
+
+        if(character == '\t')
+        {
+            column = (column / 4 + 1) * 4;
+            continue;
+        }
+
+        if(character < FirstCharacter || character > LastCharacter)
+        {
+            character = FallbackCharacter;
+        }
+
+        // Spaces only advance.
+        if(character != ' ')
+        {
+            LayoutGlyph glyph;
+            glyph.key = MakeGlyphKey(character, pixelSize);
+            glyph.center = glm::vec2(column * advance, -line * lineHeight) + center;
+
+            layout.glyphs.push_back(glyph);
+        }
+
+        column += 1;
+    }
+
+    longestLine = std::max(longestLine, column);
+    layout.extent = glm::vec2(longestLine * advance, (line + 1) * lineHeight);
+}
+
+const TextRenderer::Glyph* TextRenderer::AcquireGlyph(std::uint64_t key)
+{
+    if(const int* index = m_glyphIds.Find(key))
+    {
+        Glyph& glyph = m_glyphs[*index];
+        glyph.lastUsed = m_frameIndex;
+        m_shelves[glyph.shelf].lastUsed = m_frameIndex;
+
+        return &glyph;
+    }
+
+    unsigned int character = (unsigned int)(key >> 16);
+    int pixelSize = (int)(key & 0xFFFF);
+
+    // Find a slot for the glyph.
+    int width = 0;
+    int height = 0;
+    GetGlyphSize(pixelSize, width, height);
+
+    int shelfIndex = InvalidIndex;
+    int slot = InvalidIndex;
+
+    if(!this->AllocateSlot(pixelSize, width, height, shelfIndex, slot))
+        return nullptr;
+
+    // Reuse a free glyph or append a new one.
+    int index = 0;
+
+    if(!m_freeGlyphs.empty())
+    {
+        index = m_freeGlyphs.back();
+        m_freeGlyphs.pop_back();
+    }
+    else
+    {
+        index = (int)m_glyphs.size();
+        m_glyphs.emplace_back();
+    }
+
+    Shelf& shelf = m_shelves[shelfIndex];
+    shelf.glyphs[slot] = index;
+    shelf.freeCount -= 1;
+    shelf.lastUsed = m_frameIndex;
+
+    int x = slot * shelf.slotWidth;
+    int y = shelf.y;
+    float atlasSize = (float)m_info.atlasSize;
+
+    Glyph& glyph = m_glyphs[index];
+    glyph.key = key;
+    glyph.shelf = shelfIndex;
+    glyph.slot = slot;
+    glyph.size = glm::vec2((float)width, (float)height);
+    glyph.textureRect = glm::vec4(x / atlasSize, y / atlasSize, (x + width) / atlasSize, (y + height) / atlasSize);
+    glyph.lastUsed = m_frameIndex;
+
+    m_glyphIds.Insert(key, index);
+
+    this->RasterizeGlyph(character, pixelSize, x, y, width, height);
+
+    return &glyph;
+}
+
+bool TextRenderer::AllocateSlot(int pixelSize, int width, int height, int& shelf, int& slot)
+{
+    // Take a free slot of a shelf for the same size.
+    for(int i = 0; i < (int)m_shelves.size(); ++i)
+    {
+        Shelf& candidate = m_shelves[i];
+
+        if(candidate.pixelSize != pixelSize || candidate.freeCount == 0)
+            continue;
+
+        for(int j = 0; j < (int)candidate.glyphs.size(); ++j)
+        {
+            if(candidate.glyphs[j] == InvalidIndex)
+            {
+                shelf = i;
+                slot = j;
+                return true;
+            }
+        }
+    }
+
+    // Start a new shelf below the others.
+    if(m_shelfTop + height <= m_info.atlasSize)
+    {
+        Shelf created;
+        created.y = m_shelfTop;
+        created.height = height;
+        created.slotWidth = width;
+        created.pixelSize = pixelSize;
+        created.freeCount = m_info.atlasSize / width;
+        created.glyphs.assign(created.freeCount, InvalidIndex);
+        created.lastUsed = m_frameIndex;
+
+        m_shelfTop += height;
+        m_shelves.push_back(created);
+
+        shelf = (int)m_shelves.size() - 1;
+        slot = 0;
+        return true;
+    }
+
+    // Evict the least recently used glyph of the same size.
+    int evicted = InvalidIndex;
+
+    for(int i = 0; i < (int)m_glyphs.size(); ++i)
+    {
+        const Glyph& glyph = m_glyphs[i];
+
+        if(glyph.key == 0 || glyph.lastUsed == m_frameIndex || m_shelves[glyph.shelf].pixelSize != pixelSize)
+            continue;
+
+        if(evicted == InvalidIndex || glyph.lastUsed < m_glyphs[evicted].lastUsed)
+        {
+            evicted = i;
+        }
+    }
+
+    if(evicted != InvalidIndex)
+    {
+        shelf = m_glyphs[evicted].shelf;
+        slot = m_glyphs[evicted].slot;
+
+        this->EvictGlyph(evicted);
+        return true;
+    }
+
+    // Take over the least recently used shelf that is tall enough.
+    int reclaimed = InvalidIndex;
+
+    for(int i = 0; i < (int)m_shelves.size(); ++i)
+    {
+        const Shelf& candidate = m_shelves[i];
+
+        if(candidate.height < height || candidate.lastUsed == m_frameIndex)
+            continue;
+
+        if(reclaimed == InvalidIndex || candidate.lastUsed < m_shelves[reclaimed].lastUsed)
+        {
+            reclaimed = i;
+        }
+    }
+
+    if(reclaimed == InvalidIndex)
+    {
+        LogWarning() << "Text renderer atlas has no room for glyphs of size " << pixelSize << ".";
+        return false;
+    }
+
+    for(int glyph : m_shelves[reclaimed].glyphs)
+    {
+        if(glyph != InvalidIndex)
+        {
+            this->EvictGlyph(glyph);
+        }
+    }
+
+    Shelf& taken = m_shelves[reclaimed];
+    taken.slotWidth = width;
+    taken.pixelSize = pixelSize;
+    taken.freeCount = m_info.atlasSize / width;
+    taken.glyphs.assign(taken.freeCount, InvalidIndex);
+
+    shelf = reclaimed;
+    slot = 0;
+    return true;
+}
+
+void TextRenderer::EvictGlyph(int glyph)
+{
+    Glyph& evicted = m_glyphs[glyph];
+    Shelf& shelf = m_shelves[evicted.shelf];
+
+    shelf.glyphs[evicted.slot] = InvalidIndex;
+    shelf.freeCount += 1;
+
+    m_glyphIds.Remove(evicted.key);
+
+    evicted.key = 0;
+    m_freeGlyphs.push_back(glyph);
+}
+
+void TextRenderer::RasterizeGlyph(unsigned int character, int pixelSize, int x, int y, int width, int height)
+{
+    Detail::TextRendererFrame& frame = m_state->frames[m_frameIndex % FrameCount];
+
+    Detail::GlyphUpload upload;
+    upload.x = x;
+    upload.y = y;
+    upload.width = width;
+    upload.height = height;
+    upload.offset = frame.pixels.size();
+
+    frame.uploads.push_back(upload);
+    frame.pixels.resize(upload.offset + (std::size_t)width * height * 4);
+
+    const std::uint8_t* columns = FontColumns[character - FirstCharacter];
+    std::uint8_t* pixels = frame.pixels.data() + upload.offset;
+
+    float unitsPerPixel = (float)CellRows / pixelSize;
+    float subsampleStep = 1.0f / Supersampling;
+
+    // Rows are stored from the bottom up, matching texture coordinates of sprites.
+    for(int row = 0; row < height; ++row)
+    {
+        int fromTop = height - 1 - row - GlyphPadding;
+
+        for(int column = 0; column < width; ++column)
+        {
+            int fromLeft = column - GlyphPadding;
+            int covered = 0;
+
+            // Count subsamples that land in set cells of the glyph.
+            for(int j = 0; j < Supersampling; ++j)
+            {
+                float fontY = (fromTop + (j + 0.5f) * subsampleStep) * unitsPerPixel;
+
+                if(fontY < 0.0f || fontY >= GlyphRows)
+                    continue;
+
+                for(int i = 0; i < Supersampling; ++i)
+                {
+                    float fontX = (fromLeft + (i + 0.5f) * subsampleStep) * unitsPerPixel;
+
+                    if(fontX < 0.0f || fontX >= GlyphColumns)
+                        continue;
+
+                    covered += (columns[(int)fontX] >> (int)fontY) & 1;
+                }
+            }
+
+            // Glyphs are white, so sprite colors tint them.
+            std::uint8_t* pixel = pixels + ((std::size_t)row * width + column) * 4;
+            pixel[0] = 255;
+            pixel[1] = 255;
+            pixel[2] = 255;
+            pixel[3] = (std::uint8_t)(covered * 255 / (Supersampling * Supersampling));
+        }
+    }
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Game/EntityMap.hpp"
+#include "Renderer.hpp"
+#include "SpriteBatch.hpp"
+
+//
+// Text Renderer
+//
+//  Lays out strings into glyph quads that the sprite batch draws after
+//  sprites and particles, with a single draw call for all text of a frame.
+//
+//  Glyphs are rasterized on demand at the pixel size they are drawn at,
+//  from a built-in font of 5 by 7 outlines with descenders, supersampled
+//  for antialiased edges at any size. They are cached in an atlas texture
+//  split into shelves, where each shelf holds glyphs of a single pixel size
+//  in equal slots. When the atlas fills up, the least recently used glyph
+//  of the same size gives up its slot, or the least recently used shelf is
+//  taken over by another size. Glyphs drawn in the current frame are never
+//  evicted. Rasterized glyphs are uploaded by calls recorded into the
+//  command buffer before the draw that uses them.
+//
+//  Layouts of strings are cached by their text and pixel size, so strings
+//  that do not change between frames only copy their quads. Layouts that
+//  were not used in the current frame are dropped once the cache exceeds
+//  its capacity.
+//
+//  Text is placed by the top left corner of its first line in the same
+//  coordinates as sprites, with the y axis pointing up. Characters outside
+//  of printable ASCII are drawn as question marks.
+//
+//  Example usage:
+//      Graphics::TextRendererInfo info;
+//      info.renderer = &renderer;
+//
+//      Graphics::TextRenderer textRenderer;
+//      textRenderer.Initialize(info);
+//
+//      spriteBatchInfo.textRenderer = &textRenderer;
+//
+//      while(window.IsOpen())
+//      {
+//          textRenderer.AddText("Hello!", glm::vec2(8.0f, 200.0f), 16.0f);
+//          spriteBatch.Draw(commands, viewProjection);
+//      }
+//
+
+namespace Graphics
+{
+    // Implementation details.
+    namespace Detail
+    {
+        struct TextRendererState;
+    }
+
+    // Text renderer initialization struct.
+    struct TextRendererInfo
+    {
+        TextRendererInfo();
+
+        // Renderer that owns the atlas texture.
+        Renderer* renderer;
+
+        // Width and height of the atlas texture in pixels.
+        int atlasSize;
+
+        // Maximum number of glyph quads drawn in a frame.
+        int capacity;
+
+        // Number of layouts kept before unused ones are dropped.
+        int layoutCapacity;
+
+        // Range of pixel sizes that glyphs are rasterized at.
+        int minimumSize;
+        int maximumSize;
+    };
+
+    // Text renderer class.
+    class TextRenderer : private NonCopyable
+    {
+    public:
+        // Number of frames that can be in flight.
+        static const int FrameCount = 3;
+
+    public:
+        TextRenderer();
+        ~TextRenderer();
+
+        // Restores instance to its original state.
+        // Must be called before the renderer is cleaned up.
+        void Cleanup();
+
+        // Initializes the text renderer.
+        bool Initialize(const TextRendererInfo& info);
+
+        // Queues a string to be drawn in the current frame.
+        // Lines are separated by new line characters.
+        void AddText(const std::string& text, const glm::vec2& position, float size, const glm::vec4& color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), float depth = 0.0f);
+
+        // Measures the size of a string drawn at a size.
+        glm::vec2 MeasureText(const std::string& text, float size);
+
+        // Records uploads of glyphs rasterized in the current frame.
+        void Flush(CommandBuffer& commands);
+
+        // Writes quads of queued strings, up to a capacity.
+        // Returns the number of written instances.
+        int Write(SpriteInstance* destination, int capacity) const;
+
+        // Drops queued strings and starts a new frame.
+        void EndFrame();
+
+        // Gets the atlas texture.
+        // Returns zero until it has been created on the render thread.
+        GLuint GetTexture() const;
+
+        // Gets the number of glyph quads queued in the current frame.
+        int GetInstanceCount() const;
+
+        // Gets the number of cached glyphs and layouts.
+        int GetGlyphCount() const;
+        int GetLayoutCount() const;
+
+        // Checks if the instance is initialized.
+        bool IsInitialized() const;
+
+    private:
+        // Glyph cached in a slot of the atlas.
+        struct Glyph
+        {
+            std::uint64_t key;
+            int shelf;
+            int slot;
+            glm::vec2 size;
+            glm::vec4 textureRect;
+            std::uint64_t lastUsed;
+        };
+
+        // Row of equal slots for glyphs of a single pixel size.
+        struct Shelf
+        {
+            int y;
+            int height;
+            int slotWidth;
+            int pixelSize;
+            int freeCount;
+            std::vector<int> glyphs;
+            std::uint64_t lastUsed;
+        };
+
+        // Glyph of a layout placed relative to the origin of its string.
+        struct LayoutGlyph
+        {
+            std::uint64_t key;
+            glm::vec2 center;
+        };
+
+        // Cached layout of a string at a pixel size.
+        struct Layout
+        {
+            std::string text;
+            int pixelSize;
+            std::vector<LayoutGlyph> glyphs;
+            glm::vec2 extent;
+            std::uint64_t lastUsed;
+        };
+
+    private:
+        // Gets the pixel size that a size is rasterized at.
+        int GetPixelSize(float size) const;
+
+        // Gets a cached layout of a string, laying it out on a miss.
+        const Layout& AcquireLayout(const std::string& text, int pixelSize);
+
+        // Lays out a string into glyphs.
+        static void LayoutText(const std::string& text, int pixelSize, Layout& layout);
+
+        // Gets a cached glyph, rasterizing it on a miss.
+        // Returns nullptr if no slot could be freed for it.
+        const Glyph* AcquireGlyph(std::uint64_t key);
+
+        // Finds a slot for a glyph, evicting least recently used ones if needed.
+        bool AllocateSlot(int pixelSize, int width, int height, int& shelf, int& slot);
+
+        // Removes a glyph from its slot.
+        void EvictGlyph(int glyph);
+
+        // Rasterizes a glyph into the pixels of the current upload.
+        void RasterizeGlyph(unsigned int character, int pixelSize, int x, int y, int width, int height);
+
+    private:
+        // Renderer that owns the atlas texture.
+        Renderer* m_renderer;
+
+        // State shared with the render thread.
+        Detail::TextRendererState* m_state;
+
+        // Text renderer settings.
+        TextRendererInfo m_info;
+
+        // Cached glyphs and the shelves that hold them.
+        std::vector<Glyph> m_glyphs;
+        std::vector<int> m_freeGlyphs;
+        Game::EntityMap<int, std::uint64_t> m_glyphIds;
+        std::vector<Shelf> m_shelves;
+        int m_shelfTop;
+
+        // Cached layouts.
+        std::vector<Layout> m_layouts;
+        std::vector<int> m_freeLayouts;
+        Game::EntityMap<int, std::uint64_t> m_layoutIds;
+        Layout m_uncachedLayout;
+
+        // Glyph quads queued in the current frame.
+        std::vector<SpriteInstance> m_instances;
+        bool m_capacityWarned;
+
+        // Index of the current frame.
+        std::uint64_t m_frameIndex;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
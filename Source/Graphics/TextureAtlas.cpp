@@ -0,0 +1,517 @@
+#include "Precompiled.hpp"
+#include "TextureAtlas.hpp"
+#include "Targa.hpp"
+using namespace Graphics;
+
+namespace
+{
+    // Log message strings.
+    #define LogAddError(name) "Failed to add \"" << name << "\" image to a texture atlas! "
+    #define LogPackError() "Failed to pack a texture atlas! "
+    #define LogSaveError(filename) "Failed to save a texture atlas to \"" << filename << "\" file! "
+    #define LogLoadError(filename) "Failed to load a texture atlas from \"" << filename << "\" file! "
+
+    // Size of a pixel.
+    const std::size_t PixelSize = 4;
+
+    // Tag at the start of index files.
+    const char* IndexTag = "TextureAtlas";
+
+    // Gets the smallest power of two not lower than a value.
+    int GetPowerOfTwo(int value)
+    {
+        int result = 1;
+
+        while(result < value)
+        {
+            result *= 2;
+        }
+
+        return result;
+    }
+}
+
+SkylinePacker::SkylinePacker() :
+    m_width(0),
+    m_height(0)
+{
+}
+
+void SkylinePacker::Reset(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+
+    // Start with a single segment along the bottom.
+    Segment segment;
+    segment.x = 0;
+    segment.y = 0;
+    segment.width = width;
+
+    m_skyline.clear();
+    m_skyline.push_back(segment);
+}
+
+bool SkylinePacker::Insert(int width, int height, int& x, int& y)
+{
+    if(width <= 0 || height <= 0)
+        return false;
+
+    // Find the segment with the lowest top edge, then the narrowest one.
+    std::size_t bestIndex = m_skyline.size();
+    int bestTop = std::numeric_limits<int>::max();
+    int bestWidth = std::numeric_limits<int>::max();
+
+    for(std::size_t i = 0; i < m_skyline.size(); ++i)
+    {
+        int fit = this->GetFitHeight(i, width, height);
+
+        if(fit < 0)
+            continue;
+
+        int top = fit + height;
+
+        if(top < bestTop || (top == bestTop && m_skyline[i].width < bestWidth))
+        {
+            bestIndex = i;
+            bestTop = top;
+            bestWidth = m_skyline[i].width;
+        }
+    }
+
+    if(bestIndex == m_skyline.size())
+        return false;
+
+    x = m_skyline[bestIndex].x;
+    y = bestTop - height;
+
+    // Raise the skyline under the rectangle.
+    Segment segment;
+    segment.x = x;
+    segment.y = bestTop;
+    segment.width = width;
+
+    m_skyline.insert(m_skyline.begin() + bestIndex, segment);
+
+    // Shrink or remove segments covered by the new one.
+    std::size_t next = bestIndex + 1;
+
+    while(next < m_skyline.size())
+    {
+        Segment& covered = m_skyline[next];
+        int overlap = x + width - covered.x;
+
+        if(overlap <= 0)
+            break;
+
+        if(overlap < covered.width)
+        {
+            covered.x += overlap;
+            covered.width -= overlap;
+            break;
+        }
+
+        m_skyline.erase(m_skyline.begin() + next);
+    }
+
+    // Merge neighbours at the same height.
+    for(std::size_t i = 0; i + 1 < m_skyline.size(); )
+    {
+        if(m_skyline[i].y == m_skyline[i + 1].y)
+        {
+            m_skyline[i].width += m_skyline[i + 1].width;
+            m_skyline.erase(m_skyline.begin() + i + 1);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    return true;
+}
+
+int SkylinePacker::GetFitHeight(std::size_t index, int width, int height) const
+{
+    int x = m_skyline[index].x;
+
+    if(x + width > m_width)
+        return -1;
+
+    // Rest on the highest segment under the rectangle.
+    int y = 0;
+    int remaining = width;
+
+    for(std::size_t i = index; remaining > 0 && i < m_skyline.size(); ++i)
+    {
+        y = std::max(y, m_skyline[i].y);
+
+        if(y + height > m_height)
+            return -1;
+
+        remaining -= m_skyline[i].width;
+    }
+
+    return y;
+}
+
+int SkylinePacker::GetWidth() const
+{
+    return m_width;
+}
+
+int SkylinePacker::GetHeight() const
+{
+    return m_height;
+}
+
+TextureAtlasInfo::TextureAtlasInfo() :
+    name("TextureAtlas"),
+    maximumSize(4096),
+    padding(1)
+{
+}
+
+TextureRegion::TextureRegion() :
+    x(0),
+    y(0),
+    width(0),
+    height(0),
+    textureRect(0.0f, 0.0f, 1.0f, 1.0f)
+{
+}
+
+TextureAtlas::TextureAtlas() :
+    m_baked(false),
+    m_width(0),
+    m_height(0)
+{
+}
+
+TextureAtlas::~TextureAtlas()
+{
+    this->Cleanup();
+}
+
+void TextureAtlas::Cleanup()
+{
+    Utility::ClearContainer(m_images);
+    Utility::ClearContainer(m_regions);
+    Utility::ClearContainer(m_pixels);
+
+    m_name.clear();
+    m_baked = false;
+    m_width = 0;
+    m_height = 0;
+}
+
+bool TextureAtlas::AddImage(const std::string& name, int width, int height, const std::vector<std::uint8_t>& pixels)
+{
+    if(width <= 0 || height <= 0 || pixels.size() < (std::size_t)width * height * PixelSize)
+    {
+        LogError() << LogAddError(name) << "Invalid image size.";
+        return false;
+    }
+
+    m_images.emplace_back();
+
+    Image& image = m_images.back();
+    image.name = name;
+    image.width = width;
+    image.height = height;
+    image.pixels.assign(pixels.begin(), pixels.begin() + (std::size_t)width * height * PixelSize);
+
+    return true;
+}
+
+bool TextureAtlas::AddFile(const std::string& filename)
+{
+    std::vector<std::uint8_t> pixels;
+    int width = 0;
+    int height = 0;
+
+    if(!Targa::Load(filename, pixels, width, height))
+    {
+        LogError() << LogAddError(filename) << "Couldn't load the image.";
+        return false;
+    }
+
+    return this->AddImage(filename, width, height, pixels);
+}
+
+bool TextureAtlas::Pack(const TextureAtlasInfo& info)
+{
+    if(m_images.empty())
+    {
+        LogError() << LogPackError() << "No images have been added.";
+        return false;
+    }
+
+    if(info.padding < 0 || info.maximumSize <= 0)
+    {
+        LogError() << LogPackError() << "Invalid pack parameters.";
+        return false;
+    }
+
+    // Start at the smallest square that could hold all images.
+    std::size_t area = 0;
+    int largest = 0;
+
+    for(const Image& image : m_images)
+    {
+        int width = image.width + info.padding * 2;
+        int height = image.height + info.padding * 2;
+
+        area += (std::size_t)width * height;
+        largest = std::max(largest, std::max(width, height));
+    }
+
+    int width = GetPowerOfTwo(std::max(largest, (int)std::sqrt((double)area)));
+    int height = width;
+
+    // Grow the atlas until all images fit, alternating between dimensions.
+    std::vector<int> positions;
+
+    while(!this->Place(width, height, info.padding, positions))
+    {
+        if(width == height)
+        {
+            width *= 2;
+        }
+        else
+        {
+            height *= 2;
+        }
+
+        if(width > info.maximumSize || height > info.maximumSize)
+        {
+            LogError() << LogPackError() << "Images don't fit in the maximum size.";
+            return false;
+        }
+    }
+
+    // Copy images and extend their edges into the padding.
+    m_pixels.assign((std::size_t)width * height * PixelSize, 0);
+    m_regions.clear();
+
+    for(std::size_t i = 0; i < m_images.size(); ++i)
+    {
+        const Image& image = m_images[i];
+
+        int paddedWidth = image.width + info.padding * 2;
+        int paddedHeight = image.height + info.padding * 2;
+
+        for(int row = 0; row < paddedHeight; ++row)
+        {
+            int sourceRow = std::min(std::max(row - info.padding, 0), image.height - 1);
+            std::uint8_t* destination = &m_pixels[((std::size_t)(positions[i * 2 + 1] + row) * width + positions[i * 2]) * PixelSize];
+
+            for(int column = 0; column < paddedWidth; ++column)
+            {
+                int sourceColumn = std::min(std::max(column - info.padding, 0), image.width - 1);
+                const std::uint8_t* source = &image.pixels[((std::size_t)sourceRow * image.width + sourceColumn) * PixelSize];
+
+                std::copy(source, source + PixelSize, destination + column * PixelSize);
+            }
+        }
+
+        TextureRegion& region = m_regions[image.name];
+        region.x = positions[i * 2] + info.padding;
+        region.y = positions[i * 2 + 1] + info.padding;
+        region.width = image.width;
+        region.height = image.height;
+    }
+
+    m_name = info.name;
+    m_baked = false;
+    m_width = width;
+    m_height = height;
+
+    this->UpdateTextureRects();
+
+    Utility::ClearContainer(m_images);
+
+    return true;
+}
+
+bool TextureAtlas::Place(int width, int height, int padding, std::vector<int>& positions) const
+{
+    // Place tall images first, which leaves fewer gaps under the skyline.
+    std::vector<std::size_t> order(m_images.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    std::stable_sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b)
+    {
+        if(m_images[a].height != m_images[b].height)
+            return m_images[a].height > m_images[b].height;
+
+        return m_images[a].width > m_images[b].width;
+    });
+
+    SkylinePacker packer;
+    packer.Reset(width, height);
+
+    positions.resize(m_images.size() * 2);
+
+    for(std::size_t index : order)
+    {
+        const Image& image = m_images[index];
+
+        if(!packer.Insert(image.width + padding * 2, image.height + padding * 2, positions[index * 2], positions[index * 2 + 1]))
+            return false;
+    }
+
+    return true;
+}
+
+void TextureAtlas::UpdateTextureRects()
+{
+    for(auto& pair : m_regions)
+    {
+        TextureRegion& region = pair.second;
+        region.textureRect.x = (float)region.x / m_width;
+        region.textureRect.y = (float)region.y / m_height;
+        region.textureRect.z = (float)(region.x + region.width) / m_width;
+        region.textureRect.w = (float)(region.y + region.height) / m_height;
+    }
+}
+
+bool TextureAtlas::Save(const std::string& imageFilename, const std::string& indexFilename) const
+{
+    if(m_pixels.empty())
+    {
+        LogError() << LogSaveError(indexFilename) << "Atlas hasn't been packed.";
+        return false;
+    }
+
+    if(!Targa::Save(imageFilename, m_width, m_height, m_pixels))
+        return false;
+
+    std::ofstream file(indexFilename, std::ios::trunc);
+
+    if(!file.is_open())
+    {
+        LogError() << LogSaveError(indexFilename) << "Couldn't open the file.";
+        return false;
+    }
+
+    // Names come last, so they can contain spaces.
+    file << IndexTag << " " << m_width << " " << m_height << " " << imageFilename << "\n";
+
+    for(const auto& pair : m_regions)
+    {
+        const TextureRegion& region = pair.second;
+        file << region.x << " " << region.y << " " << region.width << " " << region.height << " " << pair.first << "\n";
+    }
+
+    if(!file.good())
+    {
+        LogError() << LogSaveError(indexFilename) << "Couldn't write to the file.";
+        return false;
+    }
+
+    return true;
+}
+
+bool TextureAtlas::Load(const std::string& indexFilename)
+{
+    this->Cleanup();
+
+    std::ifstream file(indexFilename);
+
+    if(!file.is_open())
+    {
+        LogError() << LogLoadError(indexFilename) << "Couldn't open the file.";
+        return false;
+    }
+
+    // Read the atlas size and image filename.
+    std::string tag;
+    file >> tag >> m_width >> m_height >> std::ws;
+    std::getline(file, m_name);
+
+    if(!file || tag != IndexTag || m_width <= 0 || m_height <= 0 || m_name.empty())
+    {
+        LogError() << LogLoadError(indexFilename) << "Invalid index header.";
+        this->Cleanup();
+        return false;
+    }
+
+    // Read regions until the end of the file.
+    TextureRegion region;
+    std::string name;
+
+    while(file >> region.x >> region.y >> region.width >> region.height >> std::ws && std::getline(file, name))
+    {
+        if(region.x < 0 || region.y < 0 || region.x + region.width > m_width || region.y + region.height > m_height)
+        {
+            LogError() << LogLoadError(indexFilename) << "Region \"" << name << "\" is out of bounds.";
+            this->Cleanup();
+            return false;
+        }
+
+        m_regions[name] = region;
+    }
+
+    if(!file.eof())
+    {
+        LogError() << LogLoadError(indexFilename) << "Invalid region entry.";
+        this->Cleanup();
+        return false;
+    }
+
+    m_baked = true;
+
+    this->UpdateTextureRects();
+
+    return true;
+}
+
+AssetHandle TextureAtlas::LoadTexture(AssetManager& assets)
+{
+    if(m_baked)
+        return assets.LoadTexture(m_name);
+
+    if(m_pixels.empty())
+    {
+        LogError() << "Failed to load a texture atlas texture! Atlas hasn't been packed or its texture has already been loaded.";
+        return AssetHandle();
+    }
+
+    return assets.LoadTexture(m_name, m_width, m_height, m_pixels);
+}
+
+const TextureRegion* TextureAtlas::GetRegion(const std::string& name) const
+{
+    auto it = m_regions.find(name);
+
+    if(it == m_regions.end())
+        return nullptr;
+
+    return &it->second;
+}
+
+glm::vec4 TextureAtlas::GetTextureRect(const std::string& name) const
+{
+    const TextureRegion* region = this->GetRegion(name);
+
+    if(region == nullptr)
+        return glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+
+    return region->textureRect;
+}
+
+int TextureAtlas::GetWidth() const
+{
+    return m_width;
+}
+
+int TextureAtlas::GetHeight() const
+{
+    return m_height;
+}
+
+std::size_t TextureAtlas::GetRegionCount() const
+{
+    return m_regions.size();
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "AssetManager.hpp"
+
+//
+// Texture Atlas
+//
+//  Packs many sprite images into a single texture, so sprites that would
+//  use separate textures can be drawn in the same batch. Each image becomes
+//  a region with texture coordinates that sprites set as their texture rect
+//  along with the texture of the atlas.
+//
+//  Images are packed with a skyline packer, tallest first, into the smallest
+//  power of two size that fits them. Regions are separated by padding that
+//  repeats their edge pixels, so filtering doesn't bleed neighbours in.
+//
+//  Atlases can be packed at load time and uploaded from memory, or baked
+//  offline into an image and an index file, which is then loaded without
+//  packing. The ArchivePacker tool bakes atlases with its atlas option. The
+//  index is a text file with the atlas size and image filename on the first
+//  line, followed by a line for each region with its position, size and name.
+//
+//  Example usage:
+//      Graphics::TextureAtlas atlas;
+//      atlas.AddFile("Data/Player.tga");
+//      atlas.AddFile("Data/Enemy.tga");
+//      atlas.Pack();
+//
+//      Graphics::AssetHandle texture = atlas.LoadTexture(assets);
+//
+//      sprite.texture = assets.GetTexture(texture);
+//      sprite.textureRect = atlas.GetTextureRect("Data/Player.tga");
+//
+
+namespace Graphics
+{
+    // Skyline packer class.
+    // Places rectangles at the lowest position along the top edge of placed ones.
+    class SkylinePacker
+    {
+    public:
+        SkylinePacker();
+
+        // Removes all rectangles and sets the size of the area.
+        void Reset(int width, int height);
+
+        // Places a rectangle and returns its bottom left corner.
+        // Returns false if the rectangle doesn't fit.
+        bool Insert(int width, int height, int& x, int& y);
+
+        // Gets the size of the area.
+        int GetWidth() const;
+        int GetHeight() const;
+
+    private:
+        // Horizontal segment of the skyline.
+        struct Segment
+        {
+            int x;
+            int y;
+            int width;
+        };
+
+        // Gets the height a rectangle would be placed at on a segment.
+        // Returns -1 if the rectangle doesn't fit there.
+        int GetFitHeight(std::size_t index, int width, int height) const;
+
+    private:
+        // Segments ordered from left to right.
+        std::vector<Segment> m_skyline;
+
+        // Size of the area.
+        int m_width;
+        int m_height;
+    };
+
+    // Texture atlas pack struct.
+    struct TextureAtlasInfo
+    {
+        // Name the asset manager references the texture of a packed atlas by.
+        std::string name;
+
+        // Largest width and height of the atlas.
+        int maximumSize;
+
+        // Pixels of padding around each region.
+        int padding;
+
+        TextureAtlasInfo();
+    };
+
+    // Region of an image in an atlas.
+    struct TextureRegion
+    {
+        TextureRegion();
+
+        // Position and size in pixels, without padding.
+        int x;
+        int y;
+        int width;
+        int height;
+
+        // Texture coordinates of the bottom left and top right corners.
+        glm::vec4 textureRect;
+    };
+
+    // Texture atlas class.
+    class TextureAtlas : private NonCopyable
+    {
+    public:
+        TextureAtlas();
+        ~TextureAtlas();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Adds an image from RGBA pixels with rows starting at the bottom.
+        bool AddImage(const std::string& name, int width, int height, const std::vector<std::uint8_t>& pixels);
+
+        // Adds an image from a TGA file, named after its filename.
+        bool AddFile(const std::string& filename);
+
+        // Packs added images into atlas pixels and regions.
+        bool Pack(const TextureAtlasInfo& info = TextureAtlasInfo());
+
+        // Bakes a packed atlas into an image and an index file.
+        bool Save(const std::string& imageFilename, const std::string& indexFilename) const;
+
+        // Loads regions of a baked atlas from its index file.
+        bool Load(const std::string& indexFilename);
+
+        // Starts loading the texture of the atlas.
+        // Packed pixels are handed over to the asset manager, while
+        // baked atlases load their image file. Returns the handle.
+        AssetHandle LoadTexture(AssetManager& assets);
+
+        // Gets a region by name, or null if it doesn't exist.
+        const TextureRegion* GetRegion(const std::string& name) const;
+
+        // Gets texture coordinates of a region, or the whole texture if it doesn't exist.
+        glm::vec4 GetTextureRect(const std::string& name) const;
+
+        // Gets the size of the atlas.
+        int GetWidth() const;
+        int GetHeight() const;
+
+        // Gets the number of regions.
+        std::size_t GetRegionCount() const;
+
+    private:
+        // Image waiting to be packed.
+        struct Image
+        {
+            std::string name;
+            int width;
+            int height;
+            std::vector<std::uint8_t> pixels;
+        };
+
+        // Type declarations.
+        typedef std::map<std::string, TextureRegion> RegionMap;
+
+        // Places all images in an atlas of a size.
+        bool Place(int width, int height, int padding, std::vector<int>& positions) const;
+
+        // Computes texture coordinates of regions.
+        void UpdateTextureRects();
+
+    private:
+        // Images added since the last pack.
+        std::vector<Image> m_images;
+
+        // Regions by name.
+        RegionMap m_regions;
+
+        // Packed pixels, cleared when the texture is loaded.
+        std::vector<std::uint8_t> m_pixels;
+
+        // Name of the texture, or image filename of baked atlases.
+        std::string m_name;
+        bool m_baked;
+
+        // Size of the atlas.
+        int m_width;
+        int m_height;
+    };
+}
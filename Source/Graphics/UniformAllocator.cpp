@@ -0,0 +1,271 @@
+#include "Precompiled.hpp"
+#include "UniformAllocator.hpp"
+#include "StreamBuffer.hpp"
+using namespace Graphics;
+
+namespace Graphics
+{
+    namespace Detail
+    {
+        // Constants of a frame recorded for the render thread.
+        struct UniformAllocatorFrame
+        {
+            UniformAllocatorFrame() :
+                state(nullptr),
+                usedSize(0),
+                allocationCount(0)
+            {
+            }
+
+            UniformAllocatorState* state;
+
+            // Memory that constants are written to.
+            std::unique_ptr<std::uint8_t[]> data;
+            std::atomic<std::size_t> usedSize;
+            std::atomic<int> allocationCount;
+
+            // Range of the stream buffer that constants were uploaded to.
+            BufferRange range;
+        };
+
+        // State shared with the render thread.
+        struct UniformAllocatorState
+        {
+            UniformAllocatorState() :
+                frameSize(0),
+                valid(false)
+            {
+            }
+
+            std::size_t frameSize;
+
+            // Set on the render thread once the stream buffer has been created.
+            bool valid;
+            StreamBuffer stream;
+
+            UniformAllocatorFrame frames[UniformAllocator::FrameCount];
+        };
+    }
+}
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize a uniform allocator! "
+    #define LogUploadError() "Failed to upload uniform constants! "
+
+    // Creates the stream buffer on the render thread.
+    void CreateResources(StateCache& cache, void* argument)
+    {
+        auto state = static_cast<Detail::UniformAllocatorState*>(argument);
+
+        // Offsets of ranges are aligned for the largest alignment in use.
+        GLint alignment = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+        if(alignment <= 0 || UniformAllocator::OffsetAlignment % alignment != 0)
+        {
+            LogError() << LogInitializeError() << "Unsupported uniform buffer offset alignment of " << alignment << " bytes.";
+            return;
+        }
+
+        // Regions are fenced when the next frame is uploaded, so one more is kept in flight.
+        StreamBufferInfo streamInfo;
+        streamInfo.target = GL_UNIFORM_BUFFER;
+        streamInfo.regionSize = state->frameSize;
+        streamInfo.regionCount = UniformAllocator::FrameCount + 1;
+
+        if(!state->stream.Initialize(streamInfo))
+            return;
+
+        state->valid = true;
+    }
+
+    // Destroys the stream buffer and the state on the render thread.
+    void DestroyResources(StateCache& cache, void* argument)
+    {
+        auto state = static_cast<Detail::UniformAllocatorState*>(argument);
+
+        state->stream.Cleanup();
+
+        // Ranges of the deleted buffer may have been bound.
+        cache.Invalidate();
+
+        delete state;
+    }
+
+    // Uploads constants of a frame on the render thread.
+    void UploadFrame(StateCache& cache, void* argument)
+    {
+        auto frame = static_cast<Detail::UniformAllocatorFrame*>(argument);
+        auto state = frame->state;
+
+        frame->range = BufferRange();
+
+        if(!state->valid)
+            return;
+
+        // Fence the region of the previous frame, which all its draws have been issued from.
+        state->stream.EndFrame();
+
+        std::size_t size = frame->usedSize.load(std::memory_order_relaxed);
+
+        if(size == 0)
+            return;
+
+        std::size_t offset = 0;
+        void* data = state->stream.Map(size, UniformAllocator::OffsetAlignment, offset);
+
+        if(data == nullptr)
+        {
+            LogError() << LogUploadError() << "Couldn't map the stream buffer.";
+            return;
+        }
+
+        std::memcpy(data, frame->data.get(), size);
+        state->stream.Unmap();
+
+        frame->range.buffer = state->stream.GetHandle();
+        frame->range.offset = (GLintptr)offset;
+    }
+}
+
+UniformAllocatorInfo::UniformAllocatorInfo() :
+    renderer(nullptr),
+    frameSize(1024 * 1024)
+{
+}
+
+UniformAllocator::UniformAllocator() :
+    m_renderer(nullptr),
+    m_state(nullptr),
+    m_frameIndex(0),
+    m_initialized(false)
+{
+}
+
+UniformAllocator::~UniformAllocator()
+{
+    this->Cleanup();
+}
+
+void UniformAllocator::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Destroy the state on the render thread after frames that use it.
+    m_renderer->GetCommands().Call(&DestroyResources, m_state);
+    m_state = nullptr;
+
+    m_renderer = nullptr;
+    m_frameIndex = 0;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool UniformAllocator::Initialize(const UniformAllocatorInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.renderer == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid renderer.";
+        return false;
+    }
+
+    if(info.frameSize < MaximumBlockSize)
+    {
+        LogError() << LogInitializeError() << "Invalid frame size.";
+        return false;
+    }
+
+    m_renderer = info.renderer;
+
+    // Create the state with memory of every frame in flight.
+    // Regions stay aligned when their size is a multiple of the alignment.
+    m_state = new Detail::UniformAllocatorState();
+    m_state->frameSize = (info.frameSize + OffsetAlignment - 1) / OffsetAlignment * OffsetAlignment;
+
+    for(Detail::UniformAllocatorFrame& frame : m_state->frames)
+    {
+        frame.state = m_state;
+        frame.data.reset(new std::uint8_t[m_state->frameSize]);
+    }
+
+    // Create the stream buffer on the render thread.
+    m_renderer->GetCommands().Call(&CreateResources, m_state);
+
+    // Success!
+    return m_initialized = true;
+}
+
+void UniformAllocator::BeginFrame(CommandBuffer& commands)
+{
+    Assert(m_initialized, "Uniform allocator is not initialized!");
+
+    // The renderer is done with the frame that used this memory before.
+    m_frameIndex = (m_frameIndex + 1) % FrameCount;
+
+    Detail::UniformAllocatorFrame& frame = m_state->frames[m_frameIndex];
+    frame.usedSize.store(0, std::memory_order_relaxed);
+    frame.allocationCount.store(0, std::memory_order_relaxed);
+
+    // Upload runs before any binding of the frame is executed.
+    commands.Call(&UploadFrame, &frame);
+}
+
+void* UniformAllocator::Allocate(CommandBuffer& commands, GLuint binding, std::size_t size)
+{
+    Assert(m_initialized, "Uniform allocator is not initialized!");
+    Assert(size != 0 && size <= MaximumBlockSize, "Invalid uniform block size!");
+
+    Detail::UniformAllocatorFrame& frame = m_state->frames[m_frameIndex];
+
+    // Reserve an aligned range, which other threads may do at the same time.
+    std::size_t alignedSize = (size + OffsetAlignment - 1) / OffsetAlignment * OffsetAlignment;
+    std::size_t offset = frame.usedSize.fetch_add(alignedSize, std::memory_order_relaxed);
+
+    if(offset + alignedSize > m_state->frameSize)
+    {
+        // Keep the used size at the capacity, so it's not uploaded past it.
+        frame.usedSize.fetch_sub(alignedSize, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    frame.allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+    commands.BindUniformBufferIndirect(binding, &frame.range, (GLintptr)offset, (GLsizeiptr)size);
+
+    return frame.data.get() + offset;
+}
+
+bool UniformAllocator::Bind(CommandBuffer& commands, GLuint binding, const void* data, std::size_t size)
+{
+    Assert(data != nullptr, "Uniform constants are null!");
+
+    void* memory = this->Allocate(commands, binding, size);
+
+    if(memory == nullptr)
+        return false;
+
+    std::memcpy(memory, data, size);
+    return true;
+}
+
+std::size_t UniformAllocator::GetUsedSize() const
+{
+    Assert(m_initialized, "Uniform allocator is not initialized!");
+
+    return m_state->frames[m_frameIndex].usedSize.load(std::memory_order_relaxed);
+}
+
+int UniformAllocator::GetAllocationCount() const
+{
+    Assert(m_initialized, "Uniform allocator is not initialized!");
+
+    return m_state->frames[m_frameIndex].allocationCount.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Renderer.hpp"
+
+//
+// Uniform Allocator
+//
+//  Batches per draw constants into uniform blocks instead of setting every
+//  uniform separately, which costs a driver call per value. Constants of a
+//  frame are written linearly into a single block of memory, each at an
+//  offset aligned for uniform buffer bindings, and draws bind their range
+//  of it to a uniform block binding. Ranges are bound through the state
+//  cache, so consecutive draws with the same constants don't rebind them.
+//
+//  Memory of a frame is uploaded at once on the render thread, into a
+//  region of a stream buffer that is fenced before it is reused. Ranges
+//  are recorded relative to the uploaded memory, which is only known when
+//  the frame is executed. Allocation is lock free, so passes recorded in
+//  parallel can write their constants, and memory of a frame stays valid
+//  until the renderer is done with it.
+//
+//  Offsets are aligned to 256 bytes, which is the largest uniform buffer
+//  offset alignment that implementations report, and blocks are limited to
+//  16 KiB, which all implementations support.
+//
+//  Example usage:
+//      Graphics::UniformAllocatorInfo info;
+//      info.renderer = &renderer;
+//
+//      Graphics::UniformAllocator uniformAllocator;
+//      uniformAllocator.Initialize(info);
+//
+//      Graphics::CommandBuffer& commands = renderer.GetCommands();
+//      uniformAllocator.BeginFrame(commands);
+//
+//      DrawConstants constants;
+//      constants.transform = transform;
+//      uniformAllocator.Bind(commands, 0, constants);
+//      commands.Draw(GL_TRIANGLES, 0, 36);
+//
+//      renderer.Submit();
+//
+
+namespace Graphics
+{
+    // Implementation details.
+    namespace Detail
+    {
+        struct UniformAllocatorState;
+    }
+
+    // Uniform allocator initialization struct.
+    struct UniformAllocatorInfo
+    {
+        // Renderer that executes draws.
+        Renderer* renderer;
+
+        // Size of constants that can be allocated in a frame.
+        std::size_t frameSize;
+
+        UniformAllocatorInfo();
+    };
+
+    // Uniform allocator class.
+    class UniformAllocator : private NonCopyable
+    {
+    public:
+        // Number of frames that can be in flight.
+        static const int FrameCount = 2;
+
+        // Alignment of allocated offsets.
+        static const std::size_t OffsetAlignment = 256;
+
+        // Maximum size of a single uniform block.
+        static const std::size_t MaximumBlockSize = 16 * 1024;
+
+    public:
+        UniformAllocator();
+        ~UniformAllocator();
+
+        // Restores instance to its original state.
+        // Must be called before the renderer is cleaned up.
+        void Cleanup();
+
+        // Initializes the uniform allocator.
+        bool Initialize(const UniformAllocatorInfo& info);
+
+        // Starts constants of a new frame and records their upload.
+        // Has to be called once per submitted frame, before bindings are recorded.
+        void BeginFrame(CommandBuffer& commands);
+
+        // Allocates constants and records binding of their range to a uniform block binding.
+        // Returned memory has to be written before the frame is submitted.
+        // Returns nullptr if the frame has no space left, in which case nothing is recorded.
+        void* Allocate(CommandBuffer& commands, GLuint binding, std::size_t size);
+
+        // Copies constants and records binding of their range.
+        bool Bind(CommandBuffer& commands, GLuint binding, const void* data, std::size_t size);
+
+        // Copies a structure of constants and records binding of its range.
+        template<typename Type>
+        bool Bind(CommandBuffer& commands, GLuint binding, const Type& constants);
+
+        // Gets the number of bytes allocated in the current frame.
+        std::size_t GetUsedSize() const;
+
+        // Gets the number of allocations in the current frame.
+        int GetAllocationCount() const;
+
+    private:
+        // Renderer that executes draws.
+        Renderer* m_renderer;
+
+        // State shared with the render thread.
+        Detail::UniformAllocatorState* m_state;
+
+        // Index of the current frame.
+        int m_frameIndex;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+
+    template<typename Type>
+    bool UniformAllocator::Bind(CommandBuffer& commands, GLuint binding, const Type& constants)
+    {
+        static_assert(std::is_trivially_copyable<Type>::value, "Uniform constants have to be trivially copyable!");
+
+        return this->Bind(commands, binding, &constants, sizeof(Type));
+    }
+}
@@ -0,0 +1,52 @@
+#include "Precompiled.hpp"
+#include "Logger/BinaryLog.hpp"
+#include "Logger/Outputs/FlightRecorderOutput.hpp"
+
+int main(int argc, char* argv[])
+{
+    Build::Initialize();
+    Debug::Initialize();
+    Logger::Initialize();
+
+    // Check if a flight recording is dumped instead of a binary log.
+    bool recording = argc >= 2 && std::strcmp(argv[1], "--recording") == 0;
+
+    if(recording)
+    {
+        argc -= 1;
+        argv += 1;
+    }
+
+    // Decodes a log into a stream.
+    auto decode = [recording](const char* filename, std::ostream& output) -> bool
+    {
+        if(recording)
+            return Logger::FlightRecorderOutput::Dump(filename, output);
+
+        return Logger::BinaryLog::Decode(filename, output);
+    };
+
+    // Check command line arguments.
+    if(argc < 2)
+    {
+        std::cout << "Usage: LogDecoder [--recording] <binary log or flight recording> [text log]\n";
+        return -1;
+    }
+
+    // Decode to the console if an output file is not specified.
+    if(argc < 3)
+    {
+        return decode(argv[1], std::cout) ? 0 : -1;
+    }
+
+    // Decode to a file.
+    std::ofstream output(argv[2]);
+
+    if(!output.is_open())
+    {
+        LogError() << "Couldn't open the \"" << argv[2] << "\" file.";
+        return -1;
+    }
+
+    return decode(argv[1], output) ? 0 : -1;
+}
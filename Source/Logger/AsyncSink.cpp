@@ -0,0 +1,303 @@
+#include "Precompiled.hpp"
+#include "AsyncSink.hpp"
+#include "Message.hpp"
+#include "Common/MemoryTracker.hpp"
+using namespace Logger;
+
+namespace
+{
+    // Time after which the writer thread checks for messages without being woken up.
+    const std::chrono::milliseconds WriterInterval(10);
+
+    // Time a crash handler waits for another thread that writes messages.
+    const std::chrono::milliseconds CrashTimeout(100);
+
+    // Source of unique sink identifiers.
+    std::atomic<std::uint64_t> sinkIdentifiers(0);
+
+    // Queue of the calling thread in the last sink it has written to.
+    struct QueueCache
+    {
+        std::uint64_t sink;
+        void* queue;
+    };
+
+    thread_local QueueCache queueCache = { 0, nullptr };
+}
+
+AsyncSink::ThreadQueue::ThreadQueue(std::thread::id thread, std::size_t capacity) :
+    thread(thread),
+    records(new Record[capacity]),
+    capacity(capacity),
+    head(0),
+    tail(0)
+{
+}
+
+AsyncSink::AsyncSink() :
+    m_identifier(0),
+    m_queueCapacity(0),
+    m_writerExit(false),
+    m_initialized(false)
+{
+}
+
+AsyncSink::~AsyncSink()
+{
+    this->Cleanup();
+}
+
+void AsyncSink::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Write messages synchronously from now on.
+    m_initialized = false;
+
+    // Stop the writer thread.
+    {
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        m_writerExit = true;
+    }
+
+    m_writerCondition.notify_one();
+    m_writer.join();
+
+    // Write messages pushed while stopping.
+    this->WriteQueued(true);
+
+    // Free thread queues.
+    {
+        std::lock_guard<std::mutex> lock(m_queuesMutex);
+        m_queues.clear();
+    }
+
+    m_identifier = 0;
+    m_queueCapacity = 0;
+    m_writerExit = false;
+}
+
+bool AsyncSink::Initialize(std::size_t capacity)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(capacity == 0 || (capacity & (capacity - 1)) != 0)
+    {
+        LogError() << "Failed to initialize an async sink! Capacity must be a power of two.";
+        return false;
+    }
+
+    m_identifier = ++sinkIdentifiers;
+    m_queueCapacity = capacity;
+
+    // Start the writer thread.
+    m_writer = std::thread(&AsyncSink::RunWriter, this);
+
+    // Success!
+    m_initialized = true;
+    return true;
+}
+
+void AsyncSink::Write(const Logger::Message& message)
+{
+    // Skip messages that no output would write.
+    if(!this->IsEnabled(message.GetSeverity()))
+        return;
+
+    // Write synchronously until the writer thread runs.
+    if(!m_initialized)
+    {
+        std::lock_guard<std::timed_mutex> lock(m_drainMutex);
+        this->WriteOutputs(message);
+        this->FlushOutputs(false);
+        return;
+    }
+
+    // Write queued messages on this thread if its queue is full.
+    ThreadQueue* queue = this->GetThreadQueue();
+    std::size_t tail = queue->tail.load(std::memory_order_relaxed);
+
+    while(tail - queue->head.load(std::memory_order_acquire) >= queue->capacity)
+    {
+        this->WriteQueued(false);
+    }
+
+    // Queue a copy of the message.
+    Record& record = queue->records[tail & (queue->capacity - 1)];
+    std::memcpy(record.text, message.GetText(), message.GetLength() + 1);
+    record.source = message.GetSource();
+    record.line = message.GetLine();
+    record.severity = message.GetSeverity();
+    record.category = message.GetCategory();
+    record.time = message.GetTime();
+
+    queue->tail.store(tail + 1, std::memory_order_release);
+
+    // Wake up the writer thread.
+    m_writerCondition.notify_one();
+}
+
+void AsyncSink::Flush()
+{
+    this->WriteQueued(true);
+}
+
+std::size_t AsyncSink::GetQueuedCount()
+{
+    std::lock_guard<std::mutex> lock(m_queuesMutex);
+
+    std::size_t count = 0;
+
+    for(const auto& queue : m_queues)
+    {
+        // Read the head first, so it can't move past the tail that is read after it.
+        std::size_t head = queue->head.load(std::memory_order_acquire);
+        count += queue->tail.load(std::memory_order_acquire) - head;
+    }
+
+    return count;
+}
+
+bool AsyncSink::FlushOnCrash()
+{
+    // Crashing thread may already hold the lock, so do not wait for it forever.
+    std::unique_lock<std::timed_mutex> lock(m_drainMutex, std::defer_lock);
+
+    if(!lock.try_lock_for(CrashTimeout))
+        return false;
+
+    this->DrainQueued(true);
+    return true;
+}
+
+void AsyncSink::RunWriter()
+{
+    MemoryTracker::SetThreadTag(MemoryTags::Logger);
+
+    std::unique_lock<std::mutex> lock(m_writerMutex);
+
+    while(!m_writerExit)
+    {
+        // Write queued messages without holding the lock.
+        lock.unlock();
+        this->WriteQueued(false);
+        lock.lock();
+
+        // Wait for more messages.
+        // Wake ups can be missed, as producers do not take the lock.
+        m_writerCondition.wait_for(lock, WriterInterval);
+    }
+}
+
+AsyncSink::ThreadQueue* AsyncSink::GetThreadQueue()
+{
+    // Use the cached queue if the thread has written to this sink before.
+    if(queueCache.sink == m_identifier)
+        return static_cast<ThreadQueue*>(queueCache.queue);
+
+    std::lock_guard<std::mutex> lock(m_queuesMutex);
+
+    // Find a queue of the thread, or of a finished thread with the same identifier.
+    std::thread::id thread = std::this_thread::get_id();
+    ThreadQueue* queue = nullptr;
+
+    for(auto& threadQueue : m_queues)
+    {
+        if(threadQueue->thread == thread)
+        {
+            queue = threadQueue.get();
+            break;
+        }
+    }
+
+    // Create a queue for a new thread.
+    if(queue == nullptr)
+    {
+        m_queues.emplace_back(new ThreadQueue(thread, m_queueCapacity));
+        queue = m_queues.back().get();
+    }
+
+    queueCache.sink = m_identifier;
+    queueCache.queue = queue;
+
+    return queue;
+}
+
+void AsyncSink::WriteQueued(bool force)
+{
+    std::lock_guard<std::timed_mutex> lock(m_drainMutex);
+    this->DrainQueued(force);
+}
+
+void AsyncSink::DrainQueued(bool force)
+{
+    // Take messages pushed so far by every thread.
+    {
+        std::lock_guard<std::mutex> lock(m_queuesMutex);
+
+        m_drainQueues.clear();
+        m_drainEnds.clear();
+
+        for(auto& queue : m_queues)
+        {
+            m_drainQueues.push_back(queue.get());
+            m_drainEnds.push_back(queue->tail.load(std::memory_order_acquire));
+        }
+    }
+
+    // Merge messages from all threads in the order of their timestamps.
+    while(true)
+    {
+        ThreadQueue* next = nullptr;
+        const Record* nextRecord = nullptr;
+
+        for(std::size_t i = 0; i < m_drainQueues.size(); ++i)
+        {
+            ThreadQueue* queue = m_drainQueues[i];
+            std::size_t head = queue->head.load(std::memory_order_relaxed);
+
+            if(head == m_drainEnds[i])
+                continue;
+
+            const Record* record = &queue->records[head & (queue->capacity - 1)];
+
+            if(nextRecord == nullptr || record->time < nextRecord->time)
+            {
+                next = queue;
+                nextRecord = record;
+            }
+        }
+
+        if(next == nullptr)
+            break;
+
+        this->WriteRecord(*nextRecord);
+
+        // Free the slot for the pushing thread.
+        next->head.store(next->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Flush outputs once for the whole batch.
+    // Outputs with a flush interval are also given a chance to flush when idle.
+    this->FlushOutputs(force);
+}
+
+void AsyncSink::WriteRecord(const Record& record)
+{
+    Message message;
+    message.SetText(record.text);
+    message.SetSource(record.source);
+    message.SetSeverity(record.severity);
+    message.SetCategory(record.category);
+    message.SetTime(record.time);
+
+    if(record.line != 0)
+    {
+        message.SetLine(record.line);
+    }
+
+    this->WriteOutputs(message);
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Logger/Sink.hpp"
+#include "Logger/Message.hpp"
+
+//
+// Async Sink
+//
+//  Writes messages to multiple outputs on a background writer thread.
+//  Every thread that logs gets its own single producer queue, so pushing
+//  a copy of a message does not contend with other threads, lock, or
+//  allocate memory. The writer thread drains all queues in batches, merging
+//  messages from different threads in the order of their timestamps within
+//  each batch, and flushes outputs once per batch, instead of once per
+//  message. A thread that fills its queue writes queued messages itself.
+//  Messages are written synchronously until the sink has been initialized,
+//  and the writer thread writes remaining messages when the sink is cleaned up.
+//
+//  Example usage:
+//      Logger::AsyncSink sink;
+//      sink.AddOutput(&output);
+//      sink.Initialize();
+//
+//      Logger::ScopedMessage(&sink) << "Hello world!";
+//      sink.Flush();
+//
+
+namespace Logger
+{
+    // Async sink class.
+    class AsyncSink : public Sink
+    {
+    public:
+        AsyncSink();
+        ~AsyncSink();
+
+        // Stops the writer thread after it writes remaining messages.
+        void Cleanup();
+
+        // Starts the writer thread.
+        // Capacity of each thread's message queue must be a power of two.
+        bool Initialize(std::size_t capacity = 256);
+
+        // Queues a log message for the writer thread.
+        void Write(const Logger::Message& message);
+
+        // Writes queued messages on the calling thread and waits until they reach the outputs.
+        void Flush();
+
+        // Writes queued messages and flushes outputs from a crash handler.
+        // Gives up if another thread keeps writing messages for too long.
+        bool FlushOnCrash();
+
+        // Gets the number of messages queued for the writer thread.
+        std::size_t GetQueuedCount();
+
+    private:
+        // Queued message.
+        struct Record
+        {
+            char text[Message::MaximumLength + 1];
+            const char* source;
+            int line;
+            Severity::Type severity;
+            const char* category;
+            Message::TimePoint time;
+        };
+
+        // Queue of messages pushed by a single thread.
+        struct ThreadQueue
+        {
+            ThreadQueue(std::thread::id thread, std::size_t capacity);
+
+            // Thread that pushes messages.
+            std::thread::id thread;
+
+            // Ring of queued messages.
+            std::unique_ptr<Record[]> records;
+            std::size_t capacity;
+
+            // Positions of the writer thread and the pushing thread.
+            std::atomic<std::size_t> head;
+            std::atomic<std::size_t> tail;
+        };
+
+        // Type declarations.
+        typedef std::vector<std::unique_ptr<ThreadQueue>> QueueList;
+
+    private:
+        // Runs the writer thread.
+        void RunWriter();
+
+        // Gets the message queue of the calling thread.
+        ThreadQueue* GetThreadQueue();
+
+        // Writes queued messages to outputs.
+        void WriteQueued(bool force);
+
+        // Writes queued messages to outputs while holding the drain lock.
+        void DrainQueued(bool force);
+
+        // Writes a queued message to outputs.
+        void WriteRecord(const Record& record);
+
+    private:
+        // Unique identifier of the initialized sink, cached by threads with their queue.
+        std::uint64_t m_identifier;
+
+        // Message queues of threads.
+        QueueList m_queues;
+        std::size_t m_queueCapacity;
+        std::mutex m_queuesMutex;
+
+        // Serializes draining of the queues.
+        std::timed_mutex m_drainMutex;
+
+        // Queues and their end positions used while draining.
+        std::vector<ThreadQueue*> m_drainQueues;
+        std::vector<std::size_t> m_drainEnds;
+
+        // Writer thread state.
+        std::thread m_writer;
+        std::mutex m_writerMutex;
+        std::condition_variable m_writerCondition;
+        bool m_writerExit;
+
+        // Initialization state.
+        std::atomic<bool> m_initialized;
+    };
+}
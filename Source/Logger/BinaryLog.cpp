@@ -0,0 +1,538 @@
+#include "Precompiled.hpp"
+#include "BinaryLog.hpp"
+#include "Common/BinaryStream.hpp"
+using namespace Logger;
+using namespace Logger::BinaryLog;
+
+namespace
+{
+    // Binary log file header.
+    const char Magic[4] = { 'B', 'L', 'O', 'G' };
+    const std::uint32_t Version = 1;
+
+    // Identifier written in place of a message identifier before a format definition.
+    const std::uint32_t DefinitionIdentifier = 0;
+
+    // Buffer of messages written by a thread.
+    struct ThreadBuffer
+    {
+        ThreadBuffer() :
+            size(0),
+            capacity(0),
+            generation(0)
+        {
+        }
+
+        ~ThreadBuffer();
+
+        std::unique_ptr<std::uint8_t[]> data;
+        std::size_t size;
+        std::size_t capacity;
+
+        // Binary log file the buffered messages belong to.
+        std::uint32_t generation;
+    };
+
+    thread_local ThreadBuffer threadBuffer;
+
+    // Registered call site formats.
+    std::vector<const Format*> formats;
+
+    // Binary log file.
+    std::ofstream file;
+    std::mutex fileMutex;
+
+    // Size of newly created thread buffers.
+    std::atomic<std::size_t> threadBufferSize(0);
+
+    // Counter of opened binary log files.
+    std::atomic<std::uint32_t> generation(0);
+
+    // Writes raw bytes to the file.
+    void WriteBytes(const void* data, std::size_t size)
+    {
+        file.write(reinterpret_cast<const char*>(data), size);
+    }
+
+    // Writes a format definition to the file.
+    void WriteDefinition(const Format& format)
+    {
+        std::vector<std::uint8_t> buffer;
+        BinaryWriter writer(buffer);
+
+        auto writeString = [&writer](const char* text)
+        {
+            std::size_t length = std::min(std::strlen(text), MaximumStringLength);
+            writer.Write((std::uint16_t)length);
+            writer.WriteBytes(text, length);
+        };
+
+        writer.Write(DefinitionIdentifier);
+        writer.Write(format.GetIdentifier());
+        writer.Write((std::int32_t)format.GetLine());
+        writeString(format.GetSource());
+        writeString(format.GetText());
+        writer.Write((std::uint8_t)format.GetArgumentCount());
+        writer.WriteBytes(format.GetArgumentTypes(), format.GetArgumentCount());
+
+        WriteBytes(buffer.data(), buffer.size());
+    }
+
+    // Writes a thread buffer to the file.
+    void WriteBuffer(ThreadBuffer& buffer)
+    {
+        if(buffer.size == 0)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(fileMutex);
+
+            // Discard messages buffered for a previous file.
+            if(file.is_open() && buffer.generation == generation.load())
+            {
+                WriteBytes(buffer.data.get(), buffer.size);
+            }
+        }
+
+        buffer.size = 0;
+    }
+
+    ThreadBuffer::~ThreadBuffer()
+    {
+        WriteBuffer(*this);
+    }
+}
+
+std::atomic<bool> Detail::enabled(false);
+
+Format::Format(const char* source, int line) :
+    m_identifier(0),
+    m_text(""),
+    m_source(source != nullptr ? source : ""),
+    m_line(line),
+    m_argumentTypes(nullptr),
+    m_argumentCount(0)
+{
+}
+
+const char* Format::GetText() const
+{
+    return m_text;
+}
+
+const char* Format::GetSource() const
+{
+    return m_source;
+}
+
+int Format::GetLine() const
+{
+    return m_line;
+}
+
+const ArgumentTypes::Type* Format::GetArgumentTypes() const
+{
+    return m_argumentTypes;
+}
+
+std::size_t Format::GetArgumentCount() const
+{
+    return m_argumentCount;
+}
+
+bool BinaryLog::Initialize(std::string filename, std::size_t bufferSize)
+{
+    // Cleanup the previous file.
+    BinaryLog::Cleanup();
+
+    // Validate arguments.
+    if(bufferSize < sizeof(std::uint32_t) + sizeof(std::int64_t))
+    {
+        LogError() << "Failed to initialize the binary log! Invalid buffer size.";
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(fileMutex);
+
+    // Open the file.
+    file.open(filename, std::ios::binary | std::ios::trunc);
+
+    if(!file.is_open())
+    {
+        LogError() << "Failed to initialize the binary log! Couldn't open the \"" << filename << "\" file.";
+        return false;
+    }
+
+    // Write the header with the period of a tick,
+    // so the decoder can convert timestamps to seconds.
+    std::vector<std::uint8_t> header;
+    BinaryWriter writer(header);
+
+    writer.WriteBytes(Magic, sizeof(Magic));
+    writer.Write(Version);
+    writer.Write((std::int64_t)1);
+    writer.Write((std::int64_t)std::llround(System::Clock::GetTickFrequency()));
+
+    WriteBytes(header.data(), header.size());
+
+    // Write definitions of formats registered for previous files.
+    for(const Format* format : formats)
+    {
+        WriteDefinition(*format);
+    }
+
+    // Start recording.
+    threadBufferSize = bufferSize;
+    ++generation;
+
+    Detail::enabled = true;
+
+    return true;
+}
+
+void BinaryLog::Cleanup()
+{
+    // Stop recording.
+    Detail::enabled = false;
+
+    // Write buffered messages of the calling thread.
+    WriteBuffer(threadBuffer);
+
+    // Close the file.
+    std::lock_guard<std::mutex> lock(fileMutex);
+
+    if(file.is_open())
+    {
+        file.close();
+    }
+}
+
+void BinaryLog::Flush()
+{
+    WriteBuffer(threadBuffer);
+
+    std::lock_guard<std::mutex> lock(fileMutex);
+
+    if(file.is_open())
+    {
+        file.flush();
+    }
+}
+
+std::uint32_t BinaryLog::Register(Format& format, const char* text, const ArgumentTypes::Type* types, std::size_t count)
+{
+    Assert(text != nullptr, "Binary log format text is nullptr!");
+    Assert(count <= std::numeric_limits<std::uint8_t>::max(), "Too many binary log format arguments!");
+
+    std::lock_guard<std::mutex> lock(fileMutex);
+
+    // Check if another thread has registered the format.
+    std::uint32_t identifier = format.GetIdentifier();
+
+    if(identifier != 0)
+        return identifier;
+
+    // Register the format.
+    identifier = (std::uint32_t)formats.size() + 1;
+
+    format.m_text = text;
+    format.m_argumentTypes = types;
+    format.m_argumentCount = count;
+    format.m_identifier.store(identifier, std::memory_order_release);
+
+    formats.push_back(&format);
+
+    // Write the definition before any message that uses it.
+    if(file.is_open())
+    {
+        WriteDefinition(format);
+    }
+
+    return identifier;
+}
+
+std::uint8_t* Detail::Reserve(std::size_t size)
+{
+    ThreadBuffer& buffer = threadBuffer;
+
+    // Discard messages buffered for a previous file.
+    std::uint32_t currentGeneration = generation.load(std::memory_order_relaxed);
+
+    if(buffer.generation != currentGeneration)
+    {
+        buffer.size = 0;
+        buffer.generation = currentGeneration;
+    }
+
+    // Allocate the buffer on the first write.
+    if(buffer.data == nullptr)
+    {
+        buffer.capacity = threadBufferSize.load();
+        buffer.data.reset(new std::uint8_t[buffer.capacity]);
+    }
+
+    // Write the buffer if the message does not fit.
+    if(buffer.size + size > buffer.capacity)
+    {
+        WriteBuffer(buffer);
+
+        if(size > buffer.capacity)
+        {
+            Assert(false, "Binary log message does not fit in the thread buffer!");
+            return nullptr;
+        }
+    }
+
+    std::uint8_t* data = buffer.data.get() + buffer.size;
+    buffer.size += size;
+
+    return data;
+}
+
+bool BinaryLog::Decode(std::string filename, std::ostream& output)
+{
+    // Read the file.
+    std::ifstream input(filename, std::ios::binary);
+
+    if(!input.is_open())
+    {
+        LogError() << "Failed to decode the binary log! Couldn't open the \"" << filename << "\" file.";
+        return false;
+    }
+
+    std::vector<char> contents((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    BinaryReader reader(contents.data(), contents.size());
+
+    // Read the header.
+    std::uint32_t version = 0;
+    std::int64_t periodNum = 0;
+    std::int64_t periodDen = 0;
+
+    const void* magic = reader.ReadBytes(sizeof(Magic));
+    reader.Read(version);
+    reader.Read(periodNum);
+    reader.Read(periodDen);
+
+    if(!reader.IsValid() || std::memcmp(magic, Magic, sizeof(Magic)) != 0 || version != Version || periodNum <= 0 || periodDen <= 0)
+    {
+        LogError() << "Failed to decode the binary log! Invalid file format.";
+        return false;
+    }
+
+    // Format definitions read from the file.
+    struct Definition
+    {
+        std::string text;
+        std::string source;
+        int line;
+        std::vector<ArgumentTypes::Type> types;
+    };
+
+    std::vector<Definition> definitions;
+
+    auto readString = [&reader](std::string& text)
+    {
+        std::uint16_t length = 0;
+        reader.Read(length);
+
+        const void* bytes = reader.ReadBytes(length);
+        text.assign(bytes != nullptr ? reinterpret_cast<const char*>(bytes) : "", bytes != nullptr ? length : 0);
+    };
+
+    // Decode records.
+    bool timeStarted = false;
+    std::int64_t timeStart = 0;
+
+    std::string argument;
+    char formatted[64];
+
+    while(reader.IsValid() && !reader.IsEnd())
+    {
+        std::uint32_t identifier = 0;
+        reader.Read(identifier);
+
+        // Read a format definition.
+        if(identifier == DefinitionIdentifier)
+        {
+            std::uint32_t formatIdentifier = 0;
+            std::int32_t line = 0;
+            std::uint8_t count = 0;
+
+            Definition definition;
+            reader.Read(formatIdentifier);
+            reader.Read(line);
+            readString(definition.source);
+            readString(definition.text);
+            reader.Read(count);
+
+            definition.line = line;
+            definition.types.resize(count);
+
+            for(auto& type : definition.types)
+            {
+                reader.Read(type);
+            }
+
+            if(formatIdentifier == 0)
+            {
+                LogError() << "Failed to decode the binary log! Invalid format identifier.";
+                return false;
+            }
+
+            if(definitions.size() < formatIdentifier)
+            {
+                definitions.resize(formatIdentifier);
+            }
+
+            definitions[formatIdentifier - 1] = std::move(definition);
+            continue;
+        }
+
+        // Read a message.
+        if(identifier > definitions.size())
+        {
+            LogError() << "Failed to decode the binary log! Unknown format identifier.";
+            return false;
+        }
+
+        const Definition& definition = definitions[identifier - 1];
+
+        std::int64_t timestamp = 0;
+        reader.Read(timestamp);
+
+        if(!timeStarted)
+        {
+            timeStart = timestamp;
+            timeStarted = true;
+        }
+
+        // Write message prefix with seconds since the first message.
+        double seconds = (double)(timestamp - timeStart) * periodNum / periodDen;
+        std::snprintf(formatted, sizeof(formatted), "[%.6f] ", seconds);
+        output << formatted;
+
+        // Write message text with placeholders replaced by arguments.
+        const char* text = definition.text.c_str();
+
+        for(ArgumentTypes::Type type : definition.types)
+        {
+            argument.clear();
+
+            switch(type)
+            {
+            case ArgumentTypes::Int32:
+                {
+                    std::int32_t value = 0;
+                    reader.Read(value);
+                    argument = std::to_string(value);
+                }
+                break;
+
+            case ArgumentTypes::UInt32:
+                {
+                    std::uint32_t value = 0;
+                    reader.Read(value);
+                    argument = std::to_string(value);
+                }
+                break;
+
+            case ArgumentTypes::Int64:
+                {
+                    std::int64_t value = 0;
+                    reader.Read(value);
+                    argument = std::to_string(value);
+                }
+                break;
+
+            case ArgumentTypes::UInt64:
+                {
+                    std::uint64_t value = 0;
+                    reader.Read(value);
+                    argument = std::to_string(value);
+                }
+                break;
+
+            case ArgumentTypes::Float:
+                {
+                    float value = 0.0f;
+                    reader.Read(value);
+                    std::snprintf(formatted, sizeof(formatted), "%g", value);
+                    argument = formatted;
+                }
+                break;
+
+            case ArgumentTypes::Double:
+                {
+                    double value = 0.0;
+                    reader.Read(value);
+                    std::snprintf(formatted, sizeof(formatted), "%g", value);
+                    argument = formatted;
+                }
+                break;
+
+            case ArgumentTypes::Bool:
+                {
+                    std::uint8_t value = 0;
+                    reader.Read(value);
+                    argument = value != 0 ? "true" : "false";
+                }
+                break;
+
+            case ArgumentTypes::Char:
+                {
+                    char value = 0;
+                    reader.Read(value);
+                    argument.assign(1, value);
+                }
+                break;
+
+            case ArgumentTypes::String:
+                readString(argument);
+                break;
+
+            case ArgumentTypes::Pointer:
+                {
+                    std::uint64_t value = 0;
+                    reader.Read(value);
+                    std::snprintf(formatted, sizeof(formatted), "0x%016llx", (unsigned long long)value);
+                    argument = formatted;
+                }
+                break;
+
+            default:
+                LogError() << "Failed to decode the binary log! Unknown argument type.";
+                return false;
+            }
+
+            // Replace the next placeholder.
+            const char* placeholder = std::strstr(text, "{}");
+
+            if(placeholder == nullptr)
+                continue;
+
+            output.write(text, placeholder - text);
+            output << argument;
+
+            text = placeholder + 2;
+        }
+
+        output << text;
+
+        // Write message source.
+        if(!definition.source.empty())
+        {
+            output << " {" << definition.source << ":" << definition.line << "}";
+        }
+
+        output << "\n";
+    }
+
+    if(!reader.IsValid())
+    {
+        LogError() << "Failed to decode the binary log! Data is truncated.";
+        return false;
+    }
+
+    return true;
+}
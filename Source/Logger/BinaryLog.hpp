@@ -0,0 +1,330 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "System/Clock.hpp"
+
+//
+// Binary Log
+//
+//  Records high rate diagnostics, such as per entity traces, in a compact
+//  binary form. Every call site registers its format string once and then
+//  only writes the format identifier, a timestamp and raw argument values
+//  into a buffer of the calling thread. Formatting is deferred to an offline
+//  decoder that renders the log as text, so writing a message does not lock,
+//  allocate or format anything.
+//
+//  Placeholders in format strings are replaced with arguments in order.
+//  Supported arguments are integers, enums, floating point numbers, bools,
+//  characters, strings and pointers. Format strings must be literals.
+//
+//  Threads write their buffers to the file when they are full, when they
+//  call Flush() and when they exit. Messages still buffered by other threads
+//  are lost when the binary log is cleaned up.
+//
+//  Example usage:
+//      Logger::BinaryLog::Initialize("Log.bin");
+//      LogBinary("Entity {} moved to ({}, {}).", handle.GetIdentifier(), x, y);
+//      Logger::BinaryLog::Cleanup();
+//
+//      Logger::BinaryLog::Decode("Log.bin", std::cout);
+//
+
+namespace Logger
+{
+    namespace BinaryLog
+    {
+        // Types of recorded arguments.
+        struct ArgumentTypes
+        {
+            typedef std::uint8_t Type;
+
+            enum Argument : Type
+            {
+                None,
+                Int32,
+                UInt32,
+                Int64,
+                UInt64,
+                Float,
+                Double,
+                Bool,
+                Char,
+                String,
+                Pointer,
+            };
+        };
+
+        // Maximum length of a recorded string argument.
+        const std::size_t MaximumStringLength = 1024;
+
+        // Call site format, registered on the first write.
+        class Format : private NonCopyable
+        {
+        public:
+            Format(const char* source, int line);
+
+            // Gets the format identifier, or zero if not registered yet.
+            std::uint32_t GetIdentifier() const
+            {
+                return m_identifier.load(std::memory_order_acquire);
+            }
+
+            // Gets the format text.
+            const char* GetText() const;
+
+            // Gets the format source.
+            const char* GetSource() const;
+
+            // Gets the format line.
+            int GetLine() const;
+
+            // Gets the types of format arguments.
+            const ArgumentTypes::Type* GetArgumentTypes() const;
+
+            // Gets the number of format arguments.
+            std::size_t GetArgumentCount() const;
+
+        private:
+            friend std::uint32_t Register(Format&, const char*, const ArgumentTypes::Type*, std::size_t);
+
+            // Format identifier.
+            std::atomic<std::uint32_t> m_identifier;
+
+            // Format definition.
+            const char* m_text;
+            const char* m_source;
+            int m_line;
+
+            const ArgumentTypes::Type* m_argumentTypes;
+            std::size_t m_argumentCount;
+        };
+
+        // Opens a binary log file and starts recording.
+        // Size of thread buffers applies to threads that have not written anything yet.
+        bool Initialize(std::string filename, std::size_t bufferSize = 64 * 1024);
+
+        // Writes the calling thread's buffer and closes the binary log file.
+        void Cleanup();
+
+        // Writes the calling thread's buffer to the binary log file.
+        void Flush();
+
+        // Registers a call site format and writes its definition.
+        // Returns an existing identifier if the format has been registered already.
+        std::uint32_t Register(Format& format, const char* text, const ArgumentTypes::Type* types, std::size_t count);
+
+        // Decodes a binary log file into text.
+        bool Decode(std::string filename, std::ostream& output);
+
+        // Implementation details.
+        namespace Detail
+        {
+            // Recording state.
+            extern std::atomic<bool> enabled;
+
+            // Reserves space for a message in the calling thread's buffer.
+            // Returns nullptr if the message does not fit into an empty buffer.
+            std::uint8_t* Reserve(std::size_t size);
+
+            // Gets the current timestamp in processor ticks.
+            inline std::int64_t GetTimestamp()
+            {
+                return (std::int64_t)System::Clock::ReadTicks();
+            }
+
+            // Writes a value of fixed size.
+            template<typename Type>
+            std::uint8_t* EncodeValue(std::uint8_t* data, Type value)
+            {
+                std::memcpy(data, &value, sizeof(Type));
+                return data + sizeof(Type);
+            }
+
+            // Traits of arguments with fixed size encoding.
+            template<typename EncodedType, ArgumentTypes::Argument Argument>
+            struct FixedArgument
+            {
+                static const ArgumentTypes::Type Value = Argument;
+
+                template<typename Type>
+                static std::size_t GetSize(const Type& value)
+                {
+                    return sizeof(EncodedType);
+                }
+
+                template<typename Type>
+                static std::uint8_t* Encode(std::uint8_t* data, const Type& value)
+                {
+                    return EncodeValue(data, (EncodedType)value);
+                }
+            };
+
+            // Traits of string arguments.
+            struct StringArgument
+            {
+                static const ArgumentTypes::Type Value = ArgumentTypes::String;
+
+                static std::size_t GetLength(const char* text)
+                {
+                    return text != nullptr ? std::min(std::strlen(text), MaximumStringLength) : 0;
+                }
+
+                static std::size_t GetSize(const char* text)
+                {
+                    return sizeof(std::uint16_t) + GetLength(text);
+                }
+
+                static std::size_t GetSize(const std::string& text)
+                {
+                    return sizeof(std::uint16_t) + std::min(text.size(), MaximumStringLength);
+                }
+
+                static std::uint8_t* Encode(std::uint8_t* data, const char* text)
+                {
+                    std::size_t length = GetLength(text);
+                    data = EncodeValue(data, (std::uint16_t)length);
+                    std::memcpy(data, text, length);
+                    return data + length;
+                }
+
+                static std::uint8_t* Encode(std::uint8_t* data, const std::string& text)
+                {
+                    std::size_t length = std::min(text.size(), MaximumStringLength);
+                    data = EncodeValue(data, (std::uint16_t)length);
+                    std::memcpy(data, text.data(), length);
+                    return data + length;
+                }
+            };
+
+            // Traits of pointer arguments.
+            struct PointerArgument
+            {
+                static const ArgumentTypes::Type Value = ArgumentTypes::Pointer;
+
+                static std::size_t GetSize(const void* pointer)
+                {
+                    return sizeof(std::uint64_t);
+                }
+
+                static std::uint8_t* Encode(std::uint8_t* data, const void* pointer)
+                {
+                    return EncodeValue(data, (std::uint64_t)reinterpret_cast<std::uintptr_t>(pointer));
+                }
+            };
+
+            // Selects traits of an argument type.
+            template<typename Type, typename Enable = void>
+            struct ArgumentTraits;
+
+            template<typename Type>
+            struct ArgumentTraits<Type, typename std::enable_if<std::is_integral<Type>::value && std::is_signed<Type>::value && !std::is_same<Type, char>::value>::type> :
+                public std::conditional<sizeof(Type) <= sizeof(std::int32_t), FixedArgument<std::int32_t, ArgumentTypes::Int32>, FixedArgument<std::int64_t, ArgumentTypes::Int64>>::type
+            {
+            };
+
+            template<typename Type>
+            struct ArgumentTraits<Type, typename std::enable_if<std::is_integral<Type>::value && std::is_unsigned<Type>::value && !std::is_same<Type, bool>::value && !std::is_same<Type, char>::value>::type> :
+                public std::conditional<sizeof(Type) <= sizeof(std::uint32_t), FixedArgument<std::uint32_t, ArgumentTypes::UInt32>, FixedArgument<std::uint64_t, ArgumentTypes::UInt64>>::type
+            {
+            };
+
+            template<typename Type>
+            struct ArgumentTraits<Type, typename std::enable_if<std::is_enum<Type>::value>::type> :
+                public FixedArgument<std::int64_t, ArgumentTypes::Int64>
+            {
+            };
+
+            template<> struct ArgumentTraits<bool> : public FixedArgument<std::uint8_t, ArgumentTypes::Bool> {};
+            template<> struct ArgumentTraits<char> : public FixedArgument<char, ArgumentTypes::Char> {};
+            template<> struct ArgumentTraits<float> : public FixedArgument<float, ArgumentTypes::Float> {};
+            template<> struct ArgumentTraits<double> : public FixedArgument<double, ArgumentTypes::Double> {};
+            template<> struct ArgumentTraits<const char*> : public StringArgument {};
+            template<> struct ArgumentTraits<char*> : public StringArgument {};
+            template<> struct ArgumentTraits<std::string> : public StringArgument {};
+
+            template<typename Type>
+            struct ArgumentTraits<Type*, typename std::enable_if<!std::is_same<typename std::remove_cv<Type>::type, char>::value>::type> :
+                public PointerArgument
+            {
+            };
+
+            // Calculates the encoded size of arguments.
+            inline std::size_t GetArgumentsSize()
+            {
+                return 0;
+            }
+
+            template<typename Type, typename... Arguments>
+            std::size_t GetArgumentsSize(const Type& argument, const Arguments&... arguments)
+            {
+                return ArgumentTraits<typename std::decay<Type>::type>::GetSize(argument) + GetArgumentsSize(arguments...);
+            }
+
+            // Encodes arguments.
+            inline std::uint8_t* EncodeArguments(std::uint8_t* data)
+            {
+                return data;
+            }
+
+            template<typename Type, typename... Arguments>
+            std::uint8_t* EncodeArguments(std::uint8_t* data, const Type& argument, const Arguments&... arguments)
+            {
+                data = ArgumentTraits<typename std::decay<Type>::type>::Encode(data, argument);
+                return EncodeArguments(data, arguments...);
+            }
+        }
+
+        // Checks if the binary log is recording.
+        inline bool IsEnabled()
+        {
+            return Detail::enabled.load(std::memory_order_relaxed);
+        }
+
+        // Writes a message of a call site format.
+        template<typename... Arguments>
+        void Write(Format& format, const char* text, const Arguments&... arguments)
+        {
+            // Register the format on the first write.
+            std::uint32_t identifier = format.GetIdentifier();
+
+            if(identifier == 0)
+            {
+                static const ArgumentTypes::Type types[] =
+                {
+                    Detail::ArgumentTraits<typename std::decay<Arguments>::type>::Value...,
+                    ArgumentTypes::None
+                };
+
+                identifier = Register(format, text, types, sizeof...(Arguments));
+            }
+
+            // Write the message into the thread buffer.
+            std::size_t size = sizeof(std::uint32_t) + sizeof(std::int64_t) + Detail::GetArgumentsSize(arguments...);
+            std::uint8_t* data = Detail::Reserve(size);
+
+            if(data == nullptr)
+                return;
+
+            data = Detail::EncodeValue(data, identifier);
+            data = Detail::EncodeValue(data, Detail::GetTimestamp());
+            Detail::EncodeArguments(data, arguments...);
+        }
+    }
+}
+
+//
+// Macros
+//
+
+// Writes a binary log message with a format string literal and arguments.
+// Arguments are not evaluated if the binary log is not recording.
+#define LogBinary(...) \
+    do \
+    { \
+        if(Logger::BinaryLog::IsEnabled()) \
+        { \
+            static Logger::BinaryLog::Format logBinaryFormat(LOG_SOURCE(), __LINE__); \
+            Logger::BinaryLog::Write(logBinaryFormat, __VA_ARGS__); \
+        } \
+    } \
+    while(false)
@@ -0,0 +1,68 @@
+#include "Precompiled.hpp"
+#include "FormattedMessage.hpp"
+using namespace Logger;
+
+FormattedMessage::FormattedMessage() :
+    m_length(0),
+    m_severity(Severity::Info)
+{
+    m_line[0] = '\0';
+}
+
+void FormattedMessage::Format(const Logger::Message& message, Logger::Timestamp& timestamp)
+{
+    m_length = 0;
+    m_severity = message.GetSeverity();
+
+    auto append = [this](int written)
+    {
+        if(written > 0)
+        {
+            m_length = std::min(m_length + (std::size_t)written, sizeof(m_line) - 1);
+        }
+    };
+
+    // Write message prefix, severity and category.
+    const char* category = message.GetCategory();
+
+    append(std::snprintf(m_line + m_length, sizeof(m_line) - m_length, "%s %s: %s%s",
+        timestamp.Format(message.GetTime()), Severity::GetName(message.GetSeverity()),
+        category, category[0] != '\0' ? ": " : ""));
+
+    // Write message text.
+    append(std::snprintf(m_line + m_length, sizeof(m_line) - m_length, "%s", message.GetText()));
+
+    // Write message source.
+    if(message.GetSource()[0] != '\0')
+    {
+        if(message.GetLine() != 0)
+        {
+            append(std::snprintf(m_line + m_length, sizeof(m_line) - m_length, " {%s:%d}", message.GetSource(), message.GetLine()));
+        }
+        else
+        {
+            append(std::snprintf(m_line + m_length, sizeof(m_line) - m_length, " {%s}", message.GetSource()));
+        }
+    }
+
+    // Write message suffix.
+    // Keep room for it even if the line was truncated.
+    m_length = std::min(m_length, sizeof(m_line) - 2);
+    m_line[m_length++] = '\n';
+    m_line[m_length] = '\0';
+}
+
+StringView FormattedMessage::GetLine() const
+{
+    return StringView(m_line, m_length);
+}
+
+const char* FormattedMessage::GetText() const
+{
+    return m_line;
+}
+
+Severity::Type FormattedMessage::GetSeverity() const
+{
+    return m_severity;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Logger/Message.hpp"
+#include "Logger/Timestamp.hpp"
+
+//
+// Formatted Message
+//
+//  Message rendered once into a line of text, which a sink hands to all of
+//  its outputs instead of each output formatting the same line again. The
+//  line has the form "[HH:MM:SS] Severity: Category: Text {Source:Line}"
+//  and ends with a new line character. It is kept in a fixed buffer, so
+//  formatting does not allocate memory, and is valid as long as the record.
+//
+//  Example usage:
+//      Logger::FormattedMessage formatted;
+//      formatted.Format(message, timestamp);
+//
+//      std::cout << formatted.GetLine();
+//
+
+namespace Logger
+{
+    // Formatted message class.
+    class FormattedMessage : private NonCopyable
+    {
+    public:
+        // Maximum length of a formatted line.
+        static const std::size_t MaximumLength = Message::MaximumLength + 512;
+
+    public:
+        FormattedMessage();
+
+        // Renders a message into a line.
+        void Format(const Logger::Message& message, Logger::Timestamp& timestamp);
+
+        // Gets the rendered line, including the new line character.
+        StringView GetLine() const;
+
+        // Gets the rendered line as a null terminated string.
+        const char* GetText() const;
+
+        // Gets the severity of the message.
+        Severity::Type GetSeverity() const;
+
+    private:
+        // Rendered line.
+        char m_line[MaximumLength + 1];
+        std::size_t m_length;
+
+        // Severity of the message.
+        Severity::Type m_severity;
+    };
+}
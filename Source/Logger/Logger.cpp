@@ -1,23 +1,47 @@
 #include "Precompiled.hpp"
 #include "Logger.hpp"
 #include "Sink.hpp"
+#include "AsyncSink.hpp"
 
 #include "Outputs/DebuggerOutput.hpp"
 #include "Outputs/ConsoleOutput.hpp"
 #include "Outputs/FileOutput.hpp"
+#include "Outputs/FlightRecorderOutput.hpp"
 
 namespace
 {
-    // Logger sink.
-    Logger::Sink sink;
-
     // Logger outputs.
     Logger::DebuggerOutput debuggerOutput;
     Logger::ConsoleOutput consoleOutput;
     Logger::FileOutput fileOutput;
+    Logger::FlightRecorderOutput flightRecorderOutput;
+
+    // Logger sink.
+    // Declared after outputs, so it writes remaining messages before they are destroyed.
+    Logger::AsyncSink sink;
 
     // Initialization state.
     bool initialized = false;
+
+    // Signals that are handled as crashes.
+    const int CrashSignals[] = { SIGSEGV, SIGILL, SIGFPE, SIGABRT };
+
+    // Writes remaining messages when the application crashes.
+    void CrashHandler(int signal)
+    {
+        sink.FlushOnCrash();
+
+        // Let the default handler terminate the application.
+        std::signal(signal, SIG_DFL);
+        std::raise(signal);
+    }
+
+    // Writes remaining messages on an unhandled exception.
+    void TerminateHandler()
+    {
+        sink.FlushOnCrash();
+        std::abort();
+    }
 }
 
 void Logger::Initialize()
@@ -32,20 +56,59 @@ void Logger::Initialize()
     sink.AddOutput(&consoleOutput);
 
     // Add the file output.
-    if(fileOutput.Initialize("Log.txt"))
+    Logger::FileOutputInfo fileOutputInfo;
+    fileOutputInfo.filename = "Log.txt";
+
+    if(fileOutput.Initialize(fileOutputInfo))
     {
         sink.AddOutput(&fileOutput);
     }
 
+    // Start writing messages on a background thread.
+    sink.Initialize();
+
+    // Write remaining messages if the application crashes.
+    for(int signal : CrashSignals)
+    {
+        std::signal(signal, &CrashHandler);
+    }
+
+    std::set_terminate(&TerminateHandler);
+
     // Set initialized state.
     initialized = true;
 }
 
+void Logger::SetPreciseTimestamps(bool precise)
+{
+    sink.SetPreciseTimestamps(precise);
+}
+
+bool Logger::StartFlightRecorder(const std::string& filename, std::size_t size)
+{
+    Logger::FlightRecorderOutputInfo info;
+    info.filename = filename;
+    info.previousFilename = filename + ".previous";
+    info.size = size;
+
+    if(!flightRecorderOutput.Initialize(info))
+        return false;
+
+    sink.AddOutput(&flightRecorderOutput);
+
+    return true;
+}
+
 void Logger::Write(const Logger::Message& message)
 {
     sink.Write(message);
 }
 
+std::size_t Logger::GetBacklog()
+{
+    return sink.GetQueuedCount();
+}
+
 Logger::Sink* Logger::GetGlobal()
 {
     return &sink;
@@ -3,15 +3,26 @@
 #include "Precompiled.hpp"
 #include "Logger/Message.hpp"
 #include "Logger/Sink.hpp"
+#include "Logger/RateLimit.hpp"
 
 //
 // Logger
 //
 //  Writes log messages to multiple outputs for debugging purposes.
+//  Messages are written by a background thread once the logger is initialized.
+//  Remaining messages are written and flushed if the application crashes.
+//
+//  Messages have a severity and an optional category. Severities below
+//  LOG_MINIMUM_SEVERITY are compiled out, while the runtime minimum severity
+//  of outputs is checked before a message is formatted, so a disabled
+//  message costs a single branch.
 //
 //  Example usage:
 //      Logger::Initialize();
 //      Log() << "Hello world!";
+//      LogWarning() << "Something went wrong.";
+//      LogCategory(Logger::Severity::Trace, "Renderer") << "Drawing " << count << " sprites.";
+//      LogLimited(Logger::Severity::Warning, 10) << "Entity " << identifier << " is invalid.";
 //
 
 namespace Logger
@@ -22,8 +33,18 @@ namespace Logger
     // Initializes the logger.
     void Initialize();
 
+    // Enables or disables timestamps with microsecond resolution in all outputs.
+    void SetPreciseTimestamps(bool precise);
+
+    // Records recent messages in a memory mapped ring file that survives crashes.
+    // A recording of a previous run is kept with a ".previous" suffix.
+    bool StartFlightRecorder(const std::string& filename, std::size_t size);
+
     // Writes to the global logger sink.
     void Write(const Logger::Message& message);
+
+    // Gets the number of messages waiting to be written by the global logger sink.
+    std::size_t GetBacklog();
     
     // Gets the global logger sink.
     Sink* GetGlobal();
@@ -33,8 +54,50 @@ namespace Logger
 // Macros
 //
 
+// Gets the source path of the call site, trimmed once on the first call.
+#define LOG_SOURCE() ([]() -> const char* { static const Logger::Source source(__FILE__); return source.GetPath(); }())
+
+// Minimum severity of messages that are compiled in.
+#ifndef LOG_MINIMUM_SEVERITY
+    #ifndef NDEBUG
+        #define LOG_MINIMUM_SEVERITY LOG_SEVERITY_TRACE
+    #else
+        #define LOG_MINIMUM_SEVERITY LOG_SEVERITY_INFO
+    #endif
+#endif
+
+// Writes a message of a severity and a category.
+// Message arguments are not evaluated if the message is disabled.
 #ifndef NDEBUG
-    #define Log() Logger::ScopedMessage(Logger::GetGlobal()).SetSource(__FILE__).SetLine(__LINE__)
+    #define LOG_SCOPED_MESSAGE() Logger::ScopedMessage(Logger::GetGlobal()).SetSource(LOG_SOURCE()).SetLine(__LINE__)
 #else
-    #define Log() Logger::ScopedMessage(Logger::GetGlobal())
+    #define LOG_SCOPED_MESSAGE() Logger::ScopedMessage(Logger::GetGlobal())
 #endif
+
+#define LogCategory(severity, category) \
+    if((severity) < LOG_MINIMUM_SEVERITY || !Logger::GetGlobal()->IsEnabled(severity)) {} else \
+    LOG_SCOPED_MESSAGE().SetSeverity(severity).SetCategory(category)
+
+// Writes a message of a severity.
+#define LogTrace() LogCategory(Logger::Severity::Trace, nullptr)
+#define LogDebug() LogCategory(Logger::Severity::Debug, nullptr)
+#define LogInfo() LogCategory(Logger::Severity::Info, nullptr)
+#define LogWarning() LogCategory(Logger::Severity::Warning, nullptr)
+#define LogError() LogCategory(Logger::Severity::Error, nullptr)
+
+// Writes an info message.
+#define Log() LogInfo()
+
+// Gets the rate limit of the call site, created on the first call.
+#define LOG_RATE_LIMIT(limit) ([]() -> Logger::RateLimit& { static Logger::RateLimit rateLimit(limit); return rateLimit; }())
+
+// Writes a message of a severity and a category at most a number of times per second.
+// Limit must be a constant expression.
+// Suppressed messages are counted and reported by the next written message.
+#define LogCategoryLimited(severity, category, limit) \
+    if((severity) < LOG_MINIMUM_SEVERITY || !Logger::GetGlobal()->IsEnabled(severity)) {} else \
+    for(Logger::RateLimit::Permit logPermit = LOG_RATE_LIMIT(limit).Acquire(); logPermit.IsAllowed(); logPermit.Release()) \
+    LOG_SCOPED_MESSAGE().SetSeverity(severity).SetCategory(category) << logPermit
+
+// Writes a message of a severity at most a number of times per second.
+#define LogLimited(severity, limit) LogCategoryLimited(severity, nullptr, limit)
@@ -4,20 +4,32 @@
 using namespace Logger;
 
 Message::Message() :
-    std::ostream(&m_text),
-    m_source(),
-    m_line(0)
+    m_length(0),
+    m_source(""),
+    m_line(0),
+    m_severity(Severity::Info),
+    m_category(""),
+    m_time(System::Clock::now())
 {
+    m_text[0] = '\0';
 }
 
 Message::Message(Message&& other) :
-    std::ostream(&m_text)
+    m_length(other.m_length),
+    m_source(other.m_source),
+    m_line(other.m_line),
+    m_severity(other.m_severity),
+    m_category(other.m_category),
+    m_time(other.m_time)
 {
-    m_text = std::move(other.m_text);
-    m_source = std::move(other.m_source);
+    std::memcpy(m_text, other.m_text, m_length + 1);
 
-    m_line = other.m_line;
+    other.m_text[0] = '\0';
+    other.m_length = 0;
+    other.m_source = "";
     other.m_line = 0;
+    other.m_severity = Severity::Info;
+    other.m_category = "";
 }
 
 Message::~Message()
@@ -26,13 +38,12 @@ Message::~Message()
 
 Message& Message::SetText(const char* text)
 {
+    m_text[0] = '\0';
+    m_length = 0;
+
     if(text != nullptr)
     {
-        m_text.str(text);
-    }
-    else
-    {
-        m_text.str("");
+        this->Append(text, std::strlen(text));
     }
 
     return *this;
@@ -40,63 +51,130 @@ Message& Message::SetText(const char* text)
 
 Message& Message::SetSource(const char* source)
 {
-    // Store constant string before processing it.
-    m_source = source;
+    m_source = source != nullptr ? source : "";
+    return *this;
+}
 
-    // Truncate the source file path.
-    if(!m_source.empty())
-    {
-        // Normalize source path separators.
-        std::replace(m_source.begin(), m_source.end(), '\\', '/');
+Message& Message::SetLine(int line)
+{
+    Assert(line > 0, "Attempted to set an invalid source line!");
 
-        // Get the source directory path.
-        std::string sourceDir = Build::GetSourceDir();
+    m_line = line;
+    return *this;
+}
 
-        if(sourceDir.empty())
-        {
-            // Workaround in case source directory isn't specified.
-            sourceDir = "Source/";
-        }
+Message& Message::SetSeverity(Severity::Type severity)
+{
+    Assert(severity >= Severity::Trace && severity < Severity::Count, "Attempted to set an invalid severity!");
 
-        // Remove base path to source directory.
-        auto it = std::search(m_source.begin(), m_source.end(), sourceDir.begin(), sourceDir.end(),
-            [](char a, char b)
-            {
-                // Ignore character case.
-                return std::toupper(a) == std::toupper(b);
-            }
-        );
+    m_severity = severity;
+    return *this;
+}
 
-        if(it != m_source.end())
-        {
-            m_source.erase(m_source.begin(), it + sourceDir.size());
-        }
+Message& Message::SetCategory(const char* category)
+{
+    m_category = category != nullptr ? category : "";
+    return *this;
+}
 
-        // Workaround for the first letter being lower case on Visual C++ compiler.
-        // Happenes whenever __FILE__ macro is used inside an inlined function.
-        if(!m_source.empty())
-        {
-            m_source[0] = std::toupper(m_source[0]);
-        }
+Message& Message::SetTime(TimePoint time)
+{
+    m_time = time;
+    return *this;
+}
+
+Message& Message::operator<<(const char* text)
+{
+    if(text != nullptr)
+    {
+        this->Append(text, std::strlen(text));
     }
 
     return *this;
 }
 
-Message& Message::SetLine(int line)
+Message& Message::operator<<(const unsigned char* text)
 {
-    Assert(line > 0, "Attempted to set an invalid source line!");
+    return *this << reinterpret_cast<const char*>(text);
+}
 
-    m_line = line;
+Message& Message::operator<<(const std::string& text)
+{
+    this->Append(text.c_str(), text.size());
+    return *this;
+}
+
+Message& Message::operator<<(char character)
+{
+    this->Append(&character, 1);
+    return *this;
+}
+
+Message& Message::operator<<(bool value)
+{
+    this->AppendFormat("%d", (int)value);
+    return *this;
+}
+
+Message& Message::operator<<(int value)
+{
+    this->AppendFormat("%d", value);
     return *this;
 }
 
-std::string Message::GetText() const
+Message& Message::operator<<(unsigned int value)
 {
-    return m_text.str();
+    this->AppendFormat("%u", value);
+    return *this;
+}
+
+Message& Message::operator<<(long value)
+{
+    this->AppendFormat("%ld", value);
+    return *this;
+}
+
+Message& Message::operator<<(unsigned long value)
+{
+    this->AppendFormat("%lu", value);
+    return *this;
+}
+
+Message& Message::operator<<(long long value)
+{
+    this->AppendFormat("%lld", value);
+    return *this;
 }
 
-std::string Message::GetSource() const
+Message& Message::operator<<(unsigned long long value)
+{
+    this->AppendFormat("%llu", value);
+    return *this;
+}
+
+Message& Message::operator<<(double value)
+{
+    this->AppendFormat("%g", value);
+    return *this;
+}
+
+Message& Message::operator<<(const void* pointer)
+{
+    this->AppendFormat("%p", pointer);
+    return *this;
+}
+
+const char* Message::GetText() const
+{
+    return m_text;
+}
+
+std::size_t Message::GetLength() const
+{
+    return m_length;
+}
+
+const char* Message::GetSource() const
 {
     return m_source;
 }
@@ -106,9 +184,109 @@ int Message::GetLine() const
     return m_line;
 }
 
+Severity::Type Message::GetSeverity() const
+{
+    return m_severity;
+}
+
+const char* Message::GetCategory() const
+{
+    return m_category;
+}
+
+Message::TimePoint Message::GetTime() const
+{
+    return m_time;
+}
+
 bool Message::IsEmpty() const
 {
-    return m_text.str().empty();
+    return m_length == 0;
+}
+
+void Message::Append(const char* text, std::size_t length)
+{
+    // Truncate text that does not fit.
+    length = std::min(length, MaximumLength - m_length);
+
+    std::memcpy(m_text + m_length, text, length);
+    m_length += length;
+    m_text[m_length] = '\0';
+}
+
+template<typename Type>
+void Message::AppendFormat(const char* format, Type value)
+{
+    std::size_t available = MaximumLength - m_length;
+
+    if(available == 0)
+        return;
+
+    // Result is truncated and terminated if it does not fit.
+    int result = std::snprintf(m_text + m_length, available + 1, format, value);
+
+    if(result > 0)
+    {
+        m_length += std::min((std::size_t)result, available);
+    }
+    else
+    {
+        m_text[m_length] = '\0';
+    }
+}
+
+Source::Source(const char* file)
+{
+    m_path[0] = '\0';
+
+    if(file == nullptr)
+        return;
+
+    // Get the source directory, normalized once by the build module.
+    const std::string& prefix = Build::GetSourceDirKey();
+    const std::size_t prefixLength = prefix.size();
+
+    // Remove base path to source directory.
+    // Compare ignoring character case and kind of path separators.
+    auto normalize = [](char character)
+    {
+        return character == '\\' ? '/' : (char)std::toupper((unsigned char)character);
+    };
+
+    for(const char* it = file; *it != '\0'; ++it)
+    {
+        std::size_t i = 0;
+
+        while(i < prefixLength && it[i] != '\0' && normalize(it[i]) == prefix[i])
+        {
+            ++i;
+        }
+
+        if(i == prefixLength)
+        {
+            file = it + prefixLength;
+            break;
+        }
+    }
+
+    // Copy the path with normalized separators.
+    std::size_t length = 0;
+
+    for(; file[length] != '\0' && length < MaximumLength; ++length)
+    {
+        m_path[length] = file[length] == '\\' ? '/' : file[length];
+    }
+
+    m_path[length] = '\0';
+
+    // Workaround for the first letter being lower case on Visual C++ compiler.
+    // Happenes whenever __FILE__ macro is used inside an inlined function.
+    m_path[0] = (char)std::toupper(m_path[0]);
+}
+
+const char* Source::GetPath() const
+{
+    return m_path;
 }
 
 ScopedMessage::ScopedMessage(Logger::Sink* sink) :
@@ -117,9 +295,10 @@ ScopedMessage::ScopedMessage(Logger::Sink* sink) :
     Assert(sink != nullptr, "Attempted to create a scoped message with no sink!");
 }
 
-ScopedMessage::ScopedMessage(ScopedMessage&& other)
+ScopedMessage::ScopedMessage(ScopedMessage&& other) :
+    Message(std::move(other)),
+    m_sink(other.m_sink)
 {
-    m_sink = other.m_sink;
     other.m_sink = nullptr;
 }
 
@@ -1,18 +1,35 @@
 #pragma once
 
 #include "Precompiled.hpp"
+#include "Logger/Severity.hpp"
+#include "System/Clock.hpp"
 
 //
 // Message
 //
 //  Logger message object.
+//  Formats values straight into a fixed buffer stored inside the message,
+//  so writing a message does not allocate memory. Text that does not fit
+//  into the buffer is truncated. The source is kept as a pointer to a string
+//  with static storage duration, such as the one from the __FILE__ macro.
+//  Messages have a severity and an optional category tag.
+//  Time of a message is taken when it is created, so it does not depend
+//  on when an asynchronous sink writes it.
 //
 
 namespace Logger
 {
     // Message class.
-    class Message : private NonCopyable, public std::ostream
+    class Message : private NonCopyable
     {
+    public:
+        // Type declarations.
+        typedef System::Clock::time_point TimePoint;
+
+    public:
+        // Maximum length of the message text.
+        static const std::size_t MaximumLength = 511;
+
     public:
         Message();
         Message(Message&& other);
@@ -22,28 +39,108 @@ namespace Logger
         Message& SetText(const char* text);
 
         // Sets the message source.
+        // Source string must outlive the message, see Source class.
         Message& SetSource(const char* source);
 
         // Sets the message line.
         Message& SetLine(int line);
 
+        // Sets the message severity.
+        Message& SetSeverity(Severity::Type severity);
+
+        // Sets the message category.
+        // Category string must outlive the message.
+        Message& SetCategory(const char* category);
+
+        // Sets the message time.
+        Message& SetTime(TimePoint time);
+
+        // Appends values to the message text.
+        Message& operator<<(const char* text);
+        Message& operator<<(const unsigned char* text);
+        Message& operator<<(const std::string& text);
+        Message& operator<<(char character);
+        Message& operator<<(bool value);
+        Message& operator<<(int value);
+        Message& operator<<(unsigned int value);
+        Message& operator<<(long value);
+        Message& operator<<(unsigned long value);
+        Message& operator<<(long long value);
+        Message& operator<<(unsigned long long value);
+        Message& operator<<(double value);
+        Message& operator<<(const void* pointer);
+
         // Gets the message text.
-        std::string GetText() const;
+        const char* GetText() const;
+
+        // Gets the length of the message text.
+        std::size_t GetLength() const;
 
         // Gets the message source.
-        std::string GetSource() const;
+        const char* GetSource() const;
 
         // Gets the message line.
         int GetLine() const;
 
+        // Gets the message severity.
+        Severity::Type GetSeverity() const;
+
+        // Gets the message category.
+        const char* GetCategory() const;
+
+        // Gets the message time.
+        TimePoint GetTime() const;
+
         // Checks if the message is empty.
         bool IsEmpty() const;
 
+    private:
+        // Appends characters to the message text.
+        void Append(const char* text, std::size_t length);
+
+        // Appends a value formatted with a printf format string.
+        template<typename Type>
+        void AppendFormat(const char* format, Type value);
+
     private:
         // Message state.
-        std::stringbuf m_text;
-        std::string    m_source;
-        int            m_line;
+        char        m_text[MaximumLength + 1];
+        std::size_t m_length;
+        const char* m_source;
+        int         m_line;
+
+        Severity::Type m_severity;
+        const char*    m_category;
+        TimePoint      m_time;
+    };
+}
+
+//
+// Source
+//  Source file path relative to the source directory.
+//  Trimmed once when constructed, usually as a static at the call site,
+//  so messages only have to store a pointer to it. The path is kept in
+//  a fixed buffer, so it stays valid while static objects are destroyed.
+//
+
+namespace Logger
+{
+    // Source class.
+    class Source
+    {
+    public:
+        // Maximum length of the source path.
+        static const std::size_t MaximumLength = 255;
+
+    public:
+        explicit Source(const char* file);
+
+        // Gets the trimmed source path.
+        const char* GetPath() const;
+
+    private:
+        // Trimmed source path.
+        char m_path[MaximumLength + 1];
     };
 }
 
@@ -1,23 +1,59 @@
 #pragma once
 
 #include "Precompiled.hpp"
+#include "Logger/Severity.hpp"
 
 //
 // Output
 //
 //  Base interface for output implementations.
+//  Each output has its own minimum severity of written messages.
+//  Outputs receive messages already formatted by the sink, which renders
+//  each message once for all of its outputs.
 //
 
 namespace Logger
 {
     // Forward declarations.
-    class Message;
+    class FormattedMessage;
 
     // Output interface.
     class Output : private NonCopyable
     {
     public:
+        Output() :
+            m_severity(Severity::Trace)
+        {
+        }
+
+        virtual ~Output()
+        {
+        }
+
         // Writes a message to an output.
-        virtual void Write(const Logger::Message& message) = 0;
+        virtual void Write(const Logger::FormattedMessage& message) = 0;
+
+        // Flushes written messages, usually after a batch of writes.
+        // Outputs can defer flushing according to their flush policy, unless forced.
+        virtual void Flush(bool force)
+        {
+        }
+
+        // Sets the minimum severity of written messages.
+        // Use Sink::SetSeverity() for outputs that have been added to a sink.
+        void SetSeverity(Severity::Type severity)
+        {
+            m_severity.store(severity, std::memory_order_relaxed);
+        }
+
+        // Gets the minimum severity of written messages.
+        Severity::Type GetSeverity() const
+        {
+            return m_severity.load(std::memory_order_relaxed);
+        }
+
+    private:
+        // Minimum severity of written messages.
+        std::atomic<Severity::Type> m_severity;
     };
 }
@@ -18,6 +18,9 @@ namespace Logger
         ~ConsoleOutput();
 
         // Writes a message to the console window.
-        void Write(const Logger::Message& message);
+        void Write(const Logger::FormattedMessage& message);
+
+        // Flushes the console stream.
+        void Flush(bool force);
     };
 }
@@ -18,10 +18,6 @@ namespace Logger
         ~DebuggerOutput();
 
         // Writes a message to the debugger window.
-        void Write(const Logger::Message& message);
-
-    private:
-        // Reusable string stream.
-        std::stringstream m_stream;
+        void Write(const Logger::FormattedMessage& message);
     };
 }
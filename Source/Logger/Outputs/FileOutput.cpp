@@ -1,8 +1,28 @@
 #include "Precompiled.hpp"
 #include "FileOutput.hpp"
+#include "Logger/FormattedMessage.hpp"
 using namespace Logger;
 
+FileOutputInfo::FileOutputInfo() :
+    bufferSize(64 * 1024),
+    flushMessages(256),
+    flushInterval(1000),
+    flushSeverity(Severity::Error),
+    rotateSize(16 * 1024 * 1024),
+    rotateInterval(0),
+    retainedFiles(4)
+{
+}
+
 FileOutput::FileOutput() :
+    m_flushMessages(0),
+    m_flushInterval(0),
+    m_flushSeverity(Severity::Error),
+    m_pendingMessages(0),
+    m_rotateSize(0),
+    m_rotateInterval(0),
+    m_retainedFiles(0),
+    m_fileSize(0),
     m_initialized(false)
 {
 }
@@ -21,18 +41,7 @@ void FileOutput::Cleanup()
     if(m_file.is_open())
     {
         // Write session end.
-        time_t timeData = time(nullptr);
-        tm* timeInfo = localtime(&timeData);
-
-        m_file << "\n";
-        m_file << "Session ended at ";
-        m_file << std::setfill('0');
-        m_file << std::setw(4) << timeInfo->tm_year + 1900 << "-";
-        m_file << std::setw(2) << timeInfo->tm_mon + 1     << "-";
-        m_file << std::setw(2) << timeInfo->tm_mday        << " ";
-        m_file << std::setw(2) << timeInfo->tm_hour        << ":";
-        m_file << std::setw(2) << timeInfo->tm_min         << ":";
-        m_file << std::setw(2) << timeInfo->tm_sec;
+        this->WriteTime("\nSession ended at ", "");
 
         m_file.flush();
 
@@ -40,11 +49,22 @@ void FileOutput::Cleanup()
         m_file.close();
     }
 
+    m_flushMessages = 0;
+    m_flushInterval = std::chrono::milliseconds(0);
+    m_flushSeverity = Severity::Error;
+    m_pendingMessages = 0;
+
+    m_filename.clear();
+    m_rotateSize = 0;
+    m_rotateInterval = std::chrono::seconds(0);
+    m_retainedFiles = 0;
+    m_fileSize = 0;
+
     // Reset initialization state.
     m_initialized = false;
 }
         
-bool FileOutput::Initialize(std::string filename)
+bool FileOutput::Initialize(const FileOutputInfo& info)
 {
     this->Cleanup();
 
@@ -58,69 +78,160 @@ bool FileOutput::Initialize(std::string filename)
         }
     );
 
+    // Set the write buffer before opening the file.
+    // Previous buffer is kept alive until the stream stops using it.
+    if(info.bufferSize != 0)
+    {
+        std::unique_ptr<char[]> buffer(new char[info.bufferSize]);
+        m_file.rdbuf()->pubsetbuf(buffer.get(), info.bufferSize);
+        m_buffer = std::move(buffer);
+    }
+
     // Open the file for writing.
-    m_file.open(filename);
+    m_file.open(info.filename);
 
     if(!m_file.is_open())
         return false;
 
+    m_filename = info.filename;
+    m_fileSize = 0;
+    m_openTime = Clock::now();
+
     // Write session start.
-    time_t timeData = time(nullptr);
-    tm* timeInfo = localtime(&timeData);
-
-    m_file << "Session started at ";
-    m_file << std::setfill('0');
-    m_file << std::setw(4) << timeInfo->tm_year + 1900 << "-";
-    m_file << std::setw(2) << timeInfo->tm_mon + 1     << "-";
-    m_file << std::setw(2) << timeInfo->tm_mday        << " ";
-    m_file << std::setw(2) << timeInfo->tm_hour        << ":";
-    m_file << std::setw(2) << timeInfo->tm_min         << ":";
-    m_file << std::setw(2) << timeInfo->tm_sec;
-    m_file << "\n\n";
+    this->WriteTime("Session started at ", "\n\n");
 
     m_file.flush();
 
+    // Set the flush policy.
+    m_flushMessages = std::max(info.flushMessages, 0);
+    m_flushInterval = std::chrono::milliseconds(std::max(info.flushInterval, 0));
+    m_flushSeverity = info.flushSeverity;
+    m_pendingMessages = 0;
+    m_flushTime = Clock::now();
+
+    // Set the rotation policy.
+    m_rotateSize = info.rotateSize;
+    m_rotateInterval = std::chrono::seconds(std::max(info.rotateInterval, 0));
+    m_retainedFiles = std::max(info.retainedFiles, 0);
+
     // Success!
     return m_initialized = true;
 }
 
-void FileOutput::Write(const Logger::Message& message)
+void FileOutput::Write(const Logger::FormattedMessage& message)
 {
     if(!m_initialized)
         return;
 
-    // Write message prefix.
-    time_t timeData = time(nullptr);
-    tm* timeInfo = localtime(&timeData);
+    StringView line = message.GetLine();
+    std::size_t length = line.GetSize();
+
+    // Start a new file if the current one has grown too large or old.
+    bool rotateSize = m_rotateSize != 0 && m_fileSize + length > m_rotateSize;
+    bool rotateTime = m_rotateInterval.count() != 0 && Clock::now() - m_openTime >= m_rotateInterval;
+
+    if(rotateSize || rotateTime)
+    {
+        this->RotateFile();
+    }
+
+    m_file.write(line.GetData(), length);
+    m_fileSize += length;
+
+    // Flush important messages and full batches immediately.
+    ++m_pendingMessages;
+
+    if(message.GetSeverity() >= m_flushSeverity || (m_flushMessages != 0 && m_pendingMessages >= m_flushMessages))
+    {
+        this->FlushFile();
+    }
+}
 
-    m_file << "[";
-    m_file << std::setfill('0');
-    m_file << std::setw(2) << timeInfo->tm_hour << ":";
-    m_file << std::setw(2) << timeInfo->tm_min  << ":";
-    m_file << std::setw(2) << timeInfo->tm_sec;
-    m_file << "] ";
+void FileOutput::Flush(bool force)
+{
+    if(!m_initialized)
+        return;
 
-    // Write message text.
-    m_file << message.GetText();
+    if(m_pendingMessages == 0)
+        return;
 
-    // Write message source.
-    if(!message.GetSource().empty())
+    // Flush messages that have been waiting long enough.
+    if(force || (m_flushInterval.count() != 0 && Clock::now() - m_flushTime >= m_flushInterval))
     {
-        m_file << " {";
-        m_file << message.GetSource();
+        this->FlushFile();
+    }
+}
 
-        if(message.GetLine() != 0)
+void FileOutput::FlushFile()
+{
+    m_file.flush();
+
+    m_pendingMessages = 0;
+    m_flushTime = Clock::now();
+}
+
+void FileOutput::RotateFile()
+{
+    // Close the current file.
+    this->WriteTime("\nContinued in the next file at ", "");
+    m_file.close();
+
+    // Shift retained files, dropping the oldest one.
+    if(m_retainedFiles > 0)
+    {
+        std::remove(this->GetRetainedFilename(m_retainedFiles).c_str());
+
+        for(int index = m_retainedFiles - 1; index >= 1; --index)
         {
-            m_file << ":";
-            m_file << message.GetLine();
+            std::rename(this->GetRetainedFilename(index).c_str(), this->GetRetainedFilename(index + 1).c_str());
         }
 
-        m_file << "}";
+        std::rename(m_filename.c_str(), this->GetRetainedFilename(1).c_str());
     }
 
-    // Write message suffix.
-    m_file << "\n";
+    // Open a new file.
+    m_file.clear();
+    m_file.open(m_filename, std::ios::trunc);
 
-    // Flush the file stream.
-    m_file.flush();
+    m_fileSize = 0;
+    m_openTime = Clock::now();
+    m_pendingMessages = 0;
+
+    this->WriteTime("Continued from the previous file at ", "\n\n");
+}
+
+void FileOutput::WriteTime(const char* prefix, const char* suffix)
+{
+    std::time_t timeData = std::time(nullptr);
+    std::tm* timeInfo = std::localtime(&timeData);
+
+    if(timeInfo == nullptr)
+        return;
+
+    char text[128];
+    int length = std::snprintf(text, sizeof(text), "%s%04d-%02d-%02d %02d:%02d:%02d%s", prefix,
+        timeInfo->tm_year + 1900, timeInfo->tm_mon + 1, timeInfo->tm_mday,
+        timeInfo->tm_hour, timeInfo->tm_min, timeInfo->tm_sec, suffix);
+
+    if(length <= 0)
+        return;
+
+    length = std::min(length, (int)sizeof(text) - 1);
+
+    m_file.write(text, length);
+    m_fileSize += length;
+}
+
+std::string FileOutput::GetRetainedFilename(int index) const
+{
+    // Insert the index before the extension, as in "Log.1.txt".
+    std::size_t separator = m_filename.find_last_of("/\\");
+    std::size_t extension = m_filename.find_last_of('.');
+
+    if(extension == std::string::npos || (separator != std::string::npos && extension < separator))
+    {
+        return m_filename + "." + std::to_string(index);
+    }
+
+    return m_filename.substr(0, extension) + "." + std::to_string(index) + m_filename.substr(extension);
 }
@@ -1,16 +1,52 @@
 #pragma once
 
 #include "Precompiled.hpp"
+#include "System/Clock.hpp"
 #include "Logger/Output.hpp"
 
 //
 // File Output
 //
 //  Writes log messages to a file.
+//  Messages are collected in a large write buffer and flushed according
+//  to a flush policy, instead of issuing a write for every message.
+//  Files that grow too large or old are rotated, keeping a number of
+//  previous files as "Log.1.txt", "Log.2.txt" and so on. Rotation happens
+//  when a message is written, which is on the logger thread.
 //
 
 namespace Logger
 {
+    // File output initialization struct.
+    struct FileOutputInfo
+    {
+        // Path to the file.
+        std::string filename;
+
+        // Size of the write buffer in bytes.
+        std::size_t bufferSize;
+
+        // Number of messages written before a flush, or zero to disable.
+        int flushMessages;
+
+        // Time in milliseconds after which written messages are flushed, or zero to disable.
+        int flushInterval;
+
+        // Minimum severity of messages that are flushed immediately.
+        Severity::Type flushSeverity;
+
+        // Size in bytes after which the file is rotated, or zero to disable.
+        std::size_t rotateSize;
+
+        // Time in seconds after which the file is rotated, or zero to disable.
+        int rotateInterval;
+
+        // Number of rotated files that are kept.
+        int retainedFiles;
+
+        FileOutputInfo();
+    };
+
     class FileOutput : public Logger::Output
     {
     public:
@@ -21,15 +57,58 @@ namespace Logger
         void Cleanup();
         
         // Initializes the file output.
-        bool Initialize(std::string filename);
+        bool Initialize(const FileOutputInfo& info);
 
         // Writes a message to the file.
-        void Write(const Logger::Message& message);
+        void Write(const Logger::FormattedMessage& message);
+
+        // Flushes the file stream according to the flush policy, unless forced.
+        void Flush(bool force);
 
     private:
+        // Type declarations.
+        typedef System::Clock Clock;
+
+    private:
+        // Flushes the file stream.
+        void FlushFile();
+
+        // Moves the file to retained files and opens a new one.
+        void RotateFile();
+
+        // Writes the current date and time between a prefix and a suffix.
+        void WriteTime(const char* prefix, const char* suffix);
+
+        // Gets the filename of a retained file.
+        std::string GetRetainedFilename(int index) const;
+
+    private:
+        // Write buffer of the file stream.
+        // Declared before the stream, so it outlives it.
+        std::unique_ptr<char[]> m_buffer;
+
         // File output stream.
         std::ofstream m_file;
 
+        // Flush policy.
+        int m_flushMessages;
+        std::chrono::milliseconds m_flushInterval;
+        Severity::Type m_flushSeverity;
+
+        // Messages written since the last flush.
+        int m_pendingMessages;
+        Clock::time_point m_flushTime;
+
+        // Rotation policy.
+        std::string m_filename;
+        std::size_t m_rotateSize;
+        std::chrono::seconds m_rotateInterval;
+        int m_retainedFiles;
+
+        // Size and age of the current file.
+        std::size_t m_fileSize;
+        Clock::time_point m_openTime;
+
         // Initialization state.
         bool m_initialized;
     };
@@ -0,0 +1,183 @@
+#include "Precompiled.hpp"
+#include "FlightRecorderOutput.hpp"
+#include "Logger/FormattedMessage.hpp"
+using namespace Logger;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize a flight recorder output! "
+    #define LogDumpError(filename) "Failed to dump a flight recording \"" << filename << "\"! "
+
+    // Ring file format.
+    const char Magic[4] = { 'F', 'L', 'R', 'C' };
+    const std::uint32_t Version = 1;
+}
+
+FlightRecorderOutputInfo::FlightRecorderOutputInfo() :
+    size(4 * 1024 * 1024)
+{
+}
+
+FlightRecorderOutput::FlightRecorderOutput() :
+    m_header(nullptr),
+    m_ring(nullptr),
+    m_initialized(false)
+{
+}
+
+FlightRecorderOutput::~FlightRecorderOutput()
+{
+    this->Cleanup();
+}
+
+void FlightRecorderOutput::Cleanup()
+{
+    m_header = nullptr;
+    m_ring = nullptr;
+
+    m_file.Cleanup();
+
+    // Reset initialization state.
+    m_initialized = false;
+}
+
+bool FlightRecorderOutput::Initialize(const FlightRecorderOutputInfo& info)
+{
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            this->Cleanup();
+        }
+    );
+
+    // Validate arguments.
+    if(info.filename.empty())
+    {
+        LogError() << LogInitializeError() << "Invalid filename.";
+        return false;
+    }
+
+    if(info.size <= sizeof(Header))
+    {
+        LogError() << LogInitializeError() << "Invalid size.";
+        return false;
+    }
+
+    // Keep the recording of a previous run.
+    if(!info.previousFilename.empty())
+    {
+        std::remove(info.previousFilename.c_str());
+        std::rename(info.filename.c_str(), info.previousFilename.c_str());
+    }
+
+    // Create the ring file.
+    if(!m_file.Create(info.filename, info.size))
+    {
+        LogError() << LogInitializeError() << "Couldn't create the ring file.";
+        return false;
+    }
+
+    m_header = static_cast<Header*>(m_file.GetWritableData());
+    m_ring = reinterpret_cast<char*>(m_header + 1);
+
+    std::memcpy(m_header->magic, Magic, sizeof(Magic));
+    m_header->version = Version;
+    m_header->capacity = info.size - sizeof(Header);
+    m_header->written = 0;
+
+    // Success!
+    return m_initialized = true;
+}
+
+void FlightRecorderOutput::Write(const Logger::FormattedMessage& message)
+{
+    if(!m_initialized)
+        return;
+
+    StringView line = message.GetLine();
+
+    // Copy the line into the ring, wrapping around its end.
+    std::size_t capacity = (std::size_t)m_header->capacity;
+    std::size_t length = std::min(line.GetSize(), capacity);
+    std::size_t offset = (std::size_t)(m_header->written % capacity);
+    std::size_t first = std::min(length, capacity - offset);
+
+    std::memcpy(m_ring + offset, line.GetData(), first);
+    std::memcpy(m_ring, line.GetData() + first, length - first);
+
+    // Publish the line after its content.
+    m_header->written += length;
+}
+
+bool FlightRecorderOutput::Dump(std::string filename, std::ostream& output)
+{
+    MappedFile file;
+
+    if(!file.Open(filename))
+    {
+        LogError() << LogDumpError(filename) << "Couldn't open the file.";
+        return false;
+    }
+
+    // Validate the header.
+    if(file.GetSize() < sizeof(Header))
+    {
+        LogError() << LogDumpError(filename) << "Invalid file header.";
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, file.GetData(), sizeof(Header));
+
+    if(std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version || header.capacity != file.GetSize() - sizeof(Header))
+    {
+        LogError() << LogDumpError(filename) << "Invalid file header.";
+        return false;
+    }
+
+    const char* ring = static_cast<const char*>(file.GetData()) + sizeof(Header);
+    std::size_t capacity = (std::size_t)header.capacity;
+
+    // Write the ring from the oldest character.
+    if(header.written <= capacity)
+    {
+        output.write(ring, (std::streamsize)header.written);
+    }
+    else
+    {
+        std::size_t offset = (std::size_t)(header.written % capacity);
+
+        // Skip the line that has been partially overwritten.
+        const char* oldest = ring + offset;
+        const char* end = ring + capacity;
+        const char* newline = std::find(oldest, end, '\n');
+
+        if(newline != end)
+        {
+            output.write(newline + 1, end - newline - 1);
+            output.write(ring, (std::streamsize)offset);
+        }
+        else
+        {
+            const char* wrapped = std::find(ring, ring + offset, '\n');
+
+            if(wrapped != ring + offset)
+            {
+                output.write(wrapped + 1, ring + offset - wrapped - 1);
+            }
+        }
+    }
+
+    if(!output)
+    {
+        LogError() << LogDumpError(filename) << "Couldn't write the output.";
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/MappedFile.hpp"
+#include "Logger/Output.hpp"
+
+//
+// Flight Recorder Output
+//
+//  Writes log messages into a ring of a fixed size inside a memory mapped
+//  file, overwriting the oldest messages when it wraps around. Writing a
+//  message is a copy into mapped memory, without system calls or flushes,
+//  so verbose messages can be recorded all the time. The operating system
+//  writes mapped pages back to the file even if the process crashes, which
+//  keeps the most recent history for a post mortem. Only a crash of the
+//  whole system can lose messages that have not been written back yet.
+//
+//  A recording left by a previous run is moved aside before a new one is
+//  created, so it is not overwritten when the application is restarted
+//  after a crash. Recordings are dumped as text with the log decoder.
+//
+//  Example usage:
+//      Logger::FlightRecorderOutputInfo info;
+//      info.filename = "Log.ring";
+//
+//      Logger::FlightRecorderOutput output;
+//      output.Initialize(info);
+//
+//      Logger::FlightRecorderOutput::Dump("Log.ring", std::cout);
+//
+
+namespace Logger
+{
+    // Flight recorder output initialization struct.
+    struct FlightRecorderOutputInfo
+    {
+        // Path to the ring file.
+        std::string filename;
+
+        // Path that a previous ring file is moved to, or empty to overwrite it.
+        std::string previousFilename;
+
+        // Size of the ring in bytes.
+        std::size_t size;
+
+        FlightRecorderOutputInfo();
+    };
+
+    class FlightRecorderOutput : public Logger::Output
+    {
+    public:
+        FlightRecorderOutput();
+        ~FlightRecorderOutput();
+
+        // Restores an instance to it's original state.
+        void Cleanup();
+
+        // Initializes the flight recorder output.
+        bool Initialize(const FlightRecorderOutputInfo& info);
+
+        // Writes a message to the ring.
+        void Write(const Logger::FormattedMessage& message);
+
+        // Writes messages of a ring file from oldest to newest as text.
+        static bool Dump(std::string filename, std::ostream& output);
+
+    private:
+        // Header at the start of the ring file.
+        struct Header
+        {
+            char magic[4];
+            std::uint32_t version;
+            std::uint64_t capacity;
+            std::uint64_t written;
+        };
+
+    private:
+        // Mapped ring file.
+        MappedFile m_file;
+
+        // Header and ring of message lines in the mapped file.
+        Header* m_header;
+        char* m_ring;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,69 @@
+#include "Precompiled.hpp"
+#include "RateLimit.hpp"
+#include "Message.hpp"
+using namespace Logger;
+
+RateLimit::Permit::Permit(bool allowed, int suppressed) :
+    m_allowed(allowed),
+    m_suppressed(suppressed)
+{
+}
+
+bool RateLimit::Permit::IsAllowed() const
+{
+    return m_allowed;
+}
+
+int RateLimit::Permit::GetSuppressedCount() const
+{
+    return m_suppressed;
+}
+
+void RateLimit::Permit::Release()
+{
+    m_allowed = false;
+}
+
+RateLimit::RateLimit(int messagesPerSecond) :
+    m_limit(messagesPerSecond),
+    m_windowStart(Clock::now().time_since_epoch().count()),
+    m_count(0),
+    m_suppressed(0)
+{
+    Assert(messagesPerSecond > 0, "Rate limit must allow at least one message per second!");
+}
+
+RateLimit::Permit RateLimit::Acquire()
+{
+    // Start a new window once a second has passed.
+    Clock::rep now = Clock::now().time_since_epoch().count();
+    Clock::rep windowStart = m_windowStart.load(std::memory_order_relaxed);
+
+    if(Clock::duration(now - windowStart) >= std::chrono::seconds(1))
+    {
+        // Only one thread resets the count.
+        if(m_windowStart.compare_exchange_strong(windowStart, now, std::memory_order_relaxed))
+        {
+            m_count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Suppress messages over the limit.
+    if(m_count.fetch_add(1, std::memory_order_relaxed) >= m_limit)
+    {
+        m_suppressed.fetch_add(1, std::memory_order_relaxed);
+        return Permit(false, 0);
+    }
+
+    return Permit(true, m_suppressed.exchange(0, std::memory_order_relaxed));
+}
+
+Message& Logger::operator<<(Message& message, const RateLimit::Permit& permit)
+{
+    if(permit.GetSuppressedCount() != 0)
+    {
+        message << "[" << permit.GetSuppressedCount() << " similar messages suppressed] ";
+    }
+
+    return message;
+}
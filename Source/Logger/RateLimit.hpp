@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "System/Clock.hpp"
+
+//
+// Rate Limit
+//
+//  Limits the number of messages written by a call site per second.
+//  Messages over the limit are counted and dropped before they are
+//  formatted. The next message that gets through is prefixed with the
+//  number of messages suppressed before it. Counting is lock free and
+//  approximate when many threads hit the same call site at once.
+//
+//  Example usage:
+//      for(auto& entity : entities)
+//      {
+//          LogLimited(Logger::Severity::Warning, 10) << "Entity " << entity.GetIdentifier() << " is invalid.";
+//      }
+//
+
+namespace Logger
+{
+    // Forward declarations.
+    class Message;
+
+    // Rate limit class.
+    class RateLimit : private NonCopyable
+    {
+    public:
+        // Permission to write a message.
+        class Permit
+        {
+        public:
+            Permit(bool allowed, int suppressed);
+
+            // Checks if the message can be written.
+            bool IsAllowed() const;
+
+            // Gets the number of messages suppressed before this one.
+            int GetSuppressedCount() const;
+
+            // Ends the permission after the message has been written.
+            void Release();
+
+        private:
+            bool m_allowed;
+            int m_suppressed;
+        };
+
+    public:
+        explicit RateLimit(int messagesPerSecond);
+
+        // Counts a message and checks if it can be written.
+        Permit Acquire();
+
+    private:
+        // Type declarations.
+        typedef System::Clock Clock;
+
+    private:
+        // Maximum number of messages per second.
+        int m_limit;
+
+        // Start of the current one second window.
+        std::atomic<Clock::rep> m_windowStart;
+
+        // Number of messages in the current window.
+        std::atomic<int> m_count;
+
+        // Number of messages suppressed since the last written one.
+        std::atomic<int> m_suppressed;
+    };
+
+    // Writes the number of suppressed messages.
+    Message& operator<<(Message& message, const RateLimit::Permit& permit);
+}
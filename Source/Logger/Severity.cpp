@@ -0,0 +1,27 @@
+#include "Precompiled.hpp"
+#include "Severity.hpp"
+using namespace Logger;
+
+const char* Severity::GetName(Type severity)
+{
+    switch(severity)
+    {
+    case Trace:
+        return "Trace";
+
+    case Debug:
+        return "Debug";
+
+    case Info:
+        return "Info";
+
+    case Warning:
+        return "Warning";
+
+    case Error:
+        return "Error";
+
+    default:
+        return "Unknown";
+    }
+}
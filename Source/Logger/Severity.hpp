@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Severity
+//
+//  Severity levels of log messages, from the least to the most important.
+//  Values match LOG_SEVERITY_* macros, so they can be compared against
+//  the compile time threshold in the preprocessor.
+//
+
+#define LOG_SEVERITY_TRACE   0
+#define LOG_SEVERITY_DEBUG   1
+#define LOG_SEVERITY_INFO    2
+#define LOG_SEVERITY_WARNING 3
+#define LOG_SEVERITY_ERROR   4
+
+namespace Logger
+{
+    // Severity levels.
+    struct Severity
+    {
+        enum Type
+        {
+            Trace   = LOG_SEVERITY_TRACE,
+            Debug   = LOG_SEVERITY_DEBUG,
+            Info    = LOG_SEVERITY_INFO,
+            Warning = LOG_SEVERITY_WARNING,
+            Error   = LOG_SEVERITY_ERROR,
+
+            Count,
+        };
+
+        // Gets the name of a severity level.
+        static const char* GetName(Type severity);
+    };
+}
@@ -2,10 +2,14 @@
 #include "Sink.hpp"
 #include "Output.hpp"
 #include "Message.hpp"
+#include "FormattedMessage.hpp"
 using namespace Logger;
 
-Sink::Sink()
+Sink::Sink() :
+    m_outputs(nullptr),
+    m_severity(Severity::Count)
 {
+    this->PublishOutputs(std::unique_ptr<OutputList>(new OutputList()));
 }
 
 Sink::~Sink()
@@ -17,8 +21,14 @@ void Sink::AddOutput(Logger::Output* output)
     if(output == nullptr)
         return;
 
-    // Add an output to the list.
-    m_outputs.push_back(output);
+    std::lock_guard<std::mutex> lock(m_outputsMutex);
+
+    // Publish a copy of the list with an added output.
+    std::unique_ptr<OutputList> outputs(new OutputList(*m_outputs.load()));
+    outputs->push_back(output);
+
+    this->PublishOutputs(std::move(outputs));
+    this->UpdateSeverity();
 }
 
 void Sink::RemoveOutput(Logger::Output* output)
@@ -26,16 +36,95 @@ void Sink::RemoveOutput(Logger::Output* output)
     if(output == nullptr)
         return;
 
-    // Find and remove an output from the list.
-    m_outputs.erase(std::remove(m_outputs.begin(), m_outputs.end(), output), m_outputs.end());
+    std::lock_guard<std::mutex> lock(m_outputsMutex);
+
+    // Publish a copy of the list without an output.
+    std::unique_ptr<OutputList> outputs(new OutputList(*m_outputs.load()));
+    outputs->erase(std::remove(outputs->begin(), outputs->end(), output), outputs->end());
+
+    this->PublishOutputs(std::move(outputs));
+    this->UpdateSeverity();
+}
+
+void Sink::SetSeverity(Logger::Output* output, Severity::Type severity)
+{
+    if(output == nullptr)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_outputsMutex);
+
+    output->SetSeverity(severity);
+
+    this->UpdateSeverity();
+}
+
+void Sink::SetPreciseTimestamps(bool precise)
+{
+    m_timestamp.SetPrecise(precise);
+}
+
+void Sink::PublishOutputs(std::unique_ptr<OutputList> outputs)
+{
+    // Keep replaced lists alive for writers that may still iterate them.
+    m_outputs.store(outputs.get(), std::memory_order_release);
+    m_outputLists.push_back(std::move(outputs));
+}
+
+void Sink::UpdateSeverity()
+{
+    Severity::Type severity = Severity::Count;
+
+    for(auto output : *m_outputs.load())
+    {
+        severity = std::min(severity, output->GetSeverity());
+    }
+
+    m_severity.store(severity, std::memory_order_relaxed);
 }
 
 void Sink::Write(const Logger::Message& message)
+{
+    this->WriteOutputs(message);
+    this->FlushOutputs(false);
+}
+
+void Sink::Flush()
+{
+    this->FlushOutputs(true);
+}
+
+void Sink::WriteOutputs(const Logger::Message& message)
 {
     // Write a message to all outputs.
-    for(auto output : m_outputs)
+    const OutputList& outputs = *m_outputs.load(std::memory_order_acquire);
+
+    // Format the message once, when the first output accepts it.
+    FormattedMessage formatted;
+    bool isFormatted = false;
+
+    for(auto output : outputs)
     {
         Assert(output != nullptr, "Sink output is nullptr!");
-        output->Write(message);
+
+        if(message.GetSeverity() < output->GetSeverity())
+            continue;
+
+        if(!isFormatted)
+        {
+            formatted.Format(message, m_timestamp);
+            isFormatted = true;
+        }
+
+        output->Write(formatted);
+    }
+}
+
+void Sink::FlushOutputs(bool force)
+{
+    const OutputList& outputs = *m_outputs.load(std::memory_order_acquire);
+
+    for(auto output : outputs)
+    {
+        output->Flush(force);
     }
 }
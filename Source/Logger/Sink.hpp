@@ -1,11 +1,21 @@
 #pragma once
 
 #include "Precompiled.hpp"
+#include "Logger/Severity.hpp"
+#include "Logger/Timestamp.hpp"
 
 //
 // Sink
 //
 //  Writes messages to multiple outputs.
+//  Keeps the lowest minimum severity of its outputs, so callers can skip
+//  formatting messages that would not be written to any output.
+//  Each message is formatted into a line once and shared by all outputs.
+//
+//  The list of outputs is copy on write. Adding or removing an output
+//  publishes a new list, while messages are written to whichever list was
+//  current when they started, without taking a lock. Replaced lists are
+//  kept until the sink is destroyed, as outputs rarely change.
 //
 
 namespace Logger
@@ -23,19 +33,62 @@ namespace Logger
 
     public:
         Sink();
-        ~Sink();
+        virtual ~Sink();
 
         // Adds an output.
         void AddOutput(Logger::Output* output);
 
         // Removes an output.
+        // Messages being written concurrently may still reach the output.
         void RemoveOutput(Logger::Output* output);
 
+        // Sets the minimum severity of messages written to an output.
+        void SetSeverity(Logger::Output* output, Severity::Type severity);
+
+        // Checks if messages of a severity would be written to any output.
+        bool IsEnabled(Severity::Type severity) const
+        {
+            return severity >= m_severity.load(std::memory_order_relaxed);
+        }
+
+        // Enables or disables timestamps with microsecond resolution.
+        void SetPreciseTimestamps(bool precise);
+
         // Writes a log message.
-        void Write(const Logger::Message& message);
+        virtual void Write(const Logger::Message& message);
+
+        // Waits until written messages reach the outputs.
+        virtual void Flush();
+
+    protected:
+        // Writes a log message to all outputs.
+        void WriteOutputs(const Logger::Message& message);
+
+        // Flushes all outputs.
+        // Outputs can defer flushing according to their flush policy, unless forced.
+        void FlushOutputs(bool force);
 
     private:
-        // List of outputs.
-        OutputList m_outputs;
+        // Publishes a new list of outputs.
+        void PublishOutputs(std::unique_ptr<OutputList> outputs);
+
+        // Updates the lowest minimum severity of outputs.
+        void UpdateSeverity();
+
+    private:
+        // Current list of outputs.
+        std::atomic<const OutputList*> m_outputs;
+
+        // Published lists of outputs, including the current one.
+        std::vector<std::unique_ptr<const OutputList>> m_outputLists;
+
+        // Serializes changes of outputs.
+        std::mutex m_outputsMutex;
+
+        // Lowest minimum severity of outputs.
+        std::atomic<Severity::Type> m_severity;
+
+        // Formatted message timestamps.
+        Timestamp m_timestamp;
     };
 }
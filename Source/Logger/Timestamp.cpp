@@ -0,0 +1,78 @@
+#include "Precompiled.hpp"
+#include "Timestamp.hpp"
+using namespace Logger;
+
+namespace
+{
+    // Length of the "[HH:MM:SS" prefix.
+    const std::size_t PrefixLength = 9;
+
+    // Gets the wall clock time of a steady clock time.
+    std::time_t GetWallTime(Timestamp::Clock::time_point time, long& microseconds)
+    {
+        // Anchor the steady clock to the wall clock once.
+        static const Timestamp::Clock::time_point steadyStart = Timestamp::Clock::now();
+        static const std::chrono::system_clock::time_point systemStart = std::chrono::system_clock::now();
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(time - steadyStart);
+        auto wallTime = systemStart + std::chrono::duration_cast<std::chrono::system_clock::duration>(elapsed);
+
+        auto sinceEpoch = std::chrono::duration_cast<std::chrono::microseconds>(wallTime.time_since_epoch());
+        microseconds = (long)(sinceEpoch.count() % 1000000);
+
+        if(microseconds < 0)
+        {
+            microseconds += 1000000;
+        }
+
+        return std::chrono::system_clock::to_time_t(wallTime - std::chrono::microseconds(microseconds));
+    }
+}
+
+Timestamp::Timestamp() :
+    m_second(-1),
+    m_precise(false)
+{
+    m_text[0] = '\0';
+}
+
+void Timestamp::SetPrecise(bool precise)
+{
+    m_precise = precise;
+}
+
+const char* Timestamp::Format(Clock::time_point time)
+{
+    long microseconds = 0;
+    std::time_t second = GetWallTime(time, microseconds);
+
+    // Render the prefix when the second changes.
+    if(second != m_second)
+    {
+        std::tm* timeInfo = std::localtime(&second);
+
+        if(timeInfo != nullptr)
+        {
+            std::snprintf(m_text, sizeof(m_text), "[%02d:%02d:%02d", timeInfo->tm_hour, timeInfo->tm_min, timeInfo->tm_sec);
+        }
+        else
+        {
+            std::snprintf(m_text, sizeof(m_text), "[--:--:--");
+        }
+
+        m_second = second;
+    }
+
+    // Append the suffix after the cached prefix.
+    if(m_precise)
+    {
+        std::snprintf(m_text + PrefixLength, sizeof(m_text) - PrefixLength, ".%06ld]", microseconds);
+    }
+    else
+    {
+        m_text[PrefixLength] = ']';
+        m_text[PrefixLength + 1] = '\0';
+    }
+
+    return m_text;
+}
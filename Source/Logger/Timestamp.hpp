@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "System/Clock.hpp"
+
+//
+// Timestamp
+//
+//  Formats times of log messages for outputs. Times are taken from the
+//  monotonic steady clock and anchored to the wall clock once, when the
+//  first timestamp is created. The rendered prefix is cached and only
+//  re-rendered when the second changes, as most messages within a frame
+//  share it. Precise timestamps append microseconds for frame level
+//  analysis.
+//
+//  Example usage:
+//      Logger::Timestamp timestamp;
+//      timestamp.SetPrecise(true);
+//      std::cout << timestamp.Format(message.GetTime());
+//
+
+namespace Logger
+{
+    // Timestamp class.
+    class Timestamp : private NonCopyable
+    {
+    public:
+        // Type declarations.
+        typedef System::Clock Clock;
+
+    public:
+        Timestamp();
+
+        // Enables or disables microsecond resolution.
+        void SetPrecise(bool precise);
+
+        // Formats a time as "[HH:MM:SS]" or "[HH:MM:SS.ffffff]".
+        // Returned string is valid until the next call.
+        const char* Format(Clock::time_point time);
+
+    private:
+        // Second of the cached prefix.
+        std::time_t m_second;
+
+        // Cached prefix and formatted timestamp.
+        char m_text[32];
+
+        // Resolution settings.
+        std::atomic<bool> m_precise;
+    };
+}
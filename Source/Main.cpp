@@ -1,7 +1,50 @@
 #include "Precompiled.hpp"
+#include "Common/Checksum.hpp"
+#include "Common/DispatchProfile.hpp"
+#include "Common/EventBus.hpp"
+#include "Common/JobSystem.hpp"
+#include "Common/Memory.hpp"
+#include "Common/MemoryTracker.hpp"
+#include "Logger/BinaryLog.hpp"
 #include "System/Config.hpp"
+#include "System/FileService.hpp"
+#include "System/FrameStatistics.hpp"
+#include "System/Metrics.hpp"
+#include "System/StartupGraph.hpp"
 #include "System/Window.hpp"
+#include "System/InputState.hpp"
+#include "Graphics/FrameProfiler.hpp"
+#include "Graphics/Renderer.hpp"
+#include "Graphics/ProgramCache.hpp"
+#include "Graphics/SpriteBatch.hpp"
+#include "Graphics/ParticleSystem.hpp"
+#include "Graphics/TextRenderer.hpp"
+#include "Graphics/AnimationSystem.hpp"
+#include "Graphics/DebugDraw.hpp"
+#include "Graphics/PerformanceOverlay.hpp"
+#include "Graphics/AssetManager.hpp"
+#include "Graphics/ReadbackService.hpp"
 #include "Game/EntitySystem.hpp"
+#include "Game/ComponentSystem.hpp"
+#include "Game/SystemScheduler.hpp"
+#include "Game/GameLoop.hpp"
+#include "Game/MemoryLayoutInspector.hpp"
+#include "Game/PhysicsWorld.hpp"
+#include "Game/SessionRecording.hpp"
+#include "Game/WorldPersistence.hpp"
+#include "Game/Transform.hpp"
+#include "Audio/AudioMixer.hpp"
+
+namespace
+{
+    // Set when the process is asked to stop, such as with Ctrl+C.
+    volatile std::sig_atomic_t stopRequested = 0;
+
+    void StopHandler(int)
+    {
+        stopRequested = 1;
+    }
+}
 
 int main(int argc, char* argv[])
 {
@@ -10,36 +53,1117 @@ int main(int argc, char* argv[])
     Logger::Initialize();
 
     // Initialize the config.
+    System::ConfigInfo configInfo;
+    configInfo.filename = "Game.cfg";
+    configInfo.argumentCount = argc;
+    configInfo.arguments = argv;
+    configInfo.environmentPrefix = "GAME_";
+
     System::Config config;
-    if(!config.Initialize())
-        return -1;
 
-    // Initialize the window.
+    {
+        MemoryTracker::ScopedTag tag(MemoryTags::Config);
+
+        if(!config.Initialize(configInfo))
+            return -1;
+    }
+
+    // Set memory budgets of subsystems.
+    for(int i = 0; i < MemoryTags::Count; ++i)
+    {
+        MemoryTags::Type tag = (MemoryTags::Type)i;
+        std::string prefix = std::string("Memory.") + MemoryTracker::GetTagName(tag);
+
+        std::int64_t liveBudget = config.GetVariable<std::int64_t>(prefix + ".LiveBudget", 0);
+        std::int64_t frameBudget = config.GetVariable<std::int64_t>(prefix + ".FrameBudget", 0);
+
+        MemoryTracker::SetBudget(tag, liveBudget, (std::uint64_t)std::max<std::int64_t>(frameBudget, 0));
+    }
+
+    // Reload the config when its file changes.
+    if(config.GetVariable<bool>("Config.HotReload", false))
+    {
+        config.Watch();
+    }
+
+    // Write log timestamps with microsecond resolution.
+    Logger::SetPreciseTimestamps(config.GetVariable<bool>("Logger.PreciseTimestamps", false));
+
+    // Check if a recorded session should be played back without a window.
+    const std::string SessionFilename = "Session.replay";
+
+    bool sessionRecord = config.GetVariable<bool>("Session.Record", false);
+    bool sessionReplay = config.GetVariable<bool>("Session.Replay", false);
+
+    // Check if a fixed workload should be run for profile guided optimization.
+    // Training runs headless with a seeded workload for a fixed number of ticks and exits.
+    bool training = config.GetVariable<bool>("Simulation.Training", false);
+
+    // Check if the simulation should run at full speed without a window and OpenGL.
+    bool headless = training || config.GetVariable<bool>("Simulation.Headless", false);
+    std::uint64_t tickLimit = config.GetVariable<std::uint64_t>("Simulation.TickLimit", training ? 3600 : 0);
+
+    // Check if checksums of simulation state should be computed every tick.
+    // Recorded sessions store them, so playback can detect diverging ticks.
+#if defined(DETERMINISTIC)
+    bool stateChecksums = config.GetVariable<bool>("Simulation.Checksums", true);
+#else
+    bool stateChecksums = config.GetVariable<bool>("Simulation.Checksums", false);
+#endif
+
+    // Profile CPU and GPU work of frames.
+    Graphics::FrameProfiler frameProfiler;
+    Graphics::FrameProfiler* profiler = nullptr;
+
+    if(config.GetVariable<bool>("Profiler.Enabled", false))
+    {
+        Graphics::FrameProfilerInfo info;
+        info.hardwareCounters = config.GetVariable<bool>("Profiler.HardwareCounters", false);
+
+        if(!frameProfiler.Initialize(info))
+            return -1;
+
+        profiler = &frameProfiler;
+    }
+
+    // Let profile macros record into the same profiler.
+    Graphics::FrameProfiler::SetGlobal(profiler);
+
+    // Read settings of log files.
+    // Subsystems are initialized by startup tasks, which can't read the config.
+    bool flightRecorder = config.GetVariable<bool>("Logger.FlightRecorder", false);
+    std::int64_t flightRecorderSize = config.GetVariable<std::int64_t>("Logger.FlightRecorderSize", 4 * 1024 * 1024);
+    bool binaryLog = config.GetVariable<bool>("Logger.BinaryLog", false);
+
+    // Read settings of the window.
     System::WindowInfo windowInfo;
     windowInfo.width = config.GetVariable<int>("Window.Width", 1024);
     windowInfo.height = config.GetVariable<int>("Window.Height", 576);
     windowInfo.vsync = config.GetVariable<bool>("Window.Vsync", true);
+    windowInfo.adaptiveVsync = config.GetVariable<bool>("Window.AdaptiveVsync", false);
+    windowInfo.frameLimit = config.GetVariable<double>("Window.FrameLimit", 0.0);
+    windowInfo.presentThread = config.GetVariable<bool>("Window.PresentThread", false);
+    windowInfo.coalesceInput = config.GetVariable<bool>("Window.CoalesceInput", false);
+    windowInfo.eventThread = config.GetVariable<bool>("Window.EventThread", false);
+    windowInfo.bufferCursorSamples = config.GetVariable<bool>("Window.BufferCursorSamples", false);
+    windowInfo.rawMouseMotion = config.GetVariable<bool>("Window.RawMouseMotion", false);
+    windowInfo.uploadContext = config.GetVariable<bool>("Window.UploadContext", false);
+
+    // Throttle frames and skip rendering while the window is minimized or unfocused.
+    // The simulation keeps its tick rate as long as a background frame fits within its substeps.
+    bool backgroundThrottle = config.GetVariable<bool>("Window.BackgroundThrottle", true);
+    double backgroundFrameRate = std::max(config.GetVariable<double>("Window.BackgroundFrameRate", 15.0), 1.0);
 
     System::Window window;
-    if(!window.Initialize(windowInfo))
-        return -1;
 
-    // Initialize the entity system.
+    // Read settings of the renderer.
+    Graphics::RendererInfo rendererInfo;
+    rendererInfo.window = &window;
+    rendererInfo.profiler = profiler;
+
+    Graphics::Renderer renderer;
+
+    // Read settings of the cache of program binaries.
+    Graphics::ProgramCacheInfo programCacheInfo;
+    programCacheInfo.filename = config.GetVariable<std::string>("Graphics.ProgramCache", "Programs.cache");
+
+    Graphics::ProgramCache programCache;
+
+    // Read settings of the asset manager.
+    Graphics::AssetManagerInfo assetManagerInfo;
+    assetManagerInfo.renderer = &renderer;
+    assetManagerInfo.programCache = &programCache;
+    assetManagerInfo.ioThreadCount = config.GetVariable<int>("Assets.IoThreadCount", 2);
+    assetManagerInfo.uploadBudget = config.GetVariable<int>("Assets.UploadBudget", 4 * 1024 * 1024);
+    assetManagerInfo.uploadWindow = &window;
+
+    // Assets are read from the archive first when one is set.
+    std::string assetArchiveFilename = config.GetVariable<std::string>("Assets.Archive", "");
+    Archive assetArchive;
+
+    Graphics::AssetManager assetManager;
+
+    // Create the input state.
+    System::InputState inputState;
+
+    // Read settings of the job system.
+    JobSystemInfo jobSystemInfo;
+    jobSystemInfo.workerCount = config.GetVariable<int>("Jobs.WorkerCount", -1);
+    jobSystemInfo.pinThreads = config.GetVariable<bool>("Jobs.PinThreads", false);
+    jobSystemInfo.arenaSize = config.GetVariable<int>("Jobs.ArenaSize", 256 * 1024);
+    jobSystemInfo.fiberCount = config.GetVariable<int>("Jobs.FiberCount", 0);
+    jobSystemInfo.fiberStackSize = config.GetVariable<int>("Jobs.FiberStackSize", 256 * 1024);
+
+    JobSystem jobSystem;
+
+    // Read settings of the arena for transient data of a frame.
+    LinearArenaInfo frameArenaInfo;
+    frameArenaInfo.blockSize = config.GetVariable<int>("Memory.FrameArenaSize", 1024 * 1024);
+    frameArenaInfo.reserveSize = (std::size_t)config.GetVariable<int>("Memory.FrameArenaReserveMegabytes", 0) * 1024 * 1024;
+    frameArenaInfo.hugePages = config.GetVariable<bool>("Memory.HugePages", false);
+
+    LinearArena frameArena;
+
+    // Read settings of the file service.
+    System::FileServiceInfo fileServiceInfo;
+    fileServiceInfo.threadCount = config.GetVariable<int>("Files.ThreadCount", 2);
+
+    System::FileService fileService;
+
+    // Read settings of the entity system.
+    Game::EntitySystemInfo entitySystemInfo;
+    entitySystemInfo.initialCapacity = config.GetVariable<int>("Entities.InitialCapacity", 1024);
+    entitySystemInfo.minimumFreeHandles = config.GetVariable<int>("Entities.MinimumFreeHandles", 64);
+    entitySystemInfo.growthFactor = config.GetVariable<float>("Entities.GrowthFactor", 2.0f);
+    entitySystemInfo.concurrentHandles = config.GetVariable<int>("Entities.ConcurrentHandles", 256);
+    entitySystemInfo.handleShards = config.GetVariable<int>("Entities.HandleShards", 0);
+    entitySystemInfo.shardBlockSize = config.GetVariable<int>("Entities.ShardBlockSize", 64);
+    entitySystemInfo.freeHandlePolicy = (Game::FreeHandlePolicy::Type)config.GetVariable<int>("Entities.FreeHandlePolicy", Game::FreeHandlePolicy::FirstInFirstOut);
+
     Game::EntitySystem entitySystem;
-    if(!entitySystem.Initialize())
+
+    // Read settings of the component system.
+    Game::ComponentSystemInfo componentSystemInfo;
+    componentSystemInfo.entitySystem = &entitySystem;
+    componentSystemInfo.chunkSize = config.GetVariable<int>("Components.ChunkSize", 16 * 1024);
+    componentSystemInfo.reserveSize = (std::size_t)config.GetVariable<int>("Components.ReserveMegabytes", 0) * 1024 * 1024;
+    componentSystemInfo.hugePages = config.GetVariable<bool>("Components.HugePages", false);
+
+    Game::ComponentSystem componentSystem;
+
+    // Read settings of the physics world.
+    Game::PhysicsWorldInfo physicsWorldInfo;
+    physicsWorldInfo.entitySystem = &entitySystem;
+    physicsWorldInfo.gravity.y = config.GetVariable<float>("Physics.Gravity", -9.81f);
+    physicsWorldInfo.solverIterations = config.GetVariable<int>("Physics.SolverIterations", 8);
+    physicsWorldInfo.restitution = config.GetVariable<float>("Physics.Restitution", 0.2f);
+
+    Game::PhysicsWorld physicsWorld;
+
+    // Read settings of the particle system.
+    Graphics::ParticleSystemInfo particleSystemInfo;
+    particleSystemInfo.jobSystem = &jobSystem;
+
+    Graphics::ParticleSystem particleSystem;
+
+    // Read settings of the text renderer.
+    Graphics::TextRendererInfo textRendererInfo;
+    textRendererInfo.renderer = &renderer;
+    textRendererInfo.atlasSize = config.GetVariable<int>("Graphics.TextAtlasSize", 512);
+    textRendererInfo.capacity = config.GetVariable<int>("Graphics.TextCapacity", 16 * 1024);
+    textRendererInfo.layoutCapacity = config.GetVariable<int>("Graphics.TextLayoutCapacity", 1024);
+
+    Graphics::TextRenderer textRenderer;
+
+    // Read settings of the sprite batch.
+    Graphics::SpriteBatchInfo spriteBatchInfo;
+    spriteBatchInfo.renderer = &renderer;
+    spriteBatchInfo.componentSystem = &componentSystem;
+    spriteBatchInfo.jobSystem = &jobSystem;
+    spriteBatchInfo.programCache = &programCache;
+    spriteBatchInfo.capacity = config.GetVariable<int>("Graphics.SpriteCapacity", 64 * 1024);
+    spriteBatchInfo.gpuCulling = config.GetVariable<bool>("Graphics.GpuCulling", false);
+    spriteBatchInfo.occlusionCulling = config.GetVariable<bool>("Graphics.OcclusionCulling", false);
+    spriteBatchInfo.temporalOcclusion = config.GetVariable<bool>("Graphics.TemporalOcclusion", false);
+    spriteBatchInfo.staticCellSize = config.GetVariable<float>("Graphics.StaticCellSize", 1024.0f);
+    spriteBatchInfo.particleSystem = &particleSystem;
+    spriteBatchInfo.textRenderer = &textRenderer;
+
+    Graphics::SpriteBatch spriteBatch;
+
+    // Read settings of the animation system.
+    Graphics::AnimationSystemInfo animationSystemInfo;
+    animationSystemInfo.renderer = &renderer;
+    animationSystemInfo.componentSystem = &componentSystem;
+    animationSystemInfo.jobSystem = &jobSystem;
+    animationSystemInfo.programCache = &programCache;
+    animationSystemInfo.boneCapacity = config.GetVariable<int>("Graphics.BoneCapacity", 8192);
+
+    Graphics::AnimationSystem animationSystem;
+
+    // Read settings of the readback service.
+    Graphics::ReadbackServiceInfo readbackServiceInfo;
+    readbackServiceInfo.renderer = &renderer;
+    readbackServiceInfo.window = &window;
+    readbackServiceInfo.slotCount = config.GetVariable<int>("Graphics.ReadbackSlots", 8);
+
+    Graphics::ReadbackService readbackService;
+
+    // Read settings of the audio mixer.
+    // Headless runs go without audio unless it is enabled explicitly.
+    bool audioEnabled = config.GetVariable<bool>("Audio.Enabled", !headless);
+
+    Audio::AudioMixerInfo audioMixerInfo;
+    audioMixerInfo.entitySystem = &entitySystem;
+    audioMixerInfo.componentSystem = &componentSystem;
+    audioMixerInfo.sampleRate = config.GetVariable<int>("Audio.SampleRate", 48000);
+    audioMixerInfo.blockSize = config.GetVariable<int>("Audio.BlockSize", 256);
+    audioMixerInfo.blockCount = config.GetVariable<int>("Audio.BlockCount", 3);
+    audioMixerInfo.voiceCapacity = config.GetVariable<int>("Audio.VoiceCapacity", 256);
+    audioMixerInfo.voiceBudget = config.GetVariable<int>("Audio.VoiceBudget", 32);
+    audioMixerInfo.commandCapacity = config.GetVariable<int>("Audio.CommandCapacity", 1024);
+    audioMixerInfo.nullDevice = config.GetVariable<bool>("Audio.NullDevice", headless);
+
+    Audio::AudioMixer audioMixer;
+
+#if defined(DEBUG_DRAW)
+    // Read settings of the debug draw.
+    Graphics::DebugDrawInfo debugDrawInfo;
+    debugDrawInfo.renderer = &renderer;
+    debugDrawInfo.programCache = &programCache;
+    debugDrawInfo.capacity = config.GetVariable<int>("Debug.DrawCapacity", 1024 * 1024);
+
+    Graphics::DebugDraw debugDraw;
+#endif
+
+    // Initialize the job system first, as it runs the other startup tasks.
+    if(!jobSystem.Initialize(jobSystemInfo))
+        return -1;
+
+    // Initialize subsystems in the order of their dependencies, with independent ones in parallel.
+    // Window, renderer and subsystems that record commands for the renderer stay on the main thread,
+    // which owns the OpenGL context, while files are opened and memory is allocated on workers.
+    System::StartupGraph startup;
+
+    startup.AddTask("LogFiles", [&]()
+    {
+        // Keep recent messages in a ring file that survives crashes.
+        if(flightRecorder && !Logger::StartFlightRecorder("Log.ring", (std::size_t)std::max<std::int64_t>(flightRecorderSize, 0)))
+            return false;
+
+        // Record high rate diagnostics in a binary log.
+        if(binaryLog && !Logger::BinaryLog::Initialize("Log.bin"))
+            return false;
+
+        return true;
+    });
+
+    int windowTask = startup.AddTask("Window", [&]()
+    {
+        return sessionReplay || headless || window.Initialize(windowInfo);
+    }, System::StartupThreads::Main);
+
+    int rendererTask = startup.AddTask("Renderer", [&]()
+    {
+        MemoryTracker::ScopedTag tag(MemoryTags::Render);
+
+        return sessionReplay || headless || renderer.Initialize(rendererInfo);
+    }, System::StartupThreads::Main);
+
+    int programCacheTask = startup.AddTask("ProgramCache", [&]()
+    {
+        return programCache.Initialize(programCacheInfo);
+    });
+
+    int assetManagerTask = startup.AddTask("AssetManager", [&]()
+    {
+        if(sessionReplay || headless)
+            return true;
+
+        if(!assetArchiveFilename.empty() && assetArchive.Open(assetArchiveFilename))
+        {
+            assetManagerInfo.archive = &assetArchive;
+        }
+
+        return assetManager.Initialize(assetManagerInfo);
+    }, System::StartupThreads::Main);
+
+    int inputStateTask = startup.AddTask("InputState", [&]()
+    {
+        return inputState.Initialize(&window);
+    });
+
+    startup.AddTask("FrameArena", [&]()
+    {
+        return frameArena.Initialize(frameArenaInfo);
+    });
+
+    startup.AddTask("FileService", [&]()
+    {
+        return fileService.Initialize(fileServiceInfo);
+    });
+
+    int entitySystemTask = startup.AddTask("EntitySystem", [&]()
+    {
+        return entitySystem.Initialize(entitySystemInfo);
+    });
+
+    int componentSystemTask = startup.AddTask("ComponentSystem", [&]()
+    {
+        return componentSystem.Initialize(componentSystemInfo);
+    });
+
+    int physicsWorldTask = startup.AddTask("PhysicsWorld", [&]()
+    {
+        return physicsWorld.Initialize(physicsWorldInfo);
+    });
+
+    startup.AddTask("ParticleSystem", [&]()
+    {
+        return particleSystem.Initialize(particleSystemInfo);
+    });
+
+    int textRendererTask = startup.AddTask("TextRenderer", [&]()
+    {
+        return sessionReplay || headless || textRenderer.Initialize(textRendererInfo);
+    }, System::StartupThreads::Main);
+
+    int spriteBatchTask = startup.AddTask("SpriteBatch", [&]()
+    {
+        return sessionReplay || headless || spriteBatch.Initialize(spriteBatchInfo);
+    }, System::StartupThreads::Main);
+
+    int animationSystemTask = startup.AddTask("AnimationSystem", [&]()
+    {
+        return sessionReplay || headless || animationSystem.Initialize(animationSystemInfo);
+    }, System::StartupThreads::Main);
+
+    int readbackServiceTask = startup.AddTask("ReadbackService", [&]()
+    {
+        return sessionReplay || headless || readbackService.Initialize(readbackServiceInfo);
+    }, System::StartupThreads::Main);
+
+    int audioMixerTask = startup.AddTask("AudioMixer", [&]()
+    {
+        return !audioEnabled || audioMixer.Initialize(audioMixerInfo);
+    });
+
+    startup.AddDependency(rendererTask, windowTask);
+    startup.AddDependency(assetManagerTask, rendererTask);
+    startup.AddDependency(assetManagerTask, programCacheTask);
+    startup.AddDependency(inputStateTask, windowTask);
+    startup.AddDependency(componentSystemTask, entitySystemTask);
+    startup.AddDependency(physicsWorldTask, entitySystemTask);
+    startup.AddDependency(textRendererTask, rendererTask);
+    startup.AddDependency(spriteBatchTask, rendererTask);
+    startup.AddDependency(spriteBatchTask, programCacheTask);
+    startup.AddDependency(spriteBatchTask, componentSystemTask);
+    startup.AddDependency(animationSystemTask, rendererTask);
+    startup.AddDependency(animationSystemTask, programCacheTask);
+    startup.AddDependency(animationSystemTask, componentSystemTask);
+    startup.AddDependency(readbackServiceTask, rendererTask);
+    startup.AddDependency(audioMixerTask, componentSystemTask);
+
+#if defined(DEBUG_DRAW)
+    int debugDrawTask = startup.AddTask("DebugDraw", [&]()
+    {
+        return sessionReplay || headless || debugDraw.Initialize(debugDrawInfo);
+    }, System::StartupThreads::Main);
+
+    startup.AddDependency(debugDrawTask, rendererTask);
+    startup.AddDependency(debugDrawTask, programCacheTask);
+#endif
+
+    bool parallelStartup = config.GetVariable<bool>("Startup.Parallel", true);
+    bool startupSucceeded = startup.Run(parallelStartup ? &jobSystem : nullptr);
+
+    if(config.GetVariable<bool>("Startup.LogTimes", false))
+    {
+        startup.LogTimes();
+    }
+
+    if(!startupSucceeded)
+        return -1;
+
+    // Take over the entity system from the worker that may have initialized it,
+    // as the main loop changes entities from this thread.
+    entitySystem.SetOwnerThread();
+
+    // Bake sprites of static entities created while loading.
+    componentSystem.ProcessCommands();
+    spriteBatch.BakeStatic(renderer.GetCommands());
+
+#if defined(DEBUG_DRAW)
+    // Let debug draw macros add primitives from any thread until shutdown.
+    Graphics::DebugDraw::SetGlobal(&debugDraw);
+    SCOPE_GUARD(Graphics::DebugDraw::SetGlobal(nullptr));
+#endif
+
+    // Create the system scheduler.
+    Game::SystemScheduler systemScheduler;
+
+    // Spawn and destroy entities with a fixed seed, so every training run
+    // takes the same paths through entity commands and event dispatch.
+    // Played back sessions are already deterministic and are used as they are.
+    std::deque<Game::EntityHandle> trainingEntities;
+    std::mt19937 trainingRandom(1234);
+
+    if(training && !sessionReplay)
+    {
+        int population = config.GetVariable<int>("Training.Population", 10000);
+        int churn = config.GetVariable<int>("Training.Churn", 200);
+
+        // Creates and destroys entities directly, which is only allowed on the thread that
+        // owns the entity system, so it must stay the only system of its level.
+        systemScheduler.AddSystem("Training", 0,
+            Game::ComponentTypes::GetSignature<Game::Transform>(),
+            [&, population, churn]()
+            {
+                std::uniform_real_distribution<float> position(0.0f, 1024.0f);
+                std::uniform_real_distribution<float> step(-1.0f, 1.0f);
+
+                // Replace the oldest entities once the population is reached.
+                while(!trainingEntities.empty() && (int)trainingEntities.size() + churn > population)
+                {
+                    entitySystem.DestroyEntity(trainingEntities.front());
+                    trainingEntities.pop_front();
+                }
+
+                for(int i = 0; i < churn; ++i)
+                {
+                    Game::Transform transform;
+                    transform.position = glm::vec3(position(trainingRandom), position(trainingRandom), 0.0f);
+
+                    Game::EntityHandle entity = entitySystem.CreateEntity();
+                    componentSystem.AddComponent(entity, transform);
+                    trainingEntities.push_back(entity);
+                }
+
+                // Move entities that have been created.
+                componentSystem.ForEach<Game::Transform>([&](const Game::EntityHandle& entity, Game::Transform& transform)
+                {
+                    transform.position.x += step(trainingRandom);
+                    transform.position.y += step(trainingRandom);
+                });
+            });
+    }
+
+    // Initialize the game loop.
+    Game::GameLoopInfo gameLoopInfo;
+    gameLoopInfo.tickRate = config.GetVariable<int>("Simulation.TickRate", 60);
+    gameLoopInfo.maximumSubsteps = config.GetVariable<int>("Simulation.MaximumSubsteps", 5);
+    gameLoopInfo.maximumFrameTime = config.GetVariable<float>("Simulation.MaximumFrameTime", 0.25f);
+
+    Game::GameLoop gameLoop;
+    if(!gameLoop.Initialize(gameLoopInfo))
         return -1;
 
+    // Save the world incrementally in the background, if a save file is set.
+    Game::WorldPersistenceInfo worldPersistenceInfo;
+    worldPersistenceInfo.entitySystem = &entitySystem;
+    worldPersistenceInfo.componentSystem = &componentSystem;
+    worldPersistenceInfo.filename = config.GetVariable<std::string>("World.SaveFilename", "");
+    worldPersistenceInfo.compactInterval = config.GetVariable<int>("World.CompactInterval", 32);
+
+    int worldSaveInterval = config.GetVariable<int>("World.SaveInterval", 600);
+
+    Game::WorldPersistence worldPersistence;
+
+    if(!worldPersistenceInfo.filename.empty() && worldSaveInterval > 0)
+    {
+        if(!worldPersistence.Initialize(worldPersistenceInfo))
+            return -1;
+    }
+
+    // Measure phases of frames and capture hitches.
+    System::FrameStatisticsInfo frameStatisticsInfo;
+    frameStatisticsInfo.windowSize = config.GetVariable<int>("Statistics.WindowSize", 600);
+    frameStatisticsInfo.hitchThreshold = config.GetVariable<double>("Statistics.HitchThreshold", 0.1);
+    frameStatisticsInfo.profiler = profiler;
+    frameStatisticsInfo.hitchTracePrefix = config.GetVariable<std::string>("Statistics.HitchTracePrefix", "Hitch");
+    frameStatisticsInfo.hitchTraceLimit = config.GetVariable<int>("Statistics.HitchTraceLimit", 8);
+
+    System::FrameStatistics frameStatistics;
+    if(!frameStatistics.Initialize(frameStatisticsInfo))
+        return -1;
+
+    // Inspect memory layout of component storage at an interval of frames.
+    Game::MemoryLayoutInspectorInfo memoryLayoutInfo;
+    memoryLayoutInfo.entitySystem = &entitySystem;
+    memoryLayoutInfo.componentSystem = &componentSystem;
+    memoryLayoutInfo.systemScheduler = &systemScheduler;
+
+    Game::MemoryLayoutInspector memoryLayout;
+    if(!memoryLayout.Initialize(memoryLayoutInfo))
+        return -1;
+
+    int memoryLayoutInterval = config.GetVariable<int>("Debug.LayoutInterval", 60);
+    int memoryLayoutFrames = 0;
+
+    // Export server telemetry for fleet dashboards, if a metrics file is set.
+    System::MetricsInfo metricsInfo;
+    metricsInfo.filename = config.GetVariable<std::string>("Metrics.Filename", "");
+    metricsInfo.format = config.GetVariable<std::string>("Metrics.Format", "prometheus") == "statsd" ? System::MetricsFormats::StatsD : System::MetricsFormats::Prometheus;
+    metricsInfo.prefix = config.GetVariable<std::string>("Metrics.Prefix", "server_");
+    metricsInfo.exportInterval = config.GetVariable<double>("Metrics.ExportInterval", 10.0);
+
+    bool metricsEnabled = !metricsInfo.filename.empty();
+
+    System::Metrics metrics;
+    DispatchProfile createProfile("EntitySystem::Events::Create");
+    DispatchProfile destroyProfile("EntitySystem::Events::Destroy");
+
+    int tickCountMetric = System::Metrics::InvalidMetric;
+    int tickTimeMetric = System::Metrics::InvalidMetric;
+    int entityCountMetric = System::Metrics::InvalidMetric;
+    int commandQueueMetric = System::Metrics::InvalidMetric;
+    int createCallsMetric = System::Metrics::InvalidMetric;
+    int destroyCallsMetric = System::Metrics::InvalidMetric;
+    int logBacklogMetric = System::Metrics::InvalidMetric;
+    int inputLatencyMetric = System::Metrics::InvalidMetric;
+    int chunkBytesMetric = System::Metrics::InvalidMetric;
+    int chunkUsedBytesMetric = System::Metrics::InvalidMetric;
+    int poolBytesMetric = System::Metrics::InvalidMetric;
+    int poolUsedBytesMetric = System::Metrics::InvalidMetric;
+    int freeHandlesMetric = System::Metrics::InvalidMetric;
+    int locationHolesMetric = System::Metrics::InvalidMetric;
+    std::vector<int> systemReadBytesMetrics;
+    std::vector<int> systemWrittenBytesMetrics;
+
+    if(metricsEnabled)
+    {
+        if(!metrics.Initialize(metricsInfo))
+            return -1;
+
+        tickCountMetric = metrics.AddCounter("ticks_total", "Number of simulated ticks.");
+        tickTimeMetric = metrics.AddHistogram("tick_seconds", "Time spent simulating a tick.", { 0.001, 0.002, 0.004, 0.008, 0.016, 0.033, 0.066, 0.133 });
+        entityCountMetric = metrics.AddGauge("entities", "Number of active entities.");
+        commandQueueMetric = metrics.AddGauge("entity_command_queue_high_water", "Highest number of queued entity commands during the last frame.");
+        createCallsMetric = metrics.AddCounter("entity_create_receiver_calls_total", "Number of receiver calls of entity create events.");
+        destroyCallsMetric = metrics.AddCounter("entity_destroy_receiver_calls_total", "Number of receiver calls of entity destroy events.");
+        logBacklogMetric = metrics.AddGauge("log_backlog", "Number of log messages waiting to be written.");
+        inputLatencyMetric = metrics.AddHistogram("input_latency_seconds", "Time from the arrival of input to the present that reflected it.", { 0.008, 0.016, 0.033, 0.050, 0.066, 0.100, 0.150 });
+
+        chunkBytesMetric = metrics.AddGauge("component_chunk_bytes", "Bytes allocated for component chunks.");
+        chunkUsedBytesMetric = metrics.AddGauge("component_chunk_used_bytes", "Bytes of component chunks used by entities.");
+        poolBytesMetric = metrics.AddGauge("component_pool_bytes", "Bytes allocated for inspected component pools.");
+        poolUsedBytesMetric = metrics.AddGauge("component_pool_used_bytes", "Bytes of inspected component pools used by components.");
+        freeHandlesMetric = metrics.AddGauge("entity_free_handles", "Number of unused entries in the entity handle table.");
+        locationHolesMetric = metrics.AddGauge("component_location_holes", "Number of component location entries of entities without components.");
+
+        // Estimate bytes touched by each system, with names reduced to metric name characters.
+        for(int system = 0; system < systemScheduler.GetSystemCount(); ++system)
+        {
+            std::string name = systemScheduler.GetSystemName(system);
+
+            for(char& character : name)
+            {
+                character = std::isalnum((unsigned char)character) ? (char)std::tolower((unsigned char)character) : '_';
+            }
+
+            systemReadBytesMetrics.push_back(metrics.AddGauge("system_" + name + "_read_bytes", "Estimated bytes of cache lines read by a system per frame."));
+            systemWrittenBytesMetrics.push_back(metrics.AddGauge("system_" + name + "_written_bytes", "Estimated bytes of cache lines written by a system per frame."));
+        }
+
+        // Count receiver calls of entity events.
+        entitySystem.events.create.SetProfile(&createProfile);
+        entitySystem.events.destroy.SetProfile(&destroyProfile);
+    }
+
+    SCOPE_GUARD
+    (
+        entitySystem.events.create.SetProfile(nullptr);
+        entitySystem.events.destroy.SetProfile(nullptr);
+    );
+
+    // Collects metrics of the last frame.
+    auto updateMetrics = [&]()
+    {
+        if(!metricsEnabled)
+            return;
+
+        Game::EntitySystemStatistics statistics = entitySystem.GetStatistics();
+        entitySystem.ResetStatistics();
+
+        metrics.SetGauge(entityCountMetric, entitySystem.GetEntityCount());
+        metrics.SetGauge(commandQueueMetric, statistics.commandQueueHighWater);
+        metrics.SetGauge(logBacklogMetric, (double)Logger::GetBacklog());
+
+        metrics.Increment(createCallsMetric, createProfile.GetTotalInvocations());
+        metrics.Increment(destroyCallsMetric, destroyProfile.GetTotalInvocations());
+
+        createProfile.Reset();
+        destroyProfile.Reset();
+    };
+
+    // Inspects memory layout once per interval and exports it.
+    auto inspectMemoryLayout = [&]()
+    {
+        if(memoryLayoutInterval <= 0 || ++memoryLayoutFrames < memoryLayoutInterval)
+            return;
+
+        memoryLayoutFrames = 0;
+
+        const Game::MemoryLayoutReport& report = memoryLayout.Inspect();
+
+        if(!metricsEnabled)
+            return;
+
+        metrics.SetGauge(chunkBytesMetric, (double)report.chunkAllocatedBytes);
+        metrics.SetGauge(chunkUsedBytesMetric, (double)report.chunkUsedBytes);
+        metrics.SetGauge(poolBytesMetric, (double)report.poolAllocatedBytes);
+        metrics.SetGauge(poolUsedBytesMetric, (double)report.poolUsedBytes);
+        metrics.SetGauge(freeHandlesMetric, report.freeHandleCount);
+        metrics.SetGauge(locationHolesMetric, report.locationHoles);
+
+        for(std::size_t system = 0; system < systemReadBytesMetrics.size() && system < report.systems.size(); ++system)
+        {
+            metrics.SetGauge(systemReadBytesMetrics[system], (double)report.systems[system].readBytes);
+            metrics.SetGauge(systemWrittenBytesMetrics[system], (double)report.systems[system].writtenBytes);
+        }
+    };
+
+    // Show live performance data over frames, toggled with a key.
+    Graphics::PerformanceOverlay performanceOverlay;
+
+    if(!headless && !sessionReplay)
+    {
+        Graphics::PerformanceOverlayInfo performanceOverlayInfo;
+        performanceOverlayInfo.renderer = &renderer;
+        performanceOverlayInfo.programCache = &programCache;
+        performanceOverlayInfo.window = &window;
+        performanceOverlayInfo.frameStatistics = &frameStatistics;
+        performanceOverlayInfo.entitySystem = &entitySystem;
+        performanceOverlayInfo.jobSystem = &jobSystem;
+        performanceOverlayInfo.memoryLayout = &memoryLayout.GetReport();
+        performanceOverlayInfo.toggleKey = config.GetVariable<int>("Debug.OverlayKey", GLFW_KEY_F3);
+        performanceOverlayInfo.frameBudget = config.GetVariable<float>("Debug.OverlayFrameBudget", 1.0f / 60.0f);
+        performanceOverlayInfo.visible = config.GetVariable<bool>("Debug.OverlayVisible", false);
+
+        if(!performanceOverlay.Initialize(performanceOverlayInfo))
+            return -1;
+    }
+
+    // Chains checksums of simulation state after every tick of a frame.
+    Checksum frameChecksum;
+
+    // Advances the simulation in fixed ticks.
+    auto simulate = [&]()
+    {
+        frameChecksum = Checksum();
+
+        while(gameLoop.Tick())
+        {
+            System::Timer tickTimer;
+
+            {
+                System::FrameStatistics::ScopedPhase phase(&frameStatistics, System::FramePhases::Commands);
+
+                entitySystem.ProcessCommands();
+                componentSystem.ProcessCommands();
+            }
+
+            {
+                System::FrameStatistics::ScopedPhase phase(&frameStatistics, System::FramePhases::Simulation);
+
+                systemScheduler.Run(&jobSystem);
+                physicsWorld.Update((float)gameLoop.GetTickTime(), &jobSystem);
+            }
+
+            if(worldPersistence.IsInitialized() && gameLoop.GetTickIndex() % worldSaveInterval == 0)
+            {
+                worldPersistence.Save();
+            }
+
+            if(stateChecksums)
+            {
+                Checksum tickChecksum;
+                tickChecksum.Update(gameLoop.GetTickIndex());
+                entitySystem.UpdateChecksum(tickChecksum);
+                componentSystem.UpdateChecksum(tickChecksum);
+                physicsWorld.UpdateChecksum(tickChecksum);
+
+                frameChecksum.Update(tickChecksum.GetValue());
+            }
+
+            if(metricsEnabled)
+            {
+                metrics.Increment(tickCountMetric);
+                metrics.Observe(tickTimeMetric, tickTimer.Tick());
+            }
+        }
+    };
+
+    // Play back a recorded session at full speed.
+    if(sessionReplay)
+    {
+        Game::SessionPlayerInfo playerInfo;
+        playerInfo.filename = SessionFilename;
+        playerInfo.window = &window;
+        playerInfo.entitySystem = &entitySystem;
+        playerInfo.componentSystem = &componentSystem;
+        playerInfo.gameLoop = &gameLoop;
+
+        Game::SessionPlayer player;
+        if(!player.Initialize(playerInfo))
+            return -1;
+
+        System::Timer timer;
+        timer.Reset();
+
+        double frameTime = 0.0;
+        int divergedFrames = 0;
+
+        // Jump into the session by restoring the last keyframe before the frame
+        // and simulating forward from it, without comparing checksums.
+        int seekFrame = config.GetVariable<int>("Session.SeekFrame", 0);
+
+        if(seekFrame > 0)
+        {
+            if(!player.Seek(seekFrame))
+                return -1;
+
+            while(player.GetFrameCount() < seekFrame)
+            {
+                inputState.Update();
+
+                if(!player.PlayFrame(frameTime))
+                    break;
+
+                gameLoop.BeginFrame(frameTime);
+                simulate();
+            }
+
+            timer.Tick();
+
+            Log() << "Reached frame " << player.GetFrameCount() << " of " << player.GetFrameTotal() << " by seeking in " << timer.GetElapsedTime() << " seconds.";
+
+            timer.Reset();
+        }
+
+        int firstFrame = player.GetFrameCount();
+
+        while(true)
+        {
+            inputState.Update();
+
+            if(!player.PlayFrame(frameTime))
+                break;
+
+            gameLoop.BeginFrame(frameTime);
+            simulate();
+
+            // Compare the simulation state with the recorded one.
+            std::uint64_t recordedChecksum = 0;
+
+            if(stateChecksums && player.GetChecksum(recordedChecksum) && recordedChecksum != frameChecksum.GetValue())
+            {
+                if(divergedFrames == 0)
+                {
+                    LogWarning() << "Simulation diverged from the recorded session at frame " << player.GetFrameCount() << " before tick " << gameLoop.GetTickIndex() << ".";
+                }
+
+                divergedFrames += 1;
+            }
+        }
+
+        timer.Tick();
+
+        Log() << "Played back " << player.GetFrameCount() - firstFrame << " frames up to tick " << gameLoop.GetTickIndex() << " in " << timer.GetElapsedTime() << " seconds.";
+
+        if(divergedFrames != 0)
+        {
+            LogWarning() << "Simulation state differed in " << divergedFrames << " of " << player.GetFrameCount() - firstFrame << " played frames.";
+        }
+
+        return 0;
+    }
+
+    // Save screenshots once their pixels have been read back.
+    auto saveScreenshot = [](const Graphics::ReadbackService::Events::Completed& event)
+    {
+        if(!event.succeeded || event.type != Graphics::ReadbackTypes::Screenshot)
+            return;
+
+        std::string filename = "Screenshot-" + std::to_string(event.request) + ".tga";
+
+        if(Graphics::ReadbackService::SaveImage(filename, event.width, event.height, event.pixels))
+        {
+            Log() << "Saved a screenshot to \"" << filename << "\" file.";
+        }
+    };
+
+    // Publish events of the window and services on a bus, so modules can receive them by type.
+    EventBus eventBus;
+    eventBus.Forward(window.events.keyboardKey);
+    eventBus.Forward(window.events.mouseButton);
+    eventBus.Forward(window.events.resize);
+    eventBus.Forward(window.events.focus);
+    eventBus.Forward(readbackService.events.completed);
+
+    Receiver<void(const Graphics::ReadbackService::Events::Completed&)> screenshotReceiver;
+    screenshotReceiver.Bind(&saveScreenshot);
+    eventBus.Subscribe(screenshotReceiver);
+
+    // Record the session.
+    Game::SessionRecorder recorder;
+
+    if(sessionRecord)
+    {
+        Game::SessionRecorderInfo recorderInfo;
+        recorderInfo.window = &window;
+        recorderInfo.entitySystem = &entitySystem;
+        recorderInfo.componentSystem = &componentSystem;
+        recorderInfo.gameLoop = &gameLoop;
+        recorderInfo.keyframeInterval = config.GetVariable<int>("Session.KeyframeInterval", 1800);
+
+        if(!recorder.Initialize(recorderInfo))
+            return -1;
+    }
+
+    // Stop gracefully when interrupted.
+    std::signal(SIGINT, &StopHandler);
+    std::signal(SIGTERM, &StopHandler);
+
+    System::Timer runTimer;
+    runTimer.Reset();
+
+    // Latencies of input reflected by presented frames.
+    std::vector<double> inputLatencies;
+
     // Main loop.
-    while(window.IsOpen())
+    auto runMainLoop = [&]()
     {
-        window.ProcessEvents();
+        if(profiler != nullptr)
+        {
+            profiler->NameThread("Main");
+        }
+
+        while(!stopRequested)
+        {
+            // Free transient data of the previous frame, including
+            // scratch memory of jobs, as no jobs are running here.
+            frameArena.Reset();
+            jobSystem.ResetArenas();
+
+            // Check if the window is in the background.
+            bool background = !headless && backgroundThrottle && (window.IsIconified() || !window.IsFocused());
+
+            // Throttled frames would skew frame time statistics.
+            if(!background)
+            {
+                frameStatistics.BeginFrame();
+            }
+
+            if(headless)
+            {
+                if(tickLimit != 0 && gameLoop.GetTickIndex() >= tickLimit)
+                    break;
+            }
+            else
+            {
+                if(!window.IsOpen())
+                    break;
+
+                Graphics::FrameProfiler::CpuScope scope(profiler, "Events");
+                System::FrameStatistics::ScopedPhase phase(&frameStatistics, System::FramePhases::Events);
+
+                inputState.Update();
+
+                // Wait for events in the background, waking up early when one arrives.
+                if(background)
+                {
+                    window.WaitEvents(1.0 / backgroundFrameRate);
+                }
+                else
+                {
+                    window.ProcessEvents();
+                }
+            }
+
+            {
+                MemoryTracker::ScopedTag tag(MemoryTags::Config);
+                config.ProcessChanges();
+            }
+
+            fileService.ProcessCompletions();
+
+            // Advance the simulation in fixed ticks.
+            // Headless runs add a tick per frame instead of waiting for real time.
+            if(headless)
+            {
+                gameLoop.BeginFrame(gameLoop.GetTickTime());
+            }
+            else
+            {
+                gameLoop.BeginFrame();
+            }
+
+            {
+                Graphics::FrameProfiler::CpuScope scope(profiler, "Simulate");
+                MemoryTracker::ScopedTag tag(MemoryTags::Entity);
+                simulate();
+            }
+
+            inspectMemoryLayout();
+            updateMetrics();
+
+            // Hear the world from the center of the window, as sprites are drawn in window coordinates.
+            if(!headless)
+            {
+                audioMixer.SetListener(glm::vec3(window.GetWidth() * 0.5f, window.GetHeight() * 0.5f, 0.0f));
+            }
+
+            // Send positions of sound emitters and queued voice commands to the mixer thread.
+            audioMixer.Update();
+
+            if(sessionRecord)
+            {
+                if(stateChecksums)
+                {
+                    recorder.RecordChecksum(frameChecksum.GetValue());
+                }
+
+                recorder.EndFrame(gameLoop.GetFrameTime());
+            }
+
+            // Render the frame, unless nobody can see it.
+            if(!headless && !background)
+            {
+                {
+                    Graphics::FrameProfiler::CpuScope scope(profiler, "Draw");
+                    System::FrameStatistics::ScopedPhase phase(&frameStatistics, System::FramePhases::Render);
+                    MemoryTracker::ScopedTag tag(MemoryTags::Render);
+
+                    Graphics::CommandBuffer& commands = renderer.GetCommands();
+                    assetManager.Update(commands);
+
+                    commands.BeginGpuTimer(profiler, "Clear");
+                    commands.SetViewport(0, 0, window.GetWidth(), window.GetHeight());
+                    commands.Clear(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+                    commands.EndGpuTimer(profiler);
 
-        entitySystem.ProcessCommands();
+                    // Draw sprites in window coordinates.
+                    glm::mat4 viewProjection = glm::ortho(0.0f, (float)window.GetWidth(), 0.0f, (float)window.GetHeight(), -1.0f, 1.0f);
 
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                    // Particles are only simulated while they can be seen.
+                    particleSystem.Update((float)gameLoop.GetFrameTime());
 
-        window.Present();
+                    // Queue debug text right aligned in the corner opposite to the overlay.
+                    // The sprite batch draws it after sprites, in the same draw as all other text.
+                    if(performanceOverlay.IsVisible())
+                    {
+                        const float textSize = 10.0f;
+
+                        std::string lines[] =
+                        {
+                            "Entities: " + std::to_string(entitySystem.GetEntityCount()),
+                            "Sprites: " + std::to_string(spriteBatch.GetSpriteCount()),
+                            "Particles: " + std::to_string(spriteBatch.GetParticleCount()),
+                            "Batches: " + std::to_string(spriteBatch.GetBatchCount()),
+                        };
+
+                        float top = (float)window.GetHeight() - 8.0f;
+
+                        for(const std::string& line : lines)
+                        {
+                            float width = textRenderer.MeasureText(line, textSize).x;
+                            textRenderer.AddText(line, glm::vec2((float)window.GetWidth() - 8.0f - width, top), textSize);
+                            top -= textSize;
+                        }
+                    }
+
+                    commands.BeginGpuTimer(profiler, "Sprites");
+                    commands.Enable(GL_BLEND);
+                    commands.SetBlendFunction(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                    spriteBatch.Draw(commands, viewProjection);
+                    commands.EndGpuTimer(profiler);
+
+                    // Animate skinned meshes, which are also only sampled while they can be seen.
+                    animationSystem.Update((float)gameLoop.GetFrameTime());
+
+                    commands.BeginGpuTimer(profiler, "Animation");
+                    animationSystem.Draw(commands, viewProjection);
+                    commands.EndGpuTimer(profiler);
+
+#if defined(DEBUG_DRAW)
+                    // Draw primitives added during the frame over sprites.
+                    commands.BeginGpuTimer(profiler, "DebugDraw");
+                    debugDraw.Draw(commands, viewProjection);
+                    commands.EndGpuTimer(profiler);
+#endif
+
+                    // Draw the performance overlay over everything else.
+                    commands.BeginGpuTimer(profiler, "Overlay");
+                    performanceOverlay.Draw(commands, window.GetWidth(), window.GetHeight());
+                    commands.EndGpuTimer(profiler);
+
+                    // Read the frame back for a screenshot without waiting for it.
+                    if(inputState.IsKeyPressed(GLFW_KEY_F12))
+                    {
+                        readbackService.RequestScreenshot(commands);
+                    }
+
+                    readbackService.ProcessCompletions(commands);
+                }
+
+                {
+                    // Waits while the render thread is busy with the previous frame.
+                    Graphics::FrameProfiler::CpuScope scope(profiler, "Submit");
+                    System::FrameStatistics::ScopedPhase phase(&frameStatistics, System::FramePhases::Present);
+                    renderer.Submit();
+                }
+            }
+            else if(profiler != nullptr)
+            {
+                // Frames not submitted to the render thread are marked here.
+                profiler->MarkFrame();
+            }
+
+            // Record latencies of input reflected by frames presented so far.
+            window.CollectInputLatencies(inputLatencies);
+
+            for(double inputLatency : inputLatencies)
+            {
+                frameStatistics.AddInputLatency(inputLatency);
+                metrics.Observe(inputLatencyMetric, inputLatency);
+            }
+
+            inputLatencies.clear();
+
+            // Latch allocations of the frame and check memory budgets.
+            MemoryTracker::EndFrame();
+
+            // Record frame times and check for a hitch.
+            frameStatistics.EndFrame();
+        }
+    };
+
+    // Pump window events on this thread and run the main loop on another.
+    if(windowInfo.eventThread && !headless)
+    {
+        std::thread mainLoopThread([&]()
+        {
+            runMainLoop();
+
+            // Stop pumping events.
+            window.Close();
+        });
+
+        while(window.IsOpen())
+        {
+            window.PumpEvents();
+        }
+
+        mainLoopThread.join();
+    }
+    else
+    {
+        runMainLoop();
+    }
+
+    if(headless)
+    {
+        runTimer.Tick();
+
+        Log() << "Simulated " << gameLoop.GetTickIndex() << " ticks in " << runTimer.GetElapsedTime() << " seconds.";
+    }
+
+    frameStatistics.LogSummary();
+
+    // Save the recorded session.
+    if(sessionRecord)
+    {
+        recorder.Save(SessionFilename);
+    }
+
+    // Save binaries of programs linked during the run.
+    programCache.Save();
+
+    // Save the profiled timeline.
+    if(profiler != nullptr)
+    {
+        profiler->WriteTrace(config.GetVariable<std::string>("Profiler.TraceFile", "Profile.json"));
     }
 
     return 0;
@@ -5,11 +5,30 @@
 //
 
 #include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <ctime>
+#include <csignal>
+#include <cstring>
+#include <cmath>
+#include <exception>
 #include <typeindex>
+#include <type_traits>
 #include <memory>
 #include <numeric>
+#include <limits>
+#include <iterator>
 #include <algorithm>
 #include <functional>
+#include <tuple>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <random>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
@@ -17,7 +36,9 @@
 #include <string>
 #include <vector>
 #include <queue>
+#include <deque>
 #include <map>
+#include <bitset>
 
 //
 // External
@@ -30,8 +51,14 @@
     #include <windows.h>
 #endif
 
+// Compiler intrinsics
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
 // GLM
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
 // GLEW
 #include <gl/glew.h>
@@ -48,6 +75,7 @@
 #include "Common/Utility.hpp"
 #include "Common/NonCopyable.hpp"
 #include "Common/ScopeGuard.hpp"
+#include "Common/RingBuffer.hpp"
 #include "Common/Delegate.hpp"
 #include "Common/Receiver.hpp"
 #include "Common/Dispatcher.hpp"
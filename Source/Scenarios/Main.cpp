@@ -0,0 +1,168 @@
+#include "Precompiled.hpp"
+#include "ScenarioRunner.hpp"
+#include "Scenarios.hpp"
+
+namespace
+{
+    // Writes percentiles in milliseconds as a JSON object.
+    void WritePercentiles(std::ostream& output, const System::FrameStatistics::Percentiles& percentiles)
+    {
+        output << "{ \"p50\": " << percentiles.p50 * 1000.0;
+        output << ", \"p95\": " << percentiles.p95 * 1000.0;
+        output << ", \"p99\": " << percentiles.p99 * 1000.0;
+        output << ", \"max\": " << percentiles.maximum * 1000.0 << " }";
+    }
+
+    // Writes scenario results as a JSON document.
+    void WriteJson(std::ostream& output, const std::vector<Scenarios::ScenarioResult>& results)
+    {
+        output << "{\n";
+        output << "  \"unit\": \"milliseconds\",\n";
+        output << "  \"scenarios\": [\n";
+
+        for(std::size_t i = 0; i < results.size(); ++i)
+        {
+            const Scenarios::ScenarioResult& result = results[i];
+
+            output << "    {\n";
+            output << "      \"name\": \"" << result.name << "\",\n";
+            output << "      \"frames\": " << result.frameCount << ",\n";
+            output << "      \"ticks\": " << result.tickCount << ",\n";
+            output << "      \"entities\": " << result.entityCount << ",\n";
+            output << "      \"sprites\": " << result.spriteCount << ",\n";
+            output << "      \"batches\": " << result.batchCount << ",\n";
+            output << "      \"frame\": ";
+            WritePercentiles(output, result.frameTimes);
+            output << ",\n";
+            output << "      \"phases\": {\n";
+
+            for(int phase = 0; phase < System::FramePhases::Count; ++phase)
+            {
+                output << "        \"" << System::FrameStatistics::GetPhaseName((System::FramePhases::Type)phase) << "\": ";
+                WritePercentiles(output, result.phaseTimes[phase]);
+                output << (phase + 1 < System::FramePhases::Count ? ",\n" : "\n");
+            }
+
+            output << "      }\n";
+            output << "    }" << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+
+        output << "  ]\n";
+        output << "}\n";
+    }
+
+    // Prints a row of percentiles in milliseconds.
+    void PrintPercentiles(const char* name, const System::FrameStatistics::Percentiles& percentiles)
+    {
+        std::cout << "  " << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(3);
+        std::cout << std::setw(10) << percentiles.p50 * 1000.0;
+        std::cout << std::setw(10) << percentiles.p95 * 1000.0;
+        std::cout << std::setw(10) << percentiles.p99 * 1000.0;
+        std::cout << std::setw(10) << percentiles.maximum * 1000.0 << "\n";
+    }
+
+    // Prints a scenario result as a table.
+    void PrintResult(const Scenarios::ScenarioResult& result)
+    {
+        std::cout << "\n" << result.name << ": " << result.frameCount << " frames, " << result.entityCount << " entities, ";
+        std::cout << std::fixed << std::setprecision(0) << result.spriteCount << " sprites and ";
+        std::cout << std::setprecision(1) << result.batchCount << " batches per frame\n";
+
+        std::cout << "  " << std::left << std::setw(12) << "Phase (ms)" << std::right;
+        std::cout << std::setw(10) << "p50" << std::setw(10) << "p95" << std::setw(10) << "p99" << std::setw(10) << "max" << "\n";
+
+        PrintPercentiles("Frame", result.frameTimes);
+
+        for(int phase = 0; phase < System::FramePhases::Count; ++phase)
+        {
+            PrintPercentiles(System::FrameStatistics::GetPhaseName((System::FramePhases::Type)phase), result.phaseTimes[phase]);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Build::Initialize();
+    Debug::Initialize();
+    Logger::Initialize();
+
+    // Parse command line arguments.
+    Scenarios::ScenarioRunnerInfo runnerInfo;
+    std::string filter;
+    std::string jsonFilename;
+    int frameCount = 600;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+
+        if(std::strcmp(argv[i], "--scenario") == 0 && hasValue)
+        {
+            filter = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--frames") == 0 && hasValue)
+        {
+            frameCount = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if(std::strcmp(argv[i], "--workers") == 0 && hasValue)
+        {
+            runnerInfo.workerCount = std::atoi(argv[++i]);
+        }
+        else if(std::strcmp(argv[i], "--json") == 0 && hasValue)
+        {
+            jsonFilename = argv[++i];
+        }
+        else
+        {
+            std::cout << "Usage: Scenarios [--scenario <name>] [--frames <count>] [--workers <count>] [--json <file>]\n";
+            return -1;
+        }
+    }
+
+    // Initialize the scenario runner.
+    Scenarios::ScenarioRunner runner;
+    if(!runner.Initialize(runnerInfo))
+        return -1;
+
+    // Run scenarios whose names start with the filter.
+    std::vector<Scenarios::Scenario> scenarios;
+    scenarios.push_back(Scenarios::CreateMovingEntities(100000));
+    scenarios.push_back(Scenarios::CreateSpawnChurn(50000, 10000));
+    scenarios.push_back(Scenarios::CreateInputStorm(10000, 2000));
+    scenarios.push_back(Scenarios::CreateEventOrder(10000, 8, 1000));
+
+    std::vector<Scenarios::ScenarioResult> results;
+
+    for(Scenarios::Scenario& scenario : scenarios)
+    {
+        if(scenario.name.compare(0, filter.size(), filter) != 0)
+            continue;
+
+        scenario.frameCount = frameCount;
+
+        results.push_back(runner.Run(scenario));
+        PrintResult(results.back());
+    }
+
+    if(results.empty())
+    {
+        LogError() << "No scenario matches the \"" << filter << "\" name.";
+        return -1;
+    }
+
+    // Write machine readable results.
+    if(!jsonFilename.empty())
+    {
+        std::ofstream file(jsonFilename, std::ios::trunc);
+
+        if(!file.is_open())
+        {
+            LogError() << "Couldn't open the \"" << jsonFilename << "\" file.";
+            return -1;
+        }
+
+        WriteJson(file, results);
+    }
+
+    return 0;
+}
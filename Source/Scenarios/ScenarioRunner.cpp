@@ -0,0 +1,506 @@
+#include "Precompiled.hpp"
+#include "ScenarioRunner.hpp"
+#include "Game/Transform.hpp"
+using namespace Scenarios;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize the scenario runner! "
+
+    // Number of textures that spawned sprites are spread between.
+    const int TextureCount = 8;
+
+    // Speed of the camera in view sizes per second.
+    const float CameraSpeed = 0.5f;
+
+    // Chunk of entities updated by the movement system.
+    struct MovementChunk
+    {
+        int count;
+        Game::Transform* transforms;
+        Velocity* velocities;
+    };
+}
+
+Scenario::Scenario() :
+    frameCount(600)
+{
+}
+
+ScenarioResult::ScenarioResult() :
+    frameCount(0),
+    tickCount(0),
+    entityCount(0),
+    spriteCount(0.0),
+    batchCount(0.0)
+{
+}
+
+ScenarioRunnerInfo::ScenarioRunnerInfo() :
+    workerCount(-1),
+    viewSize(1920.0f, 1080.0f),
+    worldSize(8192.0f, 8192.0f)
+{
+}
+
+ScenarioRunner::ScenarioRunner() :
+    m_cameraPosition(0.0f, 0.0f),
+    m_cameraZoom(1.0f),
+    m_spriteTotal(0),
+    m_batchTotal(0),
+    m_initialized(false)
+{
+}
+
+ScenarioRunner::~ScenarioRunner()
+{
+    this->Cleanup();
+}
+
+void ScenarioRunner::Cleanup()
+{
+    // Cleanup subsystems in reverse order.
+    m_frameStatistics.Cleanup();
+    m_gameLoop.Cleanup();
+    m_systemScheduler.Cleanup();
+    m_componentSystem.Cleanup();
+    m_entitySystem.Cleanup();
+    m_inputState.Cleanup();
+    m_jobSystem.Cleanup();
+
+    // Free rendering state.
+    m_commands.Cleanup();
+    m_culler.Clear();
+    Utility::ClearContainer(m_instances);
+    Utility::ClearContainer(m_staging);
+    Utility::ClearContainer(m_keys);
+
+    // Reset the camera.
+    m_cameraPosition = glm::vec2(0.0f, 0.0f);
+    m_cameraZoom = 1.0f;
+
+    m_spriteTotal = 0;
+    m_batchTotal = 0;
+
+    m_info = ScenarioRunnerInfo();
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool ScenarioRunner::Initialize(const ScenarioRunnerInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            m_initialized = true;
+            this->Cleanup();
+        }
+    );
+
+    // Validate arguments.
+    if(info.viewSize.x <= 0.0f || info.viewSize.y <= 0.0f)
+    {
+        LogError() << LogInitializeError() << "Invalid view size.";
+        return false;
+    }
+
+    if(info.worldSize.x <= 0.0f || info.worldSize.y <= 0.0f)
+    {
+        LogError() << LogInitializeError() << "Invalid world size.";
+        return false;
+    }
+
+    m_info = info;
+
+    // Initialize the job system.
+    JobSystemInfo jobSystemInfo;
+    jobSystemInfo.workerCount = info.workerCount;
+
+    if(!m_jobSystem.Initialize(jobSystemInfo))
+    {
+        LogError() << LogInitializeError() << "Couldn't initialize the job system.";
+        return false;
+    }
+
+    // Build the input state from events sent to the uninitialized window.
+    if(!m_inputState.Initialize(&m_window))
+    {
+        LogError() << LogInitializeError() << "Couldn't initialize the input state.";
+        return false;
+    }
+
+    // Add systems that run on every tick.
+    m_systemScheduler.AddSystem("Movement",
+        Game::ComponentTypes::GetSignature<Velocity>(),
+        Game::ComponentTypes::GetSignature<Game::Transform>(),
+        [this]() { this->UpdateMovement(); });
+
+    m_systemScheduler.AddSystem("Camera", 0, 0,
+        [this]() { this->UpdateCamera(); });
+
+    // Success!
+    return m_initialized = true;
+}
+
+ScenarioResult ScenarioRunner::Run(const Scenario& scenario)
+{
+    ScenarioResult result;
+    result.name = scenario.name;
+
+    if(!m_initialized)
+        return result;
+
+    // Start with an empty world, so scenarios do not affect each other.
+    m_componentSystem.Cleanup();
+
+    Game::EntitySystemInfo entitySystemInfo;
+    entitySystemInfo.initialCapacity = 64 * 1024;
+
+    if(!m_entitySystem.Initialize(entitySystemInfo))
+        return result;
+
+    Game::ComponentSystemInfo componentSystemInfo;
+    componentSystemInfo.entitySystem = &m_entitySystem;
+
+    if(!m_componentSystem.Initialize(componentSystemInfo))
+        return result;
+
+    if(!m_gameLoop.Initialize())
+        return result;
+
+    // Keep every frame of the run and never report hitches.
+    System::FrameStatisticsInfo frameStatisticsInfo;
+    frameStatisticsInfo.windowSize = std::max(scenario.frameCount, 1);
+    frameStatisticsInfo.hitchThreshold = 0.0;
+
+    if(!m_frameStatistics.Initialize(frameStatisticsInfo))
+        return result;
+
+    m_cameraPosition = m_info.worldSize * 0.5f;
+    m_cameraZoom = 1.0f;
+
+    m_random.seed(1234);
+
+    m_spriteTotal = 0;
+    m_batchTotal = 0;
+
+    // Populate the world.
+    if(scenario.setup)
+    {
+        scenario.setup(*this);
+    }
+
+    m_entitySystem.ProcessCommands();
+    m_componentSystem.ProcessCommands();
+
+    // Run frames of the scenario.
+    for(int frame = 0; frame < scenario.frameCount; ++frame)
+    {
+        this->RunFrame(scenario, frame);
+    }
+
+    // Gather results.
+    result.frameCount = scenario.frameCount;
+    result.tickCount = m_gameLoop.GetTickIndex();
+    result.entityCount = m_entitySystem.GetEntityCount();
+
+    if(scenario.frameCount > 0)
+    {
+        result.spriteCount = (double)m_spriteTotal / scenario.frameCount;
+        result.batchCount = (double)m_batchTotal / scenario.frameCount;
+    }
+
+    result.frameTimes = m_frameStatistics.GetFramePercentiles();
+
+    for(int phase = 0; phase < System::FramePhases::Count; ++phase)
+    {
+        result.phaseTimes[phase] = m_frameStatistics.GetPhasePercentiles((System::FramePhases::Type)phase);
+    }
+
+    return result;
+}
+
+void ScenarioRunner::RunFrame(const Scenario& scenario, int frame)
+{
+    m_frameStatistics.BeginFrame();
+
+    // Dispatch scripted input events.
+    {
+        System::FrameStatistics::ScopedPhase phase(&m_frameStatistics, System::FramePhases::Events);
+
+        m_inputState.Update();
+
+        if(scenario.events)
+        {
+            scenario.events(*this, frame);
+        }
+    }
+
+    // Advance the simulation by exactly one tick.
+    m_gameLoop.BeginFrame(m_gameLoop.GetTickTime());
+
+    while(m_gameLoop.Tick())
+    {
+        {
+            System::FrameStatistics::ScopedPhase phase(&m_frameStatistics, System::FramePhases::Commands);
+
+            m_entitySystem.ProcessCommands();
+            m_componentSystem.ProcessCommands();
+        }
+
+        {
+            System::FrameStatistics::ScopedPhase phase(&m_frameStatistics, System::FramePhases::Simulation);
+
+            if(scenario.tick)
+            {
+                scenario.tick(*this, frame);
+            }
+
+            m_systemScheduler.Run(&m_jobSystem);
+        }
+    }
+
+    // Record draws of visible sprites.
+    {
+        System::FrameStatistics::ScopedPhase phase(&m_frameStatistics, System::FramePhases::Render);
+
+        this->RecordSprites();
+    }
+
+    m_frameStatistics.EndFrame();
+}
+
+void ScenarioRunner::UpdateMovement()
+{
+    // Gather chunks first, so they can be split between workers.
+    std::vector<MovementChunk> chunks;
+
+    m_componentSystem.ForEachChunk<Game::Transform, Velocity>([&](int count, const Game::EntityHandle* entities, Game::Transform* transforms, Velocity* velocities)
+    {
+        MovementChunk chunk;
+        chunk.count = count;
+        chunk.transforms = transforms;
+        chunk.velocities = velocities;
+
+        chunks.push_back(chunk);
+    });
+
+    const float tickTime = (float)m_gameLoop.GetTickTime();
+    const glm::vec2 worldSize = m_info.worldSize;
+
+    m_jobSystem.ParallelFor((int)chunks.size(), 1, [&](int begin, int end)
+    {
+        for(int c = begin; c < end; ++c)
+        {
+            const MovementChunk& chunk = chunks[c];
+
+            for(int i = 0; i < chunk.count; ++i)
+            {
+                glm::vec3& position = chunk.transforms[i].position;
+                glm::vec2& velocity = chunk.velocities[i].value;
+
+                position.x += velocity.x * tickTime;
+                position.y += velocity.y * tickTime;
+
+                // Bounce off edges of the world.
+                if(position.x < 0.0f || position.x > worldSize.x)
+                {
+                    position.x = glm::clamp(position.x, 0.0f, worldSize.x);
+                    velocity.x = -velocity.x;
+                }
+
+                if(position.y < 0.0f || position.y > worldSize.y)
+                {
+                    position.y = glm::clamp(position.y, 0.0f, worldSize.y);
+                    velocity.y = -velocity.y;
+                }
+            }
+        }
+    });
+}
+
+void ScenarioRunner::UpdateCamera()
+{
+    const float tickTime = (float)m_gameLoop.GetTickTime();
+    const glm::vec2 viewSize = m_info.viewSize / m_cameraZoom;
+
+    // Pan with held keys.
+    glm::vec2 direction(0.0f, 0.0f);
+
+    if(m_inputState.IsKeyDown(GLFW_KEY_A)) direction.x -= 1.0f;
+    if(m_inputState.IsKeyDown(GLFW_KEY_D)) direction.x += 1.0f;
+    if(m_inputState.IsKeyDown(GLFW_KEY_S)) direction.y -= 1.0f;
+    if(m_inputState.IsKeyDown(GLFW_KEY_W)) direction.y += 1.0f;
+
+    m_cameraPosition += direction * viewSize * CameraSpeed * tickTime;
+
+    // Drag with the right mouse button.
+    if(m_inputState.IsMouseButtonDown(GLFW_MOUSE_BUTTON_RIGHT))
+    {
+        m_cameraPosition.x -= (float)m_inputState.GetCursorDeltaX() / m_cameraZoom;
+        m_cameraPosition.y += (float)m_inputState.GetCursorDeltaY() / m_cameraZoom;
+    }
+
+    // Zoom with the scroll wheel.
+    m_cameraZoom *= std::pow(1.1f, (float)m_inputState.GetScrollOffset());
+    m_cameraZoom = glm::clamp(m_cameraZoom, 0.125f, 8.0f);
+
+    m_cameraPosition = glm::clamp(m_cameraPosition, glm::vec2(0.0f, 0.0f), m_info.worldSize);
+}
+
+void ScenarioRunner::RecordSprites()
+{
+    // Gather sprites like the sprite batch does.
+    m_instances.clear();
+    m_keys.clear();
+    m_culler.Clear();
+
+    m_componentSystem.ForEachChunk<Game::Transform, Graphics::Sprite>([&](int count, const Game::EntityHandle* entities, Game::Transform* transforms, Graphics::Sprite* sprites)
+    {
+        for(int i = 0; i < count; ++i)
+        {
+            const Game::Transform& transform = transforms[i];
+            const Graphics::Sprite& sprite = sprites[i];
+
+            Graphics::SpriteInstance instance;
+            instance.position = glm::vec2(transform.position);
+            instance.size = sprite.size * transform.scale;
+            instance.rotation = transform.rotation;
+            instance.depth = transform.position.z;
+            instance.color = sprite.color;
+            instance.textureRect = sprite.textureRect;
+
+            m_culler.AddSphere(glm::vec3(instance.position, instance.depth), glm::length(instance.size) * 0.5f);
+
+            m_keys.push_back((SortKey)sprite.texture << 32 | (SortKey)m_instances.size());
+            m_instances.push_back(instance);
+        }
+    });
+
+    // Cull sprites outside of the camera view.
+    glm::vec2 halfView = m_info.viewSize * (0.5f / m_cameraZoom);
+    glm::vec2 minimum = m_cameraPosition - halfView;
+    glm::vec2 maximum = m_cameraPosition + halfView;
+
+    glm::mat4 viewProjection = glm::ortho(minimum.x, maximum.x, minimum.y, maximum.y, -1.0f, 1.0f);
+
+    m_culler.Cull(viewProjection, &m_jobSystem);
+
+    // Visible indices are ascending, so keys can be compacted in place.
+    const Graphics::FrustumCuller::IndexList& visible = m_culler.GetVisible();
+
+    for(std::size_t i = 0; i < visible.size(); ++i)
+    {
+        m_keys[i] = m_keys[visible[i]];
+    }
+
+    m_keys.resize(visible.size());
+
+    // Sort sprites by texture and write them in draw order.
+    std::sort(m_keys.begin(), m_keys.end());
+
+    m_staging.resize(m_keys.size());
+
+    // Record a draw for every texture.
+    m_commands.Reset();
+    m_commands.Clear(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    m_commands.SetViewport(0, 0, (GLsizei)m_info.viewSize.x, (GLsizei)m_info.viewSize.y);
+    m_commands.SetUniform(0, viewProjection);
+
+    std::size_t first = 0;
+    int batchCount = 0;
+
+    for(std::size_t i = 0; i < m_keys.size(); ++i)
+    {
+        GLuint texture = (GLuint)(m_keys[i] >> 32);
+        std::size_t index = (std::size_t)(m_keys[i] & 0xFFFFFFFF);
+
+        m_staging[i] = m_instances[index];
+
+        // Draw sprites up to the last one with the same texture.
+        if(i + 1 == m_keys.size() || (GLuint)(m_keys[i + 1] >> 32) != texture)
+        {
+            m_commands.BindTexture(0, GL_TEXTURE_2D, texture);
+            m_commands.Draw(GL_TRIANGLES, (GLint)first * 6, (GLsizei)(i + 1 - first) * 6);
+
+            first = i + 1;
+            batchCount += 1;
+        }
+    }
+
+    m_spriteTotal += m_keys.size();
+    m_batchTotal += batchCount;
+}
+
+Game::EntityHandle ScenarioRunner::SpawnSprite()
+{
+    std::uniform_real_distribution<float> positionX(0.0f, m_info.worldSize.x);
+    std::uniform_real_distribution<float> positionY(0.0f, m_info.worldSize.y);
+    std::uniform_real_distribution<float> speed(-200.0f, 200.0f);
+    std::uniform_int_distribution<int> texture(1, TextureCount);
+
+    Game::EntityHandle entity = m_entitySystem.CreateEntity();
+
+    Game::Transform transform;
+    transform.position = glm::vec3(positionX(m_random), positionY(m_random), 0.0f);
+
+    Velocity velocity;
+    velocity.value = glm::vec2(speed(m_random), speed(m_random));
+
+    Graphics::Sprite sprite;
+    sprite.size = glm::vec2(16.0f, 16.0f);
+    sprite.texture = (GLuint)texture(m_random);
+
+    m_componentSystem.AddComponent(entity, transform);
+    m_componentSystem.AddComponent(entity, velocity);
+    m_componentSystem.AddComponent(entity, sprite);
+
+    return entity;
+}
+
+std::mt19937& ScenarioRunner::GetRandom()
+{
+    return m_random;
+}
+
+double ScenarioRunner::GetTickTime() const
+{
+    return m_gameLoop.GetTickTime();
+}
+
+const glm::vec2& ScenarioRunner::GetWorldSize() const
+{
+    return m_info.worldSize;
+}
+
+System::Window& ScenarioRunner::GetWindow()
+{
+    return m_window;
+}
+
+JobSystem& ScenarioRunner::GetJobSystem()
+{
+    return m_jobSystem;
+}
+
+Game::EntitySystem& ScenarioRunner::GetEntitySystem()
+{
+    return m_entitySystem;
+}
+
+Game::ComponentSystem& ScenarioRunner::GetComponentSystem()
+{
+    return m_componentSystem;
+}
+
+bool ScenarioRunner::IsInitialized() const
+{
+    return m_initialized;
+}
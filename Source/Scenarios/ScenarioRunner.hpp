@@ -0,0 +1,212 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/JobSystem.hpp"
+#include "System/Window.hpp"
+#include "System/InputState.hpp"
+#include "System/FrameStatistics.hpp"
+#include "Game/EntitySystem.hpp"
+#include "Game/ComponentSystem.hpp"
+#include "Game/SystemScheduler.hpp"
+#include "Game/GameLoop.hpp"
+#include "Graphics/FrustumCuller.hpp"
+#include "Graphics/CommandBuffer.hpp"
+#include "Graphics/SpriteBatch.hpp"
+
+//
+// Scenario Runner
+//
+//  Runs the frame pipeline of the application without a window or a
+//  graphics context against scripted load scenarios. Every frame goes
+//  through the same phases as the main loop: input events are dispatched
+//  through window event dispatchers, entity and component commands are
+//  processed, systems run on the job system, sprites are gathered and
+//  culled, and their draws are recorded into a command buffer.
+//
+//  Frames run exactly one simulation tick each, so scenarios advance by the
+//  same amount of simulated time regardless of how long frames take. Render
+//  commands are recorded the same way the sprite batch records them but are
+//  never executed, since there is no context to execute them on.
+//
+//  Phase times are measured by frame statistics over the whole run and are
+//  returned as percentiles, which can be compared between builds.
+//
+//  Example usage:
+//      Scenarios::ScenarioRunner runner;
+//      runner.Initialize(Scenarios::ScenarioRunnerInfo());
+//
+//      Scenarios::ScenarioResult result = runner.Run(Scenarios::CreateMovingEntities(100000));
+//
+
+namespace Scenarios
+{
+    // Forward declarations.
+    class ScenarioRunner;
+
+    // Velocity component moved by the built-in movement system.
+    struct Velocity
+    {
+        Velocity() :
+            value(0.0f, 0.0f)
+        {
+        }
+
+        // Velocity in world units per second.
+        glm::vec2 value;
+    };
+
+    // Scripted load scenario.
+    struct Scenario
+    {
+        // Type declarations.
+        typedef std::function<void(ScenarioRunner& runner)> SetupFunction;
+        typedef std::function<void(ScenarioRunner& runner, int frame)> FrameFunction;
+
+        Scenario();
+
+        // Name of the scenario.
+        std::string name;
+
+        // Number of frames that are run.
+        int frameCount;
+
+        // Populates the world before the first frame.
+        SetupFunction setup;
+
+        // Sends input events at the beginning of every frame.
+        FrameFunction events;
+
+        // Queues entity and component changes on every tick.
+        FrameFunction tick;
+    };
+
+    // Scenario result.
+    struct ScenarioResult
+    {
+        ScenarioResult();
+
+        // Name of the scenario.
+        std::string name;
+
+        // Number of frames and ticks run.
+        int frameCount;
+        std::uint64_t tickCount;
+
+        // Number of entities after the last frame.
+        int entityCount;
+
+        // Average number of sprites and batches recorded per frame.
+        double spriteCount;
+        double batchCount;
+
+        // Percentiles of frame and phase times.
+        System::FrameStatistics::Percentiles frameTimes;
+        System::FrameStatistics::Percentiles phaseTimes[System::FramePhases::Count];
+    };
+
+    // Scenario runner initialization struct.
+    struct ScenarioRunnerInfo
+    {
+        ScenarioRunnerInfo();
+
+        // Number of job system workers.
+        // Negative value uses one less than the number of hardware threads.
+        int workerCount;
+
+        // Size of the visible area in world units at the default zoom.
+        glm::vec2 viewSize;
+
+        // Size of the world that entities move within.
+        glm::vec2 worldSize;
+    };
+
+    // Scenario runner class.
+    class ScenarioRunner : private NonCopyable
+    {
+    public:
+        ScenarioRunner();
+        ~ScenarioRunner();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the scenario runner.
+        bool Initialize(const ScenarioRunnerInfo& info);
+
+        // Runs a scenario in an empty world.
+        ScenarioResult Run(const Scenario& scenario);
+
+        // Spawns a moving sprite at a random position.
+        Game::EntityHandle SpawnSprite();
+
+        // Gets the random number generator of the current run.
+        std::mt19937& GetRandom();
+
+        // Gets the duration of a tick in seconds.
+        double GetTickTime() const;
+
+        // Gets the size of the world.
+        const glm::vec2& GetWorldSize() const;
+
+        // Gets subsystems of the pipeline.
+        System::Window& GetWindow();
+        JobSystem& GetJobSystem();
+        Game::EntitySystem& GetEntitySystem();
+        Game::ComponentSystem& GetComponentSystem();
+
+        // Checks if the instance is initialized.
+        bool IsInitialized() const;
+
+    private:
+        // Runs a single frame of a scenario.
+        void RunFrame(const Scenario& scenario, int frame);
+
+        // Moves entities by their velocities.
+        void UpdateMovement();
+
+        // Moves the camera from the input state.
+        void UpdateCamera();
+
+        // Gathers, culls and records sprites.
+        void RecordSprites();
+
+    private:
+        // Sprite sort key with a texture in the high bits and an instance index in the low bits.
+        typedef std::uint64_t SortKey;
+
+    private:
+        // Pipeline settings.
+        ScenarioRunnerInfo m_info;
+
+        // Pipeline subsystems.
+        JobSystem m_jobSystem;
+        System::Window m_window;
+        System::InputState m_inputState;
+        Game::EntitySystem m_entitySystem;
+        Game::ComponentSystem m_componentSystem;
+        Game::SystemScheduler m_systemScheduler;
+        Game::GameLoop m_gameLoop;
+        System::FrameStatistics m_frameStatistics;
+
+        // Sprite rendering state.
+        Graphics::FrustumCuller m_culler;
+        Graphics::CommandBuffer m_commands;
+        std::vector<Graphics::SpriteInstance> m_instances;
+        std::vector<Graphics::SpriteInstance> m_staging;
+        std::vector<SortKey> m_keys;
+
+        // Camera state.
+        glm::vec2 m_cameraPosition;
+        float m_cameraZoom;
+
+        // Random number generator of the current run.
+        std::mt19937 m_random;
+
+        // Totals of recorded sprites and batches.
+        std::uint64_t m_spriteTotal;
+        std::uint64_t m_batchTotal;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,263 @@
+#include "Precompiled.hpp"
+#include "Scenarios.hpp"
+#include "Common/EventChannel.hpp"
+
+namespace
+{
+    // Keys held and released by the input storm.
+    const int StormKeyCount = 6;
+
+    const int StormKeys[StormKeyCount] =
+    {
+        GLFW_KEY_W,
+        GLFW_KEY_A,
+        GLFW_KEY_S,
+        GLFW_KEY_D,
+        GLFW_KEY_SPACE,
+        GLFW_KEY_LEFT_SHIFT,
+    };
+
+    // Slots of the channel that event order pushes through.
+    // Kept small so producers overflow the ring on every tick.
+    const std::size_t OrderChannelCapacity = 256;
+
+    // Numbered event of an event order producer.
+    struct OrderEvent
+    {
+        int producer;
+        int sequence;
+    };
+
+    // Builds a scenario name with a number.
+    std::string FormatName(const char* name, int count)
+    {
+        std::ostringstream stream;
+        stream << name << " (" << count << ")";
+        return stream.str();
+    }
+
+    // Spawns a number of moving sprites.
+    void SpawnSprites(Scenarios::ScenarioRunner& runner, int count)
+    {
+        for(int i = 0; i < count; ++i)
+        {
+            runner.SpawnSprite();
+        }
+    }
+}
+
+Scenarios::Scenario Scenarios::CreateMovingEntities(int entityCount)
+{
+    Scenario scenario;
+    scenario.name = FormatName("MovingEntities", entityCount);
+
+    scenario.setup = [entityCount](ScenarioRunner& runner)
+    {
+        SpawnSprites(runner, entityCount);
+    };
+
+    return scenario;
+}
+
+Scenarios::Scenario Scenarios::CreateSpawnChurn(int entityCount, int spawnRate)
+{
+    // Entities in the order they were spawned, shared between calls.
+    struct ChurnState
+    {
+        std::deque<Game::EntityHandle> entities;
+        double pending;
+    };
+
+    auto state = std::make_shared<ChurnState>();
+
+    Scenario scenario;
+    scenario.name = FormatName("SpawnChurn", spawnRate);
+
+    scenario.setup = [state, entityCount](ScenarioRunner& runner)
+    {
+        state->entities.clear();
+        state->pending = 0.0;
+
+        for(int i = 0; i < entityCount; ++i)
+        {
+            state->entities.push_back(runner.SpawnSprite());
+        }
+    };
+
+    scenario.tick = [state, spawnRate](ScenarioRunner& runner, int frame)
+    {
+        // Spawn whole entities due by the end of this tick.
+        state->pending += spawnRate * runner.GetTickTime();
+
+        int count = (int)state->pending;
+        state->pending -= count;
+
+        // Destroy the oldest entities to keep the population steady.
+        for(int i = 0; i < count && !state->entities.empty(); ++i)
+        {
+            runner.GetEntitySystem().DestroyEntity(state->entities.front());
+            state->entities.pop_front();
+        }
+
+        for(int i = 0; i < count; ++i)
+        {
+            state->entities.push_back(runner.SpawnSprite());
+        }
+    };
+
+    return scenario;
+}
+
+Scenarios::Scenario Scenarios::CreateInputStorm(int entityCount, int eventCount)
+{
+    // Cursor position that keeps walking between frames.
+    auto cursor = std::make_shared<glm::dvec2>();
+
+    Scenario scenario;
+    scenario.name = FormatName("InputStorm", eventCount);
+
+    scenario.setup = [cursor, entityCount](ScenarioRunner& runner)
+    {
+        *cursor = glm::dvec2(960.0, 540.0);
+
+        SpawnSprites(runner, entityCount);
+    };
+
+    scenario.events = [cursor, eventCount](ScenarioRunner& runner, int frame)
+    {
+        System::Window::Events& events = runner.GetWindow().events;
+        std::mt19937& random = runner.GetRandom();
+
+        std::uniform_int_distribution<int> eventType(0, 9);
+        std::uniform_int_distribution<int> key(0, StormKeyCount - 1);
+        std::uniform_real_distribution<double> step(-8.0, 8.0);
+
+        for(int i = 0; i < eventCount; ++i)
+        {
+            int type = eventType(random);
+
+            if(type < 6)
+            {
+                cursor->x += step(random);
+                cursor->y += step(random);
+
+                System::Window::Events::CursorPosition event;
+                event.x = cursor->x;
+                event.y = cursor->y;
+                event.time = System::Window::GetTime();
+                events.cursorPosition(event);
+            }
+            else if(type < 8)
+            {
+                System::Window::Events::KeyboardKey event;
+                event.key = StormKeys[key(random)];
+                event.scancode = 0;
+                event.action = random() % 2 ? GLFW_PRESS : GLFW_RELEASE;
+                event.mods = 0;
+                event.time = System::Window::GetTime();
+                events.keyboardKey(event);
+            }
+            else if(type < 9)
+            {
+                System::Window::Events::MouseButton event;
+                event.button = random() % 2 ? GLFW_MOUSE_BUTTON_RIGHT : GLFW_MOUSE_BUTTON_LEFT;
+                event.action = random() % 2 ? GLFW_PRESS : GLFW_RELEASE;
+                event.mods = 0;
+                event.time = System::Window::GetTime();
+                events.mouseButton(event);
+            }
+            else
+            {
+                System::Window::Events::MouseScroll event;
+                event.offset = step(random) / 8.0;
+                event.time = System::Window::GetTime();
+                events.mouseScroll(event);
+            }
+        }
+    };
+
+    return scenario;
+}
+
+Scenarios::Scenario Scenarios::CreateEventOrder(int entityCount, int producerCount, int eventCount)
+{
+    // Channel and next expected sequence of each producer, shared between calls.
+    struct OrderState
+    {
+        EventChannel<void(const OrderEvent&)> channel;
+        Receiver<void(const OrderEvent&)> receiver;
+        std::vector<int> sequences;
+        std::vector<int> expected;
+        int violationCount;
+
+        void operator()(const OrderEvent& event)
+        {
+            if(event.sequence != expected[event.producer])
+            {
+                ++violationCount;
+            }
+
+            expected[event.producer] = event.sequence + 1;
+        }
+    };
+
+    auto state = std::make_shared<OrderState>();
+
+    Scenario scenario;
+    scenario.name = FormatName("EventOrder", producerCount);
+
+    scenario.setup = [state, entityCount, producerCount](ScenarioRunner& runner)
+    {
+        state->channel.Initialize(OrderChannelCapacity);
+        state->receiver.Bind(state.get());
+        state->receiver.Subscribe(state->channel.GetDispatcher());
+        state->sequences.assign(producerCount, 0);
+        state->expected.assign(producerCount, 0);
+        state->violationCount = 0;
+
+        SpawnSprites(runner, entityCount);
+    };
+
+    scenario.tick = [state, producerCount, eventCount](ScenarioRunner& runner, int frame)
+    {
+        JobSystem& jobSystem = runner.GetJobSystem();
+        JobCounter counter;
+
+        // Push from jobs while this thread flushes the channel.
+        for(int producer = 0; producer < producerCount; ++producer)
+        {
+            jobSystem.Schedule([state, producer, eventCount]()
+            {
+                int& sequence = state->sequences[producer];
+
+                for(int i = 0; i < eventCount; ++i)
+                {
+                    OrderEvent event;
+                    event.producer = producer;
+                    event.sequence = sequence++;
+                    state->channel.Push(event);
+                }
+            }, &counter);
+        }
+
+        // Jobs only run on this thread when there are no workers to take them.
+        while(jobSystem.GetWorkerCount() > 0 && !counter.IsDone())
+        {
+            state->channel.Flush();
+        }
+
+        jobSystem.Wait(counter);
+        state->channel.Flush();
+
+        // Every event has been published, so the last flush must have drained all of them.
+        if(state->violationCount != 0)
+        {
+            LogError() << "Event channel reordered " << state->violationCount << " events of the same producer!";
+            state->violationCount = 0;
+        }
+
+        Assert(state->expected == state->sequences, "Event channel held back published events!");
+    };
+
+    return scenario;
+}
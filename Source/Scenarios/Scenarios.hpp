@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "ScenarioRunner.hpp"
+
+//
+// Scenarios
+//
+//  Scripted load scenarios run by the scenario runner.
+//
+//  Moving entities keeps a fixed population of sprites moving and bouncing
+//  around the world. Spawn churn keeps a population steady while spawning
+//  and destroying entities at a fixed rate per second of simulated time,
+//  oldest first. Input storm sends bursts of cursor, key, button and scroll
+//  events every frame, which move the camera and change what is culled.
+//  Event order pushes numbered events from jobs into a small event channel
+//  on every tick while flushing it, so the ring overflows and flushes stop
+//  at slots that are being published, and checks that events of each
+//  producer arrive in the order they were pushed.
+//
+
+namespace Scenarios
+{
+    // Creates a scenario with a fixed number of moving sprites.
+    Scenario CreateMovingEntities(int entityCount);
+
+    // Creates a scenario that replaces entities at a rate per second.
+    Scenario CreateSpawnChurn(int entityCount, int spawnRate);
+
+    // Creates a scenario that sends a number of input events per frame.
+    Scenario CreateInputStorm(int entityCount, int eventCount);
+
+    // Creates a scenario that pushes a number of events per producer on every tick.
+    Scenario CreateEventOrder(int entityCount, int producerCount, int eventCount);
+}
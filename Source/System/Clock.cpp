@@ -0,0 +1,82 @@
+#include "Precompiled.hpp"
+#include "Clock.hpp"
+using namespace System;
+
+namespace
+{
+    // Time spent measuring ticks against the monotonic clock.
+    const std::int64_t CalibrationTime = 10000000;
+
+    // Measures the number of ticks per second.
+    double CalibrateTickFrequency()
+    {
+    #ifdef CLOCK_TIME_STAMP_COUNTER
+        std::int64_t startTime = Clock::GetNanoseconds();
+        std::uint64_t startTicks = Clock::ReadTicks();
+
+        std::int64_t endTime = startTime;
+
+        while(endTime - startTime < CalibrationTime)
+        {
+            endTime = Clock::GetNanoseconds();
+        }
+
+        std::uint64_t endTicks = Clock::ReadTicks();
+
+        return (double)(endTicks - startTicks) * 1.0e9 / (double)(endTime - startTime);
+    #else
+        return 1.0e9;
+    #endif
+    }
+}
+
+const bool Clock::is_steady;
+
+Clock::time_point Clock::now()
+{
+    return time_point(duration(GetNanoseconds()));
+}
+
+std::int64_t Clock::GetNanoseconds()
+{
+#if defined(WIN32)
+    static const LONGLONG frequency = []()
+    {
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        return frequency.QuadPart;
+    }();
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+
+    // Split the conversion to avoid overflowing large counter values.
+    LONGLONG seconds = counter.QuadPart / frequency;
+    LONGLONG remainder = counter.QuadPart % frequency;
+
+    return (std::int64_t)seconds * 1000000000 + (std::int64_t)remainder * 1000000000 / frequency;
+#elif defined(__linux__)
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (std::int64_t)time.tv_sec * 1000000000 + (std::int64_t)time.tv_nsec;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+double Clock::GetTickFrequency()
+{
+    static const double frequency = CalibrateTickFrequency();
+    return frequency;
+}
+
+double Clock::TicksToSeconds(std::uint64_t ticks)
+{
+    return (double)ticks / GetTickFrequency();
+}
+
+std::int64_t Clock::TicksToNanoseconds(std::uint64_t ticks)
+{
+    return (std::int64_t)((double)ticks * 1.0e9 / GetTickFrequency());
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #define CLOCK_TIME_STAMP_COUNTER
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #include <x86intrin.h>
+    #define CLOCK_TIME_STAMP_COUNTER
+#endif
+
+//
+// Clock
+//
+//  Monotonic clock with nanosecond resolution that can be used in place of
+//  standard clocks. Time is read with clock_gettime() on Linux and with the
+//  performance counter on Windows, as the resolution and cost of the steady
+//  clock vary between standard library implementations.
+//
+//  Ticks are read straight from the processor time stamp counter on x86,
+//  which takes a few cycles and no system call, so profiling and logging
+//  can take timestamps of many small events without skewing them. The tick
+//  frequency is calibrated against the monotonic clock on first use. Other
+//  architectures count ticks in nanoseconds. Ticks should only be compared
+//  for intervals measured on processors with an invariant counter.
+//
+//  Example usage:
+//      System::Clock::time_point start = System::Clock::now();
+//      std::uint64_t ticks = System::Clock::ReadTicks();
+//
+//      /* ... */
+//
+//      double seconds = System::Clock::GetSeconds(System::Clock::now() - start);
+//      double tickSeconds = System::Clock::TicksToSeconds(System::Clock::ReadTicks() - ticks);
+//
+
+namespace System
+{
+    // Clock class.
+    class Clock
+    {
+    public:
+        // Type declarations compatible with standard clocks.
+        typedef std::chrono::nanoseconds duration;
+        typedef duration::rep rep;
+        typedef duration::period period;
+        typedef std::chrono::time_point<Clock> time_point;
+
+        static const bool is_steady = true;
+
+    public:
+        // Gets the current time.
+        static time_point now();
+
+        // Gets the current time in nanoseconds since an unspecified point.
+        static std::int64_t GetNanoseconds();
+
+        // Reads the processor tick counter.
+        static std::uint64_t ReadTicks();
+
+        // Gets the number of ticks per second.
+        // Calibrates the frequency on the first call, which takes a few milliseconds.
+        static double GetTickFrequency();
+
+        // Converts a number of ticks to seconds or nanoseconds.
+        static double TicksToSeconds(std::uint64_t ticks);
+        static std::int64_t TicksToNanoseconds(std::uint64_t ticks);
+
+        // Converts a duration to seconds.
+        template<typename Rep, typename Period>
+        static double GetSeconds(const std::chrono::duration<Rep, Period>& duration);
+
+        // Gets the seconds passed from a time point to now.
+        static double GetSecondsSince(time_point time);
+    };
+}
+
+// Inline implementations.
+namespace System
+{
+    inline std::uint64_t Clock::ReadTicks()
+    {
+    #ifdef CLOCK_TIME_STAMP_COUNTER
+        return __rdtsc();
+    #else
+        return (std::uint64_t)GetNanoseconds();
+    #endif
+    }
+
+    template<typename Rep, typename Period>
+    double Clock::GetSeconds(const std::chrono::duration<Rep, Period>& duration)
+    {
+        return std::chrono::duration<double>(duration).count();
+    }
+
+    inline double Clock::GetSecondsSince(time_point time)
+    {
+        return GetSeconds(now() - time);
+    }
+}
@@ -1,10 +1,293 @@
 #include "Precompiled.hpp"
 #include "Config.hpp"
+#include "Common/BinaryStream.hpp"
 using namespace System;
 
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef WIN32
+    #include <sys/inotify.h>
+    #include <poll.h>
+    #include <unistd.h>
+
+    extern char** environ;
+#endif
+
+namespace
+{
+    // Checks if a character is a white space within a line.
+    bool IsSpace(char character)
+    {
+        return character == ' ' || character == '\t' || character == '\r' || character == '\0';
+    }
+
+    // Maximum length of a floating point number text.
+    const std::size_t MaximumFloatLength = 63;
+
+    // Cache file format identification.
+    const std::uint32_t CacheMagic   = 0x47464343; // "CCFG"
+    const std::uint32_t CacheVersion = 1;
+
+    // Extension appended to config filenames for their caches.
+    const char* CacheExtension = ".cache";
+
+    // Gets the size and modification time of a file.
+    bool GetFileStatus(const std::string& filename, std::uint64_t& size, std::int64_t& time)
+    {
+#ifdef WIN32
+        struct _stat64 status;
+
+        if(_stat64(filename.c_str(), &status) != 0)
+            return false;
+
+        size = (std::uint64_t)status.st_size;
+        time = (std::int64_t)status.st_mtime;
+#else
+        struct stat status;
+
+        if(stat(filename.c_str(), &status) != 0)
+            return false;
+
+        size = (std::uint64_t)status.st_size;
+        time = (std::int64_t)status.st_mtim.tv_sec * 1000000000 + status.st_mtim.tv_nsec;
+#endif
+        return true;
+    }
+
+    // Time after which the watcher thread checks if it should exit.
+    const int WatcherInterval = 100;
+
+    // Size of the buffer for file change notifications.
+    const std::size_t WatcherBufferSize = 4096;
+
+    // Maps a changed event to the key of its variable.
+    int GetChangedKey(const Config::Events::Changed& event)
+    {
+        return event.name.GetKey();
+    }
+
+    // Splits a path into a directory and a filename.
+    void SplitPath(const std::string& path, std::string& directory, std::string& filename)
+    {
+        std::size_t separator = path.find_last_of("/\\");
+
+        if(separator == std::string::npos)
+        {
+            directory = ".";
+            filename = path;
+        }
+        else
+        {
+            directory = path.substr(0, separator + 1);
+            filename = path.substr(separator + 1);
+        }
+    }
+
+    // Compares a text with a string literal.
+    bool IsText(const char* text, std::size_t length, const char* literal)
+    {
+        return std::strlen(literal) == length && std::memcmp(text, literal, length) == 0;
+    }
+}
+
+ConfigValue::ConfigValue() :
+    m_type(ConfigValueTypes::String),
+    m_text(""),
+    m_length(0),
+    m_boolean(false),
+    m_integer(0),
+    m_float(0.0)
+{
+}
+
+void ConfigValue::Parse(const char* text, std::size_t length)
+{
+    m_type = ConfigValueTypes::String;
+    m_text = text;
+    m_length = length;
+    m_boolean = false;
+    m_integer = 0;
+    m_float = 0.0;
+
+    if(length == 0)
+        return;
+
+    // Parse a boolean.
+    if(IsText(text, length, "true") || IsText(text, length, "True"))
+    {
+        m_type = ConfigValueTypes::Boolean;
+        m_boolean = true;
+        m_integer = 1;
+        m_float = 1.0;
+        return;
+    }
+
+    if(IsText(text, length, "false") || IsText(text, length, "False"))
+    {
+        m_type = ConfigValueTypes::Boolean;
+        return;
+    }
+
+    // Parse a decimal integer.
+    std::size_t index = 0;
+    bool negative = false;
+
+    if(text[0] == '-' || text[0] == '+')
+    {
+        negative = text[0] == '-';
+        ++index;
+    }
+
+    if(index < length)
+    {
+        std::uint64_t integer = 0;
+        std::size_t digits = index;
+
+        while(digits < length && text[digits] >= '0' && text[digits] <= '9')
+        {
+            integer = integer * 10 + (text[digits] - '0');
+            ++digits;
+        }
+
+        if(digits == length && digits - index <= 18)
+        {
+            m_type = ConfigValueTypes::Integer;
+            m_integer = negative ? -(std::int64_t)integer : (std::int64_t)integer;
+            m_float = (double)m_integer;
+            m_boolean = m_integer != 0;
+            return;
+        }
+    }
+
+    // Parse a floating point number.
+    // File content is not null terminated, so copy it for the conversion.
+    if(length <= MaximumFloatLength)
+    {
+        char buffer[MaximumFloatLength + 1];
+        std::memcpy(buffer, text, length);
+        buffer[length] = '\0';
+
+        char* end = nullptr;
+        double number = std::strtod(buffer, &end);
+
+        if(end == buffer + length && std::isfinite(number))
+        {
+            m_type = ConfigValueTypes::Float;
+            m_float = number;
+            m_integer = (std::int64_t)number;
+            m_boolean = number != 0.0;
+            return;
+        }
+    }
+}
+
+bool ConfigValue::Get(bool& value) const
+{
+    // Only convert booleans and integers.
+    if(m_type != ConfigValueTypes::Boolean && m_type != ConfigValueTypes::Integer)
+        return false;
+
+    value = m_boolean;
+    return true;
+}
+
+bool ConfigValue::Get(std::string& value) const
+{
+    value.assign(m_text, m_length);
+    return true;
+}
+
+ConfigValueTypes::Type ConfigValue::GetType() const
+{
+    return m_type;
+}
+
+std::string ConfigValue::GetText() const
+{
+    return std::string(m_text, m_length);
+}
+
+const char* ConfigValue::GetTextData() const
+{
+    return m_text;
+}
+
+std::size_t ConfigValue::GetTextLength() const
+{
+    return m_length;
+}
+
+ConfigName::ConfigName(const std::string& name) :
+    ConfigName(name.data(), name.size())
+{
+}
+
+ConfigName::ConfigName(const char* text, std::size_t length, std::uint64_t hash) :
+    m_text(text),
+    m_length(length),
+    m_hash(hash)
+{
+}
+
+ConfigName::ConfigName(const char* text, std::size_t length) :
+    m_text(text),
+    m_length(length),
+    m_hash(Detail::NameHashOffset)
+{
+    // Calculate the FNV-1a hash, same as in constant expressions.
+    for(std::size_t i = 0; i < length; ++i)
+    {
+        m_hash ^= (std::uint8_t)text[i];
+        m_hash *= Detail::NameHashPrime;
+    }
+}
+
+std::string ConfigName::GetString() const
+{
+    return std::string(m_text, m_length);
+}
+
+Detail::ConfigEntry::ConfigEntry(const ConfigName& name, const ConfigValue* value) :
+    hash(name.GetHash()),
+    name(name.GetText()),
+    length(name.GetLength()),
+    value(value),
+    overridden(false)
+{
+}
+
+ConfigInfo::ConfigInfo() :
+    filename(""),
+    argumentCount(0),
+    arguments(nullptr),
+    environmentPrefix("")
+{
+}
+
+Config::Table::Table(std::size_t size) :
+    slots(new std::atomic<const Detail::ConfigEntry*>[size]),
+    size(size)
+{
+    for(std::size_t i = 0; i < size; ++i)
+    {
+        slots[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
 Config::Config() :
+    m_table(nullptr),
+    m_entryCount(0),
+    m_watcherExit(false),
+    m_fileChanged(false),
+#ifdef WIN32
+    m_watchHandle(INVALID_HANDLE_VALUE),
+#else
+    m_watchHandle(-1),
+#endif
     m_initialized(false)
 {
+    events.changed.SetKeyFunction(&GetChangedKey);
 }
 
 Config::~Config()
@@ -17,14 +300,29 @@ void Config::Cleanup()
     if(!m_initialized)
         return;
 
-    // Clear the variable map.
-    Utility::ClearContainer(m_variables);
+    // Stop watching the config file.
+    this->StopWatcher();
+
+    // Clear hash tables before releasing the text they point to.
+    m_table = nullptr;
+    Utility::ClearContainer(m_tables);
+    Utility::ClearContainer(m_entries);
+    Utility::ClearContainer(m_values);
+    Utility::ClearContainer(m_storage);
+    m_entryCount = 0;
+
+    // Unmap the config cache.
+    m_cache.Cleanup();
+
+    // Free the file content.
+    Utility::ClearContainer(m_content);
+    m_filename.clear();
 
     // Initialization state.
     m_initialized = false;
 }
 
-bool Config::Initialize(const std::string filename)
+bool Config::Initialize(const ConfigInfo& info)
 {
     // Cleanup this instance.
     this->Cleanup();
@@ -40,8 +338,756 @@ bool Config::Initialize(const std::string filename)
     );
 
     // Parse config file.
-    // Todo: Implement loading from a file.
+    const std::string& filename = info.filename;
+
+    if(!filename.empty())
+    {
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+
+        std::uint64_t size = 0;
+        std::int64_t time = 0;
+
+        if(!GetFileStatus(filename, size, time))
+        {
+            LogWarning() << "Config file \"" << filename << "\" does not exist. Using default values.";
+        }
+        else if(!this->LoadCache(filename, size, time))
+        {
+            // Parse the config file and cache it for following loads.
+            m_content = Utility::GetBinaryFileContent(filename);
+            this->ParseContent(m_content.data(), m_content.size(), nullptr);
+
+            this->SaveCache(filename, size, time);
+        }
+    }
+
+    m_filename = filename;
+
+    // Apply overrides after the cache has been saved.
+    this->ApplyOverrides(info);
 
     // Success!
     return m_initialized = true;
 }
+
+void Config::ParseContent(const char* data, std::size_t size, ChangeList* changes)
+{
+    const char* end = data + size;
+    int lineNumber = 0;
+
+    // Estimate the number of variables to avoid rehashing.
+    this->ReserveEntries(std::count(data, end, '\n') + 1);
+
+    // Parse the content line by line.
+    for(const char* line = data; line < end; )
+    {
+        const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+
+        if(lineEnd == nullptr)
+        {
+            lineEnd = end;
+        }
+
+        const char* next = lineEnd + 1;
+        ++lineNumber;
+
+        // Trim white spaces.
+        while(line < lineEnd && IsSpace(*line))
+            ++line;
+
+        while(lineEnd > line && IsSpace(*(lineEnd - 1)))
+            --lineEnd;
+
+        // Skip empty lines and comments.
+        if(line == lineEnd || *line == '#' || *line == ';')
+        {
+            line = next;
+            continue;
+        }
+
+        // Split the line into a name and a value.
+        const char* separator = static_cast<const char*>(std::memchr(line, '=', lineEnd - line));
+
+        if(separator == nullptr)
+        {
+            LogWarning() << "Config line " << lineNumber << " is missing a \"=\" separator.";
+            line = next;
+            continue;
+        }
+
+        const char* nameEnd = separator;
+
+        while(nameEnd > line && IsSpace(*(nameEnd - 1)))
+            --nameEnd;
+
+        const char* value = separator + 1;
+
+        while(value < lineEnd && IsSpace(*value))
+            ++value;
+
+        if(nameEnd == line)
+        {
+            LogWarning() << "Config line " << lineNumber << " is missing a variable name.";
+            line = next;
+            continue;
+        }
+
+        ConfigName name(line, nameEnd - line);
+        std::size_t length = lineEnd - value;
+
+        // Skip overridden values and values that have not changed.
+        Detail::ConfigEntry* entry = const_cast<Detail::ConfigEntry*>(this->FindEntry(name));
+
+        if(entry != nullptr && entry->overridden)
+        {
+            line = next;
+            continue;
+        }
+
+        if(entry != nullptr)
+        {
+            const ConfigValue* previous = entry->value.load(std::memory_order_relaxed);
+
+            if(previous->GetTextLength() == length && std::memcmp(previous->GetTextData(), value, length) == 0)
+            {
+                line = next;
+                continue;
+            }
+        }
+
+        // Copy names and values of reloaded content, or store slices of the loaded content.
+        if(changes != nullptr)
+        {
+            if(entry == nullptr)
+            {
+                m_storage.emplace_back(name.GetText(), name.GetLength());
+                name = ConfigName(m_storage.back().data(), name.GetLength(), name.GetHash());
+            }
+
+            m_storage.emplace_back(value, length);
+            value = m_storage.back().data();
+        }
+
+        // Publish the new value.
+        const ConfigValue* parsed = this->CreateValue(value, length);
+
+        if(entry != nullptr)
+        {
+            entry->value.store(parsed, std::memory_order_release);
+        }
+        else
+        {
+            entry = this->InsertEntry(name, parsed);
+        }
+
+        if(changes != nullptr)
+        {
+            changes->push_back(entry);
+        }
+
+        line = next;
+    }
+}
+
+bool Config::Watch()
+{
+    if(!m_initialized)
+        return false;
+
+    if(m_filename.empty())
+    {
+        LogError() << "Failed to watch a config file! Config has not been loaded from a file.";
+        return false;
+    }
+
+    // Stop the previous watcher.
+    this->StopWatcher();
+
+    // Watch the directory, as editors often replace files instead of writing them.
+    std::string directory;
+    std::string filename;
+    SplitPath(m_filename, directory, filename);
+
+#ifdef WIN32
+    m_watchHandle = CreateFileA(directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+
+    if(m_watchHandle == INVALID_HANDLE_VALUE)
+    {
+        LogError() << "Failed to watch a config file \"" << m_filename << "\"! Couldn't open the directory.";
+        return false;
+    }
+#else
+    m_watchHandle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if(m_watchHandle == -1)
+    {
+        LogError() << "Failed to watch a config file \"" << m_filename << "\"! Couldn't initialize inotify.";
+        return false;
+    }
+
+    if(inotify_add_watch(m_watchHandle, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) == -1)
+    {
+        LogError() << "Failed to watch a config file \"" << m_filename << "\"! Couldn't watch the directory.";
+
+        close(m_watchHandle);
+        m_watchHandle = -1;
+        return false;
+    }
+#endif
+
+    // Start the watcher thread.
+    m_watcherExit = false;
+    m_fileChanged = false;
+    m_watcher = std::thread(&Config::RunWatcher, this);
+
+    return true;
+}
+
+void Config::ProcessChanges()
+{
+    if(!m_initialized)
+        return;
+
+    // Reload the file once for all changes since the last call.
+    if(m_fileChanged.exchange(false))
+    {
+        this->ReloadFile();
+    }
+}
+
+void Config::ReloadFile()
+{
+    if(!std::ifstream(m_filename).good())
+    {
+        LogWarning() << "Failed to reload a config file \"" << m_filename << "\"! Keeping previous values.";
+        return;
+    }
+
+    // Parse the new content and find changed variables.
+    // Content is copied where needed, so it can be freed afterwards.
+    ChangeList changes;
+
+    {
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+
+        MappedFile file;
+
+        if(file.Open(m_filename))
+        {
+            this->ParseContent(static_cast<const char*>(file.GetData()), file.GetSize(), &changes);
+        }
+    }
+
+    Log() << "Reloaded config file \"" << m_filename << "\" with " << changes.size() << " changed variables.";
+
+    // Dispatch changed variables.
+    for(const Detail::ConfigEntry* entry : changes)
+    {
+        Events::Changed event =
+        {
+            ConfigName(entry->name, entry->length, entry->hash),
+            entry->value.load(std::memory_order_acquire)
+        };
+
+        events.changed.Dispatch(event);
+    }
+}
+
+bool Config::LoadCache(const std::string& filename, std::uint64_t size, std::int64_t time)
+{
+    // Check if the cache exists before mapping it, as missing caches are expected.
+    std::string cacheFilename = filename + CacheExtension;
+
+    std::uint64_t cacheSize = 0;
+    std::int64_t cacheTime = 0;
+
+    if(!GetFileStatus(cacheFilename, cacheSize, cacheTime))
+        return false;
+
+    if(!m_cache.Open(cacheFilename))
+        return false;
+
+    SCOPE_GUARD
+    (
+        if(m_entryCount == 0)
+        {
+            m_cache.Cleanup();
+        }
+    );
+
+    // Read the cache header.
+    BinaryReader reader(m_cache.GetData(), m_cache.GetSize());
+
+    std::uint32_t magic = 0;
+    std::uint32_t version = 0;
+    std::uint64_t sourceSize = 0;
+    std::int64_t sourceTime = 0;
+
+    reader.Read(magic);
+    reader.Read(version);
+    reader.Read(sourceSize);
+    reader.Read(sourceTime);
+
+    std::size_t entryCount = 0;
+    const CacheEntry* entries = reader.ReadArray<CacheEntry>(entryCount);
+
+    std::size_t textSize = 0;
+    const char* text = reader.ReadArray<char>(textSize);
+
+    if(!reader.IsValid() || magic != CacheMagic || version != CacheVersion || entries == nullptr || text == nullptr)
+    {
+        LogWarning() << "Config cache \"" << cacheFilename << "\" has an invalid format. Parsing the config file.";
+        return false;
+    }
+
+    // Skip caches of a different version of the config file.
+    if(sourceSize != size || sourceTime != time || entryCount == 0)
+        return false;
+
+    // Validate entries before filling the hash table.
+    for(std::size_t i = 0; i < entryCount; ++i)
+    {
+        const CacheEntry& entry = entries[i];
+
+        bool valid = entry.type <= ConfigValueTypes::Float;
+        valid = valid && (std::uint64_t)entry.nameOffset + entry.nameLength <= textSize;
+        valid = valid && (std::uint64_t)entry.textOffset + entry.textLength <= textSize;
+
+        if(!valid)
+        {
+            LogWarning() << "Config cache \"" << cacheFilename << "\" has an invalid entry. Parsing the config file.";
+            return false;
+        }
+    }
+
+    // Fill the hash table with cached names and values.
+    // Entries are sorted by hashes, so slots are filled mostly in order.
+    this->ReserveEntries(entryCount);
+
+    for(std::size_t i = 0; i < entryCount; ++i)
+    {
+        const CacheEntry& entry = entries[i];
+
+        m_values.emplace_back();
+        ConfigValue* value = &m_values.back();
+
+        value->m_type = (ConfigValueTypes::Type)entry.type;
+        value->m_text = text + entry.textOffset;
+        value->m_length = entry.textLength;
+        value->m_boolean = entry.boolean != 0;
+        value->m_integer = entry.integer;
+        value->m_float = entry.real;
+
+        this->InsertEntry(ConfigName(text + entry.nameOffset, entry.nameLength, entry.hash), value);
+    }
+
+    return true;
+}
+
+void Config::SaveCache(const std::string& filename, std::uint64_t size, std::int64_t time) const
+{
+    // Collect names and values of variables.
+    std::vector<CacheEntry> entries;
+    std::vector<char> text;
+
+    entries.reserve(m_entryCount);
+
+    for(const Detail::ConfigEntry& variable : m_entries)
+    {
+        const ConfigValue& value = *variable.value.load(std::memory_order_relaxed);
+
+        CacheEntry entry = {};
+        entry.hash = variable.hash;
+        entry.integer = value.m_integer;
+        entry.real = value.m_float;
+        entry.nameOffset = (std::uint32_t)text.size();
+        entry.nameLength = (std::uint32_t)variable.length;
+        entry.textOffset = (std::uint32_t)(text.size() + variable.length);
+        entry.textLength = (std::uint32_t)value.m_length;
+        entry.type = (std::uint8_t)value.m_type;
+        entry.boolean = value.m_boolean ? 1 : 0;
+
+        text.insert(text.end(), variable.name, variable.name + variable.length);
+        text.insert(text.end(), value.m_text, value.m_text + value.m_length);
+
+        entries.push_back(entry);
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const CacheEntry& a, const CacheEntry& b)
+    {
+        return a.hash < b.hash;
+    });
+
+    // Write the cache block.
+    std::vector<std::uint8_t> buffer;
+    BinaryWriter writer(buffer);
+
+    writer.Write(CacheMagic);
+    writer.Write(CacheVersion);
+    writer.Write(size);
+    writer.Write(time);
+    writer.WriteArray(entries.data(), entries.size());
+    writer.WriteArray(text.data(), text.size());
+
+    // Write a temporary file and replace the cache with it,
+    // so other processes never map a partially written cache.
+    std::string cacheFilename = filename + CacheExtension;
+    std::string temporaryFilename = cacheFilename + "." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+
+    {
+        std::ofstream file(temporaryFilename, std::ios::binary | std::ios::trunc);
+
+        if(file)
+        {
+            file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+        }
+
+        if(!file)
+        {
+            LogWarning() << "Failed to save a config cache \"" << cacheFilename << "\"! Couldn't write to the file.";
+            std::remove(temporaryFilename.c_str());
+            return;
+        }
+    }
+
+#ifdef WIN32
+    std::remove(cacheFilename.c_str());
+#endif
+
+    if(std::rename(temporaryFilename.c_str(), cacheFilename.c_str()) != 0)
+    {
+        LogWarning() << "Failed to save a config cache \"" << cacheFilename << "\"! Couldn't replace the file.";
+        std::remove(temporaryFilename.c_str());
+    }
+}
+
+void Config::ApplyOverrides(const ConfigInfo& info)
+{
+    std::lock_guard<std::mutex> lock(m_writerMutex);
+
+    // Apply environment variables.
+    if(!info.environmentPrefix.empty())
+    {
+#ifdef WIN32
+        char** environment = _environ;
+#else
+        char** environment = environ;
+#endif
+        const std::string& prefix = info.environmentPrefix;
+
+        for(char** variable = environment; variable != nullptr && *variable != nullptr; ++variable)
+        {
+            const char* text = *variable;
+
+            if(std::strncmp(text, prefix.c_str(), prefix.size()) != 0)
+                continue;
+
+            const char* separator = std::strchr(text, '=');
+
+            if(separator == nullptr || separator == text + prefix.size())
+                continue;
+
+            // Underscores stand for dots, which can't be used in shell variable names.
+            std::string name(text + prefix.size(), separator);
+            std::replace(name.begin(), name.end(), '_', '.');
+
+            this->OverrideVariable(ConfigName(name), separator + 1, std::strlen(separator + 1));
+        }
+    }
+
+    // Apply command line arguments.
+    for(int i = 1; i < info.argumentCount; ++i)
+    {
+        const char* argument = info.arguments[i];
+
+        if(std::strncmp(argument, "--", 2) != 0 || argument[2] == '\0')
+            continue;
+
+        const char* name = argument + 2;
+        const char* separator = std::strchr(name, '=');
+
+        if(separator == nullptr)
+        {
+            // Flags without values are set to true.
+            const char* value = "true";
+            this->OverrideVariable(ConfigName(name, std::strlen(name)), value, std::strlen(value));
+        }
+        else if(separator != name)
+        {
+            this->OverrideVariable(ConfigName(name, separator - name), separator + 1, std::strlen(separator + 1));
+        }
+    }
+}
+
+void Config::OverrideVariable(const ConfigName& name, const char* text, std::size_t length)
+{
+    // Store the value text.
+    m_storage.emplace_back(text, length);
+    const ConfigValue* value = this->CreateValue(m_storage.back().data(), m_storage.back().size());
+
+    // Publish the value, interning the name of a new variable.
+    Detail::ConfigEntry* entry = const_cast<Detail::ConfigEntry*>(this->FindEntry(name));
+
+    if(entry != nullptr)
+    {
+        entry->value.store(value, std::memory_order_release);
+    }
+    else
+    {
+        m_storage.emplace_back(name.GetText(), name.GetLength());
+        entry = this->InsertEntry(ConfigName(m_storage.back().data(), name.GetLength(), name.GetHash()), value);
+    }
+
+    entry->overridden = true;
+
+    Log() << "Config variable \"" << name.GetString() << "\" overridden with \"" << std::string(text, length) << "\".";
+}
+
+void Config::StopWatcher()
+{
+    if(!m_watcher.joinable())
+        return;
+
+    // Stop the watcher thread.
+    m_watcherExit = true;
+    m_watcher.join();
+
+    // Close the platform handle.
+#ifdef WIN32
+    CloseHandle(m_watchHandle);
+    m_watchHandle = INVALID_HANDLE_VALUE;
+#else
+    close(m_watchHandle);
+    m_watchHandle = -1;
+#endif
+
+    m_watcherExit = false;
+}
+
+void Config::RunWatcher()
+{
+    std::string directory;
+    std::string filename;
+    SplitPath(m_filename, directory, filename);
+
+#ifdef WIN32
+    // Wait for overlapped notifications, so the exit flag can be checked.
+    std::wstring wideFilename(filename.begin(), filename.end());
+
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+
+    alignas(DWORD) std::uint8_t buffer[WatcherBufferSize];
+    bool pending = false;
+
+    while(!m_watcherExit)
+    {
+        if(!pending)
+        {
+            ResetEvent(overlapped.hEvent);
+
+            if(!ReadDirectoryChangesW(m_watchHandle, buffer, sizeof(buffer), FALSE,
+                FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME, nullptr, &overlapped, nullptr))
+            {
+                LogError() << "Failed to watch a config file \"" << m_filename << "\"! Couldn't read directory changes.";
+                break;
+            }
+
+            pending = true;
+        }
+
+        if(WaitForSingleObject(overlapped.hEvent, WatcherInterval) != WAIT_OBJECT_0)
+            continue;
+
+        pending = false;
+
+        DWORD size = 0;
+        if(!GetOverlappedResult(m_watchHandle, &overlapped, &size, FALSE))
+            continue;
+
+        // Overflowed notifications are reported with zero size.
+        if(size == 0)
+        {
+            m_fileChanged = true;
+            continue;
+        }
+
+        // Check if any notification is about the config file.
+        for(std::size_t offset = 0; ; )
+        {
+            const FILE_NOTIFY_INFORMATION* notify = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(buffer + offset);
+            std::wstring name(notify->FileName, notify->FileNameLength / sizeof(WCHAR));
+
+            if(_wcsicmp(name.c_str(), wideFilename.c_str()) == 0)
+            {
+                m_fileChanged = true;
+            }
+
+            if(notify->NextEntryOffset == 0)
+                break;
+
+            offset += notify->NextEntryOffset;
+        }
+    }
+
+    // Cancel the pending notification before the buffer goes away.
+    if(pending)
+    {
+        DWORD size = 0;
+        CancelIo(m_watchHandle);
+        GetOverlappedResult(m_watchHandle, &overlapped, &size, TRUE);
+    }
+
+    CloseHandle(overlapped.hEvent);
+#else
+    alignas(struct inotify_event) char buffer[WatcherBufferSize];
+
+    while(!m_watcherExit)
+    {
+        // Wait for notifications, so the exit flag can be checked.
+        pollfd descriptor = { m_watchHandle, POLLIN, 0 };
+
+        if(poll(&descriptor, 1, WatcherInterval) <= 0)
+            continue;
+
+        ssize_t size = read(m_watchHandle, buffer, sizeof(buffer));
+
+        if(size <= 0)
+            continue;
+
+        // Check if any notification is about the config file.
+        for(char* data = buffer; data < buffer + size; )
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(data);
+
+            if((event->mask & IN_Q_OVERFLOW) || (event->len != 0 && filename == event->name))
+            {
+                m_fileChanged = true;
+            }
+
+            data += sizeof(inotify_event) + event->len;
+        }
+    }
+#endif
+}
+
+const Detail::ConfigEntry* Config::FindEntry(const ConfigName& name) const
+{
+    const Table* table = m_table.load(std::memory_order_acquire);
+
+    if(table == nullptr)
+        return nullptr;
+
+    // Probe slots until the name or an empty slot is found.
+    std::size_t mask = table->size - 1;
+
+    for(std::size_t index = name.GetHash() & mask; ; index = (index + 1) & mask)
+    {
+        const Detail::ConfigEntry* entry = table->slots[index].load(std::memory_order_acquire);
+
+        if(entry == nullptr)
+            return nullptr;
+
+        if(entry->hash == name.GetHash() && entry->length == name.GetLength() && std::memcmp(entry->name, name.GetText(), entry->length) == 0)
+            return entry;
+    }
+}
+
+Detail::ConfigEntry* Config::InsertEntry(const ConfigName& name, const ConfigValue* value)
+{
+    // Keep the load factor below three quarters.
+    const Table* table = m_table.load(std::memory_order_relaxed);
+
+    if(table == nullptr || (m_entryCount + 1) * 4 > table->size * 3)
+    {
+        this->ReserveEntries(m_entryCount + 1);
+        table = m_table.load(std::memory_order_relaxed);
+    }
+
+    // Create an entry and publish it in the first empty slot.
+    m_entries.emplace_back(name, value);
+    Detail::ConfigEntry* entry = &m_entries.back();
+
+    std::size_t mask = table->size - 1;
+    std::size_t index = name.GetHash() & mask;
+
+    while(table->slots[index].load(std::memory_order_relaxed) != nullptr)
+    {
+        index = (index + 1) & mask;
+    }
+
+    table->slots[index].store(entry, std::memory_order_release);
+
+    ++m_entryCount;
+    return entry;
+}
+
+const Detail::ConfigEntry* Config::StoreVariable(const ConfigName& name, const std::string& text, bool replace)
+{
+    std::lock_guard<std::mutex> lock(m_writerMutex);
+
+    // Keep an existing value if requested.
+    Detail::ConfigEntry* entry = const_cast<Detail::ConfigEntry*>(this->FindEntry(name));
+
+    if(entry != nullptr && !replace)
+        return entry;
+
+    // Store the value text.
+    m_storage.push_back(text);
+    const ConfigValue* value = this->CreateValue(m_storage.back().data(), m_storage.back().size());
+
+    // Publish the value of an existing variable.
+    if(entry != nullptr)
+    {
+        entry->value.store(value, std::memory_order_release);
+        return entry;
+    }
+
+    // Intern the name of a new variable.
+    m_storage.emplace_back(name.GetText(), name.GetLength());
+    return this->InsertEntry(ConfigName(m_storage.back().data(), name.GetLength(), name.GetHash()), value);
+}
+
+const ConfigValue* Config::CreateValue(const char* text, std::size_t length)
+{
+    m_values.emplace_back();
+    m_values.back().Parse(text, length);
+    return &m_values.back();
+}
+
+void Config::ReserveEntries(std::size_t count)
+{
+    // Calculate a power of two size that keeps the load factor below three quarters.
+    std::size_t size = 16;
+
+    while(size * 3 < count * 4)
+    {
+        size *= 2;
+    }
+
+    const Table* current = m_table.load(std::memory_order_relaxed);
+
+    if(current != nullptr && size <= current->size)
+        return;
+
+    // Insert entries into a larger table.
+    std::unique_ptr<Table> table(new Table(size));
+    std::size_t mask = size - 1;
+
+    for(const Detail::ConfigEntry& entry : m_entries)
+    {
+        std::size_t index = entry.hash & mask;
+
+        while(table->slots[index].load(std::memory_order_relaxed) != nullptr)
+        {
+            index = (index + 1) & mask;
+        }
+
+        table->slots[index].store(&entry, std::memory_order_relaxed);
+    }
+
+    // Publish the table while keeping the replaced one for threads still reading it.
+    m_table.store(table.get(), std::memory_order_release);
+    m_tables.push_back(std::move(table));
+}
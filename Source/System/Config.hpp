@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Precompiled.hpp"
+#include "Common/MappedFile.hpp"
 
 //
 // Config
@@ -8,17 +9,290 @@
 //  Stores application's configuration which can be
 //  read from a file and then accessed in runtime.
 //
+//  Config files are read once and parsed in a single pass over the content.
+//  Names and values are kept as slices into the content instead of copies,
+//  so loading a large config does not allocate a string per variable.
+//
+//  Each line holds a single "Name = Value" pair, with surrounding white
+//  spaces trimmed. Lines starting with '#' or ';' are comments. Variables
+//  defined more than once take the last value.
+//
+//  Variables are stored in an open addressing hash table of interned names,
+//  which point into the file content or to names copied once when set. Names
+//  are passed as ConfigName, which hashes string literals with constexpr
+//  FNV-1a, so a lookup does not allocate and only compares names whose full
+//  hashes match.
+//
+//  Values are parsed once when loaded or set, into a boolean, an integer,
+//  a floating point number or a string. Reading a variable only converts
+//  between these types. Code that reads a variable often, such as tuning
+//  values read every frame, can resolve it once into a handle and read it
+//  without looking it up by name. Handles stay valid until the config is
+//  cleaned up and see values set after they were resolved.
+//
+//  Variables can be read from any thread without locks. Getting a variable
+//  only looks it up and never inserts it, while setting, resolving and
+//  reloading variables are serialized by a writer lock. Parsed values are
+//  never modified, a changed variable atomically points to a new value.
+//  The hash table is only appended to, and a grown table is swapped in
+//  atomically, with replaced tables and values kept until cleanup.
+//
+//  Loading a config file writes a binary cache next to it, which holds
+//  hashed names with their parsed values, sorted by hashes. Following loads
+//  map the cache and fill the hash table without parsing, as long as the
+//  size and modification time of the config file still match. The cache is
+//  replaced atomically, so many processes can start at once.
+//
+//  Variables can be overridden by environment variables and command line
+//  arguments, which take precedence in that order over the config file.
+//  Environment variables are matched by a prefix, with underscores in the
+//  rest of their names standing for dots. Command line arguments take the
+//  form of "--Name=Value", or "--Name" for a true value. Overridden
+//  variables are not cached and keep their values when the file reloads.
+//
+//  Example overrides:
+//      GAME_Window_Vsync=false ./Game --Simulation.TickRate=30
+//
+//  A config can watch its file on a background thread and reload it when
+//  the file is written. Reloading happens on the thread that processes
+//  changes, which parses the file again and dispatches an event for each
+//  variable whose value text has changed. Variables removed from the file
+//  keep their last values. Receivers can set a name key to only receive
+//  changes of a single variable.
+//
+//  Example config file:
+//      # Window settings.
+//      Window.Width = 1280
+//      Window.Height = 720
+//      Window.Vsync = true
+//
 //  Example usage:
+//      System::ConfigInfo info;
+//      info.filename = "Game.cfg";
+//      info.argumentCount = argc;
+//      info.arguments = argv;
+//      info.environmentPrefix = "GAME_";
+//
 //      System::Config config;
-//      config.Initialize("Game.cfg");
-//      
+//      config.Initialize(info);
+//
+//      // Missing variables are not registered by getting them.
 //      width = config.GetVariable<int>("Window.Width", 1024);
 //      height = config.GetVariable<int>("Window.Height", 576);
 //      vsync = config.GetVariable<bool>("Window.Vsync", true);
 //
+//      System::ConfigVariable<float> gravity;
+//      gravity = config.ResolveVariable<float>("Physics.Gravity", 9.81f);
+//
+//      velocity.y -= gravity.Get() * timeDelta;
+//
+//  Reloading changed config files:
+//      void Class::OnGravityChanged(const Config::Events::Changed& event) { /*...*/ }
+//
+//      Receiver<void(const Config::Events::Changed&)> receiver;
+//      receiver.Bind<Class, &Class::OnGravityChanged>(&instance);
+//      receiver.SetKey(System::ConfigName("Physics.Gravity").GetKey());
+//      receiver.Subscribe(config.events.changed);
+//
+//      config.Watch();
+//
+//      while(window.IsOpen())
+//      {
+//          config.ProcessChanges();
+//          /* ... */
+//      }
+//
 
 namespace System
 {
+    // Implementation details.
+    namespace Detail
+    {
+        // FNV-1a hash constants.
+        const std::uint64_t NameHashOffset = 14695981039346656037ull;
+        const std::uint64_t NameHashPrime = 1099511628211ull;
+
+        // Calculates the FNV-1a hash of a name in a constant expression.
+        constexpr std::uint64_t HashName(const char* text, std::size_t length, std::uint64_t hash = NameHashOffset)
+        {
+            return length == 0 ? hash : HashName(text + 1, length - 1, (hash ^ (std::uint8_t)*text) * NameHashPrime);
+        }
+    }
+
+    // Config variable name.
+    // Name text is not copied and has to outlive the name.
+    class ConfigName
+    {
+    public:
+        // Creates a name from a string literal, hashed at compile time in constant expressions.
+        template<std::size_t Size>
+        constexpr ConfigName(const char (&literal)[Size]) :
+            m_text(literal),
+            m_length(Size - 1),
+            m_hash(Detail::HashName(literal, Size - 1))
+        {
+        }
+
+        // Creates a name from a string.
+        ConfigName(const std::string& name);
+
+        // Creates a name from a text.
+        ConfigName(const char* text, std::size_t length);
+
+        // Creates a name from a text with a precomputed hash.
+        ConfigName(const char* text, std::size_t length, std::uint64_t hash);
+
+        // Gets the name text.
+        constexpr const char* GetText() const
+        {
+            return m_text;
+        }
+
+        // Gets the name length.
+        constexpr std::size_t GetLength() const
+        {
+            return m_length;
+        }
+
+        // Gets the name hash.
+        constexpr std::uint64_t GetHash() const
+        {
+            return m_hash;
+        }
+
+        // Gets the name hash folded into a dispatcher key.
+        constexpr int GetKey() const
+        {
+            return (int)(std::uint32_t)(m_hash ^ (m_hash >> 32));
+        }
+
+        // Converts the name to a string.
+        std::string GetString() const;
+
+    private:
+        const char* m_text;
+        std::size_t m_length;
+        std::uint64_t m_hash;
+    };
+
+    // Types of config values.
+    struct ConfigValueTypes
+    {
+        enum Type
+        {
+            String,
+            Boolean,
+            Integer,
+            Float,
+        };
+    };
+
+    // Config value parsed from its text.
+    class ConfigValue
+    {
+    public:
+        ConfigValue();
+
+        // Parses a value from a text.
+        // Text is not copied and has to outlive the value.
+        void Parse(const char* text, std::size_t length);
+
+        // Converts the value to a requested type.
+        bool Get(bool& value) const;
+        bool Get(std::string& value) const;
+
+        template<typename Type>
+        typename std::enable_if<std::is_arithmetic<Type>::value, bool>::type Get(Type& value) const;
+
+        template<typename Type>
+        typename std::enable_if<!std::is_arithmetic<Type>::value, bool>::type Get(Type& value) const;
+
+        // Gets the value type.
+        ConfigValueTypes::Type GetType() const;
+
+        // Gets the value text.
+        std::string GetText() const;
+
+        // Gets the value text without copying it.
+        const char* GetTextData() const;
+        std::size_t GetTextLength() const;
+
+    private:
+        // Config loads parsed values from its cache.
+        friend class Config;
+
+        // Value type.
+        ConfigValueTypes::Type m_type;
+
+        // Value text.
+        const char* m_text;
+        std::size_t m_length;
+
+        // Parsed value.
+        bool m_boolean;
+        std::int64_t m_integer;
+        double m_float;
+    };
+
+    // Implementation details.
+    namespace Detail
+    {
+        // Config variable entry, whose value is replaced atomically.
+        struct ConfigEntry
+        {
+            ConfigEntry(const ConfigName& name, const ConfigValue* value);
+
+            const std::uint64_t hash;
+            const char* const name;
+            const std::size_t length;
+
+            std::atomic<const ConfigValue*> value;
+
+            // Overridden entries are skipped when reloading.
+            // Only accessed with the writer lock held.
+            bool overridden;
+        };
+    }
+
+    // Config variable handle.
+    template<typename Type>
+    class ConfigVariable
+    {
+    public:
+        ConfigVariable();
+        ConfigVariable(const Detail::ConfigEntry* entry, const Type& defaultValue);
+
+        // Gets the variable value, or the default value if it can't be converted.
+        Type Get() const;
+
+        // Checks if the handle has been resolved.
+        bool IsValid() const;
+
+    private:
+        // Resolved variable entry.
+        const Detail::ConfigEntry* m_entry;
+
+        // Value returned if the variable can't be converted.
+        Type m_default;
+    };
+
+    // Config initialization struct.
+    struct ConfigInfo
+    {
+        // Config file, optional.
+        std::string filename;
+
+        // Command line arguments with overrides, optional.
+        int argumentCount;
+        char** arguments;
+
+        // Prefix of environment variables with overrides.
+        // Environment is not read if the prefix is empty.
+        std::string environmentPrefix;
+
+        ConfigInfo();
+    };
+
     // Config class.
     class Config : private NonCopyable
     {
@@ -29,24 +303,168 @@ namespace System
         // Restores instance to its original state.
         void Cleanup();
 
-        // Initializes the config.
-        bool Initialize(const std::string filename = "");
+        // Initializes the config, loads variables from a file and applies overrides.
+        // Config file is optional, defaults are used if it does not exist.
+        bool Initialize(const ConfigInfo& info = ConfigInfo());
+
+        // Starts watching the config file for changes.
+        bool Watch();
+
+        // Reloads the config file if it has changed and dispatches changed variables.
+        void ProcessChanges();
 
         // Sets a config variable.
         template<typename Type>
-        void SetVariable(const std::string name, const Type& value);
+        void SetVariable(const ConfigName& name, const Type& value);
 
-        // Gets a config variable.
+        // Gets a config variable, or the default value if it does not exist.
+        // Can be called from any thread.
         template<typename Type>
-        Type GetVariable(const std::string name, const Type& default);
+        Type GetVariable(const ConfigName& name, const Type& defaultValue) const;
+
+        // Resolves a config variable into a handle.
+        // Sets the variable to the default value if it does not exist.
+        template<typename Type>
+        ConfigVariable<Type> ResolveVariable(const ConfigName& name, const Type& defaultValue);
+
+    public:
+        // Config events.
+        struct Events
+        {
+            // Variable changed event.
+            // Receivers can set a name key to only receive events of that variable.
+            struct Changed
+            {
+                ConfigName name;
+                const ConfigValue* value;
+            };
+
+            Dispatcher<void(const Changed&)> changed;
+        } events;
 
     private:
+        // Hash table of variable entries.
+        // Slots are only filled, never emptied or replaced.
+        struct Table
+        {
+            Table(std::size_t size);
+
+            std::unique_ptr<std::atomic<const Detail::ConfigEntry*>[]> slots;
+            std::size_t size;
+        };
+
+        // Cached variable entry.
+        // Names and value texts are stored at offsets in a text block.
+        struct CacheEntry
+        {
+            std::uint64_t hash;
+            std::int64_t integer;
+            double real;
+            std::uint32_t nameOffset;
+            std::uint32_t nameLength;
+            std::uint32_t textOffset;
+            std::uint32_t textLength;
+            std::uint8_t type;
+            std::uint8_t boolean;
+            std::uint8_t padding[6];
+        };
+
         // Type declarations.
-        typedef std::map<std::string, std::string> VariableMap;
+        typedef std::vector<std::unique_ptr<Table>> TableList;
+        typedef std::deque<Detail::ConfigEntry> EntryList;
+        typedef std::deque<ConfigValue> ValueList;
+        typedef std::deque<std::string> TextStorage;
+        typedef std::vector<const Detail::ConfigEntry*> ChangeList;
 
     private:
-        // Map of variables.
-        VariableMap m_variables;
+        // Parses variables from config file content.
+        // Reloaded content is temporary, so changed names and values are copied
+        // and changed entries are added to the list if it is provided.
+        void ParseContent(const char* data, std::size_t size, ChangeList* changes);
+
+        // Reloads the config file and dispatches changed variables.
+        void ReloadFile();
+
+        // Loads variables from the cache of a config file with a matching size and modification time.
+        bool LoadCache(const std::string& filename, std::uint64_t size, std::int64_t time);
+
+        // Saves loaded variables into the cache of a config file.
+        void SaveCache(const std::string& filename, std::uint64_t size, std::int64_t time) const;
+
+        // Overrides variables with environment variables and command line arguments.
+        void ApplyOverrides(const ConfigInfo& info);
+
+        // Overrides a variable, which is then kept when reloading.
+        // Must be called with the writer lock held.
+        void OverrideVariable(const ConfigName& name, const char* text, std::size_t length);
+
+        // Stops the watcher thread.
+        void StopWatcher();
+
+        // Runs the watcher thread.
+        void RunWatcher();
+
+        // Finds a variable entry, returns nullptr if it does not exist.
+        const Detail::ConfigEntry* FindEntry(const ConfigName& name) const;
+
+        // Inserts a variable entry with an interned name.
+        // Must be called with the writer lock held.
+        Detail::ConfigEntry* InsertEntry(const ConfigName& name, const ConfigValue* value);
+
+        // Stores a variable value set in runtime, unless it exists and should be kept.
+        const Detail::ConfigEntry* StoreVariable(const ConfigName& name, const std::string& text, bool replace);
+
+        // Creates a value that is not modified once published.
+        const ConfigValue* CreateValue(const char* text, std::size_t length);
+
+        // Grows the hash table to fit a number of variables.
+        // Must be called with the writer lock held.
+        void ReserveEntries(std::size_t count);
+
+        // Formats a value set in runtime.
+        template<typename Type>
+        static std::string FormatValue(const Type& value);
+
+    private:
+        // Config file.
+        std::string m_filename;
+
+        // Content of the config file.
+        // Content is not mapped, as it would change under slices when the file is written.
+        std::vector<char> m_content;
+
+        // Mapped cache of the config file.
+        // Cache files are replaced instead of written, so the mapping does not change.
+        MappedFile m_cache;
+
+        // Lock that serializes changes of variables.
+        std::mutex m_writerMutex;
+
+        // Names and values copied in runtime.
+        // Deque does not move stored strings when it grows.
+        TextStorage m_storage;
+
+        // Current hash table with a power of two size.
+        // Replaced tables are kept, as other threads may still read them.
+        std::atomic<const Table*> m_table;
+        TableList m_tables;
+        std::size_t m_entryCount;
+
+        // Variable entries and values.
+        // Deques do not move elements when they grow, so pointers to them stay valid.
+        EntryList m_entries;
+        ValueList m_values;
+
+        // Watcher thread and its platform handle.
+        std::thread m_watcher;
+        std::atomic<bool> m_watcherExit;
+        std::atomic<bool> m_fileChanged;
+
+#ifdef WIN32
+        HANDLE m_watchHandle;
+#else
+        int m_watchHandle;
+#endif
 
         // Initialization state.
         bool m_initialized;
@@ -54,38 +472,138 @@ namespace System
 
     // Template implementations.
     template<typename Type>
-    void Config::SetVariable(const std::string name, const Type& value)
+    typename std::enable_if<std::is_arithmetic<Type>::value, bool>::type ConfigValue::Get(Type& value) const
+    {
+        switch(m_type)
+        {
+        case ConfigValueTypes::Boolean:
+            value = (Type)m_boolean;
+            return true;
+
+        case ConfigValueTypes::Integer:
+            value = (Type)m_integer;
+            return true;
+
+        case ConfigValueTypes::Float:
+            value = (Type)m_float;
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    template<typename Type>
+    typename std::enable_if<!std::is_arithmetic<Type>::value, bool>::type ConfigValue::Get(Type& value) const
+    {
+        // Convert other types from the value text.
+        std::istringstream convert(this->GetText());
+        convert >> value;
+        return !convert.fail();
+    }
+
+    template<typename Type>
+    ConfigVariable<Type>::ConfigVariable() :
+        m_entry(nullptr),
+        m_default()
+    {
+    }
+
+    template<typename Type>
+    ConfigVariable<Type>::ConfigVariable(const Detail::ConfigEntry* entry, const Type& defaultValue) :
+        m_entry(entry),
+        m_default(defaultValue)
+    {
+    }
+
+    template<typename Type>
+    Type ConfigVariable<Type>::Get() const
+    {
+        if(m_entry == nullptr)
+            return m_default;
+
+        Type value;
+
+        if(!m_entry->value.load(std::memory_order_acquire)->Get(value))
+            return m_default;
+
+        return value;
+    }
+
+    template<typename Type>
+    bool ConfigVariable<Type>::IsValid() const
+    {
+        return m_entry != nullptr;
+    }
+
+    template<typename Type>
+    std::string Config::FormatValue(const Type& value)
+    {
+        std::ostringstream convert;
+        convert << std::boolalpha << std::setprecision(std::numeric_limits<Type>::max_digits10) << value;
+        return convert.str();
+    }
+
+    template<typename Type>
+    void Config::SetVariable(const ConfigName& name, const Type& value)
     {
         if(!m_initialized)
             return;
 
         // Set the variable value.
-        m_variables.insert_or_assign(name, std::to_string(value));
+        this->StoreVariable(name, FormatValue(value), true);
     }
 
     template<typename Type>
-    Type Config::GetVariable(const std::string name, const Type& default)
+    Type Config::GetVariable(const ConfigName& name, const Type& defaultValue) const
     {
         if(!m_initialized)
-            return Type();
+            return defaultValue;
 
         // Find the variable by name.
-        auto it = m_variables.find(name);
+        const Detail::ConfigEntry* entry = this->FindEntry(name);
+
+        if(entry == nullptr)
+            return defaultValue;
+
+        // Convert the parsed variable value.
+        const ConfigValue* variable = entry->value.load(std::memory_order_acquire);
+
+        Type value;
 
-        // Set a new variable if it does not exist.
-        if(it == m_variables.end())
+        if(!variable->Get(value))
         {
-            auto result = m_variables.insert(std::make_pair(name, std::to_string(default)));
-            Assert(result.second, "Failed to insert a config variable!");
+            LogWarning() << "Config variable \"" << name.GetString() << "\" has an invalid value \"" << variable->GetText() << "\"!";
+            return defaultValue;
+        }
+
+        return value;
+    }
 
-            it = result.first;
+    template<typename Type>
+    ConfigVariable<Type> Config::ResolveVariable(const ConfigName& name, const Type& defaultValue)
+    {
+        if(!m_initialized)
+            return ConfigVariable<Type>();
+
+        // Register the variable with the default value if it does not exist.
+        const Detail::ConfigEntry* entry = this->FindEntry(name);
+
+        if(entry == nullptr)
+        {
+            entry = this->StoreVariable(name, FormatValue(defaultValue), false);
         }
 
-        // Convert variable value from a string and return it.
-        std::istringstream convert(it->second);
+        // Warn once about a value that can't be converted.
+        const ConfigValue* variable = entry->value.load(std::memory_order_acquire);
 
         Type value;
-        convert >> value;
-        return value;
+
+        if(!variable->Get(value))
+        {
+            LogWarning() << "Config variable \"" << name.GetString() << "\" has an invalid value \"" << variable->GetText() << "\"!";
+        }
+
+        return ConfigVariable<Type>(entry, defaultValue);
     }
 }
@@ -0,0 +1,752 @@
+#include "Precompiled.hpp"
+#include "DataTable.hpp"
+using namespace System;
+
+namespace
+{
+    // Log message strings.
+    #define LogOpenError(filename) "Failed to open \"" << filename << "\" data table! "
+    #define LogCompileError(filename) "Failed to compile \"" << filename << "\" data table! "
+
+    // Identifier and version of table files.
+    const std::uint32_t FileMagic = 0x4C425444; // "DTBL"
+    const std::uint32_t FileVersion = 1;
+
+    // Table file header.
+    struct FileHeader
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint32_t rowCount;
+        std::uint32_t columnCount;
+        std::uint32_t slotCount;
+        std::uint32_t reserved;
+        std::uint64_t columnsOffset;
+        std::uint64_t rowHashesOffset;
+        std::uint64_t slotsOffset;
+        std::uint64_t stringsOffset;
+        std::uint64_t stringsSize;
+    };
+
+    // Gets the size of a cell of a column type.
+    std::size_t GetCellSize(std::uint32_t type)
+    {
+        switch(type)
+        {
+        case DataColumnTypes::Integer:
+            return sizeof(std::int32_t);
+
+        case DataColumnTypes::Float:
+            return sizeof(float);
+
+        case DataColumnTypes::Boolean:
+            return sizeof(std::uint8_t);
+
+        case DataColumnTypes::String:
+            return sizeof(DataString);
+
+        default:
+            return 0;
+        }
+    }
+
+    // Gets the number of rows stored in columns, including padding.
+    std::size_t GetPaddedRowCount(std::size_t rowCount)
+    {
+        return (rowCount + DataTable::RowPadding - 1) / DataTable::RowPadding * DataTable::RowPadding;
+    }
+
+    // Aligns an offset within a file.
+    std::size_t AlignOffset(std::size_t offset, std::size_t alignment)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    // Trims white spaces around a field.
+    std::string TrimField(const std::string& field)
+    {
+        std::size_t begin = field.find_first_not_of(" \t");
+        std::size_t end = field.find_last_not_of(" \t");
+
+        if(begin == std::string::npos)
+            return std::string();
+
+        return field.substr(begin, end - begin + 1);
+    }
+
+    // Reads a record of comma separated fields.
+    // Quoted fields keep their white spaces and can hold commas, quotes and line breaks.
+    bool ReadRecord(const std::string& content, std::size_t& position, int& lineNumber, std::vector<std::string>& fields)
+    {
+        fields.clear();
+
+        if(position >= content.size())
+            return false;
+
+        std::string field;
+        bool quoted = false;
+        bool wasQuoted = false;
+
+        while(position < content.size())
+        {
+            char character = content[position++];
+
+            if(quoted)
+            {
+                if(character == '"')
+                {
+                    if(position < content.size() && content[position] == '"')
+                    {
+                        field += '"';
+                        ++position;
+                    }
+                    else
+                    {
+                        quoted = false;
+                    }
+                }
+                else
+                {
+                    if(character == '\n')
+                        ++lineNumber;
+
+                    field += character;
+                }
+            }
+            else if(character == '"' && TrimField(field).empty())
+            {
+                field.clear();
+                quoted = true;
+                wasQuoted = true;
+            }
+            else if(character == ',')
+            {
+                fields.push_back(wasQuoted ? field : TrimField(field));
+                field.clear();
+                wasQuoted = false;
+            }
+            else if(character == '\n')
+            {
+                ++lineNumber;
+                break;
+            }
+            else if(character != '\r' && !(wasQuoted && (character == ' ' || character == '\t')))
+            {
+                field += character;
+            }
+        }
+
+        fields.push_back(wasQuoted ? field : TrimField(field));
+        return true;
+    }
+
+    // Parses a cell into its column type.
+    bool ParseCell(const std::string& text, std::uint32_t type, std::int32_t& integer, float& real, std::uint8_t& boolean)
+    {
+        if(text.empty())
+            return false;
+
+        char* end = nullptr;
+
+        switch(type)
+        {
+        case DataColumnTypes::Integer:
+            {
+                // Out of range values saturate, which fails the range check.
+                long long value = std::strtoll(text.c_str(), &end, 10);
+
+                if(*end != '\0' || value < std::numeric_limits<std::int32_t>::min() || value > std::numeric_limits<std::int32_t>::max())
+                    return false;
+
+                integer = (std::int32_t)value;
+                return true;
+            }
+
+        case DataColumnTypes::Float:
+            real = std::strtof(text.c_str(), &end);
+            return *end == '\0';
+
+        case DataColumnTypes::Boolean:
+            if(text == "true" || text == "1")
+            {
+                boolean = 1;
+                return true;
+            }
+
+            if(text == "false" || text == "0")
+            {
+                boolean = 0;
+                return true;
+            }
+
+            return false;
+
+        default:
+            return false;
+        }
+    }
+}
+
+DataTable::DataTable() :
+    m_data(nullptr),
+    m_columns(nullptr),
+    m_rowHashes(nullptr),
+    m_slots(nullptr),
+    m_strings(nullptr),
+    m_stringsSize(0),
+    m_rowCount(0),
+    m_columnCount(0),
+    m_slotMask(0),
+    m_initialized(false)
+{
+}
+
+DataTable::~DataTable()
+{
+    this->Cleanup();
+}
+
+void DataTable::Cleanup()
+{
+    m_file.Cleanup();
+
+    m_data = nullptr;
+    m_columns = nullptr;
+    m_rowHashes = nullptr;
+    m_slots = nullptr;
+    m_strings = nullptr;
+    m_stringsSize = 0;
+    m_rowCount = 0;
+    m_columnCount = 0;
+    m_slotMask = 0;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool DataTable::Open(const std::string& filename)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            this->Cleanup();
+        }
+    );
+
+    // Map the file, which parsed data points into.
+    if(!m_file.Open(filename))
+    {
+        LogError() << LogOpenError(filename) << "Couldn't map the file.";
+        return false;
+    }
+
+    if(!this->ParseContent(filename, m_file.GetData(), m_file.GetSize()))
+        return false;
+
+    // Success!
+    return m_initialized = true;
+}
+
+bool DataTable::Parse(const std::string& filename, const void* data, std::size_t size)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            this->Cleanup();
+        }
+    );
+
+    if(!this->ParseContent(filename, data, size))
+        return false;
+
+    // Success!
+    return m_initialized = true;
+}
+
+int DataTable::FindRow(const ConfigName& identifier) const
+{
+    if(!m_initialized)
+        return NotFound;
+
+    // Probe slots until the row or an empty slot is found.
+    // Compiling guarantees that identifiers have distinct hashes.
+    std::uint64_t hash = identifier.GetHash();
+    std::uint32_t slot = (std::uint32_t)hash & m_slotMask;
+
+    while(m_slots[slot] != 0)
+    {
+        std::uint32_t row = m_slots[slot] - 1;
+
+        if(m_rowHashes[row] == hash)
+            return (int)row;
+
+        slot = (slot + 1) & m_slotMask;
+    }
+
+    return NotFound;
+}
+
+int DataTable::FindColumn(const ConfigName& name) const
+{
+    if(!m_initialized)
+        return NotFound;
+
+    // Tables have few columns, so they are searched linearly.
+    for(int i = 0; i < m_columnCount; ++i)
+    {
+        if(m_columns[i].nameHash == name.GetHash())
+            return i;
+    }
+
+    return NotFound;
+}
+
+const std::int32_t* DataTable::GetIntegers(int column) const
+{
+    return static_cast<const std::int32_t*>(this->GetColumnData(column, DataColumnTypes::Integer));
+}
+
+const float* DataTable::GetFloats(int column) const
+{
+    return static_cast<const float*>(this->GetColumnData(column, DataColumnTypes::Float));
+}
+
+const std::uint8_t* DataTable::GetBooleans(int column) const
+{
+    return static_cast<const std::uint8_t*>(this->GetColumnData(column, DataColumnTypes::Boolean));
+}
+
+const DataString* DataTable::GetStrings(int column) const
+{
+    return static_cast<const DataString*>(this->GetColumnData(column, DataColumnTypes::String));
+}
+
+StringView DataTable::GetString(int column, int row) const
+{
+    Assert(row >= 0 && row < m_rowCount, "Invalid row index!");
+
+    const DataString* strings = this->GetStrings(column);
+
+    if(strings == nullptr)
+        return StringView();
+
+    return StringView(m_strings + strings[row].offset, strings[row].length);
+}
+
+StringView DataTable::GetRowIdentifier(int row) const
+{
+    return this->GetString(0, row);
+}
+
+StringView DataTable::GetColumnName(int column) const
+{
+    Assert(column >= 0 && column < m_columnCount, "Invalid column index!");
+
+    return StringView(m_strings + m_columns[column].nameOffset, m_columns[column].nameLength);
+}
+
+DataColumnTypes::Type DataTable::GetColumnType(int column) const
+{
+    Assert(column >= 0 && column < m_columnCount, "Invalid column index!");
+
+    return (DataColumnTypes::Type)m_columns[column].type;
+}
+
+int DataTable::GetRowCount() const
+{
+    return m_rowCount;
+}
+
+int DataTable::GetColumnCount() const
+{
+    return m_columnCount;
+}
+
+bool DataTable::IsValid() const
+{
+    return m_initialized;
+}
+
+const void* DataTable::GetColumnData(int column, DataColumnTypes::Type type) const
+{
+    if(!m_initialized || column < 0 || column >= m_columnCount)
+        return nullptr;
+
+    if(m_columns[column].type != (std::uint32_t)type)
+    {
+        Assert(false, "Data table column has a different type!");
+        return nullptr;
+    }
+
+    return m_data + m_columns[column].dataOffset;
+}
+
+bool DataTable::ParseContent(const std::string& filename, const void* data, std::size_t size)
+{
+    // Validate the header.
+    if(data == nullptr || size < sizeof(FileHeader))
+    {
+        LogError() << LogOpenError(filename) << "File is too small.";
+        return false;
+    }
+
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+
+    if(reinterpret_cast<std::uintptr_t>(bytes) % ColumnAlignment != 0)
+    {
+        LogError() << LogOpenError(filename) << "Content is not aligned.";
+        return false;
+    }
+
+    const FileHeader* header = reinterpret_cast<const FileHeader*>(bytes);
+
+    if(header->magic != FileMagic || header->version != FileVersion)
+    {
+        LogError() << LogOpenError(filename) << "Unsupported file format.";
+        return false;
+    }
+
+    if(header->columnCount == 0 || header->rowCount > (std::uint32_t)std::numeric_limits<int>::max() ||
+        header->slotCount <= header->rowCount || (header->slotCount & (header->slotCount - 1)) != 0)
+    {
+        LogError() << LogOpenError(filename) << "Invalid table dimensions.";
+        return false;
+    }
+
+    // Validate ranges of the index and the string pool.
+    auto IsRangeValid = [size](std::uint64_t offset, std::uint64_t length, std::size_t alignment)
+    {
+        return offset % alignment == 0 && offset <= size && length <= size - offset;
+    };
+
+    if(!IsRangeValid(header->columnsOffset, (std::uint64_t)header->columnCount * sizeof(Column), alignof(Column)) ||
+        !IsRangeValid(header->rowHashesOffset, (std::uint64_t)header->rowCount * sizeof(std::uint64_t), alignof(std::uint64_t)) ||
+        !IsRangeValid(header->slotsOffset, (std::uint64_t)header->slotCount * sizeof(std::uint32_t), alignof(std::uint32_t)) ||
+        !IsRangeValid(header->stringsOffset, header->stringsSize, 1))
+    {
+        LogError() << LogOpenError(filename) << "Invalid index.";
+        return false;
+    }
+
+    const Column* columns = reinterpret_cast<const Column*>(bytes + header->columnsOffset);
+    const std::uint32_t* slots = reinterpret_cast<const std::uint32_t*>(bytes + header->slotsOffset);
+    std::size_t paddedRowCount = GetPaddedRowCount(header->rowCount);
+
+    // Validate columns, with identifiers in the first one.
+    for(std::uint32_t i = 0; i < header->columnCount; ++i)
+    {
+        const Column& column = columns[i];
+        std::size_t cellSize = GetCellSize(column.type);
+
+        if(cellSize == 0 || (i == 0 && column.type != DataColumnTypes::String) ||
+            !IsRangeValid(column.dataOffset, paddedRowCount * cellSize, ColumnAlignment) ||
+            (std::uint64_t)column.nameOffset + column.nameLength > header->stringsSize)
+        {
+            LogError() << LogOpenError(filename) << "Invalid column.";
+            return false;
+        }
+
+        // Cells of string columns have to point into the string pool.
+        if(column.type == DataColumnTypes::String)
+        {
+            const DataString* strings = reinterpret_cast<const DataString*>(bytes + column.dataOffset);
+
+            for(std::uint32_t row = 0; row < header->rowCount; ++row)
+            {
+                if((std::uint64_t)strings[row].offset + strings[row].length > header->stringsSize)
+                {
+                    LogError() << LogOpenError(filename) << "Invalid string cell.";
+                    return false;
+                }
+            }
+        }
+    }
+
+    // Validate slots, which need an empty one to end probing.
+    std::uint32_t filledSlots = 0;
+
+    for(std::uint32_t i = 0; i < header->slotCount; ++i)
+    {
+        if(slots[i] > header->rowCount)
+        {
+            LogError() << LogOpenError(filename) << "Invalid row slot.";
+            return false;
+        }
+
+        filledSlots += slots[i] != 0 ? 1 : 0;
+    }
+
+    if(filledSlots != header->rowCount)
+    {
+        LogError() << LogOpenError(filename) << "Invalid row slots.";
+        return false;
+    }
+
+    m_data = bytes;
+    m_columns = columns;
+    m_rowHashes = reinterpret_cast<const std::uint64_t*>(bytes + header->rowHashesOffset);
+    m_slots = slots;
+    m_strings = reinterpret_cast<const char*>(bytes + header->stringsOffset);
+    m_stringsSize = (std::size_t)header->stringsSize;
+    m_rowCount = (int)header->rowCount;
+    m_columnCount = (int)header->columnCount;
+    m_slotMask = header->slotCount - 1;
+
+    return true;
+}
+
+bool DataTable::Compile(const std::string& source, const std::string& destination)
+{
+    // Read the CSV file.
+    std::ifstream input(source, std::ios::binary);
+
+    if(!input)
+    {
+        LogError() << LogCompileError(source) << "Couldn't open the file.";
+        return false;
+    }
+
+    std::string content((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    // Strings are stored once, each followed by a null terminator.
+    std::string strings;
+    std::map<std::string, std::uint32_t> stringOffsets;
+
+    auto AddString = [&strings, &stringOffsets](const std::string& text)
+    {
+        auto result = stringOffsets.emplace(text, (std::uint32_t)strings.size());
+
+        if(result.second)
+        {
+            strings.append(text);
+            strings.push_back('\0');
+        }
+
+        return result.first->second;
+    };
+
+    // Parse column names and types from the first record.
+    std::vector<std::string> fields;
+    std::size_t position = 0;
+    int lineNumber = 1;
+
+    if(!ReadRecord(content, position, lineNumber, fields))
+    {
+        LogError() << LogCompileError(source) << "File is empty.";
+        return false;
+    }
+
+    std::vector<Column> columns(fields.size(), Column());
+    std::map<std::uint64_t, std::string> columnNames;
+
+    for(std::size_t i = 0; i < fields.size(); ++i)
+    {
+        std::size_t separator = fields[i].rfind(':');
+        std::string name = TrimField(fields[i].substr(0, separator));
+        std::string type = separator != std::string::npos ? TrimField(fields[i].substr(separator + 1)) : "";
+
+        Column& column = columns[i];
+
+        if(type == "int")
+        {
+            column.type = DataColumnTypes::Integer;
+        }
+        else if(type == "float")
+        {
+            column.type = DataColumnTypes::Float;
+        }
+        else if(type == "bool")
+        {
+            column.type = DataColumnTypes::Boolean;
+        }
+        else if(type == "string")
+        {
+            column.type = DataColumnTypes::String;
+        }
+        else
+        {
+            LogError() << LogCompileError(source) << "Column \"" << fields[i] << "\" has no valid type.";
+            return false;
+        }
+
+        if(name.empty() || (i == 0 && column.type != DataColumnTypes::String))
+        {
+            LogError() << LogCompileError(source) << "Column \"" << fields[i] << "\" has to be a named string column.";
+            return false;
+        }
+
+        column.nameHash = ConfigName(name).GetHash();
+        column.nameOffset = AddString(name);
+        column.nameLength = (std::uint32_t)name.size();
+
+        if(!columnNames.emplace(column.nameHash, name).second)
+        {
+            LogError() << LogCompileError(source) << "Column \"" << name << "\" collides with \"" << columnNames[column.nameHash] << "\".";
+            return false;
+        }
+    }
+
+    // Parse rows into separate columns.
+    std::vector<std::vector<std::uint8_t>> cells(columns.size());
+    std::vector<std::uint64_t> rowHashes;
+    std::map<std::uint64_t, std::string> rowIdentifiers;
+
+    while(true)
+    {
+        int recordLine = lineNumber;
+
+        if(!ReadRecord(content, position, lineNumber, fields))
+            break;
+
+        // Skip empty lines.
+        if(fields.size() == 1 && fields[0].empty())
+            continue;
+
+        if(fields.size() != columns.size())
+        {
+            LogError() << LogCompileError(source) << "Row on line " << recordLine << " has " << fields.size() << " fields instead of " << columns.size() << ".";
+            return false;
+        }
+
+        std::uint64_t hash = ConfigName(fields[0]).GetHash();
+
+        if(fields[0].empty() || !rowIdentifiers.emplace(hash, fields[0]).second)
+        {
+            LogError() << LogCompileError(source) << "Row identifier \"" << fields[0] << "\" on line " << recordLine << " is empty or collides with \"" << rowIdentifiers[hash] << "\".";
+            return false;
+        }
+
+        rowHashes.push_back(hash);
+
+        for(std::size_t i = 0; i < columns.size(); ++i)
+        {
+            std::vector<std::uint8_t>& column = cells[i];
+            std::size_t cellSize = GetCellSize(columns[i].type);
+            std::size_t offset = column.size();
+            column.resize(offset + cellSize);
+
+            if(columns[i].type == DataColumnTypes::String)
+            {
+                DataString cell;
+                cell.offset = AddString(fields[i]);
+                cell.length = (std::uint32_t)fields[i].size();
+                std::memcpy(column.data() + offset, &cell, sizeof(cell));
+                continue;
+            }
+
+            std::int32_t integer = 0;
+            float real = 0.0f;
+            std::uint8_t boolean = 0;
+
+            if(!ParseCell(fields[i], columns[i].type, integer, real, boolean))
+            {
+                LogError() << LogCompileError(source) << "Invalid value \"" << fields[i] << "\" in column \"" << columnNames[columns[i].nameHash] << "\" on line " << recordLine << ".";
+                return false;
+            }
+
+            if(columns[i].type == DataColumnTypes::Integer)
+                std::memcpy(column.data() + offset, &integer, sizeof(integer));
+            else if(columns[i].type == DataColumnTypes::Float)
+                std::memcpy(column.data() + offset, &real, sizeof(real));
+            else
+                column[offset] = boolean;
+        }
+    }
+
+    // Fill slots of the row lookup table, which is at most half full.
+    std::uint32_t slotCount = 1;
+
+    while(slotCount <= rowHashes.size() * 2)
+    {
+        slotCount *= 2;
+    }
+
+    std::vector<std::uint32_t> slots(slotCount, 0);
+
+    for(std::size_t row = 0; row < rowHashes.size(); ++row)
+    {
+        std::uint32_t slot = (std::uint32_t)rowHashes[row] & (slotCount - 1);
+
+        while(slots[slot] != 0)
+        {
+            slot = (slot + 1) & (slotCount - 1);
+        }
+
+        slots[slot] = (std::uint32_t)row + 1;
+    }
+
+    // Lay out the header, columns, column data, the lookup table and strings.
+    std::size_t paddedRowCount = GetPaddedRowCount(rowHashes.size());
+
+    FileHeader header = FileHeader();
+    header.magic = FileMagic;
+    header.version = FileVersion;
+    header.rowCount = (std::uint32_t)rowHashes.size();
+    header.columnCount = (std::uint32_t)columns.size();
+    header.slotCount = slotCount;
+
+    std::size_t offset = sizeof(FileHeader);
+    header.columnsOffset = AlignOffset(offset, alignof(Column));
+    offset = (std::size_t)header.columnsOffset + sizeof(Column) * columns.size();
+
+    for(std::size_t i = 0; i < columns.size(); ++i)
+    {
+        columns[i].dataOffset = AlignOffset(offset, ColumnAlignment);
+        offset = (std::size_t)columns[i].dataOffset + paddedRowCount * GetCellSize(columns[i].type);
+    }
+
+    header.rowHashesOffset = AlignOffset(offset, alignof(std::uint64_t));
+    header.slotsOffset = header.rowHashesOffset + sizeof(std::uint64_t) * rowHashes.size();
+    header.stringsOffset = header.slotsOffset + sizeof(std::uint32_t) * slots.size();
+    header.stringsSize = strings.size();
+
+    // Padding between and after columns stays zero.
+    std::vector<std::uint8_t> output((std::size_t)(header.stringsOffset + header.stringsSize), 0);
+    std::memcpy(output.data(), &header, sizeof(FileHeader));
+    std::memcpy(output.data() + header.columnsOffset, columns.data(), sizeof(Column) * columns.size());
+
+    for(std::size_t i = 0; i < columns.size(); ++i)
+    {
+        if(!cells[i].empty())
+        {
+            std::memcpy(output.data() + columns[i].dataOffset, cells[i].data(), cells[i].size());
+        }
+    }
+
+    if(!rowHashes.empty())
+    {
+        std::memcpy(output.data() + header.rowHashesOffset, rowHashes.data(), sizeof(std::uint64_t) * rowHashes.size());
+    }
+
+    std::memcpy(output.data() + header.slotsOffset, slots.data(), sizeof(std::uint32_t) * slots.size());
+    std::memcpy(output.data() + header.stringsOffset, strings.data(), strings.size());
+
+    // Write the file.
+    std::ofstream file(destination, std::ios::binary);
+
+    if(!file)
+    {
+        LogError() << LogCompileError(source) << "Couldn't open \"" << destination << "\" file.";
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(output.data()), output.size());
+
+    if(!file)
+    {
+        LogError() << LogCompileError(source) << "Couldn't write \"" << destination << "\" file.";
+        return false;
+    }
+
+    return true;
+}
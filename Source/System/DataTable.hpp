@@ -0,0 +1,173 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/MappedFile.hpp"
+#include "Common/StringView.hpp"
+#include "Config.hpp"
+
+//
+// Data Table
+//
+//  Typed table of gameplay data, such as unit stats or weapon tables, which
+//  is compiled from a CSV file at build time and mapped at runtime without
+//  parsing. Tables are stored by columns, so a system that needs a single
+//  value of every row reads one contiguous array instead of striding over
+//  whole rows, and can pass float columns to the array kernels of
+//  BatchMath. Columns are aligned to 32 bytes and padded with zeros to a
+//  multiple of eight rows, so kernels can read whole AVX registers.
+//
+//  The first line of a CSV file names columns along with their types, as
+//  "Name:int", "Name:float", "Name:bool" or "Name:string". The first column
+//  holds row identifiers, which have to be unique. Fields can be quoted to
+//  hold commas, with doubled quotes standing for a quote character.
+//
+//  Strings are kept once in a string pool, which cells of string columns
+//  point into. Rows are looked up by hashes of their identifiers in an open
+//  addressing table stored in the file, and names are passed as ConfigName,
+//  which hashes string literals at compile time, so a lookup does not touch
+//  any strings. Compiling fails if two identifiers share a hash.
+//
+//  Example CSV file:
+//      Id:string, Health:int, Speed:float, Flying:bool, Name:string
+//      Grunt, 100, 2.5, false, "Grunt, Basic"
+//      Bat, 40, 6.0, true, Bat
+//
+//  Example usage:
+//      System::DataTable::Compile("Assets/Units.csv", "Data/Units.table");
+//
+//      System::DataTable units;
+//      units.Open("Data/Units.table");
+//
+//      int health = units.FindColumn("Health");
+//      int row = units.FindRow("Bat");
+//      std::int32_t batHealth = units.GetIntegers(health)[row];
+//
+//      const float* speeds = units.GetFloats(units.FindColumn("Speed"));
+//      BatchMath::Multiply(speeds, modifiers.data(), results.data(), units.GetRowCount());
+//
+
+namespace System
+{
+    // Types of data table columns.
+    struct DataColumnTypes
+    {
+        enum Type
+        {
+            // Signed 32 bit integers.
+            Integer,
+
+            // 32 bit floating point numbers.
+            Float,
+
+            // Bytes of zero or one.
+            Boolean,
+
+            // Strings in the string pool.
+            String,
+        };
+    };
+
+    // Cell of a string column.
+    struct DataString
+    {
+        std::uint32_t offset;
+        std::uint32_t length;
+    };
+
+    // Data table class.
+    class DataTable : private NonCopyable
+    {
+    public:
+        // Alignment of column data.
+        static const std::size_t ColumnAlignment = 32;
+
+        // Number of rows that columns are padded to a multiple of.
+        static const int RowPadding = 8;
+
+        // Index returned when rows or columns are not found.
+        static const int NotFound = -1;
+
+    public:
+        DataTable();
+        ~DataTable();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Opens and maps a compiled table.
+        bool Open(const std::string& filename);
+
+        // Parses a compiled table in memory, which has to outlive the instance.
+        // The filename is only used for error messages.
+        bool Parse(const std::string& filename, const void* data, std::size_t size);
+
+        // Finds a row by its identifier.
+        int FindRow(const ConfigName& identifier) const;
+
+        // Finds a column by its name.
+        int FindColumn(const ConfigName& name) const;
+
+        // Gets values of a column, or nullptr if it has a different type.
+        const std::int32_t* GetIntegers(int column) const;
+        const float* GetFloats(int column) const;
+        const std::uint8_t* GetBooleans(int column) const;
+        const DataString* GetStrings(int column) const;
+
+        // Gets a string of a cell in a string column.
+        StringView GetString(int column, int row) const;
+
+        // Gets the identifier of a row.
+        StringView GetRowIdentifier(int row) const;
+
+        // Gets the name and the type of a column.
+        StringView GetColumnName(int column) const;
+        DataColumnTypes::Type GetColumnType(int column) const;
+
+        // Gets the number of rows and columns.
+        int GetRowCount() const;
+        int GetColumnCount() const;
+
+        // Checks if a table has been parsed.
+        bool IsValid() const;
+
+        // Compiles a CSV file into a table file.
+        static bool Compile(const std::string& source, const std::string& destination);
+
+    private:
+        // Column of a compiled table.
+        struct Column
+        {
+            std::uint64_t nameHash;
+            std::uint32_t nameOffset;
+            std::uint32_t nameLength;
+            std::uint32_t type;
+            std::uint32_t reserved;
+            std::uint64_t dataOffset;
+        };
+
+        // Parses a table that data points into.
+        bool ParseContent(const std::string& filename, const void* data, std::size_t size);
+
+        // Gets data of a column with a type.
+        const void* GetColumnData(int column, DataColumnTypes::Type type) const;
+
+    private:
+        // Mapped file.
+        MappedFile m_file;
+
+        // Parsed table data.
+        const std::uint8_t* m_data;
+        const Column* m_columns;
+        const std::uint64_t* m_rowHashes;
+        const std::uint32_t* m_slots;
+        const char* m_strings;
+        std::size_t m_stringsSize;
+
+        int m_rowCount;
+        int m_columnCount;
+        std::uint32_t m_slotMask;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,281 @@
+#include "Precompiled.hpp"
+#include "FileService.hpp"
+#include "Graphics/FrameProfiler.hpp"
+using namespace System;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize a file service! "
+    #define LogReadError(filename) "Failed to read a file \"" << filename << "\"! "
+    #define LogWriteError(filename) "Failed to write a file \"" << filename << "\"! "
+
+    // Maps a completed event to the identifier of its request.
+    int GetCompletedKey(const FileService::Events::Completed& event)
+    {
+        return event.request;
+    }
+}
+
+FileServiceInfo::FileServiceInfo() :
+    threadCount(2)
+{
+}
+
+FileService::FileService() :
+    m_requestCounter(0),
+    m_pendingCount(0),
+    m_exit(false),
+    m_initialized(false)
+{
+    events.completed.SetKeyFunction(&GetCompletedKey);
+}
+
+FileService::~FileService()
+{
+    this->Cleanup();
+}
+
+void FileService::Cleanup()
+{
+    // Stop IO threads.
+    // Also called on a partially initialized service when initialization fails.
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_exit = true;
+    }
+
+    m_condition.notify_all();
+
+    for(std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+
+    Utility::ClearContainer(m_workers);
+
+    // Drop remaining requests.
+    Utility::ClearContainer(m_requests);
+    Utility::ClearContainer(m_completions);
+    Utility::ClearContainer(m_processed);
+
+    m_requestCounter = 0;
+    m_pendingCount = 0;
+    m_exit = false;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool FileService::Initialize(const FileServiceInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            this->Cleanup();
+        }
+    );
+
+    // Validate arguments.
+    if(info.threadCount <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid thread count.";
+        return false;
+    }
+
+    // Start IO threads.
+    for(int i = 0; i < info.threadCount; ++i)
+    {
+        m_workers.emplace_back(&FileService::RunWorker, this);
+    }
+
+    // Success!
+    return m_initialized = true;
+}
+
+int FileService::Read(const std::string& filename)
+{
+    return this->Queue(FileOperations::Read, filename, std::vector<char>());
+}
+
+int FileService::Write(const std::string& filename, std::vector<char> data)
+{
+    return this->Queue(FileOperations::Write, filename, std::move(data));
+}
+
+int FileService::Queue(FileOperations::Type operation, const std::string& filename, std::vector<char> data)
+{
+    if(!m_initialized)
+        return 0;
+
+    if(filename.empty())
+    {
+        LogError() << "Failed to queue a file request! Invalid filename.";
+        return 0;
+    }
+
+    Request request;
+    request.operation = operation;
+    request.filename = filename;
+    request.data = std::move(data);
+    request.succeeded = false;
+
+    int identifier = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Skip zero when the counter wraps, as it marks failed requests.
+        if(++m_requestCounter <= 0)
+        {
+            m_requestCounter = 1;
+        }
+
+        identifier = m_requestCounter;
+        request.identifier = identifier;
+        m_requests.push_back(std::move(request));
+        m_pendingCount += 1;
+    }
+
+    m_condition.notify_one();
+
+    return identifier;
+}
+
+void FileService::ProcessCompletions()
+{
+    if(!m_initialized)
+        return;
+
+    // Take finished requests, so IO threads can keep finishing new ones.
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_processed.swap(m_completions);
+    }
+
+    // Dispatch events of finished requests.
+    for(const Request& request : m_processed)
+    {
+        Events::Completed event =
+        {
+            request.identifier,
+            request.operation,
+            request.filename,
+            request.data,
+            request.succeeded,
+        };
+
+        events.completed.Dispatch(event);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pendingCount -= (int)m_processed.size();
+    }
+
+    m_processed.clear();
+}
+
+int FileService::GetPendingCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pendingCount;
+}
+
+void FileService::Serve(Request& request)
+{
+    switch(request.operation)
+    {
+    case FileOperations::Read:
+        {
+            std::ifstream file(request.filename, std::ios::binary);
+
+            if(!file)
+            {
+                LogError() << LogReadError(request.filename) << "Couldn't open the file.";
+                return;
+            }
+
+            file.seekg(0, std::ios::end);
+            std::streamoff size = file.tellg();
+            file.seekg(0, std::ios::beg);
+
+            if(size < 0)
+            {
+                LogError() << LogReadError(request.filename) << "Couldn't get the file size.";
+                return;
+            }
+
+            request.data.resize((std::size_t)size);
+
+            if(size > 0 && !file.read(request.data.data(), size))
+            {
+                LogError() << LogReadError(request.filename) << "Couldn't read the file.";
+                Utility::ClearContainer(request.data);
+                return;
+            }
+
+            request.succeeded = true;
+        }
+        break;
+
+    case FileOperations::Write:
+        {
+            std::ofstream file(request.filename, std::ios::binary | std::ios::trunc);
+
+            if(!file)
+            {
+                LogError() << LogWriteError(request.filename) << "Couldn't open the file.";
+                return;
+            }
+
+            if(!file.write(request.data.data(), request.data.size()))
+            {
+                LogError() << LogWriteError(request.filename) << "Couldn't write to the file.";
+                return;
+            }
+
+            request.succeeded = true;
+        }
+        break;
+    }
+}
+
+void FileService::RunWorker()
+{
+    PROFILE_THREAD("Files");
+
+    while(true)
+    {
+        Request request;
+
+        // Wait for a queued request.
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_exit || !m_requests.empty(); });
+
+            if(m_exit)
+                return;
+
+            request = std::move(m_requests.front());
+            m_requests.pop_front();
+        }
+
+        // Serve the request without holding the lock.
+        {
+            PROFILE_SCOPE("Serve");
+            Serve(request);
+        }
+
+        // Keep the result until it is processed.
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_completions.push_back(std::move(request));
+        }
+    }
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// File Service
+//
+//  Reads and writes whole files on background threads, so the calling thread
+//  never blocks on a disk. Requests are queued and served by a pool of IO
+//  threads, which store their results until the owning thread processes
+//  them. Processing dispatches a completed event for each finished request
+//  on the calling thread, in the order the requests finished.
+//
+//  Requests return identifiers that completed events carry. Receivers can
+//  set a request identifier as their key to only receive that request.
+//  Requests still queued when the service is cleaned up are dropped without
+//  dispatching their events.
+//
+//  Example usage:
+//      System::FileServiceInfo info;
+//      info.threadCount = 2;
+//
+//      System::FileService files;
+//      files.Initialize(info);
+//
+//      Receiver<void(const System::FileService::Events::Completed&)> receiver;
+//      receiver.Bind<Class, &Class::OnFileRead>(&instance);
+//      receiver.SetKey(files.Read("Data/Level.bin"));
+//      receiver.Subscribe(files.events.completed);
+//
+//      while(window.IsOpen())
+//      {
+//          files.ProcessCompletions();
+//          /* ... */
+//      }
+//
+
+namespace System
+{
+    // File operations.
+    struct FileOperations
+    {
+        enum Type
+        {
+            Read,
+            Write,
+        };
+    };
+
+    // File service initialization struct.
+    struct FileServiceInfo
+    {
+        // Number of threads that serve requests.
+        int threadCount;
+
+        FileServiceInfo();
+    };
+
+    // File service class.
+    class FileService : private NonCopyable
+    {
+    public:
+        FileService();
+        ~FileService();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the service and starts IO threads.
+        bool Initialize(const FileServiceInfo& info);
+
+        // Queues a read of a whole file.
+        // Returns the identifier of the request, or zero on failure.
+        int Read(const std::string& filename);
+
+        // Queues a write that replaces the content of a file.
+        // Returns the identifier of the request, or zero on failure.
+        int Write(const std::string& filename, std::vector<char> data);
+
+        // Dispatches events of finished requests on the calling thread.
+        void ProcessCompletions();
+
+        // Gets the number of requests that have not been processed yet.
+        int GetPendingCount() const;
+
+    public:
+        // Public events.
+        struct Events
+        {
+            // Request completed event.
+            // Receivers can set a request identifier key to only receive that request.
+            struct Completed
+            {
+                int request;
+                FileOperations::Type operation;
+                const std::string& filename;
+                const std::vector<char>& data;
+                bool succeeded;
+            };
+
+            Dispatcher<void(const Completed&)> completed;
+        } events;
+
+    private:
+        // Queued request.
+        struct Request
+        {
+            int identifier;
+            FileOperations::Type operation;
+            std::string filename;
+            std::vector<char> data;
+            bool succeeded;
+        };
+
+        // Type declarations.
+        typedef std::deque<Request> RequestQueue;
+        typedef std::vector<Request> RequestList;
+        typedef std::vector<std::thread> ThreadList;
+
+    private:
+        // Queues a request.
+        int Queue(FileOperations::Type operation, const std::string& filename, std::vector<char> data);
+
+        // Serves a request.
+        static void Serve(Request& request);
+
+        // Main function of IO threads.
+        void RunWorker();
+
+    private:
+        // Queued and finished requests.
+        RequestQueue m_requests;
+        RequestList m_completions;
+        RequestList m_processed;
+
+        // Request counters.
+        int m_requestCounter;
+        int m_pendingCount;
+
+        // Synchronization of IO threads.
+        mutable std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_exit;
+
+        // Threads that serve requests.
+        ThreadList m_workers;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,67 @@
+#include "Precompiled.hpp"
+#include "FrameLimiter.hpp"
+using namespace System;
+
+namespace
+{
+    // Time before a deadline that is spun instead of slept.
+    // Covers the usual oversleep of the system scheduler.
+    const std::chrono::microseconds SpinTime(2000);
+}
+
+FrameLimiter::FrameLimiter() :
+    m_frameRate(0.0),
+    m_frameTime(Clock::duration::zero())
+{
+}
+
+void FrameLimiter::SetFrameRate(double frameRate)
+{
+    m_frameRate = std::max(frameRate, 0.0);
+
+    if(m_frameRate > 0.0)
+    {
+        m_frameTime = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_frameRate));
+    }
+    else
+    {
+        m_frameTime = Clock::duration::zero();
+    }
+
+    // Start pacing from the next wait.
+    m_deadline = Clock::time_point();
+}
+
+void FrameLimiter::Wait()
+{
+    if(m_frameTime == Clock::duration::zero())
+        return;
+
+    Clock::time_point time = Clock::now();
+
+    // Restart pacing after the first frame or when falling behind.
+    if(m_deadline == Clock::time_point() || time - m_deadline > m_frameTime)
+    {
+        m_deadline = time + m_frameTime;
+        return;
+    }
+
+    // Sleep until shortly before the deadline.
+    if(m_deadline - time > SpinTime)
+    {
+        std::this_thread::sleep_for(m_deadline - time - SpinTime);
+    }
+
+    // Spin for the rest.
+    while(Clock::now() < m_deadline)
+    {
+        std::this_thread::yield();
+    }
+
+    m_deadline += m_frameTime;
+}
+
+double FrameLimiter::GetFrameRate() const
+{
+    return m_frameRate;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Clock.hpp"
+
+//
+// Frame Limiter
+//
+//  Limits the frame rate by waiting until the next frame is due. Sleeping
+//  alone overshoots by the scheduler granularity, while spinning keeps a
+//  core busy, so the limiter sleeps until shortly before the deadline and
+//  spins for the rest. Deadlines advance by a fixed frame time, so errors
+//  of single waits do not accumulate. Deadlines are reset when frames fall
+//  behind by more than a frame time, instead of running faster to catch up.
+//
+//  Example usage:
+//      System::FrameLimiter limiter;
+//      limiter.SetFrameRate(144.0);
+//
+//      while(true)
+//      {
+//          /* ... */
+//
+//          limiter.Wait();
+//      }
+//
+
+namespace System
+{
+    // Frame limiter class.
+    class FrameLimiter
+    {
+    public:
+        FrameLimiter();
+
+        // Sets the maximum number of frames per second.
+        // Frame rate is not limited if it is zero.
+        void SetFrameRate(double frameRate);
+
+        // Waits until the next frame is due.
+        void Wait();
+
+        // Gets the maximum number of frames per second.
+        double GetFrameRate() const;
+
+    private:
+        // Maximum number of frames per second.
+        double m_frameRate;
+
+        // Duration of a frame.
+        Clock::duration m_frameTime;
+
+        // Time point when the next frame is due.
+        Clock::time_point m_deadline;
+    };
+}
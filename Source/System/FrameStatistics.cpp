@@ -0,0 +1,365 @@
+#include "Precompiled.hpp"
+#include "FrameStatistics.hpp"
+#include "Graphics/FrameProfiler.hpp"
+using namespace System;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize frame statistics! "
+
+    // Names of phases.
+    const char* PhaseNames[FramePhases::Count] =
+    {
+        "Events",
+        "Commands",
+        "Simulation",
+        "Render",
+        "Present",
+    };
+
+    // Gets a nearest rank percentile of sorted values.
+    double GetPercentile(const std::vector<double>& sorted, double percentile)
+    {
+        std::size_t rank = (std::size_t)std::ceil(percentile * sorted.size());
+        return sorted[std::max<std::size_t>(rank, 1) - 1];
+    }
+}
+
+FrameStatisticsInfo::FrameStatisticsInfo() :
+    windowSize(600),
+    hitchThreshold(0.1),
+    profiler(nullptr),
+    hitchTracePrefix("Hitch"),
+    hitchTraceLimit(8)
+{
+}
+
+FrameStatistics::Percentiles::Percentiles() :
+    p50(0.0),
+    p95(0.0),
+    p99(0.0),
+    maximum(0.0)
+{
+}
+
+FrameStatistics::ScopedPhase::ScopedPhase(FrameStatistics* statistics, FramePhases::Type phase) :
+    m_statistics(statistics),
+    m_phase(phase),
+    m_start(Clock::now())
+{
+}
+
+FrameStatistics::ScopedPhase::~ScopedPhase()
+{
+    if(m_statistics != nullptr)
+    {
+        m_statistics->AddPhaseTime(m_phase, Clock::GetSecondsSince(m_start));
+    }
+}
+
+FrameStatistics::FrameStatistics() :
+    m_windowSize(0),
+    m_hitchThreshold(0.0),
+    m_profiler(nullptr),
+    m_hitchTraceLimit(0),
+    m_current(),
+    m_frameActive(false),
+    m_frameCount(0),
+    m_hitchCount(0),
+    m_hitchTraceCount(0),
+    m_initialized(false)
+{
+}
+
+FrameStatistics::~FrameStatistics()
+{
+    this->Cleanup();
+}
+
+void FrameStatistics::Cleanup()
+{
+    m_samples.Cleanup();
+    m_windowSize = 0;
+
+    m_inputLatencies.Cleanup();
+
+    m_hitchThreshold = 0.0;
+    m_profiler = nullptr;
+    m_hitchTracePrefix.clear();
+    m_hitchTraceLimit = 0;
+
+    m_current = Sample();
+    m_frameActive = false;
+
+    m_frameCount = 0;
+    m_hitchCount = 0;
+    m_hitchTraceCount = 0;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool FrameStatistics::Initialize(const FrameStatisticsInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(info.windowSize <= 0)
+    {
+        LogError() << LogInitializeError() << "Invalid window size.";
+        return false;
+    }
+
+    if(info.hitchThreshold < 0.0)
+    {
+        LogError() << LogInitializeError() << "Invalid hitch threshold.";
+        return false;
+    }
+
+    if(info.hitchTraceLimit < 0)
+    {
+        LogError() << LogInitializeError() << "Invalid hitch trace limit.";
+        return false;
+    }
+
+    m_windowSize = info.windowSize;
+    m_samples.Reserve(m_windowSize);
+    m_inputLatencies.Reserve(m_windowSize);
+
+    m_hitchThreshold = info.hitchThreshold;
+    m_profiler = info.profiler;
+    m_hitchTracePrefix = info.hitchTracePrefix;
+    m_hitchTraceLimit = info.hitchTraceLimit;
+
+    // Success!
+    return m_initialized = true;
+}
+
+void FrameStatistics::BeginFrame()
+{
+    if(!m_initialized)
+        return;
+
+    m_current = Sample();
+    m_frameStart = Clock::now();
+    m_frameActive = true;
+}
+
+void FrameStatistics::AddPhaseTime(FramePhases::Type phase, double seconds)
+{
+    Assert(phase >= 0 && phase < FramePhases::Count, "Invalid frame phase!");
+
+    if(!m_frameActive)
+        return;
+
+    m_current.phaseTimes[phase] += seconds;
+}
+
+void FrameStatistics::EndFrame()
+{
+    if(!m_frameActive)
+        return;
+
+    m_current.frameTime = Clock::GetSecondsSince(m_frameStart);
+    m_frameActive = false;
+
+    // Keep a window of recent frames.
+    if(m_samples.GetSize() == m_windowSize)
+    {
+        m_samples.Pop();
+    }
+
+    m_samples.Push(m_current);
+    m_frameCount += 1;
+
+    // Check if the frame was a hitch.
+    if(m_hitchThreshold > 0.0 && m_current.frameTime > m_hitchThreshold)
+    {
+        this->ReportHitch(m_current);
+    }
+}
+
+FrameStatistics::Percentiles FrameStatistics::GetFramePercentiles() const
+{
+    return this->ComputePercentiles([](const Sample& sample)
+    {
+        return sample.frameTime;
+    });
+}
+
+FrameStatistics::Percentiles FrameStatistics::GetPhasePercentiles(FramePhases::Type phase) const
+{
+    Assert(phase >= 0 && phase < FramePhases::Count, "Invalid frame phase!");
+
+    return this->ComputePercentiles([phase](const Sample& sample)
+    {
+        return sample.phaseTimes[phase];
+    });
+}
+
+void FrameStatistics::AddInputLatency(double seconds)
+{
+    if(!m_initialized)
+        return;
+
+    // Keep a window of recent latencies.
+    if(m_inputLatencies.GetSize() == m_windowSize)
+    {
+        m_inputLatencies.Pop();
+    }
+
+    m_inputLatencies.Push(seconds);
+}
+
+FrameStatistics::Percentiles FrameStatistics::GetInputLatencyPercentiles() const
+{
+    std::vector<double> values;
+    values.reserve(m_inputLatencies.GetSize());
+
+    for(std::size_t i = 0; i < m_inputLatencies.GetSize(); ++i)
+    {
+        values.push_back(m_inputLatencies[i]);
+    }
+
+    return ComputeValuePercentiles(values);
+}
+
+std::size_t FrameStatistics::GetRecentFrameCount() const
+{
+    return m_samples.GetSize();
+}
+
+double FrameStatistics::GetRecentFrameTime(std::size_t index) const
+{
+    Assert(index < m_samples.GetSize(), "Invalid recent frame index!");
+
+    return m_samples[index].frameTime;
+}
+
+double FrameStatistics::GetRecentPhaseTime(std::size_t index, FramePhases::Type phase) const
+{
+    Assert(index < m_samples.GetSize(), "Invalid recent frame index!");
+    Assert(phase >= 0 && phase < FramePhases::Count, "Invalid frame phase!");
+
+    return m_samples[index].phaseTimes[phase];
+}
+
+std::uint64_t FrameStatistics::GetFrameCount() const
+{
+    return m_frameCount;
+}
+
+std::uint64_t FrameStatistics::GetHitchCount() const
+{
+    return m_hitchCount;
+}
+
+void FrameStatistics::LogSummary() const
+{
+    if(m_samples.IsEmpty())
+        return;
+
+    // Writes a line of percentiles in milliseconds.
+    std::ostringstream summary;
+    summary << std::fixed << std::setprecision(2);
+
+    auto writePercentiles = [&summary](const char* name, const Percentiles& percentiles)
+    {
+        summary << "\n  " << std::left << std::setw(12) << name << std::right
+            << " p50 " << std::setw(8) << percentiles.p50 * 1000.0
+            << " p95 " << std::setw(8) << percentiles.p95 * 1000.0
+            << " p99 " << std::setw(8) << percentiles.p99 * 1000.0
+            << " max " << std::setw(8) << percentiles.maximum * 1000.0;
+    };
+
+    writePercentiles("Frame", this->GetFramePercentiles());
+
+    for(int i = 0; i < FramePhases::Count; ++i)
+    {
+        FramePhases::Type phase = (FramePhases::Type)i;
+        writePercentiles(PhaseNames[phase], this->GetPhasePercentiles(phase));
+    }
+
+    if(!m_inputLatencies.IsEmpty())
+    {
+        writePercentiles("Input", this->GetInputLatencyPercentiles());
+    }
+
+    Log() << "Frame times in milliseconds over the last " << m_samples.GetSize() << " of " << m_frameCount << " frames, with " << m_hitchCount << " hitches:" << summary.str();
+}
+
+const char* FrameStatistics::GetPhaseName(FramePhases::Type phase)
+{
+    Assert(phase >= 0 && phase < FramePhases::Count, "Invalid frame phase!");
+
+    return PhaseNames[phase];
+}
+
+bool FrameStatistics::IsInitialized() const
+{
+    return m_initialized;
+}
+
+template<typename Selector>
+FrameStatistics::Percentiles FrameStatistics::ComputePercentiles(Selector selector) const
+{
+    // Sort a copy of the window.
+    std::vector<double> values;
+    values.reserve(m_samples.GetSize());
+
+    for(std::size_t i = 0; i < m_samples.GetSize(); ++i)
+    {
+        values.push_back(selector(m_samples[i]));
+    }
+
+    return ComputeValuePercentiles(values);
+}
+
+FrameStatistics::Percentiles FrameStatistics::ComputeValuePercentiles(std::vector<double>& sorted)
+{
+    Percentiles percentiles;
+
+    if(sorted.empty())
+        return percentiles;
+
+    std::sort(sorted.begin(), sorted.end());
+
+    percentiles.p50 = GetPercentile(sorted, 0.50);
+    percentiles.p95 = GetPercentile(sorted, 0.95);
+    percentiles.p99 = GetPercentile(sorted, 0.99);
+    percentiles.maximum = sorted.back();
+
+    return percentiles;
+}
+
+void FrameStatistics::ReportHitch(const Sample& sample)
+{
+    m_hitchCount += 1;
+
+    // Log the phase breakdown.
+    std::ostringstream phases;
+    phases << std::fixed << std::setprecision(2);
+
+    for(int i = 0; i < FramePhases::Count; ++i)
+    {
+        phases << (i != 0 ? ", " : "") << PhaseNames[i] << " " << sample.phaseTimes[i] * 1000.0 << " ms";
+    }
+
+    LogWarning() << "Frame " << m_frameCount << " took " << sample.frameTime * 1000.0 << " ms (" << phases.str() << ").";
+
+    // Capture the timeline leading up to the hitch.
+    if(m_profiler == nullptr || m_hitchTraceCount >= m_hitchTraceLimit)
+        return;
+
+    std::ostringstream filename;
+    filename << m_hitchTracePrefix << "-" << m_frameCount << ".json";
+
+    if(m_profiler->WriteTrace(filename.str()))
+    {
+        m_hitchTraceCount += 1;
+
+        Log() << "Wrote a trace of the hitch to \"" << filename.str() << "\" file.";
+    }
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Clock.hpp"
+
+// Forward declarations.
+namespace Graphics
+{
+    class FrameProfiler;
+}
+
+//
+// Frame Statistics
+//
+//  Measures how long phases of main loop frames take and keeps a rolling
+//  window of recent frames, from which percentiles of frame and phase times
+//  are computed. Percentiles show stutter that averages hide, as a few slow
+//  frames barely move the mean but dominate the 99th percentile.
+//
+//  Frames that take longer than the hitch threshold are logged with their
+//  phase breakdown. If a profiler is set, its kept events are written to a
+//  trace file for every hitch, up to a limit of files, so hitches that are
+//  hard to reproduce are captured when they happen.
+//
+//  Phases can be measured more than once per frame, such as entity commands
+//  processed on every simulation tick, in which case their times are summed.
+//
+//  Latencies from the arrival of input to the present that reflected it are
+//  kept in a separate window of the same size, as only frames with new input
+//  have a latency and presents may finish after their frames have ended.
+//
+//  Example usage:
+//      System::FrameStatistics statistics;
+//      statistics.Initialize(System::FrameStatisticsInfo());
+//
+//      while(running)
+//      {
+//          statistics.BeginFrame();
+//
+//          {
+//              System::FrameStatistics::ScopedPhase phase(&statistics, System::FramePhases::Events);
+//              window.ProcessEvents();
+//          }
+//
+//          statistics.EndFrame();
+//      }
+//
+//      statistics.LogSummary();
+//
+
+namespace System
+{
+    // Measured phases of a frame.
+    struct FramePhases
+    {
+        enum Type
+        {
+            Events,
+            Commands,
+            Simulation,
+            Render,
+            Present,
+
+            Count,
+        };
+    };
+
+    // Frame statistics initialization struct.
+    struct FrameStatisticsInfo
+    {
+        // Number of recent frames that percentiles are computed from.
+        int windowSize;
+
+        // Frame time in seconds over which a frame counts as a hitch.
+        // Hitches are not detected if it is zero.
+        double hitchThreshold;
+
+        // Profiler whose events are written for every hitch.
+        Graphics::FrameProfiler* profiler;
+
+        // Prefix of trace files written for hitches.
+        std::string hitchTracePrefix;
+
+        // Maximum number of trace files written for hitches.
+        int hitchTraceLimit;
+
+        FrameStatisticsInfo();
+    };
+
+    // Frame statistics class.
+    class FrameStatistics : private NonCopyable
+    {
+    public:
+        // Percentiles of times in seconds.
+        struct Percentiles
+        {
+            Percentiles();
+
+            double p50;
+            double p95;
+            double p99;
+            double maximum;
+        };
+
+        // Measures a phase within its scope.
+        class ScopedPhase : private NonCopyable
+        {
+        public:
+            ScopedPhase(FrameStatistics* statistics, FramePhases::Type phase);
+            ~ScopedPhase();
+
+        private:
+            FrameStatistics* m_statistics;
+            FramePhases::Type m_phase;
+            Clock::time_point m_start;
+        };
+
+    public:
+        FrameStatistics();
+        ~FrameStatistics();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the frame statistics.
+        bool Initialize(const FrameStatisticsInfo& info);
+
+        // Begins measuring a frame.
+        void BeginFrame();
+
+        // Adds time spent in a phase of the current frame.
+        void AddPhaseTime(FramePhases::Type phase, double seconds);
+
+        // Ends measuring a frame and checks if it was a hitch.
+        void EndFrame();
+
+        // Computes percentiles of recent frame times.
+        Percentiles GetFramePercentiles() const;
+
+        // Computes percentiles of recent times of a phase.
+        Percentiles GetPhasePercentiles(FramePhases::Type phase) const;
+
+        // Adds a latency from the arrival of input to its present.
+        void AddInputLatency(double seconds);
+
+        // Computes percentiles of recent input latencies.
+        Percentiles GetInputLatencyPercentiles() const;
+
+        // Gets the number of recent frames in the window.
+        std::size_t GetRecentFrameCount() const;
+
+        // Gets times of a recent frame, with the oldest one at index zero.
+        double GetRecentFrameTime(std::size_t index) const;
+        double GetRecentPhaseTime(std::size_t index, FramePhases::Type phase) const;
+
+        // Gets the number of ended frames and detected hitches.
+        std::uint64_t GetFrameCount() const;
+        std::uint64_t GetHitchCount() const;
+
+        // Logs percentiles of frame and phase times and input latencies.
+        void LogSummary() const;
+
+        // Gets the name of a phase.
+        static const char* GetPhaseName(FramePhases::Type phase);
+
+        // Checks if the instance is initialized.
+        bool IsInitialized() const;
+
+    private:
+        // Measured times of a frame.
+        struct Sample
+        {
+            double frameTime;
+            double phaseTimes[FramePhases::Count];
+        };
+
+    private:
+        // Computes percentiles of a field of recent samples.
+        template<typename Selector>
+        Percentiles ComputePercentiles(Selector selector) const;
+
+        // Computes percentiles of values, sorting them.
+        static Percentiles ComputeValuePercentiles(std::vector<double>& values);
+
+        // Logs and captures a hitch.
+        void ReportHitch(const Sample& sample);
+
+    private:
+        // Recent samples, oldest first.
+        RingBuffer<Sample> m_samples;
+        std::size_t m_windowSize;
+
+        // Recent input latencies, oldest first.
+        RingBuffer<double> m_inputLatencies;
+
+        // Hitch detection settings.
+        double m_hitchThreshold;
+        Graphics::FrameProfiler* m_profiler;
+        std::string m_hitchTracePrefix;
+        int m_hitchTraceLimit;
+
+        // Current frame.
+        Clock::time_point m_frameStart;
+        Sample m_current;
+        bool m_frameActive;
+
+        // Frame and hitch counters.
+        std::uint64_t m_frameCount;
+        std::uint64_t m_hitchCount;
+        int m_hitchTraceCount;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
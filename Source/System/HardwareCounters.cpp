@@ -0,0 +1,206 @@
+#include "Precompiled.hpp"
+#include "HardwareCounters.hpp"
+using namespace System;
+
+#if defined(__linux__)
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize hardware counters! "
+
+    // Names of counter types.
+    const char* TypeNames[HardwareCounterTypes::Count] =
+    {
+        "Instructions",
+        "Cycles",
+        "CacheMisses",
+        "BranchMisses",
+    };
+
+#if defined(__linux__)
+    // Perf event configurations of counter types.
+    const std::uint64_t EventConfigs[HardwareCounterTypes::Count] =
+    {
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES,
+    };
+
+    // Opens a counter of the calling thread in a group.
+    // Group leader is created disabled and enables the whole group.
+    int OpenEvent(std::uint64_t config, int leader)
+    {
+        perf_event_attr attributes;
+        std::memset(&attributes, 0, sizeof(attributes));
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.size = sizeof(attributes);
+        attributes.config = config;
+        attributes.disabled = leader == -1 ? 1 : 0;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        attributes.read_format = PERF_FORMAT_GROUP;
+
+        return (int)syscall(__NR_perf_event_open, &attributes, 0, -1, leader, 0);
+    }
+#endif
+}
+
+HardwareCounters::Values::Values()
+{
+    std::fill(std::begin(counts), std::end(counts), 0);
+}
+
+std::uint64_t& HardwareCounters::Values::operator[](int type)
+{
+    Assert(type >= 0 && type < HardwareCounterTypes::Count, "Invalid hardware counter type!");
+
+    return counts[type];
+}
+
+const std::uint64_t& HardwareCounters::Values::operator[](int type) const
+{
+    Assert(type >= 0 && type < HardwareCounterTypes::Count, "Invalid hardware counter type!");
+
+    return counts[type];
+}
+
+HardwareCounters::HardwareCounters() :
+    m_leader(-1),
+    m_availableCount(0),
+    m_initialized(false)
+{
+    std::fill(std::begin(m_descriptors), std::end(m_descriptors), -1);
+    std::fill(std::begin(m_positions), std::end(m_positions), -1);
+}
+
+HardwareCounters::~HardwareCounters()
+{
+    this->Cleanup();
+}
+
+void HardwareCounters::Cleanup()
+{
+#if defined(__linux__)
+    // Close members before the group leader.
+    for(int type = HardwareCounterTypes::Count - 1; type >= 0; --type)
+    {
+        if(m_descriptors[type] != -1)
+        {
+            close(m_descriptors[type]);
+        }
+    }
+#endif
+
+    std::fill(std::begin(m_descriptors), std::end(m_descriptors), -1);
+    std::fill(std::begin(m_positions), std::end(m_positions), -1);
+    m_leader = -1;
+    m_availableCount = 0;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool HardwareCounters::Initialize()
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            m_initialized = true;
+            this->Cleanup();
+        }
+    );
+
+#if defined(__linux__)
+    // Open counters that the processor supports.
+    for(int type = 0; type < HardwareCounterTypes::Count; ++type)
+    {
+        int descriptor = OpenEvent(EventConfigs[type], m_leader);
+
+        if(descriptor == -1)
+            continue;
+
+        if(m_leader == -1)
+        {
+            m_leader = descriptor;
+        }
+
+        m_descriptors[type] = descriptor;
+        m_positions[type] = m_availableCount++;
+    }
+
+    if(m_leader == -1)
+    {
+        LogError() << LogInitializeError() << "Couldn't open performance events (" << std::strerror(errno) << ").";
+        return false;
+    }
+
+    // Start counting.
+    if(ioctl(m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP) == -1 ||
+        ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) == -1)
+    {
+        LogError() << LogInitializeError() << "Couldn't enable performance events.";
+        return false;
+    }
+
+    // Success!
+    return m_initialized = true;
+#else
+    LogError() << LogInitializeError() << "Hardware counters are not supported on this platform.";
+    return false;
+#endif
+}
+
+bool HardwareCounters::Read(Values& values) const
+{
+    if(!m_initialized)
+        return false;
+
+#if defined(__linux__)
+    // Group reads start with the number of counters.
+    std::uint64_t buffer[HardwareCounterTypes::Count + 1];
+    std::size_t size = sizeof(std::uint64_t) * (m_availableCount + 1);
+
+    if(read(m_leader, buffer, size) != (ssize_t)size)
+        return false;
+
+    for(int type = 0; type < HardwareCounterTypes::Count; ++type)
+    {
+        values.counts[type] = m_positions[type] != -1 ? buffer[m_positions[type] + 1] : 0;
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool HardwareCounters::IsAvailable(HardwareCounterTypes::Type type) const
+{
+    Assert(type >= 0 && type < HardwareCounterTypes::Count, "Invalid hardware counter type!");
+
+    return m_descriptors[type] != -1;
+}
+
+const char* HardwareCounters::GetTypeName(HardwareCounterTypes::Type type)
+{
+    Assert(type >= 0 && type < HardwareCounterTypes::Count, "Invalid hardware counter type!");
+
+    return TypeNames[type];
+}
+
+bool HardwareCounters::IsInitialized() const
+{
+    return m_initialized;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Hardware Counters
+//
+//  Reads performance monitoring counters of the processor for the calling
+//  thread, such as retired instructions, cache misses and branch misses.
+//  Time alone doesn't tell why a data layout is faster, while the number of
+//  cache misses per operation usually does. Counters are opened as a single
+//  group, so all of them are scheduled onto the processor together and their
+//  values cover the same span of execution.
+//
+//  Counters only count the thread that initialized them, in user mode. Each
+//  read is a system call that takes around a microsecond, so counters should
+//  be read around sections of work rather than single operations. Counters
+//  that the processor or a virtual machine doesn't support are reported as
+//  unavailable and read as zero.
+//
+//  Counters are read with perf_event_open() on Linux, which may be denied
+//  by the perf_event_paranoid setting. Windows doesn't expose processor
+//  counters to user mode without a kernel driver, so initialization fails
+//  there and on other platforms.
+//
+//  Example usage:
+//      System::HardwareCounters counters;
+//      counters.Initialize();
+//
+//      System::HardwareCounters::Values start;
+//      counters.Read(start);
+//
+//      /* ... */
+//
+//      System::HardwareCounters::Values end;
+//      counters.Read(end);
+//
+//      std::uint64_t cacheMisses = end[System::HardwareCounterTypes::CacheMisses] - start[System::HardwareCounterTypes::CacheMisses];
+//
+
+namespace System
+{
+    // Types of hardware counters.
+    struct HardwareCounterTypes
+    {
+        enum Type
+        {
+            Instructions,
+            Cycles,
+            CacheMisses,
+            BranchMisses,
+
+            Count,
+        };
+    };
+
+    // Hardware counters class.
+    class HardwareCounters : private NonCopyable
+    {
+    public:
+        // Values of all counter types.
+        struct Values
+        {
+            Values();
+
+            std::uint64_t& operator[](int type);
+            const std::uint64_t& operator[](int type) const;
+
+            std::uint64_t counts[HardwareCounterTypes::Count];
+        };
+
+    public:
+        HardwareCounters();
+        ~HardwareCounters();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Opens and starts counters for the calling thread.
+        // Succeeds if at least one counter type is available.
+        bool Initialize();
+
+        // Reads current values of counters.
+        // Must be called on the thread that initialized the counters.
+        bool Read(Values& values) const;
+
+        // Checks if a counter type is available.
+        bool IsAvailable(HardwareCounterTypes::Type type) const;
+
+        // Gets the name of a counter type.
+        static const char* GetTypeName(HardwareCounterTypes::Type type);
+
+        // Checks if the instance is initialized.
+        bool IsInitialized() const;
+
+    private:
+        // File descriptors of counters, or -1 for unavailable ones.
+        // The first available counter leads the group.
+        int m_descriptors[HardwareCounterTypes::Count];
+        int m_leader;
+
+        // Positions of counters in values read from the group.
+        int m_positions[HardwareCounterTypes::Count];
+        int m_availableCount;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,230 @@
+#include "Precompiled.hpp"
+#include "InputState.hpp"
+using namespace System;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize an input state! "
+
+    // Checks if a key or button can be stored in a set.
+    template<typename Set>
+    bool IsInRange(const Set& set, int index)
+    {
+        return index >= 0 && (std::size_t)index < set.size();
+    }
+}
+
+InputState::InputState() :
+    m_cursorKnown(false),
+    m_cursorX(0.0),
+    m_cursorY(0.0),
+    m_cursorDeltaX(0.0),
+    m_cursorDeltaY(0.0),
+    m_scrollOffset(0.0),
+    m_initialized(false)
+{
+}
+
+InputState::~InputState()
+{
+    this->Cleanup();
+}
+
+void InputState::Cleanup()
+{
+    if(!m_initialized)
+        return;
+
+    // Unsubscribe from window events.
+    m_keyboardKey.Cleanup();
+    m_mouseButton.Cleanup();
+    m_mouseScroll.Cleanup();
+    m_cursorPosition.Cleanup();
+    m_focus.Cleanup();
+
+    // Reset the input state.
+    m_keysDown.reset();
+    m_keysPressed.reset();
+    m_keysReleased.reset();
+
+    m_buttonsDown.reset();
+    m_buttonsPressed.reset();
+    m_buttonsReleased.reset();
+
+    m_cursorKnown = false;
+    m_cursorX = 0.0;
+    m_cursorY = 0.0;
+    m_cursorDeltaX = 0.0;
+    m_cursorDeltaY = 0.0;
+    m_scrollOffset = 0.0;
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool InputState::Initialize(Window* window)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Validate arguments.
+    if(window == nullptr)
+    {
+        LogError() << LogInitializeError() << "Invalid window.";
+        return false;
+    }
+
+    // Subscribe to window events.
+    m_keyboardKey.Bind<InputState, &InputState::OnKeyboardKey>(this);
+    m_mouseButton.Bind<InputState, &InputState::OnMouseButton>(this);
+    m_mouseScroll.Bind<InputState, &InputState::OnMouseScroll>(this);
+    m_cursorPosition.Bind<InputState, &InputState::OnCursorPosition>(this);
+    m_focus.Bind<InputState, &InputState::OnFocus>(this);
+
+    m_keyboardKey.Subscribe(window->events.keyboardKey);
+    m_mouseButton.Subscribe(window->events.mouseButton);
+    m_mouseScroll.Subscribe(window->events.mouseScroll);
+    m_cursorPosition.Subscribe(window->events.cursorPosition);
+    m_focus.Subscribe(window->events.focus);
+
+    // Success!
+    return m_initialized = true;
+}
+
+void InputState::Update()
+{
+    // Clear edges and deltas of the previous snapshot.
+    m_keysPressed.reset();
+    m_keysReleased.reset();
+
+    m_buttonsPressed.reset();
+    m_buttonsReleased.reset();
+
+    m_cursorDeltaX = 0.0;
+    m_cursorDeltaY = 0.0;
+    m_scrollOffset = 0.0;
+}
+
+bool InputState::IsKeyDown(int key) const
+{
+    return IsInRange(m_keysDown, key) && m_keysDown.test(key);
+}
+
+bool InputState::IsKeyPressed(int key) const
+{
+    return IsInRange(m_keysPressed, key) && m_keysPressed.test(key);
+}
+
+bool InputState::IsKeyReleased(int key) const
+{
+    return IsInRange(m_keysReleased, key) && m_keysReleased.test(key);
+}
+
+bool InputState::IsMouseButtonDown(int button) const
+{
+    return IsInRange(m_buttonsDown, button) && m_buttonsDown.test(button);
+}
+
+bool InputState::IsMouseButtonPressed(int button) const
+{
+    return IsInRange(m_buttonsPressed, button) && m_buttonsPressed.test(button);
+}
+
+bool InputState::IsMouseButtonReleased(int button) const
+{
+    return IsInRange(m_buttonsReleased, button) && m_buttonsReleased.test(button);
+}
+
+double InputState::GetCursorX() const
+{
+    return m_cursorX;
+}
+
+double InputState::GetCursorY() const
+{
+    return m_cursorY;
+}
+
+double InputState::GetCursorDeltaX() const
+{
+    return m_cursorDeltaX;
+}
+
+double InputState::GetCursorDeltaY() const
+{
+    return m_cursorDeltaY;
+}
+
+double InputState::GetScrollOffset() const
+{
+    return m_scrollOffset;
+}
+
+void InputState::OnKeyboardKey(const Window::Events::KeyboardKey& event)
+{
+    // Skip unknown keys.
+    if(!IsInRange(m_keysDown, event.key))
+        return;
+
+    // Repeated keys are already held down.
+    if(event.action == GLFW_PRESS)
+    {
+        m_keysDown.set(event.key);
+        m_keysPressed.set(event.key);
+    }
+    else if(event.action == GLFW_RELEASE)
+    {
+        m_keysDown.reset(event.key);
+        m_keysReleased.set(event.key);
+    }
+}
+
+void InputState::OnMouseButton(const Window::Events::MouseButton& event)
+{
+    if(!IsInRange(m_buttonsDown, event.button))
+        return;
+
+    if(event.action == GLFW_PRESS)
+    {
+        m_buttonsDown.set(event.button);
+        m_buttonsPressed.set(event.button);
+    }
+    else if(event.action == GLFW_RELEASE)
+    {
+        m_buttonsDown.reset(event.button);
+        m_buttonsReleased.set(event.button);
+    }
+}
+
+void InputState::OnMouseScroll(const Window::Events::MouseScroll& event)
+{
+    m_scrollOffset += event.offset;
+}
+
+void InputState::OnCursorPosition(const Window::Events::CursorPosition& event)
+{
+    // The first known position does not move the cursor.
+    if(m_cursorKnown)
+    {
+        m_cursorDeltaX += event.x - m_cursorX;
+        m_cursorDeltaY += event.y - m_cursorY;
+    }
+
+    m_cursorX = event.x;
+    m_cursorY = event.y;
+    m_cursorKnown = true;
+}
+
+void InputState::OnFocus(const Window::Events::Focus& event)
+{
+    if(event.focused)
+        return;
+
+    // Release held keys and buttons, as their release events will not be received.
+    m_keysReleased |= m_keysDown;
+    m_keysDown.reset();
+
+    m_buttonsReleased |= m_buttonsDown;
+    m_buttonsDown.reset();
+}
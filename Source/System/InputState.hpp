@@ -0,0 +1,124 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Window.hpp"
+
+//
+// Input State
+//
+//  Keeps a snapshot of keyboard and mouse state built from window events,
+//  so systems can poll input with a bit test instead of subscribing their
+//  own receivers. Besides keys and buttons being held down, the snapshot
+//  has edges of keys and buttons pressed or released since the last update,
+//  which are not lost when a key is pressed and released within one frame.
+//
+//  Update() starts a new snapshot and has to be called once per frame,
+//  before window events are processed. Held keys are released when the
+//  window loses focus, as their release events will not be received.
+//
+//  Example usage:
+//      System::InputState inputState;
+//      inputState.Initialize(&window);
+//
+//      while(window.IsOpen())
+//      {
+//          inputState.Update();
+//          window.ProcessEvents();
+//
+//          if(inputState.IsKeyPressed(GLFW_KEY_SPACE))
+//          {
+//              /* ... */
+//          }
+//      }
+//
+
+namespace System
+{
+    // Input state class.
+    class InputState : private NonCopyable
+    {
+    public:
+        InputState();
+        ~InputState();
+
+        // Restores instance to its original state.
+        void Cleanup();
+
+        // Initializes the input state instance.
+        bool Initialize(Window* window);
+
+        // Starts a new snapshot by clearing edges and deltas.
+        void Update();
+
+        // Checks if a key is held down.
+        bool IsKeyDown(int key) const;
+
+        // Checks if a key has been pressed since the last update.
+        bool IsKeyPressed(int key) const;
+
+        // Checks if a key has been released since the last update.
+        bool IsKeyReleased(int key) const;
+
+        // Checks if a mouse button is held down.
+        bool IsMouseButtonDown(int button) const;
+
+        // Checks if a mouse button has been pressed since the last update.
+        bool IsMouseButtonPressed(int button) const;
+
+        // Checks if a mouse button has been released since the last update.
+        bool IsMouseButtonReleased(int button) const;
+
+        // Gets the cursor position.
+        double GetCursorX() const;
+        double GetCursorY() const;
+
+        // Gets the cursor movement since the last update.
+        double GetCursorDeltaX() const;
+        double GetCursorDeltaY() const;
+
+        // Gets the scroll offset since the last update.
+        double GetScrollOffset() const;
+
+    private:
+        // Event handlers.
+        void OnKeyboardKey(const Window::Events::KeyboardKey& event);
+        void OnMouseButton(const Window::Events::MouseButton& event);
+        void OnMouseScroll(const Window::Events::MouseScroll& event);
+        void OnCursorPosition(const Window::Events::CursorPosition& event);
+        void OnFocus(const Window::Events::Focus& event);
+
+    private:
+        // Type declarations.
+        typedef std::bitset<GLFW_KEY_LAST + 1> KeySet;
+        typedef std::bitset<GLFW_MOUSE_BUTTON_LAST + 1> ButtonSet;
+
+    private:
+        // Event receivers.
+        Receiver<void(const Window::Events::KeyboardKey&)> m_keyboardKey;
+        Receiver<void(const Window::Events::MouseButton&)> m_mouseButton;
+        Receiver<void(const Window::Events::MouseScroll&)> m_mouseScroll;
+        Receiver<void(const Window::Events::CursorPosition&)> m_cursorPosition;
+        Receiver<void(const Window::Events::Focus&)> m_focus;
+
+        // Keyboard state.
+        KeySet m_keysDown;
+        KeySet m_keysPressed;
+        KeySet m_keysReleased;
+
+        // Mouse button state.
+        ButtonSet m_buttonsDown;
+        ButtonSet m_buttonsPressed;
+        ButtonSet m_buttonsReleased;
+
+        // Cursor state.
+        bool m_cursorKnown;
+        double m_cursorX;
+        double m_cursorY;
+        double m_cursorDeltaX;
+        double m_cursorDeltaY;
+        double m_scrollOffset;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
@@ -0,0 +1,475 @@
+#include "Precompiled.hpp"
+#include "Metrics.hpp"
+using namespace System;
+
+namespace
+{
+    // Log message strings.
+    #define LogInitializeError() "Failed to initialize metrics! "
+    #define LogRegisterError(name) "Failed to register a metric \"" << name << "\"! "
+    #define LogExportError(filename) "Failed to export metrics to \"" << filename << "\"! "
+
+    // Source of unique metrics identifiers.
+    std::atomic<std::uint64_t> metricsIdentifiers(0);
+
+    // Block of the calling thread in the last metrics instance it has recorded to.
+    struct BlockCache
+    {
+        std::uint64_t metrics;
+        void* block;
+    };
+
+    thread_local BlockCache blockCache = { 0, nullptr };
+
+    // Stores doubles in slots of integers.
+    std::uint64_t DoubleToBits(double value)
+    {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    double BitsToDouble(std::uint64_t bits)
+    {
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+}
+
+MetricsInfo::MetricsInfo() :
+    format(MetricsFormats::Prometheus),
+    prefix("server_"),
+    exportInterval(10.0)
+{
+}
+
+Metrics::ThreadBlock::ThreadBlock(std::thread::id thread) :
+    thread(thread)
+{
+    for(std::atomic<std::uint64_t>& value : values)
+    {
+        value.store(0, std::memory_order_relaxed);
+    }
+}
+
+Metrics::Metrics() :
+    m_identifier(0),
+    m_metricCount(0),
+    m_slotCount(0),
+    m_exporterExit(false),
+    m_initialized(false)
+{
+}
+
+Metrics::~Metrics()
+{
+    this->Cleanup();
+}
+
+void Metrics::Cleanup()
+{
+    // Stop the export thread.
+    // Also called on a partially initialized instance when initialization fails.
+    {
+        std::lock_guard<std::mutex> lock(m_exporterMutex);
+        m_exporterExit = true;
+    }
+
+    m_exporterCondition.notify_all();
+
+    if(m_exporter.joinable())
+    {
+        m_exporter.join();
+    }
+
+    m_exporterExit = false;
+
+    // Export values recorded since the last export.
+    if(m_initialized)
+    {
+        this->Export();
+    }
+
+    // Release registered metrics and blocks.
+    for(Metric& metric : m_metrics)
+    {
+        metric = Metric();
+    }
+
+    m_metricCount = 0;
+    m_slotCount = 0;
+
+    Utility::ClearContainer(m_blocks);
+    m_gauges = nullptr;
+    Utility::ClearContainer(m_exported);
+
+    m_identifier = 0;
+
+    // Reset initialization parameters.
+    m_info = MetricsInfo();
+
+    // Reset the initialization state.
+    m_initialized = false;
+}
+
+bool Metrics::Initialize(const MetricsInfo& info)
+{
+    // Cleanup this instance.
+    this->Cleanup();
+
+    // Setup a cleanup guard.
+    SCOPE_GUARD
+    (
+        if(!m_initialized)
+        {
+            this->Cleanup();
+        }
+    );
+
+    // Validate arguments.
+    if(info.exportInterval <= 0.0)
+    {
+        LogError() << LogInitializeError() << "Invalid export interval.";
+        return false;
+    }
+
+    m_info = info;
+    m_identifier = ++metricsIdentifiers;
+    m_gauges.reset(new ThreadBlock(std::thread::id()));
+
+    // Start the export thread if there is a file to export to.
+    if(!m_info.filename.empty())
+    {
+        m_exporter = std::thread(&Metrics::RunExporter, this);
+    }
+
+    // Success!
+    return m_initialized = true;
+}
+
+int Metrics::AddCounter(const std::string& name, const std::string& help)
+{
+    return this->AddMetric(MetricTypes::Counter, name, help, 1);
+}
+
+int Metrics::AddGauge(const std::string& name, const std::string& help)
+{
+    return this->AddMetric(MetricTypes::Gauge, name, help, 1);
+}
+
+int Metrics::AddHistogram(const std::string& name, const std::string& help, const std::vector<double>& bounds)
+{
+    if(!std::is_sorted(bounds.begin(), bounds.end()))
+    {
+        LogError() << LogRegisterError(name) << "Bucket bounds are not sorted.";
+        return InvalidMetric;
+    }
+
+    // Use a slot for each bucket, one for values above the last bound and one for the sum.
+    int metric = this->AddMetric(MetricTypes::Histogram, name, help, (int)bounds.size() + 2);
+
+    if(metric != InvalidMetric)
+    {
+        m_metrics[metric].bounds = bounds;
+    }
+
+    return metric;
+}
+
+int Metrics::AddMetric(MetricTypes::Type type, const std::string& name, const std::string& help, int slotCount)
+{
+    if(!m_initialized)
+        return InvalidMetric;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    int index = m_metricCount.load(std::memory_order_relaxed);
+
+    if(index >= MaximumMetrics || m_slotCount + slotCount > MaximumSlots)
+    {
+        LogError() << LogRegisterError(name) << "Reached the maximum number of metrics.";
+        return InvalidMetric;
+    }
+
+    Metric& metric = m_metrics[index];
+    metric.type = type;
+    metric.name = m_info.prefix + name;
+    metric.help = help;
+    metric.slot = m_slotCount;
+
+    m_slotCount += slotCount;
+
+    // Publish the metric after it has been written.
+    m_metricCount.store(index + 1, std::memory_order_release);
+
+    return index;
+}
+
+void Metrics::Increment(int counter, std::uint64_t value)
+{
+    if(counter == InvalidMetric)
+        return;
+
+    Assert(counter >= 0 && counter < m_metricCount.load(std::memory_order_relaxed), "Invalid metric identifier!");
+    Assert(m_metrics[counter].type == MetricTypes::Counter, "Metric is not a counter!");
+
+    // Only this thread writes its block, so a plain store suffices.
+    std::atomic<std::uint64_t>& slot = this->GetThreadBlock()->values[m_metrics[counter].slot];
+    slot.store(slot.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+void Metrics::SetGauge(int gauge, double value)
+{
+    if(gauge == InvalidMetric)
+        return;
+
+    Assert(gauge >= 0 && gauge < m_metricCount.load(std::memory_order_relaxed), "Invalid metric identifier!");
+    Assert(m_metrics[gauge].type == MetricTypes::Gauge, "Metric is not a gauge!");
+
+    m_gauges->values[m_metrics[gauge].slot].store(DoubleToBits(value), std::memory_order_relaxed);
+}
+
+void Metrics::Observe(int histogram, double value)
+{
+    if(histogram == InvalidMetric)
+        return;
+
+    Assert(histogram >= 0 && histogram < m_metricCount.load(std::memory_order_relaxed), "Invalid metric identifier!");
+    Assert(m_metrics[histogram].type == MetricTypes::Histogram, "Metric is not a histogram!");
+
+    const Metric& metric = m_metrics[histogram];
+    ThreadBlock* block = this->GetThreadBlock();
+
+    // Find the first bucket with an upper bound that is not below the value.
+    int bucket = (int)(std::lower_bound(metric.bounds.begin(), metric.bounds.end(), value) - metric.bounds.begin());
+
+    std::atomic<std::uint64_t>& count = block->values[metric.slot + bucket];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    std::atomic<std::uint64_t>& sum = block->values[metric.slot + metric.bounds.size() + 1];
+    sum.store(DoubleToBits(BitsToDouble(sum.load(std::memory_order_relaxed)) + value), std::memory_order_relaxed);
+}
+
+Metrics::ThreadBlock* Metrics::GetThreadBlock()
+{
+    Assert(m_initialized, "Metrics are not initialized!");
+
+    // Use the cached block if the thread has recorded to this instance before.
+    if(blockCache.metrics == m_identifier)
+        return static_cast<ThreadBlock*>(blockCache.block);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Find a block of the thread, or of a finished thread with the same identifier.
+    std::thread::id thread = std::this_thread::get_id();
+    ThreadBlock* block = nullptr;
+
+    for(auto& threadBlock : m_blocks)
+    {
+        if(threadBlock->thread == thread)
+        {
+            block = threadBlock.get();
+            break;
+        }
+    }
+
+    // Create a block for a new thread.
+    if(block == nullptr)
+    {
+        m_blocks.emplace_back(new ThreadBlock(thread));
+        block = m_blocks.back().get();
+    }
+
+    blockCache.metrics = m_identifier;
+    blockCache.block = block;
+
+    return block;
+}
+
+std::uint64_t Metrics::SumSlot(int slot) const
+{
+    std::uint64_t sum = 0;
+
+    for(const auto& block : m_blocks)
+    {
+        sum += block->values[slot].load(std::memory_order_relaxed);
+    }
+
+    return sum;
+}
+
+double Metrics::SumDoubleSlot(int slot) const
+{
+    double sum = 0.0;
+
+    for(const auto& block : m_blocks)
+    {
+        sum += BitsToDouble(block->values[slot].load(std::memory_order_relaxed));
+    }
+
+    return sum;
+}
+
+void Metrics::Format(std::string& text)
+{
+    if(!m_initialized)
+        return;
+
+    std::lock_guard<std::mutex> formatLock(m_formatMutex);
+
+    int metricCount = m_metricCount.load(std::memory_order_acquire);
+
+    std::ostringstream stream;
+    stream << std::setprecision(12);
+
+    // Sum blocks of all threads while no thread adds a block.
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_exported.resize(MaximumSlots, 0);
+
+    for(int i = 0; i < metricCount; ++i)
+    {
+        const Metric& metric = m_metrics[i];
+
+        if(m_info.format == MetricsFormats::Prometheus)
+        {
+            if(!metric.help.empty())
+            {
+                stream << "# HELP " << metric.name << " " << metric.help << "\n";
+            }
+
+            switch(metric.type)
+            {
+            case MetricTypes::Counter:
+                stream << "# TYPE " << metric.name << " counter\n";
+                stream << metric.name << " " << this->SumSlot(metric.slot) << "\n";
+                break;
+
+            case MetricTypes::Gauge:
+                stream << "# TYPE " << metric.name << " gauge\n";
+                stream << metric.name << " " << BitsToDouble(m_gauges->values[metric.slot].load(std::memory_order_relaxed)) << "\n";
+                break;
+
+            case MetricTypes::Histogram:
+                {
+                    stream << "# TYPE " << metric.name << " histogram\n";
+
+                    // Buckets are cumulative in this format.
+                    std::uint64_t cumulative = 0;
+
+                    for(std::size_t bucket = 0; bucket <= metric.bounds.size(); ++bucket)
+                    {
+                        cumulative += this->SumSlot(metric.slot + (int)bucket);
+                        stream << metric.name << "_bucket{le=\"";
+
+                        if(bucket < metric.bounds.size())
+                        {
+                            stream << metric.bounds[bucket];
+                        }
+                        else
+                        {
+                            stream << "+Inf";
+                        }
+
+                        stream << "\"} " << cumulative << "\n";
+                    }
+
+                    stream << metric.name << "_sum " << this->SumDoubleSlot(metric.slot + (int)metric.bounds.size() + 1) << "\n";
+                    stream << metric.name << "_count " << cumulative << "\n";
+                }
+                break;
+            }
+        }
+        else
+        {
+            switch(metric.type)
+            {
+            case MetricTypes::Counter:
+                {
+                    std::uint64_t value = this->SumSlot(metric.slot);
+                    stream << metric.name << ":" << value - m_exported[metric.slot] << "|c\n";
+                    m_exported[metric.slot] = value;
+                }
+                break;
+
+            case MetricTypes::Gauge:
+                stream << metric.name << ":" << BitsToDouble(m_gauges->values[metric.slot].load(std::memory_order_relaxed)) << "|g\n";
+                break;
+
+            case MetricTypes::Histogram:
+                {
+                    // Send the number and sum of values recorded since the previous export.
+                    std::uint64_t count = 0;
+
+                    for(std::size_t bucket = 0; bucket <= metric.bounds.size(); ++bucket)
+                    {
+                        count += this->SumSlot(metric.slot + (int)bucket);
+                    }
+
+                    int sumSlot = metric.slot + (int)metric.bounds.size() + 1;
+                    double sum = this->SumDoubleSlot(sumSlot);
+
+                    stream << metric.name << ".count:" << count - m_exported[metric.slot] << "|c\n";
+                    stream << metric.name << ".sum:" << sum - BitsToDouble(m_exported[sumSlot]) << "|c\n";
+
+                    m_exported[metric.slot] = count;
+                    m_exported[sumSlot] = DoubleToBits(sum);
+                }
+                break;
+            }
+        }
+    }
+
+    text = stream.str();
+}
+
+bool Metrics::Export()
+{
+    if(!m_initialized || m_info.filename.empty())
+        return false;
+
+    std::string text;
+    this->Format(text);
+
+    // Write a temporary file and replace the export with it,
+    // so collectors never read a partially written file.
+    std::string temporaryFilename = m_info.filename + ".tmp";
+
+    {
+        std::ofstream file(temporaryFilename, std::ios::binary | std::ios::trunc);
+
+        if(!file || !file.write(text.data(), text.size()))
+        {
+            LogError() << LogExportError(temporaryFilename) << "Couldn't write to the file.";
+            return false;
+        }
+    }
+
+    std::remove(m_info.filename.c_str());
+
+    if(std::rename(temporaryFilename.c_str(), m_info.filename.c_str()) != 0)
+    {
+        LogError() << LogExportError(m_info.filename) << "Couldn't replace the file.";
+        return false;
+    }
+
+    return true;
+}
+
+void Metrics::RunExporter()
+{
+    std::unique_lock<std::mutex> lock(m_exporterMutex);
+
+    auto interval = std::chrono::duration<double>(m_info.exportInterval);
+
+    while(!m_exporterExit)
+    {
+        if(m_exporterCondition.wait_for(lock, interval, [this]() { return m_exporterExit; }))
+            break;
+
+        lock.unlock();
+        this->Export();
+        lock.lock();
+    }
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include "Precompiled.hpp"
+
+//
+// Metrics
+//
+//  Aggregates counters, gauges and histograms of server telemetry and exports
+//  them periodically from a background thread, so fleet dashboards can track
+//  tick times and load of every server. Every thread that records values gets
+//  its own block of slots that only it writes to, so recording is lock free and
+//  does not contend with other threads. The export thread sums blocks of all
+//  threads. Gauges are shared, with the last value set by any thread winning.
+//
+//  Histograms count values in buckets with fixed upper bounds, plus a bucket
+//  for values above the last bound, and keep the sum of all values.
+//
+//  Exported text replaces the content of a file on every export, either in the
+//  Prometheus text format, which the textfile collector of a node exporter
+//  serves, or as StatsD lines with counters sent as differences since the
+//  previous export. Metrics should be registered before recording starts, as
+//  registration locks and metrics can't be removed.
+//
+//  Example usage:
+//      System::MetricsInfo info;
+//      info.filename = "Metrics.prom";
+//      info.exportInterval = 10.0;
+//
+//      System::Metrics metrics;
+//      metrics.Initialize(info);
+//
+//      int ticks = metrics.AddCounter("ticks_total", "Number of simulated ticks.");
+//      int tickTime = metrics.AddHistogram("tick_seconds", "Time spent simulating a tick.", { 0.001, 0.005, 0.016 });
+//
+//      metrics.Increment(ticks);
+//      metrics.Observe(tickTime, seconds);
+//
+
+namespace System
+{
+    // Metric export formats.
+    struct MetricsFormats
+    {
+        enum Type
+        {
+            Prometheus,
+            StatsD,
+        };
+    };
+
+    // Metrics initialization struct.
+    struct MetricsInfo
+    {
+        // File that exported metrics are written to.
+        std::string filename;
+
+        // Format of exported metrics.
+        MetricsFormats::Type format;
+
+        // Prefix prepended to names of metrics.
+        std::string prefix;
+
+        // Time between exports in seconds.
+        double exportInterval;
+
+        MetricsInfo();
+    };
+
+    // Metrics class.
+    class Metrics : private NonCopyable
+    {
+    public:
+        // Maximum number of registered metrics.
+        static const int MaximumMetrics = 128;
+
+        // Number of value slots in a block of a thread.
+        static const int MaximumSlots = 1024;
+
+        // Invalid metric identifier.
+        static const int InvalidMetric = -1;
+
+    public:
+        Metrics();
+        ~Metrics();
+
+        // Restores instance to its original state.
+        // Exports metrics one last time.
+        void Cleanup();
+
+        // Initializes metrics and starts the export thread.
+        bool Initialize(const MetricsInfo& info);
+
+        // Registers a counter that only increases.
+        // Returns an invalid identifier if there are no slots left.
+        int AddCounter(const std::string& name, const std::string& help);
+
+        // Registers a gauge that is set to its current value.
+        int AddGauge(const std::string& name, const std::string& help);
+
+        // Registers a histogram with ascending upper bounds of its buckets.
+        int AddHistogram(const std::string& name, const std::string& help, const std::vector<double>& bounds);
+
+        // Increases a counter.
+        void Increment(int counter, std::uint64_t value = 1);
+
+        // Sets a gauge.
+        void SetGauge(int gauge, double value);
+
+        // Records a value in a histogram.
+        void Observe(int histogram, double value);
+
+        // Formats current values of all metrics.
+        // Counters of StatsD lines are sent as differences since the previous call.
+        void Format(std::string& text);
+
+        // Formats current values and writes them to the export file.
+        bool Export();
+
+    private:
+        // Metric types.
+        struct MetricTypes
+        {
+            enum Type
+            {
+                Counter,
+                Gauge,
+                Histogram,
+            };
+        };
+
+        // Registered metric.
+        struct Metric
+        {
+            MetricTypes::Type type;
+            std::string name;
+            std::string help;
+
+            // First slot of values.
+            // Histograms use a slot for each bucket followed by the sum.
+            int slot;
+
+            // Upper bounds of histogram buckets.
+            std::vector<double> bounds;
+        };
+
+        // Block of values written by a single thread.
+        struct ThreadBlock
+        {
+            ThreadBlock(std::thread::id thread);
+
+            std::thread::id thread;
+            std::atomic<std::uint64_t> values[MaximumSlots];
+        };
+
+        // Type declarations.
+        typedef std::vector<std::unique_ptr<ThreadBlock>> BlockList;
+
+    private:
+        // Registers a metric with a number of slots.
+        int AddMetric(MetricTypes::Type type, const std::string& name, const std::string& help, int slotCount);
+
+        // Gets the block of the calling thread.
+        ThreadBlock* GetThreadBlock();
+
+        // Sums a slot over blocks of all threads.
+        std::uint64_t SumSlot(int slot) const;
+        double SumDoubleSlot(int slot) const;
+
+        // Runs the export thread.
+        void RunExporter();
+
+    private:
+        // Initialization parameters.
+        MetricsInfo m_info;
+
+        // Unique identifier of the initialized instance, cached by threads with their block.
+        std::uint64_t m_identifier;
+
+        // Registered metrics, published by the count.
+        Metric m_metrics[MaximumMetrics];
+        std::atomic<int> m_metricCount;
+        int m_slotCount;
+
+        // Blocks of threads and shared gauge values.
+        BlockList m_blocks;
+        std::unique_ptr<ThreadBlock> m_gauges;
+        mutable std::mutex m_mutex;
+
+        // Summed values of the previous StatsD export.
+        std::vector<std::uint64_t> m_exported;
+        std::mutex m_formatMutex;
+
+        // Export thread state.
+        std::thread m_exporter;
+        std::mutex m_exporterMutex;
+        std::condition_variable m_exporterCondition;
+        bool m_exporterExit;
+
+        // Initialization state.
+        bool m_initialized;
+    };
+}
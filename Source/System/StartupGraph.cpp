@@ -0,0 +1,256 @@
+#include "Precompiled.hpp"
+#include "StartupGraph.hpp"
+using namespace System;
+
+StartupGraph::StartupGraph() :
+    m_jobSystem(nullptr),
+    m_failed(false)
+{
+}
+
+StartupGraph::~StartupGraph()
+{
+}
+
+int StartupGraph::AddTask(std::string name, TaskFunction function, StartupThreads::Type thread)
+{
+    Assert(m_counters == nullptr, "Can't add tasks while the graph is running!");
+
+    Task task;
+    task.name = name;
+    task.function = function;
+    task.thread = thread;
+    task.remaining = 0;
+    task.state = TaskStates::Waiting;
+    task.startTime = 0.0;
+    task.endTime = 0.0;
+
+    m_tasks.push_back(task);
+
+    return (int)m_tasks.size() - 1;
+}
+
+void StartupGraph::AddDependency(int task, int dependency)
+{
+    Assert(m_counters == nullptr, "Can't add dependencies while the graph is running!");
+    Assert(task >= 0 && task < (int)m_tasks.size(), "Invalid task index!");
+    Assert(dependency >= 0 && dependency < (int)m_tasks.size(), "Invalid dependency index!");
+
+    m_tasks[dependency].dependents.push_back(task);
+}
+
+bool StartupGraph::Run(JobSystem* jobSystem)
+{
+    m_jobSystem = jobSystem;
+    m_counters.reset(new JobCounter[m_tasks.size()]);
+    m_mainTasks.clear();
+    m_startTime = Clock::now();
+    m_failed = false;
+
+    // Count dependencies and find tasks that can start right away.
+    std::vector<int> ready;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for(Task& task : m_tasks)
+        {
+            task.remaining = 0;
+            task.state = TaskStates::Waiting;
+        }
+
+        for(const Task& task : m_tasks)
+        {
+            for(int dependent : task.dependents)
+            {
+                m_tasks[dependent].remaining += 1;
+            }
+        }
+
+        for(int i = 0; i < (int)m_tasks.size(); ++i)
+        {
+            if(m_tasks[i].remaining != 0)
+                continue;
+
+            m_tasks[i].state = TaskStates::Ready;
+
+            if(m_tasks[i].thread == StartupThreads::Main)
+            {
+                m_mainTasks.push_back(i);
+            }
+            else
+            {
+                ready.push_back(i);
+            }
+        }
+    }
+
+    this->ScheduleTasks(ready);
+
+    // Run main thread tasks and help with jobs until no task is left to run.
+    while(true)
+    {
+        int mainTask = -1;
+        int jobTask = -1;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if(!m_mainTasks.empty())
+            {
+                mainTask = m_mainTasks.front();
+                m_mainTasks.pop_front();
+            }
+            else
+            {
+                for(int i = 0; i < (int)m_tasks.size(); ++i)
+                {
+                    const Task& task = m_tasks[i];
+
+                    if(task.thread != StartupThreads::Main && (task.state == TaskStates::Ready || task.state == TaskStates::Running))
+                    {
+                        jobTask = i;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if(mainTask >= 0)
+        {
+            this->RunTask(mainTask);
+        }
+        else if(jobTask >= 0)
+        {
+            // Runs other jobs while waiting, so tasks progress without workers.
+            m_jobSystem->Wait(m_counters[jobTask]);
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    // Tasks are marked as finished before their jobs return,
+    // so wait for counters to be released before freeing them.
+    if(m_jobSystem != nullptr)
+    {
+        for(std::size_t i = 0; i < m_tasks.size(); ++i)
+        {
+            m_jobSystem->Wait(m_counters[i]);
+        }
+    }
+
+    // Tasks that never ran wait on each other, unless a task has failed.
+    if(!m_failed)
+    {
+        for(const Task& task : m_tasks)
+        {
+            if(task.state != TaskStates::Finished)
+            {
+                LogError() << "Failed to run startup tasks! Dependencies of \"" << task.name << "\" task form a cycle.";
+                m_failed = true;
+                break;
+            }
+        }
+    }
+
+    m_counters.reset();
+    m_jobSystem = nullptr;
+
+    return !m_failed;
+}
+
+void StartupGraph::RunTask(int index)
+{
+    Task& task = m_tasks[index];
+
+    // Skip tasks that were ready before another one failed.
+    bool skipped = false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        skipped = m_failed;
+        task.state = TaskStates::Running;
+        task.startTime = Clock::GetSecondsSince(m_startTime);
+    }
+
+    bool succeeded = !skipped && task.function();
+
+    // Release dependents of the finished task.
+    std::vector<int> ready;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Skipped tasks are left waiting, as they never ran.
+        task.state = skipped ? TaskStates::Waiting : TaskStates::Finished;
+        task.endTime = Clock::GetSecondsSince(m_startTime);
+
+        if(!succeeded)
+        {
+            if(!skipped)
+            {
+                LogError() << "Failed to run startup tasks! Task \"" << task.name << "\" has failed.";
+            }
+
+            m_failed = true;
+        }
+        else if(!m_failed)
+        {
+            for(int dependent : task.dependents)
+            {
+                Task& dependentTask = m_tasks[dependent];
+
+                if(--dependentTask.remaining != 0)
+                    continue;
+
+                dependentTask.state = TaskStates::Ready;
+
+                if(dependentTask.thread == StartupThreads::Main)
+                {
+                    m_mainTasks.push_back(dependent);
+                }
+                else
+                {
+                    ready.push_back(dependent);
+                }
+            }
+        }
+    }
+
+    this->ScheduleTasks(ready);
+}
+
+void StartupGraph::ScheduleTasks(const std::vector<int>& tasks)
+{
+    for(int task : tasks)
+    {
+        if(m_jobSystem != nullptr)
+        {
+            m_jobSystem->Schedule([this, task]() { this->RunTask(task); }, &m_counters[task]);
+        }
+        else
+        {
+            this->RunTask(task);
+        }
+    }
+}
+
+void StartupGraph::LogTimes() const
+{
+    double totalTime = 0.0;
+
+    for(const Task& task : m_tasks)
+    {
+        if(task.state != TaskStates::Finished)
+            continue;
+
+        Log() << "Startup task \"" << task.name << "\" took " << task.endTime - task.startTime << " seconds, starting at " << task.startTime << " seconds.";
+
+        totalTime = std::max(totalTime, task.endTime);
+    }
+
+    Log() << "Startup tasks finished in " << totalTime << " seconds.";
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Common/JobSystem.hpp"
+#include "Clock.hpp"
+
+//
+// Startup Graph
+//
+//  Runs initialization tasks of subsystems in the order of their explicit
+//  dependencies, with independent tasks running at the same time. Tasks
+//  run as jobs on the job system, except for tasks bound to the main thread,
+//  such as creating the window and its OpenGL context, which run on the
+//  thread that runs the graph. The main thread helps with jobs while it has
+//  no task of its own to run.
+//
+//  A task returns false if its subsystem failed to initialize, after which
+//  no new tasks are started. Running tasks are finished before the graph
+//  returns, so subsystems are never cleaned up while being initialized.
+//  Dependencies that form a cycle are reported as a failure.
+//
+//  Tasks must only touch state of their own subsystem and of subsystems
+//  they depend on, and must not read the config, which is not thread safe.
+//  Values from the config should be read into info structs beforehand.
+//
+//  Example usage:
+//      System::StartupGraph startup;
+//
+//      int window = startup.AddTask("Window", [&]() { return window.Initialize(windowInfo); }, System::StartupThreads::Main);
+//      int renderer = startup.AddTask("Renderer", [&]() { return renderer.Initialize(rendererInfo); }, System::StartupThreads::Main);
+//      int entities = startup.AddTask("Entities", [&]() { return entitySystem.Initialize(entitySystemInfo); });
+//
+//      startup.AddDependency(renderer, window);
+//
+//      if(!startup.Run(&jobSystem))
+//          return -1;
+//
+
+namespace System
+{
+    // Threads that startup tasks can run on.
+    struct StartupThreads
+    {
+        enum Type
+        {
+            Any,
+            Main,
+            Count,
+        };
+    };
+
+    // Startup graph class.
+    class StartupGraph : private NonCopyable
+    {
+    public:
+        // Type declarations.
+        typedef std::function<bool()> TaskFunction;
+
+    public:
+        StartupGraph();
+        ~StartupGraph();
+
+        // Adds a task and returns its index.
+        int AddTask(std::string name, TaskFunction function, StartupThreads::Type thread = StartupThreads::Any);
+
+        // Makes a task wait until another task has finished.
+        void AddDependency(int task, int dependency);
+
+        // Runs all tasks and waits until they finish.
+        // Runs every task on the calling thread if the job system is null.
+        // Returns false if a task failed or dependencies form a cycle.
+        bool Run(JobSystem* jobSystem);
+
+        // Logs how long tasks took and when they started.
+        void LogTimes() const;
+
+    private:
+        // States of a task.
+        struct TaskStates
+        {
+            enum Type
+            {
+                Waiting,
+                Ready,
+                Running,
+                Finished,
+            };
+        };
+
+        // Startup task.
+        struct Task
+        {
+            std::string name;
+            TaskFunction function;
+            StartupThreads::Type thread;
+
+            // Tasks that wait for this one.
+            std::vector<int> dependents;
+
+            // Number of unfinished dependencies.
+            int remaining;
+
+            // Current state, guarded by the mutex.
+            TaskStates::Type state;
+
+            // Times relative to the start of the graph, in seconds.
+            double startTime;
+            double endTime;
+        };
+
+    private:
+        // Runs a task and releases its dependents.
+        void RunTask(int task);
+
+        // Schedules tasks that are ready on worker threads.
+        void ScheduleTasks(const std::vector<int>& tasks);
+
+    private:
+        // List of tasks.
+        std::vector<Task> m_tasks;
+
+        // State of the current run.
+        JobSystem* m_jobSystem;
+        std::unique_ptr<JobCounter[]> m_counters;
+        std::deque<int> m_mainTasks;
+        Clock::time_point m_startTime;
+        bool m_failed;
+
+        // Guards states of tasks and the main thread queue.
+        std::mutex m_mutex;
+    };
+}
@@ -0,0 +1,36 @@
+#include "Precompiled.hpp"
+#include "Timer.hpp"
+using namespace System;
+
+Timer::Timer() :
+    m_deltaTime(0.0)
+{
+    this->Reset();
+}
+
+void Timer::Reset()
+{
+    m_resetTime = Clock::now();
+    m_tickTime = m_resetTime;
+    m_deltaTime = 0.0;
+}
+
+double Timer::Tick()
+{
+    Clock::time_point time = Clock::now();
+
+    m_deltaTime = Clock::GetSeconds(time - m_tickTime);
+    m_tickTime = time;
+
+    return m_deltaTime;
+}
+
+double Timer::GetDeltaTime() const
+{
+    return m_deltaTime;
+}
+
+double Timer::GetElapsedTime() const
+{
+    return Clock::GetSeconds(m_tickTime - m_resetTime);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Precompiled.hpp"
+#include "Clock.hpp"
+
+//
+// Timer
+//
+//  Measures time between ticks with a monotonic clock.
+//
+//  Example usage:
+//      System::Timer timer;
+//      timer.Reset();
+//
+//      while(true)
+//      {
+//          double deltaTime = timer.Tick();
+//
+//          /* ... */
+//      }
+//
+
+namespace System
+{
+    // Timer class.
+    class Timer
+    {
+    public:
+        Timer();
+
+        // Restarts measuring time from now.
+        void Reset();
+
+        // Advances the timer and returns seconds passed since the previous tick.
+        double Tick();
+
+        // Gets the seconds between the last two ticks.
+        double GetDeltaTime() const;
+
+        // Gets the seconds passed from the last reset to the last tick.
+        double GetElapsedTime() const;
+
+    private:
+        // Time points of the last reset and tick.
+        Clock::time_point m_resetTime;
+        Clock::time_point m_tickTime;
+
+        // Seconds between the last two ticks.
+        double m_deltaTime;
+    };
+}
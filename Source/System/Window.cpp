@@ -8,188 +8,90 @@ namespace
     // Log message strings.
     #define LogInitializeError() "Failed to initialize a window! "
 
-    // Instance counter for GLFW library.
-    bool LibraryInitialized = false;
-    int InstanceCount = 0;
-
-    // Window callbacks.
-    void ErrorCallback(int error, const char* description)
-    {
-        Log() << "GLFW Error: " << description;
-    }
-
-    void MoveCallback(GLFWwindow* window, int x, int y)
-    {
-        Assert(window != nullptr);
-
-        // Get the window instance.
-        auto instance = reinterpret_cast<System::Window*>(glfwGetWindowUserPointer(window));
-        Assert(instance != nullptr);
-
-        // Send an event.
-        Window::Events::Move eventData;
-        eventData.x = x;
-        eventData.y = y;
-
-        instance->events.move(eventData);
-    }
-
-    void ResizeCallback(GLFWwindow* window, int width, int height)
-    {
-        Assert(window != nullptr);
-
-        // Get the window instance.
-        auto instance = reinterpret_cast<System::Window*>(glfwGetWindowUserPointer(window));
-        Assert(instance != nullptr);
-
-        // Send an event.
-        Window::Events::Resize eventData;
-        eventData.width = width;
-        eventData.height = height;
-
-        instance->events.resize(eventData);
-    }
-
-    void FocusCallback(GLFWwindow* window, int focused)
-    {
-        Assert(window != nullptr);
-
-        // Get the window instance.
-        auto instance = reinterpret_cast<System::Window*>(glfwGetWindowUserPointer(window));
-        Assert(instance != nullptr);
-
-        // Send an event.
-        Window::Events::Focus eventData;
-        eventData.focused = focused > 0;
-
-        instance->events.focus(eventData);
-    }
-
-    void CloseCallback(GLFWwindow* window)
-    {
-        Assert(window != nullptr);
+    // Capacity of the event queue in the event thread mode.
+    const std::size_t EventQueueCapacity = 1024;
 
-        // Get the window instance.
-        auto instance = reinterpret_cast<System::Window*>(glfwGetWindowUserPointer(window));
-        Assert(instance != nullptr);
+    // Number of buffered cursor positions after which they are dispatched early.
+    const std::size_t CursorSampleCapacity = 1024;
 
-        // Send an event.
-        Window::Events::Close eventData;
+    // Time after which pumping events returns without any event.
+    const double EventWaitTimeout = 0.1;
 
-        instance->events.close(eventData);
-    }
-
-    void KeyboardKeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
-    {
-        Assert(window != nullptr);
-
-        // Get the window instance.
-        auto instance = reinterpret_cast<System::Window*>(glfwGetWindowUserPointer(window));
-        Assert(instance != nullptr);
-
-        // Send an event.
-        Window::Events::KeyboardKey eventData;
-        eventData.key = key;
-        eventData.scancode = scancode;
-        eventData.action = action;
-        eventData.mods = mods;
-
-        instance->events.keyboardKey(eventData);
-    }
-
-    void TextInputCallback(GLFWwindow* window, unsigned int character)
-    {
-        Assert(window != nullptr);
-
-        // Get the window instance.
-        auto instance = reinterpret_cast<System::Window*>(glfwGetWindowUserPointer(window));
-        Assert(instance != nullptr);
-
-        // Send an event.
-        Window::Events::TextInput eventData;
-        eventData.character = character;
-
-        instance->events.textInput(eventData);
-    }
-
-    void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
-    {
-        Assert(window != nullptr);
-
-        // Get the window instance.
-        auto instance = reinterpret_cast<System::Window*>(glfwGetWindowUserPointer(window));
-        Assert(instance != nullptr);
-
-        // Send an event.
-        Window::Events::MouseButton eventData;
-        eventData.button = button;
-        eventData.action = action;
-        eventData.mods = mods;
-
-        instance->events.mouseButton(eventData);
-    }
+    // Instance counter for GLFW library.
+    bool LibraryInitialized = false;
+    int InstanceCount = 0;
 
-    void MouseScrollCallback(GLFWwindow* window, double offsetx, double offsety)
+    // Event key functions.
+    int KeyboardKeyEventKey(const Window::Events::KeyboardKey& event)
     {
-        Assert(window != nullptr);
-
-        // Get the window instance.
-        auto instance = reinterpret_cast<System::Window*>(glfwGetWindowUserPointer(window));
-        Assert(instance != nullptr);
-
-        // Send an event.
-        Window::Events::MouseScroll eventData;
-        eventData.offset = offsety;
-
-        instance->events.mouseScroll(eventData);
+        return event.key;
     }
 
-    void CursorPositionCallback(GLFWwindow* window, double x, double y)
+    int MouseButtonEventKey(const Window::Events::MouseButton& event)
     {
-        Assert(window != nullptr);
-
-        // Get the window instance.
-        auto instance = reinterpret_cast<System::Window*>(glfwGetWindowUserPointer(window));
-        Assert(instance != nullptr);
-
-        // Send an event.
-        Window::Events::CursorPosition eventData;
-        eventData.x = x;
-        eventData.y = y;
-
-        instance->events.cursorPosition(eventData);
+        return event.button;
     }
 
-    void CursorEnterCallback(GLFWwindow* window, int entered)
+    // Library callbacks.
+    void ErrorCallback(int error, const char* description)
     {
-        Assert(window != nullptr);
-
-        // Get the window instance.
-        auto instance = reinterpret_cast<System::Window*>(glfwGetWindowUserPointer(window));
-        Assert(instance != nullptr);
-
-        // Send an event.
-        Window::Events::CursorEnter eventData;
-        eventData.entered = entered != 0;
-
-        instance->events.cursorEnter(eventData);
+        LogError() << "GLFW Error: " << description;
     }
 }
 
+const double Window::NoInputTime = -1.0;
+
 WindowInfo::WindowInfo() :
     name("Game"),
     width(1024),
     height(576),
-    vsync(true)
+    vsync(true),
+    adaptiveVsync(false),
+    frameLimit(0.0),
+    presentThread(false),
+    coalesceInput(false),
+    eventThread(false),
+    bufferCursorSamples(false),
+    rawMouseMotion(false),
+    uploadContext(false)
 {
 }
 
 Window::Window() :
     m_window(nullptr),
+    m_uploadWindow(nullptr),
+    m_presentPending(false),
+    m_presenterExit(false),
+    m_presentInputTime(NoInputTime),
+    m_coalesceInput(false),
+    m_cursorPending(false),
+    m_cursorX(0.0),
+    m_cursorY(0.0),
+    m_scrollPending(false),
+    m_scrollOffset(0.0),
+    m_cursorTime(0.0),
+    m_scrollTime(0.0),
+    m_bufferCursorSamples(false),
+    m_resizePending(false),
+    m_resize(),
+    m_eventThread(false),
+    m_eventTime(0.0),
+    m_inputTime(NoInputTime),
+    m_width(0),
+    m_height(0),
+    m_focused(false),
+    m_iconified(false),
     m_initialized(false)
 {
     // Increase instance count.
     ++InstanceCount;
+
+    // Let receivers filter input events by key and button.
+    events.keyboardKey.SetKeyFunction(&KeyboardKeyEventKey);
+    events.mouseButton.SetKeyFunction(&MouseButtonEventKey);
+
+    // Bind the receiver of queued events.
+    m_eventReceiver.Bind<Window, &Window::DispatchQueuedEvent>(this);
 }
 
 Window::~Window()
@@ -216,9 +118,13 @@ void Window::Cleanup()
     if(!m_initialized)
         return;
 
+    // Stop presenting on a separate thread.
+    this->StopPresenter();
+
     // Cleanup event dispatchers.
     events.move.Cleanup();
     events.resize.Cleanup();
+    events.coalescedResize.Cleanup();
     events.focus.Cleanup();
     events.close.Cleanup();
     events.keyboardKey.Cleanup();
@@ -226,8 +132,36 @@ void Window::Cleanup()
     events.mouseButton.Cleanup();
     events.mouseScroll.Cleanup();
     events.cursorPosition.Cleanup();
+    events.cursorSamples.Cleanup();
     events.cursorEnter.Cleanup();
 
+    // Discard coalesced input.
+    m_coalesceInput = false;
+    m_cursorPending = false;
+    m_scrollPending = false;
+    m_resizePending = false;
+
+    // Free buffered cursor positions.
+    m_bufferCursorSamples = false;
+    Utility::ClearContainer(m_cursorSamples);
+
+    // Discard queued events.
+    m_eventChannel.Cleanup();
+    m_eventThread = false;
+    m_eventTime = 0.0;
+
+    // Discard measured input latencies.
+    m_inputTime = NoInputTime;
+    m_presentInputTime = NoInputTime;
+    Utility::ClearContainer(m_inputLatencies);
+
+    // Destroy the upload context.
+    if(m_uploadWindow != nullptr)
+    {
+        glfwDestroyWindow(m_uploadWindow);
+        m_uploadWindow = nullptr;
+    }
+
     // Destroy the window.
     if(m_window != nullptr)
     {
@@ -261,7 +195,7 @@ bool Window::Initialize(const WindowInfo& info)
 
         if(!glfwInit())
         {
-            Log() << LogInitializeError() << "Couldn't initialize GLFW library.";
+            LogError() << LogInitializeError() << "Couldn't initialize GLFW library.";
             return false;
         }
 
@@ -285,10 +219,25 @@ bool Window::Initialize(const WindowInfo& info)
 
     if(m_window == nullptr)
     {
-        Log() << LogInitializeError() << "Couldn't create the window.";
+        LogError() << LogInitializeError() << "Couldn't create the window.";
         return false;
     }
 
+    // Create a hidden window for the upload context.
+    // It has no callbacks, as it never receives events.
+    if(info.uploadContext)
+    {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        m_uploadWindow = glfwCreateWindow(1, 1, "", nullptr, m_window);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+        if(m_uploadWindow == nullptr)
+        {
+            LogError() << LogInitializeError() << "Couldn't create the upload context.";
+            return false;
+        }
+    }
+
     // Set window user data.
     glfwSetWindowUserPointer(m_window, this);
 
@@ -296,6 +245,7 @@ bool Window::Initialize(const WindowInfo& info)
     glfwSetWindowPosCallback(m_window, MoveCallback);
     glfwSetFramebufferSizeCallback(m_window, ResizeCallback);
     glfwSetWindowFocusCallback(m_window, FocusCallback);
+    glfwSetWindowIconifyCallback(m_window, IconifyCallback);
     glfwSetWindowCloseCallback(m_window, CloseCallback);
     glfwSetKeyCallback(m_window, KeyboardKeyCallback);
     glfwSetCharCallback(m_window, TextInputCallback);
@@ -304,19 +254,66 @@ bool Window::Initialize(const WindowInfo& info)
     glfwSetCursorPosCallback(m_window, CursorPositionCallback);
     glfwSetCursorEnterCallback(m_window, CursorEnterCallback);
 
+    // Coalesce cursor and scroll events.
+    m_coalesceInput = info.coalesceInput;
+
+    // Buffer cursor positions without allocating per event.
+    if(info.bufferCursorSamples)
+    {
+        m_cursorSamples.reserve(CursorSampleCapacity);
+        m_bufferCursorSamples = true;
+    }
+
+    // Lock the cursor for raw mouse motion.
+    if(info.rawMouseMotion)
+    {
+        this->SetRawMouseMotion(true);
+    }
+
+    // Queue events for the thread that processes them.
+    if(info.eventThread)
+    {
+        if(!m_eventChannel.Initialize(EventQueueCapacity))
+        {
+            LogError() << LogInitializeError() << "Couldn't create the event queue.";
+            return false;
+        }
+
+        m_eventReceiver.Subscribe(m_eventChannel.GetDispatcher());
+        m_eventThread = true;
+    }
+
     // Make window context current.
     glfwMakeContextCurrent(m_window);
 
     // Set the swap interval.
-    glfwSwapInterval((int)info.vsync);
+    // Negative interval enables adaptive vsync if the driver supports it.
+    int swapInterval = info.vsync ? 1 : 0;
+
+    if(info.vsync && info.adaptiveVsync)
+    {
+        if(glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+        {
+            swapInterval = -1;
+        }
+        else
+        {
+            LogWarning() << "Adaptive vsync is not supported. Using vsync instead.";
+        }
+    }
+
+    glfwSwapInterval(swapInterval);
+
+    // Limit the frame rate.
+    m_frameLimiter.SetFrameRate(info.frameLimit);
 
     // Initialize GLEW library.
     GLenum error = glewInit();
 
     if(error != GLEW_OK)
     {
-        Log() << "GLEW Error: " << glewGetErrorString(error);
-        Log() << LogInitializeError() << "Couldn't initialize GLEW library.";
+        LogError() << "GLEW Error: " << glewGetErrorString(error);
+        LogError() << LogInitializeError() << "Couldn't initialize GLEW library.";
         return false;
     }
 
@@ -333,6 +330,24 @@ bool Window::Initialize(const WindowInfo& info)
     glfwGetFramebufferSize(m_window, &windowWidth, &windowHeight);
     Log() << "Create a window (" << windowWidth << "x" << windowHeight << ").";
 
+    // Cache window state, which can be queried from other threads.
+    m_width = windowWidth;
+    m_height = windowHeight;
+    m_focused = glfwGetWindowAttrib(m_window, GLFW_FOCUSED) > 0;
+    m_iconified = glfwGetWindowAttrib(m_window, GLFW_ICONIFIED) > 0;
+
+    // Release the context for the thread that renders.
+    if(info.eventThread)
+    {
+        glfwMakeContextCurrent(nullptr);
+    }
+
+    // Start presenting on a separate thread.
+    if(info.presentThread)
+    {
+        m_presenter = std::thread(&Window::RunPresenter, this);
+    }
+
     return m_initialized = true;
 }
 
@@ -341,26 +356,316 @@ void Window::MakeContextCurrent()
     if(!m_initialized)
         return;
 
+    // Wait for the presenter thread to release the context.
+    if(m_presenter.joinable())
+    {
+        std::unique_lock<std::mutex> lock(m_presentMutex);
+        m_presentCondition.wait(lock, [this]() { return !m_presentPending; });
+    }
+
     glfwMakeContextCurrent(m_window);
 }
 
+void Window::ReleaseContext()
+{
+    if(!m_initialized)
+        return;
+
+    if(glfwGetCurrentContext() == m_window)
+    {
+        glfwMakeContextCurrent(nullptr);
+    }
+}
+
+bool Window::MakeUploadContextCurrent()
+{
+    if(!m_initialized || m_uploadWindow == nullptr)
+        return false;
+
+    glfwMakeContextCurrent(m_uploadWindow);
+    return true;
+}
+
+void Window::ReleaseUploadContext()
+{
+    if(!m_initialized || m_uploadWindow == nullptr)
+        return;
+
+    if(glfwGetCurrentContext() == m_uploadWindow)
+    {
+        glfwMakeContextCurrent(nullptr);
+    }
+}
+
+bool Window::HasUploadContext() const
+{
+    return m_uploadWindow != nullptr;
+}
+
 void Window::ProcessEvents()
 {
     if(!m_initialized)
         return;
 
-    glfwPollEvents();
+    // Dispatch events forwarded by the event thread.
+    if(m_eventThread)
+    {
+        m_eventChannel.Flush();
+    }
+    else
+    {
+        glfwPollEvents();
+
+        // Dispatch input coalesced during polling.
+        this->DispatchCoalescedInput();
+    }
+
+    this->DispatchCursorSamples();
+    this->DispatchCoalescedResize();
 }
 
-void Window::Present()
+void Window::WaitEvents(double timeout)
 {
     if(!m_initialized)
         return;
 
-    glfwSwapBuffers(m_window);
+    // The event thread already waits for system events.
+    if(m_eventThread)
+    {
+        std::this_thread::sleep_for(std::chrono::duration<double>(timeout));
+        m_eventChannel.Flush();
+    }
+    else
+    {
+        // Return early when an event arrives.
+        glfwWaitEventsTimeout(timeout);
+
+        // Dispatch input coalesced during waiting.
+        this->DispatchCoalescedInput();
+    }
+
+    this->DispatchCursorSamples();
+    this->DispatchCoalescedResize();
+}
+
+void Window::PumpEvents()
+{
+    if(!m_initialized)
+        return;
+
+    Assert(m_eventThread, "Pumping events without an event thread!");
+
+    glfwWaitEventsTimeout(EventWaitTimeout);
+
+    // Forward input coalesced during waiting.
+    this->DispatchCoalescedInput();
+}
+
+void Window::DispatchCoalescedInput()
+{
+    if(m_cursorPending)
+    {
+        m_cursorPending = false;
+
+        Events::CursorPosition eventData;
+        eventData.x = m_cursorX;
+        eventData.y = m_cursorY;
+        eventData.time = m_cursorTime;
+
+        this->SendEvent(eventData);
+    }
+
+    if(m_scrollPending)
+    {
+        m_scrollPending = false;
+
+        Events::MouseScroll eventData;
+        eventData.offset = m_scrollOffset;
+        eventData.time = m_scrollTime;
+        m_scrollOffset = 0.0;
+
+        this->SendEvent(eventData);
+    }
+}
+
+void Window::BufferCursorSample(const Events::CursorPosition& event)
+{
+    // Dispatch a full buffer early instead of growing it.
+    if(m_cursorSamples.size() == CursorSampleCapacity)
+    {
+        this->DispatchCursorSamples();
+    }
+
+    Events::CursorSample sample;
+    sample.x = event.x;
+    sample.y = event.y;
+    sample.time = event.time;
+
+    m_cursorSamples.push_back(sample);
+}
+
+void Window::DispatchCursorSamples()
+{
+    if(m_cursorSamples.empty())
+        return;
+
+    Events::CursorSamples eventData;
+    eventData.samples = m_cursorSamples.data();
+    eventData.count = (int)m_cursorSamples.size();
+    eventData.time = m_cursorSamples.front().time;
+
+    events.cursorSamples(eventData);
+
+    m_cursorSamples.clear();
+}
+
+void Window::DispatchCoalescedResize()
+{
+    if(!m_resizePending)
+        return;
+
+    m_resizePending = false;
+
+    events.coalescedResize(m_resize);
+}
+
+void Window::Present(double inputTime)
+{
+    if(!m_initialized)
+        return;
 
     // Check if there are any uncaught OpenGL errors.
     Assert(glGetError() == GL_NO_ERROR, "Found uncaught OpenGL error(s) in the last frame!");
+
+    if(!m_presenter.joinable())
+    {
+        this->SwapBuffers(inputTime);
+        return;
+    }
+
+    // Hand the context over to the presenter thread.
+    glfwMakeContextCurrent(nullptr);
+
+    {
+        std::lock_guard<std::mutex> lock(m_presentMutex);
+        m_presentPending = true;
+        m_presentInputTime = inputTime;
+    }
+
+    m_presentCondition.notify_all();
+}
+
+double Window::TakeInputTime()
+{
+    double inputTime = m_inputTime;
+    m_inputTime = NoInputTime;
+
+    return inputTime;
+}
+
+void Window::CollectInputLatencies(std::vector<double>& latencies)
+{
+    std::lock_guard<std::mutex> lock(m_presentMutex);
+
+    latencies.insert(latencies.end(), m_inputLatencies.begin(), m_inputLatencies.end());
+    m_inputLatencies.clear();
+}
+
+void Window::SwapBuffers(double inputTime)
+{
+    glfwSwapBuffers(m_window);
+
+    // Measure the latency before waiting for the frame limit, which delays the next frame instead.
+    if(inputTime != NoInputTime)
+    {
+        double latency = glfwGetTime() - inputTime;
+
+        std::lock_guard<std::mutex> lock(m_presentMutex);
+        m_inputLatencies.push_back(latency);
+    }
+
+    // Wait for the frame limit after the swap, so the frame time includes it.
+    m_frameLimiter.Wait();
+}
+
+void Window::StopPresenter()
+{
+    if(!m_presenter.joinable())
+        return;
+
+    // Stop the presenter thread after a pending present.
+    {
+        std::lock_guard<std::mutex> lock(m_presentMutex);
+        m_presenterExit = true;
+    }
+
+    m_presentCondition.notify_all();
+    m_presenter.join();
+
+    m_presentPending = false;
+    m_presenterExit = false;
+
+    // Take the context back.
+    glfwMakeContextCurrent(m_window);
+}
+
+void Window::RunPresenter()
+{
+    std::unique_lock<std::mutex> lock(m_presentMutex);
+
+    while(true)
+    {
+        m_presentCondition.wait(lock, [this]() { return m_presentPending || m_presenterExit; });
+
+        if(!m_presentPending)
+            break;
+
+        // Present without holding the lock.
+        double inputTime = m_presentInputTime;
+        lock.unlock();
+
+        glfwMakeContextCurrent(m_window);
+        this->SwapBuffers(inputTime);
+        glfwMakeContextCurrent(nullptr);
+
+        lock.lock();
+
+        // Let the context be taken back.
+        m_presentPending = false;
+        m_presentCondition.notify_all();
+    }
+}
+
+void Window::SetRawMouseMotion(bool enabled)
+{
+    // Also called while initializing.
+    if(m_window == nullptr)
+        return;
+
+    // Raw motion is only reported while the cursor is disabled.
+    glfwSetInputMode(m_window, GLFW_CURSOR, enabled ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);
+
+#if defined(GLFW_RAW_MOUSE_MOTION)
+    if(glfwRawMouseMotionSupported())
+    {
+        glfwSetInputMode(m_window, GLFW_RAW_MOUSE_MOTION, enabled ? GLFW_TRUE : GLFW_FALSE);
+        return;
+    }
+#endif
+
+    if(enabled)
+    {
+        LogWarning() << "Raw mouse motion is not supported. Using accelerated motion instead.";
+    }
+}
+
+bool Window::IsRawMouseMotionSupported() const
+{
+#if defined(GLFW_RAW_MOUSE_MOTION)
+    return glfwRawMouseMotionSupported() == GLFW_TRUE;
+#else
+    return false;
+#endif
 }
 
 void Window::Close()
@@ -369,6 +674,12 @@ void Window::Close()
         return;
 
     glfwSetWindowShouldClose(m_window, GL_TRUE);
+
+    // Wake up the event thread.
+    if(m_eventThread)
+    {
+        glfwPostEmptyEvent();
+    }
 }
 
 bool Window::IsOpen() const
@@ -384,7 +695,15 @@ bool Window::IsFocused() const
     if(!m_initialized)
         return false;
 
-    return glfwGetWindowAttrib(m_window, GLFW_FOCUSED) > 0;
+    return m_focused;
+}
+
+bool Window::IsIconified() const
+{
+    if(!m_initialized)
+        return false;
+
+    return m_iconified;
 }
 
 int Window::GetWidth() const
@@ -392,9 +711,7 @@ int Window::GetWidth() const
     if(!m_initialized)
         return 0;
 
-    int width = 0;
-    glfwGetFramebufferSize(m_window, &width, nullptr);
-    return width;
+    return m_width;
 }
 
 int Window::GetHeight() const
@@ -402,12 +719,412 @@ int Window::GetHeight() const
     if(!m_initialized)
         return 0;
 
-    int height = 0;
-    glfwGetFramebufferSize(m_window, nullptr, &height);
-    return height;
+    return m_height;
+}
+
+double Window::GetEventTime() const
+{
+    return m_eventTime;
+}
+
+double Window::GetTime()
+{
+    return glfwGetTime();
 }
 
 GLFWwindow* Window::GetPrivate()
 {
     return m_window;
 }
+
+template<typename Event>
+void Window::SendEvent(const Event& event, Dispatcher<void(const Event&)>& dispatcher, Event QueuedEvent::* member, QueuedEventTypes::Type type)
+{
+    if(m_eventThread)
+    {
+        // Forward the event with its timestamp.
+        QueuedEvent queuedEvent;
+        queuedEvent.type = type;
+        queuedEvent.time = event.time;
+        queuedEvent.*member = event;
+
+        m_eventChannel.Push(queuedEvent);
+    }
+    else
+    {
+        // Dispatch the event right away.
+        m_eventTime = event.time;
+
+        if(IsInputEvent(type))
+        {
+            m_inputTime = m_inputTime == NoInputTime ? event.time : std::min(m_inputTime, event.time);
+        }
+
+        dispatcher(event);
+    }
+}
+
+void Window::SendEvent(const Events::Move& event)
+{
+    this->SendEvent(event, events.move, &QueuedEvent::move, QueuedEventTypes::Move);
+}
+
+void Window::SendEvent(const Events::Resize& event)
+{
+    this->SendEvent(event, events.resize, &QueuedEvent::resize, QueuedEventTypes::Resize);
+
+    // Forwarded events are coalesced once dispatched.
+    if(!m_eventThread)
+    {
+        m_resizePending = true;
+        m_resize = event;
+    }
+}
+
+void Window::SendEvent(const Events::Focus& event)
+{
+    this->SendEvent(event, events.focus, &QueuedEvent::focus, QueuedEventTypes::Focus);
+}
+
+void Window::SendEvent(const Events::Close& event)
+{
+    this->SendEvent(event, events.close, &QueuedEvent::close, QueuedEventTypes::Close);
+}
+
+void Window::SendEvent(const Events::KeyboardKey& event)
+{
+    this->SendEvent(event, events.keyboardKey, &QueuedEvent::keyboardKey, QueuedEventTypes::KeyboardKey);
+}
+
+void Window::SendEvent(const Events::TextInput& event)
+{
+    this->SendEvent(event, events.textInput, &QueuedEvent::textInput, QueuedEventTypes::TextInput);
+}
+
+void Window::SendEvent(const Events::MouseButton& event)
+{
+    this->SendEvent(event, events.mouseButton, &QueuedEvent::mouseButton, QueuedEventTypes::MouseButton);
+}
+
+void Window::SendEvent(const Events::MouseScroll& event)
+{
+    this->SendEvent(event, events.mouseScroll, &QueuedEvent::mouseScroll, QueuedEventTypes::MouseScroll);
+}
+
+void Window::SendEvent(const Events::CursorPosition& event)
+{
+    this->SendEvent(event, events.cursorPosition, &QueuedEvent::cursorPosition, QueuedEventTypes::CursorPosition);
+}
+
+void Window::SendEvent(const Events::CursorEnter& event)
+{
+    this->SendEvent(event, events.cursorEnter, &QueuedEvent::cursorEnter, QueuedEventTypes::CursorEnter);
+}
+
+void Window::DispatchQueuedEvent(const QueuedEvent& event)
+{
+    m_eventTime = event.time;
+
+    if(IsInputEvent(event.type))
+    {
+        m_inputTime = m_inputTime == NoInputTime ? event.time : std::min(m_inputTime, event.time);
+    }
+
+    switch(event.type)
+    {
+    case QueuedEventTypes::Move:
+        events.move(event.move);
+        break;
+
+    case QueuedEventTypes::Resize:
+        events.resize(event.resize);
+        m_resizePending = true;
+        m_resize = event.resize;
+        break;
+
+    case QueuedEventTypes::Focus:
+        events.focus(event.focus);
+        break;
+
+    case QueuedEventTypes::Close:
+        events.close(event.close);
+        break;
+
+    case QueuedEventTypes::KeyboardKey:
+        events.keyboardKey(event.keyboardKey);
+        break;
+
+    case QueuedEventTypes::TextInput:
+        events.textInput(event.textInput);
+        break;
+
+    case QueuedEventTypes::MouseButton:
+        events.mouseButton(event.mouseButton);
+        break;
+
+    case QueuedEventTypes::MouseScroll:
+        events.mouseScroll(event.mouseScroll);
+        break;
+
+    case QueuedEventTypes::CursorPosition:
+        if(m_bufferCursorSamples)
+        {
+            this->BufferCursorSample(event.cursorPosition);
+        }
+
+        events.cursorPosition(event.cursorPosition);
+        break;
+
+    case QueuedEventTypes::CursorEnter:
+        events.cursorEnter(event.cursorEnter);
+        break;
+    }
+}
+
+bool Window::IsInputEvent(QueuedEventTypes::Type type)
+{
+    switch(type)
+    {
+    case QueuedEventTypes::KeyboardKey:
+    case QueuedEventTypes::TextInput:
+    case QueuedEventTypes::MouseButton:
+    case QueuedEventTypes::MouseScroll:
+    case QueuedEventTypes::CursorPosition:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+void Window::MoveCallback(GLFWwindow* window, int x, int y)
+{
+    Assert(window != nullptr);
+
+    // Get the window instance.
+    auto instance = reinterpret_cast<System::Window*>(glfwGetWindowUserPointer(window));
+    Assert(instance != nullptr);
+
+    // Send an event.
+    Window::Events::Move eventData;
+    eventData.x = x;
+    eventData.y = y;
+    eventData.time = glfwGetTime();
+
+    instance->SendEvent(eventData);
+}
+
+void Window::ResizeCallback(GLFWwindow* window, int width, int height)
+{
+    Assert(window != nullptr);
+
+    // Get the window instance.
+    auto instance = reinterpret_cast<System::Window*>(glfwGetWindowUserPointer(window));
+    Assert(instance != nullptr);
+
+    // Cache the framebuffer size.
+    instance->m_width = width;
+    instance->m_height = height;
+
+    // Send an event.
+    Window::Events::Resize eventData;
+    eventData.width = width;
+    eventData.height = height;
+    eventData.time = glfwGetTime();
+
+    instance->SendEvent(eventData);
+}
+
+void Window::FocusCallback(GLFWwindow* window, int focused)
+{
+    Assert(window != nullptr);
+
+    // Get the window instance.
+    auto instance = reinterpret_cast<System::Window*>(glfwGetWindowUserPointer(window));
+    Assert(instance != nullptr);
+
+    // Cache the focus state.
+    instance->m_focused = focused > 0;
+
+    // Send an event.
+    Window::Events::Focus eventData;
+    eventData.focused = focused > 0;
+    eventData.time = glfwGetTime();
+
+    instance->SendEvent(eventData);
+}
+
+void Window::IconifyCallback(GLFWwindow* window, int iconified)
+{
+    Assert(window != nullptr);
+
+    // Get the window instance.
+    auto instance = reinterpret_cast<System::Window*>(glfwGetWindowUserPointer(window));
+    Assert(instance != nullptr);
+
+    // Cache the iconify state.
+    instance->m_iconified = iconified > 0;
+}
+
+void Window::CloseCallback(GLFWwindow* window)
+{
+    Assert(window != nullptr);
+
+    // Get the window instance.
+    auto instance = reinterpret_cast<System::Window*>(glfwGetWindowUserPointer(window));
+    Assert(instance != nullptr);
+
+    // Send an event.
+    Window::Events::Close eventData;
+    eventData.time = glfwGetTime();
+
+    instance->SendEvent(eventData);
+}
+
+void Window::KeyboardKeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    Assert(window != nullptr);
+
+    // Get the window instance.
+    auto instance = reinterpret_cast<System::Window*>(glfwGetWindowUserPointer(window));
+    Assert(instance != nullptr);
+
+    // Send coalesced input first to preserve the order of events.
+    instance->DispatchCoalescedInput();
+
+    // Send an event.
+    Window::Events::KeyboardKey eventData;
+    eventData.key = key;
+    eventData.scancode = scancode;
+    eventData.action = action;
+    eventData.mods = mods;
+    eventData.time = glfwGetTime();
+
+    instance->SendEvent(eventData);
+}
+
+void Window::TextInputCallback(GLFWwindow* window, unsigned int character)
+{
+    Assert(window != nullptr);
+
+    // Get the window instance.
+    auto instance = reinterpret_cast<System::Window*>(glfwGetWindowUserPointer(window));
+    Assert(instance != nullptr);
+
+    // Send coalesced input first to preserve the order of events.
+    instance->DispatchCoalescedInput();
+
+    // Send an event.
+    Window::Events::TextInput eventData;
+    eventData.character = character;
+    eventData.time = glfwGetTime();
+
+    instance->SendEvent(eventData);
+}
+
+void Window::MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
+{
+    Assert(window != nullptr);
+
+    // Get the window instance.
+    auto instance = reinterpret_cast<System::Window*>(glfwGetWindowUserPointer(window));
+    Assert(instance != nullptr);
+
+    // Send coalesced input first to preserve the order of events.
+    instance->DispatchCoalescedInput();
+
+    // Send an event.
+    Window::Events::MouseButton eventData;
+    eventData.button = button;
+    eventData.action = action;
+    eventData.mods = mods;
+    eventData.time = glfwGetTime();
+
+    instance->SendEvent(eventData);
+}
+
+void Window::MouseScrollCallback(GLFWwindow* window, double offsetx, double offsety)
+{
+    Assert(window != nullptr);
+
+    // Get the window instance.
+    auto instance = reinterpret_cast<System::Window*>(glfwGetWindowUserPointer(window));
+    Assert(instance != nullptr);
+
+    // Accumulate the offset until the end of event processing.
+    if(instance->m_coalesceInput)
+    {
+        if(!instance->m_scrollPending)
+        {
+            instance->m_scrollTime = glfwGetTime();
+        }
+
+        instance->m_scrollOffset += offsety;
+        instance->m_scrollPending = true;
+        return;
+    }
+
+    // Send an event.
+    Window::Events::MouseScroll eventData;
+    eventData.offset = offsety;
+    eventData.time = glfwGetTime();
+
+    instance->SendEvent(eventData);
+}
+
+void Window::CursorPositionCallback(GLFWwindow* window, double x, double y)
+{
+    Assert(window != nullptr);
+
+    // Get the window instance.
+    auto instance = reinterpret_cast<System::Window*>(glfwGetWindowUserPointer(window));
+    Assert(instance != nullptr);
+
+    Window::Events::CursorPosition eventData;
+    eventData.x = x;
+    eventData.y = y;
+    eventData.time = glfwGetTime();
+
+    // Buffer every position on the thread that processes events.
+    if(instance->m_bufferCursorSamples && !instance->m_eventThread)
+    {
+        instance->BufferCursorSample(eventData);
+    }
+
+    // Keep the latest position until the end of event processing.
+    // Forwarded positions are buffered when dispatched, so they are not coalesced.
+    if(instance->m_coalesceInput && !(instance->m_bufferCursorSamples && instance->m_eventThread))
+    {
+        if(!instance->m_cursorPending)
+        {
+            instance->m_cursorTime = eventData.time;
+        }
+
+        instance->m_cursorX = x;
+        instance->m_cursorY = y;
+        instance->m_cursorPending = true;
+        return;
+    }
+
+    // Send an event.
+    instance->SendEvent(eventData);
+}
+
+void Window::CursorEnterCallback(GLFWwindow* window, int entered)
+{
+    Assert(window != nullptr);
+
+    // Get the window instance.
+    auto instance = reinterpret_cast<System::Window*>(glfwGetWindowUserPointer(window));
+    Assert(instance != nullptr);
+
+    // Send coalesced input first to preserve the order of events.
+    instance->DispatchCoalescedInput();
+
+    // Send an event.
+    Window::Events::CursorEnter eventData;
+    eventData.entered = entered != 0;
+    eventData.time = glfwGetTime();
+
+    instance->SendEvent(eventData);
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Precompiled.hpp"
+#include "Common/EventChannel.hpp"
+#include "FrameLimiter.hpp"
 
 //
 // Window
@@ -21,6 +23,149 @@
 //          window.Present();
 //      }
 //
+//  Presenting can be paced by vsync, adaptive vsync that tears instead of
+//  stalling on late frames, or a frame limiter. Presenting can also be done
+//  on a separate thread, which waits for the swap while the calling thread
+//  continues with the next frame. The context is then released after each
+//  present and has to be made current again before rendering.
+//
+//  Example usage:
+//      System::WindowInfo info;
+//      info.vsync = false;
+//      info.frameLimit = 144.0;
+//      info.presentThread = true;
+//
+//      window.Initialize(info);
+//
+//      while(window.IsOpen())
+//      {
+//          window.ProcessEvents();
+//          /* Simulate while the previous frame is presented. */
+//
+//          window.MakeContextCurrent();
+//          /* Render. */
+//
+//          window.Present();
+//      }
+//
+//  Cursor and scroll events can be coalesced when processing events, which
+//  dispatches the latest cursor position and the sum of scroll offsets once
+//  instead of for every motion reported by the system. Other events are
+//  dispatched exactly, after the coalesced events that preceded them.
+//
+//  Consumers that want every cursor sample, such as aim smoothing, can have
+//  cursor positions buffered into an array that is dispatched once per
+//  processed batch of events, instead of receiving a dispatch per sample.
+//  The buffer is allocated once, so buffering doesn't allocate per event.
+//  Buffered samples are taken before coalescing, so coalesced cursor events
+//  can still be received alongside them.
+//
+//  Raw mouse motion hides and locks the cursor and reports unaccelerated
+//  motion as unbounded cursor positions, for camera and aim controls. It
+//  needs GLFW 3.3 headers, otherwise only the cursor is locked and motion
+//  keeps the acceleration of the system.
+//
+//  Example usage:
+//      System::WindowInfo info;
+//      info.bufferCursorSamples = true;
+//      info.rawMouseMotion = true;
+//
+//      window.Initialize(info);
+//
+//      void Aim::OnCursorSamples(const Window::Events::CursorSamples& event)
+//      {
+//          for(int i = 0; i < event.count; ++i)
+//          {
+//              /* Smooth event.samples[i] */
+//          }
+//      }
+//
+//  Events can also be pumped on the thread that created the window, which
+//  only waits for system events and forwards them with their timestamps
+//  through a lock-free queue. Another thread owns the context, renders and
+//  dispatches forwarded events to receivers when it processes events, so
+//  input is sampled as soon as it arrives instead of once per frame.
+//
+//  Example usage:
+//      System::WindowInfo info;
+//      info.eventThread = true;
+//
+//      window.Initialize(info);
+//
+//      std::thread renderThread([&]()
+//      {
+//          window.MakeContextCurrent();
+//
+//          while(window.IsOpen())
+//          {
+//              window.ProcessEvents();
+//              /* ... */
+//              window.Present();
+//          }
+//      });
+//
+//      while(window.IsOpen())
+//      {
+//          window.PumpEvents();
+//      }
+//
+//      renderThread.join();
+//
+//  Resize events are sent for every size the framebuffer goes through while
+//  the window is being dragged. The coalesced resize event is dispatched
+//  once per processed batch of events with the final size, so receivers
+//  that reallocate resources, such as render targets, do it once per frame.
+//
+//  Events can also be waited for, which blocks until an event arrives or
+//  a timeout passes. Applications use it to throttle frames while the window
+//  is minimized or in the background, instead of spinning at full rate.
+//
+//  Example usage:
+//      while(window.IsOpen())
+//      {
+//          if(window.IsIconified() || !window.IsFocused())
+//          {
+//              window.WaitEvents(1.0 / 15.0);
+//              continue;
+//          }
+//
+//          window.ProcessEvents();
+//          /* ... */
+//      }
+//
+//  Input latency is measured from the arrival of input to the end of the
+//  present of the first frame that reflects it. The thread that processes
+//  events takes the arrival time of input dispatched for a frame and passes
+//  it to the present of that frame, possibly through a render thread. The
+//  end of a present is when the swap returns, so the latency of the display
+//  itself is not included.
+//
+//  Example usage:
+//      window.ProcessEvents();
+//      /* ... */
+//      window.Present(window.TakeInputTime());
+//
+//      std::vector<double> latencies;
+//      window.CollectInputLatencies(latencies);
+//
+//  A hidden upload context that shares objects with the window's context can
+//  be created, so a loader thread can upload textures and buffers while the
+//  render thread keeps drawing. Uploads have to be followed by a fence that
+//  the loader waits for before other contexts use the objects.
+//
+//  Example usage:
+//      System::WindowInfo info;
+//      info.uploadContext = true;
+//
+//      window.Initialize(info);
+//
+//      std::thread loader([&]()
+//      {
+//          window.MakeUploadContextCurrent();
+//          /* Upload and fence. */
+//          window.ReleaseUploadContext();
+//      });
+//
 //  Binding events:
 //      void Class::OnKeyboardKey(const Window::Events::KeyboardKey& event) { /*...*/ }
 //      
@@ -40,12 +185,41 @@ namespace System
         int height;
         bool vsync;
 
+        // Tears late frames instead of waiting for the next vertical blank.
+        // Falls back to vsync if not supported.
+        bool adaptiveVsync;
+
+        // Maximum number of presented frames per second, unlimited if zero.
+        double frameLimit;
+
+        // Presents frames on a separate thread.
+        bool presentThread;
+
+        // Dispatches a single cursor position and scroll event per processed batch of events.
+        bool coalesceInput;
+
+        // Forwards events pumped on the creating thread to the thread that processes them.
+        bool eventThread;
+
+        // Dispatches all cursor positions of a processed batch of events at once.
+        bool bufferCursorSamples;
+
+        // Locks the cursor and reports unaccelerated motion where supported.
+        bool rawMouseMotion;
+
+        // Creates a hidden context sharing objects with the window's context.
+        bool uploadContext;
+
         WindowInfo();
     };
 
     // Window class.
     class Window : private NonCopyable
     {
+    public:
+        // Input time of frames that reflect no new input.
+        static const double NoInputTime;
+
     public:
         Window();
         ~Window();
@@ -57,13 +231,53 @@ namespace System
         bool Initialize(const WindowInfo& info = WindowInfo());
 
         // Makes window's context current.
+        // Waits for the previous frame to be presented when presenting on a separate thread.
         void MakeContextCurrent();
 
+        // Releases window's context from the calling thread.
+        void ReleaseContext();
+
+        // Makes the shared upload context current on the calling thread.
+        // Returns false if the window has no upload context.
+        bool MakeUploadContextCurrent();
+
+        // Releases the shared upload context from the calling thread.
+        void ReleaseUploadContext();
+
+        // Checks if the window has a shared upload context.
+        bool HasUploadContext() const;
+
         // Processes window events.
+        // Dispatches forwarded events when events are pumped on another thread.
         void ProcessEvents();
 
+        // Processes window events, waiting for them up to a timeout in seconds.
+        // Sleeps for the timeout when events are pumped on another thread.
+        void WaitEvents(double timeout);
+
+        // Waits for system events and forwards them to the thread that processes events.
+        // Has to be called on the thread that initialized the window.
+        void PumpEvents();
+
         // Presents backbuffer content on the window.
-        void Present();
+        // Releases the context when presenting on a separate thread.
+        // Measures input latency if given the input time of the presented frame.
+        void Present(double inputTime = NoInputTime);
+
+        // Takes the arrival time of the oldest input dispatched since the last call.
+        // Returns NoInputTime if no input has been dispatched.
+        double TakeInputTime();
+
+        // Appends latencies from the arrival of input to the end of the present that
+        // reflected it, measured since the last call, and forgets them.
+        void CollectInputLatencies(std::vector<double>& latencies);
+
+        // Enables or disables raw mouse motion, which locks the cursor.
+        // Has to be called on the thread that initialized the window.
+        void SetRawMouseMotion(bool enabled);
+
+        // Checks if the system reports unaccelerated mouse motion.
+        bool IsRawMouseMotionSupported() const;
 
         // Closes the window.
         void Close();
@@ -74,17 +288,29 @@ namespace System
         // Checks if window is focused.
         bool IsFocused() const;
 
+        // Checks if window is minimized.
+        bool IsIconified() const;
+
         // Gets window's width.
         int GetWidth() const;
 
         // Gets window's height.
         int GetHeight() const;
 
+        // Gets the time of the event being dispatched in seconds.
+        double GetEventTime() const;
+
+        // Gets the current time in seconds from the clock of event times.
+        static double GetTime();
+
         // Gets window's private data.
         GLFWwindow* GetPrivate();
 
     public:
         // Window events.
+        // Every event carries the time it arrived at in seconds, from the same
+        // clock as GetTime(). Coalesced events carry the time of the oldest
+        // input they combine.
         struct Events
         {
             // Move event.
@@ -92,6 +318,7 @@ namespace System
             {
                 int x;
                 int y;
+                double time;
             };
 
             Dispatcher<void(const Move&)> move;
@@ -101,14 +328,20 @@ namespace System
             {
                 int width;
                 int height;
+                double time;
             };
 
             Dispatcher<void(const Resize&)> resize;
 
+            // Coalesced resize event.
+            // Dispatched once per processed batch of events with the final size.
+            Dispatcher<void(const Resize&)> coalescedResize;
+
             // Focus event.
             struct Focus
             {
                 bool focused;
+                double time;
             };
 
             Dispatcher<void(const Focus&)> focus;
@@ -116,17 +349,20 @@ namespace System
             // Close event.
             struct Close
             {
+                double time;
             };
 
             Dispatcher<void(const Close&)> close;
 
             // Keyboard key event.
+            // Receivers can set a key to only receive events of that key.
             struct KeyboardKey
             {
                 int key;
                 int scancode;
                 int action;
                 int mods;
+                double time;
             };
 
             Dispatcher<void(const KeyboardKey&)> keyboardKey;
@@ -135,16 +371,19 @@ namespace System
             struct TextInput
             {
                 unsigned int character;
+                double time;
             };
 
             Dispatcher<void(const TextInput&)> textInput;
 
             // Mouse button event.
+            // Receivers can set a button as a key to only receive events of that button.
             struct MouseButton
             {
                 int button;
                 int action;
                 int mods;
+                double time;
             };
 
             Dispatcher<void(const MouseButton&)> mouseButton;
@@ -153,6 +392,7 @@ namespace System
             struct MouseScroll
             {
                 double offset;
+                double time;
             };
 
             Dispatcher<void(const MouseScroll&)> mouseScroll;
@@ -162,23 +402,197 @@ namespace System
             {
                 double x;
                 double y;
+                double time;
             };
 
             Dispatcher<void(const CursorPosition&)> cursorPosition;
 
+            // Buffered cursor positions event.
+            // Dispatched once per processed batch of events with positions in arrival order.
+            // Samples are only valid during the dispatch.
+            struct CursorSample
+            {
+                double x;
+                double y;
+                double time;
+            };
+
+            struct CursorSamples
+            {
+                const CursorSample* samples;
+                int count;
+                double time;
+            };
+
+            Dispatcher<void(const CursorSamples&)> cursorSamples;
+
             // Cursor enter event.
             struct CursorEnter
             {
                 bool entered;
+                double time;
             };
 
             Dispatcher<void(const CursorEnter&)> cursorEnter;
         } events;
 
+    private:
+        // Types of queued events.
+        struct QueuedEventTypes
+        {
+            enum Type
+            {
+                Move,
+                Resize,
+                Focus,
+                Close,
+                KeyboardKey,
+                TextInput,
+                MouseButton,
+                MouseScroll,
+                CursorPosition,
+                CursorEnter,
+            };
+        };
+
+        // Event forwarded by the event thread.
+        struct QueuedEvent
+        {
+            QueuedEventTypes::Type type;
+            double time;
+
+            union
+            {
+                Events::Move move;
+                Events::Resize resize;
+                Events::Focus focus;
+                Events::Close close;
+                Events::KeyboardKey keyboardKey;
+                Events::TextInput textInput;
+                Events::MouseButton mouseButton;
+                Events::MouseScroll mouseScroll;
+                Events::CursorPosition cursorPosition;
+                Events::CursorEnter cursorEnter;
+            };
+        };
+
+    private:
+        // Window callbacks.
+        static void MoveCallback(GLFWwindow* window, int x, int y);
+        static void ResizeCallback(GLFWwindow* window, int width, int height);
+        static void FocusCallback(GLFWwindow* window, int focused);
+        static void IconifyCallback(GLFWwindow* window, int iconified);
+        static void CloseCallback(GLFWwindow* window);
+        static void KeyboardKeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+        static void TextInputCallback(GLFWwindow* window, unsigned int character);
+        static void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+        static void MouseScrollCallback(GLFWwindow* window, double offsetx, double offsety);
+        static void CursorPositionCallback(GLFWwindow* window, double x, double y);
+        static void CursorEnterCallback(GLFWwindow* window, int entered);
+
+        // Dispatches an event, or forwards it to the thread that processes events.
+        template<typename Event>
+        void SendEvent(const Event& event, Dispatcher<void(const Event&)>& dispatcher, Event QueuedEvent::* member, QueuedEventTypes::Type type);
+
+        void SendEvent(const Events::Move& event);
+        void SendEvent(const Events::Resize& event);
+        void SendEvent(const Events::Focus& event);
+        void SendEvent(const Events::Close& event);
+        void SendEvent(const Events::KeyboardKey& event);
+        void SendEvent(const Events::TextInput& event);
+        void SendEvent(const Events::MouseButton& event);
+        void SendEvent(const Events::MouseScroll& event);
+        void SendEvent(const Events::CursorPosition& event);
+        void SendEvent(const Events::CursorEnter& event);
+
+        // Dispatches an event forwarded by the event thread.
+        void DispatchQueuedEvent(const QueuedEvent& event);
+
+        // Checks if an event type is user input.
+        static bool IsInputEvent(QueuedEventTypes::Type type);
+
+        // Dispatches coalesced cursor and scroll events.
+        void DispatchCoalescedInput();
+
+        // Buffers a cursor position on the thread that processes events.
+        void BufferCursorSample(const Events::CursorPosition& event);
+
+        // Dispatches buffered cursor positions.
+        void DispatchCursorSamples();
+
+        // Dispatches the coalesced resize event on the thread that processes events.
+        void DispatchCoalescedResize();
+
+        // Swaps buffers and waits for the frame limit.
+        // Records the input latency of the presented frame.
+        void SwapBuffers(double inputTime);
+
+        // Stops the presenter thread.
+        void StopPresenter();
+
+        // Runs the presenter thread.
+        void RunPresenter();
+
     private:
         // Window implementation.
         GLFWwindow* m_window;
 
+        // Hidden window with a context sharing objects with the window's context.
+        GLFWwindow* m_uploadWindow;
+
+        // Frame rate limiter.
+        FrameLimiter m_frameLimiter;
+
+        // Presenter thread.
+        std::thread m_presenter;
+        std::mutex m_presentMutex;
+        std::condition_variable m_presentCondition;
+        bool m_presentPending;
+        bool m_presenterExit;
+        double m_presentInputTime;
+
+        // Input latencies of presented frames, guarded by the present mutex.
+        std::vector<double> m_inputLatencies;
+
+        // Coalesced input.
+        bool m_coalesceInput;
+
+        bool m_cursorPending;
+        double m_cursorX;
+        double m_cursorY;
+
+        bool m_scrollPending;
+        double m_scrollOffset;
+
+        // Arrival times of the oldest coalesced cursor and scroll input.
+        double m_cursorTime;
+        double m_scrollTime;
+
+        // Buffered cursor positions, tracked on the thread that processes events.
+        bool m_bufferCursorSamples;
+        std::vector<Events::CursorSample> m_cursorSamples;
+
+        // Coalesced resize, tracked on the thread that processes events.
+        bool m_resizePending;
+        Events::Resize m_resize;
+
+        // Events forwarded by the event thread.
+        EventChannel<void(const QueuedEvent&)> m_eventChannel;
+        Receiver<void(const QueuedEvent&)> m_eventReceiver;
+        bool m_eventThread;
+
+        // Time of the event being dispatched.
+        double m_eventTime;
+
+        // Arrival time of the oldest input dispatched since it was last taken.
+        double m_inputTime;
+
+        // Window state cached for other threads.
+        std::atomic<int> m_width;
+        std::atomic<int> m_height;
+        std::atomic<bool> m_focused;
+        std::atomic<bool> m_iconified;
+
         // Initialization state.
         bool m_initialized;
     };